@@ -24,7 +24,16 @@
 
 #include <onnx-mlir/Runtime/OMTensor.h>
 #include <onnx-mlir/Runtime/OMTensorList.h>
+#include <onnx-mlir/Runtime/OMAlloc.h>
+#include <onnx-mlir/Runtime/OMArena.h>
+#include <onnx-mlir/Runtime/OMBatch.h>
+#include <onnx-mlir/Runtime/OMHugePages.h>
+#include <onnx-mlir/Runtime/OMInstrument.h>
+#include <onnx-mlir/Runtime/OMMicroKernel.h>
+#include <onnx-mlir/Runtime/OMNuma.h>
 #include <onnx-mlir/Runtime/OMSignature.h>
+#include <onnx-mlir/Runtime/OMThreadPool.h>
+#include <onnx-mlir/Runtime/OMWeights.h>
 
 /*! \mainpage ONNX-MLIR Runtime API documentation
  *
@@ -58,6 +67,42 @@
  * Intuitively, the model takes a list of tensors as input and returns a list of
  * ensors as output.
  *
+ * Compiled models also provide a variant copying the outputs into tensors
+ * preallocated by the caller, which avoids allocating new output tensors,
+ * shapes and lists on every inference:
+ *
+ * ```c
+ * int run_main_graph_into(OMTensorList *inputs, OMTensorList *outputs);
+ * ```
+ *
+ * Each output tensor must have the rank of the corresponding model output and
+ * a buffer large enough to hold it; its shape and strides are updated. The
+ * caller keeps the ownership of all the tensors. The model still computes
+ * each output in a buffer of its own, copied into the buffer of the output
+ * tensor and freed, so that the variant saves the allocation of the tensors
+ * but not the copy of the outputs. The function returns 0 on success, and -1
+ * if the output tensors do not match the model outputs.
+ *
+ * Both entry points check the number, data types, ranks and static dimensions
+ * of the input tensors against the table returned by `omInputSignatureTable`
+ * before running the model, and return NULL, respectively -1, when they do not
+ * match. The table, like the one of `omOutputSignatureTable`, holds the number
+ * of tensors followed, for each one, by its ONNX data type, its rank and its
+ * dimensions, -1 for the dynamic ones, and is cheaper to read than the JSON
+ * signatures.
+ *
+ * The input tensors may be strided, e.g. views of sliced arrays: the model
+ * works on a contiguous copy of the inputs it reads when their strides are
+ * not dense, so that the caller need not copy them. The inputs that the
+ * model may return as a view in its outputs must be contiguous, unless the
+ * model only returns them, and the entry points fail otherwise.
+ *
+ * A library compiled with `--entryPoint=<name>=<file.onnx>` also contains the
+ * model of each given file, e.g. the decoder of an encoder-decoder model, as
+ * the entry points `run_<name>` and `run_<name>_into`, whose signatures are
+ * returned by `omInputSignature_<name>` and `omOutputSignature_<name>`. The
+ * constants shared by the models are stored once in the library.
+ *
  * \subsection invoke-models-using-c-runtime-api Invoke Models Using C Runtime
  * API
  *
@@ -110,11 +155,168 @@
  * ```
  * Exactly as it should be.
  *
+ * \subsection thread-pool Thread Pool
+ *
+ * Models compiled with `--enableParallel` execute their parallel loops on a
+ * thread pool that is part of the runtime. The worker threads are created on
+ * the first parallel loop and reused by all the subsequent inferences. The
+ * number of threads defaults to the `OM_NUM_THREADS` environment variable, or
+ * to the number of CPUs available to the process, and can be changed with
+ * `omThreadPoolSetNumThreads`. The worker threads can be pinned to a set of
+ * CPUs, e.g. to the cores of one NUMA node, with `omThreadPoolSetAffinity`:
+ *
+ * ```c
+ * int cpus[] = {0, 1, 2, 3};
+ * omThreadPoolSetAffinity(cpus, 4);
+ * OMTensorList *outputList = run_main_graph(input);
+ * ```
+ *
+ * \subsection memory-arenas Memory Arenas
+ *
+ * Models compiled with `--memPoolArena=shared` or `--memPoolArena=thread`
+ * keep their memory pools in arenas allocated on the first inference and
+ * reused by the subsequent ones. Shared arenas must only be used by one
+ * inference at a time, while thread-local arenas let each thread run its own
+ * inferences concurrently. Arenas holding dynamic memory pools keep the
+ * largest buffer requested so far, whose size is returned by
+ * `omArenaGetHighWaterMark`, and are only reallocated when an inference needs
+ * more memory. The arenas can be freed with `omArenaRelease`. The arena
+ * identifiers of a library are offset by a base reserved on its first
+ * inference, see `omArenaReserveIds`, so that the models calling the same
+ * runtime keep their own arenas.
+ *
+ * \subsection huge-pages Huge Pages
+ *
+ * Models with large weights or memory pools take many TLB misses on regular
+ * pages. Setting the `OM_HUGE_PAGES` environment variable to 1, or calling
+ * `omHugePagesSetEnabled(1)` before the first inference, backs the memory
+ * arenas and the weights files of at least 2MB with 2MB pages, from hugetlbfs
+ * when its pool has free pages and from the transparent huge pages otherwise.
+ * `omHugePagesGetStats` reports how much memory got huge pages:
+ *
+ * ```c
+ * int64_t hugetlbBytes, advisedBytes;
+ * omHugePagesGetStats(&hugetlbBytes, &advisedBytes);
+ * ```
+ *
+ * \subsection numa NUMA Placement
+ *
+ * On multi-socket hosts, the sockets not holding the weights of a model read
+ * them through the interconnect. A model compiled with `--storeWeightsInFile
+ * --numaWeights` and run with the `OM_NUMA` environment variable set to 1
+ * replicates its weights file on each NUMA node, when warmed up or on the
+ * first inference, and reads the replica of the node each inference runs on.
+ * The memory arenas are then allocated on the node of the thread using them,
+ * and `omNumaBindThreadPool` pins the worker threads to the CPUs of a node:
+ *
+ * ```c
+ * omNumaBindThreadPool(omNumaGetCurrentNode());
+ * ```
+ *
+ * \subsection reentrancy Concurrent Inferences
+ *
+ * One loaded model library can run inferences from several threads at a time.
+ * The constants of the model are read-only globals, and the memory pools are
+ * allocated by each inference, or kept in thread-local arenas. The runtime
+ * state shared by the inferences, i.e. the thread pool and the OMTensor free
+ * lists, is protected by locks, while the weights file must be mapped before
+ * the first inference starts. Models compiled with
+ * `--memPoolArena=shared` are the exception; `--reentrant` guarantees that the
+ * generated entry points are reentrant and turns such arenas thread-local.
+ *
+ * \subsection weights Weights files
+ *
+ * Models compiled with `--storeWeightsInFile` keep their large constants in a
+ * `<name>.weights` file next to `<name>.so`. Programs loading such a library
+ * by hand map the file at the address returned by its `omModelWeights`
+ * function before the first inference:
+ *
+ * ```c
+ * void **(*modelWeights)(void) = (void **(*)(void))dlsym(handle,
+ *     "omModelWeights");
+ * if (modelWeights && omWeightsLoad(modelWeights(), "model.weights") != 0)
+ *   ... // The weights file is missing.
+ * ```
+ *
+ * The pointer to the weights is internal to the library, so that several
+ * models can be loaded in the same process.
+ *
+ * `ExecutionSession` does this when it loads the library.
+ *
+ * \subsection warmup Warm-up
+ *
+ * The first inference after loading a model library takes the page faults on
+ * its constants and resolves the runtime symbols it calls. Model libraries
+ * export a `void omModelWarmup(void)` function, which prefaults the constants
+ * and the weights file and allocates the memory arenas of static size, to be
+ * called after loading the library with `RTLD_NOW` and mapping its weights:
+ *
+ * ```c
+ * void *handle = dlopen("model.so", RTLD_NOW);
+ * void (*warmup)(void) = (void (*)(void))dlsym(handle, "omModelWarmup");
+ * warmup();
+ * ```
+ *
+ * `ExecutionSession` does both when it is constructed with `warmup` set.
+ *
+ * \subsection memory Memory requirements
+ *
+ * Model libraries also export an `int64_t omModelMemoryRequirements(void)`
+ * function returning the number of bytes an inference allocates for its
+ * memory pools, arenas and other buffers of static size, outputs included,
+ * so that models can be placed on hosts without running them first. The
+ * constants and the buffers of dynamic size are not counted, and each thread
+ * running inferences of a model compiled with `--memPoolArena=thread` keeps
+ * its own arenas. `--memoryReport` prints the details at compile time,
+ * including the size expressions of the dynamic memory pools.
+ *
+ * \subsection instrumentation Profiling
+ *
+ * A model compiled with `--instrument` reports each ONNX operation it runs to
+ * the profiler of the runtime, which records its type, node name, duration
+ * and output size when the `OM_INSTRUMENT` environment variable is set to 1
+ * or `omInstrumentSetEnabled` is called. The profile is written as CSV or as
+ * a Chrome trace, to be opened with chrome://tracing or Perfetto:
+ *
+ * ```c
+ * omInstrumentSetEnabled(1);
+ * run_main_graph(inputs);
+ * omInstrumentDump("profile.json", OM_INSTRUMENT_CHROME_TRACE);
+ * ```
+ *
+ * On Linux, `OM_INSTRUMENT_COUNTERS=1` or `omInstrumentSetCounters` adds the
+ * cycles, instructions, cache misses and vector instructions counted by the
+ * processor for each operation, which tell the memory bound operations from
+ * the compute bound ones.
+ *
+ * A model compiled with `--traceMemoryPools` also reports each allocation of
+ * its memory pools, with its actual size. `omInstrumentGetMemoryPoolStats`
+ * sums them up, e.g. per inference to catch the input shapes that need much
+ * more memory than the others:
+ *
+ * ```c
+ * OMMemoryPoolStats stats;
+ * omInstrumentReset();
+ * run_main_graph(inputs);
+ * omInstrumentGetMemoryPoolStats(&stats);
+ * printf("%lld pools, peak %lld bytes\n", (long long)stats.numAllocations,
+ *     (long long)stats.peakBytes);
+ * ```
+ *
  * \subsection reference Reference
  *
  * For full reference to available C Runtime API, refer to
- * `include/onnx-mlir/Runtime/OMTensor.h` and
- * `include/onnx-mlir/Runtime/OMTensorList.h`.
+ * `include/onnx-mlir/Runtime/OMTensor.h`,
+ * `include/onnx-mlir/Runtime/OMTensorList.h`,
+ * `include/onnx-mlir/Runtime/OMThreadPool.h`,
+ * `include/onnx-mlir/Runtime/OMAlloc.h`,
+ * `include/onnx-mlir/Runtime/OMArena.h`,
+ * `include/onnx-mlir/Runtime/OMBatch.h`,
+ * `include/onnx-mlir/Runtime/OMHugePages.h`,
+ * `include/onnx-mlir/Runtime/OMInstrument.h`,
+ * `include/onnx-mlir/Runtime/OMMicroKernel.h`,
+ * `include/onnx-mlir/Runtime/OMNuma.h` and
+ * `include/onnx-mlir/Runtime/OMWeights.h`.
  *
  */
 
@@ -0,0 +1,77 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------------- OMAlloc.h - OMAlloc Declaration header ----------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the block allocator API functions used
+// by the runtime for the OMTensor and OMTensorList structs and the data
+// buffers of the OMTensors it allocates.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMALLOC_H
+#define ONNX_MLIR_OMALLOC_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+/* Alignment in bytes of the blocks, the size of a cache line. */
+#define OM_ALLOC_ALIGNMENT 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Enable or disable the pooling of the runtime blocks
+ *
+ * When pooling is enabled, the blocks released by `omFreeBlock` are kept in
+ * free lists, one per power-of-two size class, and reused by the subsequent
+ * calls to `omAllocBlock`, so that the OMTensor structs, the OMTensorList
+ * structs and the data buffers created on every inference do not go through
+ * the system allocator. Pooling is disabled by default. Disabling it does not
+ * release the blocks already pooled, see `omAllocRelease`.
+ *
+ * @param enable whether to pool the released blocks
+ */
+void omAllocSetPooling(int enable);
+
+/**
+ * \brief Allocate a runtime block
+ *
+ * The blocks are aligned to `OM_ALLOC_ALIGNMENT` bytes and must be released
+ * by `omFreeBlock` with the same size.
+ *
+ * @param size size in bytes of the block
+ * @return pointer to the block, NULL if it cannot be allocated.
+ */
+void *omAllocBlock(int64_t size);
+
+/**
+ * \brief Release a runtime block
+ *
+ * @param block pointer to a block returned by `omAllocBlock`, may be NULL
+ * @param size size in bytes given to `omAllocBlock` for the block
+ */
+void omFreeBlock(void *block, int64_t size);
+
+/**
+ * \brief Release the pooled blocks
+ *
+ * Free the blocks kept in the free lists. The blocks in use are not affected.
+ */
+void omAllocRelease(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMALLOC_H
@@ -0,0 +1,123 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------------- OMArena.h - OMArena Declaration header ----------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the memory arena API functions used to
+// keep the memory pools of compiled models across inferences.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMARENA_H
+#define ONNX_MLIR_OMARENA_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Get the buffer of a memory arena
+ *
+ * Return the buffer of the arena identified by `id`, allocating it on first
+ * use. The buffer is kept and returned again by the subsequent calls, so that
+ * the memory pools of a model are allocated once instead of on every
+ * inference. When a call requests a size larger than the largest size seen so
+ * far for this arena (its high-water mark), the buffer is reallocated and its
+ * content is not preserved. Shared arenas are used by all the threads of the
+ * process and must only be used by one inference at a time; thread-local
+ * arenas are private to the calling thread and released when it exits.
+ *
+ * This function is called by the code generated for models compiled with
+ * `--memPoolArena`.
+ *
+ * @param id identifier of the arena, offset by the base of its model
+ * @param size size in bytes of the buffer
+ * @param alignment alignment in bytes of the buffer, 0 for the default
+ * @param threadLocal whether the arena is private to the calling thread
+ * @return pointer to the buffer of the arena, NULL if it cannot be allocated.
+ */
+void *omArenaGet(int64_t id, int64_t size, int64_t alignment, int threadLocal);
+
+/**
+ * \brief Get the zero-initialized buffer of a memory arena
+ *
+ * Same as `omArenaGet`, but the buffer is filled with zeros whenever it is
+ * allocated, i.e. on first use, after `omArenaRelease` and when it grows. The
+ * content written by a call is otherwise kept for the next calls, e.g. the
+ * cache of the shapes computed by the models compiled with
+ * `--cacheShapePlans`, which is empty while it only holds zeros.
+ *
+ * @param id identifier of the arena, offset by the base of its model
+ * @param size size in bytes of the buffer
+ * @param alignment alignment in bytes of the buffer, 0 for the default
+ * @param threadLocal whether the arena is private to the calling thread
+ * @return pointer to the buffer of the arena, NULL if it cannot be allocated.
+ */
+void *omArenaGetZeroed(
+    int64_t id, int64_t size, int64_t alignment, int threadLocal);
+
+/**
+ * \brief Reserve the identifiers of the memory arenas of a model
+ *
+ * The identifiers of the arenas are only unique within a model, the models
+ * loaded in one process offset them by a base reserved on their first call,
+ * so that the models sharing this runtime do not share their arenas. The base
+ * is stored at `base`, which holds a negative value until it is reserved.
+ *
+ * This function is called by the code generated for models compiled with
+ * `--memPoolArena` or `--cacheShapePlans`.
+ *
+ * @param base base of the identifiers of the model, negative if not reserved
+ * @param numIds number of identifiers used by the model
+ * @return base of the identifiers of the model.
+ */
+int64_t omArenaReserveIds(int64_t *base, int64_t numIds);
+
+/**
+ * \brief Release the memory arenas
+ *
+ * Free the buffers of the shared arenas and of the thread-local arenas of the
+ * calling thread. The arenas are allocated again by the next inference.
+ *
+ * Must not be called while a model is running.
+ */
+void omArenaRelease(void);
+
+/**
+ * \brief Get the high-water mark of a memory arena
+ *
+ * Sessions can be pre-warmed by calling `omArenaGet` with the high-water marks
+ * recorded in a previous run, so that no inference reallocates its pools.
+ *
+ * @param id identifier of the arena, offset by the base of its model
+ * @param threadLocal whether to query the arena of the calling thread
+ * @return largest size in bytes requested for the arena, 0 if it has not been
+ * used.
+ */
+int64_t omArenaGetHighWaterMark(int64_t id, int threadLocal);
+
+/**
+ * \brief Get the total size of the memory arenas
+ *
+ * @param threadLocal whether to query the arenas of the calling thread
+ * @return sum of the high-water marks of the shared arenas, or of the
+ * thread-local arenas of the calling thread.
+ */
+int64_t omArenaGetTotalSize(int threadLocal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMARENA_H
@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===--------------- OMBatch.h - OMBatch Declaration header ---------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the API functions running the inferences
+// of batch-separable models in chunks of their batch.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMBATCH_H
+#define ONNX_MLIR_OMBATCH_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMTensorList.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Set the size of the batch chunks
+ *
+ * The models whose graph is proven batch-separable at compile time, i.e.
+ * whose rows of the first dimension of the inputs are computed independently
+ * into the rows of the first dimension of the outputs, run the inferences on
+ * larger batches chunk by chunk. The intermediate buffers, and the memory
+ * pools and arenas holding them, are then sized for a chunk, which caps the
+ * peak memory of an inference; the outputs are still allocated for the whole
+ * batch.
+ *
+ * The default is taken from the `OM_BATCH_CHUNK_SIZE` environment variable,
+ * and is 0 when it is not set.
+ *
+ * @param chunkSize number of rows of the batch per chunk, 0 to run the whole
+ *        batch at once
+ */
+void omBatchSetChunkSize(int64_t chunkSize);
+
+/**
+ * \brief Get the size of the batch chunks
+ *
+ * @return number of rows of the batch per chunk, 0 when the batch is not
+ *         split.
+ */
+int64_t omBatchGetChunkSize(void);
+
+/**
+ * \brief Run an inference in chunks of the batch
+ *
+ * Called by the entry points of the batch-separable models. When a chunk size
+ * is set and the inputs share a first dimension larger than it, `run` is
+ * called on views of each chunk of the inputs, and the outputs of the chunks
+ * are copied into outputs of the whole batch. Otherwise, `run` is called on
+ * the inputs as they are.
+ *
+ * @param run entry point running the whole inputs it is given, of type
+ *        `OMTensorList *(OMTensorList *)`
+ * @param inputs pointer to the OMTensorList of the inputs
+ * @return pointer to the OMTensorList of the outputs, NULL if the inference
+ *         failed.
+ */
+OMTensorList *omBatchRunInChunks(void *run, OMTensorList *inputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMBATCH_H
@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ OMHugePages.h - OMHugePages Declaration header ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the API functions backing the memory
+// arenas and the weights of compiled models with huge pages.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMHUGEPAGES_H
+#define ONNX_MLIR_OMHUGEPAGES_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Back the memory arenas and the weights with huge pages
+ *
+ * When enabled, the buffers of the memory arenas and the weights files mapped
+ * by `omWeightsLoad` of at least 2MB are backed by 2MB pages, which reduces
+ * the TLB misses of models with large weights or memory pools. The pages come
+ * from the hugetlbfs pool when it has free pages, see nr_hugepages in
+ * /proc/sys/vm, and are otherwise requested from the transparent huge pages
+ * with `MADV_HUGEPAGE`. The weights are then read into anonymous memory
+ * instead of being mapped from their file, so their pages are no longer shared
+ * between the processes running the same model.
+ *
+ * The default is taken from the `OM_HUGE_PAGES` environment variable, and is
+ * disabled when it is not set. Only the buffers allocated afterwards are
+ * affected, `omHugePagesGetStats` reports how many of them use huge pages.
+ *
+ * @param enable non-zero to back the buffers with huge pages
+ * @return 0 on success, -1 if huge pages are not supported on this platform.
+ */
+int omHugePagesSetEnabled(int enable);
+
+/**
+ * \brief Whether huge pages are enabled
+ *
+ * @return non-zero if the buffers are backed by huge pages.
+ */
+int omHugePagesGetEnabled(void);
+
+/**
+ * \brief Report the memory backed by huge pages
+ *
+ * The transparent huge pages may still be split or not be available, in which
+ * case the advised memory is backed by regular pages; see the AnonHugePages
+ * lines of /proc/self/smaps for the memory they actually back.
+ *
+ * @param hugetlbBytes set to the size of the buffers allocated from the
+ *        hugetlbfs pool, may be NULL
+ * @param advisedBytes set to the size of the buffers advised to use
+ *        transparent huge pages, may be NULL
+ */
+void omHugePagesGetStats(int64_t *hugetlbBytes, int64_t *advisedBytes);
+
+/**
+ * \brief Allocate a buffer backed by huge pages
+ *
+ * Used by the runtime for the memory arenas and the weights. The buffer is
+ * aligned on 2MB and readable and writable.
+ *
+ * @param size size of the buffer in bytes
+ * @param hugetlb set to whether the buffer comes from the hugetlbfs pool
+ * @return pointer to the buffer, NULL if huge pages are disabled, the size is
+ *         less than 2MB or no huge page mapping can be created.
+ */
+void *omHugePagesAlloc(int64_t size, int *hugetlb);
+
+/**
+ * \brief Release a buffer returned by `omHugePagesAlloc`
+ *
+ * @param buffer pointer to the buffer, may be NULL
+ * @param size size given to `omHugePagesAlloc` for the buffer
+ * @param hugetlb value set by `omHugePagesAlloc` for the buffer
+ */
+void omHugePagesFree(void *buffer, int64_t size, int hugetlb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMHUGEPAGES_H
@@ -0,0 +1,189 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ OMInstrument.h - OMInstrument Declaration header --------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the API functions profiling the ONNX
+// operations of the models compiled with `--instrument`.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMINSTRUMENT_H
+#define ONNX_MLIR_OMINSTRUMENT_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Formats of the profiles written by `omInstrumentDump`.
+ */
+typedef enum {
+  /* One line per operation: op,node,thread,start_ns,duration_ns,output_bytes
+   * followed by cycles,instructions,llc_misses,vector_instructions when the
+   * counters are read. */
+  OM_INSTRUMENT_CSV = 0,
+  /* Trace Event Format, loaded by chrome://tracing and Perfetto. */
+  OM_INSTRUMENT_CHROME_TRACE = 1,
+} OMInstrumentFormat;
+
+/**
+ * Statistics of the memory pools allocated by the models compiled with
+ * `--traceMemoryPools`, see `omInstrumentGetMemoryPoolStats`.
+ */
+typedef struct {
+  /* Number of memory pools allocated, including the arena buffers. */
+  int64_t numAllocations;
+  /* Sum of the sizes of the allocated pools, in bytes. */
+  int64_t totalBytes;
+  /* Sum of the sizes of the allocated dynamic pools, in bytes. */
+  int64_t dynamicBytes;
+  /* Size of the largest pool, in bytes. */
+  int64_t maxBytes;
+  /* Largest sum of the sizes of the pools allocated at the same time. */
+  int64_t peakBytes;
+  /* Time spent allocating and freeing the pools, in nanoseconds. */
+  int64_t durationNs;
+} OMMemoryPoolStats;
+
+/**
+ * \brief Enable the profiling of the ONNX operations
+ *
+ * When enabled, the models compiled with `--instrument` record, for each ONNX
+ * operation they run, its type, its node name, the calling thread, its start
+ * time and duration in nanoseconds and the size in bytes of its outputs. The
+ * outputs of dynamic shapes are counted with their actual sizes.
+ *
+ * The default is taken from the `OM_INSTRUMENT` environment variable, and is
+ * disabled when it is not set. Each model library embeds its own runtime, so
+ * the profiling functions of the library whose operations are profiled must
+ * be called, e.g. looked up with `dlsym` in that library.
+ *
+ * @param enable non-zero to record the operations
+ */
+void omInstrumentSetEnabled(int enable);
+
+/**
+ * \brief Whether the profiling of the ONNX operations is enabled
+ *
+ * @return non-zero if the operations are recorded.
+ */
+int omInstrumentGetEnabled(void);
+
+/**
+ * \brief Enable the hardware performance counters of the profiling
+ *
+ * When enabled, the profiling also records, for each ONNX operation, the
+ * cycles, instructions and last level cache misses counted by the processor
+ * while the calling thread runs it, in user mode. Vector instructions have no
+ * portable event; they are counted by the raw event given to
+ * `omInstrumentSetVectorEvent`, or by the `OM_INSTRUMENT_VECTOR_EVENT`
+ * environment variable, e.g. `0x20c7` for the 256-bit single precision
+ * instructions of Intel Skylake. The counts of the nested operations are
+ * included in the ones of their parents, like their durations.
+ *
+ * The default is taken from the `OM_INSTRUMENT_COUNTERS` environment
+ * variable, and is disabled when it is not set. The counters are only
+ * available on Linux, through `perf_event_open`. The counters that the
+ * processor, or `/proc/sys/kernel/perf_event_paranoid`, does not allow are
+ * left out of the profile.
+ *
+ * @param enable non-zero to read the counters
+ * @return 0 on success, -1 if the counters are not supported on this
+ * platform.
+ */
+int omInstrumentSetCounters(int enable);
+
+/**
+ * \brief Whether the hardware performance counters are read
+ *
+ * @return non-zero if the counters are read.
+ */
+int omInstrumentGetCounters(void);
+
+/**
+ * \brief Set the raw event counting the vector instructions
+ *
+ * The event is specific to the processor, see `perf list`. It must be set
+ * before the threads running the model record their first operation.
+ *
+ * @param rawEvent configuration of the PERF_TYPE_RAW event, 0 for none
+ */
+void omInstrumentSetVectorEvent(uint64_t rawEvent);
+
+/**
+ * \brief Discard the recorded operations
+ *
+ * Must not be called while a model is running.
+ */
+void omInstrumentReset(void);
+
+/**
+ * \brief Get the number of recorded operations
+ *
+ * @return number of operations recorded since the last reset.
+ */
+int64_t omInstrumentGetNumRecords(void);
+
+/**
+ * \brief Get the statistics of the memory pools
+ *
+ * The models compiled with `--traceMemoryPools` record each allocation of
+ * their memory pools as a `MemoryPool` operation, and each deallocation as a
+ * `MemoryPoolFree` one, whose node names are the kind of the pools: `static`,
+ * `dynamic`, `static arena` or `dynamic arena`. The sizes of the dynamic
+ * pools are the ones of each call, so that the shapes requiring more memory
+ * stand out. The statistics summarize the records since the last reset,
+ * e.g. of a single inference when the profiling is reset before it. The
+ * arena buffers are only allocated by the first calls needing them, and are
+ * never freed.
+ *
+ * @param stats statistics of the recorded pools
+ */
+void omInstrumentGetMemoryPoolStats(OMMemoryPoolStats *stats);
+
+/**
+ * \brief Write the recorded operations
+ *
+ * The start times are relative to the first recorded operation. The names of
+ * the operations belong to the model library, so the profile must be written
+ * before it is unloaded.
+ *
+ * @param path file to write, or NULL for the standard output
+ * @param format format of the profile
+ * @return 0 on success, -1 if the file cannot be written.
+ */
+int omInstrumentDump(const char *path, OMInstrumentFormat format);
+
+/**
+ * \brief Instrumentation point of an ONNX operation
+ *
+ * Called by the models compiled with `--instrument` before (tag 0) and after
+ * (tag 1) the code of each ONNX operation, the latter with the size of its
+ * outputs. The operations run by each thread are expected to be properly
+ * nested.
+ *
+ * @param opName type of the operation, e.g. "Conv"
+ * @param nodeName name of the node in the ONNX graph, may be empty
+ * @param tag 0 at the start of the operation, 1 at its end
+ * @param outputBytes size in bytes of the outputs, at the end of the operation
+ */
+void omInstrumentPoint(
+    const char *opName, const char *nodeName, int64_t tag, int64_t outputBytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMINSTRUMENT_H
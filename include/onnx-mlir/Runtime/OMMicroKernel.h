@@ -0,0 +1,64 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------- OMMicroKernel.h - OMMicroKernel Declaration header ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the matrix multiply microkernels called
+// by compiled models for the register tiles of their matrix multiplies.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMMICROKERNEL_H
+#define ONNX_MLIR_OMMICROKERNEL_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Largest number of rows of the tuned f32 microkernels
+ *
+ * The tuned kernels compute up to this many rows of 8 or 16 columns, the
+ * other tiles use a generic loop nest.
+ */
+#define OM_MICRO_KERNEL_MAX_ROWS 8
+
+/**
+ * \brief Multiply and accumulate a register tile of f32 matrices
+ *
+ * Compute C += A * B for an I x K tile of A, a K x J tile of B and an I x J
+ * tile of C. The rows of the tiles are contiguous, and start `lda`, `ldb` and
+ * `ldc` elements apart. The tiles of 8 or 16 columns and up to
+ * `OM_MICRO_KERNEL_MAX_ROWS` rows keep the tile of C in vector registers
+ * while streaming A and B, the other tiles use a generic loop nest.
+ * It is called by the models compiled with `--enableMatmulMicroKernels`.
+ *
+ * @param I number of rows of A and C
+ * @param J number of columns of B and C
+ * @param K number of columns of A and rows of B
+ * @param A pointer to the first element of the tile of A
+ * @param lda distance in elements between the rows of A
+ * @param B pointer to the first element of the tile of B
+ * @param ldb distance in elements between the rows of B
+ * @param C pointer to the first element of the tile of C
+ * @param ldc distance in elements between the rows of C
+ */
+void omMatmulMicroKernelF32(int64_t I, int64_t J, int64_t K, const float *A,
+    int64_t lda, const float *B, int64_t ldb, float *C, int64_t ldc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMMICROKERNEL_H
@@ -0,0 +1,148 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------------- OMNuma.h - OMNuma Declaration header ---------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the API functions placing the weights,
+// the memory arenas and the worker threads of compiled models on the NUMA
+// nodes of multi-socket hosts.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMNUMA_H
+#define ONNX_MLIR_OMNUMA_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Enable the NUMA placement of the model data
+ *
+ * When enabled, on hosts with more than one NUMA node, the weights files of
+ * the models compiled with `--numaWeights` are replicated on each node, and
+ * the models read their weights from the replica of the node the inference
+ * runs on. This avoids the remote memory accesses of the sockets not holding
+ * the weights, at the cost of one copy of the weights per node. The buffers
+ * of the memory arenas are also preferably allocated on the node of the
+ * thread that first requests them.
+ *
+ * The default is taken from the `OM_NUMA` environment variable, and is
+ * disabled when it is not set. Only the weights replicated and the buffers
+ * allocated afterwards are affected. Each model library embeds its own
+ * runtime, so the setting applies to the library whose function is called.
+ *
+ * @param enable non-zero to enable the NUMA placement
+ * @return 0 on success, -1 if NUMA is not supported on this platform.
+ */
+int omNumaSetEnabled(int enable);
+
+/**
+ * \brief Whether the NUMA placement is enabled
+ *
+ * @return non-zero if the NUMA placement is enabled.
+ */
+int omNumaGetEnabled(void);
+
+/**
+ * \brief Get the number of NUMA nodes
+ *
+ * @return number of online NUMA nodes of the host, 1 if NUMA is not
+ * supported on this platform.
+ */
+int omNumaGetNumNodes(void);
+
+/**
+ * \brief Get the NUMA node of the calling thread
+ *
+ * @return node of the CPU the calling thread runs on, 0 if it is unknown.
+ */
+int omNumaGetCurrentNode(void);
+
+/**
+ * \brief Get the CPUs of a NUMA node
+ *
+ * @param node NUMA node, from 0 to `omNumaGetNumNodes() - 1`
+ * @param cpus array receiving the CPU ids of the node, may be NULL
+ * @param maxCpus number of elements of the cpus array
+ * @return number of CPUs of the node, which may be larger than maxCpus, or -1
+ * if the node does not exist.
+ */
+int omNumaGetNodeCpus(int node, int *cpus, int maxCpus);
+
+/**
+ * \brief Bind the thread pool to a NUMA node
+ *
+ * Pin the worker threads of the thread pool to the CPUs of the node, see
+ * `omThreadPoolSetAffinity`, so that the parallel loops of an inference run
+ * next to the weights replica and the arenas of that node. Pinning the
+ * calling thread is left to the caller. Typically called when a session is
+ * created, with the node of the thread running its inferences.
+ *
+ * Must not be called while a model is running.
+ *
+ * @param node NUMA node, or -1 for the node of the calling thread
+ * @return 0 on success, -1 if the node does not exist or thread affinity is
+ * not supported on this platform.
+ */
+int omNumaBindThreadPool(int node);
+
+/**
+ * \brief Replicate read-only data on each NUMA node
+ *
+ * Called by the `omModelWarmup` function of the models compiled with
+ * `--numaWeights` on their weights, so that they are replicated when the
+ * session is created rather than by the first inference. Does nothing unless
+ * the NUMA placement is enabled on a host with more than one node, or when
+ * the data is already replicated. The replicas are never released, like the
+ * mappings of the weights files.
+ *
+ * @param data pointer to the data
+ * @param size size of the data in bytes
+ * @return 0 on success, -1 if the replicas cannot be allocated.
+ */
+int omNumaReplicate(const void *data, int64_t size);
+
+/**
+ * \brief Get the replica of read-only data on the local NUMA node
+ *
+ * Called by the models compiled with `--numaWeights` on the `_weights`
+ * pointer each time they read a constant of the weights file. Replicates the
+ * data on the first call, like `omNumaReplicate`.
+ *
+ * @param data pointer to the data
+ * @param size size of the data in bytes
+ * @return replica of the data on the node of the calling thread, or data
+ * itself when it is not replicated.
+ */
+const void *omNumaGetLocalReplica(const void *data, int64_t size);
+
+/**
+ * \brief Prefer the local NUMA node for the pages of a buffer
+ *
+ * Used by the runtime for the buffers of the memory arenas. The pages of the
+ * buffer not yet touched are preferably allocated on the node of the calling
+ * thread. Does nothing unless the NUMA placement is enabled on a host with
+ * more than one node.
+ *
+ * @param buffer pointer to the buffer
+ * @param size size of the buffer in bytes
+ */
+void omNumaPreferLocal(void *buffer, int64_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMNUMA_H
@@ -15,7 +15,11 @@
 #ifdef __cplusplus
 #pragma once
 
+#include <cstdint>
+
 extern "C" {
+#else
+#include <stdint.h>
 #endif
 
 /**
@@ -32,6 +36,27 @@ const char *omInputSignature();
  */
 const char *omOutputSignature();
 
+/**
+ * \brief Return the model's input signature as a binary table.
+ *
+ * The table holds the number of inputs followed, for each input, by its
+ * ONNX data type, its rank and its dimensions, -1 for the dynamic ones. The
+ * entry point returns NULL without running the model when its inputs do not
+ * match the table.
+ *
+ * @return pointer to the input signature table
+ */
+const int64_t *omInputSignatureTable();
+
+/**
+ * \brief Return the model's output signature as a binary table.
+ *
+ * The table has the layout of the input signature table.
+ *
+ * @return pointer to the output signature table
+ */
+const int64_t *omOutputSignatureTable();
+
 #ifdef __cplusplus
 }
 #endif
@@ -111,7 +111,8 @@ OMTensor *omTensorCreateWithOwnership(void *data_ptr, int64_t *shape,
  * MemRefs to OMTensors for user convenience.
  *
  * The OMTensor created using this constructor owns the underlying memory
- * space allocated to the content of the tensor.
+ * space allocated to the content of the tensor. The data buffer is a block
+ * of `omAllocBlock`, reused across tensors when pooling is enabled.
  *
  * @param shape list of integers indicating the tensor shape.
  * @param rank tensor rank.
@@ -121,6 +122,46 @@ OMTensor *omTensorCreateWithOwnership(void *data_ptr, int64_t *shape,
  */
 OMTensor *omTensorCreateEmpty(int64_t *shape, int64_t rank, OM_DATA_TYPE dtype);
 
+/**
+ * Create an OMTensor with the specified shape, rank and element type,
+ * allocate uninitialized data aligned to the specified number of bytes.
+ *
+ * Like `omTensorCreateEmpty`, the OMTensor owns its data. Models compiled
+ * with `--specializeInputAlignment` run a version assuming aligned inputs
+ * when all their inputs are aligned to the given alignment.
+ *
+ * @param shape list of integers indicating the tensor shape.
+ * @param rank tensor rank.
+ * @param dtype tensor element data type.
+ * @param alignment alignment in bytes of the data, a power of two.
+ * @return pointer to OMTensor created, NULL if creation failed.
+ *
+ */
+OMTensor *omTensorCreateEmptyAligned(
+    int64_t *shape, int64_t rank, OM_DATA_TYPE dtype, int64_t alignment);
+
+/**
+ * Create an OMTensor with the specified shape, rank and element type,
+ * allocate uninitialized data for a bigger size along one axis.
+ *
+ * Like `omTensorCreateEmpty`, the OMTensor owns its data. Its strides are
+ * those of the tensor of the capacity along the axis, e.g. a key/value cache
+ * of a decoder holding the past tokens along its sequence axis. Models
+ * appending to an input along such an axis, by a Concat returned by the
+ * model, write in place in the capacity of the input and return a view of
+ * the input buffer, which must then outlive the output.
+ *
+ * @param shape list of integers indicating the tensor shape.
+ * @param rank tensor rank.
+ * @param dtype tensor element data type.
+ * @param axis axis along which the data has a capacity.
+ * @param capacity size of the data along the axis, at least shape[axis].
+ * @return pointer to OMTensor created, NULL if creation failed.
+ *
+ */
+OMTensor *omTensorCreateWithCapacity(int64_t *shape, int64_t rank,
+    OM_DATA_TYPE dtype, int64_t axis, int64_t capacity);
+
 /**
  * \brief Destroy the OMTensor struct.
  *
@@ -271,6 +312,39 @@ int omTensorGetRank(OMTensor *tensor);
  */
 int64_t omTensorGetNumElems(OMTensor *tensor);
 
+/**
+ * \brief Check whether the OMTensor data is contiguous
+ *
+ * The data is contiguous when the strides are those of a row-major array of
+ * the shape of the OMTensor, but for the dimensions of size 1.
+ *
+ * @param tensor, pointer to the OMTensor
+ * @return 1 if the data is contiguous, 0 otherwise.
+ */
+int omTensorIsContiguous(OMTensor *tensor);
+
+/**
+ * \brief Get a contiguous OMTensor of the data of an OMTensor
+ *
+ * Compiled models call it on their strided inputs, e.g. the OMTensors of
+ * sliced numpy arrays, so that the callers need not copy them. The strides
+ * are counted in elements and may be negative.
+ *
+ * @param tensor, pointer to the OMTensor
+ * @return the OMTensor itself if its data is contiguous, otherwise a new
+ *         OMTensor owning a contiguous copy of the data, to be released by
+ *         omTensorReleaseContiguous. NULL if the copy failed.
+ */
+OMTensor *omTensorGetContiguous(OMTensor *tensor);
+
+/**
+ * \brief Release an OMTensor returned by omTensorGetContiguous
+ *
+ * @param contiguous, pointer to the OMTensor returned by omTensorGetContiguous
+ * @param tensor, pointer to the OMTensor given to omTensorGetContiguous
+ */
+void omTensorReleaseContiguous(OMTensor *contiguous, OMTensor *tensor);
+
 /**
  * \brief OMTensor owning flag getter
  *
@@ -278,6 +352,15 @@ int64_t omTensorGetNumElems(OMTensor *tensor);
  */
 int omTensorGetOwning(OMTensor *tensor);
 
+/**
+ * \brief OMTensor owning flag setter
+ *
+ * @param tensor pointer to the OMTensor
+ * @param owning whether the data buffer is freed when the OMTensor is
+ *        destroyed.
+ */
+void omTensorSetOwning(OMTensor *tensor, int owning);
+
 #ifdef __cplusplus
 }
 #endif
@@ -82,6 +82,20 @@ int omTensorListGetSize(OMTensorList *list);
  */
 OMTensor *omTensorListGetOmtByIndex(OMTensorList *list, size_t index);
 
+/**
+ * \brief Check an OMTensorList against a signature table
+ *
+ * The table, as returned by omInputSignatureTable, holds the number of
+ * OMTensors followed, for each one, by its data type, its rank and its
+ * dimensions, -1 for the dynamic ones. The signed and unsigned integers of
+ * the same width match.
+ *
+ * @param list pointer to the OMTensorList
+ * @param table pointer to the signature table
+ * @return 0 if the OMTensors match the table, -1 otherwise.
+ */
+int omTensorListCheckSignature(OMTensorList *list, const int64_t *table);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,109 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===--------- OMThreadPool.h - OMThreadPool Declaration header -----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the thread pool API functions used to
+// execute the parallel loops of compiled models.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMTHREADPOOL_H
+#define ONNX_MLIR_OMTHREADPOOL_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Body of a parallel loop
+ *
+ * Execute the iterations `lb`, `lb + step`, ... that are smaller than `ub`.
+ *
+ * @param lb first iteration of the chunk
+ * @param ub upper bound (exclusive) of the chunk
+ * @param step loop step
+ * @param args pointer to the values captured by the loop body
+ */
+typedef void (*OMParallelForBody)(
+    int64_t lb, int64_t ub, int64_t step, void *args);
+
+/**
+ * \brief Set the number of threads of the thread pool
+ *
+ * Set the number of threads (including the calling thread) used to execute
+ * parallel loops. The worker threads are created once, on the first parallel
+ * loop, and are reused by all subsequent calls to the model entry points. A
+ * value of 1 disables parallel execution. A value smaller than 1 restores the
+ * default, which is the OM_NUM_THREADS environment variable if set, or the
+ * number of CPUs available to the process otherwise.
+ *
+ * Must not be called while a model is running.
+ *
+ * @param numThreads number of threads
+ */
+void omThreadPoolSetNumThreads(int numThreads);
+
+/**
+ * \brief Get the number of threads of the thread pool
+ *
+ * @return number of threads (including the calling thread) used to execute
+ * parallel loops.
+ */
+int omThreadPoolGetNumThreads(void);
+
+/**
+ * \brief Set the CPU affinity of the thread pool
+ *
+ * Pin the worker threads to the given list of CPUs, worker `i` being pinned
+ * to `cpus[i % numCpus]`. Pinning the calling thread is left to the caller.
+ * Passing a NULL list (or zero CPUs) removes the pinning of the worker
+ * threads that are created afterward. When no thread count was explicitly
+ * set, the pool uses one thread per listed CPU.
+ *
+ * Must not be called while a model is running.
+ *
+ * @param cpus array of CPU ids
+ * @param numCpus number of elements in the cpus array
+ * @return 0 on success, -1 if thread affinity is not supported on this
+ * platform or if some of the CPU ids are invalid.
+ */
+int omThreadPoolSetAffinity(const int *cpus, int numCpus);
+
+/**
+ * \brief Execute a parallel loop on the thread pool
+ *
+ * Split the iteration space of `for (i = lb; i < ub; i += step)` in chunks
+ * and execute them by calling `body` from the threads of the pool, the
+ * calling thread included. Idle threads steal the remaining chunks of busy
+ * threads. Returns once all the iterations are executed. Nested parallel
+ * loops, and loops started while the pool is busy with another caller, are
+ * executed sequentially by the calling thread.
+ *
+ * This function is called by the code generated for parallel loops.
+ *
+ * @param lb lower bound of the loop
+ * @param ub upper bound (exclusive) of the loop
+ * @param step loop step, must be positive
+ * @param body function executing a chunk of iterations
+ * @param args pointer passed to each call of body
+ */
+void omThreadPoolParallelFor(int64_t lb, int64_t ub, int64_t step,
+    OMParallelForBody body, void *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMTHREADPOOL_H
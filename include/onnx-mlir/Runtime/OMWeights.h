@@ -0,0 +1,67 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ OMWeights.h - OMWeights Declaration header --------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of the API functions mapping the weights
+// files of compiled models.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ONNX_MLIR_OMWEIGHTS_H
+#define ONNX_MLIR_OMWEIGHTS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Map the weights file of a model
+ *
+ * Models compiled with `--storeWeightsInFile` read their large constants from
+ * a `<name>.weights` file written next to `<name>.so`, instead of from the
+ * library. Such libraries hold an internal pointer, whose address is returned
+ * by their `void **omModelWeights(void)` function, which must be set to the
+ * mapped file before the first inference. The file is mapped read-only
+ * and stays mapped for the lifetime of the process, like the library, so that
+ * its pages are shared by all the processes running the same model.
+ *
+ * The weights files compressed by `--optimizeForSize` are instead read and
+ * decompressed into read-only anonymous memory, which is smaller on disk but
+ * no longer shared between the processes.
+ *
+ * Does nothing when `*weights` is already set, e.g. by another session of
+ * the same library.
+ *
+ * @param weights address returned by `omModelWeights` of the model library
+ * @param path path of the weights file of the model
+ * @return 0 on success, -1 if the file cannot be mapped.
+ */
+int omWeightsLoad(void **weights, const char *path);
+
+/**
+ * \brief Prefault read-only model data
+ *
+ * The constants of a model, whether in the library or in its weights file,
+ * are mapped lazily, so the first inference takes a page fault on each page
+ * of them it reads. This function advises the kernel to read the pages ahead
+ * and touches each of them, so that these faults are taken up front. Models
+ * call it from their `omModelWarmup` function.
+ *
+ * @param data pointer to the data, may be NULL
+ * @param size size of the data in bytes
+ */
+void omWeightsPrefault(const void *data, int64_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONNX_MLIR_OMWEIGHTS_H
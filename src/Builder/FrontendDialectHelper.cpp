@@ -11,8 +11,13 @@
 // Helper methods for handling input ONNX models.
 //
 //===----------------------------------------------------------------------===//
+#include <llvm/ADT/SmallString.h>
 #include <llvm/Support/Endian.h>
-#include <llvm/Support/SwapByteOrder.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Parallel.h>
+#include <llvm/Support/Path.h>
 
 #include "src/Builder/FrontendDialectHelper.hpp"
 
@@ -20,123 +25,320 @@ namespace onnx_mlir {
 
 template <typename T>
 struct TransformValueToONNXData {
-  static const google::protobuf::RepeatedField<T> data(
-      onnx::TensorProto initializer) {
-    return google::protobuf::RepeatedField<T>();
+  static const google::protobuf::RepeatedField<T> &data(
+      const onnx::TensorProto &initializer) {
+    static const google::protobuf::RepeatedField<T> empty;
+    return empty;
   }
 };
 
 template <>
 struct TransformValueToONNXData<double> {
-  static const google::protobuf::RepeatedField<double> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<double> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.double_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<float> {
-  static const google::protobuf::RepeatedField<float> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<float> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.float_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<int32_t> {
-  static const google::protobuf::RepeatedField<int32_t> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<int32_t> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.int32_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<int64_t> {
-  static const google::protobuf::RepeatedField<int64_t> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<int64_t> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.int64_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<uint8_t> {
-  static const google::protobuf::RepeatedField<int32_t> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<int32_t> &data(
+      const onnx::TensorProto &initializer) {
+    return initializer.int32_data();
+  }
+};
+
+// The bits of float16 and bfloat16 values are stored in int32_data.
+template <>
+struct TransformValueToONNXData<uint16_t> {
+  static const google::protobuf::RepeatedField<int32_t> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.int32_data();
   }
 };
 
 template <>
 struct TransformValueToONNXData<int8_t> {
-  static const google::protobuf::RepeatedField<int32_t> data(
-      onnx::TensorProto initializer) {
+  static const google::protobuf::RepeatedField<int32_t> &data(
+      const onnx::TensorProto &initializer) {
     return initializer.int32_data();
   }
 };
 
-// Helper method for constructing an array attribute from a model input.
+// Helper method for constructing an array from the typed data fields of a
+// model input. Values narrower than 32 bits are stored widened in int32_data.
 template <typename T>
-static std::vector<T> CreateArrayAttribute(onnx::TensorProto initializer) {
-  size_t size;
-  if (initializer.raw_data().size()) {
-    // copy & take care of endianness
-    std::vector<char> byteInitializer;
-    std::copy(initializer.raw_data().begin(), initializer.raw_data().end(),
-        back_inserter(byteInitializer));
-    size = initializer.raw_data().size() / sizeof(T);
-    T *arrayPtr = reinterpret_cast<T *>(&byteInitializer[0]);
-    auto array = std::vector<T>(arrayPtr, arrayPtr + size);
-    // Perform byte swap if system endianness is BE.
-    // ONNX tensor content raw data is always in LE.
-    if (llvm::support::endian::system_endianness() !=
-        llvm::support::endianness::little)
-      for (int i = 0; i < array.size(); i++)
-        llvm::sys::swapByteOrder<T>(array[i]);
-
-    return array;
-  }
-
-  // copy, no need to take care of endianness
-  auto data = TransformValueToONNXData<T>::data(initializer);
-  size = data.size();
-  return std::vector<T>(&data[0], &data[0] + size);
+static std::vector<T> CreateArrayAttribute(
+    const onnx::TensorProto &initializer) {
+  const auto &data = TransformValueToONNXData<T>::data(initializer);
+  return std::vector<T>(data.begin(), data.end());
+}
+
+// Get the path, offset and length in bytes of the external data of a
+// tensor. The location is relative to the directory of the model file, and
+// the data extends to the end of the file when no length is given.
+static void getExternalDataSlice(const onnx::TensorProto &initializer,
+    const std::string &externalDataDir, llvm::SmallVectorImpl<char> &path,
+    uint64_t &offset, uint64_t &length) {
+  std::string location;
+  int64_t externalLength = -1;
+  offset = 0;
+  for (const auto &entry : initializer.external_data()) {
+    if (entry.key() == "location")
+      location = entry.value();
+    else if (entry.key() == "offset")
+      offset = std::stoull(entry.value());
+    else if (entry.key() == "length")
+      externalLength = std::stoll(entry.value());
+  }
+  assert(!location.empty() && "External data without a location");
+  path.assign(externalDataDir.begin(), externalDataDir.end());
+  llvm::sys::path::append(path, location);
+  if (externalLength >= 0) {
+    length = externalLength;
+    return;
+  }
+  uint64_t fileSize;
+  if (std::error_code ec = llvm::sys::fs::file_size(path, fileSize))
+    llvm::report_fatal_error("Failed to open external data file " +
+                             llvm::StringRef(path.data(), path.size()) +
+                             ": " + ec.message());
+  assert(offset <= fileSize && "External data offset out of the file");
+  length = fileSize - offset;
+}
+
+// Get the bytes of a tensor stored as raw data, either in raw_data or in a
+// slice of an external data file. External data is memory mapped, and the
+// mapping is kept alive by externalData. Return false if the values of the
+// tensor are stored in its typed data fields instead.
+static bool getTensorRawData(const onnx::TensorProto &initializer,
+    const std::string &externalDataDir,
+    std::unique_ptr<llvm::MemoryBuffer> &externalData,
+    llvm::ArrayRef<char> &rawData) {
+  if (initializer.data_location() != onnx::TensorProto::EXTERNAL) {
+    if (initializer.raw_data().empty())
+      return false;
+    rawData = llvm::makeArrayRef(
+        initializer.raw_data().data(), initializer.raw_data().size());
+    return true;
+  }
+
+  llvm::SmallString<256> path;
+  uint64_t offset, length;
+  getExternalDataSlice(initializer, externalDataDir, path, offset, length);
+  auto buffer = llvm::MemoryBuffer::getFileSlice(path, length, offset);
+  if (std::error_code ec = buffer.getError())
+    llvm::report_fatal_error("Failed to map external data file " +
+                             path.str() + ": " + ec.message());
+  externalData = std::move(*buffer);
+  rawData = llvm::makeArrayRef(
+      externalData->getBufferStart(), externalData->getBufferSize());
+  return true;
+}
+
+// Create an attribute directly from raw data, which is always little-endian
+// in ONNX. The raw data is only copied, to be byte swapped, on big-endian
+// hosts.
+static mlir::DenseElementsAttr createDenseElmAttrFromRawData(
+    mlir::RankedTensorType tensorType, llvm::ArrayRef<char> rawData) {
+  std::vector<char> swappedData;
+  if (llvm::support::endian::system_endianness() !=
+      llvm::support::endianness::little) {
+    size_t elementBytes = tensorType.getElementTypeBitWidth() / 8;
+    swappedData.assign(rawData.begin(), rawData.end());
+    for (size_t i = 0; i + elementBytes <= swappedData.size();
+         i += elementBytes)
+      std::reverse(swappedData.begin() + i,
+          swappedData.begin() + i + elementBytes);
+    rawData = llvm::makeArrayRef(swappedData);
+  }
+  bool detectedSplat = false;
+  if (!mlir::DenseElementsAttr::isValidRawBuffer(
+          tensorType, rawData, detectedSplat))
+    llvm_unreachable("Raw data of ONNX TensorProto does not match its type.");
+  return mlir::DenseElementsAttr::getFromRawBuffer(
+      tensorType, rawData, detectedSplat);
+}
+
+// Get the element type of the initializers that can be imported.
+static mlir::Type getInitializerElementType(
+    mlir::OpBuilder &builder, const onnx::TensorProto &initializer) {
+  switch (initializer.data_type()) {
+  case (onnx::TensorProto::FLOAT):
+    return builder.getF32Type();
+  case (onnx::TensorProto::FLOAT16):
+    return builder.getF16Type();
+  case (onnx::TensorProto::BFLOAT16):
+    return builder.getBF16Type();
+  case (onnx::TensorProto::DOUBLE):
+    return builder.getF64Type();
+  case (onnx::TensorProto::INT8):
+    return builder.getIntegerType(8);
+  case (onnx::TensorProto::UINT8):
+    return builder.getIntegerType(8, false);
+  case (onnx::TensorProto::INT32):
+    return builder.getIntegerType(32);
+  case (onnx::TensorProto::INT64):
+    return builder.getIntegerType(64);
+  default:
+    llvm_unreachable(
+        "Failed to import ONNX TensorProto due to unsupported data types.");
+  }
+}
+
+// Get the type, path and offset of an initializer of at least minBytes bytes
+// whose external data is referenced by its constant rather than imported, and
+// only read when the constant is emitted. The references are only used on
+// little-endian hosts, where the data does not need to be byte swapped.
+// Return false if the data of the initializer is imported.
+static bool getLazyExternalData(mlir::OpBuilder &builder,
+    const onnx::TensorProto &initializer, const std::string &externalDataDir,
+    int64_t minBytes, mlir::RankedTensorType &tensorType,
+    llvm::SmallVectorImpl<char> &path, uint64_t &offset) {
+  if (minBytes < 0 ||
+      initializer.data_location() != onnx::TensorProto::EXTERNAL ||
+      llvm::support::endian::system_endianness() !=
+          llvm::support::endianness::little)
+    return false;
+  uint64_t length;
+  getExternalDataSlice(initializer, externalDataDir, path, offset, length);
+  llvm::ArrayRef<int64_t> tensorDims(
+      initializer.dims().data(), initializer.dims().size());
+  tensorType = mlir::RankedTensorType::get(
+      tensorDims, getInitializerElementType(builder, initializer));
+  uint64_t sizeInBytes =
+      tensorType.getNumElements() * tensorType.getElementTypeBitWidth() / 8;
+  if (length < (uint64_t)minBytes || length != sizeInBytes)
+    return false;
+  llvm::sys::fs::make_absolute(path);
+  return true;
+}
+
+void InitializedTensorMapping::DecodeInitializers(mlir::OpBuilder &builder,
+    const onnx::GraphProto &graph, const llvm::StringSet<> &usedNames) {
+  std::vector<const onnx::TensorProto *> initializers;
+  for (const auto &initializer : graph.initializer()) {
+    if (!usedNames.count(initializer.name()))
+      continue;
+    mlir::RankedTensorType tensorType;
+    llvm::SmallString<256> path;
+    uint64_t offset;
+    if (!getLazyExternalData(builder, initializer, externalDataDir,
+            lazyExternalDataMinBytes, tensorType, path, offset))
+      initializers.emplace_back(&initializer);
+  }
+
+  // The initializers are independent of each other, and the attributes are
+  // uniqued by the context in a thread-safe way when it is multithreaded.
+  std::vector<mlir::DenseElementsAttr> attrs(initializers.size());
+  auto decode = [&](size_t i) {
+    attrs[i] = onnxTensorProtoToDenseElmAttr(
+        builder, *initializers[i], externalDataDir);
+  };
+  if (builder.getContext()->isMultithreadingEnabled())
+    llvm::parallelForEachN(0, initializers.size(), decode);
+  else
+    for (size_t i = 0; i < initializers.size(); ++i)
+      decode(i);
+  for (size_t i = 0; i < initializers.size(); ++i)
+    decodedTensors[initializers[i]] = attrs[i];
 }
 
 mlir::Value InitializedTensorMapping::EmitInitializerForInputTensor(
     mlir::Location loc, mlir::OpBuilder &builder, const std::string &name) {
   // Initializer for input.
-  onnx::TensorProto initializer = GetInitializedTensor(name);
+  const onnx::TensorProto &initializer = GetInitializedTensor(name);
+
+  mlir::RankedTensorType tensorType;
+  llvm::SmallString<256> path;
+  uint64_t offset;
+  if (getLazyExternalData(builder, initializer, externalDataDir,
+          lazyExternalDataMinBytes, tensorType, path, offset)) {
+    auto constantOp = builder.create<mlir::ONNXConstantOp>(loc, tensorType,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+    constantOp->setAttr(
+        EXTERNAL_DATA_LOCATION_ATTR, builder.getStringAttr(path));
+    constantOp->setAttr(
+        EXTERNAL_DATA_OFFSET_ATTR, builder.getI64IntegerAttr(offset));
+    return constantOp;
+  }
 
   // Emit ConstantOp and record the mapping between the input and
   // the constant value.
-  // Create value attribute.
-  mlir::DenseElementsAttr denseElmAttr =
-      onnxTensorProtoToDenseElmAttr(builder, initializer);
+  // Create value attribute, unless it was decoded ahead.
+  auto decoded = decodedTensors.find(&initializer);
+  mlir::DenseElementsAttr denseElmAttr;
+  if (decoded != decodedTensors.end())
+    denseElmAttr = decoded->second;
+  else
+    denseElmAttr =
+        onnxTensorProtoToDenseElmAttr(builder, initializer, externalDataDir);
 
   // Create ConstantOp for dense array.
   return builder.create<mlir::ONNXConstantOp>(loc, nullptr, denseElmAttr);
 }
 
-mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
-    mlir::OpBuilder &builder, const onnx::TensorProto &initializer) {
+mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(mlir::OpBuilder &builder,
+    const onnx::TensorProto &initializer, const std::string &externalDataDir) {
   // Tensor dimensions.
   llvm::ArrayRef<int64_t> tensorDims(
       initializer.dims().data(), initializer.dims().size());
+  mlir::Type elmType = getInitializerElementType(builder, initializer);
+  auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
+
+  std::unique_ptr<llvm::MemoryBuffer> externalData;
+  llvm::ArrayRef<char> rawData;
+  if (getTensorRawData(initializer, externalDataDir, externalData, rawData))
+    return createDenseElmAttrFromRawData(tensorType, rawData);
+
   mlir::DenseElementsAttr denseElmAttr;
   switch (initializer.data_type()) {
   case (onnx::TensorProto::FLOAT): {
     const auto &arrayAttrInitializer = CreateArrayAttribute<float>(initializer);
-    auto elmType = builder.getF32Type();
-    auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
     break;
   }
+  case (onnx::TensorProto::FLOAT16):
+  case (onnx::TensorProto::BFLOAT16): {
+    // Build the half precision values from their bits.
+    const auto &arrayAttrInitializer =
+        CreateArrayAttribute<uint16_t>(initializer);
+    const llvm::fltSemantics &semantics =
+        elmType.cast<mlir::FloatType>().getFloatSemantics();
+    std::vector<llvm::APFloat> values;
+    for (uint16_t bits : arrayAttrInitializer)
+      values.emplace_back(semantics, llvm::APInt(16, bits));
+    denseElmAttr = mlir::DenseElementsAttr::get(tensorType, values);
+    break;
+  }
   case (onnx::TensorProto::DOUBLE): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<double>(initializer);
-    auto elmType = builder.getF64Type();
-    auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
     break;
@@ -144,8 +346,6 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   case (onnx::TensorProto::INT8): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<int8_t>(initializer);
-    auto elmType = builder.getIntegerType(8);
-    auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
     break;
@@ -153,8 +353,6 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   case (onnx::TensorProto::UINT8): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<uint8_t>(initializer);
-    auto elmType = builder.getIntegerType(8, false);
-    auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
     break;
@@ -162,8 +360,6 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   case (onnx::TensorProto::INT32): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<int32_t>(initializer);
-    auto elmType = builder.getIntegerType(32);
-    auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
     break;
@@ -171,8 +367,6 @@ mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
   case (onnx::TensorProto::INT64): {
     const auto &arrayAttrInitializer =
         CreateArrayAttribute<int64_t>(initializer);
-    auto elmType = builder.getIntegerType(64);
-    auto tensorType = mlir::RankedTensorType::get(tensorDims, elmType);
     denseElmAttr = mlir::DenseElementsAttr::get(
         tensorType, llvm::makeArrayRef(arrayAttrInitializer));
     break;
@@ -193,6 +387,8 @@ mlir::Type convertONNXTypeToMLIRType(
   switch (onnxType) {
   case onnx::TensorProto_DataType::TensorProto_DataType_FLOAT16:
     return builder_.getF16Type();
+  case onnx::TensorProto_DataType::TensorProto_DataType_BFLOAT16:
+    return builder_.getBF16Type();
   case onnx::TensorProto_DataType::TensorProto_DataType_FLOAT:
     return builder_.getF32Type();
   case onnx::TensorProto_DataType::TensorProto_DataType_DOUBLE:
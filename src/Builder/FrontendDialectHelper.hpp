@@ -30,8 +30,10 @@
 #include "mlir/IR/Types.h"
 #include "mlir/IR/Verifier.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopedHashTable.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "onnx/onnx_pb.h"
@@ -41,18 +43,38 @@
 
 namespace onnx_mlir {
 
-struct InitializedTensorMapping : SymbolMapping<onnx::TensorProto> {
+// The initializers are referenced from the model, which outlives the import,
+// rather than copied.
+struct InitializedTensorMapping : SymbolMapping<const onnx::TensorProto *> {
   mlir::Value EmitInitializerForInputTensor(
       mlir::Location loc, mlir::OpBuilder &builder, const std::string &name);
 
+  // Decode the initializers of a graph read by its nodes, named in
+  // `usedNames`, into dense attributes ahead of their use, on several threads
+  // when the context is multithreaded.
+  void DecodeInitializers(mlir::OpBuilder &builder,
+      const onnx::GraphProto &graph, const llvm::StringSet<> &usedNames);
+
   // Get initialized tensor.
-  onnx::TensorProto GetInitializedTensor(std::string name) {
-    return GetTensorByOnnxName(name);
+  const onnx::TensorProto &GetInitializedTensor(const std::string &name) {
+    return *GetTensorByOnnxName(name);
   }
+
+  // Directory the locations of external data are relative to.
+  std::string externalDataDir;
+
+  // External data of at least this many bytes is referenced by the constants
+  // instead of being imported; a negative value disables the references.
+  int64_t lazyExternalDataMinBytes = -1;
+
+  // Dense attributes of the initializers decoded ahead of their use.
+  llvm::DenseMap<const onnx::TensorProto *, mlir::DenseElementsAttr>
+      decodedTensors;
 };
 
-mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(
-    mlir::OpBuilder &builder, const onnx::TensorProto &initializer);
+mlir::DenseElementsAttr onnxTensorProtoToDenseElmAttr(mlir::OpBuilder &builder,
+    const onnx::TensorProto &initializer,
+    const std::string &externalDataDir = "");
 
 mlir::Type convertONNXTypeToMLIRType(
     mlir::OpBuilder &builder_, onnx::TensorProto_DataType onnxType);
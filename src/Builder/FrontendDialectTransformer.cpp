@@ -22,7 +22,10 @@
 
 #include "mlir/IR/BuiltinOps.h"
 #include "onnx/defs/schema.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/Path.h"
 
 #include "onnx/version_converter/convert.h"
 
@@ -41,6 +44,60 @@ namespace detail {
 
 typedef SymbolMapping<Value> ValueSymbolMapping;
 
+// Add to `names` the names of the values read by the nodes of the graph and
+// of its nested graphs, which may read the values of the enclosing graphs.
+static void collectNodeInputs(
+    const onnx::GraphProto &graph, std::vector<std::string> &names) {
+  for (const auto &node : graph.node()) {
+    for (const auto &input : node.input())
+      names.emplace_back(input);
+    for (const auto &attr : node.attribute()) {
+      if (attr.type() == onnx::AttributeProto::GRAPH)
+        collectNodeInputs(attr.g(), names);
+      for (const auto &nestedGraph : attr.graphs())
+        collectNodeInputs(nestedGraph, names);
+    }
+  }
+}
+
+// Return which nodes of the graph the outputs that are not pruned depend on,
+// and in `liveNames` the names of the values these nodes read. The other
+// nodes, and the initializers only they read, are not imported.
+static std::vector<bool> getLiveNodes(const onnx::GraphProto &graph,
+    llvm::ArrayRef<std::string> prunedOutputs, llvm::StringSet<> &liveNames) {
+  llvm::StringMap<int> producers;
+  for (int i = 0; i < graph.node_size(); ++i)
+    for (const auto &output : graph.node(i).output())
+      if (!output.empty())
+        producers[output] = i;
+
+  std::vector<bool> liveNodes(graph.node_size(), false);
+  std::vector<std::string> worklist;
+  for (const auto &output : graph.output())
+    if (!llvm::is_contained(prunedOutputs, output.name()))
+      worklist.emplace_back(output.name());
+  while (!worklist.empty()) {
+    std::string name = worklist.back();
+    worklist.pop_back();
+    if (name.empty() || !liveNames.insert(name).second)
+      continue;
+    auto producer = producers.find(name);
+    if (producer == producers.end() || liveNodes[producer->second])
+      continue;
+    liveNodes[producer->second] = true;
+    const onnx::NodeProto &node = graph.node(producer->second);
+    for (const auto &input : node.input())
+      worklist.emplace_back(input);
+    for (const auto &attr : node.attribute()) {
+      if (attr.type() == onnx::AttributeProto::GRAPH)
+        collectNodeInputs(attr.g(), worklist);
+      for (const auto &nestedGraph : attr.graphs())
+        collectNodeInputs(nestedGraph, worklist);
+    }
+  }
+  return liveNodes;
+}
+
 class FrontendGenImpl {
 public:
   explicit FrontendGenImpl(MLIRContext &context)
@@ -78,6 +135,9 @@ public:
   ModuleOp ImportONNXModel(
       const onnx::ModelProto &model, ImportOptions options) {
     options_ = options;
+    initializedTensors.externalDataDir = options.externalDataDir;
+    initializedTensors.lazyExternalDataMinBytes =
+        options.lazyExternalDataMinBytes;
     SetOpSetImport(model); // Determines which opsets to use.
     importGraph(model.graph());
     return module_;
@@ -277,7 +337,8 @@ private:
           llvm::makeArrayRef(attr.ints().begin(), attr.ints().end()));
       break;
     case onnx::AttributeProto::TENSOR:
-      mlirAttr = onnxTensorProtoToDenseElmAttr(builder_, attr.t());
+      mlirAttr = onnxTensorProtoToDenseElmAttr(
+          builder_, attr.t(), options_.externalDataDir);
       break;
     case onnx::AttributeProto::STRINGS: {
       llvm::SmallVector<StringRef, 4> vectorStringRef;
@@ -327,19 +388,28 @@ private:
    * input/output names.
    * @param useStdReturn if set to true, will emit standard return op as
    * terminator, otherwise, will use OnnxReturn op as terminator.
+   * @param prunedOutputs names of the outputs of the graph not returned.
    * @return function type corresponding to the subgraph input/output signature.
    */
   FunctionType importGraph(const onnx::GraphProto &graph, Region &region,
-      Operation *op, bool useStdReturn) {
+      Operation *op, bool useStdReturn,
+      llvm::ArrayRef<std::string> prunedOutputs = {}) {
     frontend_symbols_.pushScope(graph.name());
     initializedTensors.pushScope(graph.name());
     Block *entryBlock = &region.back();
 
+    // Only the nodes the returned outputs depend on are imported, and only
+    // the initializers they read are decoded.
+    llvm::StringSet<> liveNames;
+    std::vector<bool> liveNodes =
+        getLiveNodes(graph, prunedOutputs, liveNames);
+
     // Maintain a mapping between the parameter and its initializer.
     for (const auto &initializer : graph.initializer()) {
       const auto &initializerName = initializer.name();
-      initializedTensors.AddMapping(initializerName, initializer);
+      initializedTensors.AddMapping(initializerName, &initializer);
     }
+    initializedTensors.DecodeInitializers(builder_, graph, liveNames);
 
     // create a function for the graph
     // TODO:
@@ -349,6 +419,10 @@ private:
 
     llvm::SmallVector<llvm::StringRef, 4> inputNames;
     llvm::SmallVector<llvm::StringRef, 4> outputNames;
+    // The symbolic names of the dynamic dimensions of the inputs, e.g.
+    // "batch", empty for the other dimensions.
+    llvm::SmallVector<Attribute, 4> inputDimParams;
+    bool hasDimParams = false;
 
     // Import the input tensor types that are not constant and not initialized.
     int numInputs = 0;
@@ -382,6 +456,21 @@ private:
         }
         argTypes.emplace_back(argTy);
 
+        llvm::SmallVector<llvm::StringRef, 4> dimParams;
+        if (auto rankedTy = argTy.dyn_cast<RankedTensorType>()) {
+          const auto &shapeProto = input.type().tensor_type().shape();
+          for (int i = 0; i < rankedTy.getRank(); i++) {
+            if (rankedTy.getShape()[i] == -1 &&
+                !shapeProto.dim(i).dim_param().empty()) {
+              dimParams.emplace_back(shapeProto.dim(i).dim_param());
+              hasDimParams = true;
+            } else {
+              dimParams.emplace_back("");
+            }
+          }
+        }
+        inputDimParams.emplace_back(builder_.getStrArrayAttr(dimParams));
+
         // numInputs is the number of graph inputs not contained within the
         // initializer
         ++numInputs;
@@ -389,7 +478,8 @@ private:
     }
     for (const auto &output : graph.output()) {
       AddValueInfo(output);
-      outputNames.push_back(output.name());
+      if (!llvm::is_contained(prunedOutputs, output.name()))
+        outputNames.push_back(output.name());
     }
 
     for (const auto &internal : graph.value_info()) {
@@ -410,15 +500,16 @@ private:
     }
 
     // Import nodes in the subgraph.
-    for (const auto &item : graph.node()) {
-      ImportNode(item);
-    }
+    for (int i = 0; i < graph.node_size(); ++i)
+      if (liveNodes[i])
+        ImportNode(graph.node(i));
 
     llvm::SmallVector<Type, 4> retTys;
     llvm::SmallVector<Value, 4> retVals;
     // Import the output tensors
     for (const auto &output : graph.output()) {
-      ImportOutputTensor(output, retTys, retVals);
+      if (!llvm::is_contained(prunedOutputs, output.name()))
+        ImportOutputTensor(output, retTys, retVals);
     }
 
     if (useStdReturn)
@@ -429,6 +520,9 @@ private:
 
     op->setAttr("input_names", builder_.getStrArrayAttr(inputNames));
     op->setAttr("output_names", builder_.getStrArrayAttr(outputNames));
+    // Dynamic dimensions with the same name have the same size.
+    if (hasDimParams)
+      op->setAttr("input_dim_params", builder_.getArrayAttr(inputDimParams));
 
     frontend_symbols_.popScope(graph.name());
     initializedTensors.popScope(graph.name());
@@ -1169,7 +1263,7 @@ private:
    * @return A function corresponding to the imported computation graph.
    */
   FuncOp importGraph(const onnx::GraphProto &graph) {
-    const std::string &name = "main_graph";
+    const std::string &name = options_.funcName;
     auto mainFunc = FuncOp::create(UnknownLoc(), name,
         /*type=*/builder_.getFunctionType({}, {}), /*attrs=*/{});
     module_.push_back(mainFunc);
@@ -1178,7 +1272,8 @@ private:
     builder_.setInsertionPointToStart(&mainFunc.body().back());
 
     auto funcType = importGraph(graph, /*region=*/mainFunc.body(),
-        /*op=*/mainFunc.getOperation(), /*useStdReturn=*/true);
+        /*op=*/mainFunc.getOperation(), /*useStdReturn=*/true,
+        options_.prunedOutputs);
     mainFunc.setType(funcType);
     std::string sig = getSignature(funcType);
 
@@ -1196,13 +1291,9 @@ private:
 } // namespace onnx_mlir
 namespace onnx_mlir {
 
-void ImportFrontendModelFile(std::string model_fname, MLIRContext &context,
-    OwningModuleRef &module, ImportOptions options) {
-  onnx::ModelProto model;
-  std::fstream input(model_fname, std::ios::in | std::ios::binary);
-
-  auto parse_success = model.ParseFromIstream(&input);
-  assert(parse_success && "Onnx Model Parsing Failed.");
+// Import the model, converted to the current opset when requested.
+static void ImportFrontendModelWithVersion(const onnx::ModelProto &model,
+    MLIRContext &context, OwningModuleRef &module, ImportOptions options) {
   int originVersion = CURRENT_ONNX_OPSET;
   // Get the version of the model
   // Code copied from onnx/onnx/version_coverter/convert.cc
@@ -1225,6 +1316,28 @@ void ImportFrontendModelFile(std::string model_fname, MLIRContext &context,
   }
 }
 
+void ImportFrontendModelFile(std::string model_fname, MLIRContext &context,
+    OwningModuleRef &module, ImportOptions options) {
+  onnx::ModelProto model;
+  std::fstream input(model_fname, std::ios::in | std::ios::binary);
+
+  auto parse_success = model.ParseFromIstream(&input);
+  assert(parse_success && "Onnx Model Parsing Failed.");
+  // The locations of external data are relative to the model file.
+  if (options.externalDataDir.empty())
+    options.externalDataDir =
+        llvm::sys::path::parent_path(model_fname).str();
+  ImportFrontendModelWithVersion(model, context, module, options);
+}
+
+void ImportFrontendModelArray(const void *onnxBuffer, int bufferSize,
+    MLIRContext &context, OwningModuleRef &module, ImportOptions options) {
+  onnx::ModelProto model;
+  auto parse_success = model.ParseFromArray(onnxBuffer, bufferSize);
+  assert(parse_success && "Onnx Model Parsing Failed.");
+  ImportFrontendModelWithVersion(model, context, module, options);
+}
+
 void ImportFrontendModel(const onnx::ModelProto &model, MLIRContext &context,
     OwningModuleRef &module, ImportOptions options) {
 
@@ -43,6 +43,17 @@ struct ImportOptions {
   // variables)
   bool useOnnxModelTypes = false;
   bool invokeOnnxVersionConverter = false;
+  // Directory the locations of external tensor data are relative to. It
+  // defaults to the directory of the model file when a file is imported.
+  std::string externalDataDir = "";
+  // External data of at least this many bytes is only read when emitting the
+  // constants that reference it; a negative value imports all the data.
+  int64_t lazyExternalDataMinBytes = -1;
+  // Name of the function of the graph, whose entry point is run_<funcName>.
+  std::string funcName = "main_graph";
+  // Names of the outputs of the graph that are not returned, the nodes and
+  // initializers only computing them being dropped with the other dead ones.
+  std::vector<std::string> prunedOutputs;
 };
 
 /*!
@@ -54,6 +65,16 @@ void ImportFrontendModelFile(std::string model_fname,
     mlir::MLIRContext &context, mlir::OwningModuleRef &module,
     ImportOptions options = ImportOptions());
 
+/*!
+ *  Import an ONNX model serialized in memory into the ONNX Dialect.
+ *  @param onnxBuffer buffer holding the onnx model protobuf.
+ *  @param bufferSize number of bytes of the buffer.
+ *  @return MLIR::module generated for the ONNX model.
+ */
+void ImportFrontendModelArray(const void *onnxBuffer, int bufferSize,
+    mlir::MLIRContext &context, mlir::OwningModuleRef &module,
+    ImportOptions options = ImportOptions());
+
 /*!
  *  Import an ONNX model proto into the ONNX Dialect.
  *  @param model the onnx model protobuf.
@@ -4,8 +4,8 @@
 
 #pragma once
 
-#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "mlir/IR/Value.h"
@@ -38,7 +38,7 @@ struct VariableScope {
    * @param name symbol name.
    * @return symbol value.
    */
-  T get(const std::string &name) const;
+  const T &get(const std::string &name) const;
 
   /*!
    * Check whether symbol exists in the current scope.
@@ -54,9 +54,9 @@ struct VariableScope {
 
 private:
   /*!
-   * A mapping between symbol name and symbol value.
+   * A hash map between symbol name and symbol value.
    */
-  std::map<std::string, T> _nameToValue;
+  std::unordered_map<std::string, T> _nameToValue;
 };
 
 /*!
@@ -70,7 +70,7 @@ struct SymbolMapping {
    *  @param name onnx tensor name.
    *  @return onnx mlir tensor corresponding to `name`.
    */
-  T GetTensorByOnnxName(const std::string &name);
+  const T &GetTensorByOnnxName(const std::string &name);
 
   /*!
    *  Add a new mapping from onnx tensor name to MLIR symbol.
@@ -113,7 +113,7 @@ private:
  */
 
 template <typename T>
-T SymbolMapping<T>::GetTensorByOnnxName(const std::string &name) {
+const T &SymbolMapping<T>::GetTensorByOnnxName(const std::string &name) {
   for (const auto &scope : _scopes)
     if (scope.contain(name))
       return scope.get(name);
@@ -130,7 +130,7 @@ void SymbolMapping<T>::AddMapping(const std::string &name, T tensor) {
 template <typename T>
 bool SymbolMapping<T>::ContainKey(const std::string &name) {
   return llvm::any_of(_scopes,
-      [name](const VariableScope<T> &scope) { return scope.contain(name); });
+      [&name](const VariableScope<T> &scope) { return scope.contain(name); });
 }
 
 template <typename T>
@@ -151,7 +151,7 @@ void VariableScope<T>::set(const std::string &name, T val) {
 }
 
 template <typename T>
-T VariableScope<T>::get(const std::string &name) const {
+const T &VariableScope<T>::get(const std::string &name) const {
   return _nameToValue.at(name);
 }
 
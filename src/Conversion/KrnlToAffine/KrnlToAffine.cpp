@@ -42,6 +42,11 @@
 using namespace mlir;
 
 namespace {
+// Attribute used to tag the affine for loops materialized from Krnl loop
+// references marked by krnl.parallel. Tagged loops are converted into
+// affine.parallel operations once all loop bodies have been moved in place.
+static constexpr const char *PARALLEL_LOOP_ATTR = "krnl.parallel";
+
 // Since Krnl Dialect allows optimizations to be specified in the form of
 // recipes without being applied, some IR block may exist under Krnl loops
 // corresponding to loops that will be materialized only after relevant
@@ -381,9 +386,43 @@ void lowerIterateOp(KrnlIterateOp &iterateOp, OpBuilder &builder,
 /// add and multiply, this pass will leave these operations intact.
 struct ConvertKrnlToAffinePass
     : public PassWrapper<ConvertKrnlToAffinePass, FunctionPass> {
+  ConvertKrnlToAffinePass() = default;
+  ConvertKrnlToAffinePass(const ConvertKrnlToAffinePass &pass) {}
+  ConvertKrnlToAffinePass(bool matMulMicroKernels) {
+    this->matMulMicroKernels = matMulMicroKernels;
+  }
+
   void runOnFunction() final;
+
+  // Compute the full tiles of krnl.matmul with the tuned microkernels of the
+  // runtime, for the tile sizes they are provided for.
+  Option<bool> matMulMicroKernels{*this, "matmul-microkernels",
+      llvm::cl::desc("Call the runtime microkernels for the full matmul "
+                     "tiles of supported sizes."),
+      llvm::cl::init(false)};
 };
 
+/// Convert an affine for loop marked by krnl.parallel into an affine.parallel
+/// loop with the same bounds and step. Loops with min/max bounds are left
+/// untouched and thus executed sequentially.
+void convertToParallelLoop(AffineForOp forOp) {
+  forOp->removeAttr(PARALLEL_LOOP_ATTR);
+  if (forOp.getLowerBoundMap().getNumResults() != 1 ||
+      forOp.getUpperBoundMap().getNumResults() != 1)
+    return;
+
+  OpBuilder builder(forOp);
+  AffineParallelOp parallelOp = builder.create<AffineParallelOp>(
+      forOp.getLoc(), /*resultTypes=*/llvm::None, /*reductions=*/llvm::None,
+      forOp.getLowerBoundMap(), forOp.getLowerBoundOperands(),
+      forOp.getUpperBoundMap(), forOp.getUpperBoundOperands(),
+      forOp.getStep());
+  // Both loops have a single index argument and an affine.yield terminator,
+  // so the body can be moved as is.
+  parallelOp.region().takeBody(forOp.region());
+  forOp.erase();
+}
+
 LogicalResult interpretOperation(Operation *op, OpBuilder &builder,
     llvm::SmallDenseMap<Value, AffineForOp, 4> &loopRefToOp,
     llvm::SmallPtrSetImpl<Operation *> &opsToErase, LoopBodyMover &mover) {
@@ -483,6 +522,14 @@ LogicalResult interpretOperation(Operation *op, OpBuilder &builder,
     assert(succeeded(res) && "failed to unroll");
     opsToErase.insert(op);
     return success();
+  } else if (auto parallelOp = dyn_cast_or_null<KrnlParallelOp>(op)) {
+    // Tag the affine for loop; the conversion to affine.parallel is deferred
+    // until the loop body has been moved under the materialized loop nest.
+    AffineForOp loopToParallelize = loopRefToOp[parallelOp.loop()];
+    assert(loopToParallelize && "expected a materialized loop to parallelize");
+    loopToParallelize->setAttr(PARALLEL_LOOP_ATTR, builder.getUnitAttr());
+    opsToErase.insert(op);
+    return success();
   }
 
   return success();
@@ -540,6 +587,17 @@ public:
     Value memref = operandAdaptor.memref();
     SmallVector<Value, 4> indices = operandAdaptor.indices();
 
+    // Non-temporal stores are always lowered to std.store, which keeps their
+    // attribute until the lowering to LLVM, unlike the lowering of
+    // affine.store.
+    if (op.isNonTemporal()) {
+      auto storeOp = rewriter.replaceOpWithNewOp<memref::StoreOp>(
+          op, value, memref, indices);
+      storeOp->setAttr(
+          KrnlStoreOp::getNonTemporalAttrName(), rewriter.getUnitAttr());
+      return success();
+    }
+
     // Check whether all indices are affine maps or not.
     bool affineIndices =
         !llvm::any_of(indices, [](Value v) { return !isValidDim(v); });
@@ -553,6 +611,39 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// Krnl to Affine Rewrite Patterns: KrnlPrefetch operation.
+//===----------------------------------------------------------------------===//
+
+/// KrnlPrefetch will be lowered to affine.prefetch when the access indices are
+/// all affine maps. Otherwise the hint is dropped.
+class KrnlPrefetchLowering : public OpRewritePattern<KrnlPrefetchOp> {
+public:
+  using OpRewritePattern<KrnlPrefetchOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      KrnlPrefetchOp op, PatternRewriter &rewriter) const override {
+    KrnlPrefetchOpAdaptor operandAdaptor = KrnlPrefetchOpAdaptor(op);
+
+    // Prepare inputs.
+    Value memref = operandAdaptor.memref();
+    SmallVector<Value, 4> indices = operandAdaptor.indices();
+
+    // Check whether all indices are affine maps or not.
+    bool affineIndices =
+        !llvm::any_of(indices, [](Value v) { return !isValidDim(v); });
+
+    if (!affineIndices) {
+      rewriter.eraseOp(op);
+      return success();
+    }
+    AffineMap map = rewriter.getMultiDimIdentityMap(indices.size());
+    rewriter.replaceOpWithNewOp<AffinePrefetchOp>(op, memref, map, indices,
+        op.isWrite(), op.localityHint(), op.isDataCache());
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // Krnl to Affine Rewrite Patterns: Krnl MatMul operation.
 //===----------------------------------------------------------------------===//
@@ -636,6 +727,47 @@ static IndexExpr partialTrip(IndexExpr UB, IndexExpr block, IndexExpr GI) {
   return UB - GI;
 }
 
+// Generate an affine.if testing that all the conditions (expr >= 0) are
+// true, with the then and else branches given by the functions.
+static void genIfThenElseWithoutParams(PatternRewriter &rewriter,
+    SmallVectorImpl<IndexExpr> &conditions,
+    function_ref<void(ValueRange)> thenFn,
+    function_ref<void(ValueRange)> elseFn) {
+  IndexExprScope &scope = IndexExprScope::getCurrentScope();
+  int64_t rank = conditions.size();
+  SmallVector<bool, 4> isEq(rank, false);
+  SmallVector<AffineExpr, 4> affineCond;
+  bool allTrue = true;
+  bool allFalse = true;
+  for (IndexExpr i : conditions) {
+    assert(i.isAffine() && "conditions expected to be affine");
+    affineCond.emplace_back(i.getAffineExpr());
+    if (i.isLiteral()) {
+      if (i.getLiteral() < 0) // Inequality is expr >= 0, test if false.
+        allTrue = false;
+      if (i.getLiteral() >= 0) // Inequality is expr >= 0, test if true.
+        allFalse = false;
+    } else {
+      allTrue = false;
+      allFalse = false;
+    }
+  }
+  auto inset = IntegerSet::get(
+      scope.getNumDims(), scope.getNumSymbols(), affineCond, isEq);
+  SmallVector<Value, 8> dimAndSymbolList;
+  scope.getDimAndSymbolList(dimAndSymbolList);
+  auto ifOp = rewriter.create<AffineIfOp>(
+      scope.getLoc(), inset, dimAndSymbolList, true);
+  Block *thenBlock = ifOp.getThenBlock();
+  Block *elseBlock = ifOp.getElseBlock();
+  if (!allFalse) {
+    appendToBlock(thenBlock, [&](ValueRange args) { thenFn(args); });
+  }
+  if (!allTrue) {
+    appendToBlock(elseBlock, [&](ValueRange args) { elseFn(args); });
+  }
+}
+
 static IndexExpr startInBuffer(
     IndexExpr globalStart, IndexExpr tileSize, IndexExpr globalUB) {
   if (tileSize.isLiteral() && globalUB.isLiteral() &&
@@ -646,10 +778,47 @@ static IndexExpr startInBuffer(
   return globalStart % tileSize;
 }
 
+// Extend an element (or a vector of elements) of A or B to the element type of
+// C, in which the products are accumulated, e.g. i8 to i32.
+static Value extendToAccumulator(
+    PatternRewriter &rewriter, Location loc, Value val, Type accType) {
+  Type valType = val.getType();
+  if (getElementTypeOrSelf(valType) == accType)
+    return val;
+  Type resType = accType;
+  if (auto vecType = valType.dyn_cast<VectorType>())
+    resType = VectorType::get(vecType.getShape(), accType);
+  if (accType.isa<FloatType>())
+    return rewriter.create<FPExtOp>(loc, resType, val);
+  return rewriter.create<SignExtendIOp>(loc, val, resType);
+}
+
 // KrnlMatmul will be lowered to vector and affine expressions
+// Largest number of rows of the tuned microkernels of the runtime, as
+// OM_MICRO_KERNEL_MAX_ROWS in OMMicroKernel.h.
+static const int64_t matMulMicroKernelMaxRows = 8;
+
+/// Check that the runtime provides a tuned microkernel for the compute tiles
+/// of the matmul: f32 A, B and C buffers with contiguous rows, and tiles of
+/// up to matMulMicroKernelMaxRows rows of 8 or 16 columns.
+static bool isMatMulMicroKernelTile(
+    KrnlMatMulOp op, IndexExpr I, IndexExpr J, IndexExpr K) {
+  for (Value buffer : {op.A(), op.B(), op.C()}) {
+    MemRefType type = buffer.getType().cast<MemRefType>();
+    if (!type.getElementType().isF32() || !type.getAffineMaps().empty())
+      return false;
+  }
+  if (!I.isLiteral() || !J.isLiteral() || !K.isLiteral())
+    return false;
+  return I.getLiteral() >= 1 && I.getLiteral() <= matMulMicroKernelMaxRows &&
+         (J.getLiteral() == 8 || J.getLiteral() == 16);
+}
+
 class KrnlMatmulLowering : public OpRewritePattern<KrnlMatMulOp> {
 public:
-  using OpRewritePattern<KrnlMatMulOp>::OpRewritePattern;
+  KrnlMatmulLowering(MLIRContext *context, bool useMicroKernels)
+      : OpRewritePattern<KrnlMatMulOp>(context),
+        useMicroKernels(useMicroKernels) {}
 
   LogicalResult matchAndRewrite(
       KrnlMatMulOp op, PatternRewriter &rewriter) const override {
@@ -659,9 +828,10 @@ public:
     // Option.
     bool fullUnrollAndJam = op.unroll();
 
-    // Operands and types.
+    // Operands and types. The computations are performed in the element type
+    // of C, which may be wider than the one of A and B.
     Type elementType =
-        operandAdaptor.A().getType().cast<MemRefType>().getElementType();
+        operandAdaptor.C().getType().cast<MemRefType>().getElementType();
     bool simdize = op.simdize();
     // Init scope and emit constants.
     ScopedContext scope(rewriter, op.getLoc());
@@ -713,18 +883,18 @@ public:
       // Cannot simdize if the vector length is not a compile time constant.
       simdize = false;
     }
-    if (!bBounds.isLiteral(bRank - 1) || !cBounds.isLiteral(cRank - 1)) {
-      // Cannot simdize if the last dim of B or C are not constant.
-      simdize = false;
-    }
+    // The vectors of B and C are accessed through memrefs of vectors when the
+    // last dim of B and C is a compile time multiple of the vector length,
+    // and with vector transfers otherwise. The transfers read and write the
+    // vectors at any column, masking out the elements beyond the end of the
+    // rows.
+    bool useTransfers = false;
     if (simdize) {
       int64_t VL = vectorLen.getLiteral();
-      if (bBounds.getShape(bRank - 1) % VL != 0 ||
-          cBounds.getShape(cRank - 1) % VL != 0) {
-        // If the memref of B and C are not multiple of the vector length in
-        // their last dim, then we cannot simdize either.
-        simdize = false;
-      }
+      if (!bBounds.isLiteral(bRank - 1) || !cBounds.isLiteral(cRank - 1) ||
+          bBounds.getShape(bRank - 1) % VL != 0 ||
+          cBounds.getShape(cRank - 1) % VL != 0)
+        useTransfers = true;
     }
     if (!simdize)
       vectorLen = LiteralIndexExpr(1);
@@ -761,9 +931,12 @@ public:
     cStart.emplace_back(
         jComputeStart - DimIndexExpr(operandAdaptor.cMemStart()[cRank - 1]));
 
+    // The vector transfers use the element indices of B and C.
     SmallVector<IndexExpr, 4> bVecStart(bStart), cVecStart(cStart);
-    bVecStart[bRank - 1] = bStart[bRank - 1].floorDiv(vectorLen);
-    cVecStart[cRank - 1] = cStart[cRank - 1].floorDiv(vectorLen);
+    if (!useTransfers) {
+      bVecStart[bRank - 1] = bStart[bRank - 1].floorDiv(vectorLen);
+      cVecStart[cRank - 1] = cStart[cRank - 1].floorDiv(vectorLen);
+    }
 
     // Now determine if we have full/partial tiles. This is determined by the
     // outer dimensions of the original computations, as by definition tiling
@@ -792,40 +965,36 @@ public:
 
     using namespace edsc::op;
 
-    // Currently, there is a bug in unroll and jam which crashes if there is an
-    // affine if/then/else. No crash if only if-then.
-    if (iIsFullTile.isLiteralAndGreaterThan(-1) &&
-        jIsFullTile.isLiteralAndGreaterThan(-1) &&
-        kIsFullTile.isLiteralAndGreaterThan(-1)) {
-      // this is ok, only a if-then below.
-    } else {
-      fullUnrollAndJam = false;
-    }
+    // The full tiles may be computed by a microkernel of the runtime instead,
+    // the partial ones keep the code below.
+    bool microKernel =
+        useMicroKernels && isMatMulMicroKernelTile(op, iComputeTileSize,
+                               jComputeTileSize, kComputeTileSize);
     if (simdize) {
       // SIMD code generator.
       // clang-format off
       genIfThenElseWithoutParams(rewriter, allFullTiles,
         /* then full */ [&](ValueRange) {
-        genSimd(rewriter, op, elementType, aStart, bVecStart, cVecStart,
-          iComputeTileSize, jComputeTileSize, kComputeTileSize,
-          vectorLen, fullUnrollAndJam); 
+        if (microKernel)
+          genMicroKernel(op, aStart, bStart, cStart, iComputeTileSize,
+            jComputeTileSize, kComputeTileSize);
+        else
+          genSimd(rewriter, op, elementType, aStart, bVecStart, cVecStart,
+            iComputeTileSize, jComputeTileSize, kComputeTileSize,
+            vectorLen, fullUnrollAndJam, useTransfers);
       }, /* has some partial tiles */ [&](ValueRange) {
         // Trip regardless of full/partial for N & K
         // Test if SIMD dim (M) is full.
         genIfThenElseWithoutParams(rewriter, jFullTiles,
           /* full SIMD */ [&](ValueRange) {
           genSimd(rewriter, op, elementType, aStart, bVecStart, cVecStart,
-            iTrip, jComputeTileSize, kTrip, vectorLen, false);
+            iTrip, jComputeTileSize, kTrip, vectorLen, fullUnrollAndJam,
+            useTransfers);
         }, /* else partial SIMD */ [&](ValueRange) {
-          if (false && jPartialTrip.isLiteral() && jPartialTrip.getLiteral() >=2) {
-            // has a known trip count along the simd dimension of at least 2
-            // elements, use simd again.
-            genSimd(rewriter, op, elementType, aStart, bVecStart, cVecStart,
-              iTrip, jPartialTrip, kTrip, vectorLen, false);
-          } else {
-            genScalar(rewriter, op, elementType, aStart, bStart,  cStart,
-              iTrip, jPartialTrip, kTrip, false);
-          }
+          // Only the first jPartialTrip elements of the vectors are updated.
+          genSimd(rewriter, op, elementType, aStart, bVecStart, cVecStart,
+            iTrip, jPartialTrip, kTrip, vectorLen, fullUnrollAndJam,
+            useTransfers);
         });
       });
       // clang-format on
@@ -834,12 +1003,16 @@ public:
       // clang-format off
       genIfThenElseWithoutParams(rewriter, allFullTiles,
         /* then full */ [&](ValueRange) {
-        genScalar(rewriter, op, elementType, aStart, bStart, cStart,
-          iComputeTileSize, jComputeTileSize, kComputeTileSize,
-          fullUnrollAndJam); 
+        if (microKernel)
+          genMicroKernel(op, aStart, bStart, cStart, iComputeTileSize,
+            jComputeTileSize, kComputeTileSize);
+        else
+          genScalar(rewriter, op, elementType, aStart, bStart, cStart,
+            iComputeTileSize, jComputeTileSize, kComputeTileSize,
+            fullUnrollAndJam); 
       }, /* else partial */ [&](ValueRange) {
         genScalar(rewriter, op, elementType, aStart, bStart, cStart,
-          iTrip, jTrip, kTrip, false);
+          iTrip, jTrip, kTrip, fullUnrollAndJam);
       });
       // clang-format on
     }
@@ -848,15 +1021,38 @@ public:
   }
 
 private:
+  bool useMicroKernels;
+
+  // Compute a full tile with a call to the microkernel of the runtime.
+  void genMicroKernel(KrnlMatMulOp op, ArrayRef<IndexExpr> aStart,
+      ArrayRef<IndexExpr> bStart, ArrayRef<IndexExpr> cStart, IndexExpr I,
+      IndexExpr J, IndexExpr K) const {
+    OpBuilder &builder = ScopedContext::getBuilderRef();
+    KrnlMatMulOpAdaptor operandAdaptor(op);
+    SmallVector<Value, 4> aAccess, bAccess, cAccess;
+    IndexExpr::getValues(aStart, aAccess);
+    IndexExpr::getValues(bStart, bAccess);
+    IndexExpr::getValues(cStart, cAccess);
+    builder.create<KrnlMatMulMicroKernelOp>(op.getLoc(), operandAdaptor.A(),
+        aAccess, operandAdaptor.B(), bAccess, operandAdaptor.C(), cAccess,
+        builder.getI64IntegerAttr(I.getLiteral()),
+        builder.getI64IntegerAttr(J.getLiteral()),
+        builder.getI64IntegerAttr(K.getLiteral()));
+  }
+
   void genScalar(PatternRewriter &rewriter, KrnlMatMulOp op, Type elementType,
       ArrayRef<IndexExpr> aStart, ArrayRef<IndexExpr> bStart,
       ArrayRef<IndexExpr> cStart, IndexExpr I, IndexExpr J, IndexExpr K,
       bool unrollJam) const {
-    // Get operands.Î
+    // Get operands.
     KrnlMatMulOpAdaptor operandAdaptor(op);
     Value A(operandAdaptor.A()), B(operandAdaptor.B()), C(operandAdaptor.C());
     int64_t aRank(aStart.size()), bRank(bStart.size()), cRank(cStart.size());
-    MemRefType CTmpType = MemRefType::get({}, elementType);
+    // With unroll and jam, the J columns of a row are computed together,
+    // sharing the loads of A, with a temp c storage per column.
+    bool jamColumns = unrollJam && J.isLiteral();
+    int64_t numColumns = jamColumns ? J.getLiteral() : 1;
+    MemRefType CTmpType = MemRefType::get({numColumns}, elementType);
 #if DEBUG_MALLOC
 #if DEBUG_GLOBAL_ALLOC_FREE
     SmallVector<IndexExpr, 1> empty;
@@ -872,41 +1068,59 @@ private:
     Value TmpC = memref_alloca(CTmpType, constAlignAttr);
 #endif
 
-    // For i, j loops.
+    // Compute C(i, j) for the given columns j of row i.
     using namespace edsc::op;
     LiteralIndexExpr zero(0);
-    Value jSaved;
-    // clang-format off
-    affineLoopBuilder(zero, I, 1, [&](Value i) {
-      affineLoopBuilder(zero, J, 1, [&](Value j) {
-        // Defines induction variables, and possibly initialize C.
-        jSaved = j;
-        // Alloc and init temp c storage.
-        AffineIndexedValue TTmpC(TmpC);
+    auto genColumns = [&](Value i, ArrayRef<Value> columns) {
+      int64_t numCols = columns.size();
+      // Init temp c storage with CC(i + cStart0, j + cStart1).
+      SmallVector<SmallVector<Value, 4>, 8> cAccesses;
+      SmallVector<Value, 8> tmpAccesses;
+      for (int64_t c = 0; c < numCols; ++c) {
         SmallVector<Value, 4> cAccess;
-        // CC(i + cStart0.getValue(), j + cStart1.getValue());
         IndexExpr::getValues(cStart, cAccess);
-        cAccess[cRank-2] = i + cAccess[cRank-2];
-        cAccess[cRank-1] = j + cAccess[cRank-1];
-        TTmpC() = affine_load(C, cAccess);
-        // Sum over k.
-        affineLoopBuilder(zero, K, 1, [&](Value k) {
-          SmallVector<Value, 4> aAccess, bAccess;
-          // AA(i + aStart0.getValue(), k + aStart1.getValue())
-          IndexExpr::getValues(aStart, aAccess);
-          aAccess[aRank-2] = i + aAccess[aRank-2];
-          aAccess[aRank-1] = k + aAccess[aRank-1];
-          Value a = affine_load(A, aAccess);
+        cAccess[cRank - 2] = i + cAccess[cRank - 2];
+        cAccess[cRank - 1] = columns[c] + cAccess[cRank - 1];
+        tmpAccesses.emplace_back(std_constant_index(c));
+        affine_store(affine_load(C, cAccess), TmpC, tmpAccesses[c]);
+        cAccesses.emplace_back(cAccess);
+      }
+      // Sum over k.
+      affineLoopBuilder(zero, K, 1, [&](Value k) {
+        // AA(i + aStart0.getValue(), k + aStart1.getValue())
+        SmallVector<Value, 4> aAccess;
+        IndexExpr::getValues(aStart, aAccess);
+        aAccess[aRank - 2] = i + aAccess[aRank - 2];
+        aAccess[aRank - 1] = k + aAccess[aRank - 1];
+        Value a = extendToAccumulator(
+            rewriter, op.getLoc(), affine_load(A, aAccess), elementType);
+        for (int64_t c = 0; c < numCols; ++c) {
           // BB(k + bStart0.getValue(), j + bStart1.getValue())
+          SmallVector<Value, 4> bAccess;
           IndexExpr::getValues(bStart, bAccess);
-          bAccess[bRank-2] = k + bAccess[bRank-2];
-          bAccess[bRank-1] = j + bAccess[bRank-1];
-          Value b = affine_load(B, bAccess);
-          TTmpC() = a * b + TTmpC();
-        });
-        // Store temp result into C(i, j)
-        affine_store(TTmpC(), C, cAccess);
+          bAccess[bRank - 2] = k + bAccess[bRank - 2];
+          bAccess[bRank - 1] = columns[c] + bAccess[bRank - 1];
+          Value b = extendToAccumulator(
+              rewriter, op.getLoc(), affine_load(B, bAccess), elementType);
+          Value res = a * b + affine_load(TmpC, tmpAccesses[c]);
+          affine_store(res, TmpC, tmpAccesses[c]);
+        }
       });
+      // Store temp results into C(i, j).
+      for (int64_t c = 0; c < numCols; ++c)
+        affine_store(affine_load(TmpC, tmpAccesses[c]), C, cAccesses[c]);
+    };
+
+    // For i, j loops, the j loop being unrolled and jammed if requested.
+    affineLoopBuilder(zero, I, 1, [&](Value i) {
+      if (jamColumns) {
+        SmallVector<Value, 8> columns;
+        for (int64_t c = 0; c < numColumns; ++c)
+          columns.emplace_back(std_constant_index(c));
+        genColumns(i, columns);
+      } else {
+        affineLoopBuilder(zero, J, 1, [&](Value j) { genColumns(i, {j}); });
+      }
     });
 #if DEBUG_MALLOC
 #if DEBUG_GLOBAL_ALLOC_FREE
@@ -914,22 +1128,12 @@ private:
     rewriter.create<DeallocOp>(op.getLoc(), TmpC);
 #endif
 #endif
-    // clang-format on
-    if (unrollJam && J.isLiteral()) {
-      // Unroll and jam. Seems to support only one operation at this time.
-      auto jLoop = getForInductionVarOwner(jSaved);
-      LogicalResult res = loopUnrollJamUpToFactor(jLoop, J.getLiteral());
-      assert(succeeded(res) && "failed to optimize");
-    }
   }
 
   void genSimd(PatternRewriter &rewriter, KrnlMatMulOp op, Type elementType,
       ArrayRef<IndexExpr> aStart, ArrayRef<IndexExpr> bStart,
       ArrayRef<IndexExpr> cStart, IndexExpr I, IndexExpr J, IndexExpr K,
-      IndexExpr vectorLen, bool unrollJam) const {
-    // can simdize only if K is compile time
-    assert(J.isLiteral() &&
-           "can only simdize with compile time blocking factor on simd axis");
+      IndexExpr vectorLen, bool unrollJam, bool useTransfers) const {
     // Get operands.
     KrnlMatMulOpAdaptor operandAdaptor = KrnlMatMulOpAdaptor(op);
     Value A(operandAdaptor.A()), B(operandAdaptor.B()), C(operandAdaptor.C());
@@ -938,9 +1142,33 @@ private:
     // Generate the vector type conversions.
     int64_t VL = vectorLen.getLiteral();
     VectorType vecType = VectorType::get({VL}, elementType);
-    MemRefType CTmpType = MemRefType::get({}, vecType);
-    Value vecB = krnl_vector_type_cast(B, VL);
-    Value vecC = krnl_vector_type_cast(C, VL);
+    // With unroll and jam, the I rows are computed together, sharing the
+    // loads of B, with a temp vector per row.
+    bool jamRows = unrollJam && I.isLiteral();
+    int64_t numRows = jamRows ? I.getLiteral() : 1;
+    MemRefType CTmpType = MemRefType::get({numRows}, vecType);
+    Value vecB, vecC;
+    if (!useTransfers) {
+      vecB = krnl_vector_type_cast(B, VL);
+      vecC = krnl_vector_type_cast(C, VL);
+    }
+    // Load the vector of B or C at the given access, and store the vector of
+    // C.
+    auto loadVector = [&](Value memref, Value vecMemref,
+                          ArrayRef<Value> access) -> Value {
+      if (vecMemref)
+        return affine_load(vecMemref, access);
+      Type memElementType =
+          memref.getType().cast<MemRefType>().getElementType();
+      return rewriter.create<vector::TransferReadOp>(op.getLoc(),
+          VectorType::get({VL}, memElementType), memref, access);
+    };
+    auto storeVector = [&](Value vec, ArrayRef<Value> access) {
+      if (vecC)
+        affine_store(vec, vecC, access);
+      else
+        rewriter.create<vector::TransferWriteOp>(op.getLoc(), vec, C, access);
+    };
 
 #if DEBUG_MALLOC
 #if DEBUG_GLOBAL_ALLOC_FREE
@@ -957,105 +1185,98 @@ private:
     Value TmpC = memref_alloca(CTmpType, alignAttr);
 #endif
 
-    // Iterates over the I indices (j are simd dim).
-    Value iSaved;
+    // A partial tile along the simd dimension (J < VL) only updates the first
+    // J elements of the vectors of C, the others keeping their values. The
+    // whole vectors of B and C are still read, as the last dim of their
+    // memrefs is a multiple of the vector length, or their transfers are
+    // masked. The J elements are selected by a shuffle when J is a literal,
+    // with a mask otherwise.
+    Value jMask;
+    if (!J.isLiteral())
+      jMask = rewriter.create<vector::CreateMaskOp>(op.getLoc(),
+          VectorType::get({VL}, rewriter.getI1Type()),
+          ValueRange({J.getValue()}));
+    auto mergeIntoC = [&](Value tmpResults, ArrayRef<Value> cAccess) -> Value {
+      if (jMask)
+        return rewriter.create<SelectOp>(op.getLoc(), jMask, tmpResults,
+            loadVector(C, vecC, cAccess));
+      int64_t JLit = J.getLiteral();
+      if (JLit == VL)
+        return tmpResults;
+      // create vector constant
+      SmallVector<int64_t, 8> mask;
+      for (int64_t i = 0; i < VL; i++)
+        mask.emplace_back((i < JLit) ? i : VL + i);
+      // permute
+      Value originalCvec = loadVector(C, vecC, cAccess);
+      return rewriter.create<vector::ShuffleOp>(
+          op.getLoc(), tmpResults, originalCvec, mask);
+    };
+
+    // Compute the vectors of C(i) for the given rows i.
     using namespace edsc::op;
     LiteralIndexExpr zero(0);
-    // clang-format off
-    affineLoopBuilder(zero, I, 1, [&](Value i) {
-      iSaved = i; // Saved for unroll and jam.
-      // Alloca temp vector TmpC and save C(i)/0.0 into it.
-      AffineIndexedValue TTmpC(TmpC);
-      SmallVector<Value, 4> cAccess;
-      // cAccess = {i + cStart0.getValue(), cStart1.getValue()};
-      IndexExpr::getValues(cStart, cAccess);
-      cAccess[cRank-2] = i + cAccess[cRank-2];
-      TTmpC() = affine_load(vecC, cAccess);
+    auto genRows = [&](ArrayRef<Value> rows) {
+      int64_t numRowsToGen = rows.size();
+      // Save C(i) into its temp vector.
+      SmallVector<SmallVector<Value, 4>, 8> cAccesses;
+      SmallVector<Value, 8> tmpAccesses;
+      for (int64_t r = 0; r < numRowsToGen; ++r) {
+        // cAccess = {i + cStart0.getValue(), cStart1.getValue()};
+        SmallVector<Value, 4> cAccess;
+        IndexExpr::getValues(cStart, cAccess);
+        cAccess[cRank - 2] = rows[r] + cAccess[cRank - 2];
+        tmpAccesses.emplace_back(std_constant_index(r));
+        affine_store(loadVector(C, vecC, cAccess), TmpC, tmpAccesses[r]);
+        cAccesses.emplace_back(cAccess);
+      }
       // Sum over k.
       affineLoopBuilder(zero, K, 1, [&](Value k) {
-        // Value a = AA(i + aStart0.getValue(), k + aStart1.getValue());
-        SmallVector<Value, 4> aAccess, bAccess;
-        IndexExpr::getValues(aStart, aAccess);
-        aAccess[aRank-2] = i + aAccess[aRank-2];
-        aAccess[aRank-1] = k + aAccess[aRank-1];
-        Value a = affine_load(A, aAccess);
-        Value va = vector_broadcast(vecType, a);
         // bAccess = {k + bStart0.getValue(), bStart1.getValue()};
+        SmallVector<Value, 4> bAccess;
         IndexExpr::getValues(bStart, bAccess);
-        bAccess[bRank-2] = k + bAccess[bRank-2];
-        Value vb = affine_load(vecB, bAccess);
-        TTmpC() = vector_fma(va, vb, TTmpC());
+        bAccess[bRank - 2] = k + bAccess[bRank - 2];
+        Value vb = extendToAccumulator(
+            rewriter, op.getLoc(), loadVector(B, vecB, bAccess), elementType);
+        for (int64_t r = 0; r < numRowsToGen; ++r) {
+          // Value a = AA(i + aStart0.getValue(), k + aStart1.getValue());
+          SmallVector<Value, 4> aAccess;
+          IndexExpr::getValues(aStart, aAccess);
+          aAccess[aRank - 2] = rows[r] + aAccess[aRank - 2];
+          aAccess[aRank - 1] = k + aAccess[aRank - 1];
+          Value a = extendToAccumulator(
+              rewriter, op.getLoc(), affine_load(A, aAccess), elementType);
+          Value va = vector_broadcast(vecType, a);
+          Value vc = affine_load(TmpC, tmpAccesses[r]);
+          Value res = elementType.isa<FloatType>() ? vector_fma(va, vb, vc)
+                                                   : va * vb + vc;
+          affine_store(res, TmpC, tmpAccesses[r]);
+        }
       });
-      // Store temp result into C(i)
-      Value tmpResults = TTmpC();
-      int64_t JLit = J.getLiteral();
-      if (JLit != VL) {
-        // create vector constant
-        SmallVector<int64_t, 8> mask;
-        for(int64_t i=0; i<VL; i++)
-          mask.emplace_back((i<JLit) ? i : VL+i);
-        // permute
-        Value originalCvec = affine_load(vecC, cAccess);
-        tmpResults = rewriter.create<vector::ShuffleOp>(op.getLoc(),
-          tmpResults, originalCvec, mask);
+      // Store temp results into C(i).
+      for (int64_t r = 0; r < numRowsToGen; ++r) {
+        Value tmpResults =
+            mergeIntoC(affine_load(TmpC, tmpAccesses[r]), cAccesses[r]);
+        storeVector(tmpResults, cAccesses[r]);
       }
-      //CCvec(i + CStart0.getValue(), CStart1.getValue()) = tmpResults;
-      affine_store(tmpResults, vecC, cAccess);
-    });
+    };
+
+    // Iterates over the I indices (j are simd dim), unrolled and jammed if
+    // requested.
+    if (jamRows) {
+      SmallVector<Value, 8> rows;
+      for (int64_t r = 0; r < numRows; ++r)
+        rows.emplace_back(std_constant_index(r));
+      genRows(rows);
+    } else {
+      affineLoopBuilder(zero, I, 1, [&](Value i) { genRows({i}); });
+    }
 #if DEBUG_MALLOC
 #if DEBUG_GLOBAL_ALLOC_FREE
 #else
     rewriter.create<DeallocOp>(op.getLoc(), TmpC);
 #endif
 #endif
-
-    // clang-format on
-    if (false && unrollJam && I.isLiteral()) {
-      // Unroll and jam. Seems to support only one operation at this time.
-      auto iLoop = getForInductionVarOwner(iSaved);
-      LogicalResult res = loopUnrollJamUpToFactor(iLoop, I.getLiteral());
-      assert(succeeded(res) && "failed to optimize");
-    }
-  }
-
-  void genIfThenElseWithoutParams(PatternRewriter &rewriter,
-      SmallVectorImpl<IndexExpr> &conditions,
-      function_ref<void(ValueRange)> thenFn,
-      function_ref<void(ValueRange)> elseFn) const {
-
-    IndexExprScope &scope = IndexExprScope::getCurrentScope();
-    int64_t rank = conditions.size();
-    SmallVector<bool, 4> isEq(rank, false);
-    SmallVector<AffineExpr, 4> affineCond;
-    bool allTrue = true;
-    bool allFalse = true;
-    for (IndexExpr i : conditions) {
-      assert(i.isAffine() && "conditions expected to be affine");
-      affineCond.emplace_back(i.getAffineExpr());
-      if (i.isLiteral()) {
-        if (i.getLiteral() < 0) // Inequality is expr >= 0, test if false.
-          allTrue = false;
-        if (i.getLiteral() >= 0) // Inequality is expr >= 0, test if true.
-          allFalse = false;
-      } else {
-        allTrue = false;
-        allFalse = false;
-      }
-    }
-    auto inset = IntegerSet::get(
-        scope.getNumDims(), scope.getNumSymbols(), affineCond, isEq);
-    SmallVector<Value, 8> dimAndSymbolList;
-    scope.getDimAndSymbolList(dimAndSymbolList);
-    auto ifOp = rewriter.create<AffineIfOp>(
-        scope.getLoc(), inset, dimAndSymbolList, true);
-    Block *thenBlock = ifOp.getThenBlock();
-    Block *elseBlock = ifOp.getElseBlock();
-    if (!allFalse) {
-      appendToBlock(thenBlock, [&](ValueRange args) { thenFn(args); });
-    }
-    if (!allTrue) {
-      appendToBlock(elseBlock, [&](ValueRange args) { elseFn(args); });
-    }
   }
 };
 
@@ -1063,6 +1284,71 @@ private:
 // Krnl to Affine Rewrite Patterns: Krnl Copy to Buffer operation.
 //===----------------------------------------------------------------------===//
 
+// Number of bytes of the vectors of the copies to and from tile buffers.
+static const int64_t copyVectorBytes = 32;
+// Maximal vector length of the transposed copies, which transpose square
+// blocks of as many vectors.
+static const int64_t maxTransposedCopyVectorLen = 8;
+
+/// Vector length of the copies between a tile buffer and a memref, or 1 if the
+/// copies are scalar. Vectorized copies need integer or float elements,
+/// identity layouts, the innermost dimension of the buffer to be a multiple of
+/// the vector length, and also its other dimension for transposed copies, of
+/// 2-D buffers only. As the vectors span the rows of the buffer up to their
+/// end, the tile size, if any, must be the buffer size.
+static int64_t getCopyVectorLength(MemRefType buffType, MemRefType memType,
+    bool transpose, ArrayAttr tileSizeAttr) {
+  Type elementType = buffType.getElementType();
+  if (!elementType.isIntOrFloat() ||
+      elementType.getIntOrFloatBitWidth() % 8 != 0 ||
+      memType.getElementType() != elementType)
+    return 1;
+  if (!buffType.getAffineMaps().empty() || !memType.getAffineMaps().empty())
+    return 1;
+  ArrayRef<int64_t> buffShape = buffType.getShape();
+  int64_t buffRank = buffShape.size();
+  if (buffRank == 0)
+    return 1;
+  if (tileSizeAttr)
+    for (unsigned i = 0; i < tileSizeAttr.size(); ++i)
+      if (tileSizeAttr[i].cast<IntegerAttr>().getInt() != buffShape[i])
+        return 1;
+  int64_t VL = copyVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  if (transpose) {
+    VL = std::min(VL, maxTransposedCopyVectorLen);
+    if (buffRank != 2 || buffShape[0] % VL != 0)
+      return 1;
+  }
+  if (buffShape[buffRank - 1] % VL != 0)
+    return 1;
+  return VL;
+}
+
+/// Transpose the square block of vectors given by its rows. The rows are
+/// shuffled log2(VL) times, each time interleaving the halves of the block:
+/// row k with row k + VL/2. Each shuffle rotates the bits of the flat index
+/// of the elements by one, and log2(VL) of them swap its row and column bits.
+static void transposeVectors(SmallVectorImpl<Value> &vecs) {
+  OpBuilder &builder = ScopedContext::getBuilderRef();
+  Location loc = ScopedContext::getLocation();
+  int64_t VL = vecs.size();
+  SmallVector<int64_t, 16> loMask, hiMask;
+  for (int64_t i = 0; i < VL / 2; ++i) {
+    loMask.append({i, VL + i});
+    hiMask.append({VL / 2 + i, VL + VL / 2 + i});
+  }
+  for (int64_t stage = 1; stage < VL; stage *= 2) {
+    SmallVector<Value, 16> res;
+    for (int64_t k = 0; k < VL / 2; ++k) {
+      res.emplace_back(builder.create<vector::ShuffleOp>(
+          loc, vecs[k], vecs[k + VL / 2], loMask));
+      res.emplace_back(builder.create<vector::ShuffleOp>(
+          loc, vecs[k], vecs[k + VL / 2], hiMask));
+    }
+    vecs.assign(res.begin(), res.end());
+  }
+}
+
 class KrnlCopyToBufferLowering : public OpRewritePattern<KrnlCopyToBufferOp> {
 public:
   using OpRewritePattern<KrnlCopyToBufferOp>::OpRewritePattern;
@@ -1147,18 +1433,188 @@ public:
         bufferPadUBs.emplace_back(newPadUB);
       }
     }
+    // Offsets of the next tile to prefetch, if any. Transposed copies read
+    // the rows of the source along their outer loops and are not prefetched.
+    SmallVector<int64_t, 4> prefetchNext;
+    if (op.prefetchNextAttr() && !op.transpose())
+      for (Attribute offset : op.prefetchNextAttr())
+        prefetchNext.emplace_back(offset.cast<IntegerAttr>().getInt());
+
+    // Vectorize the copy along the innermost dimension of the buffer. The
+    // vectors are read with a mask when running out of the source, which
+    // yields the pad value.
+    MemRefType buffType = buffMemref.getType().cast<MemRefType>();
+    int64_t VL = getCopyVectorLength(buffType,
+        sourceMemref.getType().cast<MemRefType>(), op.transpose(),
+        op.tileSizeAttr());
+
     SmallVector<Value, 4> loopIndices;
-    genCopyLoops(buffMemref, sourceMemref, srcLoopMap, padVal, zero, starts,
-        bufferReadUBs, bufferPadUBs, loopIndices, 0, buffRank, false);
+    if (VL > 1 && op.transpose()) {
+      // The full tiles are copied by blocks of VL x VL elements, transposed
+      // by vector shuffles. The partial tiles keep the scalar copy.
+      SmallVector<IndexExpr, 2> fullTiles;
+      for (long buffIndex = 0; buffIndex < buffRank; ++buffIndex) {
+        long srcIndex = srcIndexMap[srcOffset + buffIndex];
+        fullTiles.emplace_back(isFullTile(sourceBounds.getSymbol(srcIndex),
+            buffBounds.getSymbol(buffIndex), starts[srcIndex]));
+      }
+      genIfThenElseWithoutParams(
+          rewriter, fullTiles,
+          /* then full */
+          [&](ValueRange) {
+            genTransposedVectorCopy(buffMemref, sourceMemref, padVal, starts,
+                buffType.getShape(), VL);
+          },
+          /* has partial tiles */
+          [&](ValueRange) {
+            genCopyLoops(buffMemref, sourceMemref, Value(), srcLoopMap,
+                padVal, zero, starts, bufferReadUBs, bufferPadUBs,
+                prefetchNext, loopIndices, 0, buffRank, false);
+          });
+      rewriter.eraseOp(op);
+      return success();
+    }
+    Value vecBuffMemref;
+    if (VL > 1)
+      vecBuffMemref = krnl_vector_type_cast(buffMemref, VL);
+    genCopyLoops(buffMemref, sourceMemref, vecBuffMemref, srcLoopMap, padVal,
+        zero, starts, bufferReadUBs, bufferPadUBs, prefetchNext, loopIndices,
+        0, buffRank, false);
     rewriter.eraseOp(op);
     return success();
   }
 
-  void genCopyLoops(Value buffMemref, Value sourceMemref,
+  // Copy a full tile of a 2-D buffer from the transposed source, by blocks of
+  // VL rows of the source read as vectors, and transposed into VL rows of the
+  // buffer.
+  void genTransposedVectorCopy(Value buffMemref, Value sourceMemref,
+      Value padVal, SmallVectorImpl<IndexExpr> &starts,
+      ArrayRef<int64_t> buffShape, int64_t VL) const {
+    OpBuilder &builder = ScopedContext::getBuilderRef();
+    Location loc = ScopedContext::getLocation();
+    VectorType vecType = VectorType::get({VL}, padVal.getType());
+    int64_t srcRank = starts.size();
+    AffineMap map =
+        AffineMap::getMinorIdentityMap(srcRank, 1, builder.getContext());
+    Value vecBuffMemref = krnl_vector_type_cast(buffMemref, VL);
+    LiteralIndexExpr zero(0), rows(buffShape[0]), vecCols(buffShape[1] / VL);
+    affineLoopBuilder(zero, rows, VL, [&](Value row) {
+      affineLoopBuilder(zero, vecCols, 1, [&](Value vecCol) {
+        IndexExprScope currScope;
+        DimIndexExpr i(row), j(vecCol);
+        SmallVector<IndexExpr, 4> currStarts;
+        getIndexExprList<DimIndexExpr>(starts, currStarts);
+        // Source rows j * VL + t, from column i, for the buffer columns.
+        SmallVector<Value, 8> vecs;
+        for (int64_t t = 0; t < VL; ++t) {
+          SmallVector<IndexExpr, 4> loadIndices(currStarts);
+          loadIndices[srcRank - 2] = currStarts[srcRank - 2] + j * VL + t;
+          loadIndices[srcRank - 1] = currStarts[srcRank - 1] + i;
+          SmallVector<Value, 4> loadIndexValues;
+          IndexExpr::getValues(loadIndices, loadIndexValues);
+          vecs.emplace_back(builder.create<vector::TransferReadOp>(loc,
+              vecType, sourceMemref, loadIndexValues, map, padVal,
+              ArrayAttr()));
+        }
+        transposeVectors(vecs);
+        for (int64_t u = 0; u < VL; ++u) {
+          IndexExpr buffRow = i + u;
+          affine_store(vecs[u], vecBuffMemref,
+              ValueRange({buffRow.getValue(), j.getValue()}));
+        }
+      });
+    });
+  }
+
+  // Copy the innermost dimension of the buffer by vectors, up to the pad
+  // upper bound if any, the read one otherwise. The last vector may run past
+  // them, into the part of the buffer which is not read.
+  void genVectorCopyLoop(Value sourceMemref, Value vecBuffMemref,
+      Value padVal, IndexExpr zero, SmallVectorImpl<IndexExpr> &starts,
+      IndexExpr readUB, IndexExpr padUB, SmallVectorImpl<Value> &loopIndices,
+      int64_t buffRank, bool padPhase) const {
+    bool read = !padPhase && !readUB.isLiteralAndIdenticalTo(0);
+    IndexExpr ub = padUB;
+    if (padUB.isLiteralAndIdenticalTo(0) && read)
+      ub = readUB;
+    if (ub.isLiteralAndIdenticalTo(0))
+      return;
+    OpBuilder &builder = ScopedContext::getBuilderRef();
+    Location loc = ScopedContext::getLocation();
+    VectorType vecType =
+        vecBuffMemref.getType().cast<MemRefType>().getElementType().cast<
+            VectorType>();
+    int64_t VL = vecType.getNumElements();
+    int64_t srcRank = starts.size();
+    int64_t srcOffset = srcRank - buffRank;
+    IndexExpr numVecs = ub.ceilDiv(LiteralIndexExpr(VL));
+    affineLoopBuilder(zero, numVecs, 1, [&](Value index) {
+      IndexExprScope currScope;
+      SmallVector<IndexExpr, 4> currLoopIndices, currStarts;
+      getIndexExprList<DimIndexExpr>(loopIndices, currLoopIndices);
+      DimIndexExpr vecIndex(index);
+      Value vec;
+      if (read) {
+        getIndexExprList<DimIndexExpr>(starts, currStarts);
+        SmallVector<IndexExpr, 4> loadIndices;
+        for (long srcIndex = 0; srcIndex < srcRank; ++srcIndex) {
+          int64_t buffIndex = srcIndex - srcOffset;
+          if (srcIndex < srcOffset)
+            loadIndices.emplace_back(currStarts[srcIndex]);
+          else if (buffIndex < buffRank - 1)
+            loadIndices.emplace_back(
+                currLoopIndices[buffIndex] + currStarts[srcIndex]);
+          else
+            loadIndices.emplace_back(vecIndex * VL + currStarts[srcIndex]);
+        }
+        SmallVector<Value, 4> loadIndexValues;
+        IndexExpr::getValues(loadIndices, loadIndexValues);
+        AffineMap map =
+            AffineMap::getMinorIdentityMap(srcRank, 1, builder.getContext());
+        vec = builder.create<vector::TransferReadOp>(loc, vecType,
+            sourceMemref, loadIndexValues, map, padVal, ArrayAttr());
+      } else {
+        vec = vector_broadcast(vecType, padVal);
+      }
+      currLoopIndices.emplace_back(vecIndex);
+      SmallVector<Value, 4> storeIndexValues;
+      IndexExpr::getValues(currLoopIndices, storeIndexValues);
+      affine_store(vec, vecBuffMemref, storeIndexValues);
+    });
+  }
+
+  // Prefetch the start of the row of the next tile matching the row of the
+  // current tile given by the outer loop indices. The prefetched location may
+  // be past the end of the source for the last tile, prefetches never fault.
+  void genPrefetch(Value sourceMemref, SmallVectorImpl<int64_t> &srcLoopMap,
+      SmallVectorImpl<IndexExpr> &starts, ArrayRef<int64_t> prefetchNext,
+      SmallVectorImpl<Value> &loopIndices, int64_t buffRank) const {
+    IndexExprScope currScope;
+    SmallVector<IndexExpr, 4> currLoopIndices, currStarts, prefetchIndices;
+    getIndexExprList<DimIndexExpr>(loopIndices, currLoopIndices);
+    getIndexExprList<DimIndexExpr>(starts, currStarts);
+    int64_t srcRank = starts.size();
+    int64_t srcOffset = srcRank - buffRank;
+    for (long srcIndex = 0; srcIndex < srcRank; ++srcIndex) {
+      IndexExpr index = currStarts[srcIndex] + prefetchNext[srcIndex];
+      // The innermost loop has not been generated yet, its index is zero.
+      if (srcIndex >= srcOffset) {
+        int64_t loopIndex = srcLoopMap[srcIndex - srcOffset];
+        if (loopIndex < (int64_t)currLoopIndices.size())
+          index = index + currLoopIndices[loopIndex];
+      }
+      prefetchIndices.emplace_back(index);
+    }
+    krnl_prefetch(sourceMemref, prefetchIndices, /*isWrite=*/false,
+        /*localityHint=*/3);
+  }
+
+  void genCopyLoops(Value buffMemref, Value sourceMemref, Value vecBuffMemref,
       SmallVectorImpl<int64_t> &srcLoopMap, Value padVal, IndexExpr zero,
       SmallVectorImpl<IndexExpr> &starts, SmallVectorImpl<IndexExpr> &readUBs,
-      SmallVectorImpl<IndexExpr> &padUBs, SmallVectorImpl<Value> &loopIndices,
-      int64_t i, int64_t buffRank, bool padPhase) const {
+      SmallVectorImpl<IndexExpr> &padUBs, ArrayRef<int64_t> prefetchNext,
+      SmallVectorImpl<Value> &loopIndices, int64_t i, int64_t buffRank,
+      bool padPhase) const {
     if (i == buffRank) {
       // create new scope and import index expressions
       IndexExprScope currScope;
@@ -1189,14 +1645,25 @@ public:
     } else {
       using namespace edsc::op;
       Value readUBVal = readUBs[i].getValue();
+      if (i == buffRank - 1 && !padPhase && !prefetchNext.empty() &&
+          !readUBs[i].isLiteralAndIdenticalTo(0))
+        genPrefetch(sourceMemref, srcLoopMap, starts, prefetchNext,
+            loopIndices, buffRank);
+      if (i == buffRank - 1 && vecBuffMemref) {
+        // Both the read and the padding of the innermost dimension.
+        genVectorCopyLoop(sourceMemref, vecBuffMemref, padVal, zero, starts,
+            readUBs[i], padUBs[i], loopIndices, buffRank, padPhase);
+        readUBs[i] = zero;
+        return;
+      }
       if (readUBs[i].isLiteralAndIdenticalTo(0)) {
         // Nothing to read, skip.
       } else {
         affineLoopBuilder(zero, readUBs[i], 1, [&](Value index) {
           loopIndices.emplace_back(index);
-          genCopyLoops(buffMemref, sourceMemref, srcLoopMap, padVal, zero,
-              starts, readUBs, padUBs, loopIndices, i + 1, buffRank,
-              /*no pad phase*/ false);
+          genCopyLoops(buffMemref, sourceMemref, vecBuffMemref, srcLoopMap,
+              padVal, zero, starts, readUBs, padUBs, prefetchNext, loopIndices,
+              i + 1, buffRank, /*no pad phase*/ false);
           loopIndices.pop_back_n(1);
         });
       }
@@ -1205,9 +1672,9 @@ public:
       } else {
         affineLoopBuilder(readUBs[i], padUBs[i], 1, [&](Value index) {
           loopIndices.emplace_back(index);
-          genCopyLoops(buffMemref, sourceMemref, srcLoopMap, padVal, zero,
-              starts, readUBs, padUBs, loopIndices, i + 1, buffRank,
-              /*pad phase*/ true);
+          genCopyLoops(buffMemref, sourceMemref, vecBuffMemref, srcLoopMap,
+              padVal, zero, starts, readUBs, padUBs, prefetchNext, loopIndices,
+              i + 1, buffRank, /*pad phase*/ true);
           loopIndices.pop_back_n(1);
         });
       }
@@ -1269,15 +1736,66 @@ public:
       bufferWrite.debugPrint("buffer wrote");
       bufferWriteUBs.emplace_back(bufferWrite);
     }
-    genCopyLoops(buffMemref, destMemref, zero, starts, bufferWriteUBs,
-        loopIndices, 0, buffRank);
+    // Vectorize the copy along the innermost dimension of the buffer. The
+    // vectors are written with a mask when running out of the destination.
+    Value vecBuffMemref;
+    int64_t VL = getCopyVectorLength(buffMemref.getType().cast<MemRefType>(),
+        destMemref.getType().cast<MemRefType>(), /*transpose=*/false,
+        op.tileSizeAttr());
+    if (VL > 1)
+      vecBuffMemref = krnl_vector_type_cast(buffMemref, VL);
+    genCopyLoops(buffMemref, destMemref, vecBuffMemref, zero, starts,
+        bufferWriteUBs, loopIndices, 0, buffRank);
     rewriter.eraseOp(op);
     return success();
   }
 
-  void genCopyLoops(Value buffMemref, Value destMemref, IndexExpr zero,
-      SmallVectorImpl<IndexExpr> &starts, SmallVectorImpl<IndexExpr> &writeUBs,
-      SmallVectorImpl<Value> &loopIndices, int64_t i, int64_t buffRank) const {
+  // Copy the innermost dimension of the buffer by vectors. The last vector
+  // may run past the write upper bound, only out of the destination.
+  void genVectorCopyLoop(Value destMemref, Value vecBuffMemref, IndexExpr zero,
+      SmallVectorImpl<IndexExpr> &starts, IndexExpr writeUB,
+      SmallVectorImpl<Value> &loopIndices, int64_t buffRank) const {
+    OpBuilder &builder = ScopedContext::getBuilderRef();
+    Location loc = ScopedContext::getLocation();
+    int64_t VL = vecBuffMemref.getType()
+                     .cast<MemRefType>()
+                     .getElementType()
+                     .cast<VectorType>()
+                     .getNumElements();
+    IndexExpr numVecs = writeUB.ceilDiv(LiteralIndexExpr(VL));
+    affineLoopBuilder(zero, numVecs, 1, [&](Value index) {
+      IndexExprScope currScope;
+      SmallVector<IndexExpr, 4> currLoopIndices, currStarts;
+      getIndexExprList<DimIndexExpr>(loopIndices, currLoopIndices);
+      getIndexExprList<SymbolIndexExpr>(starts, currStarts);
+      DimIndexExpr vecIndex(index);
+      int64_t destRank = starts.size();
+      int64_t destOffset = destRank - buffRank;
+      SmallVector<IndexExpr, 4> storeIndices;
+      for (long destIndex = 0; destIndex < destRank; ++destIndex) {
+        int64_t buffIndex = destIndex - destOffset;
+        if (destIndex < destOffset)
+          storeIndices.emplace_back(currStarts[destIndex]);
+        else if (buffIndex < buffRank - 1)
+          storeIndices.emplace_back(
+              currLoopIndices[buffIndex] + currStarts[destIndex]);
+        else
+          storeIndices.emplace_back(vecIndex * VL + currStarts[destIndex]);
+      }
+      currLoopIndices.emplace_back(vecIndex);
+      SmallVector<Value, 4> loadIndexValues, storeIndexValues;
+      IndexExpr::getValues(currLoopIndices, loadIndexValues);
+      IndexExpr::getValues(storeIndices, storeIndexValues);
+      Value vec = affine_load(vecBuffMemref, loadIndexValues);
+      builder.create<vector::TransferWriteOp>(
+          loc, vec, destMemref, storeIndexValues);
+    });
+  }
+
+  void genCopyLoops(Value buffMemref, Value destMemref, Value vecBuffMemref,
+      IndexExpr zero, SmallVectorImpl<IndexExpr> &starts,
+      SmallVectorImpl<IndexExpr> &writeUBs, SmallVectorImpl<Value> &loopIndices,
+      int64_t i, int64_t buffRank) const {
     if (i == buffRank) {
       // create new scope and import index expressions
       IndexExprScope currScope;
@@ -1305,12 +1823,15 @@ public:
       using namespace edsc::op;
       if (writeUBs[i].isLiteralAndIdenticalTo(0)) {
         // Nothing to write.
+      } else if (i == buffRank - 1 && vecBuffMemref) {
+        genVectorCopyLoop(destMemref, vecBuffMemref, zero, starts, writeUBs[i],
+            loopIndices, buffRank);
       } else {
         // Loop to copy the data.
         affineLoopBuilder(zero, writeUBs[i], 1, [&](Value index) {
           loopIndices.emplace_back(index);
-          genCopyLoops(buffMemref, destMemref, zero, starts, writeUBs,
-              loopIndices, i + 1, buffRank);
+          genCopyLoops(buffMemref, destMemref, vecBuffMemref, zero, starts,
+              writeUBs, loopIndices, i + 1, buffRank);
           loopIndices.pop_back_n(1);
         });
       }
@@ -1429,6 +1950,15 @@ void ConvertKrnlToAffinePass::runOnFunction() {
   // Move loop body under appropriate newly created affine loops.
   mover.moveAll(loopRefToOp);
 
+  // Convert the loops marked by krnl.parallel into affine.parallel loops.
+  SmallVector<AffineForOp, 4> loopsToParallelize;
+  funcOp.walk([&](AffineForOp forOp) {
+    if (forOp->hasAttr(PARALLEL_LOOP_ATTR))
+      loopsToParallelize.emplace_back(forOp);
+  });
+  for (AffineForOp forOp : loopsToParallelize)
+    convertToParallelLoop(forOp);
+
   ConversionTarget target(getContext());
   // Legal/illegal ops.
   target.addIllegalOp<KrnlTerminatorOp>();
@@ -1440,7 +1970,10 @@ void ConvertKrnlToAffinePass::runOnFunction() {
   target.addLegalOp<AffineYieldOp>();
   target.addLegalOp<AffineLoadOp>();
   target.addLegalOp<AffineStoreOp>();
+  target.addLegalOp<AffinePrefetchOp>();
   target.addLegalOp<KrnlVectorTypeCastOp>();
+  target.addLegalOp<KrnlMatMulMicroKernelOp>();
+  target.addLegalOp<KrnlSgemmOp>();
   target.addLegalDialect<mlir::AffineDialect, mlir::memref::MemRefDialect,
       mlir::StandardOpsDialect, mlir::vector::VectorDialect>();
   // Patterns.
@@ -1448,7 +1981,8 @@ void ConvertKrnlToAffinePass::runOnFunction() {
   patterns.insert<KrnlTerminatorLowering>(&getContext());
   patterns.insert<KrnlLoadLowering>(&getContext());
   patterns.insert<KrnlStoreLowering>(&getContext());
-  patterns.insert<KrnlMatmulLowering>(&getContext());
+  patterns.insert<KrnlPrefetchLowering>(&getContext());
+  patterns.insert<KrnlMatmulLowering>(&getContext(), matMulMicroKernels);
   patterns.insert<KrnlCopyToBufferLowering>(&getContext());
   patterns.insert<KrnlCopyFromBufferLowering>(&getContext());
 
@@ -1460,6 +1994,7 @@ void ConvertKrnlToAffinePass::runOnFunction() {
 
 } // namespace
 
-std::unique_ptr<Pass> mlir::createConvertKrnlToAffinePass() {
-  return std::make_unique<ConvertKrnlToAffinePass>();
+std::unique_ptr<Pass> mlir::createConvertKrnlToAffinePass(
+    bool matMulMicroKernels) {
+  return std::make_unique<ConvertKrnlToAffinePass>(matMulMicroKernels);
 }
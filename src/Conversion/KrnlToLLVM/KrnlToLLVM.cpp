@@ -13,22 +13,34 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
+#include "mlir/Conversion/OpenMPToLLVM/ConvertOpenMPToLLVM.h"
 #include "mlir/Conversion/SCFToStandard/SCFToStandard.h"
 #include "mlir/Conversion/ShapeToStandard/ShapeToStandard.h"
 #include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
 #include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVM.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/OpenMP/OpenMPDialect.h"
 #include "mlir/Dialect/SCF/SCF.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/Dialect/StandardOps/Transforms/Passes.h"
 #include "mlir/Dialect/Vector/VectorOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Interfaces/ControlFlowInterfaces.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Target/LLVMIR/ModuleTranslation.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "mlir/Transforms/RegionUtils.h"
 #include "onnx/onnx_pb.h"
 #include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
 
 #include "src/Conversion/KrnlToLLVM/KrnlToLLVM.hpp"
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
@@ -39,6 +51,46 @@ using namespace mlir;
 
 namespace {
 
+// Constants larger than this many bytes are written to the weights file when
+// there is one. They are stored at offsets aligned to weightsAlignment.
+static const int64_t weightsFileMinBytes = 512;
+static const int64_t weightsAlignment = 64;
+// Name of the global holding the address at which the runtime maps the
+// weights file, and of the attribute of the offsets of the Krnl globals in it.
+static const char *weightsGlobalName = "_weights";
+static const char *weightsOffsetAttrName = "weights_offset";
+// Attribute of the _weights global giving the size of the weights file when
+// the weights are read from their replica on the local NUMA node.
+static const char *weightsNumaSizeAttrName = "numa_size";
+// Header of the compressed weights files, read by omWeightsLoad: the magic,
+// the width of the byte planes, the size of the weights and the size of the
+// compressed data, then padding. See OMWeights.c for the format of the data.
+static const char *compressedWeightsMagic = "OMWZ";
+static const uint64_t compressedWeightsHeaderSize = 32;
+static const uint64_t compressedWeightsWidth = 4;
+
+// Argument attribute of the LLVM functions for noalias pointers.
+static const char *noAliasAttrName = "llvm.noalias";
+
+// Name of the global holding the base of the arena identifiers of a library,
+// reserved at run time by omArenaReserveIds, and of its attribute giving the
+// number of identifiers of the library.
+static const char *arenaIdBaseGlobalName = "_arena_id_base";
+static const char *arenaNumIdsAttrName = "num_ids";
+
+// How the entry points pass the OMTensor of an input to the entry point
+// function, recorded by analyzeInputLayouts.
+enum class InputLayout : int64_t {
+  // The input is passed with its strides, which the function reads from the
+  // descriptor, or which do not matter since the function only returns it.
+  Strided = 0,
+  // A contiguous copy of the input is passed when its strides are not dense.
+  Contiguous = 1,
+  // The input may be viewed by an output, which would outlive a copy, and is
+  // rejected when its strides are not dense.
+  Dense = 2,
+};
+
 static onnx::TensorProto::DataType llvmTypeToOnnxType(mlir::Type elemType) {
   if (elemType.isa<Float32Type>())
     return onnx::TensorProto::FLOAT;
@@ -57,6 +109,8 @@ static onnx::TensorProto::DataType llvmTypeToOnnxType(mlir::Type elemType) {
   // TODO, wait for Tong's input about how string is represented in MLIR.
   if (elemType.isa<Float16Type>())
     return onnx::TensorProto::FLOAT16;
+  if (elemType.isa<BFloat16Type>())
+    return onnx::TensorProto::BFLOAT16;
   if (elemType.isa<Float64Type>())
     return onnx::TensorProto::DOUBLE;
   if (elemType.isUnsignedInteger(32))
@@ -82,7 +136,7 @@ static onnx::TensorProto::DataType llvmTypeToOnnxType(mlir::Type elemType) {
 }
 
 static FlatSymbolRefAttr getOrInsertExternFunc(StringRef funcName,
-    ModuleOp module, mlir::Type funcType, PatternRewriter &rewriter) {
+    ModuleOp module, mlir::Type funcType, OpBuilder &rewriter) {
   auto *context = module.getContext();
   if (auto sym = module.lookupSymbol<LLVM::LLVMFuncOp>(funcName)) {
     assert(sym.getType() == funcType && "wrong symbol type");
@@ -90,7 +144,7 @@ static FlatSymbolRefAttr getOrInsertExternFunc(StringRef funcName,
   }
 
   // Insert the function into the body of the parent module.
-  PatternRewriter::InsertionGuard insertGuard(rewriter);
+  OpBuilder::InsertionGuard insertGuard(rewriter);
   rewriter.setInsertionPointToStart(module.getBody());
   rewriter.create<LLVM::LLVMFuncOp>(module.getLoc(), funcName, funcType);
   return SymbolRefAttr::get(context, funcName);
@@ -334,6 +388,31 @@ private:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlStrideOpLowering
+//===----------------------------------------------------------------------===//
+
+class KrnlStrideOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlStrideOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(
+            KrnlStrideOp::getOperationName(), context, lowering_) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    KrnlStrideOp strideOp = llvm::cast<KrnlStrideOp>(op);
+    KrnlStrideOpAdaptor operandAdaptor(operands);
+
+    // The stride is read from the descriptor, whatever the type of the
+    // MemRef tells of it.
+    MemRefDescriptor memRefDescriptor(operandAdaptor.memref());
+    rewriter.replaceOp(op, {memRefDescriptor.stride(rewriter, op->getLoc(),
+                               strideOp.index())});
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // KRNL to LLVM: KrnlGlobalOpLowering
 //===----------------------------------------------------------------------===//
@@ -375,6 +454,46 @@ public:
         typeConverter->convertType(memRefTy.getElementType());
     auto globalType = constantElementType;
 
+    // The constants moved to the weights file are addressed in the buffer the
+    // runtime maps at _weights, or in its replica on the local NUMA node. The
+    // file is aligned enough for any alignment of the global.
+    if (auto offsetAttr =
+            op->getAttrOfType<IntegerAttr>(weightsOffsetAttrName)) {
+      auto weightsGlobal =
+          module.lookupSymbol<LLVM::GlobalOp>(weightsGlobalName);
+      auto llvmI8PtrTy =
+          LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+      Value weights = rewriter.create<LLVM::LoadOp>(
+          loc, rewriter.create<LLVM::AddressOfOp>(loc, weightsGlobal));
+      auto numaSizeAttr =
+          weightsGlobal->getAttrOfType<IntegerAttr>(weightsNumaSizeAttrName);
+      if (numaSizeAttr) {
+        auto llvmI64Ty = IntegerType::get(context, 64);
+        auto replicaRef = getOrInsertExternFunc("omNumaGetLocalReplica",
+            module,
+            LLVM::LLVMFunctionType::get(llvmI8PtrTy,
+                ArrayRef<Type>({llvmI8PtrTy, llvmI64Ty}), /*isVarArg=*/false),
+            rewriter);
+        Value size =
+            rewriter.create<LLVM::ConstantOp>(loc, llvmI64Ty, numaSizeAttr);
+        weights = rewriter
+                      .create<LLVM::CallOp>(loc, llvmI8PtrTy, replicaRef,
+                          ArrayRef<Value>({weights, size}))
+                      .getResult(0);
+      }
+      Value offset = rewriter.create<LLVM::ConstantOp>(
+          loc, IntegerType::get(context, 64), offsetAttr);
+      Value weightPtr = rewriter.create<LLVM::GEPOp>(
+          loc, llvmI8PtrTy, weights, ArrayRef<Value>({offset}));
+      Value typedWeights = rewriter.create<LLVM::BitcastOp>(loc,
+          LLVM::LLVMPointerType::get(constantElementType.cast<Type>()),
+          weightPtr);
+      auto llvmMemRef = MemRefDescriptor::fromStaticShape(
+          rewriter, loc, *getTypeConverter(), memRefTy, typedWeights);
+      rewriter.replaceOp(op, {llvmMemRef});
+      return success();
+    }
+
     // The llvm type of the global (example: [2 x [8 x float]])
     if (shape.empty()) {
       globalType = LLVM::LLVMArrayType::get(globalType.cast<Type>(), 1);
@@ -385,17 +504,30 @@ public:
     }
     auto llvmGlobalType = globalType.cast<Type>();
 
-    if (!krnlGlobalOp.value().hasValue())
+    if (!krnlGlobalOp.value().hasValue() && !hasExternalData(op))
       llvm_unreachable("Krnl Global must always have a value");
 
     int64_t sizeInBytes = numElements * getMemRefEltSizeInBytes(memRefTy);
-    {
+    // The Krnl globals with the same name have values with the same bytes,
+    // see DeduplicateKrnlGlobals.cpp, and share the global of the first one,
+    // whatever its type.
+    global = module.lookupSymbol<LLVM::GlobalOp>(name);
+    if (!global) {
       OpBuilder::InsertionGuard insertGuard(rewriter);
       rewriter.setInsertionPointToStart(module.getBody());
 
       auto llvmArrayI8Ty =
           LLVM::LLVMArrayType::get(IntegerType::get(context, 8), sizeInBytes);
-      if (krnlGlobalOp.value().getValue().isa<OpaqueElementsAttr>()) {
+      if (hasExternalData(op)) {
+        // The external data is only read now, straight into the global.
+        std::unique_ptr<llvm::MemoryBuffer> data =
+            loadExternalData(op, sizeInBytes);
+        if (!data)
+          return failure();
+        StringAttr llvmStringAttr = StringAttr::get(context, data->getBuffer());
+        global = rewriter.create<LLVM::GlobalOp>(loc, llvmArrayI8Ty,
+            /*isConstant=*/true, LLVM::Linkage::Internal, name, llvmStringAttr);
+      } else if (krnlGlobalOp.value().getValue().isa<OpaqueElementsAttr>()) {
         // LLVM::GlobalOp does not support OpaqueElementsAttr.
         // Both StringAttr and OpaqueElementsAttr use StringRef for internal
         // data array. Thus, it looks safe to use StringAtrr instead of
@@ -501,6 +633,207 @@ private:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlArenaOpLowering
+//===----------------------------------------------------------------------===//
+
+/// Return the identifier of a memory arena at run time. The identifiers of a
+/// library are offset by the base it reserves on its first call, so that the
+/// libraries loaded in one process do not share their arenas.
+static Value getArenaId(
+    OpBuilder &builder, Location loc, ModuleOp module, int64_t id) {
+  auto llvmI64Ty = IntegerType::get(module.getContext(), 64);
+  Value arenaId = builder.create<LLVM::ConstantOp>(
+      loc, llvmI64Ty, builder.getI64IntegerAttr(id));
+  auto baseGlobal = module.lookupSymbol<LLVM::GlobalOp>(arenaIdBaseGlobalName);
+  if (!baseGlobal)
+    return arenaId;
+
+  // Declare the runtime function, its signature is:
+  //   * `i64 (i64*, i64)`
+  auto reserveIdsRef = getOrInsertExternFunc("omArenaReserveIds", module,
+      LLVM::LLVMFunctionType::get(llvmI64Ty,
+          ArrayRef<Type>({LLVM::LLVMPointerType::get(llvmI64Ty), llvmI64Ty}),
+          /*isVarArg=*/false),
+      builder);
+  Value baseAddr = builder.create<LLVM::AddressOfOp>(loc, baseGlobal);
+  Value numIds = builder.create<LLVM::ConstantOp>(
+      loc, llvmI64Ty, baseGlobal->getAttr(arenaNumIdsAttrName));
+  Value base = builder
+                   .create<LLVM::CallOp>(loc, llvmI64Ty, reserveIdsRef,
+                       ArrayRef<Value>({baseAddr, numIds}))
+                   .getResult(0);
+  return builder.create<LLVM::AddOp>(loc, llvmI64Ty, base, arenaId);
+}
+
+class KrnlArenaOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlArenaOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(
+            KrnlArenaOp::getOperationName(), context, lowering_) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto *context = op->getContext();
+    auto loc = op->getLoc();
+    auto arenaOp = llvm::dyn_cast<KrnlArenaOp>(op);
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+
+    KrnlArenaOpAdaptor operandAdaptor(operands);
+    auto memRefTy = op->getResult(0).getType().cast<mlir::MemRefType>();
+    auto llvmElementType =
+        typeConverter->convertType(memRefTy.getElementType());
+    int64_t alignment = 0;
+    if (arenaOp.alignmentAttr())
+      alignment = arenaOp.alignmentAttr().getValue().getSExtValue();
+
+    // Declare the runtime function, its signature is:
+    //   * `i8* (i64, i64, i64, i32)`
+    auto llvmI8PtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+    auto llvmI32Ty = IntegerType::get(context, 32);
+    auto llvmI64Ty = IntegerType::get(context, 64);
+    auto arenaGetRef = getOrInsertExternFunc(
+        arenaOp.zeroInit() ? "omArenaGetZeroed" : "omArenaGet", module,
+        LLVM::LLVMFunctionType::get(llvmI8PtrTy,
+            ArrayRef<Type>({llvmI64Ty, llvmI64Ty, llvmI64Ty, llvmI32Ty}),
+            /*isVarArg=*/false),
+        rewriter);
+
+    // Get the buffer of the arena.
+    Value id = getArenaId(rewriter, loc, module, arenaOp.id());
+    // Dynamic pools are 1-D MemRefs of bytes whose size is given by the
+    // operand, the runtime keeps the largest buffer requested so far.
+    Value size = operandAdaptor.size();
+    if (!size) {
+      int64_t sizeInBytes =
+          memRefTy.getNumElements() * getMemRefEltSizeInBytes(memRefTy);
+      size = rewriter.create<LLVM::ConstantOp>(
+          loc, llvmI64Ty, rewriter.getI64IntegerAttr(sizeInBytes));
+    }
+    auto align = rewriter.create<LLVM::ConstantOp>(
+        loc, llvmI64Ty, rewriter.getI64IntegerAttr(alignment));
+    auto threadLocal = rewriter.create<LLVM::ConstantOp>(
+        loc, llvmI32Ty, rewriter.getI32IntegerAttr(arenaOp.threadLocal()));
+    Value buffer = rewriter
+                       .create<LLVM::CallOp>(loc, llvmI8PtrTy, arenaGetRef,
+                           ArrayRef<Value>({id, size, align, threadLocal}))
+                       .getResult(0);
+    Value typedBuffer = rewriter.create<LLVM::BitcastOp>(
+        loc, LLVM::LLVMPointerType::get(llvmElementType), buffer);
+
+    // Create llvm MemRef from original MemRef and fill the data pointers.
+    if (memRefTy.hasStaticShape()) {
+      auto llvmMemRef = MemRefDescriptor::fromStaticShape(
+          rewriter, loc, *getTypeConverter(), memRefTy, typedBuffer);
+      rewriter.replaceOp(op, {llvmMemRef});
+      return success();
+    }
+    auto llvmMemRef = MemRefDescriptor::undef(
+        rewriter, loc, typeConverter->convertType(memRefTy));
+    llvmMemRef.setAllocatedPtr(rewriter, loc, typedBuffer);
+    llvmMemRef.setAlignedPtr(rewriter, loc, typedBuffer);
+    llvmMemRef.setConstantOffset(rewriter, loc, 0);
+    llvmMemRef.setSize(rewriter, loc, 0, size);
+    llvmMemRef.setConstantStride(rewriter, loc, 0, 1);
+    rewriter.replaceOp(op, {llvmMemRef});
+    return success();
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlInstrumentOpLowering
+//===----------------------------------------------------------------------===//
+
+class KrnlInstrumentOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlInstrumentOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(
+            KrnlInstrumentOp::getOperationName(), context, lowering_) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto *context = op->getContext();
+    auto loc = op->getLoc();
+    auto instrumentOp = llvm::dyn_cast<KrnlInstrumentOp>(op);
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+
+    // Declare the runtime function, its signature is:
+    //   * `void (i8*, i8*, i64, i64)`
+    auto llvmI8PtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+    auto llvmI64Ty = IntegerType::get(context, 64);
+    auto instrumentRef = getOrInsertExternFunc("omInstrumentPoint", module,
+        LLVM::LLVMFunctionType::get(LLVM::LLVMVoidType::get(context),
+            ArrayRef<Type>({llvmI8PtrTy, llvmI8PtrTy, llvmI64Ty, llvmI64Ty}),
+            /*isVarArg=*/false),
+        rewriter);
+
+    Value opName = getOrCreateString(
+        rewriter, module, loc, "_instrument_op_", instrumentOp.opName());
+    Value nodeName = getOrCreateString(
+        rewriter, module, loc, "_instrument_node_", instrumentOp.nodeName());
+    Value tag = rewriter.create<LLVM::ConstantOp>(
+        loc, llvmI64Ty, rewriter.getI64IntegerAttr(instrumentOp.tag()));
+
+    // Sum the sizes in bytes of the outputs, from their original MemRef
+    // types when their shapes are static, from their descriptors otherwise.
+    int64_t staticBytes = 0;
+    Value dynamicBytes;
+    for (unsigned i = 0; i < operands.size(); ++i) {
+      auto memRefTy = op->getOperand(i).getType().dyn_cast<MemRefType>();
+      if (!memRefTy)
+        continue;
+      int64_t eltSize = getMemRefEltSizeInBytes(memRefTy);
+      if (memRefTy.hasStaticShape()) {
+        staticBytes += memRefTy.getNumElements() * eltSize;
+        continue;
+      }
+      MemRefDescriptor descriptor(operands[i]);
+      Value bytes = rewriter.create<LLVM::ConstantOp>(
+          loc, llvmI64Ty, rewriter.getI64IntegerAttr(eltSize));
+      for (int64_t d = 0; d < memRefTy.getRank(); ++d)
+        bytes = rewriter.create<LLVM::MulOp>(
+            loc, bytes, descriptor.size(rewriter, loc, d));
+      if (dynamicBytes)
+        bytes = rewriter.create<LLVM::AddOp>(loc, dynamicBytes, bytes);
+      dynamicBytes = bytes;
+    }
+    Value bytes = rewriter.create<LLVM::ConstantOp>(
+        loc, llvmI64Ty, rewriter.getI64IntegerAttr(staticBytes));
+    if (dynamicBytes)
+      bytes = rewriter.create<LLVM::AddOp>(loc, bytes, dynamicBytes);
+
+    rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}), instrumentRef,
+        ArrayRef<Value>({opName, nodeName, tag, bytes}));
+    rewriter.eraseOp(op);
+    return success();
+  }
+
+private:
+  // Return a pointer to a NUL terminated copy of the string, held by an
+  // internal global shared by all the instrumentation points.
+  static Value getOrCreateString(PatternRewriter &rewriter, ModuleOp module,
+      Location loc, StringRef prefix, StringRef str) {
+    auto *context = module.getContext();
+    std::string name = (prefix + str).str();
+    auto global = module.lookupSymbol<LLVM::GlobalOp>(name);
+    if (!global) {
+      OpBuilder::InsertionGuard guard(rewriter);
+      rewriter.setInsertionPointToStart(module.getBody());
+      std::string value = (str + StringRef("\0", 1)).str();
+      auto arrayTy =
+          LLVM::LLVMArrayType::get(IntegerType::get(context, 8), value.size());
+      global = rewriter.create<LLVM::GlobalOp>(loc, arrayTy,
+          /*isConstant=*/true, LLVM::Linkage::Internal, name,
+          rewriter.getStringAttr(value));
+    }
+    Value address = rewriter.create<LLVM::AddressOfOp>(loc, global);
+    return rewriter.create<LLVM::BitcastOp>(loc,
+        LLVM::LLVMPointerType::get(IntegerType::get(context, 8)), address);
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // KRNL to LLVM: KrnlMemcpyOpLowering
 //===----------------------------------------------------------------------===//
@@ -520,27 +853,26 @@ public:
     ModuleOp parentModule = op->getParentOfType<ModuleOp>();
     auto memcpyRef = getOrInsertMemcpy(rewriter, parentModule);
 
+    // The memory of a memref starts at its aligned pointer advanced by its
+    // offset, which is non-zero for views such as subviews.
+    auto getInt8PtrToMemory = [&](Value memref) -> Value {
+      Type ptrType =
+          memref.getType().cast<LLVM::LLVMStructType>().getBody()[1];
+      Value alignedMemory = rewriter.create<LLVM::ExtractValueOp>(
+          loc, ptrType, memref, rewriter.getI64ArrayAttr(1));
+      Value offset = rewriter.create<LLVM::ExtractValueOp>(loc,
+          IntegerType::get(context, 64), memref, rewriter.getI64ArrayAttr(2));
+      Value memory = rewriter.create<LLVM::GEPOp>(
+          loc, ptrType, alignedMemory, ArrayRef<Value>({offset}));
+      return rewriter.create<LLVM::BitcastOp>(loc,
+          LLVM::LLVMPointerType::get(IntegerType::get(context, 8)), memory);
+    };
+
     // First operand.
-    Type dstType = operandAdaptor.dest()
-                       .getType()
-                       .cast<LLVM::LLVMStructType>()
-                       .getBody()[1];
-    Value alignedDstMemory = rewriter.create<LLVM::ExtractValueOp>(
-        loc, dstType, operandAdaptor.dest(), rewriter.getI64ArrayAttr(1));
-    Value alignedInt8PtrDstMemory = rewriter.create<LLVM::BitcastOp>(loc,
-        LLVM::LLVMPointerType::get(IntegerType::get(context, 8)),
-        alignedDstMemory);
+    Value alignedInt8PtrDstMemory = getInt8PtrToMemory(operandAdaptor.dest());
 
     // Second operand.
-    Type srcType = operandAdaptor.src()
-                       .getType()
-                       .cast<LLVM::LLVMStructType>()
-                       .getBody()[1];
-    Value alignedSrcMemory = rewriter.create<LLVM::ExtractValueOp>(
-        loc, srcType, operandAdaptor.src(), rewriter.getI64ArrayAttr(1));
-    Value alignedInt8PtrSrcMemory = rewriter.create<LLVM::BitcastOp>(loc,
-        LLVM::LLVMPointerType::get(IntegerType::get(context, 8)),
-        alignedSrcMemory);
+    Value alignedInt8PtrSrcMemory = getInt8PtrToMemory(operandAdaptor.src());
 
     // Size.
     Value int64Size = rewriter.create<LLVM::SExtOp>(
@@ -710,6 +1042,13 @@ public:
     SET_DATA_TYPE,
     GET_DATA_TYPE,
     GET_OMT_ARRAY,
+    GET_OMT_LIST_SIZE,
+    GET_RANK,
+    GET_BUFFER_SIZE,
+    CHECK_SIGNATURE,
+    IS_CONTIGUOUS,
+    GET_CONTIGUOUS,
+    RELEASE_CONTIGUOUS,
   };
 
   struct ApiSpec {
@@ -753,6 +1092,25 @@ public:
     rewriter.create<ReturnOp>(UnknownLoc::get(context), results);
   }
 
+  // Emit the binary signature table in a global, and the function returning
+  // its address.
+  static LLVM::GlobalOp genSignatureTable(PatternRewriter &rewriter,
+      MLIRContext *context, std::string globalName, std::string funcName,
+      ArrayAttr tableAttr, Location loc) {
+    SmallVector<int64_t, 16> table;
+    for (Attribute attr : tableAttr)
+      table.emplace_back(attr.cast<IntegerAttr>().getInt());
+    auto int64Ty = IntegerType::get(context, 64);
+    auto tableTy = LLVM::LLVMArrayType::get(int64Ty, table.size());
+    auto tableValue = DenseElementsAttr::get(
+        RankedTensorType::get({(int64_t)table.size()}, int64Ty),
+        llvm::makeArrayRef(table));
+    auto global = rewriter.create<LLVM::GlobalOp>(loc, tableTy,
+        /*isConstant=*/true, LLVM::Linkage::Internal, globalName, tableValue);
+    genSignatureFunction(rewriter, context, funcName, global, loc);
+    return global;
+  }
+
   LogicalResult matchAndRewrite(
       KrnlEntryPointOp op, PatternRewriter &rewriter) const override {
 
@@ -778,19 +1136,55 @@ public:
     mlir::StringAttr inSigAttr = mlir::StringAttr::get(context, inSig);
     mlir::StringAttr outSigAttr = mlir::StringAttr::get(context, outSig);
 
+    // The signatures of the entry point of main_graph, or of the only entry
+    // point, are returned by omInputSignature and omOutputSignature, those of
+    // the other entry points of a library with several models by
+    // omInputSignature_<func> and omOutputSignature_<func>.
+    StringRef funcName = op->getAttrOfType<SymbolRefAttr>(
+                               KrnlEntryPointOp::getEntryPointFuncAttrName())
+                             .getLeafReference();
+    unsigned numEntryPoints = 0;
+    module.walk([&](KrnlEntryPointOp) { numEntryPoints++; });
+    std::string sigSuffix = "";
+    if (numEntryPoints > 1 && funcName != "main_graph")
+      sigSuffix = ("_" + funcName).str();
+
     auto inSigArrayType =
         LLVM::LLVMArrayType::get(IntegerType::get(context, 8), inSig.size());
     auto insig = rewriter.create<LLVM::GlobalOp>(loc, inSigArrayType,
-        /*isConstant=*/true, LLVM::Linkage::External, "_in_signature",
-        inSigAttr);
+        /*isConstant=*/true, LLVM::Linkage::Internal,
+        "_in_signature" + sigSuffix, inSigAttr);
 
     auto outSigArrayType =
         LLVM::LLVMArrayType::get(IntegerType::get(context, 8), outSig.size());
     auto outsig = rewriter.create<LLVM::GlobalOp>(loc, outSigArrayType,
-        /*isConstant=*/true, LLVM::Linkage::External, "_out_signature",
-        outSigAttr);
-    genSignatureFunction(rewriter, context, "omInputSignature", insig, loc);
-    genSignatureFunction(rewriter, context, "omOutputSignature", outsig, loc);
+        /*isConstant=*/true, LLVM::Linkage::Internal,
+        "_out_signature" + sigSuffix, outSigAttr);
+    genSignatureFunction(
+        rewriter, context, "omInputSignature" + sigSuffix, insig, loc);
+    genSignatureFunction(
+        rewriter, context, "omOutputSignature" + sigSuffix, outsig, loc);
+
+    // The binary signature tables, recorded before the types of the function
+    // were lowered, are returned by omInputSignatureTable and
+    // omOutputSignatureTable. The inputs are checked against their table
+    // before the model is run.
+    LLVM::GlobalOp inTable;
+    auto inTableAttr = op->getAttrOfType<ArrayAttr>(
+        KrnlEntryPointOp::getInputSignatureTableAttrName());
+    auto outTableAttr = op->getAttrOfType<ArrayAttr>(
+        KrnlEntryPointOp::getOutputSignatureTableAttrName());
+    if (inTableAttr && outTableAttr) {
+      inTable = genSignatureTable(rewriter, context,
+          "_in_signature_table" + sigSuffix,
+          "omInputSignatureTable" + sigSuffix, inTableAttr, loc);
+      genSignatureTable(rewriter, context, "_out_signature_table" + sigSuffix,
+          "omOutputSignatureTable" + sigSuffix, outTableAttr, loc);
+    }
+    // The inputs of the unchecked entry points are trusted to match the
+    // signature, which is still exported.
+    if (op->getAttr(KrnlEntryPointOp::getUncheckedAttrName()))
+      inTable = LLVM::GlobalOp();
 
     // Rewrite Krnl Entry Point Operation to an LLVM function with a dynamic
     // signature. The signature is dynamic because it remains the same no matter
@@ -806,15 +1200,55 @@ public:
     auto dynEntryPointName = "run_" + staticEntryPointFuncName;
     assert(module.lookupSymbol(dynEntryPointName.str()) == nullptr &&
            "dynamic entry point name is not unique");
+    // The entry point functions specialized for some input shapes, if any.
+    auto specializations = op->getAttrOfType<ArrayAttr>(
+        KrnlEntryPointOp::getSpecializationsAttrName());
+    // Whether the OMTensor of each output owns its buffer, all of them if
+    // the ownership was not analyzed.
+    auto outputOwning = op->getAttrOfType<ArrayAttr>(
+        KrnlEntryPointOp::getOutputOwningAttrName());
+    // Whether the buffer of each owning output may instead be the buffer of
+    // an input, e.g. of a cache appended in place.
+    auto outputMayViewInput = op->getAttrOfType<ArrayAttr>(
+        KrnlEntryPointOp::getOutputMayViewInputAttrName());
+    // How each input is passed when its strides are not dense.
+    auto inputLayouts = op->getAttrOfType<ArrayAttr>(
+        KrnlEntryPointOp::getInputLayoutsAttrName());
+    // The entry point of a batch-separable model runs the whole inputs it is
+    // given with run_<func>_unsplit, called by the runtime on each chunk of
+    // the batch.
+    bool batchSeparable =
+        op->getAttr(KrnlEntryPointOp::getBatchSeparableAttrName()) != nullptr;
+    std::string runName = dynEntryPointName.str();
+    if (batchSeparable)
+      runName += "_unsplit";
     rewriter.eraseOp(op);
     auto dynEntryPointFuncTy =
         LLVM::LLVMFunctionType::get(opaquePtrTy, {opaquePtrTy}, false);
     auto dynamicEntryPointFunc = rewriter.create<LLVM::LLVMFuncOp>(
-        loc, dynEntryPointName.str(), dynEntryPointFuncTy);
+        loc, runName, dynEntryPointFuncTy);
     auto &entryPointEntryBlock =
         createEntryBlock(dynEntryPointFuncTy, dynamicEntryPointFunc);
     rewriter.setInsertionPointToStart(&entryPointEntryBlock);
 
+    // Return null without running the model when the inputs do not match the
+    // signature.
+    if (inTable) {
+      Value inputsMatch = genInputsMatch(rewriter, loc, apiRegistry,
+          entryPointEntryBlock.getArgument(0), inTable);
+      Region &body = dynamicEntryPointFunc.getBody();
+      Block *runBlock = rewriter.createBlock(&body, body.end());
+      Block *errorBlock = rewriter.createBlock(&body, body.end());
+      rewriter.setInsertionPointToEnd(&entryPointEntryBlock);
+      genInputsCheck(rewriter, loc, apiRegistry,
+          entryPointEntryBlock.getArgument(0), inputsMatch, inputLayouts,
+          runBlock, errorBlock);
+      rewriter.setInsertionPointToStart(errorBlock);
+      Value null = rewriter.create<LLVM::NullOp>(loc, opaquePtrTy);
+      rewriter.create<LLVM::ReturnOp>(loc, ValueRange({null}));
+      rewriter.setInsertionPointToStart(runBlock);
+    }
+
     // Based on the static entry point type signature, unpack dynamic memory
     // refs to corresponding static memory refs.
     auto wrappedStaticEntryPointFuncName =
@@ -828,81 +1262,17 @@ public:
                                   .getType()
                                   .dyn_cast<LLVM::LLVMFunctionType>();
 
-    // Retrieve dynamic mem refs from wrapped input, and convert every one of
-    // them to static mem refs.
-    SmallVector<Value, 4> staticInputs;
+    // Retrieve dynamic mem refs from wrapped input, convert every one of them
+    // to static mem refs, and call the static entry point.
     auto wrappedInput = entryPointEntryBlock.getArgument(0);
-
-    auto omTensorPtrArr =
-        callApi(rewriter, loc, apiRegistry, API::GET_OMT_ARRAY, {wrappedInput});
+    SmallVector<Value, 4> inputDataPtrs;
+    auto outMemRefList = genStaticEntryPointCall(rewriter, loc, apiRegistry,
+        module, wrappedInput, wrappedStaticEntryPointFuncName,
+        staticEntryPointTy, numOutputs, specializations, inputLayouts,
+        inputDataPtrs);
     auto one = rewriter.create<LLVM::ConstantOp>(
         loc, int32Ty, rewriter.getI32IntegerAttr(1));
 
-    // Create a memref type for the return argument of the iface call
-    auto memRefOutPtrTy = staticEntryPointTy.getParamType(0);
-    Value ptrToOutMemRef =
-        rewriter.create<LLVM::AllocaOp>(loc, memRefOutPtrTy, one,
-            /*alignment=*/0);
-    staticInputs.emplace_back(ptrToOutMemRef);
-
-    // Start with param 1 because 0 is the return value
-    for (size_t i = 1; i < staticEntryPointTy.getNumParams(); i++) {
-      // Call API function to retrieve the i-th dynamic memref.
-      auto idxVal = rewriter.create<LLVM::ConstantOp>(
-          loc, int32Ty, rewriter.getI32IntegerAttr(i - 1));
-
-      auto omTensorPtrAddrTy = LLVM::LLVMPointerType::get(opaquePtrTy);
-      auto omTensorPtrAddr = rewriter
-                                 .create<LLVM::GEPOp>(loc, omTensorPtrAddrTy,
-                                     omTensorPtrArr, ArrayRef<Value>({idxVal}))
-                                 .getResult();
-      auto omTensorPtr =
-          rewriter.create<LLVM::LoadOp>(loc, opaquePtrTy, omTensorPtrAddr)
-              .getResult();
-
-      // Create a (static) memref type corresponding to the i-th memref input to
-      // the inference function on stack, and load it to memRef.
-      auto memRefPtrTy = staticEntryPointTy.getParamType(i);
-
-      Value ptrToMemRef = rewriter.create<LLVM::AllocaOp>(loc, memRefPtrTy, one,
-          /*alignment=*/0);
-
-      // Fill in the memref underlying ptrToMemRef with information extracted
-      // from omTensorPtr.
-      fillPtrToMemRefWithOMTensor(
-          omTensorPtr, ptrToMemRef, rewriter, loc, apiRegistry, module);
-
-      // ptrToMemRef will be an input to main computation graph function.
-      staticInputs.emplace_back(ptrToMemRef);
-    }
-
-    // Call static entry point with the memref ptrs created, and get output.
-    auto outCallOp = rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}),
-        rewriter.getSymbolRefAttr(wrappedStaticEntryPointFuncName),
-        staticInputs);
-    auto outMemRefs = rewriter.create<LLVM::LoadOp>(loc, ptrToOutMemRef);
-    auto outMemRefsType = outMemRefs.getType().dyn_cast<LLVM::LLVMStructType>();
-
-    std::vector<mlir::Value> outMemRefList;
-    if (numOutputs == 1) {
-      // If only one output tensor exists, the tensor's corresponding memref
-      // descriptor will be returned as is.
-      outMemRefList.emplace_back(outMemRefs);
-    } else {
-      // Otherwise, if multiple tensors are to be returned, the returned value
-      // is a struct. Multiple tensors' memref descriptors are packed into the
-      // same struct. So we unpack them iteratively to outMemRefList.
-      for (int i = 0; i < numOutputs; i++) {
-        auto position = rewriter.getArrayAttr({rewriter.getI64IntegerAttr(i)});
-        auto type = outMemRefsType.getBody()[i];
-        auto extractOp = rewriter.create<LLVM::ExtractValueOp>(loc,
-            /*res=*/type,
-            /*type=*/outMemRefs,
-            /*position=*/position);
-        outMemRefList.emplace_back(extractOp.getResult());
-      }
-    }
-
     auto numOutput = rewriter.create<LLVM::ConstantOp>(
         loc, int32Ty, rewriter.getI64IntegerAttr(outMemRefList.size()));
 
@@ -931,15 +1301,18 @@ public:
       // Get the i-th memref returned, convert to a dynamic memref and store it
       // in the wrappedOutput.
 
-      auto memRef = outMemRefList.at(i);
+      auto memRef = outMemRefList[i];
       auto outMemRefTy = memRef.getType().dyn_cast<LLVM::LLVMStructType>();
       auto outMemRefRank = getRankFromMemRefType(outMemRefTy);
       auto outMemRefRankVal = rewriter.create<LLVM::ConstantOp>(
           loc, int64Ty, rewriter.getI64IntegerAttr(outMemRefRank));
       auto outOMTensor = callApi(
           rewriter, loc, apiRegistry, API::CREATE_OMTENSOR, {outMemRefRankVal});
+      Value owning = genOutputOwning(rewriter, loc, memRef,
+          isOwning(outputOwning, i), mayViewInput(outputMayViewInput, i),
+          inputDataPtrs);
       fillOMTensorWithMemRef(
-          memRef, outOMTensor, rewriter, loc, apiRegistry, module);
+          memRef, outOMTensor, owning, rewriter, loc, apiRegistry, module);
 
       auto idxVal = rewriter.create<LLVM::ConstantOp>(
           loc, int32Ty, rewriter.getI32IntegerAttr(i));
@@ -960,12 +1333,55 @@ public:
     // Return wrapped output.
     rewriter.create<LLVM::ReturnOp>(
         loc, SmallVector<Value, 1>(1, wrappedOutput));
+
+    rewriter.setInsertionPointAfter(dynamicEntryPointFunc);
+    if (batchSeparable)
+      genBatchEntryPoint(rewriter, loc, module, dynEntryPointName.str(),
+          dynamicEntryPointFunc);
+
+    // Emit a second entry point writing the outputs into caller-provided
+    // OMTensors, which are not split.
+    genIntoEntryPoint(rewriter, loc, apiRegistry, module,
+        dynEntryPointName.str() + "_into", wrappedStaticEntryPointFuncName,
+        staticEntryPointTy, numOutputs, specializations, outputOwning,
+        outputMayViewInput, inTable, inputLayouts);
     return success();
   }
 
 private:
   using ApiRegistry = std::map<API, ApiSpec>;
 
+  // Emit the entry point of a batch-separable model, running its inputs with
+  // the given function in chunks of the batch:
+  //
+  //   OMTensorList *run_<func>(OMTensorList *inputs) {
+  //     return omBatchRunInChunks(run_<func>_unsplit, inputs);
+  //   }
+  void genBatchEntryPoint(PatternRewriter &rewriter, Location loc,
+      ModuleOp module, std::string name, LLVM::LLVMFuncOp unsplitFunc) const {
+    auto opaquePtrTy =
+        LLVM::LLVMPointerType::get(IntegerType::get(module.getContext(), 8));
+    auto funcTy =
+        LLVM::LLVMFunctionType::get(opaquePtrTy, {opaquePtrTy}, false);
+    auto func = rewriter.create<LLVM::LLVMFuncOp>(loc, name, funcTy);
+    auto &entryBlock = createEntryBlock(funcTy, func);
+    OpBuilder::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(&entryBlock);
+
+    auto runInChunksRef = getOrInsertExternFunc("omBatchRunInChunks", module,
+        LLVM::LLVMFunctionType::get(
+            opaquePtrTy, {opaquePtrTy, opaquePtrTy}, false),
+        rewriter);
+    Value unsplitPtr = rewriter.create<LLVM::BitcastOp>(
+        loc, opaquePtrTy, rewriter.create<LLVM::AddressOfOp>(loc, unsplitFunc));
+    Value outputs =
+        rewriter
+            .create<LLVM::CallOp>(loc, opaquePtrTy, runInChunksRef,
+                ArrayRef<Value>({unsplitPtr, entryBlock.getArgument(0)}))
+            .getResult(0);
+    rewriter.create<LLVM::ReturnOp>(loc, ValueRange({outputs}));
+  }
+
   ApiRegistry RegisterAllApis(
       ModuleOp &module, PatternRewriter &rewriter) const {
     auto *context = module.getContext();
@@ -990,6 +1406,13 @@ private:
         ApiSpec(API::GET_DATA_TYPE, "omTensorGetDataType", int32Ty, {opaquePtrTy}),
         ApiSpec(API::SET_DATA_TYPE, "omTensorSetDataType", voidTy, {opaquePtrTy, int32Ty}),
         ApiSpec(API::GET_OMT_ARRAY, "omTensorListGetOmtArray", opaquePtrPtrTy, {opaquePtrTy}),
+        ApiSpec(API::GET_OMT_LIST_SIZE, "omTensorListGetSize", int32Ty, {opaquePtrTy}),
+        ApiSpec(API::GET_RANK, "omTensorGetRank", int32Ty, {opaquePtrTy}),
+        ApiSpec(API::GET_BUFFER_SIZE, "omTensorGetBufferSize", int64Ty, {opaquePtrTy}),
+        ApiSpec(API::CHECK_SIGNATURE, "omTensorListCheckSignature", int32Ty, {opaquePtrTy, opaquePtrTy}),
+        ApiSpec(API::IS_CONTIGUOUS, "omTensorIsContiguous", int32Ty, {opaquePtrTy}),
+        ApiSpec(API::GET_CONTIGUOUS, "omTensorGetContiguous", opaquePtrTy, {opaquePtrTy}),
+        ApiSpec(API::RELEASE_CONTIGUOUS, "omTensorReleaseContiguous", voidTy, {opaquePtrTy, opaquePtrTy}),
     };
     // clang-format on
 
@@ -1005,89 +1428,565 @@ private:
     return registry;
   }
 
-  // Call a registered API, return the return SSA values if only one result is
-  // returned, otherwise return nullptr.
-  Value callApi(PatternRewriter &rewriter, Location loc, ApiRegistry registry,
-      API apiId, ArrayRef<Value> params) const {
-    // To be used as parameters in LLVM::CallOp, voidTy must be converted
-    // to empty list to avoid emission of an SSA value with voidTy. However,
-    // we still keep using LLVM voidTy (as opposed to empty list) when recording
-    // API function signatures in API registry because when declaring API
-    // functions in LLVM IR, the correct way to indicate an output type for
-    // "void" is still LLVM voidTy. Relevant discussion thread:
-    // https://github.com/onnx/onnx-mlir/issues/255.
-    SmallVector<Type, 1> outputTys;
-    auto outputTy = registry.at(apiId).outputTy;
-    if (!outputTy.isa<LLVM::LLVMVoidType>())
-      outputTys.emplace_back(outputTy);
-    auto returnVals =
-        rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>(outputTys),
-            registry.at(apiId).symbolRef, ArrayRef<Value>(params));
-    if (returnVals.getNumResults() == 1)
-      return returnVals.getResult(0);
-    return nullptr;
-  }
-
-  // Helper function to insert an entry block to LLVM function.
-  // (TODO): upstream this to MLIR.
-  Block &createEntryBlock(
-      Type &dynEntryPoint, LLVM::LLVMFuncOp &dynamicEntryPointFunc) const {
-    // Add entry block:
-    auto *entryPointEntryBlock = new Block();
-    auto dynEntryPointFuncType = dynEntryPoint.cast<LLVM::LLVMFunctionType>();
-    dynamicEntryPointFunc.push_back(entryPointEntryBlock);
-    llvm::SmallVector<Type, 4> argTypes;
-    for (size_t i = 0; i < dynEntryPointFuncType.getNumParams(); i++)
-      argTypes.emplace_back(dynEntryPointFuncType.getParamType(i));
-    entryPointEntryBlock->addArguments(argTypes);
-    return *entryPointEntryBlock;
-  }
-
-  void fillPtrToMemRefWithOMTensor(Value &rtMemRef, Value &ptrToMemRef,
-      PatternRewriter &rewriter, const Location &loc,
-      const std::map<API, ApiSpec> &apiRegistry, ModuleOp &module) const {
+  // Unpack the OMTensors of the wrapped input into static memrefs, call the
+  // static entry point and return the memref descriptors of its outputs. The
+  // data pointers of the inputs are collected in inputDataPtrs. The inputs of
+  // the Contiguous layout are passed as they are when their strides are
+  // dense, and as contiguous copies released after the call otherwise.
+  SmallVector<Value, 4> genStaticEntryPointCall(PatternRewriter &rewriter,
+      Location loc, const ApiRegistry &apiRegistry, ModuleOp &module,
+      Value wrappedInput, StringRef wrappedStaticEntryPointFuncName,
+      LLVM::LLVMFunctionType staticEntryPointTy, int64_t numOutputs,
+      ArrayAttr specializations, ArrayAttr inputLayouts,
+      SmallVectorImpl<Value> &inputDataPtrs) const {
     auto *context = module.getContext();
-    auto memRefPtrTy = ptrToMemRef.getType().dyn_cast<LLVM::LLVMPointerType>();
-    auto memRefTy = memRefPtrTy.getElementType();
-    auto int64Ty = IntegerType::get(context, 64);
+    auto opaquePtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+    auto int32Ty = IntegerType::get(context, 32);
 
-    Value memRef = rewriter.create<LLVM::UndefOp>(loc, memRefTy);
+    // Retrieve dynamic mem refs from wrapped input, and convert every one of
+    // them to static mem refs.
+    SmallVector<Value, 4> staticInputs;
 
-    // Set dataPtr and alignedDataPtr;
-    auto dataPtr =
-        callApi(rewriter, loc, apiRegistry, API::GET_DATA, {rtMemRef});
-    dataPtr = rewriter.create<LLVM::BitcastOp>(
-        loc, memRefTy.cast<LLVM::LLVMStructType>().getBody()[0], dataPtr);
-    memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef,
-        dataPtr, rewriter.getArrayAttr({rewriter.getI32IntegerAttr(0)}));
-    memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef,
-        dataPtr, rewriter.getArrayAttr({rewriter.getI32IntegerAttr(1)}));
+    auto omTensorPtrArr =
+        callApi(rewriter, loc, apiRegistry, API::GET_OMT_ARRAY, {wrappedInput});
+    auto one = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(1));
 
-    // Use zero offset now.
-    auto zero = rewriter.create<LLVM::ConstantOp>(
-        loc, int64Ty, rewriter.getI64IntegerAttr(0));
-    memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef, zero,
-        rewriter.getArrayAttr({rewriter.getI32IntegerAttr(2)}));
+    // Create a memref type for the return argument of the iface call
+    auto memRefOutPtrTy = staticEntryPointTy.getParamType(0);
+    Value ptrToOutMemRef =
+        rewriter.create<LLVM::AllocaOp>(loc, memRefOutPtrTy, one,
+            /*alignment=*/0);
+    staticInputs.emplace_back(ptrToOutMemRef);
 
-    // Get rank, sizes array ptr and strides array ptr.
-    auto rank = getRankFromMemRefType(memRefTy.cast<LLVM::LLVMStructType>());
-    auto sizesArrayPtr =
-        callApi(rewriter, loc, apiRegistry, API::GET_DATA_SHAPE, {rtMemRef});
-    auto stridesArrayPtr =
-        callApi(rewriter, loc, apiRegistry, API::GET_DATA_STRIDES, {rtMemRef});
+    // The contiguous OMTensors of the inputs, with the OMTensors they copy.
+    SmallVector<std::pair<Value, Value>, 4> contiguousInputs;
 
-    for (decltype(rank) i = 0; i < rank; i++) {
-      auto dimIdx = rewriter.create<LLVM::ConstantOp>(
-          loc, int64Ty, rewriter.getI64IntegerAttr(i));
+    // Start with param 1 because 0 is the return value
+    for (size_t i = 1; i < staticEntryPointTy.getNumParams(); i++) {
+      // Call API function to retrieve the i-th dynamic memref.
+      auto idxVal = rewriter.create<LLVM::ConstantOp>(
+          loc, int32Ty, rewriter.getI32IntegerAttr(i - 1));
 
-      // Insert size of the dimension.
-      auto dimSizePtr =
-          rewriter.create<LLVM::GEPOp>(loc, LLVM::LLVMPointerType::get(int64Ty),
-              sizesArrayPtr, ArrayRef<Value>({dimIdx}));
-      auto dimSize = rewriter.create<LLVM::LoadOp>(
-          loc, LLVM::LLVMPointerType::get(int64Ty), dimSizePtr);
-      memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef,
-          dimSize,
+      auto omTensorPtrAddrTy = LLVM::LLVMPointerType::get(opaquePtrTy);
+      auto omTensorPtrAddr = rewriter
+                                 .create<LLVM::GEPOp>(loc, omTensorPtrAddrTy,
+                                     omTensorPtrArr, ArrayRef<Value>({idxVal}))
+                                 .getResult();
+      Value omTensorPtr =
+          rewriter.create<LLVM::LoadOp>(loc, opaquePtrTy, omTensorPtrAddr)
+              .getResult();
+      if (getInputLayout(inputLayouts, i - 1) == InputLayout::Contiguous) {
+        Value contiguousPtr = callApi(
+            rewriter, loc, apiRegistry, API::GET_CONTIGUOUS, {omTensorPtr});
+        contiguousInputs.emplace_back(contiguousPtr, omTensorPtr);
+        omTensorPtr = contiguousPtr;
+      }
+
+      // Create a (static) memref type corresponding to the i-th memref input to
+      // the inference function on stack, and load it to memRef.
+      auto memRefPtrTy = staticEntryPointTy.getParamType(i);
+
+      Value ptrToMemRef = rewriter.create<LLVM::AllocaOp>(loc, memRefPtrTy, one,
+          /*alignment=*/0);
+
+      // Fill in the memref underlying ptrToMemRef with information extracted
+      // from omTensorPtr.
+      inputDataPtrs.emplace_back(fillPtrToMemRefWithOMTensor(
+          omTensorPtr, ptrToMemRef, rewriter, loc, apiRegistry, module));
+
+      // ptrToMemRef will be an input to main computation graph function.
+      staticInputs.emplace_back(ptrToMemRef);
+    }
+
+    // Call static entry point with the memref ptrs created, and get output.
+    if (!specializations || specializations.empty()) {
+      rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}),
+          rewriter.getSymbolRefAttr(wrappedStaticEntryPointFuncName),
+          staticInputs);
+    } else {
+      SmallVector<Value, 4> callOperands;
+      callOperands.emplace_back(selectSpecializedEntryPoint(rewriter, loc,
+          module, ArrayRef<Value>(staticInputs).drop_front(),
+          wrappedStaticEntryPointFuncName, specializations));
+      callOperands.append(staticInputs.begin(), staticInputs.end());
+      rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}), callOperands);
+    }
+    // The outputs do not view the copies, which are released.
+    for (auto contiguousInput : contiguousInputs)
+      callApi(rewriter, loc, apiRegistry, API::RELEASE_CONTIGUOUS,
+          {contiguousInput.first, contiguousInput.second});
+    auto outMemRefs = rewriter.create<LLVM::LoadOp>(loc, ptrToOutMemRef);
+    auto outMemRefsType = outMemRefs.getType().dyn_cast<LLVM::LLVMStructType>();
+
+    SmallVector<Value, 4> outMemRefList;
+    if (numOutputs == 1) {
+      // If only one output tensor exists, the tensor's corresponding memref
+      // descriptor will be returned as is.
+      outMemRefList.emplace_back(outMemRefs);
+    } else {
+      // Otherwise, if multiple tensors are to be returned, the returned value
+      // is a struct. Multiple tensors' memref descriptors are packed into the
+      // same struct. So we unpack them iteratively to outMemRefList.
+      for (int i = 0; i < numOutputs; i++) {
+        auto position = rewriter.getArrayAttr({rewriter.getI64IntegerAttr(i)});
+        auto type = outMemRefsType.getBody()[i];
+        auto extractOp = rewriter.create<LLVM::ExtractValueOp>(loc,
+            /*res=*/type,
+            /*type=*/outMemRefs,
+            /*position=*/position);
+        outMemRefList.emplace_back(extractOp.getResult());
+      }
+    }
+
+    return outMemRefList;
+  }
+
+  // Return the address of the C interface of the first specialization of the
+  // static entry point whose input shapes are the shapes of the inputs, and
+  // whose alignment, if any, divides the addresses of their data, or of the
+  // static entry point if there is none. All of them have the same C
+  // interface since the memref descriptors do not depend on the static sizes.
+  Value selectSpecializedEntryPoint(PatternRewriter &rewriter, Location loc,
+      ModuleOp &module, ArrayRef<Value> ptrToInputMemRefs,
+      StringRef wrappedStaticEntryPointFuncName,
+      ArrayAttr specializations) const {
+    auto *context = module.getContext();
+    auto int1Ty = IntegerType::get(context, 1);
+    auto int64Ty = IntegerType::get(context, 64);
+    auto getFuncAddress = [&](StringRef funcName) -> Value {
+      auto funcOp = module.lookupSymbol<LLVM::LLVMFuncOp>(funcName);
+      assert(funcOp && "specialized entry point func must be an llvm func op");
+      return rewriter.create<LLVM::AddressOfOp>(loc, funcOp);
+    };
+
+    SmallVector<Value, 4> inputMemRefs;
+    for (Value ptrToMemRef : ptrToInputMemRefs)
+      inputMemRefs.emplace_back(
+          rewriter.create<LLVM::LoadOp>(loc, ptrToMemRef));
+
+    // Select in reverse order, so that the first matching one is called.
+    Value callee = getFuncAddress(wrappedStaticEntryPointFuncName);
+    for (Attribute attr : llvm::reverse(specializations)) {
+      auto specialization = attr.cast<DictionaryAttr>();
+      auto funcName =
+          specialization.get("func").cast<FlatSymbolRefAttr>().getValue();
+      auto shapes = specialization.get("shapes").cast<ArrayAttr>();
+      Value match = rewriter.create<LLVM::ConstantOp>(
+          loc, int1Ty, rewriter.getBoolAttr(true));
+      for (unsigned i = 0; i < shapes.size(); ++i) {
+        auto shape = shapes[i].cast<ArrayAttr>();
+        for (unsigned d = 0; d < shape.size(); ++d) {
+          int64_t size = shape[d].cast<IntegerAttr>().getInt();
+          if (size == -1)
+            continue;
+          // The sizes are the fourth field of the memref descriptor.
+          Value dimSize = rewriter.create<LLVM::ExtractValueOp>(loc, int64Ty,
+              inputMemRefs[i], rewriter.getI64ArrayAttr({3, (int64_t)d}));
+          Value expected = rewriter.create<LLVM::ConstantOp>(
+              loc, int64Ty, rewriter.getI64IntegerAttr(size));
+          Value sameSize = rewriter.create<LLVM::ICmpOp>(
+              loc, LLVM::ICmpPredicate::eq, dimSize, expected);
+          match = rewriter.create<LLVM::AndOp>(loc, match, sameSize);
+        }
+      }
+      if (auto alignment =
+              specialization.get("alignment").dyn_cast_or_null<IntegerAttr>()) {
+        Value mask = rewriter.create<LLVM::ConstantOp>(
+            loc, int64Ty, rewriter.getI64IntegerAttr(alignment.getInt() - 1));
+        Value zero = rewriter.create<LLVM::ConstantOp>(
+            loc, int64Ty, rewriter.getI64IntegerAttr(0));
+        for (Value memRef : inputMemRefs) {
+          // The aligned pointer is the second field of the memref descriptor.
+          auto memRefTy = memRef.getType().cast<LLVM::LLVMStructType>();
+          Value alignedPtr = rewriter.create<LLVM::ExtractValueOp>(loc,
+              memRefTy.getBody()[1], memRef, rewriter.getI64ArrayAttr({1}));
+          Value address =
+              rewriter.create<LLVM::PtrToIntOp>(loc, int64Ty, alignedPtr);
+          Value offset = rewriter.create<LLVM::AndOp>(loc, address, mask);
+          Value aligned = rewriter.create<LLVM::ICmpOp>(
+              loc, LLVM::ICmpPredicate::eq, offset, zero);
+          match = rewriter.create<LLVM::AndOp>(loc, match, aligned);
+        }
+      }
+      callee = rewriter.create<LLVM::SelectOp>(loc, match,
+          getFuncAddress("_mlir_ciface_" + funcName.lower()), callee);
+    }
+    return callee;
+  }
+
+  // Return whether the number of inputs, and their data types, ranks and
+  // static dimensions, match the signature table, checked by the runtime.
+  Value genInputsMatch(PatternRewriter &rewriter, Location loc,
+      const ApiRegistry &apiRegistry, Value wrappedInput,
+      LLVM::GlobalOp inputTable) const {
+    auto *context = rewriter.getContext();
+    auto opaquePtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+    auto int32Ty = IntegerType::get(context, 32);
+    Value tableAddr = rewriter.create<LLVM::AddressOfOp>(loc, inputTable);
+    Value table = rewriter.create<LLVM::BitcastOp>(loc, opaquePtrTy, tableAddr);
+    Value result = callApi(rewriter, loc, apiRegistry, API::CHECK_SIGNATURE,
+        {wrappedInput, table});
+    Value zero = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(0));
+    return rewriter.create<LLVM::ICmpOp>(
+        loc, LLVM::ICmpPredicate::eq, result, zero);
+  }
+
+  // The layout of the i-th input, Strided when the layouts were not analyzed.
+  static InputLayout getInputLayout(ArrayAttr inputLayouts, size_t i) {
+    if (!inputLayouts)
+      return InputLayout::Strided;
+    return (InputLayout)inputLayouts[i].cast<IntegerAttr>().getInt();
+  }
+
+  // Branch to runBlock if the match holds and the inputs of the Dense layout
+  // are contiguous, and to errorBlock otherwise. The inputs are read only
+  // once the match, which checks their number, holds.
+  void genInputsCheck(PatternRewriter &rewriter, Location loc,
+      const ApiRegistry &apiRegistry, Value wrappedInput, Value match,
+      ArrayAttr inputLayouts, Block *runBlock, Block *errorBlock) const {
+    SmallVector<int32_t, 4> denseInputs;
+    if (inputLayouts)
+      for (size_t i = 0; i < inputLayouts.size(); i++)
+        if (getInputLayout(inputLayouts, i) == InputLayout::Dense)
+          denseInputs.emplace_back(i);
+    if (denseInputs.empty()) {
+      rewriter.create<LLVM::CondBrOp>(loc, match, runBlock, errorBlock);
+      return;
+    }
+
+    auto *context = rewriter.getContext();
+    auto opaquePtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+    auto int1Ty = IntegerType::get(context, 1);
+    auto int32Ty = IntegerType::get(context, 32);
+    Block *currentBlock = rewriter.getInsertionBlock();
+    Block *denseBlock = rewriter.createBlock(runBlock);
+    rewriter.setInsertionPointToEnd(currentBlock);
+    rewriter.create<LLVM::CondBrOp>(loc, match, denseBlock, errorBlock);
+
+    rewriter.setInsertionPointToStart(denseBlock);
+    auto omTensorPtrArr =
+        callApi(rewriter, loc, apiRegistry, API::GET_OMT_ARRAY, {wrappedInput});
+    Value allDense = rewriter.create<LLVM::ConstantOp>(
+        loc, int1Ty, rewriter.getBoolAttr(true));
+    Value zero = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(0));
+    for (int32_t i : denseInputs) {
+      auto idxVal = rewriter.create<LLVM::ConstantOp>(
+          loc, int32Ty, rewriter.getI32IntegerAttr(i));
+      Value omTensorPtrAddr = rewriter.create<LLVM::GEPOp>(loc,
+          LLVM::LLVMPointerType::get(opaquePtrTy), omTensorPtrArr,
+          ArrayRef<Value>({idxVal}));
+      Value omTensorPtr =
+          rewriter.create<LLVM::LoadOp>(loc, opaquePtrTy, omTensorPtrAddr);
+      Value contiguous = callApi(
+          rewriter, loc, apiRegistry, API::IS_CONTIGUOUS, {omTensorPtr});
+      Value dense = rewriter.create<LLVM::ICmpOp>(
+          loc, LLVM::ICmpPredicate::ne, contiguous, zero);
+      allDense = rewriter.create<LLVM::AndOp>(loc, allDense, dense);
+    }
+    rewriter.create<LLVM::CondBrOp>(loc, allDense, runBlock, errorBlock);
+  }
+
+  // Emit an entry point of the form:
+  //
+  //   int run_<entry>_into(OMTensorList *inputs, OMTensorList *outputs)
+  //
+  // which runs the model and copies each output into the data buffer of the
+  // corresponding OMTensor in `outputs`, whose shape, strides and data type are
+  // updated. The caller keeps the ownership of all the OMTensors, so that they
+  // can be reused across calls. Returns 0 on success, or -1 without touching
+  // the outputs if the number of outputs, the rank of an output or the size of
+  // its buffer does not match. The outputs are computed in buffers allocated by
+  // the model, which are copied and freed: only the OMTensors of the outputs
+  // are not allocated.
+  void genIntoEntryPoint(PatternRewriter &rewriter, Location loc,
+      const ApiRegistry &apiRegistry, ModuleOp &module, std::string funcName,
+      StringRef wrappedStaticEntryPointFuncName,
+      LLVM::LLVMFunctionType staticEntryPointTy, int64_t numOutputs,
+      ArrayAttr specializations, ArrayAttr outputOwning,
+      ArrayAttr outputMayViewInput, LLVM::GlobalOp inputTable,
+      ArrayAttr inputLayouts) const {
+    auto *context = module.getContext();
+    auto opaquePtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+    auto opaquePtrPtrTy = LLVM::LLVMPointerType::get(opaquePtrTy);
+    auto int1Ty = IntegerType::get(context, 1);
+    auto int32Ty = IntegerType::get(context, 32);
+    auto int64Ty = IntegerType::get(context, 64);
+    auto int64PtrTy = LLVM::LLVMPointerType::get(int64Ty);
+
+    assert(module.lookupSymbol(funcName) == nullptr &&
+           "dynamic entry point name is not unique");
+    auto intoFuncTy = LLVM::LLVMFunctionType::get(
+        int32Ty, {opaquePtrTy, opaquePtrTy}, false);
+    auto intoFunc =
+        rewriter.create<LLVM::LLVMFuncOp>(loc, funcName, intoFuncTy);
+    auto &entryBlock = createEntryBlock(intoFuncTy, intoFunc);
+    Region &body = intoFunc.getBody();
+    Block *runBlock = rewriter.createBlock(&body, body.end());
+    Block *copyBlock = rewriter.createBlock(&body, body.end());
+    Block *freeBlock = rewriter.createBlock(&body, body.end(), {int32Ty});
+    Block *errorBlock = rewriter.createBlock(&body, body.end());
+
+    // Check the number of outputs before running the model.
+    rewriter.setInsertionPointToStart(&entryBlock);
+    auto wrappedInput = entryBlock.getArgument(0);
+    auto wrappedOutput = entryBlock.getArgument(1);
+    auto numOutputsVal = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(numOutputs));
+    auto outputListSize = callApi(
+        rewriter, loc, apiRegistry, API::GET_OMT_LIST_SIZE, {wrappedOutput});
+    Value sizeMatch = rewriter.create<LLVM::ICmpOp>(
+        loc, LLVM::ICmpPredicate::eq, outputListSize, numOutputsVal);
+    if (inputTable)
+      sizeMatch = rewriter.create<LLVM::AndOp>(loc, sizeMatch,
+          genInputsMatch(
+              rewriter, loc, apiRegistry, wrappedInput, inputTable));
+    genInputsCheck(rewriter, loc, apiRegistry, wrappedInput, sizeMatch,
+        inputTable ? inputLayouts : ArrayAttr(), runBlock, errorBlock);
+
+    // Run the model, then check that every output fits in its OMTensor.
+    rewriter.setInsertionPointToStart(runBlock);
+    SmallVector<Value, 4> inputDataPtrs;
+    auto outMemRefList = genStaticEntryPointCall(rewriter, loc, apiRegistry,
+        module, wrappedInput, wrappedStaticEntryPointFuncName,
+        staticEntryPointTy, numOutputs, specializations, inputLayouts,
+        inputDataPtrs);
+    auto outOmtPtrsArr = callApi(
+        rewriter, loc, apiRegistry, API::GET_OMT_ARRAY, {wrappedOutput});
+    Value allFit = rewriter.create<LLVM::ConstantOp>(
+        loc, int1Ty, rewriter.getBoolAttr(true));
+    SmallVector<Value, 4> outOMTensors, outSizesInBytes, outOwnings;
+    for (size_t i = 0; i < outMemRefList.size(); i++) {
+      auto memRef = outMemRefList[i];
+      auto outMemRefTy = memRef.getType().cast<LLVM::LLVMStructType>();
+      auto rank = getRankFromMemRefType(outMemRefTy);
+
+      // The outputs viewing an input keep its strides, which the copy does
+      // not handle, so the call fails for them.
+      Value owning = genOutputOwning(rewriter, loc, memRef,
+          isOwning(outputOwning, i), mayViewInput(outputMayViewInput, i),
+          inputDataPtrs);
+      outOwnings.emplace_back(owning);
+      if (mayViewInput(outputMayViewInput, i))
+        allFit = rewriter.create<LLVM::AndOp>(loc, allFit,
+            rewriter.create<LLVM::TruncOp>(loc, int1Ty, owning));
+
+      auto idxVal = rewriter.create<LLVM::ConstantOp>(
+          loc, int32Ty, rewriter.getI32IntegerAttr(i));
+      auto omTensorPtrAddr = rewriter.create<LLVM::GEPOp>(
+          loc, opaquePtrPtrTy, outOmtPtrsArr, ArrayRef<Value>({idxVal}));
+      Value outOMTensor =
+          rewriter.create<LLVM::LoadOp>(loc, opaquePtrTy, omTensorPtrAddr);
+      outOMTensors.emplace_back(outOMTensor);
+
+      // Output size in bytes, outputs being contiguous.
+      auto elemTy = outMemRefTy.getBody()[0]
+                        .cast<LLVM::LLVMPointerType>()
+                        .getElementType();
+      Value sizeInBytes = rewriter.create<LLVM::ConstantOp>(loc, int64Ty,
+          rewriter.getI64IntegerAttr(
+              (elemTy.getIntOrFloatBitWidth() + 7) / 8));
+      for (decltype(rank) d = 0; d < rank; d++) {
+        auto dimSize = rewriter.create<LLVM::ExtractValueOp>(loc, int64Ty,
+            memRef,
+            rewriter.getArrayAttr({rewriter.getI64IntegerAttr(3),
+                rewriter.getI64IntegerAttr(d)}));
+        sizeInBytes = rewriter.create<LLVM::MulOp>(loc, sizeInBytes, dimSize);
+      }
+      outSizesInBytes.emplace_back(sizeInBytes);
+
+      auto expectedRank = rewriter.create<LLVM::ConstantOp>(
+          loc, int32Ty, rewriter.getI32IntegerAttr(rank));
+      auto outRank =
+          callApi(rewriter, loc, apiRegistry, API::GET_RANK, {outOMTensor});
+      Value rankMatch = rewriter.create<LLVM::ICmpOp>(
+          loc, LLVM::ICmpPredicate::eq, outRank, expectedRank);
+      auto bufferSize = callApi(
+          rewriter, loc, apiRegistry, API::GET_BUFFER_SIZE, {outOMTensor});
+      Value sizeFit = rewriter.create<LLVM::ICmpOp>(
+          loc, LLVM::ICmpPredicate::sle, sizeInBytes, bufferSize);
+      allFit = rewriter.create<LLVM::AndOp>(loc, allFit, rankMatch);
+      allFit = rewriter.create<LLVM::AndOp>(loc, allFit, sizeFit);
+    }
+    Value mismatch = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(-1));
+    rewriter.create<LLVM::CondBrOp>(loc, allFit, copyBlock, ValueRange(),
+        freeBlock, ValueRange({mismatch}));
+
+    // Copy the outputs into the caller-provided OMTensors.
+    rewriter.setInsertionPointToStart(copyBlock);
+    auto memcpyRef = getOrInsertMemcpy(rewriter, module);
+    auto isVolatile = rewriter.create<LLVM::ConstantOp>(
+        loc, int1Ty, rewriter.getBoolAttr(false));
+    for (size_t i = 0; i < outMemRefList.size(); i++) {
+      auto memRef = outMemRefList[i];
+      auto outMemRefTy = memRef.getType().cast<LLVM::LLVMStructType>();
+      auto rank = getRankFromMemRefType(outMemRefTy);
+      Value outOMTensor = outOMTensors[i];
+
+      Value alignedPtr =
+          rewriter.create<LLVM::ExtractValueOp>(loc, outMemRefTy.getBody()[1],
+              memRef, rewriter.getArrayAttr({rewriter.getI64IntegerAttr(1)}));
+      alignedPtr =
+          rewriter.create<LLVM::BitcastOp>(loc, opaquePtrTy, alignedPtr);
+      auto dataPtr =
+          callApi(rewriter, loc, apiRegistry, API::GET_DATA, {outOMTensor});
+      rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}), memcpyRef,
+          ArrayRef<Value>(
+              {dataPtr, alignedPtr, outSizesInBytes[i], isVolatile}));
+
+      auto elemTy = outMemRefTy.getBody()[0]
+                        .cast<LLVM::LLVMPointerType>()
+                        .getElementType();
+      auto onnxTyVal = rewriter.create<LLVM::ConstantOp>(
+          loc, int32Ty, rewriter.getI32IntegerAttr(llvmTypeToOnnxType(elemTy)));
+      callApi(rewriter, loc, apiRegistry, API::SET_DATA_TYPE,
+          {outOMTensor, onnxTyVal});
+
+      auto sizesArrayPtr = callApi(
+          rewriter, loc, apiRegistry, API::GET_DATA_SHAPE, {outOMTensor});
+      auto stridesArrayPtr = callApi(
+          rewriter, loc, apiRegistry, API::GET_DATA_STRIDES, {outOMTensor});
+      for (decltype(rank) d = 0; d < rank; d++) {
+        auto dimIdx = rewriter.create<LLVM::ConstantOp>(
+            loc, int64Ty, rewriter.getI64IntegerAttr(d));
+        auto dimSize = rewriter.create<LLVM::ExtractValueOp>(loc, int64Ty,
+            memRef,
+            rewriter.getArrayAttr({rewriter.getI64IntegerAttr(3),
+                rewriter.getI64IntegerAttr(d)}));
+        auto dimSizePtr = rewriter.create<LLVM::GEPOp>(
+            loc, int64PtrTy, sizesArrayPtr, ArrayRef<Value>({dimIdx}));
+        rewriter.create<LLVM::StoreOp>(loc, dimSize, dimSizePtr);
+        auto dimStride = rewriter.create<LLVM::ExtractValueOp>(loc, int64Ty,
+            memRef,
+            rewriter.getArrayAttr({rewriter.getI64IntegerAttr(4),
+                rewriter.getI64IntegerAttr(d)}));
+        auto dimStridePtr = rewriter.create<LLVM::GEPOp>(
+            loc, int64PtrTy, stridesArrayPtr, ArrayRef<Value>({dimIdx}));
+        rewriter.create<LLVM::StoreOp>(loc, dimStride, dimStridePtr);
+      }
+    }
+    Value ok = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(0));
+    rewriter.create<LLVM::BrOp>(loc, ValueRange({ok}), freeBlock);
+
+    // Release the buffers allocated by the model, and return the status.
+    Value status = freeBlock->getArgument(0);
+    rewriter.setInsertionPointToStart(freeBlock);
+    auto freeRef = getOrInsertDealloc(rewriter, module);
+    for (size_t i = 0; i < outMemRefList.size(); i++) {
+      if (!isOwning(outputOwning, i))
+        continue;
+      auto memRef = outMemRefList[i];
+      auto outMemRefTy = memRef.getType().cast<LLVM::LLVMStructType>();
+      Value allocatedPtr =
+          rewriter.create<LLVM::ExtractValueOp>(loc, outMemRefTy.getBody()[0],
+              memRef, rewriter.getArrayAttr({rewriter.getI64IntegerAttr(0)}));
+      allocatedPtr =
+          rewriter.create<LLVM::BitcastOp>(loc, opaquePtrTy, allocatedPtr);
+      // Free nothing when the output is the buffer of an input.
+      if (mayViewInput(outputMayViewInput, i))
+        allocatedPtr = rewriter.create<LLVM::SelectOp>(loc,
+            rewriter.create<LLVM::TruncOp>(loc, int1Ty, outOwnings[i]),
+            allocatedPtr, rewriter.create<LLVM::NullOp>(loc, opaquePtrTy));
+      rewriter.create<LLVM::CallOp>(
+          loc, ArrayRef<Type>({}), freeRef, ArrayRef<Value>({allocatedPtr}));
+    }
+    rewriter.create<LLVM::ReturnOp>(loc, ValueRange({status}));
+
+    rewriter.setInsertionPointToStart(errorBlock);
+    Value error = rewriter.create<LLVM::ConstantOp>(
+        loc, int32Ty, rewriter.getI32IntegerAttr(-1));
+    rewriter.create<LLVM::ReturnOp>(loc, ValueRange({error}));
+  }
+
+  // Call a registered API, return the return SSA values if only one result is
+  // returned, otherwise return nullptr.
+  Value callApi(PatternRewriter &rewriter, Location loc, ApiRegistry registry,
+      API apiId, ArrayRef<Value> params) const {
+    // To be used as parameters in LLVM::CallOp, voidTy must be converted
+    // to empty list to avoid emission of an SSA value with voidTy. However,
+    // we still keep using LLVM voidTy (as opposed to empty list) when recording
+    // API function signatures in API registry because when declaring API
+    // functions in LLVM IR, the correct way to indicate an output type for
+    // "void" is still LLVM voidTy. Relevant discussion thread:
+    // https://github.com/onnx/onnx-mlir/issues/255.
+    SmallVector<Type, 1> outputTys;
+    auto outputTy = registry.at(apiId).outputTy;
+    if (!outputTy.isa<LLVM::LLVMVoidType>())
+      outputTys.emplace_back(outputTy);
+    auto returnVals =
+        rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>(outputTys),
+            registry.at(apiId).symbolRef, ArrayRef<Value>(params));
+    if (returnVals.getNumResults() == 1)
+      return returnVals.getResult(0);
+    return nullptr;
+  }
+
+  // Helper function to insert an entry block to LLVM function.
+  // (TODO): upstream this to MLIR.
+  Block &createEntryBlock(
+      Type &dynEntryPoint, LLVM::LLVMFuncOp &dynamicEntryPointFunc) const {
+    // Add entry block:
+    auto *entryPointEntryBlock = new Block();
+    auto dynEntryPointFuncType = dynEntryPoint.cast<LLVM::LLVMFunctionType>();
+    dynamicEntryPointFunc.push_back(entryPointEntryBlock);
+    llvm::SmallVector<Type, 4> argTypes;
+    for (size_t i = 0; i < dynEntryPointFuncType.getNumParams(); i++)
+      argTypes.emplace_back(dynEntryPointFuncType.getParamType(i));
+    entryPointEntryBlock->addArguments(argTypes);
+    return *entryPointEntryBlock;
+  }
+
+  // Fill the memref pointed to by ptrToMemRef with the OMTensor, and return
+  // the data pointer of the OMTensor.
+  Value fillPtrToMemRefWithOMTensor(Value &rtMemRef, Value &ptrToMemRef,
+      PatternRewriter &rewriter, const Location &loc,
+      const std::map<API, ApiSpec> &apiRegistry, ModuleOp &module) const {
+    auto *context = module.getContext();
+    auto memRefPtrTy = ptrToMemRef.getType().dyn_cast<LLVM::LLVMPointerType>();
+    auto memRefTy = memRefPtrTy.getElementType();
+    auto int64Ty = IntegerType::get(context, 64);
+
+    Value memRef = rewriter.create<LLVM::UndefOp>(loc, memRefTy);
+
+    // Set dataPtr and alignedDataPtr;
+    Value opaqueDataPtr =
+        callApi(rewriter, loc, apiRegistry, API::GET_DATA, {rtMemRef});
+    Value dataPtr = rewriter.create<LLVM::BitcastOp>(
+        loc, memRefTy.cast<LLVM::LLVMStructType>().getBody()[0], opaqueDataPtr);
+    memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef,
+        dataPtr, rewriter.getArrayAttr({rewriter.getI32IntegerAttr(0)}));
+    memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef,
+        dataPtr, rewriter.getArrayAttr({rewriter.getI32IntegerAttr(1)}));
+
+    // Use zero offset now.
+    auto zero = rewriter.create<LLVM::ConstantOp>(
+        loc, int64Ty, rewriter.getI64IntegerAttr(0));
+    memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef, zero,
+        rewriter.getArrayAttr({rewriter.getI32IntegerAttr(2)}));
+
+    // Get rank, sizes array ptr and strides array ptr.
+    auto rank = getRankFromMemRefType(memRefTy.cast<LLVM::LLVMStructType>());
+    auto sizesArrayPtr =
+        callApi(rewriter, loc, apiRegistry, API::GET_DATA_SHAPE, {rtMemRef});
+    auto stridesArrayPtr =
+        callApi(rewriter, loc, apiRegistry, API::GET_DATA_STRIDES, {rtMemRef});
+
+    for (decltype(rank) i = 0; i < rank; i++) {
+      auto dimIdx = rewriter.create<LLVM::ConstantOp>(
+          loc, int64Ty, rewriter.getI64IntegerAttr(i));
+
+      // Insert size of the dimension.
+      auto dimSizePtr =
+          rewriter.create<LLVM::GEPOp>(loc, LLVM::LLVMPointerType::get(int64Ty),
+              sizesArrayPtr, ArrayRef<Value>({dimIdx}));
+      auto dimSize = rewriter.create<LLVM::LoadOp>(
+          loc, LLVM::LLVMPointerType::get(int64Ty), dimSizePtr);
+      memRef = rewriter.create<LLVM::InsertValueOp>(loc, memRefTy, memRef,
+          dimSize,
           rewriter.getArrayAttr(
               {rewriter.getI64IntegerAttr(3), rewriter.getI64IntegerAttr(i)}));
 
@@ -1104,20 +2003,55 @@ private:
     }
 
     rewriter.create<LLVM::StoreOp>(loc, memRef, ptrToMemRef);
+    return opaqueDataPtr;
+  }
+
+  // Whether the OMTensor of the i-th output owns its buffer.
+  static bool isOwning(ArrayAttr outputOwning, size_t i) {
+    return !outputOwning || outputOwning[i].cast<BoolAttr>().getValue();
+  }
+
+  // Whether the buffer of the i-th output may be the buffer of an input.
+  static bool mayViewInput(ArrayAttr outputMayViewInput, size_t i) {
+    return outputMayViewInput &&
+           outputMayViewInput[i].cast<BoolAttr>().getValue();
+  }
+
+  // Return the i32 ownership of the OMTensor of an output: true, i.e., free
+  // after OMTensor is destroyed, unless the buffer belongs to an input, a
+  // constant or another output. The outputs that may view an input own their
+  // buffer when it is none of the data of the inputs.
+  Value genOutputOwning(PatternRewriter &rewriter, Location loc,
+      Value outMemRef, bool outOwning, bool outMayViewInput,
+      ArrayRef<Value> inputDataPtrs) const {
+    auto int32Ty = IntegerType::get(rewriter.getContext(), 32);
+    if (!outOwning || !outMayViewInput)
+      return rewriter.create<LLVM::ConstantOp>(
+          loc, int32Ty, rewriter.getI32IntegerAttr(outOwning ? 1 : 0));
+    auto outMemRefTy = outMemRef.getType().cast<LLVM::LLVMStructType>();
+    Value allocatedPtr =
+        rewriter.create<LLVM::ExtractValueOp>(loc, outMemRefTy.getBody()[0],
+            outMemRef, rewriter.getArrayAttr({rewriter.getI64IntegerAttr(0)}));
+    Value owning = rewriter.create<LLVM::ConstantOp>(loc,
+        IntegerType::get(rewriter.getContext(), 1), rewriter.getBoolAttr(true));
+    for (Value inputDataPtr : inputDataPtrs) {
+      Value dataPtr = rewriter.create<LLVM::BitcastOp>(
+          loc, allocatedPtr.getType(), inputDataPtr);
+      owning = rewriter.create<LLVM::AndOp>(loc, owning,
+          rewriter.create<LLVM::ICmpOp>(
+              loc, LLVM::ICmpPredicate::ne, allocatedPtr, dataPtr));
+    }
+    return rewriter.create<LLVM::ZExtOp>(loc, int32Ty, owning);
   }
 
   void fillOMTensorWithMemRef(Value &outMemRef, Value &outOMTensor,
-      PatternRewriter &rewriter, const Location &loc,
+      Value owning, PatternRewriter &rewriter, const Location &loc,
       const std::map<API, ApiSpec> &apiRegistry, ModuleOp &module) const {
     auto *context = module.getContext();
     auto outMemRefTy = outMemRef.getType().dyn_cast<LLVM::LLVMStructType>();
     auto int64Ty = IntegerType::get(context, 64);
     auto int32Ty = IntegerType::get(context, 32);
 
-    // Set ownership to true, i.e., free after OMTensor is destroyed.
-    Value owning = rewriter.create<LLVM::ConstantOp>(
-        loc, int32Ty, rewriter.getI32IntegerAttr(1));
-
     // Extract the allocated pointer.
     Value outMemRefAllocatedPtr =
         rewriter.create<LLVM::ExtractValueOp>(loc, outMemRefTy.getBody()[0],
@@ -1317,6 +2251,213 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlMatMulMicroKernelOpLowering
+//===----------------------------------------------------------------------===//
+
+class KrnlMatMulMicroKernelOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlMatMulMicroKernelOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(
+            KrnlMatMulMicroKernelOp::getOperationName(), context, lowering_) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto *context = op->getContext();
+    auto loc = op->getLoc();
+    auto kernelOp = cast<KrnlMatMulMicroKernelOp>(op);
+    KrnlMatMulMicroKernelOpAdaptor transformed(
+        operands, op->getAttrDictionary());
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+
+    // Declare the runtime function, its signature is:
+    //   * `void (i64, i64, i64, f32*, i64, f32*, i64, f32*, i64)`
+    auto llvmI64Ty = IntegerType::get(context, 64);
+    auto llvmF32PtrTy = LLVM::LLVMPointerType::get(rewriter.getF32Type());
+    auto kernelRef = getOrInsertExternFunc("omMatmulMicroKernelF32", module,
+        LLVM::LLVMFunctionType::get(LLVM::LLVMVoidType::get(context),
+            ArrayRef<Type>({llvmI64Ty, llvmI64Ty, llvmI64Ty, llvmF32PtrTy,
+                llvmI64Ty, llvmF32PtrTy, llvmI64Ty, llvmF32PtrTy, llvmI64Ty}),
+            /*isVarArg=*/false),
+        rewriter);
+
+    SmallVector<Value, 9> args;
+    for (int64_t size :
+        {kernelOp.iTile(), kernelOp.jTile(), kernelOp.kTile()})
+      args.emplace_back(rewriter.create<LLVM::ConstantOp>(
+          loc, llvmI64Ty, rewriter.getI64IntegerAttr(size)));
+    // Each tile is given by the address of its first element and the stride
+    // of its rows.
+    auto addTile = [&](Value memref, Value llvmMemref, ValueRange indices) {
+      auto memRefTy = memref.getType().cast<MemRefType>();
+      args.emplace_back(
+          getStridedElementPtr(loc, memRefTy, llvmMemref, indices, rewriter));
+      MemRefDescriptor descriptor(llvmMemref);
+      args.emplace_back(
+          descriptor.stride(rewriter, loc, memRefTy.getRank() - 2));
+    };
+    addTile(kernelOp.A(), transformed.A(), transformed.aStart());
+    addTile(kernelOp.B(), transformed.B(), transformed.bStart());
+    addTile(kernelOp.C(), transformed.C(), transformed.cStart());
+
+    rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}), kernelRef, args);
+    rewriter.eraseOp(op);
+    return success();
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlSgemmOpLowering
+//===----------------------------------------------------------------------===//
+
+/// Lower krnl.sgemm to a call to the sgemm of the external BLAS library:
+/// `cblas_sgemm` of the CBLAS interface (OpenBLAS, MKL, ...), or `dnnl_sgemm`
+/// of oneDNN.
+class KrnlSgemmOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlSgemmOpLowering(MLIRContext *context,
+      LLVMTypeConverter &lowering_, StringRef blasLibrary)
+      : ConvertToLLVMPattern(
+            KrnlSgemmOp::getOperationName(), context, lowering_),
+        blasLibrary(blasLibrary.str()) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto *context = op->getContext();
+    auto loc = op->getLoc();
+    auto sgemmOp = cast<KrnlSgemmOp>(op);
+    KrnlSgemmOpAdaptor transformed(operands, op->getAttrDictionary());
+    ModuleOp module = op->getParentOfType<ModuleOp>();
+    bool transA = sgemmOp.transA(), transB = sgemmOp.transB();
+
+    // Each matrix is given by the address of its first element and the
+    // stride of its rows.
+    auto llvmI64Ty = IntegerType::get(context, 64);
+    Value zero = rewriter.create<LLVM::ConstantOp>(
+        loc, llvmI64Ty, rewriter.getI64IntegerAttr(0));
+    auto getMatrix = [&](Value memref, Value llvmMemref, ValueRange prefix) {
+      auto memRefTy = memref.getType().cast<MemRefType>();
+      SmallVector<Value, 4> indices(prefix.begin(), prefix.end());
+      indices.append({zero, zero});
+      Value ptr =
+          getStridedElementPtr(loc, memRefTy, llvmMemref, indices, rewriter);
+      MemRefDescriptor descriptor(llvmMemref);
+      Value ld = descriptor.stride(rewriter, loc, memRefTy.getRank() - 2);
+      return std::make_pair(ptr, ld);
+    };
+    auto a = getMatrix(sgemmOp.A(), transformed.A(), transformed.aPrefix());
+    auto b = getMatrix(sgemmOp.B(), transformed.B(), transformed.bPrefix());
+    auto c = getMatrix(sgemmOp.C(), transformed.C(), transformed.cPrefix());
+
+    // The sizes of the product, K being taken from A.
+    int64_t aRank = sgemmOp.A().getType().cast<MemRefType>().getRank();
+    int64_t cRank = sgemmOp.C().getType().cast<MemRefType>().getRank();
+    MemRefDescriptor aDescriptor(transformed.A());
+    MemRefDescriptor cDescriptor(transformed.C());
+    Value M = cDescriptor.size(rewriter, loc, cRank - 2);
+    Value N = cDescriptor.size(rewriter, loc, cRank - 1);
+    Value K = aDescriptor.size(rewriter, loc, transA ? aRank - 2 : aRank - 1);
+
+    auto llvmF32Ty = rewriter.getF32Type();
+    auto llvmF32PtrTy = LLVM::LLVMPointerType::get(llvmF32Ty);
+    auto getF32Constant = [&](APFloat value) -> Value {
+      return rewriter.create<LLVM::ConstantOp>(
+          loc, llvmF32Ty, rewriter.getF32FloatAttr(value.convertToFloat()));
+    };
+    Value alpha = getF32Constant(sgemmOp.alpha());
+    Value beta = getF32Constant(sgemmOp.beta());
+
+    if (blasLibrary == "dnnl") {
+      // The signature is:
+      //   * `i32 (i8, i8, i64, i64, i64, f32, f32*, i64, f32*, i64, f32,
+      //           f32*, i64)`
+      // with the 'N' or 'T' transposition of A and B.
+      auto llvmI8Ty = IntegerType::get(context, 8);
+      auto sgemmRef = getOrInsertExternFunc("dnnl_sgemm", module,
+          LLVM::LLVMFunctionType::get(IntegerType::get(context, 32),
+              ArrayRef<Type>({llvmI8Ty, llvmI8Ty, llvmI64Ty, llvmI64Ty,
+                  llvmI64Ty, llvmF32Ty, llvmF32PtrTy, llvmI64Ty, llvmF32PtrTy,
+                  llvmI64Ty, llvmF32Ty, llvmF32PtrTy, llvmI64Ty}),
+              /*isVarArg=*/false),
+          rewriter);
+      auto getTrans = [&](bool trans) -> Value {
+        return rewriter.create<LLVM::ConstantOp>(
+            loc, llvmI8Ty, rewriter.getI8IntegerAttr(trans ? 'T' : 'N'));
+      };
+      rewriter.create<LLVM::CallOp>(loc,
+          ArrayRef<Type>({IntegerType::get(context, 32)}), sgemmRef,
+          ArrayRef<Value>({getTrans(transA), getTrans(transB), M, N, K,
+              alpha, a.first, a.second, b.first, b.second, beta, c.first,
+              c.second}));
+    } else {
+      // The signature is:
+      //   * `void (i32, i32, i32, i32, i32, i32, f32, f32*, i32, f32*, i32,
+      //            f32, f32*, i32)`
+      // with the CblasRowMajor (101) layout, and the CblasNoTrans (111) or
+      // CblasTrans (112) transposition of A and B.
+      auto llvmI32Ty = IntegerType::get(context, 32);
+      auto sgemmRef = getOrInsertExternFunc("cblas_sgemm", module,
+          LLVM::LLVMFunctionType::get(LLVM::LLVMVoidType::get(context),
+              ArrayRef<Type>({llvmI32Ty, llvmI32Ty, llvmI32Ty, llvmI32Ty,
+                  llvmI32Ty, llvmI32Ty, llvmF32Ty, llvmF32PtrTy, llvmI32Ty,
+                  llvmF32PtrTy, llvmI32Ty, llvmF32Ty, llvmF32PtrTy,
+                  llvmI32Ty}),
+              /*isVarArg=*/false),
+          rewriter);
+      auto getI32Constant = [&](int32_t value) -> Value {
+        return rewriter.create<LLVM::ConstantOp>(
+            loc, llvmI32Ty, rewriter.getI32IntegerAttr(value));
+      };
+      auto toI32 = [&](Value value) -> Value {
+        return rewriter.create<LLVM::TruncOp>(loc, llvmI32Ty, value);
+      };
+      rewriter.create<LLVM::CallOp>(loc, ArrayRef<Type>({}), sgemmRef,
+          ArrayRef<Value>({getI32Constant(101),
+              getI32Constant(transA ? 112 : 111),
+              getI32Constant(transB ? 112 : 111), toI32(M), toI32(N),
+              toI32(K), alpha, a.first, toI32(a.second), b.first,
+              toI32(b.second), beta, c.first, toI32(c.second)}));
+    }
+    rewriter.eraseOp(op);
+    return success();
+  }
+
+private:
+  std::string blasLibrary;
+};
+
+//===----------------------------------------------------------------------===//
+// KRNL to LLVM: KrnlNonTemporalStoreOpLowering
+//===----------------------------------------------------------------------===//
+
+/// Lower the std.store operations coming from non-temporal krnl.store
+/// operations to LLVM stores with the non-temporal metadata. It takes
+/// precedence over the std.store lowering of the Standard to LLVM patterns.
+class KrnlNonTemporalStoreOpLowering : public ConvertToLLVMPattern {
+public:
+  explicit KrnlNonTemporalStoreOpLowering(
+      MLIRContext *context, LLVMTypeConverter &lowering_)
+      : ConvertToLLVMPattern(memref::StoreOp::getOperationName(), context,
+            lowering_, /*benefit=*/2) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const override {
+    auto storeOp = cast<memref::StoreOp>(op);
+    if (!storeOp->hasAttr(KrnlStoreOp::getNonTemporalAttrName()))
+      return failure();
+
+    memref::StoreOp::Adaptor transformed(operands);
+    Value dataPtr = getStridedElementPtr(op->getLoc(),
+        storeOp.getMemRefType(), transformed.memref(), transformed.indices(),
+        rewriter);
+    rewriter.replaceOpWithNewOp<LLVM::StoreOp>(op, transformed.value(),
+        dataPtr, /*alignment=*/0, /*isVolatile=*/false,
+        /*isNonTemporal=*/true);
+    return success();
+  }
+};
+
 } // end namespace
 
 void mlir::populateAffineAndKrnlToLLVMConversion(RewritePatternSet &patterns,
@@ -1334,10 +2475,14 @@ void mlir::populateAffineAndKrnlToLLVMConversion(RewritePatternSet &patterns,
   populateVectorToLLVMMatrixConversionPatterns(typeConverter, patterns);
   populateStdExpandOpsPatterns(patterns);
   populateStdToLLVMConversionPatterns(typeConverter, patterns);
+  populateOpenMPToLLVMConversionPatterns(typeConverter, patterns);
 
-  patterns.insert<KrnlGlobalOpLowering, KrnlVectorTypeCastOpLowering>(
+  patterns.insert<KrnlGlobalOpLowering, KrnlArenaOpLowering,
+      KrnlInstrumentOpLowering, KrnlVectorTypeCastOpLowering,
+      KrnlNonTemporalStoreOpLowering, KrnlMatMulMicroKernelOpLowering>(
+      ctx, typeConverter);
+  patterns.insert<KrnlGetRefOpLowering, KrnlStrideOpLowering>(
       ctx, typeConverter);
-  patterns.insert<KrnlGetRefOpLowering>(ctx, typeConverter);
   patterns.insert<KrnlMemcpyOpLowering, KrnlEntryPointOpLowering>(ctx);
 
   // Math library functions.
@@ -1356,13 +2501,1054 @@ void mlir::populateAffineAndKrnlToLLVMConversion(RewritePatternSet &patterns,
 //===----------------------------------------------------------------------===//
 
 namespace {
+
+/// Return a symbol reference to the thread pool runtime function executing
+/// parallel loops, inserting it into the module if necessary. The signature is:
+///   * `void (i64, i64, i64, void (i64, i64, i64, i8*)*, i8*)`
+static FlatSymbolRefAttr getOrInsertParallelFor(
+    OpBuilder &builder, ModuleOp module, LLVM::LLVMFunctionType bodyFnType) {
+  auto *context = module.getContext();
+  StringRef funcName = "omThreadPoolParallelFor";
+  if (module.lookupSymbol<LLVM::LLVMFuncOp>(funcName))
+    return SymbolRefAttr::get(context, funcName);
+  auto llvmVoidTy = LLVM::LLVMVoidType::get(context);
+  auto llvmI8PtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+  auto llvmI64Ty = IntegerType::get(context, 64);
+  auto llvmFnType = LLVM::LLVMFunctionType::get(llvmVoidTy,
+      ArrayRef<mlir::Type>({llvmI64Ty, llvmI64Ty, llvmI64Ty,
+          LLVM::LLVMPointerType::get(bodyFnType), llvmI8PtrTy}),
+      false);
+
+  OpBuilder::InsertionGuard insertGuard(builder);
+  builder.setInsertionPointToStart(module.getBody());
+  builder.create<LLVM::LLVMFuncOp>(module.getLoc(), funcName, llvmFnType);
+  return SymbolRefAttr::get(context, funcName);
+}
+
+/// Replace a parallel loop lowered to the OpenMP dialect, i.e.
+///
+///   omp.parallel {
+///     omp.wsloop (%iv) : i64 = (%lb) to (%ub) step (%step) {
+///       <body>
+///       omp.yield
+///     }
+///     omp.terminator
+///   }
+///
+/// by a call to the thread pool of the runtime. The loop body is outlined into
+/// an internal function iterating over a chunk of the loop:
+///
+///   llvm.func internal @<func>_parallel_body_<id>(%lb, %ub, %step, %args)
+///
+/// and the values used by the body but defined outside of it are passed
+/// through a stack allocated struct pointed to by `%args`. Constants are
+/// cloned into the outlined function instead.
+static LogicalResult outlineParallelLoop(
+    omp::ParallelOp parallelOp, ModuleOp module, unsigned id) {
+  Location loc = parallelOp.getLoc();
+  Block &parallelBlock = parallelOp.region().front();
+  auto wsLoopOp = dyn_cast<omp::WsLoopOp>(parallelBlock.front());
+  if (!parallelOp.region().hasOneBlock() ||
+      parallelBlock.getOperations().size() != 2 || !wsLoopOp ||
+      wsLoopOp.lowerBound().size() != 1)
+    return parallelOp.emitError("unsupported parallel loop");
+
+  auto *context = module.getContext();
+  auto llvmVoidTy = LLVM::LLVMVoidType::get(context);
+  auto llvmI8PtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+  auto llvmI32Ty = IntegerType::get(context, 32);
+  auto llvmI64Ty = IntegerType::get(context, 64);
+  Value lb = wsLoopOp.lowerBound()[0];
+  Value ub = wsLoopOp.upperBound()[0];
+  Value step = wsLoopOp.step()[0];
+  if (lb.getType() != llvmI64Ty)
+    return parallelOp.emitError("parallel loop must use 64-bit indices");
+
+  // Values defined above the loop body, except constants, are captured.
+  Region &loopRegion = wsLoopOp.region();
+  llvm::SetVector<Value> usedValues;
+  getUsedValuesDefinedAbove(loopRegion, usedValues);
+  SmallVector<Value, 8> captures;
+  SmallVector<LLVM::ConstantOp, 8> constants;
+  for (Value value : usedValues) {
+    if (auto constantOp = value.getDefiningOp<LLVM::ConstantOp>())
+      constants.emplace_back(constantOp);
+    else
+      captures.emplace_back(value);
+  }
+  SmallVector<Type, 8> captureTypes;
+  for (Value value : captures)
+    captureTypes.emplace_back(value.getType());
+  auto argsStructTy = LLVM::LLVMStructType::getLiteral(context, captureTypes);
+  auto argsStructPtrTy = LLVM::LLVMPointerType::get(argsStructTy);
+
+  // Create the outlined function after the function containing the loop.
+  auto parentFunc = parallelOp->getParentOfType<LLVM::LLVMFuncOp>();
+  auto bodyFnType = LLVM::LLVMFunctionType::get(llvmVoidTy,
+      ArrayRef<Type>({llvmI64Ty, llvmI64Ty, llvmI64Ty, llvmI8PtrTy}), false);
+  OpBuilder builder(context);
+  builder.setInsertionPointAfter(parentFunc);
+  std::string bodyName = (parentFunc.getName() + "_parallel_body_" +
+                          std::to_string(id))
+                             .str();
+  auto bodyFunc = builder.create<LLVM::LLVMFuncOp>(
+      loc, bodyName, bodyFnType, LLVM::Linkage::Internal);
+  Region &bodyRegion = bodyFunc.getBody();
+
+  // Entry block: materialize the captured values and the constants.
+  Block *entryBlock = bodyFunc.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  Value chunkLb = entryBlock->getArgument(0);
+  Value chunkUb = entryBlock->getArgument(1);
+  Value chunkStep = entryBlock->getArgument(2);
+  Value argsPtr = builder.create<LLVM::BitcastOp>(
+      loc, argsStructPtrTy, entryBlock->getArgument(3));
+  auto zero = builder.create<LLVM::ConstantOp>(
+      loc, llvmI32Ty, builder.getI32IntegerAttr(0));
+  for (unsigned i = 0; i < captures.size(); ++i) {
+    auto index = builder.create<LLVM::ConstantOp>(
+        loc, llvmI32Ty, builder.getI32IntegerAttr(i));
+    auto fieldPtr = builder.create<LLVM::GEPOp>(loc,
+        LLVM::LLVMPointerType::get(captureTypes[i]), argsPtr,
+        ArrayRef<Value>({zero, index}));
+    Value field = builder.create<LLVM::LoadOp>(loc, fieldPtr);
+    replaceAllUsesInRegionWith(captures[i], field, loopRegion);
+  }
+  for (LLVM::ConstantOp constantOp : constants) {
+    Operation *clone = builder.clone(*constantOp.getOperation());
+    replaceAllUsesInRegionWith(
+        constantOp.getResult(), clone->getResult(0), loopRegion);
+  }
+
+  // Header block: iterate over the chunk.
+  Block *headerBlock =
+      builder.createBlock(&bodyRegion, bodyRegion.end(), {llvmI64Ty});
+  builder.setInsertionPointToEnd(entryBlock);
+  builder.create<LLVM::BrOp>(loc, ValueRange({chunkLb}), headerBlock);
+  Value iv = headerBlock->getArgument(0);
+
+  // Move the loop body, whose entry block takes the induction variable.
+  Block *loopEntryBlock = &loopRegion.front();
+  bodyRegion.getBlocks().splice(bodyRegion.end(), loopRegion.getBlocks());
+  Block *exitBlock = builder.createBlock(&bodyRegion, bodyRegion.end());
+  builder.create<LLVM::ReturnOp>(loc, ValueRange());
+
+  builder.setInsertionPointToEnd(headerBlock);
+  Value cond = builder.create<LLVM::ICmpOp>(
+      loc, LLVM::ICmpPredicate::slt, iv, chunkUb);
+  builder.create<LLVM::CondBrOp>(loc, cond, loopEntryBlock, ValueRange({iv}),
+      exitBlock, ValueRange());
+
+  // Each omp.yield increments the induction variable and jumps to the header.
+  SmallVector<omp::YieldOp, 2> yieldOps;
+  bodyFunc.walk([&](omp::YieldOp yieldOp) { yieldOps.emplace_back(yieldOp); });
+  for (omp::YieldOp yieldOp : yieldOps) {
+    builder.setInsertionPoint(yieldOp);
+    Value nextIv = builder.create<LLVM::AddOp>(loc, iv, chunkStep);
+    builder.create<LLVM::BrOp>(loc, ValueRange({nextIv}), headerBlock);
+    yieldOp.erase();
+  }
+
+  // Store the captured values in a struct allocated in the entry block of the
+  // parent function, so that loops nested in sequential loops do not grow the
+  // stack, and call the thread pool. A loop nested in a parallel loop is
+  // outlined after it, its parent function being the outlined body of each
+  // chunk: the chunks run concurrently do not share the struct.
+  builder.setInsertionPointToStart(&parentFunc.getBody().front());
+  Value args;
+  if (captures.empty()) {
+    args = builder.create<LLVM::NullOp>(loc, llvmI8PtrTy);
+  } else {
+    auto one = builder.create<LLVM::ConstantOp>(
+        loc, llvmI64Ty, builder.getI64IntegerAttr(1));
+    args = builder.create<LLVM::AllocaOp>(
+        loc, argsStructPtrTy, one, /*alignment=*/0);
+  }
+  builder.setInsertionPoint(parallelOp);
+  Value argsI8Ptr = args;
+  if (!captures.empty()) {
+    auto zero = builder.create<LLVM::ConstantOp>(
+        loc, llvmI32Ty, builder.getI32IntegerAttr(0));
+    for (unsigned i = 0; i < captures.size(); ++i) {
+      auto index = builder.create<LLVM::ConstantOp>(
+          loc, llvmI32Ty, builder.getI32IntegerAttr(i));
+      auto fieldPtr = builder.create<LLVM::GEPOp>(loc,
+          LLVM::LLVMPointerType::get(captureTypes[i]), args,
+          ArrayRef<Value>({zero, index}));
+      builder.create<LLVM::StoreOp>(loc, captures[i], fieldPtr);
+    }
+    argsI8Ptr = builder.create<LLVM::BitcastOp>(loc, llvmI8PtrTy, args);
+  }
+  Value bodyPtr = builder.create<LLVM::AddressOfOp>(loc, bodyFunc);
+  auto parallelForRef = getOrInsertParallelFor(builder, module, bodyFnType);
+  builder.create<LLVM::CallOp>(loc, ArrayRef<Type>({}), parallelForRef,
+      ArrayRef<Value>({lb, ub, step, bodyPtr, argsI8Ptr}));
+  parallelOp.erase();
+  return success();
+}
+
+// Store the i-th bytes of the elements of the given width together, the
+// bytes after the last whole element following them.
+static std::string shuffleBytes(StringRef data, uint64_t width) {
+  std::string shuffled(data.size(), 0);
+  uint64_t n = data.size() / width;
+  for (uint64_t i = 0; i < n; ++i)
+    for (uint64_t b = 0; b < width; ++b)
+      shuffled[b * n + i] = data[i * width + b];
+  std::copy(data.begin() + n * width, data.end(), shuffled.begin() + n * width);
+  return shuffled;
+}
+
+// Append the extra bytes of a length of the LZ sequences.
+static void appendLZLength(std::string &out, uint64_t length) {
+  for (; length >= 255; length -= 255)
+    out.push_back((char)255);
+  out.push_back((char)length);
+}
+
+// Compress the data with the LZ77 codec decompressed by omWeightsLoad, the
+// matches being found greedily through a hash table of the last position of
+// each 4-byte sequence.
+static std::string compressLZ(StringRef data) {
+  const unsigned char *in = data.bytes_begin();
+  uint64_t size = data.size();
+  const unsigned hashBits = 16;
+  std::vector<int64_t> lastPos(1 << hashBits, -1);
+  auto read32 = [&](uint64_t pos) {
+    return llvm::support::endian::read32le(in + pos);
+  };
+  std::string out;
+  auto appendSequence = [&](uint64_t anchor, uint64_t literals,
+                            uint64_t offset, uint64_t match) {
+    uint64_t matchCode = match ? match - 4 : 0;
+    out.push_back((char)((std::min<uint64_t>(literals, 15) << 4) |
+                         std::min<uint64_t>(matchCode, 15)));
+    if (literals >= 15)
+      appendLZLength(out, literals - 15);
+    out.append((const char *)in + anchor, literals);
+    if (!match)
+      return;
+    out.push_back((char)(offset & 255));
+    out.push_back((char)(offset >> 8));
+    if (matchCode >= 15)
+      appendLZLength(out, matchCode - 15);
+  };
+
+  uint64_t anchor = 0, pos = 0;
+  while (pos + 4 <= size) {
+    uint32_t hash = (read32(pos) * 2654435761u) >> (32 - hashBits);
+    int64_t candidate = lastPos[hash];
+    lastPos[hash] = pos;
+    if (candidate < 0 || pos - candidate > 65535 ||
+        read32(candidate) != read32(pos)) {
+      ++pos;
+      continue;
+    }
+    uint64_t match = 4;
+    while (pos + match < size && in[candidate + match] == in[pos + match])
+      ++match;
+    appendSequence(anchor, pos - anchor, pos - candidate, match);
+    pos += match;
+    anchor = pos;
+  }
+  // The last sequence only has literals.
+  appendSequence(anchor, size - anchor, 0, 0);
+  return out;
+}
+
+// Write the weights to the weights file, compressed when it makes the file
+// smaller.
+static void writeCompressedWeights(llvm::raw_ostream &os, StringRef data) {
+  std::string compressed =
+      compressLZ(shuffleBytes(data, compressedWeightsWidth));
+  if (compressed.size() + compressedWeightsHeaderSize >= data.size()) {
+    os << data;
+    return;
+  }
+  using llvm::support::endian::write;
+  os << compressedWeightsMagic;
+  write<uint32_t>(os, compressedWeightsWidth, llvm::support::little);
+  write<uint64_t>(os, data.size(), llvm::support::little);
+  write<uint64_t>(os, compressed.size(), llvm::support::little);
+  os.write_zeros(compressedWeightsHeaderSize - 24);
+  os << compressed;
+}
+
+// Write the data of the large constant globals to the weights file, at
+// aligned offsets, and record these offsets on the globals instead of their
+// values. The _weights global, holding the address of the mapped file, is only
+// created when some weights are moved. The global is internal, so that the
+// code of the model reads its own weights whatever the other models loaded in
+// the process, and its address is returned by omModelWeights. With numaWeights, it records the size
+// of the file for the runtime to replicate it on each NUMA node. With
+// compressWeights, the file is compressed and decompressed by the runtime
+// when it is loaded, the offsets being those of the decompressed weights.
+static LogicalResult moveWeightsToFile(ModuleOp module, StringRef weightsFile,
+    bool numaWeights, bool compressWeights = false) {
+  std::error_code error;
+  llvm::raw_fd_ostream fileStream(weightsFile, error, llvm::sys::fs::F_None);
+  if (error)
+    return module.emitError("cannot open the weights file ")
+           << weightsFile << ": " << error.message();
+  // The compressed weights are gathered before they are compressed.
+  std::string weights;
+  llvm::raw_string_ostream weightsStream(weights);
+  llvm::raw_ostream &os =
+      compressWeights ? (llvm::raw_ostream &)weightsStream : fileStream;
+
+  MLIRContext *context = module.getContext();
+  uint64_t fileSize = 0;
+  llvm::StringMap<uint64_t> offsets;
+  WalkResult result = module.walk([&](KrnlGlobalOp globalOp) {
+    // The globals with the same name share their data in the file.
+    auto it = offsets.find(globalOp.name());
+    if (it != offsets.end()) {
+      globalOp->setAttr(weightsOffsetAttrName,
+          IntegerAttr::get(IntegerType::get(context, 64), it->second));
+      globalOp->removeAttr("value");
+      return WalkResult::advance();
+    }
+    std::unique_ptr<llvm::MemoryBuffer> externalData;
+    std::vector<char> rawData;
+    StringRef data;
+    if (hasExternalData(globalOp)) {
+      // External data is copied from its file without being materialized.
+      auto memRefTy = globalOp.getResult().getType().cast<MemRefType>();
+      externalData = loadExternalData(globalOp,
+          memRefTy.getNumElements() * getMemRefEltSizeInBytes(memRefTy));
+      if (!externalData)
+        return WalkResult::interrupt();
+      data = externalData->getBuffer();
+    } else if (!globalOp.value().hasValue()) {
+      return WalkResult::advance();
+    } else if (auto opaqueAttr =
+                   globalOp.valueAttr().dyn_cast<OpaqueElementsAttr>()) {
+      data = opaqueAttr.getValue();
+    } else if (auto denseAttr =
+                   globalOp.valueAttr().dyn_cast<DenseElementsAttr>()) {
+      if (denseAttr.isSplat())
+        return WalkResult::advance();
+      rawData = denseAttr.getRawData();
+      data = StringRef(rawData.data(), rawData.size());
+    } else {
+      return WalkResult::advance();
+    }
+    if ((int64_t)data.size() <= weightsFileMinBytes)
+      return WalkResult::advance();
+
+    uint64_t offset = llvm::alignTo(fileSize, weightsAlignment);
+    os.write_zeros(offset - fileSize);
+    os << data;
+    fileSize = offset + data.size();
+    offsets[globalOp.name()] = offset;
+    globalOp->setAttr(weightsOffsetAttrName,
+        IntegerAttr::get(IntegerType::get(context, 64), offset));
+    globalOp->removeAttr("value");
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+  if (fileSize == 0)
+    return success();
+  if (compressWeights)
+    writeCompressedWeights(fileStream, weightsStream.str());
+
+  OpBuilder builder(module.getBodyRegion());
+  Location loc = module.getLoc();
+  auto llvmI8PtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+  auto weightsGlobal = builder.create<LLVM::GlobalOp>(loc, llvmI8PtrTy,
+      /*isConstant=*/false, LLVM::Linkage::Internal, weightsGlobalName,
+      Attribute());
+  builder.createBlock(&weightsGlobal.getInitializerRegion());
+  Value null = builder.create<LLVM::NullOp>(loc, llvmI8PtrTy);
+  builder.create<LLVM::ReturnOp>(loc, ValueRange({null}));
+  if (numaWeights)
+    weightsGlobal->setAttr(weightsNumaSizeAttrName,
+        IntegerAttr::get(IntegerType::get(context, 64), fileSize));
+  return success();
+}
+
+/*!
+ *  Module pass that writes the large constants to the weights file before
+ *  the lowering to LLVM, which then only reads their offsets. The module
+ *  left, without the values of the weights, is the code of the shared
+ *  library, reused by the compilation cache for new weights.
+ */
+struct MoveWeightsToFilePass
+    : public PassWrapper<MoveWeightsToFilePass, OperationPass<ModuleOp>> {
+  MoveWeightsToFilePass() = default;
+  MoveWeightsToFilePass(const MoveWeightsToFilePass &pass) {}
+  MoveWeightsToFilePass(
+      std::string weightsFile, bool numaWeights, bool compressWeights) {
+    this->weightsFile = weightsFile;
+    this->numaWeights = numaWeights;
+    this->compressWeights = compressWeights;
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<LLVM::LLVMDialect>();
+  }
+
+  void runOnOperation() final {
+    if (weightsFile.empty())
+      return;
+    if (failed(moveWeightsToFile(
+            getOperation(), weightsFile, numaWeights, compressWeights)))
+      signalPassFailure();
+  }
+
+  Option<std::string> weightsFile{*this, "weights-file",
+      llvm::cl::desc("Write the large constants to this file."),
+      llvm::cl::init("")};
+
+  Option<bool> numaWeights{*this, "numa-weights",
+      llvm::cl::desc("Read the weights file from its replica on the local "
+                     "NUMA node."),
+      llvm::cl::init(false)};
+
+  Option<bool> compressWeights{*this, "compress-weights",
+      llvm::cl::desc("Compress the weights file, decompressed by the runtime "
+                     "when it is loaded."),
+      llvm::cl::init(false)};
+};
+
 struct ConvertKrnlToLLVMPass
     : public PassWrapper<ConvertKrnlToLLVMPass, OperationPass<ModuleOp>> {
+  // Make sure that we have a valid default constructor and copy
+  // constructor to make sure that the options are initialized properly.
+  ConvertKrnlToLLVMPass() = default;
+  ConvertKrnlToLLVMPass(const ConvertKrnlToLLVMPass &pass) {}
+  ConvertKrnlToLLVMPass(std::string weightsFile, bool numaWeights,
+      std::string blasLibrary, bool unchecked) {
+    this->weightsFile = weightsFile;
+    this->numaWeights = numaWeights;
+    this->blasLibrary = blasLibrary;
+    this->unchecked = unchecked;
+  }
+
   void runOnOperation() final;
+
+  // Write the constants larger than weightsFileMinBytes to this file instead
+  // of LLVM globals, the runtime maps it when the model is loaded.
+  Option<std::string> weightsFile{*this, "weights-file",
+      llvm::cl::desc("Write the large constants to this file instead of "
+                     "LLVM globals."),
+      llvm::cl::init("")};
+
+  // Read the weights file from its replica on the NUMA node of the calling
+  // thread, the runtime replicating it when NUMA placement is enabled.
+  Option<bool> numaWeights{*this, "numa-weights",
+      llvm::cl::desc("Read the weights file from its replica on the local "
+                     "NUMA node."),
+      llvm::cl::init(false)};
+
+  // The BLAS library whose sgemm is called by krnl.sgemm: "cblas" for the
+  // CBLAS interface of e.g. OpenBLAS or MKL, or "dnnl" for oneDNN.
+  Option<std::string> blasLibrary{*this, "blas-library",
+      llvm::cl::desc("BLAS interface called by krnl.sgemm: cblas or dnnl."),
+      llvm::cl::init("cblas")};
+
+  // Trust the inputs of the entry points: their signatures are not checked,
+  // their dynamic dims are assumed positive and their buffers distinct.
+  Option<bool> unchecked{*this, "unchecked",
+      llvm::cl::desc("Trust the inputs of the entry points to match their "
+                     "signatures."),
+      llvm::cl::init(false)};
 };
 } // end anonymous namespace
 
+// Return the buffer of which the value is a view.
+static Value getViewedBuffer(Value value) {
+  while (Operation *op = value.getDefiningOp()) {
+    if (auto viewOp = dyn_cast<ViewLikeOpInterface>(op))
+      value = viewOp.getViewSource();
+    else if (auto castOp = dyn_cast<memref::CastOp>(op))
+      value = castOp.source();
+    else if (auto reinterpretCastOp = dyn_cast<memref::ReinterpretCastOp>(op))
+      value = reinterpretCastOp.source();
+    else
+      break;
+  }
+  return value;
+}
+
+// Collect the buffers viewed by the values a block argument receives from the
+// branches to its block. Return false if a predecessor is not a branch.
+static bool getIncomingBuffers(
+    BlockArgument arg, SmallVectorImpl<Value> &buffers) {
+  Block *block = arg.getOwner();
+  for (auto it = block->pred_begin(), end = block->pred_end(); it != end;
+       ++it) {
+    auto branchOp = dyn_cast<BranchOpInterface>((*it)->getTerminator());
+    if (!branchOp)
+      return false;
+    Optional<OperandRange> operands =
+        branchOp.getSuccessorOperands(it.getSuccessorIndex());
+    if (!operands)
+      return false;
+    buffers.emplace_back(getViewedBuffer((*operands)[arg.getArgNumber()]));
+  }
+  return true;
+}
+
+// Record on each entry point whether the buffer of each output is allocated
+// by the entry point function, so that the OMTensor of the output owns it.
+// The outputs forwarding an input (e.g. Identity), viewing a constant, or
+// returning the buffer of a previous output do not own their buffer. Their
+// OMTensors point to it without a copy. The outputs merging a buffer
+// allocated by the function and a view of an input, e.g. a Concat appended in
+// place in the capacity of its input, own their buffer when it is not the
+// buffer of an input, which the entry point checks when it runs. The analysis
+// is conservative across the shape specializations of the function.
+static void analyzeOutputOwnership(ModuleOp module) {
+  Builder builder(module.getContext());
+  module.walk([&](KrnlEntryPointOp entryPointOp) {
+    SmallVector<StringRef, 4> funcNames;
+    funcNames.emplace_back(
+        entryPointOp
+            ->getAttrOfType<SymbolRefAttr>(
+                KrnlEntryPointOp::getEntryPointFuncAttrName())
+            .getLeafReference());
+    if (auto specializations = entryPointOp->getAttrOfType<ArrayAttr>(
+            KrnlEntryPointOp::getSpecializationsAttrName()))
+      for (Attribute attr : specializations)
+        funcNames.emplace_back(attr.cast<DictionaryAttr>()
+                                   .get("func")
+                                   .cast<FlatSymbolRefAttr>()
+                                   .getValue());
+
+    SmallVector<bool, 4> owning, mayViewInput;
+    for (StringRef funcName : funcNames) {
+      FuncOp func = module.lookupSymbol<FuncOp>(funcName);
+      if (!func || func.isExternal())
+        return;
+      if (owning.empty()) {
+        owning.assign(func.getType().getNumResults(), true);
+        mayViewInput.assign(func.getType().getNumResults(), false);
+      }
+      Block *entryBlock = &func.front();
+      func.walk([&](ReturnOp returnOp) {
+        llvm::SmallPtrSet<Value, 4> returnedBuffers;
+        for (auto operand : llvm::enumerate(returnOp.getOperands())) {
+          Value buffer = getViewedBuffer(operand.value());
+          auto arg = buffer.dyn_cast<BlockArgument>();
+          SmallVector<Value, 2> incomingBuffers;
+          if (!arg || arg.getOwner() == entryBlock ||
+              !getIncomingBuffers(arg, incomingBuffers)) {
+            if (!buffer.getDefiningOp<memref::AllocOp>() ||
+                !returnedBuffers.insert(buffer).second)
+              owning[operand.index()] = false;
+            continue;
+          }
+          bool viewsInput = false;
+          for (Value incomingBuffer : incomingBuffers) {
+            auto incomingArg = incomingBuffer.dyn_cast<BlockArgument>();
+            if (incomingArg && incomingArg.getOwner() == entryBlock)
+              viewsInput = true;
+            else if (!incomingBuffer.getDefiningOp<memref::AllocOp>() ||
+                     !returnedBuffers.insert(incomingBuffer).second)
+              owning[operand.index()] = false;
+          }
+          mayViewInput[operand.index()] =
+              mayViewInput[operand.index()] || viewsInput;
+        }
+      });
+    }
+    entryPointOp->setAttr(KrnlEntryPointOp::getOutputOwningAttrName(),
+        builder.getBoolArrayAttr(owning));
+    entryPointOp->setAttr(KrnlEntryPointOp::getOutputMayViewInputAttrName(),
+        builder.getBoolArrayAttr(mayViewInput));
+  });
+}
+
+// Record on each entry point the layout of each input, as an InputLayout:
+// Strided when a function reads the strides of the input from its
+// descriptor, e.g. to append in place in its capacity, or only returns it;
+// Dense when the buffer of an output may be the buffer of the input, so that
+// the output would outlive a copy of it; Contiguous otherwise. The analysis
+// is conservative across the shape specializations of the function.
+static void analyzeInputLayouts(ModuleOp module) {
+  Builder builder(module.getContext());
+  module.walk([&](KrnlEntryPointOp entryPointOp) {
+    SmallVector<StringRef, 4> funcNames;
+    funcNames.emplace_back(
+        entryPointOp
+            ->getAttrOfType<SymbolRefAttr>(
+                KrnlEntryPointOp::getEntryPointFuncAttrName())
+            .getLeafReference());
+    if (auto specializations = entryPointOp->getAttrOfType<ArrayAttr>(
+            KrnlEntryPointOp::getSpecializationsAttrName()))
+      for (Attribute attr : specializations)
+        funcNames.emplace_back(attr.cast<DictionaryAttr>()
+                                   .get("func")
+                                   .cast<FlatSymbolRefAttr>()
+                                   .getValue());
+
+    SmallVector<bool, 4> readsStrides, readsData, viewedByOutput;
+    for (StringRef funcName : funcNames) {
+      FuncOp func = module.lookupSymbol<FuncOp>(funcName);
+      if (!func || func.isExternal())
+        return;
+      Block *entryBlock = &func.front();
+      if (readsStrides.empty()) {
+        readsStrides.assign(entryBlock->getNumArguments(), false);
+        readsData.assign(entryBlock->getNumArguments(), false);
+        viewedByOutput.assign(entryBlock->getNumArguments(), false);
+      }
+      for (BlockArgument arg : entryBlock->getArguments())
+        for (Operation *user : arg.getUsers()) {
+          if (isa<KrnlStrideOp>(user))
+            readsStrides[arg.getArgNumber()] = true;
+          else if (!isa<ReturnOp>(user))
+            readsData[arg.getArgNumber()] = true;
+        }
+      func.walk([&](ReturnOp returnOp) {
+        for (Value operand : returnOp.getOperands()) {
+          auto arg = getViewedBuffer(operand).dyn_cast<BlockArgument>();
+          if (!arg)
+            continue;
+          SmallVector<Value, 2> incomingBuffers;
+          if (arg.getOwner() == entryBlock) {
+            incomingBuffers.emplace_back(arg);
+          } else if (!getIncomingBuffers(arg, incomingBuffers)) {
+            viewedByOutput.assign(viewedByOutput.size(), true);
+            continue;
+          }
+          for (Value incomingBuffer : incomingBuffers) {
+            auto incomingArg = incomingBuffer.dyn_cast<BlockArgument>();
+            if (!incomingArg)
+              continue;
+            if (incomingArg.getOwner() == entryBlock)
+              viewedByOutput[incomingArg.getArgNumber()] = true;
+            else
+              viewedByOutput.assign(viewedByOutput.size(), true);
+          }
+        }
+      });
+    }
+
+    SmallVector<int64_t, 4> layouts;
+    for (unsigned i = 0; i < readsStrides.size(); ++i) {
+      InputLayout layout = InputLayout::Contiguous;
+      if (readsStrides[i] || !readsData[i])
+        layout = InputLayout::Strided;
+      else if (viewedByOutput[i])
+        layout = InputLayout::Dense;
+      layouts.emplace_back((int64_t)layout);
+    }
+    entryPointOp->setAttr(KrnlEntryPointOp::getInputLayoutsAttrName(),
+        builder.getI64ArrayAttr(layouts));
+  });
+}
+
+// Record on each entry point the binary signature tables of the inputs and
+// of the outputs of its function, read from their MemRef types before they
+// are lowered. A table holds the number of tensors followed, for each one, by
+// its ONNX data type, its rank and its dimensions, -1 when dynamic.
+static void recordSignatureTables(ModuleOp module) {
+  Builder builder(module.getContext());
+  auto getTable = [](ArrayRef<Type> types, SmallVectorImpl<int64_t> &table) {
+    table.emplace_back(types.size());
+    for (Type type : types) {
+      auto memRefTy = type.dyn_cast<MemRefType>();
+      if (!memRefTy)
+        return false;
+      table.emplace_back(llvmTypeToOnnxType(memRefTy.getElementType()));
+      table.emplace_back(memRefTy.getRank());
+      for (int64_t dim : memRefTy.getShape())
+        table.emplace_back(dim < 0 ? -1 : dim);
+    }
+    return true;
+  };
+  module.walk([&](KrnlEntryPointOp entryPointOp) {
+    FuncOp func = module.lookupSymbol<FuncOp>(
+        entryPointOp
+            ->getAttrOfType<SymbolRefAttr>(
+                KrnlEntryPointOp::getEntryPointFuncAttrName())
+            .getLeafReference());
+    SmallVector<int64_t, 16> inTable, outTable;
+    if (!func || !getTable(func.getType().getInputs(), inTable) ||
+        !getTable(func.getType().getResults(), outTable))
+      return;
+    entryPointOp->setAttr(KrnlEntryPointOp::getInputSignatureTableAttrName(),
+        builder.getI64ArrayAttr(inTable));
+    entryPointOp->setAttr(KrnlEntryPointOp::getOutputSignatureTableAttrName(),
+        builder.getI64ArrayAttr(outTable));
+  });
+}
+
+// Check that the memory of the MemRef is only read, directly or through the
+// views of it, and does not escape to other functions or blocks.
+static bool isReadOnlyMemRef(Value memRef) {
+  for (Operation *user : memRef.getUsers()) {
+    for (Value result : user->getResults())
+      if (result.getType().isa<MemRefType>() && !isReadOnlyMemRef(result))
+        return false;
+    auto effectInterface = dyn_cast<MemoryEffectOpInterface>(user);
+    if (!effectInterface || isa<BranchOpInterface>(user))
+      return false;
+    SmallVector<MemoryEffects::EffectInstance, 2> effects;
+    effectInterface.getEffects(effects);
+    for (MemoryEffects::EffectInstance &effect : effects)
+      if (!isa<MemoryEffects::Read>(effect.getEffect()) &&
+          (!effect.getValue() || effect.getValue() == memRef))
+        return false;
+  }
+  return true;
+}
+
+// Return the names of the functions whose MemRef arguments are only read.
+// None of their pointers is written while the function runs, which makes
+// their LLVM pointer arguments noalias; the buffers allocated in the
+// function are distinct from them, so that the loads of the arguments can be
+// reordered with the stores to these buffers.
+static SmallVector<std::string, 4> getReadOnlyArgFunctions(ModuleOp module) {
+  SmallVector<std::string, 4> funcNames;
+  module.walk([&](FuncOp func) {
+    if (func.isExternal())
+      return;
+    bool hasMemRefArg = false;
+    for (BlockArgument arg : func.getArguments()) {
+      if (!arg.getType().isa<MemRefType>())
+        continue;
+      if (!isReadOnlyMemRef(arg))
+        return;
+      hasMemRefArg = true;
+    }
+    if (hasMemRefArg)
+      funcNames.emplace_back(func.getName().str());
+  });
+  return funcNames;
+}
+
+// A memory arena whose size is known at compile time.
+struct StaticArena {
+  int64_t id;
+  int64_t size;
+  int64_t alignment;
+  bool threadLocal;
+  bool zeroInit;
+};
+
+// Return the size in bytes of a global of integer, float or array type, 0 for
+// the other types.
+static int64_t getGlobalSizeInBytes(Type type) {
+  if (auto arrayTy = type.dyn_cast<LLVM::LLVMArrayType>())
+    return arrayTy.getNumElements() *
+           getGlobalSizeInBytes(arrayTy.getElementType());
+  if (type.isIntOrFloat())
+    return (type.getIntOrFloatBitWidth() + 7) / 8;
+  return 0;
+}
+
+// Return the names of the functions called by the entry points, the
+// specialized ones included.
+static SmallVector<std::string, 4> getEntryFunctions(ModuleOp module) {
+  SmallVector<std::string, 4> funcNames;
+  module.walk([&](KrnlEntryPointOp entryPointOp) {
+    funcNames.emplace_back(entryPointOp
+                               ->getAttrOfType<SymbolRefAttr>(
+                                   KrnlEntryPointOp::getEntryPointFuncAttrName())
+                               .getLeafReference()
+                               .str());
+    if (auto specializations = entryPointOp->getAttrOfType<ArrayAttr>(
+            KrnlEntryPointOp::getSpecializationsAttrName()))
+      for (Attribute attr : specializations)
+        funcNames.emplace_back(attr.cast<DictionaryAttr>()
+                                   .get("func")
+                                   .cast<FlatSymbolRefAttr>()
+                                   .getValue()
+                                   .str());
+  });
+  return funcNames;
+}
+
+// Return the positions of the LLVM arguments of the function holding the
+// dynamic dims of its MemRef arguments, once each MemRef is unpacked into its
+// allocated and aligned pointers, offset, sizes and strides.
+static SmallVector<unsigned, 4> getDynamicDimArgs(FuncOp func) {
+  SmallVector<unsigned, 4> dimArgs;
+  unsigned pos = 0;
+  for (Type type : func.getType().getInputs()) {
+    if (auto memRefTy = type.dyn_cast<MemRefType>()) {
+      for (auto dim : llvm::enumerate(memRefTy.getShape()))
+        if (dim.value() < 0)
+          dimArgs.emplace_back(pos + 3 + dim.index());
+      pos += 3 + 2 * memRefTy.getRank();
+    } else {
+      pos += type.isa<UnrankedMemRefType>() ? 2 : 1;
+    }
+  }
+  return dimArgs;
+}
+
+// Let LLVM assume that the given arguments of the function are positive.
+static void assumePositiveArgs(
+    ModuleOp module, LLVM::LLVMFuncOp func, ArrayRef<unsigned> args) {
+  auto *context = module.getContext();
+  Location loc = func.getLoc();
+  auto llvmVoidTy = LLVM::LLVMVoidType::get(context);
+  auto llvmI1Ty = IntegerType::get(context, 1);
+  OpBuilder builder(context);
+  auto assumeRef = getOrInsertExternFunc("llvm.assume", module,
+      LLVM::LLVMFunctionType::get(llvmVoidTy, {llvmI1Ty}, /*isVarArg=*/false),
+      builder);
+  builder.setInsertionPointToStart(&func.front());
+  for (unsigned pos : args) {
+    Value arg = func.getArgument(pos);
+    Value zero = builder.create<LLVM::ConstantOp>(
+        loc, arg.getType(), builder.getIntegerAttr(arg.getType(), 0));
+    Value isPositive =
+        builder.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::sgt, arg, zero);
+    builder.create<LLVM::CallOp>(
+        loc, ArrayRef<Type>({}), assumeRef, ArrayRef<Value>({isPositive}));
+  }
+}
+
+// Emit the function
+//
+//   void omModelWarmup()
+//
+// to be called once the library is loaded, before the first inference. It
+// prefaults the constant globals and the weights file, which are otherwise
+// paged in by the first inference, replicates the weights file on the NUMA
+// nodes when it is read from its local replica, and allocates the memory
+// arenas of known size; the thread-local ones are only allocated for the
+// calling thread.
+static void genModelWarmup(
+    ModuleOp module, int64_t weightsSize, ArrayRef<StaticArena> arenas) {
+  auto *context = module.getContext();
+  Location loc = module.getLoc();
+  auto llvmVoidTy = LLVM::LLVMVoidType::get(context);
+  auto llvmI8PtrTy = LLVM::LLVMPointerType::get(IntegerType::get(context, 8));
+  auto llvmI32Ty = IntegerType::get(context, 32);
+  auto llvmI64Ty = IntegerType::get(context, 64);
+
+  SmallVector<LLVM::GlobalOp, 8> constantGlobals;
+  for (auto globalOp : module.getOps<LLVM::GlobalOp>())
+    if (globalOp.constant() && globalOp.linkage() == LLVM::Linkage::Internal)
+      constantGlobals.emplace_back(globalOp);
+
+  OpBuilder builder(context);
+  builder.setInsertionPointToEnd(module.getBody());
+  auto warmupFunc = builder.create<LLVM::LLVMFuncOp>(loc, "omModelWarmup",
+      LLVM::LLVMFunctionType::get(llvmVoidTy, {}, /*isVarArg=*/false));
+  builder.setInsertionPointToStart(warmupFunc.addEntryBlock());
+
+  auto prefaultRef = getOrInsertExternFunc("omWeightsPrefault", module,
+      LLVM::LLVMFunctionType::get(llvmVoidTy,
+          ArrayRef<Type>({llvmI8PtrTy, llvmI64Ty}), /*isVarArg=*/false),
+      builder);
+  auto prefault = [&](Value data, int64_t sizeInBytes) {
+    if (data.getType() != llvmI8PtrTy)
+      data = builder.create<LLVM::BitcastOp>(loc, llvmI8PtrTy, data);
+    auto size = builder.create<LLVM::ConstantOp>(
+        loc, llvmI64Ty, builder.getI64IntegerAttr(sizeInBytes));
+    builder.create<LLVM::CallOp>(
+        loc, ArrayRef<Type>({}), prefaultRef, ArrayRef<Value>({data, size}));
+  };
+  for (auto globalOp : constantGlobals) {
+    int64_t sizeInBytes = getGlobalSizeInBytes(globalOp.getType());
+    if (sizeInBytes > 0)
+      prefault(builder.create<LLVM::AddressOfOp>(loc, globalOp), sizeInBytes);
+  }
+  if (auto weightsGlobal =
+          module.lookupSymbol<LLVM::GlobalOp>(weightsGlobalName)) {
+    Value weights = builder.create<LLVM::LoadOp>(
+        loc, builder.create<LLVM::AddressOfOp>(loc, weightsGlobal));
+    prefault(weights, weightsSize);
+    if (weightsGlobal->hasAttr(weightsNumaSizeAttrName)) {
+      auto replicateRef = getOrInsertExternFunc("omNumaReplicate", module,
+          LLVM::LLVMFunctionType::get(llvmI32Ty,
+              ArrayRef<Type>({llvmI8PtrTy, llvmI64Ty}), /*isVarArg=*/false),
+          builder);
+      auto size = builder.create<LLVM::ConstantOp>(
+          loc, llvmI64Ty, builder.getI64IntegerAttr(weightsSize));
+      builder.create<LLVM::CallOp>(
+          loc, llvmI32Ty, replicateRef, ArrayRef<Value>({weights, size}));
+    }
+  }
+
+  if (!arenas.empty()) {
+    auto arenaGetTy = LLVM::LLVMFunctionType::get(llvmI8PtrTy,
+        ArrayRef<Type>({llvmI64Ty, llvmI64Ty, llvmI64Ty, llvmI32Ty}),
+        /*isVarArg=*/false);
+    for (const StaticArena &arena : arenas) {
+      // The zero-initialized arenas must be allocated by the same function as
+      // in the model, which zeroes them.
+      auto arenaGetRef = getOrInsertExternFunc(
+          arena.zeroInit ? "omArenaGetZeroed" : "omArenaGet", module,
+          arenaGetTy, builder);
+      Value id = getArenaId(builder, loc, module, arena.id);
+      auto size = builder.create<LLVM::ConstantOp>(
+          loc, llvmI64Ty, builder.getI64IntegerAttr(arena.size));
+      auto align = builder.create<LLVM::ConstantOp>(
+          loc, llvmI64Ty, builder.getI64IntegerAttr(arena.alignment));
+      auto threadLocal = builder.create<LLVM::ConstantOp>(
+          loc, llvmI32Ty, builder.getI32IntegerAttr(arena.threadLocal));
+      builder.create<LLVM::CallOp>(loc, llvmI8PtrTy, arenaGetRef,
+          ArrayRef<Value>({id, size, align, threadLocal}));
+    }
+  }
+  builder.create<LLVM::ReturnOp>(loc, ValueRange());
+}
+
+// Emit the function
+//
+//   int64_t omModelMemoryRequirements()
+//
+// returning the number of bytes allocated by an inference of the model for
+// its memory pools, arenas and other buffers of static size, the largest over
+// the functions of the module. The dynamic allocations are not counted.
+static void genModelMemoryRequirements(ModuleOp module, int64_t bytes) {
+  Location loc = module.getLoc();
+  auto llvmI64Ty = IntegerType::get(module.getContext(), 64);
+  OpBuilder builder(module.getContext());
+  builder.setInsertionPointToEnd(module.getBody());
+  auto func = builder.create<LLVM::LLVMFuncOp>(loc,
+      "omModelMemoryRequirements",
+      LLVM::LLVMFunctionType::get(llvmI64Ty, {}, /*isVarArg=*/false));
+  builder.setInsertionPointToStart(func.addEntryBlock());
+  Value result = builder.create<LLVM::ConstantOp>(
+      loc, llvmI64Ty, builder.getI64IntegerAttr(bytes));
+  builder.create<LLVM::ReturnOp>(loc, result);
+}
+
+// Emit the function
+//
+//   void **omModelWeights()
+//
+// returning the address of the internal _weights global, for the runtime to
+// set it to the mapping of the weights file.
+static void genModelWeights(ModuleOp module, LLVM::GlobalOp weightsGlobal) {
+  Location loc = module.getLoc();
+  auto llvmI8PtrTy =
+      LLVM::LLVMPointerType::get(IntegerType::get(module.getContext(), 8));
+  OpBuilder builder(module.getContext());
+  builder.setInsertionPointToEnd(module.getBody());
+  auto func = builder.create<LLVM::LLVMFuncOp>(loc, "omModelWeights",
+      LLVM::LLVMFunctionType::get(
+          LLVM::LLVMPointerType::get(llvmI8PtrTy), {}, /*isVarArg=*/false));
+  builder.setInsertionPointToStart(func.addEntryBlock());
+  Value weights = builder.create<LLVM::AddressOfOp>(loc, weightsGlobal);
+  builder.create<LLVM::ReturnOp>(loc, weights);
+}
+
+// Create the global holding the base of the numIds arena identifiers of the
+// library, negative until omArenaReserveIds reserves it on the first call.
+static void genArenaIdBase(ModuleOp module, int64_t numIds) {
+  OpBuilder builder(module.getBodyRegion());
+  auto llvmI64Ty = IntegerType::get(module.getContext(), 64);
+  auto baseGlobal = builder.create<LLVM::GlobalOp>(module.getLoc(), llvmI64Ty,
+      /*isConstant=*/false, LLVM::Linkage::Internal, arenaIdBaseGlobalName,
+      builder.getI64IntegerAttr(-1));
+  baseGlobal->setAttr(arenaNumIdsAttrName, builder.getI64IntegerAttr(numIds));
+}
+
+// Give internal linkage to the named function, which is replaced by a copy
+// since the linkage of an LLVM function is set when it is created.
+static void internalizeFunction(ModuleOp module, StringRef name) {
+  auto func = module.lookupSymbol<LLVM::LLVMFuncOp>(name);
+  if (!func || func.isExternal() || func.linkage() == LLVM::Linkage::Internal)
+    return;
+  OpBuilder builder(func);
+  auto internalFunc = builder.create<LLVM::LLVMFuncOp>(
+      func.getLoc(), name, func.getType(), LLVM::Linkage::Internal);
+  for (NamedAttribute attr : func->getAttrs())
+    if (!internalFunc->hasAttr(attr.first))
+      internalFunc->setAttr(attr.first, attr.second);
+  internalFunc.getBody().takeBody(func.getBody());
+  func.erase();
+}
+
 void ConvertKrnlToLLVMPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  analyzeOutputOwnership(module);
+  recordSignatureTables(module);
+  analyzeInputLayouts(module);
+  if (!weightsFile.empty() &&
+      failed(moveWeightsToFile(module, weightsFile, numaWeights))) {
+    signalPassFailure();
+    return;
+  }
+
+  // Record what the warm-up function touches before it is lowered: the size
+  // of the weights file and the memory arenas of static size, and the static
+  // memory requirements of the functions.
+  bool hasEntryPoint = false;
+  module.walk([&](KrnlEntryPointOp) { hasEntryPoint = true; });
+  int64_t weightsSize = 0;
+  module.walk([&](KrnlGlobalOp globalOp) {
+    auto offsetAttr =
+        globalOp->getAttrOfType<IntegerAttr>(weightsOffsetAttrName);
+    if (!offsetAttr)
+      return;
+    auto memRefTy = globalOp.getResult().getType().cast<MemRefType>();
+    weightsSize = std::max(weightsSize,
+        offsetAttr.getInt() +
+            memRefTy.getNumElements() * getMemRefEltSizeInBytes(memRefTy));
+  });
+  SmallVector<StaticArena, 4> staticArenas;
+  module.walk([&](KrnlArenaOp arenaOp) {
+    auto memRefTy = arenaOp.getResult().getType().cast<MemRefType>();
+    if (arenaOp.size() || !memRefTy.hasStaticShape())
+      return;
+    int64_t alignment = 0;
+    if (arenaOp.alignmentAttr())
+      alignment = arenaOp.alignmentAttr().getValue().getSExtValue();
+    staticArenas.push_back({(int64_t)arenaOp.id(),
+        memRefTy.getNumElements() * getMemRefEltSizeInBytes(memRefTy),
+        alignment, arenaOp.threadLocal(), arenaOp.zeroInit()});
+  });
+  // The identifiers of the arenas of a library are offset by a base reserved
+  // at run time, and the functions of its model are made internal once
+  // lowered, so that the libraries loaded in one process stay apart.
+  SmallVector<std::string, 4> modelFuncNames;
+  if (hasEntryPoint) {
+    int64_t numArenaIds = 0;
+    module.walk([&](KrnlArenaOp arenaOp) {
+      numArenaIds = std::max(numArenaIds, (int64_t)arenaOp.id() + 1);
+    });
+    if (numArenaIds > 0)
+      genArenaIdBase(module, numArenaIds);
+    for (FuncOp func : module.getOps<FuncOp>())
+      if (!func.isExternal())
+        modelFuncNames.emplace_back(func.getName().str());
+  }
+  SmallVector<std::string, 4> noAliasFuncNames =
+      getReadOnlyArgFunctions(module);
+  // The inputs of the unchecked entry points are trusted to match their
+  // signatures, without overlapping buffers nor empty dims.
+  SmallVector<std::pair<std::string, SmallVector<unsigned, 4>>, 4>
+      positiveDimArgs;
+  if (unchecked) {
+    module.walk([&](KrnlEntryPointOp entryPointOp) {
+      entryPointOp->setAttr(KrnlEntryPointOp::getUncheckedAttrName(),
+          UnitAttr::get(&getContext()));
+    });
+    for (const std::string &funcName : getEntryFunctions(module)) {
+      FuncOp func = module.lookupSymbol<FuncOp>(funcName);
+      if (!func || func.isExternal())
+        continue;
+      if (!llvm::is_contained(noAliasFuncNames, funcName))
+        noAliasFuncNames.emplace_back(funcName);
+      positiveDimArgs.emplace_back(funcName, getDynamicDimArgs(func));
+    }
+  }
+  int64_t memoryRequirements = 0;
+  module.walk([&](FuncOp function) {
+    int64_t functionBytes = 0;
+    function.walk([&](Operation *op) {
+      if (!isa<memref::AllocOp, KrnlArenaOp>(op))
+        return;
+      auto memRefTy = op->getResult(0).getType().cast<MemRefType>();
+      if (memRefTy.hasStaticShape())
+        functionBytes +=
+            memRefTy.getNumElements() * getMemRefEltSizeInBytes(memRefTy);
+    });
+    memoryRequirements = std::max(memoryRequirements, functionBytes);
+  });
+
   // Define the target for this lowering i.e. the LLVM dialect.
   ConversionTarget target(getContext());
   target.addLegalDialect<LLVM::LLVMDialect>();
@@ -1374,20 +3560,89 @@ void ConvertKrnlToLLVMPass::runOnOperation() {
   options.emitCWrappers = true;
   LLVMTypeConverter typeConverter(&getContext(), options);
 
+  // Parallel loops may have been lowered to OpenMP; OpenMP operations are
+  // kept as long as their regions only contain LLVM types.
+  target.addDynamicallyLegalOp<omp::ParallelOp, omp::WsLoopOp>(
+      [&](Operation *op) { return typeConverter.isLegal(&op->getRegion(0)); });
+  target.addLegalOp<omp::TerminatorOp, omp::YieldOp, omp::BarrierOp,
+      omp::FlushOp>();
+
   // We have a combination of `krnl`, `affine`, `vector`, and `std` operations.
   // We lower in stages until all the code is in the LLVM dialect.
   RewritePatternSet patterns(&getContext());
   populateAffineAndKrnlToLLVMConversion(patterns, &getContext(), typeConverter);
+  if (blasLibrary != "cblas" && blasLibrary != "dnnl") {
+    module.emitError("blas-library expects cblas or dnnl");
+    return signalPassFailure();
+  }
+  patterns.insert<KrnlSgemmOpLowering>(
+      &getContext(), typeConverter, blasLibrary);
 
   // We want to completely lower to LLVM, so we use a `FullConversion`. This
   // ensures that only legal operations will remain after the conversion.
   if (failed(
           applyFullConversion(getOperation(), target, std::move(patterns)))) {
     signalPassFailure();
+    return;
+  }
+
+  // The pointers of the MemRef arguments that are only read do not alias the
+  // pointers written by the function.
+  for (StringRef funcName : noAliasFuncNames) {
+    auto llvmFunc = module.lookupSymbol<LLVM::LLVMFuncOp>(funcName);
+    if (!llvmFunc || llvmFunc.isExternal())
+      continue;
+    for (BlockArgument arg : llvmFunc.getArguments())
+      if (arg.getType().isa<LLVM::LLVMPointerType>())
+        llvmFunc.setArgAttr(arg.getArgNumber(), noAliasAttrName,
+            BoolAttr::get(&getContext(), true));
+  }
+  for (auto &funcDimArgs : positiveDimArgs) {
+    auto llvmFunc = module.lookupSymbol<LLVM::LLVMFuncOp>(funcDimArgs.first);
+    if (llvmFunc && !llvmFunc.isExternal() && !funcDimArgs.second.empty())
+      assumePositiveArgs(module, llvmFunc, funcDimArgs.second);
+  }
+
+  // Parallel loops are executed by the thread pool of the runtime. The walk
+  // visits the nested loops first, the loops are outlined in reverse order so
+  // that the loops enclosing others are outlined before them.
+  SmallVector<omp::ParallelOp, 4> parallelOps;
+  module.walk([&](omp::ParallelOp parallelOp) {
+    parallelOps.emplace_back(parallelOp);
+  });
+  for (unsigned id = parallelOps.size(); id-- > 0;)
+    if (failed(outlineParallelLoop(parallelOps[id], module, id))) {
+      signalPassFailure();
+      return;
+    }
+
+  // The functions of the model and their C wrappers are only called through
+  // the entry points, they are not interposed by those of other libraries.
+  for (const std::string &funcName : modelFuncNames) {
+    internalizeFunction(module, funcName);
+    internalizeFunction(module, "_mlir_ciface_" + funcName);
+  }
+
+  if (hasEntryPoint) {
+    genModelWarmup(module, weightsSize, staticArenas);
+    genModelMemoryRequirements(module, memoryRequirements);
   }
+  if (auto weightsGlobal =
+          module.lookupSymbol<LLVM::GlobalOp>(weightsGlobalName))
+    genModelWeights(module, weightsGlobal);
 }
 
 /// Create the pass for lowering `Krnl`, `Affine` and `Std` dialects to LLVM.
-std::unique_ptr<mlir::Pass> mlir::createConvertKrnlToLLVMPass() {
-  return std::make_unique<ConvertKrnlToLLVMPass>();
+std::unique_ptr<mlir::Pass> mlir::createConvertKrnlToLLVMPass(
+    std::string weightsFile, bool numaWeights, std::string blasLibrary,
+    bool unchecked) {
+  return std::make_unique<ConvertKrnlToLLVMPass>(
+      weightsFile, numaWeights, blasLibrary, unchecked);
+}
+
+/// Create the pass for writing the large constants to the weights file.
+std::unique_ptr<mlir::Pass> mlir::createMoveWeightsToFilePass(
+    std::string weightsFile, bool numaWeights, bool compressWeights) {
+  return std::make_unique<MoveWeightsToFilePass>(
+      weightsFile, numaWeights, compressWeights);
 }
@@ -53,6 +53,12 @@ struct ONNXLoopOpLowering : public ConversionPattern {
           condMemRefTy, loc, rewriter, /*insertDealloc=*/true);
     emitCopy(rewriter, loc, loopOpAdapter.cond(), cond);
 
+    // Create a memref for the loop iteration variable passed to the body
+    // graph, shared by all iterations.
+    Value ivMemRef = insertAllocAndDealloc(
+        MemRefType::get({}, rewriter.getI64Type()), loc, rewriter,
+        /*insertDealloc=*/true);
+
     // Create the loop iteration.
     BuildKrnlLoop loop(rewriter, loc, 1);
     loop.createDefineOp();
@@ -76,10 +82,6 @@ struct ONNXLoopOpLowering : public ConversionPattern {
       Value origIV = loop.getInductionVar(0);
       auto iv = rewriter.create<IndexCastOp>(loc, origIV, rewriter.getI64Type())
                     .getResult();
-      Value ivMemRef = rewriter
-                           .create<memref::AllocOp>(
-                               loc, MemRefType::get({}, rewriter.getI64Type()))
-                           .getResult();
       rewriter.create<KrnlStoreOp>(loc, iv, ivMemRef);
 
       // Make the call to loop body function.
@@ -149,16 +151,21 @@ struct ONNXLoopOpLowering : public ConversionPattern {
                              .getResult();
       }
 
-      // Copy the newly computed loop condition to pre-allocated buffer.
-      emitCopy(rewriter, loc, bodyOutputs[0], cond);
+      // Copy the newly computed loop condition to pre-allocated buffer. A
+      // condition passed through unchanged is still true, and so is the
+      // buffer.
+      if (resultsRange[0] != loopOpAdapter.cond())
+        emitCopy(rewriter, loc, bodyOutputs[0], cond);
 
       // Copy intermediate values of loop carried dependencies to MemRef outside
       // the iteration scope so next iteration can have use them as init value.
+      // The loop body reads its arguments from these MemRefs, so the values
+      // the body passes through unchanged are already in place.
       auto vIntermediate = llvm::make_range(bodyOutputs.begin() + 1,
           bodyOutputs.begin() + 1 + loopOpAdapter.v_initial().size());
-      for (auto vIntermediateToFinal : llvm::zip(vIntermediate, outputs))
-        emitCopy(rewriter, loc, std::get<0>(vIntermediateToFinal),
-            std::get<1>(vIntermediateToFinal));
+      for (unsigned i = 0, e = loopOpAdapter.v_initial().size(); i != e; ++i)
+        if (resultsRange[1 + i] != outputs[i])
+          emitCopy(rewriter, loc, bodyOutputs[1 + i], outputs[i]);
 
       // Copy intermediate values of scan outputs to their corresponding slice
       // in the loop scan output tensor.
@@ -269,11 +276,21 @@ struct ONNXLoopOpLowering : public ConversionPattern {
   // into a higher dimensional tensor with shape (10x4x2), i.e., a batch of 10
   // tensors, each with shape (4x2). To do so, we can invoke emitCopy(src, dest,
   // {0}).
+  //
+  // Whole tensors with the identity layout are copied by a single memcpy
+  // rather than element by element.
   void emitCopy(ConversionPatternRewriter &rewriter, const Location &loc,
       const Value &src, const Value &dest,
       std::vector<Value> writePrefix = {}) const {
     OpBuilder::InsertionGuard insertGuard(rewriter);
     auto srcTy = src.getType().cast<MemRefType>();
+    auto destTy = dest.getType().cast<MemRefType>();
+    if (writePrefix.empty() && srcTy.getRank() > 0 &&
+        srcTy.getAffineMaps().empty() && destTy.getAffineMaps().empty()) {
+      Value sizeInBytes = getDynamicMemRefSizeInBytes(rewriter, loc, src);
+      rewriter.create<KrnlMemcpyOp>(loc, dest, src, sizeInBytes);
+      return;
+    }
     SmallVector<Value, 4> readIV;
     if (srcTy.getRank() > 0) {
       BuildKrnlLoop loop(rewriter, loc, srcTy.getRank());
@@ -73,10 +73,21 @@ struct ONNXScanOpLowering : public ConversionPattern {
           operands.end() - scanOp.num_scan_inputs(), operands.end());
       auto bodyScanInputRange = llvm::make_range(
           bodyArgs.end() - scanOp.num_scan_inputs(), bodyArgs.end());
+      auto bodyTerminatorOperands =
+          scanBody.front().getTerminator()->getOperands();
       for (const auto &opAndBodyScanInput :
           llvm::zip(opScanInputRange, bodyScanInputRange)) {
         auto opScanInput = std::get<0>(opAndBodyScanInput);
         auto bodyScanInput = std::get<1>(opAndBodyScanInput);
+        // The body reads the slice of the scan input in place, through a
+        // view. A slice returned as is by the body is still copied, since the
+        // body outputs are assumed to have the identity layout.
+        if (llvm::find(bodyTerminatorOperands, bodyScanInput) ==
+            bodyTerminatorOperands.end()) {
+          params.emplace_back(emitTrailingDimsView(
+              rewriter, scanOp->getLoc(), opScanInput, iv));
+          continue;
+        }
         auto bodyScanInputMemRef = allocateMemoryForBodyScanInput(
             scanOp->getLoc(), rewriter, bodyScanInput.getType());
         emitCopyFromTensorSlice(
@@ -162,9 +173,9 @@ struct ONNXScanOpLowering : public ConversionPattern {
           outputs.begin() + scanOp.v_initial().size(), outputs.end());
       for (auto scanIntermediateToFinal :
           llvm::zip(scanIntermediate, scanOutputs))
-        emitCopy(rewriter, loc, std::get<0>(scanIntermediateToFinal),
-            std::get<1>(scanIntermediateToFinal),
-            /*writePrefix=*/{iv});
+        emitCopyToTensorSlice(rewriter, loc,
+            std::get<0>(scanIntermediateToFinal),
+            std::get<1>(scanIntermediateToFinal), iv);
 
       // Dealloc local variables.
       for (auto localVar : localVars)
@@ -306,6 +317,25 @@ struct ONNXScanOpLowering : public ConversionPattern {
     rewriter.create<KrnlStoreOp>(loc, val, dest, writeIV);
   }
 
+  // Helper function to emit code that copies src into the slice of dest at
+  // index iv along its leading dimension. The slice of a tensor with the
+  // identity layout is contiguous, so it is written by a single memcpy.
+  static void emitCopyToTensorSlice(ConversionPatternRewriter &rewriter,
+      const Location &loc, const Value &src, const Value &dest,
+      const Value &iv) {
+    auto srcTy = src.getType().cast<MemRefType>();
+    auto destTy = dest.getType().cast<MemRefType>();
+    if (srcTy.getRank() == 0 || !hasAllConstantDimensions(srcTy) ||
+        !destTy.getAffineMaps().empty()) {
+      emitCopy(rewriter, loc, src, dest, /*writePrefix=*/{iv});
+      return;
+    }
+    Value destSlice = emitTrailingDimsView(rewriter, loc, dest, iv);
+    Value sizeInBytes = emitConstantOp(
+        rewriter, loc, rewriter.getIntegerType(64), getMemRefSizeInBytes(src));
+    rewriter.create<KrnlMemcpyOp>(loc, destSlice, src, sizeInBytes);
+  }
+
   static void emitCopyFromTensorSlice(ConversionPatternRewriter &rewriter,
       const Location &loc, const Value &src, const Value &dest,
       std::vector<Value> readPrefix = {}) {
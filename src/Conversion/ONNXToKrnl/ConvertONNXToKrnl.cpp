@@ -15,7 +15,9 @@
 
 #include "mlir/Dialect/Math/Transforms/Passes.h"
 #include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
 #include "mlir/Dialect/StandardOps/Transforms/FuncConversions.h"
+#include "llvm/ADT/DenseSet.h"
 
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
 
@@ -31,7 +33,7 @@ public:
 
   LogicalResult matchAndRewrite(
       ONNXEntryPointOp op, PatternRewriter &rewriter) const override {
-    rewriter.replaceOpWithNewOp<KrnlEntryPointOp>(op,
+    auto entryPointOp = rewriter.replaceOpWithNewOp<KrnlEntryPointOp>(op,
         op->getAttrOfType<SymbolRefAttr>(
             ONNXEntryPointOp::getEntryPointFuncAttrName()),
         op->getAttrOfType<IntegerAttr>(
@@ -40,10 +42,245 @@ public:
             ONNXEntryPointOp::getNumOutputsAttrName()),
         op->getAttrOfType<StringAttr>(
             ONNXEntryPointOp::getSignatureAttrName()));
+    // The functions specialized for some input shapes, if any.
+    if (auto specializations = op->getAttrOfType<ArrayAttr>(
+            ONNXEntryPointOp::getSpecializationsAttrName()))
+      entryPointOp->setAttr(
+          KrnlEntryPointOp::getSpecializationsAttrName(), specializations);
+    // Whether the model may be run in chunks of its batch.
+    if (op->getAttr(ONNXEntryPointOp::getBatchSeparableAttrName()))
+      entryPointOp->setAttr(KrnlEntryPointOp::getBatchSeparableAttrName(),
+          rewriter.getUnitAttr());
     return success();
   }
 };
 
+//===----------------------------------------------------------------------===//
+// Instrumentation of the ONNX operations.
+//===----------------------------------------------------------------------===//
+
+/// Surround each ONNX operation computing tensors with the instrumentation
+/// points reporting its execution time and the size of its outputs to the
+/// runtime. The points are inserted before the lowering, so the code of every
+/// lowering pattern ends up between them, and the outputs given to the
+/// second point are replaced by the buffers of the lowered operation.
+static void instrumentONNXOps(ModuleOp module) {
+  SmallVector<Operation *, 32> ops;
+  module.walk([&](Operation *op) {
+    if (op->getName().getDialectNamespace() !=
+            ONNXOpsDialect::getDialectNamespace() ||
+        op->getNumResults() == 0 || isa<ONNXConstantOp>(op))
+      return;
+    ops.emplace_back(op);
+  });
+
+  for (Operation *op : ops) {
+    OpBuilder builder(op);
+    // Strip the onnx. prefix of the operation name.
+    StringAttr opName =
+        builder.getStringAttr(op->getName().getStringRef().split('.').second);
+    StringAttr nodeName = op->getAttrOfType<StringAttr>("onnx_node_name");
+    if (!nodeName)
+      nodeName = builder.getStringAttr("");
+    builder.create<KrnlInstrumentOp>(op->getLoc(), ValueRange(), opName,
+        nodeName, builder.getI64IntegerAttr(0));
+
+    SmallVector<Value, 4> outputs;
+    for (Value result : op->getResults())
+      if (result.getType().isa<RankedTensorType>())
+        outputs.emplace_back(result);
+    builder.setInsertionPointAfter(op);
+    builder.create<KrnlInstrumentOp>(op->getLoc(), outputs, opName, nodeName,
+        builder.getI64IntegerAttr(1));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Deallocation of the results of the function calls.
+//===----------------------------------------------------------------------===//
+
+/// Free the buffers returned by the calls of the functions of the module, e.g.
+/// the outlined layers, at the end of the callers. The callees return the
+/// buffers they allocate without freeing them, like the lowered ops do for the
+/// results of the functions.
+static void deallocCallResults(ModuleOp module) {
+  module.walk([&](CallOp callOp) {
+    FuncOp callee = module.lookupSymbol<FuncOp>(callOp.getCallee());
+    Operation *terminator = callOp->getBlock()->getTerminator();
+    if (!callee || callee.isExternal() || !isa<ReturnOp>(terminator))
+      return;
+    OpBuilder builder(terminator);
+    for (Value result : callOp.getResults())
+      if (result.getType().isa<MemRefType>() &&
+          !llvm::is_contained(terminator->getOperands(), result))
+        builder.create<memref::DeallocOp>(callOp.getLoc(), result);
+  });
+}
+
+//===----------------------------------------------------------------------===//
+// Batch separability of the entry points.
+//===----------------------------------------------------------------------===//
+
+/// Return the rank of the value if it is a ranked tensor, -1 otherwise.
+static int64_t getTensorRank(Value value) {
+  auto type = value.getType().dyn_cast<RankedTensorType>();
+  return type ? type.getRank() : -1;
+}
+
+/// Check that an operand without batch dimension is broadcast along the batch
+/// dimension of the result of the given rank, or is absent.
+static bool isBroadcastAlongBatch(Value operand, int64_t rank) {
+  if (operand.getType().isa<NoneType>())
+    return true;
+  auto type = operand.getType().dyn_cast<RankedTensorType>();
+  return type && (type.getRank() < rank || type.getShape()[0] == 1);
+}
+
+/// Check that the operation, some of whose operands have the batch as first
+/// dimension, computes each row of the first dimension of its results from
+/// the same row of these operands.
+static bool isBatchSeparableOp(
+    Operation *op, const llvm::DenseSet<Value> &batched) {
+  auto isBatched = [&](Value value) { return batched.count(value) > 0; };
+  if (op->getNumResults() == 0 ||
+      llvm::any_of(op->getResults(),
+          [](Value result) { return getTensorRank(result) < 1; }))
+    return false;
+  int64_t rank = getTensorRank(op->getResult(0));
+  int64_t inputRank = getTensorRank(op->getOperand(0));
+  // Only the first operand, e.g. the input of a convolution, has the batch.
+  bool onlyFirstBatched =
+      isBatched(op->getOperand(0)) &&
+      llvm::none_of(op->getOperands().drop_front(), isBatched);
+  auto isNotBatchAxis = [&](int64_t axis) {
+    return (axis < 0 ? axis + inputRank : axis) != 0;
+  };
+  auto isBroadcast = [&]() {
+    return llvm::all_of(op->getOperands(), [&](Value operand) {
+      return isBatched(operand) ? getTensorRank(operand) == rank
+                                : isBroadcastAlongBatch(operand, rank);
+    });
+  };
+
+  if (isa<ONNXAddOp, ONNXSubOp, ONNXMulOp, ONNXDivOp, ONNXPowOp, ONNXMaxOp,
+          ONNXMinOp, ONNXSumOp, ONNXReluOp, ONNXLeakyReluOp, ONNXEluOp,
+          ONNXSeluOp, ONNXSigmoidOp, ONNXHardSigmoidOp, ONNXTanhOp, ONNXExpOp,
+          ONNXLogOp, ONNXSqrtOp, ONNXAbsOp, ONNXNegOp, ONNXErfOp,
+          ONNXSoftplusOp, ONNXSoftsignOp, ONNXClipOp, ONNXCastOp,
+          ONNXReciprocalOp, ONNXFloorOp, ONNXCeilOp, ONNXSignOp, ONNXWhereOp,
+          ONNXEqualOp, ONNXLessOp, ONNXGreaterOp, ONNXAndOp, ONNXOrOp,
+          ONNXNotOp, ONNXXorOp, ONNXPReluOp, ONNXIdentityOp>(op))
+    return isBroadcast();
+  if (isa<ONNXConvOp, ONNXConvNCHWcOp, ONNXMaxPoolSingleOutOp,
+          ONNXAveragePoolOp, ONNXGlobalAveragePoolOp, ONNXGlobalMaxPoolOp,
+          ONNXBatchNormalizationTestModeOp, ONNXInstanceNormalizationOp,
+          ONNXLRNOp, ONNXLayoutTransformOp>(op))
+    return onlyFirstBatched;
+  if (auto softmaxOp = dyn_cast<ONNXSoftmaxOp>(op))
+    return onlyFirstBatched && isNotBatchAxis(softmaxOp.axis());
+  if (auto logSoftmaxOp = dyn_cast<ONNXLogSoftmaxOp>(op))
+    return onlyFirstBatched && isNotBatchAxis(logSoftmaxOp.axis());
+  if (auto flattenOp = dyn_cast<ONNXFlattenOp>(op)) {
+    // Only a flatten at axis 1 keeps the batch as the first dimension, larger
+    // axes merge it with the following dimensions.
+    int64_t axis = flattenOp.axis();
+    return onlyFirstBatched && (axis < 0 ? axis + inputRank : axis) == 1;
+  }
+  if (auto splitOp = dyn_cast<ONNXSplitOp>(op))
+    return onlyFirstBatched && isNotBatchAxis(splitOp.axis());
+  if (auto gatherOp = dyn_cast<ONNXGatherOp>(op))
+    return onlyFirstBatched && isNotBatchAxis(gatherOp.axis());
+  if (auto concatOp = dyn_cast<ONNXConcatOp>(op))
+    return llvm::all_of(op->getOperands(), isBatched) &&
+           isNotBatchAxis(concatOp.axis());
+  if (isa<ONNXMatMulOp>(op)) {
+    // A batch of rows times a matrix, or a broadcast batch of matrices.
+    if (rank == 2)
+      return onlyFirstBatched && inputRank == 2;
+    return rank > 2 && isBroadcast();
+  }
+  if (auto gemmOp = dyn_cast<ONNXGemmOp>(op))
+    return onlyFirstBatched && gemmOp.transA() == 0;
+  if (auto transposeOp = dyn_cast<ONNXTransposeOp>(op)) {
+    auto permAttr = transposeOp.permAttr();
+    return onlyFirstBatched && permAttr &&
+           permAttr.getValue()[0].cast<IntegerAttr>().getInt() == 0;
+  }
+  if (isa<ONNXReshapeOp>(op)) {
+    // The first dim of the constant shape copies the batch.
+    DenseElementsAttr shape =
+        getDenseElementAttributeFromONNXValue(op->getOperand(1));
+    return onlyFirstBatched && shape && shape.getNumElements() > 0 &&
+           (*shape.getIntValues().begin()).getSExtValue() == 0;
+  }
+  if (isa<ONNXReduceMeanOp, ONNXReduceMaxOp, ONNXReduceMinOp,
+          ONNXReduceProdOp, ONNXReduceSumV11Op>(op)) {
+    auto axesAttr = op->getAttrOfType<ArrayAttr>("axes");
+    return onlyFirstBatched && axesAttr &&
+           llvm::all_of(axesAttr.getValue(), [&](Attribute axis) {
+             return isNotBatchAxis(axis.cast<IntegerAttr>().getInt());
+           });
+  }
+  return false;
+}
+
+/// Check that the function computes each row of the first dimension of its
+/// outputs from the same row of the first dimension of its inputs, so that its
+/// batch can be split into chunks run one after the other. The check is
+/// conservative: any operation on the batch other than the elementwise ops
+/// and the ops of CNN and MLP layers listed in isBatchSeparableOp, e.g. a
+/// function call, makes the function not separable.
+static bool isBatchSeparable(FuncOp function) {
+  if (function.isExternal() || !function.getBody().hasOneBlock() ||
+      function.getNumArguments() == 0)
+    return false;
+  llvm::DenseSet<Value> batched;
+  auto isBatched = [&](Value value) { return batched.count(value) > 0; };
+  for (BlockArgument arg : function.getArguments()) {
+    auto type = arg.getType().dyn_cast<RankedTensorType>();
+    if (!type || type.getRank() < 1 || !type.isDynamicDim(0))
+      return false;
+    batched.insert(arg);
+  }
+
+  for (Operation &op : function.getBody().front()) {
+    if (isa<ReturnOp>(op))
+      return op.getNumOperands() > 0 &&
+             llvm::all_of(op.getOperands(), isBatched);
+    bool usesBatchInRegions = false;
+    op.walk([&](Operation *nestedOp) {
+      if (nestedOp != &op &&
+          llvm::any_of(nestedOp->getOperands(), isBatched))
+        usesBatchInRegions = true;
+    });
+    if (usesBatchInRegions)
+      return false;
+    // The operations computed from the weights only have no batch.
+    if (llvm::none_of(op.getOperands(), isBatched))
+      continue;
+    if (!isBatchSeparableOp(&op, batched))
+      return false;
+    for (Value result : op.getResults())
+      batched.insert(result);
+  }
+  return false;
+}
+
+/// Mark the entry points of the batch-separable functions, run in chunks of
+/// their batch by the runtime when a chunk size is set, see OMBatch.h.
+static void markBatchSeparableEntryPoints(ModuleOp module) {
+  module.walk([&](ONNXEntryPointOp entryPointOp) {
+    FuncOp function = module.lookupSymbol<FuncOp>(
+        entryPointOp
+            ->getAttrOfType<SymbolRefAttr>(
+                ONNXEntryPointOp::getEntryPointFuncAttrName())
+            .getLeafReference());
+    if (function && isBatchSeparable(function))
+      entryPointOp->setAttr(ONNXEntryPointOp::getBatchSeparableAttrName(),
+          UnitAttr::get(module.getContext()));
+  });
+}
+
 //===----------------------------------------------------------------------===//
 // Frontend to Krnl Dialect lowering pass
 //===----------------------------------------------------------------------===//
@@ -56,6 +293,27 @@ struct FrontendToKrnlLoweringPass
   // constructor to make sure that the options are initialized properly.
   FrontendToKrnlLoweringPass() = default;
   FrontendToKrnlLoweringPass(const FrontendToKrnlLoweringPass &pass) {}
+  FrontendToKrnlLoweringPass(bool emitInPlace, bool fastMath,
+      bool optimizeConv, bool winogradConv, ArrayRef<int64_t> tileSizes,
+      bool downcastWeightsToBF16, bool fuseStoreEpilogues, bool instrument,
+      StringRef tuningDatabase, int64_t blasMinFlops,
+      bool persistentRNNStates, int64_t sparseWeightsMinZeros,
+      bool splitBatch, bool matMulUnroll) {
+    this->emitInPlace = emitInPlace;
+    this->fastMath = fastMath;
+    this->optimizeConv = optimizeConv;
+    this->winogradConv = winogradConv;
+    this->tileSizes = tileSizes;
+    this->downcastWeightsToBF16 = downcastWeightsToBF16;
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+    this->instrument = instrument;
+    this->tuningDatabase = tuningDatabase.str();
+    this->blasMinFlops = blasMinFlops;
+    this->persistentRNNStates = persistentRNNStates;
+    this->sparseWeightsMinZeros = sparseWeightsMinZeros;
+    this->splitBatch = splitBatch;
+    this->matMulUnroll = matMulUnroll;
+  }
 
   void runOnOperation() final;
 
@@ -73,12 +331,144 @@ public:
   Option<bool> checkRNNOps{*this, "check-rnn-ops-lowering",
       llvm::cl::desc("Only used for writing LIT tests for RNN ops."),
       llvm::cl::init(false)};
+
+  // Write the results of elementwise ops into the buffer of one of their
+  // operands when that operand is a temporary that is dead after the op.
+  Option<bool> emitInPlace{*this, "emit-in-place",
+      llvm::cl::desc("Reuse the buffers of dead operands of elementwise ops."),
+      llvm::cl::init(false)};
+
+  // Compute exp, tanh, erf and sigmoid with approximations that can be
+  // vectorized instead of calls to the math library.
+  Option<bool> fastMath{*this, "fast-math",
+      llvm::cl::desc("Approximate transcendental functions with polynomials."),
+      llvm::cl::init(false)};
+
+  // Lower convolutions with static shapes to specialized kernels (pointwise,
+  // depthwise, or tiled matrix multiplies over packed input patches) instead
+  // of the direct loop nest.
+  Option<bool> optimizeConv{*this, "optimize-conv",
+      llvm::cl::desc("Lower convolutions to specialized pointwise, depthwise "
+                     "or matrix multiply (im2col) kernels."),
+      llvm::cl::init(false)};
+
+  // Lower 3x3 convolutions with unit strides using Winograd F(2x2, 3x3),
+  // with the kernel transform computed at compile time for constant kernels.
+  Option<bool> winogradConv{*this, "winograd-conv",
+      llvm::cl::desc("Lower 3x3 convolutions with Winograd F(2x2, 3x3)."),
+      llvm::cl::init(false)};
+
+  // Tile sizes of the matrix multiplies of Gemm, MatMul and Conv, given as
+  // the I, J and K cache tiles followed by the I and J register tiles (see
+  // MatMulTileSizes); the defaults are used when empty.
+  ListOption<int64_t> tileSizes{*this, "matmul-tile-sizes",
+      llvm::cl::desc("Cache tiles of I, J, K and register tiles of I, J of "
+                     "the matrix multiplies."),
+      llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated};
+
+  // Tile sizes tuned for the matrix multiplies of some shapes, e.g. by
+  // utils/autotune-matmul.py, overriding those of matmul-tile-sizes for these
+  // shapes (see readMatMulTuningDatabase).
+  Option<std::string> tuningDatabase{*this, "matmul-tuning-db",
+      llvm::cl::desc("JSON file of the tile sizes tuned for the matrix "
+                     "multiplies of some shapes."),
+      llvm::cl::init("")};
+
+  // Store the packed panels of the constant f32 weights of Gemm and MatMul in
+  // bf16, halving the memory they take; the products are still accumulated
+  // in f32.
+  Option<bool> downcastWeightsToBF16{*this, "downcast-weights-to-bf16",
+      llvm::cl::desc("Pack the constant f32 weights of Gemm and MatMul in "
+                     "bf16."),
+      llvm::cl::init(false)};
+
+  // Apply a single use Relu, LeakyRelu or Clip to the values stored by the
+  // elementwise op, Gemm, Conv or pool computing its input, instead of
+  // lowering it to a loop nest of its own.
+  Option<bool> fuseStoreEpilogues{*this, "fuse-store-epilogues",
+      llvm::cl::desc("Fuse Relu, LeakyRelu and Clip into the stores of their "
+                     "producers."),
+      llvm::cl::init(false)};
+
+  // Report the execution time and the output sizes of each ONNX op to the
+  // profiling hook of the runtime, see OMInstrument.h.
+  Option<bool> instrument{*this, "instrument",
+      llvm::cl::desc("Instrument the ONNX ops with runtime profiling calls."),
+      llvm::cl::init(false)};
+
+  // Offload the f32 matrix multiplies of Gemm, MatMul and Conv of static
+  // shapes with at least this many flops to the sgemm of an external BLAS
+  // library with krnl.sgemm; 0 never offloads them.
+  Option<int64_t> blasMinFlops{*this, "blas-min-flops",
+      llvm::cl::desc("Minimum flops of the matrix multiplies offloaded to "
+                     "BLAS, 0 to disable."),
+      llvm::cl::init(0)};
+
+  // Keep the hidden and cell states of the forward RNN, GRU and LSTM ops
+  // without initial states from one call of the model to the next, e.g. to
+  // run a streaming model on consecutive chunks of its input sequence.
+  Option<bool> persistentRNNStates{*this, "persistent-rnn-states",
+      llvm::cl::desc("Keep the states of the RNN ops without initial states "
+                     "across the calls of the model."),
+      llvm::cl::init(false)};
+
+  // Multiply the constant B matrices of Gemm and MatMul with at least this
+  // percentage of zeros, e.g. the weights of pruned fully-connected layers,
+  // as compressed sparse row matrices; 0 keeps them dense.
+  Option<int64_t> sparseWeightsMinZeros{*this, "sparse-weights-min-zeros",
+      llvm::cl::desc("Minimum percentage of zeros of the constant matrices "
+                     "multiplied as sparse matrices, 0 to disable."),
+      llvm::cl::init(0)};
+
+  // Let the runtime run the entry points proven batch-separable in chunks of
+  // their batch, capping the memory of their intermediate buffers.
+  Option<bool> splitBatch{*this, "split-batch",
+      llvm::cl::desc("Run the batch-separable entry points in chunks of "
+                     "their batch."),
+      llvm::cl::init(false)};
+
+  // Unroll and jam the register tiles of the matrix multiplies, including
+  // those of the tuning database; disabled for smaller code.
+  Option<bool> matMulUnroll{*this, "matmul-unroll",
+      llvm::cl::desc("Unroll and jam the register tiles of the matrix "
+                     "multiplies."),
+      llvm::cl::init(true)};
 };
 } // end anonymous namespace.
 
 void FrontendToKrnlLoweringPass::runOnOperation() {
   ModuleOp module = getOperation();
 
+  MatMulTileSizes matMulTileSizes;
+  if (!tileSizes.empty()) {
+    if (tileSizes.size() != 5 ||
+        llvm::any_of(tileSizes, [](int64_t size) { return size <= 0; })) {
+      module.emitError("matmul-tile-sizes expects 5 positive tile sizes");
+      return signalPassFailure();
+    }
+    matMulTileSizes.iCache = tileSizes[0];
+    matMulTileSizes.jCache = tileSizes[1];
+    matMulTileSizes.kCache = tileSizes[2];
+    matMulTileSizes.iReg = tileSizes[3];
+    matMulTileSizes.jReg = tileSizes[4];
+  }
+  matMulTileSizes.unroll = matMulUnroll;
+  matMulTileSizes.blasMinFlops = blasMinFlops;
+  matMulTileSizes.sparseMinZeroPercent = sparseWeightsMinZeros;
+  if (!tuningDatabase.empty()) {
+    std::string errorMessage;
+    if (failed(readMatMulTuningDatabase(
+            tuningDatabase, matMulTileSizes, errorMessage))) {
+      module.emitError(errorMessage);
+      return signalPassFailure();
+    }
+  }
+
+  if (splitBatch)
+    markBatchSeparableEntryPoints(module);
+  if (instrument)
+    instrumentONNXOps(module);
+
   // The first thing to define is the conversion target. This will define the
   // final target for this lowering.
   ConversionTarget target(getContext());
@@ -87,7 +477,7 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
   // this lowering.
   target.addLegalDialect<KrnlOpsDialect, AffineDialect, StandardOpsDialect,
       linalg::LinalgDialect, math::MathDialect, memref::MemRefDialect,
-      shape::ShapeDialect, scf::SCFDialect>();
+      shape::ShapeDialect, scf::SCFDialect, vector::VectorDialect>();
 
   // Use krnl.load/store instead of std.load/store and affine.load/store.
   // krnl.load/store will be lowered to std.load/store and affine.load/store by
@@ -149,18 +539,22 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
   populateLoweringONNXScanOpPattern(patterns, &getContext());
   // Math
   populateLoweringONNXClipOpPattern(patterns, &getContext());
-  populateLoweringONNXElementwiseOpPattern(patterns, &getContext());
-  populateLoweringONNXGemmOpPattern(patterns, &getContext());
+  populateLoweringONNXElementwiseOpPattern(
+      patterns, &getContext(), emitInPlace, fastMath, fuseStoreEpilogues);
+  populateLoweringONNXGemmOpPattern(patterns, &getContext(), matMulTileSizes,
+      downcastWeightsToBF16, fuseStoreEpilogues);
   populateLoweringONNXReductionOpPattern(patterns, &getContext());
   populateLoweringONNXSoftmaxOpPattern(patterns, &getContext());
-  populateLoweringONNXMatMulOpPattern(patterns, &getContext());
+  populateLoweringONNXMatMulOpPattern(
+      patterns, &getContext(), matMulTileSizes, downcastWeightsToBF16);
   populateLoweringONNXLRNOpPattern(patterns, &getContext());
   // Tensor
-  populateLoweringONNXArgMaxOpPattern(patterns, &getContext());
+  populateLoweringONNXArgMinMaxOpPattern(patterns, &getContext());
   populateLoweringONNXReshapeOpPattern(patterns, &getContext());
   populateLoweringONNXPadOpPattern(patterns, &getContext());
   populateLoweringONNXUnsqueezeOpPattern(patterns, &getContext());
   populateLoweringONNXTransposeOpPattern(patterns, &getContext());
+  populateLoweringONNXLayoutTransformOpPattern(patterns, &getContext());
   populateLoweringONNXGatherOpPattern(patterns, &getContext());
   populateLoweringONNXIdentityOpPattern(patterns, &getContext());
   populateLoweringONNXConstantOfShapeOpPattern(patterns, &getContext());
@@ -172,15 +566,33 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
   populateLoweringONNXSplitOpPattern(patterns, &getContext());
   populateLoweringONNXSizeOpPattern(patterns, &getContext());
   populateLoweringONNXTileOpPattern(patterns, &getContext());
+  populateLoweringONNXTopKOpPattern(patterns, &getContext());
+  populateLoweringONNXResizeOpPattern(patterns, &getContext());
   populateLoweringONNXFlattenOpPattern(patterns, &getContext());
   // Neural network
-  populateLoweringONNXConvOpPattern(patterns, &getContext());
+  populateLoweringONNXFusedAttentionOpPattern(patterns, &getContext());
+  populateLoweringONNXConvOpPattern(patterns, &getContext(), optimizeConv,
+      winogradConv, matMulTileSizes, fuseStoreEpilogues);
+  populateLoweringONNXConvTransposeOpPattern(
+      patterns, &getContext(), matMulTileSizes, fuseStoreEpilogues);
   populateLoweringONNXNormalizationOpPattern(patterns, &getContext());
-  populateLoweringONNXPoolingOpPattern(patterns, &getContext());
+  populateLoweringONNXPoolingOpPattern(
+      patterns, &getContext(), fuseStoreEpilogues);
+  // Object detection
+  populateLoweringONNXNonMaxSuppressionOpPattern(patterns, &getContext());
+  // Quantization
+  populateLoweringONNXQuantizeLinearOpPattern(patterns, &getContext());
+  populateLoweringONNXDequantizeLinearOpPattern(patterns, &getContext());
+  populateLoweringONNXMatMulIntegerOpPattern(
+      patterns, &getContext(), matMulTileSizes);
+  populateLoweringONNXQLinearConvOpPattern(patterns, &getContext());
   // Recurrent neural network
-  populateLoweringONNXGRUOpPattern(patterns, &getContext());
-  populateLoweringONNXLSTMOpPattern(patterns, &getContext());
-  populateLoweringONNXRNNOpPattern(patterns, &getContext());
+  populateLoweringONNXGRUOpPattern(
+      patterns, &getContext(), persistentRNNStates);
+  populateLoweringONNXLSTMOpPattern(
+      patterns, &getContext(), persistentRNNStates);
+  populateLoweringONNXRNNOpPattern(
+      patterns, &getContext(), persistentRNNStates);
   // Entry point
   patterns.insert<ONNXEntryPointLowering>(&getContext());
 
@@ -192,9 +604,20 @@ void FrontendToKrnlLoweringPass::runOnOperation() {
   // operations were not converted successfully.
   if (failed(applyPartialConversion(module, target, std::move(patterns)))) {
     signalPassFailure();
+    return;
   }
+  deallocCallResults(module);
 }
 
-std::unique_ptr<Pass> mlir::createLowerToKrnlPass() {
-  return std::make_unique<FrontendToKrnlLoweringPass>();
+std::unique_ptr<Pass> mlir::createLowerToKrnlPass(bool emitInPlace,
+    bool fastMath, bool optimizeConv, bool winogradConv,
+    ArrayRef<int64_t> matMulTileSizes, bool downcastWeightsToBF16,
+    bool fuseStoreEpilogues, bool instrument,
+    llvm::StringRef matMulTuningDatabase, int64_t blasMinFlops,
+    bool persistentRNNStates, int64_t sparseWeightsMinZeros, bool splitBatch,
+    bool matMulUnroll) {
+  return std::make_unique<FrontendToKrnlLoweringPass>(emitInPlace, fastMath,
+      optimizeConv, winogradConv, matMulTileSizes, downcastWeightsToBF16,
+      fuseStoreEpilogues, instrument, matMulTuningDatabase, blasMinFlops,
+      persistentRNNStates, sparseWeightsMinZeros, splitBatch, matMulUnroll);
 }
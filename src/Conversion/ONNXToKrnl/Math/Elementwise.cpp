@@ -12,6 +12,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/Vector/VectorOps.h"
+
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
 #include "src/Dialect/ONNX/ONNXShapeHelper.hpp"
 
@@ -77,6 +79,12 @@ struct ScalarOp<ONNXSumOp> {
   using IOp = AddIOp;
 };
 
+template <>
+struct ScalarOp<ONNXMeanOp> {
+  using FOp = AddFOp;
+  using IOp = AddIOp; // Not used.
+};
+
 template <>
 struct ScalarOp<ONNXCosOp> {
   using FOp = math::CosOp;
@@ -655,12 +663,672 @@ Value emitScalarOpFor<ONNXLessOp>(ConversionPatternRewriter &rewriter,
   }
 }
 
+//===----------------------------------------------------------------------===//
+// Scalar unary ops for lowering ONNXEqualOp
+//===----------------------------------------------------------------------===//
+template <>
+Value emitScalarOpFor<ONNXEqualOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type elementType,
+    ArrayRef<Value> scalarOperands) {
+  Value lhs = scalarOperands[0];
+  Value rhs = scalarOperands[1];
+
+  Type inputType = lhs.getType();
+  if (inputType.isa<FloatType>()) {
+    return rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, lhs, rhs);
+  } else if (inputType.isa<IntegerType>()) {
+    return rewriter.create<CmpIOp>(loc, CmpIPredicate::eq, lhs, rhs);
+  } else {
+    llvm_unreachable("unsupported element type");
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Scalar unary ops for lowering ONNXWhereOp
+//===----------------------------------------------------------------------===//
+// The operands are the condition and the two values, scalars or vectors.
+template <>
+Value emitScalarOpFor<ONNXWhereOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type elementType,
+    ArrayRef<Value> scalarOperands) {
+  return rewriter.create<SelectOp>(
+      loc, scalarOperands[0], scalarOperands[1], scalarOperands[2]);
+}
+
+//===----------------------------------------------------------------------===//
+// Fast approximations of transcendental functions.
+//===----------------------------------------------------------------------===//
+
+// With fast math, exp, tanh, erf and sigmoid are computed with polynomial and
+// rational approximations instead of calls to the math library. They only use
+// arithmetic ops, so they apply to vectors as well and let these ops be
+// vectorized. They are only emitted for f32, with errors of a few ULPs; exp
+// saturates outside of [-87.3, 88.3].
+template <typename Op>
+struct FastMathOp {
+  static const bool value = false;
+};
+
+template <>
+struct FastMathOp<ONNXExpOp> {
+  static const bool value = true;
+};
+
+template <>
+struct FastMathOp<ONNXTanhOp> {
+  static const bool value = true;
+};
+
+template <>
+struct FastMathOp<ONNXErfOp> {
+  static const bool value = true;
+};
+
+template <>
+struct FastMathOp<ONNXSigmoidOp> {
+  static const bool value = true;
+};
+
+template <>
+struct FastMathOp<ONNXFusedActivationOp> {
+  static const bool value = true;
+};
+
+// Return min(max(x, lb), ub).
+static Value emitClamp(ConversionPatternRewriter &rewriter, Location loc,
+    Type type, Value x, double lb, double ub) {
+  auto lbVal = emitConstantOp(rewriter, loc, type, lb);
+  auto ubVal = emitConstantOp(rewriter, loc, type, ub);
+  auto lessThanLb = rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, x, lbVal);
+  x = rewriter.create<SelectOp>(loc, lessThanLb, lbVal, x);
+  auto greaterThanUb =
+      rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, x, ubVal);
+  return rewriter.create<SelectOp>(loc, greaterThanUb, ubVal, x);
+}
+
+// Evaluate the polynomial coeffs[0] + coeffs[1] * x + ... with Horner's rule.
+static Value emitPolynomial(ConversionPatternRewriter &rewriter, Location loc,
+    Type type, Value x, ArrayRef<double> coeffs) {
+  Value result = emitConstantOp(rewriter, loc, type, coeffs.back());
+  for (double coeff : llvm::reverse(coeffs.drop_back())) {
+    result = rewriter.create<MulFOp>(loc, result, x);
+    result = rewriter.create<AddFOp>(
+        loc, result, emitConstantOp(rewriter, loc, type, coeff));
+  }
+  return result;
+}
+
+// exp(x) = 2^n * exp(r), with n = round(x / ln(2)) and r = x - n * ln(2) in
+// [-ln(2) / 2, ln(2) / 2]. exp(r) is approximated by a polynomial of degree 7
+// (Cephes expf) and 2^n is built from the exponent bits.
+static Value emitFastExp(
+    ConversionPatternRewriter &rewriter, Location loc, Type type, Value x) {
+  x = emitClamp(rewriter, loc, type, x, -87.3, 88.3);
+  auto log2e = emitConstantOp(rewriter, loc, type, 1.44269504088896341);
+  auto half = emitConstantOp(rewriter, loc, type, 0.5);
+  Value n = rewriter.create<FloorFOp>(loc,
+      rewriter.create<AddFOp>(
+          loc, rewriter.create<MulFOp>(loc, x, log2e), half));
+
+  // ln(2) is split in two parts to compute r accurately.
+  auto ln2Hi = emitConstantOp(rewriter, loc, type, 0.693359375);
+  auto ln2Lo = emitConstantOp(rewriter, loc, type, -2.12194440e-4);
+  Value r = rewriter.create<SubFOp>(
+      loc, x, rewriter.create<MulFOp>(loc, n, ln2Hi));
+  r = rewriter.create<SubFOp>(loc, r, rewriter.create<MulFOp>(loc, n, ln2Lo));
+
+  Value p = emitPolynomial(rewriter, loc, type, r,
+      {5.0000001201e-1, 1.6666665459e-1, 4.1665795894e-2, 8.3334519073e-3,
+          1.3981999507e-3, 1.9875691500e-4});
+  Value r2 = rewriter.create<MulFOp>(loc, r, r);
+  Value expR = rewriter.create<AddFOp>(loc,
+      rewriter.create<AddFOp>(loc, rewriter.create<MulFOp>(loc, p, r2), r),
+      emitConstantOp(rewriter, loc, type, 1));
+
+  // 2^n, as a float whose biased exponent is n + 127.
+  Type intType = rewriter.getIntegerType(32);
+  if (auto vectorType = type.dyn_cast<VectorType>())
+    intType = VectorType::get(vectorType.getShape(), intType);
+  Value exponent = rewriter.create<FPToSIOp>(loc, intType, n);
+  exponent = rewriter.create<AddIOp>(
+      loc, exponent, emitConstantOp(rewriter, loc, intType, 127));
+  exponent = rewriter.create<ShiftLeftOp>(
+      loc, exponent, emitConstantOp(rewriter, loc, intType, 23));
+  Value pow2n = rewriter.create<BitcastOp>(loc, type, exponent);
+  return rewriter.create<MulFOp>(loc, expR, pow2n);
+}
+
+// tanh(x) = x * P(x^2) / Q(x^2) on [-7.9, 7.9], where tanh(x) rounds to +/-1
+// outside.
+static Value emitFastTanh(
+    ConversionPatternRewriter &rewriter, Location loc, Type type, Value x) {
+  x = emitClamp(rewriter, loc, type, x, -7.90531110763549805,
+      7.90531110763549805);
+  Value x2 = rewriter.create<MulFOp>(loc, x, x);
+  Value p = emitPolynomial(rewriter, loc, type, x2,
+      {4.89352455891786e-03, 6.37261928875436e-04, 1.48572235717979e-05,
+          5.12229709037114e-08, -8.60467152213735e-11, 2.00018790482477e-13,
+          -2.76076847742355e-16});
+  p = rewriter.create<MulFOp>(loc, p, x);
+  Value q = emitPolynomial(rewriter, loc, type, x2,
+      {4.89352518554385e-03, 2.26843463243900e-03, 1.18534705686654e-04,
+          1.19825839466702e-06});
+  return rewriter.create<DivFOp>(loc, p, q);
+}
+
+// erf(x) = x * P(x^2) / Q(x^2) on [-4, 4], where erf(x) rounds to +/-1
+// outside.
+static Value emitFastErf(
+    ConversionPatternRewriter &rewriter, Location loc, Type type, Value x) {
+  x = emitClamp(rewriter, loc, type, x, -4, 4);
+  Value x2 = rewriter.create<MulFOp>(loc, x, x);
+  Value p = emitPolynomial(rewriter, loc, type, x2,
+      {-1.60960333262415e-02, -2.95459980854025e-03, -7.34990630326855e-04,
+          -5.69250639462346e-05, -2.10102402082508e-06, 2.77068142495902e-08,
+          -2.72614225801306e-10});
+  p = rewriter.create<MulFOp>(loc, p, x);
+  Value q = emitPolynomial(rewriter, loc, type, x2,
+      {-1.42647390514189e-02, -7.37332916720468e-03, -1.68282697438203e-03,
+          -2.13374055278905e-04, -1.45660718464996e-05});
+  return rewriter.create<DivFOp>(loc, p, q);
+}
+
+// Emit the fast approximation of an op, for a f32 or vector of f32 type.
+template <typename Op>
+Value emitFastMathOpFor(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *op, Type type, ArrayRef<Value> operands) {
+  llvm_unreachable("no fast approximation for this op");
+}
+
+template <>
+Value emitFastMathOpFor<ONNXExpOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> operands) {
+  return emitFastExp(rewriter, loc, type, operands[0]);
+}
+
+template <>
+Value emitFastMathOpFor<ONNXTanhOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> operands) {
+  return emitFastTanh(rewriter, loc, type, operands[0]);
+}
+
+template <>
+Value emitFastMathOpFor<ONNXErfOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> operands) {
+  return emitFastErf(rewriter, loc, type, operands[0]);
+}
+
+template <>
+Value emitFastMathOpFor<ONNXSigmoidOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> operands) {
+  // sigmoid(x) = 1 / (1 + exp(-x))
+  auto one = emitConstantOp(rewriter, loc, type, 1);
+  Value neg = rewriter.create<NegFOp>(loc, operands[0]);
+  Value negExp = emitFastExp(rewriter, loc, type, neg);
+  return rewriter.create<DivFOp>(
+      loc, one, rewriter.create<AddFOp>(loc, one, negExp));
+}
+
+//===----------------------------------------------------------------------===//
+// Scalar unary ops for lowering ONNXFusedActivationOp
+//===----------------------------------------------------------------------===//
+// gelu(x) = x * 0.5 * (1 + erf(x / sqrt(2)))
+// swish(x) = x * sigmoid(x)
+// hardswish(x) = x * max(0, min(1, x / 6 + 0.5))
+// The whole chain is computed in registers, erf and sigmoid with their fast
+// approximations if requested.
+static Value emitFusedActivation(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, Value x, bool fastMath) {
+  StringRef activation = llvm::cast<ONNXFusedActivationOp>(op).activation();
+  Value factor;
+  if (activation == "Gelu") {
+    auto half = emitConstantOp(rewriter, loc, type, 0.5);
+    auto one = emitConstantOp(rewriter, loc, type, 1);
+    auto invSqrt2 = emitConstantOp(rewriter, loc, type, 0.70710678118654752);
+    Value scaled = rewriter.create<MulFOp>(loc, x, invSqrt2);
+    Value erf = fastMath ? emitFastErf(rewriter, loc, type, scaled)
+                         : emitScalarOpFor<ONNXErfOp>(
+                               rewriter, loc, op, type, {scaled});
+    factor = rewriter.create<MulFOp>(
+        loc, half, rewriter.create<AddFOp>(loc, one, erf));
+  } else if (activation == "Swish") {
+    factor = fastMath ? emitFastMathOpFor<ONNXSigmoidOp>(
+                            rewriter, loc, op, type, {x})
+                      : emitScalarOpFor<ONNXSigmoidOp>(
+                            rewriter, loc, op, type, {x});
+  } else {
+    assert(activation == "HardSwish" && "unsupported fused activation");
+    auto sixth = emitConstantOp(rewriter, loc, type, 1.0 / 6);
+    auto half = emitConstantOp(rewriter, loc, type, 0.5);
+    factor = emitClamp(rewriter, loc, type,
+        rewriter.create<AddFOp>(
+            loc, rewriter.create<MulFOp>(loc, x, sixth), half),
+        0, 1);
+  }
+  return rewriter.create<MulFOp>(loc, x, factor);
+}
+
+template <>
+Value emitScalarOpFor<ONNXFusedActivationOp>(
+    ConversionPatternRewriter &rewriter, Location loc, Operation *op,
+    Type elementType, ArrayRef<Value> scalarOperands) {
+  return emitFusedActivation(rewriter, loc, op, elementType,
+      scalarOperands[0], /*fastMath=*/false);
+}
+
+template <>
+Value emitFastMathOpFor<ONNXFusedActivationOp>(
+    ConversionPatternRewriter &rewriter, Location loc, Operation *op,
+    Type type, ArrayRef<Value> operands) {
+  return emitFusedActivation(
+      rewriter, loc, op, type, operands[0], /*fastMath=*/true);
+}
+
+// Return true if the op is computed with its fast approximation.
+template <typename Op>
+bool useFastMathFor(bool fastMath, MemRefType type) {
+  return fastMath && FastMathOp<Op>::value && type.getElementType().isF32();
+}
+
+// Emit the computation of an element-wise op, with its fast approximation if
+// requested.
+template <typename Op>
+Value emitElementwiseOpFor(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *op, Type type, ArrayRef<Value> operands, bool fastMath) {
+  if (fastMath)
+    return emitFastMathOpFor<Op>(rewriter, loc, op, type, operands);
+  return emitScalarOpFor<Op>(rewriter, loc, op, type, operands);
+}
+
+//===----------------------------------------------------------------------===//
+// Vectorization of element-wise ops.
+//===----------------------------------------------------------------------===//
+
+// Size in bytes of the vectors used to compute element-wise ops.
+static const int64_t elementwiseVectorBytes = 32;
+
+// Element-wise ops whose computation, as emitted by the generic
+// emitScalarOpFor, applies to vector operands as well.
+template <typename Op>
+struct VectorizableOp {
+  static const bool value = false;
+};
+
+template <>
+struct VectorizableOp<ONNXAddOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXSubOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXMulOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXDivOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXSumOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXMaxOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXMinOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXMeanOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXExpOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXLogOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXSqrtOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXCosOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXSinOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXCeilOp> {
+  static const bool value = true;
+};
+
+template <>
+struct VectorizableOp<ONNXFloorOp> {
+  static const bool value = true;
+};
+
+// Return true if the computation of the op applies to vector operands. The
+// erf and the sigmoid of the fused activations are only vectorized by their
+// fast approximations, hardswish is arithmetic only.
+template <typename Op>
+bool isVectorizableOp(Operation *op) {
+  return VectorizableOp<Op>::value;
+}
+
+template <>
+bool isVectorizableOp<ONNXFusedActivationOp>(Operation *op) {
+  return llvm::cast<ONNXFusedActivationOp>(op).activation() == "HardSwish";
+}
+
+// Return the vector length used to compute an element-wise op producing the
+// given type, or 0 if the op is not vectorized. The innermost dimension must
+// be static and hold at least one vector. For ranks above one, it must also be
+// a multiple of the vector length, as the vector view of a memref has no
+// padding between its rows.
+static int64_t getElementwiseVectorLength(MemRefType type) {
+  int64_t rank = type.getRank();
+  Type elementType = type.getElementType();
+  if (rank == 0 || !type.getAffineMaps().empty() ||
+      !elementType.isIntOrFloat() || elementType.getIntOrFloatBitWidth() < 8)
+    return 0;
+
+  int64_t vectorLen =
+      elementwiseVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  int64_t lastDim = type.getShape()[rank - 1];
+  if (lastDim < vectorLen || (rank > 1 && lastDim % vectorLen != 0))
+    return 0;
+  return vectorLen;
+}
+
+// Combine the values loaded from the operands of an element-wise op: the
+// variadic ops fold them, Mean divides their sum by their number, Where
+// selects one of its values by its condition and Expand copies its input.
+template <typename ElementwiseOp>
+Value emitCombinedOpFor(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *op, Type type, ArrayRef<Value> values) {
+  Value result = values[0];
+  for (unsigned i = 1; i < values.size(); ++i)
+    result = emitScalarOpFor<ElementwiseOp>(
+        rewriter, loc, op, type, {result, values[i]});
+  return result;
+}
+
+template <>
+Value emitCombinedOpFor<ONNXMeanOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> values) {
+  Value sum = values[0];
+  for (unsigned i = 1; i < values.size(); ++i)
+    sum = rewriter.create<AddFOp>(loc, sum, values[i]);
+  Value count = emitConstantOp(rewriter, loc, type, values.size());
+  return rewriter.create<DivFOp>(loc, sum, count);
+}
+
+template <>
+Value emitCombinedOpFor<ONNXWhereOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> values) {
+  return emitScalarOpFor<ONNXWhereOp>(rewriter, loc, op, type, values);
+}
+
+template <>
+Value emitCombinedOpFor<ONNXExpandOp>(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Type type, ArrayRef<Value> values) {
+  return values[0];
+}
+
+// Emit the loops computing an element-wise op whose operands all have the
+// type of the result, vectorized along the innermost dimension. For rank one,
+// the trailing elements that do not fill a vector are computed by a scalar
+// epilogue loop. The store epilogue op, if any, is applied to the results.
+template <typename ElementwiseOp>
+void emitVectorizedElementwiseLoops(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, ArrayRef<Value> operands, Value alloc,
+    int64_t vectorLen, bool isUnary, bool fastMath = false,
+    Operation *epilogueOp = nullptr) {
+  auto memRefType = alloc.getType().cast<MemRefType>();
+  Type elementType = memRefType.getElementType();
+  int64_t rank = memRefType.getRank();
+  int64_t lastDim = memRefType.getShape()[rank - 1];
+  int64_t vectorizedDim = lastDim / vectorLen * vectorLen;
+  VectorType vectorType = VectorType::get({vectorLen}, elementType);
+
+  // Compute the op on values loaded from the inputs at the given indices and
+  // store the result into the output.
+  auto emitComputation = [&](ArrayRef<Value> inputs, Value output, Type type,
+                             ValueRange indices) {
+    SmallVector<Value, 4> values;
+    for (Value input : inputs)
+      values.emplace_back(rewriter.create<KrnlLoadOp>(loc, input, indices));
+    Value result =
+        isUnary ? emitElementwiseOpFor<ElementwiseOp>(
+                      rewriter, loc, op, type, {values[0]}, fastMath)
+                : emitCombinedOpFor<ElementwiseOp>(
+                      rewriter, loc, op, type, values);
+    result = emitStoreEpilogue(rewriter, loc, epilogueOp, result);
+    rewriter.create<KrnlStoreOp>(loc, result, output, indices);
+  };
+
+  // Vectorized loops, over memrefs of vectors.
+  SmallVector<Value, 4> vectorOperands;
+  for (Value operand : operands)
+    vectorOperands.emplace_back(
+        rewriter.create<KrnlVectorTypeCastOp>(loc, operand, vectorLen));
+  Value vectorAlloc =
+      rewriter.create<KrnlVectorTypeCastOp>(loc, alloc, vectorLen);
+  {
+    OpBuilder::InsertionGuard insertGuard(rewriter);
+    BuildKrnlLoop loops(rewriter, loc, rank);
+    loops.createDefineAndIterateOp(vectorAlloc, /*parallelize=*/true);
+    rewriter.setInsertionPointToStart(loops.getIterateBlock());
+    emitComputation(vectorOperands, vectorAlloc, vectorType,
+        loops.getIterateBlock()->getArguments());
+  }
+
+  // Scalar epilogue.
+  if (vectorizedDim < lastDim) {
+    OpBuilder::InsertionGuard insertGuard(rewriter);
+    BuildKrnlLoop loops(rewriter, loc, 1);
+    loops.createDefineOp();
+    loops.pushBounds(vectorizedDim, lastDim);
+    loops.createIterateOp();
+    rewriter.setInsertionPointToStart(loops.getIterateBlock());
+    emitComputation(operands, alloc, elementType,
+        loops.getIterateBlock()->getArguments());
+  }
+}
+
+// Emit the loops computing an element-wise op whose operands have static
+// shapes and are broadcast to the result. Only the outer dimensions are
+// iterated by a loop nest, whose body iterates the innermost dimension. The
+// operands that are broadcast along the innermost dimension, e.g. a scalar or
+// per-channel bias, are loaded once per row before the inner loop, and the
+// loads of the other operands index the innermost dimension directly, so that
+// no broadcast index is computed per element. When vectorLen is not 0, the
+// inner loop computes vectors, from splats of the values loaded per row, and
+// for rank one a scalar epilogue computes the trailing elements. The bools of
+// a condition take a byte each in memory, unlike the bits of a vector of i1,
+// and the lanes of their vectors are loaded one by one. The store epilogue op,
+// if any, is applied to the results.
+template <typename ElementwiseOp>
+void emitBroadcastElementwiseLoops(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, ArrayRef<Value> operands, Value alloc,
+    int64_t vectorLen, Operation *epilogueOp = nullptr) {
+  auto memRefType = alloc.getType().cast<MemRefType>();
+  auto shape = memRefType.getShape();
+  Type elementType = memRefType.getElementType();
+  int64_t rank = memRefType.getRank();
+  int64_t lastDim = shape[rank - 1];
+  bool isVectorized = vectorLen > 0;
+  if (!isVectorized)
+    vectorLen = 1;
+  int64_t vectorizedDim = lastDim / vectorLen * vectorLen;
+  Type vectorType = isVectorized ? VectorType::get({vectorLen}, elementType)
+                                 : elementType;
+  Value zeroIndex = rewriter.create<ConstantIndexOp>(loc, 0);
+  auto getVectorType = [&](Value operand) {
+    return VectorType::get({vectorLen},
+        operand.getType().cast<MemRefType>().getElementType());
+  };
+  auto isBool = [](Value operand) {
+    return operand.getType().cast<MemRefType>().getElementType().isInteger(1);
+  };
+
+  // The operands varying along the innermost dimension, and their views.
+  SmallVector<bool, 4> isRowVarying;
+  SmallVector<Value, 4> views;
+  for (Value operand : operands) {
+    auto operandShape = operand.getType().cast<MemRefType>().getShape();
+    bool varying = !operandShape.empty() && operandShape.back() == lastDim;
+    isRowVarying.emplace_back(varying);
+    Value view = operand;
+    if (varying && isVectorized && !isBool(operand))
+      view = rewriter.create<KrnlVectorTypeCastOp>(loc, operand, vectorLen);
+    views.emplace_back(view);
+  }
+  Value allocView = alloc;
+  if (isVectorized)
+    allocView = rewriter.create<KrnlVectorTypeCastOp>(loc, alloc, vectorLen);
+
+  // Indices of an operand, aligned with the innermost dimensions of the
+  // output, for the given outer indices and innermost index of the output.
+  auto getOperandIndices = [&](Value operand, ValueRange outerIndices,
+                               Value innerIndex) {
+    auto operandShape = operand.getType().cast<MemRefType>().getShape();
+    int64_t operandRank = operandShape.size();
+    SmallVector<Value, 4> indices;
+    for (int64_t k = 0; k < operandRank; ++k) {
+      int64_t d = rank - operandRank + k;
+      if (operandShape[k] == 1)
+        indices.emplace_back(zeroIndex);
+      else if (d == rank - 1)
+        indices.emplace_back(innerIndex);
+      else
+        indices.emplace_back(outerIndices[d]);
+    }
+    return indices;
+  };
+
+  auto emitRow = [&](ValueRange outerIndices) {
+    // Load the operands broadcast along the row.
+    SmallVector<Value, 4> rowValues, rowVectors;
+    for (unsigned i = 0; i < operands.size(); ++i) {
+      Value value, vector;
+      if (!isRowVarying[i]) {
+        value = rewriter.create<KrnlLoadOp>(loc, operands[i],
+            getOperandIndices(operands[i], outerIndices, zeroIndex));
+        vector = value;
+        if (isVectorized)
+          vector =
+              rewriter.create<SplatOp>(loc, getVectorType(operands[i]), value);
+      }
+      rowValues.emplace_back(value);
+      rowVectors.emplace_back(vector);
+    }
+
+    auto emitInnerLoop = [&](int64_t lb, int64_t ub, bool vectorized) {
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      BuildKrnlLoop innerLoop(rewriter, loc, 1);
+      innerLoop.createDefineOp();
+      innerLoop.pushBounds(lb, ub);
+      innerLoop.createIterateOp();
+      rewriter.setInsertionPointToStart(innerLoop.getIterateBlock());
+      Value iv = innerLoop.getInductionVar(0);
+      Type type = vectorized ? vectorType : elementType;
+      auto getValue = [&](unsigned i) -> Value {
+        if (!isRowVarying[i])
+          return vectorized ? rowVectors[i] : rowValues[i];
+        if (vectorized && isBool(operands[i])) {
+          Value lanes =
+              rewriter.create<SplatOp>(loc, getVectorType(operands[i]),
+                  emitConstantOp(rewriter, loc, rewriter.getI1Type(), 0));
+          Value first = rewriter.create<MulIOp>(
+              loc, iv, rewriter.create<ConstantIndexOp>(loc, vectorLen));
+          for (int64_t l = 0; l < vectorLen; ++l) {
+            Value lane = rewriter.create<ConstantIndexOp>(loc, l);
+            Value value = rewriter.create<KrnlLoadOp>(loc, operands[i],
+                getOperandIndices(operands[i], outerIndices,
+                    rewriter.create<AddIOp>(loc, first, lane)));
+            lanes = rewriter.create<vector::InsertElementOp>(
+                loc, value, lanes, lane);
+          }
+          return lanes;
+        }
+        return rewriter.create<KrnlLoadOp>(loc,
+            vectorized ? views[i] : operands[i],
+            getOperandIndices(operands[i], outerIndices, iv));
+      };
+      SmallVector<Value, 4> values;
+      for (unsigned i = 0; i < operands.size(); ++i)
+        values.emplace_back(getValue(i));
+      Value result =
+          emitCombinedOpFor<ElementwiseOp>(rewriter, loc, op, type, values);
+      result = emitStoreEpilogue(rewriter, loc, epilogueOp, result);
+      SmallVector<Value, 4> outIndices(
+          outerIndices.begin(), outerIndices.end());
+      outIndices.emplace_back(iv);
+      rewriter.create<KrnlStoreOp>(
+          loc, result, vectorized ? allocView : alloc, outIndices);
+    };
+    emitInnerLoop(0, vectorizedDim / vectorLen, isVectorized);
+    // Scalar epilogue.
+    if (vectorizedDim < lastDim)
+      emitInnerLoop(vectorizedDim, lastDim, /*vectorized=*/false);
+  };
+
+  if (rank == 1) {
+    emitRow({});
+    return;
+  }
+  OpBuilder::InsertionGuard insertGuard(rewriter);
+  BuildKrnlLoop outerLoops(rewriter, loc, rank - 1);
+  outerLoops.createDefineOp();
+  for (int64_t i = 0; i < rank - 1; ++i)
+    outerLoops.pushBounds(0, shape[i]);
+  int64_t parallelLoopIndex = 0;
+  while (parallelLoopIndex < rank - 2 && shape[parallelLoopIndex] == 1)
+    ++parallelLoopIndex;
+  outerLoops.parallelizeLoop(parallelLoopIndex);
+  outerLoops.createIterateOp();
+  rewriter.setInsertionPointToStart(outerLoops.getIterateBlock());
+  emitRow(outerLoops.getIterateBlock()->getArguments());
+}
+
 // Element-wise unary ops lowering to Krnl dialect.
 //===----------------------------------------------------------------------===//
 template <typename ElementwiseUnaryOp>
 struct ONNXElementwiseUnaryOpLowering : public ConversionPattern {
-  ONNXElementwiseUnaryOpLowering(MLIRContext *ctx)
-      : ConversionPattern(ElementwiseUnaryOp::getOperationName(), 1, ctx) {}
+  bool emitInPlace = false;
+  bool fuseStoreEpilogues = false;
+  bool fastMath = false;
+
+  ONNXElementwiseUnaryOpLowering(MLIRContext *ctx, bool emitInPlace = false,
+      bool fuseStoreEpilogues = false, bool fastMath = false)
+      : ConversionPattern(ElementwiseUnaryOp::getOperationName(), 1, ctx) {
+    this->emitInPlace = emitInPlace;
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+    this->fastMath = fastMath;
+  }
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
     auto loc = ONNXLoc<ElementwiseUnaryOp>(op);
@@ -669,21 +1337,45 @@ struct ONNXElementwiseUnaryOpLowering : public ConversionPattern {
     // Insert an allocation and deallocation for the result of this operation.
     auto memRefType = convertToMemRefType(*op->result_type_begin());
 
+    // The result of the store epilogue op, if any, is stored instead.
+    Operation *epilogueOp =
+        fuseStoreEpilogues ? getStoreEpilogueOp(op) : nullptr;
+    Operation *resultOp = epilogueOp ? epilogueOp : op;
+
+    // If the operand is dead after this operation, store the result into its
+    // buffer instead.
     Value alloc;
-    bool insertDealloc = checkInsertDealloc(op);
+    if (emitInPlace && checkInsertDealloc(resultOp))
+      alloc = getInPlaceOperandBuffer(op, operands, memRefType);
 
-    if (hasAllConstantDimensions(memRefType))
-      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
-    else
-      alloc =
-          insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc, X);
+    if (!alloc) {
+      bool insertDealloc = checkInsertDealloc(resultOp);
+      if (hasAllConstantDimensions(memRefType))
+        alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+      else
+        alloc =
+            insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc, X);
+    }
+
+    // Compute full vectors along the innermost dimension when possible.
+    bool useFastMath = useFastMathFor<ElementwiseUnaryOp>(fastMath, memRefType);
+    int64_t vectorLen =
+        (isVectorizableOp<ElementwiseUnaryOp>(op) || useFastMath)
+            ? getElementwiseVectorLength(memRefType)
+            : 0;
+    if (vectorLen > 0 && X.getType() == memRefType) {
+      emitVectorizedElementwiseLoops<ElementwiseUnaryOp>(rewriter, loc, op,
+          {X}, alloc, vectorLen, /*isUnary=*/true, useFastMath, epilogueOp);
+      replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+      return success();
+    }
 
     SmallVector<Value, 4> loopIVs;
     // Only create krnl.iterate if one of the operands is not scalar tensor.
     if (!hasAllScalarValues(operands)) {
       // Create iterateOp & get block within iterate op.
       BuildKrnlLoop loops(rewriter, loc, memRefType.getRank());
-      loops.createDefineAndIterateOp(X);
+      loops.createDefineAndIterateOp(X, /*parallelize=*/true);
       Block *iterationBlock = loops.getIterateBlock();
 
       // Insert instructions inside the KernelIterateOp body.
@@ -695,12 +1387,14 @@ struct ONNXElementwiseUnaryOpLowering : public ConversionPattern {
     }
 
     auto loadedVal = rewriter.create<KrnlLoadOp>(loc, X, loopIVs);
-    auto loweredOpResult = emitScalarOpFor<ElementwiseUnaryOp>(
-        rewriter, loc, op, memRefType.getElementType(), {loadedVal});
+    auto loweredOpResult = emitElementwiseOpFor<ElementwiseUnaryOp>(rewriter,
+        loc, op, memRefType.getElementType(), {loadedVal}, useFastMath);
+    loweredOpResult =
+        emitStoreEpilogue(rewriter, loc, epilogueOp, loweredOpResult);
     // Store result in the resulting array.
     rewriter.create<KrnlStoreOp>(loc, loweredOpResult, alloc, loopIVs);
 
-    rewriter.replaceOp(op, alloc);
+    replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
     return success();
   }
 };
@@ -711,11 +1405,13 @@ struct ONNXElementwiseUnaryOpLowering : public ConversionPattern {
 //===----------------------------------------------------------------------===//
 template <typename ElementwiseBinaryOp>
 struct ONNXElementwiseBinaryOpLowering : public ConversionPattern {
+  bool emitInPlace = false;
   bool isUniBroadcasting = false;
 
-  ONNXElementwiseBinaryOpLowering(
-      MLIRContext *ctx, bool isUniBroadcasting = false)
+  ONNXElementwiseBinaryOpLowering(MLIRContext *ctx, bool emitInPlace = false,
+      bool isUniBroadcasting = false)
       : ConversionPattern(ElementwiseBinaryOp::getOperationName(), 1, ctx) {
+    this->emitInPlace = emitInPlace;
     this->isUniBroadcasting = isUniBroadcasting;
   }
 
@@ -739,9 +1435,14 @@ struct ONNXElementwiseBinaryOpLowering : public ConversionPattern {
     ScopedContext scope(rewriter, loc);
     IndexExprScope outerScope(shapeHelper.scope);
 
-    // Insert an allocation and deallocation for the result of this operation.
-    Value alloc = insertAllocAndDeallocSimple(
-        rewriter, op, outputMemRefType, loc, shapeHelper.outputDims);
+    // Insert an allocation and deallocation for the result of this operation,
+    // unless an operand that is dead after this operation can hold it.
+    Value alloc;
+    if (emitInPlace)
+      alloc = getInPlaceOperandBuffer(op, operands, outputMemRefType);
+    if (!alloc)
+      alloc = insertAllocAndDeallocSimple(
+          rewriter, op, outputMemRefType, loc, shapeHelper.outputDims);
 
     // Emit main computation.
     SmallVector<IndexExpr, 4> outputAccessExprs;
@@ -749,7 +1450,7 @@ struct ONNXElementwiseBinaryOpLowering : public ConversionPattern {
     if (!hasAllScalarValues(operands)) {
       // Create iterateOp & get block within iterate op.
       BuildKrnlLoop loops(rewriter, loc, outputRank);
-      loops.createDefineAndIterateOp(alloc);
+      loops.createDefineAndIterateOp(alloc, /*parallelize=*/true);
       Block *iterationBlock = loops.getIterateBlock();
       // Insert instructions inside the KernelIterateOp body.
       rewriter.setInsertionPointToStart(iterationBlock);
@@ -789,8 +1490,15 @@ struct ONNXElementwiseBinaryOpLowering : public ConversionPattern {
 //===----------------------------------------------------------------------===//
 template <typename ElementwiseVariadicOp>
 struct ONNXElementwiseVariadicOpLowering : public ConversionPattern {
-  ONNXElementwiseVariadicOpLowering(MLIRContext *ctx)
-      : ConversionPattern(ElementwiseVariadicOp::getOperationName(), 1, ctx) {}
+  bool emitInPlace = false;
+  bool fuseStoreEpilogues = false;
+
+  ONNXElementwiseVariadicOpLowering(MLIRContext *ctx, bool emitInPlace = false,
+      bool fuseStoreEpilogues = false)
+      : ConversionPattern(ElementwiseVariadicOp::getOperationName(), 1, ctx) {
+    this->emitInPlace = emitInPlace;
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+  }
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
     auto loc =
@@ -810,9 +1518,51 @@ struct ONNXElementwiseVariadicOpLowering : public ConversionPattern {
     ScopedContext scope(rewriter, loc);
     IndexExprScope outerScope;
 
-    // Insert an allocation and deallocation for the result of this operation.
-    Value alloc = insertAllocAndDeallocSimple(
-        rewriter, op, outputMemRefType, loc, shapeHelper.outputDims);
+    // The result of the store epilogue op, if any, is stored instead.
+    Operation *epilogueOp =
+        fuseStoreEpilogues ? getStoreEpilogueOp(op) : nullptr;
+    bool insertDealloc = checkInsertDealloc(epilogueOp ? epilogueOp : op);
+
+    // Insert an allocation and deallocation for the result of this operation,
+    // unless an operand that is dead after this operation can hold it.
+    Value alloc;
+    if (emitInPlace && insertDealloc)
+      alloc = getInPlaceOperandBuffer(op, operands, outputMemRefType);
+    if (!alloc)
+      alloc = insertAllocAndDeallocSimple(rewriter, op, outputMemRefType, loc,
+          shapeHelper.outputDims, insertDealloc);
+
+    // Compute full vectors along the innermost dimension when no operand is
+    // broadcast.
+    int64_t vectorLen = VectorizableOp<ElementwiseVariadicOp>::value
+                            ? getElementwiseVectorLength(outputMemRefType)
+                            : 0;
+    bool hasBroadcast = llvm::any_of(operands,
+        [&](Value operand) { return operand.getType() != outputMemRefType; });
+    if (vectorLen > 0 && !hasBroadcast) {
+      emitVectorizedElementwiseLoops<ElementwiseVariadicOp>(rewriter, loc, op,
+          operands, alloc, vectorLen, /*isUnary=*/false, /*fastMath=*/false,
+          epilogueOp);
+      replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+      return success();
+    }
+
+    // With static shapes, the loops are specialized to the broadcast of each
+    // operand, vectorized along the innermost dimension when possible.
+    bool hasStaticBroadcast =
+        hasBroadcast && outputRank > 0 &&
+        hasAllConstantDimensions(outputMemRefType) &&
+        outputMemRefType.getShape()[outputRank - 1] > 1 &&
+        llvm::all_of(operands, [](Value operand) {
+          auto type = operand.getType().cast<MemRefType>();
+          return hasAllConstantDimensions(type) && type.getAffineMaps().empty();
+        });
+    if (hasStaticBroadcast) {
+      emitBroadcastElementwiseLoops<ElementwiseVariadicOp>(
+          rewriter, loc, op, operands, alloc, vectorLen, epilogueOp);
+      replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+      return success();
+    }
 
     // Emit main computation.
     SmallVector<IndexExpr, 4> outputAccessExprs;
@@ -820,7 +1570,7 @@ struct ONNXElementwiseVariadicOpLowering : public ConversionPattern {
     if (!hasAllScalarValues(operands)) {
       // Create iterateOp & get block within iterate op.
       BuildKrnlLoop loops(rewriter, loc, outputRank);
-      loops.createDefineAndIterateOp(alloc);
+      loops.createDefineAndIterateOp(alloc, /*parallelize=*/true);
       Block *iterationBlock = loops.getIterateBlock();
       // Insert instructions inside the KernelIterateOp body.
       rewriter.setInsertionPointToStart(iterationBlock);
@@ -829,38 +1579,162 @@ struct ONNXElementwiseVariadicOpLowering : public ConversionPattern {
         outputAccessExprs.emplace_back(DimIndexExpr(arg));
     }
 
-    // Fold over operands for each of their scalar values.
-    // Obtain the first operand.
-    SmallVector<IndexExpr, 4> oprdAccessExprs;
-    LogicalResult res = shapeHelper.GetAccessExprs(
-        operands[0], 0, outputAccessExprs, oprdAccessExprs);
-    assert(succeeded(res));
-    Value accumulated = krnl_load(operands[0], oprdAccessExprs);
-
-    // Iterate over the remaining operands.
-    for (unsigned i = 1; i < numArgs; i++) {
-      // Obtain the next operand.
+    // Load the scalar values of all the operands and combine them.
+    SmallVector<Value, 4> values;
+    for (unsigned i = 0; i < numArgs; i++) {
       SmallVector<IndexExpr, 4> oprdAccessExprs;
       LogicalResult res = shapeHelper.GetAccessExprs(
           operands[i], i, outputAccessExprs, oprdAccessExprs);
       assert(succeeded(res));
-      Value next = krnl_load(operands[i], oprdAccessExprs);
-      // Fold.
-      accumulated = emitScalarOpFor<ElementwiseVariadicOp>(
-          rewriter, loc, op, outputElementType, {accumulated, next});
+      values.emplace_back(krnl_load(operands[i], oprdAccessExprs));
     }
+    Value accumulated = emitCombinedOpFor<ElementwiseVariadicOp>(
+        rewriter, loc, op, outputElementType, values);
+
+    accumulated = emitStoreEpilogue(rewriter, loc, epilogueOp, accumulated);
 
     // Store result in the resulting array.
     krnl_store(accumulated, alloc, outputAccessExprs);
 
+    replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+
+    return success();
+  }
+};
+
+// Where lowering to Krnl dialect. With static shapes, the values are selected
+// as vectors along the innermost dimension, by vector selects.
+//===----------------------------------------------------------------------===//
+struct ONNXWhereOpLowering : public ConversionPattern {
+  ONNXWhereOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXWhereOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto loc = ONNXLoc<ONNXWhereOp>(op);
+    auto outputMemRefType = convertToMemRefType(*op->result_type_begin());
+    auto outputRank = outputMemRefType.getRank();
+
+    // Shape helper.
+    ONNXOpBroadcastedShapeHelper shapeHelper(&rewriter, loc);
+    LogicalResult shapecomputed = shapeHelper.Compute(operands);
+    assert(succeeded(shapecomputed));
+    using namespace mlir::edsc;
+    ScopedContext scope(rewriter, loc);
+    IndexExprScope outerScope(shapeHelper.scope);
+
+    Value alloc = insertAllocAndDeallocSimple(
+        rewriter, op, outputMemRefType, loc, shapeHelper.outputDims);
+
+    bool hasStaticShapes =
+        outputRank > 0 && hasAllConstantDimensions(outputMemRefType) &&
+        outputMemRefType.getShape()[outputRank - 1] > 1 &&
+        llvm::all_of(operands, [](Value operand) {
+          auto type = operand.getType().cast<MemRefType>();
+          return hasAllConstantDimensions(type) && type.getAffineMaps().empty();
+        });
+    if (hasStaticShapes) {
+      emitBroadcastElementwiseLoops<ONNXWhereOp>(rewriter, loc, op, operands,
+          alloc, getElementwiseVectorLength(outputMemRefType));
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
+
+    SmallVector<IndexExpr, 4> outputAccessExprs;
+    if (!hasAllScalarValues(operands)) {
+      BuildKrnlLoop loops(rewriter, loc, outputRank);
+      loops.createDefineAndIterateOp(alloc, /*parallelize=*/true);
+      Block *iterationBlock = loops.getIterateBlock();
+      rewriter.setInsertionPointToStart(iterationBlock);
+      for (auto arg : iterationBlock->getArguments())
+        outputAccessExprs.emplace_back(DimIndexExpr(arg));
+    }
+    SmallVector<Value, 3> values;
+    for (unsigned i = 0; i < operands.size(); ++i) {
+      SmallVector<IndexExpr, 4> accessExprs;
+      LogicalResult res = shapeHelper.GetAccessExprs(
+          operands[i], i, outputAccessExprs, accessExprs);
+      assert(succeeded(res));
+      values.emplace_back(krnl_load(operands[i], accessExprs));
+    }
+    Value result = emitScalarOpFor<ONNXWhereOp>(
+        rewriter, loc, op, outputMemRefType.getElementType(), values);
+    krnl_store(result, alloc, outputAccessExprs);
+
     rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
 
+// Expand lowering to Krnl dialect. The result is a view of the input, whose
+// broadcast dimensions have a zero stride, when the input buffer outlives it.
+// Otherwise the input is copied by the broadcast loops.
+//===----------------------------------------------------------------------===//
+struct ONNXExpandOpLowering : public ConversionPattern {
+  ONNXExpandOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXExpandOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto loc = ONNXLoc<ONNXExpandOp>(op);
+    ONNXExpandOpAdaptor operandAdaptor(operands);
+    Value input = operandAdaptor.input();
+    auto inputType = input.getType().cast<MemRefType>();
+    auto outputMemRefType = convertToMemRefType(*op->result_type_begin());
+    if (!hasAllConstantDimensions(inputType) ||
+        !hasAllConstantDimensions(outputMemRefType) ||
+        !inputType.getAffineMaps().empty())
+      return failure();
+    ArrayRef<int64_t> inShape = inputType.getShape();
+    ArrayRef<int64_t> outShape = outputMemRefType.getShape();
+    int64_t inRank = inShape.size();
+    int64_t outRank = outShape.size();
+
+    if (canLowerToInputView(op, input)) {
+      // The strides of the input, zero along the broadcast dimensions.
+      SmallVector<int64_t, 4> strides(outRank, 0);
+      int64_t stride = 1;
+      for (int64_t d = outRank - 1, k = inRank - 1; k >= 0; --d, --k) {
+        if (inShape[k] == outShape[d])
+          strides[d] = stride;
+        stride *= inShape[k];
+      }
+      auto viewType = MemRefType::get(outShape,
+          outputMemRefType.getElementType(),
+          makeStridedLinearLayoutMap(strides, 0, rewriter.getContext()));
+      Value view = rewriter.create<memref::ReinterpretCastOp>(loc, viewType,
+          input, /*offset=*/0, outShape, strides);
+      rewriter.replaceOp(op, view);
+      return success();
+    }
+
+    Value alloc = insertAllocAndDealloc(
+        outputMemRefType, loc, rewriter, checkInsertDealloc(op));
+    if (outRank == 0 || outShape[outRank - 1] == 1 || inRank == 0) {
+      BuildKrnlLoop loops(rewriter, loc, outRank);
+      loops.createDefineAndIterateOp(alloc, /*parallelize=*/true);
+      rewriter.setInsertionPointToStart(loops.getIterateBlock());
+      ValueRange outIndices = loops.getIterateBlock()->getArguments();
+      Value zeroIndex = rewriter.create<ConstantIndexOp>(loc, 0);
+      SmallVector<Value, 4> inIndices;
+      for (int64_t k = 0; k < inRank; ++k)
+        inIndices.emplace_back(inShape[k] == 1
+                                   ? zeroIndex
+                                   : outIndices[outRank - inRank + k]);
+      Value value = rewriter.create<KrnlLoadOp>(loc, input, inIndices);
+      rewriter.create<KrnlStoreOp>(loc, value, alloc, outIndices);
+    } else {
+      emitBroadcastElementwiseLoops<ONNXExpandOp>(rewriter, loc, op, {input},
+          alloc, getElementwiseVectorLength(outputMemRefType));
+    }
+    rewriter.replaceOp(op, alloc);
     return success();
   }
 };
 
-void populateLoweringONNXElementwiseOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx) {
+void populateLoweringONNXElementwiseOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool emitInPlace, bool fastMath,
+    bool fuseStoreEpilogues) {
   patterns.insert<ONNXElementwiseUnaryOpLowering<mlir::ONNXAbsOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXAddOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXAndOp>,
@@ -871,28 +1745,24 @@ void populateLoweringONNXElementwiseOpPattern(
       ONNXElementwiseUnaryOpLowering<mlir::ONNXCoshOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXDivOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXEluOp>,
-      ONNXElementwiseUnaryOpLowering<mlir::ONNXErfOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXAcosOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXAcoshOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXAsinOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXAsinhOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXAtanhOp>,
-      ONNXElementwiseUnaryOpLowering<mlir::ONNXExpOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXFloorOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXHardSigmoidOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXLeakyReluOp>,
-      ONNXElementwiseBinaryOpLowering<mlir::ONNXLessOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXLogOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXMaxOp>,
+      ONNXElementwiseVariadicOpLowering<mlir::ONNXMeanOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXMinOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXMulOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXNegOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXOrOp>,
-      ONNXElementwiseBinaryOpLowering<mlir::ONNXPowOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXReciprocalOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXReluOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXSeluOp>,
-      ONNXElementwiseUnaryOpLowering<mlir::ONNXSigmoidOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXSignOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXSinOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXSinhOp>,
@@ -902,8 +1772,19 @@ void populateLoweringONNXElementwiseOpPattern(
       ONNXElementwiseVariadicOpLowering<mlir::ONNXSubOp>,
       ONNXElementwiseVariadicOpLowering<mlir::ONNXSumOp>,
       ONNXElementwiseUnaryOpLowering<mlir::ONNXTanOp>,
-      ONNXElementwiseUnaryOpLowering<mlir::ONNXTanhOp>,
-      ONNXElementwiseVariadicOpLowering<mlir::ONNXXorOp>>(ctx);
+      ONNXElementwiseVariadicOpLowering<mlir::ONNXXorOp>>(
+      ctx, emitInPlace, fuseStoreEpilogues);
+  patterns.insert<ONNXElementwiseBinaryOpLowering<mlir::ONNXEqualOp>,
+      ONNXElementwiseBinaryOpLowering<mlir::ONNXLessOp>,
+      ONNXElementwiseBinaryOpLowering<mlir::ONNXPowOp>>(ctx, emitInPlace);
   patterns.insert<ONNXElementwiseBinaryOpLowering<mlir::ONNXPReluOp>>(
-      ctx, /*isUniBroadcasting=*/true);
+      ctx, emitInPlace, /*isUniBroadcasting=*/true);
+  // Ops with a fast approximation.
+  patterns.insert<ONNXElementwiseUnaryOpLowering<mlir::ONNXErfOp>,
+      ONNXElementwiseUnaryOpLowering<mlir::ONNXExpOp>,
+      ONNXElementwiseUnaryOpLowering<mlir::ONNXFusedActivationOp>,
+      ONNXElementwiseUnaryOpLowering<mlir::ONNXSigmoidOp>,
+      ONNXElementwiseUnaryOpLowering<mlir::ONNXTanhOp>>(
+      ctx, emitInPlace, fuseStoreEpilogues, fastMath);
+  patterns.insert<ONNXExpandOpLowering, ONNXWhereOpLowering>(ctx);
 }
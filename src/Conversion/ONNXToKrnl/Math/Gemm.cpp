@@ -23,18 +23,59 @@
 #define DEBUG_UNROLL_OFF 0
 #define DEBUG_OPTIMIZED_OFF 0
 #define DEBUG_GLOBAL_ALLOC_FREE 1
+#define DEBUG_PARALLEL_OFF 0
 
 #define BUFFER_ALIGN 128
 using namespace mlir;
 
-template <typename GemmOp>
+// Activation applied to the result of the Gemm, if any.
+static StringRef getGemmActivation(ONNXGemmOp &gemmOp) { return ""; }
+static StringRef getGemmActivation(ONNXFusedGemmOp &gemmOp) {
+  return gemmOp.activation();
+}
+
+// Apply the activation of a fused Gemm to one element of its result.
+static Value emitGemmActivation(ConversionPatternRewriter &rewriter,
+    Location loc, StringRef activation, Type elementType, Value res) {
+  if (activation.empty())
+    return res;
+  if (activation == "Relu") {
+    Value zero = emitConstantOp(rewriter, loc, elementType, 0);
+    Value lessThanZero =
+        rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, res, zero);
+    return rewriter.create<SelectOp>(loc, lessThanZero, zero, res);
+  }
+  if (activation == "Sigmoid") {
+    Value zero = emitConstantOp(rewriter, loc, elementType, 0);
+    Value one = emitConstantOp(rewriter, loc, elementType, 1);
+    Value negExp = rewriter.create<math::ExpOp>(
+        loc, rewriter.create<SubFOp>(loc, zero, res));
+    return rewriter.create<DivFOp>(
+        loc, one, rewriter.create<AddFOp>(loc, one, negExp));
+  }
+  assert(activation == "Tanh" && "unsupported activation");
+  return rewriter.create<math::TanhOp>(loc, res);
+}
+
+template <typename GemmOp, typename GemmOpAdaptor>
 struct ONNXGemmOpLowering : public ConversionPattern {
-  ONNXGemmOpLowering(MLIRContext *ctx)
-      : ConversionPattern(GemmOp::getOperationName(), 1, ctx) {}
+  using GemmShapeHelper = ONNXGenericGemmOpShapeHelper<GemmOp, GemmOpAdaptor>;
+  MatMulTileSizes tileSizes;
+  bool downcastWeightsToBF16 = false;
+  bool fuseStoreEpilogues = false;
 
-  void genericGemm(ONNXGemmOp &gemmOp, ONNXGemmOpAdaptor &operandAdaptor,
-      Type elementType, ONNXGemmOpShapeHelper &shapeHelper, Value alloc,
-      Value zeroVal, Value alphaVal, Value betaVal,
+  ONNXGemmOpLowering(MLIRContext *ctx,
+      const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+      bool downcastWeightsToBF16 = false, bool fuseStoreEpilogues = false)
+      : ConversionPattern(GemmOp::getOperationName(), 1, ctx) {
+    this->tileSizes = tileSizes;
+    this->downcastWeightsToBF16 = downcastWeightsToBF16;
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+  }
+
+  void genericGemm(GemmOp &gemmOp, GemmOpAdaptor &operandAdaptor,
+      Type elementType, GemmShapeHelper &shapeHelper, Value alloc,
+      Value zeroVal, Value alphaVal, Value betaVal, Operation *epilogueOp,
       ConversionPatternRewriter &rewriter, Location loc) const {
     // Scope for krnl EDSC ops
     using namespace mlir::edsc;
@@ -47,6 +88,8 @@ struct ONNXGemmOpLowering : public ConversionPattern {
 
     // Outer loops.
     ValueRange outerLoops = krnl_define_loop(2);
+    if (!DEBUG_PARALLEL_OFF)
+      krnl_parallel(outerLoops[0]);
     krnl_iterate(
         outerLoops, rBound.getLbs(), rBound.getUbs(), {}, [&](ValueRange args) {
           // Outer loop indices.
@@ -90,15 +133,17 @@ struct ONNXGemmOpLowering : public ConversionPattern {
             Value c = krnl_load(operandAdaptor.C(), cAccess);
             res = std_addf(res, std_mulf(betaVal, c));
           }
+          res = emitGemmActivation(
+              rewriter, loc, getGemmActivation(gemmOp), elementType, res);
+          res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
           krnl_store(res, R, outerIndices);
         });
   }
 
-  void tiledTransposedGemm(ONNXGemmOp &gemmOp,
-      ONNXGemmOpAdaptor &operandAdaptor, Type elementType,
-      ONNXGemmOpShapeHelper &shapeHelper, Value alloc, Value zeroVal,
-      Value alphaVal, Value betaVal, ConversionPatternRewriter &rewriter,
-      Location loc) const {
+  void tiledTransposedGemm(GemmOp &gemmOp, GemmOpAdaptor &operandAdaptor,
+      Type elementType, GemmShapeHelper &shapeHelper, Value alloc,
+      Value zeroVal, Value alphaVal, Value betaVal, Operation *epilogueOp,
+      ConversionPatternRewriter &rewriter, Location loc) const {
     // Scope for krnl EDSC ops
     using namespace mlir::edsc;
     using namespace mlir::edsc::intrinsics;
@@ -113,41 +158,70 @@ struct ONNXGemmOpLowering : public ConversionPattern {
     LiteralIndexExpr zero(0);
     Value z = zero.getValue();
 
+    // Half precision products are accumulated in single precision, into a
+    // temporary result converted back by the alpha/beta computations. The
+    // tiles of A and B are padded with the zero of their own type.
+    Value abZeroVal = zeroVal;
+    Type accType = getMatMulAccumulationType(elementType);
+    if (accType != elementType) {
+      MemRefType accMemRefType = MemRefType::get(
+          alloc.getType().cast<MemRefType>().getShape(), accType);
+      R = insertAllocAndDeallocSimple(rewriter, gemmOp, accMemRefType, loc,
+          shapeHelper.dimsForOutput(0), /*insertDealloc=*/true, BUFFER_ALIGN);
+      zeroVal = emitConstantOp(rewriter, loc, accType, 0);
+      alphaVal = emitConstantOp(
+          rewriter, loc, accType, gemmOp.alpha().convertToFloat());
+      betaVal = emitConstantOp(
+          rewriter, loc, accType, gemmOp.beta().convertToFloat());
+    }
+
+    // Constant B matrices with enough zeros are multiplied as CSR matrices,
+    // large f32 products are otherwise computed by an external BLAS library.
+    bool sparseB = isSparseMatMulConstant(B, tileSizes);
+    if (!sparseB && isBlasSgemm(A, B, R, I, J, K, tileSizes)) {
+      krnl_sgemm(A, {}, B, {}, R, {}, aTrans, bTrans, /*alpha=*/1.0,
+          /*beta=*/0.0);
+      emitGemmEpilogue(gemmOp, operandAdaptor, elementType, accType,
+          shapeHelper, alloc, R, alphaVal, betaVal, epilogueOp, rewriter, loc);
+      return;
+    }
+
     // Initialize alloc/R to zero.
     ValueRange zeroLoop = krnl_define_loop(2);
+    if (!DEBUG_PARALLEL_OFF)
+      krnl_parallel(zeroLoop[0]);
     krnl_iterate_ie(zeroLoop, {zero, zero}, {I, J}, {}, [&](ValueRange args) {
       ValueRange indices = krnl_get_induction_var_value(zeroLoop);
       krnl_store(zeroVal, R, indices);
     });
 
+    if (sparseB) {
+      emitSparseMatMul(A, {}, aTrans,
+          emitSparseMatMulGlobals(rewriter, loc, B, bTrans), R, {}, I, K,
+          /*parallelize=*/!DEBUG_PARALLEL_OFF);
+      emitGemmEpilogue(gemmOp, operandAdaptor, elementType, accType,
+          shapeHelper, alloc, R, alphaVal, betaVal, epilogueOp, rewriter, loc);
+      return;
+    }
+
     // Prepare for the computations.
     // 1) Define blocking, with simdization along the j axis.
-    const int64_t iCacheTile(64), jCacheTile(128), kCacheTile(512);
-    const int64_t iRegTile(4), jRegTile(8);
+    const MatMulTileSizes tiles = tileSizes.forShape(I, J, K);
+    const int64_t iCacheTile(tiles.iCache), jCacheTile(tiles.jCache),
+        kCacheTile(tiles.kCache);
+    const int64_t iRegTile(tiles.iReg), jRegTile(tiles.jReg);
 
-    bool unrollAndJam = DEBUG_UNROLL_OFF ? false : true;
+    bool unrollAndJam = DEBUG_UNROLL_OFF ? false : tiles.unroll;
     // Simdize with jRegTile as the vector length.
-    bool simdize = DEBUG_SIMD_OFF ? false : true;
-
-    bool mustTileR = false;
-    if (!J.isLiteral()) {
-      // Assume large J, will simdize, but since simdized dimension must be a
-      // multiple of the vector length, we must tile C into a smaller block of
-      // known dimensions that are compatible with SIMD.
-      mustTileR = true;
-    } else {
-      int64_t jVal = J.getLiteral();
-      if (jVal < jRegTile) {
-        // Very small computation, give up on SIMD.
-        simdize = false;
-      } else if (jVal % jRegTile != 0) {
-        // Unfortunately, J is not divisible by the vector length. Could try
-        // to change the vector length, but right now, just go to buffering.
-        mustTileR = true;
-      } else {
-        // Best of all world, large computation, of sizes compatible with vector
-        // length.
-      }
+    bool simdize = DEBUG_SIMD_OFF ? false : tiles.simdize;
+    // Execute the outermost cache tile loop in parallel.
+    bool parallelize = DEBUG_PARALLEL_OFF ? false : true;
+
+    // The results are simdized in place, with masked vector transfers when J
+    // is not a compile time multiple of the vector length.
+    if (J.isLiteral() && J.getLiteral() < jRegTile) {
+      // Very small computation, give up on SIMD.
+      simdize = false;
     }
 
     // 2) Alloc data for tiles.
@@ -157,27 +231,37 @@ struct ONNXGemmOpLowering : public ConversionPattern {
         MemRefType::get({iCacheTile, kCacheTile}, elementType);
     MemRefType bTileType =
         MemRefType::get({kCacheTile, jCacheTile}, elementType);
-    MemRefType rTileType =
-        MemRefType::get({iCacheTile, jCacheTile}, elementType);
+    IntegerAttr alignAttr = rewriter.getI64IntegerAttr(BUFFER_ALIGN);
+    // Constant B matrices are packed into their tiles at compile time, the
+    // tiles of B are then read in place instead of being copied to bBuff.
+    Value packedB = emitPackedMatMulPanels(
+        rewriter, loc, B, bTrans, tiles, downcastWeightsToBF16);
+    Value aBuff, bBuff;
+    auto allocTileBuffers = [&]() {
+      ValueRange empty;
+      aBuff = memref_alloc(aTileType, empty, alignAttr);
+      if (!packedB)
+        bBuff = memref_alloc(bTileType, empty, alignAttr);
+    };
+    auto deallocTileBuffers = [&]() {
+      memref_dealloc(aBuff);
+      if (!packedB)
+        memref_dealloc(bBuff);
+    };
+    // When the outermost cache tile loop is parallel, the tile buffers are
+    // private to each of its iterations and thus allocated inside that loop.
+    if (!parallelize) {
 #if DEBUG_GLOBAL_ALLOC_FREE
-    SmallVector<IndexExpr, 1> empty;
-    Value aBuff = insertAllocAndDeallocSimple(
-        rewriter, gemmOp, aTileType, loc, empty, true, BUFFER_ALIGN);
-    Value bBuff = insertAllocAndDeallocSimple(
-        rewriter, gemmOp, bTileType, loc, empty, true, BUFFER_ALIGN);
-    Value rBuff;
-    if (mustTileR)
-      rBuff = insertAllocAndDeallocSimple(
+      SmallVector<IndexExpr, 1> empty;
+      aBuff = insertAllocAndDeallocSimple(
           rewriter, gemmOp, aTileType, loc, empty, true, BUFFER_ALIGN);
+      if (!packedB)
+        bBuff = insertAllocAndDeallocSimple(
+            rewriter, gemmOp, bTileType, loc, empty, true, BUFFER_ALIGN);
 #else
-    ValueRange empty;
-    IntegerAttr alignAttr = rewriter.getI64IntegerAttr(BUFFER_ALIGN);
-    Value aBuff = memref_alloc(aTileType, empty, alignAttr);
-    Value bBuff = memref_alloc(bTileType, empty, alignAttr);
-    Value rBuff;
-    if (mustTileR)
-      rBuff = memref_alloc(rTileType, empty, alignAttr);
+      allocTileBuffers();
 #endif
+    }
 
     // 3) introduce the loops and permute them
     // I, J, K loop.
@@ -195,97 +279,100 @@ struct ONNXGemmOpLowering : public ConversionPattern {
     ValueRange kCacheBlock = krnl_block(kk, kCacheTile);
     Value kk1(kCacheBlock[0]), kk2(kCacheBlock[1]);
 
-    // If we must tile the result R, then we put I & J in the outermost.
-    // Otherwise, we follow the more traditional scheme of having J & K in the
-    // outermost.
-    if (mustTileR) {
-      // (cache) ii1 jj1 kk1,    (reg) jj2, ii2,    (matmul) ii3, jj3, kk3
-      krnl_permute({ii1, ii2, ii3, jj1, jj2, jj3, kk1, kk2},
-          {/*i*/ 0, 4, 5, /*j*/ 1, 3, 6, /*k*/ 2, 7});
-      // Compute: A[i, k] * b[k, j] -> R[i, j])
-      krnl_iterate_ie(
-          {ii, jj}, {ii1, jj1}, {zero, zero}, {I, J}, {}, [&](ValueRange args) {
-            ValueRange i1_j1_indices = krnl_get_induction_var_value({ii1, jj1});
-            Value i1(i1_j1_indices[0]), j1(i1_j1_indices[1]);
-            krnl_copy_to_buffer(rBuff, R, {i1, j1}, zeroVal, false);
-            krnl_iterate_ie({kk}, {kk1}, {zero}, {K}, {}, [&](ValueRange args) {
-              ValueRange k1_index = krnl_get_induction_var_value({kk1});
-              Value k1(k1_index[0]);
-              if (aTrans)
-                krnl_copy_to_buffer(aBuff, A, {k1, i1}, zeroVal, true);
-              else
-                krnl_copy_to_buffer(aBuff, A, {i1, k1}, zeroVal, false);
-              if (bTrans)
-                krnl_copy_to_buffer(bBuff, B, {j1, k1}, zeroVal, true);
-              else
-                krnl_copy_to_buffer(bBuff, B, {k1, j1}, zeroVal, false);
-              krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
-                ValueRange j2_i2_indices =
-                    krnl_get_induction_var_value({jj2, ii2});
-                Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
-                krnl_matmul(aBuff, {i1, k1}, bBuff, {k1, j1}, rBuff, {i1, j1},
-                    /*loops*/ {ii3, jj3, kk2},
-                    /*compute start*/ {i2, j2, k1},
-                    /*ubs*/ {I.getValue(), J.getValue(), K.getValue()},
-                    /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
-                    /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
-              });
-            });
-            krnl_copy_from_buffer(rBuff, R, {i1, j1});
-          });
+    // The tile of B starting at (k1, j1), and its start indices. K being the
+    // innermost cache tile loop, the next tile of B, which is prefetched
+    // during the copy, starts at (k1 + kCacheTile, j1).
+    auto getBTile = [&](Value k1, Value j1, SmallVectorImpl<Value> &bStart) {
+      if (!packedB) {
+        if (bTrans)
+          krnl_copy_to_buffer(bBuff, B, {j1, k1}, abZeroVal, true);
+        else
+          krnl_copy_to_buffer(
+              bBuff, B, {k1, j1}, abZeroVal, false, {kCacheTile, 0});
+        bStart.append({k1, j1});
+        return bBuff;
+      }
+      LiteralIndexExpr kTile(kCacheTile), jTile(jCacheTile);
+      Value kt = DimIndexExpr(k1).floorDiv(kTile).getValue();
+      Value jt = DimIndexExpr(j1).floorDiv(jTile).getValue();
+      bStart.append({kt, jt, k1, j1});
+      return packedB;
+    };
 
-    } else {
-      // Does not have to tile the result.
-      // (cache) jj1 kk1, ii1, (reg) jj2, ii2, (matmul) ii3, jj3, kk3
-      krnl_permute({jj1, jj2, jj3, kk1, kk2, ii1, ii2, ii3},
-          {/*j*/ 0, 3, 5, /*k*/ 1, 6, /*i*/ 2, 4, 7});
-      // Compute: A[i, k] * b[k, j] -> R[i, j])
-      krnl_iterate_ie(
-          {jj, kk}, {jj1, kk1}, {zero, zero}, {J, K}, {}, [&](ValueRange args) {
-            ValueRange j1_k1_indices = krnl_get_induction_var_value({jj1, kk1});
-            Value j1(j1_k1_indices[0]), k1(j1_k1_indices[1]);
-            if (bTrans)
-              krnl_copy_to_buffer(bBuff, B, {j1, k1}, zeroVal, true);
+    // (cache) jj1 kk1, ii1, (reg) jj2, ii2, (matmul) ii3, jj3, kk3
+    krnl_permute({jj1, jj2, jj3, kk1, kk2, ii1, ii2, ii3},
+        {/*j*/ 0, 3, 5, /*k*/ 1, 6, /*i*/ 2, 4, 7});
+    if (parallelize)
+      krnl_parallel(jj1);
+    // Compute: A[i, k] * b[k, j] -> R[i, j])
+    krnl_iterate_ie(
+        {jj, kk}, {jj1, kk1}, {zero, zero}, {J, K}, {}, [&](ValueRange args) {
+          ValueRange j1_k1_indices = krnl_get_induction_var_value({jj1, kk1});
+          Value j1(j1_k1_indices[0]), k1(j1_k1_indices[1]);
+          if (parallelize)
+            allocTileBuffers();
+          SmallVector<Value, 4> bStart;
+          Value bTile = getBTile(k1, j1, bStart);
+          krnl_iterate_ie({ii}, {ii1}, {zero}, {I}, {}, [&](ValueRange args) {
+            ValueRange i1_index = krnl_get_induction_var_value({ii1});
+            Value i1(i1_index[0]);
+            // Prefetch the next tile of A, at (i1 + iCacheTile, k1).
+            if (aTrans)
+              krnl_copy_to_buffer(aBuff, A, {k1, i1}, abZeroVal, true);
             else
-              krnl_copy_to_buffer(bBuff, B, {k1, j1}, zeroVal, false);
-            krnl_iterate_ie({ii}, {ii1}, {zero}, {I}, {}, [&](ValueRange args) {
-              ValueRange i1_index = krnl_get_induction_var_value({ii1});
-              Value i1(i1_index[0]);
-              if (aTrans)
-                krnl_copy_to_buffer(aBuff, A, {k1, i1}, zeroVal, true);
-              else
-                krnl_copy_to_buffer(aBuff, A, {i1, k1}, zeroVal, false);
-              krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
-                ValueRange j2_i2_indices =
-                    krnl_get_induction_var_value({jj2, ii2});
-                Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
-                krnl_matmul(aBuff, {i1, k1}, bBuff, {k1, j1}, R, {z, z},
-                    /*loops*/ {ii3, jj3, kk2},
-                    /*compute start*/ {i2, j2, k1},
-                    /*ubs*/ {I.getValue(), J.getValue(), K.getValue()},
-                    /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
-                    /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
-              });
+              krnl_copy_to_buffer(
+                  aBuff, A, {i1, k1}, abZeroVal, false, {iCacheTile, 0});
+            krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
+              ValueRange j2_i2_indices =
+                  krnl_get_induction_var_value({jj2, ii2});
+              Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
+              krnl_matmul(aBuff, {i1, k1}, bTile, bStart, R, {z, z},
+                  /*loops*/ {ii3, jj3, kk2},
+                  /*compute start*/ {i2, j2, k1},
+                  /*ubs*/ {I.getValue(), J.getValue(), K.getValue()},
+                  /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
+                  /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
             });
           });
-    }
+          if (parallelize)
+            deallocTileBuffers();
+        });
 
 #if DEBUG_GLOBAL_ALLOC_FREE
 #else
-    rewriter.create<memref::DeallocOp>(loc, aBuff);
-    rewriter.create<memref::DeallocOp>(loc, bBuff);
-    if (mustTileR)
-      rewriter.create<memref::DeallocOp>(loc, rBuff);
+    if (!parallelize)
+      deallocTileBuffers();
 #endif
 
-    // Perform the alpha/beta computations.
+    emitGemmEpilogue(gemmOp, operandAdaptor, elementType, accType,
+        shapeHelper, alloc, R, alphaVal, betaVal, epilogueOp, rewriter, loc);
+  }
+
+  // Perform the alpha/beta computations, the activation and the store
+  // epilogue, if any, in a single pass over the product R of A and B,
+  // accumulated in accType, storing the results into alloc.
+  void emitGemmEpilogue(GemmOp &gemmOp, GemmOpAdaptor &operandAdaptor,
+      Type elementType, Type accType, GemmShapeHelper &shapeHelper,
+      Value alloc, Value R, Value alphaVal, Value betaVal,
+      Operation *epilogueOp, ConversionPatternRewriter &rewriter,
+      Location loc) const {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    IndexExpr I = shapeHelper.dimsForOutput()[0];
+    IndexExpr J = shapeHelper.dimsForOutput()[1];
+    LiteralIndexExpr zero(0);
     float alphaLit = gemmOp.alpha().convertToFloat();
     float betaLit = gemmOp.beta().convertToFloat();
-    if (alphaLit == 1.0 && (betaLit == 0.0 || !shapeHelper.hasBias)) {
+    StringRef activation = getGemmActivation(gemmOp);
+    if (alphaLit == 1.0 && (betaLit == 0.0 || !shapeHelper.hasBias) &&
+        activation.empty() && !epilogueOp && R == alloc) {
       // No need for the multiply/add.
       return;
     }
     ValueRange outerLoops = krnl_define_loop(2);
+    if (!DEBUG_PARALLEL_OFF)
+      krnl_parallel(outerLoops[0]);
     krnl_iterate_ie(outerLoops, {zero, zero}, {I, J}, {}, [&](ValueRange args) {
       // Outer loop indices.
       ValueRange outerIndices = krnl_get_induction_var_value(outerLoops);
@@ -304,11 +391,17 @@ struct ONNXGemmOpLowering : public ConversionPattern {
               IndexExpr::select(dim > 1, DimIndexExpr(outerIndices[x]), 0));
         }
         Value c = krnl_load(operandAdaptor.C(), cAccess);
+        if (accType != elementType)
+          c = rewriter.create<FPExtOp>(loc, accType, c);
         if (betaLit != 1.0)
           c = std_mulf(betaVal, c);
         res = std_addf(res, c);
       }
-      krnl_store(res, R, outerIndices);
+      res = emitGemmActivation(rewriter, loc, activation, accType, res);
+      if (R != alloc)
+        res = rewriter.create<FPTruncOp>(loc, elementType, res);
+      res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
+      krnl_store(res, alloc, outerIndices);
     });
   }
 
@@ -316,10 +409,10 @@ struct ONNXGemmOpLowering : public ConversionPattern {
       ConversionPatternRewriter &rewriter) const final {
 
     // Get shape.
-    ONNXGemmOpAdaptor operandAdaptor(operands);
-    ONNXGemmOp gemmOp = llvm::cast<ONNXGemmOp>(op);
+    GemmOpAdaptor operandAdaptor(operands);
+    GemmOp gemmOp = llvm::cast<GemmOp>(op);
     Location loc = op->getLoc();
-    ONNXGemmOpShapeHelper shapeHelper(&gemmOp, rewriter,
+    GemmShapeHelper shapeHelper(&gemmOp, rewriter,
         getDenseElementAttributeFromKrnlValue,
         loadDenseElementArrayValueAtIndex);
     auto shapecomputed = shapeHelper.Compute(operandAdaptor);
@@ -329,10 +422,15 @@ struct ONNXGemmOpLowering : public ConversionPattern {
     ScopedContext scope(rewriter, loc);
 
     // Insert an allocation and deallocation for the output of this operation.
+    // The result of the store epilogue op, if any, is stored instead.
+    Operation *epilogueOp =
+        fuseStoreEpilogues ? getStoreEpilogueOp(op) : nullptr;
     MemRefType outputMemRefType = convertToMemRefType(*op->result_type_begin());
     Type elementType = outputMemRefType.getElementType();
     Value alloc = insertAllocAndDeallocSimple(rewriter, op, outputMemRefType,
-        loc, shapeHelper.dimsForOutput(0), (int64_t)BUFFER_ALIGN);
+        loc, shapeHelper.dimsForOutput(0),
+        checkInsertDealloc(epilogueOp ? epilogueOp : op),
+        (int64_t)BUFFER_ALIGN);
 
     // Get the constants: zero, alpha,and beta.
     float alphaLit = gemmOp.alpha().convertToFloat();
@@ -373,17 +471,21 @@ struct ONNXGemmOpLowering : public ConversionPattern {
 
     if (DEBUG_OPTIMIZED_OFF) {
       genericGemm(gemmOp, operandAdaptor, elementType, shapeHelper, alloc, zero,
-          alpha, beta, rewriter, loc);
+          alpha, beta, epilogueOp, rewriter, loc);
     } else {
       tiledTransposedGemm(gemmOp, operandAdaptor, elementType, shapeHelper,
-          alloc, zero, alpha, beta, rewriter, loc);
+          alloc, zero, alpha, beta, epilogueOp, rewriter, loc);
     }
-    rewriter.replaceOp(op, alloc);
+    replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
     return success();
   }
 };
 
-void populateLoweringONNXGemmOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx) {
-  patterns.insert<ONNXGemmOpLowering<ONNXGemmOp>>(ctx);
+void populateLoweringONNXGemmOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes,
+    bool downcastWeightsToBF16, bool fuseStoreEpilogues) {
+  patterns.insert<ONNXGemmOpLowering<ONNXGemmOp, ONNXGemmOpAdaptor>>(
+      ctx, tileSizes, downcastWeightsToBF16, fuseStoreEpilogues);
+  patterns.insert<ONNXGemmOpLowering<ONNXFusedGemmOp, ONNXFusedGemmOpAdaptor>>(
+      ctx, tileSizes, downcastWeightsToBF16, fuseStoreEpilogues);
 }
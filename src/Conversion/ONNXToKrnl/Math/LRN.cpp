@@ -17,6 +17,153 @@
 
 using namespace mlir;
 
+// Number of bytes of the vectors of the sliding window along the innermost
+// spatial dimension.
+static const int64_t lrnVectorBytes = 32;
+
+// Lower an LRN with static shapes by sliding the window of channels of the
+// square sum: for each pixel the sum of the window of channel c is the sum of
+// channel c - 1, plus the square of the channel entering the window and minus
+// the square of the channel leaving it, i.e. O(C) per pixel instead of
+// O(C * size). The channels are split into at most three ranges, where a
+// channel enters and/or leaves the window, so that no condition is computed
+// per channel. The pixels of the innermost dimension are computed by vectors
+// when they fill whole vectors.
+static void emitSlidingWindowLRN(ConversionPatternRewriter &rewriter,
+    Location loc, ONNXLRNOp lrnOp, Value input, Value alloc) {
+  auto memRefType = alloc.getType().cast<MemRefType>();
+  auto shape = memRefType.getShape();
+  Type elementType = memRefType.getElementType();
+  int64_t rank = shape.size();
+  int64_t channels = shape[1];
+  int64_t sizeLit = lrnOp.size();
+  // The window of channel c is [c - before, c + after].
+  int64_t before = (sizeLit - 1) / 2;
+  int64_t after = sizeLit / 2;
+
+  int64_t vectorLen =
+      lrnVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  if (shape[rank - 1] % vectorLen != 0)
+    vectorLen = 1;
+  Type type = elementType;
+  Value inputView = input, allocView = alloc;
+  if (vectorLen > 1) {
+    type = VectorType::get({vectorLen}, elementType);
+    inputView = rewriter.create<KrnlVectorTypeCastOp>(loc, input, vectorLen);
+    allocView = rewriter.create<KrnlVectorTypeCastOp>(loc, alloc, vectorLen);
+  }
+  auto getConstant = [&](double value) -> Value {
+    Value scalar = emitConstantOp(rewriter, loc, elementType, value);
+    if (vectorLen > 1)
+      return rewriter.create<SplatOp>(loc, type, scalar);
+    return scalar;
+  };
+  Value zero = getConstant(0);
+  Value bias = getConstant(lrnOp.bias().convertToFloat());
+  Value alphaDivSize =
+      getConstant(lrnOp.alpha().convertToFloat() / (float)sizeLit);
+  Value beta = getConstant(lrnOp.beta().convertToFloat());
+
+  // Loops over all the dimensions but the channels, the innermost one by
+  // vectors. The first loop with more than one iteration is parallel.
+  OpBuilder::InsertionGuard insertGuard(rewriter);
+  BuildKrnlLoop pixelLoops(rewriter, loc, rank - 1);
+  pixelLoops.createDefineOp();
+  SmallVector<int64_t, 4> pixelUbs;
+  for (int64_t i = 0; i < rank; ++i)
+    if (i != 1)
+      pixelUbs.emplace_back(i == rank - 1 ? shape[i] / vectorLen : shape[i]);
+  for (int64_t ub : pixelUbs)
+    pixelLoops.pushBounds(0, ub);
+  for (int64_t i = 0; i < rank - 1; ++i)
+    if (pixelUbs[i] > 1) {
+      pixelLoops.parallelizeLoop(i);
+      break;
+    }
+  pixelLoops.createIterateOp();
+  rewriter.setInsertionPointToStart(pixelLoops.getIterateBlock());
+  ArrayRef<BlockArgument> pixelIVs = pixelLoops.getAllInductionVar();
+
+  auto getIndices = [&](Value c) {
+    SmallVector<Value, 4> indices;
+    indices.emplace_back(pixelIVs[0]);
+    indices.emplace_back(c);
+    indices.append(pixelIVs.begin() + 1, pixelIVs.end());
+    return indices;
+  };
+  auto emitSquareAt = [&](Value c) -> Value {
+    Value x = rewriter.create<KrnlLoadOp>(loc, inputView, getIndices(c));
+    return rewriter.create<MulFOp>(loc, x, x);
+  };
+  auto emitChannelOffset = [&](Value c, int64_t offset) -> Value {
+    return rewriter.create<AddIOp>(
+        loc, c, rewriter.create<ConstantIndexOp>(loc, offset));
+  };
+  auto emitChannelLoop = [&](int64_t lb, int64_t ub,
+                             function_ref<void(Value)> bodyFn) {
+    OpBuilder::InsertionGuard insertGuard(rewriter);
+    BuildKrnlLoop channelLoop(rewriter, loc, 1);
+    channelLoop.createDefineOp();
+    channelLoop.pushBounds(lb, ub);
+    channelLoop.createIterateOp();
+    rewriter.setInsertionPointToStart(channelLoop.getIterateBlock());
+    bodyFn(channelLoop.getInductionVar(0));
+  };
+
+  // The running square sum starts with the channels [0, after).
+  Value sumAlloc =
+      rewriter.create<memref::AllocaOp>(loc, MemRefType::get({}, type));
+  rewriter.create<KrnlStoreOp>(loc, zero, sumAlloc, ArrayRef<Value>{});
+  auto addToSum = [&](Value value, bool subtract) {
+    Value sum = rewriter.create<KrnlLoadOp>(loc, sumAlloc, ArrayRef<Value>{});
+    if (subtract)
+      sum = rewriter.create<SubFOp>(loc, sum, value);
+    else
+      sum = rewriter.create<AddFOp>(loc, sum, value);
+    rewriter.create<KrnlStoreOp>(loc, sum, sumAlloc, ArrayRef<Value>{});
+  };
+  emitChannelLoop(0, std::min(after, channels),
+      [&](Value c) { addToSum(emitSquareAt(c), /*subtract=*/false); });
+
+  // Channel c + after enters the window when c < C - after, and channel
+  // c - before - 1 leaves it when c > before.
+  int64_t enterUb = std::max<int64_t>(channels - after, 0);
+  int64_t leaveLb = std::min(before + 1, channels);
+  SmallVector<int64_t, 4> bounds = {0, std::min(enterUb, leaveLb),
+      std::max(enterUb, leaveLb), channels};
+  for (unsigned i = 0; i + 1 < bounds.size(); ++i) {
+    int64_t lb = bounds[i], ub = bounds[i + 1];
+    if (lb >= ub)
+      continue;
+    bool enters = lb < enterUb;
+    bool leaves = lb >= leaveLb;
+    emitChannelLoop(lb, ub, [&](Value c) {
+      if (enters)
+        addToSum(emitSquareAt(emitChannelOffset(c, after)),
+            /*subtract=*/false);
+      if (leaves)
+        addToSum(emitSquareAt(emitChannelOffset(c, -before - 1)),
+            /*subtract=*/true);
+      // The subtractions may round the sum below zero.
+      Value sum =
+          rewriter.create<KrnlLoadOp>(loc, sumAlloc, ArrayRef<Value>{});
+      Value isNegative =
+          rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, sum, zero);
+      sum = rewriter.create<SelectOp>(loc, isNegative, zero, sum);
+
+      // y = x / ((bias + (alpha / nsize) * square_sum) ** beta)
+      SmallVector<Value, 4> indices = getIndices(c);
+      Value x = rewriter.create<KrnlLoadOp>(loc, inputView, indices);
+      Value scale = rewriter.create<math::PowFOp>(loc,
+          rewriter.create<AddFOp>(loc, bias,
+              rewriter.create<MulFOp>(loc, alphaDivSize, sum)),
+          beta);
+      rewriter.create<KrnlStoreOp>(loc,
+          rewriter.create<DivFOp>(loc, x, scale), allocView, indices);
+    });
+  }
+}
+
 struct ONNXLRNOpLowering : public ConversionPattern {
   ONNXLRNOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXLRNOp::getOperationName(), 1, ctx) {}
@@ -55,6 +202,16 @@ struct ONNXLRNOpLowering : public ConversionPattern {
     Value alloc = insertAllocAndDeallocSimple(
         rewriter, op, outputMemRefType, loc, shapeHelper.dimsForOutput(0));
 
+    // Static float inputs with identity layouts slide a window of channels.
+    auto inputMemRefType = input.getType().cast<MemRefType>();
+    if (outputRank >= 3 && hasAllConstantDimensions(outputMemRefType) &&
+        elementType.isa<FloatType>() &&
+        inputMemRefType.getAffineMaps().empty()) {
+      emitSlidingWindowLRN(rewriter, loc, lrnOp, input, alloc);
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
+
     BuildKrnlLoop outputLoops(rewriter, loc, outputRank);
     outputLoops.createDefineOp();
     outputLoops.pushAllBounds(shapeHelper.dimsForOutput(0));
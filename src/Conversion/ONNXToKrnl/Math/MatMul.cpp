@@ -25,8 +25,16 @@
 using namespace mlir;
 
 struct ONNXMatMulOpLowering : public ConversionPattern {
-  ONNXMatMulOpLowering(MLIRContext *ctx)
-      : ConversionPattern(mlir::ONNXMatMulOp::getOperationName(), 1, ctx) {}
+  MatMulTileSizes tileSizes;
+  bool downcastWeightsToBF16 = false;
+
+  ONNXMatMulOpLowering(MLIRContext *ctx,
+      const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+      bool downcastWeightsToBF16 = false)
+      : ConversionPattern(mlir::ONNXMatMulOp::getOperationName(), 1, ctx) {
+    this->tileSizes = tileSizes;
+    this->downcastWeightsToBF16 = downcastWeightsToBF16;
+  }
 
   // Handle the generic cases, including when there are broadcasts.
   void replaceGenericMatmul(ONNXMatMulOp &matMulOp,
@@ -101,6 +109,11 @@ struct ONNXMatMulOpLowering : public ConversionPattern {
     // Add mat mul operation.
     Value loadedA = krnl_load(operandAdaptor.A(), aAccessFct);
     Value loadedB = krnl_load(operandAdaptor.B(), bAccessFct);
+    if (loadedA.getType() != elementType) {
+      // Half precision products are accumulated in single precision.
+      loadedA = rewriter.create<FPExtOp>(loc, elementType, loadedA);
+      loadedB = rewriter.create<FPExtOp>(loc, elementType, loadedB);
+    }
     Value loadedY =
         rewriter.create<KrnlLoadOp>(loc, reductionVal, ArrayRef<Value>{});
     Value AB = rewriter.create<MulFOp>(loc, loadedA, loadedB);
@@ -143,7 +156,10 @@ struct ONNXMatMulOpLowering : public ConversionPattern {
 
     // Compute.
     // Define blocking, with simdization along the j axis.
-    const int64_t iRegTile(4), jRegTile(8), kRegTile(4);
+    const MatMulTileSizes tiles =
+        tileSizes.forShape(shapeHelper.dimsForOutput(0)[0],
+            shapeHelper.dimsForOutput(0)[1], shapeHelper.aDims[1]);
+    const int64_t iRegTile(tiles.iReg), jRegTile(tiles.jReg), kRegTile(4);
     // I, J, K loop.
     ValueRange origLoop = krnl_define_loop(3);
     Value ii(origLoop[0]), jj(origLoop[1]), kk(origLoop[2]);
@@ -162,12 +178,142 @@ struct ONNXMatMulOpLowering : public ConversionPattern {
           Value i1(indices[0]), j1(indices[1]), k1(indices[2]);
           krnl_matmul(A, {zero, zero}, B, {zero, zero}, C, {zero, zero},
               {ii2, jj2, kk2}, {i1, j1, k1}, {I, J, K},
-              {iRegTile, jRegTile, kRegTile}, {}, {}, {}, true, true, false);
+              {iRegTile, jRegTile, kRegTile}, {}, {}, {}, tiles.simdize,
+              tiles.unroll, false);
         });
   }
 
-  // Handle the cases with 2x2 matrices both for A, B, and C without broadcast.
-  // Implementation here uses the efficient 2d tiling plus kernel substitution.
+  // Handle the cases where both A and B have at least 2 dims, with one
+  // [I, K] x [K, J] matrix multiply per batch, and broadcast along the batch
+  // dims. Matrices exceeding a single cache tile are packed into tile buffers
+  // like in Gemm, the smaller ones are register tiled in place.
+  void replaceTiledMatmul(ONNXMatMulOp &matMulOp,
+      ONNXMatMulOpAdaptor &operandAdaptor, Type elementType,
+      ONNXMatMulOpShapeHelper &shapeHelper, Value alloc, Value zeroVal,
+      ConversionPatternRewriter &rewriter, Location loc) const {
+
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    // Define scopes
+    ScopedContext scope(rewriter, loc);
+
+    Value A(operandAdaptor.A()), B(operandAdaptor.B()), C(alloc);
+    SmallVector<IndexExpr, 4> outputDims(shapeHelper.dimsForOutput(0));
+    int rank = outputDims.size();
+    int batchRank = rank - 2;
+    IndexExpr I(outputDims[rank - 2]), J(outputDims[rank - 1]),
+        K(shapeHelper.aDims[rank - 1]);
+    const MatMulTileSizes tiles = tileSizes.forShape(I, J, K);
+    bool registerTileOnly = fitsInMatMulCacheTile(I, J, K, tiles);
+    const int64_t iRegTile(tiles.iReg), jRegTile(tiles.jReg), kRegTile(4);
+
+    // The loops over the batch dims are parallel candidates: use the
+    // outermost one that is not known to be a single iteration, and the
+    // outermost tile loop of the matrix multiplies otherwise.
+    int parallelBatchDim = -1;
+    for (int i = 0; i < batchRank; ++i)
+      if (!outputDims[i].isLiteral() || outputDims[i].getLiteral() > 1) {
+        parallelBatchDim = i;
+        break;
+      }
+
+    // A constant B matrix shared by all the batches is multiplied as a CSR
+    // matrix when it has enough zeros, and is otherwise packed into its tiles
+    // at compile time, unless the multiplies are offloaded to BLAS.
+    Optional<SparseMatMulMatrix> sparseB;
+    if (isSparseMatMulConstant(B, tiles))
+      sparseB = emitSparseMatMulGlobals(rewriter, loc, B, /*transposed=*/false);
+    Value packedB;
+    if (!sparseB && !registerTileOnly &&
+        B.getType().cast<MemRefType>().getRank() == 2 &&
+        !isBlasSgemm(A, B, C, I, J, K, tiles))
+      packedB = emitPackedMatMulPanels(rewriter, loc, B, /*transposed=*/false,
+          tiles, downcastWeightsToBF16);
+
+    // Emit the matrix multiply of the batch given by the batch indices.
+    auto emitMatrixMultiply = [&](ValueRange batchIndices) {
+      IndexExprScope innerScope;
+      SymbolIndexExpr i(I), j(J), k(K);
+      LiteralIndexExpr zeroIE(0);
+      Value zero = zeroIE.getValue();
+
+      // Batch indices of A, B, and C: padded dims have no index, and
+      // broadcast dims are accessed at 0.
+      SmallVector<Value, 4> aPrefix, bPrefix;
+      SmallVector<Value, 4> cPrefix(batchIndices.begin(), batchIndices.end());
+      for (int d = 0; d < batchRank; ++d) {
+        if (!shapeHelper.aPadDims[d])
+          aPrefix.emplace_back(shapeHelper.aDims[d].isLiteralAndIdenticalTo(1)
+                                   ? zero
+                                   : batchIndices[d]);
+        if (!shapeHelper.bPadDims[d])
+          bPrefix.emplace_back(shapeHelper.bDims[d].isLiteralAndIdenticalTo(1)
+                                   ? zero
+                                   : batchIndices[d]);
+      }
+      auto withPrefix = [](ValueRange prefix, ValueRange indices) {
+        SmallVector<Value, 4> res(prefix.begin(), prefix.end());
+        res.append(indices.begin(), indices.end());
+        return res;
+      };
+
+      // Initialize the result matrix to zero.
+      ValueRange zLoop = krnl_define_loop(2);
+      krnl_iterate_ie(
+          zLoop, {zeroIE, zeroIE}, {i, j}, {}, [&](ValueRange args) {
+            ValueRange indices = krnl_get_induction_var_value(zLoop);
+            krnl_store(zeroVal, C, withPrefix(cPrefix, indices));
+          });
+
+      if (sparseB) {
+        emitSparseMatMul(A, aPrefix, /*transA=*/false, *sparseB, C, cPrefix, i,
+            k, /*parallelize=*/parallelBatchDim < 0);
+        return;
+      }
+      if (!registerTileOnly) {
+        emitTiledMatMul(A, aPrefix, B, bPrefix, C, cPrefix, i, j, k, zeroVal,
+            tiles, /*parallelize=*/parallelBatchDim < 0, packedB);
+        return;
+      }
+
+      // Register tiling only, with simdization along the j axis.
+      ValueRange origLoop = krnl_define_loop(3);
+      Value ii(origLoop[0]), jj(origLoop[1]), kk(origLoop[2]);
+      ValueRange iRegBlock = krnl_block(ii, iRegTile);
+      Value ii1(iRegBlock[0]), ii2(iRegBlock[1]);
+      ValueRange jRegBlock = krnl_block(jj, jRegTile);
+      Value jj1(jRegBlock[0]), jj2(jRegBlock[1]);
+      ValueRange kRegBlock = krnl_block(kk, kRegTile);
+      Value kk1(kRegBlock[0]), kk2(kRegBlock[1]);
+      krnl_permute({ii1, ii2, jj1, jj2, kk1, kk2}, {0, 3, 1, 4, 2, 5});
+      krnl_iterate_ie({ii, jj, kk}, {ii1, jj1, kk1}, {zeroIE, zeroIE, zeroIE},
+          {i, j, k}, {}, [&](ValueRange args) {
+            ValueRange indices = krnl_get_induction_var_value({ii1, jj1, kk1});
+            Value i1(indices[0]), j1(indices[1]), k1(indices[2]);
+            krnl_matmul(A, withPrefix(aPrefix, {zero, zero}), B,
+                withPrefix(bPrefix, {zero, zero}), C,
+                withPrefix(cPrefix, {zero, zero}), {ii2, jj2, kk2},
+                {i1, j1, k1}, {i.getValue(), j.getValue(), k.getValue()},
+                {iRegTile, jRegTile, kRegTile}, {}, {}, {}, tiles.simdize,
+                tiles.unroll, false);
+          });
+    };
+
+    if (batchRank == 0) {
+      emitMatrixMultiply({});
+      return;
+    }
+    ValueRange batchLoops = krnl_define_loop(batchRank);
+    if (parallelBatchDim >= 0)
+      krnl_parallel(batchLoops[parallelBatchDim]);
+    SmallVector<IndexExpr, 4> batchLbs(batchRank, LiteralIndexExpr(0));
+    SmallVector<IndexExpr, 4> batchUbs(
+        outputDims.begin(), outputDims.begin() + batchRank);
+    krnl_iterate_ie(batchLoops, batchLbs, batchUbs, {}, [&](ValueRange args) {
+      emitMatrixMultiply(krnl_get_induction_var_value(batchLoops));
+    });
+  }
 
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
@@ -189,18 +335,50 @@ struct ONNXMatMulOpLowering : public ConversionPattern {
     Value alloc = insertAllocAndDeallocSimple(
         rewriter, op, outputMemRefType, loc, shapeHelper.dimsForOutput(0));
 
+    // Half precision products are accumulated in single precision, into a
+    // temporary result converted back below.
+    Type accType = getMatMulAccumulationType(elementType);
+    Value acc = alloc;
+    if (accType != elementType)
+      acc = insertAllocAndDeallocSimple(rewriter, op,
+          MemRefType::get(outputMemRefType.getShape(), accType), loc,
+          shapeHelper.dimsForOutput(0), /*insertDealloc=*/true);
+
     // Get the constants: zero.
-    Value zero = emitConstantOp(rewriter, loc, elementType, 0);
+    Value zero = emitConstantOp(rewriter, loc, accType, 0);
 
     Value A(operandAdaptor.A()), B(operandAdaptor.B());
     MemRefBoundsIndexCapture aBounds(A), bBounds(B);
 
-    if (aBounds.getRank() == 2 && bBounds.getRank() == 2) {
-      replace2x2Matmul2d(matMulOp, operandAdaptor, elementType, shapeHelper,
-          alloc, zero, rewriter, loc);
+    // The small matrix multiplies are register tiled in place, unless B is
+    // multiplied as a sparse matrix.
+    if (aBounds.getRank() == 2 && bBounds.getRank() == 2 &&
+        !isSparseMatMulConstant(B, tileSizes) &&
+        fitsInMatMulCacheTile(shapeHelper.dimsForOutput(0)[0],
+            shapeHelper.dimsForOutput(0)[1], shapeHelper.aDims[1],
+            tileSizes)) {
+      replace2x2Matmul2d(matMulOp, operandAdaptor, accType, shapeHelper, acc,
+          zero, rewriter, loc);
+    } else if (aBounds.getRank() >= 2 && bBounds.getRank() >= 2) {
+      replaceTiledMatmul(matMulOp, operandAdaptor, accType, shapeHelper, acc,
+          zero, rewriter, loc);
     } else {
-      replaceGenericMatmul(matMulOp, operandAdaptor, elementType, shapeHelper,
-          alloc, zero, rewriter, loc);
+      replaceGenericMatmul(matMulOp, operandAdaptor, accType, shapeHelper, acc,
+          zero, rewriter, loc);
+    }
+
+    if (acc != alloc) {
+      BuildKrnlLoop convertLoops(rewriter, loc, outputMemRefType.getRank());
+      convertLoops.createDefineOp();
+      convertLoops.pushAllBounds(shapeHelper.dimsForOutput(0));
+      convertLoops.createIterateOp();
+      rewriter.setInsertionPointToStart(convertLoops.getIterateBlock());
+      SmallVector<Value, 4> loopIVs;
+      for (auto arg : convertLoops.getIterateBlock()->getArguments())
+        loopIVs.emplace_back(arg);
+      Value res = rewriter.create<KrnlLoadOp>(loc, acc, loopIVs);
+      res = rewriter.create<FPTruncOp>(loc, elementType, res);
+      rewriter.create<KrnlStoreOp>(loc, res, alloc, loopIVs);
     }
     // Done.
     rewriter.replaceOp(op, alloc);
@@ -208,7 +386,8 @@ struct ONNXMatMulOpLowering : public ConversionPattern {
   }
 };
 
-void populateLoweringONNXMatMulOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx) {
-  patterns.insert<ONNXMatMulOpLowering>(ctx);
+void populateLoweringONNXMatMulOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes,
+    bool downcastWeightsToBF16) {
+  patterns.insert<ONNXMatMulOpLowering>(ctx, tileSizes, downcastWeightsToBF16);
 }
@@ -13,10 +13,22 @@
 //===----------------------------------------------------------------------===//
 
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
 #include "src/Dialect/ONNX/ONNXShapeHelper.hpp"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
 
 using namespace mlir;
 
+#define BUFFER_ALIGN 128
+
+// Size in bytes of the vectors accumulating the reductions.
+static const int64_t reductionVectorBytes = 32;
+
+// Maximum number of partial results computed in parallel by the reductions
+// along the outermost dimensions, combined pairwise afterwards.
+static const int64_t reductionParallelChunks = 8;
+
 // Identity values
 template <>
 Value getIdentityValue<ONNXReduceMaxOp>(
@@ -79,6 +91,40 @@ struct ScalarOp<ONNXReduceMeanOp> {
   using IOp = AddIOp;
 };
 
+// Kinds of the vector.reduction combining the lanes of a vector accumulator.
+template <typename ONNXReductionOp>
+StringRef getVectorReductionKind();
+
+template <>
+StringRef getVectorReductionKind<ONNXReduceMaxOp>() {
+  return "max";
+}
+
+template <>
+StringRef getVectorReductionKind<ONNXReduceMinOp>() {
+  return "min";
+}
+
+template <>
+StringRef getVectorReductionKind<ONNXReduceProdOp>() {
+  return "mul";
+}
+
+template <>
+StringRef getVectorReductionKind<ONNXReduceSumV11Op>() {
+  return "add";
+}
+
+template <>
+StringRef getVectorReductionKind<ONNXReduceSumOp>() {
+  return "add";
+}
+
+template <>
+StringRef getVectorReductionKind<ONNXReduceMeanOp>() {
+  return "add";
+}
+
 //===----------------------------------------------------------------------===//
 // Scalar unary ops for lowering ONNXReduceMaxOp
 //===----------------------------------------------------------------------===//
@@ -88,7 +134,7 @@ Value emitScalarOpFor<ONNXReduceMaxOp>(ConversionPatternRewriter &rewriter,
     ArrayRef<Value> scalarOperands) {
   Value lhs = scalarOperands[0];
   Value rhs = scalarOperands[1];
-  Type element_type = lhs.getType();
+  Type element_type = getElementTypeOrSelf(lhs.getType());
   if (element_type.isa<IntegerType>()) {
     auto max = rewriter.create<CmpIOp>(loc, CmpIPredicate::sgt, lhs, rhs);
     auto result = rewriter.create<SelectOp>(loc, max, lhs, rhs);
@@ -111,11 +157,12 @@ Value emitScalarOpFor<ONNXReduceMinOp>(ConversionPatternRewriter &rewriter,
     ArrayRef<Value> scalarOperands) {
   Value lhs = scalarOperands[0];
   Value rhs = scalarOperands[1];
-  if (elementType.isa<IntegerType>()) {
+  Type scalarType = getElementTypeOrSelf(elementType);
+  if (scalarType.isa<IntegerType>()) {
     auto min = rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, lhs, rhs);
     auto result = rewriter.create<SelectOp>(loc, min, lhs, rhs);
     return result;
-  } else if (elementType.isa<FloatType>()) {
+  } else if (scalarType.isa<FloatType>()) {
     auto min = rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, lhs, rhs);
     auto result = rewriter.create<SelectOp>(loc, min, lhs, rhs);
     return result;
@@ -124,6 +171,346 @@ Value emitScalarOpFor<ONNXReduceMinOp>(ConversionPatternRewriter &rewriter,
   }
 }
 
+//===----------------------------------------------------------------------===//
+// Reduction loop nests
+//===----------------------------------------------------------------------===//
+
+// Return the indices of the result element into which the input element at
+// the given indices is reduced. The kept reduced dimensions are at index zero.
+static SmallVector<Value, 4> getReductionOutputIndices(ArrayRef<Value> inIndices,
+    std::map<int64_t, int64_t> &outInDimMap, int64_t outRank,
+    Value zeroIndex) {
+  SmallVector<Value, 4> outIndices;
+  for (int64_t i = 0; i < outRank; ++i) {
+    if (outInDimMap.find(i) != outInDimMap.end())
+      outIndices.emplace_back(inIndices[outInDimMap[i]]);
+    else
+      outIndices.emplace_back(zeroIndex);
+  }
+  return outIndices;
+}
+
+// Emit a loop nest initializing the result to the identity of the reduction,
+// then a loop nest over the input accumulating each element into the result.
+template <typename ONNXReductionOp>
+void emitScalarReductionLoops(ConversionPatternRewriter &rewriter,
+    Location loc, Operation *op, Value input, Value alloc,
+    std::map<int64_t, int64_t> &outInDimMap) {
+  int64_t inRank = input.getType().cast<MemRefType>().getRank();
+  auto memRefOutType = alloc.getType().cast<MemRefType>();
+  int64_t outRank = memRefOutType.getRank();
+  auto elementOutType = memRefOutType.getElementType();
+
+  // 1. Define loops to initialize the result.
+  std::vector<Value> originalLoopsInit;
+  defineLoops(rewriter, loc, originalLoopsInit, outRank);
+
+  // Iteration information
+  KrnlIterateOperandPack packInit(rewriter, originalLoopsInit);
+  for (decltype(outRank) i = 0; i < outRank; ++i) {
+    addDimensionToPack(rewriter, loc, packInit, alloc, i);
+  }
+  auto iterateOpInit = rewriter.create<KrnlIterateOp>(loc, packInit);
+  Block &iterationBlockInit = iterateOpInit.bodyRegion().front();
+
+  // Perform the insertions into the body of the initialization loop.
+
+  // Insert instructions inside the KernelIterateOp body.
+  rewriter.setInsertionPointToStart(&iterationBlockInit);
+
+  // Handle the operation:
+  SmallVector<Value, 4> loopIVs;
+  for (auto arg : iterationBlockInit.getArguments()) {
+    loopIVs.push_back(arg);
+  }
+
+  Value identity =
+      getIdentityValue<ONNXReductionOp>(rewriter, loc, elementOutType);
+  rewriter.create<KrnlStoreOp>(loc, identity, alloc, loopIVs);
+
+  // 2. Define an Krnl loop to do reduction.
+  rewriter.setInsertionPointAfter(iterateOpInit);
+  auto ipMainRegion = rewriter.saveInsertionPoint();
+  std::vector<Value> originalLoops;
+  defineLoops(rewriter, loc, originalLoops, inRank);
+  // Iteration information
+  KrnlIterateOperandPack pack(rewriter, originalLoops);
+  for (decltype(inRank) i = 0; i < inRank; ++i) {
+    addDimensionToPack(rewriter, loc, pack, input, i);
+  }
+  auto iterateOp = rewriter.create<KrnlIterateOp>(loc, pack);
+  Block &iterationBlock = iterateOp.bodyRegion().front();
+
+  // Perform the insertions into the body of the reduction loop.
+  // Insert instructions inside the KernelIterateOp body.
+  rewriter.setInsertionPointToStart(&iterationBlock);
+
+  // Handle the operation:
+  SmallVector<Value, 4> inLoopIVs;
+  auto args = iterationBlock.getArguments();
+  for (int i = 0; i < args.size(); ++i) {
+    inLoopIVs.push_back(args[i]);
+  }
+  Value zeroIndex = nullptr;
+  if (static_cast<int64_t>(outInDimMap.size()) < outRank)
+    zeroIndex = rewriter.create<ConstantIndexOp>(loc, 0);
+  SmallVector<Value, 4> outLoopIVs =
+      getReductionOutputIndices(inLoopIVs, outInDimMap, outRank, zeroIndex);
+
+  Value next, accumulated;
+  next = rewriter.create<KrnlLoadOp>(loc, input, inLoopIVs);
+  accumulated = rewriter.create<KrnlLoadOp>(loc, alloc, outLoopIVs);
+  accumulated = emitScalarOpFor<ONNXReductionOp>(
+      rewriter, loc, op, memRefOutType.getElementType(), {accumulated, next});
+  rewriter.create<KrnlStoreOp>(loc, accumulated, alloc, outLoopIVs);
+
+  rewriter.restoreInsertionPoint(ipMainRegion);
+}
+
+// Emit the reduction of an input with a static shape along its innermost or
+// its outermost dimensions. Return false, emitting nothing, for the other
+// reductions.
+//
+// When the innermost dimensions are reduced, each result element is
+// accumulated into a vector of partial results along the innermost
+// dimension, whose lanes are then combined by a vector.reduction. The loop
+// over the result elements is parallel.
+//
+// When the outermost dimensions are reduced, the outermost dimension is split
+// into chunks, reduced in parallel into a buffer of partial results that are
+// then combined pairwise, as a tree. The kept innermost dimension is
+// vectorized.
+template <typename ONNXReductionOp>
+bool emitVectorizedReduction(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *op, Value input, ArrayRef<int64_t> axes, Value alloc,
+    std::map<int64_t, int64_t> &outInDimMap) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+
+  auto inputType = input.getType().cast<MemRefType>();
+  auto inputShape = inputType.getShape();
+  Type elementType = inputType.getElementType();
+  int64_t inRank = inputType.getRank();
+  int64_t outRank = alloc.getType().cast<MemRefType>().getRank();
+  int64_t nAxes = axes.size();
+  if (inRank == 0 || !hasAllConstantDimensions(inputType) ||
+      !inputType.getAffineMaps().empty() || !elementType.isIntOrFloat() ||
+      elementType.getIntOrFloatBitWidth() < 8)
+    return false;
+
+  // The axes are unique, so they are the innermost (outermost) dimensions
+  // when they are all among the nAxes innermost (outermost) ones.
+  bool innerReduction = llvm::all_of(
+      axes, [&](int64_t axis) { return axis >= inRank - nAxes; });
+  bool outerReduction =
+      nAxes < inRank && inputShape[0] > 1 &&
+      llvm::all_of(axes, [&](int64_t axis) { return axis < nAxes; });
+  if (!innerReduction && !outerReduction)
+    return false;
+
+  // Vectorize along the innermost dimension when it holds whole vectors. For
+  // rank one, the trailing elements are reduced by a scalar epilogue.
+  int64_t lastDim = inputShape[inRank - 1];
+  int64_t vectorLen =
+      reductionVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  if (lastDim < vectorLen || (inRank > 1 && lastDim % vectorLen != 0))
+    vectorLen = 1;
+  int64_t vectorizedDim = lastDim / vectorLen * vectorLen;
+
+  ScopedContext scope(rewriter, loc);
+  IndexExprScope ieScope(&rewriter, loc);
+  Value zeroIndex = std_constant_index(0);
+  Value identity =
+      getIdentityValue<ONNXReductionOp>(rewriter, loc, elementType);
+  Type accType = elementType;
+  Value accIdentity = identity;
+  Value inputView = input;
+  if (vectorLen > 1) {
+    accType = VectorType::get({vectorLen}, elementType);
+    accIdentity = rewriter.create<SplatOp>(loc, accType, identity);
+    inputView = krnl_vector_type_cast(input, vectorLen);
+  }
+  auto viewShape = inputView.getType().cast<MemRefType>().getShape();
+
+  auto combine = [&](Type type, Value lhs, Value rhs) {
+    return emitScalarOpFor<ONNXReductionOp>(
+        rewriter, loc, op, type, {lhs, rhs});
+  };
+  // Bounds of the loops over the dimensions [start, end) of the input view.
+  auto getBounds = [&](int64_t start, int64_t end,
+                       SmallVectorImpl<IndexExpr> &lbs,
+                       SmallVectorImpl<IndexExpr> &ubs) {
+    for (int64_t i = start; i < end; ++i) {
+      lbs.emplace_back(LiteralIndexExpr(0));
+      ubs.emplace_back(LiteralIndexExpr(viewShape[i]));
+    }
+  };
+
+  if (innerReduction) {
+    int64_t firstAxis = inRank - nAxes;
+
+    // Reduce the elements at the given indices of the outer dimensions into
+    // one result element.
+    auto emitElementReduction = [&](ValueRange outerIndices) {
+      SmallVector<Value, 1> scalarAccess; // Empty.
+      Value acc = rewriter.create<memref::AllocaOp>(
+          loc, MemRefType::get({}, accType));
+      krnl_store(accIdentity, acc, scalarAccess);
+      SmallVector<IndexExpr, 4> lbs, ubs;
+      getBounds(firstAxis, inRank, lbs, ubs);
+      ValueRange reductionLoops = krnl_define_loop(nAxes);
+      krnl_iterate_ie(reductionLoops, lbs, ubs, {}, [&](ValueRange args) {
+        SmallVector<Value, 4> inIndices(
+            outerIndices.begin(), outerIndices.end());
+        for (Value iv : krnl_get_induction_var_value(reductionLoops))
+          inIndices.emplace_back(iv);
+        Value next = krnl_load(inputView, inIndices);
+        Value accVal = krnl_load(acc, scalarAccess);
+        krnl_store(combine(accType, accVal, next), acc, scalarAccess);
+      });
+      Value res = krnl_load(acc, scalarAccess);
+      if (vectorLen > 1)
+        res = rewriter.create<vector::ReductionOp>(loc, elementType,
+            rewriter.getStringAttr(
+                getVectorReductionKind<ONNXReductionOp>()),
+            res, ValueRange{});
+
+      SmallVector<Value, 4> inIndices(outerIndices.begin(), outerIndices.end());
+      inIndices.resize(inRank, zeroIndex);
+      SmallVector<Value, 4> outIndices =
+          getReductionOutputIndices(inIndices, outInDimMap, outRank, zeroIndex);
+      krnl_store(res, alloc, outIndices);
+
+      // Scalar epilogue.
+      if (vectorizedDim < lastDim) {
+        ValueRange epilogueLoops = krnl_define_loop(1);
+        krnl_iterate_ie(epilogueLoops, {LiteralIndexExpr(vectorizedDim)},
+            {LiteralIndexExpr(lastDim)}, {}, [&](ValueRange args) {
+              Value next =
+                  krnl_load(input, krnl_get_induction_var_value(epilogueLoops));
+              Value accVal = krnl_load(alloc, outIndices);
+              krnl_store(combine(elementType, accVal, next), alloc, outIndices);
+            });
+      }
+    };
+
+    if (firstAxis == 0) {
+      emitElementReduction({});
+      return true;
+    }
+    SmallVector<IndexExpr, 4> lbs, ubs;
+    getBounds(0, firstAxis, lbs, ubs);
+    ValueRange outerLoops = krnl_define_loop(firstAxis);
+    for (int64_t i = 0; i < firstAxis; ++i)
+      if (inputShape[i] > 1) {
+        krnl_parallel(outerLoops[i]);
+        break;
+      }
+    krnl_iterate_ie(outerLoops, lbs, ubs, {}, [&](ValueRange args) {
+      emitElementReduction(krnl_get_induction_var_value(outerLoops));
+    });
+    return true;
+  }
+
+  // Split the outermost dimension into a power of two number of chunks.
+  int64_t firstKept = nAxes;
+  int64_t nKept = inRank - firstKept;
+  int64_t outerDim = inputShape[0];
+  int64_t numChunks = 1;
+  while (numChunks * 2 <= std::min(reductionParallelChunks, outerDim))
+    numChunks *= 2;
+  int64_t chunkSize = (outerDim + numChunks - 1) / numChunks;
+
+  SmallVector<int64_t, 4> partialShape = {numChunks};
+  partialShape.append(inputShape.begin() + firstKept, inputShape.end());
+  SmallVector<IndexExpr, 1> noDims;
+  Value partials = insertAllocAndDeallocSimple(rewriter, op,
+      MemRefType::get(partialShape, elementType), loc, noDims,
+      /*insertDealloc=*/true, BUFFER_ALIGN);
+  Value partialsView = partials;
+  Value allocView = alloc;
+  if (vectorLen > 1) {
+    partialsView = krnl_vector_type_cast(partials, vectorLen);
+    allocView = krnl_vector_type_cast(alloc, vectorLen);
+  }
+  SmallVector<IndexExpr, 4> keptLbs, keptUbs;
+  getBounds(firstKept, inRank, keptLbs, keptUbs);
+
+  // 1. Reduce the chunks in parallel, each into its partial results.
+  ValueRange chunkLoops = krnl_define_loop(1);
+  krnl_parallel(chunkLoops[0]);
+  krnl_iterate_ie(chunkLoops, {LiteralIndexExpr(0)},
+      {LiteralIndexExpr(numChunks)}, {}, [&](ValueRange args) {
+        IndexExprScope chunkScope;
+        Value chunk = krnl_get_induction_var_value(chunkLoops)[0];
+        ValueRange initLoops = krnl_define_loop(nKept);
+        krnl_iterate_ie(initLoops, keptLbs, keptUbs, {}, [&](ValueRange args) {
+          SmallVector<Value, 4> partialIndices = {chunk};
+          for (Value iv : krnl_get_induction_var_value(initLoops))
+            partialIndices.emplace_back(iv);
+          krnl_store(accIdentity, partialsView, partialIndices);
+        });
+
+        DimIndexExpr c(chunk);
+        IndexExpr rowStart = c * chunkSize;
+        SmallVector<IndexExpr, 4> lbs = {rowStart};
+        SmallVector<IndexExpr, 4> ubs = {
+            IndexExpr::min(rowStart + chunkSize, outerDim)};
+        getBounds(1, inRank, lbs, ubs);
+        ValueRange reductionLoops = krnl_define_loop(inRank);
+        krnl_iterate_ie(reductionLoops, lbs, ubs, {}, [&](ValueRange args) {
+          ValueRange inIndices = krnl_get_induction_var_value(reductionLoops);
+          SmallVector<Value, 4> partialIndices = {chunk};
+          for (int64_t i = firstKept; i < inRank; ++i)
+            partialIndices.emplace_back(inIndices[i]);
+          Value next = krnl_load(inputView, inIndices);
+          Value accVal = krnl_load(partialsView, partialIndices);
+          krnl_store(
+              combine(accType, accVal, next), partialsView, partialIndices);
+        });
+      });
+
+  // 2. Combine the partial results pairwise, halving their number at each
+  // step, the last step storing into the result.
+  for (int64_t stride = numChunks / 2; stride >= 1; stride /= 2) {
+    bool lastStep = (stride == 1);
+    SmallVector<IndexExpr, 4> lbs(keptLbs.begin(), keptLbs.end());
+    SmallVector<IndexExpr, 4> ubs(keptUbs.begin(), keptUbs.end());
+    if (!lastStep) {
+      lbs.emplace_back(LiteralIndexExpr(0));
+      ubs.emplace_back(LiteralIndexExpr(stride));
+    }
+    ValueRange combineLoops = krnl_define_loop(lbs.size());
+    if (viewShape[firstKept] > 1)
+      krnl_parallel(combineLoops[0]);
+    krnl_iterate_ie(combineLoops, lbs, ubs, {}, [&](ValueRange args) {
+      ValueRange ivs = krnl_get_induction_var_value(combineLoops);
+      Value chunk = zeroIndex;
+      if (!lastStep)
+        chunk = ivs[nKept];
+      Value otherChunk =
+          rewriter.create<AddIOp>(loc, chunk, std_constant_index(stride));
+      SmallVector<Value, 4> lhsIndices = {chunk}, rhsIndices = {otherChunk};
+      for (int64_t i = 0; i < nKept; ++i) {
+        lhsIndices.emplace_back(ivs[i]);
+        rhsIndices.emplace_back(ivs[i]);
+      }
+      Value res = combine(accType, krnl_load(partialsView, lhsIndices),
+          krnl_load(partialsView, rhsIndices));
+      if (!lastStep) {
+        krnl_store(res, partialsView, lhsIndices);
+        return;
+      }
+      SmallVector<Value, 4> inIndices(firstKept, zeroIndex);
+      for (int64_t i = 0; i < nKept; ++i)
+        inIndices.emplace_back(ivs[i]);
+      krnl_store(res, allocView,
+          getReductionOutputIndices(inIndices, outInDimMap, outRank, zeroIndex));
+    });
+  }
+  return true;
+}
+
 template <typename ONNXReductionOp>
 struct ONNXReductionOpLowering : public ConversionPattern {
   bool computeMean = false;
@@ -195,7 +582,6 @@ struct ONNXReductionOpLowering : public ConversionPattern {
 
     // Get type information
     auto memRefOutShape = memRefOutType.getShape();
-    auto elementOutType = memRefOutType.getElementType();
     std::map<int64_t, int64_t> outInDimMap =
         getReductionMapping(memRefInType, axes, isKeepdims);
 
@@ -222,84 +608,15 @@ struct ONNXReductionOpLowering : public ConversionPattern {
       }
     }
 
-    // There are two required and one optional Krnl loops:
-    // - One to initialize the result memref,
-    // - One to do reduction, and
-    // - One to compute mean (optional).
-
-    // 1. Define loops to initialize the result.
-    std::vector<Value> originalLoopsInit;
-    defineLoops(rewriter, loc, originalLoopsInit, outRank);
-
-    // Iteration information
-    KrnlIterateOperandPack packInit(rewriter, originalLoopsInit);
-    for (decltype(outRank) i = 0; i < outRank; ++i) {
-      addDimensionToPack(rewriter, loc, packInit, alloc, i);
-    }
-    auto iterateOpInit = rewriter.create<KrnlIterateOp>(loc, packInit);
-    Block &iterationBlockInit = iterateOpInit.bodyRegion().front();
-
-    // Perform the insertions into the body of the initialization loop.
-
-    // Insert instructions inside the KernelIterateOp body.
-    rewriter.setInsertionPointToStart(&iterationBlockInit);
-
-    // Handle the operation:
-    SmallVector<Value, 4> loopIVs;
-    for (auto arg : iterationBlockInit.getArguments()) {
-      loopIVs.push_back(arg);
-    }
+    // Reduce the input into the result. Reductions of static shapes along the
+    // innermost or outermost dimensions are vectorized and parallelized, the
+    // others initialize the result and accumulate into it in two loop nests.
+    if (!emitVectorizedReduction<ONNXReductionOp>(
+            rewriter, loc, op, input, axes, alloc, outInDimMap))
+      emitScalarReductionLoops<ONNXReductionOp>(
+          rewriter, loc, op, input, alloc, outInDimMap);
 
-    Value identity =
-        getIdentityValue<ONNXReductionOp>(rewriter, loc, elementOutType);
-    rewriter.create<KrnlStoreOp>(loc, identity, alloc, loopIVs);
-
-    // 2. Define an Krnl loop to do reduction.
-    rewriter.setInsertionPointAfter(iterateOpInit);
-    auto ipMainRegion = rewriter.saveInsertionPoint();
-    std::vector<Value> originalLoops;
-    defineLoops(rewriter, loc, originalLoops, inRank);
-    // Iteration information
-    KrnlIterateOperandPack pack(rewriter, originalLoops);
-    for (decltype(inRank) i = 0; i < inRank; ++i) {
-      addDimensionToPack(rewriter, loc, pack, input, i);
-    }
-    auto iterateOp = rewriter.create<KrnlIterateOp>(loc, pack);
-    Block &iterationBlock = iterateOp.bodyRegion().front();
-
-    // Perform the insertions into the body of the reduction loop.
-    // Insert instructions inside the KernelIterateOp body.
-    rewriter.setInsertionPointToStart(&iterationBlock);
-
-    // Handle the operation:
-    SmallVector<Value, 4> inLoopIVs, outLoopIVs;
-    auto args = iterationBlock.getArguments();
-    for (int i = 0; i < args.size(); ++i) {
-      inLoopIVs.push_back(args[i]);
-    }
-    Value zeroIndex = nullptr;
-    for (decltype(inRank) i = 0; i < outRank; ++i) {
-      if (outInDimMap.find(i) != outInDimMap.end()) {
-        outLoopIVs.push_back(inLoopIVs[outInDimMap[i]]);
-      } else {
-        if (zeroIndex) {
-          outLoopIVs.push_back(zeroIndex);
-        } else {
-          zeroIndex = rewriter.create<ConstantIndexOp>(loc, 0);
-          outLoopIVs.push_back(zeroIndex);
-        }
-      }
-    }
-
-    Value next, accumulated;
-    next = rewriter.create<KrnlLoadOp>(loc, input, inLoopIVs);
-    accumulated = rewriter.create<KrnlLoadOp>(loc, alloc, outLoopIVs);
-    accumulated = emitScalarOpFor<ONNXReductionOp>(
-        rewriter, loc, op, memRefOutType.getElementType(), {accumulated, next});
-    rewriter.create<KrnlStoreOp>(loc, accumulated, alloc, outLoopIVs);
-
-    // 3. Define an Krnl loop to compute mean (optional).
-    rewriter.restoreInsertionPoint(ipMainRegion);
+    // Compute mean (optional).
     MemRefBoundsIndexCapture inputBounds(input);
     MemRefBoundsIndexCapture allocBounds(alloc);
     if (computeMean) {
@@ -428,7 +745,6 @@ struct ONNXReduceSumOpLowering : public ConversionPattern {
 
     // Get type information
     auto memRefOutShape = memRefOutType.getShape();
-    auto elementOutType = memRefOutType.getElementType();
     std::map<int64_t, int64_t> outInDimMap =
         getReductionMapping(memRefInType, axes, isKeepdims);
 
@@ -455,84 +771,15 @@ struct ONNXReduceSumOpLowering : public ConversionPattern {
       }
     }
 
-    // There are two required and one optional Krnl loops:
-    // - One to initialize the result memref,
-    // - One to do reduction, and
-    // - One to compute mean (optional).
-
-    // 1. Define loops to initialize the result.
-    std::vector<Value> originalLoopsInit;
-    defineLoops(rewriter, loc, originalLoopsInit, outRank);
-
-    // Iteration information
-    KrnlIterateOperandPack packInit(rewriter, originalLoopsInit);
-    for (decltype(outRank) i = 0; i < outRank; ++i) {
-      addDimensionToPack(rewriter, loc, packInit, alloc, i);
-    }
-    auto iterateOpInit = rewriter.create<KrnlIterateOp>(loc, packInit);
-    Block &iterationBlockInit = iterateOpInit.bodyRegion().front();
-
-    // Perform the insertions into the body of the initialization loop.
-
-    // Insert instructions inside the KernelIterateOp body.
-    rewriter.setInsertionPointToStart(&iterationBlockInit);
-
-    // Handle the operation:
-    SmallVector<Value, 4> loopIVs;
-    for (auto arg : iterationBlockInit.getArguments()) {
-      loopIVs.push_back(arg);
-    }
-
-    Value identity =
-        getIdentityValue<ONNXReduceSumOp>(rewriter, loc, elementOutType);
-    rewriter.create<KrnlStoreOp>(loc, identity, alloc, loopIVs);
-
-    // 2. Define an Krnl loop to do reduction.
-    rewriter.setInsertionPointAfter(iterateOpInit);
-    auto ipMainRegion = rewriter.saveInsertionPoint();
-    std::vector<Value> originalLoops;
-    defineLoops(rewriter, loc, originalLoops, inRank);
-    // Iteration information
-    KrnlIterateOperandPack pack(rewriter, originalLoops);
-    for (decltype(inRank) i = 0; i < inRank; ++i) {
-      addDimensionToPack(rewriter, loc, pack, input, i);
-    }
-    auto iterateOp = rewriter.create<KrnlIterateOp>(loc, pack);
-    Block &iterationBlock = iterateOp.bodyRegion().front();
-
-    // Perform the insertions into the body of the reduction loop.
-    // Insert instructions inside the KernelIterateOp body.
-    rewriter.setInsertionPointToStart(&iterationBlock);
-
-    // Handle the operation:
-    SmallVector<Value, 4> inLoopIVs, outLoopIVs;
-    auto args = iterationBlock.getArguments();
-    for (int i = 0; i < args.size(); ++i) {
-      inLoopIVs.push_back(args[i]);
-    }
-    Value zeroIndex = nullptr;
-    for (decltype(inRank) i = 0; i < outRank; ++i) {
-      if (outInDimMap.find(i) != outInDimMap.end()) {
-        outLoopIVs.push_back(inLoopIVs[outInDimMap[i]]);
-      } else {
-        if (zeroIndex) {
-          outLoopIVs.push_back(zeroIndex);
-        } else {
-          zeroIndex = rewriter.create<ConstantIndexOp>(loc, 0);
-          outLoopIVs.push_back(zeroIndex);
-        }
-      }
-    }
-
-    Value next, accumulated;
-    next = rewriter.create<KrnlLoadOp>(loc, input, inLoopIVs);
-    accumulated = rewriter.create<KrnlLoadOp>(loc, alloc, outLoopIVs);
-    accumulated = emitScalarOpFor<ONNXReduceSumOp>(
-        rewriter, loc, op, memRefOutType.getElementType(), {accumulated, next});
-    rewriter.create<KrnlStoreOp>(loc, accumulated, alloc, outLoopIVs);
+    // Reduce the input into the result. Reductions of static shapes along the
+    // innermost or outermost dimensions are vectorized and parallelized, the
+    // others initialize the result and accumulate into it in two loop nests.
+    if (!emitVectorizedReduction<ONNXReduceSumOp>(
+            rewriter, loc, op, input, axes, alloc, outInDimMap))
+      emitScalarReductionLoops<ONNXReduceSumOp>(
+          rewriter, loc, op, input, alloc, outInDimMap);
 
-    // 3. Define an Krnl loop to compute mean (optional).
-    rewriter.restoreInsertionPoint(ipMainRegion);
+    // Compute mean (optional).
     MemRefBoundsIndexCapture inputBounds(input);
     MemRefBoundsIndexCapture allocBounds(alloc);
     if (computeMean) {
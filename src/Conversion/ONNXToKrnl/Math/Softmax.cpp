@@ -13,10 +13,143 @@
 //===----------------------------------------------------------------------===//
 
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
 #include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
 
 using namespace mlir;
 
+// Size in bytes of the vectors computing the softmax.
+static const int64_t softmaxVectorBytes = 32;
+
+// Emit the softmax of an input whose innermost dimension holds whole vectors,
+// along the 2-D shape coerced at `axis`. Return false, emitting nothing, for
+// the other inputs.
+//
+// A single pass over each row computes, lane by lane, the running max m and
+// the sum s of exp(x - m), the sum being rescaled whenever the max grows
+// (online softmax). The lanes are then combined into the max and the sum of
+// the row, and a second pass stores exp(x - max) / sum. The loop over the rows
+// is parallel.
+static bool emitVectorizedSoftmax(ConversionPatternRewriter &rewriter,
+    Location loc, Value input, Value alloc, int64_t axis) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+
+  auto inputType = input.getType().cast<MemRefType>();
+  auto inputShape = inputType.getShape();
+  Type elementType = inputType.getElementType();
+  int64_t rank = inputType.getRank();
+  if (rank == 0 || !elementType.isa<FloatType>() ||
+      !inputType.getAffineMaps().empty() ||
+      !alloc.getType().cast<MemRefType>().getAffineMaps().empty())
+    return false;
+  int64_t vectorLen =
+      softmaxVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  int64_t lastDim = inputShape[rank - 1];
+  if (lastDim <= 0 || lastDim % vectorLen != 0)
+    return false;
+
+  ScopedContext scope(rewriter, loc);
+  VectorType vecType = VectorType::get({vectorLen}, elementType);
+  Value inputView = krnl_vector_type_cast(input, vectorLen);
+  Value allocView = krnl_vector_type_cast(alloc, vectorLen);
+  Value zero = emitConstantOp(rewriter, loc, vecType, 0);
+  Value one = emitConstantOp(rewriter, loc, vecType, 1);
+  Value negInfinity = emitConstantOp(
+      rewriter, loc, vecType, -std::numeric_limits<double>::infinity());
+  Value oneScalar = emitConstantOp(rewriter, loc, elementType, 1);
+
+  MemRefBoundsCapture bounds(inputView);
+  SmallVector<Value, 4> outerLbs, outerUbs, innerLbs, innerUbs;
+  for (int64_t i = 0; i < rank; ++i) {
+    (i < axis ? outerLbs : innerLbs).emplace_back(bounds.lb(i));
+    (i < axis ? outerUbs : innerUbs).emplace_back(bounds.ub(i));
+  }
+
+  auto emitRowSoftmax = [&](ValueRange outerIndices) {
+    auto getIndices = [&](ValueRange innerLoops) {
+      SmallVector<Value, 4> indices(outerIndices.begin(), outerIndices.end());
+      for (Value iv : krnl_get_induction_var_value(innerLoops))
+        indices.emplace_back(iv);
+      return indices;
+    };
+    SmallVector<Value, 1> scalarAccess; // Empty.
+    MemRefType accType = MemRefType::get({}, vecType);
+    Value maxAcc = rewriter.create<memref::AllocaOp>(loc, accType);
+    Value sumAcc = rewriter.create<memref::AllocaOp>(loc, accType);
+    krnl_store(negInfinity, maxAcc, scalarAccess);
+    krnl_store(zero, sumAcc, scalarAccess);
+
+    // 1. Compute the running max and sum with one exponential per element:
+    // when x exceeds m, s becomes s * exp(m - x) + 1, and s + exp(x - m)
+    // otherwise. Equal values, -inf included, add exp(0) without computing
+    // -inf - -inf.
+    ValueRange statLoops = krnl_define_loop(rank - axis);
+    krnl_iterate(statLoops, innerLbs, innerUbs, {}, [&](ValueRange args) {
+      Value x = krnl_load(inputView, getIndices(statLoops));
+      Value m = krnl_load(maxAcc, scalarAccess);
+      Value s = krnl_load(sumAcc, scalarAccess);
+      Value greater = rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, x, m);
+      Value equal = rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, x, m);
+      Value diff = rewriter.create<SelectOp>(loc, greater,
+          rewriter.create<SubFOp>(loc, m, x),
+          rewriter.create<SubFOp>(loc, x, m));
+      diff = rewriter.create<SelectOp>(loc, equal, zero, diff);
+      Value e = rewriter.create<math::ExpOp>(loc, diff);
+      s = rewriter.create<SelectOp>(loc, greater,
+          rewriter.create<AddFOp>(loc, rewriter.create<MulFOp>(loc, s, e), one),
+          rewriter.create<AddFOp>(loc, s, e));
+      krnl_store(s, sumAcc, scalarAccess);
+      krnl_store(rewriter.create<SelectOp>(loc, greater, x, m), maxAcc,
+          scalarAccess);
+    });
+
+    // Combine the lanes, rescaling the sum of each lane to the max of the
+    // row.
+    Value m = krnl_load(maxAcc, scalarAccess);
+    Value rowMax = rewriter.create<vector::ReductionOp>(loc, elementType,
+        rewriter.getStringAttr("max"), m, ValueRange{});
+    Value rowMaxVec = rewriter.create<SplatOp>(loc, vecType, rowMax);
+    Value laneDiff = rewriter.create<SelectOp>(loc,
+        rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, m, rowMaxVec), zero,
+        rewriter.create<SubFOp>(loc, m, rowMaxVec));
+    Value laneSum =
+        rewriter.create<MulFOp>(loc, krnl_load(sumAcc, scalarAccess),
+            rewriter.create<math::ExpOp>(loc, laneDiff));
+    Value rowSum = rewriter.create<vector::ReductionOp>(loc, elementType,
+        rewriter.getStringAttr("add"), laneSum, ValueRange{});
+    Value invSumVec = rewriter.create<SplatOp>(
+        loc, vecType, rewriter.create<DivFOp>(loc, oneScalar, rowSum));
+
+    // 2. Normalize.
+    ValueRange normLoops = krnl_define_loop(rank - axis);
+    krnl_iterate(normLoops, innerLbs, innerUbs, {}, [&](ValueRange args) {
+      SmallVector<Value, 4> indices = getIndices(normLoops);
+      Value x = krnl_load(inputView, indices);
+      Value e = rewriter.create<math::ExpOp>(
+          loc, rewriter.create<SubFOp>(loc, x, rowMaxVec));
+      krnl_store(rewriter.create<MulFOp>(loc, e, invSumVec), allocView, indices);
+    });
+  };
+
+  if (axis == 0) {
+    emitRowSoftmax({});
+    return true;
+  }
+  ValueRange outerLoops = krnl_define_loop(axis);
+  for (int64_t i = 0; i < axis; ++i)
+    if (inputShape[i] != 1) {
+      krnl_parallel(outerLoops[i]);
+      break;
+    }
+  krnl_iterate(outerLoops, outerLbs, outerUbs, {}, [&](ValueRange args) {
+    emitRowSoftmax(krnl_get_induction_var_value(outerLoops));
+  });
+  return true;
+}
+
 struct ONNXSoftmaxOpLowering : public ConversionPattern {
   ONNXSoftmaxOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXSoftmaxOp::getOperationName(), 1, ctx) {}
@@ -46,6 +179,11 @@ struct ONNXSoftmaxOpLowering : public ConversionPattern {
       alloc = insertAllocAndDealloc(
           memRefType, loc, rewriter, insertDealloc, input);
 
+    if (emitVectorizedSoftmax(rewriter, loc, input, alloc, axis)) {
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
+
     // Shape of the result
     auto memRefShape = memRefType.getShape();
 
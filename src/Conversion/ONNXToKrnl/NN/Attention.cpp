@@ -0,0 +1,247 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===--------------- Attention.cpp - Lowering FusedAttention Op -----------===//
+//
+// Copyright 2019 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX FusedAttention Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+
+using namespace mlir;
+
+// Number of keys whose scores are computed at once. Only the scores of one
+// block of keys are kept for a query.
+static const int64_t attentionKeyBlock = 64;
+
+struct ONNXFusedAttentionOpLowering : public ConversionPattern {
+  ONNXFusedAttentionOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXFusedAttentionOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    ONNXFusedAttentionOpAdaptor operandAdaptor(operands);
+    ONNXFusedAttentionOp attentionOp = llvm::cast<ONNXFusedAttentionOp>(op);
+    Location loc = op->getLoc();
+    Value Q = operandAdaptor.Q();
+    Value K = operandAdaptor.K();
+    Value V = operandAdaptor.V();
+    Value mask = operandAdaptor.mask();
+    bool hasMask = !mask.getType().isa<NoneType>();
+
+    MemRefType memRefType = convertToMemRefType(*op->result_type_begin());
+    Type elementType = memRefType.getElementType();
+    int64_t rank = memRefType.getRank();
+    int64_t nBatchLoops = rank - 2;
+
+    ScopedContext scope(rewriter, loc);
+    IndexExprScope ieScope(&rewriter, loc);
+    MemRefBoundsIndexCapture qBounds(Q), kBounds(K), vBounds(V);
+    IndexExpr keyNum = kBounds.getDim(rank - 1);
+    Value depth = qBounds.getDim(rank - 1).getValue();
+    Value valueDim = vBounds.getDim(rank - 1).getValue();
+
+    // Insert an allocation and deallocation for the result of this operation.
+    SmallVector<IndexExpr, 4> outputDims;
+    for (int64_t i = 0; i < rank - 1; ++i)
+      outputDims.emplace_back(qBounds.getDim(i));
+    outputDims.emplace_back(vBounds.getDim(rank - 1));
+    Value alloc = insertAllocAndDeallocSimple(
+        rewriter, op, memRefType, loc, outputDims, checkInsertDealloc(op));
+
+    Value zeroIndex = std_constant_index(0);
+    Value zero = emitConstantOp(rewriter, loc, elementType, 0);
+    Value one = emitConstantOp(rewriter, loc, elementType, 1);
+    Value negInfinity = emitConstantOp(
+        rewriter, loc, elementType, -std::numeric_limits<double>::infinity());
+    Value scale = emitConstantOp(
+        rewriter, loc, elementType, attentionOp.scale().convertToFloat());
+    SmallVector<Value, 1> scalarAccess; // Empty.
+
+    // exp(x - max), exp(0) when x equals max, -inf included.
+    auto expDiff = [&](Value x, Value max) -> Value {
+      Value diff = rewriter.create<SelectOp>(loc,
+          rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, x, max), zero,
+          rewriter.create<SubFOp>(loc, x, max));
+      return rewriter.create<math::ExpOp>(loc, diff);
+    };
+    auto emitMax = [&](Value lhs, Value rhs) -> Value {
+      return rewriter.create<SelectOp>(loc,
+          rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, lhs, rhs), lhs,
+          rhs);
+    };
+    // Loop over the elements of a row of V.
+    auto iterateValueDim = [&](function_ref<void(Value)> bodyFn) {
+      ValueRange loops = krnl_define_loop(1);
+      krnl_iterate(loops, {zeroIndex}, {valueDim}, {}, [&](ValueRange args) {
+        bodyFn(krnl_get_induction_var_value(loops)[0]);
+      });
+    };
+
+    // Each query, i.e. each row of Q, streams over the blocks of keys: the
+    // scores of a block are computed, the running max, sum and weighted sum of
+    // the values are rescaled to the max of the block, and the values of the
+    // block are accumulated. Only O(block + Dv) elements are kept per query,
+    // rather than a [S, L] score matrix. The queries are computed in parallel.
+    SmallVector<IndexExpr, 4> queryLbs, queryUbs;
+    for (int64_t i = 0; i < rank - 1; ++i) {
+      queryLbs.emplace_back(LiteralIndexExpr(0));
+      queryUbs.emplace_back(qBounds.getDim(i));
+    }
+    ValueRange queryLoops = krnl_define_loop(rank - 1);
+    for (int64_t i = 0; i < rank - 1; ++i)
+      if (qBounds.getShape(i) != 1) {
+        krnl_parallel(queryLoops[i]);
+        break;
+      }
+    krnl_iterate_ie(queryLoops, queryLbs, queryUbs, {}, [&](ValueRange args) {
+      IndexExprScope queryScope;
+      ValueRange queryIndices = krnl_get_induction_var_value(queryLoops);
+      SmallVector<Value, 4> batchIndices(
+          queryIndices.begin(), queryIndices.begin() + nBatchLoops);
+      Value row = queryIndices[nBatchLoops];
+      auto getIndices = [&](Value first, Value second) {
+        SmallVector<Value, 4> indices(batchIndices.begin(), batchIndices.end());
+        indices.emplace_back(first);
+        indices.emplace_back(second);
+        return indices;
+      };
+      // The mask is broadcast to [..., S, L].
+      auto getMaskIndices = [&](Value key) {
+        ArrayRef<int64_t> maskShape =
+            mask.getType().cast<MemRefType>().getShape();
+        int64_t maskRank = maskShape.size();
+        SmallVector<Value, 4> fullIndices = getIndices(row, key);
+        SmallVector<Value, 4> indices;
+        for (int64_t i = 0; i < maskRank; ++i)
+          indices.emplace_back(maskShape[i] == 1
+                                   ? zeroIndex
+                                   : fullIndices[rank - maskRank + i]);
+        return indices;
+      };
+
+      MemRefType scalarType = MemRefType::get({}, elementType);
+      Value maxAcc = rewriter.create<memref::AllocaOp>(loc, scalarType);
+      Value sumAcc = rewriter.create<memref::AllocaOp>(loc, scalarType);
+      Value blockMaxAcc = rewriter.create<memref::AllocaOp>(loc, scalarType);
+      Value dotAcc = rewriter.create<memref::AllocaOp>(loc, scalarType);
+      Value scores = rewriter.create<memref::AllocaOp>(
+          loc, MemRefType::get({attentionKeyBlock}, elementType));
+      SmallVector<Value, 1> accDims;
+      if (vBounds.getShape(rank - 1) == -1)
+        accDims.emplace_back(valueDim);
+      Value acc = rewriter.create<memref::AllocaOp>(loc,
+          MemRefType::get({vBounds.getShape(rank - 1)}, elementType), accDims);
+      krnl_store(negInfinity, maxAcc, scalarAccess);
+      krnl_store(zero, sumAcc, scalarAccess);
+      iterateValueDim([&](Value dv) { krnl_store(zero, acc, dv); });
+
+      SymbolIndexExpr queryKeyNum(keyNum);
+      ValueRange blockLoops = krnl_define_loop(1);
+      krnl_iterate_ie(blockLoops, {LiteralIndexExpr(0)},
+          {queryKeyNum.ceilDiv(attentionKeyBlock)}, {}, [&](ValueRange args) {
+            IndexExprScope blockScope;
+            DimIndexExpr block(krnl_get_induction_var_value(blockLoops)[0]);
+            IndexExpr blockStart = block * attentionKeyBlock;
+            IndexExpr blockEnd = IndexExpr::min(
+                blockStart + attentionKeyBlock, SymbolIndexExpr(keyNum));
+            Value blockStartVal = blockStart.getValue();
+
+            // 1. Compute the scores of the block of keys and their max.
+            krnl_store(negInfinity, blockMaxAcc, scalarAccess);
+            ValueRange scoreLoops = krnl_define_loop(1);
+            krnl_iterate_ie(scoreLoops, {blockStart}, {blockEnd}, {},
+                [&](ValueRange args) {
+                  Value key = krnl_get_induction_var_value(scoreLoops)[0];
+                  krnl_store(zero, dotAcc, scalarAccess);
+                  ValueRange dotLoops = krnl_define_loop(1);
+                  krnl_iterate(dotLoops, {zeroIndex}, {depth}, {},
+                      [&](ValueRange args) {
+                        Value d = krnl_get_induction_var_value(dotLoops)[0];
+                        Value prod = rewriter.create<MulFOp>(loc,
+                            krnl_load(Q, getIndices(row, d)),
+                            krnl_load(K, getIndices(d, key)));
+                        krnl_store(rewriter.create<AddFOp>(loc,
+                                       krnl_load(dotAcc, scalarAccess), prod),
+                            dotAcc, scalarAccess);
+                      });
+                  Value score = rewriter.create<MulFOp>(
+                      loc, krnl_load(dotAcc, scalarAccess), scale);
+                  if (hasMask)
+                    score = rewriter.create<AddFOp>(
+                        loc, score, krnl_load(mask, getMaskIndices(key)));
+                  krnl_store(score, scores,
+                      rewriter.create<SubIOp>(loc, key, blockStartVal)
+                          .getResult());
+                  krnl_store(
+                      emitMax(score, krnl_load(blockMaxAcc, scalarAccess)),
+                      blockMaxAcc, scalarAccess);
+                });
+
+            // 2. Rescale the sums to the new max.
+            Value prevMax = krnl_load(maxAcc, scalarAccess);
+            Value newMax =
+                emitMax(krnl_load(blockMaxAcc, scalarAccess), prevMax);
+            Value correction = expDiff(prevMax, newMax);
+            krnl_store(rewriter.create<MulFOp>(
+                           loc, krnl_load(sumAcc, scalarAccess), correction),
+                sumAcc, scalarAccess);
+            iterateValueDim([&](Value dv) {
+              krnl_store(
+                  rewriter.create<MulFOp>(loc, krnl_load(acc, dv), correction),
+                  acc, dv);
+            });
+            krnl_store(newMax, maxAcc, scalarAccess);
+
+            // 3. Accumulate the values weighted by exp(score - max).
+            ValueRange accLoops = krnl_define_loop(1);
+            krnl_iterate_ie(accLoops, {blockStart}, {blockEnd}, {},
+                [&](ValueRange args) {
+                  Value key = krnl_get_induction_var_value(accLoops)[0];
+                  Value score = krnl_load(scores,
+                      rewriter.create<SubIOp>(loc, key, blockStartVal)
+                          .getResult());
+                  Value weight = expDiff(score, newMax);
+                  krnl_store(rewriter.create<AddFOp>(
+                                 loc, krnl_load(sumAcc, scalarAccess), weight),
+                      sumAcc, scalarAccess);
+                  iterateValueDim([&](Value dv) {
+                    Value weighted = rewriter.create<MulFOp>(
+                        loc, weight, krnl_load(V, getIndices(key, dv)));
+                    krnl_store(rewriter.create<AddFOp>(
+                                   loc, krnl_load(acc, dv), weighted),
+                        acc, dv);
+                  });
+                });
+          });
+
+      // Normalize the weighted sum of the values.
+      Value invSum = rewriter.create<DivFOp>(
+          loc, one, krnl_load(sumAcc, scalarAccess));
+      iterateValueDim([&](Value dv) {
+        krnl_store(rewriter.create<MulFOp>(loc, krnl_load(acc, dv), invSum),
+            alloc, getIndices(row, dv));
+      });
+    });
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXFusedAttentionOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXFusedAttentionOpLowering>(ctx);
+}
@@ -13,8 +13,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
+
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
 
+#define BUFFER_ALIGN 128
 using namespace mlir;
 
 std::vector<int64_t> getDilations(ONNXConvOp poolOp) {
@@ -34,8 +39,837 @@ std::vector<int64_t> getDilations(ONNXConvOp poolOp) {
 }
 
 struct ONNXConvOpLowering : public ConversionPattern {
-  ONNXConvOpLowering(MLIRContext *ctx)
-      : ConversionPattern(mlir::ONNXConvOp::getOperationName(), 1, ctx) {}
+  bool optimizeConv = false;
+  bool useWinograd = false;
+  MatMulTileSizes tileSizes;
+  bool fuseStoreEpilogues = false;
+  static int winogradKernelID;
+
+  ONNXConvOpLowering(MLIRContext *ctx, bool optimizeConv = false,
+      bool useWinograd = false,
+      const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+      bool fuseStoreEpilogues = false)
+      : ConversionPattern(mlir::ONNXConvOp::getOperationName(), 1, ctx) {
+    this->optimizeConv = optimizeConv;
+    this->useWinograd = useWinograd;
+    this->tileSizes = tileSizes;
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+    winogradKernelID = 0;
+  }
+
+  // Apply the store epilogue op to the result in place, for the kernels that
+  // accumulate into the result rather than storing each element once.
+  static void applyStoreEpilogueInPlace(ConversionPatternRewriter &rewriter,
+      Location loc, Operation *epilogueOp, Value alloc) {
+    if (!epilogueOp)
+      return;
+    OpBuilder::InsertionGuard insertGuard(rewriter);
+    BuildKrnlLoop loops(
+        rewriter, loc, alloc.getType().cast<MemRefType>().getRank());
+    loops.createDefineAndIterateOp(alloc, /*parallelize=*/true);
+    rewriter.setInsertionPointToStart(loops.getIterateBlock());
+    ValueRange indices = loops.getIterateBlock()->getArguments();
+    Value res = rewriter.create<KrnlLoadOp>(loc, alloc, indices);
+    res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
+    rewriter.create<KrnlStoreOp>(loc, res, alloc, indices);
+  }
+
+  // Return true if the convolution can be lowered to one of the specialized
+  // kernels below, which requires static shapes.
+  static bool canOptimizeConv(ONNXConvOpAdaptor &operandAdaptor, Value alloc) {
+    auto isStatic = [](Value val) {
+      return val.getType().isa<NoneType>() ||
+             hasAllConstantDimensions(val.getType().cast<MemRefType>());
+    };
+    return isStatic(operandAdaptor.X()) && isStatic(operandAdaptor.W()) &&
+           isStatic(operandAdaptor.B()) && isStatic(alloc) &&
+           alloc.getType()
+               .cast<MemRefType>()
+               .getElementType()
+               .isa<FloatType>();
+  }
+
+  // Return true for pointwise convolutions, i.e. 1x1 kernels with unit
+  // strides and no padding, which are plain matrix multiplies over channels.
+  static bool isPointwiseConv(ONNXConvOp convOp, ONNXConvOpAdaptor &adaptor,
+      ArrayRef<int64_t> pads, ArrayRef<int64_t> strides) {
+    auto kernelShape = adaptor.W().getType().cast<MemRefType>().getShape();
+    auto isOne = [](int64_t val) { return val == 1; };
+    return convOp.group() == 1 &&
+           llvm::all_of(kernelShape.drop_front(2), isOne) &&
+           llvm::all_of(strides, isOne) &&
+           llvm::all_of(pads, [](int64_t pad) { return pad == 0; });
+  }
+
+  // Return true for depthwise convolutions, where each group has a single
+  // input channel. The kernel positions are unrolled, which is only done for
+  // reasonably small kernels.
+  static bool isDepthwiseConv(ONNXConvOp convOp, ONNXConvOpAdaptor &adaptor) {
+    const int64_t maxUnrolledKernelSize = 64;
+    auto inputShape = adaptor.X().getType().cast<MemRefType>().getShape();
+    auto kernelShape = adaptor.W().getType().cast<MemRefType>().getShape();
+    int64_t kernelSize = 1;
+    for (int64_t dim : kernelShape.drop_front(2))
+      kernelSize *= dim;
+    return convOp.group() > 1 && convOp.group() == inputShape[1] &&
+           kernelShape[1] == 1 && kernelSize <= maxUnrolledKernelSize;
+  }
+
+  // Lower a pointwise convolution to one matrix multiply per image, directly
+  // on views of the operands: no data is packed besides the tiles of the
+  // matrix multiply.
+  //
+  // D (NxCxH1x...xHd) x K (MxCx1x...x1) -> R (NxMxH1x...xHd)
+  //
+  //   for n, m, h:
+  //     R[n][m][h] = B[m] (or 0)
+  //   for n = 0 .. N:
+  //     R[n] += K * D[n]
+  //
+  // where K is viewed as a [M, C] matrix, and D[n] and R[n] as [C, HX] and
+  // [M, HX] matrices, with HX = H1 * ... * Hd.
+  void pointwiseConv(ONNXConvOpAdaptor &operandAdaptor, Value alloc,
+      ConversionPatternRewriter &rewriter, Location loc) const {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    Value input(operandAdaptor.X()), kernel(operandAdaptor.W());
+    Value bias(operandAdaptor.B());
+    auto inputShape = input.getType().cast<MemRefType>().getShape();
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    Type elementType = alloc.getType().cast<MemRefType>().getElementType();
+    int64_t batchSize = inputShape[0];
+    int64_t numChannels = inputShape[1];
+    int64_t numKernels = kernelShape[0];
+    int64_t spatialSize = 1;
+    for (int64_t dim : inputShape.drop_front(2))
+      spatialSize *= dim;
+
+    // Row-major views of the operands, with the spatial dimensions collapsed.
+    auto getView = [&](Value val, ArrayRef<int64_t> shape) -> Value {
+      SmallVector<int64_t, 3> strides(shape.size(), 1);
+      for (int64_t i = shape.size() - 2; i >= 0; --i)
+        strides[i] = strides[i + 1] * shape[i + 1];
+      return rewriter.create<memref::ReinterpretCastOp>(loc,
+          MemRefType::get(shape, elementType), val, /*offset=*/0, shape,
+          strides);
+    };
+    Value kernelMatrix = getView(kernel, {numKernels, numChannels});
+    Value inputMatrices =
+        getView(input, {batchSize, numChannels, spatialSize});
+    Value resultMatrices = getView(alloc, {batchSize, numKernels, spatialSize});
+
+    Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
+    LiteralIndexExpr zero(0);
+
+    // The matrix multiplies accumulate into the bias.
+    ValueRange initLoops = krnl_define_loop(3);
+    krnl_parallel(initLoops[1]);
+    krnl_iterate_ie(initLoops, {zero, zero, zero},
+        {LiteralIndexExpr(batchSize), LiteralIndexExpr(numKernels),
+            LiteralIndexExpr(spatialSize)},
+        {}, [&](ValueRange args) {
+          ValueRange ivs = krnl_get_induction_var_value(initLoops);
+          Value val = zeroVal;
+          if (!bias.getType().isa<NoneType>())
+            val = krnl_load(bias, ivs[1]);
+          krnl_store(val, resultMatrices, ivs);
+        });
+
+    ValueRange batchLoop = krnl_define_loop(1);
+    krnl_iterate_ie(batchLoop, {zero}, {LiteralIndexExpr(batchSize)}, {},
+        [&](ValueRange args) {
+          Value n = krnl_get_induction_var_value(batchLoop)[0];
+          emitTiledMatMul(kernelMatrix, {}, inputMatrices, {n}, resultMatrices,
+              {n}, LiteralIndexExpr(numKernels), LiteralIndexExpr(spatialSize),
+              LiteralIndexExpr(numChannels), zeroVal, tileSizes);
+        });
+  }
+
+  // Lower a depthwise convolution to a stencil over each output channel.
+  //
+  // D (NxCxH1x...xHd) x K (MxC1xK1x...xKd) -> R (NxMxR1x...xRd)
+  //
+  // with group = C and M = C * MC. The positions of the kernel are unrolled
+  // at compile time, and the output positions whose inputs are in the
+  // padding are excluded from the loop bounds, so that the innermost loop
+  // has no conditions and accesses contiguous data for unit strides:
+  //
+  //   for n = 0 .. N, m = 0 .. M:
+  //     c = m / MC
+  //     for r1 .. rd:
+  //       R[n][m][r1]...[rd] = B[m] (or 0)
+  //     for each kernel position k1 .. kd:
+  //       w = K[m][0][k1]...[kd]
+  //       for ri = lbi(ki) .. ubi(ki):
+  //         R[n][m][r1]...[rd] += w * D[n][c][r1 * s1 + k1 * d1 - pt1]...
+  //
+  // where lbi and ubi bound the ri for which the input index is valid.
+  void depthwiseConv(ONNXConvOp convOp, ONNXConvOpAdaptor &operandAdaptor,
+      Value alloc, ArrayRef<int64_t> pads, ArrayRef<int64_t> strides,
+      ArrayRef<int64_t> dilations, ConversionPatternRewriter &rewriter,
+      Location loc) const {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    Value input(operandAdaptor.X()), kernel(operandAdaptor.W());
+    Value bias(operandAdaptor.B());
+    auto inputShape = input.getType().cast<MemRefType>().getShape();
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    auto resultShape = alloc.getType().cast<MemRefType>().getShape();
+    Type elementType = alloc.getType().cast<MemRefType>().getElementType();
+    int64_t nSpatialDims = resultShape.size() - 2;
+    int64_t kernelsPerGroup = kernelShape[0] / convOp.group();
+    ArrayRef<int64_t> kernelSpatialShape = kernelShape.drop_front(2);
+
+    Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
+    LiteralIndexExpr zero(0);
+    SmallVector<IndexExpr, 4> spatialLbs(nSpatialDims, zero);
+    SmallVector<IndexExpr, 4> spatialUbs;
+    for (int64_t i = 0; i < nSpatialDims; ++i)
+      spatialUbs.emplace_back(LiteralIndexExpr(resultShape[2 + i]));
+
+    auto floorDiv = [](int64_t a, int64_t b) {
+      return (a >= 0) ? a / b : -((-a + b - 1) / b);
+    };
+
+    ValueRange channelLoops = krnl_define_loop(2);
+    krnl_parallel(channelLoops[1]);
+    krnl_iterate_ie(channelLoops, {zero, zero},
+        {LiteralIndexExpr(resultShape[0]), LiteralIndexExpr(resultShape[1])},
+        {}, [&](ValueRange args) {
+          IndexExprScope channelScope;
+          ValueRange channelIvs = krnl_get_induction_var_value(channelLoops);
+          DimIndexExpr n(channelIvs[0]), m(channelIvs[1]);
+          IndexExpr c = m.floorDiv(LiteralIndexExpr(kernelsPerGroup));
+
+          // Initialize the output channel.
+          Value init = zeroVal;
+          if (!bias.getType().isa<NoneType>())
+            init = krnl_load(bias, channelIvs[1]);
+          ValueRange initLoops = krnl_define_loop(nSpatialDims);
+          krnl_iterate_ie(
+              initLoops, spatialLbs, spatialUbs, {}, [&](ValueRange args) {
+                SmallVector<Value, 6> resultIndices = {
+                    n.getValue(), m.getValue()};
+                for (Value iv : krnl_get_induction_var_value(initLoops))
+                  resultIndices.emplace_back(iv);
+                krnl_store(init, alloc, resultIndices);
+              });
+
+          // Accumulate the contribution of each kernel position.
+          SmallVector<int64_t, 4> k(nSpatialDims, 0);
+          while (true) {
+            SmallVector<IndexExpr, 4> lbs, ubs;
+            SmallVector<int64_t, 4> offsets;
+            bool isEmpty = false;
+            for (int64_t i = 0; i < nSpatialDims; ++i) {
+              int64_t dilation = dilations.empty() ? 1 : dilations[i];
+              // Input index: h = r * s + offset, valid in [0, H).
+              int64_t offset = k[i] * dilation - pads[i];
+              int64_t lb =
+                  std::max<int64_t>(0, -floorDiv(offset, strides[i]));
+              int64_t ub = std::min<int64_t>(resultShape[2 + i],
+                  floorDiv(inputShape[2 + i] - 1 - offset, strides[i]) + 1);
+              isEmpty |= (lb >= ub);
+              lbs.emplace_back(LiteralIndexExpr(lb));
+              ubs.emplace_back(LiteralIndexExpr(ub));
+              offsets.emplace_back(offset);
+            }
+            if (!isEmpty) {
+              SmallVector<IndexExpr, 6> kernelIndices = {m, zero};
+              for (int64_t i = 0; i < nSpatialDims; ++i)
+                kernelIndices.emplace_back(LiteralIndexExpr(k[i]));
+              Value weight = krnl_load(kernel, kernelIndices);
+              ValueRange stencilLoops = krnl_define_loop(nSpatialDims);
+              krnl_iterate_ie(
+                  stencilLoops, lbs, ubs, {}, [&](ValueRange args) {
+                    IndexExprScope innerScope;
+                    ValueRange ivs = krnl_get_induction_var_value(stencilLoops);
+                    SmallVector<IndexExpr, 6> resultIndices = {
+                        DimIndexExpr(n), DimIndexExpr(m)};
+                    SmallVector<IndexExpr, 6> inputIndices = {
+                        DimIndexExpr(n), DimIndexExpr(c)};
+                    for (int64_t i = 0; i < nSpatialDims; ++i) {
+                      DimIndexExpr r(ivs[i]);
+                      resultIndices.emplace_back(r);
+                      inputIndices.emplace_back(r * strides[i] + offsets[i]);
+                    }
+                    Value res = std_addf(krnl_load(alloc, resultIndices),
+                        std_mulf(weight, krnl_load(input, inputIndices)));
+                    krnl_store(res, alloc, resultIndices);
+                  });
+            }
+            // Next kernel position, in row-major order.
+            int64_t i = nSpatialDims - 1;
+            for (; i >= 0; --i) {
+              if (++k[i] < kernelSpatialShape[i])
+                break;
+              k[i] = 0;
+            }
+            if (i < 0)
+              break;
+          }
+        });
+  }
+
+  // Return true if the convolution can use Winograd F(2x2, 3x3), i.e. for 2D
+  // convolutions with 3x3 kernels and unit strides and dilations.
+  static bool canUseWinograd(ONNXConvOp convOp, ONNXConvOpAdaptor &adaptor,
+      ArrayRef<int64_t> strides, ArrayRef<int64_t> dilations) {
+    auto kernelShape = adaptor.W().getType().cast<MemRefType>().getShape();
+    auto isOne = [](int64_t val) { return val == 1; };
+    return convOp.group() == 1 && kernelShape.size() == 4 &&
+           kernelShape[2] == 3 && kernelShape[3] == 3 &&
+           llvm::all_of(strides, isOne) && llvm::all_of(dilations, isOne);
+  }
+
+  // Emit a global with the Winograd transform of constant kernels, computed
+  // at compile time.
+  Value emitConstantWinogradKernel(Value kernel, MemRefType transformedType,
+      ConversionPatternRewriter &rewriter, Location loc) const {
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    char *kernelBuffer = createArrayFromDenseElementsAttr(
+        kernel.getDefiningOp()
+            ->getAttrOfType<::mlir::Attribute>("value")
+            .dyn_cast_or_null<mlir::DenseElementsAttr>());
+    char *resBuffer = allocateBufferFor(transformedType, /*useMaxSize=*/true);
+    ConstPropWinogradKernelImpl(kernelBuffer, kernelShape, resBuffer);
+    char *resArray = allocateBufferFor(transformedType);
+    convertDoubleInt64ToExactType(transformedType, resBuffer, resArray);
+    DenseElementsAttr denseAttr =
+        createDenseElementsAttrFromArray(resArray, transformedType);
+    free(resArray);
+    free(resBuffer);
+    free(kernelBuffer);
+
+    auto global = rewriter.create<KrnlGlobalOp>(loc, transformedType,
+        /*shape=*/rewriter.getI64ArrayAttr(transformedType.getShape()),
+        /*name=*/
+        rewriter.getStringAttr(
+            "winograd_kernel_" + std::to_string(winogradKernelID++)),
+        /*value=*/denseAttr,
+        /*offset=*/nullptr,
+        /*alignment=*/nullptr);
+    return global.getResult();
+  }
+
+  // Lower a 3x3 convolution with Winograd F(2x2, 3x3), which computes each
+  // 2x2 output tile from a 4x4 input tile with 16 multiplies instead of 36.
+  //
+  // D (NxCxHxW) x K (MxCx3x3) -> R (NxMxRHxRW)
+  //
+  // With the transform matrices G (4x3), BT (4x4) and AT (2x4), the (T =
+  // ceil(RH / 2) * ceil(RW / 2)) tiles of each image, and p = (i, j) the
+  // 16 positions of the transformed tiles:
+  //
+  //   # Kernel transform, computed at compile time for constant kernels.
+  //   for m, c:
+  //     U[p][m][c] = (G * K[m][c] * GT)[i][j]
+  //   for n = 0 .. N:
+  //     # Input transform of the tiles, read with a stride of 2.
+  //     for c, t:
+  //       V[p][c][t] = (BT * D[n][c][tile t] * B)[i][j]
+  //     for p = 0 .. 16:
+  //       X[p] = U[p] * V[p]
+  //     # Output transform.
+  //     for m, t:
+  //       R[n][m][tile t] = AT * X[.][m][t] * A + B[m]
+  //
+  // The matrix multiplies are tiled and simdized like Gemm. The last tile
+  // row and column are handled separately when the output size is odd, so
+  // that no condition is needed when storing the results.
+  void winogradConv(ONNXConvOp convOp, ONNXConvOpAdaptor &operandAdaptor,
+      Value alloc, ArrayRef<int64_t> pads, Operation *epilogueOp,
+      ConversionPatternRewriter &rewriter, Location loc) const {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    Value input(operandAdaptor.X()), kernel(operandAdaptor.W());
+    Value bias(operandAdaptor.B());
+    auto inputShape = input.getType().cast<MemRefType>().getShape();
+    auto resultShape = alloc.getType().cast<MemRefType>().getShape();
+    Type elementType = alloc.getType().cast<MemRefType>().getElementType();
+    int64_t numChannels = inputShape[1];
+    int64_t numKernels = resultShape[1];
+    int64_t tileRows = (resultShape[2] + 1) / 2;
+    int64_t tileCols = (resultShape[3] + 1) / 2;
+    int64_t numTiles = tileRows * tileCols;
+    // Pad the tiles so that the matrix multiplies can be simdized without
+    // tiling the results.
+    const int64_t vectorLen = tileSizes.jReg;
+    int64_t paddedNumTiles = (numTiles + vectorLen - 1) / vectorLen * vectorLen;
+
+    Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
+    Value half = emitConstantOp(rewriter, loc, elementType, 0.5);
+    LiteralIndexExpr zero(0);
+    auto add = [&](Value a, Value b) -> Value {
+      return rewriter.create<AddFOp>(loc, a, b);
+    };
+    auto sub = [&](Value a, Value b) -> Value {
+      return rewriter.create<SubFOp>(loc, a, b);
+    };
+    // Apply a transform to each column of the tile x, then to each row of the
+    // result, i.e. compute T * x * TT for the transform matrix T.
+    using Tile = SmallVector<SmallVector<Value, 4>, 4>;
+    auto applyTransform =
+        [](const Tile &x,
+            function_ref<SmallVector<Value, 4>(ArrayRef<Value>)> transform) {
+          Tile columns, res;
+          for (unsigned j = 0; j < x[0].size(); ++j) {
+            SmallVector<Value, 4> column;
+            for (unsigned i = 0; i < x.size(); ++i)
+              column.emplace_back(x[i][j]);
+            columns.emplace_back(transform(column));
+          }
+          for (unsigned i = 0; i < columns[0].size(); ++i) {
+            SmallVector<Value, 4> row;
+            for (unsigned j = 0; j < columns.size(); ++j)
+              row.emplace_back(columns[j][i]);
+            res.emplace_back(transform(row));
+          }
+          return res;
+        };
+    // G * x, for a 3-element x.
+    auto kernelTransform = [&](ArrayRef<Value> x) -> SmallVector<Value, 4> {
+      Value s = add(x[0], x[2]);
+      return {x[0], std_mulf(add(s, x[1]), half), std_mulf(sub(s, x[1]), half),
+          x[2]};
+    };
+    // BT * x, for a 4-element x.
+    auto inputTransform = [&](ArrayRef<Value> x) -> SmallVector<Value, 4> {
+      return {sub(x[0], x[2]), add(x[1], x[2]), sub(x[2], x[1]),
+          sub(x[1], x[3])};
+    };
+    // AT * x, for a 4-element x.
+    auto outputTransform = [&](ArrayRef<Value> x) -> SmallVector<Value, 4> {
+      return {add(add(x[0], x[1]), x[2]), sub(sub(x[1], x[2]), x[3])};
+    };
+
+    // Transformed kernels, inputs and products.
+    MemRefType kernelsType =
+        MemRefType::get({16, numKernels, numChannels}, elementType);
+    SmallVector<IndexExpr, 1> noDims;
+    Value transformedKernels;
+    if (isKrnlGlobalConstant(kernel) || isDenseONNXConstant(kernel))
+      transformedKernels =
+          emitConstantWinogradKernel(kernel, kernelsType, rewriter, loc);
+    else
+      transformedKernels = insertAllocAndDeallocSimple(
+          rewriter, convOp, kernelsType, loc, noDims, true, BUFFER_ALIGN);
+    Value transformedInputs = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({16, numChannels, paddedNumTiles}, elementType), loc,
+        noDims, true, BUFFER_ALIGN);
+    Value products = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({16, numKernels, paddedNumTiles}, elementType), loc,
+        noDims, true, BUFFER_ALIGN);
+
+    // 1) Transform the kernels at inference time if they are not constant.
+    if (!isKrnlGlobalConstant(kernel) && !isDenseONNXConstant(kernel)) {
+      ValueRange kernelLoops = krnl_define_loop(2);
+      krnl_parallel(kernelLoops[0]);
+      krnl_iterate_ie(kernelLoops, {zero, zero},
+          {LiteralIndexExpr(numKernels), LiteralIndexExpr(numChannels)}, {},
+          [&](ValueRange args) {
+            IndexExprScope innerScope;
+            ValueRange ivs = krnl_get_induction_var_value(kernelLoops);
+            DimIndexExpr m(ivs[0]), c(ivs[1]);
+            Tile g(3);
+            for (int64_t i = 0; i < 3; ++i)
+              for (int64_t j = 0; j < 3; ++j) {
+                SmallVector<IndexExpr, 4> kernelIndices = {
+                    m, c, LiteralIndexExpr(i), LiteralIndexExpr(j)};
+                g[i].emplace_back(krnl_load(kernel, kernelIndices));
+              }
+            Tile u = applyTransform(g, kernelTransform);
+            for (int64_t p = 0; p < 16; ++p) {
+              SmallVector<IndexExpr, 3> transformedIndices = {
+                  LiteralIndexExpr(p), m, c};
+              krnl_store(u[p / 4][p % 4], transformedKernels,
+                  transformedIndices);
+            }
+          });
+    }
+
+    // The padding columns of the transformed inputs are never written below.
+    if (paddedNumTiles > numTiles) {
+      ValueRange padLoops = krnl_define_loop(3);
+      krnl_iterate_ie(padLoops, {zero, zero, LiteralIndexExpr(numTiles)},
+          {LiteralIndexExpr(16), LiteralIndexExpr(numChannels),
+              LiteralIndexExpr(paddedNumTiles)},
+          {}, [&](ValueRange args) {
+            ValueRange ivs = krnl_get_induction_var_value(padLoops);
+            krnl_store(zeroVal, transformedInputs, ivs);
+          });
+    }
+
+    // Emit the output transform of the tiles [thLb, thUb) x [twLb, twUb),
+    // of which only the first validRows x validCols outputs are stored.
+    auto emitOutputTransform = [&](Value n, int64_t thLb, int64_t thUb,
+                                   int64_t twLb, int64_t twUb,
+                                   int64_t validRows, int64_t validCols) {
+      if (thLb >= thUb || twLb >= twUb)
+        return;
+      ValueRange outputLoops = krnl_define_loop(3);
+      krnl_parallel(outputLoops[0]);
+      krnl_iterate_ie(outputLoops, {zero, LiteralIndexExpr(thLb),
+                                       LiteralIndexExpr(twLb)},
+          {LiteralIndexExpr(numKernels), LiteralIndexExpr(thUb),
+              LiteralIndexExpr(twUb)},
+          {}, [&](ValueRange args) {
+            IndexExprScope innerScope;
+            ValueRange ivs = krnl_get_induction_var_value(outputLoops);
+            DimIndexExpr m(ivs[0]), th(ivs[1]), tw(ivs[2]);
+            IndexExpr t = th * tileCols + tw;
+            Tile x(4);
+            for (int64_t p = 0; p < 16; ++p) {
+              SmallVector<IndexExpr, 3> productIndices = {
+                  LiteralIndexExpr(p), m, t};
+              x[p / 4].emplace_back(krnl_load(products, productIndices));
+            }
+            Tile y = applyTransform(x, outputTransform);
+            Value biasVal;
+            if (!bias.getType().isa<NoneType>())
+              biasVal = krnl_load(bias, ivs[0]);
+            for (int64_t i = 0; i < validRows; ++i)
+              for (int64_t j = 0; j < validCols; ++j) {
+                Value res = y[i][j];
+                if (biasVal)
+                  res = add(res, biasVal);
+                res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
+                SmallVector<IndexExpr, 4> resultIndices = {
+                    DimIndexExpr(n), m, th * 2 + i, tw * 2 + j};
+                krnl_store(res, alloc, resultIndices);
+              }
+          });
+    };
+
+    // Images are processed one at a time, which bounds the size of the
+    // transformed inputs.
+    ValueRange batchLoop = krnl_define_loop(1);
+    krnl_iterate_ie(batchLoop, {zero}, {LiteralIndexExpr(inputShape[0])}, {},
+        [&](ValueRange args) {
+          Value n = krnl_get_induction_var_value(batchLoop)[0];
+
+          // 2) Transform the input tiles. Bound checks are only emitted for
+          // the rows and columns of the tiles that may reach the padding.
+          ValueRange inputLoops = krnl_define_loop(3);
+          krnl_parallel(inputLoops[0]);
+          krnl_iterate_ie(inputLoops, {zero, zero, zero},
+              {LiteralIndexExpr(numChannels), LiteralIndexExpr(tileRows),
+                  LiteralIndexExpr(tileCols)},
+              {}, [&](ValueRange args) {
+                IndexExprScope innerScope;
+                ValueRange ivs = krnl_get_induction_var_value(inputLoops);
+                DimIndexExpr c(ivs[0]), th(ivs[1]), tw(ivs[2]);
+                int64_t lastTile[2] = {tileRows - 1, tileCols - 1};
+                Tile d(4);
+                for (int64_t i = 0; i < 4; ++i)
+                  for (int64_t j = 0; j < 4; ++j) {
+                    SmallVector<IndexExpr, 4> inputIndices = {
+                        DimIndexExpr(n), c};
+                    IndexExpr inBounds = PredicateIndexExpr(true);
+                    bool mayBeOutOfBounds = false;
+                    int64_t offsets[2] = {i, j};
+                    IndexExpr tiles[2] = {th, tw};
+                    for (int64_t dim = 0; dim < 2; ++dim) {
+                      int64_t offset = offsets[dim] - pads[dim];
+                      IndexExpr h = tiles[dim] * 2 + offset;
+                      int64_t size = inputShape[2 + dim];
+                      if (offset < 0 || lastTile[dim] * 2 + offset >= size) {
+                        // Read a valid element out of the padding, the value
+                        // is replaced by zero below.
+                        IndexExpr valid = (h >= 0) & (h < size);
+                        inBounds = inBounds & valid;
+                        h = IndexExpr::select(valid, h, 0);
+                        mayBeOutOfBounds = true;
+                      }
+                      inputIndices.emplace_back(h);
+                    }
+                    Value val = krnl_load(input, inputIndices);
+                    if (mayBeOutOfBounds)
+                      val = rewriter.create<SelectOp>(
+                          loc, inBounds.getValue(), val, zeroVal);
+                    d[i].emplace_back(val);
+                  }
+                Tile v = applyTransform(d, inputTransform);
+                IndexExpr t = th * tileCols + tw;
+                for (int64_t p = 0; p < 16; ++p) {
+                  SmallVector<IndexExpr, 3> transformedIndices = {
+                      LiteralIndexExpr(p), c, t};
+                  krnl_store(v[p / 4][p % 4], transformedInputs,
+                      transformedIndices);
+                }
+              });
+
+          // 3) Multiply the transformed kernels and inputs of each position,
+          // accumulated into zero.
+          ValueRange zeroLoops = krnl_define_loop(3);
+          krnl_parallel(zeroLoops[1]);
+          krnl_iterate_ie(zeroLoops, {zero, zero, zero},
+              {LiteralIndexExpr(16), LiteralIndexExpr(numKernels),
+                  LiteralIndexExpr(paddedNumTiles)},
+              {}, [&](ValueRange args) {
+                ValueRange ivs = krnl_get_induction_var_value(zeroLoops);
+                krnl_store(zeroVal, products, ivs);
+              });
+
+          ValueRange positionLoop = krnl_define_loop(1);
+          krnl_iterate_ie(positionLoop, {zero}, {LiteralIndexExpr(16)}, {},
+              [&](ValueRange args) {
+                Value p = krnl_get_induction_var_value(positionLoop)[0];
+                emitTiledMatMul(transformedKernels, {p}, transformedInputs,
+                    {p}, products, {p}, LiteralIndexExpr(numKernels),
+                    LiteralIndexExpr(paddedNumTiles),
+                    LiteralIndexExpr(numChannels), zeroVal, tileSizes);
+              });
+
+          // 4) Transform the products into the output tiles, the last tile
+          // row and column being partial for odd output sizes.
+          int64_t fullRows = resultShape[2] / 2, fullCols = resultShape[3] / 2;
+          emitOutputTransform(n, 0, fullRows, 0, fullCols, 2, 2);
+          emitOutputTransform(n, 0, fullRows, fullCols, tileCols, 2, 1);
+          emitOutputTransform(n, fullRows, tileRows, 0, fullCols, 1, 2);
+          emitOutputTransform(
+              n, fullRows, tileRows, fullCols, tileCols, 1, 1);
+        });
+  }
+
+  // Lower the convolution to one matrix multiply per image and group, by
+  // packing the input patches into a matrix (im2col).
+  //
+  // D (NxCxH1x...xHd) x K (MxCGxK1x...xKd) -> R (NxMxR1x...xRd)
+  //
+  // where CG = C / group and MG = M / group. With KX = K1 * ... * Kd, and RX
+  // = R1 * ... * Rd rounded up to a multiple of the vector length:
+  //
+  //   # Weights, as one [MG, CG * KX] matrix per group.
+  //   for g, m, c, k1 .. kd:
+  //     W[g][m][c * KX + k] = K[g * MG + m][c][k1]...[kd]
+  //   for n = 0 .. N:
+  //     # Input patches, as one [CG * KX, RX] matrix per group.
+  //     for g, c, k1 .. kd, r1 .. rd:
+  //       hi = ri * si + ki * di - pti
+  //       P[g][c * KX + k][r] =
+  //           all(0 <= hi < Hi) ? D[n][g * CG + c][h1..hd] : 0
+  //     for g = 0 .. group:
+  //       Y[g] = W[g] * P[g]
+  //     for g, m, r1 .. rd:
+  //       R[n][g * MG + m][r1]...[rd] = Y[g][m][r] + B[g * MG + m]
+  //
+  // where k and r are the linearized indices k1 .. kd and r1 .. rd. The
+  // matrix multiplies are tiled and simdized like Gemm.
+  void im2colConv(ONNXConvOp convOp, ONNXConvOpAdaptor &operandAdaptor,
+      Value alloc, ArrayRef<int64_t> pads, ArrayRef<int64_t> strides,
+      ArrayRef<int64_t> dilations, Operation *epilogueOp,
+      ConversionPatternRewriter &rewriter, Location loc) const {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    Value input(operandAdaptor.X()), kernel(operandAdaptor.W());
+    Value bias(operandAdaptor.B());
+    bool hasBias = !bias.getType().isa<NoneType>();
+    auto inputShape = input.getType().cast<MemRefType>().getShape();
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    auto resultShape = alloc.getType().cast<MemRefType>().getShape();
+    Type elementType = alloc.getType().cast<MemRefType>().getElementType();
+    int64_t nSpatialDims = resultShape.size() - 2;
+    ArrayRef<int64_t> kernelSpatialShape = kernelShape.drop_front(2);
+    ArrayRef<int64_t> resultSpatialShape = resultShape.drop_front(2);
+
+    // Vector length of the matrix multiplies.
+    const int64_t jRegTile(tileSizes.jReg);
+
+    int64_t group = convOp.group();
+    int64_t kernelsPerGroup = kernelShape[0] / group;
+    int64_t channelsPerGroup = kernelShape[1];
+    int64_t kernelSize = 1, resultSize = 1;
+    for (int64_t i = 0; i < nSpatialDims; ++i) {
+      kernelSize *= kernelSpatialShape[i];
+      resultSize *= resultSpatialShape[i];
+    }
+    int64_t patchSize = channelsPerGroup * kernelSize;
+    // Pad the columns of the matrices so that they can be simdized without
+    // tiling the results.
+    int64_t paddedResultSize =
+        (resultSize + jRegTile - 1) / jRegTile * jRegTile;
+    bool hasPads = llvm::any_of(pads, [](int64_t pad) { return pad != 0; });
+
+    Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
+    // Half precision products are accumulated in single precision.
+    Type accType = getMatMulAccumulationType(elementType);
+    Value accZeroVal = zeroVal;
+    if (accType != elementType)
+      accZeroVal = emitConstantOp(rewriter, loc, accType, 0);
+    LiteralIndexExpr zero(0);
+    LiteralIndexExpr I(kernelsPerGroup), J(paddedResultSize), K(patchSize);
+
+    // Linearize row-major indices.
+    auto linearize = [](ArrayRef<IndexExpr> indices, ArrayRef<int64_t> dims) {
+      IndexExpr linear = LiteralIndexExpr(0);
+      for (unsigned i = 0; i < indices.size(); ++i)
+        linear = linear * dims[i] + indices[i];
+      return linear;
+    };
+    // Bounds of a loop nest, starting at zero.
+    auto getUbs = [](ArrayRef<int64_t> dims) {
+      SmallVector<IndexExpr, 4> ubs;
+      for (int64_t dim : dims)
+        ubs.emplace_back(LiteralIndexExpr(dim));
+      return ubs;
+    };
+
+    // Matrices.
+    SmallVector<IndexExpr, 1> noDims;
+    Value weights = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({group, kernelsPerGroup, patchSize}, elementType), loc,
+        noDims, true, BUFFER_ALIGN);
+    Value patches = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({group, patchSize, paddedResultSize}, elementType),
+        loc, noDims, true, BUFFER_ALIGN);
+    Value products = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({group, kernelsPerGroup, paddedResultSize}, accType),
+        loc, noDims, true, BUFFER_ALIGN);
+
+    // 1) Pack the weights.
+    SmallVector<int64_t, 6> weightLoopDims = {
+        group, kernelsPerGroup, channelsPerGroup};
+    weightLoopDims.append(kernelSpatialShape.begin(), kernelSpatialShape.end());
+    SmallVector<IndexExpr, 6> weightLbs(weightLoopDims.size(), zero);
+    ValueRange weightLoops = krnl_define_loop(weightLoopDims.size());
+    krnl_iterate_ie(weightLoops, weightLbs, getUbs(weightLoopDims), {},
+        [&](ValueRange args) {
+          IndexExprScope innerScope;
+          ValueRange ivs = krnl_get_induction_var_value(weightLoops);
+          DimIndexExpr g(ivs[0]), m(ivs[1]), c(ivs[2]);
+          SmallVector<IndexExpr, 4> kernelIndices = {
+              g * kernelsPerGroup + m, c};
+          SmallVector<IndexExpr, 4> kIndices;
+          for (int64_t i = 0; i < nSpatialDims; ++i)
+            kIndices.emplace_back(DimIndexExpr(ivs[3 + i]));
+          kernelIndices.append(kIndices.begin(), kIndices.end());
+          SmallVector<IndexExpr, 3> weightIndices = {
+              g, m, c * kernelSize + linearize(kIndices, kernelSpatialShape)};
+          krnl_store(krnl_load(kernel, kernelIndices), weights, weightIndices);
+        });
+
+    // The padding columns of the patches are never written below.
+    if (paddedResultSize > resultSize) {
+      ValueRange padLoops = krnl_define_loop(3);
+      krnl_iterate_ie(padLoops, {zero, zero, LiteralIndexExpr(resultSize)},
+          {LiteralIndexExpr(group), K, J}, {}, [&](ValueRange args) {
+            ValueRange ivs = krnl_get_induction_var_value(padLoops);
+            krnl_store(zeroVal, patches, ivs);
+          });
+    }
+
+    // Images are processed one at a time, which bounds the size of the
+    // patches. In the loops through output channels, the largest of the group
+    // and channel loops is parallel.
+    ValueRange batchLoop = krnl_define_loop(1);
+    krnl_iterate_ie(batchLoop, {zero}, {LiteralIndexExpr(inputShape[0])}, {},
+        [&](ValueRange args) {
+          Value n = krnl_get_induction_var_value(batchLoop)[0];
+
+          // 2) Pack the input patches.
+          SmallVector<int64_t, 8> patchLoopDims = {group, channelsPerGroup};
+          patchLoopDims.append(
+              kernelSpatialShape.begin(), kernelSpatialShape.end());
+          patchLoopDims.append(
+              resultSpatialShape.begin(), resultSpatialShape.end());
+          SmallVector<IndexExpr, 8> patchLbs(patchLoopDims.size(), zero);
+          ValueRange patchLoops = krnl_define_loop(patchLoopDims.size());
+          krnl_parallel(patchLoops[(group > channelsPerGroup) ? 0 : 1]);
+          krnl_iterate_ie(patchLoops, patchLbs, getUbs(patchLoopDims), {},
+              [&](ValueRange args) {
+                IndexExprScope innerScope;
+                ValueRange ivs = krnl_get_induction_var_value(patchLoops);
+                DimIndexExpr g(ivs[0]), c(ivs[1]);
+                SmallVector<IndexExpr, 4> kIndices, rIndices;
+                for (int64_t i = 0; i < nSpatialDims; ++i) {
+                  kIndices.emplace_back(DimIndexExpr(ivs[2 + i]));
+                  rIndices.emplace_back(
+                      DimIndexExpr(ivs[2 + nSpatialDims + i]));
+                }
+                SmallVector<IndexExpr, 4> inputIndices = {
+                    DimIndexExpr(n), g * channelsPerGroup + c};
+                IndexExpr inBounds = PredicateIndexExpr(true);
+                for (int64_t i = 0; i < nSpatialDims; ++i) {
+                  int64_t dilation = dilations.empty() ? 1 : dilations[i];
+                  IndexExpr h = rIndices[i] * strides[i] +
+                                kIndices[i] * dilation - pads[i];
+                  if (hasPads) {
+                    // Read a valid element out of the padding, the value is
+                    // replaced by zero below.
+                    IndexExpr valid = (h >= 0) & (h < inputShape[2 + i]);
+                    inBounds = inBounds & valid;
+                    h = IndexExpr::select(valid, h, 0);
+                  }
+                  inputIndices.emplace_back(h);
+                }
+                Value val = krnl_load(input, inputIndices);
+                if (hasPads)
+                  val = rewriter.create<SelectOp>(
+                      loc, inBounds.getValue(), val, zeroVal);
+                SmallVector<IndexExpr, 3> patchIndices = {g,
+                    c * kernelSize + linearize(kIndices, kernelSpatialShape),
+                    linearize(rIndices, resultSpatialShape)};
+                krnl_store(val, patches, patchIndices);
+              });
+
+          // 3) Compute the products, accumulated into zero.
+          ValueRange zeroLoops = krnl_define_loop(3);
+          krnl_parallel(zeroLoops[(group > kernelsPerGroup) ? 0 : 1]);
+          krnl_iterate_ie(zeroLoops, {zero, zero, zero},
+              {LiteralIndexExpr(group), I, J}, {}, [&](ValueRange args) {
+                ValueRange ivs = krnl_get_induction_var_value(zeroLoops);
+                krnl_store(accZeroVal, products, ivs);
+              });
+
+          ValueRange groupLoop = krnl_define_loop(1);
+          krnl_iterate_ie(groupLoop, {zero}, {LiteralIndexExpr(group)}, {},
+              [&](ValueRange args) {
+                Value g = krnl_get_induction_var_value(groupLoop)[0];
+                emitTiledMatMul(weights, {g}, patches, {g}, products, {g}, I,
+                    J, K, accZeroVal, tileSizes);
+              });
+
+          // 4) Copy the products to the result, adding the bias.
+          SmallVector<int64_t, 6> resultLoopDims = {group, kernelsPerGroup};
+          resultLoopDims.append(
+              resultSpatialShape.begin(), resultSpatialShape.end());
+          SmallVector<IndexExpr, 6> resultLbs(resultLoopDims.size(), zero);
+          ValueRange resultLoops = krnl_define_loop(resultLoopDims.size());
+          krnl_parallel(resultLoops[(group > kernelsPerGroup) ? 0 : 1]);
+          krnl_iterate_ie(resultLoops, resultLbs, getUbs(resultLoopDims), {},
+              [&](ValueRange args) {
+                IndexExprScope innerScope;
+                ValueRange ivs = krnl_get_induction_var_value(resultLoops);
+                DimIndexExpr g(ivs[0]), m(ivs[1]);
+                IndexExpr kernelIndex = g * kernelsPerGroup + m;
+                SmallVector<IndexExpr, 4> rIndices;
+                for (int64_t i = 0; i < nSpatialDims; ++i)
+                  rIndices.emplace_back(DimIndexExpr(ivs[2 + i]));
+                SmallVector<IndexExpr, 3> productIndices = {
+                    g, m, linearize(rIndices, resultSpatialShape)};
+                Value res = krnl_load(products, productIndices);
+                if (hasBias) {
+                  SmallVector<IndexExpr, 1> biasIndices = {kernelIndex};
+                  Value b = krnl_load(bias, biasIndices);
+                  if (accType != elementType)
+                    b = rewriter.create<FPExtOp>(loc, accType, b);
+                  res = std_addf(res, b);
+                }
+                if (accType != elementType)
+                  res = rewriter.create<FPTruncOp>(loc, elementType, res);
+                res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
+                SmallVector<IndexExpr, 6> resultIndices = {
+                    DimIndexExpr(n), kernelIndex};
+                resultIndices.append(rIndices.begin(), rIndices.end());
+                krnl_store(res, alloc, resultIndices);
+              });
+        });
+  }
 
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
@@ -69,9 +903,12 @@ struct ONNXConvOpLowering : public ConversionPattern {
     int spatialStartIndex = 2;
 
     // Insert an allocation and deallocation for the result of this operation.
+    // The result of the store epilogue op, if any, is stored instead.
     auto memRefType = convertToMemRefType(*op->result_type_begin());
     Value alloc;
-    bool insertDealloc = checkInsertDealloc(op);
+    Operation *epilogueOp =
+        fuseStoreEpilogues ? getStoreEpilogueOp(op) : nullptr;
+    bool insertDealloc = checkInsertDealloc(epilogueOp ? epilogueOp : op);
 
     auto resultShape = memRefType.getShape();
     auto inputOperand = operandAdaptor.X();
@@ -86,6 +923,29 @@ struct ONNXConvOpLowering : public ConversionPattern {
       alloc = insertAllocAndDealloc(
           memRefType, loc, rewriter, insertDealloc, {inputOperand});
 
+    if (useWinograd && canOptimizeConv(operandAdaptor, alloc) &&
+        canUseWinograd(convOp, operandAdaptor, strides, dilations)) {
+      winogradConv(
+          convOp, operandAdaptor, alloc, pads, epilogueOp, rewriter, loc);
+      replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+      return success();
+    }
+
+    if (optimizeConv && canOptimizeConv(operandAdaptor, alloc)) {
+      if (isDepthwiseConv(convOp, operandAdaptor)) {
+        depthwiseConv(convOp, operandAdaptor, alloc, pads, strides, dilations,
+            rewriter, loc);
+        applyStoreEpilogueInPlace(rewriter, loc, epilogueOp, alloc);
+      } else if (isPointwiseConv(convOp, operandAdaptor, pads, strides)) {
+        pointwiseConv(operandAdaptor, alloc, rewriter, loc);
+        applyStoreEpilogueInPlace(rewriter, loc, epilogueOp, alloc);
+      } else
+        im2colConv(convOp, operandAdaptor, alloc, pads, strides, dilations,
+            epilogueOp, rewriter, loc);
+      replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+      return success();
+    }
+
     // R = Conv(D, K)
     //
     // The input/output shapes will look like this:
@@ -178,6 +1038,11 @@ struct ONNXConvOpLowering : public ConversionPattern {
       gIndex = outerLoops.pushBounds(0, group);
     //   for m = 0 .. kernelsPerGroup:
     int mIndex = outerLoops.pushBounds(0, kernelsPerGroup);
+    // Output channels are computed in parallel. Group and kernelsPerGroup are
+    // compile time constants, select the largest of the two loops so that
+    // depthwise convolutions are parallelized as well. The batch loop stays
+    // sequential as the batch size is typically small at inference time.
+    outerLoops.parallelizeLoop((group > kernelsPerGroup) ? gIndex : mIndex);
     // Outer loop iterations.
     outerLoops.createIterateOp();
     rewriter.setInsertionPointToStart(outerLoops.getIterateBlock());
@@ -352,25 +1217,281 @@ struct ONNXConvOpLowering : public ConversionPattern {
         }
         rewriter.restoreInsertionPoint(ipOuterLoopRegion);
 
-        auto result = krnl_load(reductionVal, empty);
+        Value result = krnl_load(reductionVal, empty);
         // Store the result. Optionally add bias.
         if (hasBias) {
           SmallVector<IndexExpr, 4> biasIndices;
           biasIndices.emplace_back(kernel);
           auto loadBias = krnl_load(biasOperand, biasIndices);
-          auto resultWithBias = rewriter.create<AddFOp>(loc, result, loadBias);
-          krnl_store(resultWithBias, alloc, resultIndices);
-        } else
-          krnl_store(result, alloc, resultIndices);
+          result = rewriter.create<AddFOp>(loc, result, loadBias);
+        }
+        result = emitStoreEpilogue(rewriter, loc, epilogueOp, result);
+        krnl_store(result, alloc, resultIndices);
       }
     }
-    rewriter.replaceOp(op, alloc);
+    replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
 
     return success();
   }
 };
 
-void populateLoweringONNXConvOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx) {
-  patterns.insert<ONNXConvOpLowering>(ctx);
+int ONNXConvOpLowering::winogradKernelID;
+
+struct ONNXConvNCHWcOpLowering : public ConversionPattern {
+  static int packedKernelID;
+
+  ONNXConvNCHWcOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXConvNCHWcOp::getOperationName(), 1, ctx) {
+    packedKernelID = 0;
+  }
+
+  // Emit a global with the packed constant kernels, computed at compile time.
+  Value emitConstantPackedKernel(Value kernel, MemRefType packedType,
+      int64_t blockSize, ConversionPatternRewriter &rewriter,
+      Location loc) const {
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    char *kernelBuffer = createArrayFromDenseElementsAttr(
+        kernel.getDefiningOp()
+            ->getAttrOfType<::mlir::Attribute>("value")
+            .dyn_cast_or_null<mlir::DenseElementsAttr>());
+    char *resBuffer = allocateBufferFor(packedType, /*useMaxSize=*/true);
+    ConstPropPackBlockedConvKernelImpl(
+        kernelBuffer, kernelShape, blockSize, resBuffer);
+    char *resArray = allocateBufferFor(packedType);
+    convertDoubleInt64ToExactType(packedType, resBuffer, resArray);
+    DenseElementsAttr denseAttr =
+        createDenseElementsAttrFromArray(resArray, packedType);
+    free(resArray);
+    free(resBuffer);
+    free(kernelBuffer);
+
+    auto global = rewriter.create<KrnlGlobalOp>(loc, packedType,
+        /*shape=*/rewriter.getI64ArrayAttr(packedType.getShape()),
+        /*name=*/
+        rewriter.getStringAttr(
+            "packed_conv_kernel_" + std::to_string(packedKernelID++)),
+        /*value=*/denseAttr,
+        /*offset=*/nullptr,
+        /*alignment=*/rewriter.getI64IntegerAttr(BUFFER_ALIGN));
+    return global.getResult();
+  }
+
+  // Lower a convolution in the blocked layout NCHW[b]c on vectors of the b
+  // channels of the output blocks. The kernels are packed into b x b matrices
+  // from the input channels of a block to the output channels of a block, so
+  // that each input element is broadcast and multiplied by a row of them.
+  //
+  // D (NxCBxH1x...xHdxb) x K (MxCxK1x...xKd) -> R (NxMBxR1x...xRdxb)
+  //
+  //   # Packed at compile time for constant kernels, zero padded.
+  //   KP[m / b][c / b][k1]...[kd][c % b][m % b] = K[m][c][k1]...[kd]
+  //   for n, mb, r1 .. rd:
+  //     acc = B[mb * b .. mb * b + b] (or 0)
+  //     for k1 .. kd:
+  //       hi = ri * si + ki * di - pti
+  //       if all 0 <= hi < Hi:
+  //         for cb = 0 .. CB, ci = 0 .. b:
+  //           acc += D[n][cb][h1]...[hd][ci] * KP[mb][cb][k1]...[kd][ci]
+  //     R[n][mb][r1]...[rd] = acc
+  //
+  // The loop over ci is unrolled, and the condition omitted without padding.
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto loc = op->getLoc();
+    ONNXConvNCHWcOpAdaptor operandAdaptor(operands);
+    ONNXConvNCHWcOp convOp = llvm::cast<ONNXConvNCHWcOp>(op);
+    Value input(operandAdaptor.X()), kernel(operandAdaptor.W());
+    Value bias(operandAdaptor.B());
+    auto inputType = input.getType().cast<MemRefType>();
+    auto kernelType = kernel.getType().cast<MemRefType>();
+    auto memRefType = convertToMemRefType(*op->result_type_begin());
+    if (!hasAllConstantDimensions(inputType) ||
+        !hasAllConstantDimensions(kernelType) ||
+        !hasAllConstantDimensions(memRefType))
+      return op->emitError("The blocked convolutions need static shapes");
+
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+    ScopedContext scope(rewriter, loc);
+    IndexExprScope ieScope(&rewriter, loc);
+
+    auto inputShape = inputType.getShape();
+    auto kernelShape = kernelType.getShape();
+    auto resultShape = memRefType.getShape();
+    Type elementType = memRefType.getElementType();
+    int64_t blockSize = convOp.block_size();
+    int64_t nSpatialDims = kernelShape.size() - 2;
+    int64_t numKernels = kernelShape[0];
+    int64_t numChannels = kernelShape[1];
+    int64_t numChannelBlocks = inputShape[1];
+    ArrayRef<int64_t> kernelSpatialShape = kernelShape.drop_front(2);
+    SmallVector<int64_t, 4> pads, strides, dilations;
+    for (int64_t i = 0; i < nSpatialDims; ++i) {
+      pads.emplace_back(ArrayAttrIntVal(convOp.pads(), i));
+      strides.emplace_back(ArrayAttrIntVal(convOp.strides(), i));
+      dilations.emplace_back(ArrayAttrIntVal(convOp.dilations(), i));
+    }
+    bool hasPadding = llvm::any_of(convOp.pads().getValue(),
+        [](Attribute pad) { return pad.cast<IntegerAttr>().getInt() != 0; });
+
+    SmallVector<IndexExpr, 1> noDims;
+    Value alloc = insertAllocAndDeallocSimple(
+        rewriter, op, memRefType, loc, noDims, BUFFER_ALIGN);
+    Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
+    LiteralIndexExpr zero(0), block(blockSize);
+
+    // Pack the kernels at inference time if they are not constant.
+    SmallVector<int64_t, 6> packedShape = {resultShape[1], numChannelBlocks};
+    packedShape.append(kernelSpatialShape.begin(), kernelSpatialShape.end());
+    packedShape.append({blockSize, blockSize});
+    MemRefType packedType = MemRefType::get(packedShape, elementType);
+    Value packed;
+    if (isKrnlGlobalConstant(kernel) || isDenseONNXConstant(kernel)) {
+      packed = emitConstantPackedKernel(
+          kernel, packedType, blockSize, rewriter, loc);
+    } else {
+      packed = insertAllocAndDeallocSimple(
+          rewriter, op, packedType, loc, noDims, true, BUFFER_ALIGN);
+      if (numKernels % blockSize != 0 || numChannels % blockSize != 0) {
+        SmallVector<IndexExpr, 6> lbs(packedShape.size(), zero), ubs;
+        for (int64_t dim : packedShape)
+          ubs.emplace_back(LiteralIndexExpr(dim));
+        ValueRange padLoops = krnl_define_loop(packedShape.size());
+        krnl_iterate_ie(padLoops, lbs, ubs, {}, [&](ValueRange args) {
+          ValueRange ivs = krnl_get_induction_var_value(padLoops);
+          krnl_store(zeroVal, packed, ivs);
+        });
+      }
+      SmallVector<IndexExpr, 4> lbs(kernelShape.size(), zero), ubs;
+      for (int64_t dim : kernelShape)
+        ubs.emplace_back(LiteralIndexExpr(dim));
+      ValueRange packLoops = krnl_define_loop(kernelShape.size());
+      krnl_parallel(packLoops[0]);
+      krnl_iterate_ie(packLoops, lbs, ubs, {}, [&](ValueRange args) {
+        IndexExprScope innerScope;
+        ValueRange ivs = krnl_get_induction_var_value(packLoops);
+        DimIndexExpr m(ivs[0]), c(ivs[1]);
+        SmallVector<IndexExpr, 6> packedIndices = {
+            m.floorDiv(block), c.floorDiv(block)};
+        for (Value iv : ivs.drop_front(2))
+          packedIndices.emplace_back(DimIndexExpr(iv));
+        packedIndices.emplace_back(c % block);
+        packedIndices.emplace_back(m % block);
+        krnl_store(krnl_load(kernel, ivs), packed, packedIndices);
+      });
+    }
+
+    VectorType vecType = VectorType::get({blockSize}, elementType);
+    Value packedVectors = krnl_vector_type_cast(packed, blockSize);
+    Value resultVectors = krnl_vector_type_cast(alloc, blockSize);
+    Value zeroVec = emitConstantOp(rewriter, loc, vecType, 0);
+    MemRefType accType = MemRefType::get({}, vecType);
+    SmallVector<Value, 1> scalarAccess; // Empty.
+
+    SmallVector<IndexExpr, 6> outputLbs(2 + nSpatialDims, zero), outputUbs;
+    for (int64_t dim : resultShape.drop_back())
+      outputUbs.emplace_back(LiteralIndexExpr(dim));
+    SmallVector<IndexExpr, 4> kernelLbs(nSpatialDims, zero), kernelUbs;
+    for (int64_t dim : kernelSpatialShape)
+      kernelUbs.emplace_back(LiteralIndexExpr(dim));
+
+    // Accumulate the contributions of the input channels at one kernel
+    // position into acc.
+    auto emitKernelPosition = [&](Value acc, DimIndexExpr n, DimIndexExpr mb,
+                                  ValueRange outputIVs, ValueRange kernelIVs) {
+      SmallVector<IndexExpr, 4> inputPos;
+      Value isValid;
+      for (int64_t i = 0; i < nSpatialDims; ++i) {
+        IndexExpr h = DimIndexExpr(outputIVs[i]) * strides[i] +
+                      DimIndexExpr(kernelIVs[i]) * dilations[i] - pads[i];
+        inputPos.emplace_back(h);
+        if (!hasPadding)
+          continue;
+        Value hVal = h.getValue();
+        Value inBounds = rewriter.create<AndOp>(loc,
+            rewriter.create<CmpIOp>(
+                loc, CmpIPredicate::sge, hVal, zero.getValue()),
+            rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, hVal,
+                LiteralIndexExpr(inputShape[2 + i]).getValue()));
+        isValid =
+            isValid ? rewriter.create<AndOp>(loc, isValid, inBounds) : inBounds;
+      }
+
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      if (isValid) {
+        auto ifOp = rewriter.create<scf::IfOp>(
+            loc, isValid, /*withElseRegion=*/false);
+        rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+      }
+      ValueRange channelLoop = krnl_define_loop(1);
+      krnl_iterate_ie(channelLoop, {zero},
+          {LiteralIndexExpr(numChannelBlocks)}, {}, [&](ValueRange args) {
+            IndexExprScope channelScope;
+            Value cb = krnl_get_induction_var_value(channelLoop)[0];
+            SmallVector<IndexExpr, 6> inputIndices = {
+                DimIndexExpr(n), DimIndexExpr(cb)};
+            SmallVector<IndexExpr, 6> kernelIndices = {
+                DimIndexExpr(mb), DimIndexExpr(cb)};
+            for (int64_t i = 0; i < nSpatialDims; ++i) {
+              inputIndices.emplace_back(DimIndexExpr(inputPos[i]));
+              kernelIndices.emplace_back(DimIndexExpr(kernelIVs[i]));
+            }
+            inputIndices.emplace_back(zero);
+            kernelIndices.emplace_back(zero);
+            kernelIndices.emplace_back(zero);
+            Value sum = krnl_load(acc, scalarAccess);
+            for (int64_t ci = 0; ci < blockSize; ++ci) {
+              inputIndices.back() = LiteralIndexExpr(ci);
+              kernelIndices[kernelIndices.size() - 2] = LiteralIndexExpr(ci);
+              Value x = rewriter.create<SplatOp>(
+                  loc, vecType, krnl_load(input, inputIndices));
+              Value w = krnl_load(packedVectors, kernelIndices);
+              sum = rewriter.create<vector::FMAOp>(loc, x, w, sum);
+            }
+            krnl_store(sum, acc, scalarAccess);
+          });
+    };
+
+    ValueRange outputLoops = krnl_define_loop(2 + nSpatialDims);
+    krnl_parallel(outputLoops[1]);
+    krnl_iterate_ie(
+        outputLoops, outputLbs, outputUbs, {}, [&](ValueRange args) {
+          IndexExprScope outputScope;
+          ValueRange outputIVs = krnl_get_induction_var_value(outputLoops);
+          DimIndexExpr n(outputIVs[0]), mb(outputIVs[1]);
+          Value acc = rewriter.create<memref::AllocaOp>(loc, accType);
+          Value init = zeroVec;
+          if (!bias.getType().isa<NoneType>())
+            init = rewriter.create<vector::TransferReadOp>(
+                loc, vecType, bias, ValueRange{(mb * blockSize).getValue()});
+          krnl_store(init, acc, scalarAccess);
+
+          ValueRange kernelLoops = krnl_define_loop(nSpatialDims);
+          krnl_iterate_ie(
+              kernelLoops, kernelLbs, kernelUbs, {}, [&](ValueRange args) {
+                IndexExprScope kernelScope;
+                emitKernelPosition(acc, n, mb, outputIVs.drop_front(2),
+                    krnl_get_induction_var_value(kernelLoops));
+              });
+
+          SmallVector<Value, 6> resultIndices(
+              outputIVs.begin(), outputIVs.end());
+          resultIndices.emplace_back(zero.getValue());
+          krnl_store(
+              krnl_load(acc, scalarAccess), resultVectors, resultIndices);
+        });
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+int ONNXConvNCHWcOpLowering::packedKernelID;
+
+void populateLoweringONNXConvOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool optimizeConv, bool useWinograd,
+    const MatMulTileSizes &tileSizes, bool fuseStoreEpilogues) {
+  patterns.insert<ONNXConvOpLowering>(
+      ctx, optimizeConv, useWinograd, tileSizes, fuseStoreEpilogues);
+  patterns.insert<ONNXConvNCHWcOpLowering>(ctx);
 }
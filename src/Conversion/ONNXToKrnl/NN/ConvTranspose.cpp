@@ -0,0 +1,322 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------- ConvTranspose.cpp - Lowering ConvTranspose Op ------------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX ConvTranspose Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+
+#define BUFFER_ALIGN 128
+using namespace mlir;
+
+struct ONNXConvTransposeOpLowering : public ConversionPattern {
+  MatMulTileSizes tileSizes;
+  bool fuseStoreEpilogues = false;
+
+  ONNXConvTransposeOpLowering(MLIRContext *ctx,
+      const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+      bool fuseStoreEpilogues = false)
+      : ConversionPattern(
+            mlir::ONNXConvTransposeOp::getOperationName(), 1, ctx) {
+    this->tileSizes = tileSizes;
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+  }
+
+  // Lower the transposed convolution to one matrix multiply per image and
+  // group, whose columns are scattered into the result (col2im). Unlike
+  // lowering it as a convolution of the input padded with zeros between its
+  // elements, no product of a padding zero is computed.
+  //
+  // D (NxCxH1x...xHd) x K (CxMGxK1x...xKd) -> R (NxMxR1x...xRd)
+  //
+  // where CG = C / group and M = group * MG. With KX = K1 * ... * Kd and HX =
+  // H1 * ... * Hd:
+  //
+  //   # Weights, as one [MG * KX, CG] matrix per group.
+  //   for g, c, m, k1 .. kd:
+  //     W[g][m * KX + k][c] = K[g * CG + c][m][k1]...[kd]
+  //   for n = 0 .. N:
+  //     # Columns, D[n] being viewed as one [CG, HX] matrix per group.
+  //     for g = 0 .. group:
+  //       Y[g] = W[g] * D[n][g]
+  //     # Scatter the columns into their output positions.
+  //     for g, m, r1 .. rd:
+  //       S[g][m][r1]...[rd] = 0
+  //     for g, m, k1 .. kd, h1 .. hd:
+  //       ri = hi * si + ki * di - pti
+  //       if all(0 <= ri < Ri):
+  //         S[g][m][r1]...[rd] += Y[g][m * KX + k][h]
+  //     for g, m, r1 .. rd:
+  //       R[n][g * MG + m][r1]...[rd] = S[g][m][r1]...[rd] + B[g * MG + m]
+  //
+  // where k and h are the linearized indices k1 .. kd and h1 .. hd. The
+  // matrix multiplies are tiled and simdized like Gemm. The scatter of an
+  // output channel is done by a single thread, the parallel loop being the
+  // group or channel loop.
+  void col2imConvTranspose(ONNXConvTransposeOp convOp,
+      ONNXConvTransposeOpAdaptor &operandAdaptor, Value alloc,
+      ArrayRef<int64_t> pads, ArrayRef<int64_t> strides,
+      ArrayRef<int64_t> dilations, Operation *epilogueOp,
+      ConversionPatternRewriter &rewriter, Location loc) const {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+
+    Value input(operandAdaptor.X()), kernel(operandAdaptor.W());
+    Value bias(operandAdaptor.B());
+    bool hasBias = !bias.getType().isa<NoneType>();
+    auto inputShape = input.getType().cast<MemRefType>().getShape();
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    auto resultShape = alloc.getType().cast<MemRefType>().getShape();
+    Type elementType = alloc.getType().cast<MemRefType>().getElementType();
+    int64_t nSpatialDims = resultShape.size() - 2;
+    ArrayRef<int64_t> inputSpatialShape = inputShape.drop_front(2);
+    ArrayRef<int64_t> kernelSpatialShape = kernelShape.drop_front(2);
+    ArrayRef<int64_t> resultSpatialShape = resultShape.drop_front(2);
+
+    int64_t group = convOp.group();
+    int64_t channelsPerGroup = kernelShape[0] / group;
+    int64_t kernelsPerGroup = kernelShape[1];
+    int64_t kernelSize = 1, inputSize = 1;
+    for (int64_t i = 0; i < nSpatialDims; ++i) {
+      kernelSize *= kernelSpatialShape[i];
+      inputSize *= inputSpatialShape[i];
+    }
+    int64_t columnSize = kernelsPerGroup * kernelSize;
+
+    Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
+    // Half precision products are accumulated in single precision.
+    Type accType = getMatMulAccumulationType(elementType);
+    Value accZeroVal = zeroVal;
+    if (accType != elementType)
+      accZeroVal = emitConstantOp(rewriter, loc, accType, 0);
+    LiteralIndexExpr zero(0);
+    LiteralIndexExpr I(columnSize), J(inputSize), K(channelsPerGroup);
+
+    // Linearize row-major indices.
+    auto linearize = [](ArrayRef<IndexExpr> indices, ArrayRef<int64_t> dims) {
+      IndexExpr linear = LiteralIndexExpr(0);
+      for (unsigned i = 0; i < indices.size(); ++i)
+        linear = linear * dims[i] + indices[i];
+      return linear;
+    };
+    // Bounds of a loop nest, starting at zero.
+    auto getUbs = [](ArrayRef<int64_t> dims) {
+      SmallVector<IndexExpr, 4> ubs;
+      for (int64_t dim : dims)
+        ubs.emplace_back(LiteralIndexExpr(dim));
+      return ubs;
+    };
+
+    // Matrices. The input is viewed as [N, group, CG, HX] matrices.
+    SmallVector<IndexExpr, 1> noDims;
+    Value weights = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({group, columnSize, channelsPerGroup}, elementType),
+        loc, noDims, true, BUFFER_ALIGN);
+    Value columns = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get({group, columnSize, inputSize}, accType), loc, noDims,
+        true, BUFFER_ALIGN);
+    SmallVector<int64_t, 6> sumShape = {group, kernelsPerGroup};
+    sumShape.append(resultSpatialShape.begin(), resultSpatialShape.end());
+    Value sums = insertAllocAndDeallocSimple(rewriter, convOp,
+        MemRefType::get(sumShape, accType), loc, noDims, true, BUFFER_ALIGN);
+    SmallVector<int64_t, 4> inputMatrixShape = {
+        inputShape[0], group, channelsPerGroup, inputSize};
+    SmallVector<int64_t, 4> inputMatrixStrides(4, 1);
+    for (int64_t i = 2; i >= 0; --i)
+      inputMatrixStrides[i] =
+          inputMatrixStrides[i + 1] * inputMatrixShape[i + 1];
+    Value inputMatrices = rewriter.create<memref::ReinterpretCastOp>(loc,
+        MemRefType::get(inputMatrixShape, elementType), input, /*offset=*/0,
+        inputMatrixShape, inputMatrixStrides);
+
+    // 1) Pack the transposed weights.
+    SmallVector<int64_t, 6> weightLoopDims = {
+        group, channelsPerGroup, kernelsPerGroup};
+    weightLoopDims.append(kernelSpatialShape.begin(), kernelSpatialShape.end());
+    SmallVector<IndexExpr, 6> weightLbs(weightLoopDims.size(), zero);
+    ValueRange weightLoops = krnl_define_loop(weightLoopDims.size());
+    krnl_iterate_ie(weightLoops, weightLbs, getUbs(weightLoopDims), {},
+        [&](ValueRange args) {
+          IndexExprScope innerScope;
+          ValueRange ivs = krnl_get_induction_var_value(weightLoops);
+          DimIndexExpr g(ivs[0]), c(ivs[1]), m(ivs[2]);
+          SmallVector<IndexExpr, 4> kernelIndices = {
+              g * channelsPerGroup + c, m};
+          SmallVector<IndexExpr, 4> kIndices;
+          for (int64_t i = 0; i < nSpatialDims; ++i)
+            kIndices.emplace_back(DimIndexExpr(ivs[3 + i]));
+          kernelIndices.append(kIndices.begin(), kIndices.end());
+          SmallVector<IndexExpr, 3> weightIndices = {
+              g, m * kernelSize + linearize(kIndices, kernelSpatialShape), c};
+          krnl_store(krnl_load(kernel, kernelIndices), weights, weightIndices);
+        });
+
+    // Images are processed one at a time, which bounds the size of the
+    // columns. In the loops through output channels, the largest of the group
+    // and channel loops is parallel.
+    int64_t parallelLoop = (group > kernelsPerGroup) ? 0 : 1;
+    ValueRange batchLoop = krnl_define_loop(1);
+    krnl_iterate_ie(batchLoop, {zero}, {LiteralIndexExpr(inputShape[0])}, {},
+        [&](ValueRange args) {
+          Value n = krnl_get_induction_var_value(batchLoop)[0];
+
+          // 2) Compute the columns, accumulated into zero.
+          ValueRange zeroLoops = krnl_define_loop(3);
+          krnl_parallel(zeroLoops[(group > columnSize) ? 0 : 1]);
+          krnl_iterate_ie(zeroLoops, {zero, zero, zero},
+              {LiteralIndexExpr(group), I, J}, {}, [&](ValueRange args) {
+                ValueRange ivs = krnl_get_induction_var_value(zeroLoops);
+                krnl_store(accZeroVal, columns, ivs);
+              });
+
+          ValueRange groupLoop = krnl_define_loop(1);
+          krnl_iterate_ie(groupLoop, {zero}, {LiteralIndexExpr(group)}, {},
+              [&](ValueRange args) {
+                Value g = krnl_get_induction_var_value(groupLoop)[0];
+                emitTiledMatMul(weights, {g}, inputMatrices, {n, g}, columns,
+                    {g}, I, J, K, accZeroVal, tileSizes);
+              });
+
+          // 3) Scatter the columns into the sums of the output positions.
+          SmallVector<IndexExpr, 6> sumLbs(sumShape.size(), zero);
+          ValueRange initLoops = krnl_define_loop(sumShape.size());
+          krnl_parallel(initLoops[parallelLoop]);
+          krnl_iterate_ie(initLoops, sumLbs, getUbs(sumShape), {},
+              [&](ValueRange args) {
+                ValueRange ivs = krnl_get_induction_var_value(initLoops);
+                krnl_store(accZeroVal, sums, ivs);
+              });
+
+          SmallVector<int64_t, 8> scatterLoopDims = {group, kernelsPerGroup};
+          scatterLoopDims.append(
+              kernelSpatialShape.begin(), kernelSpatialShape.end());
+          scatterLoopDims.append(
+              inputSpatialShape.begin(), inputSpatialShape.end());
+          SmallVector<IndexExpr, 8> scatterLbs(scatterLoopDims.size(), zero);
+          ValueRange scatterLoops = krnl_define_loop(scatterLoopDims.size());
+          krnl_parallel(scatterLoops[parallelLoop]);
+          krnl_iterate_ie(scatterLoops, scatterLbs, getUbs(scatterLoopDims),
+              {}, [&](ValueRange args) {
+                IndexExprScope innerScope;
+                ValueRange ivs = krnl_get_induction_var_value(scatterLoops);
+                DimIndexExpr g(ivs[0]), m(ivs[1]);
+                SmallVector<IndexExpr, 4> kIndices, hIndices;
+                for (int64_t i = 0; i < nSpatialDims; ++i) {
+                  kIndices.emplace_back(DimIndexExpr(ivs[2 + i]));
+                  hIndices.emplace_back(
+                      DimIndexExpr(ivs[2 + nSpatialDims + i]));
+                }
+                SmallVector<IndexExpr, 3> columnIndices = {g,
+                    m * kernelSize + linearize(kIndices, kernelSpatialShape),
+                    linearize(hIndices, inputSpatialShape)};
+                Value val = krnl_load(columns, columnIndices);
+                // The columns scattered out of the result, into its padding,
+                // add zero to a valid position of the same channel instead.
+                SmallVector<IndexExpr, 6> sumIndices = {g, m};
+                IndexExpr inBounds = PredicateIndexExpr(true);
+                for (int64_t i = 0; i < nSpatialDims; ++i) {
+                  int64_t dilation = dilations.empty() ? 1 : dilations[i];
+                  IndexExpr r = hIndices[i] * strides[i] +
+                                kIndices[i] * dilation - pads[i];
+                  IndexExpr valid = (r >= 0) & (r < resultSpatialShape[i]);
+                  inBounds = inBounds & valid;
+                  sumIndices.emplace_back(IndexExpr::select(valid, r, 0));
+                }
+                val = rewriter.create<SelectOp>(
+                    loc, inBounds.getValue(), val, accZeroVal);
+                Value sum = krnl_load(sums, sumIndices);
+                krnl_store(std_addf(sum, val), sums, sumIndices);
+              });
+
+          // 4) Copy the sums to the result, adding the bias.
+          ValueRange resultLoops = krnl_define_loop(sumShape.size());
+          krnl_parallel(resultLoops[parallelLoop]);
+          krnl_iterate_ie(resultLoops, sumLbs, getUbs(sumShape), {},
+              [&](ValueRange args) {
+                IndexExprScope innerScope;
+                ValueRange ivs = krnl_get_induction_var_value(resultLoops);
+                DimIndexExpr g(ivs[0]), m(ivs[1]);
+                IndexExpr kernelIndex = g * kernelsPerGroup + m;
+                Value res = krnl_load(sums, ivs);
+                if (hasBias) {
+                  SmallVector<IndexExpr, 1> biasIndices = {kernelIndex};
+                  Value b = krnl_load(bias, biasIndices);
+                  if (accType != elementType)
+                    b = rewriter.create<FPExtOp>(loc, accType, b);
+                  res = std_addf(res, b);
+                }
+                if (accType != elementType)
+                  res = rewriter.create<FPTruncOp>(loc, elementType, res);
+                res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
+                SmallVector<IndexExpr, 6> resultIndices = {
+                    DimIndexExpr(n), kernelIndex};
+                for (int64_t i = 0; i < nSpatialDims; ++i)
+                  resultIndices.emplace_back(DimIndexExpr(ivs[2 + i]));
+                krnl_store(res, alloc, resultIndices);
+              });
+        });
+  }
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    auto loc = op->getLoc();
+    ONNXConvTransposeOpAdaptor operandAdaptor(operands);
+    ONNXConvTransposeOp convOp = llvm::dyn_cast<ONNXConvTransposeOp>(op);
+
+    // The matrices are packed for static shapes only.
+    auto isStatic = [](Value val) {
+      return val.getType().isa<NoneType>() ||
+             hasAllConstantDimensions(val.getType().cast<MemRefType>());
+    };
+    auto memRefType = convertToMemRefType(*op->result_type_begin());
+    if (!isStatic(operandAdaptor.X()) || !isStatic(operandAdaptor.W()) ||
+        !isStatic(operandAdaptor.B()) || !hasAllConstantDimensions(memRefType))
+      return failure();
+
+    // Read the dilations, pads and strides attributes, set by the shape
+    // inference.
+    SmallVector<int64_t, 4> dilations, pads, strides;
+    if (convOp.dilationsAttr())
+      for (Attribute dilation : convOp.dilationsAttr().getValue())
+        dilations.emplace_back(dilation.cast<IntegerAttr>().getInt());
+    for (Attribute pad : convOp.padsAttr().getValue())
+      pads.emplace_back(pad.cast<IntegerAttr>().getInt());
+    for (Attribute stride : convOp.stridesAttr().getValue())
+      strides.emplace_back(stride.cast<IntegerAttr>().getInt());
+
+    // Scope for krnl EDSC ops
+    using namespace mlir::edsc;
+    ScopedContext scope(rewriter, loc);
+    // Scope for IndexExpr.
+    IndexExprScope ieScope(&rewriter, loc);
+
+    // Insert an allocation and deallocation for the result of this operation.
+    // The result of the store epilogue op, if any, is stored instead.
+    Operation *epilogueOp =
+        fuseStoreEpilogues ? getStoreEpilogueOp(op) : nullptr;
+    bool insertDealloc = checkInsertDealloc(epilogueOp ? epilogueOp : op);
+    Value alloc =
+        insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+
+    col2imConvTranspose(convOp, operandAdaptor, alloc, pads, strides,
+        dilations, epilogueOp, rewriter, loc);
+    replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXConvTransposeOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes,
+    bool fuseStoreEpilogues) {
+  patterns.insert<ONNXConvTransposeOpLowering>(
+      ctx, tileSizes, fuseStoreEpilogues);
+}
@@ -13,9 +13,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+#include "mlir/Dialect/Vector/VectorOps.h"
 
 using namespace mlir;
 
+// Size in bytes of the vectors computing the layer and instance
+// normalizations.
+static const int64_t layerNormVectorBytes = 32;
+
 struct ONNXBatchNormalizationTestModeOpLowering : public ConversionPattern {
   ONNXBatchNormalizationTestModeOpLowering(MLIRContext *ctx)
       : ConversionPattern(
@@ -136,7 +142,365 @@ struct ONNXBatchNormalizationTestModeOpLowering : public ConversionPattern {
   }
 };
 
+struct ONNXFusedLayerNormOpLowering : public ConversionPattern {
+  ONNXFusedLayerNormOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXFusedLayerNormOp::getOperationName(), 1, ctx) {}
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    // layernorm{epsilon}(x, scale, bias) =
+    //      scale * (x - mean) / sqrt(variance + epsilon) + bias
+    // with the mean and the variance of each row, along the last dimension.
+    using namespace mlir::edsc;
+    ONNXFusedLayerNormOpAdaptor operandAdaptor(operands);
+    ONNXFusedLayerNormOp layerNormOp = llvm::cast<ONNXFusedLayerNormOp>(op);
+    Location loc = op->getLoc();
+    Value operand = operandAdaptor.X();
+    Value scale = operandAdaptor.Scale();
+    Value bias = operandAdaptor.B();
+
+    MemRefType memRefType = convertToMemRefType(*op->result_type_begin());
+    Type elementType = memRefType.getElementType();
+    int64_t rank = memRefType.getRank();
+    int64_t rowSize = memRefType.getShape()[rank - 1];
+
+    // Insert an allocation and deallocation for the result of this operation.
+    Value alloc;
+    bool insertDealloc = checkInsertDealloc(op);
+    if (hasAllConstantDimensions(memRefType))
+      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+    else
+      alloc = insertAllocAndDealloc(
+          memRefType, loc, rewriter, insertDealloc, {operand});
+
+    // The rows are computed on vectors when they hold whole vectors.
+    int64_t vectorLen =
+        layerNormVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+    if (rowSize <= 0 || rowSize % vectorLen != 0 ||
+        !operand.getType().cast<MemRefType>().getAffineMaps().empty() ||
+        !memRefType.getAffineMaps().empty())
+      vectorLen = 1;
+
+    ScopedContext scope(rewriter, loc);
+    Type accType = elementType;
+    Value operandView = operand, allocView = alloc;
+    Value scaleView = scale, biasView = bias;
+    if (vectorLen > 1) {
+      accType = VectorType::get({vectorLen}, elementType);
+      operandView = krnl_vector_type_cast(operand, vectorLen);
+      allocView = krnl_vector_type_cast(alloc, vectorLen);
+      scaleView = krnl_vector_type_cast(scale, vectorLen);
+      biasView = krnl_vector_type_cast(bias, vectorLen);
+    }
+    auto splat = [&](Value scalar) -> Value {
+      if (vectorLen == 1)
+        return scalar;
+      return rewriter.create<SplatOp>(loc, accType, scalar);
+    };
+    auto laneSum = [&](Value val) -> Value {
+      if (vectorLen == 1)
+        return val;
+      return rewriter.create<vector::ReductionOp>(loc, elementType,
+          rewriter.getStringAttr("add"), val, ValueRange{});
+    };
+    Value zero = emitConstantOp(rewriter, loc, accType, 0);
+    Value one = emitConstantOp(rewriter, loc, elementType, 1);
+    Value epsilon = emitConstantOp(rewriter, loc, elementType,
+        layerNormOp.epsilon().convertToFloat());
+
+    MemRefBoundsCapture bounds(operandView);
+    SmallVector<Value, 4> rowLbs, rowUbs;
+    for (int64_t i = 0; i < rank - 1; ++i) {
+      rowLbs.emplace_back(bounds.lb(i));
+      rowUbs.emplace_back(bounds.ub(i));
+    }
+
+    auto emitRowLayerNorm = [&](ValueRange rowIndices) {
+      auto getIndices = [&](Value iv) {
+        SmallVector<Value, 4> indices(rowIndices.begin(), rowIndices.end());
+        indices.emplace_back(iv);
+        return indices;
+      };
+      SmallVector<Value, 1> scalarAccess; // Empty.
+      MemRefType accMemRefType = MemRefType::get({}, accType);
+      Value meanAcc = rewriter.create<memref::AllocaOp>(loc, accMemRefType);
+      Value m2Acc = rewriter.create<memref::AllocaOp>(loc, accMemRefType);
+      krnl_store(zero, meanAcc, scalarAccess);
+      krnl_store(zero, m2Acc, scalarAccess);
+
+      // 1. Compute the mean and the sum of the squared deviations of each
+      // lane in a single pass (Welford): at the k-th element,
+      //   delta = x - mean, mean += delta / k, m2 += delta * (x - mean).
+      ValueRange statLoop = krnl_define_loop(1);
+      krnl_iterate(statLoop, {bounds.lb(rank - 1)}, {bounds.ub(rank - 1)}, {},
+          [&](ValueRange args) {
+            Value iv = krnl_get_induction_var_value(statLoop)[0];
+            Value count = rewriter.create<AddIOp>(
+                loc, iv, emitConstantOp(rewriter, loc, iv.getType(), 1));
+            count = rewriter.create<IndexCastOp>(
+                loc, count, rewriter.getIntegerType(64));
+            count = rewriter.create<SIToFPOp>(loc, count, elementType);
+            Value x = krnl_load(operandView, getIndices(iv));
+            Value mean = krnl_load(meanAcc, scalarAccess);
+            Value delta = rewriter.create<SubFOp>(loc, x, mean);
+            mean = rewriter.create<AddFOp>(
+                loc, mean, rewriter.create<DivFOp>(loc, delta, splat(count)));
+            Value m2 = rewriter.create<AddFOp>(loc,
+                krnl_load(m2Acc, scalarAccess),
+                rewriter.create<MulFOp>(
+                    loc, delta, rewriter.create<SubFOp>(loc, x, mean)));
+            krnl_store(mean, meanAcc, scalarAccess);
+            krnl_store(m2, m2Acc, scalarAccess);
+          });
+
+      // Combine the lanes, which all hold rowSize / vectorLen elements:
+      //   mean = sum(mean_l) / vectorLen,
+      //   m2 = sum(m2_l + (rowSize / vectorLen) * (mean_l - mean)^2).
+      Value laneMean = krnl_load(meanAcc, scalarAccess);
+      Value laneM2 = krnl_load(m2Acc, scalarAccess);
+      Value rowMean = laneSum(laneMean);
+      Value rowM2 = laneM2;
+      if (vectorLen > 1) {
+        rowMean = rewriter.create<DivFOp>(loc, rowMean,
+            emitConstantOp(rewriter, loc, elementType, vectorLen));
+        Value diff = rewriter.create<SubFOp>(loc, laneMean, splat(rowMean));
+        Value laneCount =
+            emitConstantOp(rewriter, loc, accType, rowSize / vectorLen);
+        rowM2 = rewriter.create<AddFOp>(loc, laneM2,
+            rewriter.create<MulFOp>(loc, laneCount,
+                rewriter.create<MulFOp>(loc, diff, diff)));
+      }
+      rowM2 = laneSum(rowM2);
+      Value rowCount;
+      if (rowSize > 0)
+        rowCount = emitConstantOp(rewriter, loc, elementType, rowSize);
+      else
+        rowCount = rewriter.create<SIToFPOp>(loc,
+            rewriter.create<IndexCastOp>(
+                loc, bounds.ub(rank - 1), rewriter.getIntegerType(64)),
+            elementType);
+      Value variance = rewriter.create<DivFOp>(loc, rowM2, rowCount);
+      Value invStdDev = rewriter.create<DivFOp>(loc, one,
+          rewriter.create<math::SqrtOp>(
+              loc, rewriter.create<AddFOp>(loc, variance, epsilon)));
+      Value rowMeanVec = splat(rowMean);
+      Value invStdDevVec = splat(invStdDev);
+
+      // 2. Normalize.
+      ValueRange normLoop = krnl_define_loop(1);
+      krnl_iterate(normLoop, {bounds.lb(rank - 1)}, {bounds.ub(rank - 1)}, {},
+          [&](ValueRange args) {
+            Value iv = krnl_get_induction_var_value(normLoop)[0];
+            SmallVector<Value, 4> indices = getIndices(iv);
+            Value x = krnl_load(operandView, indices);
+            Value factor = rewriter.create<MulFOp>(
+                loc, invStdDevVec, krnl_load(scaleView, iv));
+            Value y = rewriter.create<MulFOp>(
+                loc, rewriter.create<SubFOp>(loc, x, rowMeanVec), factor);
+            y = rewriter.create<AddFOp>(loc, y, krnl_load(biasView, iv));
+            krnl_store(y, allocView, indices);
+          });
+    };
+
+    // The rows are normalized in parallel.
+    if (rank == 1) {
+      emitRowLayerNorm({});
+    } else {
+      ValueRange rowLoops = krnl_define_loop(rank - 1);
+      for (int64_t i = 0; i < rank - 1; ++i)
+        if (memRefType.getShape()[i] != 1) {
+          krnl_parallel(rowLoops[i]);
+          break;
+        }
+      krnl_iterate(rowLoops, rowLbs, rowUbs, {}, [&](ValueRange args) {
+        emitRowLayerNorm(krnl_get_induction_var_value(rowLoops));
+      });
+    }
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+struct ONNXInstanceNormalizationOpLowering : public ConversionPattern {
+  ONNXInstanceNormalizationOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXInstanceNormalizationOp::getOperationName(), 1, ctx) {}
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    // instancenorm{epsilon}(x, scale, B) =
+    //      scale[c] * (x - mean) / sqrt(variance + epsilon) + B[c]
+    // with the mean and the variance of each [n, c] slab of x, i.e. over all
+    // the spatial dimensions.
+    using namespace mlir::edsc;
+    ONNXInstanceNormalizationOpAdaptor operandAdaptor(operands);
+    ONNXInstanceNormalizationOp instanceNormOp =
+        llvm::cast<ONNXInstanceNormalizationOp>(op);
+    Location loc = op->getLoc();
+    Value operand = operandAdaptor.input();
+    Value scale = operandAdaptor.scale();
+    Value bias = operandAdaptor.B();
+
+    MemRefType memRefType = convertToMemRefType(*op->result_type_begin());
+    Type elementType = memRefType.getElementType();
+    int64_t rank = memRefType.getRank();
+    if (rank < 3)
+      return failure();
+    int64_t innerSize = memRefType.getShape()[rank - 1];
+
+    // Insert an allocation and deallocation for the result of this operation.
+    Value alloc;
+    bool insertDealloc = checkInsertDealloc(op);
+    if (hasAllConstantDimensions(memRefType))
+      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+    else
+      alloc = insertAllocAndDealloc(
+          memRefType, loc, rewriter, insertDealloc, {operand});
+
+    // The slabs are computed on vectors when their innermost dimension holds
+    // whole vectors.
+    int64_t vectorLen =
+        layerNormVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+    if (innerSize <= 0 || innerSize % vectorLen != 0 ||
+        !operand.getType().cast<MemRefType>().getAffineMaps().empty() ||
+        !memRefType.getAffineMaps().empty())
+      vectorLen = 1;
+
+    ScopedContext scope(rewriter, loc);
+    Type accType = elementType;
+    Value operandView = operand, allocView = alloc;
+    if (vectorLen > 1) {
+      accType = VectorType::get({vectorLen}, elementType);
+      operandView = krnl_vector_type_cast(operand, vectorLen);
+      allocView = krnl_vector_type_cast(alloc, vectorLen);
+    }
+    auto splat = [&](Value scalar) -> Value {
+      if (vectorLen == 1)
+        return scalar;
+      return rewriter.create<SplatOp>(loc, accType, scalar);
+    };
+    auto laneSum = [&](Value val) -> Value {
+      if (vectorLen == 1)
+        return val;
+      return rewriter.create<vector::ReductionOp>(loc, elementType,
+          rewriter.getStringAttr("add"), val, ValueRange{});
+    };
+    Value zero = emitConstantOp(rewriter, loc, accType, 0);
+    Value scalarZero = emitConstantOp(rewriter, loc, elementType, 0);
+    Value one = emitConstantOp(rewriter, loc, elementType, 1);
+    Value epsilon = emitConstantOp(rewriter, loc, elementType,
+        instanceNormOp.epsilon().convertToFloat());
+
+    MemRefBoundsCapture bounds(operandView);
+    SmallVector<Value, 4> spatialLbs, spatialUbs;
+    for (int64_t i = 2; i < rank; ++i) {
+      spatialLbs.emplace_back(bounds.lb(i));
+      spatialUbs.emplace_back(bounds.ub(i));
+    }
+
+    auto emitSlabInstanceNorm = [&](ValueRange slabIndices) {
+      auto getIndices = [&](ValueRange spatialIndices) {
+        SmallVector<Value, 4> indices(slabIndices.begin(), slabIndices.end());
+        indices.append(spatialIndices.begin(), spatialIndices.end());
+        return indices;
+      };
+      SmallVector<Value, 1> scalarAccess; // Empty.
+      MemRefType accMemRefType = MemRefType::get({}, accType);
+      Value meanAcc = rewriter.create<memref::AllocaOp>(loc, accMemRefType);
+      Value m2Acc = rewriter.create<memref::AllocaOp>(loc, accMemRefType);
+      Value countAcc = rewriter.create<memref::AllocaOp>(
+          loc, MemRefType::get({}, elementType));
+      krnl_store(zero, meanAcc, scalarAccess);
+      krnl_store(zero, m2Acc, scalarAccess);
+      krnl_store(scalarZero, countAcc, scalarAccess);
+
+      // 1. Compute the mean and the sum of the squared deviations of each
+      // lane in a single pass over the slab (Welford): at the k-th element,
+      //   delta = x - mean, mean += delta / k, m2 += delta * (x - mean).
+      ValueRange statLoops = krnl_define_loop(rank - 2);
+      krnl_iterate(statLoops, spatialLbs, spatialUbs, {}, [&](ValueRange args) {
+        ValueRange spatialIndices = krnl_get_induction_var_value(statLoops);
+        Value count = rewriter.create<AddFOp>(
+            loc, krnl_load(countAcc, scalarAccess), one);
+        krnl_store(count, countAcc, scalarAccess);
+        Value x = krnl_load(operandView, getIndices(spatialIndices));
+        Value mean = krnl_load(meanAcc, scalarAccess);
+        Value delta = rewriter.create<SubFOp>(loc, x, mean);
+        mean = rewriter.create<AddFOp>(
+            loc, mean, rewriter.create<DivFOp>(loc, delta, splat(count)));
+        Value m2 = rewriter.create<AddFOp>(loc, krnl_load(m2Acc, scalarAccess),
+            rewriter.create<MulFOp>(
+                loc, delta, rewriter.create<SubFOp>(loc, x, mean)));
+        krnl_store(mean, meanAcc, scalarAccess);
+        krnl_store(m2, m2Acc, scalarAccess);
+      });
+
+      // Combine the lanes, which all hold count elements:
+      //   mean = sum(mean_l) / vectorLen,
+      //   m2 = sum(m2_l + count * (mean_l - mean)^2).
+      Value laneCount = krnl_load(countAcc, scalarAccess);
+      Value laneMean = krnl_load(meanAcc, scalarAccess);
+      Value laneM2 = krnl_load(m2Acc, scalarAccess);
+      Value slabMean = laneSum(laneMean);
+      Value slabM2 = laneM2;
+      Value slabCount = laneCount;
+      if (vectorLen > 1) {
+        Value lanes = emitConstantOp(rewriter, loc, elementType, vectorLen);
+        slabMean = rewriter.create<DivFOp>(loc, slabMean, lanes);
+        Value diff = rewriter.create<SubFOp>(loc, laneMean, splat(slabMean));
+        slabM2 = rewriter.create<AddFOp>(loc, laneM2,
+            rewriter.create<MulFOp>(loc, splat(laneCount),
+                rewriter.create<MulFOp>(loc, diff, diff)));
+        slabCount = rewriter.create<MulFOp>(loc, laneCount, lanes);
+      }
+      slabM2 = laneSum(slabM2);
+      Value variance = rewriter.create<DivFOp>(loc, slabM2, slabCount);
+      Value invStdDev = rewriter.create<DivFOp>(loc, one,
+          rewriter.create<math::SqrtOp>(
+              loc, rewriter.create<AddFOp>(loc, variance, epsilon)));
+
+      // y = x * factor + shift, with factor = scale[c] / stddev and
+      // shift = B[c] - mean * factor.
+      Value channel = slabIndices[1];
+      Value factor = rewriter.create<MulFOp>(
+          loc, invStdDev, krnl_load(scale, channel));
+      Value shift = rewriter.create<SubFOp>(loc, krnl_load(bias, channel),
+          rewriter.create<MulFOp>(loc, slabMean, factor));
+      Value factorVec = splat(factor);
+      Value shiftVec = splat(shift);
+
+      // 2. Normalize.
+      ValueRange normLoops = krnl_define_loop(rank - 2);
+      krnl_iterate(normLoops, spatialLbs, spatialUbs, {}, [&](ValueRange args) {
+        SmallVector<Value, 4> indices =
+            getIndices(krnl_get_induction_var_value(normLoops));
+        Value x = krnl_load(operandView, indices);
+        Value y = rewriter.create<AddFOp>(
+            loc, rewriter.create<MulFOp>(loc, x, factorVec), shiftVec);
+        krnl_store(y, allocView, indices);
+      });
+    };
+
+    // The [n, c] slabs are normalized in parallel.
+    ValueRange slabLoops = krnl_define_loop(2);
+    for (int64_t i = 0; i < 2; ++i)
+      if (memRefType.getShape()[i] != 1) {
+        krnl_parallel(slabLoops[i]);
+        break;
+      }
+    krnl_iterate(slabLoops, {bounds.lb(0), bounds.lb(1)},
+        {bounds.ub(0), bounds.ub(1)}, {}, [&](ValueRange args) {
+          emitSlabInstanceNorm(krnl_get_induction_var_value(slabLoops));
+        });
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
 void populateLoweringONNXNormalizationOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx) {
   patterns.insert<ONNXBatchNormalizationTestModeOpLowering>(ctx);
+  patterns.insert<ONNXFusedLayerNormOpLowering>(ctx);
+  patterns.insert<ONNXInstanceNormalizationOpLowering>(ctx);
 }
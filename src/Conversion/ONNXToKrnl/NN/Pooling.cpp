@@ -13,9 +13,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "mlir/Dialect/Vector/VectorOps.h"
 
 using namespace mlir;
 
+// Size in bytes of the vectors computing the pooling windows.
+static const int64_t poolingVectorBytes = 32;
+
 // Identity values
 template <>
 Value getIdentityValue<ONNXMaxPoolSingleOutOp>(
@@ -127,6 +131,168 @@ void postProcessPoolingWindow<ONNXAveragePoolOp>(
   rewriter.create<KrnlStoreOp>(loc, average, alloc, resultIndices);
 }
 
+//===----------------------------------------------------------------------===//
+// Helper function to do post-processing after applying a full filter window,
+// of the kernel size.
+//
+template <typename PoolOp>
+Value postProcessFullPoolingWindow(ConversionPatternRewriter &rewriter,
+    Location loc, Value window, int64_t kernelSize) {
+  return window;
+}
+
+// Calculate the average value for AveragePool, whatever count_include_pad.
+template <>
+Value postProcessFullPoolingWindow<ONNXAveragePoolOp>(
+    ConversionPatternRewriter &rewriter, Location loc, Value window,
+    int64_t kernelSize) {
+  Value scale =
+      emitConstantOp(rewriter, loc, window.getType(), 1.0 / kernelSize);
+  return rewriter.create<MulFOp>(loc, window, scale);
+}
+
+//===----------------------------------------------------------------------===//
+// Fast path for static pools without dilation.
+//
+// Compute the outputs whose window lies entirely within the input, which form
+// a box [interiorLbs, interiorUbs) along the spatial dimensions. All their
+// windows have the kernel size: the pooling loops have constant bounds and
+// the average divides by the kernel size. When the innermost stride is 1, a
+// vector of consecutive outputs along the innermost dimension reads vectors
+// of consecutive inputs, so the box is cut down to whole vectors along it.
+// The pools in the blocked layout NCHW[b]c have a window of 1 with a unit
+// stride along the b channels of the blocks, their innermost dimension, so
+// that they run on vectors of channels. The store epilogue op, if any, is
+// applied to the outputs. Return false, emitting nothing, when the box is
+// empty.
+template <typename PoolOp>
+bool emitInteriorPooling(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *op, Value input, Value alloc, Value identity,
+    ArrayRef<int64_t> kernelShape, ArrayRef<int64_t> pads,
+    ArrayRef<int64_t> strides, Operation *epilogueOp,
+    SmallVectorImpl<int64_t> &interiorLbs,
+    SmallVectorImpl<int64_t> &interiorUbs) {
+  using namespace mlir::edsc;
+
+  auto inputShape = input.getType().cast<MemRefType>().getShape();
+  auto memRefType = alloc.getType().cast<MemRefType>();
+  auto outputShape = memRefType.getShape();
+  Type elementType = memRefType.getElementType();
+  int64_t rank = outputShape.size();
+  int64_t kernelRank = kernelShape.size();
+  int64_t kernelOffset = rank - kernelRank;
+
+  // The window of o lies within the input when o * s - pt >= 0 and
+  // o * s - pt + k <= I.
+  for (int64_t i = 0; i < kernelRank; ++i) {
+    int64_t outputDim = outputShape[kernelOffset + i];
+    int64_t lb =
+        std::min((pads[i] + strides[i] - 1) / strides[i], outputDim);
+    int64_t lastStart = inputShape[kernelOffset + i] + pads[i] - kernelShape[i];
+    int64_t ub =
+        (lastStart < 0) ? 0 : std::min(lastStart / strides[i] + 1, outputDim);
+    if (ub <= lb) {
+      interiorLbs.clear();
+      interiorUbs.clear();
+      return false;
+    }
+    interiorLbs.emplace_back(lb);
+    interiorUbs.emplace_back(ub);
+  }
+  int64_t vectorLen = 1;
+  if (strides[kernelRank - 1] == 1) {
+    int64_t width = interiorUbs.back() - interiorLbs.back();
+    vectorLen = poolingVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+    if (width < vectorLen)
+      vectorLen = 1;
+    interiorUbs.back() = interiorLbs.back() + width / vectorLen * vectorLen;
+  }
+  int64_t kernelSize = 1;
+  for (int64_t k : kernelShape)
+    kernelSize *= k;
+
+  Type accType = elementType;
+  Value accIdentity = identity;
+  if (vectorLen > 1) {
+    accType = VectorType::get({vectorLen}, elementType);
+    accIdentity = rewriter.create<SplatOp>(loc, accType, identity);
+  }
+
+  // Loops over the batch and channel dimensions, then over the box, the
+  // innermost dimension by vectors. The first loop with more than one
+  // iteration is parallel.
+  SmallVector<int64_t, 4> loopUbs(
+      outputShape.begin(), outputShape.begin() + kernelOffset);
+  SmallVector<int64_t, 4> loopLbs(kernelOffset, 0);
+  for (int64_t i = 0; i < kernelRank; ++i) {
+    loopLbs.emplace_back(interiorLbs[i]);
+    loopUbs.emplace_back(interiorUbs[i]);
+  }
+  loopLbs.back() = 0;
+  loopUbs.back() = (interiorUbs.back() - interiorLbs.back()) / vectorLen;
+  SmallVector<IndexExpr, 4> lbs, ubs;
+  for (int64_t i = 0; i < rank; ++i) {
+    lbs.emplace_back(LiteralIndexExpr(loopLbs[i]));
+    ubs.emplace_back(LiteralIndexExpr(loopUbs[i]));
+  }
+  SmallVector<IndexExpr, 4> kLbs, kUbs;
+  for (int64_t i = 0; i < kernelRank; ++i) {
+    kLbs.emplace_back(LiteralIndexExpr(0));
+    kUbs.emplace_back(LiteralIndexExpr(kernelShape[i]));
+  }
+
+  ValueRange outputLoops = krnl_define_loop(rank);
+  for (int64_t i = 0; i < rank; ++i)
+    if (loopUbs[i] - loopLbs[i] > 1) {
+      krnl_parallel(outputLoops[i]);
+      break;
+    }
+  krnl_iterate_ie(outputLoops, lbs, ubs, {}, [&](ValueRange args) {
+    IndexExprScope outputScope;
+    ValueRange outputIVs = krnl_get_induction_var_value(outputLoops);
+    SmallVector<Value, 4> outputIndices(outputIVs.begin(), outputIVs.end());
+    // wo = v * vectorLen + firstW.
+    outputIndices.back() = (DimIndexExpr(outputIVs.back()) * vectorLen +
+                            interiorLbs.back())
+                               .getValue();
+
+    SmallVector<Value, 1> scalarAccess; // Empty.
+    Value acc =
+        rewriter.create<memref::AllocaOp>(loc, MemRefType::get({}, accType));
+    krnl_store(accIdentity, acc, scalarAccess);
+    ValueRange windowLoops = krnl_define_loop(kernelRank);
+    krnl_iterate_ie(windowLoops, kLbs, kUbs, {}, [&](ValueRange args) {
+      ValueRange windowIVs = krnl_get_induction_var_value(windowLoops);
+      // hi = ho * sH - ptH + kh
+      SmallVector<Value, 4> inputIndices(
+          outputIndices.begin(), outputIndices.begin() + kernelOffset);
+      for (int64_t i = 0; i < kernelRank; ++i)
+        inputIndices.emplace_back(
+            (DimIndexExpr(outputIndices[kernelOffset + i]) * strides[i] +
+                DimIndexExpr(windowIVs[i]) - pads[i])
+                .getValue());
+      Value next;
+      if (vectorLen > 1)
+        next = rewriter.create<vector::TransferReadOp>(
+            loc, accType.cast<VectorType>(), input, inputIndices);
+      else
+        next = krnl_load(input, inputIndices);
+      Value accVal = krnl_load(acc, scalarAccess);
+      krnl_store(emitScalarOpFor<PoolOp>(
+                     rewriter, loc, op, accType, {accVal, next}),
+          acc, scalarAccess);
+    });
+    Value res = postProcessFullPoolingWindow<PoolOp>(
+        rewriter, loc, krnl_load(acc, scalarAccess), kernelSize);
+    res = emitStoreEpilogue(rewriter, loc, epilogueOp, res);
+    if (vectorLen > 1)
+      rewriter.create<vector::TransferWriteOp>(loc, res, alloc, outputIndices);
+    else
+      krnl_store(res, alloc, outputIndices);
+  });
+  return true;
+}
+
 //===----------------------------------------------------------------------===//
 // Helper function to insert alloc and dealloc ops for memref of dynamic shape.
 //
@@ -190,8 +356,12 @@ Value insertAllocAndDeallocForPooling(ConversionPatternRewriter &rewriter,
 //
 template <typename PoolOp>
 struct ONNXPoolOpLowering : public ConversionPattern {
-  ONNXPoolOpLowering(MLIRContext *ctx)
-      : ConversionPattern(PoolOp::getOperationName(), 1, ctx) {}
+  bool fuseStoreEpilogues = false;
+
+  ONNXPoolOpLowering(MLIRContext *ctx, bool fuseStoreEpilogues = false)
+      : ConversionPattern(PoolOp::getOperationName(), 1, ctx) {
+    this->fuseStoreEpilogues = fuseStoreEpilogues;
+  }
 
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
@@ -242,8 +412,11 @@ struct ONNXPoolOpLowering : public ConversionPattern {
     IndexExprScope ieScope(&rewriter, loc);
 
     // Insert an allocation and deallocation for the output of this operation.
+    // The result of the store epilogue op, if any, is stored instead.
     Value alloc;
-    bool insertDealloc = checkInsertDealloc(op);
+    Operation *epilogueOp =
+        fuseStoreEpilogues ? getStoreEpilogueOp(op) : nullptr;
+    bool insertDealloc = checkInsertDealloc(epilogueOp ? epilogueOp : op);
 
     if (hasAllConstantDimensions(memRefType))
       alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
@@ -334,183 +507,239 @@ struct ONNXPoolOpLowering : public ConversionPattern {
     // Identity value of the operation.
     auto identity = getIdentityValue<PoolOp>(rewriter, loc, outputElementType);
 
-    // 1. Define output loops to compute one output pixel.
-    // for n in range(N):
-    //   for c in range(C):
-    //     for ho in range(HO):
-    //       for wo in range(WO):
-    BuildKrnlLoop outputLoops(rewriter, loc, outputShape.size());
-    outputLoops.createDefineAndIterateOp(alloc);
-
-    auto ipMainRegion = rewriter.saveInsertionPoint();
-    rewriter.setInsertionPointToStart(outputLoops.getIterateBlock());
-    {
-      // 2. Emit the body of the output loop nest, which applies a pooling
-      // window to a region in the input, producing one output pixel.
-      SmallVector<IndexExpr, 4> outputIndices;
-      for (int i = 0; i < outputShape.size(); ++i)
-        outputIndices.emplace_back(
-            DimIndexExpr(outputLoops.getInductionVar(i)));
-
-      // 2.1 Emit: output[n][c][ho][wo] = identity
-      // Create a local reduction value for output[n][c][ho][wo].
-      Value reductionVal = rewriter.create<memref::AllocaOp>(
-          loc, MemRefType::get({}, memRefType.getElementType()));
-      rewriter.create<KrnlStoreOp>(
-          loc, identity, reductionVal, ArrayRef<Value>{});
-
-      // 2.2 Emit affine maps which express the lower and upper bounds for the
-      // pooling window's dimensions.
-      // The pooling window can be smaller than the kernel when slicing it over
-      // the border edges. Thus, we will compute the start and end indices for
-      // each dimension as follows.
-      //   firstValidH = ceil(float(ptH / dH)) * dH - ptH
-      //   startH = max(firstValidH, ho * sH - ptH)
-      //   endH = min(H, ho * sH + (kH - 1) * dH  + 1 - pbH)
-      //   hDim = round(float(endH - startH) / float(dH))
-
-      // Prepare induction variables.
-      SmallVector<SmallVector<IndexExpr, 4>, 4> IVExprs;
-      {
-        MemRefBoundsIndexCapture inputBounds(inputOperand);
-        for (int i = 0; i < kernelShape.size(); ++i) {
-          int j = i + kernelOffset;
-          SmallVector<IndexExpr, 4> ic;
-          // d0, output
-          ic.emplace_back(outputIndices[j]);
-          // s0, input dim
-          ic.emplace_back(inputBounds.getDim(j));
-          // s1, kernel dim
-          ic.emplace_back(LiteralIndexExpr(kernelShape[i]));
-          // s2, pad dim
-          ic.emplace_back(LiteralIndexExpr(pads[i]));
-          // s3, stride dim
-          ic.emplace_back(LiteralIndexExpr(strides[i]));
-          // s4, dilation dim
-          ic.emplace_back(LiteralIndexExpr((isDilated) ? dilations[i] : 1));
-          IVExprs.emplace_back(ic);
-        }
-      }
-
-      // Compute the start and end position of the conv window.
-      //   firstValidH = ceil(float(ptH / dH)) * dH - ptH
-      //   startH = max(firstValidH, ho * sH - ptH)
-      //   endH = min(H, ho * sH + (kH - 1) * dH  + 1 - pbH)
-      SmallVector<IndexExpr, 4> windowStartExprs, windowEndExprs;
-      for (int i = 0; i < kernelShape.size(); ++i) {
-        std::vector<mlir::IndexExpr> exprs =
-            getIndexExprsForConvWindow(IVExprs[i], ceilMode, isDilated);
-        windowStartExprs.emplace_back(exprs[0]);
-        windowEndExprs.emplace_back(exprs[1]);
+    auto emitPoolingLoops = [&](ArrayRef<int64_t> lbs,
+                                ArrayRef<int64_t> ubs) {
+      // 1. Define output loops to compute one output pixel, over the given
+      // ranges of the output if any, over the whole output otherwise.
+      // for n in range(N):
+      //   for c in range(C):
+      //     for ho in range(HO):
+      //       for wo in range(WO):
+      BuildKrnlLoop outputLoops(rewriter, loc, outputShape.size());
+      if (lbs.empty()) {
+        outputLoops.createDefineAndIterateOp(alloc);
+      } else {
+        outputLoops.createDefineOp();
+        for (int i = 0; i < outputShape.size(); ++i)
+          outputLoops.pushBounds(lbs[i], ubs[i]);
+        outputLoops.createIterateOp();
       }
 
-      // Compute the size of the full conv window.
-      //   hDim = round(float(endH - startH) / float(dH))
-      //   wDim = round(float(endW - startW) / float(dW))
-      SmallVector<Value, 4> fullWindowSize;
-      for (int i = 0; i < kernelShape.size(); ++i) {
-        Value dim = rewriter.create<SubIOp>(
-            loc, windowEndExprs[i].getValue(), windowStartExprs[i].getValue());
-        if (isDilated) {
-          Value one = emitConstantOp(rewriter, loc, rewriter.getIndexType(), 1);
-          Value numerator = rewriter.create<AddIOp>(loc, dim, one);
-          Value denominator = IVExprs[i][5].getValue(); // dilations[i]
-          dim = rewriter.create<SignedDivIOp>(loc, numerator, denominator);
-          if (ceilMode) {
-            auto remainder =
-                rewriter.create<SignedRemIOp>(loc, numerator, denominator);
-            Value zero =
-                emitConstantOp(rewriter, loc, rewriter.getIndexType(), 0);
-            auto isZero = rewriter.create<CmpIOp>(
-                loc, CmpIPredicate::eq, remainder, zero);
-            auto dimPlusOne = rewriter.create<AddIOp>(loc, dim, one);
-            dim = rewriter.create<SelectOp>(loc, isZero, dim, dimPlusOne);
+      auto ipMainRegion = rewriter.saveInsertionPoint();
+      rewriter.setInsertionPointToStart(outputLoops.getIterateBlock());
+      {
+        // 2. Emit the body of the output loop nest, which applies a pooling
+        // window to a region in the input, producing one output pixel.
+        SmallVector<IndexExpr, 4> outputIndices;
+        for (int i = 0; i < outputShape.size(); ++i)
+          outputIndices.emplace_back(
+              DimIndexExpr(outputLoops.getInductionVar(i)));
+
+        // 2.1 Emit: output[n][c][ho][wo] = identity
+        // Create a local reduction value for output[n][c][ho][wo].
+        Value reductionVal = rewriter.create<memref::AllocaOp>(
+            loc, MemRefType::get({}, memRefType.getElementType()));
+        rewriter.create<KrnlStoreOp>(
+            loc, identity, reductionVal, ArrayRef<Value>{});
+
+        // 2.2 Emit affine maps which express the lower and upper bounds for the
+        // pooling window's dimensions.
+        // The pooling window can be smaller than the kernel when slicing it
+        // over the border edges. Thus, we will compute the start and end
+        // indices for each dimension as follows.
+        //   firstValidH = ceil(float(ptH / dH)) * dH - ptH
+        //   startH = max(firstValidH, ho * sH - ptH)
+        //   endH = min(H, ho * sH + (kH - 1) * dH  + 1 - pbH)
+        //   hDim = round(float(endH - startH) / float(dH))
+
+        // Prepare induction variables.
+        SmallVector<SmallVector<IndexExpr, 4>, 4> IVExprs;
+        {
+          MemRefBoundsIndexCapture inputBounds(inputOperand);
+          for (int i = 0; i < kernelShape.size(); ++i) {
+            int j = i + kernelOffset;
+            SmallVector<IndexExpr, 4> ic;
+            // d0, output
+            ic.emplace_back(outputIndices[j]);
+            // s0, input dim
+            ic.emplace_back(inputBounds.getDim(j));
+            // s1, kernel dim
+            ic.emplace_back(LiteralIndexExpr(kernelShape[i]));
+            // s2, pad dim
+            ic.emplace_back(LiteralIndexExpr(pads[i]));
+            // s3, stride dim
+            ic.emplace_back(LiteralIndexExpr(strides[i]));
+            // s4, dilation dim
+            ic.emplace_back(LiteralIndexExpr((isDilated) ? dilations[i] : 1));
+            IVExprs.emplace_back(ic);
           }
         }
-        fullWindowSize.emplace_back(dim);
-      }
 
-      // 2.3 Define pooling loops.
-      //  for hp in range(hDim):
-      //    for wp in range(wDim):
-      //      hi = hp * dH + startH
-      //      wi = wp * dW + startW
-      //      output[n][c][ho][wo] =
-      //        emitScalarOpFor(output[n][c][ho][wo], input[n, c, hi, wi]);
-      BuildKrnlLoop poolingLoops(rewriter, loc, kernelShape.size());
-      poolingLoops.createDefineOp();
-      // Push bounds.
-      AffineMap windowSizeMap =
-          getWindowAffineMap(rewriter, ceilMode, isDilated);
-      for (int i = 0; i < kernelShape.size(); ++i) {
-        // Affine map's operands.
-        SmallVector<Value, 4> operands;
-        for (IndexExpr expr : IVExprs[i])
-          operands.emplace_back(expr.getValue());
-        poolingLoops.pushBounds(0, windowSizeMap, operands);
-      }
-      // Create a krnl iterate.
-      poolingLoops.createIterateOp();
+        // Compute the start and end position of the conv window.
+        //   firstValidH = ceil(float(ptH / dH)) * dH - ptH
+        //   startH = max(firstValidH, ho * sH - ptH)
+        //   endH = min(H, ho * sH + (kH - 1) * dH  + 1 - pbH)
+        SmallVector<IndexExpr, 4> windowStartExprs, windowEndExprs;
+        for (int i = 0; i < kernelShape.size(); ++i) {
+          std::vector<mlir::IndexExpr> exprs =
+              getIndexExprsForConvWindow(IVExprs[i], ceilMode, isDilated);
+          windowStartExprs.emplace_back(exprs[0]);
+          windowEndExprs.emplace_back(exprs[1]);
+        }
 
-      auto ipOuterLoopRegion = rewriter.saveInsertionPoint();
-      rewriter.setInsertionPointToStart(poolingLoops.getIterateBlock());
-      {
-        // 2.4 Emit the body of the pooling loop nest.
-        // Prepare indices to access a pixel in the input.
-        SmallVector<IndexExpr, 4> inputIndices;
-        { // Construct inputIndices
-          for (int i = 0; i < kernelOffset; ++i)
-            inputIndices.emplace_back(outputIndices[i]);
-          for (int i = kernelOffset; i < inputShape.size(); ++i) {
-            int j = i - kernelOffset;
-            DimIndexExpr hp(poolingLoops.getInductionVar(j));
-            IndexExpr startH = windowStartExprs[j];
-            if (isDilated) {
-              // hi = hp * dH + startH
-              IndexExpr dH = IVExprs[j][5];
-              inputIndices.emplace_back(hp * dH + startH);
-            } else {
-              // hi = hp + startH
-              inputIndices.emplace_back(hp + startH);
+        // Compute the size of the full conv window.
+        //   hDim = round(float(endH - startH) / float(dH))
+        //   wDim = round(float(endW - startW) / float(dW))
+        SmallVector<Value, 4> fullWindowSize;
+        for (int i = 0; i < kernelShape.size(); ++i) {
+          Value dim = rewriter.create<SubIOp>(loc,
+              windowEndExprs[i].getValue(), windowStartExprs[i].getValue());
+          if (isDilated) {
+            Value one =
+                emitConstantOp(rewriter, loc, rewriter.getIndexType(), 1);
+            Value numerator = rewriter.create<AddIOp>(loc, dim, one);
+            Value denominator = IVExprs[i][5].getValue(); // dilations[i]
+            dim = rewriter.create<SignedDivIOp>(loc, numerator, denominator);
+            if (ceilMode) {
+              auto remainder =
+                  rewriter.create<SignedRemIOp>(loc, numerator, denominator);
+              Value zero =
+                  emitConstantOp(rewriter, loc, rewriter.getIndexType(), 0);
+              auto isZero = rewriter.create<CmpIOp>(
+                  loc, CmpIPredicate::eq, remainder, zero);
+              auto dimPlusOne = rewriter.create<AddIOp>(loc, dim, one);
+              dim = rewriter.create<SelectOp>(loc, isZero, dim, dimPlusOne);
             }
           }
+          fullWindowSize.emplace_back(dim);
         }
 
-        // Apply pooling operation.
+        // 2.3 Define pooling loops.
+        //  for hp in range(hDim):
+        //    for wp in range(wDim):
+        //      hi = hp * dH + startH
+        //      wi = wp * dW + startW
         //      output[n][c][ho][wo] =
         //        emitScalarOpFor(output[n][c][ho][wo], input[n, c, hi, wi]);
-        Value loadInput = krnl_load(inputOperand, inputIndices);
-        Value loadPartialOutput =
+        BuildKrnlLoop poolingLoops(rewriter, loc, kernelShape.size());
+        poolingLoops.createDefineOp();
+        // Push bounds.
+        AffineMap windowSizeMap =
+            getWindowAffineMap(rewriter, ceilMode, isDilated);
+        for (int i = 0; i < kernelShape.size(); ++i) {
+          // Affine map's operands.
+          SmallVector<Value, 4> operands;
+          for (IndexExpr expr : IVExprs[i])
+            operands.emplace_back(expr.getValue());
+          poolingLoops.pushBounds(0, windowSizeMap, operands);
+        }
+        // Create a krnl iterate.
+        poolingLoops.createIterateOp();
+
+        auto ipOuterLoopRegion = rewriter.saveInsertionPoint();
+        rewriter.setInsertionPointToStart(poolingLoops.getIterateBlock());
+        {
+          // 2.4 Emit the body of the pooling loop nest.
+          // Prepare indices to access a pixel in the input.
+          SmallVector<IndexExpr, 4> inputIndices;
+          { // Construct inputIndices
+            for (int i = 0; i < kernelOffset; ++i)
+              inputIndices.emplace_back(outputIndices[i]);
+            for (int i = kernelOffset; i < inputShape.size(); ++i) {
+              int j = i - kernelOffset;
+              DimIndexExpr hp(poolingLoops.getInductionVar(j));
+              IndexExpr startH = windowStartExprs[j];
+              if (isDilated) {
+                // hi = hp * dH + startH
+                IndexExpr dH = IVExprs[j][5];
+                inputIndices.emplace_back(hp * dH + startH);
+              } else {
+                // hi = hp + startH
+                inputIndices.emplace_back(hp + startH);
+              }
+            }
+          }
+
+          // Apply pooling operation.
+          //      output[n][c][ho][wo] =
+          //        emitScalarOpFor(output[n][c][ho][wo], input[n, c, hi, wi]);
+          Value loadInput = krnl_load(inputOperand, inputIndices);
+          Value loadPartialOutput =
+              rewriter.create<KrnlLoadOp>(loc, reductionVal, ArrayRef<Value>{});
+          Value output = emitScalarOpFor<PoolOp>(rewriter, loc, op,
+              outputElementType, {loadPartialOutput, loadInput});
+          rewriter.create<KrnlStoreOp>(
+              loc, output, reductionVal, ArrayRef<Value>{});
+        }
+        rewriter.restoreInsertionPoint(ipOuterLoopRegion);
+        Value output =
             rewriter.create<KrnlLoadOp>(loc, reductionVal, ArrayRef<Value>{});
-        Value output = emitScalarOpFor<PoolOp>(rewriter, loc, op,
-            outputElementType, {loadPartialOutput, loadInput});
-        rewriter.create<KrnlStoreOp>(
-            loc, output, reductionVal, ArrayRef<Value>{});
+        krnl_store(output, alloc, outputIndices);
+
+        // 2.5 Post-processing for the pooling window, e.g. taking average.
+        SmallVector<Value, 4> outputIndicesInValue;
+        for (IndexExpr expr : outputIndices)
+          outputIndicesInValue.emplace_back(expr.getValue());
+        postProcessPoolingWindow<PoolOp>(rewriter, loc, poolOp, alloc,
+            outputIndicesInValue, kernelShape, fullWindowSize);
+
+        // 2.6 Apply the store epilogue op, if any, to the final value.
+        if (epilogueOp) {
+          Value res = krnl_load(alloc, outputIndices);
+          krnl_store(emitStoreEpilogue(rewriter, loc, epilogueOp, res), alloc,
+              outputIndices);
+        }
       }
-      rewriter.restoreInsertionPoint(ipOuterLoopRegion);
-      Value output =
-          rewriter.create<KrnlLoadOp>(loc, reductionVal, ArrayRef<Value>{});
-      krnl_store(output, alloc, outputIndices);
-
-      // 2.5 Post-processing for the pooling window, e.g. taking average.
-      SmallVector<Value, 4> outputIndicesInValue;
-      for (IndexExpr expr : outputIndices)
-        outputIndicesInValue.emplace_back(expr.getValue());
-      postProcessPoolingWindow<PoolOp>(rewriter, loc, poolOp, alloc,
-          outputIndicesInValue, kernelShape, fullWindowSize);
-    }
 
-    // Go back to the main region.
-    rewriter.restoreInsertionPoint(ipMainRegion);
+      // Go back to the main region.
+      rewriter.restoreInsertionPoint(ipMainRegion);
+    };
+
+    // Static pools without dilation compute the outputs whose window lies
+    // within the input by a fast path, leaving the outputs along the borders
+    // to the loop nest above. For each spatial dimension i, these are the
+    // outputs inside the fast path box along the spatial dimensions before i
+    // and outside of it along i.
+    SmallVector<int64_t, 4> interiorLbs, interiorUbs;
+    if (!isDilated &&
+        hasAllConstantDimensions(inputOperand.getType().cast<MemRefType>()) &&
+        hasAllConstantDimensions(memRefType) &&
+        outputElementType.isa<FloatType>() &&
+        emitInteriorPooling<PoolOp>(rewriter, loc, op, inputOperand, alloc,
+            identity, kernelShape, pads, strides, epilogueOp, interiorLbs,
+            interiorUbs)) {
+      int64_t rank = outputShape.size();
+      for (int64_t i = kernelOffset; i < rank; ++i) {
+        SmallVector<int64_t, 4> lbs(rank, 0);
+        SmallVector<int64_t, 4> ubs(outputShape.begin(), outputShape.end());
+        for (int64_t j = kernelOffset; j < i; ++j) {
+          lbs[j] = interiorLbs[j - kernelOffset];
+          ubs[j] = interiorUbs[j - kernelOffset];
+        }
+        if (interiorLbs[i - kernelOffset] > 0) {
+          ubs[i] = interiorLbs[i - kernelOffset];
+          emitPoolingLoops(lbs, ubs);
+        }
+        if (interiorUbs[i - kernelOffset] < outputShape[i]) {
+          lbs[i] = interiorUbs[i - kernelOffset];
+          ubs[i] = outputShape[i];
+          emitPoolingLoops(lbs, ubs);
+        }
+      }
+    } else {
+      emitPoolingLoops({}, {});
+    }
 
-    rewriter.replaceOp(op, alloc);
+    replaceOpWithStoreEpilogue(rewriter, op, epilogueOp, alloc);
 
     return success();
   }
 };
 
 void populateLoweringONNXPoolingOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx) {
-  patterns.insert<ONNXPoolOpLowering<ONNXMaxPoolSingleOutOp>>(ctx);
-  patterns.insert<ONNXPoolOpLowering<ONNXAveragePoolOp>>(ctx);
+    RewritePatternSet &patterns, MLIRContext *ctx, bool fuseStoreEpilogues) {
+  patterns.insert<ONNXPoolOpLowering<ONNXMaxPoolSingleOutOp>>(
+      ctx, fuseStoreEpilogues);
+  patterns.insert<ONNXPoolOpLowering<ONNXAveragePoolOp>>(
+      ctx, fuseStoreEpilogues);
 }
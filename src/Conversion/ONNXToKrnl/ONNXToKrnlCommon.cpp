@@ -13,8 +13,15 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/MemRef/EDSC/Intrinsics.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
 
+#define BUFFER_ALIGN 128
+
 /// Check if all operands are scalar values at compile time.
 bool hasAllScalarValues(ArrayRef<Value> values) {
   for (Value value : values) {
@@ -158,6 +165,135 @@ bool checkInsertDealloc(Operation *currentOp, int resultIndex) {
   return insertDealloc;
 }
 
+// Return the buffer of an operand of the current op that can hold the result
+// of the op. The operand must be the only use of a value computed by another
+// op of the same block, and must be lowered to a buffer allocated for that
+// value alone (ops such as Identity forward the buffer of their input).
+// Dynamic shapes are only handled for unary ops, since for several operands
+// the same type does not imply the same runtime shape under broadcasting.
+Value getInPlaceOperandBuffer(
+    Operation *currentOp, ArrayRef<Value> operands, MemRefType type) {
+  // The result buffer is freed with the operand buffer, so the result must
+  // not be returned by the function.
+  if (!checkInsertDealloc(currentOp))
+    return nullptr;
+
+  if (!hasAllConstantDimensions(type) && currentOp->getNumOperands() != 1)
+    return nullptr;
+
+  for (unsigned i = 0; i < currentOp->getNumOperands(); ++i) {
+    Value input = currentOp->getOperand(i);
+    Operation *inputOp = input.getDefiningOp();
+    if (!inputOp || !input.hasOneUse() || llvm::isa<ONNXIdentityOp>(inputOp))
+      continue;
+
+    auto alloc = operands[i].getDefiningOp<memref::AllocOp>();
+    if (!alloc || alloc.getType() != type ||
+        alloc.getOperation()->getBlock() != currentOp->getBlock())
+      continue;
+
+    return alloc.getResult();
+  }
+  return nullptr;
+}
+
+// Get the value of a bound of a Clip, which must be absent or a constant with
+// a single element.
+static bool getConstantClipBound(Value bound, Optional<double> &value) {
+  if (bound.getType().isa<NoneType>())
+    return true;
+  ONNXConstantOp constOp = getONNXConstantOp(bound);
+  if (!constOp)
+    return false;
+  DenseElementsAttr attr =
+      constOp.valueAttr().dyn_cast_or_null<DenseElementsAttr>();
+  if (!attr || attr.getNumElements() != 1)
+    return false;
+  Attribute element = *attr.getValues<Attribute>().begin();
+  if (auto floatAttr = element.dyn_cast<FloatAttr>())
+    value = floatAttr.getValueAsDouble();
+  else
+    value = (double)element.cast<IntegerAttr>().getInt();
+  return true;
+}
+
+Operation *getStoreEpilogueOp(Operation *currentOp) {
+  if (currentOp->getNumResults() != 1)
+    return nullptr;
+  Value result = currentOp->getResult(0);
+  if (!result.hasOneUse())
+    return nullptr;
+  Operation *consumer = *result.getUsers().begin();
+  if (consumer->getBlock() != currentOp->getBlock() ||
+      consumer->getResult(0).getType() != result.getType())
+    return nullptr;
+
+  Type elementType = getElementTypeOrSelf(result.getType());
+  if (llvm::isa<ONNXReluOp, ONNXLeakyReluOp>(consumer))
+    return elementType.isa<FloatType>() ? consumer : nullptr;
+  if (auto clipOp = llvm::dyn_cast<ONNXClipOp>(consumer)) {
+    Optional<double> min, max;
+    if (clipOp.input() == result && elementType.isIntOrFloat() &&
+        getConstantClipBound(clipOp.min(), min) &&
+        getConstantClipBound(clipOp.max(), max))
+      return consumer;
+  }
+  return nullptr;
+}
+
+Value emitStoreEpilogue(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *epilogueOp, Value value) {
+  if (!epilogueOp)
+    return value;
+  Type type = value.getType();
+  Type elementType = getElementTypeOrSelf(type);
+  auto getConstant = [&](double constant) -> Value {
+    Value scalar = emitConstantOp(rewriter, loc, elementType, constant);
+    if (type.isa<VectorType>())
+      return rewriter.create<SplatOp>(loc, type, scalar);
+    return scalar;
+  };
+  auto emitLessThan = [&](Value lhs, Value rhs) -> Value {
+    if (elementType.isa<FloatType>())
+      return rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, lhs, rhs);
+    return rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, lhs, rhs);
+  };
+
+  if (llvm::isa<ONNXReluOp>(epilogueOp)) {
+    Value zero = getConstant(0);
+    return rewriter.create<SelectOp>(
+        loc, emitLessThan(value, zero), zero, value);
+  }
+  if (auto leakyReluOp = llvm::dyn_cast<ONNXLeakyReluOp>(epilogueOp)) {
+    Value zero = getConstant(0);
+    Value alpha = getConstant(leakyReluOp.alpha().convertToFloat());
+    return rewriter.create<SelectOp>(loc, emitLessThan(value, zero),
+        rewriter.create<MulFOp>(loc, alpha, value), value);
+  }
+  auto clipOp = llvm::cast<ONNXClipOp>(epilogueOp);
+  Optional<double> min, max;
+  getConstantClipBound(clipOp.min(), min);
+  getConstantClipBound(clipOp.max(), max);
+  if (min.hasValue()) {
+    Value minVal = getConstant(min.getValue());
+    value = rewriter.create<SelectOp>(
+        loc, emitLessThan(value, minVal), minVal, value);
+  }
+  if (max.hasValue()) {
+    Value maxVal = getConstant(max.getValue());
+    value = rewriter.create<SelectOp>(
+        loc, emitLessThan(value, maxVal), value, maxVal);
+  }
+  return value;
+}
+
+void replaceOpWithStoreEpilogue(ConversionPatternRewriter &rewriter,
+    Operation *currentOp, Operation *epilogueOp, Value alloc) {
+  rewriter.replaceOp(currentOp, alloc);
+  if (epilogueOp)
+    rewriter.replaceOp(epilogueOp, alloc);
+}
+
 // Create a mapping from result type's dimensions to input type's dimensions,
 // given that the result type is the result of a reduction op over the input
 // type.
@@ -497,3 +633,606 @@ Value foldOrEmitONNXTransposeOp(ConversionPatternRewriter &rewriter,
     return rewriter.create<ONNXTransposeOp>(loc, resultType, input, permAttr)
         .getResult();
 }
+
+/// Get the tuned tile sizes of a matrix multiply, these by default. The tuned
+/// sizes have no database, so that selecting them again keeps them, and keep
+/// the BLAS threshold.
+MatMulTileSizes MatMulTileSizes::forShape(
+    IndexExpr I, IndexExpr J, IndexExpr K) const {
+  if (!tuningDatabase || !I.isLiteral() || !J.isLiteral() || !K.isLiteral())
+    return *this;
+  auto entry = tuningDatabase->shapes.find(
+      {I.getLiteral(), J.getLiteral(), K.getLiteral()});
+  if (entry == tuningDatabase->shapes.end())
+    return *this;
+  MatMulTileSizes tuned = entry->second;
+  tuned.blasMinFlops = blasMinFlops;
+  return tuned;
+}
+
+/// Read the tile sizes tuned for some matrix multiplies.
+LogicalResult readMatMulTuningDatabase(
+    StringRef path, MatMulTileSizes &tileSizes, std::string &errorMessage) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    errorMessage = "cannot read " + path.str() + ": " +
+                   buffer.getError().message();
+    return failure();
+  }
+  llvm::Expected<llvm::json::Value> json =
+      llvm::json::parse(buffer.get()->getBuffer());
+  if (!json) {
+    errorMessage = path.str() + ": " + llvm::toString(json.takeError());
+    return failure();
+  }
+  llvm::json::Object *root = json->getAsObject();
+  llvm::json::Array *entries = root ? root->getArray("matmul") : nullptr;
+  if (!entries) {
+    errorMessage = path.str() + ": expected a \"matmul\" array";
+    return failure();
+  }
+
+  auto database = std::make_shared<MatMulTuningDatabase>();
+  for (const llvm::json::Value &value : *entries) {
+    const llvm::json::Object *entry = value.getAsObject();
+    llvm::Optional<int64_t> i, j, k;
+    const llvm::json::Array *sizes = nullptr;
+    if (entry) {
+      i = entry->getInteger("i");
+      j = entry->getInteger("j");
+      k = entry->getInteger("k");
+      sizes = entry->getArray("tile_sizes");
+    }
+    SmallVector<int64_t, 5> sizeValues;
+    if (sizes)
+      for (const llvm::json::Value &size : *sizes)
+        if (llvm::Optional<int64_t> sizeValue = size.getAsInteger())
+          if (*sizeValue > 0)
+            sizeValues.emplace_back(*sizeValue);
+    if (!i || !j || !k || !sizes || sizes->size() != 5 ||
+        sizeValues.size() != 5) {
+      errorMessage = path.str() + ": expected i, j, k and 5 positive "
+                                  "tile_sizes in each matmul entry";
+      return failure();
+    }
+    MatMulTileSizes tuned;
+    tuned.iCache = sizeValues[0];
+    tuned.jCache = sizeValues[1];
+    tuned.kCache = sizeValues[2];
+    tuned.iReg = sizeValues[3];
+    tuned.jReg = sizeValues[4];
+    tuned.simdize = entry->getBoolean("simdize").getValueOr(true);
+    tuned.unroll =
+        tileSizes.unroll && entry->getBoolean("unroll").getValueOr(true);
+    database->shapes[{*i, *j, *k}] = tuned;
+  }
+  tileSizes.tuningDatabase = database;
+  return success();
+}
+
+/// Check if an [I, K] x [K, J] matrix multiply fits in a single cache tile.
+bool fitsInMatMulCacheTile(IndexExpr I, IndexExpr J, IndexExpr K,
+    const MatMulTileSizes &tileSizes) {
+  const MatMulTileSizes tiles = tileSizes.forShape(I, J, K);
+  return I.isLiteral() && J.isLiteral() && K.isLiteral() &&
+         I.getLiteral() <= tiles.iCache && J.getLiteral() <= tiles.jCache &&
+         K.getLiteral() <= tiles.kCache;
+}
+
+/// Check if a matrix multiply is large enough to be offloaded to BLAS.
+bool isBlasSgemm(Value A, Value B, Value C, IndexExpr I, IndexExpr J,
+    IndexExpr K, const MatMulTileSizes &tileSizes) {
+  if (tileSizes.blasMinFlops <= 0)
+    return false;
+  for (Value matrix : {A, B, C})
+    if (!matrix.getType().cast<MemRefType>().getElementType().isF32())
+      return false;
+  if (!I.isLiteral() || !J.isLiteral() || !K.isLiteral())
+    return false;
+  return 2 * I.getLiteral() * J.getLiteral() * K.getLiteral() >=
+         tileSizes.blasMinFlops;
+}
+
+/// Emit a global with the constant B matrix packed into cache tile panels.
+Value emitPackedMatMulPanels(ConversionPatternRewriter &rewriter, Location loc,
+    Value B, bool transposed, const MatMulTileSizes &tileSizes,
+    bool downcastToBF16) {
+  static int packedPanelsID = 0;
+  if (!isKrnlGlobalConstant(B) && !isDenseONNXConstant(B))
+    return nullptr;
+  DenseElementsAttr valueAttr =
+      B.getDefiningOp()->getAttrOfType<DenseElementsAttr>("value");
+  MemRefType bType = B.getType().cast<MemRefType>();
+  if (!valueAttr || bType.getRank() != 2 || !bType.hasStaticShape() ||
+      !bType.getElementType().isa<FloatType>())
+    return nullptr;
+
+  auto bShape = bType.getShape();
+  int64_t K = transposed ? bShape[1] : bShape[0];
+  int64_t J = transposed ? bShape[0] : bShape[1];
+  int64_t kTile(tileSizes.kCache), jTile(tileSizes.jCache);
+  Type packedElementType = bType.getElementType();
+  if (downcastToBF16 && packedElementType.isF32())
+    packedElementType = rewriter.getBF16Type();
+  MemRefType packedType = MemRefType::get(
+      {(K + kTile - 1) / kTile, (J + jTile - 1) / jTile, kTile, jTile},
+      packedElementType);
+
+  char *bBuffer = createArrayFromDenseElementsAttr(valueAttr);
+  char *resBuffer = allocateBufferFor(packedType, /*useMaxSize=*/true);
+  ConstPropPackMatMulPanelsImpl(
+      bBuffer, bShape, transposed, kTile, jTile, resBuffer);
+  char *resArray = allocateBufferFor(packedType);
+  convertDoubleInt64ToExactType(packedType, resBuffer, resArray);
+  DenseElementsAttr denseAttr =
+      createDenseElementsAttrFromArray(resArray, packedType);
+  free(resArray);
+  free(resBuffer);
+  free(bBuffer);
+
+  auto global = rewriter.create<KrnlGlobalOp>(loc, packedType,
+      /*shape=*/rewriter.getI64ArrayAttr(packedType.getShape()),
+      /*name=*/
+      rewriter.getStringAttr(
+          "packed_panels_" + std::to_string(packedPanelsID++)),
+      /*value=*/denseAttr,
+      /*offset=*/nullptr,
+      /*alignment=*/rewriter.getI64IntegerAttr(BUFFER_ALIGN));
+  return global.getResult();
+}
+
+/// Count the zeros of a constant B matrix to select its CSR multiply.
+bool isSparseMatMulConstant(Value B, const MatMulTileSizes &tileSizes) {
+  if (tileSizes.sparseMinZeroPercent <= 0 ||
+      (!isKrnlGlobalConstant(B) && !isDenseONNXConstant(B)))
+    return false;
+  DenseElementsAttr valueAttr =
+      B.getDefiningOp()->getAttrOfType<DenseElementsAttr>("value");
+  MemRefType bType = B.getType().cast<MemRefType>();
+  if (!valueAttr || bType.getRank() != 2 || !bType.hasStaticShape() ||
+      !bType.getElementType().isa<FloatType>())
+    return false;
+  int64_t numElements = bType.getNumElements();
+  int64_t numZeros = llvm::count_if(valueAttr.getFloatValues(),
+      [](const APFloat &value) { return value.isZero(); });
+  return numZeros < numElements &&
+         100 * numZeros >= tileSizes.sparseMinZeroPercent * numElements;
+}
+
+/// Emit the row offsets, columns and values globals of a constant B matrix.
+SparseMatMulMatrix emitSparseMatMulGlobals(ConversionPatternRewriter &rewriter,
+    Location loc, Value B, bool transposed) {
+  static int sparseMatrixID = 0;
+  DenseElementsAttr valueAttr =
+      B.getDefiningOp()->getAttrOfType<DenseElementsAttr>("value");
+  MemRefType bType = B.getType().cast<MemRefType>();
+  auto bShape = bType.getShape();
+  int64_t K = transposed ? bShape[1] : bShape[0];
+  int64_t J = transposed ? bShape[0] : bShape[1];
+
+  // The rows of the [K, J] matrix, reading the JxK one transposed.
+  SmallVector<APFloat, 64> elements(valueAttr.getFloatValues());
+  SmallVector<int32_t, 64> rowOffsets, columns;
+  SmallVector<APFloat, 64> values;
+  rowOffsets.emplace_back(0);
+  for (int64_t k = 0; k < K; ++k) {
+    for (int64_t j = 0; j < J; ++j) {
+      const APFloat &value =
+          elements[transposed ? j * bShape[1] + k : k * bShape[1] + j];
+      if (value.isZero())
+        continue;
+      columns.emplace_back(j);
+      values.emplace_back(value);
+    }
+    rowOffsets.emplace_back(columns.size());
+  }
+
+  std::string suffix = std::to_string(sparseMatrixID++);
+  Type i32Type = rewriter.getI32Type();
+  auto createGlobal = [&](StringRef name, Type elementType,
+                          DenseElementsAttr denseAttr) {
+    MemRefType type = MemRefType::get(
+        denseAttr.getType().getShape(), elementType);
+    auto global = rewriter.create<KrnlGlobalOp>(loc, type,
+        /*shape=*/rewriter.getI64ArrayAttr(type.getShape()),
+        /*name=*/rewriter.getStringAttr(name + suffix),
+        /*value=*/denseAttr,
+        /*offset=*/nullptr,
+        /*alignment=*/rewriter.getI64IntegerAttr(BUFFER_ALIGN));
+    return global.getResult();
+  };
+  auto getTensorType = [](int64_t size, Type elementType) {
+    return RankedTensorType::get({size}, elementType);
+  };
+  SparseMatMulMatrix sparseB;
+  sparseB.rowOffsets = createGlobal("sparse_row_offsets_", i32Type,
+      DenseElementsAttr::get(getTensorType(K + 1, i32Type),
+          llvm::makeArrayRef(rowOffsets)));
+  sparseB.columns = createGlobal("sparse_columns_", i32Type,
+      DenseElementsAttr::get(getTensorType(columns.size(), i32Type),
+          llvm::makeArrayRef(columns)));
+  Type elementType = bType.getElementType();
+  sparseB.values = createGlobal("sparse_values_", elementType,
+      DenseElementsAttr::get(getTensorType(values.size(), elementType),
+          llvm::makeArrayRef(values)));
+  return sparseB;
+}
+
+/// Emit C += A * B, with the nonzero elements of the CSR encoded B only.
+void emitSparseMatMul(Value A, ValueRange aPrefix, bool transA,
+    const SparseMatMulMatrix &B, Value C, ValueRange cPrefix, IndexExpr I,
+    IndexExpr K, bool parallelize) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+
+  OpBuilder &builder = ScopedContext::getBuilderRef();
+  Location loc = ScopedContext::getLocation();
+  Type accType = C.getType().cast<MemRefType>().getElementType();
+  auto extend = [&](Value value) -> Value {
+    if (value.getType() == accType)
+      return value;
+    return builder.create<FPExtOp>(loc, accType, value);
+  };
+  auto loadIndex = [&](Value memref, Value index) -> Value {
+    return builder.create<IndexCastOp>(
+        loc, krnl_load(memref, ValueRange(index)), builder.getIndexType());
+  };
+
+  LiteralIndexExpr zero(0);
+  ValueRange loops = krnl_define_loop(2);
+  if (parallelize)
+    krnl_parallel(loops[0]);
+  krnl_iterate_ie(loops, {zero, zero}, {I, K}, {}, [&](ValueRange args) {
+    ValueRange indices = krnl_get_induction_var_value(loops);
+    Value i(indices[0]), k(indices[1]);
+    SmallVector<Value, 4> aIndices(aPrefix.begin(), aPrefix.end());
+    aIndices.emplace_back(transA ? k : i);
+    aIndices.emplace_back(transA ? i : k);
+    Value a = extend(krnl_load(A, aIndices));
+    // The nonzero elements of the row k of B, at data dependent columns.
+    Value one = std_constant_index(1);
+    Value begin = loadIndex(B.rowOffsets, k);
+    Value end = loadIndex(B.rowOffsets, std_addi(k, one));
+    auto nonZeroLoop = builder.create<scf::ForOp>(loc, begin, end, one);
+    OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPoint(nonZeroLoop.getBody()->getTerminator());
+    Value p = nonZeroLoop.getInductionVar();
+    Value j = loadIndex(B.columns, p);
+    Value b = extend(krnl_load(B.values, ValueRange(p)));
+    SmallVector<Value, 4> cIndices(cPrefix.begin(), cPrefix.end());
+    cIndices.emplace_back(i);
+    cIndices.emplace_back(j);
+    Value c = krnl_load(C, cIndices);
+    krnl_store(std_addf(c, std_mulf(a, b)), C, cIndices);
+  });
+}
+
+/// Half precision products are accumulated in single precision.
+Type getMatMulAccumulationType(Type elementType) {
+  if (elementType.isF16() || elementType.isBF16())
+    return FloatType::getF32(elementType.getContext());
+  return elementType;
+}
+
+/// Emit C += A * B, tiled for the caches and simdized like Gemm.
+void emitTiledMatMul(Value A, ValueRange aPrefix, Value B, ValueRange bPrefix,
+    Value C, ValueRange cPrefix, IndexExpr I, IndexExpr J, IndexExpr K,
+    Value zeroVal, const MatMulTileSizes &tileSizes, bool parallelize,
+    Value packedB) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+
+  if (isBlasSgemm(A, B, C, I, J, K, tileSizes)) {
+    krnl_sgemm(A, aPrefix, B, bPrefix, C, cPrefix, /*transA=*/false,
+        /*transB=*/false, /*alpha=*/1.0, /*beta=*/1.0);
+    return;
+  }
+
+  const MatMulTileSizes tiles = tileSizes.forShape(I, J, K);
+  const int64_t iCacheTile(tiles.iCache), jCacheTile(tiles.jCache),
+      kCacheTile(tiles.kCache);
+  const int64_t iRegTile(tiles.iReg), jRegTile(tiles.jReg);
+  bool unrollAndJam = tiles.unroll;
+  bool simdize = tiles.simdize;
+  // The results are simdized in place, with masked vector transfers when J
+  // is not a compile time multiple of the vector length.
+  if (J.isLiteral() && J.getLiteral() < jRegTile)
+    simdize = false;
+
+  // A and B may have a narrower element type than C, e.g. i8 matrices
+  // multiplied into an i32 one, their tiles are then padded with their own
+  // zero.
+  Type elementType = zeroVal.getType();
+  Type aElementType = A.getType().cast<MemRefType>().getElementType();
+  Type bElementType = B.getType().cast<MemRefType>().getElementType();
+  auto getZeroVal = [&](Type type) {
+    if (type == elementType)
+      return zeroVal;
+    return emitConstantOp(ScopedContext::getBuilderRef(),
+        ScopedContext::getLocation(), type, 0);
+  };
+  Value aZeroVal = getZeroVal(aElementType);
+  Value bZeroVal = getZeroVal(bElementType);
+  MemRefType aTileType =
+      MemRefType::get({iCacheTile, kCacheTile}, aElementType);
+  MemRefType bTileType =
+      MemRefType::get({kCacheTile, jCacheTile}, bElementType);
+  IntegerAttr alignAttr =
+      ScopedContext::getBuilderRef().getI64IntegerAttr(BUFFER_ALIGN);
+  Value aBuff, bBuff;
+  auto allocTileBuffers = [&]() {
+    ValueRange empty;
+    aBuff = memref_alloc(aTileType, empty, alignAttr);
+    if (!packedB)
+      bBuff = memref_alloc(bTileType, empty, alignAttr);
+  };
+  auto deallocTileBuffers = [&]() {
+    memref_dealloc(aBuff);
+    if (!packedB)
+      memref_dealloc(bBuff);
+  };
+  // When the outermost tile loop is parallel, the tile buffers are private to
+  // each of its iterations and thus allocated inside that loop.
+  if (!parallelize)
+    allocTileBuffers();
+
+  LiteralIndexExpr zero(0);
+  Value z = zero.getValue();
+  auto withPrefix = [](ValueRange prefix, ArrayRef<Value> indices) {
+    SmallVector<Value, 4> res(prefix.begin(), prefix.end());
+    res.append(indices.begin(), indices.end());
+    return res;
+  };
+  // Offsets from a tile of A or B to the next one along the innermost cache
+  // tile loop, which is prefetched while the tile is copied.
+  auto nextTile = [](ValueRange prefix, int64_t rowOffset, int64_t colOffset) {
+    SmallVector<int64_t, 4> res(prefix.size(), 0);
+    res.append({rowOffset, colOffset});
+    return res;
+  };
+  // The B tile starting at (k1, j1): either copied into the tile buffer, or
+  // one of the panels of the packed B, selected by the tile indices.
+  auto getBTile = [&](Value k1, Value j1, SmallVectorImpl<Value> &bStart) {
+    if (!packedB) {
+      krnl_copy_to_buffer(bBuff, B, withPrefix(bPrefix, {k1, j1}), bZeroVal,
+          false, nextTile(bPrefix, kCacheTile, 0));
+      bStart.append({k1, j1});
+      return bBuff;
+    }
+    LiteralIndexExpr kTile(kCacheTile), jTile(jCacheTile);
+    Value kt = DimIndexExpr(k1).floorDiv(kTile).getValue();
+    Value jt = DimIndexExpr(j1).floorDiv(jTile).getValue();
+    bStart.append({kt, jt, k1, j1});
+    return packedB;
+  };
+
+  // I, J, K loop.
+  ValueRange origLoop = krnl_define_loop(3);
+  Value ii(origLoop[0]), jj(origLoop[1]), kk(origLoop[2]);
+  // Tile I.
+  ValueRange iCacheBlock = krnl_block(ii, iCacheTile);
+  ValueRange iRegBlock = krnl_block(iCacheBlock[1], iRegTile);
+  Value ii1(iCacheBlock[0]), ii2(iRegBlock[0]), ii3(iRegBlock[1]);
+  // Tile J.
+  ValueRange jCacheBlock = krnl_block(jj, jCacheTile);
+  ValueRange jRegBlock = krnl_block(jCacheBlock[1], jRegTile);
+  Value jj1(jCacheBlock[0]), jj2(jRegBlock[0]), jj3(jRegBlock[1]);
+  // Tile K.
+  ValueRange kCacheBlock = krnl_block(kk, kCacheTile);
+  Value kk1(kCacheBlock[0]), kk2(kCacheBlock[1]);
+
+  // (cache) jj1 kk1, ii1, (reg) jj2, ii2, (matmul) ii3, jj3, kk3
+  krnl_permute({jj1, jj2, jj3, kk1, kk2, ii1, ii2, ii3},
+      {/*j*/ 0, 3, 5, /*k*/ 1, 6, /*i*/ 2, 4, 7});
+  if (parallelize)
+    krnl_parallel(jj1);
+  krnl_iterate_ie(
+      {jj, kk}, {jj1, kk1}, {zero, zero}, {J, K}, {}, [&](ValueRange args) {
+        ValueRange j1_k1_indices = krnl_get_induction_var_value({jj1, kk1});
+        Value j1(j1_k1_indices[0]), k1(j1_k1_indices[1]);
+        if (parallelize)
+          allocTileBuffers();
+        SmallVector<Value, 4> bStart;
+        Value bTile = getBTile(k1, j1, bStart);
+        krnl_iterate_ie({ii}, {ii1}, {zero}, {I}, {}, [&](ValueRange args) {
+          ValueRange i1_index = krnl_get_induction_var_value({ii1});
+          Value i1(i1_index[0]);
+          krnl_copy_to_buffer(aBuff, A, withPrefix(aPrefix, {i1, k1}),
+              aZeroVal, false, nextTile(aPrefix, iCacheTile, 0));
+          krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
+            ValueRange j2_i2_indices =
+                krnl_get_induction_var_value({jj2, ii2});
+            Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
+            krnl_matmul(aBuff, {i1, k1}, bTile, bStart, C,
+                withPrefix(cPrefix, {z, z}),
+                /*loops*/ {ii3, jj3, kk2},
+                /*compute start*/ {i2, j2, k1},
+                /*ubs*/ {I.getValue(), J.getValue(), K.getValue()},
+                /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
+                /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
+          });
+        });
+        if (parallelize)
+          deallocTileBuffers();
+      });
+
+  if (!parallelize)
+    deallocTileBuffers();
+}
+
+/// Emit the quantization of x: saturate(round(x / scale) + zeroPoint).
+Value emitQuantize(ConversionPatternRewriter &rewriter, Location loc, Value x,
+    Value scale, Value zeroPoint, Type quantType) {
+  Type floatType = x.getType();
+  unsigned width = quantType.getIntOrFloatBitWidth();
+  Value one = emitConstantOp(rewriter, loc, floatType, 1);
+  Value two = emitConstantOp(rewriter, loc, floatType, 2);
+  Value half = emitConstantOp(rewriter, loc, floatType, 0.5);
+  Value minVal =
+      emitConstantOp(rewriter, loc, floatType, -(double)(1LL << (width - 1)));
+  Value maxVal = emitConstantOp(
+      rewriter, loc, floatType, (double)((1LL << (width - 1)) - 1));
+
+  // Round half to even: round up when the fraction is above one half, or when
+  // it is exactly one half and the floor is odd.
+  Value scaled = rewriter.create<DivFOp>(loc, x, scale);
+  Value floor = rewriter.create<FloorFOp>(loc, scaled);
+  Value fraction = rewriter.create<SubFOp>(loc, scaled, floor);
+  Value halfFloor = rewriter.create<FloorFOp>(
+      loc, rewriter.create<DivFOp>(loc, floor, two));
+  Value parity = rewriter.create<SubFOp>(
+      loc, floor, rewriter.create<MulFOp>(loc, halfFloor, two));
+  Value isOdd = rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, parity, one);
+  Value aboveHalf =
+      rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, fraction, half);
+  Value isHalf =
+      rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, fraction, half);
+  Value roundUp = rewriter.create<OrOp>(
+      loc, aboveHalf, rewriter.create<AndOp>(loc, isHalf, isOdd));
+  Value rounded = rewriter.create<SelectOp>(
+      loc, roundUp, rewriter.create<AddFOp>(loc, floor, one), floor);
+
+  // Add the zero point and saturate to the range of quantType.
+  if (zeroPoint)
+    rounded = rewriter.create<AddFOp>(loc, rounded,
+        rewriter.create<SIToFPOp>(loc, floatType, zeroPoint));
+  Value lessThanMin =
+      rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, rounded, minVal);
+  rounded = rewriter.create<SelectOp>(loc, lessThanMin, minVal, rounded);
+  Value greaterThanMax =
+      rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, rounded, maxVal);
+  rounded = rewriter.create<SelectOp>(loc, greaterThanMax, maxVal, rounded);
+  return rewriter.create<FPToSIOp>(loc, quantType, rounded);
+}
+
+/// Load a per-tensor or per-axis quantization parameter.
+Value loadQuantizationParam(ConversionPatternRewriter &rewriter, Location loc,
+    Value param, Value index) {
+  if (param.getType().isa<NoneType>())
+    return nullptr;
+  auto paramType = param.getType().cast<MemRefType>();
+  if (paramType.getRank() == 0)
+    return rewriter.create<KrnlLoadOp>(loc, param, ArrayRef<Value>{});
+  if (paramType.getShape()[0] == 1) {
+    Value zero = rewriter.create<ConstantIndexOp>(loc, 0);
+    return rewriter.create<KrnlLoadOp>(loc, param, zero);
+  }
+  return rewriter.create<KrnlLoadOp>(loc, param, index);
+}
+
+/// Emit a view of the trailing dimensions of a memref.
+Value emitTrailingDimsView(ConversionPatternRewriter &rewriter, Location loc,
+    Value memref, ValueRange leadingIndices) {
+  auto memRefType = memref.getType().cast<MemRefType>();
+  ArrayRef<int64_t> viewShape =
+      memRefType.getShape().drop_front(leadingIndices.size());
+  assert(memRefType.getAffineMaps().empty() &&
+         llvm::none_of(viewShape, [](int64_t dim) { return dim < 0; }) &&
+         "expected static trailing dimensions and the identity layout");
+
+  SmallVector<int64_t, 4> viewStrides(viewShape.size(), 1);
+  for (int i = (int)viewShape.size() - 2; i >= 0; i--)
+    viewStrides[i] = viewStrides[i + 1] * viewShape[i + 1];
+  auto viewType = MemRefType::get(viewShape, memRefType.getElementType(),
+      makeStridedLinearLayoutMap(viewStrides,
+          MemRefType::getDynamicStrideOrOffset(), rewriter.getContext()));
+
+  SmallVector<OpFoldResult, 4> offsets, sizes, strides;
+  for (Value index : leadingIndices) {
+    offsets.emplace_back(index);
+    sizes.emplace_back(rewriter.getIndexAttr(1));
+    strides.emplace_back(rewriter.getIndexAttr(1));
+  }
+  for (int64_t dim : viewShape) {
+    offsets.emplace_back(rewriter.getIndexAttr(0));
+    sizes.emplace_back(rewriter.getIndexAttr(dim));
+    strides.emplace_back(rewriter.getIndexAttr(1));
+  }
+  return rewriter.create<memref::SubViewOp>(
+      loc, viewType, memref, offsets, sizes, strides);
+}
+
+/// Check if the slices of a memref along the axis are contiguous.
+bool hasContiguousSlicesAlongAxis(MemRefType type, int64_t axis) {
+  if (!hasAllConstantDimensions(type) || !type.getAffineMaps().empty())
+    return false;
+  for (int64_t i = 0; i < axis; ++i)
+    if (type.getShape()[i] != 1)
+      return false;
+  return true;
+}
+
+// Minimal size in bytes of a buffer for its stores to be non-temporal.
+static const int64_t nonTemporalStoreMinBytes = 4 * 1024 * 1024;
+
+/// Check if the stores into a buffer should be non-temporal.
+bool useNonTemporalStores(MemRefType type) {
+  if (!hasAllConstantDimensions(type))
+    return false;
+  return type.getNumElements() * getMemRefEltSizeInBytes(type) >=
+         nonTemporalStoreMinBytes;
+}
+
+/// Emit a view of a static slice of a memref along an axis.
+Value emitStaticSliceView(ConversionPatternRewriter &rewriter, Location loc,
+    Value memref, int64_t axis, int64_t offset, ArrayRef<int64_t> sliceShape) {
+  auto memRefType = memref.getType().cast<MemRefType>();
+  ArrayRef<int64_t> shape = memRefType.getShape();
+  int64_t rank = shape.size();
+  SmallVector<int64_t, 4> viewStrides(rank, 1);
+  for (int64_t i = rank - 2; i >= 0; i--)
+    viewStrides[i] = viewStrides[i + 1] * shape[i + 1];
+  auto viewType = MemRefType::get(sliceShape, memRefType.getElementType(),
+      makeStridedLinearLayoutMap(
+          viewStrides, offset * viewStrides[axis], rewriter.getContext()));
+
+  SmallVector<OpFoldResult, 4> offsets, sizes, strides;
+  for (int64_t i = 0; i < rank; ++i) {
+    offsets.emplace_back(rewriter.getIndexAttr(i == axis ? offset : 0));
+    sizes.emplace_back(rewriter.getIndexAttr(sliceShape[i]));
+    strides.emplace_back(rewriter.getIndexAttr(1));
+  }
+  return rewriter.create<memref::SubViewOp>(
+      loc, viewType, memref, offsets, sizes, strides);
+}
+
+/// Check if the result of the op can be a view of the buffer of its input.
+bool canLowerToInputView(Operation *op, Value input) {
+  auto inputType = input.getType().dyn_cast<MemRefType>();
+  return inputType && inputType.getAffineMaps().empty() &&
+         checkInsertDealloc(op);
+}
+
+/// Emit a view of a memref with the identity layout with another shape.
+Value emitReshapeView(ConversionPatternRewriter &rewriter, Location loc,
+    Value memref, MemRefType type, ValueRange dynamicDims) {
+  ArrayRef<int64_t> shape = type.getShape();
+  int64_t rank = shape.size();
+  SmallVector<OpFoldResult, 4> sizes(rank), strides(rank);
+  // The strides are static until the first dynamic dimension from the end.
+  int64_t staticStride = 1;
+  Value dynamicStride;
+  unsigned dynamicDimIndex = dynamicDims.size();
+  for (int64_t i = rank - 1; i >= 0; --i) {
+    if (dynamicStride)
+      strides[i] = dynamicStride;
+    else
+      strides[i] = rewriter.getIndexAttr(staticStride);
+    if (shape[i] < 0) {
+      Value dim = dynamicDims[--dynamicDimIndex];
+      sizes[i] = dim;
+      if (!dynamicStride)
+        dynamicStride = rewriter.create<ConstantIndexOp>(loc, staticStride);
+      dynamicStride = rewriter.create<MulIOp>(loc, dynamicStride, dim);
+    } else {
+      sizes[i] = rewriter.getIndexAttr(shape[i]);
+      if (dynamicStride)
+        dynamicStride = rewriter.create<MulIOp>(loc, dynamicStride,
+            rewriter.create<ConstantIndexOp>(loc, shape[i]));
+      else
+        staticStride *= shape[i];
+    }
+  }
+  return rewriter.create<memref::ReinterpretCastOp>(
+      loc, type, memref, rewriter.getIndexAttr(0), sizes, strides);
+}
@@ -15,7 +15,9 @@
 
 #pragma once
 
+#include <array>
 #include <map>
+#include <memory>
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/Linalg/IR/LinalgOps.h"
@@ -26,6 +28,7 @@
 #include "mlir/Dialect/StandardOps/Transforms/FuncConversions.h"
 #include "mlir/Dialect/StandardOps/Transforms/Passes.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/TypeUtilities.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -77,6 +80,33 @@ Value insertAllocAndDeallocSimple(PatternRewriter &rewriter, Operation *op,
 // inserted.
 bool checkInsertDealloc(Operation *currentOp, int resultIndex = 0);
 
+// Return the buffer of an operand of the current op that can hold the result
+// of the op, i.e. an operand that has the type of the result and whose buffer
+// is a temporary allocation that is dead after the op. Return nullptr if no
+// such operand exists. Only valid for elementwise ops, where each element of
+// the result is computed from the elements of the operands at the same index.
+Value getInPlaceOperandBuffer(
+    Operation *currentOp, ArrayRef<Value> operands, MemRefType type);
+
+// Return the consumer of the result of the current op that the current op
+// can apply to the values it stores, so that the consumer needs neither its
+// own loop nest nor its own buffer: a Relu or LeakyRelu of a float result, or
+// a Clip with constant or no bounds. The consumer must be the only user of
+// the result, in the same block. Return nullptr if there is no such consumer.
+Operation *getStoreEpilogueOp(Operation *currentOp);
+
+// Apply a store epilogue op to a value, an element or a vector of elements of
+// the result, before it is stored. Return the value itself when epilogueOp is
+// nullptr.
+Value emitStoreEpilogue(ConversionPatternRewriter &rewriter, Location loc,
+    Operation *epilogueOp, Value value);
+
+// Replace the current op by the buffer of its result. When a store epilogue
+// op was applied at the stores, the buffer holds the result of the epilogue
+// op, which is replaced by the buffer as well.
+void replaceOpWithStoreEpilogue(ConversionPatternRewriter &rewriter,
+    Operation *currentOp, Operation *epilogueOp, Value alloc);
+
 // Create a mapping from result type's dimensions to input type's dimensions,
 // given that the result type is the result of a reduction op over the input
 // type.
@@ -134,6 +164,167 @@ std::vector<Value> foldOrEmitONNXSplitOp(ConversionPatternRewriter &rewriter,
 Value foldOrEmitONNXTransposeOp(ConversionPatternRewriter &rewriter,
     Location loc, Type resultType, Value input, ArrayAttr permAttr);
 
+/// Tile sizes of the matrix multiplies of Gemm, MatMul and Conv: the cache
+/// tiles of I, J and K, and the register tiles of I and J, J being simdized
+/// with jReg as the vector length. The defaults suit 32 KB L1 caches and 8
+/// float vectors (e.g. AVX2); compilers targeting another CPU derive them
+/// from its vector width and cache sizes. The register tiles are simdized and
+/// unrolled and jammed unless disabled. The sizes tuned for the matrix
+/// multiplies of some I, J and K, e.g. by utils/autotune-matmul.py, are given
+/// by a tuning database and selected with forShape.
+struct MatMulTuningDatabase;
+struct MatMulTileSizes {
+  int64_t iCache = 64, jCache = 128, kCache = 512;
+  int64_t iReg = 4, jReg = 8;
+  bool simdize = true, unroll = true;
+  std::shared_ptr<const MatMulTuningDatabase> tuningDatabase;
+  /// Minimum number of flops (2 * I * J * K) of the f32 matrix multiplies of
+  /// static shapes offloaded to the sgemm of an external BLAS library with
+  /// krnl.sgemm, 0 to never offload them.
+  int64_t blasMinFlops = 0;
+  /// Minimum percentage of zeros of the constant B matrices multiplied as
+  /// compressed sparse row matrices by emitSparseMatMul, 0 to never do so.
+  int64_t sparseMinZeroPercent = 0;
+
+  /// Get the tile sizes of a matrix multiply, the tuned ones when the sizes
+  /// I, J and K are literals found in the tuning database, these otherwise.
+  MatMulTileSizes forShape(IndexExpr I, IndexExpr J, IndexExpr K) const;
+};
+
+/// Tile sizes tuned for matrix multiplies, by I, J and K sizes.
+struct MatMulTuningDatabase {
+  std::map<std::array<int64_t, 3>, MatMulTileSizes> shapes;
+};
+
+/// Read the tuning database of a JSON file of the form:
+///   {"matmul": [{"i": 384, "j": 768, "k": 768,
+///                "tile_sizes": [64, 128, 512, 4, 8],
+///                "simdize": true, "unroll": true}, ...]}
+/// where the tile sizes are those of MatMulTileSizes, and the other keys are
+/// ignored. The tuned tiles are not unrolled when the unroll of tileSizes is
+/// disabled. On success, the database is set in tileSizes; an error message
+/// is returned otherwise.
+LogicalResult readMatMulTuningDatabase(
+    StringRef path, MatMulTileSizes &tileSizes, std::string &errorMessage);
+
+/// Emit C += A * B for [I, K] x [K, J] matrices, tiled for the caches and
+/// simdized along J with krnl.matmul, like Gemm. The matrices are the two
+/// trailing dimensions of A, B and C, the leading dimensions being selected
+/// by the prefix indices. When parallelize is set, the outermost tile loop is
+/// parallel; the tile buffers are otherwise allocated once, e.g. in each
+/// iteration of a parallel loop of the caller. When packedB is given, the
+/// panels of B are read from it (see emitPackedMatMulPanels) instead of being
+/// copied into a tile buffer. A and B may have a narrower element type than C
+/// (e.g. i8 with an i32 C), the products being accumulated in the type of C
+/// whose zero is zeroVal. The tile sizes are those selected for I, J and K by
+/// tileSizes.forShape. The multiplies selected by isBlasSgemm are emitted as a
+/// krnl.sgemm instead. Must be called within EDSC and IndexExpr scopes.
+void emitTiledMatMul(Value A, ValueRange aPrefix, Value B, ValueRange bPrefix,
+    Value C, ValueRange cPrefix, IndexExpr I, IndexExpr J, IndexExpr K,
+    Value zeroVal, const MatMulTileSizes &tileSizes, bool parallelize = true,
+    Value packedB = nullptr);
+
+/// Check if the [I, K] x [K, J] matrix multiply of the A, B and C memrefs is
+/// offloaded to an external BLAS library: the matrices are f32, the sizes are
+/// literals and there are at least tileSizes.blasMinFlops flops.
+bool isBlasSgemm(Value A, Value B, Value C, IndexExpr I, IndexExpr J,
+    IndexExpr K, const MatMulTileSizes &tileSizes);
+
+/// Emit a global holding the constant B matrix of a matrix multiply (JxK when
+/// transposed), packed at compile time into the kCache x jCache panels read
+/// by the tiled matrix multiplies. Return null if B is not a constant 2D float
+/// matrix with static shape. When downcastToBF16 is set, f32 panels are stored
+/// in bf16, halving their footprint, and extended back by the multiplies.
+Value emitPackedMatMulPanels(ConversionPatternRewriter &rewriter, Location loc,
+    Value B, bool transposed, const MatMulTileSizes &tileSizes,
+    bool downcastToBF16 = false);
+
+/// The compressed sparse row (CSR) encoding of a constant [K, J] B matrix: the
+/// K + 1 i32 offsets of its rows in the arrays of the i32 column and of the
+/// value of its nonzero elements.
+struct SparseMatMulMatrix {
+  Value rowOffsets, columns, values;
+};
+
+/// Check if B is a constant 2D float matrix with static shape, with some
+/// nonzero elements and at least tileSizes.sparseMinZeroPercent percent of
+/// zeros, e.g. the weights of a pruned fully-connected layer, multiplied as a
+/// CSR matrix.
+bool isSparseMatMulConstant(Value B, const MatMulTileSizes &tileSizes);
+
+/// Emit the globals of the CSR encoding of the constant B matrix selected by
+/// isSparseMatMulConstant (JxK when transposed).
+SparseMatMulMatrix emitSparseMatMulGlobals(ConversionPatternRewriter &rewriter,
+    Location loc, Value B, bool transposed);
+
+/// Emit C += A * B for an [I, K] A matrix ([K, I] when transA) and a CSR
+/// encoded [K, J] B matrix: each element of A is multiplied with the nonzero
+/// elements of its row of B only, accumulated in place into C. A and B may
+/// have a narrower float type than C. The matrices are the two trailing
+/// dimensions of A and C, the leading ones being selected by the prefix
+/// indices. When parallelize is set, the loop over I is parallel. Must be
+/// called within EDSC and IndexExpr scopes.
+void emitSparseMatMul(Value A, ValueRange aPrefix, bool transA,
+    const SparseMatMulMatrix &B, Value C, ValueRange cPrefix, IndexExpr I,
+    IndexExpr K, bool parallelize = true);
+
+/// Return the element type in which the products of matrices of the given
+/// element type are accumulated: f32 for the half precision f16 and bf16, the
+/// element type itself otherwise.
+Type getMatMulAccumulationType(Type elementType);
+
+/// Check if an [I, K] x [K, J] matrix multiply fits in a single cache tile of
+/// emitTiledMatMul, in which case it can be register tiled directly.
+bool fitsInMatMulCacheTile(IndexExpr I, IndexExpr J, IndexExpr K,
+    const MatMulTileSizes &tileSizes);
+
+/// Emit the quantization of the float x to the signless integer quantType:
+/// saturate(round(x / scale) + zeroPoint), rounding half to even. The zero
+/// point has the quantType type.
+Value emitQuantize(ConversionPatternRewriter &rewriter, Location loc, Value x,
+    Value scale, Value zeroPoint, Type quantType);
+
+/// Load the scale or zero point of a quantized op for the given index along
+/// the quantization axis: the single element of a scalar or one element
+/// parameter (per-tensor quantization), the indexed element otherwise
+/// (per-axis quantization). Return null for a missing (NoneType) parameter.
+Value loadQuantizationParam(ConversionPatternRewriter &rewriter, Location loc,
+    Value param, Value index);
+
+/// Emit a view of the trailing dimensions of a memref with the identity
+/// layout at the given indices along its leading dimensions, e.g. a (4x2)
+/// view at offset i * 8 of a (10x4x2) memref. The trailing dimensions must be
+/// static. The view is contiguous and has a dynamic offset.
+Value emitTrailingDimsView(ConversionPatternRewriter &rewriter, Location loc,
+    Value memref, ValueRange leadingIndices);
+
+/// Check if the static memref with the identity layout is split into
+/// contiguous slices along the axis, i.e. all its dimensions before the axis
+/// are 1.
+bool hasContiguousSlicesAlongAxis(MemRefType type, int64_t axis);
+
+/// Check if the stores into a buffer of the given type, written once and not
+/// read back by the op writing it, should be non-temporal: its static size is
+/// above the share of a core in the last level cache, which it would only
+/// flush.
+bool useNonTemporalStores(MemRefType type);
+
+/// Emit a view of the static slice of a memref with the identity layout that
+/// starts at the offset along the axis and has the given shape.
+Value emitStaticSliceView(ConversionPatternRewriter &rewriter, Location loc,
+    Value memref, int64_t axis, int64_t offset, ArrayRef<int64_t> sliceShape);
+
+/// Check if the result of the op can be lowered to a view of the buffer of
+/// its input, which must have the identity layout. The view must not outlive
+/// the buffer, so the result must not be returned by the function.
+bool canLowerToInputView(Operation *op, Value input);
+
+/// Emit a view with the identity layout type of a memref with the identity
+/// layout and as many elements, e.g. a (2x12) view of a (4x6) memref. The
+/// values of the dynamic dimensions of the type are given in order.
+Value emitReshapeView(ConversionPatternRewriter &rewriter, Location loc,
+    Value memref, MemRefType type, ValueRange dynamicDims);
+
 //===----------------------------------------------------------------------===//
 // This is to get a scalar operation of a given type for a specific operation.
 //===----------------------------------------------------------------------===//
@@ -161,14 +352,17 @@ Value getIdentityValue(
 // This is used in the innermost loop of a KrnlIterateOp to insert computation
 // composed of one or many scalar ops.
 // Use template specialization for each of different ONNX operations.
+// The generic version also accepts a vector type as elementType, in which case
+// the scalar op is applied to vector operands.
 //===----------------------------------------------------------------------===//
 template <typename Op>
 Value emitScalarOpFor(ConversionPatternRewriter &rewriter, Location loc,
     Operation *op, Type elementType, ArrayRef<Value> scalarOperands) {
-  if (elementType.isa<IntegerType>()) {
+  Type scalarType = getElementTypeOrSelf(elementType);
+  if (scalarType.isa<IntegerType>()) {
     return rewriter.create<ScalarIOp<Op>>(
         loc, elementType, scalarOperands, mlir::None);
-  } else if (elementType.isa<FloatType>()) {
+  } else if (scalarType.isa<FloatType>()) {
     return rewriter.create<ScalarFOp<Op>>(
         loc, elementType, scalarOperands, mlir::None);
   } else {
@@ -230,17 +424,20 @@ void populateLoweringONNXScanOpPattern(
 void populateLoweringONNXClipOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
-void populateLoweringONNXElementwiseOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx);
+void populateLoweringONNXElementwiseOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool emitInPlace = false, bool fastMath = false,
+    bool fuseStoreEpilogues = false);
 
-void populateLoweringONNXGemmOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx);
+void populateLoweringONNXGemmOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+    bool downcastWeightsToBF16 = false, bool fuseStoreEpilogues = false);
 
 void populateLoweringONNXLRNOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
-void populateLoweringONNXMatMulOpPattern(
-    RewritePatternSet &patterns, MLIRContext *ctx);
+void populateLoweringONNXMatMulOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+    bool downcastWeightsToBF16 = false);
 
 void populateLoweringONNXReductionOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
@@ -250,26 +447,54 @@ void populateLoweringONNXSoftmaxOpPattern(
 
 // `NN` directory methods:
 
-void populateLoweringONNXConvOpPattern(
+void populateLoweringONNXFusedAttentionOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
+void populateLoweringONNXConvOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool optimizeConv = false, bool useWinograd = false,
+    const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+    bool fuseStoreEpilogues = false);
+
+void populateLoweringONNXConvTransposeOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes = MatMulTileSizes(),
+    bool fuseStoreEpilogues = false);
+
 void populateLoweringONNXNormalizationOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
-void populateLoweringONNXPoolingOpPattern(
+void populateLoweringONNXPoolingOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool fuseStoreEpilogues = false);
+
+// `ObjectDetection` directory methods:
+
+void populateLoweringONNXNonMaxSuppressionOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
-// `RNN` directory methods:
-void populateLoweringONNXGRUOpPattern(
+// `Quantization` directory methods:
+
+void populateLoweringONNXQuantizeLinearOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
-void populateLoweringONNXLSTMOpPattern(
+void populateLoweringONNXDequantizeLinearOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
-void populateLoweringONNXRNNOpPattern(
+
+void populateLoweringONNXMatMulIntegerOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes = MatMulTileSizes());
+
+void populateLoweringONNXQLinearConvOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
+// `RNN` directory methods:
+void populateLoweringONNXGRUOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool persistentStates = false);
+
+void populateLoweringONNXLSTMOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool persistentStates = false);
+void populateLoweringONNXRNNOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, bool persistentStates = false);
+
 // `Tensor` directory methods:
-void populateLoweringONNXArgMaxOpPattern(
+void populateLoweringONNXArgMinMaxOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
 void populateLoweringONNXUnsqueezeOpPattern(
@@ -278,6 +503,9 @@ void populateLoweringONNXUnsqueezeOpPattern(
 void populateLoweringONNXTransposeOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
+void populateLoweringONNXLayoutTransformOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx);
+
 void populateLoweringONNXGatherOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
@@ -320,6 +548,12 @@ void populateLoweringONNXSizeOpPattern(
 void populateLoweringONNXTileOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
+void populateLoweringONNXTopKOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx);
+
+void populateLoweringONNXResizeOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx);
+
 void populateLoweringONNXFlattenOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx);
 
@@ -0,0 +1,346 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------ NonMaxSuppression.cpp - Lowering NonMaxSuppression Op ---------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX NonMaxSuppression Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+
+#include "mlir/Dialect/MemRef/EDSC/Intrinsics.h"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+
+using namespace mlir;
+
+// Size in bytes of the vectors of boxes compared to a selected box.
+static const int64_t nmsVectorBytes = 32;
+
+struct ONNXNonMaxSuppressionOpLowering : public ConversionPattern {
+  ONNXNonMaxSuppressionOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXNonMaxSuppressionOp::getOperationName(), 1, ctx) {}
+
+  // The boxes of each batch are first decoded in arrays of corners and areas,
+  // padded to a multiple of the vector length. Each class of each batch is
+  // then processed in parallel, in a buffer of the scores of its candidate
+  // boxes, the removed boxes having a -inf score:
+  //
+  //   S[j] = scores[b, c, j] > score_threshold ? scores[b, c, j] : -inf
+  //   for t = 0 .. min(max_output_boxes_per_class, N):
+  //     if not done:
+  //       s = argmax(S)
+  //       if S[s] == -inf: done = true
+  //       else:
+  //         selected[b, c, t] = s, S[s] = -inf
+  //         S = IoU(box s, boxes) > iou_threshold ? -inf : S    # vectors
+  //
+  // The boxes are selected in the order of their scores. A selection stops
+  // once max_output_boxes_per_class boxes are selected, or when all the
+  // boxes are removed, the remaining iterations being skipped. The selected
+  // boxes of all the classes are then gathered in the result.
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+    Location loc = op->getLoc();
+    ONNXNonMaxSuppressionOpAdaptor operandAdaptor(operands);
+    ONNXNonMaxSuppressionOp nmsOp = llvm::cast<ONNXNonMaxSuppressionOp>(op);
+
+    Value boxes = operandAdaptor.boxes();
+    Value scores = operandAdaptor.scores();
+    auto boxesType = boxes.getType().cast<MemRefType>();
+    auto scoresType = scores.getType().cast<MemRefType>();
+    if (!hasAllConstantDimensions(boxesType) ||
+        !hasAllConstantDimensions(scoresType))
+      return failure();
+    auto outputType = convertToMemRefType(op->getResult(0).getType());
+    Type elementType = boxesType.getElementType();
+    int64_t numBatches = scoresType.getShape()[0];
+    int64_t numClasses = scoresType.getShape()[1];
+    int64_t numBoxes = scoresType.getShape()[2];
+    int64_t vectorLen =
+        nmsVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+    int64_t paddedBoxes = (numBoxes + vectorLen - 1) / vectorLen * vectorLen;
+    bool centerPointBox = nmsOp.center_point_box() == 1;
+
+    ScopedContext scope(rewriter, loc);
+    IndexExprScope ieScope(&rewriter, loc);
+    Type indexType = rewriter.getIndexType();
+    Type i64Type = rewriter.getIntegerType(64);
+    SmallVector<Value, 1> scalarAccess; // Empty.
+    auto loadScalar = [&](Value memref) -> Value {
+      SmallVector<Value, 1> indices(
+          memref.getType().cast<MemRefType>().getRank(),
+          emitConstantOp(rewriter, loc, indexType, 0));
+      return krnl_load(memref, indices);
+    };
+
+    // The number of iterations of the selection is bounded by the number of
+    // boxes, and by max_output_boxes_per_class when it is a constant. There
+    // is no selected box without max_output_boxes_per_class.
+    int64_t maxSelected = numBoxes;
+    Value maxOutput = operandAdaptor.max_output_boxes_per_class();
+    if (isFromNone(maxOutput)) {
+      maxSelected = 0;
+    } else if (DenseElementsAttr maxOutputAttr =
+                   getDenseElementAttributeFromKrnlValue(maxOutput)) {
+      int64_t value =
+          (*maxOutputAttr.getValues<IntegerAttr>().begin()).getInt();
+      maxSelected = std::max(std::min(value, numBoxes), (int64_t)0);
+    }
+    Value negInf = emitNegativeInfinityConstantOp(rewriter, loc, elementType);
+    Value zero = emitConstantOp(rewriter, loc, elementType, 0);
+    Value zeroIndex = emitConstantOp(rewriter, loc, indexType, 0);
+    Value oneIndex = emitConstantOp(rewriter, loc, indexType, 1);
+    Value maxOutputIndex = zeroIndex, iouThreshold = zero,
+          scoreThreshold = negInf;
+    if (maxSelected > 0)
+      maxOutputIndex =
+          rewriter.create<IndexCastOp>(loc, loadScalar(maxOutput), indexType);
+    if (!isFromNone(operandAdaptor.iou_threshold()))
+      iouThreshold = loadScalar(operandAdaptor.iou_threshold());
+    if (!isFromNone(operandAdaptor.score_threshold()))
+      scoreThreshold = loadScalar(operandAdaptor.score_threshold());
+
+    // Iterate over a static space, the first dimension larger than one in
+    // parallel when requested.
+    auto iterate = [&](ArrayRef<int64_t> lbs, ArrayRef<int64_t> ubs,
+                       bool parallel,
+                       function_ref<void(ValueRange)> bodyBuilder) {
+      SmallVector<IndexExpr, 4> lbExprs, ubExprs;
+      for (unsigned i = 0; i < lbs.size(); ++i) {
+        lbExprs.emplace_back(LiteralIndexExpr(lbs[i]));
+        ubExprs.emplace_back(LiteralIndexExpr(ubs[i]));
+      }
+      ValueRange loops = krnl_define_loop(lbs.size());
+      for (unsigned i = 0; parallel && i < lbs.size(); ++i)
+        if (ubs[i] - lbs[i] > 1) {
+          krnl_parallel(loops[i]);
+          break;
+        }
+      krnl_iterate_ie(loops, lbExprs, ubExprs, {}, [&](ValueRange args) {
+        bodyBuilder(krnl_get_induction_var_value(loops));
+      });
+    };
+    auto getMin = [&](Value a, Value b) -> Value {
+      return rewriter.create<SelectOp>(loc,
+          rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, a, b), a, b);
+    };
+    auto getMax = [&](Value a, Value b) -> Value {
+      return rewriter.create<SelectOp>(loc,
+          rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, a, b), a, b);
+    };
+
+    // The corners y1, x1, y2, x2 and the area of the boxes, as rows of a
+    // buffer per batch. The padding boxes are empty.
+    SmallVector<IndexExpr, 1> noDims;
+    Value corners = insertAllocAndDeallocSimple(rewriter, op,
+        MemRefType::get({numBatches, 5, paddedBoxes}, elementType), loc,
+        noDims, /*insertDealloc=*/true, BUFFER_ALIGN);
+    iterate({0, 0}, {numBatches, numBoxes}, true, [&](ValueRange ivs) {
+      Value b(ivs[0]), j(ivs[1]);
+      SmallVector<Value, 4> coords;
+      for (int64_t i = 0; i < 4; ++i)
+        coords.emplace_back(krnl_load(
+            boxes, {b, j, emitConstantOp(rewriter, loc, indexType, i)}));
+      Value y1, x1, y2, x2;
+      if (centerPointBox) {
+        // [x_center, y_center, width, height].
+        Value half = emitConstantOp(rewriter, loc, elementType, 0.5);
+        Value halfWidth = rewriter.create<MulFOp>(loc, coords[2], half);
+        Value halfHeight = rewriter.create<MulFOp>(loc, coords[3], half);
+        x1 = rewriter.create<SubFOp>(loc, coords[0], halfWidth);
+        x2 = rewriter.create<AddFOp>(loc, coords[0], halfWidth);
+        y1 = rewriter.create<SubFOp>(loc, coords[1], halfHeight);
+        y2 = rewriter.create<AddFOp>(loc, coords[1], halfHeight);
+      } else {
+        // [y1, x1, y2, x2] of any diagonal.
+        y1 = getMin(coords[0], coords[2]);
+        y2 = getMax(coords[0], coords[2]);
+        x1 = getMin(coords[1], coords[3]);
+        x2 = getMax(coords[1], coords[3]);
+      }
+      Value area = rewriter.create<MulFOp>(loc,
+          rewriter.create<SubFOp>(loc, y2, y1),
+          rewriter.create<SubFOp>(loc, x2, x1));
+      Value rows[] = {y1, x1, y2, x2, area};
+      for (int64_t i = 0; i < 5; ++i)
+        krnl_store(rows[i], corners,
+            {b, emitConstantOp(rewriter, loc, indexType, i), j});
+    });
+    if (paddedBoxes > numBoxes)
+      iterate({0, 0, numBoxes}, {numBatches, 5, paddedBoxes}, false,
+          [&](ValueRange ivs) { krnl_store(zero, corners, ivs); });
+    Value cornerVectors = krnl_vector_type_cast(corners, vectorLen);
+    auto vectorType = VectorType::get({vectorLen}, elementType);
+
+    // The indices of the selected boxes of each class, and their number.
+    Value selected = insertAllocAndDeallocSimple(rewriter, op,
+        MemRefType::get(
+            {numBatches, numClasses, std::max(maxSelected, (int64_t)1)},
+            i64Type),
+        loc, noDims, /*insertDealloc=*/true);
+    Value counts = insertAllocAndDeallocSimple(rewriter, op,
+        MemRefType::get({numBatches, numClasses}, indexType), loc, noDims,
+        /*insertDealloc=*/true);
+
+    iterate({0, 0}, {numBatches, numClasses}, true, [&](ValueRange ivs) {
+      Value b(ivs[0]), c(ivs[1]);
+      krnl_store(zeroIndex, counts, {b, c});
+      if (maxSelected == 0)
+        return;
+      Value work = memref_alloca(MemRefType::get({paddedBoxes}, elementType));
+      Value done = memref_alloca(MemRefType::get({}, rewriter.getI1Type()));
+      Value bestScore = memref_alloca(MemRefType::get({}, elementType));
+      Value bestIndex = memref_alloca(MemRefType::get({}, indexType));
+      krnl_store(emitConstantOp(rewriter, loc, rewriter.getI1Type(), 0), done,
+          scalarAccess);
+      iterate({0}, {numBoxes}, false, [&](ValueRange boxIvs) {
+        Value score = krnl_load(scores, {b, c, boxIvs[0]});
+        Value isCandidate = rewriter.create<CmpFOp>(
+            loc, CmpFPredicate::OGT, score, scoreThreshold);
+        krnl_store(rewriter.create<SelectOp>(loc, isCandidate, score, negInf),
+            work, boxIvs);
+      });
+      if (paddedBoxes > numBoxes)
+        iterate({numBoxes}, {paddedBoxes}, false,
+            [&](ValueRange boxIvs) { krnl_store(negInf, work, boxIvs); });
+      Value workVectors = krnl_vector_type_cast(work, vectorLen);
+
+      iterate({0}, {maxSelected}, false, [&](ValueRange selectionIvs) {
+        Value t = selectionIvs[0];
+        Value isActive = rewriter.create<AndOp>(loc,
+            rewriter.create<XOrOp>(loc, krnl_load(done, scalarAccess),
+                emitConstantOp(rewriter, loc, rewriter.getI1Type(), 1)),
+            rewriter.create<CmpIOp>(
+                loc, CmpIPredicate::slt, t, maxOutputIndex));
+        auto activeIf = rewriter.create<scf::IfOp>(
+            loc, isActive, /*withElseRegion=*/false);
+        OpBuilder::InsertionGuard activeGuard(rewriter);
+        rewriter.setInsertionPointToStart(&activeIf.thenRegion().front());
+
+        // The best remaining box, the first one among equal scores.
+        krnl_store(negInf, bestScore, scalarAccess);
+        krnl_store(zeroIndex, bestIndex, scalarAccess);
+        iterate({0}, {numBoxes}, false, [&](ValueRange boxIvs) {
+          Value score = krnl_load(work, boxIvs);
+          Value best = krnl_load(bestScore, scalarAccess);
+          Value isBetter =
+              rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, score, best);
+          krnl_store(rewriter.create<SelectOp>(loc, isBetter, score, best),
+              bestScore, scalarAccess);
+          krnl_store(rewriter.create<SelectOp>(loc, isBetter, boxIvs[0],
+                         krnl_load(bestIndex, scalarAccess)),
+              bestIndex, scalarAccess);
+        });
+        Value isFound = rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT,
+            krnl_load(bestScore, scalarAccess), negInf);
+        auto foundIf = rewriter.create<scf::IfOp>(
+            loc, isFound, /*withElseRegion=*/true);
+        rewriter.setInsertionPointToStart(&foundIf.elseRegion().front());
+        krnl_store(emitConstantOp(rewriter, loc, rewriter.getI1Type(), 1),
+            done, scalarAccess);
+        rewriter.setInsertionPointToStart(&foundIf.thenRegion().front());
+
+        Value s = krnl_load(bestIndex, scalarAccess);
+        krnl_store(
+            rewriter.create<IndexCastOp>(loc, s, i64Type), selected, {b, c, t});
+        krnl_store(rewriter.create<AddIOp>(loc, t, oneIndex), counts, {b, c});
+        krnl_store(negInf, work, {s});
+
+        // Remove the boxes overlapping the selected box, as vectors.
+        SmallVector<Value, 5> selectedRows;
+        for (int64_t i = 0; i < 5; ++i)
+          selectedRows.emplace_back(rewriter.create<SplatOp>(loc, vectorType,
+              krnl_load(corners,
+                  {b, emitConstantOp(rewriter, loc, indexType, i), s})));
+        Value zeroVector = rewriter.create<SplatOp>(loc, vectorType, zero);
+        Value negInfVector = rewriter.create<SplatOp>(loc, vectorType, negInf);
+        Value thresholdVector =
+            rewriter.create<SplatOp>(loc, vectorType, iouThreshold);
+        iterate({0}, {paddedBoxes / vectorLen}, false,
+            [&](ValueRange vectorIvs) {
+          Value v = vectorIvs[0];
+          SmallVector<Value, 5> rows;
+          for (int64_t i = 0; i < 5; ++i)
+            rows.emplace_back(krnl_load(cornerVectors,
+                {b, emitConstantOp(rewriter, loc, indexType, i), v}));
+          Value height = getMax(zeroVector,
+              rewriter.create<SubFOp>(loc, getMin(rows[2], selectedRows[2]),
+                  getMax(rows[0], selectedRows[0])));
+          Value width = getMax(zeroVector,
+              rewriter.create<SubFOp>(loc, getMin(rows[3], selectedRows[3]),
+                  getMax(rows[1], selectedRows[1])));
+          Value intersection = rewriter.create<MulFOp>(loc, height, width);
+          Value unionArea = rewriter.create<SubFOp>(loc,
+              rewriter.create<AddFOp>(loc, rows[4], selectedRows[4]),
+              intersection);
+          // IoU > threshold, without dividing by an empty union.
+          Value isOverlapping = rewriter.create<CmpFOp>(loc,
+              CmpFPredicate::OGT, intersection,
+              rewriter.create<MulFOp>(loc, thresholdVector, unionArea));
+          Value workVector = krnl_load(workVectors, {v});
+          krnl_store(rewriter.create<SelectOp>(
+                         loc, isOverlapping, negInfVector, workVector),
+              workVectors, {v});
+        });
+      });
+    });
+
+    // Gather the selected boxes of the classes in order.
+    Value total = memref_alloca(MemRefType::get({}, indexType));
+    krnl_store(zeroIndex, total, scalarAccess);
+    iterate({0, 0}, {numBatches, numClasses}, false, [&](ValueRange ivs) {
+      krnl_store(rewriter.create<AddIOp>(loc, krnl_load(total, scalarAccess),
+                     krnl_load(counts, ivs)),
+          total, scalarAccess);
+    });
+    SmallVector<IndexExpr, 2> outputDims;
+    outputDims.emplace_back(SymbolIndexExpr(krnl_load(total, scalarAccess)));
+    outputDims.emplace_back(LiteralIndexExpr(3));
+    Value alloc = insertAllocAndDeallocSimple(rewriter, op, outputType, loc,
+        outputDims, checkInsertDealloc(op));
+    Value offset = memref_alloca(MemRefType::get({}, indexType));
+    krnl_store(zeroIndex, offset, scalarAccess);
+    iterate({0, 0}, {numBatches, numClasses}, false, [&](ValueRange ivs) {
+      Value b(ivs[0]), c(ivs[1]);
+      Value count = krnl_load(counts, ivs);
+      Value start = krnl_load(offset, scalarAccess);
+      auto selectedLoop =
+          rewriter.create<scf::ForOp>(loc, zeroIndex, count, oneIndex);
+      {
+        OpBuilder::InsertionGuard guard(rewriter);
+        rewriter.setInsertionPoint(selectedLoop.getBody()->getTerminator());
+        Value p = selectedLoop.getInductionVar();
+        Value row = rewriter.create<AddIOp>(loc, start, p);
+        Value columns[] = {rewriter.create<IndexCastOp>(loc, b, i64Type),
+            rewriter.create<IndexCastOp>(loc, c, i64Type),
+            krnl_load(selected, {b, c, p})};
+        for (int64_t i = 0; i < 3; ++i)
+          krnl_store(columns[i], alloc,
+              {row, emitConstantOp(rewriter, loc, indexType, i)});
+      }
+      krnl_store(rewriter.create<AddIOp>(loc, start, count), offset,
+          scalarAccess);
+    });
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXNonMaxSuppressionOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXNonMaxSuppressionOpLowering>(ctx);
+}
@@ -0,0 +1,93 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------- DequantizeLinear.cpp - Lowering DequantizeLinear Op -------===//
+//
+// Copyright 2019 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX DequantizeLinear Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+
+using namespace mlir;
+
+struct ONNXDequantizeLinearOpLowering : public ConversionPattern {
+  ONNXDequantizeLinearOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXDequantizeLinearOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXDequantizeLinearOpAdaptor operandAdaptor(operands);
+    ONNXDequantizeLinearOp dequantizeOp =
+        llvm::cast<ONNXDequantizeLinearOp>(op);
+    Location loc = op->getLoc();
+    Value input = operandAdaptor.x();
+    Value scale = operandAdaptor.x_scale();
+    Value zeroPoint = operandAdaptor.x_zero_point();
+
+    // The integer ops of the standard dialect only operate on signless types.
+    Type quantType = input.getType().cast<MemRefType>().getElementType();
+    if (!quantType.isSignlessInteger())
+      return emitError(loc, "DequantizeLinear only supports signless integer "
+                            "inputs");
+
+    // Insert an allocation and deallocation for the result of this operation.
+    MemRefType memRefType = convertToMemRefType(*op->result_type_begin());
+    Type elementType = memRefType.getElementType();
+    Value alloc;
+    bool insertDealloc = checkInsertDealloc(op);
+    if (hasAllConstantDimensions(memRefType))
+      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+    else
+      alloc = insertAllocAndDealloc(
+          memRefType, loc, rewriter, insertDealloc, {input});
+
+    // The per-axis parameters are indexed along the axis.
+    int64_t rank = memRefType.getRank();
+    int64_t axis = dequantizeOp.axis();
+    if (axis < 0)
+      axis += rank;
+
+    SmallVector<Value, 4> loopIVs;
+    if (rank > 0) {
+      BuildKrnlLoop loops(rewriter, loc, rank);
+      loops.createDefineAndIterateOp(input);
+      rewriter.setInsertionPointToStart(loops.getIterateBlock());
+      for (auto arg : loops.getIterateBlock()->getArguments())
+        loopIVs.emplace_back(arg);
+    }
+    Value axisIndex = (axis >= 0 && axis < rank) ? loopIVs[axis] : nullptr;
+
+    // y = (x - zeroPoint) * scale, the difference being computed in 32 bits
+    // to avoid overflows.
+    Type i32Type = rewriter.getIntegerType(32);
+    auto extend = [&](Value val) -> Value {
+      if (quantType.getIntOrFloatBitWidth() >= 32)
+        return val;
+      return rewriter.create<SignExtendIOp>(loc, val, i32Type);
+    };
+    Value x = extend(rewriter.create<KrnlLoadOp>(loc, input, loopIVs));
+    Value zeroPointVal =
+        loadQuantizationParam(rewriter, loc, zeroPoint, axisIndex);
+    if (zeroPointVal)
+      x = rewriter.create<SubIOp>(loc, x, extend(zeroPointVal));
+    Value scaleVal = loadQuantizationParam(rewriter, loc, scale, axisIndex);
+    Value res = rewriter.create<MulFOp>(
+        loc, rewriter.create<SIToFPOp>(loc, elementType, x), scaleVal);
+    rewriter.create<KrnlStoreOp>(loc, res, alloc, loopIVs);
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXDequantizeLinearOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXDequantizeLinearOpLowering>(ctx);
+}
@@ -0,0 +1,297 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- MatMulInteger.cpp - Lowering quantized MatMul Ops ------------===//
+//
+// Copyright 2019 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX MatMulInteger and QLinearMatMul Operators to Krnl
+// dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+#include "src/Dialect/ONNX/IndexExpr.hpp"
+
+#include "mlir/Dialect/MemRef/EDSC/Intrinsics.h"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+
+using namespace mlir;
+
+/// Emit Y = (A - aZeroPoint) * (B - bZeroPoint) for int8 A [..., I, K] and B
+/// [K, J], accumulated in the i32 Y [..., I, J]. The products of the raw
+/// int8 values are computed by the tiled matrix multiply, and the zero points
+/// are then accounted for with the row sums of A and the column sums of B:
+///
+///   Y[i, j] -= bZero[j] * rowSum(A)[i] + aZero[i] * colSum(B)[j]
+///              - K * aZero[i] * bZero[j]
+///
+/// The zero points are optional, A has per-row and B per-column zero points.
+static void emitIntegerMatMul(ConversionPatternRewriter &rewriter,
+    Location loc, Value A, Value aZeroPoint, Value B, Value bZeroPoint,
+    Value Y, const MatMulTileSizes &tileSizes) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+  ScopedContext scope(rewriter, loc);
+
+  Type i32Type = rewriter.getIntegerType(32);
+  Value zeroVal = emitConstantOp(rewriter, loc, i32Type, 0);
+  auto extend = [&](Value val) -> Value {
+    return rewriter.create<SignExtendIOp>(loc, val, i32Type);
+  };
+
+  MemRefBoundsIndexCapture aBounds(A), bBounds(B);
+  int aRank = aBounds.getRank();
+  int batchRank = aRank - 2;
+  IndexExpr I(aBounds.getDim(aRank - 2)), K(aBounds.getDim(aRank - 1)),
+      J(bBounds.getDim(1));
+  LiteralIndexExpr zeroIE(0);
+  SmallVector<Value, 1> scalarAccess; // Empty.
+  bool hasAZeroPoint = !aZeroPoint.getType().isa<NoneType>();
+  bool hasBZeroPoint = !bZeroPoint.getType().isa<NoneType>();
+
+  // The column sums of B are shared by all the batches.
+  Value colSums;
+  if (hasAZeroPoint) {
+    SmallVector<IndexExpr, 1> colSumDims = {J};
+    MemRefType colSumType =
+        MemRefType::get({J.isLiteral() ? J.getLiteral() : -1}, i32Type);
+    colSums = insertAllocAndDeallocSimple(rewriter, nullptr, colSumType, loc,
+        colSumDims, /*insertDealloc=*/true);
+    ValueRange jLoop = krnl_define_loop(1);
+    krnl_iterate_ie(jLoop, {zeroIE}, {J}, {}, [&](ValueRange args) {
+      Value j = krnl_get_induction_var_value(jLoop)[0];
+      Value sum = memref_alloca(MemRefType::get({}, i32Type));
+      krnl_store(zeroVal, sum, scalarAccess);
+      ValueRange kLoop = krnl_define_loop(1);
+      krnl_iterate_ie(kLoop, {zeroIE}, {K}, {}, [&](ValueRange args) {
+        Value k = krnl_get_induction_var_value(kLoop)[0];
+        Value b = extend(krnl_load(B, {k, j}));
+        Value sumVal = krnl_load(sum, scalarAccess);
+        krnl_store(rewriter.create<AddIOp>(loc, sumVal, b), sum, scalarAccess);
+      });
+      krnl_store(krnl_load(sum, scalarAccess), colSums, {j});
+    });
+  }
+
+  // Emit the matrix multiply of the batch given by the batch indices.
+  auto emitMatrixMultiply = [&](ValueRange batchIndices) {
+    IndexExprScope innerScope;
+    SymbolIndexExpr i(I), j(J), k(K);
+    auto withPrefix = [&](ValueRange indices) {
+      SmallVector<Value, 4> res(batchIndices.begin(), batchIndices.end());
+      res.append(indices.begin(), indices.end());
+      return res;
+    };
+
+    // Initialize the result matrix to zero.
+    ValueRange zLoop = krnl_define_loop(2);
+    krnl_iterate_ie(zLoop, {zeroIE, zeroIE}, {i, j}, {}, [&](ValueRange args) {
+      ValueRange indices = krnl_get_induction_var_value(zLoop);
+      krnl_store(zeroVal, Y, withPrefix(indices));
+    });
+
+    emitTiledMatMul(A, batchIndices, B, {}, Y, batchIndices, i, j, k, zeroVal,
+        tileSizes, /*parallelize=*/batchRank == 0);
+    if (!hasAZeroPoint && !hasBZeroPoint)
+      return;
+
+    // Subtract the contributions of the zero points.
+    Value kVal = rewriter.create<IndexCastOp>(loc, k.getValue(), i32Type);
+    ValueRange iLoop = krnl_define_loop(1);
+    krnl_iterate_ie(iLoop, {zeroIE}, {i}, {}, [&](ValueRange args) {
+      Value ii = krnl_get_induction_var_value(iLoop)[0];
+      Value aZero;
+      if (hasAZeroPoint)
+        aZero = extend(loadQuantizationParam(rewriter, loc, aZeroPoint, ii));
+      Value rowSum;
+      if (hasBZeroPoint) {
+        Value sum = memref_alloca(MemRefType::get({}, i32Type));
+        krnl_store(zeroVal, sum, scalarAccess);
+        ValueRange kLoop = krnl_define_loop(1);
+        krnl_iterate_ie(kLoop, {zeroIE}, {k}, {}, [&](ValueRange args) {
+          Value kk = krnl_get_induction_var_value(kLoop)[0];
+          Value a = extend(krnl_load(A, withPrefix({ii, kk})));
+          Value sumVal = krnl_load(sum, scalarAccess);
+          krnl_store(
+              rewriter.create<AddIOp>(loc, sumVal, a), sum, scalarAccess);
+        });
+        rowSum = krnl_load(sum, scalarAccess);
+      }
+      ValueRange jLoop = krnl_define_loop(1);
+      krnl_iterate_ie(jLoop, {zeroIE}, {j}, {}, [&](ValueRange args) {
+        Value jj = krnl_get_induction_var_value(jLoop)[0];
+        Value correction = zeroVal;
+        Value bZero;
+        if (hasBZeroPoint) {
+          bZero = extend(loadQuantizationParam(rewriter, loc, bZeroPoint, jj));
+          correction = rewriter.create<MulIOp>(loc, bZero, rowSum);
+        }
+        if (hasAZeroPoint) {
+          Value colSum = krnl_load(colSums, {jj});
+          correction = rewriter.create<AddIOp>(
+              loc, correction, rewriter.create<MulIOp>(loc, aZero, colSum));
+        }
+        if (hasAZeroPoint && hasBZeroPoint) {
+          Value zeroProduct = rewriter.create<MulIOp>(
+              loc, kVal, rewriter.create<MulIOp>(loc, aZero, bZero));
+          correction = rewriter.create<SubIOp>(loc, correction, zeroProduct);
+        }
+        SmallVector<Value, 4> yIndices = withPrefix({ii, jj});
+        krnl_store(
+            rewriter.create<SubIOp>(loc, krnl_load(Y, yIndices), correction),
+            Y, yIndices);
+      });
+    });
+  };
+
+  if (batchRank == 0) {
+    emitMatrixMultiply({});
+    return;
+  }
+  ValueRange batchLoops = krnl_define_loop(batchRank);
+  krnl_parallel(batchLoops[0]);
+  SmallVector<IndexExpr, 4> batchLbs(batchRank, zeroIE);
+  SmallVector<IndexExpr, 4> batchUbs;
+  for (int d = 0; d < batchRank; ++d)
+    batchUbs.emplace_back(aBounds.getDim(d));
+  krnl_iterate_ie(batchLoops, batchLbs, batchUbs, {}, [&](ValueRange args) {
+    emitMatrixMultiply(krnl_get_induction_var_value(batchLoops));
+  });
+}
+
+/// Check that A and B can be lowered by emitIntegerMatMul.
+static LogicalResult checkIntegerMatMulOperands(
+    Location loc, Value A, Value B) {
+  auto aType = A.getType().cast<MemRefType>();
+  auto bType = B.getType().cast<MemRefType>();
+  // The integer ops of the standard dialect only operate on signless types.
+  if (!aType.getElementType().isSignlessInteger(8) ||
+      !bType.getElementType().isSignlessInteger(8))
+    return emitError(loc, "only signless 8-bit integer matrices are supported");
+  if (aType.getRank() < 2 || bType.getRank() != 2)
+    return emitError(loc, "only [..., I, K] x [K, J] matrices are supported");
+  return success();
+}
+
+/// Return the output dims of the [..., I, K] x [K, J] matrix multiply.
+static SmallVector<IndexExpr, 4> getIntegerMatMulOutputDims(Value A, Value B) {
+  MemRefBoundsIndexCapture aBounds(A), bBounds(B);
+  SmallVector<IndexExpr, 4> outputDims;
+  for (int d = 0; d < aBounds.getRank() - 1; ++d)
+    outputDims.emplace_back(aBounds.getDim(d));
+  outputDims.emplace_back(bBounds.getDim(1));
+  return outputDims;
+}
+
+struct ONNXMatMulIntegerOpLowering : public ConversionPattern {
+  MatMulTileSizes tileSizes;
+
+  ONNXMatMulIntegerOpLowering(MLIRContext *ctx,
+      const MatMulTileSizes &tileSizes = MatMulTileSizes())
+      : ConversionPattern(
+            mlir::ONNXMatMulIntegerOp::getOperationName(), 1, ctx) {
+    this->tileSizes = tileSizes;
+  }
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXMatMulIntegerOpAdaptor operandAdaptor(operands);
+    Location loc = op->getLoc();
+    Value A(operandAdaptor.A()), B(operandAdaptor.B());
+    if (failed(checkIntegerMatMulOperands(loc, A, B)))
+      return failure();
+
+    // Insert an allocation and deallocation for the output of this operation.
+    IndexExprScope outerScope(&rewriter, loc);
+    MemRefType outputMemRefType = convertToMemRefType(*op->result_type_begin());
+    SmallVector<IndexExpr, 4> outputDims = getIntegerMatMulOutputDims(A, B);
+    Value alloc = insertAllocAndDeallocSimple(
+        rewriter, op, outputMemRefType, loc, outputDims);
+
+    emitIntegerMatMul(rewriter, loc, A, operandAdaptor.a_zero_point(), B,
+        operandAdaptor.b_zero_point(), alloc, tileSizes);
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+struct ONNXQLinearMatMulOpLowering : public ConversionPattern {
+  MatMulTileSizes tileSizes;
+
+  ONNXQLinearMatMulOpLowering(MLIRContext *ctx,
+      const MatMulTileSizes &tileSizes = MatMulTileSizes())
+      : ConversionPattern(
+            mlir::ONNXQLinearMatMulOp::getOperationName(), 1, ctx) {
+    this->tileSizes = tileSizes;
+  }
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXQLinearMatMulOpAdaptor operandAdaptor(operands);
+    Location loc = op->getLoc();
+    Value A(operandAdaptor.a()), B(operandAdaptor.b());
+    if (failed(checkIntegerMatMulOperands(loc, A, B)))
+      return failure();
+    MemRefType outputMemRefType = convertToMemRefType(*op->result_type_begin());
+    Type quantType = outputMemRefType.getElementType();
+    if (!quantType.isSignlessInteger(8))
+      return emitError(
+          loc, "only signless 8-bit integer results are supported");
+
+    // Accumulate the products in a temporary i32 buffer.
+    IndexExprScope outerScope(&rewriter, loc);
+    SmallVector<IndexExpr, 4> outputDims = getIntegerMatMulOutputDims(A, B);
+    Value alloc = insertAllocAndDeallocSimple(
+        rewriter, op, outputMemRefType, loc, outputDims);
+    MemRefType accMemRefType = MemRefType::get(
+        outputMemRefType.getShape(), rewriter.getIntegerType(32));
+    Value acc = insertAllocAndDeallocSimple(
+        rewriter, op, accMemRefType, loc, outputDims, /*insertDealloc=*/true);
+    emitIntegerMatMul(rewriter, loc, A, operandAdaptor.a_zero_point(), B,
+        operandAdaptor.b_zero_point(), acc, tileSizes);
+
+    // Requantize: y = saturate(round(acc * aScale * bScale / yScale) + yZero).
+    // The scales of A are per row and the ones of B per column.
+    Type floatType =
+        operandAdaptor.y_scale().getType().cast<MemRefType>().getElementType();
+    int rank = outputMemRefType.getRank();
+    BuildKrnlLoop loops(rewriter, loc, rank);
+    loops.createDefineOp();
+    loops.pushAllBounds(outputDims);
+    loops.createIterateOp();
+    rewriter.setInsertionPointToStart(loops.getIterateBlock());
+    SmallVector<Value, 4> loopIVs;
+    for (auto arg : loops.getIterateBlock()->getArguments())
+      loopIVs.emplace_back(arg);
+    Value i(loopIVs[rank - 2]), j(loopIVs[rank - 1]);
+    Value aScale =
+        loadQuantizationParam(rewriter, loc, operandAdaptor.a_scale(), i);
+    Value bScale =
+        loadQuantizationParam(rewriter, loc, operandAdaptor.b_scale(), j);
+    Value yScale =
+        loadQuantizationParam(rewriter, loc, operandAdaptor.y_scale(), j);
+    Value yZero =
+        loadQuantizationParam(rewriter, loc, operandAdaptor.y_zero_point(), j);
+    Value scale = rewriter.create<DivFOp>(
+        loc, yScale, rewriter.create<MulFOp>(loc, aScale, bScale));
+    Value accVal = rewriter.create<SIToFPOp>(
+        loc, floatType, rewriter.create<KrnlLoadOp>(loc, acc, loopIVs));
+    Value res = emitQuantize(rewriter, loc, accVal, scale, yZero, quantType);
+    rewriter.create<KrnlStoreOp>(loc, res, alloc, loopIVs);
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXMatMulIntegerOpPattern(RewritePatternSet &patterns,
+    MLIRContext *ctx, const MatMulTileSizes &tileSizes) {
+  patterns.insert<ONNXMatMulIntegerOpLowering>(ctx, tileSizes);
+  patterns.insert<ONNXQLinearMatMulOpLowering>(ctx, tileSizes);
+}
@@ -0,0 +1,202 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===--------------- QLinearConv.cpp - Lowering QLinearConv Op ------------===//
+//
+// Copyright 2019 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX QLinearConv Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+
+using namespace mlir;
+
+static SmallVector<int64_t, 4> getIntArrayAttr(ArrayAttr attr) {
+  SmallVector<int64_t, 4> values;
+  for (Attribute value : attr.getValue())
+    values.emplace_back(value.cast<IntegerAttr>().getInt());
+  return values;
+}
+
+struct ONNXQLinearConvOpLowering : public ConversionPattern {
+  ONNXQLinearConvOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXQLinearConvOp::getOperationName(), 1, ctx) {
+  }
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXQLinearConvOpAdaptor operandAdaptor(operands);
+    ONNXQLinearConvOp convOp = llvm::cast<ONNXQLinearConvOp>(op);
+    Location loc = op->getLoc();
+    Value input = operandAdaptor.x();
+    Value kernel = operandAdaptor.w();
+    Value bias = operandAdaptor.B();
+    bool hasBias = !bias.getType().isa<NoneType>();
+
+    // The integer ops of the standard dialect only operate on signless types.
+    MemRefType memRefType = convertToMemRefType(*op->result_type_begin());
+    Type quantType = memRefType.getElementType();
+    if (!quantType.isSignlessInteger(8) ||
+        !input.getType()
+             .cast<MemRefType>()
+             .getElementType()
+             .isSignlessInteger(8) ||
+        !kernel.getType()
+             .cast<MemRefType>()
+             .getElementType()
+             .isSignlessInteger(8))
+      return emitError(loc, "QLinearConv only supports signless 8-bit "
+                            "integer inputs and results");
+    auto kernelShape = kernel.getType().cast<MemRefType>().getShape();
+    if (kernelShape[0] < 0 || kernelShape[1] < 0)
+      return emitError(loc, "QLinearConv requires static numbers of channels");
+
+    // The attributes are all set by the shape inference.
+    SmallVector<int64_t, 4> pads = getIntArrayAttr(convOp.padsAttr());
+    SmallVector<int64_t, 4> strides = getIntArrayAttr(convOp.stridesAttr());
+    SmallVector<int64_t, 4> dilations =
+        getIntArrayAttr(convOp.dilationsAttr());
+    int64_t group = convOp.group();
+    int64_t kernelsPerGroup = kernelShape[0] / group;
+    int64_t channelsPerGroup = kernelShape[1];
+
+    // Insert an allocation and deallocation for the result of this operation.
+    Value alloc;
+    bool insertDealloc = checkInsertDealloc(op);
+    if (hasAllConstantDimensions(memRefType))
+      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+    else
+      alloc = insertAllocAndDealloc(
+          memRefType, loc, rewriter, insertDealloc, {input});
+
+    // Y[n][m][r1]..[rd] = requantize(B[m] + sum over c, k1, .., kd of
+    //     (X[n][g * C/group + c][r1 * s1 - pt1 + k1 * d1]..[..] - xZero) *
+    //     (W[m][c][k1]..[kd] - wZero[m]))
+    // with g = m / (M/group), the padded elements of X contributing zero. The
+    // products are accumulated in 32-bit integers.
+    int spatialStartIndex = 2;
+    int64_t nSpatialLoops = memRefType.getRank() - spatialStartIndex;
+    Type i32Type = rewriter.getIntegerType(32);
+    Value zeroI32 = emitConstantOp(rewriter, loc, i32Type, 0);
+    auto extend = [&](Value val) -> Value {
+      return rewriter.create<SignExtendIOp>(loc, val, i32Type);
+    };
+    auto indexConst = [&](int64_t val) -> Value {
+      return rewriter.create<ConstantIndexOp>(loc, val);
+    };
+
+    // 1. Define the loops over the outputs, in parallel along the kernels.
+    BuildKrnlLoop outerLoops(rewriter, loc, spatialStartIndex + nSpatialLoops);
+    outerLoops.createDefineOp();
+    int nIndex = outerLoops.pushBounds(0, input, 0);
+    int mIndex = outerLoops.pushBounds(0, kernelShape[0]);
+    for (int i = spatialStartIndex; i < memRefType.getRank(); ++i)
+      outerLoops.pushBounds(0, alloc, i);
+    outerLoops.parallelizeLoop(mIndex);
+    outerLoops.createIterateOp();
+    rewriter.setInsertionPointToStart(outerLoops.getIterateBlock());
+
+    Value n = outerLoops.getInductionVar(nIndex);
+    Value m = outerLoops.getInductionVar(mIndex);
+    SmallVector<Value, 4> outputIndices;
+    for (int i = 0; i < spatialStartIndex + nSpatialLoops; ++i)
+      outputIndices.emplace_back(outerLoops.getInductionVar(i));
+    Value channelStart = rewriter.create<MulIOp>(loc,
+        rewriter.create<UnsignedDivIOp>(loc, m, indexConst(kernelsPerGroup)),
+        indexConst(channelsPerGroup));
+
+    Value xZero = loadQuantizationParam(
+        rewriter, loc, operandAdaptor.x_zero_point(), nullptr);
+    Value wZero =
+        loadQuantizationParam(rewriter, loc, operandAdaptor.w_zero_point(), m);
+    SmallVector<Value, 1> scalarAccess; // Empty.
+    Value acc = rewriter.create<memref::AllocaOp>(
+        loc, MemRefType::get({}, i32Type));
+    Value initVal = zeroI32;
+    if (hasBias)
+      initVal = rewriter.create<KrnlLoadOp>(loc, bias, m);
+    rewriter.create<KrnlStoreOp>(loc, initVal, acc, scalarAccess);
+
+    // 2. Define the reduction loops over the channels of the group and the
+    // kernel window.
+    BuildKrnlLoop innerLoops(rewriter, loc, 1 + nSpatialLoops);
+    innerLoops.createDefineOp();
+    innerLoops.pushBounds(0, kernel, 1);
+    for (int i = spatialStartIndex; i < kernelShape.size(); ++i)
+      innerLoops.pushBounds(0, kernel, i);
+    innerLoops.createIterateOp();
+    auto ipOuterLoopRegion = rewriter.saveInsertionPoint();
+    rewriter.setInsertionPointToStart(innerLoops.getIterateBlock());
+    {
+      Value c = innerLoops.getInductionVar(0);
+      SmallVector<Value, 4> inputIndices = {
+          n, rewriter.create<AddIOp>(loc, channelStart, c)};
+      SmallVector<Value, 4> kernelIndices = {m, c};
+      Value inBounds;
+      for (int i = 0; i < nSpatialLoops; ++i) {
+        Value r = outputIndices[spatialStartIndex + i];
+        Value k = innerLoops.getInductionVar(1 + i);
+        kernelIndices.emplace_back(k);
+        // h = r * s - pt + k * d, skipped when in the padding.
+        Value h = rewriter.create<SubIOp>(loc,
+            rewriter.create<AddIOp>(loc,
+                rewriter.create<MulIOp>(loc, r, indexConst(strides[i])),
+                rewriter.create<MulIOp>(loc, k, indexConst(dilations[i]))),
+            indexConst(pads[i]));
+        Value dim = rewriter.create<memref::DimOp>(
+            loc, input, spatialStartIndex + i);
+        Value valid = rewriter.create<AndOp>(loc,
+            rewriter.create<CmpIOp>(loc, CmpIPredicate::sge, h, indexConst(0)),
+            rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, h, dim));
+        inBounds =
+            (i == 0) ? valid : rewriter.create<AndOp>(loc, inBounds, valid);
+        inputIndices.emplace_back(
+            rewriter.create<SelectOp>(loc, valid, h, indexConst(0)));
+      }
+
+      Value x = extend(rewriter.create<KrnlLoadOp>(loc, input, inputIndices));
+      if (xZero)
+        x = rewriter.create<SubIOp>(loc, x, extend(xZero));
+      if (inBounds)
+        x = rewriter.create<SelectOp>(loc, inBounds, x, zeroI32);
+      Value w = extend(rewriter.create<KrnlLoadOp>(loc, kernel, kernelIndices));
+      if (wZero)
+        w = rewriter.create<SubIOp>(loc, w, extend(wZero));
+      Value accVal = rewriter.create<KrnlLoadOp>(loc, acc, scalarAccess);
+      accVal = rewriter.create<AddIOp>(
+          loc, accVal, rewriter.create<MulIOp>(loc, x, w));
+      rewriter.create<KrnlStoreOp>(loc, accVal, acc, scalarAccess);
+    }
+    rewriter.restoreInsertionPoint(ipOuterLoopRegion);
+
+    // 3. Requantize: y = saturate(round(acc * xScale * wScale / yScale) +
+    // yZero).
+    Value xScale = loadQuantizationParam(
+        rewriter, loc, operandAdaptor.x_scale(), nullptr);
+    Value wScale =
+        loadQuantizationParam(rewriter, loc, operandAdaptor.w_scale(), m);
+    Value yScale = loadQuantizationParam(
+        rewriter, loc, operandAdaptor.y_scale(), nullptr);
+    Value yZero = loadQuantizationParam(
+        rewriter, loc, operandAdaptor.y_zero_point(), nullptr);
+    Value scale = rewriter.create<DivFOp>(
+        loc, yScale, rewriter.create<MulFOp>(loc, xScale, wScale));
+    Value accVal = rewriter.create<SIToFPOp>(loc, xScale.getType(),
+        rewriter.create<KrnlLoadOp>(loc, acc, scalarAccess));
+    Value res = emitQuantize(rewriter, loc, accVal, scale, yZero, quantType);
+    rewriter.create<KrnlStoreOp>(loc, res, alloc, outputIndices);
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXQLinearConvOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXQLinearConvOpLowering>(ctx);
+}
@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ QuantizeLinear.cpp - Lowering QuantizeLinear Op ---------===//
+//
+// Copyright 2019 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX QuantizeLinear Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+
+using namespace mlir;
+
+struct ONNXQuantizeLinearOpLowering : public ConversionPattern {
+  ONNXQuantizeLinearOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXQuantizeLinearOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXQuantizeLinearOpAdaptor operandAdaptor(operands);
+    ONNXQuantizeLinearOp quantizeOp = llvm::cast<ONNXQuantizeLinearOp>(op);
+    Location loc = op->getLoc();
+    Value input = operandAdaptor.x();
+    Value scale = operandAdaptor.y_scale();
+    Value zeroPoint = operandAdaptor.y_zero_point();
+
+    // The integer ops of the standard dialect only operate on signless types.
+    MemRefType memRefType = convertToMemRefType(*op->result_type_begin());
+    Type quantType = memRefType.getElementType();
+    if (!quantType.isSignlessInteger(8))
+      return emitError(loc, "QuantizeLinear only supports signless 8-bit "
+                            "integer results");
+    if (!input.getType().cast<MemRefType>().getElementType().isa<FloatType>())
+      return emitError(loc, "QuantizeLinear only supports float inputs");
+
+    // Insert an allocation and deallocation for the result of this operation.
+    Value alloc;
+    bool insertDealloc = checkInsertDealloc(op);
+    if (hasAllConstantDimensions(memRefType))
+      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+    else
+      alloc = insertAllocAndDealloc(
+          memRefType, loc, rewriter, insertDealloc, {input});
+
+    // The per-axis parameters are indexed along the axis.
+    int64_t rank = memRefType.getRank();
+    int64_t axis = quantizeOp.axis();
+    if (axis < 0)
+      axis += rank;
+
+    SmallVector<Value, 4> loopIVs;
+    if (rank > 0) {
+      BuildKrnlLoop loops(rewriter, loc, rank);
+      loops.createDefineAndIterateOp(input);
+      rewriter.setInsertionPointToStart(loops.getIterateBlock());
+      for (auto arg : loops.getIterateBlock()->getArguments())
+        loopIVs.emplace_back(arg);
+    }
+    Value axisIndex = (axis >= 0 && axis < rank) ? loopIVs[axis] : nullptr;
+
+    Value x = rewriter.create<KrnlLoadOp>(loc, input, loopIVs);
+    Value scaleVal = loadQuantizationParam(rewriter, loc, scale, axisIndex);
+    Value zeroPointVal =
+        loadQuantizationParam(rewriter, loc, zeroPoint, axisIndex);
+    Value res =
+        emitQuantize(rewriter, loc, x, scaleVal, zeroPointVal, quantType);
+    rewriter.create<KrnlStoreOp>(loc, res, alloc, loopIVs);
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXQuantizeLinearOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXQuantizeLinearOpLowering>(ctx);
+}
@@ -34,9 +34,8 @@ struct GruActivationPack {
 };
 
 struct GruWeightPack {
-  Value Wz;
-  Value Wr;
-  Value Wh;
+  // Parameter weights of all the gates: [input_size, 3*hidden_size].
+  Value W;
   Value Rz;
   Value Rr;
   Value Rh;
@@ -181,10 +180,9 @@ getWeightPack<ONNXGRUOp, GruWeightPack>(
   // MemRef types for parameter weights.
   auto w3DTy = MemRefType::get({1, 3 * hiddenSize, inputSize}, elementType);
   auto w2DTy = MemRefType::get({3 * hiddenSize, inputSize}, elementType);
-  auto wSplit2DTy = MemRefType::get({hiddenSize, inputSize}, elementType);
-  auto wTranspose2DTy = MemRefType::get({inputSize, hiddenSize}, elementType);
+  auto wTranspose2DTy =
+      MemRefType::get({inputSize, 3 * hiddenSize}, elementType);
   SmallVector<Type, 2> w3D2Ty(2, w3DTy);
-  SmallVector<Type, 3> wSplit2D3Ty(3, wSplit2DTy);
 
   // MemRef types for recurrence weights.
   auto r3DTy = MemRefType::get({1, 3 * hiddenSize, hiddenSize}, elementType);
@@ -217,20 +215,16 @@ getWeightPack<ONNXGRUOp, GruWeightPack>(
     bR = foldOrEmitONNXSqueezeOp(rewriter, loc, r2DTy, vals[1], /*axis=*/0);
   }
 
-  // Split W and R into individual weight tensors, and transpose them.
+  // Transpose W as a whole, since the projections of the inputs onto all the
+  // gates are computed at once. Split R into individual weight tensors, and
+  // transpose them.
   if (direction == FORWARD || direction == BIDIRECTIONAL) {
     // W
-    std::vector<Value> vals =
-        foldOrEmitONNXSplitOp(rewriter, loc, wSplit2D3Ty, fW, 0);
-    weightForward.Wz = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[0], permAttr);
-    weightForward.Wr = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[1], permAttr);
-    weightForward.Wh = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[2], permAttr);
+    weightForward.W =
+        foldOrEmitONNXTransposeOp(rewriter, loc, wTranspose2DTy, fW, permAttr);
     // R
-    vals.clear();
-    vals = foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D3Ty, fR, 0);
+    std::vector<Value> vals =
+        foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D3Ty, fR, 0);
     weightForward.Rz = foldOrEmitONNXTransposeOp(
         rewriter, loc, rTranspose2DTy, vals[0], permAttr);
     weightForward.Rr = foldOrEmitONNXTransposeOp(
@@ -240,17 +234,11 @@ getWeightPack<ONNXGRUOp, GruWeightPack>(
   }
   if (direction == REVERSE || direction == BIDIRECTIONAL) {
     // W
-    std::vector<Value> vals =
-        foldOrEmitONNXSplitOp(rewriter, loc, wSplit2D3Ty, bW, 0);
-    weightReverse.Wz = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[0], permAttr);
-    weightReverse.Wr = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[1], permAttr);
-    weightReverse.Wh = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[2], permAttr);
+    weightReverse.W =
+        foldOrEmitONNXTransposeOp(rewriter, loc, wTranspose2DTy, bW, permAttr);
     // R
-    vals.clear();
-    vals = foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D3Ty, bR, 0);
+    std::vector<Value> vals =
+        foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D3Ty, bR, 0);
     weightReverse.Rz = foldOrEmitONNXTransposeOp(
         rewriter, loc, rTranspose2DTy, vals[0], permAttr);
     weightReverse.Rr = foldOrEmitONNXTransposeOp(
@@ -330,7 +318,7 @@ std::tuple<GruBiasPack, GruBiasPack> getBiasPack<ONNXGRUOp, GruBiasPack>(
 template <>
 GruState allocAndInitializeStates<ONNXGRUOp, GruState>(
     ConversionPatternRewriter &rewriter, Location loc, ONNXGRUOp *op,
-    typename ONNXGRUOp::Adaptor operandAdaptor) {
+    typename ONNXGRUOp::Adaptor operandAdaptor, bool persistentStates) {
   GruState state;
 
   // direction
@@ -346,24 +334,34 @@ GruState allocAndInitializeStates<ONNXGRUOp, GruState>(
       operandAdaptor.W(), operandAdaptor.R(), op->Y_h(),
       checkInsertDealloc(op->getOperation(), 1));
 
-  // Insert allocation and deallocation the intermedidate Ht for the forward and
-  // reverse directions.
-  // Ht :: [batch_size, hidden_size]
-  if (direction == FORWARD || direction == BIDIRECTIONAL) {
-    state.forwardHt = allocIntermediateState(
+  if (persistentStates &&
+      hasPersistentStates(operandAdaptor.X(), operandAdaptor.R(), direction,
+          {operandAdaptor.initial_h()})) {
+    // The state continues from that of the previous call, without being
+    // initialized.
+    state.forwardHt = getPersistentState(
         rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
-  }
-  if (direction == REVERSE || direction == BIDIRECTIONAL) {
-    state.reverseHt = allocIntermediateState(
-        rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
-  }
+  } else {
+    // Insert allocation and deallocation the intermedidate Ht for the forward
+    // and reverse directions.
+    // Ht :: [batch_size, hidden_size]
+    if (direction == FORWARD || direction == BIDIRECTIONAL) {
+      state.forwardHt = allocIntermediateState(
+          rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
+    }
+    if (direction == REVERSE || direction == BIDIRECTIONAL) {
+      state.reverseHt = allocIntermediateState(
+          rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
+    }
 
-  // Initialize Ht.
-  Value noneValue;
-  initializeIntermediateStates(rewriter, loc, state.forwardHt, state.reverseHt,
-      noneValue, noneValue, operandAdaptor.initial_h(), noneValue,
-      operandAdaptor.X().getType().cast<MemRefType>().getElementType(),
-      direction, /*onlyHidden=*/true);
+    // Initialize Ht.
+    Value noneValue;
+    initializeIntermediateStates(rewriter, loc, state.forwardHt,
+        state.reverseHt, noneValue, noneValue, operandAdaptor.initial_h(),
+        noneValue,
+        operandAdaptor.X().getType().cast<MemRefType>().getElementType(),
+        direction, /*onlyHidden=*/true);
+  }
 
   // Obtain the value of 'linear_before_reset' attribute.
   int64_t linearBeforeResetAttr = op->linear_before_reset();
@@ -376,9 +374,10 @@ GruState allocAndInitializeStates<ONNXGRUOp, GruState>(
 
 template <>
 void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
-    ConversionPatternRewriter &rewriter, Location loc, Value Xt, GruState state,
+    ConversionPatternRewriter &rewriter, Location loc, Value XW, GruState state,
     GruActivationPack activationPack, GruWeightPack weightPack,
-    GruBiasPack biasPack, Value sequenceIV, Value directionIV, bool isForward) {
+    GruBiasPack biasPack, Value sequenceIV, Value directionIV, bool isForward,
+    RNNPackedBatch packedBatch) {
   // Equations (Default: f=Sigmoid, g=Tanh):"
   // zt = f(Xt*(Wz^T) + Ht-1*(Rz^T) + Wbz + Rbz)"
   // rt = f(Xt*(Wr^T) + Ht-1*(Rr^T) + Wbr + Rbr)"
@@ -397,14 +396,33 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
   MemRefType matrixType = Ht.getType().cast<MemRefType>();
   Type elementType = matrixType.getElementType();
 
-  // Common matrix multiplications.
-  Value XtWz = onnx_matmul(matrixType, Xt, weightPack.Wz);
-  Value HtRz = onnx_matmul(matrixType, Ht, weightPack.Rz);
-  Value XtWr = onnx_matmul(matrixType, Xt, weightPack.Wr);
-  Value HtRr = onnx_matmul(matrixType, Ht, weightPack.Rr);
-  Value XtWh = onnx_matmul(matrixType, Xt, weightPack.Wh);
+  // Common matrix multiplications. The projections of Xt onto the parameter
+  // weights were computed for all the timesteps at once, in XW.
+  // With sequence_lens, the rows of the states are in the order of the packed
+  // batch in the results, and in rt.
+  Value HtRz, HtRr, HtRh;
+  if (packedBatch.order) {
+    Value packedHt = emitPackedState(rewriter, loc, Ht, packedBatch);
+    SmallVector<Value, 4> Rs = {weightPack.Rz, weightPack.Rr};
+    if (state.linearBeforeReset)
+      Rs.emplace_back(weightPack.Rh);
+    SmallVector<Value, 4> results =
+        emitPackedMatMuls(rewriter, loc, packedHt, Rs, packedBatch, sequenceIV);
+    HtRz = results[0];
+    HtRr = results[1];
+    if (state.linearBeforeReset)
+      HtRh = results[2];
+  } else {
+    HtRz = onnx_matmul(matrixType, Ht, weightPack.Rz);
+    HtRr = onnx_matmul(matrixType, Ht, weightPack.Rr);
+  }
   Value one = emitConstantOp(rewriter, loc, elementType, 1);
 
+  // The gates are in the order z, r, h along the columns of XW.
+  int64_t hiddenSize = matrixType.getShape()[1];
+  Value xwRowOffset =
+      emitInputProjectionRowOffset(rewriter, loc, Ht, sequenceIV);
+
   if (state.linearBeforeReset) {
     // zt = f(Xt*(Wz^T) + Ht-1*(Rz^T) + Wbz + Rbz)"
     // rt = f(Xt*(Wr^T) + Ht-1*(Rr^T) + Wbr + Rbr)"
@@ -412,7 +430,8 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
     // Ht = (1 - zt) (.) ht + zt (.) Ht-1"
     // In this case, we can do all matrix multiplications first, then fuse all
     // element-wise computations into a single nested loop.
-    Value HtRh = onnx_matmul(matrixType, Ht, weightPack.Rh);
+    if (!packedBatch.order)
+      HtRh = onnx_matmul(matrixType, Ht, weightPack.Rh);
 
     // Do element-wise computations. Fuse them into a single nested loop.
     MemRefBoundsCapture bounds(Ht);
@@ -420,10 +439,13 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
     krnl_iterate(
         loops, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
           ValueRange indices = krnl_get_induction_var_value(loops);
-          Value bs(indices[0]), hs(indices[1]);
-          Value HtVal = krnl_load(Ht, indices);
+          Value hs(indices[1]);
+          RNNBatchRow row = getBatchRow(rewriter, loc, packedBatch, Ht,
+              xwRowOffset, indices[0], sequenceIV, isForward);
+          Value bs(row.batch), xwRow(row.xwRow);
+          Value HtVal = krnl_load(Ht, {bs, hs});
           // zt = f(Xt*(Wz^T) + Ht-1*(Rz^T) + Wbz + Rbz)
-          Value XtWzVal = krnl_load(XtWz, indices);
+          Value XtWzVal = loadInputProjection(XW, xwRow, hs, 0);
           Value HtRzVal = krnl_load(HtRz, indices);
           Value zt = std_addf(XtWzVal, HtRzVal);
           if (biasPack.hasBias) {
@@ -434,7 +456,7 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
           }
           zt = applyActivation(rewriter, loc, activationPack.f, zt);
           // rt = f(Xt*(Wr^T) + Ht-1*(Rr^T) + Wbr + Rbr)"
-          Value XtWrVal = krnl_load(XtWr, indices);
+          Value XtWrVal = loadInputProjection(XW, xwRow, hs, hiddenSize);
           Value HtRrVal = krnl_load(HtRr, indices);
           Value rt = std_addf(XtWrVal, HtRrVal);
           if (biasPack.hasBias) {
@@ -445,7 +467,7 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
           }
           rt = applyActivation(rewriter, loc, activationPack.f, rt);
           // ht = g(Xt*(Wh^T) + (rt (.) (Ht-1*(Rh^T) + Rbh)) + Wbh)
-          Value XtWhVal = krnl_load(XtWh, indices);
+          Value XtWhVal = loadInputProjection(XW, xwRow, hs, 2 * hiddenSize);
           Value HtRhVal = krnl_load(HtRh, indices);
           if (biasPack.hasBias) {
             Value RbhVal = krnl_load(biasPack.Rbh, {hs});
@@ -464,10 +486,12 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
           Value ztHt = std_mulf(zt, HtVal);
           Value nextHt = std_addf(ztht, ztHt);
 
-          // Store the intermediate Ht.
-          krnl_store(nextHt, Ht, indices);
+          // Store the intermediate Ht, kept once the sequence ended.
+          nextHt = selectState(rewriter, loc, row, nextHt, Ht, {bs, hs});
+          krnl_store(nextHt, Ht, {bs, hs});
           if (!isNoneType(state.allH))
-            krnl_store(nextHt, state.allH, {sequenceIV, directionIV, bs, hs});
+            krnl_store(selectOutput(rewriter, loc, row, nextHt), state.allH,
+                {row.timestep, directionIV, bs, hs});
         });
   } else {
     // zt = f(Xt*(Wz^T) + Ht-1*(Rz^T) + Wbz + Rbz)"
@@ -495,10 +519,13 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
     krnl_iterate(
         loops1, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
           ValueRange indices = krnl_get_induction_var_value(loops1);
-          Value bs(indices[0]), hs(indices[1]);
-          Value HtVal = krnl_load(Ht, indices);
+          Value hs(indices[1]);
+          RNNBatchRow row = getBatchRow(rewriter, loc, packedBatch, Ht,
+              xwRowOffset, indices[0], sequenceIV, isForward);
+          Value bs(row.batch), xwRow(row.xwRow);
+          Value HtVal = krnl_load(Ht, {bs, hs});
           // rt = f(Xt*(Wr^T) + Ht-1*(Rr^T) + Wbr + Rbr)"
-          Value XtWrVal = krnl_load(XtWr, indices);
+          Value XtWrVal = loadInputProjection(XW, xwRow, hs, hiddenSize);
           Value HtRrVal = krnl_load(HtRr, indices);
           Value rtVal = std_addf(XtWrVal, HtRrVal);
           if (biasPack.hasBias) {
@@ -515,17 +542,25 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
         });
 
     // Emit (rt (.) Ht-1)*(Rh^T)
-    Value rtHtRh = onnx_matmul(matrixType, rtHt, weightPack.Rh);
+    Value rtHtRh;
+    if (packedBatch.order)
+      rtHtRh = emitPackedMatMuls(
+          rewriter, loc, rtHt, {weightPack.Rh}, packedBatch, sequenceIV)[0];
+    else
+      rtHtRh = onnx_matmul(matrixType, rtHt, weightPack.Rh);
 
     // Do element-wise computations. Fuse them into a single nested loop.
     ValueRange loops2 = krnl_define_loop(bounds.rank());
     krnl_iterate(
         loops2, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
           ValueRange indices = krnl_get_induction_var_value(loops2);
-          Value bs(indices[0]), hs(indices[1]);
-          Value HtVal = krnl_load(Ht, indices);
+          Value hs(indices[1]);
+          RNNBatchRow row = getBatchRow(rewriter, loc, packedBatch, Ht,
+              xwRowOffset, indices[0], sequenceIV, isForward);
+          Value bs(row.batch), xwRow(row.xwRow);
+          Value HtVal = krnl_load(Ht, {bs, hs});
           // zt = f(Xt*(Wz^T) + Ht-1*(Rz^T) + Wbz + Rbz)
-          Value XtWzVal = krnl_load(XtWz, indices);
+          Value XtWzVal = loadInputProjection(XW, xwRow, hs, 0);
           Value HtRzVal = krnl_load(HtRz, indices);
           Value zt = std_addf(XtWzVal, HtRzVal);
           if (biasPack.hasBias) {
@@ -536,7 +571,7 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
           }
           zt = applyActivation(rewriter, loc, activationPack.f, zt);
           // ht = g(Xt*(Wh^T) + (rt (.) Ht-1)*(Rh^T) + Rbh + Wbh)
-          Value XtWhVal = krnl_load(XtWh, indices);
+          Value XtWhVal = loadInputProjection(XW, xwRow, hs, 2 * hiddenSize);
           Value rtHtRhVal = krnl_load(rtHtRh, indices);
           Value ht = std_addf(XtWhVal, rtHtRhVal);
           if (biasPack.hasBias) {
@@ -552,10 +587,12 @@ void calculateState<GruState, GruActivationPack, GruWeightPack, GruBiasPack>(
           Value ztHt = std_mulf(zt, HtVal);
           Value nextHt = std_addf(ztht, ztHt);
 
-          // Store the intermediate Ht.
-          krnl_store(nextHt, Ht, indices);
+          // Store the intermediate Ht, kept once the sequence ended.
+          nextHt = selectState(rewriter, loc, row, nextHt, Ht, {bs, hs});
+          krnl_store(nextHt, Ht, {bs, hs});
           if (!isNoneType(state.allH))
-            krnl_store(nextHt, state.allH, {sequenceIV, directionIV, bs, hs});
+            krnl_store(selectOutput(rewriter, loc, row, nextHt), state.allH,
+                {row.timestep, directionIV, bs, hs});
         });
 
     // Clean up
@@ -581,8 +618,8 @@ void stateToOutput<ONNXGRUOp, GruState>(ConversionPatternRewriter &rewriter,
   }
 }
 
-void populateLoweringONNXGRUOpPattern(
-    OwningRewritePatternList &patterns, MLIRContext *ctx) {
+void populateLoweringONNXGRUOpPattern(OwningRewritePatternList &patterns,
+    MLIRContext *ctx, bool persistentStates) {
   patterns.insert<ONNXRNNOpLowering<ONNXGRUOp, GruState, GruActivationPack,
-      GruWeightPack, GruBiasPack>>(ctx);
+      GruWeightPack, GruBiasPack>>(ctx, persistentStates);
 }
@@ -39,10 +39,8 @@ struct LstmActivationPack {
 };
 
 struct LstmWeightPack {
-  Value Wi;
-  Value Wo;
-  Value Wf;
-  Value Wc;
+  // Parameter weights of all the gates: [input_size, 4*hidden_size].
+  Value W;
   Value Ri;
   Value Ro;
   Value Rf;
@@ -220,10 +218,9 @@ getWeightPack<ONNXLSTMOp, LstmWeightPack>(
   // MemRef types for parameter weights.
   auto w3DTy = MemRefType::get({1, 4 * hiddenSize, inputSize}, elementType);
   auto w2DTy = MemRefType::get({4 * hiddenSize, inputSize}, elementType);
-  auto wSplit2DTy = MemRefType::get({hiddenSize, inputSize}, elementType);
-  auto wTranspose2DTy = MemRefType::get({inputSize, hiddenSize}, elementType);
+  auto wTranspose2DTy =
+      MemRefType::get({inputSize, 4 * hiddenSize}, elementType);
   SmallVector<Type, 4> w3D2Ty(2, w3DTy);
-  SmallVector<Type, 4> wSplit2D4Ty(4, wSplit2DTy);
 
   // MemRef types for recurrence weights.
   auto r3DTy = MemRefType::get({1, 4 * hiddenSize, hiddenSize}, elementType);
@@ -256,22 +253,16 @@ getWeightPack<ONNXLSTMOp, LstmWeightPack>(
     bR = foldOrEmitONNXSqueezeOp(rewriter, loc, r2DTy, vals[1], /*axis=*/0);
   }
 
-  // Split W and R into individual weight tensors, and transpose them.
+  // Transpose W as a whole, since the projections of the inputs onto all the
+  // gates are computed at once. Split R into individual weight tensors, and
+  // transpose them.
   if (direction == FORWARD || direction == BIDIRECTIONAL) {
     // W
-    std::vector<Value> vals =
-        foldOrEmitONNXSplitOp(rewriter, loc, wSplit2D4Ty, fW, 0);
-    weightForward.Wi = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[0], permAttr);
-    weightForward.Wo = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[1], permAttr);
-    weightForward.Wf = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[2], permAttr);
-    weightForward.Wc = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[3], permAttr);
+    weightForward.W =
+        foldOrEmitONNXTransposeOp(rewriter, loc, wTranspose2DTy, fW, permAttr);
     // R
-    vals.clear();
-    vals = foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D4Ty, fR, 0);
+    std::vector<Value> vals =
+        foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D4Ty, fR, 0);
     weightForward.Ri = foldOrEmitONNXTransposeOp(
         rewriter, loc, rTranspose2DTy, vals[0], permAttr);
     weightForward.Ro = foldOrEmitONNXTransposeOp(
@@ -283,19 +274,11 @@ getWeightPack<ONNXLSTMOp, LstmWeightPack>(
   }
   if (direction == REVERSE || direction == BIDIRECTIONAL) {
     // W
-    std::vector<Value> vals =
-        foldOrEmitONNXSplitOp(rewriter, loc, wSplit2D4Ty, bW, 0);
-    weightReverse.Wi = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[0], permAttr);
-    weightReverse.Wo = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[1], permAttr);
-    weightReverse.Wf = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[2], permAttr);
-    weightReverse.Wc = foldOrEmitONNXTransposeOp(
-        rewriter, loc, wTranspose2DTy, vals[3], permAttr);
+    weightReverse.W =
+        foldOrEmitONNXTransposeOp(rewriter, loc, wTranspose2DTy, bW, permAttr);
     // R
-    vals.clear();
-    vals = foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D4Ty, bR, 0);
+    std::vector<Value> vals =
+        foldOrEmitONNXSplitOp(rewriter, loc, rSplit2D4Ty, bR, 0);
     weightReverse.Ri = foldOrEmitONNXTransposeOp(
         rewriter, loc, rTranspose2DTy, vals[0], permAttr);
     weightReverse.Ro = foldOrEmitONNXTransposeOp(
@@ -428,7 +411,7 @@ std::tuple<LstmBiasPack, LstmBiasPack> getBiasPack<ONNXLSTMOp, LstmBiasPack>(
 template <>
 LstmState allocAndInitializeStates<ONNXLSTMOp, LstmState>(
     ConversionPatternRewriter &rewriter, Location loc, ONNXLSTMOp *op,
-    typename ONNXLSTMOp::Adaptor operandAdaptor) {
+    typename ONNXLSTMOp::Adaptor operandAdaptor, bool persistentStates) {
   LstmState state;
 
   // direction
@@ -449,6 +432,18 @@ LstmState allocAndInitializeStates<ONNXLSTMOp, LstmState>(
       operandAdaptor.W(), operandAdaptor.R(), op->Y_c(),
       checkInsertDealloc(op->getOperation(), 2));
 
+  // The states continue from those of the previous call, without being
+  // initialized.
+  if (persistentStates &&
+      hasPersistentStates(operandAdaptor.X(), operandAdaptor.R(), direction,
+          {operandAdaptor.initial_h(), operandAdaptor.initial_c()})) {
+    state.forwardHt = getPersistentState(
+        rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
+    state.forwardCt = getPersistentState(
+        rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
+    return state;
+  }
+
   // Insert allocation and deallocation the intermedidate Ht and Ct for the
   // forward and reverse directions.
   // Ht :: [batch_size, hidden_size]
@@ -477,10 +472,10 @@ LstmState allocAndInitializeStates<ONNXLSTMOp, LstmState>(
 
 template <>
 void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
-    LstmBiasPack>(ConversionPatternRewriter &rewriter, Location loc, Value Xt,
+    LstmBiasPack>(ConversionPatternRewriter &rewriter, Location loc, Value XW,
     LstmState state, LstmActivationPack activationPack,
     LstmWeightPack weightPack, LstmBiasPack biasPack, Value sequenceIV,
-    Value directionIV, bool isForward) {
+    Value directionIV, bool isForward, RNNPackedBatch packedBatch) {
   // Equations for LSTM.
   // it = f(Xt*(Wi^T) + Ht-1*(Ri^T) + Pi (.) Ct-1 + Wbi + Rbi)
   // ft = f(Xt*(Wf^T) + Ht-1*(Rf^T) + Pf (.) Ct-1 + Wbf + Rbf)
@@ -498,20 +493,26 @@ void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
   // Frequently used types.
   MemRefType matrixType = Ht.getType().cast<MemRefType>();
 
-  // Do matrix multiplications.
-  Value XtWi, XtWf, XtWc, XtWo, HtRi, HtRf, HtRc, HtRo;
-  if (TEST_FUSED_MATMUL) {
+  // Do matrix multiplications. The projections of Xt onto the parameter
+  // weights were computed for all the timesteps at once, in XW.
+  Value HtRi, HtRf, HtRc, HtRo;
+  SmallVector<Value, 4> fusedMatMulResults;
+  if (packedBatch.order) {
+    // The rows of the states are in the order of the packed batch in the
+    // results.
+    Value packedHt = emitPackedState(rewriter, loc, Ht, packedBatch);
+    SmallVector<Value, 4> results = emitPackedMatMuls(rewriter, loc, packedHt,
+        {weightPack.Ri, weightPack.Rf, weightPack.Rc, weightPack.Ro},
+        packedBatch, sequenceIV);
+    HtRi = results[0];
+    HtRf = results[1];
+    HtRc = results[2];
+    HtRo = results[3];
+  } else if (TEST_FUSED_MATMUL) {
     // For testing purpose, support only static dimensions.
     Type elementType = matrixType.getElementType();
     Value zero = std_constant_index(0);
     Value zeroVal = emitConstantOp(rewriter, loc, elementType, 0);
-    XtWi = memref_alloc(matrixType);
-    XtWf = memref_alloc(matrixType);
-    XtWc = memref_alloc(matrixType);
-    XtWo = memref_alloc(matrixType);
-    emitFusedMatMul(rewriter, loc, matrixType, Xt,
-        {weightPack.Wi, weightPack.Wf, weightPack.Wc, weightPack.Wo}, zero,
-        zeroVal, {XtWi, XtWf, XtWc, XtWo});
     HtRi = memref_alloc(matrixType);
     HtRf = memref_alloc(matrixType);
     HtRc = memref_alloc(matrixType);
@@ -519,27 +520,52 @@ void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
     emitFusedMatMul(rewriter, loc, matrixType, Ht,
         {weightPack.Ri, weightPack.Rf, weightPack.Rc, weightPack.Ro}, zero,
         zeroVal, {HtRi, HtRf, HtRc, HtRo});
+    fusedMatMulResults = {HtRi, HtRf, HtRc, HtRo};
   } else {
-    XtWi = onnx_matmul(matrixType, Xt, weightPack.Wi);
     HtRi = onnx_matmul(matrixType, Ht, weightPack.Ri);
-    XtWf = onnx_matmul(matrixType, Xt, weightPack.Wf);
     HtRf = onnx_matmul(matrixType, Ht, weightPack.Rf);
-    XtWc = onnx_matmul(matrixType, Xt, weightPack.Wc);
     HtRc = onnx_matmul(matrixType, Ht, weightPack.Rc);
-    XtWo = onnx_matmul(matrixType, Xt, weightPack.Wo);
     HtRo = onnx_matmul(matrixType, Ht, weightPack.Ro);
   }
 
+  // The gates are in the order i, o, f, c along the columns of XW.
+  int64_t hiddenSize = matrixType.getShape()[1];
+  Value xwRowOffset =
+      emitInputProjectionRowOffset(rewriter, loc, Ht, sequenceIV);
+
+  // When possible, the gates and the states are computed on vectors along the
+  // hidden dimension, through vector views of all the buffers. The vectors of
+  // a gate then stay in registers from the matrix multiplications to the
+  // updates of the states.
+  int64_t vectorLen = getGateVectorLength(matrixType,
+      {activationPack.f, activationPack.g, activationPack.h});
+  Value CtBuffer = Ct, HtBuffer = Ht, allH = state.allH;
+  if (vectorLen > 0) {
+    auto view = [&](Value &buffer) {
+      if (buffer && !isNoneType(buffer))
+        buffer = krnl_vector_type_cast(buffer, vectorLen);
+    };
+    for (Value *buffer : {&CtBuffer, &HtBuffer, &allH, &XW, &HtRi, &HtRf,
+             &HtRc, &HtRo, &biasPack.Wbi, &biasPack.Rbi, &biasPack.Wbf,
+             &biasPack.Rbf, &biasPack.Wbc, &biasPack.Rbc, &biasPack.Wbo,
+             &biasPack.Rbo, &biasPack.Pi, &biasPack.Pf, &biasPack.Po})
+      view(*buffer);
+    hiddenSize /= vectorLen;
+  }
+
   // Do element-wise computations. Fuse them into a single nested loop.
-  MemRefBoundsCapture bounds(Ht);
+  MemRefBoundsCapture bounds(HtBuffer);
   ValueRange loops = krnl_define_loop(bounds.rank());
   krnl_iterate(
       loops, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
         ValueRange indices = krnl_get_induction_var_value(loops);
-        Value bs(indices[0]), hs(indices[1]);
-        Value CtVal = krnl_load(Ct, indices);
+        Value hs(indices[1]);
+        RNNBatchRow row = getBatchRow(rewriter, loc, packedBatch, Ht,
+            xwRowOffset, indices[0], sequenceIV, isForward);
+        Value bs(row.batch), xwRow(row.xwRow);
+        Value CtVal = krnl_load(CtBuffer, {bs, hs});
         // it = f(Xt*(Wi^T) + Ht-1*(Ri^T) + Pi (.) Ct-1 + Wbi + Rbi)
-        Value XtWiVal = krnl_load(XtWi, indices);
+        Value XtWiVal = loadInputProjection(XW, xwRow, hs, 0);
         Value HtRiVal = krnl_load(HtRi, indices);
         Value it = std_addf(XtWiVal, HtRiVal);
         if (biasPack.hasBias) {
@@ -556,7 +582,7 @@ void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
         it = applyActivation(rewriter, loc, activationPack.f, it);
 
         // ft = f(Xt*(Wf^T) + Ht-1*(Rf^T) + Pf (.) Ct-1 + Wbf + Rbf)
-        Value XtWfVal = krnl_load(XtWf, indices);
+        Value XtWfVal = loadInputProjection(XW, xwRow, hs, 2 * hiddenSize);
         Value HtRfVal = krnl_load(HtRf, indices);
         Value ft = std_addf(XtWfVal, HtRfVal);
         if (biasPack.hasBias) {
@@ -573,7 +599,7 @@ void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
         ft = applyActivation(rewriter, loc, activationPack.f, ft);
 
         // ct = g(Xt*(Wc^T) + Ht-1*(Rc^T) + Wbc + Rbc)
-        Value XtWcVal = krnl_load(XtWc, indices);
+        Value XtWcVal = loadInputProjection(XW, xwRow, hs, 3 * hiddenSize);
         Value HtRcVal = krnl_load(HtRc, indices);
         Value ct = std_addf(XtWcVal, HtRcVal);
         if (biasPack.hasBias) {
@@ -590,7 +616,7 @@ void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
         Value nextCt = std_addf(ftCt, itct);
 
         // ot = f(Xt*(Wo^T) + Ht-1*(Ro^T) + Po (.) Ct + Wbo + Rbo)
-        Value XtWoVal = krnl_load(XtWo, indices);
+        Value XtWoVal = loadInputProjection(XW, xwRow, hs, hiddenSize);
         Value HtRoVal = krnl_load(HtRo, indices);
         Value ot = std_addf(XtWoVal, HtRoVal);
         if (biasPack.hasBias) {
@@ -610,23 +636,18 @@ void calculateState<LstmState, LstmActivationPack, LstmWeightPack,
         Value nextHt = applyActivation(rewriter, loc, activationPack.h, nextCt);
         nextHt = std_mulf(ot, nextHt);
 
-        // Store the intermediate Ht, Ct.
-        krnl_store(nextCt, Ct, indices);
-        krnl_store(nextHt, Ht, indices);
-        if (!isNoneType(state.allH))
-          krnl_store(nextHt, state.allH, {sequenceIV, directionIV, bs, hs});
+        // Store the intermediate Ht, Ct, kept once the sequence ended.
+        nextCt = selectState(rewriter, loc, row, nextCt, CtBuffer, {bs, hs});
+        nextHt = selectState(rewriter, loc, row, nextHt, HtBuffer, {bs, hs});
+        krnl_store(nextCt, CtBuffer, {bs, hs});
+        krnl_store(nextHt, HtBuffer, {bs, hs});
+        if (!isNoneType(allH))
+          krnl_store(selectOutput(rewriter, loc, row, nextHt), allH,
+              {row.timestep, directionIV, bs, hs});
       });
 
-  if (TEST_FUSED_MATMUL) {
-    rewriter.create<memref::DeallocOp>(loc, XtWi);
-    rewriter.create<memref::DeallocOp>(loc, XtWf);
-    rewriter.create<memref::DeallocOp>(loc, XtWc);
-    rewriter.create<memref::DeallocOp>(loc, XtWo);
-    rewriter.create<memref::DeallocOp>(loc, HtRi);
-    rewriter.create<memref::DeallocOp>(loc, HtRf);
-    rewriter.create<memref::DeallocOp>(loc, HtRc);
-    rewriter.create<memref::DeallocOp>(loc, HtRo);
-  }
+  for (Value fusedMatMulResult : fusedMatMulResults)
+    rewriter.create<memref::DeallocOp>(loc, fusedMatMulResult);
 }
 
 template <>
@@ -656,8 +677,8 @@ void stateToOutput<ONNXLSTMOp, LstmState>(ConversionPatternRewriter &rewriter,
   }
 }
 
-void populateLoweringONNXLSTMOpPattern(
-    OwningRewritePatternList &patterns, MLIRContext *ctx) {
+void populateLoweringONNXLSTMOpPattern(OwningRewritePatternList &patterns,
+    MLIRContext *ctx, bool persistentStates) {
   patterns.insert<ONNXRNNOpLowering<ONNXLSTMOp, LstmState, LstmActivationPack,
-      LstmWeightPack, LstmBiasPack>>(ctx);
+      LstmWeightPack, LstmBiasPack>>(ctx, persistentStates);
 }
@@ -32,7 +32,8 @@ struct RnnActivationPack {
 };
 
 struct RnnWeightPack {
-  Value Wi;
+  // Parameter weights: [input_size, hidden_size].
+  Value W;
   Value Ri;
 };
 
@@ -182,13 +183,13 @@ getWeightPack<ONNXRNNOp, RnnWeightPack>(
 
   // Split W and R into individual weight tensors, and transpose them.
   if (direction == FORWARD || direction == BIDIRECTIONAL) {
-    weightForward.Wi =
+    weightForward.W =
         foldOrEmitONNXTransposeOp(rewriter, loc, wTranspose2DTy, fW, permAttr);
     weightForward.Ri =
         foldOrEmitONNXTransposeOp(rewriter, loc, rTranspose2DTy, fR, permAttr);
   }
   if (direction == REVERSE || direction == BIDIRECTIONAL) {
-    weightReverse.Wi =
+    weightReverse.W =
         foldOrEmitONNXTransposeOp(rewriter, loc, wTranspose2DTy, bW, permAttr);
     weightReverse.Ri =
         foldOrEmitONNXTransposeOp(rewriter, loc, rTranspose2DTy, bR, permAttr);
@@ -257,7 +258,7 @@ std::tuple<RnnBiasPack, RnnBiasPack> getBiasPack<ONNXRNNOp, RnnBiasPack>(
 template <>
 RnnState allocAndInitializeStates<ONNXRNNOp, RnnState>(
     ConversionPatternRewriter &rewriter, Location loc, ONNXRNNOp *op,
-    typename ONNXRNNOp::Adaptor operandAdaptor) {
+    typename ONNXRNNOp::Adaptor operandAdaptor, bool persistentStates) {
   RnnState state;
 
   // direction
@@ -273,6 +274,16 @@ RnnState allocAndInitializeStates<ONNXRNNOp, RnnState>(
       operandAdaptor.W(), operandAdaptor.R(), op->Y_h(),
       checkInsertDealloc(op->getOperation(), 1));
 
+  // The state continues from that of the previous call, without being
+  // initialized.
+  if (persistentStates &&
+      hasPersistentStates(operandAdaptor.X(), operandAdaptor.R(), direction,
+          {operandAdaptor.initial_h()})) {
+    state.forwardHt = getPersistentState(
+        rewriter, loc, operandAdaptor.X(), operandAdaptor.R());
+    return state;
+  }
+
   // Insert allocation and deallocation the intermedidate Ht for the forward and
   // reverse directions.
   // Ht :: [batch_size, hidden_size]
@@ -295,9 +306,10 @@ RnnState allocAndInitializeStates<ONNXRNNOp, RnnState>(
 
 template <>
 void calculateState<RnnState, RnnActivationPack, RnnWeightPack, RnnBiasPack>(
-    ConversionPatternRewriter &rewriter, Location loc, Value Xt, RnnState state,
+    ConversionPatternRewriter &rewriter, Location loc, Value XW, RnnState state,
     RnnActivationPack activationPack, RnnWeightPack weightPack,
-    RnnBiasPack biasPack, Value sequenceIV, Value directionIV, bool isForward) {
+    RnnBiasPack biasPack, Value sequenceIV, Value directionIV, bool isForward,
+    RNNPackedBatch packedBatch) {
   // Equations for RNN.
   // Ht = f(Xt*(Wi^T) + Ht-1*(Ri^T) + Wbi + Rbi)
   // Shape information:
@@ -314,9 +326,17 @@ void calculateState<RnnState, RnnActivationPack, RnnWeightPack, RnnBiasPack>(
   Value Ht = (isForward) ? state.forwardHt : state.reverseHt;
   MemRefType matrixType = Ht.getType().cast<MemRefType>();
 
-  // Do matrix multiplications.
-  Value XtWi = onnx_matmul(matrixType, Xt, weightPack.Wi);
-  Value HtRi = onnx_matmul(matrixType, Ht, weightPack.Ri);
+  // Do matrix multiplications. The projections of Xt onto the parameter
+  // weights were computed for all the timesteps at once, in XW.
+  Value HtRi;
+  if (packedBatch.order)
+    HtRi = emitPackedMatMuls(rewriter, loc,
+        emitPackedState(rewriter, loc, Ht, packedBatch), {weightPack.Ri},
+        packedBatch, sequenceIV)[0];
+  else
+    HtRi = onnx_matmul(matrixType, Ht, weightPack.Ri);
+  Value xwRowOffset =
+      emitInputProjectionRowOffset(rewriter, loc, Ht, sequenceIV);
 
   // Do element-wise computations. Fuse them into a single nested loop.
   MemRefBoundsCapture bounds(Ht);
@@ -324,9 +344,12 @@ void calculateState<RnnState, RnnActivationPack, RnnWeightPack, RnnBiasPack>(
   krnl_iterate(
       loops, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
         ValueRange indices = krnl_get_induction_var_value(loops);
-        Value bs(indices[0]), hs(indices[1]);
+        Value hs(indices[1]);
+        RNNBatchRow row = getBatchRow(rewriter, loc, packedBatch, Ht,
+            xwRowOffset, indices[0], sequenceIV, isForward);
+        Value bs(row.batch), xwRow(row.xwRow);
         // Ht = f(Xt*(Wi^T) + Ht-1*(Ri^T) + Wbi + Rbi)
-        Value XtWiVal = krnl_load(XtWi, indices);
+        Value XtWiVal = loadInputProjection(XW, xwRow, hs, 0);
         Value HtRiVal = krnl_load(HtRi, indices);
         Value nextHt = std_addf(XtWiVal, HtRiVal);
         if (biasPack.hasBias) {
@@ -337,10 +360,12 @@ void calculateState<RnnState, RnnActivationPack, RnnWeightPack, RnnBiasPack>(
         }
         nextHt = applyActivation(rewriter, loc, activationPack.f, nextHt);
 
-        // Store the intermediate Ht.
-        krnl_store(nextHt, Ht, indices);
+        // Store the intermediate Ht, kept once the sequence ended.
+        nextHt = selectState(rewriter, loc, row, nextHt, Ht, {bs, hs});
+        krnl_store(nextHt, Ht, {bs, hs});
         if (!isNoneType(state.allH))
-          krnl_store(nextHt, state.allH, {sequenceIV, directionIV, bs, hs});
+          krnl_store(selectOutput(rewriter, loc, row, nextHt), state.allH,
+              {row.timestep, directionIV, bs, hs});
       });
 }
 
@@ -362,8 +387,8 @@ void stateToOutput<ONNXRNNOp, RnnState>(ConversionPatternRewriter &rewriter,
   }
 }
 
-void populateLoweringONNXRNNOpPattern(
-    OwningRewritePatternList &patterns, MLIRContext *ctx) {
+void populateLoweringONNXRNNOpPattern(OwningRewritePatternList &patterns,
+    MLIRContext *ctx, bool persistentStates) {
   patterns.insert<ONNXRNNOpLowering<ONNXRNNOp, RnnState, RnnActivationPack,
-      RnnWeightPack, RnnBiasPack>>(ctx);
+      RnnWeightPack, RnnBiasPack>>(ctx, persistentStates);
 }
@@ -112,6 +112,43 @@ Value allocIntermediateState(
   return alloc;
 }
 
+/// Check whether the intermediate states of an RNN op persist across the
+/// calls of the model. The reverse and bidirectional ops read the sequence
+/// from its end, which does not continue the sequence of the previous call.
+bool hasPersistentStates(
+    Value X, Value R, StringRef direction, ArrayRef<Value> initialStates) {
+  return direction == FORWARD && dimAt(X, 1) >= 0 && dimAt(R, 2) >= 0 &&
+         llvm::all_of(initialStates, isNoneType);
+}
+
+/// Get an intermediate hidden or cell state persisting across the calls of
+/// the model. The states of a model are in globals named rnn_state, and are
+/// shared by its concurrent calls.
+Value getPersistentState(
+    ConversionPatternRewriter &rewriter, Location loc, Value X, Value R) {
+  Type elementType = X.getType().cast<ShapedType>().getElementType();
+  auto memRefType = MemRefType::get({/*batch_size=*/dimAt(X, 1),
+                                        /*hidden_size=*/dimAt(R, 2)},
+      elementType);
+  auto module = rewriter.getInsertionBlock()
+                    ->getParentOp()
+                    ->getParentOfType<ModuleOp>();
+  std::string name = "rnn_state";
+  for (unsigned i = 0; module.lookupSymbol(name); ++i)
+    name = "rnn_state_" + std::to_string(i);
+  {
+    OpBuilder::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(module.getBody());
+    auto zeros = DenseElementsAttr::get(
+        RankedTensorType::get(memRefType.getShape(), elementType),
+        rewriter.getZeroAttr(elementType));
+    rewriter.create<memref::GlobalOp>(loc, rewriter.getStringAttr(name),
+        rewriter.getStringAttr("private"), TypeAttr::get(memRefType), zeros,
+        /*constant=*/UnitAttr());
+  }
+  return rewriter.create<memref::GetGlobalOp>(loc, memRefType, name);
+}
+
 /// Initialize the intermediate hidden and cell states.
 void initializeIntermediateStates(ConversionPatternRewriter &rewriter,
     Location loc, Value forwardHt, Value reverseHt, Value forwardCt,
@@ -280,11 +317,66 @@ void stateToOutputForHiddenOrCell(ConversionPatternRewriter &rewriter,
   }
 }
 
-// Apply an activation function on a given scalar operand.
+// Size in bytes of the vectors used to compute the gates.
+static const int64_t gateVectorBytes = 32;
+
+// Activations that applyActivation computes on vectors.
+static bool isVectorizableActivation(RNNActivation activation) {
+  return activation.name.equals_lower("sigmoid") ||
+         activation.name.equals_lower("tanh") ||
+         activation.name.equals_lower("relu");
+}
+
+int64_t getGateVectorLength(
+    MemRefType stateType, ArrayRef<RNNActivation> activations) {
+  Type elementType = stateType.getElementType();
+  if (!elementType.isF32() || !stateType.getAffineMaps().empty())
+    return 0;
+  for (RNNActivation activation : activations)
+    if (!isVectorizableActivation(activation))
+      return 0;
+
+  int64_t vectorLen = gateVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  int64_t hiddenSize = stateType.getShape()[1];
+  if (hiddenSize < 0 || hiddenSize % vectorLen != 0)
+    return 0;
+  return vectorLen;
+}
+
+// Apply an activation function on a given scalar or vector operand.
 Value applyActivation(ConversionPatternRewriter &rewriter, Location loc,
     RNNActivation activation, Value operand) {
   Value res;
 
+  // Vectors do not go through the ONNX ops, the activation is computed in
+  // place.
+  if (auto vectorType = operand.getType().dyn_cast<VectorType>()) {
+    assert(isVectorizableActivation(activation) &&
+           "Unsupported vector activation");
+    Value zero = emitConstantOp(rewriter, loc, vectorType, 0);
+    Value one = emitConstantOp(rewriter, loc, vectorType, 1);
+    if (activation.name.equals_lower("relu")) {
+      Value lessThanZero =
+          rewriter.create<CmpFOp>(loc, CmpFPredicate::OLT, operand, zero);
+      return rewriter.create<SelectOp>(loc, lessThanZero, zero, operand);
+    }
+    if (activation.name.equals_lower("sigmoid")) {
+      // sigmoid(x) = 1 / (1 + exp(-x))
+      Value negExp = rewriter.create<math::ExpOp>(
+          loc, rewriter.create<SubFOp>(loc, zero, operand));
+      return rewriter.create<DivFOp>(
+          loc, one, rewriter.create<AddFOp>(loc, one, negExp));
+    }
+    // tanh(x) = 1 - 2 / (exp(2x) + 1), which saturates to -1 and 1 when
+    // exp(2x) underflows and overflows.
+    Value two = emitConstantOp(rewriter, loc, vectorType, 2);
+    Value exp2x = rewriter.create<math::ExpOp>(
+        loc, rewriter.create<MulFOp>(loc, two, operand));
+    return rewriter.create<SubFOp>(loc, one,
+        rewriter.create<DivFOp>(
+            loc, two, rewriter.create<AddFOp>(loc, exp2x, one)));
+  }
+
   bool isScalar = !operand.getType().isa<ShapedType>();
   assert(isScalar && "Not a scalar operand");
 
@@ -334,58 +426,77 @@ Value applyActivation(ConversionPatternRewriter &rewriter, Location loc,
   return res;
 }
 
-/// Create a copy of a slice of X at a specific timestep.
-/// This function is not able correctly to emit 'dealloc' for the copy since it
-/// does not have enough information about the parent context. Users must
-/// deallocate the copy by themselves.
-Value emitXSliceAt(ConversionPatternRewriter &rewriter, Location loc, Value X,
-    Value timestepIV) {
+/// Compute the projections of the inputs of all the timesteps onto the
+/// parameter weights of all the gates, W being of shape [input_size,
+/// num_gates * hidden_size]. X is contiguous, so that it is copied as is into a
+/// buffer of shape [seq_length * batch_size, input_size], each timestep then
+/// spanning batch_size rows of the projections.
+Value emitInputProjection(
+    ConversionPatternRewriter &rewriter, Location loc, Value X, Value W) {
   ScopedContext scope(rewriter, loc);
 
-  Value sliceX;
-
+  int64_t seqLength = dimAt(X, 0);
   int64_t batchSize = dimAt(X, 1);
   int64_t inputSize = dimAt(X, 2);
+  int64_t projectionSize = dimAt(W, 1);
+  int64_t numRows = -1;
+  if (seqLength != -1 && batchSize != -1)
+    numRows = seqLength * batchSize;
   auto elementType = X.getType().cast<ShapedType>().getElementType();
-  MemRefType sliceXType = MemRefType::get({batchSize, inputSize}, elementType);
+  MemRefType x2DType = MemRefType::get({numRows, inputSize}, elementType);
+  MemRefType xwType = MemRefType::get({numRows, projectionSize}, elementType);
 
   // Allocate a buffer
-  if (hasAllConstantDimensions(sliceXType))
-    sliceX =
-        insertAllocAndDealloc(sliceXType, loc, rewriter, /*deallocate=*/false);
+  Value X2D;
+  if (hasAllConstantDimensions(x2DType))
+    X2D = insertAllocAndDealloc(x2DType, loc, rewriter, /*deallocate=*/true);
   else {
-    auto memRefShape = sliceXType.getShape();
     SmallVector<Value, 2> allocOperands;
-    if (memRefShape[0] < 0) {
+    if (numRows < 0) {
+      Value seqLengthVal =
+          getDimOrConstant(rewriter, loc, X, 0, rewriter.getIndexType());
       Value batchSizeVal =
           getDimOrConstant(rewriter, loc, X, 1, rewriter.getIndexType());
-      allocOperands.emplace_back(batchSizeVal);
+      allocOperands.emplace_back(std_muli(seqLengthVal, batchSizeVal));
     }
-    if (memRefShape[1] < 0) {
+    if (inputSize < 0) {
       Value inputSizeVal =
           getDimOrConstant(rewriter, loc, X, 2, rewriter.getIndexType());
       allocOperands.emplace_back(inputSizeVal);
     }
-    sliceX = memref_alloc(sliceXType, allocOperands);
+    X2D = memref_alloc(x2DType, allocOperands);
+    auto *parentBlock = X2D.getDefiningOp()->getBlock();
+    auto dealloc = rewriter.create<memref::DeallocOp>(loc, X2D);
+    dealloc.getOperation()->moveBefore(&parentBlock->back());
   }
 
   // Copy data from X.
-  MemRefBoundsCapture bounds(sliceX);
-  ValueRange loops = krnl_define_loop(2);
-  krnl_iterate(
-      loops, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
-        ValueRange indices = krnl_get_induction_var_value(loops);
-        Value b(indices[0]), i(indices[1]);
-        Value val = krnl_load(X, {timestepIV, b, i});
-        krnl_store(val, sliceX, {b, i});
-      });
+  Value sizeInBytes = getDynamicMemRefSizeInBytes(rewriter, loc, X);
+  rewriter.create<KrnlMemcpyOp>(loc, X2D, X, sizeInBytes);
 
-  return sliceX;
+  return onnx_matmul(xwType, X2D, W);
+}
+
+/// Each timestep spans batch_size rows of the projections of the inputs.
+Value emitInputProjectionRowOffset(ConversionPatternRewriter &rewriter,
+    Location loc, Value Ht, Value timestepIV) {
+  ScopedContext scope(rewriter, loc);
+  Value batchSize =
+      getDimOrConstant(rewriter, loc, Ht, 0, rewriter.getIndexType());
+  return std_muli(timestepIV, batchSize);
+}
+
+/// Must be called within a ScopedContext.
+Value loadInputProjection(Value XW, Value row, Value hs, int64_t gateOffset) {
+  Value column = hs;
+  if (gateOffset != 0)
+    column = std_addi(hs, std_constant_index(gateOffset));
+  return krnl_load(XW, {row, column});
 }
 
 void emitFusedMatMul(ConversionPatternRewriter &rewriter, Location loc,
     MemRefType matrixType, Value A, ArrayRef<Value> Bs, Value zero,
-    Value zeroVal, ArrayRef<Value> Cs) {
+    Value zeroVal, ArrayRef<Value> Cs, Value rowLengths, Value step) {
   ScopedContext scope(rewriter, loc);
 
   Type elementType = matrixType.getElementType();
@@ -410,25 +521,18 @@ void emitFusedMatMul(ConversionPatternRewriter &rewriter, Location loc,
   // Simdize with jRegTile as the vector length.
   bool simdize = true;
 
-  bool mustTileR = false;
-  // J is hidden size which is always literal.
+  // J is hidden size which is always literal. The results are simdized in
+  // place, with masked vector transfers when J is not a multiple of the
+  // vector length.
   int64_t jVal = matrixType.getShape()[1];
   if (jVal < jRegTile) {
     // Very small computation, give up on SIMD.
     simdize = false;
-  } else if (jVal % jRegTile != 0) {
-    // Unfortunately, J is not divisible by the vector length. Could try
-    // to change the vector length, but right now, just go to buffering.
-    mustTileR = true;
-  } else {
-    // Best of all world, large computation, of sizes compatible with vector
-    // length.
   }
 
   // 2) Alloc data for tiles.
   MemRefType aTileType = MemRefType::get({iCacheTile, kCacheTile}, elementType);
   MemRefType bTileType = MemRefType::get({kCacheTile, jCacheTile}, elementType);
-  MemRefType cTileType = MemRefType::get({iCacheTile, jCacheTile}, elementType);
   IntegerAttr alignAttr = rewriter.getI64IntegerAttr(BUFFER_ALIGN);
   ValueRange empty;
   Value aBuff = memref_alloc(aTileType, empty, alignAttr);
@@ -437,13 +541,6 @@ void emitFusedMatMul(ConversionPatternRewriter &rewriter, Location loc,
     Value bBuff = memref_alloc(bTileType, empty, alignAttr);
     bBuffs.emplace_back(bBuff);
   }
-  SmallVector<Value, 4> cBuffs;
-  if (mustTileR) {
-    for (int i = 0; i < Cs.size(); ++i) {
-      Value cBuff = memref_alloc(cTileType, empty, alignAttr);
-      cBuffs.emplace_back(cBuff);
-    }
-  }
 
   // 3) introduce the loops and permute them
   // I, J, K loop.
@@ -461,74 +558,197 @@ void emitFusedMatMul(ConversionPatternRewriter &rewriter, Location loc,
   ValueRange kCacheBlock = krnl_block(kk, kCacheTile);
   Value kk1(kCacheBlock[0]), kk2(kCacheBlock[1]);
 
-  // If we must tile the result R, then we put I & J in the outermost.
-  // Otherwise, we follow the more traditional scheme of having J & K in the
-  // outermost.
-  if (mustTileR) {
-    // (cache) ii1 jj1 kk1,    (reg) jj2, ii2,    (matmul) ii3, jj3, kk3
-    krnl_permute({ii1, ii2, ii3, jj1, jj2, jj3, kk1, kk2},
-        {/*i*/ 0, 4, 5, /*j*/ 1, 3, 6, /*k*/ 2, 7});
-    // Compute: A[i, k] * b[k, j] -> R[i, j])
-    krnl_iterate(
-        {ii, jj}, {ii1, jj1}, {zero, zero}, {I, J}, {}, [&](ValueRange args) {
-          ValueRange i1_j1_indices = krnl_get_induction_var_value({ii1, jj1});
-          Value i1(i1_j1_indices[0]), j1(i1_j1_indices[1]);
-          for (int n = 0; n < cBuffs.size(); ++n)
-            krnl_copy_to_buffer(cBuffs[n], Cs[n], {i1, j1}, zeroVal, false);
-          krnl_iterate({kk}, {kk1}, {zero}, {K}, {}, [&](ValueRange args) {
-            ValueRange k1_index = krnl_get_induction_var_value({kk1});
-            Value k1(k1_index[0]);
-            krnl_copy_to_buffer(aBuff, A, {i1, k1}, zeroVal, false);
+  // (cache) jj1 kk1, ii1, (reg) jj2, ii2, (matmul) ii3, jj3, kk3
+  krnl_permute({jj1, jj2, jj3, kk1, kk2, ii1, ii2, ii3},
+      {/*j*/ 0, 3, 5, /*k*/ 1, 6, /*i*/ 2, 4, 7});
+  // Compute: A[i, k] * b[k, j] -> C[i, j])
+  krnl_iterate(
+      {jj, kk}, {jj1, kk1}, {zero, zero}, {J, K}, {}, [&](ValueRange args) {
+        ValueRange j1_k1_indices = krnl_get_induction_var_value({jj1, kk1});
+        Value j1(j1_k1_indices[0]), k1(j1_k1_indices[1]);
+        for (int n = 0; n < bBuffs.size(); ++n)
+          krnl_copy_to_buffer(bBuffs[n], Bs[n], {k1, j1}, zeroVal, false);
+        krnl_iterate({ii}, {ii1}, {zero}, {I}, {}, [&](ValueRange args) {
+          ValueRange i1_index = krnl_get_induction_var_value({ii1});
+          Value i1(i1_index[0]);
+          krnl_copy_to_buffer(aBuff, A, {i1, k1}, zeroVal, false);
+          krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
+            ValueRange j2_i2_indices = krnl_get_induction_var_value({jj2, ii2});
+            Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
+            // The rows are sorted by decreasing length: the tile is skipped
+            // when its first row ended.
+            OpBuilder::InsertionGuard guard(rewriter);
+            if (rowLengths) {
+              Value isRunning = rewriter.create<CmpIOp>(loc,
+                  CmpIPredicate::slt, step, krnl_load(rowLengths, {i2}));
+              auto ifOp = rewriter.create<scf::IfOp>(
+                  loc, isRunning, /*withElseRegion=*/false);
+              rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+            }
             for (int n = 0; n < bBuffs.size(); ++n)
-              krnl_copy_to_buffer(bBuffs[n], Bs[n], {k1, j1}, zeroVal, false);
-            krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
-              ValueRange j2_i2_indices =
-                  krnl_get_induction_var_value({jj2, ii2});
-              Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
-              for (int n = 0; n < bBuffs.size(); ++n) {
-                krnl_matmul(aBuff, {i1, k1}, bBuffs[n], {k1, j1}, cBuffs[n],
-                    {i1, j1},
-                    /*loops*/ {ii3, jj3, kk2},
-                    /*compute start*/ {i2, j2, k1},
-                    /*ubs*/ {I, J, K},
-                    /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
-                    /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
-              }
-            });
-          });
-          for (int n = 0; n < cBuffs.size(); ++n)
-            krnl_copy_from_buffer(cBuffs[n], Cs[n], {i1, j1});
-        });
-  } else {
-    // Does not have to tile the result.
-    // (cache) jj1 kk1, ii1, (reg) jj2, ii2, (matmul) ii3, jj3, kk3
-    krnl_permute({jj1, jj2, jj3, kk1, kk2, ii1, ii2, ii3},
-        {/*j*/ 0, 3, 5, /*k*/ 1, 6, /*i*/ 2, 4, 7});
-    // Compute: A[i, k] * b[k, j] -> C[i, j])
-    krnl_iterate(
-        {jj, kk}, {jj1, kk1}, {zero, zero}, {J, K}, {}, [&](ValueRange args) {
-          ValueRange j1_k1_indices = krnl_get_induction_var_value({jj1, kk1});
-          Value j1(j1_k1_indices[0]), k1(j1_k1_indices[1]);
-          for (int n = 0; n < bBuffs.size(); ++n)
-            krnl_copy_to_buffer(bBuffs[n], Bs[n], {k1, j1}, zeroVal, false);
-          krnl_iterate({ii}, {ii1}, {zero}, {I}, {}, [&](ValueRange args) {
-            ValueRange i1_index = krnl_get_induction_var_value({ii1});
-            Value i1(i1_index[0]);
-            krnl_copy_to_buffer(aBuff, A, {i1, k1}, zeroVal, false);
-            krnl_iterate({}, {jj2, ii2}, {}, {}, {}, [&](ValueRange args) {
-              ValueRange j2_i2_indices =
-                  krnl_get_induction_var_value({jj2, ii2});
-              Value j2(j2_i2_indices[0]), i2(j2_i2_indices[1]);
-              for (int n = 0; n < bBuffs.size(); ++n)
-                krnl_matmul(aBuff, {i1, k1}, bBuffs[n], {k1, j1}, Cs[n],
-                    {zero, zero},
-                    /*loops*/ {ii3, jj3, kk2},
-                    /*compute start*/ {i2, j2, k1},
-                    /*ubs*/ {I, J, K},
-                    /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
-                    /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
-            });
+              krnl_matmul(aBuff, {i1, k1}, bBuffs[n], {k1, j1}, Cs[n],
+                  {zero, zero},
+                  /*loops*/ {ii3, jj3, kk2},
+                  /*compute start*/ {i2, j2, k1},
+                  /*ubs*/ {I, J, K},
+                  /*compute tile*/ {iRegTile, jRegTile, kCacheTile},
+                  /* a/b/c tiles*/ {}, {}, {}, simdize, unrollAndJam, false);
           });
         });
+      });
+
+  // The tiles are allocated at each call, within the loops of the timesteps.
+  memref_dealloc(aBuff);
+  for (Value bBuff : bBuffs)
+    memref_dealloc(bBuff);
+}
+
+// Allocate a temporary buffer whose leading dimension is the batch, freed at
+// the end of the current block. Must be called within a ScopedContext.
+static Value allocBatchBuffer(ConversionPatternRewriter &rewriter,
+    Location loc, MemRefType memRefType, Value batchSize) {
+  SmallVector<Value, 1> allocOperands;
+  if (memRefType.getShape()[0] < 0)
+    allocOperands.emplace_back(batchSize);
+  Value alloc = memref_alloc(memRefType, allocOperands);
+  auto *parentBlock = alloc.getDefiningOp()->getBlock();
+  auto dealloc = rewriter.create<memref::DeallocOp>(loc, alloc);
+  dealloc.getOperation()->moveBefore(&parentBlock->back());
+  return alloc;
+}
+
+RNNPackedBatch emitPackedBatch(ConversionPatternRewriter &rewriter,
+    Location loc, Value X, Value sequenceLens) {
+  RNNPackedBatch packedBatch;
+  if (isNoneType(sequenceLens))
+    return packedBatch;
+  ScopedContext scope(rewriter, loc);
+
+  Type indexType = rewriter.getIndexType();
+  MemRefBoundsCapture xBounds(X);
+  Value seqLength(xBounds.ub(0)), batchSize(xBounds.ub(1));
+  Value zero = std_constant_index(0);
+  Value one = std_constant_index(1);
+  auto batchType = MemRefType::get({dimAt(X, 1)}, indexType);
+  packedBatch.order = allocBatchBuffer(rewriter, loc, batchType, batchSize);
+  packedBatch.lengths = allocBatchBuffer(rewriter, loc, batchType, batchSize);
+  Value rank = memref_alloca(MemRefType::get({}, indexType));
+
+  // The length of a sequence, bounded by seq_length.
+  auto loadLength = [&](Value batch) -> Value {
+    Value length = rewriter.create<IndexCastOp>(
+        loc, krnl_load(sequenceLens, {batch}), indexType);
+    Value isShorter =
+        rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, length, seqLength);
+    return rewriter.create<SelectOp>(loc, isShorter, length, seqLength);
+  };
+
+  // The row of a sequence in the packed batch is the number of the sequences
+  // longer than it, or as long and before it in the batch. The batches are
+  // small enough for this quadratic sort.
+  ValueRange batchLoop = krnl_define_loop(1);
+  krnl_iterate(batchLoop, {zero}, {batchSize}, {}, [&](ValueRange args) {
+    Value batch = krnl_get_induction_var_value(batchLoop)[0];
+    Value length = loadLength(batch);
+    krnl_store(zero, rank, ValueRange());
+    ValueRange otherLoop = krnl_define_loop(1);
+    krnl_iterate(otherLoop, {zero}, {batchSize}, {}, [&](ValueRange args) {
+      Value other = krnl_get_induction_var_value(otherLoop)[0];
+      Value otherLength = loadLength(other);
+      Value isLonger = rewriter.create<CmpIOp>(
+          loc, CmpIPredicate::sgt, otherLength, length);
+      Value isAsLong =
+          rewriter.create<CmpIOp>(loc, CmpIPredicate::eq, otherLength, length);
+      Value isBefore =
+          rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, other, batch);
+      Value isFirst = rewriter.create<OrOp>(
+          loc, isLonger, rewriter.create<AndOp>(loc, isAsLong, isBefore));
+      Value rankVal = krnl_load(rank, ValueRange());
+      krnl_store(rewriter.create<SelectOp>(
+                     loc, isFirst, std_addi(rankVal, one), rankVal),
+          rank, ValueRange());
+    });
+    Value row = krnl_load(rank, ValueRange());
+    krnl_store(batch, packedBatch.order, {row});
+    krnl_store(length, packedBatch.lengths, {row});
+  });
+  return packedBatch;
+}
+
+Value emitPackedState(ConversionPatternRewriter &rewriter, Location loc,
+    Value Ht, RNNPackedBatch packedBatch) {
+  ScopedContext scope(rewriter, loc);
+  MemRefBoundsCapture bounds(Ht);
+  Value packedHt = allocBatchBuffer(
+      rewriter, loc, Ht.getType().cast<MemRefType>(), bounds.ub(0));
+  ValueRange loops = krnl_define_loop(bounds.rank());
+  krnl_iterate(
+      loops, bounds.getLbs(), bounds.getUbs(), {}, [&](ValueRange args) {
+        ValueRange indices = krnl_get_induction_var_value(loops);
+        Value batch = krnl_load(packedBatch.order, {indices[0]});
+        krnl_store(krnl_load(Ht, {batch, indices[1]}), packedHt, indices);
+      });
+  return packedHt;
+}
+
+SmallVector<Value, 4> emitPackedMatMuls(ConversionPatternRewriter &rewriter,
+    Location loc, Value packedHt, ArrayRef<Value> Rs,
+    RNNPackedBatch packedBatch, Value step) {
+  ScopedContext scope(rewriter, loc);
+  auto matrixType = packedHt.getType().cast<MemRefType>();
+  MemRefBoundsCapture bounds(packedHt);
+  SmallVector<Value, 4> Cs;
+  for (unsigned i = 0; i < Rs.size(); ++i)
+    Cs.emplace_back(allocBatchBuffer(rewriter, loc, matrixType, bounds.ub(0)));
+  Value zero = std_constant_index(0);
+  Value zeroVal = emitConstantOp(rewriter, loc, matrixType.getElementType(), 0);
+  emitFusedMatMul(rewriter, loc, matrixType, packedHt, Rs, zero, zeroVal, Cs,
+      packedBatch.lengths, step);
+  return Cs;
+}
+
+/// Must be called within a ScopedContext.
+RNNBatchRow getBatchRow(ConversionPatternRewriter &rewriter, Location loc,
+    RNNPackedBatch packedBatch, Value Ht, Value xwRowOffset, Value row,
+    Value sequenceIV, bool isForward) {
+  RNNBatchRow batchRow;
+  if (!packedBatch.order) {
+    batchRow.batch = row;
+    batchRow.timestep = sequenceIV;
+    batchRow.xwRow = std_addi(xwRowOffset, row);
+    return batchRow;
+  }
+  batchRow.batch = krnl_load(packedBatch.order, {row});
+  Value length = krnl_load(packedBatch.lengths, {row});
+  batchRow.isRunning =
+      rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, sequenceIV, length);
+  batchRow.timestep = sequenceIV;
+  if (!isForward) {
+    Value reverseTimestep = rewriter.create<SubIOp>(loc,
+        rewriter.create<SubIOp>(loc, length, std_constant_index(1)),
+        sequenceIV);
+    batchRow.timestep = rewriter.create<SelectOp>(
+        loc, batchRow.isRunning, reverseTimestep, sequenceIV);
   }
+  batchRow.xwRow = std_addi(
+      emitInputProjectionRowOffset(rewriter, loc, Ht, batchRow.timestep),
+      batchRow.batch);
+  return batchRow;
+}
+
+/// Must be called within a ScopedContext.
+Value selectState(ConversionPatternRewriter &rewriter, Location loc,
+    RNNBatchRow row, Value next, Value state, ValueRange indices) {
+  if (!row.isRunning)
+    return next;
+  return rewriter.create<SelectOp>(
+      loc, row.isRunning, next, krnl_load(state, indices));
+}
+
+Value selectOutput(ConversionPatternRewriter &rewriter, Location loc,
+    RNNBatchRow row, Value next) {
+  if (!row.isRunning)
+    return next;
+  Value zero = emitConstantOp(rewriter, loc, next.getType(), 0);
+  return rewriter.create<SelectOp>(loc, row.isRunning, next, zero);
 }
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Dialect/MemRef/EDSC/Intrinsics.h"
+#include "mlir/Dialect/SCF/SCF.h"
 #include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
 #include "mlir/IR/AffineExpr.h"
 
@@ -54,6 +55,18 @@ void initializeHiddenAndCell(ConversionPatternRewriter &rewriter, Location loc,
 Value allocIntermediateState(
     ConversionPatternRewriter &rewriter, Location loc, Value X, Value R);
 
+/// Check whether the intermediate states of an RNN op persist across the
+/// calls of the model: the op runs forward, from no initial states, on states
+/// of static shapes.
+bool hasPersistentStates(
+    Value X, Value R, StringRef direction, ArrayRef<Value> initialStates);
+
+/// Get an intermediate hidden or cell state persisting across the calls of
+/// the model, a global buffer zero-initialized when the model is loaded and
+/// updated in place by each call.
+Value getPersistentState(
+    ConversionPatternRewriter &rewriter, Location loc, Value X, Value R);
+
 /// Initialize the intermediate hidden and cell states.
 void initializeIntermediateStates(ConversionPatternRewriter &rewriter,
     Location loc, Value forwardHt, Value reverseHt, Value forwardCt,
@@ -67,19 +80,92 @@ void stateToOutputForHiddenOrCell(ConversionPatternRewriter &rewriter,
     Location loc, Value forwardVal, Value reverseVal, StringRef direction,
     Value output);
 
-/// Apply an activation function on a given operand.
+/// Apply an activation function on a given operand, a scalar or a vector.
 Value applyActivation(ConversionPatternRewriter &rewriter, Location loc,
     RNNActivation activation, Value operand);
 
-/// Get a slice of X at a specific timestep.
-Value emitXSliceAt(
-    ConversionPatternRewriter &rewriter, Location loc, Value X, Value timestep);
+/// Get the length of the vectors used to compute the gates of states of the
+/// given type, or 0 if the gates are computed element by element. The hidden
+/// size must be a multiple of the vector length and all the activations must
+/// apply to vectors.
+int64_t getGateVectorLength(
+    MemRefType stateType, ArrayRef<RNNActivation> activations);
+
+/// Compute the projections of the inputs of all the timesteps onto the
+/// parameter weights of all the gates, as a single matrix multiplication
+/// [seq_length * batch_size, input_size] x [input_size, num_gates *
+/// hidden_size].
+Value emitInputProjection(
+    ConversionPatternRewriter &rewriter, Location loc, Value X, Value W);
+
+/// Get the first row of the projections of the inputs at a specific timestep.
+Value emitInputProjectionRowOffset(
+    ConversionPatternRewriter &rewriter, Location loc, Value Ht, Value timestep);
+
+/// Load a projection of the inputs onto the gate whose columns start at
+/// 'gateOffset'.
+Value loadInputProjection(Value XW, Value row, Value hs, int64_t gateOffset);
 
 /// Emit multiple matrix multiplications where A is shared and all Bs have the
-/// same dimensions.
+/// same dimensions. With 'rowLengths', the register tiles of the rows of A
+/// whose first row has a length not greater than 'step' are not computed.
 void emitFusedMatMul(ConversionPatternRewriter &rewriter, Location loc,
     MemRefType matrixType, Value A, ArrayRef<Value> Bs, Value zero,
-    Value zeroVal, ArrayRef<Value> Cs);
+    Value zeroVal, ArrayRef<Value> Cs, Value rowLengths = nullptr,
+    Value step = nullptr);
+
+/// The batch of an RNN op with sequence_lens, packed by decreasing sequence
+/// length: row r of the packed batch is the sequence order[r] of the batch,
+/// of length lengths[r] bounded by seq_length. At each step, the sequences
+/// still running are the first rows of the packed batch, and the recurrence
+/// matrix multiplications skip the rows of the ended ones. Both buffers are
+/// null without sequence_lens.
+struct RNNPackedBatch {
+  Value order;
+  Value lengths;
+};
+
+/// A row of the batch at a step of an RNN op: the batch index and the
+/// timestep of its sequence, the row of its projections of the inputs, and
+/// whether its sequence is still running, null without sequence_lens.
+struct RNNBatchRow {
+  Value batch;
+  Value timestep;
+  Value xwRow;
+  Value isRunning;
+};
+
+/// Sort the batch of an RNN op by decreasing sequence length.
+RNNPackedBatch emitPackedBatch(ConversionPatternRewriter &rewriter,
+    Location loc, Value X, Value sequenceLens);
+
+/// Gather the rows of a state in the order of the packed batch.
+Value emitPackedState(ConversionPatternRewriter &rewriter, Location loc,
+    Value Ht, RNNPackedBatch packedBatch);
+
+/// Multiply the rows of the packed states of the sequences running at a step
+/// by the recurrence weights.
+SmallVector<Value, 4> emitPackedMatMuls(ConversionPatternRewriter &rewriter,
+    Location loc, Value packedHt, ArrayRef<Value> Rs,
+    RNNPackedBatch packedBatch, Value step);
+
+/// Get a row of the batch at a step. Without sequence_lens, it is the
+/// sequence 'row' at timestep 'sequenceIV'. With them, it is the sequence of
+/// the row of the packed batch, 'sequenceIV' counting the steps from the first
+/// timestep of each sequence in the direction of the loop, and an ended
+/// sequence is at the padding timestep 'sequenceIV'.
+RNNBatchRow getBatchRow(ConversionPatternRewriter &rewriter, Location loc,
+    RNNPackedBatch packedBatch, Value Ht, Value xwRowOffset, Value row,
+    Value sequenceIV, bool isForward);
+
+/// Select the next value of a state of a row of the batch, or its value in
+/// the state buffer once its sequence ended.
+Value selectState(ConversionPatternRewriter &rewriter, Location loc,
+    RNNBatchRow row, Value next, Value state, ValueRange indices);
+
+/// Select the output of a row of the batch, zero once its sequence ended.
+Value selectOutput(ConversionPatternRewriter &rewriter, Location loc,
+    RNNBatchRow row, Value next);
 
 // Override the following methods when lowering an RNN operation:
 // - hasAllNoneOutput
@@ -112,16 +198,20 @@ template <typename RNNOp, typename B>
 std::tuple<B, B> getBiasPack(
     ConversionPatternRewriter &rewriter, Location loc, RNNOp *op);
 
-// Allocate memory for RNN states and initialize them.
+// Allocate memory for RNN states and initialize them. With persistentStates,
+// the states of the ops satisfying hasPersistentStates are kept from one call
+// of the model to the next instead.
 template <typename RNNOp, typename S>
 S allocAndInitializeStates(ConversionPatternRewriter &rewriter, Location loc,
-    RNNOp *op, typename RNNOp::Adaptor operandAdaptor);
+    RNNOp *op, typename RNNOp::Adaptor operandAdaptor, bool persistentStates);
 
-// Calculate new states from the current input and states.
+// Calculate new states from the projections of the current input and the
+// states, for the sequences of the packed batch still running with
+// sequence_lens.
 template <typename S, typename A, typename W, typename B>
-void calculateState(ConversionPatternRewriter &rewriter, Location loc, Value Xt,
+void calculateState(ConversionPatternRewriter &rewriter, Location loc, Value XW,
     S state, A activationSet, W weight, B bias, Value sequenceIV,
-    Value directionIV, bool isForward);
+    Value directionIV, bool isForward, RNNPackedBatch packedBatch);
 
 // Write states to the RNN's outputs.
 template <typename RNNOp, typename S>
@@ -131,8 +221,11 @@ void stateToOutput(ConversionPatternRewriter &rewriter, Location loc, RNNOp *op,
 // A common template for lowering an RNN operation.
 template <typename RNNOp, typename S, typename A, typename W, typename B>
 struct ONNXRNNOpLowering : public ConversionPattern {
-  ONNXRNNOpLowering(MLIRContext *ctx)
-      : ConversionPattern(RNNOp::getOperationName(), 1, ctx) {}
+  ONNXRNNOpLowering(MLIRContext *ctx, bool persistentStates = false)
+      : ConversionPattern(RNNOp::getOperationName(), 1, ctx),
+        persistentStates(persistentStates) {}
+
+  bool persistentStates;
 
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
@@ -149,7 +242,7 @@ struct ONNXRNNOpLowering : public ConversionPattern {
 
     // Initialize output states.
     S state = allocAndInitializeStates<RNNOp, S>(
-        rewriter, loc, &rnnOp, operandAdaptor);
+        rewriter, loc, &rnnOp, operandAdaptor, persistentStates);
 
     // Activation functions.
     A activationForward, activationReverse;
@@ -169,7 +262,20 @@ struct ONNXRNNOpLowering : public ConversionPattern {
     int64_t sequenceDimSize = dimAt(rnnOp.X(), 0);
     auto direction = rnnOp.direction();
 
-    if (direction == FORWARD || direction == BIDIRECTIONAL) {
+    // With sequence_lens, the steps only compute the sequences still running,
+    // sorted first.
+    RNNPackedBatch packedBatch = emitPackedBatch(
+        rewriter, loc, X, operandAdaptor.sequence_lens());
+
+    // The projections of the inputs onto the parameter weights do not depend
+    // on the states: compute those of all the timesteps at once.
+    Value XWForward, XWReverse;
+    if (direction == FORWARD || direction == BIDIRECTIONAL)
+      XWForward = emitInputProjection(rewriter, loc, X, weightForward.W);
+    if (direction == REVERSE || direction == BIDIRECTIONAL)
+      XWReverse = emitInputProjection(rewriter, loc, X, weightReverse.W);
+
+    auto emitForwardLoop = [&]() {
       BuildKrnlLoop sequenceLoops(rewriter, loc, 1);
       sequenceLoops.createDefineOp();
       if (sequenceDimSize != -1)
@@ -185,19 +291,15 @@ struct ONNXRNNOpLowering : public ConversionPattern {
         Value directionIV =
             emitConstantOp(rewriter, loc, rewriter.getIndexType(), 0);
         Value sequenceIV = sequenceLoops.getInductionVar(0);
-        // Get a slice of X at the current timestep.
-        Value Xt = emitXSliceAt(rewriter, loc, X, sequenceIV);
         // Emit calculation for one RNN step.
-        calculateState<S, A, W, B>(rewriter, loc, Xt, state, activationForward,
-            weightForward, biasForward, sequenceIV, directionIV,
-            /*isForward=*/true);
-        // Clean up
-        rewriter.create<memref::DeallocOp>(loc, Xt);
+        calculateState<S, A, W, B>(rewriter, loc, XWForward, state,
+            activationForward, weightForward, biasForward, sequenceIV,
+            directionIV, /*isForward=*/true, packedBatch);
       }
       rewriter.restoreInsertionPoint(ipSequenceLoops);
-    }
+    };
 
-    if (direction == REVERSE || direction == BIDIRECTIONAL) {
+    auto emitReverseLoop = [&]() {
       BuildKrnlLoop sequenceLoops(rewriter, loc, 1);
       sequenceLoops.createDefineOp();
       if (sequenceDimSize != -1)
@@ -222,19 +324,46 @@ struct ONNXRNNOpLowering : public ConversionPattern {
         else
           sequenceSize = rewriter.create<memref::DimOp>(loc, X, 0).getResult();
 
-        Value reverseSequenceIV = rewriter.create<AffineApplyOp>(loc,
-            reverseIVMap,
-            std::vector<Value>{sequenceLoops.getInductionVar(0), sequenceSize});
-        // Get a slice of X at the current timestep.
-        Value Xt = emitXSliceAt(rewriter, loc, X, reverseSequenceIV);
+        // The steps of the packed batch are reversed in each sequence.
+        Value reverseSequenceIV = sequenceLoops.getInductionVar(0);
+        if (!packedBatch.order)
+          reverseSequenceIV = rewriter.create<AffineApplyOp>(loc, reverseIVMap,
+              std::vector<Value>{reverseSequenceIV, sequenceSize});
         // Emit calculation for one RNN step.
-        calculateState<S, A, W, B>(rewriter, loc, Xt, state, activationReverse,
-            weightReverse, biasReverse, reverseSequenceIV, directionIV,
-            /*isForward=*/false);
-        // Clean up
-        rewriter.create<memref::DeallocOp>(loc, Xt);
+        calculateState<S, A, W, B>(rewriter, loc, XWReverse, state,
+            activationReverse, weightReverse, biasReverse, reverseSequenceIV,
+            directionIV, /*isForward=*/false, packedBatch);
       }
       rewriter.restoreInsertionPoint(ipSequenceLoops);
+    };
+
+    if (direction == FORWARD)
+      emitForwardLoop();
+    else if (direction == REVERSE)
+      emitReverseLoop();
+    else {
+      // The two directions only share the inputs: run them as two parallel
+      // tasks, the first one being the forward direction.
+      BuildKrnlLoop directionLoops(rewriter, loc, 1);
+      directionLoops.createDefineOp();
+      directionLoops.pushBounds(0, 2);
+      directionLoops.parallelizeLoop(0);
+      directionLoops.createIterateOp();
+
+      auto ipDirectionLoops = rewriter.saveInsertionPoint();
+      rewriter.setInsertionPointToStart(directionLoops.getIterateBlock());
+      {
+        Value isForward = rewriter.create<CmpIOp>(loc, CmpIPredicate::eq,
+            directionLoops.getInductionVar(0),
+            emitConstantOp(rewriter, loc, rewriter.getIndexType(), 0));
+        auto ifOp = rewriter.create<scf::IfOp>(
+            loc, isForward, /*withElseRegion=*/true);
+        rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+        emitForwardLoop();
+        rewriter.setInsertionPointToStart(&ifOp.elseRegion().front());
+        emitReverseLoop();
+      }
+      rewriter.restoreInsertionPoint(ipDirectionLoops);
     }
 
     std::vector<Value> outputs;
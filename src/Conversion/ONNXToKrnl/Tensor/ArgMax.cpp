@@ -1,28 +1,226 @@
-//===---------------- ArgMax.cpp - Lowering ArgMax Op -------------------===//
+//===------------ ArgMax.cpp - Lowering ArgMax and ArgMin Ops -------------===//
 //
-// This file lowers the ONNX ArgMax Operator to Krnl dialect.
+// This file lowers the ONNX ArgMax and ArgMin Operators to Krnl dialect.
 //
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
 #include "src/Dialect/ONNX/ONNXShapeHelper.hpp"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
 
 using namespace mlir;
 
-struct ONNXArgMaxOpLowering : public ConversionPattern {
-  ONNXArgMaxOpLowering(MLIRContext *ctx)
-      : ConversionPattern(mlir::ONNXArgMaxOp::getOperationName(), 1, ctx) {}
+// Size in bytes of the vectors of the best values found along the axis.
+static const int64_t argMinMaxVectorBytes = 32;
+
+// Predicate comparing a value to the best value found so far. The last index
+// is selected among equal values by also accepting equality.
+template <typename ArgOp>
+CmpFPredicate getArgMinMaxPredicate(bool selectLastIndex);
+
+template <>
+CmpFPredicate getArgMinMaxPredicate<ONNXArgMaxOp>(bool selectLastIndex) {
+  return selectLastIndex ? CmpFPredicate::OGE : CmpFPredicate::OGT;
+}
+
+template <>
+CmpFPredicate getArgMinMaxPredicate<ONNXArgMinOp>(bool selectLastIndex) {
+  return selectLastIndex ? CmpFPredicate::OLE : CmpFPredicate::OLT;
+}
+
+// Kind of the vector.reduction combining the best values of the lanes.
+template <typename ArgOp>
+StringRef getArgMinMaxReductionKind();
+
+template <>
+StringRef getArgMinMaxReductionKind<ONNXArgMaxOp>() {
+  return "max";
+}
+
+template <>
+StringRef getArgMinMaxReductionKind<ONNXArgMinOp>() {
+  return "min";
+}
+
+// Indices of the output element of the given indices of the data.
+static SmallVector<Value, 4> getArgMinMaxOutputIndices(
+    ArrayRef<Value> inIndices, std::map<int64_t, int64_t> &outInDimMap,
+    int64_t outRank, Value zeroIndex) {
+  SmallVector<Value, 4> outIndices;
+  for (int64_t i = 0; i < outRank; ++i) {
+    if (outInDimMap.find(i) != outInDimMap.end())
+      outIndices.emplace_back(inIndices[outInDimMap[i]]);
+    else
+      outIndices.emplace_back(zeroIndex);
+  }
+  return outIndices;
+}
+
+// Emit the ArgMax or ArgMin along the innermost dimension of a float data
+// with a static shape. Return false, emitting nothing, otherwise.
+//
+// Each lane of a vector keeps the best value of the elements it sees along
+// the innermost dimension and its index. The best value of the lanes is then
+// computed by a vector.reduction, and the index is resolved among the lanes
+// holding it: the smallest one, or the largest one when the last index is
+// selected. The trailing elements of a rank one data are compared by a scalar
+// epilogue. The loop over the output elements is parallel.
+template <typename ArgOp>
+bool emitVectorizedArgMinMax(ConversionPatternRewriter &rewriter,
+    Location loc, Value data, int64_t axis, bool selectLastIndex, Value alloc,
+    std::map<int64_t, int64_t> &outInDimMap) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+
+  auto dataType = data.getType().cast<MemRefType>();
+  auto dataShape = dataType.getShape();
+  Type elementType = dataType.getElementType();
+  int64_t dataRank = dataType.getRank();
+  int64_t outRank = alloc.getType().cast<MemRefType>().getRank();
+  if (axis != dataRank - 1 || !hasAllConstantDimensions(dataType) ||
+      !dataType.getAffineMaps().empty() || !elementType.isa<FloatType>())
+    return false;
+  int64_t lastDim = dataShape[dataRank - 1];
+  int64_t vectorLen =
+      argMinMaxVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+  if (lastDim < vectorLen || (dataRank > 1 && lastDim % vectorLen != 0))
+    return false;
+  int64_t numVectors = lastDim / vectorLen;
+  int64_t vectorizedDim = numVectors * vectorLen;
+
+  ScopedContext scope(rewriter, loc);
+  IndexExprScope ieScope(&rewriter, loc);
+  Value zeroIndex = std_constant_index(0);
+  Type indexType = rewriter.getIntegerType(64);
+  auto valueVecType = VectorType::get({vectorLen}, elementType);
+  auto indexVecType = VectorType::get({vectorLen}, indexType);
+  Value dataView = krnl_vector_type_cast(data, vectorLen);
+  CmpFPredicate predicate = getArgMinMaxPredicate<ArgOp>(selectLastIndex);
+
+  // Indices of the lanes, and the step of the indices between vectors.
+  SmallVector<int64_t, 16> lanes;
+  for (int64_t i = 0; i < vectorLen; ++i)
+    lanes.emplace_back(i);
+  Value laneIndices = rewriter.create<ConstantOp>(loc,
+      DenseElementsAttr::get(indexVecType, llvm::makeArrayRef(lanes)));
+  Value vectorLenVal = emitConstantOp(rewriter, loc, indexType, vectorLen);
+  // Index of the lanes not holding the best value, never selected.
+  Value noIndex = rewriter.create<SplatOp>(loc, indexVecType,
+      emitConstantOp(rewriter, loc, indexType, selectLastIndex ? -1 : lastDim));
+
+  auto emitRowArgMinMax = [&](ValueRange outerIndices) {
+    SmallVector<Value, 1> scalarAccess; // Empty.
+    Value bestValues = rewriter.create<memref::AllocaOp>(
+        loc, MemRefType::get({}, valueVecType));
+    Value bestIndices = rewriter.create<memref::AllocaOp>(
+        loc, MemRefType::get({}, indexVecType));
+    SmallVector<Value, 4> inIndices(outerIndices.begin(), outerIndices.end());
+    inIndices.emplace_back(zeroIndex);
+    krnl_store(krnl_load(dataView, inIndices), bestValues, scalarAccess);
+    krnl_store(laneIndices, bestIndices, scalarAccess);
+
+    ValueRange vectorLoops = krnl_define_loop(1);
+    krnl_iterate_ie(vectorLoops, {LiteralIndexExpr(1)},
+        {LiteralIndexExpr(numVectors)}, {}, [&](ValueRange args) {
+          Value v = krnl_get_induction_var_value(vectorLoops)[0];
+          SmallVector<Value, 4> indices(
+              outerIndices.begin(), outerIndices.end());
+          indices.emplace_back(v);
+          Value next = krnl_load(dataView, indices);
+          Value best = krnl_load(bestValues, scalarAccess);
+          Value isBetter = rewriter.create<CmpFOp>(loc, predicate, next, best);
+          Value firstIndex = rewriter.create<MulIOp>(loc,
+              rewriter.create<IndexCastOp>(loc, v, indexType), vectorLenVal);
+          Value nextIndices = rewriter.create<AddIOp>(loc,
+              rewriter.create<SplatOp>(loc, indexVecType, firstIndex),
+              laneIndices);
+          krnl_store(rewriter.create<SelectOp>(loc, isBetter, next, best),
+              bestValues, scalarAccess);
+          krnl_store(rewriter.create<SelectOp>(loc, isBetter, nextIndices,
+                         krnl_load(bestIndices, scalarAccess)),
+              bestIndices, scalarAccess);
+        });
+
+    // Resolve the best value and its index among the lanes.
+    Value best = krnl_load(bestValues, scalarAccess);
+    Value bestValue = rewriter.create<vector::ReductionOp>(loc, elementType,
+        rewriter.getStringAttr(getArgMinMaxReductionKind<ArgOp>()), best,
+        ValueRange{});
+    Value isBest = rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, best,
+        rewriter.create<SplatOp>(loc, valueVecType, bestValue));
+    Value candidates = rewriter.create<SelectOp>(
+        loc, isBest, krnl_load(bestIndices, scalarAccess), noIndex);
+    Value bestIndex = rewriter.create<vector::ReductionOp>(loc, indexType,
+        rewriter.getStringAttr(selectLastIndex ? "max" : "min"), candidates,
+        ValueRange{});
+    SmallVector<Value, 4> outIndices =
+        getArgMinMaxOutputIndices(inIndices, outInDimMap, outRank, zeroIndex);
+    krnl_store(bestIndex, alloc, outIndices);
+
+    // Scalar epilogue.
+    if (vectorizedDim < lastDim) {
+      Value bestAcc = rewriter.create<memref::AllocaOp>(
+          loc, MemRefType::get({}, elementType));
+      krnl_store(bestValue, bestAcc, scalarAccess);
+      ValueRange epilogueLoops = krnl_define_loop(1);
+      krnl_iterate_ie(epilogueLoops, {LiteralIndexExpr(vectorizedDim)},
+          {LiteralIndexExpr(lastDim)}, {}, [&](ValueRange args) {
+            Value i = krnl_get_induction_var_value(epilogueLoops)[0];
+            Value next = krnl_load(data, i);
+            Value best = krnl_load(bestAcc, scalarAccess);
+            Value isBetter =
+                rewriter.create<CmpFOp>(loc, predicate, next, best);
+            krnl_store(rewriter.create<SelectOp>(loc, isBetter, next, best),
+                bestAcc, scalarAccess);
+            krnl_store(rewriter.create<SelectOp>(loc, isBetter,
+                           rewriter.create<IndexCastOp>(loc, i, indexType),
+                           krnl_load(alloc, outIndices)),
+                alloc, outIndices);
+          });
+    }
+  };
+
+  if (dataRank == 1) {
+    emitRowArgMinMax({});
+    return true;
+  }
+  SmallVector<IndexExpr, 4> lbs, ubs;
+  for (int64_t i = 0; i < dataRank - 1; ++i) {
+    lbs.emplace_back(LiteralIndexExpr(0));
+    ubs.emplace_back(LiteralIndexExpr(dataShape[i]));
+  }
+  ValueRange outerLoops = krnl_define_loop(dataRank - 1);
+  for (int64_t i = 0; i < dataRank - 1; ++i)
+    if (dataShape[i] > 1) {
+      krnl_parallel(outerLoops[i]);
+      break;
+    }
+  krnl_iterate_ie(outerLoops, lbs, ubs, {}, [&](ValueRange args) {
+    emitRowArgMinMax(krnl_get_induction_var_value(outerLoops));
+  });
+  return true;
+}
+
+template <typename ArgOp, typename ArgOpAdaptor>
+struct ONNXArgMinMaxOpLowering : public ConversionPattern {
+  using ArgMinMaxShapeHelper =
+      ONNXGenericArgMinMaxOpShapeHelper<ArgOp, ArgOpAdaptor>;
+
+  ONNXArgMinMaxOpLowering(MLIRContext *ctx)
+      : ConversionPattern(ArgOp::getOperationName(), 1, ctx) {}
 
   LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
       ConversionPatternRewriter &rewriter) const final {
     // Gather info.
     auto loc = op->getLoc();
-    ONNXArgMaxOpAdaptor operandAdaptor(operands);
-    ONNXArgMaxOp argMaxOp = llvm::cast<ONNXArgMaxOp>(op);
+    ArgOpAdaptor operandAdaptor(operands);
+    ArgOp argOp = llvm::cast<ArgOp>(op);
 
     // shape helper
-    ONNXArgMaxOpShapeHelper shapeHelper(&argMaxOp, rewriter,
+    ArgMinMaxShapeHelper shapeHelper(&argOp, rewriter,
         getDenseElementAttributeFromKrnlValue,
         loadDenseElementArrayValueAtIndex);
 
@@ -33,7 +231,6 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
     // reduced output
     auto reducedMemRefType = convertToMemRefType(*op->result_type_begin());
     auto reducedElementType = reducedMemRefType.getElementType();
-    auto reducedMemrefShape = reducedMemRefType.getShape();
     int64_t reducedRank = reducedMemRefType.getRank();
 
     // data input
@@ -42,12 +239,13 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
     int64_t dataRank = dataType.getRank();
 
     // axis & keepdims attribute
-    int64_t axis = argMaxOp.axis();
+    int64_t axis = argOp.axis();
     assert(axis >= -dataRank && axis <= dataRank - 1);
     axis = axis >= 0 ? axis : (dataRank + axis);
 
-    int64_t keepdims = argMaxOp.keepdims();
+    int64_t keepdims = argOp.keepdims();
     bool isKeepdims = (keepdims == 1) ? true : false;
+    bool selectLastIndex = argOp.select_last_index() == 1;
 
     // Get type information
     llvm::SmallVector<int64_t, 1> axes;
@@ -59,6 +257,12 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
     Value alloc = insertAllocAndDeallocSimple(
         rewriter, op, reducedMemRefType, loc, shapeHelper.dimsForOutput(0));
 
+    if (emitVectorizedArgMinMax<ArgOp>(rewriter, loc, data, axis,
+            selectLastIndex, alloc, outInDimMap)) {
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
+
     // Constant Value
     auto minusOne = emitConstantOp(rewriter, loc, reducedElementType, -1);
     auto zero = emitConstantOp(rewriter, loc, reducedElementType, 0);
@@ -82,28 +286,29 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
 
     rewriter.restoreInsertionPoint(initLoopBody);
 
-    // 2. Krnl loop to calculate argmax.
+    // 2. Krnl loop to calculate argmax or argmin. The output elements are
+    // independent, so the outermost kept dimension is iterated in parallel.
     BuildKrnlLoop calcLoops(rewriter, loc, dataRank);
     calcLoops.createDefineOp();
     for (int i = 0; i < dataRank; ++i)
       calcLoops.pushBounds(0, data, i);
+    for (int i = 0; i < dataRank; ++i)
+      if (i != axis && dataType.getShape()[i] != 1) {
+        calcLoops.parallelizeLoop(i);
+        break;
+      }
     calcLoops.createIterateOp();
     rewriter.setInsertionPointToStart(calcLoops.getIterateBlock());
 
     // Handle the operation:
-    SmallVector<Value, 4> inLoopIVs, outLoopIVs, maxLoopIVs;
+    SmallVector<Value, 4> inLoopIVs, maxLoopIVs;
 
     for (int i = 0; i < dataRank; ++i) {
       inLoopIVs.push_back(calcLoops.getInductionVar(i));
     }
 
-    for (int i = 0; i < reducedRank; ++i) {
-      if (outInDimMap.find(i) != outInDimMap.end()) {
-        outLoopIVs.push_back(inLoopIVs[outInDimMap[i]]);
-      } else {
-        outLoopIVs.push_back(zeroIndex);
-      }
-    }
+    SmallVector<Value, 4> outLoopIVs = getArgMinMaxOutputIndices(
+        inLoopIVs, outInDimMap, reducedRank, zeroIndex);
 
     Value next = rewriter.create<KrnlLoadOp>(loc, data, inLoopIVs);
     Value idx = rewriter.create<KrnlLoadOp>(loc, alloc, outLoopIVs);
@@ -113,7 +318,7 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
         rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, idx, zero);
     idx = rewriter.create<SelectOp>(loc, lessThanZero, zero, idx);
 
-    // induction variables of current max value
+    // induction variables of current best value
     for (int i = 0; i < dataRank; ++i) {
       if (i != axis)
         maxLoopIVs.push_back(calcLoops.getInductionVar(i));
@@ -121,14 +326,14 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
         maxLoopIVs.push_back(
             rewriter.create<IndexCastOp>(loc, idx, rewriter.getIndexType()));
     }
-    Value maxVal = rewriter.create<KrnlLoadOp>(loc, data, maxLoopIVs);
+    Value bestVal = rewriter.create<KrnlLoadOp>(loc, data, maxLoopIVs);
 
-    // if next value is larger than current max value, update index
-    Value greaterThanMax =
-        rewriter.create<CmpFOp>(loc, CmpFPredicate::OGT, next, maxVal);
+    // if next value is better than current best value, update index
+    Value isBetter = rewriter.create<CmpFOp>(loc,
+        getArgMinMaxPredicate<ArgOp>(selectLastIndex), next, bestVal);
     Value pos = rewriter.create<IndexCastOp>(
         loc, inLoopIVs[axis], rewriter.getIntegerType(64));
-    idx = rewriter.create<SelectOp>(loc, greaterThanMax, pos, idx);
+    idx = rewriter.create<SelectOp>(loc, isBetter, pos, idx);
     rewriter.create<KrnlStoreOp>(loc, idx, alloc, outLoopIVs);
 
     rewriter.replaceOp(op, alloc);
@@ -136,7 +341,10 @@ struct ONNXArgMaxOpLowering : public ConversionPattern {
   }
 };
 
-void populateLoweringONNXArgMaxOpPattern(
+void populateLoweringONNXArgMinMaxOpPattern(
     RewritePatternSet &patterns, MLIRContext *ctx) {
-  patterns.insert<ONNXArgMaxOpLowering>(ctx);
+  patterns.insert<ONNXArgMinMaxOpLowering<ONNXArgMaxOp, ONNXArgMaxOpAdaptor>>(
+      ctx);
+  patterns.insert<ONNXArgMinMaxOpLowering<ONNXArgMinOp, ONNXArgMinOpAdaptor>>(
+      ctx);
 }
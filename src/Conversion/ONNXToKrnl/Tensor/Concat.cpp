@@ -12,6 +12,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/SCF/SCF.h"
+
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
 #include "src/Dialect/ONNX/ONNXShapeHelper.hpp"
 
@@ -41,15 +43,48 @@ struct ONNXConcatOpLowering : public ConversionPattern {
     // Alloc and dealloc.
     auto resultOperand = concatOp.concat_result();
     auto outputMemRefType = convertToMemRefType(*op->result_type_begin());
-    auto resultShape = outputMemRefType.getShape();
-    auto rank = resultShape.size();
+
+    // When the slices of the output along the axis are contiguous, e.g. for
+    // a concatenation along the channels of a single image, the inputs are
+    // copied by memcpy, or written in place by their producer.
+    bool contiguousSlices =
+        hasContiguousSlicesAlongAxis(outputMemRefType, axis);
+    for (int i = 0; i < inputNum; ++i)
+      contiguousSlices &= hasContiguousSlicesAlongAxis(
+          operands[i].getType().cast<MemRefType>(), axis);
+    if (contiguousSlices) {
+      Value alloc = emitConcatOfContiguousSlices(
+          rewriter, loc, op, operands, outputMemRefType, axis);
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
+
+    if (canAppendInPlace(op, operands, outputMemRefType, axis)) {
+      Value result = emitAppendInPlace(rewriter, loc, op, operands,
+          outputMemRefType, axis, shapeHelper.dimsForOutput(0));
+      rewriter.replaceOp(op, result);
+      return success();
+    }
 
     Value alloc = insertAllocAndDeallocSimple(
         rewriter, op, outputMemRefType, loc, shapeHelper.dimsForOutput(0));
-    ;
+    emitCopyLoops(rewriter, loc, operands, alloc, axis, /*firstInput=*/0,
+        useNonTemporalStores(outputMemRefType));
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+
+  // Emit the loops copying the inputs from the first given one into the
+  // output at their offsets along the axis. A large output is written around
+  // the caches.
+  static void emitCopyLoops(ConversionPatternRewriter &rewriter, Location loc,
+      ArrayRef<Value> operands, Value alloc, int64_t axis, int firstInput,
+      bool nonTemporal) {
+    int inputNum = operands.size();
+    int64_t rank = alloc.getType().cast<MemRefType>().getRank();
 
     // Creates loops, one for each input.
-    for (int i = 0; i < inputNum; ++i) {
+    for (int i = firstInput; i < inputNum; ++i) {
       OpBuilder::InsertionGuard insertGuard(rewriter);
       // Operand info.
       auto currShape = operands[i].getType().cast<MemRefType>().getShape();
@@ -81,10 +116,212 @@ struct ONNXConcatOpLowering : public ConversionPattern {
       // Insert copy.
       auto loadData =
           rewriter.create<KrnlLoadOp>(loc, operands[i], readIndices);
-      rewriter.create<KrnlStoreOp>(loc, loadData, alloc, writeIndices);
+      auto storeOp =
+          rewriter.create<KrnlStoreOp>(loc, loadData, alloc, writeIndices);
+      if (nonTemporal)
+        storeOp.setNonTemporal();
     }
-    rewriter.replaceOp(op, alloc);
-    return success();
+  }
+
+  // Check if the inputs after the first one can be appended in place, in the
+  // capacity along the axis of the buffer of the first input, e.g. the past
+  // keys or values of a decoder in an OMTensor created by
+  // omTensorCreateWithCapacity. The first input must be an argument of the
+  // function only used by the concat, and the output must only be returned.
+  // Their sizes along the axis must be dynamic, so that their strides before
+  // the axis, which tell the capacity, are those of their descriptors.
+  static bool canAppendInPlace(Operation *op, ArrayRef<Value> operands,
+      MemRefType outputMemRefType, int64_t axis) {
+    auto arg = operands[0].dyn_cast<BlockArgument>();
+    if (axis < 1 || !arg || !arg.getOwner()->isEntryBlock() ||
+        !llvm::isa<FuncOp>(arg.getOwner()->getParentOp()) ||
+        !op->getOperand(0).hasOneUse())
+      return false;
+    auto inputType = arg.getType().dyn_cast<MemRefType>();
+    if (!inputType || !inputType.getAffineMaps().empty() ||
+        !outputMemRefType.getAffineMaps().empty())
+      return false;
+    ArrayRef<int64_t> inputShape = inputType.getShape();
+    ArrayRef<int64_t> outputShape = outputMemRefType.getShape();
+    for (int64_t r = 0; r < outputMemRefType.getRank(); ++r)
+      if (r == axis ? inputShape[r] >= 0 || outputShape[r] >= 0
+                    : inputShape[r] != outputShape[r])
+        return false;
+    Value result = op->getResult(0);
+    return !result.use_empty() &&
+           llvm::all_of(result.getUsers(),
+               [](Operation *user) { return llvm::isa<ReturnOp>(user); });
+  }
+
+  // Emit the concatenation appending in place when the output fits in the
+  // buffer of the first input, i.e. the size of the output along the axis
+  // times the stride of the axis is at most the stride of the dimension
+  // before the axis. The output is then a view of the first input with its
+  // strides. Otherwise, the inputs are copied into a buffer returned by the
+  // function.
+  static Value emitAppendInPlace(ConversionPatternRewriter &rewriter,
+      Location loc, Operation *op, ArrayRef<Value> operands,
+      MemRefType outputMemRefType, int64_t axis,
+      SmallVectorImpl<IndexExpr> &outputDims) {
+    Value input = operands[0];
+    ArrayRef<int64_t> shape = outputMemRefType.getShape();
+    int64_t rank = shape.size();
+    auto emitStride = [&](int64_t r) -> Value {
+      return rewriter.create<KrnlStrideOp>(loc, rewriter.getIndexType(), input,
+          rewriter.getI64IntegerAttr(r));
+    };
+    Value size = rewriter.create<MulIOp>(
+        loc, outputDims[axis].getValue(), emitStride(axis));
+    Value fits = rewriter.create<CmpIOp>(
+        loc, CmpIPredicate::sle, size, emitStride(axis - 1));
+    auto ifOp = rewriter.create<scf::IfOp>(
+        loc, outputMemRefType, fits, /*withElseRegion=*/true);
+
+    OpBuilder::InsertionGuard insertGuard(rewriter);
+    rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+    // The strides are static until the first dynamic dimension from the end,
+    // as for the type of the view.
+    SmallVector<OpFoldResult, 4> sizes(rank), strides(rank);
+    int64_t staticStride = 1;
+    bool dynamicStride = false;
+    for (int64_t r = rank - 1; r >= 0; --r) {
+      if (dynamicStride)
+        strides[r] = emitStride(r);
+      else
+        strides[r] = rewriter.getIndexAttr(staticStride);
+      if (shape[r] < 0) {
+        sizes[r] = outputDims[r].getValue();
+        dynamicStride = true;
+      } else {
+        sizes[r] = rewriter.getIndexAttr(shape[r]);
+        staticStride *= shape[r];
+      }
+    }
+    Value view = rewriter.create<memref::ReinterpretCastOp>(loc,
+        outputMemRefType, input, rewriter.getIndexAttr(0), sizes, strides);
+    emitCopyLoops(rewriter, loc, operands, view, axis, /*firstInput=*/1,
+        /*nonTemporal=*/false);
+    rewriter.create<scf::YieldOp>(loc, view);
+
+    rewriter.setInsertionPointToStart(&ifOp.elseRegion().front());
+    Value alloc = insertAllocAndDeallocSimple(rewriter, op, outputMemRefType,
+        loc, outputDims, /*insertDealloc=*/false);
+    emitCopyLoops(rewriter, loc, operands, alloc, axis, /*firstInput=*/0,
+        /*nonTemporal=*/false);
+    rewriter.create<scf::YieldOp>(loc, alloc);
+    return ifOp.getResult(0);
+  }
+
+  // Return the buffer of the input of the concat at the given index when its
+  // producer can write it in place in the output: the input must be the only
+  // use of a value computed by an op of the same block into a buffer
+  // allocated for that value alone.
+  static memref::AllocOp getInPlaceInputBuffer(
+      Operation *op, ArrayRef<Value> operands, int index) {
+    Value input = op->getOperand(index);
+    Operation *inputOp = input.getDefiningOp();
+    if (!inputOp || !input.hasOneUse() || llvm::isa<ONNXIdentityOp>(inputOp))
+      return nullptr;
+    auto alloc = operands[index].getDefiningOp<memref::AllocOp>();
+    if (!alloc || alloc.getOperation()->getBlock() != op->getBlock())
+      return nullptr;
+    return alloc;
+  }
+
+  // Emit the concatenation of inputs whose slices in the output are
+  // contiguous. The inputs are laid at increasing byte offsets of a single
+  // buffer. The producers of the inputs that allow it write directly into
+  // their view of the buffer, the other inputs are copied by a memcpy.
+  static Value emitConcatOfContiguousSlices(
+      ConversionPatternRewriter &rewriter, Location loc, Operation *op,
+      ArrayRef<Value> operands, MemRefType outputMemRefType, int64_t axis) {
+    int inputNum = operands.size();
+    int64_t eltSizeInBytes = getMemRefEltSizeInBytes(outputMemRefType);
+    int64_t sliceSizeInBytes = eltSizeInBytes;
+    for (int64_t dim : outputMemRefType.getShape().drop_front(axis + 1))
+      sliceSizeInBytes *= dim;
+
+    // The buffer is freed with the output, so the producers can only write
+    // in it when the output is not returned.
+    bool insertDealloc = checkInsertDealloc(op);
+    SmallVector<memref::AllocOp, 4> inPlaceBuffers;
+    for (int i = 0; i < inputNum; ++i) {
+      memref::AllocOp inputBuffer =
+          insertDealloc ? getInPlaceInputBuffer(op, operands, i) : nullptr;
+      if (llvm::is_contained(inPlaceBuffers, inputBuffer))
+        inputBuffer = nullptr;
+      inPlaceBuffers.emplace_back(inputBuffer);
+    }
+
+    if (llvm::none_of(inPlaceBuffers, [](memref::AllocOp alloc) {
+          return static_cast<bool>(alloc);
+        })) {
+      Value alloc =
+          insertAllocAndDealloc(outputMemRefType, loc, rewriter, insertDealloc);
+      int64_t offset = 0;
+      for (int i = 0; i < inputNum; ++i) {
+        auto inputType = operands[i].getType().cast<MemRefType>();
+        Value outputSlice = emitStaticSliceView(
+            rewriter, loc, alloc, axis, offset, inputType.getShape());
+        Value sizeInBytes = emitConstantOp(rewriter, loc,
+            rewriter.getIntegerType(64), getMemRefSizeInBytes(operands[i]));
+        rewriter.create<KrnlMemcpyOp>(
+            loc, outputSlice, operands[i], sizeInBytes);
+        offset += inputType.getShape()[axis];
+      }
+      return alloc;
+    }
+
+    // The buffer, its views and the views written by the producers are
+    // emitted at the beginning of the block, before the producers.
+    auto bufferType = MemRefType::get(
+        {outputMemRefType.getNumElements() * eltSizeInBytes},
+        rewriter.getIntegerType(8));
+    Value buffer = insertAllocAndDealloc(
+        bufferType, loc, rewriter, /*insertDealloc=*/true);
+    auto emitView = [&](MemRefType type, int64_t byteShift) -> Value {
+      Value shift = rewriter.create<ConstantIndexOp>(loc, byteShift);
+      return rewriter.create<memref::ViewOp>(
+          loc, type, buffer, shift, ValueRange{});
+    };
+    Value alloc;
+    {
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointAfter(buffer.getDefiningOp());
+      alloc = emitView(outputMemRefType, 0);
+    }
+
+    int64_t offset = 0;
+    for (int i = 0; i < inputNum; ++i) {
+      auto inputType = operands[i].getType().cast<MemRefType>();
+      int64_t byteShift = offset * sliceSizeInBytes;
+      offset += inputType.getShape()[axis];
+      if (!inPlaceBuffers[i]) {
+        Value sizeInBytes = emitConstantOp(rewriter, loc,
+            rewriter.getIntegerType(64), getMemRefSizeInBytes(operands[i]));
+        rewriter.create<KrnlMemcpyOp>(
+            loc, emitView(inputType, byteShift), operands[i], sizeInBytes);
+        continue;
+      }
+
+      // The producer writes into the view, which is freed with the buffer.
+      Value inputView;
+      {
+        OpBuilder::InsertionGuard insertGuard(rewriter);
+        rewriter.setInsertionPointAfter(alloc.getDefiningOp());
+        inputView = emitView(inputType, byteShift);
+      }
+      memref::AllocOp inputBuffer = inPlaceBuffers[i];
+      SmallVector<Operation *, 1> deallocs;
+      for (Operation *user : inputBuffer.getResult().getUsers())
+        if (llvm::isa<memref::DeallocOp>(user))
+          deallocs.emplace_back(user);
+      for (Operation *dealloc : deallocs)
+        rewriter.eraseOp(dealloc);
+      inputBuffer.getResult().replaceAllUsesWith(inputView);
+      rewriter.eraseOp(inputBuffer);
+    }
+    return alloc;
   }
 };
 
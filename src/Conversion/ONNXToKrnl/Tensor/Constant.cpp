@@ -59,9 +59,11 @@ struct ONNXConstantOpLowering : public ConversionPattern {
         /*shape=*/rewriter.getI64ArrayAttr(shape),
         /*name=*/
         rewriter.getStringAttr("constant_" + std::to_string(constantID)),
-        /*value=*/constantOp.value().getValue(),
+        /*value=*/constantOp.valueAttr(),
         /*offset=*/nullptr,
         /*alignment=*/nullptr);
+    // External data is only read when the global is emitted.
+    copyExternalData(op, constantGlobal);
 
     // Increment constant ID:
     constantID++;
@@ -18,13 +18,13 @@
 using namespace mlir;
 
 //===----------------------------------------------------------------------===//
-// Helper function to insert alloc and dealloc ops for memref of dynamic shape.
+// Helper functions to compute the dynamic dimensions of the output and to
+// insert alloc and dealloc ops for memref of dynamic shape.
 //
 // Should namespace or static be used here?
-Value insertAllocAndDeallocForFlatten(MemRefType memRefType, Location loc,
-    ConversionPatternRewriter &rewriter, bool insertDealloc, Value input,
+SmallVector<Value, 2> getDynamicDimsForFlatten(MemRefType memRefType,
+    Location loc, ConversionPatternRewriter &rewriter, Value input,
     int64_t axisValue) {
-  memref::AllocOp alloc;
   auto inputShape = input.getType().cast<MemRefType>().getShape();
   auto inputRank = inputShape.size();
 
@@ -48,8 +48,14 @@ Value insertAllocAndDeallocForFlatten(MemRefType memRefType, Location loc,
     }
     allocOperands.emplace_back(dimVal);
   }
+  return allocOperands;
+}
 
-  alloc = rewriter.create<memref::AllocOp>(loc, memRefType, allocOperands);
+Value insertAllocAndDeallocForFlatten(MemRefType memRefType, Location loc,
+    ConversionPatternRewriter &rewriter, bool insertDealloc, Value input,
+    int64_t axisValue) {
+  memref::AllocOp alloc = rewriter.create<memref::AllocOp>(loc, memRefType,
+      getDynamicDimsForFlatten(memRefType, loc, rewriter, input, axisValue));
   if (insertDealloc) {
     auto *parentBlock = alloc.getOperation()->getBlock();
     auto dealloc = rewriter.create<memref::DeallocOp>(loc, alloc);
@@ -78,9 +84,19 @@ struct ONNXFlattenOpLowering : public ConversionPattern {
     if (axisValue < 0)
       axisValue = inputRank + axisValue;
 
+    // Only the view of the input changes, unless the input is not contiguous
+    // or the result outlives it.
+    MemRefType outputMemRefType = convertToMemRefType(*op->result_type_begin());
+    if (canLowerToInputView(op, input)) {
+      rewriter.replaceOp(op, emitReshapeView(rewriter, loc, input,
+                                 outputMemRefType,
+                                 getDynamicDimsForFlatten(outputMemRefType, loc,
+                                     rewriter, input, axisValue)));
+      return success();
+    }
+
     // Insert alloc and dealloc
     bool insertDealloc = checkInsertDealloc(op);
-    MemRefType outputMemRefType = convertToMemRefType(*op->result_type_begin());
     Value alloc;
     if (hasAllConstantDimensions(outputMemRefType))
       alloc =
@@ -17,6 +17,10 @@
 
 using namespace mlir;
 
+// Minimum size of the rows selected by the indices for them to be copied by a
+// memcpy rather than element by element.
+static const int64_t gatherRowCopyMinBytes = 64;
+
 struct ONNXGatherOpLowering : public ConversionPattern {
   ONNXGatherOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXGatherOp::getOperationName(), 1, ctx) {}
@@ -59,10 +63,31 @@ struct ONNXGatherOpLowering : public ConversionPattern {
           for kk in ndindex(Nk):
             out[ii + jj + kk] = data[ii + (indices[jj],) + kk]
     */
-    // Define loops and iteration trip counts (equivalent to size of output)
-    BuildKrnlLoop outputLoops(rewriter, loc, outputRank);
+    // When the dimensions kk of data are static, each index selects a
+    // contiguous row of data, which is copied to a contiguous row of the
+    // output. Large rows, e.g. the rows of an embedding table, are copied by a
+    // memcpy per row.
+    int64_t rowRank = dataRank - (axisLit + 1);
+    MemRefType dataType = operandAdaptor.data().getType().cast<MemRefType>();
+    ArrayRef<int64_t> rowShape = dataType.getShape().drop_front(axisLit + 1);
+    int64_t rowBytes = getMemRefEltSizeInBytes(dataType);
+    for (int64_t dim : rowShape)
+      rowBytes = (dim < 0) ? -1 : rowBytes * dim;
+    bool copyRows = rowRank > 0 && outputRank > rowRank &&
+                    rowBytes >= gatherRowCopyMinBytes &&
+                    dataType.getAffineMaps().empty();
+    int64_t loopRank = copyRows ? outputRank - rowRank : outputRank;
+
+    // Define loops and iteration trip counts (equivalent to size of output,
+    // or of its leading dimensions when copying rows). The loops are
+    // parallelized along their first dimension.
+    SmallVector<IndexExpr, 4> loopUbs(shapeHelper.dimsForOutput(0).begin(),
+        shapeHelper.dimsForOutput(0).begin() + loopRank);
+    BuildKrnlLoop outputLoops(rewriter, loc, loopRank);
     outputLoops.createDefineOp();
-    outputLoops.pushAllBounds(shapeHelper.dimsForOutput(0));
+    outputLoops.pushAllBounds(loopUbs);
+    if (loopRank > 0)
+      outputLoops.parallelizeLoop(0);
     outputLoops.createIterateOp();
     int iIndexStart = 0;
     int jIndexStart = iIndexStart + axisLit;
@@ -99,13 +124,28 @@ struct ONNXGatherOpLowering : public ConversionPattern {
       dataAccessFct.emplace_back(outputAccessFct[iIndexStart + i]);
     // Then add indices[jj] (indexVal).
     dataAccessFct.emplace_back(index);
-    // Then add kks.
-    for (int k = axisLit + 1; k < dataRank; ++k)
-      dataAccessFct.emplace_back(outputAccessFct[kIndexStart + k]);
-    Value data = krnl_load(operandAdaptor.data(), dataAccessFct);
 
-    // Save data into output
-    krnl_store(data, alloc, outputAccessFct);
+    if (copyRows) {
+      // Copy the row data[ii + (indices[jj],)] to out[ii + jj].
+      SmallVector<Value, 4> dataRowIndices, outputRowIndices;
+      IndexExpr::getValues(dataAccessFct, dataRowIndices);
+      IndexExpr::getValues(outputAccessFct, outputRowIndices);
+      Value dataRow = emitTrailingDimsView(
+          rewriter, loc, operandAdaptor.data(), dataRowIndices);
+      Value outputRow =
+          emitTrailingDimsView(rewriter, loc, alloc, outputRowIndices);
+      Value sizeInBytes = emitConstantOp(
+          rewriter, loc, rewriter.getIntegerType(64), rowBytes);
+      rewriter.create<KrnlMemcpyOp>(loc, outputRow, dataRow, sizeInBytes);
+    } else {
+      // Then add kks.
+      for (int k = axisLit + 1; k < dataRank; ++k)
+        dataAccessFct.emplace_back(outputAccessFct[kIndexStart + k]);
+      Value data = krnl_load(operandAdaptor.data(), dataAccessFct);
+
+      // Save data into output
+      krnl_store(data, alloc, outputAccessFct);
+    }
     rewriter.replaceOp(op, alloc);
     return success();
   }
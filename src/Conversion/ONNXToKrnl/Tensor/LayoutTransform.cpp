@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------- LayoutTransform.cpp - Lowering LayoutTransform Op --------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX LayoutTransform Operator, reordering tensors
+// between the plain layout NCHW and the blocked layout NCHW[b]c, to Krnl
+// dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+
+using namespace mlir;
+
+struct ONNXLayoutTransformOpLowering : public ConversionPattern {
+  ONNXLayoutTransformOpLowering(MLIRContext *ctx)
+      : ConversionPattern(
+            mlir::ONNXLayoutTransformOp::getOperationName(), 1, ctx) {}
+
+  // The plain element X[n][c][d1]...[dn] is the blocked element
+  // Y[n][c / b][d1]...[dn][c % b]. Both reorders loop over the plain tensor,
+  // whose innermost dimension is contiguous, the batch and channels in
+  // parallel. The channels of the last block past C are zeroed first.
+  //
+  //   for n, c, d1 .. dn:
+  //     Y[n][c / b][d1]...[dn][c % b] = X[n][c][d1]...[dn]    (block)
+  //     Y[n][c][d1]...[dn] = X[n][c / b][d1]...[dn][c % b]    (unblock)
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXLayoutTransformOpAdaptor operandAdaptor(operands);
+    ONNXLayoutTransformOp layoutOp = llvm::cast<ONNXLayoutTransformOp>(op);
+    auto loc = op->getLoc();
+    Value input = operandAdaptor.X();
+    auto inputType = input.getType().cast<MemRefType>();
+    auto memRefType = convertToMemRefType(*op->result_type_begin());
+    if (!hasAllConstantDimensions(inputType) ||
+        !hasAllConstantDimensions(memRefType))
+      return op->emitError("The layout transforms need static shapes");
+
+    using namespace mlir::edsc;
+    ScopedContext scope(rewriter, loc);
+    IndexExprScope ieScope(&rewriter, loc);
+
+    bool toBlocked = layoutOp.block_size() > 0;
+    auto plainShape = toBlocked ? inputType.getShape() : memRefType.getShape();
+    auto blockedShape =
+        toBlocked ? memRefType.getShape() : inputType.getShape();
+    int64_t blockSize = blockedShape.back();
+    int64_t numChannels = plainShape[1];
+    int64_t rank = plainShape.size();
+    SmallVector<IndexExpr, 1> noDims;
+    Value alloc =
+        insertAllocAndDeallocSimple(rewriter, op, memRefType, loc, noDims);
+
+    // Zero the last block when it is not full.
+    if (toBlocked && numChannels % blockSize != 0) {
+      Value zeroVal =
+          emitConstantOp(rewriter, loc, memRefType.getElementType(), 0);
+      SmallVector<IndexExpr, 6> lbs(rank + 1, LiteralIndexExpr(0)), ubs;
+      for (int64_t dim : blockedShape)
+        ubs.emplace_back(LiteralIndexExpr(dim));
+      lbs[1] = LiteralIndexExpr(blockedShape[1] - 1);
+      ValueRange padLoops = krnl_define_loop(rank + 1);
+      krnl_iterate_ie(padLoops, lbs, ubs, {}, [&](ValueRange args) {
+        ValueRange ivs = krnl_get_induction_var_value(padLoops);
+        krnl_store(zeroVal, alloc, ivs);
+      });
+    }
+
+    SmallVector<IndexExpr, 6> lbs(rank, LiteralIndexExpr(0)), ubs;
+    for (int64_t dim : plainShape)
+      ubs.emplace_back(LiteralIndexExpr(dim));
+    ValueRange loops = krnl_define_loop(rank);
+    krnl_parallel(loops[plainShape[0] > 1 ? 0 : 1]);
+    krnl_iterate_ie(loops, lbs, ubs, {}, [&](ValueRange args) {
+      IndexExprScope innerScope;
+      ValueRange ivs = krnl_get_induction_var_value(loops);
+      SmallVector<IndexExpr, 6> plainIndices, blockedIndices;
+      for (Value iv : ivs)
+        plainIndices.emplace_back(DimIndexExpr(iv));
+      DimIndexExpr c(ivs[1]);
+      blockedIndices.emplace_back(plainIndices[0]);
+      blockedIndices.emplace_back(c.floorDiv(LiteralIndexExpr(blockSize)));
+      blockedIndices.append(plainIndices.begin() + 2, plainIndices.end());
+      blockedIndices.emplace_back(c % LiteralIndexExpr(blockSize));
+      if (toBlocked)
+        krnl_store(krnl_load(input, plainIndices), alloc, blockedIndices);
+      else
+        krnl_store(krnl_load(input, blockedIndices), alloc, plainIndices);
+    });
+
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+};
+
+void populateLoweringONNXLayoutTransformOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXLayoutTransformOpLowering>(ctx);
+}
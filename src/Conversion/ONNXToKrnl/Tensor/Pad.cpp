@@ -17,6 +17,10 @@
 
 using namespace mlir;
 
+// Minimal size in bytes of the rows of the input for them to be copied into
+// the output by a memcpy rather than element by element.
+static const int64_t padRowCopyMinBytes = 64;
+
 struct ONNXPadOpLowering : public ConversionPattern {
   ONNXPadOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXPadOp::getOperationName(), 1, ctx) {}
@@ -73,30 +77,85 @@ struct ONNXPadOpLowering : public ConversionPattern {
 
     // get the padding value
     auto valueAttr = (*constantValAttr.getValues<FloatAttr>().begin());
+    Value input = operandAdaptor.data();
+    auto inputShape = input.getType().cast<MemRefType>().getShape();
+
+    // Store the padding value over the given box of the output.
+    auto emitPadFill = [&](ArrayRef<int64_t> lbs, ArrayRef<int64_t> ubs) {
+      OpBuilder::InsertionGuard insertGuard(rewriter);
+      BuildKrnlLoop padLoops(rewriter, loc, rank);
+      padLoops.createDefineOp();
+      for (int i = 0; i < rank; ++i)
+        padLoops.pushBounds(lbs[i], ubs[i]);
+      padLoops.createIterateOp();
+      rewriter.setInsertionPointToStart(padLoops.getIterateBlock());
+      SmallVector<Value, 4> outLoopIVs;
+      for (int i = 0; i < rank; ++i)
+        outLoopIVs.emplace_back(padLoops.getInductionVar(i));
+      auto paddingValue = rewriter.create<ConstantOp>(loc, valueAttr);
+      rewriter.create<KrnlStoreOp>(loc, paddingValue, alloc, outLoopIVs);
+    };
+
+    // Only the border of the output is filled with the padding value, so that
+    // the interior is written once. The border along a dimension is restricted
+    // to the interior of the outer dimensions, whose own border is filled
+    // first, so that the fill nests do not overlap. A negative pad crops the
+    // input, and the whole output is then filled.
+    bool hasNegativePads =
+        llvm::any_of(pads, [](int64_t pad) { return pad < 0; });
+    if (hasNegativePads) {
+      SmallVector<int64_t, 4> lbs(rank, 0);
+      emitPadFill(lbs, memRefShape);
+    } else {
+      for (int d = 0; d < rank; ++d) {
+        SmallVector<int64_t, 4> lbs, ubs;
+        for (int i = 0; i < rank; ++i) {
+          bool isInterior = i < d;
+          lbs.emplace_back(isInterior ? pads[i] : 0);
+          ubs.emplace_back(
+              isInterior ? pads[i] + inputShape[i] : memRefShape[i]);
+        }
+        // Border before the input.
+        if (pads[d] > 0) {
+          ubs[d] = pads[d];
+          emitPadFill(lbs, ubs);
+        }
+        // Border after the input.
+        if (pads[d + rank] > 0) {
+          lbs[d] = pads[d] + inputShape[d];
+          ubs[d] = memRefShape[d];
+          emitPadFill(lbs, ubs);
+        }
+      }
+    }
 
-    // Iterate over the loop nest using the output shape.
-    BuildKrnlLoop padLoops(rewriter, loc, rank);
-    padLoops.createDefineOp();
-    for (int i = 0; i < rank; ++i)
-      padLoops.pushBounds(0, alloc, i);
-    padLoops.createIterateOp();
+    // Rows of the input that are long enough are copied into the output by a
+    // memcpy, and only the outer dimensions are then iterated.
+    int64_t elementSize = getMemRefEltSizeInBytes(memRefType);
+    int64_t innerDim = inputShape[rank - 1];
+    bool copyRows = !hasNegativePads && innerDim > 0 &&
+                    innerDim * elementSize >= padRowCopyMinBytes &&
+                    input.getType().cast<MemRefType>().getAffineMaps().empty();
+    int64_t loopRank = copyRows ? rank - 1 : rank;
 
     // Iterate over the loop nest using the input shape.
-    BuildKrnlLoop valueLoops(rewriter, loc, rank);
-    valueLoops.createDefineOp();
-    for (int i = 0; i < rank; ++i)
-      valueLoops.pushBounds(0, operandAdaptor.data(), i);
-    valueLoops.createIterateOp();
-
-    // Copy the input data into the output.
-    rewriter.setInsertionPointToStart(valueLoops.getIterateBlock());
+    BuildKrnlLoop valueLoops(rewriter, loc, loopRank);
+    if (loopRank > 0) {
+      valueLoops.createDefineOp();
+      for (int i = 0; i < loopRank; ++i)
+        valueLoops.pushBounds(0, input, i);
+      valueLoops.createIterateOp();
+
+      // Copy the input data into the output.
+      rewriter.setInsertionPointToStart(valueLoops.getIterateBlock());
+    }
 
     SmallVector<Value, 4> inLoopIVs;
-    for (int i = 0; i < rank; ++i)
+    for (int i = 0; i < loopRank; ++i)
       inLoopIVs.emplace_back(valueLoops.getInductionVar(i));
 
     SmallVector<Value, 4> outLoopIVs;
-    for (int i = 0; i < rank; ++i) {
+    for (int i = 0; i < loopRank; ++i) {
       // Calculate the index for the load and store.
       if (pads[i] == 0) {
         outLoopIVs.emplace_back(valueLoops.getInductionVar(i));
@@ -109,17 +168,31 @@ struct ONNXPadOpLowering : public ConversionPattern {
       }
     }
 
-    auto originValue =
-        rewriter.create<KrnlLoadOp>(loc, operandAdaptor.data(), inLoopIVs);
-    rewriter.create<KrnlStoreOp>(loc, originValue, alloc, outLoopIVs);
-    rewriter.setInsertionPointToStart(padLoops.getIterateBlock());
-
-    SmallVector<Value, 4> outLoopIVs1;
-    for (int i = 0; i < rank; ++i)
-      outLoopIVs1.emplace_back(padLoops.getInductionVar(i));
-
-    auto paddingValue = rewriter.create<ConstantOp>(loc, valueAttr);
-    rewriter.create<KrnlStoreOp>(loc, paddingValue, alloc, outLoopIVs1);
+    if (copyRows) {
+      // Copy the input row into the interior of the output row.
+      SmallVector<OpFoldResult, 4> srcOffsets, dstOffsets, sizes, strides;
+      for (int i = 0; i < rank; ++i) {
+        bool isInner = i == rank - 1;
+        srcOffsets.emplace_back(
+            isInner ? OpFoldResult(rewriter.getIndexAttr(0)) : inLoopIVs[i]);
+        dstOffsets.emplace_back(isInner
+                                    ? OpFoldResult(rewriter.getIndexAttr(
+                                          pads[rank - 1]))
+                                    : outLoopIVs[i]);
+        sizes.emplace_back(rewriter.getIndexAttr(isInner ? innerDim : 1));
+        strides.emplace_back(rewriter.getIndexAttr(1));
+      }
+      Value src = rewriter.create<memref::SubViewOp>(
+          loc, input, srcOffsets, sizes, strides);
+      Value dst = rewriter.create<memref::SubViewOp>(
+          loc, alloc, dstOffsets, sizes, strides);
+      Value rowBytes = emitConstantOp(
+          rewriter, loc, rewriter.getIntegerType(64), innerDim * elementSize);
+      rewriter.create<KrnlMemcpyOp>(loc, dst, src, rowBytes);
+    } else {
+      auto originValue = rewriter.create<KrnlLoadOp>(loc, input, inLoopIVs);
+      rewriter.create<KrnlStoreOp>(loc, originValue, alloc, outLoopIVs);
+    }
 
     // Replace the original op with the generated code.
     rewriter.replaceOp(op, alloc);
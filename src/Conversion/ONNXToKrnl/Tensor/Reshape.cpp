@@ -63,8 +63,14 @@ struct ONNXReshapeOpLowering : public ConversionPattern {
     }
 
     bool insertDealloc = checkInsertDealloc(op);
+    // Only the view of the data changes, unless the data is not contiguous or
+    // the result outlives it.
+    bool isView = canLowerToInputView(op, data);
     if (hasAllConstantDimensions(memRefType)) {
-      alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
+      if (isView)
+        alloc = emitReshapeView(rewriter, loc, data, memRefType, {});
+      else
+        alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
     } else {
       // Calculate the unknown output dimensions using given shape information.
       // Shape information is store in the shape input. However, the shape input
@@ -155,21 +161,27 @@ struct ONNXReshapeOpLowering : public ConversionPattern {
         allocOperands.push_back(rewriter.create<IndexCastOp>(
             loc, actualDimVal, rewriter.getIndexType()));
       }
-      memref::AllocOp allocateMemref =
-          rewriter.create<memref::AllocOp>(loc, memRefType, allocOperands);
-
-      // Make sure to allocate at the beginning of the block if
-      // all dimensions are known.
-      auto *parentBlock = allocateMemref.getOperation()->getBlock();
-      if (insertDealloc) {
-        auto dealloc = rewriter.create<memref::DeallocOp>(loc, allocateMemref);
-        dealloc.getOperation()->moveBefore(&parentBlock->back());
-      }
+      if (isView) {
+        alloc = emitReshapeView(rewriter, loc, data, memRefType, allocOperands);
+      } else {
+        memref::AllocOp allocateMemref =
+            rewriter.create<memref::AllocOp>(loc, memRefType, allocOperands);
+
+        // Make sure to allocate at the beginning of the block if
+        // all dimensions are known.
+        auto *parentBlock = allocateMemref.getOperation()->getBlock();
+        if (insertDealloc) {
+          auto dealloc =
+              rewriter.create<memref::DeallocOp>(loc, allocateMemref);
+          dealloc.getOperation()->moveBefore(&parentBlock->back());
+        }
 
-      alloc = allocateMemref;
+        alloc = allocateMemref;
+      }
     }
 
-    rewriter.create<KrnlMemcpyOp>(loc, alloc, data, tensorSizeFromInput);
+    if (!isView)
+      rewriter.create<KrnlMemcpyOp>(loc, alloc, data, tensorSizeFromInput);
     rewriter.replaceOp(op, alloc);
 
     return success();
@@ -0,0 +1,307 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------------- Resize.cpp - Lowering Resize Op --------------------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX Resize and Upsample Operators to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/Vector/VectorOps.h"
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+
+using namespace mlir;
+
+// Size in bytes of the vectors along the innermost dimension of the linear
+// interpolations.
+static const int64_t resizeVectorBytes = 32;
+
+// The source position of the output position `o` along an axis of `inSize`
+// elements resized to `outSize` elements with `scale`.
+static double getResizeSourcePosition(StringRef coordinateMode, int64_t o,
+    int64_t inSize, int64_t outSize, double scale) {
+  if (coordinateMode == "asymmetric")
+    return o / scale;
+  if (coordinateMode == "align_corners")
+    return outSize == 1 ? 0 : o * (inSize - 1.0) / (outSize - 1.0);
+  if (coordinateMode == "pytorch_half_pixel")
+    return outSize == 1 ? 0 : (o + 0.5) / scale - 0.5;
+  if (coordinateMode == "tf_half_pixel_for_nn")
+    return (o + 0.5) / scale;
+  // half_pixel.
+  return (o + 0.5) / scale - 0.5;
+}
+
+// The index of the source element nearest to the source position `x`.
+static int64_t getResizeNearestIndex(
+    StringRef nearestMode, double x, int64_t inSize) {
+  int64_t index;
+  if (nearestMode == "floor")
+    index = std::floor(x);
+  else if (nearestMode == "ceil")
+    index = std::ceil(x);
+  else if (x == std::floor(x) + 0.5)
+    index = nearestMode == "round_prefer_ceil" ? std::ceil(x) : std::floor(x);
+  else
+    index = std::round(x);
+  return std::min(std::max(index, (int64_t)0), inSize - 1);
+}
+
+// The index tables of an axis resized by the lowering, computed at compile
+// time: the source index of each output index for the nearest mode, the two
+// source indices and the weight of the second one for the linear mode.
+struct ResizeAxisTables {
+  int64_t axis;
+  double ratio;
+  Value indices;
+  Value highIndices;
+  Value weights;
+};
+
+// Lower Resize, and Upsample which is a Resize with the asymmetric coordinate
+// transformation and the floor nearest mode, for static shapes. The source
+// positions along each resized axis only depend on the shapes, the scales and
+// the attributes, and are computed once when lowering, in global tables:
+//
+//   nearest: Y[.., o, ..] = X[.., I[o], ..]
+//   linear:  Y[.., o, ..] = X[.., L[o], ..] +
+//                           (X[.., H[o], ..] - X[.., L[o], ..]) * W[o]
+//
+// The linear interpolation is separable, and is computed by one pass per
+// resized axis, the axes shrinking most first since each pass costs the size
+// of its output. The passes along the outer axes interpolate whole rows of
+// the innermost dimension, which are processed as vectors.
+static LogicalResult emitResize(ConversionPatternRewriter &rewriter,
+    Operation *op, Value input, Value scales, StringRef mode,
+    StringRef coordinateMode, StringRef nearestMode) {
+  using namespace mlir::edsc;
+  using namespace mlir::edsc::intrinsics;
+  Location loc = op->getLoc();
+  auto inputType = input.getType().cast<MemRefType>();
+  auto outputType = convertToMemRefType(op->getResult(0).getType());
+  Type elementType = outputType.getElementType();
+  int64_t rank = outputType.getRank();
+  if (!hasAllConstantDimensions(inputType) ||
+      !hasAllConstantDimensions(outputType) ||
+      !(mode == "nearest" ||
+          (mode == "linear" && elementType.isa<FloatType>())) ||
+      coordinateMode == "tf_crop_and_resize")
+    return failure();
+  ArrayRef<int64_t> inShape = inputType.getShape();
+  ArrayRef<int64_t> outShape = outputType.getShape();
+
+  // The scales, which default to the ratios of the sizes when only the sizes
+  // are given.
+  SmallVector<double, 4> scaleValues;
+  for (int64_t i = 0; i < rank; ++i)
+    scaleValues.emplace_back(
+        inShape[i] == 0 ? 1.0 : (double)outShape[i] / inShape[i]);
+  if (DenseElementsAttr scalesAttr =
+          getDenseElementAttributeFromKrnlValue(scales)) {
+    if (scalesAttr.getNumElements() == rank) {
+      int64_t i = 0;
+      for (APFloat scale : scalesAttr.getValues<APFloat>())
+        scaleValues[i++] = scale.convertToFloat();
+    }
+  }
+
+  ScopedContext scope(rewriter, loc);
+  IndexExprScope ieScope(&rewriter, loc);
+  static int resizeTableID = 0;
+  std::string suffix = std::to_string(resizeTableID++);
+  auto createGlobal = [&](StringRef name, int64_t axis, Type type,
+                          ArrayRef<Attribute> values) -> Value {
+    auto tensorType = RankedTensorType::get({(int64_t)values.size()}, type);
+    MemRefType memRefType = MemRefType::get({(int64_t)values.size()}, type);
+    auto global = rewriter.create<KrnlGlobalOp>(loc, memRefType,
+        /*shape=*/rewriter.getI64ArrayAttr(memRefType.getShape()),
+        /*name=*/
+        rewriter.getStringAttr(
+            name.str() + std::to_string(axis) + "_" + suffix),
+        /*value=*/DenseElementsAttr::get(tensorType, values),
+        /*offset=*/nullptr,
+        /*alignment=*/rewriter.getI64IntegerAttr(BUFFER_ALIGN));
+    return global.getResult();
+  };
+
+  Type i32Type = rewriter.getIntegerType(32);
+  SmallVector<ResizeAxisTables, 4> resizedAxes;
+  for (int64_t axis = 0; axis < rank; ++axis) {
+    int64_t inSize = inShape[axis], outSize = outShape[axis];
+    if (inSize == outSize && scaleValues[axis] == 1.0)
+      continue;
+    if (inSize == 0 || outSize == 0)
+      continue;
+    ResizeAxisTables tables = {axis, (double)outSize / inSize};
+    SmallVector<Attribute, 16> indices, highIndices, weights;
+    for (int64_t o = 0; o < outSize; ++o) {
+      double x = getResizeSourcePosition(
+          coordinateMode, o, inSize, outSize, scaleValues[axis]);
+      if (mode == "nearest") {
+        indices.emplace_back(rewriter.getI32IntegerAttr(
+            getResizeNearestIndex(nearestMode, x, inSize)));
+        continue;
+      }
+      x = std::min(std::max(x, 0.0), inSize - 1.0);
+      int64_t low = std::floor(x);
+      indices.emplace_back(rewriter.getI32IntegerAttr(low));
+      highIndices.emplace_back(
+          rewriter.getI32IntegerAttr(std::min(low + 1, inSize - 1)));
+      weights.emplace_back(FloatAttr::get(elementType, x - low));
+    }
+    tables.indices = createGlobal("resize_indices_", axis, i32Type, indices);
+    if (mode == "linear") {
+      tables.highIndices =
+          createGlobal("resize_high_indices_", axis, i32Type, highIndices);
+      tables.weights =
+          createGlobal("resize_weights_", axis, elementType, weights);
+    }
+    resizedAxes.emplace_back(tables);
+  }
+
+  Value alloc = insertAllocAndDealloc(
+      outputType, loc, rewriter, checkInsertDealloc(op), {input});
+
+  auto loadIndex = [&](Value table, Value o) -> Value {
+    return rewriter.create<IndexCastOp>(
+        loc, krnl_load(table, o), rewriter.getIndexType());
+  };
+
+  // Iterate over the elements of a static shape, the outermost dimension
+  // larger than one in parallel.
+  auto iterate = [&](ArrayRef<int64_t> shape,
+                     function_ref<void(ValueRange)> bodyBuilder) {
+    SmallVector<IndexExpr, 4> lbs, ubs;
+    for (int64_t dim : shape) {
+      lbs.emplace_back(LiteralIndexExpr(0));
+      ubs.emplace_back(LiteralIndexExpr(dim));
+    }
+    ValueRange loops = krnl_define_loop(shape.size());
+    for (unsigned i = 0; i < shape.size(); ++i)
+      if (shape[i] != 1) {
+        krnl_parallel(loops[i]);
+        break;
+      }
+    krnl_iterate_ie(loops, lbs, ubs, {}, [&](ValueRange args) {
+      bodyBuilder(krnl_get_induction_var_value(loops));
+    });
+  };
+
+  if (rank == 0 || resizedAxes.empty()) {
+    iterate(outShape, [&](ValueRange ivs) {
+      krnl_store(krnl_load(input, ivs), alloc, ivs);
+    });
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+
+  if (mode == "nearest") {
+    iterate(outShape, [&](ValueRange ivs) {
+      SmallVector<Value, 4> inIndices(ivs.begin(), ivs.end());
+      for (ResizeAxisTables &tables : resizedAxes)
+        inIndices[tables.axis] = loadIndex(tables.indices, ivs[tables.axis]);
+      krnl_store(krnl_load(input, inIndices), alloc, ivs);
+    });
+    rewriter.replaceOp(op, alloc);
+    return success();
+  }
+
+  // Linear: one pass per resized axis, the axes shrinking most first.
+  llvm::stable_sort(resizedAxes,
+      [](const ResizeAxisTables &a, const ResizeAxisTables &b) {
+        return a.ratio < b.ratio;
+      });
+  Value source = input;
+  SmallVector<IndexExpr, 1> noDims;
+  SmallVector<int64_t, 4> shape(inShape.begin(), inShape.end());
+  for (unsigned p = 0; p < resizedAxes.size(); ++p) {
+    ResizeAxisTables &tables = resizedAxes[p];
+    int64_t axis = tables.axis;
+    shape[axis] = outShape[axis];
+    Value dest = alloc;
+    if (p + 1 < resizedAxes.size())
+      dest = insertAllocAndDeallocSimple(rewriter, op,
+          MemRefType::get(shape, elementType), loc, noDims,
+          /*insertDealloc=*/true);
+
+    // Interpolate the rows of the innermost dimension as vectors when the
+    // pass is along an outer axis.
+    int64_t lastDim = shape[rank - 1];
+    int64_t vectorLen =
+        resizeVectorBytes * 8 / elementType.getIntOrFloatBitWidth();
+    bool isVectorized =
+        axis != rank - 1 && lastDim % vectorLen == 0 &&
+        source.getType().cast<MemRefType>().getAffineMaps().empty();
+    Value sourceView = source, destView = dest;
+    SmallVector<int64_t, 4> loopShape(shape.begin(), shape.end());
+    VectorType vectorType;
+    if (isVectorized) {
+      sourceView = krnl_vector_type_cast(source, vectorLen);
+      destView = krnl_vector_type_cast(dest, vectorLen);
+      loopShape[rank - 1] = lastDim / vectorLen;
+      vectorType = VectorType::get({vectorLen}, elementType);
+    }
+
+    iterate(loopShape, [&](ValueRange ivs) {
+      Value o = ivs[axis];
+      SmallVector<Value, 4> lowIndices(ivs.begin(), ivs.end());
+      SmallVector<Value, 4> highIndices(ivs.begin(), ivs.end());
+      lowIndices[axis] = loadIndex(tables.indices, o);
+      highIndices[axis] = loadIndex(tables.highIndices, o);
+      Value weight = krnl_load(tables.weights, o);
+      if (isVectorized)
+        weight = rewriter.create<SplatOp>(loc, vectorType, weight);
+      Value low = krnl_load(sourceView, lowIndices);
+      Value high = krnl_load(sourceView, highIndices);
+      Value delta = rewriter.create<SubFOp>(loc, high, low);
+      Value result = rewriter.create<AddFOp>(
+          loc, low, rewriter.create<MulFOp>(loc, delta, weight));
+      krnl_store(result, destView, ivs);
+    });
+    source = dest;
+  }
+
+  rewriter.replaceOp(op, alloc);
+  return success();
+}
+
+struct ONNXResizeOpLowering : public ConversionPattern {
+  ONNXResizeOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXResizeOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXResizeOpAdaptor operandAdaptor(operands);
+    ONNXResizeOp resizeOp = llvm::cast<ONNXResizeOp>(op);
+    return emitResize(rewriter, op, operandAdaptor.X(),
+        operandAdaptor.scales(), resizeOp.mode(),
+        resizeOp.coordinate_transformation_mode(), resizeOp.nearest_mode());
+  }
+};
+
+struct ONNXUpsampleOpLowering : public ConversionPattern {
+  ONNXUpsampleOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXUpsampleOp::getOperationName(), 1, ctx) {}
+
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    ONNXUpsampleOpAdaptor operandAdaptor(operands);
+    ONNXUpsampleOp upsampleOp = llvm::cast<ONNXUpsampleOp>(op);
+    return emitResize(rewriter, op, operandAdaptor.X(),
+        operandAdaptor.scales(), upsampleOp.mode(), "asymmetric", "floor");
+  }
+};
+
+void populateLoweringONNXResizeOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXResizeOpLowering, ONNXUpsampleOpLowering>(ctx);
+}
@@ -17,6 +17,19 @@
 
 using namespace mlir;
 
+// Minimal size in bytes of the innermost runs of the output for them to be
+// copied by a memcpy rather than element by element.
+static const int64_t sliceRunCopyMinBytes = 64;
+
+// Return the literal of an index expression as an attribute, its value
+// otherwise.
+static OpFoldResult getOpFoldResult(
+    ConversionPatternRewriter &rewriter, IndexExpr expr) {
+  if (expr.isLiteral())
+    return rewriter.getIndexAttr(expr.getLiteral());
+  return expr.getValue();
+}
+
 struct ONNXSliceOpLowering : public ConversionPattern {
   ONNXSliceOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXSliceOp::getOperationName(), 1, ctx) {}
@@ -33,15 +46,47 @@ struct ONNXSliceOpLowering : public ConversionPattern {
     auto shapecomputed = shapeHelper.Compute(operandAdaptor);
     assert(succeeded(shapecomputed));
 
+    Value data = operandAdaptor.data();
     auto outputMemRefType = convertToMemRefType(*op->result_type_begin());
     int64_t outputRank = outputMemRefType.getShape().size();
+    SmallVectorImpl<IndexExpr> &outputDims = shapeHelper.dimsForOutput(0);
+
+    // A slice with unit steps is a view of the data, unless the data is not
+    // contiguous or the slice outlives it.
+    bool hasUnitSteps = llvm::all_of(shapeHelper.steps,
+        [](IndexExpr step) { return step.isLiteralAndIdenticalTo(1); });
+    if (hasUnitSteps && canLowerToInputView(op, data)) {
+      SmallVector<OpFoldResult, 4> offsets, sizes, strides;
+      for (int ii = 0; ii < outputRank; ++ii) {
+        offsets.emplace_back(getOpFoldResult(rewriter, shapeHelper.starts[ii]));
+        sizes.emplace_back(getOpFoldResult(rewriter, outputDims[ii]));
+        strides.emplace_back(rewriter.getIndexAttr(1));
+      }
+      rewriter.replaceOp(op, rewriter.create<memref::SubViewOp>(
+                                 loc, data, offsets, sizes, strides)
+                                 .getResult());
+      return success();
+    }
+
     // Insert an allocation and deallocation for the output of this operation.
     Value alloc = insertAllocAndDeallocSimple(
-        rewriter, op, outputMemRefType, loc, shapeHelper.dimsForOutput(0));
+        rewriter, op, outputMemRefType, loc, outputDims);
 
-    BuildKrnlLoop outputLoops(rewriter, loc, outputRank);
+    // With a unit step along the innermost dimension, the innermost runs of
+    // the output are contiguous in the data, and long enough runs are copied
+    // by a memcpy. Only the outer dimensions are then iterated.
+    int64_t elementSize = getMemRefEltSizeInBytes(outputMemRefType);
+    int64_t innerDim = outputMemRefType.getShape()[outputRank - 1];
+    bool copyRuns =
+        shapeHelper.steps[outputRank - 1].isLiteralAndIdenticalTo(1) &&
+        innerDim > 0 && innerDim * elementSize >= sliceRunCopyMinBytes &&
+        data.getType().cast<MemRefType>().getAffineMaps().empty();
+    int64_t loopRank = copyRuns ? outputRank - 1 : outputRank;
+
+    BuildKrnlLoop outputLoops(rewriter, loc, loopRank);
     outputLoops.createDefineOp();
-    outputLoops.pushAllBounds(shapeHelper.dimsForOutput(0));
+    for (int ii = 0; ii < loopRank; ++ii)
+      outputLoops.pushBounds(0, outputDims[ii]);
     outputLoops.createIterateOp();
     rewriter.setInsertionPointToStart(outputLoops.getIterateBlock());
 
@@ -55,7 +100,7 @@ struct ONNXSliceOpLowering : public ConversionPattern {
     // Store: "i" for all dims.
     SmallVector<IndexExpr, 4> loadIndices;
     SmallVector<IndexExpr, 4> storeIndices;
-    for (int ii = 0; ii < outputRank; ++ii) {
+    for (int ii = 0; ii < loopRank; ++ii) {
       Value inductionVal = outputLoops.getInductionVar(ii);
       DimIndexExpr inductionIndex(inductionVal);
       IndexExpr start = SymbolIndexExpr(shapeHelper.starts[ii]);
@@ -63,9 +108,30 @@ struct ONNXSliceOpLowering : public ConversionPattern {
       loadIndices.emplace_back((step * inductionIndex) + start);
       storeIndices.emplace_back(inductionIndex);
     }
-    // Load data and store in alloc data.
-    Value loadVal = krnl_load(operandAdaptor.data(), loadIndices);
-    krnl_store(loadVal, alloc, storeIndices);
+    if (copyRuns) {
+      // Copy the run starting at the innermost start into the output row.
+      loadIndices.emplace_back(SymbolIndexExpr(shapeHelper.starts.back()));
+      storeIndices.emplace_back(LiteralIndexExpr(0));
+      SmallVector<OpFoldResult, 4> srcOffsets, dstOffsets, sizes, strides;
+      for (int ii = 0; ii < outputRank; ++ii) {
+        srcOffsets.emplace_back(getOpFoldResult(rewriter, loadIndices[ii]));
+        dstOffsets.emplace_back(getOpFoldResult(rewriter, storeIndices[ii]));
+        sizes.emplace_back(
+            rewriter.getIndexAttr(ii == outputRank - 1 ? innerDim : 1));
+        strides.emplace_back(rewriter.getIndexAttr(1));
+      }
+      Value src = rewriter.create<memref::SubViewOp>(
+          loc, data, srcOffsets, sizes, strides);
+      Value dst = rewriter.create<memref::SubViewOp>(
+          loc, alloc, dstOffsets, sizes, strides);
+      Value runBytes = emitConstantOp(
+          rewriter, loc, rewriter.getIntegerType(64), innerDim * elementSize);
+      rewriter.create<KrnlMemcpyOp>(loc, dst, src, runBytes);
+    } else {
+      // Load data and store in alloc data.
+      Value loadVal = krnl_load(data, loadIndices);
+      krnl_store(loadVal, alloc, storeIndices);
+    }
 
     rewriter.replaceOp(op, alloc);
     return success();
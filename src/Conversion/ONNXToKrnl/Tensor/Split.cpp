@@ -17,6 +17,10 @@
 
 using namespace mlir;
 
+// Minimal size in bytes of the contiguous chunks of an output for them to be
+// copied by a memcpy rather than element by element.
+static const int64_t splitChunkCopyMinBytes = 64;
+
 struct ONNXSplitOpLowering : public ConversionPattern {
   ONNXSplitOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXSplitOp::getOperationName(), 1, ctx) {}
@@ -38,6 +42,31 @@ struct ONNXSplitOpLowering : public ConversionPattern {
     auto shapecomputed = shapeHelper.Compute(operandAdaptor);
     assert(succeeded(shapecomputed));
 
+    // When the slices of the input along the axis are contiguous, the outputs
+    // are views of the input, unless they outlive it. The QKV projections of
+    // the attention layers are split along their outermost non-unit axis.
+    Value input = operandAdaptor.input();
+    auto inputType = input.getType().cast<MemRefType>();
+    bool contiguousSlices = hasContiguousSlicesAlongAxis(inputType, axis);
+    bool outputViews = contiguousSlices;
+    for (int i = 0; i < outputNum; ++i)
+      outputViews &= checkInsertDealloc(op, i) &&
+                     hasAllConstantDimensions(convertToMemRefType(
+                         splitOp.outputs()[i].getType()));
+    if (outputViews) {
+      SmallVector<Value, 4> views;
+      int64_t offset = 0;
+      for (int i = 0; i < outputNum; ++i) {
+        ArrayRef<int64_t> outputShape =
+            convertToMemRefType(splitOp.outputs()[i].getType()).getShape();
+        views.emplace_back(emitStaticSliceView(
+            rewriter, loc, input, axis, offset, outputShape));
+        offset += outputShape[axis];
+      }
+      rewriter.replaceOp(op, views);
+      return success();
+    }
+
     // Alloc and dealloc.
     SmallVector<Value, 4> allocs;
     for (int i = 0; i < outputNum; ++i) {
@@ -48,6 +77,88 @@ struct ONNXSplitOpLowering : public ConversionPattern {
       allocs.emplace_back(alloc);
     }
 
+    // When the slices of the input along the axis are contiguous, each
+    // output is copied by a memcpy.
+    for (Value alloc : allocs)
+      contiguousSlices &=
+          hasAllConstantDimensions(alloc.getType().cast<MemRefType>());
+    if (contiguousSlices) {
+      int64_t offset = 0;
+      for (Value alloc : allocs) {
+        ArrayRef<int64_t> outputShape =
+            alloc.getType().cast<MemRefType>().getShape();
+        Value inputSlice = emitStaticSliceView(
+            rewriter, loc, input, axis, offset, outputShape);
+        Value sizeInBytes = emitConstantOp(rewriter, loc,
+            rewriter.getIntegerType(64), getMemRefSizeInBytes(alloc));
+        rewriter.create<KrnlMemcpyOp>(loc, alloc, inputSlice, sizeInBytes);
+        offset += outputShape[axis];
+      }
+      rewriter.replaceOp(op, allocs);
+      return success();
+    }
+
+    // Otherwise, the dimensions from the axis form contiguous chunks of the
+    // input and of the outputs, which are copied by a memcpy when they are
+    // static and long enough. Only the dimensions before the axis are then
+    // iterated.
+    ArrayRef<int64_t> inputShape = inputType.getShape();
+    int64_t elementSize = getMemRefEltSizeInBytes(inputType);
+    int64_t innerElements = 1;
+    for (int64_t r = axis + 1; r < rank; ++r)
+      innerElements *= inputShape[r];
+    bool copyChunks =
+        inputType.getAffineMaps().empty() &&
+        llvm::all_of(inputShape.drop_front(axis + 1),
+            [](int64_t dim) { return dim > 0; });
+    for (Value alloc : allocs) {
+      int64_t splitDim = alloc.getType().cast<MemRefType>().getShape()[axis];
+      copyChunks &= splitDim > 0 &&
+                    splitDim * innerElements * elementSize >=
+                        splitChunkCopyMinBytes;
+    }
+    if (copyChunks) {
+      int64_t offset = 0;
+      for (int i = 0; i < outputNum; ++i) {
+        OpBuilder::InsertionGuard insertGuard(rewriter);
+        auto outputType = allocs[i].getType().cast<MemRefType>();
+        int64_t splitDim = outputType.getShape()[axis];
+        BuildKrnlLoop outerLoops(rewriter, loc, axis);
+        outerLoops.createDefineOp();
+        for (int64_t r = 0; r < axis; ++r)
+          outerLoops.pushBounds(0, allocs[i], r);
+        outerLoops.createIterateOp();
+        rewriter.setInsertionPointToStart(outerLoops.getIterateBlock());
+
+        SmallVector<OpFoldResult, 4> srcOffsets, dstOffsets, sizes, strides;
+        for (int64_t r = 0; r < rank; ++r) {
+          if (r < axis) {
+            srcOffsets.emplace_back(outerLoops.getInductionVar(r));
+            dstOffsets.emplace_back(outerLoops.getInductionVar(r));
+            sizes.emplace_back(rewriter.getIndexAttr(1));
+          } else {
+            srcOffsets.emplace_back(
+                rewriter.getIndexAttr(r == axis ? offset : 0));
+            dstOffsets.emplace_back(rewriter.getIndexAttr(0));
+            sizes.emplace_back(
+                rewriter.getIndexAttr(outputType.getShape()[r]));
+          }
+          strides.emplace_back(rewriter.getIndexAttr(1));
+        }
+        Value src = rewriter.create<memref::SubViewOp>(
+            loc, input, srcOffsets, sizes, strides);
+        Value dst = rewriter.create<memref::SubViewOp>(
+            loc, allocs[i], dstOffsets, sizes, strides);
+        Value chunkBytes = emitConstantOp(rewriter, loc,
+            rewriter.getIntegerType(64),
+            splitDim * innerElements * elementSize);
+        rewriter.create<KrnlMemcpyOp>(loc, dst, src, chunkBytes);
+        offset += splitDim;
+      }
+      rewriter.replaceOp(op, allocs);
+      return success();
+    }
+
     // Creates loops, one for each output.
     for (int i = 0; i < outputNum; ++i) {
       OpBuilder::InsertionGuard insertGuard(rewriter);
@@ -42,6 +42,22 @@ struct ONNXSqueezeOpLowering : public ConversionPattern {
     // and compute the output tensor's size in bytes.
     Value alloc, tensorSize;
     bool insertDealloc = checkInsertDealloc(op);
+    // Only the view of the data changes, unless the data is not contiguous or
+    // the result outlives it.
+    if (canLowerToInputView(op, data)) {
+      SmallVector<Value, 4> dynamicDims;
+      int64_t inRank = data.getType().cast<ShapedType>().getRank();
+      for (int64_t inIdx = 0, outIdx = 0; inIdx < inRank; ++inIdx) {
+        if (std::find(axes.begin(), axes.end(), inIdx) != axes.end())
+          continue;
+        if (memRefShape[outIdx++] < 0)
+          dynamicDims.emplace_back(
+              rewriter.create<memref::DimOp>(loc, data, inIdx));
+      }
+      rewriter.replaceOp(
+          op, emitReshapeView(rewriter, loc, data, memRefType, dynamicDims));
+      return success();
+    }
     if (hasAllConstantDimensions(memRefType)) {
       alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
       auto tensorSizeInBytes = elementSizeInBytes;
@@ -53,6 +53,105 @@ Value insertAllocAndDeallocForTile(MemRefType memRefType, Location loc,
   return alloc;
 }
 
+// Minimal size in bytes of the contiguous blocks of the input for the output
+// to be built by memcpys of these blocks rather than element by element.
+static const int64_t tileBlockCopyMinBytes = 64;
+
+// Build the output of a Tile with static shapes and identity layouts from
+// memcpys. The blocks of the input spanning dimension `firstDim` and the
+// following ones, which are not repeated, are copied into the output first.
+// Then, from the innermost repeated dimension, the block of the output holding
+// the elements whose indices along it are within the input dimension is
+// replicated by copying it after itself, doubling its size each time.
+static void emitTileByBlockCopies(ConversionPatternRewriter &rewriter,
+    Location loc, Value input, Value alloc, int64_t firstDim) {
+  ArrayRef<int64_t> inputShape =
+      input.getType().cast<MemRefType>().getShape();
+  auto outputType = alloc.getType().cast<MemRefType>();
+  ArrayRef<int64_t> outputShape = outputType.getShape();
+  int64_t rank = inputShape.size();
+  int64_t elementSize = getMemRefEltSizeInBytes(outputType);
+
+  // Strides in elements.
+  SmallVector<int64_t, 4> inputStrides(rank, 1), outputStrides(rank, 1);
+  for (int64_t i = rank - 2; i >= 0; --i) {
+    inputStrides[i] = inputStrides[i + 1] * inputShape[i + 1];
+    outputStrides[i] = outputStrides[i + 1] * outputShape[i + 1];
+  }
+  Type elementType = outputType.getElementType();
+  Value flatInput = emitReshapeView(rewriter, loc, input,
+      MemRefType::get({inputShape[0] * inputStrides[0]}, elementType), {});
+  Value flatOutput = emitReshapeView(rewriter, loc, alloc,
+      MemRefType::get({outputShape[0] * outputStrides[0]}, elementType), {});
+
+  auto emitLinearOffset = [&](ValueRange indices, ArrayRef<int64_t> strides,
+                              int64_t start) -> Value {
+    Value offset = rewriter.create<ConstantIndexOp>(loc, start);
+    for (unsigned i = 0; i < indices.size(); ++i)
+      offset = rewriter.create<AddIOp>(loc, offset,
+          rewriter.create<MulIOp>(loc, indices[i],
+              rewriter.create<ConstantIndexOp>(loc, strides[i])));
+    return offset;
+  };
+  auto emitBlockCopy = [&](Value dst, Value dstOffset, Value src,
+                           Value srcOffset, int64_t size) {
+    auto emitBlockView = [&](Value flat, Value offset) -> Value {
+      SmallVector<OpFoldResult, 1> offsets = {offset};
+      SmallVector<OpFoldResult, 1> sizes = {rewriter.getIndexAttr(size)};
+      SmallVector<OpFoldResult, 1> strides = {rewriter.getIndexAttr(1)};
+      return rewriter.create<memref::SubViewOp>(
+          loc, flat, offsets, sizes, strides);
+    };
+    Value sizeInBytes = emitConstantOp(
+        rewriter, loc, rewriter.getIntegerType(64), size * elementSize);
+    rewriter.create<KrnlMemcpyOp>(loc, emitBlockView(dst, dstOffset),
+        emitBlockView(src, srcOffset), sizeInBytes);
+  };
+  // Iterate over the input indices along the dimensions before `dim`.
+  auto iterateOuterDims = [&](int64_t dim,
+                              function_ref<void(ValueRange)> bodyFn) {
+    if (dim == 0) {
+      bodyFn({});
+      return;
+    }
+    OpBuilder::InsertionGuard insertGuard(rewriter);
+    BuildKrnlLoop outerLoops(rewriter, loc, dim);
+    outerLoops.createDefineOp();
+    for (int64_t i = 0; i < dim; ++i)
+      outerLoops.pushBounds(0, inputShape[i]);
+    outerLoops.createIterateOp();
+    rewriter.setInsertionPointToStart(outerLoops.getIterateBlock());
+    SmallVector<Value, 4> indices;
+    for (int64_t i = 0; i < dim; ++i)
+      indices.emplace_back(outerLoops.getInductionVar(i));
+    bodyFn(indices);
+  };
+
+  // 1. Copy the blocks of the input.
+  int64_t blockSize = inputShape[firstDim] * inputStrides[firstDim];
+  iterateOuterDims(firstDim, [&](ValueRange indices) {
+    emitBlockCopy(flatOutput, emitLinearOffset(indices, outputStrides, 0),
+        flatInput, emitLinearOffset(indices, inputStrides, 0), blockSize);
+  });
+
+  // 2. Replicate the blocks along the repeated dimensions.
+  for (int64_t dim = firstDim; dim >= 0; --dim) {
+    int64_t filled = inputShape[dim] * outputStrides[dim];
+    int64_t total = outputShape[dim] * outputStrides[dim];
+    if (filled == 0 || filled == total)
+      continue;
+    iterateOuterDims(dim, [&](ValueRange indices) {
+      for (int64_t done = filled; done < total;) {
+        int64_t size = std::min(done, total - done);
+        emitBlockCopy(flatOutput,
+            emitLinearOffset(indices, outputStrides, done), flatOutput,
+            emitLinearOffset(indices, outputStrides, 0), size);
+        done += size;
+      }
+    });
+  }
+}
+
 struct ONNXTileOpLowering : public ConversionPattern {
   ONNXTileOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXTileOp::getOperationName(), 1, ctx) {}
@@ -81,6 +180,28 @@ struct ONNXTileOpLowering : public ConversionPattern {
     Value alloc = insertAllocAndDeallocSimple(
         rewriter, op, outputMemRefType, loc, shapeHelper.dimsForOutput(0));
 
+    // With static shapes, the output is replicated from large enough blocks
+    // of the input. The blocks span the innermost repeated dimension and the
+    // following ones, which are contiguous in both the input and the output.
+    auto inputType = input.getType().cast<MemRefType>();
+    ArrayRef<int64_t> inputShape = inputType.getShape();
+    if (outputRank > 0 && hasAllConstantDimensions(inputType) &&
+        hasAllConstantDimensions(outputMemRefType) &&
+        inputType.getAffineMaps().empty()) {
+      int64_t firstDim = outputRank - 1;
+      while (firstDim > 0 &&
+             outputMemRefShape[firstDim] == inputShape[firstDim])
+        firstDim--;
+      int64_t blockBytes = getMemRefEltSizeInBytes(outputMemRefType);
+      for (int64_t i = firstDim; i < outputRank; ++i)
+        blockBytes *= inputShape[i];
+      if (blockBytes >= tileBlockCopyMinBytes) {
+        emitTileByBlockCopies(rewriter, loc, input, alloc, firstDim);
+        rewriter.replaceOp(op, alloc);
+        return success();
+      }
+    }
+
     // Define loops and iteration trip counts (equivalent to size of output)
     BuildKrnlLoop outputLoops(rewriter, loc, outputRank);
     outputLoops.createDefineOp();
@@ -117,7 +238,11 @@ struct ONNXTileOpLowering : public ConversionPattern {
     for (int i = 0; i < outputRank; ++i) {
       storeIndices.emplace_back(outputLoops.getInductionVar(i));
     }
-    rewriter.create<KrnlStoreOp>(loc, loadVal, alloc, storeIndices);
+    // A large output is written around the caches.
+    auto storeOp =
+        rewriter.create<KrnlStoreOp>(loc, loadVal, alloc, storeIndices);
+    if (useNonTemporalStores(outputMemRefType))
+      storeOp.setNonTemporal();
 
     rewriter.replaceOp(op, alloc);
 
@@ -0,0 +1,216 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------------- TopK.cpp - Lowering TopK Op ----------------------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file lowers the ONNX TopK Operator to Krnl dialect.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/SCF/SCF.h"
+
+#include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
+
+#include "mlir/Dialect/MemRef/EDSC/Intrinsics.h"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
+
+using namespace mlir;
+
+struct ONNXTopKOpLowering : public ConversionPattern {
+  ONNXTopKOpLowering(MLIRContext *ctx)
+      : ConversionPattern(mlir::ONNXTopKOp::getOperationName(), 1, ctx) {}
+
+  // Select the K best elements of each row along the axis in a buffer of K
+  // elements kept sorted, best first, in a single pass over the row:
+  //
+  //   for each row:
+  //     V[0 .. K] = worst, I[0 .. K] = N
+  //     for j = 0 .. N:
+  //       x = X[.., j, ..]
+  //       if better(x, j, V[K - 1], I[K - 1]):
+  //         # Insert x, shifting the worse elements of the buffer.
+  //         for i = K - 1 .. 0:
+  //           if i > 0 and better(x, j, V[i - 1], I[i - 1]):
+  //             V[i], I[i] = V[i - 1], I[i - 1]
+  //           else if better(x, j, V[i], I[i]):
+  //             V[i], I[i] = x, j
+  //     Values[.., 0 .. K, ..], Indices[.., 0 .. K, ..] = V, I
+  //
+  // where better compares the values, the lower index being better among
+  // equal values. Most elements of long rows are rejected by the comparison
+  // with the worst element of the buffer, the row being neither sorted nor
+  // copied, so that the cost is close to one pass over the input for the
+  // small K of the top-k selections. The rows are processed in parallel, each
+  // with its own buffer.
+  LogicalResult matchAndRewrite(Operation *op, ArrayRef<Value> operands,
+      ConversionPatternRewriter &rewriter) const final {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+    Location loc = op->getLoc();
+    ONNXTopKOpAdaptor operandAdaptor(operands);
+    ONNXTopKOp topKOp = llvm::cast<ONNXTopKOp>(op);
+
+    Value input = operandAdaptor.X();
+    auto valuesMemRefType = convertToMemRefType(op->getResult(0).getType());
+    auto indicesMemRefType = convertToMemRefType(op->getResult(1).getType());
+    Type elementType = valuesMemRefType.getElementType();
+    int64_t rank = valuesMemRefType.getRank();
+    int64_t axis = topKOp.axis();
+    axis = axis < 0 ? axis + rank : axis;
+    // The size of the buffers is K, which must be a constant.
+    int64_t k = valuesMemRefType.getShape()[axis];
+    if (k < 0 ||
+        !(elementType.isa<FloatType>() || elementType.isSignlessInteger()))
+      return failure();
+    bool largest = topKOp.largest() == 1;
+
+    ScopedContext scope(rewriter, loc);
+    IndexExprScope ieScope(&rewriter, loc);
+    MemRefBoundsIndexCapture inputBounds(input);
+
+    Value values = insertAllocAndDealloc(
+        valuesMemRefType, loc, rewriter, checkInsertDealloc(op, 0), {input});
+    Value indices = insertAllocAndDealloc(
+        indicesMemRefType, loc, rewriter, checkInsertDealloc(op, 1), {input});
+    if (k == 0) {
+      rewriter.replaceOp(op, {values, indices});
+      return success();
+    }
+
+    Value worst =
+        largest ? emitNegativeInfinityConstantOp(rewriter, loc, elementType)
+                : emitPositiveInfinityConstantOp(rewriter, loc, elementType);
+    Value rowSize = inputBounds.getDim(axis).getValue();
+    Value zeroIndex = emitConstantOp(rewriter, loc, rewriter.getIndexType(), 0);
+    Value oneIndex = emitConstantOp(rewriter, loc, rewriter.getIndexType(), 1);
+    Value lastIndex =
+        emitConstantOp(rewriter, loc, rewriter.getIndexType(), k - 1);
+
+    // Check whether the element x at j ranks before the element y at i.
+    auto isBetter = [&](Value x, Value j, Value y, Value i) -> Value {
+      Value before, equal;
+      if (elementType.isa<FloatType>()) {
+        before = rewriter.create<CmpFOp>(loc,
+            largest ? CmpFPredicate::OGT : CmpFPredicate::OLT, x, y);
+        equal = rewriter.create<CmpFOp>(loc, CmpFPredicate::OEQ, x, y);
+      } else {
+        before = rewriter.create<CmpIOp>(loc,
+            largest ? CmpIPredicate::sgt : CmpIPredicate::slt, x, y);
+        equal = rewriter.create<CmpIOp>(loc, CmpIPredicate::eq, x, y);
+      }
+      Value lowerIndex =
+          rewriter.create<CmpIOp>(loc, CmpIPredicate::ult, j, i);
+      return rewriter.create<OrOp>(
+          loc, before, rewriter.create<AndOp>(loc, equal, lowerIndex));
+    };
+
+    auto selectRow = [&](ValueRange outerIndices) {
+      // Indices of the element of the row at position j along the axis.
+      auto getRowIndices = [&](Value j) {
+        SmallVector<Value, 4> rowIndices(
+            outerIndices.begin(), outerIndices.begin() + axis);
+        rowIndices.emplace_back(j);
+        rowIndices.append(outerIndices.begin() + axis, outerIndices.end());
+        return rowIndices;
+      };
+      LiteralIndexExpr zero(0), K(k);
+      SymbolIndexExpr N(rowSize);
+
+      Value bufferValues = memref_alloca(MemRefType::get({k}, elementType));
+      Value bufferIndices =
+          memref_alloca(MemRefType::get({k}, rewriter.getIndexType()));
+      ValueRange initLoop = krnl_define_loop(1);
+      krnl_iterate_ie(initLoop, {zero}, {K}, {}, [&](ValueRange args) {
+        Value i = krnl_get_induction_var_value(initLoop)[0];
+        krnl_store(worst, bufferValues, i);
+        krnl_store(rowSize, bufferIndices, i);
+      });
+
+      ValueRange scanLoop = krnl_define_loop(1);
+      krnl_iterate_ie(scanLoop, {zero}, {N}, {}, [&](ValueRange args) {
+        Value j = krnl_get_induction_var_value(scanLoop)[0];
+        Value x = krnl_load(input, getRowIndices(j));
+        Value isSelected = isBetter(x, j,
+            krnl_load(bufferValues, lastIndex),
+            krnl_load(bufferIndices, lastIndex));
+        auto ifOp = rewriter.create<scf::IfOp>(
+            loc, isSelected, /*withElseRegion=*/false);
+        OpBuilder::InsertionGuard insertGuard(rewriter);
+        rewriter.setInsertionPointToStart(&ifOp.thenRegion().front());
+        ValueRange insertLoop = krnl_define_loop(1);
+        krnl_iterate_ie(insertLoop, {zero}, {K}, {}, [&](ValueRange args) {
+          Value p = krnl_get_induction_var_value(insertLoop)[0];
+          Value i = rewriter.create<SubIOp>(loc, lastIndex, p);
+          Value hasPrevious = rewriter.create<CmpIOp>(
+              loc, CmpIPredicate::ugt, i, zeroIndex);
+          Value previous = rewriter.create<SelectOp>(loc, hasPrevious,
+              rewriter.create<SubIOp>(loc, i, oneIndex), zeroIndex);
+          Value previousValue = krnl_load(bufferValues, previous);
+          Value previousIndex = krnl_load(bufferIndices, previous);
+          Value value = krnl_load(bufferValues, i);
+          Value index = krnl_load(bufferIndices, i);
+          Value isShifted = rewriter.create<AndOp>(loc, hasPrevious,
+              isBetter(x, j, previousValue, previousIndex));
+          Value isInserted = isBetter(x, j, value, index);
+          value = rewriter.create<SelectOp>(loc, isShifted, previousValue,
+              rewriter.create<SelectOp>(loc, isInserted, x, value));
+          index = rewriter.create<SelectOp>(loc, isShifted, previousIndex,
+              rewriter.create<SelectOp>(loc, isInserted, j, index));
+          krnl_store(value, bufferValues, i);
+          krnl_store(index, bufferIndices, i);
+        });
+      });
+
+      ValueRange outputLoop = krnl_define_loop(1);
+      krnl_iterate_ie(outputLoop, {zero}, {K}, {}, [&](ValueRange args) {
+        Value i = krnl_get_induction_var_value(outputLoop)[0];
+        SmallVector<Value, 4> outputIndices = getRowIndices(i);
+        krnl_store(krnl_load(bufferValues, i), values, outputIndices);
+        Value index = rewriter.create<IndexCastOp>(loc,
+            krnl_load(bufferIndices, i), rewriter.getIntegerType(64));
+        krnl_store(index, indices, outputIndices);
+      });
+    };
+
+    // Iterate over the rows, all the dimensions but the axis.
+    if (rank == 1) {
+      selectRow({});
+    } else {
+      SmallVector<IndexExpr, 4> outerLbs, outerUbs;
+      for (int64_t i = 0; i < rank; ++i)
+        if (i != axis) {
+          outerLbs.emplace_back(LiteralIndexExpr(0));
+          outerUbs.emplace_back(inputBounds.getDim(i));
+        }
+      ValueRange outerLoops = krnl_define_loop(rank - 1);
+      for (int64_t i = 0, l = 0; i < rank; ++i) {
+        if (i == axis)
+          continue;
+        if (inputBounds.getShape(i) != 1) {
+          krnl_parallel(outerLoops[l]);
+          break;
+        }
+        ++l;
+      }
+      krnl_iterate_ie(outerLoops, outerLbs, outerUbs, {},
+          [&](ValueRange args) {
+            IndexExprScope rowScope;
+            selectRow(krnl_get_induction_var_value(outerLoops));
+          });
+    }
+
+    rewriter.replaceOp(op, {values, indices});
+    return success();
+  }
+};
+
+void populateLoweringONNXTopKOpPattern(
+    RewritePatternSet &patterns, MLIRContext *ctx) {
+  patterns.insert<ONNXTopKOpLowering>(ctx);
+}
@@ -13,10 +13,43 @@
 //===----------------------------------------------------------------------===//
 
 #include "src/Conversion/ONNXToKrnl/ONNXToKrnlCommon.hpp"
+#include "src/Dialect/Krnl/KrnlHelper.hpp"
 #include "src/Dialect/ONNX/ONNXShapeHelper.hpp"
+#include "mlir/Dialect/StandardOps/EDSC/Intrinsics.h"
 
 using namespace mlir;
 
+// When the innermost dimension of the output is not the innermost dimension
+// of the input, the two dimensions are transposed by tiles: square tiles of
+// vectors of this size, transposed in registers, or tiles of this number of
+// elements otherwise.
+static const int64_t transposeVectorBytes = 32;
+static const int64_t transposeTileSize = 8;
+
+// Transpose the square matrix whose rows are the vectors. The off-diagonal
+// blocks of the 2b x 2b blocks are swapped for b = n/2, ..., 1, with one
+// shuffle of two rows per row.
+static void emitVectorTileTranspose(ConversionPatternRewriter &rewriter,
+    Location loc, SmallVectorImpl<Value> &rows) {
+  int64_t n = rows.size();
+  for (int64_t b = n / 2; b >= 1; b /= 2)
+    for (int64_t i = 0; i < n; ++i) {
+      if (i & b)
+        continue;
+      SmallVector<int64_t, 16> loMask, hiMask;
+      for (int64_t j = 0; j < n; ++j) {
+        loMask.emplace_back((j & b) ? n + j - b : j);
+        hiMask.emplace_back((j & b) ? n + j : j + b);
+      }
+      Value lo = rewriter.create<vector::ShuffleOp>(
+          loc, rows[i], rows[i + b], loMask);
+      Value hi = rewriter.create<vector::ShuffleOp>(
+          loc, rows[i], rows[i + b], hiMask);
+      rows[i] = lo;
+      rows[i + b] = hi;
+    }
+}
+
 struct ONNXTransposeOpLowering : public ConversionPattern {
   ONNXTransposeOpLowering(MLIRContext *ctx)
       : ConversionPattern(mlir::ONNXTransposeOp::getOperationName(), 1, ctx) {}
@@ -47,6 +80,33 @@ struct ONNXTransposeOpLowering : public ConversionPattern {
     Value alloc = insertAllocAndDeallocSimple(
         rewriter, op, memRefType, loc, shapeHelper.dimsForOutput(0));
 
+    // The input dimension that is innermost in the output.
+    SmallVector<int64_t, 4> perm;
+    for (decltype(rank) i = 0; i < rank; ++i)
+      perm.emplace_back(ArrayAttrIntVal(permAttr, i));
+    int64_t inDim = rank - 1;
+    int64_t outDim = (rank > 1) ? perm[rank - 1] : inDim;
+    if (outDim != inDim) {
+      auto dataType = data.getType().cast<MemRefType>();
+      Type elementType = memRefType.getElementType();
+      int64_t vectorLen = 1;
+      if (elementType.isIntOrFloat())
+        vectorLen = transposeVectorBytes * 8 /
+                    std::max(1u, elementType.getIntOrFloatBitWidth());
+      if (vectorLen > 1 && vectorLen <= 16 && llvm::isPowerOf2_64(vectorLen) &&
+          hasAllConstantDimensions(dataType) &&
+          dataType.getAffineMaps().empty() &&
+          memRefType.getAffineMaps().empty() &&
+          dataType.getShape()[inDim] % vectorLen == 0 &&
+          dataType.getShape()[outDim] % vectorLen == 0)
+        emitVectorTiledTranspose(
+            rewriter, loc, data, alloc, perm, inDim, outDim, vectorLen);
+      else
+        emitTiledTranspose(rewriter, loc, data, alloc, perm, inDim, outDim);
+      rewriter.replaceOp(op, alloc);
+      return success();
+    }
+
     // Create loop.
     BuildKrnlLoop inputLoops(rewriter, loc, rank);
     inputLoops.createDefineAndIterateOp(data);
@@ -63,8 +123,7 @@ struct ONNXTransposeOpLowering : public ConversionPattern {
       SmallVector<IndexExpr, 4> writeIndices;
       for (decltype(rank) i = 0; i < rank; ++i) {
         Value readVal = inputLoops.getInductionVar(i);
-        Value writeVal =
-            inputLoops.getInductionVar(ArrayAttrIntVal(permAttr, i));
+        Value writeVal = inputLoops.getInductionVar(perm[i]);
         readIndices.emplace_back(DimIndexExpr(readVal));
         writeIndices.emplace_back(DimIndexExpr(writeVal));
       }
@@ -78,6 +137,119 @@ struct ONNXTransposeOpLowering : public ConversionPattern {
 
     return success();
   }
+
+  // Transpose the inDim and outDim dimensions of the input by tiles of
+  // transposeTileSize x transposeTileSize elements, with the loops over the
+  // elements of a tile innermost, so that both the reads and the writes of a
+  // tile stay in a few cache lines.
+  static void emitTiledTranspose(ConversionPatternRewriter &rewriter,
+      Location loc, Value data, Value alloc, ArrayRef<int64_t> perm,
+      int64_t inDim, int64_t outDim) {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+    ScopedContext scope(rewriter, loc);
+    int64_t rank = perm.size();
+
+    MemRefBoundsCapture bounds(data);
+    SmallVector<Value, 4> lbs, ubs;
+    for (int64_t i = 0; i < rank; ++i) {
+      lbs.emplace_back(bounds.lb(i));
+      ubs.emplace_back(bounds.ub(i));
+    }
+
+    // The loops over the other dimensions come first, then the loops over
+    // the tiles and the ones within a tile, reading along inDim innermost.
+    ValueRange origLoops = krnl_define_loop(rank);
+    ValueRange outBlock = krnl_block(origLoops[outDim], transposeTileSize);
+    ValueRange inBlock = krnl_block(origLoops[inDim], transposeTileSize);
+    SmallVector<Value, 4> loops, innerLoops;
+    SmallVector<int64_t, 4> permuteMap;
+    int64_t pos = 0;
+    for (int64_t i = 0; i < rank; ++i) {
+      if (i == outDim) {
+        loops.append({outBlock[0], outBlock[1]});
+        permuteMap.append({rank - 2, rank});
+      } else if (i == inDim) {
+        loops.append({inBlock[0], inBlock[1]});
+        permuteMap.append({rank - 1, rank + 1});
+      } else {
+        loops.emplace_back(origLoops[i]);
+        permuteMap.emplace_back(pos++);
+      }
+      innerLoops.emplace_back(loops.back());
+    }
+    krnl_permute(loops, permuteMap);
+    // The outermost loop over another dimension is parallel.
+    if (rank > 2)
+      krnl_parallel(origLoops[(outDim == 0) ? 1 : 0]);
+
+    krnl_iterate(origLoops, loops, lbs, ubs, {}, [&](ValueRange args) {
+      ValueRange readIndices = krnl_get_induction_var_value(innerLoops);
+      SmallVector<Value, 4> writeIndices;
+      for (int64_t i = 0; i < rank; ++i)
+        writeIndices.emplace_back(readIndices[perm[i]]);
+      krnl_store(krnl_load(data, readIndices), alloc, writeIndices);
+    });
+  }
+
+  // Transpose the inDim and outDim dimensions of the input by square tiles
+  // of vectorLen x vectorLen elements: the vectorLen rows of a tile read
+  // along inDim are transposed in registers by shuffles, then written along
+  // outDim, the innermost dimension of the output.
+  static void emitVectorTiledTranspose(ConversionPatternRewriter &rewriter,
+      Location loc, Value data, Value alloc, ArrayRef<int64_t> perm,
+      int64_t inDim, int64_t outDim, int64_t vectorLen) {
+    using namespace mlir::edsc;
+    using namespace mlir::edsc::intrinsics;
+    ScopedContext scope(rewriter, loc);
+    int64_t rank = perm.size();
+    ArrayRef<int64_t> shape = data.getType().cast<MemRefType>().getShape();
+    int64_t outPos = rank - 1;
+    int64_t inPos = llvm::find(perm, inDim) - perm.begin();
+
+    // Vector views of the input along inDim and of the output along outDim.
+    Value dataView = krnl_vector_type_cast(data, vectorLen);
+    Value allocView = krnl_vector_type_cast(alloc, vectorLen);
+
+    // One iteration per tile along inDim and outDim.
+    SmallVector<Value, 4> lbs, ubs;
+    for (int64_t i = 0; i < rank; ++i) {
+      lbs.emplace_back(std_constant_index(0));
+      bool tiled = (i == inDim || i == outDim);
+      ubs.emplace_back(
+          std_constant_index(tiled ? shape[i] / vectorLen : shape[i]));
+    }
+    Value vectorLenVal = std_constant_index(vectorLen);
+    ValueRange loops = krnl_define_loop(rank);
+    if (rank > 2)
+      krnl_parallel(loops[(outDim == 0) ? 1 : 0]);
+    krnl_iterate(loops, lbs, ubs, {}, [&](ValueRange args) {
+      ValueRange ivs = krnl_get_induction_var_value(loops);
+      Value outStart = rewriter.create<MulIOp>(loc, ivs[outDim], vectorLenVal);
+      Value inStart = rewriter.create<MulIOp>(loc, ivs[inDim], vectorLenVal);
+
+      // Read the rows of the tile, one per index along outDim.
+      SmallVector<Value, 16> rows;
+      for (int64_t r = 0; r < vectorLen; ++r) {
+        SmallVector<Value, 4> readIndices(ivs.begin(), ivs.end());
+        readIndices[outDim] =
+            rewriter.create<AddIOp>(loc, outStart, std_constant_index(r));
+        rows.emplace_back(krnl_load(dataView, readIndices));
+      }
+      emitVectorTileTranspose(rewriter, loc, rows);
+
+      // Write the transposed rows, one per index along inDim.
+      for (int64_t r = 0; r < vectorLen; ++r) {
+        SmallVector<Value, 4> writeIndices;
+        for (int64_t i = 0; i < rank; ++i)
+          writeIndices.emplace_back(ivs[perm[i]]);
+        writeIndices[inPos] =
+            rewriter.create<AddIOp>(loc, inStart, std_constant_index(r));
+        writeIndices[outPos] = ivs[outDim];
+        krnl_store(rows[r], allocView, writeIndices);
+      }
+    });
+  }
 };
 
 void populateLoweringONNXTransposeOpPattern(
@@ -38,6 +38,23 @@ struct ONNXUnsqueezeOpLowering : public ConversionPattern {
       axes.emplace_back(axis);
     }
 
+    // Only the view of the data changes, unless the data is not contiguous or
+    // the result outlives it. Unknown dimensions are the operand's dimensions.
+    auto memRefShape = memRefType.getShape();
+    if (canLowerToInputView(op, data)) {
+      SmallVector<Value, 4> dynamicDims;
+      for (int outIdx = 0, inIdx = 0; outIdx < memRefShape.size(); ++outIdx) {
+        if (memRefShape[outIdx] < 0)
+          dynamicDims.emplace_back(
+              rewriter.create<memref::DimOp>(loc, data, inIdx));
+        if (std::find(axes.begin(), axes.end(), outIdx) == axes.end())
+          inIdx++;
+      }
+      rewriter.replaceOp(
+          op, emitReshapeView(rewriter, loc, data, memRefType, dynamicDims));
+      return success();
+    }
+
     // Insert an allocation and deallocation for the result of this operation.
     Value alloc;
 
@@ -46,7 +63,6 @@ struct ONNXUnsqueezeOpLowering : public ConversionPattern {
         rewriter.getIntegerType(64), getMemRefEltSizeInBytes(memRefType));
 
     bool insertDealloc = checkInsertDealloc(op);
-    auto memRefShape = memRefType.getShape();
     if (hasAllConstantDimensions(memRefType)) {
       alloc = insertAllocAndDealloc(memRefType, loc, rewriter, insertDealloc);
       for (int i = 0; i < memRefShape.size(); ++i) {
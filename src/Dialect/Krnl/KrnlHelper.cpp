@@ -309,6 +309,13 @@ void BuildKrnlLoop::pushAllBounds(SmallVectorImpl<IndexExpr> &upperBounds) {
   }
 }
 
+void BuildKrnlLoop::parallelizeLoop(int originalLoopIndex) {
+  assert(createdDefineOp && "Must create define op before parallel op.");
+  assert(originalLoopIndex >= 0 && originalLoopIndex < originalLoopNum &&
+         "Original loop index is out of bounds.");
+  rewriter.create<KrnlParallelOp>(loc, originalLoops[originalLoopIndex]);
+}
+
 void BuildKrnlLoop::createIterateOp() {
   // Loop definition operation is mandatory.
   assert(createdDefineOp && "Must create define op before iterate op.");
@@ -323,9 +330,11 @@ void BuildKrnlLoop::createIterateOp() {
   createdIterateOp = true;
 }
 
-void BuildKrnlLoop::createDefineAndIterateOp(Value memRefOperand) {
+void BuildKrnlLoop::createDefineAndIterateOp(
+    Value memRefOperand, bool parallelize) {
   // Rank of the MemRef operand. We will emit a loop for each dimension.
-  int loopNum = memRefOperand.getType().cast<MemRefType>().getShape().size();
+  auto shape = memRefOperand.getType().cast<MemRefType>().getShape();
+  int loopNum = shape.size();
   assert(originalLoopNum == loopNum &&
          "Mismatch in loop numbers from constructor and define.");
 
@@ -337,6 +346,16 @@ void BuildKrnlLoop::createDefineAndIterateOp(Value memRefOperand) {
   for (int i = 0; i < originalLoopNum; ++i)
     pushBounds(0, memRefOperand, i);
 
+  // Skip the outer loops with a single iteration, there is nothing to gain
+  // from running them in parallel.
+  if (parallelize) {
+    int parallelLoopIndex = 0;
+    while (parallelLoopIndex < originalLoopNum - 1 &&
+           shape[parallelLoopIndex] == 1)
+      ++parallelLoopIndex;
+    parallelizeLoop(parallelLoopIndex);
+  }
+
   // Emit the iteration operation over the current loop nest.
   createIterateOp();
 }
@@ -407,6 +426,15 @@ void krnl_store(Value val, Value memref, ValueRange indices) {
       ScopedContext::getLocation(), val, memref, indices);
 }
 
+void krnl_prefetch(
+    Value memref, ValueRange indices, bool isWrite, unsigned localityHint) {
+  using namespace mlir::edsc;
+  assert(ScopedContext::getContext() && "EDSC ScopedContext not set up");
+  ScopedContext::getBuilderRef().create<KrnlPrefetchOp>(
+      ScopedContext::getLocation(), memref, indices, isWrite, localityHint,
+      /*isDataCache=*/true);
+}
+
 // Support only 1D vector type.
 Value krnl_vector_type_cast(Value sourceMemref, int64_t vectorLen) {
   using namespace mlir::edsc;
@@ -439,6 +467,13 @@ void krnl_permute(ValueRange loops, ArrayRef<int64_t> map) {
       ScopedContext::getLocation(), loops, map);
 }
 
+void krnl_parallel(Value loop) {
+  using namespace mlir::edsc;
+  assert(ScopedContext::getContext() && "EDSC ScopedContext not set up");
+  ScopedContext::getBuilderRef().create<KrnlParallelOp>(
+      ScopedContext::getLocation(), loop);
+}
+
 ValueRange krnl_get_induction_var_value(ValueRange loops) {
   using namespace mlir::edsc;
   assert(ScopedContext::getContext() && "EDSC ScopedContext not set up");
@@ -487,19 +522,19 @@ void krnl_iterate(ValueRange originalLoops, ValueRange lbs, ValueRange ubs,
 
 void krnl_copy_to_buffer(Value bufferMemref, Value memref, ValueRange starts,
     Value padValue, ArrayRef<int64_t> tileSize, ArrayRef<int64_t> padToNext,
-    bool transpose) {
+    bool transpose, ArrayRef<int64_t> prefetchNext) {
   using namespace mlir::edsc;
   assert(ScopedContext::getContext() && "EDSC ScopedContext not set up");
   ScopedContext::getBuilderRef().create<KrnlCopyToBufferOp>(
       ScopedContext::getLocation(), bufferMemref, memref, starts, padValue,
-      tileSize, padToNext, transpose);
+      tileSize, padToNext, transpose, prefetchNext);
 }
 
 void krnl_copy_to_buffer(Value bufferMemref, Value memref, ValueRange starts,
-    Value padValue, bool transpose) {
+    Value padValue, bool transpose, ArrayRef<int64_t> prefetchNext) {
   ArrayRef<int64_t> empty;
-  krnl_copy_to_buffer(
-      bufferMemref, memref, starts, padValue, empty, empty, transpose);
+  krnl_copy_to_buffer(bufferMemref, memref, starts, padValue, empty, empty,
+      transpose, prefetchNext);
 }
 
 void krnl_copy_from_buffer(Value bufferMemref, Value memref, ValueRange starts,
@@ -537,6 +572,18 @@ void krnl_matmul(Value A, ValueRange aStart, Value B, ValueRange bStart,
       empty, empty, empty, empty, simdize, unroll, overcompute);
 }
 
+void krnl_sgemm(Value A, ValueRange aPrefix, Value B, ValueRange bPrefix,
+    Value C, ValueRange cPrefix, bool transA, bool transB, float alpha,
+    float beta) {
+  using namespace mlir::edsc;
+  assert(ScopedContext::getContext() && "EDSC ScopedContext not set up");
+  OpBuilder &builder = ScopedContext::getBuilderRef();
+  builder.create<KrnlSgemmOp>(ScopedContext::getLocation(), A, aPrefix, B,
+      bPrefix, C, cPrefix, builder.getBoolAttr(transA),
+      builder.getBoolAttr(transB), builder.getF32FloatAttr(alpha),
+      builder.getF32FloatAttr(beta));
+}
+
 //====---------------- EDSC Support with IndexExpr -----------------------===//
 
 Value krnl_load(Value memref, ArrayRef<IndexExpr> indices) {
@@ -551,6 +598,13 @@ void krnl_store(Value val, Value memref, ArrayRef<IndexExpr> indices) {
   krnl_store(val, memref, ValueRange(indexValues));
 }
 
+void krnl_prefetch(Value memref, ArrayRef<IndexExpr> indices, bool isWrite,
+    unsigned localityHint) {
+  SmallVector<Value, 4> indexValues;
+  IndexExpr::getValues(indices, indexValues);
+  krnl_prefetch(memref, ValueRange(indexValues), isWrite, localityHint);
+}
+
 void krnl_iterate_ie(ValueRange originalLoops, ValueRange optimizedLoops,
     ArrayRef<IndexExpr> lbs, ArrayRef<IndexExpr> ubs, ValueRange iterArgs,
     function_ref<void(ValueRange)> bodyBuilderFn) {
@@ -186,6 +186,11 @@ public:
   // for each index expression i in upperBounds, push 0..upperBound[i].
   void pushAllBounds(SmallVectorImpl<IndexExpr> &upperBounds);
 
+  // Mark the (original) loop associated with the given index as parallel.
+  // Use the index returned when pushing the bounds. Must be called after the
+  // define op is created.
+  void parallelizeLoop(int originalLoopIndex);
+
   // Create the KrnlIterateOp assiciated with this loop nest. The loops
   // iteration will be created if the definition and the optimization
   // operations associated with this loop nest have been emitted already.
@@ -195,8 +200,9 @@ public:
   // for a given operand of MemRef type. The loop nest has a depth equal to the
   // rank of the MemRef operand. The lower bound of each loop is zero. The
   // upper bound of each loop is given by the corresponding dimension of the
-  // MemRef operand.
-  void createDefineAndIterateOp(Value memRefOperand);
+  // MemRef operand. If parallelize is true, the outermost loop that does not
+  // statically have a single iteration is marked as parallel.
+  void createDefineAndIterateOp(Value memRefOperand, bool parallelize = false);
 
   // Get the (original loop) induction variable associated with the given
   // index. Use the index returned when pushing the bounds.
@@ -269,11 +275,14 @@ void generateIndexMap(
 
 Value krnl_load(Value memref, ValueRange indices);
 void krnl_store(Value val, Value memref, ValueRange indices);
+void krnl_prefetch(
+    Value memref, ValueRange indices, bool isWrite, unsigned localityHint);
 Value krnl_vector_type_cast(Value sourceMemref, int64_t vectorLen);
 
 ValueRange krnl_define_loop(int64_t originalLoopNum);
 ValueRange krnl_block(Value loop, int64_t blockSize);
 void krnl_permute(ValueRange loops, ArrayRef<int64_t> map);
+void krnl_parallel(Value loop);
 ValueRange krnl_get_induction_var_value(ValueRange loops);
 
 void krnl_iterate(ValueRange originalLoops, ValueRange optimizedLoops,
@@ -295,9 +304,13 @@ void krnl_copy_to_buffer(
     // the buffer, if the user want to pad the data to a higher size. TileSize
     // enables the user to
     ArrayRef<int64_t> tileSize, ArrayRef<int64_t> padToNext,
-    bool transpose = false);
+    bool transpose = false,
+    // If not empty, offsets from starts of the next tile to be copied, which
+    // is prefetched during the copy. Same rank as sourceMemref.
+    ArrayRef<int64_t> prefetchNext = {});
 void krnl_copy_to_buffer(Value bufferMemref, Value sourceMemref,
-    ValueRange starts, Value padValue, bool transpose = false);
+    ValueRange starts, Value padValue, bool transpose = false,
+    ArrayRef<int64_t> prefetchNext = {});
 
 void krnl_copy_from_buffer(Value bufferMemref, Value memref, ValueRange starts,
     ArrayRef<int64_t> tileSize);
@@ -333,10 +346,19 @@ void krnl_matmul(Value A, ValueRange aStart, Value B, ValueRange bStart,
     Value C, ValueRange cStart, ValueRange loops, ValueRange computeStarts,
     ValueRange globalUBs, bool simdize, bool unroll, bool overcompute);
 
+// C = alpha * op(A) * op(B) + beta * C with the sgemm of an external BLAS
+// library, on the two trailing dimensions of A, B and C, their leading ones
+// being selected by the prefixes.
+void krnl_sgemm(Value A, ValueRange aPrefix, Value B, ValueRange bPrefix,
+    Value C, ValueRange cPrefix, bool transA, bool transB, float alpha,
+    float beta);
+
 //====---------------- EDSC Support with IndexExpr -----------------------===//
 
 Value krnl_load(Value memref, ArrayRef<IndexExpr> indices);
 void krnl_store(Value val, Value memref, ArrayRef<IndexExpr> indices);
+void krnl_prefetch(Value memref, ArrayRef<IndexExpr> indices, bool isWrite,
+    unsigned localityHint);
 
 // Use _ie suffix below as often the typecheck has issues distinguising between
 // Value and IndexExpr calls.
@@ -395,7 +395,9 @@ void KrnlDummyCastOp::build(
 // Use the sourceMemRef as a template to create the result type, where all the
 // dimensions are copied but for the last one that is divided by vectorLen, as
 // the elementary type of the result is vectorLen x elementary type. Supports
-// only 1D vectors.
+// only 1D vectors. For ranks above one, the last dimension must be a multiple
+// of vectorLen, since the rows of the result are not padded. For rank one, the
+// trailing elements that do not fill a vector are not part of the result.
 void KrnlVectorTypeCastOp::build(OpBuilder &builder, OperationState &state,
     Value sourceMemRef, int64_t vectorLen) {
   MemRefType sourceType = sourceMemRef.getType().cast<MemRefType>();
@@ -408,7 +410,7 @@ void KrnlVectorTypeCastOp::build(OpBuilder &builder, OperationState &state,
     vectorShape.emplace_back(sourceShape[i]);
   assert(sourceShape[rank - 1] > 0 &&
          "expected compile time, strictly positive last dim");
-  assert(sourceShape[rank - 1] % vectorLen == 0 &&
+  assert((rank == 1 || sourceShape[rank - 1] % vectorLen == 0) &&
          "last dim must be a multiple of vector length");
   vectorShape.emplace_back(sourceShape[rank - 1] / vectorLen);
   MemRefType resultType = MemRefType::get(vectorShape, vecType);
@@ -552,11 +554,81 @@ static LogicalResult verify(KrnlMatMulOp op) {
   ArrayAttr cTileAttr = operandAdaptor.cTileSize();
   if (cTileAttr && !(cTileAttr.size() == 0 || cTileAttr.size() == 2))
     return op.emitOpError("cTileSize rank should be 0 or 2");
+  // Products are accumulated in the element type of C.
+  Type aType =
+      operandAdaptor.A().getType().cast<MemRefType>().getElementType();
+  Type bType =
+      operandAdaptor.B().getType().cast<MemRefType>().getElementType();
+  Type cType =
+      operandAdaptor.C().getType().cast<MemRefType>().getElementType();
+  auto isAccumulatedIn = [](Type type, Type accType) {
+    if (type == accType)
+      return true;
+    bool sameKind = (type.isSignlessInteger() && accType.isSignlessInteger()) ||
+                    (type.isa<FloatType>() && accType.isa<FloatType>());
+    return sameKind &&
+           type.getIntOrFloatBitWidth() < accType.getIntOrFloatBitWidth();
+  };
+  if (!isAccumulatedIn(aType, cType) || !isAccumulatedIn(bType, cType))
+    return op.emitOpError(
+        "C element type should be the one of A and B, or a wider one");
   return success();
 }
 
 MutableOperandRange KrnlMatMulOp::getLoopRefs() { return loopsMutable(); }
 
+//===----------------------------------------------------------------------===//
+// KrnlMatMulMicroKernelOp
+//===----------------------------------------------------------------------===//
+
+static LogicalResult verify(KrnlMatMulMicroKernelOp op) {
+  KrnlMatMulMicroKernelOpAdaptor operandAdaptor(op);
+  auto checkStart = [&](Value memref, ValueRange start) {
+    int64_t rank = memref.getType().cast<MemRefType>().getRank();
+    return rank >= 2 && (int64_t)start.size() == rank;
+  };
+  if (!checkStart(operandAdaptor.A(), operandAdaptor.aStart()) ||
+      !checkStart(operandAdaptor.B(), operandAdaptor.bStart()) ||
+      !checkStart(operandAdaptor.C(), operandAdaptor.cStart()))
+    return op.emitOpError(
+        "expected memrefs of rank >= 2 indexed by as many start indices");
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// KrnlSgemmOp
+//===----------------------------------------------------------------------===//
+
+static LogicalResult verify(KrnlSgemmOp op) {
+  KrnlSgemmOpAdaptor operandAdaptor(op);
+  auto checkPrefix = [&](Value memref, ValueRange prefix) {
+    int64_t rank = memref.getType().cast<MemRefType>().getRank();
+    return rank >= 2 && (int64_t)prefix.size() == rank - 2;
+  };
+  if (!checkPrefix(operandAdaptor.A(), operandAdaptor.aPrefix()) ||
+      !checkPrefix(operandAdaptor.B(), operandAdaptor.bPrefix()) ||
+      !checkPrefix(operandAdaptor.C(), operandAdaptor.cPrefix()))
+    return op.emitOpError(
+        "expected memrefs of rank >= 2 with an index per leading dimension");
+  // Check the sizes of the matrices that are known.
+  ArrayRef<int64_t> aShape =
+      operandAdaptor.A().getType().cast<MemRefType>().getShape().take_back(2);
+  ArrayRef<int64_t> bShape =
+      operandAdaptor.B().getType().cast<MemRefType>().getShape().take_back(2);
+  ArrayRef<int64_t> cShape =
+      operandAdaptor.C().getType().cast<MemRefType>().getShape().take_back(2);
+  int64_t M = op.transA() ? aShape[1] : aShape[0];
+  int64_t aK = op.transA() ? aShape[0] : aShape[1];
+  int64_t bK = op.transB() ? bShape[1] : bShape[0];
+  int64_t N = op.transB() ? bShape[0] : bShape[1];
+  auto mismatch = [](int64_t x, int64_t y) {
+    return x >= 0 && y >= 0 && x != y;
+  };
+  if (mismatch(aK, bK) || mismatch(M, cShape[0]) || mismatch(N, cShape[1]))
+    return op.emitOpError("incompatible matrix sizes");
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // KrnlCopyToBufferOp
 //===----------------------------------------------------------------------===//
@@ -564,13 +636,18 @@ MutableOperandRange KrnlMatMulOp::getLoopRefs() { return loopsMutable(); }
 void KrnlCopyToBufferOp::build(::mlir::OpBuilder &odsBuilder,
     ::mlir::OperationState &odsState, Value odsBufferMemref, Value odsMemref,
     ValueRange odsStarts, Value odsPadValue, ArrayRef<int64_t> odsTileSize,
-    ArrayRef<int64_t> odsPadToNext, bool odsTranspose) {
+    ArrayRef<int64_t> odsPadToNext, bool odsTranspose,
+    ArrayRef<int64_t> odsPrefetchNext) {
   // Massage types.
   ValueRange startsRange(odsStarts);
   ArrayAttr tileSizeAttr = odsBuilder.getI64ArrayAttr(odsTileSize);
   ArrayAttr padToNextAttr = odsBuilder.getI64ArrayAttr(odsPadToNext);
+  ArrayAttr prefetchNextAttr;
+  if (!odsPrefetchNext.empty())
+    prefetchNextAttr = odsBuilder.getI64ArrayAttr(odsPrefetchNext);
   build(odsBuilder, odsState, odsBufferMemref, odsMemref, startsRange,
-      odsPadValue, tileSizeAttr, padToNextAttr, odsTranspose);
+      odsPadValue, tileSizeAttr, padToNextAttr, odsTranspose,
+      prefetchNextAttr);
 }
 
 static LogicalResult verify(KrnlCopyToBufferOp op) {
@@ -601,6 +678,11 @@ static LogicalResult verify(KrnlCopyToBufferOp op) {
       return op.emitOpError(
           "To transpose buffer, its rank must be greater than 1");
   }
+  if (opAdaptor.prefetchNext()) {
+    int64_t prefetchRank = opAdaptor.prefetchNext().size();
+    if (prefetchRank != srcRank)
+      return op.emitOpError("Rank of prefetchNext must be identical to memref");
+  }
 
   return success();
 }
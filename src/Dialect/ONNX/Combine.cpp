@@ -18,6 +18,7 @@
 
 #include "src/Dialect/ONNX/ONNXOps.hpp"
 #include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include <cmath>
 #include <numeric>
 
 using namespace mlir;
@@ -27,20 +28,320 @@ using namespace mlir;
 //===----------------------------------------------------------------------===//
 
 namespace {
+
+// Return true if the value is a constant float tensor holding one element.
+bool isScalarFloatConstant(Value value) {
+  ONNXConstantOp constOp = getONNXConstantOp(value);
+  if (!constOp || !constOp.valueAttr())
+    return false;
+  auto dense = constOp.valueAttr().dyn_cast<DenseElementsAttr>();
+  return dense && dense.getNumElements() == 1 &&
+         dense.getType().getElementType().isa<FloatType>();
+}
+
+// Return the value of a scalar float constant.
+double getScalarFloatConstant(Value value) {
+  auto dense =
+      getONNXConstantOp(value).valueAttr().cast<DenseElementsAttr>();
+  return (*dense.getValues<APFloat>().begin()).convertToDouble();
+}
+
+// Return true if the value is a scalar float constant equal to `expected`.
+bool isScalarFloatConstantOf(Value value, double expected) {
+  return isScalarFloatConstant(value) &&
+         getScalarFloatConstant(value) == expected;
+}
+
+// Return true if the value is the scalar float constant -0.0, the additive
+// identity of the floats: x + -0.0 is x for every x, while -0.0 + +0.0 is
+// +0.0.
+bool isScalarFloatConstantNegativeZero(Value value) {
+  if (!isScalarFloatConstant(value))
+    return false;
+  auto dense =
+      getONNXConstantOp(value).valueAttr().cast<DenseElementsAttr>();
+  APFloat zero = *dense.getValues<APFloat>().begin();
+  return zero.isZero() && zero.isNegative();
+}
+
+// Return true if the value is a scalar float constant equal to `expected`, up
+// to the rounding of the constants of the exported models.
+bool isScalarFloatConstantNear(Value value, double expected) {
+  return isScalarFloatConstant(value) &&
+         std::abs(getScalarFloatConstant(value) - expected) <=
+             1e-4 * std::abs(expected);
+}
+
+// Return a scalar float constant as an F32 attribute.
+FloatAttr getScalarFloatAttr(PatternRewriter &rewriter, Value value) {
+  return rewriter.getF32FloatAttr(getScalarFloatConstant(value));
+}
+
+// Return the scale of an attention as an F32 attribute, from the constant
+// scalar dividing (reciprocal) or multiplying its scores.
+FloatAttr getAttentionScale(
+    PatternRewriter &rewriter, Value value, bool reciprocal) {
+  double scale = getScalarFloatConstant(value);
+  return rewriter.getF32FloatAttr(reciprocal ? 1.0 / scale : scale);
+}
+
+// Return true if the softmax computing the value is along its last axis.
+bool isSoftmaxAlongLastAxis(Value value, IntegerAttr axisAttr) {
+  if (!value.getType().isa<RankedTensorType>())
+    return false;
+  int64_t rank = value.getType().cast<RankedTensorType>().getRank();
+  int64_t axis = axisAttr.getValue().getSExtValue();
+  return axis == -1 || axis == rank - 1;
+}
+
+// Return true if the operands of an attention are ranked tensors, Q, K and V
+// having the same rank of at least 2 and the same batch dimensions, and the
+// optional mask a rank not exceeding it.
+bool areAttentionOperands(Value q, Value k, Value v, Value mask) {
+  auto qType = q.getType().dyn_cast<RankedTensorType>();
+  auto kType = k.getType().dyn_cast<RankedTensorType>();
+  auto vType = v.getType().dyn_cast<RankedTensorType>();
+  if (!qType || !kType || !vType)
+    return false;
+  int64_t rank = qType.getRank();
+  if (rank < 2 || kType.getRank() != rank || vType.getRank() != rank)
+    return false;
+  for (int64_t i = 0; i < rank - 2; ++i) {
+    int64_t dim = qType.getShape()[i];
+    if (dim == -1 || kType.getShape()[i] != dim || vType.getShape()[i] != dim)
+      return false;
+  }
+  if (!mask)
+    return true;
+  auto maskType = mask.getType().dyn_cast<RankedTensorType>();
+  return maskType && maskType.getRank() <= rank;
+}
+
+// Return true if the reduction of `data` is along its last axis only, keeping
+// the reduced dimension.
+bool isLastAxisReduction(Value data, ArrayAttr axes, IntegerAttr keepdims) {
+  if (!data.getType().isa<RankedTensorType>() || !axes ||
+      axes.getValue().size() != 1 ||
+      keepdims.getValue().getSExtValue() != 1)
+    return false;
+  int64_t rank = data.getType().cast<RankedTensorType>().getRank();
+  int64_t axis = axes.getValue()[0].cast<IntegerAttr>().getInt();
+  return axis == -1 || axis == rank - 1;
+}
+
+// Return true if the operands of a layer normalization are a ranked float
+// tensor with a static last dimension, and a scale and a bias of that size.
+bool areLayerNormOperands(Value x, Value scale, Value bias) {
+  auto xType = x.getType().dyn_cast<RankedTensorType>();
+  if (!xType || xType.getRank() < 1 ||
+      !xType.getElementType().isa<FloatType>())
+    return false;
+  int64_t lastDim = xType.getShape()[xType.getRank() - 1];
+  if (lastDim == -1)
+    return false;
+  for (Value param : {scale, bias}) {
+    auto paramType = param.getType().dyn_cast<RankedTensorType>();
+    if (!paramType || paramType.getShape() != ArrayRef<int64_t>(lastDim))
+      return false;
+  }
+  return true;
+}
+
+// Return true if the value is a scalar float constant whose reciprocal is
+// exactly representable, e.g. a power of two, so that dividing by it is the
+// same as multiplying by its reciprocal.
+bool hasExactReciprocal(Value value) {
+  if (!isScalarFloatConstant(value))
+    return false;
+  auto dense =
+      getONNXConstantOp(value).valueAttr().cast<DenseElementsAttr>();
+  APFloat divisor = *dense.getValues<APFloat>().begin();
+  if (!divisor.isFiniteNonZero())
+    return false;
+  APFloat reciprocal(divisor.getSemantics(), 1);
+  return reciprocal.divide(divisor, APFloat::rmNearestTiesToEven) ==
+         APFloat::opOK;
+}
+
+// Return the reciprocal of a scalar float constant, with the type of the
+// constant when it is static.
+DenseElementsAttr getReciprocalDenseAttr(
+    PatternRewriter &rewriter, Value value) {
+  auto dense =
+      getONNXConstantOp(value).valueAttr().cast<DenseElementsAttr>();
+  APFloat divisor = *dense.getValues<APFloat>().begin();
+  APFloat reciprocal(divisor.getSemantics(), 1);
+  reciprocal.divide(divisor, APFloat::rmNearestTiesToEven);
+  ShapedType type = dense.getType();
+  auto valueType = value.getType().dyn_cast<RankedTensorType>();
+  if (valueType && valueType.hasStaticShape())
+    type = valueType;
+  return DenseElementsAttr::get(type, reciprocal);
+}
+
+// Return the number of the significand bits of a float type.
+static unsigned getSignificandBits(FloatType type) {
+  return APFloat::semanticsPrecision(type.getFloatSemantics());
+}
+
+// Return true if every value of the element type of `from` is exactly
+// represented in the element type of `to`, e.g. fp16 in fp32, so that a Cast
+// from the first to the second loses nothing.
+bool isLosslessCast(Value from, Value to) {
+  Type fromType = from.getType().cast<ShapedType>().getElementType();
+  Type toType = to.getType().cast<ShapedType>().getElementType();
+  auto toFloat = toType.dyn_cast<FloatType>();
+  if (auto fromFloat = fromType.dyn_cast<FloatType>())
+    return toFloat && (fromFloat == toFloat ||
+                          (fromFloat.getWidth() < toFloat.getWidth() &&
+                              getSignificandBits(fromFloat) <=
+                                  getSignificandBits(toFloat)));
+  auto fromInt = fromType.dyn_cast<IntegerType>();
+  if (!fromInt || fromInt.isSignless())
+    return false;
+  unsigned valueBits = fromInt.getWidth() - (fromInt.isSigned() ? 1 : 0);
+  if (toFloat)
+    return valueBits <= getSignificandBits(toFloat);
+  auto toInt = toType.dyn_cast<IntegerType>();
+  if (!toInt || toInt.isSignless())
+    return false;
+  if (fromInt.isSigned())
+    return toInt.isSigned() && fromInt.getWidth() <= toInt.getWidth();
+  return valueBits <= toInt.getWidth() - (toInt.isSigned() ? 1 : 0);
+}
+
+// Return true if the value is a constant shape of a Reshape without zeros,
+// which would copy the dimensions of the reshaped tensor.
+bool isShapeWithoutZeros(Value value) {
+  ONNXConstantOp constOp = getONNXConstantOp(value);
+  if (!constOp || !constOp.valueAttr())
+    return false;
+  auto dense = constOp.valueAttr().dyn_cast<DenseElementsAttr>();
+  return dense && llvm::none_of(dense.getValues<APInt>(),
+                      [](const APInt &dim) { return dim.isNullValue(); });
+}
+
+// Return true if the op is an Add or a Sum of tensors of the given type, none
+// of which is computed by a MatMul or a Gemm.
+bool isSumOfSameType(Operation *op, Type type) {
+  if (!isa<ONNXAddOp, ONNXSumOp>(op) || op->getResult(0).getType() != type)
+    return false;
+  return llvm::all_of(op->getOperands(), [&](Value operand) {
+    Operation *def = operand.getDefiningOp();
+    return operand.getType() == type &&
+           !(def && isa<ONNXMatMulOp, ONNXGemmOp>(def));
+  });
+}
+
+// Collect the leaves of the chain of Adds and Sums of the given type computing
+// the value, the intermediate results having one use. Only the first operands
+// are followed: the Sum adds its operands from left to right, so that the
+// left-nested chains keep the order of their float additions.
+void collectSumLeaves(Value value, Type type, SmallVectorImpl<Value> &leaves) {
+  Operation *def = value.getDefiningOp();
+  if (!def || !value.hasOneUse() || !isSumOfSameType(def, type)) {
+    leaves.emplace_back(value);
+    return;
+  }
+  collectSumLeaves(def->getOperand(0), type, leaves);
+  leaves.append(std::next(def->operand_begin()), def->operand_end());
+}
+
+// Collect the leaves of the chain of Adds and Sums ending with the Add
+// computing the value, or return false if it is not such a chain of tensors of
+// the same static shape.
+bool getAddChainLeaves(Value value, SmallVectorImpl<Value> &leaves) {
+  auto type = value.getType().dyn_cast<RankedTensorType>();
+  Operation *def = value.getDefiningOp();
+  if (!type || !type.hasStaticShape() || !isSumOfSameType(def, type))
+    return false;
+  collectSumLeaves(def->getOperand(0), type, leaves);
+  leaves.append(std::next(def->operand_begin()), def->operand_end());
+  return true;
+}
+
+// Return true if the Add computing the value ends a chain of at least two Adds
+// or Sums of the same type.
+bool isAddChainOfSameType(Value value) {
+  SmallVector<Value, 8> leaves;
+  return getAddChainLeaves(value, leaves) && leaves.size() > 2;
+}
+
+// Return a Sum of the leaves of the chain of Adds computing the value.
+Value createSumOfAddChain(
+    PatternRewriter &rewriter, Location loc, Value value) {
+  SmallVector<Value, 8> leaves;
+  getAddChainLeaves(value, leaves);
+  return rewriter.create<ONNXSumOp>(loc, value.getType(), leaves);
+}
+
 /// Include the patterns defined in the Declarative Rewrite framework.
 #include "src/Dialect/ONNX/ONNXCombine.inc"
 } // end anonymous namespace
 
 /// Register optimization patterns as "canonicalization" patterns
-/// on the ONNXMatMultOp.
+/// on the ONNXAddOp.
 void ONNXAddOp::getCanonicalizationPatterns(
     RewritePatternSet &results, MLIRContext *context) {
   results.insert<MulAddToGemmOptPattern>(context);
+  results.insert<FuseLayerNorm>(context);
+  results.insert<FuseLayerNormWithMul>(context);
+  results.insert<AddZeroPattern>(context);
+  results.insert<ZeroAddPattern>(context);
+  results.insert<AddChainToSumPattern>(context);
+}
+
+/// on the ONNXMatMulOp.
+void ONNXMatMulOp::getCanonicalizationPatterns(
+    RewritePatternSet &results, MLIRContext *context) {
+  results.insert<FuseDivMaskedAttention>(context);
+  results.insert<FuseMulMaskedAttention>(context);
+  results.insert<FuseDivAttention>(context);
+  results.insert<FuseMulAttention>(context);
+}
+
+/// on the ONNXMulOp.
+void ONNXMulOp::getCanonicalizationPatterns(
+    RewritePatternSet &results, MLIRContext *context) {
+  results.insert<MulOnePattern>(context);
+  results.insert<OneMulPattern>(context);
+  results.insert<FuseGeluOfDivPattern>(context);
+  results.insert<FuseGeluOfMulPattern>(context);
+  results.insert<FuseHalfGeluOfDivPattern>(context);
+  results.insert<FuseHalfGeluOfMulPattern>(context);
+  results.insert<FuseSwishPattern>(context);
+  results.insert<FuseSigmoidSwishPattern>(context);
+  results.insert<FuseHardSwishPattern>(context);
+  results.insert<FuseHardSigmoidSwishPattern>(context);
+}
+
+/// on the ONNXDivOp.
+void ONNXDivOp::getCanonicalizationPatterns(
+    RewritePatternSet &results, MLIRContext *context) {
+  results.insert<DivByConstantToMulPattern>(context);
+}
+
+/// on the ONNXPowOp.
+void ONNXPowOp::getCanonicalizationPatterns(
+    RewritePatternSet &results, MLIRContext *context) {
+  results.insert<PowOfTwoToMulPattern>(context);
+}
+
+/// on the ONNXReshapeOp.
+void ONNXReshapeOp::getCanonicalizationPatterns(
+    RewritePatternSet &results, MLIRContext *context) {
+  results.insert<FuseReshapePattern>(context);
+  results.insert<RemoveIdentityReshapePattern>(context);
 }
 
 void ONNXGemmOp::getCanonicalizationPatterns(
     RewritePatternSet &results, MLIRContext *context) {
   results.insert<FuseGemmFollowedByAddition>(context);
+  // These patterns are rooted at the Relu, Sigmoid, and Tanh ops, which have
+  // no canonicalizer of their own.
+  results.insert<FuseGemmFollowedByRelu>(context);
+  results.insert<FuseGemmFollowedBySigmoid>(context);
+  results.insert<FuseGemmFollowedByTanh>(context);
 }
 /// on the ONNXIdentityOp.
 void ONNXIdentityOp::getCanonicalizationPatterns(
@@ -52,6 +353,7 @@ void ONNXIdentityOp::getCanonicalizationPatterns(
 void ONNXCastOp::getCanonicalizationPatterns(
     RewritePatternSet &result, MLIRContext *context) {
   result.insert<CastEliminationPattern>(context);
+  result.insert<FuseCastPattern>(context);
 }
 
 /// on the ONNXTransposeOp.
@@ -22,7 +22,9 @@
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/MathExtras.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -37,7 +39,7 @@ using namespace mlir;
 
 IndexExprScope::IndexExprScope(OpBuilder *rewriter, Location loc)
     : dims(), symbols(), rewriter(rewriter), loc(loc),
-      parentScope(getCurrentScopePtr()), container() {
+      parentScope(getCurrentScopePtr()), allocator(), sharedLiterals() {
   getCurrentScopePtr() = this;
 }
 
@@ -47,7 +49,7 @@ IndexExprScope::IndexExprScope(OpBuilder &rewriter, Location loc)
 IndexExprScope::IndexExprScope()
     : dims(), symbols(), rewriter(getCurrentScope().rewriter),
       loc(getCurrentScope().loc), parentScope(getCurrentScopePtr()),
-      container() {
+      allocator(), sharedLiterals() {
   getCurrentScopePtr() = this;
 }
 
@@ -58,11 +60,10 @@ IndexExprScope::IndexExprScope(IndexExprScope &explicitEnclosingScope)
 }
 
 IndexExprScope::~IndexExprScope() {
-  // Free the memory of each IndexExprImpl in scope's container.
-  for (IndexExprImpl *obj : container)
-    delete obj;
-  container.clear();
-  // no need to clear the cached copies as they are also in the container.
+  // The memory of the IndexExprImpl of the scope is freed with its allocator,
+  // they need no destruction.
+  static_assert(std::is_trivially_destructible<IndexExprImpl>::value,
+      "IndexExprImpl are released without destruction");
   getCurrentScopePtr() = parentScope;
 }
 
@@ -76,8 +77,26 @@ IndexExprScope::~IndexExprScope() {
 // IndexExprScope builder for IndexExpr.
 //===----------------------------------------------------------------------===//
 
-void IndexExprScope::addIndexExprImpl(IndexExprImpl *obj) {
-  container.emplace_back(obj);
+void *IndexExprScope::allocateIndexExprImpl() {
+  return allocator.Allocate<IndexExprImpl>();
+}
+
+IndexExprImpl *IndexExprScope::getSharedLiteral(int64_t value) {
+  // Literals get a value, created at the insertion point, once code is
+  // generated: they are only shared during shape inference.
+  if (!isShapeInferencePass())
+    return nullptr;
+  // The empty and tombstone keys of the map, INT64_MAX and INT64_MAX - 1, are
+  // not shared; INT64_MAX is the usual end of the Slices to the last element.
+  if (value == llvm::DenseMapInfo<int64_t>::getEmptyKey() ||
+      value == llvm::DenseMapInfo<int64_t>::getTombstoneKey())
+    return nullptr;
+  IndexExprImpl *&literal = sharedLiterals[value];
+  if (!literal) {
+    literal = IndexExprImpl::create();
+    literal->initAsLiteral(value, IndexExprKind::Affine);
+  }
+  return literal;
 }
 
 //===----------------------------------------------------------------------===//
@@ -122,6 +141,73 @@ OpBuilder &IndexExprScope::getRewriter() const {
   return *rewriter;
 }
 
+//===----------------------------------------------------------------------===//
+// IndexExprScope hoisting of loop invariant operations.
+//===----------------------------------------------------------------------===//
+
+Value IndexExprScope::createHoistedOp(StringRef opName, ValueRange operands,
+    function_ref<Value(OpBuilder &, ValueRange)> buildFn, Attribute key,
+    bool isDivision) {
+  OpBuilder &builder = getRewriter();
+  // Find the outermost enclosing loop in which all the operands are
+  // invariant, constants being rematerialized before it.
+  Operation *outermostLoop = nullptr;
+  Block *block = builder.getInsertionBlock();
+  Operation *parentOp = block ? block->getParentOp() : nullptr;
+  while (auto loopOp = dyn_cast_or_null<LoopLikeOpInterface>(parentOp)) {
+    if (!llvm::all_of(operands, [&](Value operand) {
+          return loopOp.isDefinedOutsideOfLoop(operand) ||
+                 matchPattern(operand, m_Constant());
+        }))
+      break;
+    outermostLoop = parentOp;
+    parentOp = parentOp->getParentOp();
+  }
+  if (!outermostLoop)
+    return buildFn(builder, operands);
+
+  // Reuse an identical operation hoisted before the same loop.
+  auto isSameOperand = [](Value hoisted, Value operand) {
+    Attribute hoistedAttr, attr;
+    return hoisted == operand ||
+           (matchPattern(hoisted, m_Constant(&hoistedAttr)) &&
+               matchPattern(operand, m_Constant(&attr)) && hoistedAttr == attr);
+  };
+  for (HoistedOp &hoistedOp : hoistedOps) {
+    if (hoistedOp.loop != outermostLoop || hoistedOp.opName != opName ||
+        hoistedOp.key != key || hoistedOp.operands.size() != operands.size())
+      continue;
+    if (llvm::all_of(llvm::zip(hoistedOp.operands, operands), [&](auto pair) {
+          return isSameOperand(std::get<0>(pair), std::get<1>(pair));
+        }))
+      return hoistedOp.result;
+  }
+
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPoint(outermostLoop);
+  SmallVector<Value, 3> hoistedOperands;
+  for (Value operand : operands) {
+    Operation *defOp = operand.getDefiningOp();
+    if (defOp && outermostLoop->isAncestor(defOp))
+      operand = builder.clone(*defOp)->getResult(0);
+    hoistedOperands.emplace_back(operand);
+  }
+  // The hoisted division is evaluated even when the loops have no iteration,
+  // in which case its divisor may be zero: divide by one instead.
+  SmallVector<Value, 3> buildOperands(hoistedOperands);
+  if (isDivision && !matchPattern(buildOperands[1], m_NonZero())) {
+    Value divisor = buildOperands[1];
+    Value zero = builder.create<ConstantIndexOp>(loc, 0);
+    Value one = builder.create<ConstantIndexOp>(loc, 1);
+    Value isZero =
+        builder.create<CmpIOp>(loc, CmpIPredicate::eq, divisor, zero);
+    buildOperands[1] = builder.create<SelectOp>(loc, isZero, one, divisor);
+  }
+  Value result = buildFn(builder, buildOperands);
+  hoistedOps.push_back({opName, hoistedOperands, key, outermostLoop, result});
+  return result;
+}
+
 //===----------------------------------------------------------------------===//
 // IndexExprScope Debug.
 //===----------------------------------------------------------------------===//
@@ -142,7 +228,7 @@ void IndexExprScope::debugPrint(const std::string &msg) const {
 
 IndexExpr IndexExpr::deepCopy() const {
   // Create new implementation and set scope to current scope (don't copy it).
-  IndexExprImpl *newImplObj = new IndexExprImpl();
+  IndexExprImpl *newImplObj = IndexExprImpl::create();
   assert(newImplObj && "failed to allocate IndexExpr implemtation");
   // Copy all of hte other fields (preserving current scope).
   newImplObj->copy(getObjPtr());
@@ -383,6 +469,49 @@ void IndexExpr::debugPrint(const std::string &msg) const {
 // IndexExpr Op Support.
 //===----------------------------------------------------------------------===//
 
+// Create the binary operation OP on the values of aa and bb, hoisted out of
+// the loops in which they are invariant.
+template <typename OP>
+static Value createHoistedBinaryOp(
+    IndexExpr const aa, IndexExpr const bb, bool isDivision = false) {
+  IndexExprScope &scope = IndexExprScope::getCurrentScope();
+  SmallVector<Value, 2> operands = {aa.getValue(), bb.getValue()};
+  return scope.createHoistedOp(
+      OP::getOperationName(), operands,
+      [&](OpBuilder &builder, ValueRange ops) -> Value {
+        return builder.create<OP>(scope.getLoc(), ops[0], ops[1]);
+      },
+      Attribute(), isDivision);
+}
+
+// Create a compare of aa and bb, hoisted out of the loops in which they are
+// invariant.
+static Value createHoistedCompare(
+    CmpIPredicate comparePred, IndexExpr const aa, IndexExpr const bb) {
+  IndexExprScope &scope = IndexExprScope::getCurrentScope();
+  SmallVector<Value, 2> operands = {aa.getValue(), bb.getValue()};
+  Attribute predAttr = scope.getRewriter().getI64IntegerAttr(
+      static_cast<int64_t>(comparePred));
+  return scope.createHoistedOp(CmpIOp::getOperationName(), operands,
+      [&](OpBuilder &builder, ValueRange ops) -> Value {
+        return builder.create<CmpIOp>(
+            scope.getLoc(), comparePred, ops[0], ops[1]);
+      },
+      predAttr);
+}
+
+// Create a select between trueVal and falseVal, hoisted out of the loops in
+// which the compare and both values are invariant.
+static Value createHoistedSelect(Value compare, Value trueVal, Value falseVal) {
+  IndexExprScope &scope = IndexExprScope::getCurrentScope();
+  SmallVector<Value, 3> operands = {compare, trueVal, falseVal};
+  return scope.createHoistedOp(SelectOp::getOperationName(), operands,
+      [&](OpBuilder &builder, ValueRange ops) -> Value {
+        return builder.create<SelectOp>(
+            scope.getLoc(), ops[0], ops[1], ops[2]);
+      });
+}
+
 // Used for add/sub/mult/ceilDiv/floorDiv
 IndexExpr IndexExpr::binaryOp(IndexExpr const b, bool affineWithLitB,
     bool canBeAffine, F2 litFct, F2 affineExprFct, F2 valueFct) const {
@@ -446,9 +575,7 @@ IndexExpr IndexExpr::compareOp(
     return PredicateIndexExpr(false);
   };
   F2 valueFct = [&](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
-    Value compare = aa.getRewriter().create<CmpIOp>(
-        aa.getLoc(), comparePred, aa.getValue(), bb.getValue());
-    return PredicateIndexExpr(compare);
+    return PredicateIndexExpr(createHoistedCompare(comparePred, aa, bb));
   };
   // Cannot have affine results, disable and pass null lambda function.
   return binaryOp(b, false, false, litFct, nullptr, valueFct);
@@ -475,8 +602,7 @@ IndexExpr IndexExpr::operator&(IndexExpr const b) const {
   // Not literals or questionmark, we must have predicates.
   assert(isPredType() && "expected predicate index expression");
   assert(b.isPredType() && "expected predicate index expression");
-  Value res = getRewriter().create<AndOp>(getLoc(), getValue(), b.getValue());
-  return PredicateIndexExpr(res);
+  return PredicateIndexExpr(createHoistedBinaryOp<AndOp>(*this, b));
 }
 
 // Conjunction of two conditions: Or
@@ -500,8 +626,7 @@ IndexExpr IndexExpr::operator|(IndexExpr const b) const {
   // Not literals or questionmark, we must have predicates.
   assert(isPredType() && "expected predicate index expression");
   assert(b.isPredType() && "expected predicate index expression");
-  Value res = getRewriter().create<OrOp>(getLoc(), getValue(), b.getValue());
-  return PredicateIndexExpr(res);
+  return PredicateIndexExpr(createHoistedBinaryOp<OrOp>(*this, b));
 }
 
 IndexExpr IndexExpr::operator!() const {
@@ -569,8 +694,7 @@ IndexExpr IndexExpr::operator+(IndexExpr const b) const {
     return AffineIndexExpr(aa.getAffineExpr() + bb.getAffineExpr());
   };
   F2 valueFct = [](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
-    return NonAffineIndexExpr(aa.getRewriter().create<AddIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(createHoistedBinaryOp<AddIOp>(aa, bb));
   };
   return binaryOp(b, false, true, litFct, affineExprFct, valueFct);
 }
@@ -583,8 +707,7 @@ IndexExpr IndexExpr::operator-(IndexExpr const b) const {
     return AffineIndexExpr(aa.getAffineExpr() - bb.getAffineExpr());
   };
   F2 valueFct = [](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
-    return NonAffineIndexExpr(aa.getRewriter().create<SubIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(createHoistedBinaryOp<SubIOp>(aa, bb));
   };
   return binaryOp(b, false, true, litFct, affineExprFct, valueFct);
 }
@@ -599,8 +722,7 @@ IndexExpr IndexExpr::operator*(IndexExpr const b) const {
   F2 valueFct = [](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
     if (bb.isLiteral() && bb.getLiteral() == 1)
       return aa.deepCopy();
-    return NonAffineIndexExpr(aa.getRewriter().create<MulIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(createHoistedBinaryOp<MulIOp>(aa, bb));
   };
   // Literal should be place in second argument; do so if a is a lit.
   if (isLiteral())
@@ -620,15 +742,15 @@ IndexExpr IndexExpr::floorDiv(IndexExpr const b) const {
       return aa.deepCopy();
     if (bval > 1)
       return AffineIndexExpr(aa.getAffineExpr().floorDiv(bval));
-    return NonAffineIndexExpr(aa.getRewriter().create<SignedFloorDivIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(
+        createHoistedBinaryOp<SignedFloorDivIOp>(aa, bb, /*isDivision=*/true));
   };
   F2 valueFct = [](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
     if (bb.isLiteral() && bb.getLiteral() == 1) {
       return aa.deepCopy();
     }
-    return NonAffineIndexExpr(aa.getRewriter().create<SignedFloorDivIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(
+        createHoistedBinaryOp<SignedFloorDivIOp>(aa, bb, /*isDivision=*/true));
   };
   // Index b must be a literal.
   return binaryOp(b, true, true, litFct, affineExprFct, valueFct);
@@ -646,15 +768,15 @@ IndexExpr IndexExpr::ceilDiv(IndexExpr const b) const {
       return aa.deepCopy();
     if (bval > 1)
       return AffineIndexExpr(aa.getAffineExpr().ceilDiv(bval));
-    return NonAffineIndexExpr(aa.getRewriter().create<SignedCeilDivIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(
+        createHoistedBinaryOp<SignedCeilDivIOp>(aa, bb, /*isDivision=*/true));
   };
   F2 valueFct = [](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
     if (bb.isLiteral() && bb.getLiteral() == 1) {
       return aa.deepCopy();
     }
-    return NonAffineIndexExpr(aa.getRewriter().create<SignedCeilDivIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(
+        createHoistedBinaryOp<SignedCeilDivIOp>(aa, bb, /*isDivision=*/true));
   };
   // Index b must be a literal.
   return binaryOp(b, true, true, litFct, affineExprFct, valueFct);
@@ -670,15 +792,15 @@ IndexExpr IndexExpr::operator%(IndexExpr const b) const {
     int64_t bval = bb.getLiteral();
     if (bval >= 0)
       return AffineIndexExpr(aa.getAffineExpr() % bval);
-    return NonAffineIndexExpr(aa.getRewriter().create<SignedRemIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(
+        createHoistedBinaryOp<SignedRemIOp>(aa, bb, /*isDivision=*/true));
   };
   F2 valueFct = [](IndexExpr const aa, IndexExpr const bb) -> IndexExpr {
     if (bb.isLiteral() && bb.getLiteral() == 1) {
       return aa.deepCopy();
     }
-    return NonAffineIndexExpr(aa.getRewriter().create<SignedRemIOp>(
-        aa.getLoc(), aa.getValue(), bb.getValue()));
+    return NonAffineIndexExpr(
+        createHoistedBinaryOp<SignedRemIOp>(aa, bb, /*isDivision=*/true));
   };
   // Index b must be a literal.
   return binaryOp(b, true, true, litFct, affineExprFct, valueFct);
@@ -743,7 +865,7 @@ IndexExpr IndexExpr::clamp(IndexExpr const min, IndexExpr const max) const {
   if (compare.isShapeInferencePass())
     return QuestionmarkIndexExpr();
   // Generate code for the select.
-  Value results = compare.getRewriter().create<SelectOp>(compare.getLoc(),
+  Value results = createHoistedSelect(
       compare.getValue(), trueVal.getValue(), falseVal.getValue());
   return NonAffineIndexExpr(results);
 }
@@ -782,11 +904,10 @@ IndexExpr IndexExpr::clamp(IndexExpr const min, IndexExpr const max) const {
   };
   // Res is already defined, we are reducing into it.
   F2Self valueFct = [](IndexExpr res, IndexExpr const aa) {
-    Value compareVal = res.getRewriter().create<CmpIOp>(
-        aa.getLoc(), CmpIPredicate::slt, aa.getValue(), res.getValue());
-    Value resVal = aa.getRewriter().create<SelectOp>(
-        aa.getLoc(), compareVal, aa.getValue(), res.getValue());
-    res.getObj().initAsKind(res.getValue(), IndexExprKind::NonAffine);
+    Value compareVal = createHoistedCompare(CmpIPredicate::slt, aa, res);
+    Value resVal =
+        createHoistedSelect(compareVal, aa.getValue(), res.getValue());
+    res.getObj().initAsKind(resVal, IndexExprKind::NonAffine);
     return res;
   };
   return reductionOp(vals, litFct, affineExprFct, valueFct);
@@ -838,11 +959,10 @@ IndexExpr IndexExpr::clamp(IndexExpr const min, IndexExpr const max) const {
   };
   // Res is already defined, we are reducing into it.
   F2Self valueFct = [](IndexExpr res, IndexExpr const aa) {
-    Value compareVal = res.getRewriter().create<CmpIOp>(
-        aa.getLoc(), CmpIPredicate::sgt, aa.getValue(), res.getValue());
-    Value resVal = aa.getRewriter().create<SelectOp>(
-        aa.getLoc(), compareVal, aa.getValue(), res.getValue());
-    res.getObj().initAsKind(res.getValue(), IndexExprKind::NonAffine);
+    Value compareVal = createHoistedCompare(CmpIPredicate::sgt, aa, res);
+    Value resVal =
+        createHoistedSelect(compareVal, aa.getValue(), res.getValue());
+    res.getObj().initAsKind(resVal, IndexExprKind::NonAffine);
     return res;
   };
   return reductionOp(vals, litFct, affineExprFct, valueFct);
@@ -966,20 +1086,23 @@ LiteralIndexExpr::LiteralIndexExpr(IndexExpr const otherIndexExpr) {
 }
 
 void LiteralIndexExpr::init(int64_t const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprScope::getCurrentScope().getSharedLiteral(value);
+  if (indexExprObj)
+    return;
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   indexExprObj->initAsLiteral(value, IndexExprKind::Affine);
 }
 
 NonAffineIndexExpr::NonAffineIndexExpr(Value const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implemtation");
   indexExprObj->initAsKind(value, IndexExprKind::NonAffine);
 }
 
 NonAffineIndexExpr::NonAffineIndexExpr(IndexExpr const otherIndexExpr) {
   // Create new IndexExpr implementation object.
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   // If the index expression is a literal,  just copy it.
   if (otherIndexExpr.isLiteral()) {
@@ -1022,7 +1145,7 @@ NonAffineIndexExpr::NonAffineIndexExpr(IndexExpr const otherIndexExpr) {
 }
 
 QuestionmarkIndexExpr::QuestionmarkIndexExpr() {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implemtation");
   indexExprObj->initAsQuestionmark();
 }
@@ -1033,20 +1156,20 @@ QuestionmarkIndexExpr::QuestionmarkIndexExpr(IndexExpr const otherIndexExpr)
 }
 
 PredicateIndexExpr::PredicateIndexExpr(bool const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   indexExprObj->initAsLiteral(value, IndexExprKind::Predicate);
 }
 
 PredicateIndexExpr::PredicateIndexExpr(Value const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implemtation");
   indexExprObj->initAsKind(value, IndexExprKind::Predicate);
 }
 
 PredicateIndexExpr::PredicateIndexExpr(IndexExpr const otherIndexExpr) {
   // Create new IndexExpr implementation object.
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   // If the index expression is a literal,  just copy it.
   if (otherIndexExpr.isLiteral()) {
@@ -1060,14 +1183,14 @@ PredicateIndexExpr::PredicateIndexExpr(IndexExpr const otherIndexExpr) {
 }
 
 AffineIndexExpr::AffineIndexExpr(AffineExpr const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implemtation");
   indexExprObj->initAsAffineExpr(value);
 }
 
 AffineIndexExpr::AffineIndexExpr(IndexExpr const otherIndexExpr) {
   // Create new IndexExpr implementation object.
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   // If the index expression is a literal,  just copy it.
   if (otherIndexExpr.isLiteral()) {
@@ -1109,14 +1232,14 @@ AffineIndexExpr::AffineIndexExpr(IndexExpr const otherIndexExpr) {
 }
 
 DimIndexExpr::DimIndexExpr(Value const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implemtation");
   indexExprObj->initAsKind(value, IndexExprKind::Dim);
 }
 
 DimIndexExpr::DimIndexExpr(IndexExpr const otherIndexExpr) {
   // Create new IndexExpr implementation object.
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   // If the index expression is a literal,  just copy it.
   if (otherIndexExpr.isLiteral()) {
@@ -1159,14 +1282,14 @@ DimIndexExpr::DimIndexExpr(IndexExpr const otherIndexExpr) {
 }
 
 SymbolIndexExpr::SymbolIndexExpr(Value const value) {
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implemtation");
   indexExprObj->initAsKind(value, IndexExprKind::Symbol);
 }
 
 SymbolIndexExpr::SymbolIndexExpr(IndexExpr const otherIndexExpr) {
   // Create new IndexExpr implementation object.
-  indexExprObj = new IndexExprImpl();
+  indexExprObj = IndexExprImpl::create();
   assert(indexExprObj && "failed to allocate IndexExpr implementation");
   // If the index expression is a literal,  just copy it.
   if (otherIndexExpr.isLiteral()) {
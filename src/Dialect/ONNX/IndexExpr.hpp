@@ -243,6 +243,16 @@ compile time sizes, -1 for runtime sizes).
 
     // Back to the outer scope
 
+  The non-affine operations generated by a scope (add, mul, divisions,
+compares, selects, min/max...) are hoisted out of the loops enclosing the
+insertion point of its rewriter when their operands are invariant in these
+loops, constants being rematerialized before them. For example, the
+"dim > 1" compare of a broadcasting access function is computed once before
+the loop nest iterating over the output, instead of once per iteration.
+Divisors that are not known to be nonzero are replaced by one when zero, as
+the hoisted division is evaluated even when the loops have no iteration.
+Within a scope, identical hoisted operations are only generated once.
+
 5) Additional infrastructure
 
    ArrayValueIndexCapture allows us to read 1D arrays and generate symbols out
@@ -264,6 +274,8 @@ inference part as no code may be generated during such phases.
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Value.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Allocator.h"
 
 #include <functional>
 #include <stdint.h>
@@ -340,6 +352,15 @@ public:
   int getNumDims() const { return dims.size(); }
   int getNumSymbols() const { return symbols.size(); }
 
+  // Create an operation with buildFn, before the outermost of the loops
+  // enclosing the insertion point in which the operands are invariant. The
+  // operation, identified by its name, operands and key attribute, is reused
+  // when already hoisted before the same loop. The second operand of a
+  // division is made safe to evaluate outside of the loops.
+  Value createHoistedOp(StringRef opName, ValueRange operands,
+      function_ref<Value(OpBuilder &, ValueRange)> buildFn,
+      Attribute key = {}, bool isDivision = false);
+
   // Debug (enable using DEBUG=1 at top of file).
   void debugPrint(const std::string &msg) const;
 
@@ -349,8 +370,11 @@ private:
     return scope;
   }
 
-  // Add a new IndexExprImpl in the scope's container.
-  void addIndexExprImpl(IndexExprImpl *obj);
+  // Allocate a new IndexExprImpl in the scope's allocator.
+  void *allocateIndexExprImpl();
+  // Return the IndexExprImpl of the affine literal shared by the index exprs
+  // of the scope, null when literals are not shared.
+  IndexExprImpl *getSharedLiteral(int64_t value);
 
   // Support functions for AffineExpr.
   int addDim(Value const value);
@@ -365,9 +389,21 @@ private:
   Location loc;
   // Parent scope (used when creating a child scope).
   IndexExprScope *parentScope;
-  // Container of all index expr implementation records, to simplify
-  // live range analysis. ALl will be deleted upon scope destruction.
-  SmallVector<IndexExprImpl *, 20> container;
+  // Allocator of all index expr implementation records, to simplify
+  // live range analysis. All are released at once upon scope destruction.
+  llvm::BumpPtrAllocator allocator;
+  // Affine literals of the shape inference scopes, which never get a value
+  // nor are modified, shared by the index exprs of the same literal.
+  llvm::DenseMap<int64_t, IndexExprImpl *> sharedLiterals;
+  // Operations hoisted out of loops, reused by identical operations.
+  struct HoistedOp {
+    StringRef opName;
+    SmallVector<Value, 3> operands;
+    Attribute key;
+    Operation *loop;
+    Value result;
+  };
+  SmallVector<HoistedOp, 8> hoistedOps;
 };
 
 //===----------------------------------------------------------------------===//
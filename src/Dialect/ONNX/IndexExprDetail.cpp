@@ -36,8 +36,12 @@ IndexExprImpl::IndexExprImpl()
   // Set scope from thread private global.
   scope = IndexExprScope::getCurrentScopePtr();
   assert(scope && "expected IndexExpr Scope to be defined");
-  // Record the new index expr implementation.
-  scope->addIndexExprImpl(this);
+}
+
+/*static*/ IndexExprImpl *IndexExprImpl::create() {
+  IndexExprScope *scope = IndexExprScope::getCurrentScopePtr();
+  assert(scope && "expected IndexExpr Scope to be defined");
+  return new (scope->allocateIndexExprImpl()) IndexExprImpl();
 }
 
 void IndexExprImpl::initAsUndefined() {
@@ -23,12 +23,14 @@ namespace mlir {
 // Implementation of the IndexExpr. In nearly all cases, the value described by
 // this data structure is constant. Sole exception is during the reduction
 // operations. IndexExpr are simply a pointer to this data structure. This data
-// structure is allocated in dynamic memory and resides in the scope. It will
-// be automaticaly destroyed at the same time as the scope.
+// structure is allocated by the allocator of the scope, with create, and
+// resides in the scope. It will be automaticaly released at the same time as
+// the scope.
 
 struct IndexExprImpl {
-  // Public constructor.
+  // Public constructor, and allocation in the current scope.
   IndexExprImpl();
+  static IndexExprImpl *create();
 
   // Basic initialization calls.
   void initAsUndefined();
@@ -1175,6 +1175,26 @@ LogicalResult ONNXMinOp::inferShapes(
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// Mean
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXMeanOp. This method is required by the
+/// shape inference interface.
+LogicalResult ONNXMeanOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  for (int i = 0; i < getNumOperands(); ++i) {
+    if (!getOperand(i).getType().isa<RankedTensorType>())
+      return emitError("Input tensor(s) not ranked");
+  }
+  Type resultTy = getOperand(0).getType().cast<RankedTensorType>();
+  for (int i = 1; i < getNumOperands(); ++i) {
+    Type nextTy = getOperand(i).getType().cast<RankedTensorType>();
+    resultTy = getBroadcastedType(resultTy, nextTy);
+  }
+  getResult().setType(resultTy);
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // Neg
 //===----------------------------------------------------------------------===//
@@ -1216,15 +1236,18 @@ LogicalResult ONNXMatMulOp::inferShapes(
 // QLinearMatMul
 //===----------------------------------------------------------------------===//
 
-LogicalResult ONNXQLinearMatMulOp::inferShapes(
-    std::function<void(mlir::Region &)> doShapeInference) {
+/// Infer the result type of the matrix multiply of lhs and rhs, following the
+/// numpy matmul rules, with the given element type.
+template <typename OP>
+static LogicalResult inferMatMulResultType(
+    OP *op, Value lhs, Value rhs, Type elementType) {
   // Cannot infer shape if no shape exists.
-  if (!a().getType().isa<RankedTensorType>() ||
-      !b().getType().isa<RankedTensorType>())
-    return emitError("Input tensor(s) not ranked");
+  if (!lhs.getType().isa<RankedTensorType>() ||
+      !rhs.getType().isa<RankedTensorType>())
+    return op->emitError("Input tensor(s) not ranked");
 
-  auto lhsTy = a().getType().cast<RankedTensorType>();
-  auto rhsTy = b().getType().cast<RankedTensorType>();
+  auto lhsTy = lhs.getType().cast<RankedTensorType>();
+  auto rhsTy = rhs.getType().cast<RankedTensorType>();
 
   SmallVector<int64_t, 2> dims;
   auto lhsShape = lhsTy.getShape();
@@ -1232,14 +1255,14 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
 
   if (lhsShape.size() < 1 && rhsShape.size() < 1) {
     // Multiplication by scalars is not allowed.
-    return emitError("Multiplication by scalar arguments not allowed");
+    return op->emitError("Multiplication by scalar arguments not allowed");
   } else if (lhsShape.size() == 1 && rhsShape.size() == 1) {
     // Special case when both arrays are 1-dimensional and according to
     // numpy rules the types need to be extended to 1xN and Nx1. Helper sizes
     // need to be removed after the multiplication but cannot be removed if
     // all sizes are 1.
     if (lhsShape[0] != -1 && rhsShape[0] != -1 && lhsShape[0] != rhsShape[0])
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     dims.emplace_back(1);
   } else if (lhsShape.size() == 1 && rhsShape.size() >= 2) {
     // If the first argument is 1-D, it is promoted to a matrix by prepending
@@ -1254,7 +1277,7 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
     unsigned rhsRank = rhsShape.size();
     if (lhsShape[0] != -1 && rhsShape[rhsRank - 2] != -1 &&
         lhsShape[0] != rhsShape[rhsRank - 2])
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     for (decltype(rhsRank) i = 0; i < rhsRank - 2; ++i)
       dims.emplace_back(rhsShape[i]);
     dims.emplace_back(rhsShape[rhsRank - 1]);
@@ -1271,7 +1294,7 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
     unsigned lhsRank = lhsShape.size();
     if (lhsShape[lhsRank - 1] != -1 && rhsShape[0] != -1 &&
         lhsShape[lhsRank - 1] != rhsShape[0])
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     for (decltype(lhsRank) i = 0; i < lhsRank - 2; ++i)
       dims.emplace_back(lhsShape[i]);
     dims.emplace_back(lhsShape[lhsRank - 2]);
@@ -1284,7 +1307,7 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
     unsigned lhsRank = lhsShape.size();
     if (lhsShape[lhsRank - 1] != -1 && rhsShape[0] != -1 &&
         lhsShape[lhsRank - 1] != rhsShape[0])
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     for (decltype(lhsRank) i = 0; i < lhsRank - 1; ++i)
       dims.emplace_back(lhsShape[i]);
     dims.emplace_back(rhsShape[1]);
@@ -1297,7 +1320,7 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
     unsigned rhsRank = rhsShape.size();
     if (lhsShape[1] != -1 && rhsShape[rhsRank - 2] != -1 &&
         lhsShape[1] != rhsShape[rhsRank - 2])
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     for (decltype(rhsRank) i = 0; i < rhsRank - 2; ++i)
       dims.emplace_back(rhsShape[i]);
     dims.emplace_back(lhsShape[0]);
@@ -1312,7 +1335,7 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
     unsigned rhsRank = rhsShape.size();
     if (lhsShape[lhsRank - 1] != -1 && rhsShape[rhsRank - 2] != -1 &&
         lhsShape[lhsRank - 1] != rhsShape[rhsRank - 2])
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     // Check and perform broadcasting for the shapes.
     SmallVector<int64_t, 2> lhsBcastShape;
     for (decltype(lhsRank) i = 0; i < lhsRank - 2; ++i)
@@ -1321,7 +1344,7 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
     for (decltype(rhsRank) i = 0; i < rhsRank - 2; ++i)
       rhsBcastShape.emplace_back(rhsShape[i]);
     if (!getBroadcastedShape(lhsBcastShape, rhsBcastShape, dims))
-      return emitError("Broadcasted dimensions are incompatible");
+      return op->emitError("Broadcasted dimensions are incompatible");
     dims.emplace_back(lhsShape[lhsRank - 2]);
     dims.emplace_back(rhsShape[rhsRank - 1]);
   } else {
@@ -1335,15 +1358,34 @@ LogicalResult ONNXQLinearMatMulOp::inferShapes(
 
     // Check legality of matrix multiplication.
     if (lhsDim != -1 && rhsDim != -1 && lhsDim != rhsDim)
-      return emitError("Attempt to multiply incompatible matrices");
+      return op->emitError("Attempt to multiply incompatible matrices");
     if (rhsShape.size() > 1)
       dims.emplace_back(rhsShape[1]);
   }
 
-  getResult().setType(RankedTensorType::get(dims, lhsTy.getElementType()));
+  op->getResult().setType(RankedTensorType::get(dims, elementType));
   return success();
 }
 
+LogicalResult ONNXQLinearMatMulOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  if (!a().getType().isa<RankedTensorType>())
+    return emitError("Input tensor(s) not ranked");
+  Type elementType = a().getType().cast<RankedTensorType>().getElementType();
+  return inferMatMulResultType(this, a(), b(), elementType);
+}
+
+//===----------------------------------------------------------------------===//
+// MatMulInteger
+//===----------------------------------------------------------------------===//
+
+LogicalResult ONNXMatMulIntegerOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  // The products are accumulated in 32-bit integers.
+  Type elementType = IntegerType::get(getContext(), 32);
+  return inferMatMulResultType(this, A(), B(), elementType);
+}
+
 // Gemm
 LogicalResult ONNXGemmOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
@@ -2327,6 +2369,9 @@ LogicalResult ONNXScalerOp::inferShapes(
 
 LogicalResult ONNXConstantOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
+  // The type of a constant referencing external data is set on import.
+  if (hasExternalData(getOperation()))
+    return success();
   if ((sparse_value().hasValue() && value().hasValue()) ||
       (!sparse_value().hasValue() && !value().hasValue()))
     return emitError("Require exactly one of the two attributes, "
@@ -3024,6 +3069,48 @@ LogicalResult ONNXLessOp::inferShapes(
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// Equal
+//===----------------------------------------------------------------------===//
+
+LogicalResult ONNXEqualOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  if (!A().getType().isa<RankedTensorType>() ||
+      !B().getType().isa<RankedTensorType>())
+    return emitError("Input tensor(s) not ranked");
+  Type lhsTy = A().getType().cast<RankedTensorType>();
+  Type rhsTy = B().getType().cast<RankedTensorType>();
+  ArrayRef<int64_t> dims =
+      getBroadcastedType(lhsTy, rhsTy).cast<RankedTensorType>().getShape();
+
+  getResult().setType(
+      RankedTensorType::get(dims, IntegerType::get(getContext(), /*width=*/1)));
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Where
+//===----------------------------------------------------------------------===//
+
+LogicalResult ONNXWhereOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  if (!condition().getType().isa<RankedTensorType>() ||
+      !X().getType().isa<RankedTensorType>() ||
+      !Y().getType().isa<RankedTensorType>())
+    return emitError("Input tensor(s) not ranked");
+  auto xTy = X().getType().cast<RankedTensorType>();
+  auto valuesTy =
+      getBroadcastedType(xTy, Y().getType()).cast<RankedTensorType>();
+  SmallVector<int64_t, 4> dims;
+  if (!getBroadcastedShape(
+          condition().getType().cast<RankedTensorType>().getShape(),
+          valuesTy.getShape(), dims))
+    return emitError("Where operands are not broadcastable");
+
+  getResult().setType(RankedTensorType::get(dims, xTy.getElementType()));
+  return success();
+}
+
 // Operations for which shape inference has not been implemented yet
 // If you add the implementation for one op, move it out of this section
 // Also please add test case in test/mlir/onnx/onnx_shape_inference.mlir
@@ -3052,7 +3139,22 @@ LogicalResult ONNXArgMaxOp::inferShapes(
 
 LogicalResult ONNXArgMinOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
+  if (!data().getType().isa<RankedTensorType>())
+    return emitError("Input tensor not ranked");
+
+  ONNXArgMinOpShapeHelper shapeHelper(this);
+  ONNXArgMinOpAdaptor operandAdaptor(*this);
+  if (failed(shapeHelper.Compute(operandAdaptor)))
+    return emitError("Failed to scan ArgMin parameters successfully");
+
+  SmallVector<int64_t, 4> outputDims;
+  IndexExpr::getShape(shapeHelper.dimsForOutput(0), outputDims);
+
+  // ONNX spec specifies the reduced type as an int64
+  Type elementType = IntegerType::get(getContext(), 64);
+  getResult().setType(RankedTensorType::get(outputDims, elementType));
+
+  return success();
 }
 
 LogicalResult ONNXBatchNormalizationOp::inferShapes(
@@ -3133,11 +3235,6 @@ LogicalResult ONNXDetOp::inferShapes(
   return emitError(NOT_IMPLEMENTED_MESSAGE);
 }
 
-LogicalResult ONNXEqualOp::inferShapes(
-    std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
-}
-
 LogicalResult ONNXEyeLikeOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
   return emitError(NOT_IMPLEMENTED_MESSAGE);
@@ -3176,7 +3273,27 @@ LogicalResult ONNXIfOp::inferShapes(
 
 LogicalResult ONNXInstanceNormalizationOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
+  // Cannot infer shape if no shape exists.
+  if (!input().getType().isa<RankedTensorType>())
+    return emitError("Input tensor(s) not ranked");
+
+  auto inputType = input().getType().cast<RankedTensorType>();
+  if (inputType.getRank() < 3)
+    return emitError("The input must have a rank of at least 3");
+  int64_t channels = inputType.getShape()[1];
+  for (Value param : {scale(), B()}) {
+    auto paramType = param.getType().dyn_cast<RankedTensorType>();
+    if (!paramType)
+      continue;
+    if (paramType.getRank() != 1)
+      return emitError("Scale and B must be 1-D tensors");
+    int64_t paramDim = paramType.getShape()[0];
+    if (channels != -1 && paramDim != -1 && channels != paramDim)
+      return emitError("Scale and B must have the size of the channels");
+  }
+
+  getResult().setType(inputType);
+  return success();
 }
 
 LogicalResult ONNXIsInfOp::inferShapes(
@@ -3218,11 +3335,6 @@ LogicalResult ONNXLpPoolOp::inferShapes(
   return emitError(NOT_IMPLEMENTED_MESSAGE);
 }
 
-LogicalResult ONNXMatMulIntegerOp::inferShapes(
-    std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
-}
-
 LogicalResult ONNXMaxPoolOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
   return emitError(NOT_IMPLEMENTED_MESSAGE);
@@ -3238,11 +3350,6 @@ LogicalResult ONNXMaxUnpoolOp::inferShapes(
   return emitError(NOT_IMPLEMENTED_MESSAGE);
 }
 
-LogicalResult ONNXMeanOp::inferShapes(
-    std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
-}
-
 LogicalResult ONNXMeanVarianceNormalizationOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
   return emitError(NOT_IMPLEMENTED_MESSAGE);
@@ -3260,7 +3367,10 @@ LogicalResult ONNXMultinomialOp::inferShapes(
 
 LogicalResult ONNXNonMaxSuppressionOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
+  // The number of selected boxes is only known when running.
+  getResult().setType(
+      RankedTensorType::get({-1, 3}, IntegerType::get(getContext(), 64)));
+  return success();
 }
 
 LogicalResult ONNXNonZeroOp::inferShapes(
@@ -3328,9 +3438,57 @@ LogicalResult ONNXReduceSumSquareOp::inferShapes(
   return emitError(NOT_IMPLEMENTED_MESSAGE);
 }
 
+// Compute the output dims of Resize and Upsample from constant scales: each
+// dim is floor(input_dim * scale), unknown when the scales are not constant.
+static LogicalResult inferResizedDims(Operation *op, RankedTensorType xTy,
+    Value scales, SmallVectorImpl<int64_t> &outputDims) {
+  int64_t rank = xTy.getRank();
+  outputDims.assign(rank, -1);
+  if (!getONNXConstantOp(scales))
+    return success();
+  auto constScales = getONNXConstantOp(scales)
+                         .valueAttr()
+                         .dyn_cast_or_null<mlir::DenseElementsAttr>();
+  if (!constScales || constScales.getNumElements() != rank)
+    return op->emitError("The number of scales must be the input rank");
+  int64_t i = 0;
+  for (APFloat scale : constScales.getValues<APFloat>()) {
+    int64_t dim = xTy.getShape()[i];
+    if (dim != -1)
+      outputDims[i] = floor(dim * scale.convertToFloat());
+    ++i;
+  }
+  return success();
+}
+
 LogicalResult ONNXResizeOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
+  if (!X().getType().isa<RankedTensorType>())
+    return emitError("Input tensor not ranked");
+
+  auto xTy = X().getType().cast<RankedTensorType>();
+  int64_t rank = xTy.getRank();
+  SmallVector<int64_t, 4> outputDims;
+  // The sizes, when given, are the output dims. Otherwise the output dims
+  // are computed from the scales, which are then given as an empty tensor.
+  if (!isFromNone(sizes())) {
+    outputDims.assign(rank, -1);
+    if (getONNXConstantOp(sizes())) {
+      auto constSizes = getONNXConstantOp(sizes())
+                            .valueAttr()
+                            .dyn_cast_or_null<mlir::DenseElementsAttr>();
+      if (!constSizes || constSizes.getNumElements() != rank)
+        return emitError("The number of sizes must be the input rank");
+      int64_t i = 0;
+      for (IntegerAttr size : constSizes.getValues<IntegerAttr>())
+        outputDims[i++] = size.getInt();
+    }
+  } else if (failed(inferResizedDims(*this, xTy, scales(), outputDims))) {
+    return failure();
+  }
+
+  getResult().setType(RankedTensorType::get(outputDims, xTy.getElementType()));
+  return success();
 }
 
 LogicalResult ONNXReverseSequenceOp::inferShapes(
@@ -3529,7 +3687,43 @@ LogicalResult ONNXThresholdedReluOp::inferShapes(
 
 LogicalResult ONNXTopKOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
+  if (!X().getType().isa<RankedTensorType>())
+    return emitError("Input tensor not ranked");
+
+  auto xTy = X().getType().cast<RankedTensorType>();
+  SmallVector<int64_t, 4> outputDims(
+      xTy.getShape().begin(), xTy.getShape().end());
+  int64_t rank = outputDims.size();
+  int64_t axisValue = axis();
+  if (axisValue < -rank || axisValue >= rank)
+    return emitError("TopK axis value out of bound");
+  if (axisValue < 0) {
+    axisValue += rank;
+    auto builder = mlir::Builder(getContext());
+    axisAttr(IntegerAttr::get(builder.getIntegerType(64, /*isSigned=*/true),
+        APInt(64, axisValue, /*isSigned=*/true)));
+  }
+
+  // The size along the axis is K, unknown when K is not a constant.
+  outputDims[axisValue] = -1;
+  if (getONNXConstantOp(K())) {
+    auto constK = getONNXConstantOp(K())
+                      .valueAttr()
+                      .dyn_cast_or_null<mlir::DenseElementsAttr>();
+    if (!constK || constK.getNumElements() != 1)
+      return emitError("TopK K must be a single element tensor");
+    int64_t k = (*constK.getValues<IntegerAttr>().begin()).getInt();
+    if (k < 0 || (xTy.getShape()[axisValue] != -1 &&
+                     k > xTy.getShape()[axisValue]))
+      return emitError("TopK K value out of bound");
+    outputDims[axisValue] = k;
+  }
+
+  getResult(0).setType(
+      RankedTensorType::get(outputDims, xTy.getElementType()));
+  getResult(1).setType(RankedTensorType::get(
+      outputDims, IntegerType::get(getContext(), 64)));
+  return success();
 }
 
 LogicalResult ONNXUniqueOp::inferShapes(
@@ -3539,12 +3733,15 @@ LogicalResult ONNXUniqueOp::inferShapes(
 
 LogicalResult ONNXUpsampleOp::inferShapes(
     std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
-}
+  if (!X().getType().isa<RankedTensorType>())
+    return emitError("Input tensor not ranked");
 
-LogicalResult ONNXWhereOp::inferShapes(
-    std::function<void(mlir::Region &)> doShapeInference) {
-  return emitError(NOT_IMPLEMENTED_MESSAGE);
+  auto xTy = X().getType().cast<RankedTensorType>();
+  SmallVector<int64_t, 4> outputDims;
+  if (failed(inferResizedDims(*this, xTy, scales(), outputDims)))
+    return failure();
+  getResult().setType(RankedTensorType::get(outputDims, xTy.getElementType()));
+  return success();
 }
 
 LogicalResult ONNXArrayFeatureExtractorOp::inferShapes(
@@ -3743,6 +3940,200 @@ LogicalResult ONNXCustomOp::inferShapes(
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// FusedGemmOp
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXFusedGemmOp, which is the one of the Gemm
+/// computing its input.
+LogicalResult ONNXFusedGemmOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  if (activation() != "Relu" && activation() != "Sigmoid" &&
+      activation() != "Tanh")
+    return emitError("Unsupported activation: " + activation());
+  bool hasBias = !C().getType().isa<NoneType>();
+  // Cannot infer shape if no shape exists.
+  if (!A().getType().isa<RankedTensorType>() ||
+      !B().getType().isa<RankedTensorType>() ||
+      (hasBias && !C().getType().isa<RankedTensorType>()))
+    return emitError("Input tensor(s) not ranked");
+
+  return shapeHelperInferShapes<ONNXFusedGemmOpShapeHelper, ONNXFusedGemmOp,
+      ONNXFusedGemmOpAdaptor>(this, A());
+}
+
+//===----------------------------------------------------------------------===//
+// FusedActivationOp
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXFusedActivationOp: the shape of X.
+LogicalResult ONNXFusedActivationOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  StringRef activation = this->activation();
+  if (activation != "Gelu" && activation != "Swish" &&
+      activation != "HardSwish")
+    return emitError("Unsupported activation: ") << activation;
+  getResult().setType(X().getType());
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// FusedAttentionOp
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXFusedAttentionOp: [..., S, Dv] for Q of
+/// shape [..., S, D] and V of shape [..., L, Dv].
+LogicalResult ONNXFusedAttentionOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  bool hasMask = !mask().getType().isa<NoneType>();
+  // Cannot infer shape if no shape exists.
+  if (!Q().getType().isa<RankedTensorType>() ||
+      !K().getType().isa<RankedTensorType>() ||
+      !V().getType().isa<RankedTensorType>() ||
+      (hasMask && !mask().getType().isa<RankedTensorType>()))
+    return emitError("Input tensor(s) not ranked");
+
+  auto qType = Q().getType().cast<RankedTensorType>();
+  auto kType = K().getType().cast<RankedTensorType>();
+  auto vType = V().getType().cast<RankedTensorType>();
+  int64_t rank = qType.getRank();
+  if (rank < 2 || kType.getRank() != rank || vType.getRank() != rank)
+    return emitError("Q, K and V must have the same rank, at least 2");
+  if (hasMask && mask().getType().cast<RankedTensorType>().getRank() > rank)
+    return emitError("The mask rank must not exceed the rank of Q");
+  int64_t d = qType.getShape()[rank - 1];
+  int64_t kd = kType.getShape()[rank - 2];
+  if (d != -1 && kd != -1 && d != kd)
+    return emitError("The last dimension of Q must match the dimension "
+                     "before last of K");
+
+  SmallVector<int64_t, 4> dims(
+      qType.getShape().begin(), qType.getShape().end() - 1);
+  dims.emplace_back(vType.getShape()[rank - 1]);
+  getResult().setType(RankedTensorType::get(dims, qType.getElementType()));
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// FusedLayerNormOp
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXFusedLayerNormOp: the shape of X.
+LogicalResult ONNXFusedLayerNormOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  // Cannot infer shape if no shape exists.
+  if (!X().getType().isa<RankedTensorType>())
+    return emitError("Input tensor(s) not ranked");
+
+  auto xType = X().getType().cast<RankedTensorType>();
+  if (xType.getRank() < 1)
+    return emitError("The input must have a rank of at least 1");
+  int64_t lastDim = xType.getShape()[xType.getRank() - 1];
+  for (Value param : {Scale(), B()}) {
+    auto paramType = param.getType().dyn_cast<RankedTensorType>();
+    if (!paramType)
+      continue;
+    if (paramType.getRank() != 1)
+      return emitError("Scale and B must be 1-D tensors");
+    int64_t paramDim = paramType.getShape()[0];
+    if (lastDim != -1 && paramDim != -1 && lastDim != paramDim)
+      return emitError("Scale and B must have the size of the last dimension "
+                       "of the input");
+  }
+
+  getResult().setType(xType);
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// LayoutTransformOp
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXLayoutTransformOp: the channels of X are
+/// split into blocks for a positive block_size, and the blocks merged back
+/// into the given number of channels otherwise.
+LogicalResult ONNXLayoutTransformOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  // Cannot infer shape if no shape exists.
+  if (!X().getType().isa<RankedTensorType>())
+    return emitError("Input tensor not ranked");
+
+  auto xType = X().getType().cast<RankedTensorType>();
+  auto xShape = xType.getShape();
+  int64_t blockSize = block_size();
+  SmallVector<int64_t, 6> yShape;
+  if (blockSize > 0) {
+    if (xShape.size() < 2)
+      return emitError("The plain input must have a rank of at least 2");
+    int64_t numChannels = xShape[1];
+    yShape.append(xShape.begin(), xShape.end());
+    yShape[1] = (numChannels == -1) ? -1
+                                    : (numChannels + blockSize - 1) / blockSize;
+    yShape.emplace_back(blockSize);
+  } else {
+    if (xShape.size() < 3)
+      return emitError("The blocked input must have a rank of at least 3");
+    if (!channels().hasValue())
+      return emitError("The number of channels of the plain output is needed");
+    int64_t numChannels = channels().getValue();
+    int64_t inputBlockSize = xShape.back();
+    if (xShape[1] != -1 && inputBlockSize != -1 &&
+        (numChannels > xShape[1] * inputBlockSize ||
+            numChannels <= (xShape[1] - 1) * inputBlockSize))
+      return emitError("The channels do not fit the blocks of the input");
+    yShape.append(xShape.begin(), xShape.end() - 1);
+    yShape[1] = numChannels;
+  }
+  getResult().setType(RankedTensorType::get(yShape, xType.getElementType()));
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// ConvNCHWcOp
+//===----------------------------------------------------------------------===//
+/// Infer the output shape of the ONNXConvNCHWcOp, the blocked shape of the
+/// output of the same Conv on the plain input.
+LogicalResult ONNXConvNCHWcOp::inferShapes(
+    std::function<void(mlir::Region &)> doShapeInference) {
+  // Cannot infer shape if no shape exists.
+  if (!X().getType().isa<RankedTensorType>() ||
+      !W().getType().isa<RankedTensorType>())
+    return emitError("Input tensor not ranked");
+
+  auto xType = X().getType().cast<RankedTensorType>();
+  auto xShape = xType.getShape();
+  auto wShape = W().getType().cast<RankedTensorType>().getShape();
+  int64_t blockSize = block_size();
+  int64_t spatialRank = wShape.size() - 2;
+  if (blockSize <= 0)
+    return emitError("The block size must be positive");
+  if (spatialRank < 1 || (int64_t)xShape.size() != spatialRank + 3)
+    return emitError("The blocked input must have a rank of the rank of the "
+                     "weights plus 1");
+  if (xShape.back() != blockSize)
+    return emitError("The blocks of the input must have the block size");
+  if (xShape[1] != -1 && wShape[1] != -1 &&
+      xShape[1] != (wShape[1] + blockSize - 1) / blockSize)
+    return emitOpError("Channel dimension mismatch");
+  if ((int64_t)pads().size() != 2 * spatialRank ||
+      (int64_t)strides().size() != spatialRank ||
+      (int64_t)dilations().size() != spatialRank)
+    return emitError("The pads, strides and dilations must be explicit");
+
+  SmallVector<int64_t, 6> yShape = {xShape[0],
+      (wShape[0] == -1) ? -1 : (wShape[0] + blockSize - 1) / blockSize};
+  for (int64_t i = 0; i < spatialRank; ++i) {
+    int64_t inputDim = xShape[2 + i], kernelDim = wShape[2 + i];
+    if (inputDim == -1 || kernelDim == -1) {
+      yShape.emplace_back(-1);
+      continue;
+    }
+    int64_t dilation = ArrayAttrIntVal(dilations(), i);
+    int64_t stride = ArrayAttrIntVal(strides(), i);
+    int64_t padded = inputDim + ArrayAttrIntVal(pads(), i) +
+                     ArrayAttrIntVal(pads(), spatialRank + i);
+    yShape.emplace_back((padded - (kernelDim - 1) * dilation - 1) / stride + 1);
+  }
+  yShape.emplace_back(blockSize);
+  getResult().setType(RankedTensorType::get(yShape, xType.getElementType()));
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // ONNX type related code
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,166 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ ONNXOpsCostModel.cpp - ONNX Operations Cost -------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file provides the number of floating point operations of the ONNX
+// operations implementing the CostModelOpInterface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Get the size of a dimension of a ranked tensor, -1 if it is not known.
+int64_t getDimOrUnknown(Value value, int64_t index) {
+  auto type = value.getType().dyn_cast<RankedTensorType>();
+  if (!type || index < 0 || index >= type.getRank() ||
+      type.isDynamicDim(index))
+    return -1;
+  return type.getDimSize(index);
+}
+
+/// Get the cost of an operation performing one floating point operation per
+/// element of its first result and per operand after the first one.
+int64_t getElementwiseFlops(Operation *op) {
+  int64_t numElements = getNumElementsOrUnknown(op->getResult(0));
+  if (numElements < 0)
+    return -1;
+  return numElements * std::max<int64_t>(op->getNumOperands() - 1, 1);
+}
+
+/// Get the cost of a pooling operation, one floating point operation per
+/// element of its window for each element of its result.
+int64_t getPoolFlops(Value output, Optional<ArrayAttr> kernelShape) {
+  int64_t flops = getNumElementsOrUnknown(output);
+  if (flops < 0 || !kernelShape.hasValue())
+    return -1;
+  for (Attribute dim : kernelShape.getValue())
+    flops *= dim.cast<IntegerAttr>().getInt();
+  return flops;
+}
+
+/// Get the cost of a Gemm, with 2 floating point operations per product and
+/// one more per element of the result when C is added.
+int64_t getGemmFlops(Value A, Value C, Value Y, bool transA) {
+  int64_t K = getDimOrUnknown(A, transA ? 0 : 1);
+  int64_t numElements = getNumElementsOrUnknown(Y);
+  if (K < 0 || numElements < 0)
+    return -1;
+  int64_t flops = 2 * numElements * K;
+  if (!C.getType().isa<NoneType>())
+    flops += numElements;
+  return flops;
+}
+
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// Elementwise operations.
+//===----------------------------------------------------------------------===//
+
+int64_t ONNXAbsOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXAddOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXDivOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXErfOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXExpOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXLeakyReluOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXLogOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXMaxOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXMinOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXMulOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXNegOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXPowOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXReluOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXSigmoidOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXSqrtOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXSubOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXSumOp::getFlops() { return getElementwiseFlops(*this); }
+int64_t ONNXTanhOp::getFlops() { return getElementwiseFlops(*this); }
+
+/// Scale and shift of each element, with the scale and the shift folded from
+/// the mean, variance, epsilon and the scale and bias of the channels.
+int64_t ONNXBatchNormalizationTestModeOp::getFlops() {
+  int64_t numElements = getNumElementsOrUnknown(o_Y());
+  return numElements < 0 ? -1 : 2 * numElements;
+}
+
+/// Maximum, subtraction, exponential and division of each element.
+int64_t ONNXSoftmaxOp::getFlops() {
+  int64_t numElements = getNumElementsOrUnknown(output());
+  return numElements < 0 ? -1 : 4 * numElements;
+}
+
+//===----------------------------------------------------------------------===//
+// Reductions and pooling.
+//===----------------------------------------------------------------------===//
+
+int64_t ONNXReduceMeanOp::getFlops() {
+  return getNumElementsOrUnknown(data());
+}
+
+int64_t ONNXReduceSumOp::getFlops() { return getNumElementsOrUnknown(data()); }
+
+int64_t ONNXGlobalAveragePoolOp::getFlops() {
+  return getNumElementsOrUnknown(X());
+}
+
+int64_t ONNXAveragePoolOp::getFlops() {
+  return getPoolFlops(Y(), kernel_shape());
+}
+
+int64_t ONNXMaxPoolSingleOutOp::getFlops() {
+  return getPoolFlops(o_Y(), kernel_shape());
+}
+
+//===----------------------------------------------------------------------===//
+// Data movement, without floating point operations.
+//===----------------------------------------------------------------------===//
+
+int64_t ONNXConcatOp::getFlops() { return 0; }
+int64_t ONNXTransposeOp::getFlops() { return 0; }
+
+//===----------------------------------------------------------------------===//
+// Matrix multiplications and convolutions.
+//===----------------------------------------------------------------------===//
+
+int64_t ONNXMatMulOp::getFlops() {
+  auto aType = A().getType().dyn_cast<RankedTensorType>();
+  if (!aType)
+    return -1;
+  int64_t K = getDimOrUnknown(A(), aType.getRank() - 1);
+  int64_t numElements = getNumElementsOrUnknown(Y());
+  if (K < 0 || numElements < 0)
+    return -1;
+  return 2 * numElements * K;
+}
+
+int64_t ONNXGemmOp::getFlops() { return getGemmFlops(A(), C(), Y(), transA()); }
+
+int64_t ONNXFusedGemmOp::getFlops() {
+  return getGemmFlops(A(), C(), Y(), transA());
+}
+
+/// Each element of the result is the sum of the products of the elements of
+/// a window of C/group channels, plus the bias.
+int64_t ONNXConvOp::getFlops() {
+  auto wType = W().getType().dyn_cast<RankedTensorType>();
+  int64_t numElements = getNumElementsOrUnknown(Y());
+  if (!wType || !wType.hasStaticShape() || numElements < 0)
+    return -1;
+  int64_t window = 1;
+  for (int64_t i = 1; i < wType.getRank(); ++i)
+    window *= wType.getDimSize(i);
+  int64_t flops = 2 * numElements * window;
+  if (!B().getType().isa<NoneType>())
+    flops += numElements;
+  return flops;
+}
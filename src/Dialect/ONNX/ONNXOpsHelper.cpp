@@ -12,6 +12,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+
 #include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
 #include "src/Dialect/ONNX/IndexExpr.hpp"
 #include "src/Dialect/ONNX/ONNXOps.hpp"
@@ -171,7 +173,7 @@ int64_t ArrayAttrIntVal(Optional<ArrayAttr> a, int i) {
 DenseElementsAttr getDenseElementAttributeFromONNXValue(Value value) {
   auto definingOp = value.getDefiningOp();
   if (auto constantOp = dyn_cast_or_null<mlir::ONNXConstantOp>(definingOp)) {
-    return constantOp.valueAttr().dyn_cast<DenseElementsAttr>();
+    return constantOp.valueAttr().dyn_cast_or_null<DenseElementsAttr>();
   }
   return nullptr;
 }
@@ -197,6 +199,28 @@ bool isFromNone(Value v) {
   return false;
 }
 
+// Check that two executions of the operation compute the same results. The
+// random generators, and the Dropout that may be random, do not. The
+// operations with regions are not considered.
+bool isDeterministicONNXOp(Operation *op) {
+  Dialect *dialect = op->getDialect();
+  if (!dialect ||
+      dialect->getNamespace() != ONNXOpsDialect::getDialectNamespace() ||
+      op->getNumRegions() != 0 || op->getNumResults() == 0 ||
+      !MemoryEffectOpInterface::hasNoEffect(op))
+    return false;
+  return !isa<ONNXRandomNormalOp, ONNXRandomNormalLikeOp, ONNXRandomUniformOp,
+      ONNXRandomUniformLikeOp, ONNXMultinomialOp, ONNXDropoutOp>(op);
+}
+
+SmallVector<NamedAttribute, 4> getSemanticAttrs(Operation *op) {
+  SmallVector<NamedAttribute, 4> attrs;
+  for (NamedAttribute attr : op->getAttrs())
+    if (attr.first != "onnx_node_name")
+      attrs.emplace_back(attr);
+  return attrs;
+}
+
 //===----------------------------------------------------------------------===//
 // Get a broadcasted type for RankedTensorType and MemRefType.
 //===----------------------------------------------------------------------===//
@@ -440,3 +464,33 @@ bool isDenseONNXConstant(Value result) {
 
   return true;
 }
+
+bool hasExternalData(Operation *op) {
+  return op->getAttrOfType<StringAttr>(EXTERNAL_DATA_LOCATION_ATTR) &&
+         op->getAttrOfType<IntegerAttr>(EXTERNAL_DATA_OFFSET_ATTR);
+}
+
+void copyExternalData(Operation *from, Operation *to) {
+  if (!hasExternalData(from))
+    return;
+  to->setAttr(EXTERNAL_DATA_LOCATION_ATTR,
+      from->getAttrOfType<StringAttr>(EXTERNAL_DATA_LOCATION_ATTR));
+  to->setAttr(EXTERNAL_DATA_OFFSET_ATTR,
+      from->getAttrOfType<IntegerAttr>(EXTERNAL_DATA_OFFSET_ATTR));
+}
+
+std::unique_ptr<llvm::MemoryBuffer> loadExternalData(
+    Operation *op, uint64_t sizeInBytes) {
+  assert(hasExternalData(op) && "Operation without external data");
+  StringRef location =
+      op->getAttrOfType<StringAttr>(EXTERNAL_DATA_LOCATION_ATTR).getValue();
+  uint64_t offset =
+      op->getAttrOfType<IntegerAttr>(EXTERNAL_DATA_OFFSET_ATTR).getInt();
+  auto buffer = llvm::MemoryBuffer::getFileSlice(location, sizeInBytes, offset);
+  if (std::error_code error = buffer.getError()) {
+    op->emitError("cannot read the external data in ")
+        << location << ": " << error.message();
+    return nullptr;
+  }
+  return std::move(*buffer);
+}
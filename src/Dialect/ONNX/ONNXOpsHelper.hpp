@@ -19,6 +19,7 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Value.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include "src/Dialect/ONNX/IndexExpr.hpp"
 #include "src/Dialect/ONNX/ONNXOps.hpp"
@@ -105,6 +106,13 @@ mlir::ONNXConstantOp getONNXConstantOp(mlir::Value value);
 mlir::Value getONNXConstantOpFromDenseAttr(
     mlir::PatternRewriter &rewriter, mlir::Location loc, mlir::Attribute dense);
 bool isFromNone(mlir::Value value);
+/// Test if the operation is an ONNX operation without region nor side effect
+/// computing the same results at each execution.
+bool isDeterministicONNXOp(mlir::Operation *op);
+/// Return the attributes of the operation that define its results, all but
+/// the name of the node it was imported from.
+llvm::SmallVector<mlir::NamedAttribute, 4> getSemanticAttrs(
+    mlir::Operation *op);
 mlir::Type getBroadcastedRankedType(mlir::Type type1, mlir::Type type2);
 
 //===----------------------------------------------------------------------===//
@@ -169,3 +177,22 @@ mlir::DenseElementsAttr createDenseElementsAttrFromSize(
 
 // Check whether a value is produced by a dense ONNXConstantOp.
 bool isDenseONNXConstant(mlir::Value result);
+
+// Names of the attributes of a constant, ONNXConstantOp or KrnlGlobalOp, whose
+// data is not held in a dense attribute but in a slice of an external data
+// file, given by its path and offset in bytes. The data is only read when the
+// constant is emitted, so that the memory of the compiler does not grow with
+// the size of the weights.
+const llvm::StringRef EXTERNAL_DATA_LOCATION_ATTR = "external_data_location";
+const llvm::StringRef EXTERNAL_DATA_OFFSET_ATTR = "external_data_offset";
+
+// Check whether a constant operation references external data.
+bool hasExternalData(mlir::Operation *op);
+
+// Copy the external data references of a constant operation to another one.
+void copyExternalData(mlir::Operation *from, mlir::Operation *to);
+
+// Map the external data, of the given size in bytes, of a constant operation.
+// Return null, after emitting an error, if it cannot be read.
+std::unique_ptr<llvm::MemoryBuffer> loadExternalData(
+    mlir::Operation *op, uint64_t sizeInBytes);
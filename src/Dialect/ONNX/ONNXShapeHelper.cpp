@@ -55,41 +55,47 @@ ONNXOpShapeHelper<OP>::ONNXOpShapeHelper(OP *newOp,
 }
 
 //===----------------------------------------------------------------------===//
-// ONNX Op Shape Helper for ArgMax
+// ONNX Op Shape Helper for ArgMax and ArgMin
 //===----------------------------------------------------------------------===//
-ONNXArgMaxOpShapeHelper::ONNXArgMaxOpShapeHelper(ONNXArgMaxOp *newOp)
-    : ONNXOpShapeHelper<ONNXArgMaxOp>(newOp) {}
 
-ONNXArgMaxOpShapeHelper::ONNXArgMaxOpShapeHelper(ONNXArgMaxOp *newOp,
+template <typename OP, typename OP_ADAPTOR>
+ONNXGenericArgMinMaxOpShapeHelper<OP,
+    OP_ADAPTOR>::ONNXGenericArgMinMaxOpShapeHelper(OP *newOp)
+    : ONNXOpShapeHelper<OP>(newOp) {}
+
+template <typename OP, typename OP_ADAPTOR>
+ONNXGenericArgMinMaxOpShapeHelper<OP,
+    OP_ADAPTOR>::ONNXGenericArgMinMaxOpShapeHelper(OP *newOp,
     ConversionPatternRewriter &rewriter,
     ArrayValueIndexCapture::GetDenseVal fGetDenseVal,
     ArrayValueIndexCapture::LoadVal fLoadVal)
-    : ONNXOpShapeHelper<ONNXArgMaxOp>(newOp, rewriter, fGetDenseVal, fLoadVal) {
-}
+    : ONNXOpShapeHelper<OP>(newOp, rewriter, fGetDenseVal, fLoadVal) {}
 
-LogicalResult ONNXArgMaxOpShapeHelper::Compute(
-    ONNXArgMaxOpAdaptor operandAdaptor) {
+template <typename OP, typename OP_ADAPTOR>
+LogicalResult ONNXGenericArgMinMaxOpShapeHelper<OP, OP_ADAPTOR>::Compute(
+    OP_ADAPTOR operandAdaptor) {
   // Get info about input data operand.
   Value data = operandAdaptor.data();
   int64_t dataRank = data.getType().cast<ShapedType>().getRank();
 
   // axis is a required attribute and should have default value of 0.
-  int64_t axisValue = op->axis();
+  int64_t axisValue = this->op->axis();
 
   // Accepted axis range is [-r, r-1] where r = rank(data).
   if (axisValue < -1 * (int64_t)dataRank || axisValue >= (int64_t)dataRank) {
-    return op->emitError("ArgMax axis value out of bound");
+    return this->op->emitError("axis value out of bound");
   }
 
   if (axisValue < 0) {
     axisValue = dataRank + axisValue;
-    auto builder = mlir::Builder(op->getContext());
-    op->axisAttr(IntegerAttr::get(builder.getIntegerType(64, /*isSigned=*/true),
-        APInt(64, /*value=*/axisValue, /*isSigned=*/true)));
+    auto builder = mlir::Builder(this->op->getContext());
+    this->op->axisAttr(
+        IntegerAttr::get(builder.getIntegerType(64, /*isSigned=*/true),
+            APInt(64, /*value=*/axisValue, /*isSigned=*/true)));
   }
 
   // keepdims is a required attribute and should have default value of 1.
-  int64_t keepdims = op->keepdims();
+  int64_t keepdims = this->op->keepdims();
   bool isKeepdims = (keepdims == 1) ? true : false;
 
   // Compute outputDims
@@ -114,11 +120,16 @@ LogicalResult ONNXArgMaxOpShapeHelper::Compute(
   }
 
   // Save the final result.
-  dimsForOutput(0) = outputDims;
+  this->dimsForOutput(0) = outputDims;
 
   return success();
 }
 
+template struct ONNXGenericArgMinMaxOpShapeHelper<ONNXArgMaxOp,
+    ONNXArgMaxOpAdaptor>;
+template struct ONNXGenericArgMinMaxOpShapeHelper<ONNXArgMinOp,
+    ONNXArgMinOpAdaptor>;
+
 //===----------------------------------------------------------------------===//
 // ONNX Op Shape Helper for Broadcasting
 //===----------------------------------------------------------------------===//
@@ -432,18 +443,23 @@ LogicalResult ONNXTileOpShapeHelper::Compute(ONNXTileOpAdaptor operandAdaptor) {
 // ONNX Gemm Op Shape Helper
 //===----------------------------------------------------------------------===//
 
-ONNXGemmOpShapeHelper::ONNXGemmOpShapeHelper(ONNXGemmOp *newOp)
-    : ONNXOpShapeHelper<ONNXGemmOp>(newOp), aDims(), bDims(), cDims(),
-      hasBias(false), cRank(-1) {}
+template <typename OP, typename OP_ADAPTOR>
+ONNXGenericGemmOpShapeHelper<OP, OP_ADAPTOR>::ONNXGenericGemmOpShapeHelper(
+    OP *newOp)
+    : ONNXOpShapeHelper<OP>(newOp), aDims(), bDims(), cDims(), hasBias(false),
+      cRank(-1) {}
 
-ONNXGemmOpShapeHelper::ONNXGemmOpShapeHelper(ONNXGemmOp *newOp,
-    ConversionPatternRewriter &rewriter,
+template <typename OP, typename OP_ADAPTOR>
+ONNXGenericGemmOpShapeHelper<OP, OP_ADAPTOR>::ONNXGenericGemmOpShapeHelper(
+    OP *newOp, ConversionPatternRewriter &rewriter,
     ArrayValueIndexCapture::GetDenseVal fGetDenseVal,
     ArrayValueIndexCapture::LoadVal fLoadVal)
-    : ONNXOpShapeHelper<ONNXGemmOp>(newOp, rewriter, fGetDenseVal, fLoadVal),
-      aDims(), bDims(), cDims(), hasBias(false), cRank(-1) {}
+    : ONNXOpShapeHelper<OP>(newOp, rewriter, fGetDenseVal, fLoadVal), aDims(),
+      bDims(), cDims(), hasBias(false), cRank(-1) {}
 
-LogicalResult ONNXGemmOpShapeHelper::Compute(ONNXGemmOpAdaptor operandAdaptor) {
+template <typename OP, typename OP_ADAPTOR>
+LogicalResult ONNXGenericGemmOpShapeHelper<OP, OP_ADAPTOR>::Compute(
+    OP_ADAPTOR operandAdaptor) {
   // Shape inference indicated by passing a null rewriter pointer.
   // Output dims of result.
   DimsExpr outputDims;
@@ -456,25 +472,25 @@ LogicalResult ONNXGemmOpShapeHelper::Compute(ONNXGemmOpAdaptor operandAdaptor) {
 
   // Test ranks.
   if (A.getType().cast<ShapedType>().getShape().size() != 2)
-    return op->emitError("Gemm with A should be a 2D tensor");
+    return this->op->emitError("Gemm with A should be a 2D tensor");
   if (B.getType().cast<ShapedType>().getShape().size() != 2)
-    return op->emitError("Gemm with B should be a 2D tensor");
+    return this->op->emitError("Gemm with B should be a 2D tensor");
   cRank = 0;
   if (hasBias) {
     cRank = C.getType().cast<ShapedType>().getShape().size();
     if (cRank > 2)
-      return op->emitError("Gemm with C should be a 1D or 2D tensor");
+      return this->op->emitError("Gemm with C should be a 1D or 2D tensor");
   }
   // Scan dimensions of A with/without transpose.
   MemRefBoundsIndexCapture ABounds(A);
-  if (op->transA() == 0) {
+  if (this->op->transA() == 0) {
     aDims = {ABounds.getDim(0), ABounds.getDim(1)};
   } else {
     aDims = {ABounds.getDim(1), ABounds.getDim(0)};
   }
   // Scan dimensions of B with/without transpose.
   MemRefBoundsIndexCapture BBounds(B);
-  if (op->transB() == 0) {
+  if (this->op->transB() == 0) {
     bDims = {BBounds.getDim(0), BBounds.getDim(1)};
   } else {
     bDims = {BBounds.getDim(1), BBounds.getDim(0)};
@@ -498,7 +514,8 @@ LogicalResult ONNXGemmOpShapeHelper::Compute(ONNXGemmOpAdaptor operandAdaptor) {
   // Check static dimensions, if we can.
   if (aDims[1].isLiteral() && bDims[0].isLiteral() &&
       aDims[1].getLiteral() != bDims[0].getLiteral()) {
-    return op->emitError("Gemm 2nd dim of A is different than 1st dim of B");
+    return this->op->emitError(
+        "Gemm 2nd dim of A is different than 1st dim of B");
   }
   if (hasBias) {
     // Check first dim.
@@ -507,7 +524,7 @@ LogicalResult ONNXGemmOpShapeHelper::Compute(ONNXGemmOpAdaptor operandAdaptor) {
           cDims[0].getLiteral() == outputDims[0].getLiteral()) {
         // We are fine.
       } else {
-        return op->emitError("bias add has bad dimension on first dim");
+        return this->op->emitError("bias add has bad dimension on first dim");
       }
     }
     // Check second dim.
@@ -516,17 +533,21 @@ LogicalResult ONNXGemmOpShapeHelper::Compute(ONNXGemmOpAdaptor operandAdaptor) {
           cDims[1].getLiteral() == outputDims[1].getLiteral()) {
         // We are fine.
       } else {
-        return op->emitError("bias add has bad dimension on second dim");
+        return this->op->emitError("bias add has bad dimension on second dim");
       }
     }
   }
   // Save the final result.
-  dimsForOutput(0) = outputDims;
+  this->dimsForOutput(0) = outputDims;
 
-  scope.debugPrint("scope from inside gemm compute");
+  this->scope.debugPrint("scope from inside gemm compute");
   return success();
 }
 
+template struct ONNXGenericGemmOpShapeHelper<ONNXGemmOp, ONNXGemmOpAdaptor>;
+template struct ONNXGenericGemmOpShapeHelper<ONNXFusedGemmOp,
+    ONNXFusedGemmOpAdaptor>;
+
 //===----------------------------------------------------------------------===//
 // ONNX MatMul Op Shape Helper
 //===----------------------------------------------------------------------===//
@@ -116,17 +116,23 @@ private:
   bool isUniBroadcasting;
 };
 
-// Shape for ArgMax
-struct ONNXArgMaxOpShapeHelper : public ONNXOpShapeHelper<ONNXArgMaxOp> {
-  ONNXArgMaxOpShapeHelper(ONNXArgMaxOp *newOp);
-  ONNXArgMaxOpShapeHelper(ONNXArgMaxOp *newOp,
+// Shape for ArgMaxOp and ArgMinOp.
+template <typename OP, typename OP_ADAPTOR>
+struct ONNXGenericArgMinMaxOpShapeHelper : public ONNXOpShapeHelper<OP> {
+  ONNXGenericArgMinMaxOpShapeHelper(OP *newOp);
+  ONNXGenericArgMinMaxOpShapeHelper(OP *newOp,
       ConversionPatternRewriter &rewriter,
       ArrayValueIndexCapture::GetDenseVal fGetDenseVal,
       ArrayValueIndexCapture::LoadVal fLoadVal);
 
-  LogicalResult Compute(ONNXArgMaxOpAdaptor operandAdaptor);
+  LogicalResult Compute(OP_ADAPTOR operandAdaptor);
 };
 
+using ONNXArgMaxOpShapeHelper =
+    ONNXGenericArgMinMaxOpShapeHelper<ONNXArgMaxOp, ONNXArgMaxOpAdaptor>;
+using ONNXArgMinOpShapeHelper =
+    ONNXGenericArgMinMaxOpShapeHelper<ONNXArgMinOp, ONNXArgMinOpAdaptor>;
+
 // Shape for concat
 struct ONNXConcatOpShapeHelper : public ONNXOpShapeHelper<ONNXConcatOp> {
   ONNXConcatOpShapeHelper(ONNXConcatOp *newOp);
@@ -164,16 +170,17 @@ struct ONNXTileOpShapeHelper : public ONNXOpShapeHelper<ONNXTileOp> {
   LogicalResult Compute(ONNXTileOpAdaptor operandAdaptor);
 };
 
-// Shape for GemmOp. Rank of C is known, and its rank can be 0, 1, or 2. Each
-// of the dimensions of C can have 1 (broadcast) or many (same size as position
-// requires).
-struct ONNXGemmOpShapeHelper : public ONNXOpShapeHelper<ONNXGemmOp> {
-  ONNXGemmOpShapeHelper(ONNXGemmOp *newOp);
-  ONNXGemmOpShapeHelper(ONNXGemmOp *newOp, ConversionPatternRewriter &rewriter,
+// Shape for GemmOp and FusedGemmOp. Rank of C is known, and its rank can be 0,
+// 1, or 2. Each of the dimensions of C can have 1 (broadcast) or many (same
+// size as position requires).
+template <typename OP, typename OP_ADAPTOR>
+struct ONNXGenericGemmOpShapeHelper : public ONNXOpShapeHelper<OP> {
+  ONNXGenericGemmOpShapeHelper(OP *newOp);
+  ONNXGenericGemmOpShapeHelper(OP *newOp, ConversionPatternRewriter &rewriter,
       ArrayValueIndexCapture::GetDenseVal fGetDenseVal,
       ArrayValueIndexCapture::LoadVal fLoadVal);
 
-  LogicalResult Compute(ONNXGemmOpAdaptor operandAdaptor);
+  LogicalResult Compute(OP_ADAPTOR operandAdaptor);
 
   // Additional data for GemmOp: output = a * b.
   SmallVector<IndexExpr, 4> aDims; // Dim of A, after applying transpose.
@@ -183,6 +190,11 @@ struct ONNXGemmOpShapeHelper : public ONNXOpShapeHelper<ONNXGemmOp> {
   int cRank; // Dim of the original C (not padding dims by 1).
 };
 
+using ONNXGemmOpShapeHelper =
+    ONNXGenericGemmOpShapeHelper<ONNXGemmOp, ONNXGemmOpAdaptor>;
+using ONNXFusedGemmOpShapeHelper =
+    ONNXGenericGemmOpShapeHelper<ONNXFusedGemmOp, ONNXFusedGemmOpAdaptor>;
+
 // Shape for MatMulOp.
 struct ONNXMatMulOpShapeHelper : public ONNXOpShapeHelper<ONNXMatMulOp> {
   ONNXMatMulOpShapeHelper(ONNXMatMulOp *newOp);
@@ -115,6 +115,80 @@ DenseElementsAttr insertZerosForNonPaddedDims(
   return rewriter.getI64TensorAttr(llvm::makeArrayRef(pads));
 }
 
+// Get the values of the constant pads of a Pad, or an empty vector when they
+// are not a constant.
+SmallVector<int64_t, 8> getConstantPads(ONNXPadOp padOp) {
+  SmallVector<int64_t, 8> pads;
+  ONNXConstantOp padsOp = getONNXConstantOp(padOp.pads());
+  if (!padsOp)
+    return pads;
+  auto padsAttr = padsOp.valueAttr().dyn_cast_or_null<DenseElementsAttr>();
+  if (!padsAttr)
+    return pads;
+  for (auto pad : padsAttr.getValues<IntegerAttr>())
+    pads.emplace_back(pad.getInt());
+  return pads;
+}
+
+// Check whether a Pad can be folded into the Conv consuming it: the padding
+// must be a constant zero padding of the spatial dimensions only, and the
+// Conv must not compute its own padding.
+bool isPadFoldableIntoConv(Value pad, Attribute autoPad) {
+  ONNXPadOp padOp = pad.getDefiningOp<ONNXPadOp>();
+  if (!padOp || padOp.mode() != "constant")
+    return false;
+  if (autoPad && autoPad.cast<StringAttr>().getValue() != "NOTSET")
+    return false;
+
+  // The padding value must be zero, which is also its default.
+  Value constantValue = padOp.constant_value();
+  if (!constantValue.getType().isa<NoneType>()) {
+    ONNXConstantOp valueOp = getONNXConstantOp(constantValue);
+    if (!valueOp)
+      return false;
+    auto valueAttr = valueOp.valueAttr().dyn_cast_or_null<DenseElementsAttr>();
+    if (!valueAttr || !valueAttr.getType().getElementType().isa<FloatType>())
+      return false;
+    if (llvm::any_of(valueAttr.getValues<APFloat>(),
+            [](APFloat value) { return !value.isZero(); }))
+      return false;
+  }
+
+  // Neither the batch nor the channel dimensions may be padded, and negative
+  // pads, which crop the input, cannot be expressed by the Conv.
+  SmallVector<int64_t, 8> pads = getConstantPads(padOp);
+  int64_t rank = pads.size() / 2;
+  if (rank < 3)
+    return false;
+  if (pads[0] != 0 || pads[1] != 0 || pads[rank] != 0 || pads[rank + 1] != 0)
+    return false;
+  return llvm::all_of(pads, [](int64_t pad) { return pad >= 0; });
+}
+
+// Add the pads of the spatial dimensions of a Pad to the pads of a Conv.
+//
+// Pad pads = [0, 0, B1, ... Bk, 0, 0, E1, ..., Ek]
+// Conv pads = [b1, ... bk, e1, ..., ek]
+//
+// becomes:
+//
+// pads = [B1 + b1, ... Bk + bk, E1 + e1, ..., Ek + ek]
+ArrayAttr addPadToConvPads(
+    PatternRewriter &rewriter, Value pad, ArrayAttr convPads) {
+  SmallVector<int64_t, 8> pads =
+      getConstantPads(pad.getDefiningOp<ONNXPadOp>());
+  int64_t rank = pads.size() / 2;
+  int64_t nSpatialDims = rank - 2;
+  SmallVector<int64_t, 8> newPads;
+  for (int64_t i = 0; i < 2 * nSpatialDims; ++i) {
+    int64_t padIndex = (i < nSpatialDims) ? i + 2 : i + 4;
+    int64_t convPad =
+        convPads ? convPads.getValue()[i].cast<IntegerAttr>().getInt() : 0;
+    newPads.emplace_back(pads[padIndex] + convPad);
+  }
+  return rewriter.getI64ArrayAttr(newPads);
+}
+
 /// Include the patterns defined in the Declarative Rewrite framework.
 #include "src/Dialect/ONNX/ONNXRewrite.inc"
 
@@ -126,6 +200,12 @@ void ONNXBatchNormalizationTestModeOp::getCanonicalizationPatterns(
   results.insert<FuseBatchNormTestModeConvPattern>(context);
 }
 
+/// on the ONNXConvOp.
+void ONNXConvOp::getCanonicalizationPatterns(
+    RewritePatternSet &results, MLIRContext *context) {
+  results.insert<FoldPadIntoConvPattern>(context);
+}
+
 /// on the ONNXShapeOp.
 void ONNXShapeOp::getCanonicalizationPatterns(
     RewritePatternSet &results, MLIRContext *context) {
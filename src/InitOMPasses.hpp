@@ -23,17 +23,105 @@ void initOMPasses() {
         return mlir::createShapeInferencePass();
       });
 
+  mlir::registerPass("specialize-shapes",
+      "Clone the entry point functions for some input shapes.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createSpecializeShapesPass();
+      });
+
   mlir::registerPass("constprop-onnx",
       "ConstProp ONNX operations into composition of other ONNX operations.",
       []() -> std::unique_ptr<mlir::Pass> {
         return mlir::createConstPropONNXToONNXPass();
       });
 
+  mlir::registerPass("inference-cleanup-onnx",
+      "Remove the Dropout and Identity operations and the unused optional "
+      "results that only matter for training.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createInferenceCleanupONNXPass();
+      });
+
+  mlir::registerPass("unroll-loop-onnx",
+      "Fully unroll the ONNX Loops of a small constant trip count that "
+      "cannot terminate early.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createUnrollLoopONNXPass();
+      });
+
+  mlir::registerPass("cse-onnx",
+      "Eliminate the common subexpressions of ONNX operations, ignoring the "
+      "names of their nodes.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createCSEONNXToONNXPass();
+      });
+
+  mlir::registerPass("loop-invariant-motion-onnx",
+      "Move the operations of the ONNX Loop and Scan bodies that only depend "
+      "on the enclosing scope before the loops.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createLoopInvariantMotionONNXPass();
+      });
+
+  mlir::registerPass("layout-propagation-onnx",
+      "Push Transpose operations through elementwise and pooling operations, "
+      "cancel inverse pairs and fold them into Gemm operands.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createLayoutPropagationONNXToONNXPass();
+      });
+
+  mlir::registerPass("inline-functions-onnx",
+      "Inline the calls of the small functions of the models, e.g. of their "
+      "model-local functions.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createInlineFunctionsONNXPass();
+      });
+
+  mlir::registerPass("outline-repeated-layers-onnx",
+      "Outline the repeated layers of the models into functions called once "
+      "for each layer.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createOutlineRepeatedLayersONNXPass();
+      });
+
+  mlir::registerPass("assign-layout-onnx",
+      "Compute the Convs with static shapes, and the elementwise and pooling "
+      "operations between them, in the blocked layout NCHW[b]c.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createAssignLayoutONNXPass();
+      });
+
+  mlir::registerPass("propagate-low-precision-onnx",
+      "Compute the elementwise operations between Casts from and to fp16 or "
+      "bf16 in that precision and remove the Casts.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createPropagateLowPrecisionONNXPass();
+      });
+
+  mlir::registerPass("schedule-for-memory-onnx",
+      "Reorder the independent ONNX operations to lower the peak of the "
+      "bytes of the live tensors.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createScheduleForMemoryONNXPass();
+      });
+
   mlir::registerPass("elide-constants", "Elide values of constant operations.",
       []() -> std::unique_ptr<mlir::Pass> {
         return mlir::createElideConstantValuePass();
       });
 
+  mlir::registerPass("print-cost-model",
+      "Print the floating point operations and bytes of the ONNX operations.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createPrintCostModelPass();
+      });
+
+  mlir::registerPass("krnl-stack-allocation",
+      "Allocate the small temporary MemRefs of static shape on the stack.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createKrnlStackAllocationPass();
+      });
+
   mlir::registerPass("enable-memory-pool",
       "Enable a memory pool for allocating internal MemRefs.",
       []() -> std::unique_ptr<mlir::Pass> {
@@ -52,6 +140,66 @@ void initOMPasses() {
         return mlir::createKrnlOptimizeMemoryPoolsPass();
       });
 
+  mlir::registerPass("fuse-elementwise-loops",
+      "Fuse consecutive elementwise Krnl loops.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createKrnlFuseElementwiseLoopsPass();
+      });
+
+  mlir::registerPass("optimize-loop-locality",
+      "Reorder and tile the Krnl loops for the locality of their accesses.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createKrnlOptimizeLoopLocalityPass();
+      });
+
+  mlir::registerPass("strength-reduce-memref-accesses",
+      "Increment the offsets of the accesses of the innermost SCF loops.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createStrengthReduceMemRefAccessesPass();
+      });
+
+  mlir::registerPass("parallelize-independent-loops",
+      "Execute the independent loop nests of a function concurrently.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createParallelizeIndependentLoopsPass();
+      });
+
+  mlir::registerPass("unify-symbolic-dims",
+      "Share the dims of the inputs with the same symbolic name.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createUnifySymbolicDimsPass();
+      });
+
+  mlir::registerPass("dedup-krnl-globals",
+      "Share the names of the identical Krnl globals.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createDeduplicateKrnlGlobalsPass();
+      });
+
+  mlir::registerPass("specialize-input-alignment",
+      "Clone the entry point functions for aligned inputs.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createSpecializeInputAlignmentPass();
+      });
+
+  mlir::registerPass("memory-pool-arena",
+      "Keep the memory pools in memory arenas across calls.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createKrnlMemoryPoolArenaPass();
+      });
+
+  mlir::registerPass("shape-plan-cache",
+      "Cache the shapes computed from the input dims across calls.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createKrnlShapePlanCachePass();
+      });
+
+  mlir::registerPass("trace-memory-pools",
+      "Report the allocations of the memory pools to the runtime profiler.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createKrnlTraceMemoryPoolsPass();
+      });
+
   mlir::registerPass("convert-krnl-to-affine", "Lower Krnl dialect.",
       []() -> std::unique_ptr<mlir::Pass> {
         return mlir::createConvertKrnlToAffinePass();
@@ -69,6 +217,13 @@ void initOMPasses() {
         return mlir::createElideConstGlobalValuePass();
       });
 
+  mlir::registerPass("move-weights-to-file",
+      "Write the large constants to the weights file ahead of the lowering to "
+      "LLVM.",
+      []() -> std::unique_ptr<mlir::Pass> {
+        return mlir::createMoveWeightsToFilePass();
+      });
+
   mlir::registerPass("convert-krnl-to-llvm",
       "Lower the Krnl Affine and Std dialects to LLVM.",
       []() -> std::unique_ptr<mlir::Pass> {
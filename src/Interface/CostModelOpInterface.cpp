@@ -0,0 +1,51 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- CostModelOpInterface.cpp - Definition for CostModel ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementations of the cost model interfaces
+// defined in CostModelOpInterface.td.
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/Interface/CostModelOpInterface.hpp"
+
+namespace mlir {
+
+int64_t getNumElementsOrUnknown(Value value) {
+  auto type = value.getType().dyn_cast<RankedTensorType>();
+  if (!type || !type.hasStaticShape())
+    return -1;
+  return type.getNumElements();
+}
+
+int64_t getTensorBytes(Operation *op) {
+  int64_t bytes = 0;
+  auto addBytes = [&](Value value) {
+    if (value.getType().isa<NoneType>() || bytes < 0)
+      return;
+    int64_t numElements = getNumElementsOrUnknown(value);
+    if (numElements < 0 ||
+        !value.getType().cast<ShapedType>().getElementType().isIntOrFloat()) {
+      bytes = -1;
+      return;
+    }
+    Type elementType = value.getType().cast<ShapedType>().getElementType();
+    bytes += numElements * ((elementType.getIntOrFloatBitWidth() + 7) / 8);
+  };
+  for (Value operand : op->getOperands())
+    addBytes(operand);
+  for (Value result : op->getResults())
+    addBytes(result);
+  return bytes;
+}
+
+/// Include the auto-generated declarations.
+#include "src/Interface/CostModelOpInterface.cpp.inc"
+
+} // end namespace mlir
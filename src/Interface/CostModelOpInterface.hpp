@@ -0,0 +1,35 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- CostModelOpInterface.hpp - Definition for CostModel ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the declarations of the cost model interfaces defined
+// in CostModelOpInterface.td.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/OpDefinition.h"
+
+namespace mlir {
+
+/// Get the number of elements of a ranked tensor of static shape, -1 for the
+/// other values.
+int64_t getNumElementsOrUnknown(Value value);
+
+/// Get the sum of the sizes in bytes of the operands and results of the
+/// operation, -1 if one of their shapes is not known. The operands of type
+/// none are not counted.
+int64_t getTensorBytes(Operation *op);
+
+/// Include the auto-generated declarations.
+#include "src/Interface/CostModelOpInterface.hpp.inc"
+
+} // end namespace mlir
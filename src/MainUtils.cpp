@@ -15,18 +15,50 @@
 #include <cstdio>
 #include <cstdlib>
 #include <fcntl.h>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <vector>
 
+#include "mlir/Conversion/SCFToOpenMP/SCFToOpenMP.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/OpenMP/OpenMPDialect.h"
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/IR/SymbolTable.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassInstrumentation.h"
 #include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
+#include "mlir/Target/LLVMIR/Dialect/OpenMP/OpenMPToLLVMIRTranslation.h"
 #include "mlir/Target/LLVMIR/Export.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include "ExternalUtil.hpp"
 #include "MainUtils.hpp"
@@ -34,6 +66,7 @@
 #ifdef _WIN32
 #include <io.h>
 #else
+#include <sys/resource.h>
 #include <unistd.h>
 #endif
 
@@ -83,6 +116,28 @@ llvm::cl::opt<bool> useOnnxModelTypes("useOnnxModelTypes",
     llvm::cl::desc("use types and shapes from ONNX model"),
     llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
 
+llvm::cl::opt<int> lazyExternalDataMinBytes("lazyExternalDataMinBytes",
+    llvm::cl::desc("only read the external data of initializers of at least "
+                   "this many bytes when emitting them, -1 to import all"),
+    llvm::cl::init(1 << 20), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::list<std::string> pruneOutputs("pruneOutputs",
+    llvm::cl::desc("names of the outputs of the ONNX models that are not "
+                   "returned, the nodes and initializers only computing "
+                   "them not being imported"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> timeImport("timeImport",
+    llvm::cl::desc("report the time spent importing the input model"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<string> profileCompile("profileCompile",
+    llvm::cl::desc("write the wall time and the peak memory of each "
+                   "compilation stage, pass and subprocess to a json file"),
+    llvm::cl::value_desc("file"), llvm::cl::init(""),
+    llvm::cl::cat(OnnxMlirOptions));
+
 llvm::cl::opt<string> mtriple("mtriple", llvm::cl::desc("Target architecture"),
     llvm::cl::value_desc("<llvm target triple>"),
     llvm::cl::cat(OnnxMlirOptions), llvm::cl::ValueRequired);
@@ -91,6 +146,317 @@ llvm::cl::opt<string> mcpu("mcpu", llvm::cl::desc("Target cpu"),
     llvm::cl::value_desc("<llvm cpu value>"), llvm::cl::cat(OnnxMlirOptions),
     llvm::cl::ValueRequired);
 
+llvm::cl::opt<bool> enableParallel("enableParallel",
+    llvm::cl::desc("execute loops marked by krnl.parallel in parallel on the "
+                   "thread pool of the runtime (see OM_NUM_THREADS)"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableInPlace("enableInPlace",
+    llvm::cl::desc("write the results of elementwise ops into the buffers of "
+                   "operands that are dead after the op"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableOptimizedConv("enableOptimizedConv",
+    llvm::cl::desc("lower convolutions with static shapes to specialized "
+                   "kernels: pointwise and depthwise kernels, or matrix "
+                   "multiplies over packed input patches (im2col)"),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableWinogradConv("enableWinogradConv",
+    llvm::cl::desc("lower 3x3 convolutions with unit strides and static "
+                   "shapes with Winograd F(2x2, 3x3)"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> inlineFunctionsMaxOps("inlineFunctionsMaxOps",
+    llvm::cl::desc("inline the calls of the functions of the model of at "
+                   "most this many ops, e.g. of its model-local functions, "
+                   "for the optimizations to see through them (0 to keep "
+                   "the calls)"),
+    llvm::cl::init(64), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> outlineRepeatedLayers("outlineRepeatedLayers",
+    llvm::cl::desc("outline the repeated layers of the model, e.g. the "
+                   "encoder layers of a BERT, into a function called once "
+                   "for each layer when it reduces the size of the code"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> convBlockSize("convBlockSize",
+    llvm::cl::desc("compute the convolutions with static shapes and at least "
+                   "this many input channels, and the elementwise and "
+                   "pooling ops between them, in the blocked layout "
+                   "NCHW[b]c with blocks of this many channels, e.g. 8 for "
+                   "AVX2 or 16 for AVX-512, 0 to disable"),
+    llvm::cl::init(0), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::list<int64_t> matmulTileSizes("matmulTileSizes",
+    llvm::cl::desc("tile sizes of the matrix multiplies of Gemm, MatMul and "
+                   "Conv: the i, j and k cache tiles, then the i and j "
+                   "register tiles (default: derived from mtriple and mcpu)"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<string> matmulTuningDatabase("matmulTuningDatabase",
+    llvm::cl::desc("json file of the tile sizes tuned for the matrix "
+                   "multiplies of some shapes, written by "
+                   "utils/autotune-matmul.py; the other shapes keep "
+                   "matmulTileSizes"),
+    llvm::cl::value_desc("file"), llvm::cl::init(""),
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<string> profileGenerate("profileGenerate",
+    llvm::cl::desc("instrument the model for profile-guided optimization, "
+                   "the runs of the library writing their profile to the "
+                   "given .profraw file (%p expanding to the process id); "
+                   "the library is linked with the profile runtime of clang"),
+    llvm::cl::value_desc("file"), llvm::cl::init(""),
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<string> profileUse("profileUse",
+    llvm::cl::desc("optimize the model with the .profdata file merged by "
+                   "llvm-profdata from the runs of a --profileGenerate "
+                   "library, for the layout of the branches and the "
+                   "inlining"),
+    llvm::cl::value_desc("file"), llvm::cl::init(""),
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::list<std::string> specializeShapes("specializeShapes",
+    llvm::cl::desc("also compile the model for each given list of input "
+                   "shapes, e.g. 1x3x224x224:1x10 for two inputs, with ? for "
+                   "a dim left dynamic; a call runs the first specialization "
+                   "matching its input shapes, or the dynamic model"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> specializeInputAlignment("specializeInputAlignment",
+    llvm::cl::desc("also compile the model assuming that the data of its "
+                   "inputs are aligned to this many bytes, run when they are "
+                   "(see omTensorCreateEmptyAligned), 0 to disable"),
+    llvm::cl::init(0), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> downcastWeightsToBF16("downcastWeightsToBF16",
+    llvm::cl::desc("store the constant fp32 weights of Gemm and MatMul in "
+                   "bf16; the products are still accumulated in fp32"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableMatmulMicroKernels("enableMatmulMicroKernels",
+    llvm::cl::desc("compute the full register tiles of the f32 matrix "
+                   "multiplies of 8 or 16 columns with the tuned microkernels "
+                   "of the runtime (see OMMicroKernel.h)"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+enum class BlasLibraryType { None, OpenBLAS, MKL, DNNL };
+
+llvm::cl::opt<BlasLibraryType> blasLibrary("blasLibrary",
+    llvm::cl::desc("compute the large f32 matrix multiplies of Gemm, MatMul "
+                   "and Conv with the sgemm of a BLAS library linked with "
+                   "the model:"),
+    llvm::cl::values(clEnumValN(BlasLibraryType::None, "none",
+                         "use the generated kernels"),
+        clEnumValN(BlasLibraryType::OpenBLAS, "openblas",
+            "call cblas_sgemm of OpenBLAS"),
+        clEnumValN(BlasLibraryType::MKL, "mkl", "call cblas_sgemm of MKL"),
+        clEnumValN(BlasLibraryType::DNNL, "dnnl", "call dnnl_sgemm of oneDNN")),
+    llvm::cl::init(BlasLibraryType::None), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> blasMinFlops("blasMinFlops",
+    llvm::cl::desc("minimum number of flops (2 * M * N * K) of the matrix "
+                   "multiplies of static shapes computed with blasLibrary"),
+    llvm::cl::init(1 << 28), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> sparseWeightsMinZeros("sparseWeightsMinZeros",
+    llvm::cl::desc("minimum percentage of zeros of the constant B matrices of "
+                   "Gemm and MatMul, e.g. the weights of pruned "
+                   "fully-connected layers, multiplied as compressed sparse "
+                   "row matrices (0 to keep them dense)"),
+    llvm::cl::init(0), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableStoreEpilogues("enableStoreEpilogues",
+    llvm::cl::desc("apply a Relu, LeakyRelu or Clip to the values stored by "
+                   "the op computing its input, when it is the only use of "
+                   "that input"),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> propagateLowPrecision("propagate-low-precision",
+    llvm::cl::desc("compute the elementwise operations between casts from and "
+                   "to fp16 or bf16 in that precision, which rounds their "
+                   "intermediate results"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableMemoryScheduling("enableMemoryScheduling",
+    llvm::cl::desc("reorder the independent ONNX operations to lower the "
+                   "peak of the bytes of their live tensors"),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableLoopLocality("enableLoopLocality",
+    llvm::cl::desc("reorder the loops of the ops other than the matrix "
+                   "multiplies so that their innermost loops walk the largest "
+                   "buffers contiguously, and tile them when their buffers "
+                   "exceed the L1 cache"),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableStrengthReduction("enableStrengthReduction",
+    llvm::cl::desc("carry the offsets of the accesses of the innermost loops "
+                   "as values incremented at each iteration instead of "
+                   "recomputing them from the indices"),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> splitBatch("splitBatch",
+    llvm::cl::desc("let the runtime run the models whose graph is proven "
+                   "batch-separable in chunks of their batch, of the size set "
+                   "by omBatchSetChunkSize or OM_BATCH_CHUNK_SIZE, capping "
+                   "the memory of their intermediate buffers"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> persistentRNNStates("persistentRNNStates",
+    llvm::cl::desc("keep the hidden and cell states of the forward RNN, GRU "
+                   "and LSTM ops without initial states from one call of the "
+                   "model to the next, updating them in place, e.g. for "
+                   "streaming models called on chunks of their inputs"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableInterOpParallel("enableInterOpParallel",
+    llvm::cl::desc("with enableParallel, execute the independent loop nests, "
+                   "e.g. of the branches of the graph, concurrently on the "
+                   "thread pool of the runtime"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> enableRuntimeInlining("enableRuntimeInlining",
+    llvm::cl::desc("link the bitcode of the tensor functions of the runtime "
+                   "into the model, so that the calls of the entry points "
+                   "to them are inlined (default: true, when the runtime "
+                   "bitcode was built)"),
+    llvm::cl::init(true), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> instrument("instrument",
+    llvm::cl::desc("report the execution time and the output sizes of each "
+                   "onnx op to the profiler of the runtime, enabled with "
+                   "omInstrumentSetEnabled or OM_INSTRUMENT"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+enum class MathAccuracyType { Precise, Fast };
+
+llvm::cl::opt<MathAccuracyType> mathAccuracy("mathAccuracy",
+    llvm::cl::desc("accuracy of exp, tanh, erf and sigmoid:"),
+    llvm::cl::values(clEnumValN(MathAccuracyType::Precise, "precise",
+                         "call the math library"),
+        clEnumValN(MathAccuracyType::Fast, "fast",
+            "use vectorizable approximations, within a few ULPs for f32")),
+    llvm::cl::init(MathAccuracyType::Precise), llvm::cl::cat(OnnxMlirOptions));
+
+enum class MemPoolArenaType { None, Shared, Thread };
+
+llvm::cl::opt<MemPoolArenaType> memPoolArena("memPoolArena",
+    llvm::cl::desc("keep the memory pools across inferences:"),
+    llvm::cl::values(clEnumValN(MemPoolArenaType::None, "none",
+                         "allocate the memory pools on every inference"),
+        clEnumValN(MemPoolArenaType::Shared, "shared",
+            "in arenas shared by all the threads of the process"),
+        clEnumValN(MemPoolArenaType::Thread, "thread",
+            "in arenas private to each calling thread")),
+    llvm::cl::init(MemPoolArenaType::None), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> cacheShapePlans("cacheShapePlans",
+    llvm::cl::desc("keep the sizes, offsets and loop bounds computed from the "
+                   "dynamic input dims in a per-thread cache, recomputed only "
+                   "when the input shapes change"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> unrollLoopMaxTripCount("unrollLoopMaxTripCount",
+    llvm::cl::desc("fully unroll the onnx loops of a constant trip count up "
+                   "to this many iterations that cannot terminate early, for "
+                   "shape inference and constant propagation to go through "
+                   "their bodies, 0 to disable"),
+    llvm::cl::init(0), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<int64_t> stackAllocationMaxBytes("stackAllocationMaxBytes",
+    llvm::cl::desc("allocate the temporary buffers of static shape up to this "
+                   "many bytes on the stack instead of the memory pools, 0 to "
+                   "disable"),
+    llvm::cl::init(1024), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> traceMemoryPools("traceMemoryPools",
+    llvm::cl::desc("report the size and the duration of each allocation of "
+                   "the memory pools to the profiler of the runtime, enabled "
+                   "with omInstrumentSetEnabled or OM_INSTRUMENT"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> optimizeForSize("optimizeForSize",
+    llvm::cl::desc("optimize the library for its size rather than its speed, "
+                   "e.g. for memory-constrained targets: the LLVM passes and "
+                   "the code generation run at -Os, the matrix multiplies "
+                   "are not unrolled, the repeated layers are outlined and "
+                   "the small functions are not inlined, and the weights "
+                   "file of --storeWeightsInFile is compressed; the sizes of "
+                   "the library and of its weights are reported"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> memoryReport("memoryReport",
+    llvm::cl::desc("print the sizes of the memory pools, constants and "
+                   "intermediate buffers of each function"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> printCostModel("printCostModel",
+    llvm::cl::desc("print the floating point operations and bytes of each onnx "
+                   "operation, once their shapes are inferred"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> reentrant("reentrant",
+    llvm::cl::desc("generate entry points that can be called concurrently from "
+                   "several threads, keeping the memory pools local to each "
+                   "call or to each calling thread"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> unchecked("unchecked",
+    llvm::cl::desc("trust the inputs to match the signature of the model: the "
+                   "entry points do not check them, and the generated code "
+                   "assumes that their dynamic dims are positive and that "
+                   "their buffers do not overlap"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<unsigned> compileThreads("j",
+    llvm::cl::desc("number of threads compiling the functions of the model "
+                   "(default: all the hardware threads, 1 compiles serially)"),
+    llvm::cl::value_desc("threads"), llvm::cl::init(0),
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<unsigned> objectPartitions("objectPartitions",
+    llvm::cl::desc("number of object files the model is split into by "
+                   "function, compiled concurrently (default: 1)"),
+    llvm::cl::init(1), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::list<std::string> entryPoints("entryPoint",
+    llvm::cl::desc("also compile the ONNX model <file> into the library, as "
+                   "the entry point run_<name>; the constants it shares with "
+                   "the other models are only stored once"),
+    llvm::cl::value_desc("name=file"), llvm::cl::ZeroOrMore,
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> storeWeightsInFile("storeWeightsInFile",
+    llvm::cl::desc("write the large constants of shared libraries to a "
+                   "<name>.weights file mapped by the runtime, instead of "
+                   "compiling them into the library"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> numaWeights("numaWeights",
+    llvm::cl::desc("read the weights file of --storeWeightsInFile from a "
+                   "replica on the NUMA node of each inference, made by the "
+                   "runtime when OM_NUMA is set"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<string> compilationCacheDir("compilationCacheDir",
+    llvm::cl::desc("directory caching the shared libraries, keyed by the "
+                   "input file, the options and the compiler (disabled when "
+                   "empty)"),
+    llvm::cl::value_desc("path"), llvm::cl::init(""),
+    llvm::cl::cat(OnnxMlirOptions));
+
+llvm::cl::opt<bool> reuseCodeForNewWeights("reuseCodeForNewWeights",
+    llvm::cl::desc("with --storeWeightsInFile and --compilationCacheDir, "
+                   "reuse the cached shared library compiled from the same "
+                   "code, e.g. of a model retrained with new weights, and "
+                   "only write its new weights file"),
+    llvm::cl::init(false), llvm::cl::cat(OnnxMlirOptions));
+
 // Make a function that forces preserving all files using the runtime arguments
 // and/or the overridePreserveFiles enum.
 enum class KeepFilesOfType { All, MLIR, Bitcode, Object, None };
@@ -155,32 +521,158 @@ string getRuntimeDir() {
   return llvm::StringRef(instDir).str();
 }
 
-// onnx-mlir currently requires llvm tools llc and opt and they are assumed
-// to be under llvm-project/build/bin. This doesn't work with the case where
-// llvm-project has been installed system wide (typically under /usr/local/...)
-// and its source has been removed.
-//
-// To account for this scenario, we first search for the tools in the same
-// directory where onnx-mlir is run. If they are found, it  means both onnx-mlir
-// and llvm-project have been installed system wide under the same directory,
-// so we get them from that directory (typically /usr/local/bin). Otherwise,
-// at least one of onnx-mlir and llvm-project has not been installed system
-// wide. In this case, getToolPath returns an empty string and we will fallback
-// to llvm-project/build/bin.
-//
-// Note that this will not work if both onnx-mlir and llvm-project have been
-// installed system wide but to different places and their sources have been
-// removed. So we force CMAKE_INSTALL_PREFIX to be the same as that of
-// llvm-project.
-string getToolPath(string tool) {
-  string execDir = llvm::sys::path::parent_path(kExecPath).str();
-  llvm::SmallString<8> toolPath(execDir);
-  llvm::sys::path::append(toolPath, tool);
-  string p = llvm::StringRef(toolPath).str();
-  if (llvm::sys::fs::can_execute(p))
-    return p;
-  else
-    return string();
+//===----------------------------------------------------------------------===//
+// Compilation profile written by --profileCompile.
+//===----------------------------------------------------------------------===//
+
+struct CompileProfile {
+  struct Stage {
+    string name;
+    double seconds;
+    int64_t peakRSS;
+  };
+  struct Subprocess {
+    string program;
+    double seconds;
+    int64_t peakMemory;
+    int exitCode;
+  };
+  struct PassTime {
+    double seconds = 0;
+    int64_t runs = 0;
+  };
+
+  double startTime = -1;
+  std::vector<Stage> stages;
+  std::vector<Subprocess> subprocesses;
+  // The passes nested on the functions run on several threads.
+  std::mutex passesMutex;
+  llvm::MapVector<string, PassTime> passes;
+};
+static CompileProfile compileProfile;
+
+static double getWallTime() {
+  return llvm::TimeRecord::getCurrentTime(/*Start=*/true).getWallTime();
+}
+
+// Peak resident set size of the compiler so far, -1 when unknown.
+static int64_t getPeakRSS() {
+#ifdef _WIN32
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return (int64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Record the wall time of a compilation stage and the peak memory at its end,
+// from its construction to its destruction.
+class ProfiledStage {
+public:
+  ProfiledStage(StringRef name) : name(name.str()) {
+    if (profileCompile.empty())
+      return;
+    start = getWallTime();
+    if (compileProfile.startTime < 0)
+      compileProfile.startTime = start;
+  }
+
+  ~ProfiledStage() {
+    if (!profileCompile.empty())
+      compileProfile.stages.push_back(
+          {name, getWallTime() - start, getPeakRSS()});
+  }
+
+private:
+  string name;
+  double start = 0;
+};
+
+// Accumulate the wall time of each pass, over all the operations it runs on.
+class PassTimeInstrumentation : public PassInstrumentation {
+public:
+  void runBeforePass(Pass *pass, Operation *op) override {
+    getStartTimes().push_back(getWallTime());
+  }
+  void runAfterPass(Pass *pass, Operation *op) override { record(pass); }
+  void runAfterPassFailed(Pass *pass, Operation *op) override {
+    record(pass);
+  }
+
+private:
+  // The passes running on a thread are nested in the pass adaptors.
+  static std::vector<double> &getStartTimes() {
+    static thread_local std::vector<double> startTimes;
+    return startTimes;
+  }
+
+  static void record(Pass *pass) {
+    double seconds = getWallTime() - getStartTimes().back();
+    getStartTimes().pop_back();
+    // The adaptors running the nested pass managers include the time of
+    // their passes.
+    if (pass->getName().contains("OpToOpPassAdaptor"))
+      return;
+    std::lock_guard<std::mutex> lock(compileProfile.passesMutex);
+    CompileProfile::PassTime &time = compileProfile.passes[pass->getName()];
+    time.seconds += seconds;
+    time.runs++;
+  }
+};
+
+static void writeCompileProfile(string outputBaseName, int returnCode) {
+  if (profileCompile.empty())
+    return;
+  error_code error;
+  llvm::raw_fd_ostream os(profileCompile, error, llvm::sys::fs::F_None);
+  if (error) {
+    llvm::errs() << "Failed to open " << profileCompile << ": "
+                 << error.message() << "\n";
+    return;
+  }
+  double totalSeconds = compileProfile.startTime < 0
+                            ? 0
+                            : getWallTime() - compileProfile.startTime;
+  llvm::json::OStream json(os, /*IndentSize=*/2);
+  json.object([&] {
+    json.attribute("output", outputBaseName);
+    json.attribute("return_code", returnCode);
+    json.attribute("wall_seconds", totalSeconds);
+    json.attribute("peak_rss_bytes", getPeakRSS());
+    json.attributeArray("stages", [&] {
+      for (const CompileProfile::Stage &stage : compileProfile.stages)
+        json.object([&] {
+          json.attribute("name", stage.name);
+          json.attribute("wall_seconds", stage.seconds);
+          json.attribute("peak_rss_bytes", stage.peakRSS);
+        });
+    });
+    json.attributeArray("passes", [&] {
+      for (const auto &pass : compileProfile.passes)
+        json.object([&] {
+          json.attribute("name", pass.first);
+          json.attribute("wall_seconds", pass.second.seconds);
+          json.attribute("runs", pass.second.runs);
+        });
+    });
+    json.attributeArray("subprocesses", [&] {
+      for (const CompileProfile::Subprocess &subprocess :
+          compileProfile.subprocesses)
+        json.object([&] {
+          json.attribute("program", subprocess.program);
+          json.attribute("wall_seconds", subprocess.seconds);
+          json.attribute("peak_memory_bytes", subprocess.peakMemory);
+          json.attribute("exit_code", subprocess.exitCode);
+        });
+    });
+  });
+  os << "\n";
 }
 
 // Helper struct to make command construction and execution easy & readable.
@@ -232,9 +724,16 @@ struct Command {
       cout << _path << ": " << llvm::join(argsRef, " ") << "\n";
 
     std::string errMsg;
+    llvm::Optional<llvm::sys::ProcessStatistics> stats;
+    double start = getWallTime();
     int rc = llvm::sys::ExecuteAndWait(_path, llvm::makeArrayRef(argsRef),
         /*Env=*/None, /*Redirects=*/None,
-        /*SecondsToWait=*/0, /*MemoryLimit=*/0, &errMsg);
+        /*SecondsToWait=*/0, /*MemoryLimit=*/0, &errMsg,
+        /*ExecutionFailed=*/nullptr, &stats);
+    if (!profileCompile.empty())
+      compileProfile.subprocesses.push_back({_args.front(),
+          getWallTime() - start,
+          stats ? (int64_t)stats->PeakMemory * 1024 : -1, rc});
 
     if (rc != 0) {
       fprintf(stderr, "%s\n", llvm::join(argsRef, " ").c_str());
@@ -274,65 +773,282 @@ void LoadMLIR(string inputFilename, mlir::MLIRContext &context,
   }
 }
 
-string getTargetCpuOption() {
-  string targetOptions = "";
-  if (mcpu != "")
-    targetOptions += "--mcpu=" + mcpu;
-  return targetOptions;
+// Target of mtriple, the host by default. Returns nullptr when the target is
+// unknown.
+static const llvm::Target *lookupTarget(string &triple) {
+  llvm::InitializeAllTargetInfos();
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  triple = mtriple != "" ? string(mtriple)
+                         : llvm::sys::getDefaultTargetTriple();
+  string error;
+  return llvm::TargetRegistry::lookupTarget(triple, error);
 }
 
-string getTargetTripleOption() {
-  string targetOptions = "";
-  if (mtriple != "")
-    targetOptions = "--mtriple=" + mtriple;
-  // Comand cannot tolerate extra spaces. Add only when needed.
-  return targetOptions;
+static std::unique_ptr<llvm::TargetMachine> createTargetMachine(
+    const llvm::Target &target, string triple,
+    llvm::Optional<llvm::Reloc::Model> relocModel) {
+  return std::unique_ptr<llvm::TargetMachine>(target.createTargetMachine(
+      triple, mcpu, /*Features=*/"", llvm::TargetOptions(), relocModel,
+      /*CM=*/llvm::None,
+      optimizeForSize ? llvm::CodeGenOpt::Default
+                      : llvm::CodeGenOpt::Aggressive));
 }
 
-// Write LLVM optimized bitcode.
-void genLLVMBitcode(const mlir::OwningModuleRef &module,
-    string optimizedBitcodePath, string outputBaseName) {
-  error_code error;
+// Target machine of mtriple and mcpu, the host by default. Returns nullptr
+// when the target is unknown.
+static std::unique_ptr<llvm::TargetMachine> createTargetMachine(
+    llvm::Optional<llvm::Reloc::Model> relocModel) {
+  string triple;
+  const llvm::Target *target = lookupTarget(triple);
+  if (!target)
+    return nullptr;
+  return createTargetMachine(*target, triple, relocModel);
+}
 
-  // Write bitcode to a file.
-  string unoptimizedBitcodePath = outputBaseName + ".unoptimized.bc";
-  llvm::FileRemover unoptimzedBitcodeRemover(
-      unoptimizedBitcodePath, !keepFiles(KeepFilesOfType::Bitcode));
+// Tile sizes of the matrix multiplies, as the i, j and k cache tiles followed
+// by the i and j register tiles. Unless given by the user, they are derived
+// from the vector registers and the data caches of the target, for f32:
+// j is simdized over two vector registers (or one 512-bit register), the
+// kCache x jReg panels of B fill half of L1, and the iCache x kCache tiles of
+// A half of L2. An empty list keeps the defaults of the lowering, e.g. when
+// the target is unknown.
+std::vector<int64_t> getMatMulTileSizes() {
+  if (!matmulTileSizes.empty()) {
+    if (matmulTileSizes.size() != 5) {
+      llvm::errs() << "matmulTileSizes expects 5 tile sizes.\n";
+      exit(1);
+    }
+    return std::vector<int64_t>(matmulTileSizes.begin(), matmulTileSizes.end());
+  }
 
-  llvm::raw_fd_ostream moduleBitcodeStream(
-      unoptimizedBitcodePath, error, llvm::sys::fs::F_None);
+  std::unique_ptr<llvm::TargetMachine> targetMachine =
+      createTargetMachine(llvm::None);
+  if (!targetMachine)
+    return {};
+  string triple = targetMachine->getTargetTriple().str();
 
+  // The cost model is queried for a function of the target.
   llvm::LLVMContext llvmContext;
+  llvm::Module llvmModule("tile_sizes", llvmContext);
+  llvmModule.setTargetTriple(triple);
+  llvm::Function *func = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(llvmContext), false),
+      llvm::GlobalValue::ExternalLinkage, "tile_sizes", llvmModule);
+  llvm::TargetTransformInfo tti = targetMachine->getTargetTransformInfo(*func);
+  llvm::TypeSize vectorSize = tti.getRegisterBitWidth(
+      llvm::TargetTransformInfo::RGK_FixedWidthVector);
+  int64_t vectorBits = vectorSize.getFixedSize();
+  int64_t numVectorRegs =
+      tti.getNumberOfRegisters(tti.getRegisterClassForType(/*Vector=*/true));
+  if (vectorBits < 128)
+    return {};
+  int64_t l1Bytes =
+      tti.getCacheSize(llvm::TargetTransformInfo::CacheLevel::L1D)
+          .getValueOr(32 * 1024);
+  int64_t l2Bytes =
+      tti.getCacheSize(llvm::TargetTransformInfo::CacheLevel::L2D)
+          .getValueOr(256 * 1024);
+
+  const int64_t elementBytes = sizeof(float);
+  int64_t jReg = std::max<int64_t>(8, vectorBits / (8 * elementBytes));
+  // Keep the iReg x jReg accumulators within half of the vector registers.
+  int64_t iReg = numVectorRegs >= 32 ? 8 : 4;
+  int64_t kCache = llvm::PowerOf2Floor(l1Bytes / 2 / (jReg * elementBytes));
+  kCache = std::min<int64_t>(std::max<int64_t>(kCache, 128), 1024);
+  int64_t iCache = llvm::PowerOf2Floor(l2Bytes / 2 / (kCache * elementBytes));
+  iCache = std::min<int64_t>(std::max<int64_t>(iCache, 4 * iReg), 256);
+  int64_t jCache = std::max<int64_t>(128, 8 * jReg);
+  return {iCache, jCache, kCache, iReg, jReg};
+}
+
+// Link the definitions of the runtime functions called by the model from the
+// bitcode of the runtime, for the optimizer to inline them. They stay
+// available externally, the calls that are not inlined going to the runtime
+// library as before.
+static void linkRuntimeBitcode(llvm::Module &llvmModule) {
+  llvm::SmallString<64> bitcodePath(getRuntimeDir());
+  llvm::sys::path::append(bitcodePath, "cruntime.bc");
+  if (!llvm::sys::fs::exists(bitcodePath))
+    return;
+  // A bitcode file written by another version of LLVM, or for another target,
+  // is ignored.
+  llvm::SMDiagnostic diagnostic;
+  std::unique_ptr<llvm::Module> runtimeModule =
+      llvm::parseIRFile(bitcodePath, diagnostic, llvmModule.getContext());
+  if (!runtimeModule ||
+      runtimeModule->getTargetTriple() != llvmModule.getTargetTriple())
+    return;
+  runtimeModule->setDataLayout(llvmModule.getDataLayout());
+
+  llvm::StringSet<> modelDefinitions;
+  for (llvm::GlobalObject &object : llvmModule.global_objects())
+    if (!object.isDeclaration())
+      modelDefinitions.insert(object.getName());
+  if (llvm::Linker::linkModules(llvmModule, std::move(runtimeModule),
+          llvm::Linker::LinkOnlyNeeded))
+    return;
+  for (llvm::GlobalObject &object : llvmModule.global_objects())
+    if (!object.isDeclaration() && object.hasExternalLinkage() &&
+        !modelDefinitions.count(object.getName()))
+      object.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+}
+
+// Run the -O3 pipeline of the target machine on the LLVM module, or the -Os
+// one with optimizeForSize, adding the profile instrumentation of
+// profileGenerate or the profile of profileUse.
+static void optimizeLLVMModule(
+    llvm::Module &llvmModule, llvm::TargetMachine &targetMachine) {
+  const unsigned optLevel = optimizeForSize ? 2 : 3;
+  const unsigned sizeLevel = optimizeForSize ? 1 : 0;
+  // As with clang -Os, the functions are marked optsize for the passes and
+  // the code generation, and the loops are not unrolled.
+  if (optimizeForSize)
+    for (llvm::Function &function : llvmModule)
+      if (!function.isDeclaration())
+        function.addFnAttr(llvm::Attribute::OptimizeForSize);
+  llvm::PassManagerBuilder builder;
+  builder.OptLevel = optLevel;
+  builder.SizeLevel = sizeLevel;
+  builder.DisableUnrollLoops = optimizeForSize;
+  builder.Inliner = llvm::createFunctionInliningPass(
+      optLevel, sizeLevel, /*DisableInlineHotCallSite=*/false);
+  builder.LoopVectorize = true;
+  builder.SLPVectorize = true;
+  if (!profileGenerate.empty()) {
+    builder.EnablePGOInstrGen = true;
+    builder.PGOInstrGen = profileGenerate;
+  }
+  if (!profileUse.empty()) {
+    if (!llvm::sys::fs::exists(profileUse)) {
+      llvm::errs() << "Failed to open " << profileUse << ".\n";
+      exit(1);
+    }
+    builder.PGOInstrUse = profileUse;
+  }
+  targetMachine.adjustPassManager(builder);
+
+  llvm::legacy::PassManager modulePasses;
+  llvm::legacy::FunctionPassManager functionPasses(&llvmModule);
+  modulePasses.add(llvm::createTargetTransformInfoWrapperPass(
+      targetMachine.getTargetIRAnalysis()));
+  functionPasses.add(llvm::createTargetTransformInfoWrapperPass(
+      targetMachine.getTargetIRAnalysis()));
+  builder.populateFunctionPassManager(functionPasses);
+  builder.populateModulePassManager(modulePasses);
+
+  functionPasses.doInitialization();
+  for (llvm::Function &function : llvmModule)
+    functionPasses.run(function);
+  functionPasses.doFinalization();
+  modulePasses.run(llvmModule);
+}
+
+// Translate the module to LLVM IR and optimize it at -O3, or -Os, for the
+// target machine, in memory. The optimized bitcode is only written when it is kept.
+std::unique_ptr<llvm::Module> genOptimizedLLVMModule(
+    const mlir::OwningModuleRef &module, llvm::LLVMContext &llvmContext,
+    llvm::TargetMachine &targetMachine, string bitcodePath) {
   mlir::registerLLVMDialectTranslation(*(module.get().getContext()));
-  auto llvmModule = mlir::translateModuleToLLVMIR(*module, llvmContext);
+  mlir::registerOpenMPDialectTranslation(*(module.get().getContext()));
+  std::unique_ptr<llvm::Module> llvmModule;
+  {
+    ProfiledStage stage("translate");
+    llvmModule = mlir::translateModuleToLLVMIR(*module, llvmContext);
+  }
   if (!llvmModule) {
     llvm::errs() << "Failed to translate module to LLVMIR.\n";
     exit(1);
   }
-  llvm::WriteBitcodeToFile(*llvmModule, moduleBitcodeStream);
-  moduleBitcodeStream.flush();
-
-  // Use the LLVM's 'opt' command to optimize the bitcode.
-  string optPath = getToolPath("opt");
-  Command optBitcode(/*exePath=*/!optPath.empty() ? optPath : kOptPath);
-  optBitcode.appendStr("-O3")
-      .appendStr(getTargetTripleOption())
-      .appendStr(getTargetCpuOption())
-      .appendList({"-o", optimizedBitcodePath})
-      .appendStr(unoptimizedBitcodePath)
-      .exec();
+  llvmModule->setTargetTriple(targetMachine.getTargetTriple().str());
+  llvmModule->setDataLayout(targetMachine.createDataLayout());
+
+  ProfiledStage stage("opt");
+  if (enableRuntimeInlining)
+    linkRuntimeBitcode(*llvmModule);
+  optimizeLLVMModule(*llvmModule, targetMachine);
+
+  if (keepFiles(KeepFilesOfType::Bitcode)) {
+    error_code error;
+    llvm::raw_fd_ostream bitcodeStream(
+        bitcodePath, error, llvm::sys::fs::F_None);
+    if (error) {
+      llvm::errs() << "Failed to open " << bitcodePath << ": "
+                   << error.message() << "\n";
+      exit(1);
+    }
+    llvm::WriteBitcodeToFile(*llvmModule, bitcodeStream);
+  }
+  return llvmModule;
 }
 
-// Compile LLVM bitcode to object file.
-void genModelObject(const mlir::OwningModuleRef &module, string bitcodePath,
-    string modelObjPath) {
-  string llcPath = getToolPath("llc");
-  Command llvmToObj(/*exePath=*/!llcPath.empty() ? llcPath : kLlcPath);
-  llvmToObj.appendStr("-filetype=obj")
-      .appendStr("-relocation-model=pic")
-      .appendList({"-o", modelObjPath})
-      .appendStr(bitcodePath)
-      .exec();
+// Compile the LLVM module to objectPartitions object files. The partitions
+// are compiled concurrently, each one by its own target machine.
+std::vector<string> genModelObjects(llvm::Module &llvmModule,
+    llvm::TargetMachine &targetMachine, string outputBaseName) {
+  ProfiledStage stage("llc");
+  unsigned numPartitions = std::max<unsigned>(objectPartitions, 1);
+  std::vector<string> objPaths;
+  if (numPartitions == 1)
+    objPaths.emplace_back(outputBaseName + ".o");
+  else
+    for (unsigned i = 0; i < numPartitions; ++i)
+      objPaths.emplace_back(
+          outputBaseName + ".part" + std::to_string(i) + ".o");
+
+  std::vector<std::unique_ptr<llvm::raw_fd_ostream>> objStreams;
+  SmallVector<llvm::raw_pwrite_stream *, 4> objStreamPtrs;
+  for (const string &objPath : objPaths) {
+    error_code error;
+    objStreams.emplace_back(std::make_unique<llvm::raw_fd_ostream>(
+        objPath, error, llvm::sys::fs::F_None));
+    if (error) {
+      llvm::errs() << "Failed to open " << objPath << ": " << error.message()
+                   << "\n";
+      exit(1);
+    }
+    objStreamPtrs.emplace_back(objStreams.back().get());
+  }
+
+  if (numPartitions == 1) {
+    llvm::legacy::PassManager codegenPasses;
+    if (targetMachine.addPassesToEmitFile(
+            codegenPasses, *objStreams[0], nullptr, llvm::CGFT_ObjectFile)) {
+      llvm::errs() << "The target cannot emit object files.\n";
+      exit(1);
+    }
+    codegenPasses.run(llvmModule);
+    return objPaths;
+  }
+
+  // The module is split by function, the weight globals being spread over
+  // the partitions that use them.
+  const llvm::Target &target = targetMachine.getTarget();
+  string triple = targetMachine.getTargetTriple().str();
+  llvm::splitCodeGen(llvmModule, objStreamPtrs, /*BCOSs=*/{},
+      [&]() { return createTargetMachine(target, triple, llvm::Reloc::PIC_); },
+      llvm::CGFT_ObjectFile);
+  return objPaths;
+}
+
+// Optimize the module and compile it to object files, in process. Returns the
+// paths of the object files.
+std::vector<string> genModelObjects(
+    const mlir::OwningModuleRef &module, string outputBaseName) {
+  std::unique_ptr<llvm::TargetMachine> targetMachine =
+      createTargetMachine(llvm::Reloc::PIC_);
+  if (!targetMachine) {
+    llvm::errs() << "Unknown target "
+                 << (mtriple != "" ? string(mtriple)
+                                   : llvm::sys::getDefaultTargetTriple())
+                 << ".\n";
+    exit(1);
+  }
+  llvm::LLVMContext llvmContext;
+  std::unique_ptr<llvm::Module> llvmModule = genOptimizedLLVMModule(
+      module, llvmContext, *targetMachine, outputBaseName + ".bc");
+  return genModelObjects(*llvmModule, *targetMachine, outputBaseName);
 }
 
 void genJniObject(const mlir::OwningModuleRef &module, string jniSharedLibPath,
@@ -342,11 +1058,31 @@ void genJniObject(const mlir::OwningModuleRef &module, string jniSharedLibPath,
 }
 
 // Link everything into a shared object.
+// Add the library providing the sgemm called by the model, if any.
+static void addBlasLibrary(std::vector<string> &libs) {
+  switch (blasLibrary) {
+  case BlasLibraryType::None:
+    break;
+  case BlasLibraryType::OpenBLAS:
+    libs.emplace_back("-lopenblas");
+    break;
+  case BlasLibraryType::MKL:
+    libs.emplace_back("-lmkl_rt");
+    break;
+  case BlasLibraryType::DNNL:
+    libs.emplace_back("-ldnnl");
+    break;
+  }
+}
+
 void genSharedLib(const mlir::OwningModuleRef &module,
     string modelSharedLibPath, std::vector<string> opts,
     std::vector<string> objs, std::vector<string> libs) {
 
   string runtimeDirInclFlag = "-L" + getRuntimeDir();
+  // The instrumented model writes its profile with the profile runtime.
+  if (!profileGenerate.empty())
+    opts.emplace_back("-fprofile-instr-generate");
 
   Command link(kCxxPath);
   link.appendList(opts)
@@ -376,33 +1112,189 @@ void genJniJar(const mlir::OwningModuleRef &module, string modelSharedLibPath,
 void compileModuleToSharedLibrary(
     const mlir::OwningModuleRef &module, std::string outputBaseName) {
 
-  string bitcodePath = outputBaseName + ".bc";
-  genLLVMBitcode(module, bitcodePath, outputBaseName);
-  llvm::FileRemover bitcodeRemover(
-      bitcodePath, !keepFiles(KeepFilesOfType::Bitcode));
-
-  string modelObjPath = outputBaseName + ".o";
-  genModelObject(module, bitcodePath, modelObjPath);
-  llvm::FileRemover modelObjRemover(
-      modelObjPath, !keepFiles(KeepFilesOfType::Object));
+  std::vector<string> modelObjPaths = genModelObjects(module, outputBaseName);
+  std::vector<std::unique_ptr<llvm::FileRemover>> modelObjRemovers;
+  for (const string &modelObjPath : modelObjPaths)
+    modelObjRemovers.emplace_back(std::make_unique<llvm::FileRemover>(
+        modelObjPath, !keepFiles(KeepFilesOfType::Object)));
 
   string modelSharedLibPath = outputBaseName + ".so";
-  genSharedLib(module, modelSharedLibPath, {"-shared", "-fPIC"}, {modelObjPath},
-      {"-lcruntime"});
+  std::vector<string> libs = {"-lcruntime"};
+  if (enableParallel)
+    libs.emplace_back("-lpthread");
+  addBlasLibrary(libs);
+  genSharedLib(
+      module, modelSharedLibPath, {"-shared", "-fPIC"}, modelObjPaths, libs);
+}
+
+// Split an additional entry point, given as <name>=<file.onnx>, the name
+// being a C identifier.
+static bool parseEntryPoint(
+    llvm::StringRef entryPoint, string &name, string &path) {
+  auto split = entryPoint.split('=');
+  if (split.first.empty() || split.second.empty() ||
+      !split.second.endswith(".onnx") || isdigit(split.first[0]))
+    return false;
+  for (char c : split.first)
+    if (!isalnum(c) && c != '_')
+      return false;
+  name = split.first.str();
+  path = split.second.str();
+  return true;
+}
+
+// Add a field to the hash of a cache key.
+static void updateCacheKey(llvm::SHA1 &hasher, llvm::StringRef data) {
+  hasher.update(data);
+  // Separate the fields so that they cannot be shifted into each other.
+  hasher.update(llvm::StringRef("\0", 1));
+}
+
+// Add the compiler, the target and the options to the hash of a cache key.
+// Returns false if the compiler cannot be identified.
+static bool updateCacheKeyWithOptions(
+    llvm::SHA1 &hasher, const std::vector<string> &options) {
+  // The compiler is identified by the size and the time of its executable,
+  // which change with every build.
+  llvm::sys::fs::file_status execStatus;
+  if (llvm::sys::fs::status(kExecPath, execStatus))
+    return false;
+  updateCacheKey(hasher, std::to_string(execStatus.getSize()));
+  updateCacheKey(hasher, std::to_string(llvm::sys::toTimeT(
+                             execStatus.getLastModificationTime())));
+  updateCacheKey(hasher, mtriple);
+  updateCacheKey(hasher, mcpu);
+  for (const string &option : options)
+    updateCacheKey(hasher, option);
+  return true;
+}
+
+string getCompilationCacheKey(
+    string inputFilename, const std::vector<string> &options) {
+  // The compilations that are profiled always run.
+  if (compilationCacheDir.empty() || !profileCompile.empty())
+    return string();
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> fileOrErr =
+      llvm::MemoryBuffer::getFile(inputFilename);
+  if (!fileOrErr)
+    return string();
+
+  llvm::SHA1 hasher;
+  auto update = [&](llvm::StringRef data) { updateCacheKey(hasher, data); };
+  if (!updateCacheKeyWithOptions(hasher, options))
+    return string();
+  update((*fileOrErr)->getBuffer());
+  // The models of the other entry points are part of the input.
+  for (const string &entryPoint : entryPoints) {
+    string name, path;
+    if (!parseEntryPoint(entryPoint, name, path))
+      return string();
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> entryPointOrErr =
+        llvm::MemoryBuffer::getFile(path);
+    if (!entryPointOrErr)
+      return string();
+    update((*entryPointOrErr)->getBuffer());
+  }
+  // So is the tuning database, which changes with each tuning.
+  if (!matmulTuningDatabase.empty()) {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> databaseOrErr =
+        llvm::MemoryBuffer::getFile(matmulTuningDatabase);
+    if (!databaseOrErr)
+      return string();
+    update((*databaseOrErr)->getBuffer());
+  }
+  // And the profile, which changes with each profiled run.
+  if (!profileUse.empty()) {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> profileOrErr =
+        llvm::MemoryBuffer::getFile(profileUse);
+    if (!profileOrErr)
+      return string();
+    update((*profileOrErr)->getBuffer());
+  }
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+static string getCompilationCachePath(string cacheKey, string extension) {
+  llvm::SmallString<64> cachePath(compilationCacheDir);
+  llvm::sys::path::append(cachePath, cacheKey + extension);
+  return llvm::StringRef(cachePath).str();
+}
+
+bool loadFromCompilationCache(
+    string cacheKey, string outputBaseName, bool withWeights) {
+  if (cacheKey.empty())
+    return false;
+  string cachePath = getCompilationCachePath(cacheKey, ".so");
+  if (!llvm::sys::fs::exists(cachePath))
+    return false;
+  // The weights file, if any, is stored before the library.
+  string cacheWeightsPath = getCompilationCachePath(cacheKey, ".weights");
+  if (withWeights && llvm::sys::fs::exists(cacheWeightsPath) &&
+      llvm::sys::fs::copy_file(cacheWeightsPath, outputBaseName + ".weights"))
+    return false;
+  return !llvm::sys::fs::copy_file(cachePath, outputBaseName + ".so");
+}
+
+void storeInCompilationCache(
+    string cacheKey, string outputBaseName, bool withWeights) {
+  if (cacheKey.empty())
+    return;
+  if (llvm::sys::fs::create_directories(compilationCacheDir)) {
+    llvm::errs() << "Could not create the compilation cache "
+                 << compilationCacheDir << ".\n";
+    return;
+  }
+  // Copy to a file of this process first, then rename it, so that processes
+  // sharing the cache never load a partial library.
+  string pid = std::to_string(llvm::sys::Process::getProcessId());
+  auto store = [&](string extension) {
+    string path = getCompilationCachePath(cacheKey, extension);
+    string tempPath = path + "." + pid;
+    if (llvm::sys::fs::copy_file(outputBaseName + extension, tempPath) ||
+        llvm::sys::fs::rename(tempPath, path)) {
+      llvm::sys::fs::remove(tempPath);
+      llvm::errs() << "Could not store " << outputBaseName << extension
+                   << " in the compilation cache.\n";
+      return false;
+    }
+    return true;
+  };
+  // The weights file goes first, so that a cached library always has its
+  // weights.
+  if (withWeights && llvm::sys::fs::exists(outputBaseName + ".weights") &&
+      !store(".weights"))
+    return;
+  store(".so");
+}
+
+// Key of the shared library compiled from the code of the module, lowered
+// until its large constants are written to the weights file, in the
+// compilation cache. The module then holds everything the library is compiled
+// from, as the constants left in it and the offsets of the weights depend on
+// the values of the weights, so that the library compiled for other weights
+// of the same offsets can be reused with the new weights file.
+static string getCompiledCodeCacheKey(
+    mlir::ModuleOp module, const std::vector<string> &options) {
+  llvm::SHA1 hasher;
+  // The code keys never match the keys of the input files.
+  updateCacheKey(hasher, "code");
+  if (!updateCacheKeyWithOptions(hasher, options))
+    return string();
+  std::string code;
+  llvm::raw_string_ostream os(code);
+  module.print(os);
+  updateCacheKey(hasher, os.str());
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
 }
 
 void compileModuleToJniJar(
     const mlir::OwningModuleRef &module, std::string outputBaseName) {
 
-  string bitcodePath = outputBaseName + ".bc";
-  genLLVMBitcode(module, bitcodePath, outputBaseName);
-  llvm::FileRemover bitcodeRemover(
-      bitcodePath, !keepFiles(KeepFilesOfType::Bitcode));
-
-  string modelObjPath = outputBaseName + ".o";
-  genModelObject(module, bitcodePath, modelObjPath);
-  llvm::FileRemover modelObjRemover(
-      modelObjPath, !keepFiles(KeepFilesOfType::Object));
+  std::vector<string> modelObjPaths = genModelObjects(module, outputBaseName);
+  std::vector<std::unique_ptr<llvm::FileRemover>> modelObjRemovers;
+  for (const string &modelObjPath : modelObjPaths)
+    modelObjRemovers.emplace_back(std::make_unique<llvm::FileRemover>(
+        modelObjPath, !keepFiles(KeepFilesOfType::Object)));
 
   string jniSharedLibPath = getRuntimeDir() + "/libjniruntime.a";
   string jniObjPath = "jnidummy.c.o";
@@ -411,9 +1303,14 @@ void compileModuleToJniJar(
       jniObjPath, !keepFiles(KeepFilesOfType::Object));
 
   string modelSharedLibPath = "libmodel.so";
+  std::vector<string> libs = {"-ljniruntime", "-lcruntime"};
+  if (enableParallel)
+    libs.emplace_back("-lpthread");
+  addBlasLibrary(libs);
+  std::vector<string> objPaths = modelObjPaths;
+  objPaths.emplace_back(jniObjPath);
   genSharedLib(module, modelSharedLibPath,
-      {"-shared", "-fPIC", "-z", "noexecstack"}, {modelObjPath, jniObjPath},
-      {"-ljniruntime", "-lcruntime"});
+      {"-shared", "-fPIC", "-z", "noexecstack"}, objPaths, libs);
   llvm::FileRemover modelSharedLibRemover(
       modelSharedLibPath, !keepFiles(KeepFilesOfType::Object));
 
@@ -426,6 +1323,7 @@ void registerDialects(mlir::MLIRContext &context) {
   context.getOrLoadDialect<mlir::AffineDialect>();
   context.getOrLoadDialect<mlir::vector::VectorDialect>();
   context.getOrLoadDialect<mlir::LLVM::LLVMDialect>();
+  context.getOrLoadDialect<mlir::omp::OpenMPDialect>();
   context.getOrLoadDialect<mlir::scf::SCFDialect>();
   context.getOrLoadDialect<mlir::StandardOpsDialect>();
   context.getOrLoadDialect<mlir::shape::ShapeDialect>();
@@ -436,49 +1334,215 @@ void registerDialects(mlir::MLIRContext &context) {
 }
 
 void addONNXToMLIRPasses(mlir::PassManager &pm) {
+  // The small functions are inlined before the shapes are inferred and the
+  // constants propagated through them, unless optimizing for size.
+  if (inlineFunctionsMaxOps > 0 && !optimizeForSize)
+    pm.addPass(mlir::createInlineFunctionsONNXPass(inlineFunctionsMaxOps));
+  if (!specializeShapes.empty())
+    pm.addPass(mlir::createSpecializeShapesPass(std::vector<std::string>(
+        specializeShapes.begin(), specializeShapes.end())));
+  // Remove the training-only ops and results before their shapes are
+  // inferred and their buffers allocated.
+  pm.addNestedPass<FuncOp>(mlir::createInferenceCleanupONNXPass());
+  if (unrollLoopMaxTripCount > 0)
+    pm.addNestedPass<FuncOp>(
+        mlir::createUnrollLoopONNXPass(unrollLoopMaxTripCount));
   pm.addNestedPass<FuncOp>(mlir::createDecomposeONNXToONNXPass());
   pm.addPass(mlir::createShapeInferencePass());
-  pm.addPass(mlir::createCanonicalizerPass());
+  pm.addNestedPass<FuncOp>(mlir::createCanonicalizerPass());
+  // Cancel the Transposes around the ops that do not depend on the layout,
+  // now that their operands have ranks.
+  pm.addNestedPass<FuncOp>(mlir::createLayoutPropagationONNXToONNXPass());
   pm.addPass(mlir::createShapeInferencePass());
   // There are more opportunities for const propagation once all tensors have
   // inferred shapes.
   pm.addNestedPass<FuncOp>(mlir::createConstPropONNXToONNXPass());
+  // Compute the invariants of the loop bodies before the loops, and the
+  // repeated subgraphs and constants once, then canonicalize the ops whose
+  // operands became the same.
+  pm.addNestedPass<FuncOp>(mlir::createLoopInvariantMotionONNXPass());
+  pm.addNestedPass<FuncOp>(mlir::createCSEONNXToONNXPass());
+  // Remove the Casts around the regions computed in reduced precision, the
+  // canonicalization removing the Cast pairs left between them.
+  if (propagateLowPrecision)
+    pm.addNestedPass<FuncOp>(mlir::createPropagateLowPrecisionONNXPass());
+  // The CNN regions run on blocks of channels, the reorders left at their
+  // boundaries only.
+  if (convBlockSize > 1)
+    pm.addNestedPass<FuncOp>(mlir::createAssignLayoutONNXPass(convBlockSize));
+  pm.addNestedPass<FuncOp>(mlir::createCanonicalizerPass());
+  // The layers are outlined once their ops are in their final form, and
+  // before the memory scheduling interleaves them.
+  if (outlineRepeatedLayers || optimizeForSize)
+    pm.addPass(mlir::createOutlineRepeatedLayersONNXPass());
   // Clean dead code.
   pm.addPass(mlir::createSymbolDCEPass());
+  // The order of the ops is the order of the lifetimes of their buffers.
+  if (enableMemoryScheduling)
+    pm.addNestedPass<FuncOp>(mlir::createScheduleForMemoryONNXPass());
+  if (printCostModel)
+    pm.addNestedPass<FuncOp>(mlir::createPrintCostModelPass());
 }
 
 void addONNXToKrnlPasses(mlir::PassManager &pm) {
-  pm.addPass(mlir::createLowerToKrnlPass());
+  pm.addPass(mlir::createLowerToKrnlPass(enableInPlace,
+      /*fastMath=*/mathAccuracy == MathAccuracyType::Fast,
+      enableOptimizedConv, enableWinogradConv, getMatMulTileSizes(),
+      downcastWeightsToBF16, enableStoreEpilogues, instrument,
+      matmulTuningDatabase,
+      /*blasMinFlops=*/blasLibrary == BlasLibraryType::None ? 0
+                                                            : blasMinFlops,
+      persistentRNNStates, sparseWeightsMinZeros, splitBatch,
+      /*matMulUnroll=*/!optimizeForSize));
+  // The dynamic input dims with the same symbolic name have the same size.
+  pm.addNestedPass<FuncOp>(mlir::createUnifySymbolicDimsPass());
+  if (specializeInputAlignment > 0)
+    pm.addPass(
+        mlir::createSpecializeInputAlignmentPass(specializeInputAlignment));
   // An additional pass of canonicalization is helpful because lowering
   // from ONNX dialect to Standard dialect exposes additional canonicalization
   // oppertunities.
-  pm.addPass(mlir::createCanonicalizerPass());
+  pm.addNestedPass<FuncOp>(mlir::createCanonicalizerPass());
+  // Fuse the loops of consecutive elementwise ops before the memory pools are
+  // formed, so that the intermediate buffers removed by the fusion do not
+  // take space in the pools.
+  pm.addNestedPass<FuncOp>(mlir::createKrnlFuseElementwiseLoopsPass());
   pm.addNestedPass<FuncOp>(createDisconnectKrnlDimFromAllocPass());
 
+  // The small temporaries are allocated on the stack, outside of the pools.
+  if (stackAllocationMaxBytes > 0)
+    pm.addNestedPass<FuncOp>(
+        mlir::createKrnlStackAllocationPass(stackAllocationMaxBytes));
   // TODO: make this pass optional:
   pm.addNestedPass<FuncOp>(mlir::createKrnlEnableMemoryPoolPass());
   pm.addNestedPass<FuncOp>(mlir::createKrnlBundleMemoryPoolsPass());
-  pm.addPass(mlir::createCanonicalizerPass());
-  pm.addNestedPass<FuncOp>(mlir::createKrnlOptimizeMemoryPoolsPass());
-  pm.addPass(mlir::createCanonicalizerPass());
+  pm.addNestedPass<FuncOp>(mlir::createCanonicalizerPass());
+  pm.addNestedPass<FuncOp>(
+      mlir::createKrnlOptimizeMemoryPoolsPass(/*report=*/memoryReport));
+  pm.addNestedPass<FuncOp>(mlir::createCanonicalizerPass());
+  // Shared arenas hand the same buffers to concurrent calls, reentrant entry
+  // points keep their arenas per thread.
+  MemPoolArenaType arenaType = memPoolArena;
+  if (reentrant && arenaType == MemPoolArenaType::Shared) {
+    llvm::errs() << "Warning: --reentrant keeps the memory arenas per "
+                    "thread, ignoring --memPoolArena=shared.\n";
+    arenaType = MemPoolArenaType::Thread;
+  }
+  if (arenaType != MemPoolArenaType::None)
+    pm.addPass(mlir::createKrnlMemoryPoolArenaPass(
+        /*threadLocal=*/arenaType == MemPoolArenaType::Thread));
+  // The shape computations include the offsets of the pools and the sizes of
+  // the dynamic ones.
+  if (cacheShapePlans)
+    pm.addPass(mlir::createKrnlShapePlanCachePass());
+  // Trace the pools that are actually allocated, once compacted and moved
+  // into arenas.
+  if (traceMemoryPools)
+    pm.addNestedPass<FuncOp>(mlir::createKrnlTraceMemoryPoolsPass());
 }
 
 void addKrnlToAffinePasses(mlir::PassManager &pm) {
-  pm.addNestedPass<FuncOp>(mlir::createConvertKrnlToAffinePass());
+  if (enableLoopLocality)
+    pm.addNestedPass<FuncOp>(mlir::createKrnlOptimizeLoopLocalityPass());
+  pm.addNestedPass<FuncOp>(
+      mlir::createConvertKrnlToAffinePass(enableMatmulMicroKernels));
   // Fuse loops in Affine dialect.
   //  pm.addPass(mlir::createLoopFusionPass());
 }
 
-void addKrnlToLLVMPasses(mlir::OpPassManager &pm) {
+// The passes of addKrnlToLLVMPasses up to the writing of the weights file.
+static void addWeightsFilePasses(
+    mlir::OpPassManager &pm, std::string weightsFile) {
+  // The constants shared by several functions, e.g. by the models of several
+  // entry points, are emitted once.
+  pm.addPass(mlir::createDeduplicateKrnlGlobalsPass());
+  if (!weightsFile.empty())
+    pm.addPass(mlir::createMoveWeightsToFilePass(
+        weightsFile, numaWeights, /*compressWeights=*/optimizeForSize));
+}
+
+// The passes of addKrnlToLLVMPasses after the writing of the weights file.
+static void addLowerToLLVMPasses(mlir::OpPassManager &pm) {
   pm.addNestedPass<FuncOp>(mlir::createConvertVectorToSCFPass());
   pm.addPass(mlir::createLowerAffinePass());
+  if (enableStrengthReduction)
+    pm.addNestedPass<FuncOp>(mlir::createStrengthReduceMemRefAccessesPass());
+  // Parallel loops (from krnl.parallel) are executed sequentially unless they
+  // are mapped onto OpenMP here; otherwise they are lowered to CFG as well.
+  // OpenMP parallel loops are outlined into calls to the runtime thread pool
+  // when lowering to LLVM.
+  if (enableParallel) {
+    if (enableInterOpParallel)
+      pm.addNestedPass<FuncOp>(mlir::createParallelizeIndependentLoopsPass());
+    pm.addPass(mlir::createConvertSCFToOpenMPPass());
+  }
   pm.addPass(mlir::createLowerToCFGPass());
-  pm.addPass(mlir::createConvertKrnlToLLVMPass());
+  pm.addPass(mlir::createConvertKrnlToLLVMPass(/*weightsFile=*/"",
+      numaWeights, blasLibrary == BlasLibraryType::DNNL ? "dnnl" : "cblas",
+      unchecked));
   pm.addPass(mlir::createCanonicalizerPass());
 }
 
+void addKrnlToLLVMPasses(mlir::OpPassManager &pm, std::string weightsFile) {
+  addWeightsFilePasses(pm, weightsFile);
+  addLowerToLLVMPasses(pm);
+}
+
+// The passes nested on the functions, the shape inference and the decoding
+// of the initializers run on compileThreads threads.
+static void setCompileThreads(mlir::MLIRContext &context) {
+  context.disableMultithreading(compileThreads == 1);
+  if (compileThreads > 1)
+    llvm::parallel::strategy = llvm::hardware_concurrency(compileThreads);
+}
+
+// Options of the import of the ONNX models, from the command line.
+static ImportOptions getImportOptions() {
+  ImportOptions options;
+  options.useOnnxModelTypes = useOnnxModelTypes;
+  options.invokeOnnxVersionConverter = invokeOnnxVersionConverter;
+  options.lazyExternalDataMinBytes = lazyExternalDataMinBytes;
+  options.prunedOutputs.assign(pruneOutputs.begin(), pruneOutputs.end());
+  return options;
+}
+
+// Import the models of the other entry points into the same module.
+static void importEntryPoints(mlir::MLIRContext &context,
+    mlir::OwningModuleRef &module, ImportOptions options) {
+  for (const string &entryPoint : entryPoints) {
+    string name, path;
+    if (!parseEntryPoint(entryPoint, name, path)) {
+      llvm::errs() << "Invalid entry point " << entryPoint
+                   << ", expected <name>=<file.onnx>.\n";
+      exit(1);
+    }
+    if (module->lookupSymbol(name)) {
+      llvm::errs() << "Entry point " << name << " is already defined.\n";
+      exit(1);
+    }
+    mlir::OwningModuleRef entryPointModule;
+    options.funcName = name;
+    ImportFrontendModelFile(path, context, entryPointModule, options);
+    for (Operation &op : llvm::make_early_inc_range(
+             entryPointModule->getBody()->getOperations())) {
+      if (op.hasTrait<OpTrait::IsTerminator>())
+        continue;
+      op.remove();
+      module->push_back(&op);
+    }
+  }
+}
+
 void processInputFile(string inputFilename, mlir::MLIRContext &context,
     mlir::OwningModuleRef &module) {
+  setCompileThreads(context);
+  ProfiledStage stage("import");
+  // The import is timed apart from the passes, the report is printed when
+  // the timer is destroyed.
+  llvm::TimerGroup timers("onnx-mlir", "ONNX-MLIR compilation");
+  llvm::Timer importTimer("import", "Import of the input model", timers);
+  llvm::TimeRegion importRegion(timeImport ? &importTimer : nullptr);
+
   // Decide if the input file is an ONNX model or a model specified
   // in MLIR. The extension of the file is the decider.
   string extension = inputFilename.substr(inputFilename.find_last_of(".") + 1);
@@ -488,15 +1552,27 @@ void processInputFile(string inputFilename, mlir::MLIRContext &context,
          "Either ONNX model or MLIR file needs to be provided.");
 
   if (inputIsONNX) {
-    ImportOptions options;
-    options.useOnnxModelTypes = useOnnxModelTypes;
-    options.invokeOnnxVersionConverter = invokeOnnxVersionConverter;
+    ImportOptions options = getImportOptions();
     ImportFrontendModelFile(inputFilename, context, module, options);
+    importEntryPoints(context, module, options);
   } else {
+    if (!entryPoints.empty()) {
+      llvm::errs() << "Additional entry points require an ONNX model.\n";
+      exit(1);
+    }
     LoadMLIR(inputFilename, context, module);
   }
 }
 
+void processInputArray(const void *onnxBuffer, int bufferSize,
+    mlir::MLIRContext &context, mlir::OwningModuleRef &module) {
+  setCompileThreads(context);
+  ProfiledStage stage("import");
+  ImportOptions options = getImportOptions();
+  ImportFrontendModelArray(onnxBuffer, bufferSize, context, module, options);
+  importEntryPoints(context, module, options);
+}
+
 InputIRLevelType determineInputIRLevel(mlir::OwningModuleRef &module) {
   Operation *moduleOp = module->getOperation();
 
@@ -551,6 +1627,29 @@ void outputCode(
     module->print(llvm::outs(), flags);
 }
 
+// Print the size of the library and of its weights file, with the size of
+// the weights before their compression.
+static void reportLibrarySize(const string &outputBaseName) {
+  uint64_t size;
+  if (!llvm::sys::fs::file_size(outputBaseName + ".so", size))
+    printf("Size of %s.so: %llu bytes.\n", outputBaseName.c_str(),
+        (unsigned long long)size);
+  string weightsPath = outputBaseName + ".weights";
+  if (llvm::sys::fs::file_size(weightsPath, size))
+    return;
+  // The header of the compressed files starts with OMWZ, the width of the
+  // byte planes and the size of the weights, see MoveWeightsToFile.
+  uint64_t weightsSize = size;
+  auto header = llvm::MemoryBuffer::getFileSlice(weightsPath, 16, 0);
+  if (header && (*header)->getBuffer().startswith("OMWZ"))
+    weightsSize = llvm::support::endian::read64le(
+        (*header)->getBufferStart() + 8);
+  printf("Size of %s: %llu bytes, %llu bytes uncompressed (%.1f%% saved).\n",
+      weightsPath.c_str(), (unsigned long long)size,
+      (unsigned long long)weightsSize,
+      weightsSize ? 100.0 * (weightsSize - size) / weightsSize : 0.0);
+}
+
 void emitOutputFiles(string outputBaseName, EmissionTargetType emissionTarget,
     mlir::MLIRContext &context, mlir::OwningModuleRef &module) {
   // For EmitONNXIR and EmitMLIR the constant value are embedded in the code
@@ -576,6 +1675,8 @@ void emitOutputFiles(string outputBaseName, EmissionTargetType emissionTarget,
     if (keepFiles(KeepFilesOfType::MLIR))
       outputCode(module, outputBaseName, ".llvm.mlir");
     printf("Shared library %s.so has been compiled.\n", outputBaseName.c_str());
+    if (optimizeForSize)
+      reportLibrarySize(outputBaseName);
   } else if (emissionTarget == EmitJNI) {
     compileModuleToJniJar(module, outputBaseName);
     if (keepFiles(KeepFilesOfType::MLIR))
@@ -610,14 +1711,12 @@ void emitOutputFiles(string outputBaseName, EmissionTargetType emissionTarget,
   }
 }
 
-int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
-    std::string outputBaseName, EmissionTargetType emissionTarget) {
-  mlir::PassManager pm(&context, mlir::OpPassManager::Nesting::Implicit);
-
-  if (keepFiles(KeepFilesOfType::MLIR)) {
-    outputCode(module, outputBaseName, ".input.mlir");
-  }
-
+// Add the passes lowering the module from its input level to the emission
+// target, or only until the weights file is written with untilWeightsFile,
+// the lowering to LLVM being left to addLowerToLLVMPasses.
+static void addCompilerPasses(mlir::OwningModuleRef &module,
+    mlir::PassManager &pm, std::string outputBaseName,
+    EmissionTargetType emissionTarget, bool untilWeightsFile = false) {
   InputIRLevelType inputIRLevel = determineInputIRLevel(module);
 
   if (inputIRLevel <= ONNXLevel && emissionTarget >= EmitONNXIR) {
@@ -631,13 +1730,121 @@ int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
       addKrnlToAffinePasses(pm);
   }
 
-  if (inputIRLevel <= LLVMLevel && emissionTarget >= EmitLLVMIR)
-    addKrnlToLLVMPasses(pm);
+  // The weights file sits next to the shared library, where the runtime
+  // looks for it.
+  if (inputIRLevel <= LLVMLevel && emissionTarget >= EmitLLVMIR) {
+    addWeightsFilePasses(pm, storeWeightsInFile && emissionTarget == EmitLib
+                                 ? outputBaseName + ".weights"
+                                 : "");
+    if (!untilWeightsFile)
+      addLowerToLLVMPasses(pm);
+  }
+}
+
+int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
+    std::string outputBaseName, EmissionTargetType emissionTarget,
+    const std::vector<std::string> &cacheOptions) {
+  setCompileThreads(context);
+
+  mlir::PassManager pm(&context, mlir::OpPassManager::Nesting::Implicit);
+
+  if (keepFiles(KeepFilesOfType::MLIR)) {
+    outputCode(module, outputBaseName, ".input.mlir");
+  }
 
+  // The library compiled from the same code is reused with the new weights
+  // file, the lowering to LLVM and the compilation of the library skipped.
+  bool reuseCode = reuseCodeForNewWeights && storeWeightsInFile &&
+                   emissionTarget == EmitLib && !compilationCacheDir.empty() &&
+                   profileCompile.empty();
+  addCompilerPasses(module, pm, outputBaseName, emissionTarget, reuseCode);
   mlir::applyPassManagerCLOptions(pm);
-  if (mlir::failed(pm.run(*module)))
-    return 4;
+  if (!profileCompile.empty())
+    pm.addInstrumentation(std::make_unique<PassTimeInstrumentation>());
+  {
+    ProfiledStage stage("passes");
+    if (mlir::failed(pm.run(*module))) {
+      writeCompileProfile(outputBaseName, 4);
+      return 4;
+    }
+  }
+
+  string codeKey;
+  if (reuseCode) {
+    codeKey = getCompiledCodeCacheKey(*module, cacheOptions);
+    if (loadFromCompilationCache(
+            codeKey, outputBaseName, /*withWeights=*/false)) {
+      printf("Shared library %s.so has been loaded from the compilation "
+             "cache, with its new weights file.\n",
+          outputBaseName.c_str());
+      return 0;
+    }
+    mlir::PassManager llvmPM(&context, mlir::OpPassManager::Nesting::Implicit);
+    addLowerToLLVMPasses(llvmPM);
+    mlir::applyPassManagerCLOptions(llvmPM);
+    if (mlir::failed(llvmPM.run(*module)))
+      return 4;
+  }
 
-  emitOutputFiles(outputBaseName, emissionTarget, context, module);
+  {
+    ProfiledStage stage("emit");
+    emitOutputFiles(outputBaseName, emissionTarget, context, module);
+  }
+  storeInCompilationCache(codeKey, outputBaseName, /*withWeights=*/false);
+  writeCompileProfile(outputBaseName, 0);
   return 0;
 }
+
+std::unique_ptr<mlir::ExecutionEngine> compileModuleToExecutionEngine(
+    mlir::OwningModuleRef &module, mlir::MLIRContext &context,
+    std::string outputBaseName) {
+  setCompileThreads(context);
+
+  mlir::PassManager pm(&context, mlir::OpPassManager::Nesting::Implicit);
+  addCompilerPasses(module, pm, outputBaseName, EmitLLVMIR);
+  mlir::applyPassManagerCLOptions(pm);
+  if (mlir::failed(pm.run(*module)))
+    return nullptr;
+
+  // The runtime functions called by the model, and the sgemm of the BLAS
+  // library, are resolved in the libraries loaded in the process.
+  llvm::SmallString<64> runtimePath(getRuntimeDir());
+  llvm::sys::path::append(runtimePath, "libcruntime_shared.so");
+  std::vector<string> libs = {runtimePath.str().str()};
+  std::vector<string> blasLibs;
+  addBlasLibrary(blasLibs);
+  // The BLAS library is named after its -l<name> link flag.
+  for (const string &blasLib : blasLibs)
+    libs.emplace_back("lib" + blasLib.substr(2) + ".so");
+  for (const string &lib : libs) {
+    string error;
+    if (llvm::sys::DynamicLibrary::LoadLibraryPermanently(
+            lib.c_str(), &error)) {
+      llvm::errs() << "Failed to load " << lib << ": " << error << "\n";
+      return nullptr;
+    }
+  }
+
+  // The module is translated and optimized as for a shared library.
+  std::unique_ptr<llvm::TargetMachine> targetMachine =
+      createTargetMachine(llvm::Reloc::PIC_);
+  if (!targetMachine) {
+    llvm::errs() << "Unknown target "
+                 << (mtriple != "" ? string(mtriple)
+                                   : llvm::sys::getDefaultTargetTriple())
+                 << ".\n";
+    return nullptr;
+  }
+  auto buildLLVMModule = [&](mlir::ModuleOp, llvm::LLVMContext &llvmContext) {
+    return genOptimizedLLVMModule(
+        module, llvmContext, *targetMachine, outputBaseName + ".bc");
+  };
+  auto engine = mlir::ExecutionEngine::create(*module, buildLLVMModule,
+      /*transformer=*/{}, llvm::CodeGenOpt::Aggressive);
+  if (!engine) {
+    llvm::errs() << "Failed to create the execution engine: "
+                 << llvm::toString(engine.takeError()) << "\n";
+    return nullptr;
+  }
+  return std::move(*engine);
+}
@@ -20,6 +20,7 @@
 #include "mlir/Conversion/SCFToStandard/SCFToStandard.h"
 #include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVM.h"
 #include "mlir/Conversion/VectorToSCF/VectorToSCF.h"
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/InitAllDialects.h"
 #include "mlir/Parser.h"
 #include "mlir/Pass/PassManager.h"
@@ -46,12 +47,29 @@ enum InputIRLevelType {
 
 void setExecPath(const char *argv0, void *fmain);
 
+// Directory of the runtime libraries, found from the path set by setExecPath.
+std::string getRuntimeDir();
+
 void LoadMLIR(std::string inputFilename, mlir::MLIRContext &context,
     mlir::OwningModuleRef &module);
 
 void compileModuleToSharedLibrary(
     const mlir::OwningModuleRef &module, std::string outputBaseName);
 
+// Key of the shared library compiled from the input file with the given
+// options in the compilation cache, or an empty string when the cache is
+// disabled.
+std::string getCompilationCacheKey(
+    std::string inputFilename, const std::vector<std::string> &options);
+
+// Copy the cached shared library of the key to <outputBaseName>.so, and its
+// weights file with withWeights. Returns false on a miss.
+bool loadFromCompilationCache(std::string cacheKey, std::string outputBaseName,
+    bool withWeights = true);
+
+void storeInCompilationCache(std::string cacheKey, std::string outputBaseName,
+    bool withWeights = true);
+
 void compileModuleToJniJar(
     const mlir::OwningModuleRef &module, std::string outputBaseName);
 
@@ -63,11 +81,19 @@ void addONNXToKrnlPasses(mlir::PassManager &pm);
 
 void addKrnlToAffinePasses(mlir::PassManager &pm);
 
-void addKrnlToLLVMPasses(mlir::OpPassManager &pm);
+// The large constants are written to the weights file instead of LLVM
+// globals when one is given.
+void addKrnlToLLVMPasses(
+    mlir::OpPassManager &pm, std::string weightsFile = "");
 
 void processInputFile(std::string inputFilename, mlir::MLIRContext &context,
     mlir::OwningModuleRef &module);
 
+// Import the ONNX model serialized in the buffer, e.g. by a Python program
+// holding it in memory, as processInputFile imports an ONNX file.
+void processInputArray(const void *onnxBuffer, int bufferSize,
+    mlir::MLIRContext &context, mlir::OwningModuleRef &module);
+
 InputIRLevelType determineInputIRLevel(mlir::OwningModuleRef &module);
 
 void outputCode(
@@ -77,5 +103,16 @@ void emitOutputFiles(std::string outputBaseName,
     EmissionTargetType emissionTarget, mlir::MLIRContext &context,
     mlir::OwningModuleRef &module);
 
+// The cache options, all the options but the input and output files, key the
+// libraries reused for new weights with --reuseCodeForNewWeights.
 int compileModule(mlir::OwningModuleRef &module, mlir::MLIRContext &context,
-    std::string outputBaseName, EmissionTargetType targetType);
+    std::string outputBaseName, EmissionTargetType targetType,
+    const std::vector<std::string> &cacheOptions = {});
+
+// Lower the module with the passes of compileModule and compile it in process
+// with the MLIR ExecutionEngine, for its entry points to be run without
+// emitting a shared library. The files kept by --preserveBitcode are named
+// after outputBaseName. Returns nullptr when the module cannot be compiled.
+std::unique_ptr<mlir::ExecutionEngine> compileModuleToExecutionEngine(
+    mlir::OwningModuleRef &module, mlir::MLIRContext &context,
+    std::string outputBaseName);
@@ -14,7 +14,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
 
 namespace mlir {
 class Pass;
@@ -24,25 +29,123 @@ std::unique_ptr<Pass> createDecomposeONNXToONNXPass();
 
 std::unique_ptr<Pass> createShapeInferencePass();
 
+/// Pass for cloning the entry point functions for some input shapes.
+std::unique_ptr<Pass> createSpecializeShapesPass(
+    llvm::ArrayRef<std::string> specializations = {});
+
 std::unique_ptr<Pass> createConstPropONNXToONNXPass();
 
+/// Pass for removing the ONNX operations and results that only matter for
+/// training, e.g. Dropout and the statistics of BatchNormalization.
+std::unique_ptr<Pass> createInferenceCleanupONNXPass();
+
+/// Pass for fully unrolling the ONNX Loops of a small constant trip count
+/// that cannot terminate early.
+std::unique_ptr<Pass> createUnrollLoopONNXPass(int64_t maxTripCount = 8);
+
+/// Pass for eliminating the ONNX operations computing the same results as
+/// operations before them, including the duplicated constants.
+std::unique_ptr<Pass> createCSEONNXToONNXPass();
+
+/// Pass for moving the loop invariant operations of the bodies of the ONNX
+/// Loops and Scans before them.
+std::unique_ptr<Pass> createLoopInvariantMotionONNXPass();
+
+/// Pass for propagating and eliminating the Transpose operations.
+std::unique_ptr<Pass> createLayoutPropagationONNXToONNXPass();
+
+/// Pass for inlining the calls of the small functions of a model, e.g. of
+/// its model-local functions.
+std::unique_ptr<Pass> createInlineFunctionsONNXPass(int64_t maxOps = 64);
+
+/// Pass for outlining the repeated layers of a model into functions called
+/// once for each layer, when the code saved pays off the calls.
+std::unique_ptr<Pass> createOutlineRepeatedLayersONNXPass(int64_t minOps = 8);
+
+/// Pass for computing the convolutional regions in the blocked layout
+/// NCHW[b]c, reordering the values at their boundaries.
+std::unique_ptr<Pass> createAssignLayoutONNXPass(int64_t blockSize = 8);
+
+/// Pass for computing the elementwise ONNX operations between Casts from and
+/// to fp16 or bf16 in that precision, removing the Casts.
+std::unique_ptr<Pass> createPropagateLowPrecisionONNXPass();
+
+/// Pass for ordering the independent ONNX operations to lower the peak of the
+/// bytes of the tensors live at once.
+std::unique_ptr<Pass> createScheduleForMemoryONNXPass();
+
 /// Pass for eliding the values of constant operations.
 std::unique_ptr<Pass> createElideConstantValuePass();
 
+/// Pass for printing the floating point operations and bytes of the ONNX
+/// operations, which attaches them to the operations with annotate.
+std::unique_ptr<Pass> createPrintCostModelPass(bool annotate = false);
+
+/// Pass for allocating the small temporary MemRefs of static shape, up to
+/// maxBytes, on the stack.
+std::unique_ptr<Pass> createKrnlStackAllocationPass(int64_t maxBytes = 1024);
+
 /// Pass for enabling a memory pool for MemRefs.
 std::unique_ptr<Pass> createKrnlEnableMemoryPoolPass();
 
 /// Pass for enabling a memory pool for MemRefs.
 std::unique_ptr<Pass> createKrnlBundleMemoryPoolsPass();
 
-/// Pass for optimizing memory pools.
-std::unique_ptr<Pass> createKrnlOptimizeMemoryPoolsPass();
+/// Pass for optimizing memory pools, which prints the memory footprint of
+/// each function with report.
+std::unique_ptr<Pass> createKrnlOptimizeMemoryPoolsPass(bool report = false);
+
+/// Pass for fusing consecutive elementwise Krnl loops.
+std::unique_ptr<Pass> createKrnlFuseElementwiseLoopsPass();
+
+/// Pass for reordering and tiling the Krnl loops that are neither blocked nor
+/// permuted, with tiles fitting in cacheSize bytes.
+std::unique_ptr<Pass> createKrnlOptimizeLoopLocalityPass(
+    int64_t cacheSize = 32 * 1024);
+
+/// Pass for carrying the offsets of the accesses of the innermost SCF loops
+/// as loop values incremented at each iteration.
+std::unique_ptr<Pass> createStrengthReduceMemRefAccessesPass();
+
+/// Pass for executing the independent loop nests of a function concurrently.
+std::unique_ptr<Pass> createParallelizeIndependentLoopsPass();
+
+/// Pass for sharing the dims of the inputs with the same symbolic name.
+std::unique_ptr<Pass> createUnifySymbolicDimsPass();
+
+/// Pass for sharing the names of the identical Krnl globals.
+std::unique_ptr<Pass> createDeduplicateKrnlGlobalsPass();
+
+/// Pass for cloning the entry point functions for aligned inputs.
+std::unique_ptr<Pass> createSpecializeInputAlignmentPass(
+    int64_t alignment = 64);
+
+/// Pass for keeping the memory pools in memory arenas across calls.
+std::unique_ptr<Pass> createKrnlMemoryPoolArenaPass(bool threadLocal = false);
+
+/// Pass for caching the shapes computed from the input dims across calls.
+std::unique_ptr<Pass> createKrnlShapePlanCachePass(int64_t minOps = 8);
+
+/// Pass for reporting the allocations of the memory pools to the profiler.
+std::unique_ptr<Pass> createKrnlTraceMemoryPoolsPass();
 
-/// Add pass for lowering to Krnl IR.
-std::unique_ptr<Pass> createLowerToKrnlPass();
+/// Add pass for lowering to Krnl IR. The matrix multiply tile sizes are those
+/// of the matmul-tile-sizes option of the pass, the defaults when empty,
+/// except for the shapes tuned in the matrix multiply tuning database.
+std::unique_ptr<Pass> createLowerToKrnlPass(bool emitInPlace = false,
+    bool fastMath = false, bool optimizeConv = false,
+    bool winogradConv = false, llvm::ArrayRef<int64_t> matMulTileSizes = {},
+    bool downcastWeightsToBF16 = false, bool fuseStoreEpilogues = false,
+    bool instrument = false, llvm::StringRef matMulTuningDatabase = "",
+    int64_t blasMinFlops = 0, bool persistentRNNStates = false,
+    int64_t sparseWeightsMinZeros = 0, bool splitBatch = false,
+    bool matMulUnroll = true);
 
-/// Pass for lowering frontend dialects to Krnl IR dialect.
-std::unique_ptr<Pass> createConvertKrnlToAffinePass();
+/// Pass for lowering frontend dialects to Krnl IR dialect. The full tiles of
+/// the matrix multiplies call the microkernels of the runtime with
+/// matMulMicroKernels, for the tile sizes they are provided for.
+std::unique_ptr<Pass> createConvertKrnlToAffinePass(
+    bool matMulMicroKernels = false);
 
 /// Pass for lowering krnl.dim operations to standard dialect.
 std::unique_ptr<Pass> createDisconnectKrnlDimFromAllocPass();
@@ -53,7 +156,17 @@ std::unique_ptr<Pass> createLowerKrnlShapePass();
 /// Pass for eliding the values of global Krnl operations.
 std::unique_ptr<Pass> createElideConstGlobalValuePass();
 
-/// Pass for lowering Krnl dialect to LLVM dialect.
-std::unique_ptr<Pass> createConvertKrnlToLLVMPass();
+/// Pass for writing the large constants to the weights file ahead of the
+/// lowering to LLVM dialect, compressed with compressWeights.
+std::unique_ptr<Pass> createMoveWeightsToFilePass(std::string weightsFile = "",
+    bool numaWeights = false, bool compressWeights = false);
+
+/// Pass for lowering Krnl dialect to LLVM dialect. The large constants are
+/// written to the weights file instead of LLVM globals when one is given, and
+/// read from a replica on the local NUMA node with numaWeights. The inputs of
+/// the entry points are not checked when unchecked.
+std::unique_ptr<Pass> createConvertKrnlToLLVMPass(std::string weightsFile = "",
+    bool numaWeights = false, std::string blasLibrary = "cblas",
+    bool unchecked = false);
 
 } // end namespace mlir
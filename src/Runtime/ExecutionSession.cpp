@@ -13,36 +13,104 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <vector>
 
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
 #include "ExecutionSession.hpp"
 #include "llvm/Support/ManagedStatic.h"
 
 namespace onnx_mlir {
 
 ExecutionSession::ExecutionSession(
-    std::string sharedLibPath, std::string entryPointName) {
+    std::string sharedLibPath, std::string entryPointName, bool warmup) {
 
+#ifndef _WIN32
+  // The symbols of the library stay local to it, so that the libraries loaded
+  // afterwards do not resolve their functions to those of this one. With
+  // warmup, all the symbols are bound now instead of on their first call.
+  if (void *handle = dlopen(sharedLibPath.c_str(),
+          (warmup ? RTLD_NOW : RTLD_LAZY) | RTLD_LOCAL))
+    _sharedLibraryHandle = llvm::sys::DynamicLibrary(handle);
+#else
   _sharedLibraryHandle =
       llvm::sys::DynamicLibrary::getPermanentLibrary(sharedLibPath.c_str());
+#endif
   if (!_sharedLibraryHandle.isValid()) {
     std::stringstream errStr;
     errStr << "Cannot open library: '" << sharedLibPath << "'" << std::endl;
     throw std::runtime_error(errStr.str());
   }
 
-  _entryPointFunc = reinterpret_cast<entryPointFuncType>(
+  auto entryPointFunc = reinterpret_cast<entryPointFuncType>(
       _sharedLibraryHandle.getAddressOfSymbol(entryPointName.c_str()));
-  if (!_entryPointFunc) {
+  if (!entryPointFunc) {
     std::stringstream errStr;
     errStr << "Cannot load symbol: '" << entryPointName << "'" << std::endl;
     throw std::runtime_error(errStr.str());
   }
+  _entryPointFunc = entryPointFunc;
+
+  auto entryPointIntoFunc = reinterpret_cast<entryPointIntoFuncType>(
+      _sharedLibraryHandle.getAddressOfSymbol(
+          (entryPointName + "_into").c_str()));
+  if (entryPointIntoFunc)
+    _entryPointIntoFunc = entryPointIntoFunc;
+
+  // Libraries compiled with their weights in a separate file read them from
+  // the mapping of <name>.weights at the address returned by omModelWeights,
+  // or at the _weights symbol exported by the libraries compiled before it.
+  void **weights = nullptr;
+  auto weightsFunc = reinterpret_cast<weightsFuncType>(
+      _sharedLibraryHandle.getAddressOfSymbol("omModelWeights"));
+  if (weightsFunc)
+    weights = weightsFunc();
+  else
+    weights = reinterpret_cast<void **>(
+        _sharedLibraryHandle.getAddressOfSymbol("_weights"));
+  if (weights) {
+    std::string weightsPath =
+        sharedLibPath.substr(0, sharedLibPath.find_last_of(".")) + ".weights";
+    if (omWeightsLoad(weights, weightsPath.c_str()) != 0) {
+      std::stringstream errStr;
+      errStr << "Cannot map weights file: '" << weightsPath << "'"
+             << std::endl;
+      throw std::runtime_error(errStr.str());
+    }
+  }
+
+  // Libraries compiled before omModelWarmup was introduced have none.
+  if (warmup) {
+    auto warmupFunc = reinterpret_cast<warmupFuncType>(
+        _sharedLibraryHandle.getAddressOfSymbol("omModelWarmup"));
+    if (warmupFunc)
+      warmupFunc();
+  }
 }
 
+void *ExecutionSession::getAddressOfSymbol(const std::string &symbolName) {
+  return _sharedLibraryHandle.getAddressOfSymbol(symbolName.c_str());
+}
+
+namespace {
+
+// Destroy an OMTensorList without destroying its OMTensors.
+void destroyListOnly(OMTensorList *list) {
+  OMTensor **omts = omTensorListGetOmtArray(list);
+  for (int i = 0; i < omTensorListGetSize(list); i++)
+    omts[i] = nullptr;
+  omTensorListDestroy(list);
+}
+} // namespace
+
 std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>>
 ExecutionSession::run(
     std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>> ins) {
@@ -53,6 +121,9 @@ ExecutionSession::run(
   auto *wrappedInput = omTensorListCreate(&omts[0], omts.size());
 
   auto *wrappedOutput = _entryPointFunc(wrappedInput);
+  destroyListOnly(wrappedInput);
+  if (!wrappedOutput)
+    throw std::runtime_error("Input tensors do not match the model signature");
 
   std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>> outs;
 
@@ -60,12 +131,250 @@ ExecutionSession::run(
     outs.emplace_back(std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>(
         omTensorListGetOmtByIndex(wrappedOutput, i), omTensorDestroy));
   }
+  destroyListOnly(wrappedOutput);
   return std::move(outs);
 }
 
+void ExecutionSession::runInto(
+    const std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>>
+        &ins,
+    const std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>>
+        &outs) {
+  if (!_entryPointIntoFunc)
+    throw std::runtime_error(
+        "Model library does not support caller-provided outputs");
+
+  std::vector<OMTensor *> inOmts, outOmts;
+  for (const auto &inOmt : ins)
+    inOmts.emplace_back(inOmt.get());
+  for (const auto &outOmt : outs)
+    outOmts.emplace_back(outOmt.get());
+  // The lists do not own the OMTensors, only release the lists themselves.
+  std::unique_ptr<OMTensorList, decltype(&destroyListOnly)> wrappedInput(
+      omTensorListCreate(inOmts.data(), inOmts.size()), destroyListOnly);
+  std::unique_ptr<OMTensorList, decltype(&destroyListOnly)> wrappedOutput(
+      omTensorListCreate(outOmts.data(), outOmts.size()), destroyListOnly);
+
+  if (_entryPointIntoFunc(wrappedInput.get(), wrappedOutput.get()) != 0)
+    throw std::runtime_error(
+        "Tensors do not match the model inputs and outputs");
+}
+
+std::future<std::vector<OMTensorUniquePtr>> ExecutionSession::runAsync(
+    std::vector<OMTensorUniquePtr> ins) {
+  return std::async(
+      std::launch::async,
+      [this](std::vector<OMTensorUniquePtr> inputs) {
+        return run(std::move(inputs));
+      },
+      std::move(ins));
+}
+
 ExecutionSession::~ExecutionSession() {
+  // The code of the engine is released before LLVM is shut down.
+  _engine.reset();
   // Call llvm_shutdown which will take care of cleaning up our shared library
   // handles
   llvm::llvm_shutdown();
 }
+namespace {
+
+// Whether the elements of the tensor are laid out in row-major order without
+// gaps, so that its rows can be copied as a single block.
+bool isContiguous(OMTensor *tensor) {
+  int64_t *shape = omTensorGetShape(tensor);
+  int64_t *strides = omTensorGetStrides(tensor);
+  int64_t stride = 1;
+  for (int64_t i = omTensorGetRank(tensor) - 1; i >= 0; --i) {
+    if (shape[i] != 1 && strides[i] != stride)
+      return false;
+    stride *= shape[i];
+  }
+  return true;
+}
+
+// The number of rows of the request, or -1 if its inputs cannot be batched
+// along their leading dimension.
+int64_t getBatchSize(const std::vector<OMTensorUniquePtr> &ins) {
+  if (ins.empty())
+    return -1;
+  int64_t batchSize = -1;
+  for (const auto &in : ins) {
+    if (omTensorGetRank(in.get()) == 0 || !isContiguous(in.get()))
+      return -1;
+    int64_t rows = omTensorGetShape(in.get())[0];
+    if (batchSize != -1 && rows != batchSize)
+      return -1;
+    batchSize = rows;
+  }
+  return batchSize;
+}
+
+// Whether the inputs of two requests have the same data types and the same
+// dimensions but the leading one.
+bool haveSameRowTypes(const std::vector<OMTensorUniquePtr> &ins,
+    const std::vector<OMTensorUniquePtr> &otherIns) {
+  if (ins.size() != otherIns.size())
+    return false;
+  for (size_t i = 0; i < ins.size(); ++i) {
+    OMTensor *in = ins[i].get(), *otherIn = otherIns[i].get();
+    int rank = omTensorGetRank(in);
+    if (omTensorGetDataType(in) != omTensorGetDataType(otherIn) ||
+        rank != omTensorGetRank(otherIn) ||
+        !std::equal(omTensorGetShape(in) + 1, omTensorGetShape(in) + rank,
+            omTensorGetShape(otherIn) + 1))
+      return false;
+  }
+  return true;
+}
+
+// Create a tensor with the shape of the given one but the leading dimension.
+OMTensorUniquePtr createWithRows(OMTensor *tensor, int64_t rows) {
+  int64_t rank = omTensorGetRank(tensor);
+  std::vector<int64_t> shape(
+      omTensorGetShape(tensor), omTensorGetShape(tensor) + rank);
+  shape[0] = rows;
+  OMTensor *result =
+      omTensorCreateEmpty(shape.data(), rank, omTensorGetDataType(tensor));
+  if (!result)
+    throw std::bad_alloc();
+  return OMTensorUniquePtr(result, omTensorDestroy);
+}
+} // namespace
+
+BatchingSession::BatchingSession(ExecutionSession &session,
+    int64_t maxBatchSize, std::chrono::microseconds window)
+    : _session(session), _maxBatchSize(maxBatchSize), _window(window) {
+  _batchThread = std::thread(&BatchingSession::batchLoop, this);
+}
+
+std::future<std::vector<OMTensorUniquePtr>> BatchingSession::runAsync(
+    std::vector<OMTensorUniquePtr> ins) {
+  Request request{std::move(ins), {}};
+  auto outs = request.outs.get_future();
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_stopping)
+      throw std::runtime_error("Batching session is stopping");
+    _requests.emplace_back(std::move(request));
+  }
+  _requestAdded.notify_one();
+  return outs;
+}
+
+BatchingSession::~BatchingSession() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _requestAdded.notify_one();
+  _batchThread.join();
+}
+
+void BatchingSession::batchLoop() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _requestAdded.wait(lock, [&] { return _stopping || !_requests.empty(); });
+    if (_requests.empty())
+      return;
+
+    // Wait for the requests to batch with the oldest one until the window
+    // closes or the batch is full.
+    auto deadline = std::chrono::steady_clock::now() + _window;
+    int64_t firstRows = getBatchSize(_requests.front().ins);
+    auto batchRows = [&] {
+      int64_t rows = 0;
+      for (const Request &request : _requests)
+        if (haveSameRowTypes(request.ins, _requests.front().ins))
+          rows += std::max<int64_t>(getBatchSize(request.ins), 0);
+      return rows;
+    };
+    if (firstRows > 0 && firstRows < _maxBatchSize)
+      _requestAdded.wait_until(lock, deadline,
+          [&] { return _stopping || batchRows() >= _maxBatchSize; });
+
+    // Take the oldest request and the compatible ones that fit in the batch.
+    std::vector<Request> batch;
+    batch.emplace_back(std::move(_requests.front()));
+    _requests.pop_front();
+    int64_t rows = firstRows;
+    for (auto it = _requests.begin(); firstRows > 0 && it != _requests.end();) {
+      int64_t requestRows = getBatchSize(it->ins);
+      if (requestRows > 0 && rows + requestRows <= _maxBatchSize &&
+          haveSameRowTypes(it->ins, batch.front().ins)) {
+        rows += requestRows;
+        batch.emplace_back(std::move(*it));
+        it = _requests.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    lock.unlock();
+    runBatch(batch);
+    lock.lock();
+  }
+}
+
+void BatchingSession::runBatch(std::vector<Request> &batch) {
+  auto runEach = [&] {
+    for (Request &request : batch)
+      request.outs.set_value(_session.run(std::move(request.ins)));
+  };
+
+  try {
+    if (batch.size() == 1) {
+      runEach();
+      return;
+    }
+
+    // Concatenate the inputs of the requests along the leading dimension.
+    int64_t rows = 0;
+    for (const Request &request : batch)
+      rows += getBatchSize(request.ins);
+    std::vector<OMTensorUniquePtr> batchedIns;
+    for (size_t i = 0; i < batch.front().ins.size(); ++i) {
+      batchedIns.emplace_back(createWithRows(batch.front().ins[i].get(), rows));
+      char *dst = static_cast<char *>(omTensorGetDataPtr(batchedIns[i].get()));
+      for (const Request &request : batch) {
+        OMTensor *in = request.ins[i].get();
+        memcpy(dst, omTensorGetDataPtr(in), omTensorGetBufferSize(in));
+        dst += omTensorGetBufferSize(in);
+      }
+    }
+
+    std::vector<OMTensorUniquePtr> batchedOuts =
+        _session.run(std::move(batchedIns));
+    for (const auto &out : batchedOuts)
+      if (omTensorGetRank(out.get()) == 0 ||
+          omTensorGetShape(out.get())[0] != rows || !isContiguous(out.get())) {
+        runEach();
+        return;
+      }
+
+    // Split the outputs back into the rows of each request.
+    std::vector<const char *> srcs;
+    for (const auto &out : batchedOuts)
+      srcs.emplace_back(static_cast<char *>(omTensorGetDataPtr(out.get())));
+    for (Request &request : batch) {
+      int64_t requestRows = getBatchSize(request.ins);
+      std::vector<OMTensorUniquePtr> outs;
+      for (size_t i = 0; i < batchedOuts.size(); ++i) {
+        outs.emplace_back(createWithRows(batchedOuts[i].get(), requestRows));
+        int64_t size = omTensorGetBufferSize(outs[i].get());
+        memcpy(omTensorGetDataPtr(outs[i].get()), srcs[i], size);
+        srcs[i] += size;
+      }
+      request.outs.set_value(std::move(outs));
+    }
+  } catch (...) {
+    // Fail the requests that were not answered yet.
+    for (Request &request : batch) {
+      try {
+        request.outs.set_exception(std::current_exception());
+      } catch (const std::future_error &) {
+      }
+    }
+  }
+}
 } // namespace onnx_mlir
@@ -16,31 +16,147 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "OnnxMlirRuntime.h"
 #include "llvm/Support/DynamicLibrary.h"
 
+namespace mlir {
+class ExecutionEngine;
+class OwningModuleRef;
+} // namespace mlir
+
 namespace onnx_mlir {
 
 typedef OMTensorList *(*entryPointFuncType)(OMTensorList *);
+typedef int (*entryPointIntoFuncType)(OMTensorList *, OMTensorList *);
+typedef void (*warmupFuncType)();
+typedef void **(*weightsFuncType)();
+
+// Use custom deleter since forward declared OMTensor hides destructor
+typedef std::unique_ptr<OMTensor, decltype(&omTensorDestroy)> OMTensorUniquePtr;
+
+// Tag of the ExecutionSession constructor compiling an ONNX file in process,
+// which would otherwise be taken for a shared library.
+struct JitCompile {};
 
 class ExecutionSession {
 public:
-  ExecutionSession(std::string sharedLibPath, std::string entryPointName);
+  // With warmup, all the symbols of the library are bound when it is loaded
+  // (RTLD_NOW) and its omModelWarmup function prefaults its constants and
+  // allocates its memory arenas, so that the first run is as fast as the
+  // following ones.
+  ExecutionSession(std::string sharedLibPath, std::string entryPointName,
+      bool warmup = false);
+
+  // Compile the model in process, with the passes of onnx-mlir and its
+  // options, and run it through the MLIR ExecutionEngine instead of a shared
+  // library. The ONNX file, or the ONNX or MLIR module, which is lowered in
+  // place, is compiled once and its entry point called by run as the one of
+  // a library. The runtime functions are loaded from libcruntime_shared.so
+  // in the runtime directory. These constructors are defined in the
+  // JitExecutionSession library, which links the compiler.
+  ExecutionSession(std::string onnxFilePath, std::string entryPointName,
+      JitCompile);
+  ExecutionSession(mlir::OwningModuleRef &module, std::string entryPointName);
 
   // Use custom deleter since forward declared OMTensor hides destructor
   std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>> run(
       std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>>);
 
+  // Run the model and copy its outputs into the given OMTensors, which must
+  // have the rank of the outputs and buffers large enough to hold them. Their
+  // shapes and strides are updated. The outputs are still computed in buffers
+  // of the model, only their OMTensors are not allocated. Neither the inputs
+  // nor the outputs are consumed, so that the same OMTensors can be reused
+  // across calls.
+  void runInto(
+      const std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>>
+          &ins,
+      const std::vector<std::unique_ptr<OMTensor, decltype(&omTensorDestroy)>>
+          &outs);
+
+  // Run the model on a separate thread. The inputs are released once the
+  // run completes.
+  std::future<std::vector<OMTensorUniquePtr>> runAsync(
+      std::vector<OMTensorUniquePtr> ins);
+
+  // Address of a symbol of the library, null if it has none or the model is
+  // compiled in process.
+  void *getAddressOfSymbol(const std::string &symbolName);
+
   ~ExecutionSession();
 
 protected:
+  // Compile the module in process and load its entry points, naming the kept
+  // intermediate files after outputBaseName.
+  void loadEngine(mlir::OwningModuleRef &module, std::string entryPointName,
+      std::string outputBaseName);
+
   // Handler to the shared library file being loaded.
   llvm::sys::DynamicLibrary _sharedLibraryHandle;
 
+  // Engine owning the code of the model compiled in process, if any.
+  std::shared_ptr<mlir::ExecutionEngine> _engine;
+
   // Entry point function.
-  entryPointFuncType _entryPointFunc = nullptr;
+  std::function<OMTensorList *(OMTensorList *)> _entryPointFunc;
+
+  // Entry point function writing into caller-provided outputs, may be null
+  // for libraries compiled before it was introduced.
+  std::function<int(OMTensorList *, OMTensorList *)> _entryPointIntoFunc;
+};
+
+// Front end of an ExecutionSession that coalesces the concurrent requests
+// into batched runs. The requests whose inputs have the same data types and
+// the same dimensions but the leading one are concatenated along the leading
+// (batch) dimension, the model is run once on the batch, and its outputs are
+// split back along their leading dimension. A request waits at most the
+// given window for other requests to batch with, and a batch holds at most
+// maxBatchSize rows.
+//
+// The model must treat the leading dimension of all its inputs and outputs
+// as the batch dimension, with rows computed independently of each other.
+// Requests whose inputs do not share their leading dimension, or batches
+// whose outputs do not have the batch size as leading dimension, are run
+// one request at a time.
+class BatchingSession {
+public:
+  BatchingSession(ExecutionSession &session, int64_t maxBatchSize,
+      std::chrono::microseconds window);
+
+  std::future<std::vector<OMTensorUniquePtr>> runAsync(
+      std::vector<OMTensorUniquePtr> ins);
+
+  // Run the pending requests and stop the batching thread.
+  ~BatchingSession();
+
+private:
+  struct Request {
+    std::vector<OMTensorUniquePtr> ins;
+    std::promise<std::vector<OMTensorUniquePtr>> outs;
+  };
+
+  void batchLoop();
+  void runBatch(std::vector<Request> &batch);
+
+  ExecutionSession &_session;
+  int64_t _maxBatchSize;
+  std::chrono::microseconds _window;
+
+  std::mutex _mutex;
+  std::condition_variable _requestAdded;
+  std::deque<Request> _requests;
+  bool _stopping = false;
+  std::thread _batchThread;
 };
 } // namespace onnx_mlir
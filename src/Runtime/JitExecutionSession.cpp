@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---- JitExecutionSession.cpp - In-Process ExecutionSession Compile ---===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the constructors of the ExecutionSession class compiling
+// the model in process with the MLIR ExecutionEngine, so that C++ programs can
+// run a model without emitting and loading a shared library.
+//
+//===----------------------------------------------------------------------===//
+
+#include <sstream>
+
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+
+#include "ExecutionSession.hpp"
+#include "src/MainUtils.hpp"
+
+namespace onnx_mlir {
+
+ExecutionSession::ExecutionSession(
+    std::string onnxFilePath, std::string entryPointName, JitCompile) {
+  mlir::MLIRContext context;
+  registerDialects(context);
+  mlir::OwningModuleRef module;
+  processInputFile(onnxFilePath, context, module);
+  loadEngine(module, entryPointName,
+      onnxFilePath.substr(0, onnxFilePath.find_last_of(".")));
+}
+
+ExecutionSession::ExecutionSession(
+    mlir::OwningModuleRef &module, std::string entryPointName) {
+  loadEngine(module, entryPointName, entryPointName);
+}
+
+void ExecutionSession::loadEngine(mlir::OwningModuleRef &module,
+    std::string entryPointName, std::string outputBaseName) {
+  _engine = compileModuleToExecutionEngine(
+      module, *module->getContext(), outputBaseName);
+  if (!_engine)
+    throw std::runtime_error("Cannot compile model");
+
+  // The engine calls the functions through wrappers taking the addresses of
+  // their arguments followed by the address of their result.
+  auto lookup = [&](std::string name) -> void (*)(void **) {
+    auto func = _engine->lookup(name);
+    if (!func) {
+      llvm::consumeError(func.takeError());
+      return nullptr;
+    }
+    return *func;
+  };
+
+  auto entryPointFunc = lookup(entryPointName);
+  if (!entryPointFunc) {
+    std::stringstream errStr;
+    errStr << "Cannot load symbol: '" << entryPointName << "'" << std::endl;
+    throw std::runtime_error(errStr.str());
+  }
+  _entryPointFunc = [entryPointFunc](OMTensorList *input) {
+    OMTensorList *output = nullptr;
+    void *args[] = {&input, &output};
+    entryPointFunc(args);
+    return output;
+  };
+
+  if (auto entryPointIntoFunc = lookup(entryPointName + "_into"))
+    _entryPointIntoFunc = [entryPointIntoFunc](
+                              OMTensorList *input, OMTensorList *output) {
+      int result = 0;
+      void *args[] = {&input, &output, &result};
+      entryPointIntoFunc(args);
+      return result;
+    };
+}
+} // namespace onnx_mlir
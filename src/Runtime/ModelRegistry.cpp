@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------- ModelRegistry.cpp - ModelRegistry Implementation ----------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of ModelRegistry class, which serves the
+// requests of several compiled binary model libraries in one process.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <sstream>
+
+#include "ModelRegistry.hpp"
+
+namespace onnx_mlir {
+
+ModelRegistry::ModelRegistry(int numRunners, int numThreads, bool pooling,
+    std::string runtimeLibPath)
+    : _numThreads(numThreads), _pooling(pooling) {
+  // The runtime functions of the models loaded afterwards resolve to the
+  // global symbols of the shared runtime, which no model runs yet.
+  _runtime =
+      llvm::sys::DynamicLibrary::getPermanentLibrary(runtimeLibPath.c_str());
+  if (_runtime.isValid())
+    configureRuntime(_runtime.getAddressOfSymbol("omThreadPoolSetNumThreads"),
+        _runtime.getAddressOfSymbol("omAllocSetPooling"));
+  for (int i = 0; i < std::max(numRunners, 1); ++i)
+    _runners.emplace_back(&ModelRegistry::runLoop, this);
+}
+
+void ModelRegistry::configureRuntime(void *setNumThreads, void *setPooling) {
+  if (setNumThreads)
+    reinterpret_cast<void (*)(int)>(setNumThreads)(_numThreads);
+  if (setPooling)
+    reinterpret_cast<void (*)(int)>(setPooling)(_pooling);
+}
+
+void ModelRegistry::load(const std::string &name, std::string sharedLibPath,
+    const ModelOptions &options) {
+  if (options.maxConcurrency < 1)
+    throw std::invalid_argument("Model concurrency limit must be positive");
+  // Load the library before taking the lock, the runs go on meanwhile.
+  auto session = std::make_unique<ExecutionSession>(
+      sharedLibPath, options.entryPointName, options.warmup);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_models.count(name)) {
+    std::stringstream errStr;
+    errStr << "Model already loaded: '" << name << "'" << std::endl;
+    throw std::runtime_error(errStr.str());
+  }
+  // Without the shared runtime, the runtime of the library is configured
+  // before the model runs, its thread pool cannot be resized afterwards.
+  if (!_runtime.isValid())
+    configureRuntime(session->getAddressOfSymbol("omThreadPoolSetNumThreads"),
+        session->getAddressOfSymbol("omAllocSetPooling"));
+  _models[name] = Model{std::move(session), options};
+}
+
+std::future<std::vector<OMTensorUniquePtr>> ModelRegistry::runAsync(
+    const std::string &name, std::vector<OMTensorUniquePtr> ins) {
+  std::future<std::vector<OMTensorUniquePtr>> outs;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_stopping)
+      throw std::runtime_error("Model registry is stopping");
+    auto model = _models.find(name);
+    if (model == _models.end()) {
+      std::stringstream errStr;
+      errStr << "Model not loaded: '" << name << "'" << std::endl;
+      throw std::runtime_error(errStr.str());
+    }
+    Request request{&model->second, std::move(ins), {}};
+    outs = request.outs.get_future();
+    // Inserted after the requests of the same priority.
+    _requests.emplace(model->second.options.priority, std::move(request));
+  }
+  _requestReady.notify_one();
+  return outs;
+}
+
+ModelRegistry::~ModelRegistry() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _requestReady.notify_all();
+  for (std::thread &runner : _runners)
+    runner.join();
+}
+
+void ModelRegistry::runLoop() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    // The first request, in priority order, of a model under its limit.
+    auto next = _requests.end();
+    _requestReady.wait(lock, [&] {
+      next = std::find_if(_requests.begin(), _requests.end(), [](auto &entry) {
+        return entry.second.model->running <
+               entry.second.model->options.maxConcurrency;
+      });
+      return next != _requests.end() || (_stopping && _requests.empty());
+    });
+    if (next == _requests.end())
+      return;
+
+    Request request = std::move(next->second);
+    _requests.erase(next);
+    ++request.model->running;
+    lock.unlock();
+    try {
+      request.outs.set_value(
+          request.model->session->run(std::move(request.ins)));
+    } catch (...) {
+      request.outs.set_exception(std::current_exception());
+    }
+    lock.lock();
+    // A request held back by the limit of this model may run now.
+    --request.model->running;
+    _requestReady.notify_all();
+  }
+}
+} // namespace onnx_mlir
@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------- ModelRegistry.hpp - ModelRegistry Declaration ------------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declarations of ModelRegistry class, which serves the
+// requests of several compiled binary model libraries in one process.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ExecutionSession.hpp"
+
+namespace onnx_mlir {
+
+// Options of a model of a ModelRegistry.
+struct ModelOptions {
+  // Requests of the models of higher priority run first.
+  int priority = 0;
+  // Maximum number of concurrent runs of the model.
+  int maxConcurrency = 1;
+  // Bind the symbols of the library and allocate its memory when it is
+  // loaded, see the ExecutionSession constructor.
+  bool warmup = true;
+  std::string entryPointName = "run_main_graph";
+};
+
+// Models loaded in one process and run by a fixed number of runner threads,
+// instead of one ExecutionSession with its own threads per model.
+//
+// The shared runtime library is loaded with its symbols global before the
+// models, so that the runtime functions of all the models resolve to it: the
+// models share one thread pool for their parallel loops and one pool of
+// runtime blocks, which the registry configures once, while their memory
+// arenas are kept apart. The model libraries are loaded with their symbols
+// local, a model never calls the functions of another one. Without the shared
+// runtime, each model runs with the runtime linked into its library, which
+// is configured when the model is loaded. A parallel loop started while the
+// pool is busy with another run is executed sequentially, as one runner is
+// usually enough to keep the pool busy.
+//
+// The requests are queued and run in the order of the priorities of their
+// models, the oldest first among equal priorities, such that a model never
+// has more than its concurrency limit of runs at a time. A model whose limit
+// is reached does not hold back the requests of the other models.
+class ModelRegistry {
+public:
+  // The thread pool shared by the models has numThreads threads, or its
+  // default size if numThreads is smaller than 1. The runtime is loaded from
+  // runtimeLibPath, searched in the library path when it is a file name.
+  ModelRegistry(int numRunners = 1, int numThreads = 0, bool pooling = true,
+      std::string runtimeLibPath = "libcruntime_shared.so");
+
+  // Load the model library under the given name. The models are only
+  // unloaded with the registry, the libraries being released all at once.
+  void load(const std::string &name, std::string sharedLibPath,
+      const ModelOptions &options = ModelOptions());
+
+  // Queue a request of the named model. The inputs are released once its run
+  // completes.
+  std::future<std::vector<OMTensorUniquePtr>> runAsync(
+      const std::string &name, std::vector<OMTensorUniquePtr> ins);
+
+  // Run the pending requests and stop the runner threads.
+  ~ModelRegistry();
+
+private:
+  struct Model {
+    std::unique_ptr<ExecutionSession> session;
+    ModelOptions options;
+    int running = 0;
+  };
+
+  struct Request {
+    Model *model;
+    std::vector<OMTensorUniquePtr> ins;
+    std::promise<std::vector<OMTensorUniquePtr>> outs;
+  };
+
+  // Configure the runtime with its omThreadPoolSetNumThreads and
+  // omAllocSetPooling functions, which may be null.
+  void configureRuntime(void *setNumThreads, void *setPooling);
+  void runLoop();
+
+  int _numThreads;
+  bool _pooling;
+  // Runtime shared by the models, invalid if it cannot be loaded.
+  llvm::sys::DynamicLibrary _runtime;
+
+  std::mutex _mutex;
+  std::condition_variable _requestReady;
+  std::map<std::string, Model> _models;
+  // Pending requests, by decreasing priority then arrival.
+  std::multimap<int, Request, std::greater<int>> _requests;
+  bool _stopping = false;
+  std::vector<std::thread> _runners;
+};
+} // namespace onnx_mlir
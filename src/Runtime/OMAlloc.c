@@ -0,0 +1,159 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------------- OMAlloc.c - OMAlloc C Implementation ----------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the block allocator of the
+// runtime.
+//
+// Blocks are rounded up to a power-of-two size class. Released blocks of the
+// classes up to OM_ALLOC_MAX_POOLED_SIZE are kept in a process-wide free list
+// per class, linked through their first bytes, and at most
+// OM_ALLOC_MAX_POOLED_BLOCKS blocks are kept per class. Larger blocks always
+// go to the system allocator.
+//
+//===----------------------------------------------------------------------===//
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMAlloc.h"
+
+/* Size classes from 64 bytes (class 0) to 16 MB (class 18) are pooled. */
+#define OM_ALLOC_MIN_SIZE_LOG2 6
+#define OM_ALLOC_NUM_CLASSES 19
+#define OM_ALLOC_MAX_POOLED_SIZE                                               \
+  ((int64_t)1 << (OM_ALLOC_MIN_SIZE_LOG2 + OM_ALLOC_NUM_CLASSES - 1))
+#define OM_ALLOC_MAX_POOLED_BLOCKS 16
+
+typedef struct OMFreeBlock {
+  struct OMFreeBlock *next;
+} OMFreeBlock;
+
+typedef struct {
+  OMFreeBlock *head;
+  int64_t numBlocks;
+} OMFreeList;
+
+static OMFreeList freeLists[OM_ALLOC_NUM_CLASSES];
+static volatile int pooling = 0;
+
+#ifdef _WIN32
+
+static SRWLOCK freeListsLock = SRWLOCK_INIT;
+
+static void lockFreeLists(void) { AcquireSRWLockExclusive(&freeListsLock); }
+static void unlockFreeLists(void) { ReleaseSRWLockExclusive(&freeListsLock); }
+
+#else
+
+static pthread_mutex_t freeListsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void lockFreeLists(void) { pthread_mutex_lock(&freeListsMutex); }
+static void unlockFreeLists(void) { pthread_mutex_unlock(&freeListsMutex); }
+
+#endif
+
+static void *alignedAlloc(int64_t size) {
+#ifdef _WIN32
+  return _aligned_malloc(size, OM_ALLOC_ALIGNMENT);
+#else
+  void *block = NULL;
+  if (posix_memalign(&block, OM_ALLOC_ALIGNMENT, size) != 0)
+    return NULL;
+  return block;
+#endif
+}
+
+static void alignedFree(void *block) {
+#ifdef _WIN32
+  _aligned_free(block);
+#else
+  free(block);
+#endif
+}
+
+/* Return the size class of a pooled size, -1 for the larger sizes. */
+static int getSizeClass(int64_t size) {
+  if (size > OM_ALLOC_MAX_POOLED_SIZE)
+    return -1;
+  int sizeClass = 0;
+  while (((int64_t)1 << (OM_ALLOC_MIN_SIZE_LOG2 + sizeClass)) < size)
+    ++sizeClass;
+  return sizeClass;
+}
+
+void omAllocSetPooling(int enable) { pooling = enable; }
+
+void *omAllocBlock(int64_t size) {
+  /* Zero-sized blocks still get a valid pointer. */
+  if (size < 1)
+    size = 1;
+  int sizeClass = getSizeClass(size);
+  if (sizeClass < 0)
+    return alignedAlloc(size);
+
+  if (pooling) {
+    lockFreeLists();
+    OMFreeBlock *block = freeLists[sizeClass].head;
+    if (block) {
+      freeLists[sizeClass].head = block->next;
+      --freeLists[sizeClass].numBlocks;
+    }
+    unlockFreeLists();
+    if (block)
+      return block;
+  }
+  /* Allocate the whole class so that the block can be pooled later on. */
+  return alignedAlloc((int64_t)1 << (OM_ALLOC_MIN_SIZE_LOG2 + sizeClass));
+}
+
+void omFreeBlock(void *block, int64_t size) {
+  if (!block)
+    return;
+  int sizeClass = getSizeClass(size < 1 ? 1 : size);
+  if (sizeClass >= 0 && pooling) {
+    lockFreeLists();
+    int pooled = freeLists[sizeClass].numBlocks < OM_ALLOC_MAX_POOLED_BLOCKS;
+    if (pooled) {
+      OMFreeBlock *freeBlock = (OMFreeBlock *)block;
+      freeBlock->next = freeLists[sizeClass].head;
+      freeLists[sizeClass].head = freeBlock;
+      ++freeLists[sizeClass].numBlocks;
+    }
+    unlockFreeLists();
+    if (pooled)
+      return;
+  }
+  alignedFree(block);
+}
+
+void omAllocRelease(void) {
+  lockFreeLists();
+  for (int i = 0; i < OM_ALLOC_NUM_CLASSES; ++i) {
+    OMFreeBlock *block = freeLists[i].head;
+    while (block) {
+      OMFreeBlock *next = block->next;
+      alignedFree(block);
+      block = next;
+    }
+    freeLists[i].head = NULL;
+    freeLists[i].numBlocks = 0;
+  }
+  unlockFreeLists();
+}
@@ -0,0 +1,284 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------------- OMArena.c - OMArena C Implementation ----------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the memory arenas holding the
+// memory pools of compiled models across inferences.
+//
+// Each arena is a buffer identified by a small integer assigned at compile
+// time, offset by the base reserved by its model at run time. Shared arenas
+// live in a process-wide table, thread-local arenas in a table owned by each
+// thread. Arenas holding dynamic memory pools keep the largest buffer
+// requested so far, and are only reallocated when a larger size is requested.
+// Buffers of at least 2MB are backed by huge pages when they are enabled, see
+// OMHugePages.h, and the buffers are placed on the NUMA node of the thread
+// allocating them when the NUMA placement is enabled, see OMNuma.h.
+//
+//===----------------------------------------------------------------------===//
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMArena.h"
+#include "onnx-mlir/Runtime/OMHugePages.h"
+#include "onnx-mlir/Runtime/OMNuma.h"
+
+/* Alignment of the buffers when none is requested. */
+#define OM_ARENA_DEFAULT_ALIGNMENT 16
+
+typedef struct {
+  void *buffer;
+  int64_t size;
+  int hugePages; /* buffer from omHugePagesAlloc */
+  int hugetlb;   /* buffer from the hugetlbfs pool */
+} OMArenaSlot;
+
+typedef struct {
+  OMArenaSlot *slots;
+  int64_t numSlots;
+} OMArenaTable;
+
+static void *alignedAlloc(int64_t size, int64_t alignment) {
+  if (alignment < OM_ARENA_DEFAULT_ALIGNMENT)
+    alignment = OM_ARENA_DEFAULT_ALIGNMENT;
+  /* Zero-sized pools still get a valid pointer. */
+  if (size < 1)
+    size = 1;
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  void *buffer = NULL;
+  if (posix_memalign(&buffer, alignment, size) != 0)
+    return NULL;
+  return buffer;
+#endif
+}
+
+static void alignedFree(void *buffer) {
+#ifdef _WIN32
+  _aligned_free(buffer);
+#else
+  free(buffer);
+#endif
+}
+
+/* Return the slot of the arena, growing the table if needed. */
+static OMArenaSlot *getSlot(OMArenaTable *table, int64_t id) {
+  if (id < 0)
+    return NULL;
+  if (id >= table->numSlots) {
+    int64_t numSlots = table->numSlots ? table->numSlots : 4;
+    while (numSlots <= id)
+      numSlots *= 2;
+    OMArenaSlot *slots =
+        (OMArenaSlot *)realloc(table->slots, numSlots * sizeof(OMArenaSlot));
+    if (!slots)
+      return NULL;
+    memset(slots + table->numSlots, 0,
+        (numSlots - table->numSlots) * sizeof(OMArenaSlot));
+    table->slots = slots;
+    table->numSlots = numSlots;
+  }
+  return &table->slots[id];
+}
+
+static void freeSlotBuffer(OMArenaSlot *slot) {
+  if (!slot->buffer)
+    return;
+  if (slot->hugePages)
+    omHugePagesFree(slot->buffer, slot->size, slot->hugetlb);
+  else
+    alignedFree(slot->buffer);
+  slot->buffer = NULL;
+}
+
+static void *getBuffer(OMArenaTable *table, int64_t id, int64_t size,
+    int64_t alignment, int zeroed) {
+  OMArenaSlot *slot = getSlot(table, id);
+  if (!slot)
+    return NULL;
+  if (!slot->buffer || size > slot->size) {
+    /* The content of the pool does not outlive a call, no need to copy it. */
+    freeSlotBuffer(slot);
+    /* Huge pages are aligned on 2MB, more than any pool requires. */
+    slot->buffer = omHugePagesAlloc(size, &slot->hugetlb);
+    slot->hugePages = slot->buffer != NULL;
+    if (!slot->buffer)
+      slot->buffer = alignedAlloc(size, alignment);
+    slot->size = slot->buffer ? size : 0;
+    /* Thread-local arenas are then next to the thread running the model. */
+    omNumaPreferLocal(slot->buffer, size);
+    if (zeroed && slot->buffer)
+      memset(slot->buffer, 0, size);
+  }
+  return slot->buffer;
+}
+
+static void releaseTable(OMArenaTable *table) {
+  for (int64_t i = 0; i < table->numSlots; ++i)
+    freeSlotBuffer(&table->slots[i]);
+  free(table->slots);
+  table->slots = NULL;
+  table->numSlots = 0;
+}
+
+/* Process-wide table of the shared arenas. */
+static OMArenaTable sharedTable = {NULL, 0};
+/* First identifier not reserved by a model, guarded by the shared lock. */
+static int64_t nextArenaId = 0;
+
+#ifdef _WIN32
+
+static SRWLOCK sharedLock = SRWLOCK_INIT;
+/* Thread-local arenas are not released at thread exit on Windows. */
+static __declspec(thread) OMArenaTable threadTable = {NULL, 0};
+
+static OMArenaTable *getThreadTable(int create) { return &threadTable; }
+
+static void lockShared(void) { AcquireSRWLockExclusive(&sharedLock); }
+static void unlockShared(void) { ReleaseSRWLockExclusive(&sharedLock); }
+
+static int64_t loadIdBase(int64_t *base) {
+  return (int64_t)InterlockedCompareExchange64(
+      (LONG64 volatile *)base, -1, -1);
+}
+static void storeIdBase(int64_t *base, int64_t value) {
+  InterlockedExchange64((LONG64 volatile *)base, value);
+}
+
+#else
+
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t threadTableKey;
+static pthread_once_t threadTableKeyOnce = PTHREAD_ONCE_INIT;
+
+static void destroyThreadTable(void *table) {
+  releaseTable((OMArenaTable *)table);
+  free(table);
+}
+
+static void createThreadTableKey(void) {
+  pthread_key_create(&threadTableKey, destroyThreadTable);
+}
+
+static OMArenaTable *getThreadTable(int create) {
+  pthread_once(&threadTableKeyOnce, createThreadTableKey);
+  OMArenaTable *table = (OMArenaTable *)pthread_getspecific(threadTableKey);
+  if (!table && create) {
+    table = (OMArenaTable *)calloc(1, sizeof(OMArenaTable));
+    if (table && pthread_setspecific(threadTableKey, table) != 0) {
+      free(table);
+      table = NULL;
+    }
+  }
+  return table;
+}
+
+static void lockShared(void) { pthread_mutex_lock(&sharedMutex); }
+static void unlockShared(void) { pthread_mutex_unlock(&sharedMutex); }
+
+/* The base is read by the models without the lock once it is reserved. */
+static int64_t loadIdBase(int64_t *base) {
+  return atomic_load((atomic_llong *)base);
+}
+static void storeIdBase(int64_t *base, int64_t value) {
+  atomic_store((atomic_llong *)base, value);
+}
+
+#endif
+
+static void *getArena(int64_t id, int64_t size, int64_t alignment,
+    int threadLocal, int zeroed) {
+  if (threadLocal) {
+    OMArenaTable *table = getThreadTable(/*create=*/1);
+    return table ? getBuffer(table, id, size, alignment, zeroed) : NULL;
+  }
+  lockShared();
+  void *buffer = getBuffer(&sharedTable, id, size, alignment, zeroed);
+  unlockShared();
+  return buffer;
+}
+
+void *omArenaGet(int64_t id, int64_t size, int64_t alignment, int threadLocal) {
+  return getArena(id, size, alignment, threadLocal, /*zeroed=*/0);
+}
+
+void *omArenaGetZeroed(
+    int64_t id, int64_t size, int64_t alignment, int threadLocal) {
+  return getArena(id, size, alignment, threadLocal, /*zeroed=*/1);
+}
+
+int64_t omArenaReserveIds(int64_t *base, int64_t numIds) {
+  int64_t reserved = loadIdBase(base);
+  if (reserved >= 0)
+    return reserved;
+  lockShared();
+  reserved = loadIdBase(base);
+  if (reserved < 0) {
+    reserved = nextArenaId;
+    nextArenaId += numIds;
+    storeIdBase(base, reserved);
+  }
+  unlockShared();
+  return reserved;
+}
+
+void omArenaRelease(void) {
+  lockShared();
+  releaseTable(&sharedTable);
+  unlockShared();
+  OMArenaTable *table = getThreadTable(/*create=*/0);
+  if (table)
+    releaseTable(table);
+}
+
+int64_t omArenaGetHighWaterMark(int64_t id, int threadLocal) {
+  int64_t size = 0;
+  if (threadLocal) {
+    OMArenaTable *table = getThreadTable(/*create=*/0);
+    if (table && id >= 0 && id < table->numSlots)
+      size = table->slots[id].size;
+    return size;
+  }
+  lockShared();
+  if (id >= 0 && id < sharedTable.numSlots)
+    size = sharedTable.slots[id].size;
+  unlockShared();
+  return size;
+}
+
+static int64_t getTotalSize(OMArenaTable *table) {
+  int64_t size = 0;
+  for (int64_t i = 0; i < table->numSlots; ++i)
+    size += table->slots[i].size;
+  return size;
+}
+
+int64_t omArenaGetTotalSize(int threadLocal) {
+  if (threadLocal) {
+    OMArenaTable *table = getThreadTable(/*create=*/0);
+    return table ? getTotalSize(table) : 0;
+  }
+  lockShared();
+  int64_t size = getTotalSize(&sharedTable);
+  unlockShared();
+  return size;
+}
@@ -0,0 +1,232 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------------- OMBatch.c - OMBatch C Implementation ----------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the inferences run in chunks of
+// their batch, for the models proven batch-separable at compile time.
+//
+// Each chunk of the inputs is a view of their rows, with their strides, so
+// that the inputs are not copied. The outputs of the first chunk give the
+// types and the shapes of the outputs of the whole batch, and the rows of the
+// outputs of each chunk are copied into them.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdatomic.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMBatch.h"
+#include "onnx-mlir/Runtime/OMTensor.h"
+
+/* Environment variable setting the size of the chunks. */
+#define OM_BATCH_CHUNK_SIZE_ENV "OM_BATCH_CHUNK_SIZE"
+
+typedef OMTensorList *(*OMRunFunction)(OMTensorList *);
+
+/* Left out of the header, see OMTensorList.inc. */
+extern OMTensorList *omTensorListCreateWithOwnership(
+    OMTensor **tensors, int n, int owning);
+
+#ifdef _WIN32
+
+/* -1 until set or read from the environment. */
+static volatile LONGLONG chunkSize = -1;
+
+static int64_t loadChunkSize(void) {
+  return (int64_t)InterlockedCompareExchange64(&chunkSize, -1, -1);
+}
+static void storeChunkSize(int64_t size) {
+  InterlockedExchange64(&chunkSize, size);
+}
+
+#else
+
+/* -1 until set or read from the environment. */
+static atomic_llong chunkSize = -1;
+
+static int64_t loadChunkSize(void) { return atomic_load(&chunkSize); }
+static void storeChunkSize(int64_t size) { atomic_store(&chunkSize, size); }
+
+#endif
+
+void omBatchSetChunkSize(int64_t size) { storeChunkSize(size > 0 ? size : 0); }
+
+int64_t omBatchGetChunkSize(void) {
+  int64_t size = loadChunkSize();
+  if (size < 0) {
+    const char *env = getenv(OM_BATCH_CHUNK_SIZE_ENV);
+    size = env ? atoll(env) : 0;
+    size = size > 0 ? size : 0;
+    storeChunkSize(size);
+  }
+  return size;
+}
+
+/* Return the first dimension shared by the tensors, -1 if they have none. */
+static int64_t getBatchSize(OMTensorList *list) {
+  int n = omTensorListGetSize(list);
+  int64_t batchSize = -1;
+  for (int i = 0; i < n; i++) {
+    OMTensor *tensor = omTensorListGetOmtByIndex(list, i);
+    if (!tensor || omTensorGetRank(tensor) < 1)
+      return -1;
+    int64_t dim = omTensorGetShape(tensor)[0];
+    if (i > 0 && dim != batchSize)
+      return -1;
+    batchSize = dim;
+  }
+  return batchSize;
+}
+
+/* Number of bytes of a row of the tensor along its first dimension. */
+static int64_t getRowBytes(OMTensor *tensor) {
+  int64_t bytes = getDataTypeSize(omTensorGetDataType(tensor));
+  int64_t *shape = omTensorGetShape(tensor);
+  for (int i = 1; i < omTensorGetRank(tensor); i++)
+    bytes *= shape[i];
+  return bytes;
+}
+
+/* Return views of the rows [start, start + size) of the inputs. */
+static OMTensorList *createChunk(
+    OMTensorList *inputs, int64_t start, int64_t size) {
+  int n = omTensorListGetSize(inputs);
+  OMTensor **views = (OMTensor **)calloc(n, sizeof(OMTensor *));
+  if (!views)
+    return NULL;
+  for (int i = 0; i < n; i++) {
+    OMTensor *input = omTensorListGetOmtByIndex(inputs, i);
+    int64_t rank = omTensorGetRank(input);
+    int64_t *strides = omTensorGetStrides(input);
+    int64_t *shape = (int64_t *)malloc(rank * sizeof(int64_t));
+    if (shape) {
+      memcpy(shape, omTensorGetShape(input), rank * sizeof(int64_t));
+      shape[0] = size;
+      OM_DATA_TYPE dtype = omTensorGetDataType(input);
+      char *data = (char *)omTensorGetDataPtr(input) +
+                   start * strides[0] * getDataTypeSize(dtype);
+      views[i] = omTensorCreate(data, shape, rank, dtype);
+      free(shape);
+    }
+    if (!views[i]) {
+      for (int j = 0; j < i; j++)
+        omTensorDestroy(views[j]);
+      free(views);
+      return NULL;
+    }
+    omTensorSetStrides(views[i], strides);
+  }
+  OMTensorList *chunk = omTensorListCreateWithOwnership(views, n, 1);
+  if (!chunk) {
+    for (int i = 0; i < n; i++)
+      omTensorDestroy(views[i]);
+    free(views);
+  }
+  return chunk;
+}
+
+/* Return outputs of the whole batch of the types and shapes of the outputs of
+ * a chunk.
+ */
+static OMTensorList *createOutputs(OMTensorList *chunkOutputs, int64_t batch) {
+  int n = omTensorListGetSize(chunkOutputs);
+  OMTensor **tensors = (OMTensor **)calloc(n, sizeof(OMTensor *));
+  if (!tensors)
+    return NULL;
+  for (int i = 0; i < n; i++) {
+    OMTensor *chunkOutput = omTensorListGetOmtByIndex(chunkOutputs, i);
+    int64_t rank = omTensorGetRank(chunkOutput);
+    int64_t *shape = (int64_t *)malloc(rank * sizeof(int64_t));
+    if (shape) {
+      memcpy(shape, omTensorGetShape(chunkOutput), rank * sizeof(int64_t));
+      shape[0] = batch;
+      tensors[i] =
+          omTensorCreateEmpty(shape, rank, omTensorGetDataType(chunkOutput));
+      free(shape);
+    }
+    if (!tensors[i]) {
+      for (int j = 0; j < i; j++)
+        omTensorDestroy(tensors[j]);
+      free(tensors);
+      return NULL;
+    }
+  }
+  OMTensorList *outputs = omTensorListCreateWithOwnership(tensors, n, 1);
+  if (!outputs) {
+    for (int i = 0; i < n; i++)
+      omTensorDestroy(tensors[i]);
+    free(tensors);
+  }
+  return outputs;
+}
+
+/* Copy the outputs of a chunk into the rows [start, start + rows) of the
+ * outputs.
+ */
+static int copyChunkOutputs(OMTensorList *outputs, OMTensorList *chunkOutputs,
+    int64_t start, int64_t rows) {
+  int n = omTensorListGetSize(outputs);
+  if (omTensorListGetSize(chunkOutputs) != n)
+    return -1;
+  for (int i = 0; i < n; i++) {
+    OMTensor *output = omTensorListGetOmtByIndex(outputs, i);
+    OMTensor *chunkOutput = omTensorListGetOmtByIndex(chunkOutputs, i);
+    int64_t rank = omTensorGetRank(output);
+    if (omTensorGetRank(chunkOutput) != rank ||
+        omTensorGetDataType(chunkOutput) != omTensorGetDataType(output) ||
+        getRowBytes(chunkOutput) != getRowBytes(output) ||
+        omTensorGetShape(chunkOutput)[0] != rows)
+      return -1;
+    OMTensor *contiguous = omTensorGetContiguous(chunkOutput);
+    if (!contiguous)
+      return -1;
+    int64_t rowBytes = getRowBytes(output);
+    memcpy((char *)omTensorGetDataPtr(output) + start * rowBytes,
+        omTensorGetDataPtr(contiguous),
+        rows * rowBytes);
+    omTensorReleaseContiguous(contiguous, chunkOutput);
+  }
+  return 0;
+}
+
+OMTensorList *omBatchRunInChunks(void *run, OMTensorList *inputs) {
+  OMRunFunction runFunction = (OMRunFunction)run;
+  int64_t size = omBatchGetChunkSize();
+  int64_t batch = size > 0 && inputs ? getBatchSize(inputs) : -1;
+  if (batch <= size)
+    return runFunction(inputs);
+
+  OMTensorList *outputs = NULL;
+  for (int64_t start = 0; start < batch; start += size) {
+    int64_t rows = batch - start < size ? batch - start : size;
+    OMTensorList *chunk = createChunk(inputs, start, rows);
+    OMTensorList *chunkOutputs = chunk ? runFunction(chunk) : NULL;
+    if (chunk)
+      omTensorListDestroy(chunk);
+    if (chunkOutputs && !outputs)
+      outputs = createOutputs(chunkOutputs, batch);
+    int status = chunkOutputs && outputs
+                     ? copyChunkOutputs(outputs, chunkOutputs, start, rows)
+                     : -1;
+    if (chunkOutputs)
+      omTensorListDestroy(chunkOutputs);
+    if (status != 0) {
+      if (outputs)
+        omTensorListDestroy(outputs);
+      return NULL;
+    }
+  }
+  return outputs;
+}
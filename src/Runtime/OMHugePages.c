@@ -0,0 +1,141 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ OMHugePages.c - OMHugePages C Implementation ------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the buffers backed by huge pages
+// for the memory arenas and the weights of compiled models.
+//
+// Buffers are first mapped from the hugetlbfs pool with MAP_HUGETLB. When the
+// pool has no free pages, they are mapped on a 2MB boundary, the transparent
+// huge pages only backing aligned ranges, and advised with MADV_HUGEPAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <stdatomic.h>
+#include <sys/mman.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMHugePages.h"
+
+/* Size of the huge pages. */
+#define OM_HUGE_PAGE_SIZE ((int64_t)2 << 20)
+/* Environment variable enabling the huge pages. */
+#define OM_HUGE_PAGES_ENV "OM_HUGE_PAGES"
+
+#ifdef __linux__
+
+/* -1 until set or read from the environment. */
+static atomic_int hugePagesEnabled = -1;
+static atomic_llong hugetlbBytesAllocated = 0;
+static atomic_llong advisedBytesAllocated = 0;
+
+static int64_t roundUpToHugePage(int64_t size) {
+  return (size + OM_HUGE_PAGE_SIZE - 1) & ~(OM_HUGE_PAGE_SIZE - 1);
+}
+
+int omHugePagesSetEnabled(int enable) {
+  atomic_store(&hugePagesEnabled, enable ? 1 : 0);
+  return 0;
+}
+
+int omHugePagesGetEnabled(void) {
+  int enabled = atomic_load(&hugePagesEnabled);
+  if (enabled < 0) {
+    const char *env = getenv(OM_HUGE_PAGES_ENV);
+    enabled = env && atoi(env) > 0;
+    atomic_store(&hugePagesEnabled, enabled);
+  }
+  return enabled;
+}
+
+void omHugePagesGetStats(int64_t *hugetlbBytes, int64_t *advisedBytes) {
+  if (hugetlbBytes)
+    *hugetlbBytes = atomic_load(&hugetlbBytesAllocated);
+  if (advisedBytes)
+    *advisedBytes = atomic_load(&advisedBytesAllocated);
+}
+
+void *omHugePagesAlloc(int64_t size, int *hugetlb) {
+  if (!omHugePagesGetEnabled() || size < OM_HUGE_PAGE_SIZE)
+    return NULL;
+  int64_t mappedSize = roundUpToHugePage(size);
+
+#ifdef MAP_HUGETLB
+  void *buffer = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (buffer != MAP_FAILED) {
+    *hugetlb = 1;
+    atomic_fetch_add(&hugetlbBytesAllocated, mappedSize);
+    return buffer;
+  }
+#endif
+
+#ifdef MADV_HUGEPAGE
+  /* Map one more huge page and trim the mapping to an aligned range. */
+  int64_t rawSize = mappedSize + OM_HUGE_PAGE_SIZE;
+  char *raw = (char *)mmap(NULL, rawSize, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    return NULL;
+  char *aligned = (char *)roundUpToHugePage((int64_t)(uintptr_t)raw);
+  if (aligned > raw)
+    munmap(raw, aligned - raw);
+  char *end = aligned + mappedSize;
+  if (end < raw + rawSize)
+    munmap(end, raw + rawSize - end);
+  if (madvise(aligned, mappedSize, MADV_HUGEPAGE) != 0) {
+    /* Transparent huge pages are disabled. */
+    munmap(aligned, mappedSize);
+    return NULL;
+  }
+  *hugetlb = 0;
+  atomic_fetch_add(&advisedBytesAllocated, mappedSize);
+  return aligned;
+#else
+  return NULL;
+#endif
+}
+
+void omHugePagesFree(void *buffer, int64_t size, int hugetlb) {
+  if (!buffer)
+    return;
+  int64_t mappedSize = roundUpToHugePage(size);
+  munmap(buffer, mappedSize);
+  atomic_fetch_sub(
+      hugetlb ? &hugetlbBytesAllocated : &advisedBytesAllocated, mappedSize);
+}
+
+#else
+
+/* Huge pages are only supported on Linux for now. */
+
+int omHugePagesSetEnabled(int enable) { return enable ? -1 : 0; }
+
+int omHugePagesGetEnabled(void) { return 0; }
+
+void omHugePagesGetStats(int64_t *hugetlbBytes, int64_t *advisedBytes) {
+  if (hugetlbBytes)
+    *hugetlbBytes = 0;
+  if (advisedBytes)
+    *advisedBytes = 0;
+}
+
+void *omHugePagesAlloc(int64_t size, int *hugetlb) { return NULL; }
+
+void omHugePagesFree(void *buffer, int64_t size, int hugetlb) {}
+
+#endif
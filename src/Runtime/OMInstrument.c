@@ -0,0 +1,462 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ OMInstrument.c - OMInstrument C Implementation ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the profiler of the ONNX
+// operations of the models compiled with `--instrument`.
+//
+// The start times of the operations running on a thread are kept on a stack
+// local to that thread, so that operations nested in the body of a Loop are
+// timed as well. The completed operations are appended to a process-wide
+// array under a lock, which is only taken once per operation.
+//
+// On Linux, the hardware performance counters of the calling thread are also
+// read at the start and at the end of each operation when enabled. Each
+// thread opens its own group of counters with perf_event_open on its first
+// operation, so that they are read with a single system call.
+//
+//===----------------------------------------------------------------------===//
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* For syscall. */
+#define _GNU_SOURCE
+#elif !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMInstrument.h"
+
+/* Environment variable enabling the profiling. */
+#define OM_INSTRUMENT_ENV "OM_INSTRUMENT"
+/* Environment variable enabling the hardware performance counters. */
+#define OM_INSTRUMENT_COUNTERS_ENV "OM_INSTRUMENT_COUNTERS"
+/* Environment variable giving the raw event counting vector instructions. */
+#define OM_INSTRUMENT_VECTOR_EVENT_ENV "OM_INSTRUMENT_VECTOR_EVENT"
+/* Depth of the operations nested on a thread that are timed. */
+#define OM_INSTRUMENT_MAX_DEPTH 64
+/* Cycles, instructions, last level cache misses and vector instructions. */
+#define OM_INSTRUMENT_NUM_COUNTERS 4
+
+typedef struct {
+  const char *opName;
+  const char *nodeName;
+  int thread;
+  int64_t startNs;
+  int64_t durationNs;
+  int64_t outputBytes;
+  /* -1 for the counters that are not read. */
+  int64_t counters[OM_INSTRUMENT_NUM_COUNTERS];
+} OMInstrumentRecord;
+
+static OMInstrumentRecord *records = NULL;
+static int64_t numRecords = 0;
+static int64_t maxRecords = 0;
+static int numThreads = 0;
+
+#ifdef _WIN32
+
+/* -1 until set or read from the environment. */
+static volatile LONG instrumentEnabled = -1;
+static SRWLOCK recordsLock = SRWLOCK_INIT;
+static __declspec(thread) int64_t startTimes[OM_INSTRUMENT_MAX_DEPTH];
+static __declspec(thread) int depth = 0;
+static __declspec(thread) int threadId = -1;
+
+static int loadEnabled(void) {
+  return (int)InterlockedCompareExchange(&instrumentEnabled, -1, -1);
+}
+static void storeEnabled(int enabled) {
+  InterlockedExchange(&instrumentEnabled, enabled);
+}
+
+static void lockRecords(void) { AcquireSRWLockExclusive(&recordsLock); }
+static void unlockRecords(void) { ReleaseSRWLockExclusive(&recordsLock); }
+
+static int64_t getTimeNs(void) {
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (int64_t)((double)counter.QuadPart * 1e9 / frequency.QuadPart);
+}
+
+#else
+
+/* -1 until set or read from the environment. */
+static atomic_int instrumentEnabled = -1;
+static pthread_mutex_t recordsMutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local int64_t startTimes[OM_INSTRUMENT_MAX_DEPTH];
+static _Thread_local int depth = 0;
+static _Thread_local int threadId = -1;
+
+static int loadEnabled(void) { return atomic_load(&instrumentEnabled); }
+static void storeEnabled(int enabled) {
+  atomic_store(&instrumentEnabled, enabled);
+}
+
+static void lockRecords(void) { pthread_mutex_lock(&recordsMutex); }
+static void unlockRecords(void) { pthread_mutex_unlock(&recordsMutex); }
+
+static int64_t getTimeNs(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+#endif
+
+#ifdef __linux__
+
+/* -1 until set or read from the environment. */
+static atomic_int countersEnabled = -1;
+/* 0 when no vector instruction event is given. */
+static _Atomic uint64_t vectorEvent = 0;
+
+/* Group of the counters of the thread, -2 until opened and -1 if they
+ * cannot be opened, e.g. when perf_event_paranoid forbids it. */
+static _Thread_local int counterGroup = -2;
+/* Position of each counter in the values read from the group, -1 for the
+ * counters not supported by the processor. */
+static _Thread_local int counterPositions[OM_INSTRUMENT_NUM_COUNTERS];
+static _Thread_local int64_t startCounters[OM_INSTRUMENT_MAX_DEPTH]
+                                          [OM_INSTRUMENT_NUM_COUNTERS];
+
+static int openCounter(uint32_t type, uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  /* Only the user code of the model is counted, which unprivileged
+   * processes are allowed to do by default. */
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, /*pid=*/0, /*cpu=*/-1,
+      group, /*flags=*/0);
+}
+
+static void openCounterGroup(void) {
+  uint64_t vectorConfig = atomic_load(&vectorEvent);
+  const char *env = getenv(OM_INSTRUMENT_VECTOR_EVENT_ENV);
+  if (vectorConfig == 0 && env)
+    vectorConfig = strtoull(env, NULL, 0);
+  uint32_t types[OM_INSTRUMENT_NUM_COUNTERS] = {PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_RAW};
+  uint64_t configs[OM_INSTRUMENT_NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, vectorConfig};
+  int numOpened = 0;
+  counterGroup = -1;
+  for (int i = 0; i < OM_INSTRUMENT_NUM_COUNTERS; ++i) {
+    counterPositions[i] = -1;
+    if (types[i] == PERF_TYPE_RAW && vectorConfig == 0)
+      continue;
+    int fd = openCounter(types[i], configs[i], counterGroup);
+    if (fd < 0)
+      continue;
+    /* The first counter opened leads the group. */
+    if (counterGroup < 0)
+      counterGroup = fd;
+    counterPositions[i] = numOpened++;
+  }
+}
+
+/* Read the counters of the thread, -1 for the ones that are not counted. */
+static void readCounters(int64_t counters[OM_INSTRUMENT_NUM_COUNTERS]) {
+  for (int i = 0; i < OM_INSTRUMENT_NUM_COUNTERS; ++i)
+    counters[i] = -1;
+  if (counterGroup == -2)
+    openCounterGroup();
+  if (counterGroup < 0)
+    return;
+  uint64_t values[1 + OM_INSTRUMENT_NUM_COUNTERS];
+  if (read(counterGroup, values, sizeof(values)) < (ssize_t)sizeof(uint64_t))
+    return;
+  for (int i = 0; i < OM_INSTRUMENT_NUM_COUNTERS; ++i)
+    if (counterPositions[i] >= 0 && (uint64_t)counterPositions[i] < values[0])
+      counters[i] = (int64_t)values[1 + counterPositions[i]];
+}
+
+#endif
+
+void omInstrumentSetEnabled(int enable) { storeEnabled(enable ? 1 : 0); }
+
+int omInstrumentGetEnabled(void) {
+  int enabled = loadEnabled();
+  if (enabled < 0) {
+    const char *env = getenv(OM_INSTRUMENT_ENV);
+    enabled = env && atoi(env) > 0;
+    storeEnabled(enabled);
+  }
+  return enabled;
+}
+
+void omInstrumentReset(void) {
+  lockRecords();
+  free(records);
+  records = NULL;
+  numRecords = 0;
+  maxRecords = 0;
+  unlockRecords();
+}
+
+int omInstrumentSetCounters(int enable) {
+#ifdef __linux__
+  atomic_store(&countersEnabled, enable ? 1 : 0);
+  return 0;
+#else
+  return enable ? -1 : 0;
+#endif
+}
+
+int omInstrumentGetCounters(void) {
+#ifdef __linux__
+  int enabled = atomic_load(&countersEnabled);
+  if (enabled < 0) {
+    const char *env = getenv(OM_INSTRUMENT_COUNTERS_ENV);
+    enabled = env && atoi(env) > 0;
+    atomic_store(&countersEnabled, enabled);
+  }
+  return enabled;
+#else
+  return 0;
+#endif
+}
+
+void omInstrumentSetVectorEvent(uint64_t rawEvent) {
+#ifdef __linux__
+  atomic_store(&vectorEvent, rawEvent);
+#endif
+}
+
+int64_t omInstrumentGetNumRecords(void) {
+  lockRecords();
+  int64_t count = numRecords;
+  unlockRecords();
+  return count;
+}
+
+void omInstrumentGetMemoryPoolStats(OMMemoryPoolStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  /* The records are in the order of the ends of the allocations and
+   * deallocations, which gives the memory in use after each of them. */
+  int64_t liveBytes = 0;
+  lockRecords();
+  for (int64_t i = 0; i < numRecords; ++i) {
+    const OMInstrumentRecord *record = &records[i];
+    if (strcmp(record->opName, "MemoryPoolFree") == 0) {
+      liveBytes -= record->outputBytes;
+      stats->durationNs += record->durationNs;
+      continue;
+    }
+    if (strcmp(record->opName, "MemoryPool") != 0)
+      continue;
+    stats->numAllocations++;
+    stats->totalBytes += record->outputBytes;
+    if (strncmp(record->nodeName, "dynamic", 7) == 0)
+      stats->dynamicBytes += record->outputBytes;
+    if (record->outputBytes > stats->maxBytes)
+      stats->maxBytes = record->outputBytes;
+    liveBytes += record->outputBytes;
+    if (liveBytes > stats->peakBytes)
+      stats->peakBytes = liveBytes;
+    stats->durationNs += record->durationNs;
+  }
+  unlockRecords();
+}
+
+static void addRecord(const char *opName, const char *nodeName,
+    int64_t startNs, int64_t durationNs, int64_t outputBytes,
+    const int64_t counters[OM_INSTRUMENT_NUM_COUNTERS]) {
+  lockRecords();
+  if (numRecords == maxRecords) {
+    int64_t newMaxRecords = maxRecords ? 2 * maxRecords : 1024;
+    OMInstrumentRecord *newRecords = (OMInstrumentRecord *)realloc(
+        records, newMaxRecords * sizeof(OMInstrumentRecord));
+    if (!newRecords) {
+      unlockRecords();
+      return;
+    }
+    records = newRecords;
+    maxRecords = newMaxRecords;
+  }
+  /* Threads are numbered in the order of their first operation. */
+  if (threadId < 0)
+    threadId = numThreads++;
+  OMInstrumentRecord *record = &records[numRecords++];
+  record->opName = opName;
+  record->nodeName = nodeName;
+  record->thread = threadId;
+  record->startNs = startNs;
+  record->durationNs = durationNs;
+  record->outputBytes = outputBytes;
+  memcpy(record->counters, counters, sizeof(record->counters));
+  unlockRecords();
+}
+
+void omInstrumentPoint(const char *opName, const char *nodeName, int64_t tag,
+    int64_t outputBytes) {
+  int64_t counters[OM_INSTRUMENT_NUM_COUNTERS] = {-1, -1, -1, -1};
+  if (tag == 0) {
+    /* A start time of 0 marks the operations that are not recorded, so that
+     * enabling the profiling in the middle of an operation is harmless. */
+    if (depth < OM_INSTRUMENT_MAX_DEPTH) {
+      int enabled = omInstrumentGetEnabled();
+#ifdef __linux__
+      if (enabled && omInstrumentGetCounters())
+        readCounters(counters);
+      memcpy(startCounters[depth], counters, sizeof(counters));
+#endif
+      /* The counters are read first so that they do not count the clock. */
+      startTimes[depth] = enabled ? getTimeNs() : 0;
+    }
+    ++depth;
+    return;
+  }
+  if (depth == 0)
+    return;
+  --depth;
+  if (depth >= OM_INSTRUMENT_MAX_DEPTH || startTimes[depth] == 0 ||
+      !omInstrumentGetEnabled())
+    return;
+  int64_t startNs = startTimes[depth];
+  int64_t durationNs = getTimeNs() - startNs;
+#ifdef __linux__
+  if (startCounters[depth][0] != -1 || startCounters[depth][1] != -1 ||
+      startCounters[depth][2] != -1 || startCounters[depth][3] != -1) {
+    readCounters(counters);
+    for (int i = 0; i < OM_INSTRUMENT_NUM_COUNTERS; ++i)
+      if (counters[i] >= 0 && startCounters[depth][i] >= 0)
+        counters[i] -= startCounters[depth][i];
+      else
+        counters[i] = -1;
+  }
+#endif
+  addRecord(opName, nodeName, startNs, durationNs, outputBytes, counters);
+}
+
+/* Write the string with the characters escaped for JSON. */
+static void writeJsonString(FILE *file, const char *str) {
+  fputc('"', file);
+  for (const unsigned char *c = (const unsigned char *)str; *c; ++c) {
+    if (*c == '"' || *c == '\\')
+      fprintf(file, "\\%c", *c);
+    else if (*c < 0x20)
+      fprintf(file, "\\u%04x", *c);
+    else
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+/* Write the string as a CSV field, quoted when needed. */
+static void writeCsvString(FILE *file, const char *str) {
+  if (!strpbrk(str, ",\"\n")) {
+    fputs(str, file);
+    return;
+  }
+  fputc('"', file);
+  for (const char *c = str; *c; ++c) {
+    if (*c == '"')
+      fputc('"', file);
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+int omInstrumentDump(const char *path, OMInstrumentFormat format) {
+  FILE *file = path ? fopen(path, "w") : stdout;
+  if (!file)
+    return -1;
+
+  static const char *counterNames[OM_INSTRUMENT_NUM_COUNTERS] = {
+      "cycles", "instructions", "llc_misses", "vector_instructions"};
+
+  lockRecords();
+  int64_t baseNs = 0;
+  /* The counter columns are only written when some counter was read. */
+  int hasCounters = 0;
+  for (int64_t i = 0; i < numRecords; ++i) {
+    if (i == 0 || records[i].startNs < baseNs)
+      baseNs = records[i].startNs;
+    for (int c = 0; c < OM_INSTRUMENT_NUM_COUNTERS; ++c)
+      hasCounters |= records[i].counters[c] != -1;
+  }
+
+  if (format == OM_INSTRUMENT_CHROME_TRACE) {
+    /* Complete events, whose times are in microseconds. */
+    fputs("{\"traceEvents\":[", file);
+    for (int64_t i = 0; i < numRecords; ++i) {
+      const OMInstrumentRecord *record = &records[i];
+      fputs(i ? ",\n" : "\n", file);
+      fputs("{\"name\":", file);
+      writeJsonString(file, record->opName);
+      fprintf(file,
+          ",\"cat\":\"onnx\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+          "\"pid\":0,\"tid\":%d,\"args\":{\"node\":",
+          (record->startNs - baseNs) / 1e3, record->durationNs / 1e3,
+          record->thread);
+      writeJsonString(file, record->nodeName);
+      fprintf(file, ",\"output_bytes\":%" PRId64, record->outputBytes);
+      for (int c = 0; c < OM_INSTRUMENT_NUM_COUNTERS; ++c)
+        if (record->counters[c] != -1)
+          fprintf(file, ",\"%s\":%" PRId64, counterNames[c],
+              record->counters[c]);
+      fputs("}}", file);
+    }
+    fputs("\n]}\n", file);
+  } else {
+    fputs("op,node,thread,start_ns,duration_ns,output_bytes", file);
+    for (int c = 0; hasCounters && c < OM_INSTRUMENT_NUM_COUNTERS; ++c)
+      fprintf(file, ",%s", counterNames[c]);
+    fputc('\n', file);
+    for (int64_t i = 0; i < numRecords; ++i) {
+      const OMInstrumentRecord *record = &records[i];
+      writeCsvString(file, record->opName);
+      fputc(',', file);
+      writeCsvString(file, record->nodeName);
+      fprintf(file, ",%d,%" PRId64 ",%" PRId64 ",%" PRId64, record->thread,
+          record->startNs - baseNs, record->durationNs, record->outputBytes);
+      /* The counters that are not read are left empty. */
+      for (int c = 0; hasCounters && c < OM_INSTRUMENT_NUM_COUNTERS; ++c)
+        if (record->counters[c] != -1)
+          fprintf(file, ",%" PRId64, record->counters[c]);
+        else
+          fputc(',', file);
+      fputc('\n', file);
+    }
+  }
+  unlockRecords();
+
+  int result = ferror(file) ? -1 : 0;
+  if (path && fclose(file) != 0)
+    result = -1;
+  else if (!path)
+    fflush(file);
+  return result;
+}
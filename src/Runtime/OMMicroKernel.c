@@ -0,0 +1,131 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------- OMMicroKernel.c - OMMicroKernel C Implementation ---------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the matrix multiply microkernels
+// called by compiled models for the register tiles of their matrix
+// multiplies.
+//
+// The kernels follow the BLIS microkernels: the tile of C is held in vector
+// registers, one or two 8-float vectors per row, and updated with a column
+// of A broadcast against a row of B for each k. They are written with the
+// vector extensions of GCC and Clang, and the number of rows is a constant
+// of each specialization, so that they compile to AVX2 (two 4-wide halves
+// for SSE), AVX-512 or NEON code without spilling, whatever the target of
+// the runtime. Other compilers use the generic loop nest.
+//
+//===----------------------------------------------------------------------===//
+
+#include <string.h>
+
+#include "onnx-mlir/Runtime/OMMicroKernel.h"
+
+/* Generic loop nest, also used for the tiles without tuned kernel. */
+static void matmulGeneric(int64_t I, int64_t J, int64_t K, const float *A,
+    int64_t lda, const float *B, int64_t ldb, float *C, int64_t ldc) {
+  for (int64_t i = 0; i < I; ++i)
+    for (int64_t k = 0; k < K; ++k) {
+      float a = A[i * lda + k];
+      for (int64_t j = 0; j < J; ++j)
+        C[i * ldc + j] += a * B[k * ldb + j];
+    }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+
+#define OM_ALWAYS_INLINE inline __attribute__((always_inline))
+
+typedef float omV8f __attribute__((vector_size(32)));
+
+/* Unaligned loads and stores, the rows of the tiles being arbitrary. */
+#define OM_LOAD_V8F(vec, ptr) memcpy(&(vec), (ptr), sizeof(omV8f))
+#define OM_STORE_V8F(ptr, vec) memcpy((ptr), &(vec), sizeof(omV8f))
+
+/* Tile of `rows` x 8, `rows` being a constant once inlined. */
+static OM_ALWAYS_INLINE void kernelx8(int64_t rows, int64_t K, const float *A,
+    int64_t lda, const float *B, int64_t ldb, float *C, int64_t ldc) {
+  omV8f acc[OM_MICRO_KERNEL_MAX_ROWS];
+  for (int64_t i = 0; i < rows; ++i)
+    OM_LOAD_V8F(acc[i], C + i * ldc);
+  for (int64_t k = 0; k < K; ++k) {
+    omV8f b;
+    OM_LOAD_V8F(b, B + k * ldb);
+    for (int64_t i = 0; i < rows; ++i)
+      acc[i] += A[i * lda + k] * b;
+  }
+  for (int64_t i = 0; i < rows; ++i)
+    OM_STORE_V8F(C + i * ldc, acc[i]);
+}
+
+/* Tile of `rows` x 16, with two vectors per row. */
+static OM_ALWAYS_INLINE void kernelx16(int64_t rows, int64_t K,
+    const float *A, int64_t lda, const float *B, int64_t ldb, float *C,
+    int64_t ldc) {
+  omV8f acc0[OM_MICRO_KERNEL_MAX_ROWS], acc1[OM_MICRO_KERNEL_MAX_ROWS];
+  for (int64_t i = 0; i < rows; ++i) {
+    OM_LOAD_V8F(acc0[i], C + i * ldc);
+    OM_LOAD_V8F(acc1[i], C + i * ldc + 8);
+  }
+  for (int64_t k = 0; k < K; ++k) {
+    omV8f b0, b1;
+    OM_LOAD_V8F(b0, B + k * ldb);
+    OM_LOAD_V8F(b1, B + k * ldb + 8);
+    for (int64_t i = 0; i < rows; ++i) {
+      float a = A[i * lda + k];
+      acc0[i] += a * b0;
+      acc1[i] += a * b1;
+    }
+  }
+  for (int64_t i = 0; i < rows; ++i) {
+    OM_STORE_V8F(C + i * ldc, acc0[i]);
+    OM_STORE_V8F(C + i * ldc + 8, acc1[i]);
+  }
+}
+
+#define OM_KERNEL_CASE(kernel, rows)                                           \
+  case rows:                                                                   \
+    kernel(rows, K, A, lda, B, ldb, C, ldc);                                   \
+    return
+
+void omMatmulMicroKernelF32(int64_t I, int64_t J, int64_t K, const float *A,
+    int64_t lda, const float *B, int64_t ldb, float *C, int64_t ldc) {
+  if (J == 8) {
+    switch (I) {
+      OM_KERNEL_CASE(kernelx8, 1);
+      OM_KERNEL_CASE(kernelx8, 2);
+      OM_KERNEL_CASE(kernelx8, 3);
+      OM_KERNEL_CASE(kernelx8, 4);
+      OM_KERNEL_CASE(kernelx8, 5);
+      OM_KERNEL_CASE(kernelx8, 6);
+      OM_KERNEL_CASE(kernelx8, 7);
+      OM_KERNEL_CASE(kernelx8, 8);
+    }
+  } else if (J == 16) {
+    switch (I) {
+      OM_KERNEL_CASE(kernelx16, 1);
+      OM_KERNEL_CASE(kernelx16, 2);
+      OM_KERNEL_CASE(kernelx16, 3);
+      OM_KERNEL_CASE(kernelx16, 4);
+      OM_KERNEL_CASE(kernelx16, 5);
+      OM_KERNEL_CASE(kernelx16, 6);
+      OM_KERNEL_CASE(kernelx16, 7);
+      OM_KERNEL_CASE(kernelx16, 8);
+    }
+  }
+  matmulGeneric(I, J, K, A, lda, B, ldb, C, ldc);
+}
+
+#else
+
+void omMatmulMicroKernelF32(int64_t I, int64_t J, int64_t K, const float *A,
+    int64_t lda, const float *B, int64_t ldb, float *C, int64_t ldc) {
+  matmulGeneric(I, J, K, A, lda, B, ldb, C, ldc);
+}
+
+#endif
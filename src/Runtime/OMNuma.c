@@ -0,0 +1,324 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------------- OMNuma.c - OMNuma C Implementation ---------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the NUMA placement of the weights,
+// the memory arenas and the worker threads of compiled models.
+//
+// The nodes and their CPUs are read from /sys/devices/system/node, and the
+// memory is placed with the mbind system call, so that the runtime does not
+// depend on libnuma. The replicas of the weights are registered in a small
+// table that is only appended to, and read without locking by the models.
+// Each model library embeds its own runtime, and thus its own table, so the
+// replicas are created by the calls of the model itself.
+//
+//===----------------------------------------------------------------------===//
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMHugePages.h"
+#include "onnx-mlir/Runtime/OMNuma.h"
+#include "onnx-mlir/Runtime/OMThreadPool.h"
+
+/* Environment variable enabling the NUMA placement. */
+#define OM_NUMA_ENV "OM_NUMA"
+
+#if defined(__linux__) && defined(SYS_mbind)
+
+#define OM_NUMA_MAX_NODES 64
+#define OM_NUMA_MAX_CPUS 4096
+/* Number of CPUs the thread pool can be pinned to, see OMThreadPool.c. */
+#define OM_NUMA_MAX_POOL_CPUS 256
+/* Number of weights files that can be replicated. */
+#define OM_NUMA_MAX_REPLICATED 16
+#define OM_NUMA_SYSFS "/sys/devices/system/node"
+
+/* Memory policies of mbind, see linux/mempolicy.h. */
+#define OM_MPOL_PREFERRED 1
+#define OM_MPOL_BIND 2
+
+typedef struct {
+  const void *data;
+  int64_t size;
+  void *replicas[OM_NUMA_MAX_NODES];
+  int hugetlb[OM_NUMA_MAX_NODES];
+} OMNumaReplicated;
+
+/* -1 until set or read from the environment. */
+static atomic_int numaEnabled = -1;
+
+/* Topology, read once. The nodes are numbered by their rank in the list of
+ * the online nodes, which may not be contiguous. */
+static pthread_once_t topologyOnce = PTHREAD_ONCE_INIT;
+static int numNodes = 1;
+static int nodeIds[OM_NUMA_MAX_NODES];
+static short cpuNodes[OM_NUMA_MAX_CPUS];
+
+static pthread_mutex_t replicatedMutex = PTHREAD_MUTEX_INITIALIZER;
+static OMNumaReplicated replicated[OM_NUMA_MAX_REPLICATED];
+static atomic_int numReplicated = 0;
+
+/* Parse a sysfs list such as "0-3,8-11" into at most max values. Return the
+ * number of values in the list, -1 if the file cannot be read. */
+static int readList(const char *path, int *values, int max) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return -1;
+  char line[4096];
+  int count = 0;
+  if (fgets(line, sizeof(line), file)) {
+    char *p = line;
+    while (*p >= '0' && *p <= '9') {
+      int first = (int)strtol(p, &p, 10);
+      int last = first;
+      if (*p == '-')
+        last = (int)strtol(p + 1, &p, 10);
+      for (int v = first; v <= last; ++v, ++count)
+        if (values && count < max)
+          values[count] = v;
+      if (*p == ',')
+        ++p;
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+static void readTopology(void) {
+  numNodes = 1;
+  nodeIds[0] = 0;
+  for (int cpu = 0; cpu < OM_NUMA_MAX_CPUS; ++cpu)
+    cpuNodes[cpu] = -1;
+  int ids[OM_NUMA_MAX_NODES];
+  int count = readList(OM_NUMA_SYSFS "/online", ids, OM_NUMA_MAX_NODES);
+  if (count < 1 || count > OM_NUMA_MAX_NODES) {
+    /* Without NUMA information, all the CPUs are on node 0. */
+    long numCpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (long cpu = 0; cpu < numCpus && cpu < OM_NUMA_MAX_CPUS; ++cpu)
+      cpuNodes[cpu] = 0;
+    return;
+  }
+  int cpus[OM_NUMA_MAX_CPUS];
+  for (int n = 0; n < count; ++n) {
+    char path[64];
+    snprintf(path, sizeof(path), OM_NUMA_SYSFS "/node%d/cpulist", ids[n]);
+    int numCpus = readList(path, cpus, OM_NUMA_MAX_CPUS);
+    for (int i = 0; i < numCpus && i < OM_NUMA_MAX_CPUS; ++i)
+      if (cpus[i] < OM_NUMA_MAX_CPUS)
+        cpuNodes[cpus[i]] = (short)n;
+    nodeIds[n] = ids[n];
+  }
+  numNodes = count;
+}
+
+static void initTopology(void) { pthread_once(&topologyOnce, readTopology); }
+
+/* Set the memory policy of the pages of [buffer, buffer + size) to the node,
+ * the range being shrunk to whole pages. */
+static int bindToNode(void *buffer, int64_t size, int mode, int node) {
+  uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t begin = ((uintptr_t)buffer + pageSize - 1) & ~(pageSize - 1);
+  uintptr_t end = ((uintptr_t)buffer + size) & ~(pageSize - 1);
+  if (end <= begin)
+    return 0;
+  const int bitsPerLong = 8 * sizeof(unsigned long);
+  unsigned long mask[OM_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+  memset(mask, 0, sizeof(mask));
+  int id = nodeIds[node];
+  mask[id / bitsPerLong] |= 1UL << (id % bitsPerLong);
+  /* The kernel reads maxnode - 1 bits of the mask. */
+  unsigned long maxNode = 8 * sizeof(mask) + 1;
+  long result = syscall(
+      SYS_mbind, (void *)begin, end - begin, mode, mask, maxNode, 0);
+  return result == 0 ? 0 : -1;
+}
+
+int omNumaSetEnabled(int enable) {
+  atomic_store(&numaEnabled, enable ? 1 : 0);
+  return 0;
+}
+
+int omNumaGetEnabled(void) {
+  int enabled = atomic_load(&numaEnabled);
+  if (enabled < 0) {
+    const char *env = getenv(OM_NUMA_ENV);
+    enabled = env && atoi(env) > 0;
+    atomic_store(&numaEnabled, enabled);
+  }
+  return enabled;
+}
+
+int omNumaGetNumNodes(void) {
+  initTopology();
+  return numNodes;
+}
+
+int omNumaGetCurrentNode(void) {
+  initTopology();
+  int cpu = sched_getcpu();
+  if (cpu < 0 || cpu >= OM_NUMA_MAX_CPUS || cpuNodes[cpu] < 0)
+    return 0;
+  return cpuNodes[cpu];
+}
+
+int omNumaGetNodeCpus(int node, int *cpus, int maxCpus) {
+  initTopology();
+  if (node < 0 || node >= numNodes)
+    return -1;
+  int count = 0;
+  for (int cpu = 0; cpu < OM_NUMA_MAX_CPUS; ++cpu) {
+    if (cpuNodes[cpu] != node)
+      continue;
+    if (cpus && count < maxCpus)
+      cpus[count] = cpu;
+    ++count;
+  }
+  return count;
+}
+
+int omNumaBindThreadPool(int node) {
+  if (node < 0)
+    node = omNumaGetCurrentNode();
+  int numCpus = omNumaGetNodeCpus(node, NULL, 0);
+  if (numCpus < 1)
+    return -1;
+  if (numCpus > OM_NUMA_MAX_POOL_CPUS)
+    numCpus = OM_NUMA_MAX_POOL_CPUS;
+  int *cpus = (int *)malloc(numCpus * sizeof(int));
+  if (!cpus)
+    return -1;
+  omNumaGetNodeCpus(node, cpus, numCpus);
+  int result = omThreadPoolSetAffinity(cpus, numCpus);
+  free(cpus);
+  return result;
+}
+
+static void freeReplicas(OMNumaReplicated *entry) {
+  for (int n = 0; n < OM_NUMA_MAX_NODES; ++n)
+    if (entry->replicas[n]) {
+      if (entry->hugetlb[n] >= 0)
+        omHugePagesFree(entry->replicas[n], entry->size, entry->hugetlb[n]);
+      else
+        munmap(entry->replicas[n], entry->size);
+      entry->replicas[n] = NULL;
+    }
+}
+
+/* Return the entry of the data, NULL if it was not replicated yet. */
+static OMNumaReplicated *findReplicated(const void *data) {
+  int count = atomic_load_explicit(&numReplicated, memory_order_acquire);
+  for (int i = 0; i < count; ++i)
+    if (replicated[i].data == data)
+      return &replicated[i];
+  return NULL;
+}
+
+/* Replicate the data on each node and publish its entry. An entry without
+ * replicas is published when they cannot be allocated, so that the data is
+ * not copied again on each call. */
+static OMNumaReplicated *replicate(const void *data, int64_t size) {
+  pthread_mutex_lock(&replicatedMutex);
+  OMNumaReplicated *entry = findReplicated(data);
+  int count = atomic_load(&numReplicated);
+  if (entry || count == OM_NUMA_MAX_REPLICATED) {
+    pthread_mutex_unlock(&replicatedMutex);
+    return entry;
+  }
+
+  entry = &replicated[count];
+  memset(entry, 0, sizeof(*entry));
+  entry->data = data;
+  entry->size = size;
+  for (int n = 0; n < numNodes; ++n) {
+    /* The pages are placed when first touched, by the copy below. */
+    void *replica = omHugePagesAlloc(size, &entry->hugetlb[n]);
+    if (!replica) {
+      entry->hugetlb[n] = -1;
+      replica = mmap(NULL, size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (replica == MAP_FAILED)
+        replica = NULL;
+    }
+    entry->replicas[n] = replica;
+    if (!replica || bindToNode(replica, size, OM_MPOL_BIND, n) != 0) {
+      freeReplicas(entry);
+      break;
+    }
+    memcpy(replica, data, size);
+    mprotect(replica, size, PROT_READ);
+  }
+  atomic_store_explicit(&numReplicated, count + 1, memory_order_release);
+  pthread_mutex_unlock(&replicatedMutex);
+  return entry;
+}
+
+int omNumaReplicate(const void *data, int64_t size) {
+  if (!data || size <= 0 || !omNumaGetEnabled() || omNumaGetNumNodes() < 2)
+    return 0;
+  OMNumaReplicated *entry = replicate(data, size);
+  return entry && entry->replicas[0] ? 0 : -1;
+}
+
+const void *omNumaGetLocalReplica(const void *data, int64_t size) {
+  if (!data || size <= 0 || !omNumaGetEnabled() || omNumaGetNumNodes() < 2)
+    return data;
+  OMNumaReplicated *entry = findReplicated(data);
+  if (!entry)
+    entry = replicate(data, size);
+  if (!entry || !entry->replicas[0])
+    return data;
+  return entry->replicas[omNumaGetCurrentNode()];
+}
+
+void omNumaPreferLocal(void *buffer, int64_t size) {
+  if (!buffer || !omNumaGetEnabled() || omNumaGetNumNodes() < 2)
+    return;
+  bindToNode(buffer, size, OM_MPOL_PREFERRED, omNumaGetCurrentNode());
+}
+
+#else
+
+/* NUMA placement is only supported on Linux for now. */
+
+int omNumaSetEnabled(int enable) { return enable ? -1 : 0; }
+
+int omNumaGetEnabled(void) { return 0; }
+
+int omNumaGetNumNodes(void) { return 1; }
+
+int omNumaGetCurrentNode(void) { return 0; }
+
+int omNumaGetNodeCpus(int node, int *cpus, int maxCpus) { return -1; }
+
+int omNumaBindThreadPool(int node) { return -1; }
+
+int omNumaReplicate(const void *data, int64_t size) { return 0; }
+
+const void *omNumaGetLocalReplica(const void *data, int64_t size) {
+  return data;
+}
+
+void omNumaPreferLocal(void *buffer, int64_t size) {}
+
+#endif
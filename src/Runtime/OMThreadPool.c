@@ -0,0 +1,303 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------ OMThreadPool.c - OMThreadPool C Implementation ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the thread pool executing the
+// parallel loops of compiled models.
+//
+// The worker threads are created on the first parallel loop and persist
+// until the thread count or the affinity is changed, so that running a model
+// does not spawn any thread. The iteration space of a parallel loop is split
+// into chunks, and each thread (the calling thread included) gets a
+// contiguous range of chunks. Once a thread is done with its own range, it
+// steals the remaining chunks of the other ranges.
+//
+//===----------------------------------------------------------------------===//
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMThreadPool.h"
+
+/* Upper limit on the number of threads of the pool. */
+#define OM_MAX_THREADS 256
+/* Number of chunks given to each thread, more chunks balance the load better
+ * at the cost of more synchronization. */
+#define OM_CHUNKS_PER_THREAD 4
+/* Environment variable setting the default number of threads. */
+#define OM_NUM_THREADS_ENV "OM_NUM_THREADS"
+
+/* Number of threads requested by the user, 0 for the default. */
+static int requestedNumThreads = 0;
+
+#ifdef _WIN32
+
+/* Parallel loops are executed sequentially on Windows for now. */
+
+void omThreadPoolSetNumThreads(int numThreads) {
+  requestedNumThreads = numThreads > 0 ? numThreads : 0;
+}
+
+int omThreadPoolGetNumThreads(void) { return 1; }
+
+int omThreadPoolSetAffinity(const int *cpus, int numCpus) { return -1; }
+
+void omThreadPoolParallelFor(int64_t lb, int64_t ub, int64_t step,
+    OMParallelForBody body, void *args) {
+  if (lb < ub)
+    body(lb, ub, step, args);
+}
+
+#else
+
+/* Range of chunks owned by a thread, aligned to avoid false sharing. */
+typedef struct {
+  _Alignas(64) atomic_llong next; /* next chunk to execute */
+  int64_t end;                    /* one past the last chunk */
+} OMChunkRange;
+
+/* Parallel loop being executed by the pool. */
+typedef struct {
+  OMParallelForBody body;
+  void *args;
+  int64_t lb, ub, step;
+  int64_t chunkSize; /* number of iterations per chunk */
+  int numRanges;     /* number of threads working on the loop */
+} OMParallelJob;
+
+/* Serializes the parallel loops of concurrent callers. */
+static pthread_mutex_t callerMutex = PTHREAD_MUTEX_INITIALIZER;
+/* Protects the pool state below. */
+static pthread_mutex_t poolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t doneCond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t workers[OM_MAX_THREADS];
+static int numWorkers = 0;
+static int affinityCpus[OM_MAX_THREADS];
+static int numAffinityCpus = 0;
+static unsigned long long jobGeneration = 0;
+/* Value of jobGeneration when the workers were started. */
+static unsigned long long startGeneration = 0;
+static int pendingWorkers = 0;
+static int shutdownWorkers = 0;
+static OMParallelJob currentJob;
+static OMChunkRange chunkRanges[OM_MAX_THREADS];
+
+/* Set for pool threads, and for callers inside a parallel loop, so that
+ * nested parallel loops are executed sequentially. */
+static _Thread_local int insideParallelLoop = 0;
+
+static int clampNumThreads(long numThreads) {
+  if (numThreads < 1)
+    return 1;
+  if (numThreads > OM_MAX_THREADS)
+    return OM_MAX_THREADS;
+  return (int)numThreads;
+}
+
+static int getDefaultNumThreads(void) {
+  const char *env = getenv(OM_NUM_THREADS_ENV);
+  if (env && atoi(env) > 0)
+    return clampNumThreads(atoi(env));
+  if (numAffinityCpus > 0)
+    return clampNumThreads(numAffinityCpus);
+#ifdef __linux__
+  /* Honor the CPU set of the process, e.g. when started with taskset. */
+  cpu_set_t cpuSet;
+  if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+    return clampNumThreads(CPU_COUNT(&cpuSet));
+#endif
+  return clampNumThreads(sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+static void executeChunk(int64_t chunk) {
+  int64_t lb =
+      currentJob.lb + chunk * currentJob.chunkSize * currentJob.step;
+  int64_t ub = lb + currentJob.chunkSize * currentJob.step;
+  if (ub > currentJob.ub)
+    ub = currentJob.ub;
+  currentJob.body(lb, ub, currentJob.step, currentJob.args);
+}
+
+static void executeChunks(int rangeId) {
+  /* Execute the chunks of the own range first, then steal the chunks of the
+   * other ranges, starting with the next one. */
+  for (int i = 0; i < currentJob.numRanges; ++i) {
+    OMChunkRange *range = &chunkRanges[(rangeId + i) % currentJob.numRanges];
+    int64_t chunk;
+    while ((chunk = atomic_fetch_add_explicit(
+                &range->next, 1, memory_order_relaxed)) < range->end)
+      executeChunk(chunk);
+  }
+}
+
+static void *workerMain(void *arg) {
+  int rangeId = (int)(intptr_t)arg;
+  insideParallelLoop = 1;
+  unsigned long long seenGeneration = startGeneration;
+  pthread_mutex_lock(&poolMutex);
+  while (1) {
+    while (!shutdownWorkers && jobGeneration == seenGeneration)
+      pthread_cond_wait(&workCond, &poolMutex);
+    if (shutdownWorkers)
+      break;
+    seenGeneration = jobGeneration;
+    pthread_mutex_unlock(&poolMutex);
+
+    executeChunks(rangeId);
+
+    pthread_mutex_lock(&poolMutex);
+    if (--pendingWorkers == 0)
+      pthread_cond_signal(&doneCond);
+  }
+  pthread_mutex_unlock(&poolMutex);
+  return NULL;
+}
+
+/* Must be called with callerMutex held. */
+static void stopWorkers(void) {
+  pthread_mutex_lock(&poolMutex);
+  shutdownWorkers = 1;
+  pthread_cond_broadcast(&workCond);
+  pthread_mutex_unlock(&poolMutex);
+  for (int i = 0; i < numWorkers; ++i)
+    pthread_join(workers[i], NULL);
+  numWorkers = 0;
+  shutdownWorkers = 0;
+}
+
+/* Must be called with callerMutex held. */
+static void startWorkers(int n) {
+  if (numWorkers == n)
+    return;
+  stopWorkers();
+  startGeneration = jobGeneration;
+  for (int i = 0; i < n; ++i) {
+    /* Range 0 is owned by the calling thread. */
+    if (pthread_create(
+            &workers[i], NULL, workerMain, (void *)(intptr_t)(i + 1)))
+      break;
+#ifdef __linux__
+    if (numAffinityCpus > 0) {
+      cpu_set_t cpuSet;
+      CPU_ZERO(&cpuSet);
+      CPU_SET(affinityCpus[i % numAffinityCpus], &cpuSet);
+      pthread_setaffinity_np(workers[i], sizeof(cpuSet), &cpuSet);
+    }
+#endif
+    numWorkers++;
+  }
+}
+
+#if defined(__GNUC__)
+/* Join the workers before the model library is unloaded. */
+__attribute__((destructor)) static void shutdownThreadPool(void) {
+  pthread_mutex_lock(&callerMutex);
+  stopWorkers();
+  pthread_mutex_unlock(&callerMutex);
+}
+#endif
+
+void omThreadPoolSetNumThreads(int numThreads) {
+  pthread_mutex_lock(&callerMutex);
+  requestedNumThreads = numThreads > 0 ? clampNumThreads(numThreads) : 0;
+  pthread_mutex_unlock(&callerMutex);
+}
+
+int omThreadPoolGetNumThreads(void) {
+  return requestedNumThreads > 0 ? requestedNumThreads
+                                 : getDefaultNumThreads();
+}
+
+int omThreadPoolSetAffinity(const int *cpus, int numCpus) {
+#ifdef __linux__
+  /* A NULL list clears the affinity, whatever the number of CPUs. */
+  if (!cpus)
+    numCpus = 0;
+  if (numCpus < 0 || numCpus > OM_MAX_THREADS)
+    return -1;
+  for (int i = 0; i < numCpus; ++i)
+    if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE)
+      return -1;
+  pthread_mutex_lock(&callerMutex);
+  /* Workers are restarted with the new affinity on the next parallel loop. */
+  stopWorkers();
+  numAffinityCpus = numCpus;
+  for (int i = 0; i < numAffinityCpus; ++i)
+    affinityCpus[i] = cpus[i];
+  pthread_mutex_unlock(&callerMutex);
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+void omThreadPoolParallelFor(int64_t lb, int64_t ub, int64_t step,
+    OMParallelForBody body, void *args) {
+  if (lb >= ub)
+    return;
+  int64_t numIterations = (ub - lb + step - 1) / step;
+  int numThreads = omThreadPoolGetNumThreads();
+  if (numThreads == 1 || numIterations == 1 || insideParallelLoop ||
+      pthread_mutex_trylock(&callerMutex) != 0) {
+    body(lb, ub, step, args);
+    return;
+  }
+  insideParallelLoop = 1;
+  startWorkers(numThreads - 1);
+
+  /* Split the iterations in chunks, and the chunks in one range per thread. */
+  int numRanges = numWorkers + 1;
+  int64_t numChunks = (int64_t)numRanges * OM_CHUNKS_PER_THREAD;
+  if (numChunks > numIterations)
+    numChunks = numIterations;
+  int64_t chunkSize = (numIterations + numChunks - 1) / numChunks;
+  numChunks = (numIterations + chunkSize - 1) / chunkSize;
+
+  pthread_mutex_lock(&poolMutex);
+  currentJob.body = body;
+  currentJob.args = args;
+  currentJob.lb = lb;
+  currentJob.ub = ub;
+  currentJob.step = step;
+  currentJob.chunkSize = chunkSize;
+  currentJob.numRanges = numRanges;
+  for (int i = 0; i < numRanges; ++i) {
+    atomic_store_explicit(&chunkRanges[i].next, numChunks * i / numRanges,
+        memory_order_relaxed);
+    chunkRanges[i].end = numChunks * (i + 1) / numRanges;
+  }
+  pendingWorkers = numWorkers;
+  jobGeneration++;
+  pthread_cond_broadcast(&workCond);
+  pthread_mutex_unlock(&poolMutex);
+
+  executeChunks(0);
+
+  pthread_mutex_lock(&poolMutex);
+  while (pendingWorkers > 0)
+    pthread_cond_wait(&doneCond, &poolMutex);
+  pthread_mutex_unlock(&poolMutex);
+
+  insideParallelLoop = 0;
+  pthread_mutex_unlock(&callerMutex);
+}
+
+#endif
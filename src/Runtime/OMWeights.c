@@ -0,0 +1,291 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------------- OMWeights.c - OMWeights C Implementation --------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the implementation of the mapping of the weights files
+// of compiled models. When huge pages are enabled, large weights files are
+// read into huge pages instead, see OMHugePages.h.
+//
+// The weights files compressed by the compiler, see OMWeights.h, are read and
+// decompressed into anonymous memory. Their data is shuffled by byte planes,
+// the i-th bytes of all the elements being stored together, which gathers
+// the sign and exponent bytes of the floats, and compressed with an LZ77
+// codec of the LZ4 block format: sequences of a token, whose high and low
+// nibbles are the number of literals and the length of the match minus 4
+// (15 continued by extra bytes adding up to the length, until one is not
+// 255), the literals, and the 2-byte little-endian offset of the match. The
+// last sequence only has literals.
+//
+//===----------------------------------------------------------------------===//
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#elif !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "onnx-mlir/Runtime/OMHugePages.h"
+#include "onnx-mlir/Runtime/OMWeights.h"
+
+#ifndef _WIN32
+/* Read the file into a read-only buffer of huge pages, NULL if huge pages are
+ * not used. The buffer is never released, like the mappings of the files. */
+static void *readFileToHugePages(int fd, int64_t size) {
+  int hugetlb;
+  char *data = (char *)omHugePagesAlloc(size, &hugetlb);
+  if (!data)
+    return NULL;
+  int64_t offset = 0;
+  while (offset < size) {
+    ssize_t n = pread(fd, data + offset, size - offset, offset);
+    if (n <= 0) {
+      omHugePagesFree(data, size, hugetlb);
+      return NULL;
+    }
+    offset += n;
+  }
+  mprotect(data, size, PROT_READ);
+  return data;
+}
+#endif
+
+static void *mapFile(const char *path) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return NULL;
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping)
+    return NULL;
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  return data;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void *hugeData = readFileToHugePages(fd, st.st_size);
+  if (hugeData) {
+    close(fd);
+    return hugeData;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* The mapping keeps the file referenced. */
+  close(fd);
+  return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+/* Header of the compressed weights files, written by the compiler. */
+#define OM_WEIGHTS_MAGIC "OMWZ"
+#define OM_WEIGHTS_HEADER_SIZE 32
+
+static uint64_t readLE(const unsigned char *bytes, int n) {
+  uint64_t value = 0;
+  for (int i = n - 1; i >= 0; i--)
+    value = (value << 8) | bytes[i];
+  return value;
+}
+
+/* Read the extra bytes of a length of the LZ sequences. */
+static int readLength(const unsigned char **ip, const unsigned char *end,
+    uint64_t *length) {
+  unsigned char byte;
+  do {
+    if (*ip >= end)
+      return -1;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return 0;
+}
+
+/* Decompress the LZ payload into exactly size bytes, -1 if it is corrupted. */
+static int decompressLZ(const unsigned char *ip, uint64_t payloadSize,
+    unsigned char *out, uint64_t size) {
+  const unsigned char *end = ip + payloadSize;
+  unsigned char *op = out, *outEnd = out + size;
+  while (ip < end) {
+    unsigned char token = *ip++;
+    uint64_t literals = token >> 4;
+    if (literals == 15 && readLength(&ip, end, &literals) != 0)
+      return -1;
+    if (literals > (uint64_t)(end - ip) || literals > (uint64_t)(outEnd - op))
+      return -1;
+    memcpy(op, ip, literals);
+    ip += literals;
+    op += literals;
+    if (ip == end)
+      break;
+    if (end - ip < 2)
+      return -1;
+    uint64_t offset = readLE(ip, 2);
+    ip += 2;
+    uint64_t match = token & 15;
+    if (match == 15 && readLength(&ip, end, &match) != 0)
+      return -1;
+    match += 4;
+    if (offset == 0 || offset > (uint64_t)(op - out) ||
+        match > (uint64_t)(outEnd - op))
+      return -1;
+    /* The match may overlap the bytes it writes. */
+    for (const unsigned char *from = op - offset; match > 0; match--)
+      *op++ = *from++;
+  }
+  return op == outEnd ? 0 : -1;
+}
+
+/* Buffer of the decompressed weights, of huge pages or of anonymous pages
+ * otherwise, so that it can be made read-only. */
+typedef struct {
+  unsigned char *data;
+  int hugePages, hugetlb;
+} OMWeightsBuffer;
+
+static int allocWeights(OMWeightsBuffer *buffer, int64_t size) {
+  buffer->data = (unsigned char *)omHugePagesAlloc(size, &buffer->hugetlb);
+  buffer->hugePages = buffer->data != NULL;
+  if (!buffer->data) {
+#ifdef _WIN32
+    buffer->data = (unsigned char *)VirtualAlloc(
+        NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffer->data = data == MAP_FAILED ? NULL : (unsigned char *)data;
+#endif
+  }
+  return buffer->data ? 0 : -1;
+}
+
+static void freeWeights(OMWeightsBuffer *buffer, int64_t size) {
+  if (buffer->hugePages)
+    omHugePagesFree(buffer->data, size, buffer->hugetlb);
+  else
+#ifdef _WIN32
+    VirtualFree(buffer->data, 0, MEM_RELEASE);
+#else
+    munmap(buffer->data, size);
+#endif
+}
+
+static void protectWeights(OMWeightsBuffer *buffer, int64_t size) {
+#ifdef _WIN32
+  DWORD oldProtect;
+  VirtualProtect(buffer->data, size, PAGE_READONLY, &oldProtect);
+#else
+  mprotect(buffer->data, size, PROT_READ);
+#endif
+}
+
+/* Read and decompress a compressed weights file. Set *compressed to whether
+ * the file is compressed, and return the weights, NULL if the file is not
+ * compressed or cannot be read. The weights are never released, like the
+ * mappings of the files. */
+static void *readCompressedFile(const char *path, int *compressed) {
+  *compressed = 0;
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return NULL;
+  unsigned char header[OM_WEIGHTS_HEADER_SIZE];
+  if (fread(header, 1, OM_WEIGHTS_HEADER_SIZE, file) !=
+          OM_WEIGHTS_HEADER_SIZE ||
+      memcmp(header, OM_WEIGHTS_MAGIC, 4) != 0) {
+    fclose(file);
+    return NULL;
+  }
+  *compressed = 1;
+  uint64_t width = readLE(header + 4, 4);
+  uint64_t size = readLE(header + 8, 8);
+  uint64_t payloadSize = readLE(header + 16, 8);
+  OMWeightsBuffer buffer;
+  if (width == 0 || size == 0 || allocWeights(&buffer, size) != 0) {
+    fclose(file);
+    return NULL;
+  }
+  unsigned char *payload = (unsigned char *)malloc(payloadSize);
+  unsigned char *shuffled = (unsigned char *)malloc(size);
+  int ok = payload && shuffled &&
+           fread(payload, 1, payloadSize, file) == payloadSize &&
+           decompressLZ(payload, payloadSize, shuffled, size) == 0;
+  fclose(file);
+  free(payload);
+  if (ok) {
+    /* Byte b of element i is at b * n + i, the bytes after the last whole
+     * element follow the planes. */
+    uint64_t n = size / width;
+    for (uint64_t b = 0; b < width; b++)
+      for (uint64_t i = 0; i < n; i++)
+        buffer.data[i * width + b] = shuffled[b * n + i];
+    memcpy(buffer.data + n * width, shuffled + n * width, size - n * width);
+    protectWeights(&buffer, size);
+  } else {
+    freeWeights(&buffer, size);
+  }
+  free(shuffled);
+  return ok ? buffer.data : NULL;
+}
+
+int omWeightsLoad(void **weights, const char *path) {
+  if (!weights)
+    return -1;
+  if (*weights)
+    return 0;
+  int compressed;
+  void *data = readCompressedFile(path, &compressed);
+  if (!compressed)
+    data = mapFile(path);
+  if (!data)
+    return -1;
+  *weights = data;
+  return 0;
+}
+
+void omWeightsPrefault(const void *data, int64_t size) {
+  if (!data || size <= 0)
+    return;
+#ifdef _WIN32
+  int64_t pageSize = 4096;
+#else
+  int64_t pageSize = sysconf(_SC_PAGESIZE);
+  if (pageSize <= 0)
+    pageSize = 4096;
+  /* The advice applies to whole pages. */
+  uintptr_t begin = (uintptr_t)data & ~(uintptr_t)(pageSize - 1);
+  posix_madvise((void *)begin, (uintptr_t)data + size - begin,
+      POSIX_MADV_WILLNEED);
+#endif
+  /* Read one byte per page for the pages to be mapped now. */
+  const volatile char *bytes = (const volatile char *)data;
+  for (int64_t offset = 0; offset < size; offset += pageSize)
+    (void)bytes[offset];
+  (void)bytes[size - 1];
+}
@@ -0,0 +1,67 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----- PyCompileSession.cpp - PyCompileSession Implementation ---------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains implementations of PyCompileSession class, which helps
+// python programs compile ONNX models held in memory in process.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "PyCompileSession.hpp"
+#include "src/MainUtils.hpp"
+
+namespace onnx_mlir {
+
+PyCompileSession::PyCompileSession(std::vector<std::string> options)
+    : _options(options) {}
+
+py::object PyCompileSession::pyCompile(
+    py::bytes model, std::string entryPointName) {
+  // The options are parsed as the arguments of onnx-mlir. The options that
+  // are not given keep the values of the previous compilations of the
+  // process, e.g. --enableParallel=false turns one off again.
+  std::vector<const char *> argv = {"onnx-mlir"};
+  for (const std::string &option : _options)
+    argv.emplace_back(option.c_str());
+  llvm::cl::ResetAllOptionOccurrences();
+  std::string error;
+  llvm::raw_string_ostream errorStream(error);
+  if (!llvm::cl::ParseCommandLineOptions(
+          argv.size(), argv.data(), /*Overview=*/"", &errorStream))
+    throw std::invalid_argument(errorStream.str());
+
+  // The model is imported from the bytes object, without copying it.
+  char *buffer;
+  Py_ssize_t size;
+  if (PyBytes_AsStringAndSize(model.ptr(), &buffer, &size) != 0)
+    throw py::error_already_set();
+  mlir::MLIRContext context;
+  registerDialects(context);
+  mlir::OwningModuleRef module;
+  processInputArray(buffer, size, context, module);
+
+  // The library, and its weights file, are only kept on disk until they are
+  // loaded by the ExecutionSession.
+  llvm::SmallString<64> outputDir;
+  if (llvm::sys::fs::createUniqueDirectory("onnx-mlir", outputDir))
+    throw std::runtime_error("Cannot create the output directory");
+  auto removeOutputDir = llvm::make_scope_exit(
+      [&]() { llvm::sys::fs::remove_directories(outputDir); });
+  std::string outputBaseName = (outputDir + "/model").str();
+  if (compileModule(module, context, outputBaseName, EmitLib) != 0)
+    throw std::runtime_error("Cannot compile model");
+
+  return py::module::import("PyRuntime")
+      .attr("ExecutionSession")(outputBaseName + ".so", entryPointName);
+}
+} // namespace onnx_mlir
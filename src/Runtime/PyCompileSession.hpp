@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- PyCompileSession.hpp - PyCompileSession Declaration ----------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains declaration of PyCompileSession class, which helps
+// python programs compile ONNX models held in memory in process.
+//
+//===----------------------------------------------------------------------===//
+
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+namespace onnx_mlir {
+
+// The models are compiled with the options of the onnx-mlir command line,
+// e.g. "-O3" or "--enableParallel", which are global to the process: the GIL
+// is held while a model is compiled, so that the compilations of the Python
+// threads run one at a time.
+class PyCompileSession {
+public:
+  PyCompileSession(std::vector<std::string> options = {});
+
+  // Compile the serialized ONNX model to a shared library, without writing
+  // the model to a file, and return a PyRuntime ExecutionSession of it.
+  py::object pyCompile(py::bytes model, std::string entryPointName);
+
+private:
+  std::vector<std::string> _options;
+};
+} // namespace onnx_mlir
+
+PYBIND11_MODULE(PyCompile, m) {
+  py::class_<onnx_mlir::PyCompileSession>(m, "CompileSession")
+      .def(py::init<std::vector<std::string>>(),
+          py::arg("options") = std::vector<std::string>())
+      .def("compile", &onnx_mlir::PyCompileSession::pyCompile,
+          py::arg("model"), py::arg("entry_point_name") = "run_main_graph");
+}
@@ -16,31 +16,37 @@
 #include "onnx/onnx_pb.h"
 #include <third_party/onnx/onnx/onnx_pb.h>
 
+#include <algorithm>
+
 #include "PyExecutionSession.hpp"
 
 namespace onnx_mlir {
 
-std::vector<py::array> PyExecutionSession::pyRun(
-    const std::vector<py::array> &inputsPyArray) {
-  assert(_entryPointFunc && "Entry point not loaded.");
-
+// Run the model on the OMTensors of the numpy arrays, which are collected in
+// wrappedPyArrays, and return its outputs, or NULL if the inputs do not match
+// the model. The strided arrays whose strides are not multiples of their item
+// sizes, and all the strided arrays if copyStrided, are first copied into
+// C-contiguous arrays.
+OMTensorList *PyExecutionSession::runWrapped(
+    const std::vector<py::array> &inputsPyArray, bool copyStrided,
+    std::vector<py::array> &wrappedPyArrays, bool &hasStridedInputs) {
+  wrappedPyArrays.clear();
+  hasStridedInputs = false;
   std::vector<OMTensor *> omts;
-  for (auto inputPyArray : inputsPyArray) {
-    assert(inputPyArray.flags() && py::array::c_style &&
-           "Expect contiguous python array.");
-
-    void *dataPtr;
-    int ownData = 0;
-    if (inputPyArray.writeable()) {
-      dataPtr = inputPyArray.mutable_data();
-    } else {
-      // If data is not writable, copy them to a writable buffer.
-      auto *copiedData = (float *)malloc(inputPyArray.nbytes());
-      memcpy(copiedData, inputPyArray.data(), inputPyArray.nbytes());
-      dataPtr = copiedData;
-      // We want OMTensor to free up the memory space upon destruction.
-      ownData = 1;
+  for (const py::array &pyArray : inputsPyArray) {
+    py::array inputPyArray = pyArray;
+    if (!(inputPyArray.flags() & py::array::c_style)) {
+      bool itemStrides = std::all_of(inputPyArray.strides(),
+          inputPyArray.strides() + inputPyArray.ndim(),
+          [&](py::ssize_t stride) {
+            return stride % (py::ssize_t)inputPyArray.itemsize() == 0;
+          });
+      if (copyStrided || !itemStrides)
+        inputPyArray = py::array::ensure(pyArray, py::array::c_style);
+      else
+        hasStridedInputs = true;
     }
+    wrappedPyArrays.emplace_back(inputPyArray);
 
     // Borrowed from:
     // https://github.com/pybind/pybind11/issues/563#issuecomment-267835542
@@ -74,20 +80,67 @@ std::vector<py::array> PyExecutionSession::pyRun(
       exit(1);
     }
 
-    auto *inputOMTensor = omTensorCreateWithOwnership(dataPtr,
-        (int64_t *)inputPyArray.shape(), inputPyArray.ndim(), dtype, ownData);
-    omTensorSetStridesWithPyArrayStrides(
-        inputOMTensor, (int64_t *)inputPyArray.strides());
+    auto *inputOMTensor =
+        omTensorCreate(const_cast<void *>(inputPyArray.data()),
+            (int64_t *)inputPyArray.shape(), inputPyArray.ndim(), dtype);
+    if (!(inputPyArray.flags() & py::array::c_style))
+      omTensorSetStridesWithPyArrayStrides(
+          inputOMTensor, (int64_t *)inputPyArray.strides());
 
     omts.emplace_back(inputOMTensor);
   }
 
   auto *wrappedInput = omTensorListCreate(&omts[0], omts.size());
-  auto *wrappedOutput = _entryPointFunc(wrappedInput);
+  OMTensorList *wrappedOutput;
+  {
+    // The model does not touch Python objects, let other Python threads run,
+    // including other inferences, while it runs.
+    py::gil_scoped_release release;
+    wrappedOutput = _entryPointFunc(wrappedInput);
+  }
+  // The OMTensors of the inputs do not own their data.
+  omTensorListDestroy(wrappedInput);
+  return wrappedOutput;
+}
+
+std::vector<py::array> PyExecutionSession::pyRun(
+    const std::vector<py::array> &inputsPyArray) {
+  assert(_entryPointFunc && "Entry point not loaded.");
+
+  // The OMTensors of the inputs wrap the data of the numpy arrays without
+  // copying it, even when the arrays are not writeable since the model never
+  // writes into its inputs. The strided arrays, e.g. slices, are passed with
+  // their strides, and the model copies those it needs contiguous. It rejects
+  // the strided inputs its outputs may view, which are then copied into
+  // C-contiguous arrays, kept alive until the end of the run with the other
+  // arrays, and the model is run again.
+  std::vector<py::array> wrappedPyArrays;
+  bool hasStridedInputs = false;
+  OMTensorList *wrappedOutput = runWrapped(
+      inputsPyArray, /*copyStrided=*/false, wrappedPyArrays, hasStridedInputs);
+  if (!wrappedOutput && hasStridedInputs)
+    wrappedOutput = runWrapped(inputsPyArray, /*copyStrided=*/true,
+        wrappedPyArrays, hasStridedInputs);
+  if (!wrappedOutput)
+    throw std::runtime_error("Input arrays do not match the model signature");
+
+  // Whether a buffer returned by the model is the data of an input, or the
+  // buffer of a previous output.
+  std::vector<const char *> outputDataPtrs;
+  auto isAliased = [&](const char *dataPtr) {
+    for (const py::array &inputPyArray : wrappedPyArrays) {
+      const char *inputData = (const char *)inputPyArray.data();
+      if (dataPtr >= inputData && dataPtr < inputData + inputPyArray.nbytes())
+        return true;
+    }
+    return std::find(outputDataPtrs.begin(), outputDataPtrs.end(), dataPtr) !=
+           outputDataPtrs.end();
+  };
 
   std::vector<py::array> outputPyArrays;
+  auto **outputOmts = omTensorListGetOmtArray(wrappedOutput);
   for (int i = 0; i < omTensorListGetSize(wrappedOutput); i++) {
-    auto *omt = omTensorListGetOmtByIndex(wrappedOutput, i);
+    auto *omt = outputOmts[i];
     auto shape = std::vector<int64_t>(
         omTensorGetShape(omt), omTensorGetShape(omt) + omTensorGetRank(omt));
 
@@ -113,7 +166,7 @@ std::vector<py::array> PyExecutionSession::pyRun(
       dtype = py::dtype("bool_");
     else if (omTensorGetDataType(omt) ==
              (OM_DATA_TYPE)onnx::TensorProto::FLOAT16)
-      dtype = py::dtype("float32");
+      dtype = py::dtype("float16");
     else if (omTensorGetDataType(omt) ==
              (OM_DATA_TYPE)onnx::TensorProto::DOUBLE)
       dtype = py::dtype("float64");
@@ -128,9 +181,27 @@ std::vector<py::array> PyExecutionSession::pyRun(
       exit(1);
     }
 
-    outputPyArrays.emplace_back(
-        py::array(dtype, shape, omTensorGetDataPtr(omt)));
+    const char *dataPtr = (const char *)omTensorGetDataPtr(omt);
+    if (!omTensorGetOwning(omt) || isAliased(dataPtr)) {
+      // Copy the data, which is owned by someone else, e.g. a strided input
+      // returned with its strides.
+      std::vector<py::ssize_t> strides;
+      for (int64_t d = 0; d < omTensorGetRank(omt); d++)
+        strides.emplace_back(omTensorGetStrides(omt)[d] * dtype.itemsize());
+      outputPyArrays.emplace_back(py::array(dtype, shape, strides, dataPtr));
+      omTensorSetOwning(omt, 0);
+    } else {
+      // The numpy array takes the OMTensor, which frees the buffer once the
+      // array is garbage collected.
+      py::capsule owner(
+          omt, [](void *ptr) { omTensorDestroy((OMTensor *)ptr); });
+      outputPyArrays.emplace_back(py::array(dtype, shape, dataPtr, owner));
+      outputOmts[i] = nullptr;
+    }
+    outputDataPtrs.emplace_back(dataPtr);
   }
+  // Destroy the OMTensors that were not taken by numpy arrays.
+  omTensorListDestroy(wrappedOutput);
 
   return outputPyArrays;
 }
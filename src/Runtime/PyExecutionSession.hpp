@@ -23,17 +23,29 @@ namespace py = pybind11;
 
 namespace onnx_mlir {
 
+// The GIL is released while the model runs, and several Python threads can
+// call run on the same session concurrently, unless the model was compiled
+// with --memPoolArena=shared: the memory pools of the calls then share the
+// same buffers.
 class PyExecutionSession : public onnx_mlir::ExecutionSession {
 public:
-  PyExecutionSession(std::string sharedLibPath, std::string entryPointName)
-      : onnx_mlir::ExecutionSession(sharedLibPath, entryPointName){};
+  PyExecutionSession(std::string sharedLibPath, std::string entryPointName,
+      bool warmup = false)
+      : onnx_mlir::ExecutionSession(sharedLibPath, entryPointName, warmup){};
 
   std::vector<py::array> pyRun(const std::vector<py::array> &inputsPyArray);
+
+private:
+  OMTensorList *runWrapped(const std::vector<py::array> &inputsPyArray,
+      bool copyStrided, std::vector<py::array> &wrappedPyArrays,
+      bool &hasStridedInputs);
 };
 } // namespace onnx_mlir
 
 PYBIND11_MODULE(PyRuntime, m) {
   py::class_<onnx_mlir::PyExecutionSession>(m, "ExecutionSession")
-      .def(py::init<const std::string &, const std::string &>())
+      .def(py::init<const std::string &, const std::string &, bool>(),
+          py::arg("shared_lib_path"), py::arg("entry_point_name"),
+          py::arg("warmup") = false)
       .def("run", &onnx_mlir::PyExecutionSession::pyRun);
 }
@@ -15,6 +15,23 @@ extern "C" {
 JNIEXPORT jobject JNICALL Java_com_ibm_onnxmlir_OMModel_main_1graph_1jni(
     JNIEnv *, jclass, jobject);
 
+/*
+ * Class:     com_ibm_onnxmlir_OMModel
+ * Method:    main_graph_batch_jni
+ * Signature: ([Lcom/ibm/onnxmlir/OMTensorList;)[Lcom/ibm/onnxmlir/OMTensorList;
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_ibm_onnxmlir_OMModel_main_1graph_1batch_1jni(
+    JNIEnv *, jclass, jobjectArray);
+
+/*
+ * Class:     com_ibm_onnxmlir_OMModel
+ * Method:    main_graph_into_jni
+ * Signature: (Lcom/ibm/onnxmlir/OMTensorList;Lcom/ibm/onnxmlir/OMTensorList;)Lcom/ibm/onnxmlir/OMTensorList;
+ */
+JNIEXPORT jobject JNICALL Java_com_ibm_onnxmlir_OMModel_main_1graph_1into_1jni(
+    JNIEnv *, jclass, jobject, jobject);
+
 /*
  * Class:     com_ibm_onnxmlir_OMModel
  * Method:    input_signature_jni
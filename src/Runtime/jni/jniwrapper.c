@@ -21,11 +21,21 @@
 #endif
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
 #include "OnnxMlirRuntime.h"
 #include "com_ibm_onnxmlir_OMModel.h"
 #include "jnilog.h"
 
 extern OMTensorList *run_main_graph(OMTensorList *);
+extern int run_main_graph_into(OMTensorList *, OMTensorList *);
+extern OMTensorList *omTensorListCreateWithOwnership(
+    OMTensor **tensors, int n, int owning);
 
 /* Declare type var, make call and assign to var, check against val.
  * It's assumed that a Java exception has already been thrown so
@@ -188,6 +198,92 @@ jniapi_t *fill_jniapi(JNIEnv *env, jniapi_t *japi) {
   return japi;
 }
 
+/* Java classes and method IDs looked up once per process, in JNI_OnLoad or
+ * on the first inference if JNI_OnLoad could not. The classes are global
+ * references, which unlike the local references returned by FindClass can be
+ * shared across threads and calls.
+ */
+static jniapi_t cached_jniapi;
+
+#ifdef _WIN32
+
+static volatile LONG jniapi_cached = 0;
+static SRWLOCK jniapiLock = SRWLOCK_INIT;
+
+static int is_jniapi_cached(void) {
+  return InterlockedCompareExchange(&jniapi_cached, 0, 0);
+}
+static void set_jniapi_cached(void) { InterlockedExchange(&jniapi_cached, 1); }
+static void lock_jniapi(void) { AcquireSRWLockExclusive(&jniapiLock); }
+static void unlock_jniapi(void) { ReleaseSRWLockExclusive(&jniapiLock); }
+
+#else
+
+static atomic_int jniapi_cached = 0;
+static pthread_mutex_t jniapiMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int is_jniapi_cached(void) { return atomic_load(&jniapi_cached); }
+static void set_jniapi_cached(void) { atomic_store(&jniapi_cached, 1); }
+static void lock_jniapi(void) { pthread_mutex_lock(&jniapiMutex); }
+static void unlock_jniapi(void) { pthread_mutex_unlock(&jniapiMutex); }
+
+#endif
+
+/* Look up the Java classes and method IDs into cached_jniapi, with global
+ * references to the classes, unless some thread already did. Return 0 on
+ * success, -1 otherwise with the Java exception cleared.
+ */
+static int cache_jniapi(JNIEnv *env) {
+  jniapi_t jniapi;
+  int status = -1;
+
+  lock_jniapi();
+  if (is_jniapi_cached()) {
+    status = 0;
+  } else if (fill_jniapi(env, &jniapi)) {
+    jniapi.jecpt_cls = (*env)->NewGlobalRef(env, jniapi.jecpt_cls);
+    jniapi.jlong_cls = (*env)->NewGlobalRef(env, jniapi.jlong_cls);
+    jniapi.jstring_cls = (*env)->NewGlobalRef(env, jniapi.jstring_cls);
+    jniapi.jomt_cls = (*env)->NewGlobalRef(env, jniapi.jomt_cls);
+    jniapi.jomtl_cls = (*env)->NewGlobalRef(env, jniapi.jomtl_cls);
+    if (jniapi.jecpt_cls && jniapi.jlong_cls && jniapi.jstring_cls &&
+        jniapi.jomt_cls && jniapi.jomtl_cls) {
+      cached_jniapi = jniapi;
+      set_jniapi_cached();
+      status = 0;
+    }
+  }
+  if (status != 0)
+    (*env)->ExceptionClear(env);
+  unlock_jniapi();
+  return status;
+}
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+  JNIEnv *env;
+
+  /* The JVM runs many inferences, keep the OMTensor structs and the
+   * OMTensorList structs in the runtime free lists across them.
+   */
+  omAllocSetPooling(1);
+
+  if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) != JNI_OK)
+    return JNI_VERSION_1_6;
+
+  /* If the lookup fails, the first inference looks them up again. */
+  cache_jniapi(env);
+  return JNI_VERSION_1_6;
+}
+
+/* Return the Java method IDs cached for the process, or look them up into
+ * japi if they cannot be cached.
+ */
+jniapi_t *get_jniapi(JNIEnv *env, jniapi_t *japi) {
+  if (is_jniapi_cached() || cache_jniapi(env) == 0)
+    return &cached_jniapi;
+  return fill_jniapi(env, japi);
+}
+
 /* Convert Java object to native data structure */
 OMTensorList *omtl_java_to_native(
     JNIEnv *env, jclass cls, jobject java_omtl, jniapi_t *japi) {
@@ -200,37 +296,35 @@ OMTensorList *omtl_java_to_native(
   JNI_TYPE_VAR_CALL(
       env, jsize, jomtl_omtn, (*env)->GetArrayLength(env, jomtl_omts));
 
-  /* Allocate memory for holding each Java omt object and OMTensor pointers
-   * for constructing native OMTensor array
+  /* Allocate memory for holding the OMTensor pointers for constructing
+   * native OMTensor array
    */
-  LIB_TYPE_VAR_CALL(jobject *, jobj_omts, malloc(jomtl_omtn * sizeof(jobject)),
-      NULL, env, japi->jecpt_cls, "jobj_omts=null");
   LIB_TYPE_VAR_CALL(OMTensor **, jni_omts,
       malloc(jomtl_omtn * sizeof(OMTensor *)), NULL, env, japi->jecpt_cls,
       "jni_omts=null");
 
   /* Loop through all the jomtl_omts  */
   for (int i = 0; i < jomtl_omtn; i++) {
-    JNI_VAR_CALL(
-        env, jobj_omts[i], (*env)->GetObjectArrayElement(env, jomtl_omts, i));
+    JNI_TYPE_VAR_CALL(env, jobject, jobj_omt,
+        (*env)->GetObjectArrayElement(env, jomtl_omts, i));
 
     /* Get data, shape, strides, dataType, rank, and bufferSize by calling
      * corresponding methods
      */
     JNI_TYPE_VAR_CALL(env, jobject, jomt_data,
-        (*env)->CallObjectMethod(env, jobj_omts[i], japi->jomt_getData));
+        (*env)->CallObjectMethod(env, jobj_omt, japi->jomt_getData));
     JNI_TYPE_VAR_CALL(env, jobject, jomt_shape,
-        (*env)->CallObjectMethod(env, jobj_omts[i], japi->jomt_getShape));
+        (*env)->CallObjectMethod(env, jobj_omt, japi->jomt_getShape));
     JNI_TYPE_VAR_CALL(env, jobject, jomt_strides,
-        (*env)->CallObjectMethod(env, jobj_omts[i], japi->jomt_getStrides));
+        (*env)->CallObjectMethod(env, jobj_omt, japi->jomt_getStrides));
     JNI_TYPE_VAR_CALL(env, jint, jomt_dataType,
-        (*env)->CallIntMethod(env, jobj_omts[i], japi->jomt_getDataType));
+        (*env)->CallIntMethod(env, jobj_omt, japi->jomt_getDataType));
     JNI_TYPE_VAR_CALL(env, jlong, jomt_bufferSize,
-        (*env)->CallLongMethod(env, jobj_omts[i], japi->jomt_getBufferSize));
+        (*env)->CallLongMethod(env, jobj_omt, japi->jomt_getBufferSize));
     JNI_TYPE_VAR_CALL(env, jint, jomt_rank,
-        (*env)->CallIntMethod(env, jobj_omts[i], japi->jomt_getRank));
+        (*env)->CallIntMethod(env, jobj_omt, japi->jomt_getRank));
     JNI_TYPE_VAR_CALL(env, jlong, jomt_numElems,
-        (*env)->CallLongMethod(env, jobj_omts[i], japi->jomt_getNumElems));
+        (*env)->CallLongMethod(env, jobj_omt, japi->jomt_getNumElems));
 
     /* Get direct buffer associated with data */
     JNI_TYPE_VAR_CALL(
@@ -263,19 +357,27 @@ OMTensorList *omtl_java_to_native(
         omTensorCreate(jni_data, jni_shape, jni_rank, jni_dataType), NULL, env,
         japi->jecpt_cls, "jni_omts[%d]=null", i);
 
-    /* Release reference to the java objects */
+    /* Release reference to the java objects, so that the local references
+     * do not pile up with the number of tensors or of batched requests.
+     */
     JNI_CALL(
         env, (*env)->ReleaseLongArrayElements(env, jomt_shape, jni_shape, 0));
     JNI_CALL(env,
         (*env)->ReleaseLongArrayElements(env, jomt_strides, jni_strides, 0));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_data));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_shape));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_strides));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jobj_omt));
   }
+  JNI_CALL(env, (*env)->DeleteLocalRef(env, jomtl_omts));
 
   /* Create OMTensorList to be constructed and passed to the
-   * model shared library
+   * model shared library. The list owns the OMTensor array so that
+   * omTensorListDestroy frees it.
    */
   LIB_TYPE_VAR_CALL(OMTensorList *, jni_omtl,
-      omTensorListCreate(jni_omts, jomtl_omtn), NULL, env, japi->jecpt_cls,
-      "jni_omtl=null");
+      omTensorListCreateWithOwnership(jni_omts, jomtl_omtn, 1), NULL, env,
+      japi->jecpt_cls, "jni_omtl=null");
 
   return jni_omtl;
 }
@@ -355,8 +457,12 @@ jobject omtl_native_to_java(
         (*env)->NewObject(env, japi->jomt_cls, japi->jomt_constructor,
             jomt_data, jomt_shape, jomt_strides, jomt_dataType));
 
-    /* Set the OMTensor object in the object array */
+    /* Set the OMTensor object in the object array, which keeps it */
     JNI_CALL(env, (*env)->SetObjectArrayElement(env, jobj_omts, i, jobj_omt));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_data));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_shape));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_strides));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jobj_omt));
   }
 
   /* Create the OMTensorList java object */
@@ -367,37 +473,187 @@ jobject omtl_native_to_java(
   return java_omtl;
 }
 
-JNIEXPORT jobject JNICALL Java_com_ibm_onnxmlir_OMModel_main_1graph_1jni(
-    JNIEnv *env, jclass cls, jobject java_iomtl) {
+/* Update the shape, strides and data type of the OMTensor Java objects
+ * in java_omtl, whose data buffers the model wrote into, from the native
+ * OMTensors in jni_omtl.
+ */
+jobject omtl_native_to_java_into(JNIEnv *env, jclass cls,
+    OMTensorList *jni_omtl, jobject java_omtl, jniapi_t *japi) {
 
-  /* Apparently J9 cannot have the return pointer of FindClass shared
-   * across threads. So move jniapi into stack so each thread has its
-   * own copy.
-   */
-  jniapi_t jniapi;
+  /* Get OMTensor array Java object in OMTensorList */
+  JNI_TYPE_VAR_CALL(env, jobjectArray, jomtl_omts,
+      (*env)->CallObjectMethod(env, java_omtl, japi->jomtl_getOmtArray));
 
-  log_init();
+  /* Get the OMTensor array and its size in the OMTensorList */
+  LIB_TYPE_VAR_CALL(OMTensor **, jni_omts, omTensorListGetOmtArray(jni_omtl),
+      NULL, env, japi->jecpt_cls, "jni_omts=null");
+  LIB_TYPE_VAR_CALL(int, jni_omtn, omTensorListGetSize(jni_omtl), 0, env,
+      japi->jecpt_cls, "jni_omtn=0");
+
+  for (int i = 0; i < jni_omtn; i++) {
+    JNI_TYPE_VAR_CALL(env, jobject, jobj_omt,
+        (*env)->GetObjectArrayElement(env, jomtl_omts, i));
 
-  /* Find and initialize Java method IDs in struct jniapi */
-  CHECK_CALL(jniapi_t *, japi, fill_jniapi(env, &jniapi), NULL);
+    int jni_rank = omTensorGetRank(jni_omts[i]);
+    int jni_dataType = omTensorGetDataType(jni_omts[i]);
+    long *jni_shape = omTensorGetShape(jni_omts[i]);
+    long *jni_strides = omTensorGetStrides(jni_omts[i]);
+
+    OMT_DEBUG(i, omTensorGetNumElems(jni_omts[i]),
+        omTensorGetDataPtr(jni_omts[i]), jni_shape, jni_strides, jni_dataType,
+        omTensorGetBufferSize(jni_omts[i]), jni_rank, 0);
+
+    /* Create data shape and strides array Java objects and set them,
+     * together with the data type, in the OMTensor Java object.
+     */
+    JNI_TYPE_VAR_CALL(
+        env, jlongArray, jomt_shape, (*env)->NewLongArray(env, jni_rank));
+    JNI_CALL(env,
+        (*env)->SetLongArrayRegion(env, jomt_shape, 0, jni_rank, jni_shape));
+    JNI_TYPE_VAR_CALL(
+        env, jlongArray, jomt_strides, (*env)->NewLongArray(env, jni_rank));
+    JNI_CALL(env, (*env)->SetLongArrayRegion(
+                      env, jomt_strides, 0, jni_rank, jni_strides));
+    JNI_CALL(env, (*env)->CallVoidMethod(
+                      env, jobj_omt, japi->jomt_setShape, jomt_shape));
+    JNI_CALL(env, (*env)->CallVoidMethod(
+                      env, jobj_omt, japi->jomt_setStrides, jomt_strides));
+    JNI_CALL(env, (*env)->CallVoidMethod(
+                      env, jobj_omt, japi->jomt_setDataType, jni_dataType));
+
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_shape));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jomt_strides));
+    JNI_CALL(env, (*env)->DeleteLocalRef(env, jobj_omt));
+  }
+
+  return java_omtl;
+}
+
+/* Run the model on the Java inputs and return its Java outputs, NULL if
+ * the inputs do not match the model signature or a Java exception has been
+ * thrown.
+ */
+static jobject main_graph(
+    JNIEnv *env, jclass cls, jobject java_iomtl, jniapi_t *japi) {
 
   /* Convert Java object to native data structure */
   CHECK_CALL(OMTensorList *, jni_iomtl,
       omtl_java_to_native(env, cls, java_iomtl, japi), NULL);
 
   /* Call model inference entry point */
-  CHECK_CALL(OMTensorList *, jni_oomtl, run_main_graph(jni_iomtl), NULL);
+  OMTensorList *jni_oomtl = run_main_graph(jni_iomtl);
+  omTensorListDestroy(jni_iomtl);
+  if (!jni_oomtl)
+    return NULL;
 
   /* Convert native data structure to Java object */
-  CHECK_CALL(jobject, java_oomtl,
-      omtl_native_to_java(env, cls, jni_oomtl, japi), NULL);
+  jobject java_oomtl = omtl_native_to_java(env, cls, jni_oomtl, japi);
 
   /* Free intermediate data structures and return Java object */
-  omTensorListDestroy(jni_iomtl);
   omTensorListDestroy(jni_oomtl);
   return java_oomtl;
 }
 
+JNIEXPORT jobject JNICALL Java_com_ibm_onnxmlir_OMModel_main_1graph_1jni(
+    JNIEnv *env, jclass cls, jobject java_iomtl) {
+
+  /* Apparently J9 cannot have the return pointer of FindClass shared
+   * across threads. So if they cannot be cached as global references,
+   * look them up into the stack so each thread has its own copy.
+   */
+  jniapi_t jniapi;
+
+  log_init();
+
+  /* Get the Java method IDs in struct jniapi */
+  CHECK_CALL(jniapi_t *, japi, get_jniapi(env, &jniapi), NULL);
+
+  return main_graph(env, cls, java_iomtl, japi);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_ibm_onnxmlir_OMModel_main_1graph_1batch_1jni(
+    JNIEnv *env, jclass cls, jobjectArray java_iomtls) {
+
+  /* See main_graph_jni */
+  jniapi_t jniapi;
+
+  log_init();
+
+  /* Get the Java method IDs in struct jniapi once for all the requests */
+  CHECK_CALL(jniapi_t *, japi, get_jniapi(env, &jniapi), NULL);
+
+  JNI_TYPE_VAR_CALL(
+      env, jsize, java_omtln, (*env)->GetArrayLength(env, java_iomtls));
+  JNI_TYPE_VAR_CALL(env, jobjectArray, java_oomtls,
+      (*env)->NewObjectArray(env, java_omtln, japi->jomtl_cls, NULL));
+
+  for (jsize i = 0; i < java_omtln; i++) {
+    /* The local references of each request are released with its frame,
+     * only its outputs are kept.
+     */
+    if ((*env)->PushLocalFrame(env, 16) != 0)
+      return NULL;
+    jobject java_iomtl = (*env)->GetObjectArrayElement(env, java_iomtls, i);
+    jobject java_oomtl = NULL;
+    if (java_iomtl)
+      java_oomtl = main_graph(env, cls, java_iomtl, japi);
+    else
+      (*env)->ThrowNew(env, japi->jecpt_cls, "null input tensor list");
+    java_oomtl = (*env)->PopLocalFrame(env, java_oomtl);
+    if ((*env)->ExceptionCheck(env))
+      return NULL;
+
+    /* The outputs of the requests whose inputs do not match the model
+     * signature are null, like the ones returned by main_graph_jni.
+     */
+    if (java_oomtl) {
+      JNI_CALL(env,
+          (*env)->SetObjectArrayElement(env, java_oomtls, i, java_oomtl));
+      JNI_CALL(env, (*env)->DeleteLocalRef(env, java_oomtl));
+    }
+  }
+  return java_oomtls;
+}
+
+JNIEXPORT jobject JNICALL Java_com_ibm_onnxmlir_OMModel_main_1graph_1into_1jni(
+    JNIEnv *env, jclass cls, jobject java_iomtl, jobject java_oomtl) {
+
+  /* See main_graph_jni */
+  jniapi_t jniapi;
+
+  log_init();
+
+  /* Get the Java method IDs in struct jniapi */
+  CHECK_CALL(jniapi_t *, japi, get_jniapi(env, &jniapi), NULL);
+
+  /* Convert the Java inputs and outputs to native data structures. Both
+   * refer to the direct buffers of the Java OMTensors without copying
+   * them, so the model writes the outputs into the caller's buffers.
+   */
+  CHECK_CALL(OMTensorList *, jni_iomtl,
+      omtl_java_to_native(env, cls, java_iomtl, japi), NULL);
+  CHECK_CALL(OMTensorList *, jni_oomtl,
+      omtl_java_to_native(env, cls, java_oomtl, japi), NULL);
+
+  /* Call model inference entry point writing into the outputs */
+  int ret = run_main_graph_into(jni_iomtl, jni_oomtl);
+  omTensorListDestroy(jni_iomtl);
+  if (ret != 0) {
+    omTensorListDestroy(jni_oomtl);
+    LOG_PRINTF(LOG_ERROR, "run_main_graph_into=%d", ret);
+    (*env)->ThrowNew(env, japi->jecpt_cls,
+        "output tensors do not match the model outputs");
+    return NULL;
+  }
+
+  /* Update the shapes, strides and data types of the Java outputs */
+  jobject java_omtl =
+      omtl_native_to_java_into(env, cls, jni_oomtl, java_oomtl, japi);
+  omTensorListDestroy(jni_oomtl);
+  return java_omtl;
+}
+
 JNIEXPORT jstring JNICALL Java_com_ibm_onnxmlir_OMModel_input_1signature_1jni(
     JNIEnv *env, jclass cls) {
 
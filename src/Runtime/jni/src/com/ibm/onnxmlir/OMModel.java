@@ -57,13 +57,57 @@ public class OMModel {
     }
 
     private static native OMTensorList main_graph_jni(OMTensorList list);
+    private static native OMTensorList[] main_graph_batch_jni(
+            OMTensorList[] lists);
+    private static native OMTensorList main_graph_into_jni(
+            OMTensorList inputs, OMTensorList outputs);
     private static native String input_signature_jni();
     private static native String output_signature_jni();
     
+    /**
+     * Run the model on the given inputs. The model can be run from several
+     * threads concurrently when it is compiled with --reentrant, each
+     * thread looking up the Java classes used by the native code at most
+     * once.
+     *
+     * @param list input tensors
+     * @return output tensors, null if the inputs do not match the model
+     *         signature
+     */
     public static OMTensorList mainGraph(OMTensorList list) {
         return main_graph_jni(list);
     }
 
+    /**
+     * Run the model on each of the given inputs in a single native call,
+     * so that the cost of crossing the JNI boundary is paid once for the
+     * whole batch of requests.
+     *
+     * @param lists input tensors of each request
+     * @return output tensors of each request, null for the requests whose
+     *         inputs do not match the model signature
+     */
+    public static OMTensorList[] mainGraphBatch(OMTensorList[] lists) {
+        return main_graph_batch_jni(lists);
+    }
+
+    /**
+     * Run the model copying the outputs into the data buffers of the given
+     * OMTensors, whose shape, strides and data type are updated. The output
+     * buffers can be reused across calls, so that no direct ByteBuffer is
+     * allocated per inference; the model still computes each output in a
+     * buffer of its own before copying it.
+     *
+     * @param inputs input tensors
+     * @param outputs output tensors, each with a buffer large enough for the
+     *                corresponding model output
+     * @return outputs
+     */
+    public static OMTensorList mainGraphInto(OMTensorList inputs,
+            OMTensorList outputs) {
+        return main_graph_into_jni(inputs, outputs);
+    }
+
     public static String inputSignature() {
         return input_signature_jni();
     }
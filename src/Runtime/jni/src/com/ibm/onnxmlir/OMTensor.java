@@ -92,6 +92,28 @@ public class OMTensor {
         putShape(shape);
     }
 
+    /**
+     * Constructor of a tensor with an uninitialized data buffer, e.g. to
+     * preallocate the outputs of OMModel.mainGraphInto
+     *
+     * @param shape data shape
+     * @param dataType data type
+     */
+    public OMTensor(long[] shape, int dataType) {
+        if (dataType <= 0 || dataType > ONNX_TYPE_BFLOAT16 ||
+                ONNX_TYPE_SIZE[dataType] == 0)
+            throw new IllegalArgumentException(
+                    "data type " + dataType + " unknown");
+        putShape(shape);
+        long size = ONNX_TYPE_SIZE[dataType];
+        for (long dim : shape) size *= dim;
+        if (size > Integer.MAX_VALUE)
+            throw new IllegalArgumentException(
+                    "data buffer size " + size + " too large");
+        _data = ByteBuffer.allocateDirect((int)size).order(nativeEndian);
+        _dataType = dataType;
+    }
+
 
     /* ---------- Byte data getter and setter ---------- */
 
@@ -57,9 +57,8 @@ FuncOp getContainingFunction(Operation *op) {
   return cast<FuncOp>(parentFuncOp);
 }
 
-/// Emit constant operation.
-Value emitConstantOp(
-    OpBuilder &rewriter, Location loc, Type type, double value) {
+/// Return the attribute of a constant of a scalar type.
+static Attribute getConstantAttr(OpBuilder &rewriter, Type type, double value) {
   Attribute constantAttr;
 
   TypeSwitch<Type>(type)
@@ -82,7 +81,20 @@ Value emitConstantOp(
         constantAttr = rewriter.getIntegerAttr(type, (int64_t)value);
       })
       .Default([](Type) { llvm_unreachable("unsupported element type"); });
-  return rewriter.create<ConstantOp>(loc, constantAttr);
+  return constantAttr;
+}
+
+/// Emit constant operation. A vector type yields a splat of the value.
+Value emitConstantOp(
+    OpBuilder &rewriter, Location loc, Type type, double value) {
+  if (auto vectorType = type.dyn_cast<VectorType>()) {
+    Attribute elementAttr =
+        getConstantAttr(rewriter, vectorType.getElementType(), value);
+    return rewriter.create<ConstantOp>(
+        loc, DenseElementsAttr::get(vectorType, elementAttr));
+  }
+  return rewriter.create<ConstantOp>(
+      loc, getConstantAttr(rewriter, type, value));
 }
 
 //===----------------------------------------------------------------------===//
@@ -100,6 +112,25 @@ bool isKrnlMemcpy(Operation *op) {
   return llvm::dyn_cast_or_null<KrnlMemcpyOp>(op);
 }
 
+/// Check if the value is the result of a getRef or a view into it. The
+/// accesses to a view of a getRef count as accesses to the getRef.
+static bool isGetRefOrViewOf(Value value, Value getRefResult) {
+  while (value != getRefResult) {
+    Operation *definingOp = value.getDefiningOp();
+    if (auto viewOp = llvm::dyn_cast_or_null<memref::ViewOp>(definingOp))
+      value = viewOp.source();
+    else if (auto subViewOp =
+                 llvm::dyn_cast_or_null<memref::SubViewOp>(definingOp))
+      value = subViewOp.source();
+    else if (auto castOp =
+                 llvm::dyn_cast_or_null<memref::ReinterpretCastOp>(definingOp))
+      value = castOp.source();
+    else
+      return false;
+  }
+  return true;
+}
+
 /// Checks if this operation loads/stores from the result of a specific getRef.
 /// A krnl.memcpy acts as both load and store.
 bool isLoadStoreForGetRef(KrnlGetRefOp getRef, Operation *op) {
@@ -107,17 +138,17 @@ bool isLoadStoreForGetRef(KrnlGetRefOp getRef, Operation *op) {
 
   // Is used by load/store/krnl.memcpy.
   bool isUsedByLoadStore =
-      (isLoad(op) && result == op->getOperands()[0]) ||
-      (isStore(op) && result == op->getOperands()[1]) ||
-      (isKrnlMemcpy(op) &&
-          (result == op->getOperands()[0] || result == op->getOperands()[1]));
+      (isLoad(op) && isGetRefOrViewOf(op->getOperands()[0], result)) ||
+      (isStore(op) && isGetRefOrViewOf(op->getOperands()[1], result)) ||
+      (isKrnlMemcpy(op) && (isGetRefOrViewOf(op->getOperands()[0], result) ||
+                               isGetRefOrViewOf(op->getOperands()[1], result)));
 
   // If not used by a load/store or krnl memcpy, then it can be used by
   // another operation. When this happens we assume that the lowering of the
   // operation will involve a load/store.
   if (!isUsedByLoadStore && !isLoad(op) && !isStore(op) && !isKrnlMemcpy(op))
     for (const auto &operand : op->getOperands())
-      if (operand == result)
+      if (isGetRefOrViewOf(operand, result))
         return true;
 
   return isUsedByLoadStore;
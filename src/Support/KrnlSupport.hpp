@@ -43,6 +43,7 @@ FuncOp getContainingFunction(Operation *op);
 // Emit a constant of a specific type.
 // Use this function for small values only to avoid unexpected loss in type
 // casting.
+// For a vector type, the constant is a splat of the value.
 Value emitConstantOp(
     OpBuilder &rewriter, Location loc, Type type, double value);
 
@@ -10,17 +10,26 @@
 //
 // This file contains implementation of a utility called BinaryDecoder, which
 // decodes a sequence of binary data within a binary file specified by an
-// offset and a length into a typed array and print to stdout.
+// offset and a length into a typed array and print to stdout, or write it into
+// a .npy file.
+//
+// The file is mapped rather than read, and only the range of the selected
+// elements, so that slices of tensors of several GB can be inspected.
 //
 //===----------------------------------------------------------------------===//
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "onnx/onnx_pb.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 
 #if defined(_WIN32)
 
@@ -39,8 +48,28 @@ llvm::cl::opt<int64_t> Start("s",
     llvm::cl::desc("Specify the index of the starting byte"),
     llvm::cl::value_desc("start"), llvm::cl::Required);
 llvm::cl::opt<int64_t> Size("n",
-    llvm::cl::desc("Specify the number of bytes of data to decode"),
-    llvm::cl::value_desc("size"), llvm::cl::Required);
+    llvm::cl::desc("Specify the number of bytes of data to decode, all the "
+                   "bytes from the starting byte by default"),
+    llvm::cl::value_desc("size"), llvm::cl::init(-1));
+llvm::cl::opt<int64_t> First("first",
+    llvm::cl::desc("Specify the index of the first element to decode"),
+    llvm::cl::value_desc("index"), llvm::cl::init(0));
+llvm::cl::opt<int64_t> Count("count",
+    llvm::cl::desc("Specify the number of elements to decode, all the "
+                   "elements from the first one by default"),
+    llvm::cl::value_desc("count"), llvm::cl::init(-1));
+llvm::cl::opt<int64_t> Stride("stride",
+    llvm::cl::desc("Specify the distance in elements between two decoded "
+                   "elements"),
+    llvm::cl::value_desc("stride"), llvm::cl::init(1));
+llvm::cl::opt<std::string> NpyFilename("npy",
+    llvm::cl::desc("Write the decoded elements into a .npy file instead of "
+                   "printing them"),
+    llvm::cl::value_desc("file"));
+llvm::cl::list<int64_t> Shape("shape",
+    llvm::cl::desc("Specify the shape of the array of the .npy file, a "
+                   "vector of the decoded elements by default"),
+    llvm::cl::CommaSeparated);
 llvm::cl::opt<bool> Remove(
     "rm", llvm::cl::desc(
               "Whether to remove the file being decoded after inspection."));
@@ -61,40 +90,197 @@ llvm::cl::opt<onnx::TensorProto::DataType> DataType(
         clEnumVal(onnx::TensorProto::UINT32, "UINT32"),
         clEnumVal(onnx::TensorProto::UINT64, "UINT64")));
 
+// Return the size of the elements of the data type and their numpy type, a
+// size of 0 for the data types of variable size.
+static int64_t getElementType(
+    onnx::TensorProto::DataType dataType, std::string &npyType) {
+#define ELEMENT_TYPE(ONNX_TYPE, KIND, SIZE)                                    \
+  case ONNX_TYPE:                                                              \
+    kind = KIND;                                                               \
+    size = SIZE;                                                               \
+    break;
+
+  char kind;
+  int64_t size;
+  switch (dataType) {
+    ELEMENT_TYPE(onnx::TensorProto::BOOL, 'b', 1);
+    ELEMENT_TYPE(onnx::TensorProto::UINT8, 'u', 1);
+    ELEMENT_TYPE(onnx::TensorProto::INT8, 'i', 1);
+    ELEMENT_TYPE(onnx::TensorProto::UINT16, 'u', 2);
+    ELEMENT_TYPE(onnx::TensorProto::INT16, 'i', 2);
+    ELEMENT_TYPE(onnx::TensorProto::INT32, 'i', 4);
+    ELEMENT_TYPE(onnx::TensorProto::INT64, 'i', 8);
+    ELEMENT_TYPE(onnx::TensorProto::FLOAT16, 'f', 2);
+    ELEMENT_TYPE(onnx::TensorProto::FLOAT, 'f', 4);
+    ELEMENT_TYPE(onnx::TensorProto::DOUBLE, 'f', 8);
+    ELEMENT_TYPE(onnx::TensorProto::UINT32, 'u', 4);
+    ELEMENT_TYPE(onnx::TensorProto::UINT64, 'u', 8);
+  default:
+    return 0;
+  }
+#undef ELEMENT_TYPE
+
+  char byteOrder =
+      size == 1 ? '|' : (llvm::sys::IsLittleEndianHost ? '<' : '>');
+  npyType = std::string(1, byteOrder) + kind + std::to_string(size);
+  return size;
+}
+
+// Print the count elements of type T starting at data, stride elements apart.
+// The elements are read in place, from the mapped file.
 template <typename T>
-int printBuffer(std::vector<char> buffer) {
-  auto *ptr = (T *)&buffer[0];
-  auto data = std::vector<T>(ptr, ptr + buffer.size() / sizeof(T));
-  for (const auto &elem : data)
-    std::cout << elem << " ";
+int printBuffer(const char *data, int64_t count, int64_t stride) {
+  std::ios::sync_with_stdio(false);
+  for (int64_t i = 0; i < count; ++i) {
+    T elem;
+    std::memcpy(&elem, data + i * stride * sizeof(T), sizeof(T));
+    // Promote the bytes, printed as numbers rather than characters.
+    std::cout << +elem << " ";
+  }
+  std::cout.flush();
+  return 0;
+}
+
+// Write the count elements starting at data, stride elements apart, into a
+// .npy file. The contiguous elements are written straight from the mapped
+// file, the strided ones are gathered block by block.
+static int writeNpy(const char *data, int64_t count, int64_t stride,
+    int64_t elementSize, const std::string &npyType) {
+  std::string shape;
+  if (Shape.empty()) {
+    shape = std::to_string(count) + ",";
+  } else {
+    int64_t numElements = 1;
+    for (int64_t dim : Shape) {
+      numElements *= dim;
+      shape += std::to_string(dim) + (Shape.size() == 1 ? "," : ", ");
+    }
+    if (numElements != count) {
+      llvm::errs() << "The shape has " << numElements << " elements, "
+                   << count << " elements are decoded\n";
+      return -1;
+    }
+    if (Shape.size() > 1)
+      shape.resize(shape.size() - 2);
+  }
+
+  // The magic string, the version, the length of the header and the header
+  // take a multiple of 64 bytes, the header being padded with spaces.
+  std::string header = "{'descr': '" + npyType +
+                       "', 'fortran_order': False, 'shape': (" + shape +
+                       "), }";
+  header.append(63 - (10 + header.size()) % 64, ' ');
+  header += '\n';
+
+  std::error_code ec;
+  llvm::raw_fd_ostream os(NpyFilename, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    llvm::errs() << NpyFilename << ": " << ec.message() << "\n";
+    return -1;
+  }
+  os << "\x93"
+     << "NUMPY" << (char)1 << (char)0 << (char)(header.size() & 0xff)
+     << (char)(header.size() >> 8) << header;
+  if (stride == 1) {
+    os.write(data, count * elementSize);
+  } else {
+    const int64_t blockSize = 1 << 16;
+    std::vector<char> block(std::min(count, blockSize) * elementSize);
+    for (int64_t first = 0; first < count; first += blockSize) {
+      int64_t num = std::min(count - first, blockSize);
+      for (int64_t i = 0; i < num; ++i)
+        std::memcpy(&block[i * elementSize],
+            data + (first + i) * stride * elementSize, elementSize);
+      os.write(block.data(), num * elementSize);
+    }
+  }
+  os.close();
+  if (os.has_error()) {
+    llvm::errs() << NpyFilename << ": " << os.error().message() << "\n";
+    os.clear_error();
+    return -1;
+  }
   return 0;
 }
 
 int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv);
-  std::vector<char> buffer(Size);
-  std::ifstream file(Filename, std::ios::in | std::ios::binary);
-  if (!file)
+  std::string npyType;
+  int64_t elementSize = getElementType(DataType, npyType);
+  if (elementSize == 0) {
+    llvm::errs() << "The data type cannot be decoded\n";
     return -1;
-  file.seekg(Start, file.beg);
-  file.read(&buffer[0], Size);
-  file.close();
+  }
 
-  if (Remove)
-    llvm::sys::fs::remove(Filename);
+  // Select the elements in the bytes of the file to decode.
+  uint64_t fileSize;
+  if (llvm::sys::fs::file_size(Filename, fileSize) || Start < 0 ||
+      Start > (int64_t)fileSize)
+    return -1;
+  int64_t size = fileSize - Start;
+  if (Size >= 0)
+    size = std::min<int64_t>(Size, size);
+  int64_t numElements = size / elementSize;
+  if (First < 0 || Stride < 1)
+    return -1;
+  int64_t count = First < numElements
+                      ? (numElements - First + Stride - 1) / Stride
+                      : 0;
+  if (Count >= 0) {
+    if (Count > count) {
+      llvm::errs() << "Only " << count << " elements can be decoded\n";
+      return -1;
+    }
+    count = Count;
+  }
+
+  // Map the range of the selected elements only.
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+  const char *data = nullptr;
+  if (count > 0) {
+    auto bufferOrError = llvm::MemoryBuffer::getFileSlice(Filename,
+        ((count - 1) * Stride + 1) * elementSize,
+        Start + First * elementSize);
+    if (!bufferOrError) {
+      llvm::errs() << Filename << ": " << bufferOrError.getError().message()
+                   << "\n";
+      return -1;
+    }
+    buffer = std::move(*bufferOrError);
+    data = buffer->getBufferStart();
+  }
 
+  int status = 0;
+  if (!NpyFilename.empty()) {
+    status = writeNpy(data, count, Stride, elementSize, npyType);
+  } else {
 #define PRINT_BUFFER_FOR_TYPE(ONNX_TYPE, CPP_TYPE)                             \
   if (DataType == ONNX_TYPE)                                                   \
-    return printBuffer<CPP_TYPE>(buffer);
-
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT8, u_int8_t);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT16, u_int16_t);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT16, int16_t);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT32, int32_t);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT64, int64_t);
-
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::FLOAT, float);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::DOUBLE, double);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT32, u_int32_t);
-  PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT64, u_int64_t);
-}
\ No newline at end of file
+    status = printBuffer<CPP_TYPE>(data, count, Stride);
+
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::BOOL, bool);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT8, u_int8_t);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT8, int8_t);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT16, u_int16_t);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT16, int16_t);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT32, int32_t);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::INT64, int64_t);
+
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::FLOAT, float);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::DOUBLE, double);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT32, u_int32_t);
+    PRINT_BUFFER_FOR_TYPE(onnx::TensorProto::UINT64, u_int64_t);
+#undef PRINT_BUFFER_FOR_TYPE
+
+    if (DataType == onnx::TensorProto::FLOAT16) {
+      llvm::errs() << "FLOAT16 elements can only be written into a .npy file\n";
+      status = -1;
+    }
+  }
+
+  // The file is unmapped before it is removed.
+  buffer.reset();
+  if (Remove)
+    llvm::sys::fs::remove(Filename);
+  return status;
+}
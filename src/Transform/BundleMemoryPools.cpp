@@ -13,6 +13,9 @@
 // all the internal MemRef memory pools emitted by the EnableMemoryPool pass
 // int a single memory pool.
 //
+// Like the memory pools it bundles, the bundle is allocated by each call of
+// the function, so concurrent calls get their own bundles.
+//
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
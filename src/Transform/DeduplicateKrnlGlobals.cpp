@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------ DeduplicateKrnlGlobals.cpp - Share Identical Krnl Globals -----===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// Each constant of a model is lowered to its own Krnl global, so the
+// constants that appear in several functions of the module, e.g. the weights
+// shared by the encoder and the decoder compiled into one library, or the
+// ones cloned by the shape specializations, would be emitted once per
+// function. This pass gives the same name to the Krnl globals with the same
+// type and the same attributes, the value included, so that the lowering to
+// LLVM emits a single global, or a single range of the weights file, for
+// them.
+//
+// The globals whose values have the same bytes, such as the tied weights or
+// the position tables of different shapes or element types, share their name
+// as well: the lowering only reads the bytes of the global of the first one,
+// and casts its address to the element type of each of them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return in `data` the bytes of the value of the global, or of its element
+// when it is a splat, and in `size` the size of the value in bytes. The
+// globals with external data, or with an element type that is not made of
+// whole bytes, are only shared when their attributes are identical.
+bool getPayload(KrnlGlobalOp globalOp, StringRef &data, int64_t &size) {
+  if (!globalOp.value().hasValue())
+    return false;
+  auto memRefTy = globalOp.getResult().getType().cast<MemRefType>();
+  unsigned bitWidth = memRefTy.getElementTypeBitWidth();
+  if (!memRefTy.hasStaticShape() || bitWidth % 8 != 0)
+    return false;
+  size = memRefTy.getNumElements() * (bitWidth / 8);
+  if (auto opaqueAttr = globalOp.valueAttr().dyn_cast<OpaqueElementsAttr>()) {
+    data = opaqueAttr.getValue();
+    return (int64_t)data.size() == size;
+  }
+  if (auto denseAttr = globalOp.valueAttr().dyn_cast<DenseElementsAttr>()) {
+    ArrayRef<char> rawData = denseAttr.getRawData();
+    data = StringRef(rawData.data(), rawData.size());
+    return denseAttr.isSplat() || (int64_t)data.size() == size;
+  }
+  return false;
+}
+
+/*!
+ *  Module pass that shares the names of the identical Krnl globals.
+ */
+class DeduplicateKrnlGlobalsPass
+    : public PassWrapper<DeduplicateKrnlGlobalsPass, OperationPass<ModuleOp>> {
+public:
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    // The attributes are uniqued by the context, so identical globals have
+    // the same type and the same dictionary of attributes besides their name.
+    llvm::DenseMap<std::pair<Type, Attribute>, StringAttr> names;
+    // The bytes of the values are hashed and compared by content.
+    llvm::DenseMap<std::pair<StringRef, int64_t>, StringAttr> payloadNames;
+    getOperation().walk([&](KrnlGlobalOp globalOp) {
+      NamedAttrList attrs(globalOp->getAttrs());
+      attrs.erase("name");
+      auto key = std::make_pair(
+          globalOp.getResult().getType(), attrs.getDictionary(context));
+      StringAttr name =
+          names.try_emplace(key, globalOp.nameAttr()).first->second;
+      StringRef data;
+      int64_t size;
+      if (getPayload(globalOp, data, size))
+        name = payloadNames.try_emplace(std::make_pair(data, size), name)
+                   .first->second;
+      if (name != globalOp.nameAttr())
+        globalOp->setAttr("name", name);
+    });
+  }
+};
+} // namespace
+
+/*!
+ * Create a pass that shares the names of the identical Krnl globals.
+ */
+std::unique_ptr<Pass> mlir::createDeduplicateKrnlGlobalsPass() {
+  return std::make_unique<DeduplicateKrnlGlobalsPass>();
+}
@@ -12,6 +12,12 @@
 // all internal tensors is large and needs to be mitigated. This pass enables a
 // managed memory pool for allocating MemRefs.
 //
+// The memory pools are allocated and freed by each call of the function, so
+// that concurrent calls never share them and the generated code stays
+// reentrant. Only the KrnlMemoryPoolArena pass keeps them across calls. The
+// small temporaries moved to the stack by the KrnlStackAllocation pass are
+// memref.alloca and are not pooled.
+//
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
@@ -30,11 +36,18 @@ namespace {
 bool checkOpResultIsReturned(memref::AllocOp *allocOp) {
   FuncOp function = getContainingFunction(allocOp->getOperation());
 
+  // The views of the alloc, such as the reshaped tensors, alias it.
+  SmallVector<Value, 4> aliases = {allocOp->getResult()};
+  for (unsigned i = 0; i < aliases.size(); ++i)
+    for (Operation *user : aliases[i].getUsers())
+      if (isa<memref::ViewOp, memref::SubViewOp, memref::ReinterpretCastOp>(
+              user))
+        aliases.emplace_back(user->getResult(0));
+
   bool opIsReturned = false;
-  function.walk([&opIsReturned, allocOp](ReturnOp op) {
-    auto result = allocOp->getResult();
+  function.walk([&opIsReturned, &aliases](ReturnOp op) {
     for (const auto &operand : op.getOperands())
-      if (operand == result)
+      if (llvm::is_contained(aliases, operand))
         opIsReturned = true;
   });
 
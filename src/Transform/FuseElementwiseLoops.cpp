@@ -0,0 +1,341 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------- FuseElementwiseLoops.cpp - Fuse Elementwise Krnl Loops ------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// Each elementwise operation is lowered to its own krnl.iterate nest, which
+// makes a full pass over memory per operation. This pass fuses consecutive
+// krnl.iterate nests that have the same iteration space, when every buffer
+// written by one nest and accessed by the other is only accessed at the
+// current iteration point. Once fused, the intermediate results stored by the
+// producer and loaded by the consumer are forwarded, and their buffers are
+// removed when they have no other use. Buffers accessed through a
+// krnl.vector_type_cast are tracked as their source buffer, and are only
+// considered accessed at the same point by two bodies if both access them with
+// the same element type.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/SetVector.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Return the loops iterated by a krnl.iterate operation, if they are
+/// the loops of a krnl.define_loops that are neither blocked nor permuted.
+bool getIteratedLoops(KrnlIterateOp iterateOp, SmallVectorImpl<Value> &loops) {
+  int64_t numLoops = iterateOp.getNumOptimizedLoops();
+  if (numLoops != iterateOp.bodyRegion().front().getNumArguments())
+    return false;
+
+  auto operands = iterateOp.getOperands();
+  SmallVector<Value, 4> inputLoops;
+  for (auto operand : llvm::drop_begin(operands, numLoops))
+    if (operand.getType().isa<LoopType>())
+      inputLoops.emplace_back(operand);
+
+  if ((int64_t)inputLoops.size() != numLoops)
+    return false;
+
+  for (int64_t i = 0; i < numLoops; ++i) {
+    Value loop = operands[i];
+    if (loop != inputLoops[i] || !loop.getDefiningOp<KrnlDefineLoopsOp>())
+      return false;
+    // The loops must only be iterated and possibly be marked as parallel.
+    for (Operation *user : loop.getUsers())
+      if (user != iterateOp.getOperation() && !isa<KrnlParallelOp>(user))
+        return false;
+    loops.emplace_back(loop);
+  }
+  return true;
+}
+
+/// Return true if the loop is marked as parallel.
+bool isParallelLoop(Value loop) {
+  return llvm::any_of(
+      loop.getUsers(), [](Operation *user) { return isa<KrnlParallelOp>(user); });
+}
+
+/// Return true if the two krnl.iterate operations iterate over the same
+/// iteration space, i.e. they have the same bounds computed from the same
+/// values.
+bool haveSameIterationSpace(KrnlIterateOp firstOp, KrnlIterateOp secondOp) {
+  if (firstOp->getAttr(KrnlIterateOp::getBoundsAttrName()) !=
+      secondOp->getAttr(KrnlIterateOp::getBoundsAttrName()))
+    return false;
+
+  auto firstOperands = firstOp.getOperands();
+  auto secondOperands = secondOp.getOperands();
+  if (firstOperands.size() != secondOperands.size())
+    return false;
+
+  for (auto operands : llvm::zip(firstOperands, secondOperands)) {
+    Value firstOperand = std::get<0>(operands);
+    Value secondOperand = std::get<1>(operands);
+    if (firstOperand.getType().isa<LoopType>() &&
+        secondOperand.getType().isa<LoopType>())
+      continue;
+    if (firstOperand != secondOperand)
+      return false;
+  }
+  return true;
+}
+
+/// Return the buffer accessed through a memref, looking through vector type
+/// casts.
+Value getAccessedBuffer(Value memref) {
+  if (auto castOp = memref.getDefiningOp<KrnlVectorTypeCastOp>())
+    return castOp.source();
+  return memref;
+}
+
+/// Memory accesses of the body of a krnl.iterate operation.
+struct LoopBodyAccesses {
+  // Buffers read and written by the body.
+  llvm::SetVector<Value> readBuffers;
+  llvm::SetVector<Value> writtenBuffers;
+  // Buffers that are accessed at another point than the current iteration.
+  llvm::SetVector<Value> nonPointwiseBuffers;
+  // Type of the elements loaded from or stored to each buffer.
+  llvm::DenseMap<Value, Type> accessTypes;
+
+  void addAccess(Value memref, ValueRange indices, Block &body,
+      llvm::SetVector<Value> &buffers);
+};
+
+/// Return true if the indices are the induction variables of the loop body,
+/// in order.
+bool isPointwiseAccess(ValueRange indices, Block &body) {
+  if (indices.size() != body.getNumArguments())
+    return false;
+  for (auto index : llvm::zip(indices, body.getArguments()))
+    if (std::get<0>(index) != std::get<1>(index))
+      return false;
+  return true;
+}
+
+/// Record an access to a memref. An access through a vector view of a buffer
+/// also covers the neighbouring elements of the buffer, so a buffer accessed
+/// with different element types is not accessed pointwise.
+void LoopBodyAccesses::addAccess(Value memref, ValueRange indices, Block &body,
+    llvm::SetVector<Value> &buffers) {
+  Value buffer = getAccessedBuffer(memref);
+  Type accessType = memref.getType().cast<MemRefType>().getElementType();
+  buffers.insert(buffer);
+  auto inserted = accessTypes.try_emplace(buffer, accessType);
+  if (!isPointwiseAccess(indices, body) ||
+      inserted.first->second != accessType)
+    nonPointwiseBuffers.insert(buffer);
+}
+
+/// Collect the memory accesses of a loop body. Return false if the body
+/// contains operations other than krnl.load, krnl.store and operations
+/// without side effects.
+bool collectAccesses(Block &body, LoopBodyAccesses &accesses) {
+  for (Operation &op : body.without_terminator()) {
+    if (auto loadOp = dyn_cast<KrnlLoadOp>(op)) {
+      accesses.addAccess(
+          loadOp.memref(), loadOp.indices(), body, accesses.readBuffers);
+      continue;
+    }
+    if (auto storeOp = dyn_cast<KrnlStoreOp>(op)) {
+      accesses.addAccess(
+          storeOp.memref(), storeOp.indices(), body, accesses.writtenBuffers);
+      continue;
+    }
+    auto memInterface = dyn_cast<MemoryEffectOpInterface>(op);
+    if (op.getNumRegions() > 0 || !memInterface || !memInterface.hasNoEffect())
+      return false;
+  }
+  return true;
+}
+
+/// Return true if the two loop bodies can be executed in a single loop, one
+/// iteration of the first body followed by the same iteration of the second.
+/// This holds when every buffer written by one body and accessed by the other
+/// is only accessed at the current iteration point by both bodies.
+bool canFuseAccesses(
+    LoopBodyAccesses &producer, LoopBodyAccesses &consumer) {
+  auto conflicts = [](Value buffer, LoopBodyAccesses &writer,
+                       LoopBodyAccesses &other) {
+    if (!other.readBuffers.count(buffer) && !other.writtenBuffers.count(buffer))
+      return false;
+    return writer.nonPointwiseBuffers.count(buffer) ||
+           other.nonPointwiseBuffers.count(buffer) ||
+           writer.accessTypes.lookup(buffer) != other.accessTypes.lookup(buffer);
+  };
+  for (Value buffer : producer.writtenBuffers)
+    if (conflicts(buffer, producer, consumer))
+      return false;
+  for (Value buffer : consumer.writtenBuffers)
+    if (conflicts(buffer, consumer, producer))
+      return false;
+  return true;
+}
+
+/// Return true if the operation can be executed before the operations of a
+/// loop that precedes it, i.e. if it does not access memory.
+bool canMoveAcrossLoop(Operation *op) {
+  if (isa<KrnlDefineLoopsOp, KrnlParallelOp, memref::AllocOp, memref::DimOp,
+          KrnlDimOp>(op))
+    return true;
+  auto memInterface = dyn_cast<MemoryEffectOpInterface>(op);
+  return op->getNumRegions() == 0 && memInterface &&
+         memInterface.hasNoEffect();
+}
+
+/// Forward the values stored by the fused producer to the loads of the
+/// consumer that read them at the same iteration point, and remove the
+/// buffers that are no longer read.
+void forwardStoredValues(Block &body) {
+  // Latest value stored at the current iteration point of each buffer.
+  llvm::DenseMap<Value, Value> storedValues;
+  llvm::SetVector<Value> forwardedBuffers;
+  for (Operation &op : llvm::make_early_inc_range(body.without_terminator())) {
+    if (auto storeOp = dyn_cast<KrnlStoreOp>(op)) {
+      Value buffer = getAccessedBuffer(storeOp.memref());
+      if (isPointwiseAccess(storeOp.indices(), body))
+        storedValues[buffer] = storeOp.value();
+      else
+        storedValues.erase(buffer);
+      continue;
+    }
+    auto loadOp = dyn_cast<KrnlLoadOp>(op);
+    if (!loadOp || !isPointwiseAccess(loadOp.indices(), body))
+      continue;
+    Value buffer = getAccessedBuffer(loadOp.memref());
+    Value storedValue = storedValues.lookup(buffer);
+    if (!storedValue || storedValue.getType() != loadOp.getType())
+      continue;
+    forwardedBuffers.insert(buffer);
+    loadOp.getResult().replaceAllUsesWith(storedValue);
+    loadOp.erase();
+  }
+
+  // Remove the temporary buffers that are now only stored to, directly or
+  // through vector views.
+  auto isOnlyStored = [](Value memref) {
+    return llvm::all_of(memref.getUsers(), [](Operation *user) {
+      if (auto castOp = dyn_cast<KrnlVectorTypeCastOp>(user))
+        return llvm::all_of(castOp.getResult().getUsers(),
+            [](Operation *castUser) { return isa<KrnlStoreOp>(castUser); });
+      return isa<KrnlStoreOp, memref::DeallocOp>(user);
+    });
+  };
+  for (Value buffer : forwardedBuffers) {
+    auto allocOp = buffer.getDefiningOp<memref::AllocOp>();
+    if (!allocOp || !isOnlyStored(buffer))
+      continue;
+    for (Operation *user : llvm::make_early_inc_range(buffer.getUsers())) {
+      if (auto castOp = dyn_cast<KrnlVectorTypeCastOp>(user))
+        for (Operation *castUser :
+            llvm::make_early_inc_range(castOp.getResult().getUsers()))
+          castUser->erase();
+      user->erase();
+    }
+    allocOp.erase();
+  }
+}
+
+/// Fuse the producer loop into the consumer loop: the body of the producer is
+/// moved at the beginning of the body of the consumer.
+void fuseLoops(KrnlIterateOp producer, KrnlIterateOp consumer,
+    ArrayRef<Value> producerLoops) {
+  Block &producerBody = producer.bodyRegion().front();
+  Block &consumerBody = consumer.bodyRegion().front();
+  for (auto args :
+      llvm::zip(producerBody.getArguments(), consumerBody.getArguments()))
+    std::get<0>(args).replaceAllUsesWith(std::get<1>(args));
+
+  consumerBody.getOperations().splice(consumerBody.begin(),
+      producerBody.getOperations(), producerBody.begin(),
+      std::prev(producerBody.end()));
+  producer.erase();
+
+  // Remove the loops of the producer.
+  llvm::SetVector<Operation *> defineLoops;
+  for (Value loop : producerLoops) {
+    defineLoops.insert(loop.getDefiningOp());
+    for (Operation *user : llvm::make_early_inc_range(loop.getUsers()))
+      user->erase();
+  }
+  for (Operation *defineLoop : defineLoops)
+    defineLoop->erase();
+
+  forwardStoredValues(consumerBody);
+}
+
+/// Try to fuse the krnl.iterate operation with the closest preceding
+/// krnl.iterate operation of its block.
+bool tryFuseWithPrecedingLoop(KrnlIterateOp consumer) {
+  // Find the preceding loop, only skipping operations that can be moved after
+  // it.
+  KrnlIterateOp producer;
+  for (Operation *op = consumer->getPrevNode(); op; op = op->getPrevNode()) {
+    if ((producer = dyn_cast<KrnlIterateOp>(op)))
+      break;
+    if (!canMoveAcrossLoop(op))
+      return false;
+  }
+  if (!producer)
+    return false;
+
+  SmallVector<Value, 4> producerLoops, consumerLoops;
+  if (!getIteratedLoops(producer, producerLoops) ||
+      !getIteratedLoops(consumer, consumerLoops))
+    return false;
+
+  if (!haveSameIterationSpace(producer, consumer))
+    return false;
+
+  // The fused loop keeps the loops of the consumer, they must be marked as
+  // parallel the same way.
+  for (auto loops : llvm::zip(producerLoops, consumerLoops))
+    if (isParallelLoop(std::get<0>(loops)) != isParallelLoop(std::get<1>(loops)))
+      return false;
+
+  LoopBodyAccesses producerAccesses, consumerAccesses;
+  if (!collectAccesses(producer.bodyRegion().front(), producerAccesses) ||
+      !collectAccesses(consumer.bodyRegion().front(), consumerAccesses) ||
+      !canFuseAccesses(producerAccesses, consumerAccesses))
+    return false;
+
+  fuseLoops(producer, consumer, producerLoops);
+  return true;
+}
+
+/*!
+ *  Function pass that fuses consecutive elementwise krnl.iterate operations.
+ */
+class KrnlFuseElementwiseLoopsPass
+    : public PassWrapper<KrnlFuseElementwiseLoopsPass, FunctionPass> {
+public:
+  void runOnFunction() override {
+    auto function = getFunction();
+
+    // Fusing a loop may enable the fusion of the next loop with the fused
+    // one, visit the loops in program order. Producers are always visited
+    // before their consumers, so erasing them does not invalidate the list.
+    SmallVector<KrnlIterateOp, 32> iterateOps;
+    function.walk([&](KrnlIterateOp op) { iterateOps.emplace_back(op); });
+    for (auto iterateOp : iterateOps)
+      tryFuseWithPrecedingLoop(iterateOp);
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createKrnlFuseElementwiseLoopsPass() {
+  return std::make_unique<KrnlFuseElementwiseLoopsPass>();
+}
@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- MemoryPoolArena.cpp - Keep memory pools across inferences ----===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// The memory pools bundled by the BundleMemoryPools pass are still allocated
+// and freed on every call of the model. This pass replaces the memory pools of
+// the top block of each function by runtime memory arenas, whose buffers are
+// allocated once on first use and reused by the subsequent calls. Dynamic
+// memory pools keep the largest buffer seen so far (high-water mark), and are
+// only reallocated when a call needs more memory. In the thread-local variant,
+// each calling thread gets its own arenas so that concurrent inferences do not
+// share their memory pools. It is the variant used by --reentrant, shared
+// arenas being only safe for one inference at a time.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+#include "src/Support/KrnlSupport.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Check that the alloc is a bundled memory pool, i.e. a static or dynamic
+/// 1-D MemRef of bytes used by krnl.getref operations.
+bool isMemPool(memref::AllocOp allocOp) {
+  auto memRefType = allocOp.getResult().getType().cast<MemRefType>();
+  return checkOpResultIsUsedByGetRef(&allocOp) &&
+         memRefType.getShape().size() == 1 &&
+         getMemRefEltSizeInBytes(memRefType) == 1;
+}
+
+/*!
+ *  Module pass that moves the memory pools into memory arenas.
+ *  Arena identifiers are unique within the module.
+ */
+class KrnlMemoryPoolArenaPass
+    : public PassWrapper<KrnlMemoryPoolArenaPass, OperationPass<ModuleOp>> {
+public:
+  KrnlMemoryPoolArenaPass() = default;
+  KrnlMemoryPoolArenaPass(const KrnlMemoryPoolArenaPass &pass) {}
+  KrnlMemoryPoolArenaPass(bool threadLocal) {
+    this->threadLocal = threadLocal;
+  }
+
+  Option<bool> threadLocal{*this, "thread-local",
+      llvm::cl::desc("Give each calling thread its own memory arenas."),
+      llvm::cl::init(false)};
+
+  void runOnOperation() override {
+    ModuleOp module = getOperation();
+    int64_t id = 0;
+
+    module.walk([&](FuncOp function) {
+      if (function.isExternal())
+        return;
+
+      // Only the pools of the top block are allocated once per call.
+      SmallVector<memref::AllocOp, 4> memPools;
+      for (auto allocOp : function.getBody().front().getOps<memref::AllocOp>())
+        if (isMemPool(allocOp))
+          memPools.emplace_back(allocOp);
+
+      for (auto allocOp : memPools) {
+        OpBuilder builder(allocOp);
+        auto memRefType = allocOp.getResult().getType().cast<MemRefType>();
+        Value dynamicSize = hasAllConstantDimensions(memRefType)
+                                ? Value()
+                                : allocOp.getOperand(0);
+        auto arenaOp = builder.create<KrnlArenaOp>(allocOp.getLoc(),
+            memRefType, dynamicSize, builder.getI64IntegerAttr(id++),
+            threadLocal ? builder.getUnitAttr() : nullptr,
+            allocOp.alignmentAttr(), /*zeroInit=*/nullptr);
+
+        // The arena outlives the call, drop the deallocation of the pool.
+        SmallVector<Operation *, 1> deallocs;
+        for (auto *user : allocOp.getResult().getUsers())
+          if (isa<memref::DeallocOp>(user))
+            deallocs.emplace_back(user);
+        for (auto *dealloc : deallocs)
+          dealloc->erase();
+
+        allocOp.getResult().replaceAllUsesWith(arenaOp.getResult());
+        allocOp.erase();
+      }
+    });
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createKrnlMemoryPoolArenaPass(bool threadLocal) {
+  return std::make_unique<KrnlMemoryPoolArenaPass>(threadLocal);
+}
@@ -0,0 +1,299 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------- AssignLayout.cpp - Blocked Layout for the CNN Regions -------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that computes the convolutional regions of a
+// function in the blocked layout N x ceil(C / b) x H x W x b, NCHW[b]c, where
+// the b channels of a block are contiguous, so that the convolutions and the
+// pools run on vectors of b channels. It runs after the Transposes of the
+// models exported from NHWC frameworks are eliminated by the layout
+// propagation, on the plain NCHW ops.
+//
+// A region starts at a Conv with static shapes, a single group and at least
+// b input channels, so that the first convolutions of the networks, on the 3
+// channels of the images, stay in the plain layout. It extends to the users
+// that do not depend on the layout:
+//
+//   - the Convs, which become ConvNCHWc,
+//   - the unary elementwise ops,
+//   - the binary elementwise ops without broadcast,
+//   - the MaxPools and AveragePools, which pool the blocked tensors with a
+//     window of 1 along the channels of the blocks.
+//
+// onnx.LayoutTransform reorders the values at the boundaries of the regions
+// only: the plain operands entering a region, and a plain copy of the blocked
+// values used outside of it. The channels of the last block past C are zeros
+// after a reorder; the elementwise ops keep them finite, and the packed
+// weights of the ConvNCHWc multiply them by zero.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return the type of a value if it is a static tensor of floats of a rank of
+// at least 3, N x C x D1 x ... x Dn, otherwise null.
+RankedTensorType getPlainType(Value value) {
+  auto type = value.getType().dyn_cast<RankedTensorType>();
+  if (!type || !type.hasStaticShape() || type.getRank() < 3 ||
+      !type.getElementType().isa<FloatType>())
+    return RankedTensorType();
+  return type;
+}
+
+// Return the blocked type N x ceil(C / b) x D1 x ... x Dn x b of a plain type.
+RankedTensorType getBlockedType(RankedTensorType type, int64_t blockSize) {
+  SmallVector<int64_t, 6> shape(type.getShape().begin(), type.getShape().end());
+  shape[1] = (shape[1] + blockSize - 1) / blockSize;
+  shape.emplace_back(blockSize);
+  return RankedTensorType::get(shape, type.getElementType());
+}
+
+// Return the values of an optional array attribute, or `rank` times the
+// default value when it is absent.
+SmallVector<int64_t, 4> getArrayAttrOr(
+    Optional<ArrayAttr> attr, int64_t rank, int64_t defaultValue) {
+  SmallVector<int64_t, 4> values;
+  if (!attr.hasValue())
+    return SmallVector<int64_t, 4>(rank, defaultValue);
+  for (int64_t i = 0; i < rank; ++i)
+    values.emplace_back(ArrayAttrIntVal(attr, i));
+  return values;
+}
+
+// Return true if the Conv starts or extends a region.
+bool isBlockableConv(ONNXConvOp convOp, int64_t blockSize) {
+  auto inputType = getPlainType(convOp.X());
+  auto weightType = getPlainType(convOp.W());
+  if (!inputType || !weightType || !getPlainType(convOp.Y()))
+    return false;
+  if (!convOp.B().getType().isa<NoneType>() &&
+      !convOp.B().getType().cast<ShapedType>().hasStaticShape())
+    return false;
+  return convOp.group() == 1 && convOp.auto_pad() == "NOTSET" &&
+         inputType.getShape()[1] >= blockSize;
+}
+
+// Return true for the elementwise ops that do not depend on the layout, and
+// keep the padding channels finite.
+bool isLayoutAgnosticUnaryOp(Operation *op) {
+  return isa<ONNXReluOp, ONNXLeakyReluOp, ONNXSigmoidOp, ONNXTanhOp,
+      ONNXEluOp, ONNXHardSigmoidOp, ONNXSoftplusOp, ONNXNegOp, ONNXAbsOp,
+      ONNXFusedActivationOp>(op);
+}
+
+bool isLayoutAgnosticBinaryOp(Operation *op) {
+  return isa<ONNXAddOp, ONNXSubOp, ONNXMulOp>(op);
+}
+
+class LayoutAssignment {
+public:
+  LayoutAssignment(int64_t blockSize) : blockSize(blockSize) {}
+
+  // Compute the regions of the op in the blocked layout, in the order of the
+  // ops, so that the blocked operands of an op are known when it is visited.
+  void visit(Operation *op) {
+    OpBuilder builder(op);
+    Value result;
+    if (auto convOp = dyn_cast<ONNXConvOp>(op)) {
+      if (isBlockableConv(convOp, blockSize))
+        result = blockConv(builder, convOp);
+    } else if (isa<ONNXMaxPoolSingleOutOp, ONNXAveragePoolOp>(op)) {
+      if (blocked.count(op->getOperand(0)))
+        result = blockPool(builder, op);
+    } else if (isLayoutAgnosticUnaryOp(op) || isLayoutAgnosticBinaryOp(op)) {
+      result = blockElementwiseOp(builder, op);
+    }
+    if (!result)
+      return;
+    blocked[op->getResult(0)] = result;
+    replacedOps.emplace_back(op);
+  }
+
+  // Use plain copies of the blocked values outside of the regions, and
+  // erase the plain ops of the regions.
+  void replaceRegions() {
+    llvm::SmallPtrSet<Operation *, 16> replaced(
+        replacedOps.begin(), replacedOps.end());
+    for (Operation *op : replacedOps) {
+      Value plain = op->getResult(0);
+      Value blockedValue = blocked[plain];
+      Value reorder;
+      for (OpOperand &use : llvm::make_early_inc_range(plain.getUses())) {
+        if (replaced.count(use.getOwner()))
+          continue;
+        if (!reorder) {
+          OpBuilder builder(op->getContext());
+          builder.setInsertionPointAfter(blockedValue.getDefiningOp());
+          auto plainType = plain.getType().cast<RankedTensorType>();
+          reorder = builder.create<ONNXLayoutTransformOp>(op->getLoc(),
+              plainType, blockedValue, getSI64Attr(builder, 0),
+              getSI64Attr(builder, plainType.getShape()[1]));
+        }
+        use.set(reorder);
+      }
+    }
+    for (Operation *op : llvm::reverse(replacedOps))
+      op->erase();
+  }
+
+private:
+  IntegerAttr getSI64Attr(OpBuilder &builder, int64_t value) {
+    return IntegerAttr::get(
+        builder.getIntegerType(64, /*isSigned=*/true), APInt(64, value, true));
+  }
+
+  // Return the blocked value of a plain value, reordered before the current
+  // op when it is outside of the regions.
+  Value getBlocked(OpBuilder &builder, Value plain) {
+    auto it = blocked.find(plain);
+    if (it != blocked.end())
+      return it->second;
+    auto &reorder = reorders[plain];
+    if (!reorder) {
+      OpBuilder::InsertionGuard guard(builder);
+      if (Operation *def = plain.getDefiningOp())
+        builder.setInsertionPointAfter(def);
+      else
+        builder.setInsertionPointToStart(plain.getParentBlock());
+      reorder = builder.create<ONNXLayoutTransformOp>(plain.getLoc(),
+          getBlockedType(plain.getType().cast<RankedTensorType>(), blockSize),
+          plain, getSI64Attr(builder, blockSize), IntegerAttr());
+    }
+    return reorder;
+  }
+
+  Value blockConv(OpBuilder &builder, ONNXConvOp convOp) {
+    int64_t spatialRank =
+        convOp.W().getType().cast<RankedTensorType>().getRank() - 2;
+    auto pads = getArrayAttrOr(convOp.pads(), 2 * spatialRank, 0);
+    auto strides = getArrayAttrOr(convOp.strides(), spatialRank, 1);
+    auto dilations = getArrayAttrOr(convOp.dilations(), spatialRank, 1);
+    Value input = getBlocked(builder, convOp.X());
+    return builder.create<ONNXConvNCHWcOp>(convOp.getLoc(),
+        getBlockedType(getPlainType(convOp.Y()), blockSize), input,
+        convOp.W(), convOp.B(), builder.getI64ArrayAttr(dilations),
+        builder.getI64ArrayAttr(pads), builder.getI64ArrayAttr(strides),
+        getSI64Attr(builder, blockSize));
+  }
+
+  // The blocked pool has a window of 1 along the channels of the blocks.
+  Value blockPool(OpBuilder &builder, Operation *op) {
+    auto resultType = getPlainType(op->getResult(0));
+    auto kernelShapeAttr = op->getAttrOfType<ArrayAttr>("kernel_shape");
+    auto autoPadAttr = op->getAttrOfType<StringAttr>("auto_pad");
+    if (!resultType || !kernelShapeAttr ||
+        (autoPadAttr && autoPadAttr.getValue() != "NOTSET"))
+      return Value();
+    if (auto maxPoolOp = dyn_cast<ONNXMaxPoolSingleOutOp>(op))
+      if (maxPoolOp.storage_order() != 0)
+        return Value();
+    int64_t spatialRank = kernelShapeAttr.size();
+    auto getAttr = [&](StringRef name) -> Optional<ArrayAttr> {
+      if (auto attr = op->getAttrOfType<ArrayAttr>(name))
+        return attr;
+      return None;
+    };
+    auto kernelShape = getArrayAttrOr(kernelShapeAttr, spatialRank, 1);
+    auto strides = getArrayAttrOr(getAttr("strides"), spatialRank, 1);
+    auto pads = getArrayAttrOr(getAttr("pads"), 2 * spatialRank, 0);
+    kernelShape.emplace_back(1);
+    strides.emplace_back(1);
+    pads.insert(pads.begin() + spatialRank, 0);
+    pads.emplace_back(0);
+
+    BlockAndValueMapping mapping;
+    mapping.map(op->getOperand(0), blocked[op->getOperand(0)]);
+    Operation *blockedOp = builder.clone(*op, mapping);
+    blockedOp->setAttr("kernel_shape", builder.getI64ArrayAttr(kernelShape));
+    blockedOp->setAttr("strides", builder.getI64ArrayAttr(strides));
+    blockedOp->setAttr("pads", builder.getI64ArrayAttr(pads));
+    if (auto dilationsAttr = getAttr("dilations")) {
+      auto dilations = getArrayAttrOr(dilationsAttr, spatialRank, 1);
+      dilations.emplace_back(1);
+      blockedOp->setAttr("dilations", builder.getI64ArrayAttr(dilations));
+    }
+    blockedOp->getResult(0).setType(getBlockedType(resultType, blockSize));
+    return blockedOp->getResult(0);
+  }
+
+  // The elementwise ops are blocked when one of their operands is, and all
+  // their operands have the shape of their result.
+  Value blockElementwiseOp(OpBuilder &builder, Operation *op) {
+    auto resultType = getPlainType(op->getResult(0));
+    if (!resultType || op->getNumResults() != 1 ||
+        llvm::none_of(op->getOperands(),
+            [&](Value operand) { return blocked.count(operand); }) ||
+        llvm::any_of(op->getOperandTypes(),
+            [&](Type type) { return type != resultType; }))
+      return Value();
+    BlockAndValueMapping mapping;
+    for (Value operand : op->getOperands())
+      mapping.map(operand, getBlocked(builder, operand));
+    Operation *blockedOp = builder.clone(*op, mapping);
+    blockedOp->getResult(0).setType(getBlockedType(resultType, blockSize));
+    return blockedOp->getResult(0);
+  }
+
+  int64_t blockSize;
+  // The blocked values of the results of the ops of the regions.
+  llvm::DenseMap<Value, Value> blocked;
+  // The reorders of the plain values entering the regions.
+  llvm::DenseMap<Value, Value> reorders;
+  // The plain ops of the regions, in order.
+  SmallVector<Operation *, 16> replacedOps;
+};
+
+/*!
+ *  Function pass that computes the CNN regions in the blocked layout.
+ */
+class AssignLayoutONNXPass
+    : public PassWrapper<AssignLayoutONNXPass, FunctionPass> {
+public:
+  AssignLayoutONNXPass() = default;
+  AssignLayoutONNXPass(const AssignLayoutONNXPass &pass) {}
+  AssignLayoutONNXPass(int64_t blockSize) { this->blockSize = blockSize; }
+
+  Option<int64_t> blockSize{*this, "block-size",
+      llvm::cl::desc("Number of contiguous channels of the blocks, e.g. 8 "
+                     "for AVX2 or 16 for AVX-512."),
+      llvm::cl::init(8)};
+
+  void runOnFunction() final {
+    FuncOp function = getFunction();
+    if (function.isExternal() || blockSize < 2)
+      return;
+
+    // The ops are visited in order, the blocked ops created before them.
+    SmallVector<Operation *, 32> ops;
+    function.walk([&](Operation *op) { ops.emplace_back(op); });
+    LayoutAssignment assignment(blockSize);
+    for (Operation *op : ops)
+      assignment.visit(op);
+    assignment.replaceRegions();
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create an AssignLayoutONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createAssignLayoutONNXPass(
+    int64_t blockSize) {
+  return std::make_unique<AssignLayoutONNXPass>(blockSize);
+}
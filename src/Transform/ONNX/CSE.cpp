@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------- CSE.cpp - ONNX Common Subexpression Elimination --------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that replaces the ONNX operations computing the
+// same results as an operation before them by the results of that operation.
+// Exported graphs often compute the same Shape/Gather/Unsqueeze chain, or the
+// same constant, many times; each node carries its own onnx_node_name, which
+// is ignored when comparing the operations.
+//
+// The constants with the same value are deduplicated as well: their dense
+// elements attributes are uniqued by content in the context, so that equal
+// values are the same attribute.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Hash and compare the operations by name, operands, result types and
+// attributes other than the node name.
+struct ONNXOpInfo : public llvm::DenseMapInfo<Operation *> {
+  static unsigned getHashValue(const Operation *opC) {
+    auto *op = const_cast<Operation *>(opC);
+    SmallVector<NamedAttribute, 4> attrs = getSemanticAttrs(op);
+    return llvm::hash_combine(op->getName(),
+        llvm::hash_combine_range(attrs.begin(), attrs.end()),
+        llvm::hash_combine_range(
+            op->result_type_begin(), op->result_type_end()),
+        llvm::hash_combine_range(op->operand_begin(), op->operand_end()));
+  }
+
+  static bool isEqual(const Operation *lhsC, const Operation *rhsC) {
+    auto *lhs = const_cast<Operation *>(lhsC);
+    auto *rhs = const_cast<Operation *>(rhsC);
+    if (lhs == rhs)
+      return true;
+    if (lhs == getTombstoneKey() || lhs == getEmptyKey() ||
+        rhs == getTombstoneKey() || rhs == getEmptyKey())
+      return false;
+    return lhs->getName() == rhs->getName() &&
+           lhs->getOperands() == rhs->getOperands() &&
+           lhs->getResultTypes() == rhs->getResultTypes() &&
+           getSemanticAttrs(lhs) == getSemanticAttrs(rhs);
+  }
+};
+
+using KnownOps = llvm::DenseMap<Operation *, Operation *, ONNXOpInfo>;
+
+// Eliminate the operations of the block computed before, in the block or in
+// the blocks enclosing it. The operations of the nested blocks are only known
+// within them.
+void eliminateCommonSubexpressions(Block &block, KnownOps knownOps) {
+  for (Operation &op : llvm::make_early_inc_range(block)) {
+    for (Region &region : op.getRegions())
+      for (Block &nestedBlock : region)
+        eliminateCommonSubexpressions(nestedBlock, knownOps);
+    if (!isDeterministicONNXOp(&op))
+      continue;
+    auto inserted = knownOps.try_emplace(&op, &op);
+    if (inserted.second)
+      continue;
+    op.replaceAllUsesWith(inserted.first->second);
+    op.erase();
+  }
+}
+
+/*!
+ *  Function pass that eliminates the common subexpressions of ONNX ops.
+ */
+struct CSEONNXToONNXPass
+    : public PassWrapper<CSEONNXToONNXPass, FunctionPass> {
+  void runOnFunction() final {
+    for (Block &block : getFunction().getBody())
+      eliminateCommonSubexpressions(block, KnownOps());
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create a CSEONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createCSEONNXToONNXPass() {
+  return std::make_unique<CSEONNXToONNXPass>();
+}
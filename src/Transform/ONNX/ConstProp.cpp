@@ -64,17 +64,63 @@ const StringRef BUFFER_ID_ATTR = "buffer_id";
 /// 2) createConstantOpAndStoreBufferPtr(..., char *buffer)
 ///    - create a new ONNXConstantOp using the given buffer, and
 ///    - add the buffer to the buffer pool.
+///    - release the buffers of the constant inputs that die with the folded
+///      operation.
 /// 3) allocateBufferFor(Value value, bool useMaxSize = false)
 ///    - create a new buffer whose size is obtained from the type of 'value'.
+/// 4) reuseOrAllocateBufferFor(Value input, Value replacingValue)
+///    - reuse the buffer of 'input' for an element-wise result if 'input'
+///      dies with the folded operation, or create a new buffer.
 ///
 /// Note that:
-///   - The buffers in the buffer pool will be automatically freed. Users don't
-///     need to take care about that.
+///   - The buffers in the buffer pool are reference counted by the constants
+///     using them, e.g. a reshaped constant shares the buffer of its input. A
+///     buffer is freed once the last constant using it is folded away, so that
+///     only the live constants of a constant subgraph are kept in memory.
+///   - The remaining buffers in the buffer pool will be automatically freed.
+///     Users don't need to take care about that.
 ///   - If we create a buffer and do not put it on the buffer pool, please
 ///     make sure that it is correctly freed.
 ///
-/// Buffer pool to store buffer pointers.
-SmallVector<char *, 4> bufferPtrs;
+/// Buffer pool to store buffer pointers and their number of constants.
+struct ConstPropBuffer {
+  char *ptr;
+  unsigned useCount;
+};
+SmallVector<ConstPropBuffer, 4> bufferPool;
+/// Buffer ids in the buffer pool of the live buffers.
+llvm::DenseMap<char *, unsigned> bufferIds;
+
+/// Add a constant using a buffer to the buffer pool and return the buffer id.
+unsigned addBufferUse(char *ptr) {
+  auto it = bufferIds.find(ptr);
+  if (it != bufferIds.end()) {
+    bufferPool[it->second].useCount++;
+    return it->second;
+  }
+  bufferPool.push_back({ptr, 1});
+  unsigned bufferId = bufferPool.size() - 1;
+  bufferIds[ptr] = bufferId;
+  return bufferId;
+}
+
+/// Remove a constant using a buffer, and free the buffer if it was the last
+/// one.
+void releaseBufferUse(unsigned bufferId) {
+  ConstPropBuffer &buffer = bufferPool[bufferId];
+  assert(buffer.ptr && buffer.useCount > 0 && "Buffer is already freed");
+  if (--buffer.useCount > 0)
+    return;
+  bufferIds.erase(buffer.ptr);
+  free(buffer.ptr);
+  buffer.ptr = nullptr;
+}
+
+/// Check whether a value dies once the operation 'user' is folded.
+bool diesWith(Value value, Operation *user) {
+  return llvm::all_of(
+      value.getUsers(), [&](Operation *op) { return op == user; });
+}
 
 /// A helper function to get a value of a given type from an attribute.
 template <typename T>
@@ -117,14 +163,13 @@ char *getArrayFromAttributeOrBuffer(PatternRewriter &rewriter, Operation *op) {
   Attribute bufferIDAttr = op->getAttrOfType<::mlir::Attribute>(BUFFER_ID_ATTR);
   if (bufferIDAttr) {
     unsigned bufferId = bufferIDAttr.cast<IntegerAttr>().getUInt();
-    res = bufferPtrs[bufferId];
+    res = bufferPool[bufferId].ptr;
   } else {
     DenseElementsAttr dataAttr =
         op->getAttrOfType<::mlir::Attribute>("value")
             .dyn_cast_or_null<mlir::DenseElementsAttr>();
     res = createArrayFromDenseElementsAttr(dataAttr);
-    bufferPtrs.emplace_back(res);
-    unsigned bufferId = bufferPtrs.size() - 1;
+    unsigned bufferId = addBufferUse(res);
     // Add an attribute to store the buffer id.
     op->setAttr(BUFFER_ID_ATTR,
         IntegerAttr::get(
@@ -142,7 +187,7 @@ void getArrayForFinalOutput(Operation *op, char *res) {
   Attribute bufferIDAttr = op->getAttrOfType<::mlir::Attribute>(BUFFER_ID_ATTR);
   if (bufferIDAttr) {
     unsigned bufferId = bufferIDAttr.cast<IntegerAttr>().getUInt();
-    char *resArr = bufferPtrs[bufferId];
+    char *resArr = bufferPool[bufferId].ptr;
     convertDoubleInt64ToExactType(constOp.getResult().getType(), resArr, res);
   } else {
     llvm_unreachable("Could not find the input buffer");
@@ -189,36 +234,64 @@ bool isFromDenseONNXConstantOp(Value result) {
   return true;
 }
 
+/// Release the buffers of the constant operands of 'foldedOp' that have no
+/// other users, since they are erased together with 'foldedOp'. The buffer id
+/// is removed from a released constant so that it is released only once.
+void releaseDeadInputBuffers(Operation *foldedOp) {
+  for (Value operand : foldedOp->getOperands()) {
+    Operation *inputOp = operand.getDefiningOp();
+    if (!inputOp || !isa<ONNXConstantOp>(inputOp) ||
+        !diesWith(operand, foldedOp))
+      continue;
+    IntegerAttr bufferIDAttr =
+        inputOp->getAttrOfType<IntegerAttr>(BUFFER_ID_ATTR);
+    if (!bufferIDAttr)
+      continue;
+    inputOp->removeAttr(BUFFER_ID_ATTR);
+    releaseBufferUse(bufferIDAttr.getUInt());
+  }
+}
+
 /// A helper function to create an ONNXConstantOp for a given data array.
 /// This ONNXConstantOp is only used internally.
 ONNXConstantOp createConstantOpAndStoreBufferPtr(
     PatternRewriter &rewriter, Value replacingValue, char *vt) {
   Location loc = replacingValue.getLoc();
-  int64_t maxSizeInBytes = getMaxSizeInBytes(replacingValue.getType());
 
   ONNXConstantOp constOp = rewriter.create<ONNXConstantOp>(loc,
       replacingValue.getType(), Attribute(), Attribute(), FloatAttr(),
       ArrayAttr(), IntegerAttr(), ArrayAttr(), StringAttr(), ArrayAttr());
 
-  // Store the buffer pointer.
-  unsigned bufferId = -1;
-  for (unsigned i = 0; i < bufferPtrs.size(); ++i)
-    if (bufferPtrs[i] == vt) {
-      bufferId = i;
-      break;
-    }
-  if (bufferId == -1) {
-    bufferPtrs.emplace_back(vt);
-    bufferId = bufferPtrs.size() - 1;
-  }
+  // Store the buffer pointer, which may be shared with an input.
+  unsigned bufferId = addBufferUse(vt);
   // Store the buffer id.
   constOp.getOperation()->setAttr(BUFFER_ID_ATTR,
       IntegerAttr::get(
           rewriter.getIntegerType(/*width=*/64, /*isSigned=*/false), bufferId));
 
+  // The inputs only used by the folded operation are no longer needed.
+  if (Operation *foldedOp = replacingValue.getDefiningOp())
+    releaseDeadInputBuffers(foldedOp);
+
   return constOp;
 }
 
+/// Get a buffer for an element-wise result of 'input'. The buffer of 'input'
+/// is reused if no other constant needs it, since each element of the result
+/// only depends on the same element of 'input'.
+char *reuseOrAllocateBufferFor(Value input, Value replacingValue) {
+  Operation *inputOp = input.getDefiningOp();
+  IntegerAttr bufferIDAttr =
+      inputOp->getAttrOfType<IntegerAttr>(BUFFER_ID_ATTR);
+  if (bufferIDAttr &&
+      bufferPool[bufferIDAttr.getUInt()].useCount == 1 &&
+      diesWith(input, replacingValue.getDefiningOp()) &&
+      getMaxSizeInBytes(input.getType()) ==
+          getMaxSizeInBytes(replacingValue.getType()))
+    return bufferPool[bufferIDAttr.getUInt()].ptr;
+  return allocateBufferFor(replacingValue.getType(), /*useMaxSize=*/true);
+}
+
 //===----------------------------------------------------------------------===//
 // Code to perform constant propagation for binary in presence of broadcast.
 //===----------------------------------------------------------------------===//
@@ -421,10 +494,9 @@ ONNXConstantOp ConstPropElementwiseUnary(
   char *constArray =
       getArrayFromAttributeOrBuffer(rewriter, constValue.getDefiningOp());
 
-  // Do calculation.
+  // Do calculation, in place if the input is no longer needed.
   // Use maximum size (double or int64_t) to avoid the precision loss.
-  char *resArray =
-      allocateBufferFor(replacingValue.getType(), /*useMaxSize=*/true);
+  char *resArray = reuseOrAllocateBufferFor(constValue, replacingValue);
   if (elementType.isa<FloatType>()) {
     // Use double to avoid the precision loss during computation.
     IterateConstPropElementwiseUnary<ElementwiseUnaryOp, double>(
@@ -484,10 +556,11 @@ ONNXConstantOp ConstPropTranspose(
 }
 
 //===----------------------------------------------------------------------===//
-// Code to perform constant propagation for unsqueeze.
+// Code to perform constant propagation for unsqueeze and reshape.
 //===----------------------------------------------------------------------===//
 
-ONNXConstantOp ConstPropUnsqueeze(
+// The data is unchanged, only the type of the constant is.
+ONNXConstantOp ConstPropReshape(
     PatternRewriter &rewriter, Value replacingValue, Value input) {
   Type replacingType = replacingValue.getType();
   Type elementType = replacingType.cast<ShapedType>().getElementType();
@@ -502,6 +575,327 @@ ONNXConstantOp ConstPropUnsqueeze(
   return res;
 }
 
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for cast.
+//===----------------------------------------------------------------------===//
+
+/// Check whether an element type can be held by the constprop buffers and
+/// converted back to its exact type.
+bool isConstPropElementType(Type elementType) {
+  if (FloatType floatTy = elementType.dyn_cast<FloatType>())
+    return floatTy.getWidth() == 16 || floatTy.getWidth() == 32 ||
+           floatTy.getWidth() == 64;
+  if (IntegerType intTy = elementType.dyn_cast<IntegerType>())
+    return intTy.getWidth() == 8 || intTy.getWidth() == 16 ||
+           intTy.getWidth() == 32 || intTy.getWidth() == 64;
+  return false;
+}
+
+/// Check whether the element types of the first operand and of the result of
+/// an operation are supported by constprop.
+bool hasConstPropElementTypes(Value result) {
+  Operation *op = result.getDefiningOp();
+  return isConstPropElementType(
+             op->getOperand(0).getType().cast<ShapedType>().getElementType()) &&
+         isConstPropElementType(
+             result.getType().cast<ShapedType>().getElementType());
+}
+
+ONNXConstantOp ConstPropCast(
+    PatternRewriter &rewriter, Value replacingValue, Value input) {
+  ShapedType replacingType = replacingValue.getType().cast<ShapedType>();
+  Type inputElementType = input.getType().cast<ShapedType>().getElementType();
+
+  // Get the const value.
+  char *inputArray =
+      getArrayFromAttributeOrBuffer(rewriter, input.getDefiningOp());
+
+  // Do calculation, in place if the input is no longer needed.
+  // Use maximum size (double or int64_t) to avoid the precision loss.
+  char *resArray = reuseOrAllocateBufferFor(input, replacingValue);
+  ConstPropCastImpl(inputElementType, replacingType.getElementType(),
+      inputArray, getNumberOfElements(replacingType.getShape()), resArray);
+
+  // Construct a new ONNXConstantOp.
+  ONNXConstantOp res =
+      createConstantOpAndStoreBufferPtr(rewriter, replacingValue, resArray);
+
+  return res;
+}
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for matmul and gemm.
+//===----------------------------------------------------------------------===//
+
+ONNXConstantOp ConstPropMatMul(
+    PatternRewriter &rewriter, Value replacingValue, Value lhs, Value rhs) {
+  Type elementType =
+      replacingValue.getType().cast<ShapedType>().getElementType();
+  ArrayRef<int64_t> lhsShape = lhs.getType().cast<ShapedType>().getShape();
+  ArrayRef<int64_t> rhsShape = rhs.getType().cast<ShapedType>().getShape();
+
+  // Get lhs and rhs values.
+  char *lhsArray = getArrayFromAttributeOrBuffer(rewriter, lhs.getDefiningOp());
+  char *rhsArray = getArrayFromAttributeOrBuffer(rewriter, rhs.getDefiningOp());
+
+  // Do calculation.
+  // Use maximum size (double or int64_t) to avoid the precision loss.
+  char *resArray =
+      allocateBufferFor(replacingValue.getType(), /*useMaxSize=*/true);
+  ConstPropMatMulImpl(
+      elementType, lhsArray, lhsShape, rhsArray, rhsShape, resArray);
+
+  // Construct a new ONNXConstantOp.
+  ONNXConstantOp res =
+      createConstantOpAndStoreBufferPtr(rewriter, replacingValue, resArray);
+
+  return res;
+}
+
+class ConstPropGemmPattern : public OpRewritePattern<ONNXGemmOp> {
+public:
+  using OpRewritePattern<ONNXGemmOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      ONNXGemmOp gemmOp, PatternRewriter &rewriter) const override {
+    Value replacingValue = gemmOp.getResult();
+    ShapedType replacingType = replacingValue.getType().cast<ShapedType>();
+    Value A = gemmOp.A(), B = gemmOp.B(), C = gemmOp.C();
+    bool hasBias = !C.getType().isa<NoneType>();
+    if (!replacingType.hasStaticShape() || !isFromDenseONNXConstantOp(A) ||
+        !isFromDenseONNXConstantOp(B) ||
+        (hasBias && !isFromDenseONNXConstantOp(C)))
+      return failure();
+
+    // Get the constant input values.
+    char *aArray = getArrayFromAttributeOrBuffer(rewriter, A.getDefiningOp());
+    char *bArray = getArrayFromAttributeOrBuffer(rewriter, B.getDefiningOp());
+    char *cArray = nullptr;
+    ArrayRef<int64_t> cShape;
+    if (hasBias) {
+      cArray = getArrayFromAttributeOrBuffer(rewriter, C.getDefiningOp());
+      cShape = C.getType().cast<ShapedType>().getShape();
+    }
+
+    // Do calculation.
+    char *resArray = allocateBufferFor(replacingType, /*useMaxSize=*/true);
+    ConstPropGemmImpl(replacingType.getElementType(), aArray,
+        A.getType().cast<ShapedType>().getShape(), gemmOp.transA() != 0,
+        bArray, B.getType().cast<ShapedType>().getShape(),
+        gemmOp.transB() != 0, cArray, cShape,
+        gemmOp.alpha().convertToFloat(), gemmOp.beta().convertToFloat(),
+        resArray);
+
+    ONNXConstantOp res =
+        createConstantOpAndStoreBufferPtr(rewriter, replacingValue, resArray);
+    rewriter.replaceOp(gemmOp, res.getResult());
+    return success();
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for slice.
+//===----------------------------------------------------------------------===//
+
+class ConstPropSlicePattern : public OpRewritePattern<ONNXSliceOp> {
+public:
+  using OpRewritePattern<ONNXSliceOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      ONNXSliceOp sliceOp, PatternRewriter &rewriter) const override {
+    Value replacingValue = sliceOp.getResult();
+    ShapedType replacingType = replacingValue.getType().cast<ShapedType>();
+    Value data = sliceOp.data();
+    Value axes = sliceOp.axes(), steps = sliceOp.steps();
+    bool hasAxes = !axes.getType().isa<NoneType>();
+    bool hasSteps = !steps.getType().isa<NoneType>();
+    if (!replacingType.hasStaticShape() ||
+        !isConstPropElementType(replacingType.getElementType()) ||
+        !isFromDenseONNXConstantOp(data) ||
+        !isFromDenseONNXConstantOp(sliceOp.starts()) ||
+        (hasAxes && !isFromDenseONNXConstantOp(axes)) ||
+        (hasSteps && !isFromDenseONNXConstantOp(steps)))
+      return failure();
+    ArrayRef<int64_t> dataShape = data.getType().cast<ShapedType>().getShape();
+    int64_t rank = dataShape.size();
+
+    // Get the integer values, which are int64 in the buffers.
+    auto getValues = [&](Value value) {
+      int64_t *array = reinterpret_cast<int64_t *>(
+          getArrayFromAttributeOrBuffer(rewriter, value.getDefiningOp()));
+      int64_t numElements =
+          getNumberOfElements(value.getType().cast<ShapedType>().getShape());
+      return SmallVector<int64_t, 4>(array, array + numElements);
+    };
+    SmallVector<int64_t, 4> startValues = getValues(sliceOp.starts());
+    SmallVector<int64_t, 4> axisValues, stepValues;
+    if (hasAxes)
+      axisValues = getValues(axes);
+    else
+      for (int64_t i = 0; i < (int64_t)startValues.size(); ++i)
+        axisValues.emplace_back(i);
+    if (hasSteps)
+      stepValues = getValues(steps);
+    else
+      stepValues.assign(startValues.size(), 1);
+
+    // Normalize the starts of the sliced axes, the result type gives the
+    // number of elements taken along each axis. Starts are clamped to
+    // [0, dim] for positive steps and to [0, dim - 1] for negative ones.
+    SmallVector<int64_t, 4> sliceStarts(rank, 0), sliceSteps(rank, 1);
+    for (unsigned i = 0; i < startValues.size(); ++i) {
+      int64_t axis = axisValues[i] < 0 ? axisValues[i] + rank : axisValues[i];
+      int64_t dim = dataShape[axis], step = stepValues[i];
+      int64_t start = startValues[i];
+      if (start < 0)
+        start += dim;
+      start = std::max<int64_t>(0, std::min(start, step > 0 ? dim : dim - 1));
+      sliceStarts[axis] = start;
+      sliceSteps[axis] = step;
+    }
+
+    // Get the const value.
+    char *dataArray =
+        getArrayFromAttributeOrBuffer(rewriter, data.getDefiningOp());
+
+    // Do slicing.
+    char *resArray = allocateBufferFor(replacingType, /*useMaxSize=*/true);
+    ConstPropSliceImpl(replacingType.getElementType(), dataArray, dataShape,
+        sliceStarts, sliceSteps, replacingType.getShape(), resArray);
+
+    ONNXConstantOp res =
+        createConstantOpAndStoreBufferPtr(rewriter, replacingValue, resArray);
+    rewriter.replaceOp(sliceOp, res.getResult());
+    return success();
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for gather.
+//===----------------------------------------------------------------------===//
+
+ONNXConstantOp ConstPropGather(PatternRewriter &rewriter,
+    Value replacingValue, Value data, Value indices) {
+  ShapedType dataType = data.getType().cast<ShapedType>();
+  ArrayRef<int64_t> dataShape = dataType.getShape();
+  Type elementType = dataType.getElementType();
+
+  // Get axis attribute.
+  int64_t axis = replacingValue.getDefiningOp()
+                     ->getAttrOfType<IntegerAttr>("axis")
+                     .getValue()
+                     .getSExtValue();
+  if (axis < 0)
+    axis += dataShape.size();
+
+  // Get the indices, which are int64 in the buffer. Negative indices count
+  // back from the end of the axis.
+  int64_t *indicesArray = reinterpret_cast<int64_t *>(
+      getArrayFromAttributeOrBuffer(rewriter, indices.getDefiningOp()));
+  SmallVector<int64_t, 4> indexValues;
+  for (int64_t i = 0, e = getNumberOfElements(
+                          indices.getType().cast<ShapedType>().getShape());
+       i < e; ++i) {
+    int64_t index = indicesArray[i];
+    indexValues.emplace_back(index < 0 ? index + dataShape[axis] : index);
+  }
+
+  // Get the const value.
+  char *dataArray =
+      getArrayFromAttributeOrBuffer(rewriter, data.getDefiningOp());
+
+  // Do calculation.
+  // Use maximum size (double or int64_t) to avoid the precision loss.
+  char *resArray =
+      allocateBufferFor(replacingValue.getType(), /*useMaxSize=*/true);
+  ConstPropGatherImpl(
+      elementType, dataArray, dataShape, axis, indexValues, resArray);
+
+  // Construct a new ONNXConstantOp.
+  ONNXConstantOp res =
+      createConstantOpAndStoreBufferPtr(rewriter, replacingValue, resArray);
+
+  return res;
+}
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for concat.
+//===----------------------------------------------------------------------===//
+
+class ConstPropConcatPattern : public OpRewritePattern<ONNXConcatOp> {
+public:
+  using OpRewritePattern<ONNXConcatOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      ONNXConcatOp concatOp, PatternRewriter &rewriter) const override {
+    Value replacingValue = concatOp.getResult();
+    ShapedType replacingType = replacingValue.getType().cast<ShapedType>();
+    if (!replacingType.hasStaticShape())
+      return failure();
+    for (Value input : concatOp.inputs())
+      if (!isFromDenseONNXConstantOp(input))
+        return failure();
+    Type elementType = replacingType.getElementType();
+
+    // Concat axis.
+    int64_t axis = concatOp.axis();
+    if (axis < 0)
+      axis += replacingType.getRank();
+
+    // Get the constant input values.
+    SmallVector<char *, 4> inputArrays;
+    SmallVector<ArrayRef<int64_t>, 4> inputShapes;
+    for (Value input : concatOp.inputs()) {
+      inputArrays.emplace_back(
+          getArrayFromAttributeOrBuffer(rewriter, input.getDefiningOp()));
+      inputShapes.emplace_back(input.getType().cast<ShapedType>().getShape());
+    }
+
+    // Do concatenation.
+    char *resArray = allocateBufferFor(replacingType, /*useMaxSize=*/true);
+    ConstPropConcatImpl(elementType, inputArrays, inputShapes, axis, resArray);
+
+    ONNXConstantOp res =
+        createConstantOpAndStoreBufferPtr(rewriter, replacingValue, resArray);
+    rewriter.replaceOp(concatOp, res.getResult());
+    return success();
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for constant of shape.
+//===----------------------------------------------------------------------===//
+
+class ConstPropConstantOfShapePattern
+    : public OpRewritePattern<ONNXConstantOfShapeOp> {
+public:
+  using OpRewritePattern<ONNXConstantOfShapeOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(ONNXConstantOfShapeOp constantOfShapeOp,
+      PatternRewriter &rewriter) const override {
+    // The shape is known once shape inference has seen a constant input.
+    Value replacingValue = constantOfShapeOp.getResult();
+    ShapedType replacingType = replacingValue.getType().cast<ShapedType>();
+    if (!replacingType.hasStaticShape() ||
+        !isFromDenseONNXConstantOp(constantOfShapeOp.input()))
+      return failure();
+
+    // The result is a splat of 'value', which defaults to a float zero.
+    Attribute splatValue;
+    if (auto valueAttr = constantOfShapeOp.valueAttr())
+      splatValue = valueAttr.cast<DenseElementsAttr>().getSplatValue();
+    else
+      splatValue = rewriter.getF32FloatAttr(0);
+    DenseElementsAttr denseAttr = DenseElementsAttr::get(
+        constructRankedTensorType(replacingType), splatValue);
+
+    rewriter.replaceOpWithNewOp<ONNXConstantOp>(constantOfShapeOp,
+        replacingType, Attribute(), denseAttr, FloatAttr(), ArrayAttr(),
+        IntegerAttr(), ArrayAttr(), StringAttr(), ArrayAttr());
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // Code to perform constant propagation for split.
 //===----------------------------------------------------------------------===//
@@ -596,31 +990,77 @@ void ConstPropONNXToONNXPass::runOnFunction() {
 
   RewritePatternSet patterns(context);
   populateWithGenerated(patterns);
-  patterns.insert<ConstPropSplitPattern>(&getContext());
+  patterns.insert<ConstPropSplitPattern, ConstPropConcatPattern,
+      ConstPropConstantOfShapePattern, ConstPropGemmPattern,
+      ConstPropSlicePattern>(&getContext());
+  // Fold static Shape and Size so that shape computations, e.g. Shape ->
+  // Gather -> Concat -> Reshape, become constant.
+  ONNXShapeOp::getCanonicalizationPatterns(patterns, context);
+  ONNXSizeOp::getCanonicalizationPatterns(patterns, context);
+  FrozenRewritePatternSet frozenPatterns(std::move(patterns));
+
+  auto propagateConstants = [&]() -> LogicalResult {
+    if (failed(applyPatternsAndFoldGreedily(function, frozenPatterns)))
+      return failure();
+
+    // Create DenseElementsAttr and clean up helper attributes. The buffers are
+    // released as soon as their last constant is created.
+    function.walk([&](ONNXConstantOp constOp) {
+      Operation *op = constOp.getOperation();
+      if (IntegerAttr bufferIDAttr =
+              op->getAttrOfType<IntegerAttr>(BUFFER_ID_ATTR)) {
+        char *arr = allocateBufferFor(constOp.getResult().getType());
+        getArrayForFinalOutput(op, arr);
+        ShapedType type = constOp.getResult().getType().cast<ShapedType>();
+        DenseElementsAttr denseAttr =
+            createDenseElementsAttrFromArray(arr, type);
+        op->setAttr("value", denseAttr);
+        op->removeAttr(BUFFER_ID_ATTR);
+        releaseBufferUse(bufferIDAttr.getUInt());
+        free(arr);
+      }
+    });
+
+    // Remove temporary buffers.
+    for (ConstPropBuffer &buffer : bufferPool)
+      free(buffer.ptr);
+    bufferPool.clear();
+    bufferIds.clear();
+    return success();
+  };
 
-  if (failed(applyPatternsAndFoldGreedily(function, std::move(patterns))))
+  if (failed(propagateConstants())) {
     signalPassFailure();
+    return;
+  }
 
-  // Create DenseElementsAttr and clean up helper attributes.
-  function.walk([&](ONNXConstantOp constOp) {
-    Operation *op = constOp.getOperation();
-    if (op->getAttrOfType<::mlir::Attribute>(BUFFER_ID_ATTR)) {
-      char *arr = allocateBufferFor(constOp.getResult().getType());
-      getArrayForFinalOutput(op, arr);
-      ShapedType type = constOp.getResult().getType().cast<ShapedType>();
-      DenseElementsAttr denseAttr = createDenseElementsAttrFromArray(arr, type);
-      op->setAttr("value", denseAttr);
-      op->removeAttr(BUFFER_ID_ATTR);
-      free(arr);
-    }
+  // The shape operands of ConstantOfShape and Reshape may have been folded
+  // into constants, which gives them static result types that shape inference
+  // could not see. Refine these types, then propagate the now static results.
+  bool refined = false;
+  function.walk([&](Operation *op) {
+    if (!isa<ONNXConstantOfShapeOp, ONNXReshapeOp>(op))
+      return;
+    ShapedType type = op->getResult(0).getType().dyn_cast<ShapedType>();
+    Value shape = op->getOperands().back();
+    if (!type || type.hasStaticShape() || !isFromDenseONNXConstantOp(shape))
+      return;
+    if (failed(cast<ShapeInference>(op).inferShapes([](Region &) {})))
+      return;
+    refined = true;
   });
-
-  // Remove temporary buffers.
-  for (char *ptr : bufferPtrs) {
-    free(ptr);
+  if (!refined)
+    return;
+  if (failed(propagateConstants())) {
+    signalPassFailure();
+    return;
   }
-  bufferPtrs.clear();
 
+  // Refined types may reach the function results.
+  Operation *returnOp = function.getBody().back().getTerminator();
+  auto results = returnOp->getOperandTypes();
+  function.setType(FunctionType::get(context, function.getType().getInputs(),
+      std::vector<Type>(results.begin(), results.end())));
 } // end anonymous namespace
 
 /*!
@@ -117,9 +117,19 @@ char *createArrayFromDenseElementsAttr(DenseElementsAttr dataAttr) {
   if (elementType.isa<FloatType>()) {
     // Use double to avoid the precision loss during computation.
     double *resArr = (double *)res;
+    bool isHalf = elementType.cast<FloatType>().getWidth() == 16;
     auto valueIt = dataAttr.getFloatValues().begin();
     for (int64_t i = 0; i < numElements; ++i) {
-      double val = (double)(*valueIt++).convertToFloat();
+      double val;
+      if (isHalf) {
+        // Half precision floats do not convert directly to float.
+        APFloat apVal = *valueIt++;
+        bool losesInfo;
+        apVal.convert(
+            APFloat::IEEEdouble(), APFloat::rmNearestTiesToEven, &losesInfo);
+        val = apVal.convertToDouble();
+      } else
+        val = (double)(*valueIt++).convertToFloat();
       *(resArr + i) = val;
     }
   } else if (elementType.isa<IntegerType>()) {
@@ -175,6 +185,17 @@ void convertDoubleInt64ToExactType(Type outType, char *inArr, char *outArr) {
         *(inArrFloat + i) = (float)*(inArrDouble + i);
     } else if (floatTy.getWidth() == 64) {
       std::copy(inArr, inArr + maxSizeInBytes, outArr);
+    } else if (floatTy.getWidth() == 16) {
+      // Round to the nearest f16 or bf16, and store its bits.
+      double *inArrDouble = (double *)inArr;
+      uint16_t *inArrHalf = (uint16_t *)outArr;
+      for (int64_t i = 0; i < numElements; ++i) {
+        APFloat val(*(inArrDouble + i));
+        bool losesInfo;
+        val.convert(floatTy.getFloatSemantics(), APFloat::rmNearestTiesToEven,
+            &losesInfo);
+        *(inArrHalf + i) = (uint16_t)val.bitcastToAPInt().getZExtValue();
+      }
     } else
       llvm_unreachable("Unknown data type");
   } else if (elementType.isa<IntegerType>()) {
@@ -186,6 +207,16 @@ void convertDoubleInt64ToExactType(Type outType, char *inArr, char *outArr) {
         *(inArrInt32 + i) = (int32_t)(*(inArrInt64 + i));
     } else if (intTy.getWidth() == 64) {
       std::copy(inArr, inArr + maxSizeInBytes, outArr);
+    } else if (intTy.getWidth() == 16) {
+      int64_t *inArrInt64 = (int64_t *)inArr;
+      int16_t *inArrInt16 = (int16_t *)outArr;
+      for (int64_t i = 0; i < numElements; ++i)
+        *(inArrInt16 + i) = (int16_t)(*(inArrInt64 + i));
+    } else if (intTy.getWidth() == 8) {
+      int64_t *inArrInt64 = (int64_t *)inArr;
+      int8_t *inArrInt8 = (int8_t *)outArr;
+      for (int64_t i = 0; i < numElements; ++i)
+        *(inArrInt8 + i) = (int8_t)(*(inArrInt64 + i));
     } else
       llvm_unreachable("Unknown data type");
   } else
@@ -318,3 +349,368 @@ void ConstPropTransposeImpl(Type elementType, char *constArray,
   } else
     llvm_unreachable("Unknown data type");
 }
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for gather and concat.
+//===----------------------------------------------------------------------===//
+
+template <typename T>
+void IterateConstPropGather(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, uint64_t axis,
+    llvm::ArrayRef<int64_t> indices, char *resArray) {
+  T *constArrayT = reinterpret_cast<T *>(constArray);
+  T *resArrayT = reinterpret_cast<T *>(resArray);
+  int64_t outer = 1, inner = 1;
+  for (uint64_t i = 0; i < axis; ++i)
+    outer *= constShape[i];
+  for (uint64_t i = axis + 1; i < constShape.size(); ++i)
+    inner *= constShape[i];
+  int64_t axisDim = constShape[axis];
+  int64_t numIndices = indices.size();
+  for (int64_t o = 0; o < outer; ++o)
+    for (int64_t k = 0; k < numIndices; ++k) {
+      T *src = constArrayT + (o * axisDim + indices[k]) * inner;
+      T *dst = resArrayT + (o * numIndices + k) * inner;
+      std::copy(src, src + inner, dst);
+    }
+}
+
+void ConstPropGatherImpl(Type elementType, char *constArray,
+    llvm::ArrayRef<int64_t> constShape, uint64_t axis,
+    llvm::ArrayRef<int64_t> indices, char *resArray) {
+  if (elementType.isa<FloatType>()) {
+    // Use double to avoid the precision loss during computation.
+    IterateConstPropGather<double>(
+        constArray, constShape, axis, indices, resArray);
+  } else if (elementType.isa<IntegerType>()) {
+    // Use int64_t to avoid the precision loss during computation.
+    IterateConstPropGather<int64_t>(
+        constArray, constShape, axis, indices, resArray);
+  } else
+    llvm_unreachable("Unknown data type");
+}
+
+template <typename T>
+void IterateConstPropConcat(llvm::ArrayRef<char *> constArrays,
+    llvm::ArrayRef<llvm::ArrayRef<int64_t>> constShapes, uint64_t axis,
+    char *resArray) {
+  T *resArrayT = reinterpret_cast<T *>(resArray);
+  llvm::ArrayRef<int64_t> firstShape = constShapes[0];
+  int64_t outer = 1, inner = 1, resAxisDim = 0;
+  for (uint64_t i = 0; i < axis; ++i)
+    outer *= firstShape[i];
+  for (uint64_t i = axis + 1; i < firstShape.size(); ++i)
+    inner *= firstShape[i];
+  for (llvm::ArrayRef<int64_t> shape : constShapes)
+    resAxisDim += shape[axis];
+  // Each input contributes a contiguous block of axis x inner elements to each
+  // outer row of the result.
+  int64_t offset = 0;
+  for (unsigned n = 0; n < constArrays.size(); ++n) {
+    T *constArrayT = reinterpret_cast<T *>(constArrays[n]);
+    int64_t blockSize = constShapes[n][axis] * inner;
+    for (int64_t o = 0; o < outer; ++o) {
+      T *src = constArrayT + o * blockSize;
+      std::copy(src, src + blockSize,
+          resArrayT + o * resAxisDim * inner + offset);
+    }
+    offset += blockSize;
+  }
+}
+
+void ConstPropConcatImpl(Type elementType, llvm::ArrayRef<char *> constArrays,
+    llvm::ArrayRef<llvm::ArrayRef<int64_t>> constShapes, uint64_t axis,
+    char *resArray) {
+  if (elementType.isa<FloatType>()) {
+    // Use double to avoid the precision loss during computation.
+    IterateConstPropConcat<double>(constArrays, constShapes, axis, resArray);
+  } else if (elementType.isa<IntegerType>()) {
+    // Use int64_t to avoid the precision loss during computation.
+    IterateConstPropConcat<int64_t>(constArrays, constShapes, axis, resArray);
+  } else
+    llvm_unreachable("Unknown data type");
+}
+
+//===----------------------------------------------------------------------===//
+// Code to perform constant propagation for cast, matmul, gemm and slice.
+//===----------------------------------------------------------------------===//
+
+void ConstPropCastImpl(Type inputElementType, Type outputElementType,
+    char *constArray, int64_t numElements, char *resArray) {
+  bool fromFloat = inputElementType.isa<FloatType>();
+  double *constArrayDouble = reinterpret_cast<double *>(constArray);
+  int64_t *constArrayInt64 = reinterpret_cast<int64_t *>(constArray);
+  if (FloatType floatTy = outputElementType.dyn_cast<FloatType>()) {
+    double *resArrayT = reinterpret_cast<double *>(resArray);
+    for (int64_t i = 0; i < numElements; ++i) {
+      double val = fromFloat ? constArrayDouble[i] : (double)constArrayInt64[i];
+      // Round to the precision of the result type.
+      APFloat apVal(val);
+      bool losesInfo;
+      apVal.convert(floatTy.getFloatSemantics(), APFloat::rmNearestTiesToEven,
+          &losesInfo);
+      apVal.convert(
+          APFloat::IEEEdouble(), APFloat::rmNearestTiesToEven, &losesInfo);
+      resArrayT[i] = apVal.convertToDouble();
+    }
+  } else {
+    IntegerType intTy = outputElementType.cast<IntegerType>();
+    int64_t *resArrayT = reinterpret_cast<int64_t *>(resArray);
+    for (int64_t i = 0; i < numElements; ++i) {
+      // Floating point values are truncated toward zero, and all the values
+      // wrap around to the width of the result type.
+      int64_t val =
+          fromFloat ? (int64_t)constArrayDouble[i] : constArrayInt64[i];
+      APInt apVal =
+          APInt(64, val, /*isSigned=*/true).truncOrSelf(intTy.getWidth());
+      resArrayT[i] =
+          intTy.isUnsigned() ? apVal.getZExtValue() : apVal.getSExtValue();
+    }
+  }
+}
+
+template <typename T>
+void IterateConstPropMatMul(char *lhsArray, llvm::ArrayRef<int64_t> lhsShape,
+    char *rhsArray, llvm::ArrayRef<int64_t> rhsShape, char *resArray) {
+  T *lhsArrayT = reinterpret_cast<T *>(lhsArray);
+  T *rhsArrayT = reinterpret_cast<T *>(rhsArray);
+  T *resArrayT = reinterpret_cast<T *>(resArray);
+
+  // A 1-D lhs [K] is a [1, K] matrix and a 1-D rhs [K] is a [K, 1] matrix,
+  // which does not change the layout of the result.
+  SmallVector<int64_t, 4> aShape(lhsShape.begin(), lhsShape.end());
+  SmallVector<int64_t, 4> bShape(rhsShape.begin(), rhsShape.end());
+  if (aShape.size() == 1)
+    aShape.insert(aShape.begin(), 1);
+  if (bShape.size() == 1)
+    bShape.emplace_back(1);
+  int64_t aRank = aShape.size(), bRank = bShape.size();
+  int64_t M = aShape[aRank - 2], K = aShape[aRank - 1], N = bShape[bRank - 1];
+
+  // The batch dimensions are broadcast.
+  int64_t batchRank = std::max(aRank, bRank) - 2;
+  SmallVector<int64_t, 4> batchShape, aBatchShape, bBatchShape;
+  for (int64_t i = 0; i < batchRank; ++i) {
+    int64_t aIndex = i - batchRank + aRank - 2;
+    int64_t bIndex = i - batchRank + bRank - 2;
+    aBatchShape.emplace_back(aIndex >= 0 ? aShape[aIndex] : 1);
+    bBatchShape.emplace_back(bIndex >= 0 ? bShape[bIndex] : 1);
+    batchShape.emplace_back(std::max(aBatchShape[i], bBatchShape[i]));
+  }
+  std::vector<int64_t> batchStrides = getStrides(batchShape);
+  std::vector<int64_t> aBatchStrides = getStrides(aBatchShape);
+  std::vector<int64_t> bBatchStrides = getStrides(bBatchShape);
+
+  for (int64_t batch = 0; batch < getNumberOfElements(batchShape); ++batch) {
+    std::vector<int64_t> batchIndices = getAccessIndex(batch, batchStrides);
+    int64_t aBatch = 0, bBatch = 0;
+    for (int64_t i = 0; i < batchRank; ++i) {
+      if (aBatchShape[i] != 1)
+        aBatch += batchIndices[i] * aBatchStrides[i];
+      if (bBatchShape[i] != 1)
+        bBatch += batchIndices[i] * bBatchStrides[i];
+    }
+    T *a = lhsArrayT + aBatch * M * K;
+    T *b = rhsArrayT + bBatch * K * N;
+    T *res = resArrayT + batch * M * N;
+    for (int64_t m = 0; m < M; ++m)
+      for (int64_t n = 0; n < N; ++n) {
+        T sum = 0;
+        for (int64_t k = 0; k < K; ++k)
+          sum += a[m * K + k] * b[k * N + n];
+        res[m * N + n] = sum;
+      }
+  }
+}
+
+void ConstPropMatMulImpl(Type elementType, char *lhsArray,
+    llvm::ArrayRef<int64_t> lhsShape, char *rhsArray,
+    llvm::ArrayRef<int64_t> rhsShape, char *resArray) {
+  if (elementType.isa<FloatType>()) {
+    // Use double to avoid the precision loss during computation.
+    IterateConstPropMatMul<double>(
+        lhsArray, lhsShape, rhsArray, rhsShape, resArray);
+  } else if (elementType.isa<IntegerType>()) {
+    // Use int64_t to avoid the precision loss during computation.
+    IterateConstPropMatMul<int64_t>(
+        lhsArray, lhsShape, rhsArray, rhsShape, resArray);
+  } else
+    llvm_unreachable("Unknown data type");
+}
+
+template <typename T>
+void IterateConstPropGemm(char *aArray, llvm::ArrayRef<int64_t> aShape,
+    bool transA, char *bArray, llvm::ArrayRef<int64_t> bShape, bool transB,
+    char *cArray, llvm::ArrayRef<int64_t> cShape, double alpha, double beta,
+    char *resArray) {
+  T *aArrayT = reinterpret_cast<T *>(aArray);
+  T *bArrayT = reinterpret_cast<T *>(bArray);
+  T *cArrayT = reinterpret_cast<T *>(cArray);
+  T *resArrayT = reinterpret_cast<T *>(resArray);
+
+  int64_t M = transA ? aShape[1] : aShape[0];
+  int64_t K = transA ? aShape[0] : aShape[1];
+  int64_t N = transB ? bShape[0] : bShape[1];
+  // C is unidirectionally broadcast to [M, N].
+  int64_t cRank = cShape.size();
+  int64_t cM = (cRank == 2) ? cShape[0] : 1;
+  int64_t cN = (cRank >= 1) ? cShape[cRank - 1] : 1;
+
+  for (int64_t m = 0; m < M; ++m)
+    for (int64_t n = 0; n < N; ++n) {
+      T sum = 0;
+      for (int64_t k = 0; k < K; ++k) {
+        T a = transA ? aArrayT[k * M + m] : aArrayT[m * K + k];
+        T b = transB ? bArrayT[n * K + k] : bArrayT[k * N + n];
+        sum += a * b;
+      }
+      T res = (T)(alpha * sum);
+      if (cArrayT)
+        res += (T)(
+            beta * cArrayT[(cM == 1 ? 0 : m) * cN + (cN == 1 ? 0 : n)]);
+      resArrayT[m * N + n] = res;
+    }
+}
+
+void ConstPropGemmImpl(Type elementType, char *aArray,
+    llvm::ArrayRef<int64_t> aShape, bool transA, char *bArray,
+    llvm::ArrayRef<int64_t> bShape, bool transB, char *cArray,
+    llvm::ArrayRef<int64_t> cShape, double alpha, double beta,
+    char *resArray) {
+  if (elementType.isa<FloatType>()) {
+    // Use double to avoid the precision loss during computation.
+    IterateConstPropGemm<double>(aArray, aShape, transA, bArray, bShape,
+        transB, cArray, cShape, alpha, beta, resArray);
+  } else if (elementType.isa<IntegerType>()) {
+    // Use int64_t to avoid the precision loss during computation.
+    IterateConstPropGemm<int64_t>(aArray, aShape, transA, bArray, bShape,
+        transB, cArray, cShape, alpha, beta, resArray);
+  } else
+    llvm_unreachable("Unknown data type");
+}
+
+template <typename T>
+void IterateConstPropSlice(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, llvm::ArrayRef<int64_t> starts,
+    llvm::ArrayRef<int64_t> steps, llvm::ArrayRef<int64_t> resShape,
+    char *resArray) {
+  T *constArrayT = reinterpret_cast<T *>(constArray);
+  T *resArrayT = reinterpret_cast<T *>(resArray);
+  std::vector<int64_t> constStrides = getStrides(constShape);
+  std::vector<int64_t> resStrides = getStrides(resShape);
+  for (int64_t i = 0; i < getNumberOfElements(resShape); ++i) {
+    std::vector<int64_t> resIndices = getAccessIndex(i, resStrides);
+    int64_t constOffset = 0;
+    for (unsigned j = 0; j < resShape.size(); ++j)
+      constOffset += (starts[j] + resIndices[j] * steps[j]) * constStrides[j];
+    resArrayT[i] = constArrayT[constOffset];
+  }
+}
+
+void ConstPropSliceImpl(Type elementType, char *constArray,
+    llvm::ArrayRef<int64_t> constShape, llvm::ArrayRef<int64_t> starts,
+    llvm::ArrayRef<int64_t> steps, llvm::ArrayRef<int64_t> resShape,
+    char *resArray) {
+  if (elementType.isa<FloatType>()) {
+    IterateConstPropSlice<double>(
+        constArray, constShape, starts, steps, resShape, resArray);
+  } else if (elementType.isa<IntegerType>()) {
+    IterateConstPropSlice<int64_t>(
+        constArray, constShape, starts, steps, resShape, resArray);
+  } else
+    llvm_unreachable("Unknown data type");
+}
+
+//===----------------------------------------------------------------------===//
+// Code to precompute the kernel transform of Winograd convolutions.
+//===----------------------------------------------------------------------===//
+
+void ConstPropWinogradKernelImpl(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, char *resArray) {
+  assert(constShape.size() == 4 && constShape[2] == 3 && constShape[3] == 3 &&
+         "Expect MxCx3x3 kernels");
+  // Kernel transform matrix of F(2x2, 3x3).
+  const double G[4][3] = {
+      {1.0, 0.0, 0.0}, {0.5, 0.5, 0.5}, {0.5, -0.5, 0.5}, {0.0, 0.0, 1.0}};
+  int64_t numKernels = constShape[0];
+  int64_t numChannels = constShape[1];
+
+  // Use double to avoid the precision loss during computation.
+  double *constArrayT = reinterpret_cast<double *>(constArray);
+  double *resArrayT = reinterpret_cast<double *>(resArray);
+  for (int64_t m = 0; m < numKernels; ++m)
+    for (int64_t c = 0; c < numChannels; ++c) {
+      double *g = constArrayT + (m * numChannels + c) * 9;
+      // U = G * g * G^T, stored at U[i * 4 + j][m][c].
+      for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j) {
+          double u = 0;
+          for (int k = 0; k < 3; ++k)
+            for (int l = 0; l < 3; ++l)
+              u += G[i][k] * g[k * 3 + l] * G[j][l];
+          resArrayT[((i * 4 + j) * numKernels + m) * numChannels + c] = u;
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Code to pack the constant kernels of convolutions in the blocked layout.
+//===----------------------------------------------------------------------===//
+
+void ConstPropPackBlockedConvKernelImpl(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, int64_t blockSize, char *resArray) {
+  assert(constShape.size() >= 3 && "Expect MxCxK1x...xKd kernels");
+  int64_t numKernels = constShape[0];
+  int64_t numChannels = constShape[1];
+  int64_t numKernelBlocks = (numKernels + blockSize - 1) / blockSize;
+  int64_t numChannelBlocks = (numChannels + blockSize - 1) / blockSize;
+  int64_t kernelSize = 1;
+  for (int64_t dim : constShape.drop_front(2))
+    kernelSize *= dim;
+
+  double *constArrayT = reinterpret_cast<double *>(constArray);
+  double *resArrayT = reinterpret_cast<double *>(resArray);
+  int64_t resSize =
+      numKernelBlocks * numChannelBlocks * kernelSize * blockSize * blockSize;
+  std::fill(resArrayT, resArrayT + resSize, 0.0);
+  // K[m][c][k] is stored at KP[m / b][c / b][k][c % b][m % b].
+  for (int64_t m = 0; m < numKernels; ++m)
+    for (int64_t c = 0; c < numChannels; ++c)
+      for (int64_t k = 0; k < kernelSize; ++k) {
+        int64_t block =
+            (m / blockSize) * numChannelBlocks * kernelSize +
+            (c / blockSize) * kernelSize + k;
+        resArrayT[(block * blockSize + c % blockSize) * blockSize +
+                  m % blockSize] =
+            constArrayT[(m * numChannels + c) * kernelSize + k];
+      }
+}
+
+//===----------------------------------------------------------------------===//
+// Code to pack the constant B matrices of matrix multiplies into panels.
+//===----------------------------------------------------------------------===//
+
+void ConstPropPackMatMulPanelsImpl(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, bool transposed, int64_t kTile,
+    int64_t jTile, char *resArray) {
+  assert(constShape.size() == 2 && "Expect a 2D matrix");
+  int64_t K = transposed ? constShape[1] : constShape[0];
+  int64_t J = transposed ? constShape[0] : constShape[1];
+  int64_t numKTiles = (K + kTile - 1) / kTile;
+  int64_t numJTiles = (J + jTile - 1) / jTile;
+
+  double *constArrayT = reinterpret_cast<double *>(constArray);
+  double *resArrayT = reinterpret_cast<double *>(resArray);
+  for (int64_t kt = 0; kt < numKTiles; ++kt)
+    for (int64_t jt = 0; jt < numJTiles; ++jt) {
+      double *panel = resArrayT + (kt * numJTiles + jt) * kTile * jTile;
+      for (int64_t kk = 0; kk < kTile; ++kk)
+        for (int64_t jj = 0; jj < jTile; ++jj) {
+          int64_t k = kt * kTile + kk, j = jt * jTile + jj;
+          double val = 0;
+          if (k < K && j < J)
+            val = transposed ? constArrayT[j * K + k] : constArrayT[k * J + j];
+          panel[kk * jTile + jj] = val;
+        }
+    }
+}
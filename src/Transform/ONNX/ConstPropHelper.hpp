@@ -86,3 +86,62 @@ void ConstPropSplitImpl(Type elementType, char *constArray,
 void ConstPropTransposeImpl(Type elementType, char *constArray,
     llvm::ArrayRef<int64_t> constShape, llvm::ArrayRef<uint64_t> perm,
     llvm::ArrayRef<int64_t> resShape, char *resArray);
+
+/// Constant propagation for gather: the slices at 'indices' along 'axis' are
+/// copied. Indices are expected to be non-negative.
+void ConstPropGatherImpl(Type elementType, char *constArray,
+    llvm::ArrayRef<int64_t> constShape, uint64_t axis,
+    llvm::ArrayRef<int64_t> indices, char *resArray);
+
+/// Constant propagation for concat.
+void ConstPropConcatImpl(Type elementType, llvm::ArrayRef<char *> constArrays,
+    llvm::ArrayRef<llvm::ArrayRef<int64_t>> constShapes, uint64_t axis,
+    char *resArray);
+
+/// Constant propagation for cast: the values of the input element type are
+/// converted to the output element type and rounded to its precision.
+void ConstPropCastImpl(Type inputElementType, Type outputElementType,
+    char *constArray, int64_t numElements, char *resArray);
+
+/// Constant propagation for matmul, with the batch dimensions broadcast.
+void ConstPropMatMulImpl(Type elementType, char *lhsArray,
+    llvm::ArrayRef<int64_t> lhsShape, char *rhsArray,
+    llvm::ArrayRef<int64_t> rhsShape, char *resArray);
+
+/// Constant propagation for gemm: alpha * A' * B' + beta * C, where C is
+/// ignored when 'cArray' is null.
+void ConstPropGemmImpl(Type elementType, char *aArray,
+    llvm::ArrayRef<int64_t> aShape, bool transA, char *bArray,
+    llvm::ArrayRef<int64_t> bShape, bool transB, char *cArray,
+    llvm::ArrayRef<int64_t> cShape, double alpha, double beta,
+    char *resArray);
+
+/// Constant propagation for slice: index i of each dimension of the result
+/// reads index starts[d] + i * steps[d] of the input. Starts are expected to
+/// be normalized, i.e. non-negative and clamped.
+void ConstPropSliceImpl(Type elementType, char *constArray,
+    llvm::ArrayRef<int64_t> constShape, llvm::ArrayRef<int64_t> starts,
+    llvm::ArrayRef<int64_t> steps, llvm::ArrayRef<int64_t> resShape,
+    char *resArray);
+
+/// Constant propagation for the kernel transform of Winograd F(2x2, 3x3)
+/// convolutions: MxCx3x3 floating point kernels are transformed into one MxC
+/// matrix per position of the 4x4 transformed tiles, i.e. a 16xMxC array.
+void ConstPropWinogradKernelImpl(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, char *resArray);
+
+/// Constant propagation for the packing of the kernels of convolutions in the
+/// blocked layout: M x C x K1 x ... x Kd floating point kernels are split into
+/// b x b matrices from the input channels of a block to the output channels
+/// of a block, stored in a zero padded ceil(M / b) x ceil(C / b) x K1 x ... x
+/// Kd x b x b array.
+void ConstPropPackBlockedConvKernelImpl(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, int64_t blockSize, char *resArray);
+
+/// Constant propagation for the packing of the B matrices of matrix
+/// multiplies: a KxJ (or JxK when transposed) floating point matrix is split
+/// into kTile x jTile panels, stored contiguously in a zero padded
+/// ceil(K / kTile) x ceil(J / jTile) x kTile x jTile array.
+void ConstPropPackMatMulPanelsImpl(char *constArray,
+    llvm::ArrayRef<int64_t> constShape, bool transposed, int64_t kTile,
+    int64_t jTile, char *resArray);
@@ -0,0 +1,123 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- InferenceCleanup.cpp - Remove the Training-Only Operations ---===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that removes from a graph run for inference
+// the operations and the results that only matter for training, before shape
+// inference, so that no buffer is allocated for them:
+//
+//   - Dropout is the identity at inference, its mask all true.
+//   - Identity is an alias of its input.
+//   - BatchNormalization computing its running and saved statistics becomes
+//     BatchNormalizationTestMode when they are not used, and normalizes with
+//     the running statistics of its inputs.
+//   - The unused optional outputs of the recurrent ops, LSTM, GRU and RNN,
+//     become none, which their lowerings skip.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return true if none of the results of the op but the first one is used.
+bool hasOnlyFirstResultUsed(Operation *op) {
+  return llvm::all_of(op->getResults().drop_front(),
+      [](Value result) { return result.use_empty(); });
+}
+
+// Replace a Dropout by its input. A used mask is replaced by a constant of
+// trues when its shape is static, otherwise the Dropout is kept for it.
+void cleanupDropout(ONNXDropoutOp dropoutOp) {
+  dropoutOp.output().replaceAllUsesWith(dropoutOp.data());
+  if (!dropoutOp.mask().use_empty()) {
+    auto dataType = dropoutOp.data().getType().dyn_cast<RankedTensorType>();
+    if (!dataType || !dataType.hasStaticShape())
+      return;
+    OpBuilder builder(dropoutOp);
+    auto maskType =
+        RankedTensorType::get(dataType.getShape(), builder.getI1Type());
+    Value mask = builder.create<ONNXConstantOp>(dropoutOp.getLoc(),
+        Attribute(), DenseElementsAttr::get(maskType, true));
+    dropoutOp.mask().replaceAllUsesWith(mask);
+  }
+  dropoutOp.erase();
+}
+
+// Replace a BatchNormalization whose statistics are not used by its test
+// mode.
+void cleanupBatchNormalization(ONNXBatchNormalizationOp bnOp) {
+  if (!hasOnlyFirstResultUsed(bnOp))
+    return;
+  OpBuilder builder(bnOp);
+  Value y = builder.create<ONNXBatchNormalizationTestModeOp>(bnOp.getLoc(),
+      bnOp.Y().getType(), bnOp.X(), bnOp.scale(), bnOp.B(), bnOp.mean(),
+      bnOp.var(), builder.getF32FloatAttr(bnOp.epsilon().convertToFloat()),
+      builder.getF32FloatAttr(bnOp.momentum().convertToFloat()));
+  bnOp.Y().replaceAllUsesWith(y);
+  bnOp.erase();
+}
+
+// Make the unused results of a recurrent op none.
+void cleanupRecurrentOp(Operation *op) {
+  for (Value result : op->getResults())
+    if (result.use_empty())
+      result.setType(NoneType::get(op->getContext()));
+}
+
+/*!
+ *  Function pass that removes the training-only operations and results.
+ */
+struct InferenceCleanupONNXPass
+    : public PassWrapper<InferenceCleanupONNXPass, FunctionPass> {
+  void runOnFunction() final {
+    FuncOp function = getFunction();
+    SmallVector<Operation *, 8> ops;
+    function.walk([&](Operation *op) {
+      if (isa<ONNXDropoutOp, ONNXIdentityOp, ONNXBatchNormalizationOp,
+              ONNXLSTMOp, ONNXGRUOp, ONNXRNNOp>(op))
+        ops.emplace_back(op);
+    });
+    for (Operation *op : ops) {
+      if (auto dropoutOp = dyn_cast<ONNXDropoutOp>(op)) {
+        cleanupDropout(dropoutOp);
+      } else if (auto identityOp = dyn_cast<ONNXIdentityOp>(op)) {
+        identityOp.getResult().replaceAllUsesWith(identityOp.input());
+        identityOp.erase();
+      } else if (auto bnOp = dyn_cast<ONNXBatchNormalizationOp>(op)) {
+        cleanupBatchNormalization(bnOp);
+      } else {
+        cleanupRecurrentOp(op);
+      }
+    }
+
+    // The inputs replacing the results may reach the function results.
+    if (ops.empty() || function.isExternal())
+      return;
+    Operation *returnOp = function.getBody().back().getTerminator();
+    auto results = returnOp->getOperandTypes();
+    function.setType(FunctionType::get(function.getContext(),
+        function.getType().getInputs(),
+        std::vector<Type>(results.begin(), results.end())));
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create an InferenceCleanupONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createInferenceCleanupONNXPass() {
+  return std::make_unique<InferenceCleanupONNXPass>();
+}
@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------- InlineFunctions.cpp - Inline the small functions ----------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that inlines the calls of the small functions
+// of a model, e.g. of the model-local functions and of the function ops the
+// frontend imports as calls of their function bodies. The calls are otherwise
+// boundaries to the shape inference, the constant propagation and the fusions
+// of the ops around them.
+//
+// A function is inlined when its body is a single block of at most max-ops
+// ops and calls no other function, its calls being inlined first, and is not
+// marked noinline like the outlined layers. The functions left without calls
+// are erased, unless an entry point refers to them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Check that the function is marked noinline, e.g. an outlined layer.
+bool isNoInline(FuncOp function) {
+  auto passthrough = function->getAttrOfType<ArrayAttr>("passthrough");
+  return passthrough && llvm::any_of(passthrough, [](Attribute attr) {
+    auto str = attr.dyn_cast<StringAttr>();
+    return str && str.getValue() == "noinline";
+  });
+}
+
+/// Return true if the function can be inlined: its body is a single block
+/// ended by a return, of at most maxOps ops, none of them a call.
+bool isInlinable(FuncOp function, int64_t maxOps) {
+  if (function.isExternal() || isNoInline(function) ||
+      !function.getBody().hasOneBlock() ||
+      !isa<ReturnOp>(function.getBody().front().getTerminator()))
+    return false;
+  int64_t numOps = 0;
+  bool hasCall = false;
+  function.getBody().walk([&](Operation *op) {
+    if (isa<CallOpInterface>(op))
+      hasCall = true;
+    else if (!isa<ReturnOp, ONNXReturnOp>(op))
+      ++numOps;
+  });
+  return !hasCall && numOps <= maxOps;
+}
+
+/// Replace the call by a copy of the body of the function.
+void inlineCall(CallOp callOp, FuncOp function) {
+  Block &body = function.getBody().front();
+  BlockAndValueMapping mapping;
+  mapping.map(body.getArguments(), callOp.getOperands());
+  OpBuilder builder(callOp);
+  for (Operation &op : body.without_terminator())
+    builder.clone(op, mapping);
+  for (auto en : llvm::enumerate(body.getTerminator()->getOperands()))
+    callOp.getResult(en.index())
+        .replaceAllUsesWith(mapping.lookupOrDefault(en.value()));
+  callOp.erase();
+}
+
+class InlineFunctionsONNXPass
+    : public PassWrapper<InlineFunctionsONNXPass, OperationPass<ModuleOp>> {
+public:
+  InlineFunctionsONNXPass() = default;
+  InlineFunctionsONNXPass(const InlineFunctionsONNXPass &pass) {}
+  InlineFunctionsONNXPass(int64_t maxOps) { this->maxOps = maxOps; }
+
+  Option<int64_t> maxOps{*this, "max-ops",
+      llvm::cl::desc("Maximum number of ops of an inlined function."),
+      llvm::cl::init(64)};
+
+  void runOnOperation() final {
+    ModuleOp module = getOperation();
+    SymbolTable symbolTable(module);
+
+    // The calls of the functions calling other functions are inlined once
+    // these functions are inlined into them, round after round.
+    llvm::SmallPtrSet<Operation *, 8> callees;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      SmallVector<std::pair<CallOp, FuncOp>, 8> calls;
+      module.walk([&](CallOp callOp) {
+        FuncOp callee = symbolTable.lookup<FuncOp>(callOp.getCallee());
+        if (callee && callee != callOp->getParentOfType<FuncOp>() &&
+            isInlinable(callee, maxOps))
+          calls.emplace_back(callOp, callee);
+      });
+      for (auto &call : calls) {
+        inlineCall(call.first, call.second);
+        callees.insert(call.second);
+        changed = true;
+      }
+    }
+
+    // Erase the inlined functions without calls nor entry points left.
+    for (Operation *callee : callees)
+      if (SymbolTable::symbolKnownUseEmpty(callee, module))
+        callee->erase();
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create an InlineFunctionsONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createInlineFunctionsONNXPass(
+    int64_t maxOps) {
+  return std::make_unique<InlineFunctionsONNXPass>(maxOps);
+}
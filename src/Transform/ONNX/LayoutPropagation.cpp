@@ -0,0 +1,331 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===--------- LayoutPropagation.cpp - ONNX Transpose Elimination ---------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that propagates the Transpose operations of a
+// function towards its results, through the elementwise and pooling ops, so
+// that inverse pairs of Transposes meet and cancel. The Transposes feeding a
+// Gemm or a 2-D MatMul are folded into the transA/transB attributes of a Gemm.
+//
+// Models exported from NHWC frameworks carry a Transpose before and after
+// every Conv; once pushed through the ops in between, the pairs cancel.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return in `perm` the permutation of a Transpose with a ranked input, the
+// reversed dimensions when its attribute is absent.
+bool getPermutation(
+    ONNXTransposeOp transposeOp, SmallVectorImpl<int64_t> &perm) {
+  auto inputType = transposeOp.data().getType().dyn_cast<RankedTensorType>();
+  if (!inputType)
+    return false;
+  int64_t rank = inputType.getRank();
+  perm.clear();
+  if (ArrayAttr permAttr = transposeOp.permAttr()) {
+    for (Attribute dim : permAttr.getValue())
+      perm.emplace_back(dim.cast<IntegerAttr>().getInt());
+  } else {
+    for (int64_t i = rank - 1; i >= 0; --i)
+      perm.emplace_back(i);
+  }
+  return (int64_t)perm.size() == rank;
+}
+
+// Return the Transpose producing `value` if it is only used once, so that it
+// disappears when pushed through its user.
+ONNXTransposeOp getSingleUseTranspose(Value value) {
+  auto transposeOp = value.getDefiningOp<ONNXTransposeOp>();
+  if (!transposeOp || !transposeOp->hasOneUse())
+    return ONNXTransposeOp();
+  return transposeOp;
+}
+
+// Return the type of `result` before it is transposed by `perm`: dimension i
+// of the transposed result is dimension perm[i] of the untransposed one.
+Type getUntransposedType(Value result, ArrayRef<int64_t> perm) {
+  auto type = result.getType().cast<TensorType>();
+  if (!type.hasRank())
+    return type;
+  SmallVector<int64_t, 4> shape(perm.size());
+  for (unsigned i = 0; i < perm.size(); ++i)
+    shape[perm[i]] = type.getShape()[i];
+  return RankedTensorType::get(shape, type.getElementType());
+}
+
+// Replace `op` by a Transpose by `perm` of `newResult`.
+void replaceByTranspose(PatternRewriter &rewriter, Operation *op,
+    Value newResult, ArrayRef<int64_t> perm) {
+  rewriter.replaceOpWithNewOp<ONNXTransposeOp>(op, op->getResult(0).getType(),
+      newResult, rewriter.getI64ArrayAttr(perm));
+}
+
+/// Op(Transpose(x, perm)) -> Transpose(Op(x), perm) for a unary elementwise op.
+template <typename OP_TYPE>
+struct PushTransposeThroughUnaryOp : public OpRewritePattern<OP_TYPE> {
+  using OpRewritePattern<OP_TYPE>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      OP_TYPE op, PatternRewriter &rewriter) const override {
+    ONNXTransposeOp transposeOp = getSingleUseTranspose(op->getOperand(0));
+    SmallVector<int64_t, 4> perm;
+    if (!transposeOp || !getPermutation(transposeOp, perm))
+      return failure();
+
+    Value newResult = rewriter.create<OP_TYPE>(op.getLoc(),
+        getUntransposedType(op->getResult(0), perm), transposeOp.data(),
+        op->getAttrs());
+    replaceByTranspose(rewriter, op, newResult, perm);
+    return success();
+  }
+};
+
+/// Op(Transpose(x, perm), Transpose(y, perm)) -> Transpose(Op(x, y), perm) for
+/// a binary elementwise op. One of the operands may instead be a constant,
+/// transposed by the inverse permutation unless all its dimensions are 1.
+template <typename OP_TYPE>
+struct PushTransposeThroughBinaryOp : public OpRewritePattern<OP_TYPE> {
+  using OpRewritePattern<OP_TYPE>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      OP_TYPE op, PatternRewriter &rewriter) const override {
+    Operation *operation = op.getOperation();
+    SmallVector<int64_t, 4> perm;
+    for (Value operand : operation->getOperands()) {
+      ONNXTransposeOp transposeOp = getSingleUseTranspose(operand);
+      SmallVector<int64_t, 4> operandPerm;
+      if (!transposeOp || !getPermutation(transposeOp, operandPerm) ||
+          getONNXConstantOp(transposeOp.data()))
+        continue;
+      perm = operandPerm;
+      break;
+    }
+    if (perm.empty())
+      return failure();
+    int64_t rank = perm.size();
+
+    // The untransposed operands, or null for the constants to be transposed.
+    SmallVector<Value, 2> newOperands;
+    for (Value operand : operation->getOperands()) {
+      ONNXTransposeOp transposeOp = getSingleUseTranspose(operand);
+      SmallVector<int64_t, 4> operandPerm;
+      if (transposeOp && getPermutation(transposeOp, operandPerm) &&
+          operandPerm == perm) {
+        newOperands.emplace_back(transposeOp.data());
+        continue;
+      }
+      auto constType = operand.getType().dyn_cast<RankedTensorType>();
+      if (!getONNXConstantOp(operand) || !constType ||
+          constType.getRank() > rank)
+        return failure();
+      if (llvm::all_of(constType.getShape(), [](int64_t d) { return d == 1; }))
+        newOperands.emplace_back(operand);
+      else if (constType.getRank() == rank)
+        newOperands.emplace_back(Value());
+      else
+        return failure();
+    }
+
+    SmallVector<int64_t, 4> inversePerm(rank);
+    for (int64_t i = 0; i < rank; ++i)
+      inversePerm[perm[i]] = i;
+    for (unsigned i = 0; i < newOperands.size(); ++i) {
+      if (newOperands[i])
+        continue;
+      Value constant = operation->getOperand(i);
+      newOperands[i] = rewriter.create<ONNXTransposeOp>(op.getLoc(),
+          getUntransposedType(constant, perm), constant,
+          rewriter.getI64ArrayAttr(inversePerm));
+    }
+
+    Value newResult = rewriter.create<OP_TYPE>(op.getLoc(),
+        getUntransposedType(op->getResult(0), perm), newOperands,
+        op->getAttrs());
+    replaceByTranspose(rewriter, op, newResult, perm);
+    return success();
+  }
+};
+
+/// Pool(Transpose(x, perm)) -> Transpose(Pool'(x), perm) when the permutation
+/// keeps the batch and channel dimensions in place. The spatial attributes of
+/// Pool' are permuted along with the spatial dimensions.
+template <typename OP_TYPE>
+struct PushTransposeThroughPoolOp : public OpRewritePattern<OP_TYPE> {
+  using OpRewritePattern<OP_TYPE>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      OP_TYPE op, PatternRewriter &rewriter) const override {
+    ONNXTransposeOp transposeOp = getSingleUseTranspose(op->getOperand(0));
+    SmallVector<int64_t, 4> perm;
+    if (!transposeOp || !getPermutation(transposeOp, perm) ||
+        perm.size() < 3 || perm[0] != 0 || perm[1] != 1)
+      return failure();
+    int64_t nSpatial = perm.size() - 2;
+
+    // Spatial dimension i of the pooling is dimension perm[2 + i] - 2 of x.
+    auto permuteSpatial = [&](ArrayAttr attr) -> ArrayAttr {
+      SmallVector<int64_t, 4> values, permuted;
+      for (Attribute value : attr.getValue())
+        values.emplace_back(value.cast<IntegerAttr>().getInt());
+      permuted = values;
+      for (int64_t i = 0; i < (int64_t)values.size(); ++i) {
+        int64_t offset = (i / nSpatial) * nSpatial;
+        permuted[offset + perm[2 + i % nSpatial] - 2] = values[i];
+      }
+      return rewriter.getI64ArrayAttr(permuted);
+    };
+    NamedAttrList attrs(op->getAttrDictionary());
+    for (StringRef name : {"kernel_shape", "strides", "dilations", "pads"}) {
+      ArrayAttr attr = op->template getAttrOfType<ArrayAttr>(name);
+      if (!attr || attr.size() == 0)
+        continue;
+      if ((int64_t)attr.size() % nSpatial != 0)
+        return failure();
+      attrs.set(name, permuteSpatial(attr));
+    }
+
+    Value newResult = rewriter.create<OP_TYPE>(op.getLoc(),
+        getUntransposedType(op->getResult(0), perm), transposeOp.data(),
+        attrs.getAttrs());
+    replaceByTranspose(rewriter, op, newResult, perm);
+    return success();
+  }
+};
+
+// Return the input of a Transpose swapping the two dimensions of a matrix,
+// a null value otherwise.
+Value getTransposedMatrix(Value value) {
+  auto transposeOp = value.getDefiningOp<ONNXTransposeOp>();
+  SmallVector<int64_t, 4> perm;
+  if (!transposeOp || !getPermutation(transposeOp, perm) || perm.size() != 2 ||
+      perm[0] != 1)
+    return Value();
+  return transposeOp.data();
+}
+
+IntegerAttr getSI64Attr(PatternRewriter &rewriter, int64_t value) {
+  return IntegerAttr::get(
+      rewriter.getIntegerType(64, /*isSigned=*/true), APInt(64, value, true));
+}
+
+/// Gemm(Transpose(A), Transpose(B)) -> Gemm(A, B) with transA/transB flipped.
+struct FoldTransposeIntoGemm : public OpRewritePattern<ONNXGemmOp> {
+  using OpRewritePattern<ONNXGemmOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      ONNXGemmOp gemmOp, PatternRewriter &rewriter) const override {
+    Value newA = getTransposedMatrix(gemmOp.A());
+    Value newB = getTransposedMatrix(gemmOp.B());
+    if (!newA && !newB)
+      return failure();
+
+    rewriter.updateRootInPlace(gemmOp, [&]() {
+      if (newA) {
+        gemmOp->setOperand(0, newA);
+        gemmOp.transAAttr(getSI64Attr(rewriter, !gemmOp.transA()));
+      }
+      if (newB) {
+        gemmOp->setOperand(1, newB);
+        gemmOp.transBAttr(getSI64Attr(rewriter, !gemmOp.transB()));
+      }
+    });
+    return success();
+  }
+};
+
+/// MatMul(Transpose(A), Transpose(B)) -> Gemm(A, B) with transA/transB set,
+/// without bias, for matrices. MatMul itself has no transposition attributes.
+struct FoldTransposeIntoMatMul : public OpRewritePattern<ONNXMatMulOp> {
+  using OpRewritePattern<ONNXMatMulOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      ONNXMatMulOp matMulOp, PatternRewriter &rewriter) const override {
+    auto aType = matMulOp.A().getType().dyn_cast<RankedTensorType>();
+    auto bType = matMulOp.B().getType().dyn_cast<RankedTensorType>();
+    if (!aType || !bType || aType.getRank() != 2 || bType.getRank() != 2)
+      return failure();
+    Value newA = getTransposedMatrix(matMulOp.A());
+    Value newB = getTransposedMatrix(matMulOp.B());
+    if (!newA && !newB)
+      return failure();
+
+    Value none =
+        rewriter.create<ConstantOp>(matMulOp.getLoc(), rewriter.getUnitAttr());
+    rewriter.replaceOpWithNewOp<ONNXGemmOp>(matMulOp, matMulOp.getType(),
+        newA ? newA : matMulOp.A(), newB ? newB : matMulOp.B(), none,
+        rewriter.getF32FloatAttr(1.0), rewriter.getF32FloatAttr(1.0),
+        getSI64Attr(rewriter, newA ? 1 : 0),
+        getSI64Attr(rewriter, newB ? 1 : 0));
+    return success();
+  }
+};
+
+struct LayoutPropagationONNXToONNXPass
+    : public PassWrapper<LayoutPropagationONNXToONNXPass, FunctionPass> {
+  void runOnFunction() final;
+};
+} // end anonymous namespace.
+
+void LayoutPropagationONNXToONNXPass::runOnFunction() {
+  auto function = getFunction();
+  MLIRContext *context = &getContext();
+
+  RewritePatternSet patterns(context);
+  patterns.insert<PushTransposeThroughUnaryOp<ONNXReluOp>,
+      PushTransposeThroughUnaryOp<ONNXLeakyReluOp>,
+      PushTransposeThroughUnaryOp<ONNXEluOp>,
+      PushTransposeThroughUnaryOp<ONNXSeluOp>,
+      PushTransposeThroughUnaryOp<ONNXSigmoidOp>,
+      PushTransposeThroughUnaryOp<ONNXHardSigmoidOp>,
+      PushTransposeThroughUnaryOp<ONNXTanhOp>,
+      PushTransposeThroughUnaryOp<ONNXExpOp>,
+      PushTransposeThroughUnaryOp<ONNXLogOp>,
+      PushTransposeThroughUnaryOp<ONNXNegOp>,
+      PushTransposeThroughUnaryOp<ONNXAbsOp>,
+      PushTransposeThroughUnaryOp<ONNXSqrtOp>,
+      PushTransposeThroughUnaryOp<ONNXReciprocalOp>,
+      PushTransposeThroughUnaryOp<ONNXSoftplusOp>,
+      PushTransposeThroughUnaryOp<ONNXSoftsignOp>,
+      PushTransposeThroughUnaryOp<ONNXErfOp>,
+      PushTransposeThroughUnaryOp<ONNXCastOp>>(context);
+  patterns.insert<PushTransposeThroughBinaryOp<ONNXAddOp>,
+      PushTransposeThroughBinaryOp<ONNXSubOp>,
+      PushTransposeThroughBinaryOp<ONNXMulOp>,
+      PushTransposeThroughBinaryOp<ONNXDivOp>,
+      PushTransposeThroughBinaryOp<ONNXPReluOp>>(context);
+  patterns.insert<PushTransposeThroughPoolOp<ONNXMaxPoolSingleOutOp>,
+      PushTransposeThroughPoolOp<ONNXAveragePoolOp>,
+      PushTransposeThroughPoolOp<ONNXGlobalMaxPoolOp>,
+      PushTransposeThroughPoolOp<ONNXGlobalAveragePoolOp>>(context);
+  patterns.insert<FoldTransposeIntoGemm, FoldTransposeIntoMatMul>(context);
+  // Cancel the pairs of Transposes that meet.
+  ONNXTransposeOp::getCanonicalizationPatterns(patterns, context);
+
+  if (failed(applyPatternsAndFoldGreedily(function, std::move(patterns))))
+    signalPassFailure();
+}
+
+/*!
+ * Create a LayoutPropagationONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createLayoutPropagationONNXToONNXPass() {
+  return std::make_unique<LayoutPropagationONNXToONNXPass>();
+}
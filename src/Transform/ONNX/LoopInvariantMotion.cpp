@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------ LoopInvariantMotion.cpp - Hoist the ONNX Loop Invariants ------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that moves the operations of the bodies of the
+// ONNX Loops and Scans that only depend on the values of the enclosing scope
+// before the Loop or Scan, so that they are computed once instead of at each
+// iteration. Exported bodies often transpose a weight, compute a shape or
+// build a mask from the outer tensors. The operations moved are the
+// deterministic ones without side effect, since a body may run zero times.
+// The bodies of the inner loops are visited first, for their invariants to
+// be moved out of the outer loops as well.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Move the operations of the body of the loop whose operands are all defined
+// outside of it before the loop.
+void hoistLoopInvariants(Operation *loopOp) {
+  Region &body = loopOp->getRegion(0);
+  if (body.empty())
+    return;
+  // The operations of the nested regions are executed conditionally, only
+  // the ones of the entry block are moved.
+  for (Operation &op : llvm::make_early_inc_range(body.front())) {
+    if (!isDeterministicONNXOp(&op))
+      continue;
+    bool isInvariant = llvm::all_of(op.getOperands(),
+        [&](Value value) { return !body.isAncestor(value.getParentRegion()); });
+    if (isInvariant)
+      op.moveBefore(loopOp);
+  }
+}
+
+/*!
+ *  Function pass that hoists the loop invariants of the ONNX Loops and Scans.
+ */
+struct LoopInvariantMotionONNXPass
+    : public PassWrapper<LoopInvariantMotionONNXPass, FunctionPass> {
+  void runOnFunction() final {
+    getFunction().walk([](Operation *op) {
+      if (isa<ONNXLoopOp, ONNXScanOp>(op))
+        hoistLoopInvariants(op);
+    });
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create a LoopInvariantMotionONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createLoopInvariantMotionONNXPass() {
+  return std::make_unique<LoopInvariantMotionONNXPass>();
+}
@@ -0,0 +1,330 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- OutlineRepeatedLayers.cpp - Outline the repeated layers ------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that outlines the repeated layers of a model,
+// e.g. the encoder layers of a BERT, into a function called once for each of
+// them. Each layer is otherwise lowered into its own copy of the same loop
+// nests, so that the compile time and the size of the code grow with the
+// depth of the model.
+//
+// The layers are found among the ops of the function body, the constants
+// left aside: a layer is a run of ops repeated consecutively, each copy
+// computing the same ops with the same attributes and types on its own
+// operands. The values used by a layer and defined out of it are the
+// arguments of the outlined function, except for the constants that have the
+// same value in all the copies, which are cloned into the function. The
+// weights of each layer hence reach the function as its arguments, and the
+// values of a layer used after it as its results.
+//
+// The cost model weighs the code of the copies removed against the code of
+// the calls. Each op of a layer is lowered into at least a loop nest, whose
+// code matches that of a call passing kValuesPerOp values. A run of copies is
+// outlined when its layers have at least min-ops ops and the code saved is
+// larger than the code of the calls.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Number of values passed to a call whose code matches the code of the loop
+/// nest of an op.
+const int64_t kValuesPerOp = 8;
+
+/// Return true if the op is a constant, which is not part of the layers.
+bool isConstantOp(Operation *op) {
+  return op && llvm::isa<ONNXConstantOp, ConstantOp>(op);
+}
+
+/// The values used by a copy of a layer and defined out of it, in the order
+/// of their first uses, and the values of the copy used after it, as the op
+/// index and result number.
+struct LayerInterface {
+  SmallVector<Value, 8> inputs;
+  SmallVector<std::pair<unsigned, unsigned>, 2> outputs;
+};
+
+/// Get the interface of the copy of a layer made of the given ops.
+LayerInterface getLayerInterface(ArrayRef<Operation *> ops) {
+  LayerInterface interface;
+  llvm::SmallPtrSet<Operation *, 16> opSet(ops.begin(), ops.end());
+  llvm::SmallPtrSet<Value, 8> inputSet;
+  for (auto en : llvm::enumerate(ops)) {
+    Operation *op = en.value();
+    for (Value operand : op->getOperands())
+      if (!opSet.count(operand.getDefiningOp()) &&
+          inputSet.insert(operand).second)
+        interface.inputs.emplace_back(operand);
+    for (OpResult result : op->getResults())
+      if (llvm::any_of(result.getUsers(),
+              [&](Operation *user) { return !opSet.count(user); }))
+        interface.outputs.emplace_back(en.index(), result.getResultNumber());
+  }
+  return interface;
+}
+
+/// Return true if the ops of the two copies compute the same ops with the
+/// same attributes and types, on operands defined at the same places of the
+/// copies or by the same inputs of the copies. The names of the nodes, unique
+/// to each op, are ignored.
+bool isSameLayer(ArrayRef<Operation *> first, ArrayRef<Operation *> second) {
+  DenseMap<Operation *, unsigned> firstIndices, secondIndices;
+  DenseMap<Value, unsigned> firstInputs, secondInputs;
+  for (unsigned i = 0; i < first.size(); ++i) {
+    Operation *a = first[i], *b = second[i];
+    if (a->getName() != b->getName() ||
+        getSemanticAttrs(a) != getSemanticAttrs(b) ||
+        a->getResultTypes() != b->getResultTypes() ||
+        a->getNumOperands() != b->getNumOperands() || a->getNumRegions() ||
+        b->getNumRegions() || llvm::isa<ONNXIdentityOp>(a))
+      return false;
+    firstIndices[a] = secondIndices[b] = i;
+    for (unsigned j = 0; j < a->getNumOperands(); ++j) {
+      Value x = a->getOperand(j), y = b->getOperand(j);
+      if (x.getType() != y.getType())
+        return false;
+      auto xIndex = firstIndices.find(x.getDefiningOp());
+      auto yIndex = secondIndices.find(y.getDefiningOp());
+      if (xIndex != firstIndices.end() || yIndex != secondIndices.end()) {
+        if (xIndex == firstIndices.end() || yIndex == secondIndices.end() ||
+            xIndex->second != yIndex->second ||
+            x.cast<OpResult>().getResultNumber() !=
+                y.cast<OpResult>().getResultNumber())
+          return false;
+        continue;
+      }
+      // The inputs are numbered in the order of their first uses.
+      auto xInput = firstInputs.try_emplace(x, firstInputs.size()).first;
+      auto yInput = secondInputs.try_emplace(y, secondInputs.size()).first;
+      if (xInput->second != yInput->second)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Return true if the input has the same constant value in all the copies.
+bool isSharedConstant(ArrayRef<LayerInterface> interfaces, unsigned input) {
+  Operation *constantOp = interfaces[0].inputs[input].getDefiningOp();
+  if (!isConstantOp(constantOp))
+    return false;
+  return llvm::all_of(interfaces, [&](const LayerInterface &interface) {
+    Operation *op = interface.inputs[input].getDefiningOp();
+    return isConstantOp(op) && op->getName() == constantOp->getName() &&
+           getSemanticAttrs(op) == getSemanticAttrs(constantOp);
+  });
+}
+
+/*!
+ *  Module pass that outlines the repeated layers into functions.
+ */
+class OutlineRepeatedLayersONNXPass
+    : public PassWrapper<OutlineRepeatedLayersONNXPass,
+          OperationPass<ModuleOp>> {
+public:
+  OutlineRepeatedLayersONNXPass() = default;
+  OutlineRepeatedLayersONNXPass(const OutlineRepeatedLayersONNXPass &pass) {}
+  OutlineRepeatedLayersONNXPass(int64_t minOps) { this->minOps = minOps; }
+
+  Option<int64_t> minOps{*this, "min-ops",
+      llvm::cl::desc("Minimum number of ops of an outlined layer."),
+      llvm::cl::init(8)};
+
+  void runOnOperation() final {
+    ModuleOp module = getOperation();
+    SymbolTable symbolTable(module);
+    SmallVector<FuncOp, 1> functions(module.getOps<FuncOp>());
+    for (FuncOp function : functions) {
+      if (function.isExternal())
+        continue;
+      SmallVector<Operation *, 64> ops;
+      for (Operation &op : function.getBody().front().without_terminator())
+        if (!isConstantOp(&op) && !llvm::isa<ONNXEntryPointOp>(op))
+          ops.emplace_back(&op);
+      outlineRepeatedLayers(function, ops, symbolTable);
+    }
+  }
+
+  /// Return the number of copies of the layer of the given size starting at
+  /// the given op.
+  int64_t getNumCopies(ArrayRef<Operation *> ops, size_t start, size_t size) {
+    ArrayRef<Operation *> layer = ops.slice(start, size);
+    int64_t numCopies = 1;
+    for (size_t next = start + size; next + size <= ops.size();
+         next += size, ++numCopies)
+      if (!isSameLayer(layer, ops.slice(next, size)))
+        break;
+    return numCopies;
+  }
+
+  /// Return the size of the code saved by outlining the copies, or 0 if the
+  /// outlining does not pay off.
+  int64_t getSavedCode(ArrayRef<LayerInterface> interfaces, size_t size) {
+    int64_t numCopies = interfaces.size();
+    if (numCopies < 2 || (int64_t)size < minOps)
+      return 0;
+    int64_t numValues =
+        interfaces[0].inputs.size() + interfaces[0].outputs.size();
+    int64_t savedCode = (numCopies - 1) * size * kValuesPerOp;
+    int64_t callCode = numCopies * (1 + numValues);
+    return savedCode > callCode ? savedCode - callCode : 0;
+  }
+
+  void outlineRepeatedLayers(
+      FuncOp function, ArrayRef<Operation *> ops, SymbolTable &symbolTable) {
+    size_t start = 0;
+    while (start < ops.size()) {
+      // The longest run of copies is searched first, the shorter ones only
+      // outlined if they save more code.
+      size_t bestSize = 0;
+      int64_t bestSavedCode = 0, bestNumCopies = 0;
+      int64_t minSize = std::max<int64_t>(minOps, 1);
+      for (int64_t size = (ops.size() - start) / 2; size >= minSize; --size) {
+        if (ops[start + size]->getName() != ops[start]->getName())
+          continue;
+        int64_t numCopies = getNumCopies(ops, start, size);
+        if (numCopies < 2)
+          continue;
+        SmallVector<LayerInterface, 8> interfaces;
+        for (int64_t i = 0; i < numCopies; ++i)
+          interfaces.emplace_back(
+              getLayerInterface(ops.slice(start + i * size, size)));
+        if (!isSameInterface(ops.slice(start, size), interfaces))
+          continue;
+        int64_t savedCode = getSavedCode(interfaces, size);
+        if (savedCode > bestSavedCode) {
+          bestSize = size;
+          bestSavedCode = savedCode;
+          bestNumCopies = numCopies;
+        }
+      }
+      if (bestSize == 0) {
+        ++start;
+        continue;
+      }
+      outlineCopies(function, ops.slice(start, bestSize * bestNumCopies),
+          bestSize, symbolTable);
+      start += bestSize * bestNumCopies;
+    }
+  }
+
+  /// Return true if the copies have the same outputs, all tensors.
+  bool isSameInterface(
+      ArrayRef<Operation *> layer, ArrayRef<LayerInterface> interfaces) {
+    for (auto output : interfaces[0].outputs)
+      if (!layer[output.first]
+               ->getResult(output.second)
+               .getType()
+               .isa<TensorType>())
+        return false;
+    return llvm::all_of(interfaces, [&](const LayerInterface &interface) {
+      return interface.outputs == interfaces[0].outputs;
+    });
+  }
+
+  /// Outline the copies of a layer of the given size into a function, and
+  /// replace each copy with a call.
+  void outlineCopies(FuncOp function, ArrayRef<Operation *> ops, size_t size,
+      SymbolTable &symbolTable) {
+    ArrayRef<Operation *> layer = ops.take_front(size);
+    SmallVector<LayerInterface, 8> interfaces;
+    for (size_t start = 0; start < ops.size(); start += size)
+      interfaces.emplace_back(getLayerInterface(ops.slice(start, size)));
+    const LayerInterface &interface = interfaces[0];
+
+    // The arguments are the inputs but the shared constants, cloned into the
+    // function.
+    SmallVector<bool, 8> isArgument;
+    SmallVector<Type, 8> argTypes, resultTypes;
+    for (unsigned i = 0; i < interface.inputs.size(); ++i) {
+      isArgument.emplace_back(!isSharedConstant(interfaces, i));
+      if (isArgument.back())
+        argTypes.emplace_back(interface.inputs[i].getType());
+    }
+    for (auto output : interface.outputs)
+      resultTypes.emplace_back(
+          layer[output.first]->getResult(output.second).getType());
+
+    MLIRContext *context = function.getContext();
+    OpBuilder builder(context);
+    FuncOp layerFunction = FuncOp::create(layer[0]->getLoc(),
+        (function.getName() + "_layer").str(),
+        builder.getFunctionType(argTypes, resultTypes));
+    layerFunction.setPrivate();
+    // The layer is lowered once, the inliner not copying it back into the
+    // callers.
+    layerFunction->setAttr(
+        "passthrough", builder.getArrayAttr({builder.getStringAttr("noinline")}));
+    symbolTable.insert(layerFunction, Block::iterator(function));
+
+    Block *body = layerFunction.addEntryBlock();
+    builder.setInsertionPointToStart(body);
+    BlockAndValueMapping mapping;
+    unsigned numArgs = 0;
+    for (unsigned i = 0; i < interface.inputs.size(); ++i) {
+      Value input = interface.inputs[i];
+      if (isArgument[i])
+        mapping.map(input, body->getArgument(numArgs++));
+      else
+        mapping.map(input, builder.clone(*input.getDefiningOp())->getResult(0));
+    }
+    for (Operation *op : layer)
+      builder.clone(*op, mapping);
+    SmallVector<Value, 2> results;
+    for (auto output : interface.outputs)
+      results.emplace_back(mapping.lookup(
+          layer[output.first]->getResult(output.second)));
+    builder.create<ReturnOp>(layerFunction.getLoc(), results);
+
+    // The inputs of a copy are read once the copies before it are replaced,
+    // the outputs of a layer being the inputs of the next one.
+    for (size_t start = 0; start < ops.size(); start += size) {
+      ArrayRef<Operation *> copy = ops.slice(start, size);
+      LayerInterface copyInterface = getLayerInterface(copy);
+      SmallVector<Value, 8> args;
+      for (unsigned i = 0; i < copyInterface.inputs.size(); ++i)
+        if (isArgument[i])
+          args.emplace_back(copyInterface.inputs[i]);
+      builder.setInsertionPointAfter(copy.back());
+      CallOp callOp =
+          builder.create<CallOp>(copy[0]->getLoc(), layerFunction, args);
+      for (auto en : llvm::enumerate(copyInterface.outputs))
+        copy[en.value().first]
+            ->getResult(en.value().second)
+            .replaceAllUsesWith(callOp.getResult(en.index()));
+      for (Operation *op : llvm::reverse(copy))
+        op->erase();
+      // The weights are now the operands of the call, the shared constants
+      // left unused.
+      for (Value input : copyInterface.inputs)
+        if (isConstantOp(input.getDefiningOp()) && input.use_empty())
+          input.getDefiningOp()->erase();
+    }
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create an OutlineRepeatedLayersONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createOutlineRepeatedLayersONNXPass(
+    int64_t minOps) {
+  return std::make_unique<OutlineRepeatedLayersONNXPass>(minOps);
+}
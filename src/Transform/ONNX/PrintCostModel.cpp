@@ -0,0 +1,96 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-------- PrintCostModel.cpp - Print the cost of ONNX operations ------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass printing the number of floating point
+// operations and of bytes of each ONNX operation implementing the
+// CostModelOpInterface, and their totals per function. With the annotate
+// option, the costs are also attached to the operations, as the cost.flops
+// and cost.bytes attributes, for the passes and tools reading the IR.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Print the costs as a number, or unknown.
+void printCost(int64_t cost, llvm::raw_ostream &os) {
+  if (cost < 0)
+    os << "unknown";
+  else
+    os << cost;
+}
+
+/*!
+ *  Function pass that prints the cost of the ONNX operations.
+ */
+class PrintCostModelPass
+    : public PassWrapper<PrintCostModelPass, FunctionPass> {
+public:
+  PrintCostModelPass() = default;
+  PrintCostModelPass(const PrintCostModelPass &pass) {}
+  PrintCostModelPass(bool annotate) { this->annotate = annotate; }
+
+  Option<bool> annotate{*this, "annotate",
+      llvm::cl::desc("Attach the costs to the operations as attributes."),
+      llvm::cl::init(false)};
+
+  void runOnFunction() override {
+    auto function = getFunction();
+    Builder builder(&getContext());
+
+    // The whole report is written at once, the functions being processed in
+    // parallel. The totals leave out the operations of unknown costs.
+    std::string buffer;
+    llvm::raw_string_ostream os(buffer);
+    os << "cost model of @" << function.getName() << ":\n";
+    int64_t totalFlops = 0, totalBytes = 0, numUnknown = 0;
+    function.walk([&](CostModelOpInterface costOp) {
+      int64_t flops = costOp.getFlops();
+      int64_t bytes = costOp.getBytes();
+      os << "  " << costOp->getName() << " " << costOp->getLoc()
+         << ": flops ";
+      printCost(flops, os);
+      os << ", bytes ";
+      printCost(bytes, os);
+      os << "\n";
+      if (flops < 0 || bytes < 0)
+        numUnknown++;
+      totalFlops += std::max<int64_t>(flops, 0);
+      totalBytes += std::max<int64_t>(bytes, 0);
+      if (annotate) {
+        costOp->setAttr("cost.flops", builder.getI64IntegerAttr(flops));
+        costOp->setAttr("cost.bytes", builder.getI64IntegerAttr(bytes));
+      }
+    });
+    os << "  total: flops " << totalFlops << ", bytes " << totalBytes;
+    if (numUnknown > 0)
+      os << ", " << numUnknown << " operations of unknown cost";
+    os << "\n";
+    llvm::errs() << os.str();
+
+    if (!annotate)
+      markAllAnalysesPreserved();
+  }
+};
+} // end anonymous namespace
+
+/*!
+ * Create a cost model printing pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createPrintCostModelPass(bool annotate) {
+  return std::make_unique<PrintCostModelPass>(annotate);
+}
@@ -0,0 +1,207 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---- PropagateLowPrecision.cpp - Compute Cast Regions in fp16/bf16 ---===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that computes in reduced precision the regions
+// of elementwise ONNX operations sandwiched between Casts. Exported fp16
+// models cast their tensors to fp32 around many operations, and each Cast is
+// a full elementwise pass over memory:
+//
+//   %x32 = onnx.Cast(%x16) {to = f32}
+//   %y32 = onnx.Relu(onnx.Add(%x32, %b32))
+//   %y16 = onnx.Cast(%y32) {to = f16}
+//
+// When every input of the region is a Cast from the reduced precision type,
+// or a constant, and every use of its results is a Cast back to that type,
+// the operations of the region are computed in the reduced precision type and
+// the Casts are removed:
+//
+//   %y16 = onnx.Relu(onnx.Add(%x16, %b16))
+//
+// The results are not bit-exact, the intermediate values being rounded to
+// the reduced precision, which is why the pass is only run on request.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SetVector.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return the element type of a tensor, or null.
+Type getElementType(Value value) {
+  auto tensorType = value.getType().dyn_cast<TensorType>();
+  return tensorType ? tensorType.getElementType() : Type();
+}
+
+// Return the same kind of tensor type as `type`, with the element type
+// `elementType`.
+Type getTensorTypeOf(Type type, Type elementType) {
+  if (auto rankedType = type.dyn_cast<RankedTensorType>())
+    return RankedTensorType::get(rankedType.getShape(), elementType);
+  return UnrankedTensorType::get(elementType);
+}
+
+// Return true if the Cast converts a reduced precision tensor to fp32.
+bool isWideningCast(Operation *op) {
+  auto castOp = dyn_cast<ONNXCastOp>(op);
+  if (!castOp)
+    return false;
+  Type from = getElementType(castOp.input());
+  return from && (from.isF16() || from.isBF16()) && castOp.to().isF32();
+}
+
+// Return true if the elementwise op computes the same results, up to the
+// rounding of the intermediate values, in reduced precision.
+bool isPrecisionInsensitiveOp(Operation *op) {
+  return isa<ONNXAddOp, ONNXSubOp, ONNXMulOp, ONNXDivOp, ONNXMaxOp,
+      ONNXMinOp, ONNXNegOp, ONNXAbsOp, ONNXReluOp, ONNXSigmoidOp, ONNXTanhOp>(
+      op);
+}
+
+// The operations of a region computed in fp32 between Casts from and to the
+// reduced precision type.
+struct CastRegion {
+  Type lowType;
+  llvm::SetVector<Operation *> ops;
+  // The Casts from the reduced precision type read by the region.
+  llvm::SetVector<Operation *> entries;
+  // The Casts to the reduced precision type of its results.
+  llvm::SetVector<Operation *> exits;
+  // The constant operands of the region.
+  llvm::SetVector<Operation *> constants;
+
+  // Grow the region from the uses of the entry Cast. Return false when the
+  // region reads or produces values that are not cast.
+  bool grow(Operation *entry) {
+    lowType = getElementType(entry->getOperand(0));
+    SmallVector<Operation *, 8> worklist;
+    auto addUsers = [&](Operation *op) {
+      for (Operation *user : op->getResult(0).getUsers())
+        worklist.emplace_back(user);
+    };
+    entries.insert(entry);
+    addUsers(entry);
+    while (!worklist.empty()) {
+      Operation *op = worklist.pop_back_val();
+      if (ops.count(op) || exits.count(op))
+        continue;
+      if (auto castOp = dyn_cast<ONNXCastOp>(op)) {
+        if (castOp.to() != lowType)
+          return false;
+        exits.insert(op);
+        continue;
+      }
+      if (!isPrecisionInsensitiveOp(op) || op->getNumResults() != 1 ||
+          !getElementType(op->getResult(0)).isF32())
+        return false;
+      ops.insert(op);
+      addUsers(op);
+      for (Value operand : op->getOperands()) {
+        Operation *def = operand.getDefiningOp();
+        if (!def)
+          return false;
+        if (isWideningCast(def)) {
+          if (getElementType(def->getOperand(0)) != lowType)
+            return false;
+          entries.insert(def);
+        } else if (auto constOp = dyn_cast<ONNXConstantOp>(def)) {
+          if (!constOp.valueAttr() ||
+              !constOp.valueAttr().isa<DenseElementsAttr>() ||
+              !getElementType(operand).isF32())
+            return false;
+          constants.insert(def);
+        } else {
+          worklist.emplace_back(def);
+        }
+      }
+    }
+    return !exits.empty();
+  }
+
+  // Compute the operations of the region in the reduced precision type.
+  void lower() {
+    const fltSemantics &semantics =
+        lowType.cast<FloatType>().getFloatSemantics();
+    for (Operation *constant : constants) {
+      auto dense = cast<ONNXConstantOp>(constant)
+                       .valueAttr()
+                       .cast<DenseElementsAttr>();
+      Attribute lowDense = dense.mapValues(lowType, [&](const APFloat &value) {
+        APFloat lowValue = value;
+        bool losesInfo;
+        lowValue.convert(semantics, APFloat::rmNearestTiesToEven, &losesInfo);
+        return lowValue.bitcastToAPInt();
+      });
+      OpBuilder builder(constant);
+      Value lowConstant = builder.create<ONNXConstantOp>(
+          constant->getLoc(), Attribute(), lowDense);
+      constant->getResult(0).replaceUsesWithIf(lowConstant,
+          [&](OpOperand &use) { return ops.count(use.getOwner()); });
+    }
+    for (Operation *entry : entries)
+      entry->getResult(0).replaceUsesWithIf(
+          entry->getOperand(0), [&](OpOperand &use) {
+            return ops.count(use.getOwner()) || exits.count(use.getOwner());
+          });
+    for (Operation *op : ops)
+      op->getResult(0).setType(
+          getTensorTypeOf(op->getResult(0).getType(), lowType));
+    for (Operation *exit : exits) {
+      exit->getResult(0).replaceAllUsesWith(exit->getOperand(0));
+      exit->erase();
+    }
+    for (Operation *entry : entries)
+      if (entry->use_empty())
+        entry->erase();
+    for (Operation *constant : constants)
+      if (constant->use_empty())
+        constant->erase();
+  }
+};
+
+/*!
+ *  Function pass that computes the Cast-sandwiched regions in fp16/bf16.
+ */
+struct PropagateLowPrecisionONNXPass
+    : public PassWrapper<PropagateLowPrecisionONNXPass, FunctionPass> {
+  void runOnFunction() final {
+    SmallVector<Operation *, 8> casts;
+    getFunction().walk([&](Operation *op) {
+      if (isWideningCast(op))
+        casts.emplace_back(op);
+    });
+    // The Casts of a lowered region may be erased, skip them.
+    llvm::DenseSet<Operation *> visited;
+    for (Operation *cast : casts) {
+      if (visited.count(cast))
+        continue;
+      CastRegion region;
+      bool isLowerable = region.grow(cast);
+      visited.insert(region.entries.begin(), region.entries.end());
+      if (isLowerable)
+        region.lower();
+    }
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create a PropagateLowPrecisionONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createPropagateLowPrecisionONNXPass() {
+  return std::make_unique<PropagateLowPrecisionONNXPass>();
+}
@@ -0,0 +1,217 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- ScheduleForMemory.cpp - ONNX Peak Memory Scheduling ---------===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that reorders the independent ONNX operations
+// of a function to lower the peak of the bytes of the tensors live at once.
+// The order of the operations is the order of the lifetimes of their buffers
+// in the memory pools; the importer keeps the order of the nodes of the
+// model, which, for the branchy graphs, computes the large results of all the
+// branches before reducing any of them.
+//
+// The operations are list scheduled: among those whose operands are
+// computed, the next one is the one growing the live bytes the least, the
+// bytes of its results minus the bytes of the operands it is the last user
+// of. The new order is only kept when its peak is lower.
+//
+//===----------------------------------------------------------------------===//
+
+#include <limits>
+#include <set>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return the bytes of the tensor, 0 for the tensors of unknown shapes and
+// for the constants, which are not allocated in the memory pools.
+int64_t getTensorBytes(Value value) {
+  if (value.getDefiningOp<ONNXConstantOp>())
+    return 0;
+  auto tensorType = value.getType().dyn_cast<RankedTensorType>();
+  if (!tensorType || !tensorType.hasStaticShape() ||
+      !tensorType.getElementType().isIntOrFloat())
+    return 0;
+  return tensorType.getNumElements() *
+         ((tensorType.getElementTypeBitWidth() + 7) / 8);
+}
+
+// The operations of a block, but its terminator, with their dependences.
+struct ScheduleGraph {
+  SmallVector<Operation *, 32> ops;
+  // Operations using the results of each operation, in the block.
+  SmallVector<llvm::SetVector<unsigned>, 32> successors;
+  // Number of operations each operation depends on.
+  SmallVector<unsigned, 32> numPredecessors;
+  // Bytes of the results of each operation.
+  SmallVector<int64_t, 32> resultBytes;
+  // Values defined by the operations of the block with the number of their
+  // uses in the block, the terminator included.
+  llvm::DenseMap<Value, unsigned> numUses;
+
+  explicit ScheduleGraph(Block &block) {
+    llvm::DenseMap<Operation *, unsigned> indices;
+    for (Operation &op : block.without_terminator()) {
+      indices[&op] = ops.size();
+      ops.emplace_back(&op);
+    }
+    successors.resize(ops.size());
+    numPredecessors.assign(ops.size(), 0);
+    auto addEdge = [&](unsigned from, unsigned to) {
+      if (from != to && successors[from].insert(to))
+        ++numPredecessors[to];
+    };
+    // The operations with side effects keep their order.
+    Optional<unsigned> lastEffectOp;
+    for (unsigned i = 0; i < ops.size(); ++i) {
+      Operation *op = ops[i];
+      int64_t bytes = 0;
+      for (Value result : op->getResults()) {
+        bytes += getTensorBytes(result);
+        unsigned uses = 0;
+        for (Operation *user : result.getUsers()) {
+          Operation *ancestor = block.findAncestorOpInBlock(*user);
+          if (!ancestor)
+            continue;
+          ++uses;
+          auto it = indices.find(ancestor);
+          if (it != indices.end())
+            addEdge(i, it->second);
+        }
+        numUses[result] = uses;
+      }
+      resultBytes.emplace_back(bytes);
+      if (!MemoryEffectOpInterface::hasNoEffect(op) ||
+          op->getNumRegions() != 0) {
+        if (lastEffectOp)
+          addEdge(*lastEffectOp, i);
+        lastEffectOp = i;
+      }
+    }
+  }
+
+  // Return the bytes of the operands freed when the operation is scheduled,
+  // those whose `remaining` uses are all in the operation.
+  int64_t getFreedBytes(
+      Operation *op, const llvm::DenseMap<Value, unsigned> &remaining) {
+    int64_t bytes = 0;
+    llvm::SmallPtrSet<Value, 4> seen;
+    op->walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands()) {
+        auto it = remaining.find(operand);
+        if (it == remaining.end() || !seen.insert(operand).second)
+          continue;
+        unsigned uses = llvm::count_if(operand.getUsers(),
+            [&](Operation *user) { return op->isAncestor(user); });
+        if (it->second == uses)
+          bytes += getTensorBytes(operand);
+      }
+    });
+    return bytes;
+  }
+
+  // Schedule the operation, updating the number of the remaining uses of its
+  // operands.
+  void execute(Operation *op, llvm::DenseMap<Value, unsigned> &remaining) {
+    op->walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands()) {
+        auto it = remaining.find(operand);
+        if (it != remaining.end())
+          --it->second;
+      }
+    });
+  }
+
+  // Return the peak of the live bytes of the operations in the given order.
+  int64_t getPeakBytes(ArrayRef<unsigned> order) {
+    llvm::DenseMap<Value, unsigned> remaining = numUses;
+    int64_t live = 0, peak = 0;
+    for (unsigned i : order) {
+      live += resultBytes[i];
+      peak = std::max(peak, live);
+      live -= getFreedBytes(ops[i], remaining);
+      execute(ops[i], remaining);
+    }
+    return peak;
+  }
+
+  // Return the order growing the live bytes the least at each step, the
+  // first operation in the block breaking the ties.
+  SmallVector<unsigned, 32> schedule() {
+    llvm::DenseMap<Value, unsigned> remaining = numUses;
+    SmallVector<unsigned, 32> predecessors = numPredecessors;
+    std::set<unsigned> ready;
+    for (unsigned i = 0; i < ops.size(); ++i)
+      if (predecessors[i] == 0)
+        ready.insert(i);
+    SmallVector<unsigned, 32> order;
+    while (!ready.empty()) {
+      unsigned best = *ready.begin();
+      int64_t bestGrowth = std::numeric_limits<int64_t>::max();
+      for (unsigned i : ready) {
+        int64_t growth = resultBytes[i] - getFreedBytes(ops[i], remaining);
+        if (growth < bestGrowth) {
+          best = i;
+          bestGrowth = growth;
+        }
+      }
+      ready.erase(best);
+      order.emplace_back(best);
+      execute(ops[best], remaining);
+      for (unsigned successor : successors[best])
+        if (--predecessors[successor] == 0)
+          ready.insert(successor);
+    }
+    return order;
+  }
+};
+
+/*!
+ *  Function pass that orders the ONNX operations for a lower peak memory.
+ */
+struct ScheduleForMemoryONNXPass
+    : public PassWrapper<ScheduleForMemoryONNXPass, FunctionPass> {
+  void runOnFunction() final {
+    for (Block &block : getFunction().getBody()) {
+      if (block.empty() || !block.back().hasTrait<OpTrait::IsTerminator>())
+        continue;
+      ScheduleGraph graph(block);
+      SmallVector<unsigned, 32> order = graph.schedule();
+      // Every operation is scheduled, the dependences being acyclic.
+      if (order.size() != graph.ops.size())
+        continue;
+      SmallVector<unsigned, 32> blockOrder;
+      for (unsigned i = 0; i < graph.ops.size(); ++i)
+        blockOrder.emplace_back(i);
+      if (graph.getPeakBytes(order) >= graph.getPeakBytes(blockOrder))
+        continue;
+      Operation *terminator = block.getTerminator();
+      for (unsigned i : order)
+        graph.ops[i]->moveBefore(terminator);
+    }
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create a ScheduleForMemoryONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createScheduleForMemoryONNXPass() {
+  return std::make_unique<ScheduleForMemoryONNXPass>();
+}
@@ -12,12 +12,15 @@
 // shapes through function specialization.
 //
 //===----------------------------------------------------------------------===//
+#include <atomic>
 #include <regex>
 
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/Pass/Pass.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "src/Dialect/ONNX/ONNXOps.hpp"
@@ -60,49 +63,65 @@ class ShapeInferencePass : public mlir::PassWrapper<ShapeInferencePass,
 public:
   void runOnOperation() override {
     auto module = getOperation();
-    auto matchedFuncs =
+    auto funcs =
         lookUpFuncsMatching(module, std::regex("[a-zA-Z0-9_]*main_graph"));
-    if (!matchedFuncs.empty()) {
-      for (auto func : matchedFuncs) {
+    if (funcs.empty())
+      module.walk([&](FuncOp funcOp) { funcs.emplace_back(funcOp); });
+
+    // The functions are independent: each one only updates its own type, so
+    // they are inferred in parallel when the context is multithreaded. The
+    // diagnostics are reported in the order of the functions.
+    MLIRContext *context = &getContext();
+    if (!context->isMultithreadingEnabled() || funcs.size() < 2) {
+      for (auto func : funcs)
         if (failed(runShapeInferenceOn(func)))
           signalPassFailure();
-      }
-    } else {
-      auto result = module.walk([&](FuncOp funcOp) -> WalkResult {
-        return runShapeInferenceOn(funcOp);
-      });
-      if (result.wasInterrupted())
-        signalPassFailure();
+      return;
     }
+    std::atomic<bool> passFailed(false);
+    ParallelDiagnosticHandler diagHandler(context);
+    llvm::parallelForEachN(0, funcs.size(), [&](size_t i) {
+      diagHandler.setOrderIDForThread(i);
+      if (failed(runShapeInferenceOn(funcs[i])))
+        passFailed = true;
+      diagHandler.eraseOrderIDForThread();
+    });
+    if (passFailed)
+      signalPassFailure();
   }
 
   static LogicalResult runShapeInferenceOnRegion(mlir::Region &r) {
-    // Iterate on the operations that need shape inference i.e the operations
-    // that return a dynamic shape or followed by a return op.
+    // The worklist starts with the operations that need shape inference i.e
+    // the operations that return a dynamic shape or followed by a return op.
+    // The users of the results whose types an inference changed are inferred
+    // again, so that the shapes refined, e.g. by a canonicalization between
+    // two runs of the pass, are propagated downstream of the changes only.
+    llvm::SmallPtrSet<Operation *, 32> worklist;
     for (Operation &op : r.getOps()) {
-      std::function<void(mlir::Region &)> doShapeInference =
-          &ShapeInferencePass::runShapeInferenceOnRegion;
       // The shape of graph output has been imported from onnx protobuf model,
       // so the ops followed by a return op may not have dynamic shape output.
       // However, shape inference is still need on these ops
       // to infer optional attributes.
       if (containSubgraph(&op) || isUsedByReturnOp(&op) ||
-          returnsDynamicShape(&op)) {
-        if (auto shape_op = llvm::dyn_cast<ShapeInference>(op)) {
-          if (failed(shape_op.inferShapes(doShapeInference))) {
-            op.emitError("shape inference failed");
-            return failure();
-          }
-        } else {
-          op.emitError("unable to infer shape of operation without shape "
-                       "inference interface");
-          return failure();
-        }
-      }
+          returnsDynamicShape(&op))
+        worklist.insert(&op);
     }
 
+    // The users follow the operations they use in the region, the worklist is
+    // emptied in a single pass over it.
     int64_t dynamicOperations = 0;
+    SmallVector<Type, 4> resultTypes;
     for (Operation &op : r.getOps()) {
+      if (worklist.erase(&op)) {
+        resultTypes.assign(op.result_type_begin(), op.result_type_end());
+        if (failed(inferShapes(op)))
+          return failure();
+        if (!llvm::equal(resultTypes, op.getResultTypes()))
+          for (Operation *user : op.getUsers())
+            if (Operation *userInRegion = r.findAncestorOpInRegion(*user))
+              if (userInRegion != &op && isa<ShapeInference>(userInRegion))
+                worklist.insert(userInRegion);
+      }
       if (returnsDynamicShape(&op))
         dynamicOperations++;
     }
@@ -115,6 +134,24 @@ public:
     return success();
   }
 
+  static LogicalResult inferShapes(Operation &op) {
+    std::function<void(mlir::Region &)> doShapeInference =
+        &ShapeInferencePass::runShapeInferenceOnRegion;
+    if (auto shape_op = llvm::dyn_cast<ShapeInference>(op)) {
+      if (failed(shape_op.inferShapes(doShapeInference))) {
+        op.emitError("shape inference failed");
+        return failure();
+      }
+    } else if (!isa<CallOp>(op)) {
+      // The calls, e.g. of the outlined layers, have the result types of
+      // their callees.
+      op.emitError("unable to infer shape of operation without shape "
+                   "inference interface");
+      return failure();
+    }
+    return success();
+  }
+
   static LogicalResult runShapeInferenceOn(mlir::FuncOp f) {
     // Iterate on the operations that need shape inference i.e the operations
     // that return a dynamic shape or followed by a return op.
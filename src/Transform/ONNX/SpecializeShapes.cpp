@@ -0,0 +1,166 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===---------- SpecializeShapes.cpp - Shape-specialized functions --------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// A model compiled with dynamic input dimensions gets dynamic loop bounds,
+// which keeps the lowering from using its static shape optimizations such as
+// vectorization. This pass clones the entry point function once for each
+// given list of input shapes, with these shapes as the types of the inputs,
+// so that the shape inference and the lowering specialize each clone. The
+// clones are recorded on the entry point, and the runtime entry point calls
+// the first clone whose shapes match the shapes of the inputs, or the
+// function with dynamic shapes otherwise.
+//
+// A specialization lists the shapes of all the inputs separated by ':', each
+// shape being its dimensions separated by 'x', e.g. "1x3x224x224:1x10". A
+// '?' leaves a dimension dynamic.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Parse a specialization into one shape per input, with -1 for the dynamic
+/// dimensions.
+LogicalResult parseSpecialization(StringRef specialization,
+    SmallVectorImpl<SmallVector<int64_t, 4>> &shapes) {
+  SmallVector<StringRef, 4> inputShapes;
+  specialization.split(inputShapes, ':');
+  for (StringRef inputShape : inputShapes) {
+    SmallVector<StringRef, 4> dims;
+    SmallVector<int64_t, 4> shape;
+    if (!inputShape.empty())
+      inputShape.split(dims, 'x');
+    for (StringRef dim : dims) {
+      int64_t size;
+      if (dim == "?")
+        shape.emplace_back(-1);
+      else if (!dim.getAsInteger(10, size) && size > 0)
+        shape.emplace_back(size);
+      else
+        return failure();
+    }
+    shapes.emplace_back(shape);
+  }
+  return success();
+}
+
+/*!
+ *  Module pass that clones the entry point functions for some input shapes.
+ */
+struct SpecializeShapesPass
+    : public PassWrapper<SpecializeShapesPass, OperationPass<ModuleOp>> {
+  SpecializeShapesPass() = default;
+  SpecializeShapesPass(const SpecializeShapesPass &pass) {}
+  SpecializeShapesPass(ArrayRef<std::string> specializations) {
+    this->specializations = specializations;
+  }
+
+  ListOption<std::string> specializations{*this, "shapes",
+      llvm::cl::desc("Input shapes of the specializations, the shapes of the "
+                     "inputs being separated by ':' and their dims by 'x'."),
+      llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated};
+
+  void runOnOperation() final {
+    ModuleOp module = getOperation();
+    if (specializations.empty())
+      return;
+
+    SmallVector<ONNXEntryPointOp, 1> entryPointOps;
+    module.walk([&](ONNXEntryPointOp op) { entryPointOps.emplace_back(op); });
+    for (ONNXEntryPointOp entryPointOp : entryPointOps)
+      if (failed(specialize(module, entryPointOp))) {
+        signalPassFailure();
+        return;
+      }
+  }
+
+  LogicalResult specialize(ModuleOp module, ONNXEntryPointOp entryPointOp) {
+    MLIRContext *context = &getContext();
+    Builder builder(context);
+    StringRef funcName =
+        entryPointOp
+            ->getAttrOfType<SymbolRefAttr>(
+                ONNXEntryPointOp::getEntryPointFuncAttrName())
+            .getLeafReference();
+    FuncOp func = module.lookupSymbol<FuncOp>(funcName);
+    if (!func)
+      return entryPointOp.emitError("entry point function not found");
+
+    SmallVector<Attribute, 4> specializationAttrs;
+    for (auto en : llvm::enumerate(specializations)) {
+      // Check the shapes against the types of the inputs.
+      SmallVector<SmallVector<int64_t, 4>, 4> shapes;
+      if (failed(parseSpecialization(en.value(), shapes)))
+        return func.emitError("invalid shape specialization ") << en.value();
+      if (shapes.size() != func.getNumArguments())
+        return func.emitError("shape specialization ")
+               << en.value() << " does not give the shapes of all inputs";
+      SmallVector<Type, 4> argTypes;
+      SmallVector<Attribute, 4> shapeAttrs;
+      for (unsigned i = 0; i < shapes.size(); ++i) {
+        RankedTensorType argType =
+            func.getArgument(i).getType().dyn_cast<RankedTensorType>();
+        bool compatible =
+            argType && argType.getRank() == (int64_t)shapes[i].size();
+        for (int64_t d = 0; compatible && d < argType.getRank(); ++d) {
+          if (shapes[i][d] == -1)
+            shapes[i][d] = argType.getShape()[d];
+          else if (argType.getShape()[d] != -1 &&
+                   argType.getShape()[d] != shapes[i][d])
+            compatible = false;
+        }
+        if (!compatible)
+          return func.emitError("shape specialization ")
+                 << en.value() << " does not match the type of input " << i;
+        argTypes.emplace_back(
+            RankedTensorType::get(shapes[i], argType.getElementType()));
+        shapeAttrs.emplace_back(builder.getI64ArrayAttr(shapes[i]));
+      }
+
+      // Clone the function with the specialized input types. The result
+      // types are refined by the shape inference.
+      FuncOp specializedFunc = func.clone();
+      std::string specializedName =
+          (funcName + "_spec" + Twine(en.index())).str();
+      specializedFunc.setName(specializedName);
+      for (unsigned i = 0; i < argTypes.size(); ++i)
+        specializedFunc.getArgument(i).setType(argTypes[i]);
+      specializedFunc.setType(builder.getFunctionType(
+          argTypes, func.getType().getResults()));
+      module.insert(Block::iterator(func.getOperation()), specializedFunc);
+
+      specializationAttrs.emplace_back(builder.getDictionaryAttr(
+          {builder.getNamedAttr(
+               "func", builder.getSymbolRefAttr(specializedName)),
+              builder.getNamedAttr(
+                  "shapes", builder.getArrayAttr(shapeAttrs))}));
+    }
+    entryPointOp->setAttr(ONNXEntryPointOp::getSpecializationsAttrName(),
+        builder.getArrayAttr(specializationAttrs));
+    return success();
+  }
+};
+} // namespace
+
+/*!
+ * Create a pass that specializes the entry point functions for some input
+ * shapes.
+ */
+std::unique_ptr<mlir::Pass> mlir::createSpecializeShapesPass(
+    ArrayRef<std::string> specializations) {
+  return std::make_unique<SpecializeShapesPass>(specializations);
+}
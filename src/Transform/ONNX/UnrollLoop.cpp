@@ -0,0 +1,184 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===----------- UnrollLoop.cpp - Unroll the Constant Trip Count Loops ----===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file implements a pass that fully unrolls the ONNX Loops running a
+// small constant number of iterations, e.g. the loops over the layers or the
+// time steps of the exported models. Such a Loop is lowered into a krnl loop
+// calling its body on the buffers of the loop-carried values, and its body
+// is specialized neither for its iteration number nor for the shapes the
+// values take at each iteration. Unrolled before shape inference, the body
+// ops see the constant iteration numbers and the values of the previous
+// iteration, for shape inference and constant propagation to go through.
+//
+// A Loop is unrolled when its trip count is a constant, its initial condition
+// is none or a constant true, and its body returns its input condition, so
+// that the loop cannot terminate early. The scan outputs are the
+// concatenation of the values of the iterations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/Dialect/ONNX/ONNXOpsHelper.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Return the value of a constant of a single integer element, or None.
+Optional<APInt> getScalarConstant(Value value) {
+  auto constantOp = getONNXConstantOp(value);
+  if (!constantOp || !constantOp.valueAttr())
+    return None;
+  auto dense = constantOp.valueAttr().dyn_cast<DenseElementsAttr>();
+  if (!dense || dense.getNumElements() != 1 ||
+      !dense.getType().getElementType().isa<IntegerType>())
+    return None;
+  return *dense.int_value_begin();
+}
+
+// Return true if the value is a constant true.
+bool isConstantTrue(Value value) {
+  auto constant = getScalarConstant(value);
+  return constant.hasValue() && constant->getBoolValue();
+}
+
+// Return true if the body of the loop returns its input condition or a
+// constant true, looking through the Identities.
+bool isConditionInvariant(ONNXLoopOp loopOp) {
+  Block &body = loopOp.body().front();
+  Value condOut = body.getTerminator()->getOperand(0);
+  while (auto identityOp =
+             dyn_cast_or_null<ONNXIdentityOp>(condOut.getDefiningOp()))
+    condOut = identityOp.input();
+  return condOut == body.getArgument(1) || isConstantTrue(condOut);
+}
+
+// Return the trip count of a loop that can be unrolled, or 0.
+int64_t getUnrollTripCount(ONNXLoopOp loopOp, int64_t maxTripCount) {
+  if (!llvm::hasSingleElement(loopOp.body()))
+    return 0;
+  auto tripCount = getScalarConstant(loopOp.M());
+  if (!tripCount.hasValue() || tripCount->getSExtValue() < 1 ||
+      tripCount->getSExtValue() > maxTripCount)
+    return 0;
+  if (!loopOp.cond().getType().isa<NoneType>() &&
+      !isConstantTrue(loopOp.cond()))
+    return 0;
+  if (!isConditionInvariant(loopOp))
+    return 0;
+  return tripCount->getSExtValue();
+}
+
+// Replace the loop by the copies of its body for the iterations.
+void unrollLoop(ONNXLoopOp loopOp, int64_t tripCount) {
+  OpBuilder builder(loopOp);
+  Location loc = loopOp.getLoc();
+  Block &body = loopOp.body().front();
+  Operation *terminator = body.getTerminator();
+  int64_t numVs = loopOp.v_initial().size();
+
+  Value cond = builder.create<ONNXConstantOp>(loc, Attribute(),
+      DenseElementsAttr::get(
+          RankedTensorType::get({}, builder.getI1Type()), true));
+  SmallVector<Value, 4> vs(
+      loopOp.v_initial().begin(), loopOp.v_initial().end());
+  SmallVector<SmallVector<Value, 4>, 4> scans(
+      terminator->getNumOperands() - 1 - numVs);
+  for (int64_t i = 0; i < tripCount; ++i) {
+    BlockAndValueMapping mapping;
+    Value iterationNum = builder.create<ONNXConstantOp>(loc, Attribute(),
+        DenseElementsAttr::get(
+            RankedTensorType::get({}, builder.getI64Type()), i));
+    mapping.map(body.getArgument(0), iterationNum);
+    mapping.map(body.getArgument(1), cond);
+    for (int64_t j = 0; j < numVs; ++j)
+      mapping.map(body.getArgument(2 + j), vs[j]);
+    for (Operation &op : body.without_terminator())
+      builder.clone(op, mapping);
+
+    for (int64_t j = 0; j < numVs; ++j)
+      vs[j] = mapping.lookupOrDefault(terminator->getOperand(1 + j));
+    for (unsigned j = 0; j < scans.size(); ++j)
+      scans[j].emplace_back(
+          mapping.lookupOrDefault(terminator->getOperand(1 + numVs + j)));
+  }
+
+  // Stack the values of the iterations along a new leading dimension.
+  SmallVector<Value, 4> results(vs.begin(), vs.end());
+  for (auto scanAndResult : llvm::zip(scans, loopOp.scan_outputs())) {
+    Type resultType = std::get<1>(scanAndResult).getType();
+    Type elementType = resultType.cast<ShapedType>().getElementType();
+    SmallVector<Value, 4> slices;
+    for (Value value : std::get<0>(scanAndResult))
+      slices.emplace_back(builder.create<ONNXUnsqueezeOp>(loc,
+          UnrankedTensorType::get(elementType), value,
+          builder.getI64ArrayAttr(0)));
+    results.emplace_back(builder.create<ONNXConcatOp>(loc, resultType, slices,
+        IntegerAttr::get(builder.getIntegerType(64, /*isSigned=*/true), 0)));
+  }
+  loopOp.replaceAllUsesWith(results);
+  loopOp.erase();
+}
+
+/*!
+ *  Function pass that unrolls the Loops of a small constant trip count.
+ */
+class UnrollLoopONNXPass
+    : public PassWrapper<UnrollLoopONNXPass, FunctionPass> {
+public:
+  UnrollLoopONNXPass() = default;
+  UnrollLoopONNXPass(const UnrollLoopONNXPass &pass) {}
+  UnrollLoopONNXPass(int64_t maxTripCount) {
+    this->maxTripCount = maxTripCount;
+  }
+
+  Option<int64_t> maxTripCount{*this, "max-trip-count",
+      llvm::cl::desc("Maximum trip count of an unrolled Loop."),
+      llvm::cl::init(8)};
+
+  void runOnFunction() final {
+    FuncOp function = getFunction();
+    if (function.isExternal())
+      return;
+
+    // The inner loops are visited first, their copies unrolled with the
+    // outer ones.
+    SmallVector<std::pair<ONNXLoopOp, int64_t>, 4> loops;
+    function.walk([&](ONNXLoopOp loopOp) {
+      if (int64_t tripCount = getUnrollTripCount(loopOp, maxTripCount))
+        loops.emplace_back(loopOp, tripCount);
+    });
+    for (auto loopAndTripCount : loops)
+      unrollLoop(loopAndTripCount.first, loopAndTripCount.second);
+
+    // The values of the last iteration may reach the function results.
+    if (loops.empty())
+      return;
+    Operation *returnOp = function.getBody().back().getTerminator();
+    auto results = returnOp->getOperandTypes();
+    function.setType(FunctionType::get(function.getContext(),
+        function.getType().getInputs(),
+        std::vector<Type>(results.begin(), results.end())));
+  }
+};
+} // end anonymous namespace.
+
+/*!
+ * Create an UnrollLoopONNX pass.
+ */
+std::unique_ptr<mlir::Pass> mlir::createUnrollLoopONNXPass(
+    int64_t maxTripCount) {
+  return std::make_unique<UnrollLoopONNXPass>(maxTripCount);
+}
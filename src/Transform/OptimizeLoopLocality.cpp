@@ -0,0 +1,407 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------ OptimizeLoopLocality.cpp - Reorder and Tile Krnl Loop Nests ---===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// Only the matrix multiplies schedule their krnl.iterate nests with krnl.block
+// and krnl.permute, the other lowerings iterate in the order of the dims of
+// one of their operands. This pass schedules the nests that are neither
+// blocked nor permuted, before their lowering to affine loops:
+//
+// - The loops are permuted so that the loops indexing the innermost dims of
+//   the largest memrefs accessed by the body are the innermost ones, i.e. so
+//   that the innermost loop walks them contiguously.
+// - When the footprint of the nest exceeds the cache size and a memref is
+//   still walked across its innermost dim by an outer loop, e.g. in a
+//   transpose, that loop and the innermost one are tiled, so that the square
+//   tiles of all the accessed memrefs fit in the cache together.
+//
+// The loops marked as parallel stay the outermost ones, untiled. The bodies
+// must only access memory with krnl.load and krnl.store. The memrefs stored
+// to must always be accessed at the same indices, made of induction variables
+// and values defined outside the loops. The reduction loops, i.e. the loops
+// not indexing every memref stored to, keep their relative order, so that the
+// iterations accessing the same elements still execute in the same order.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Builders.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "llvm/Support/MathExtras.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+#include "src/Support/KrnlSupport.hpp"
+
+#include <cmath>
+
+using namespace mlir;
+
+namespace {
+
+// Estimated size of the dynamic dims, for the footprints of the memrefs.
+const int64_t kDynamicDimSize = 1024;
+// The tiles are not smaller than this, smaller ones being dominated by the
+// loop overheads.
+const int64_t kMinTileSize = 8;
+
+/// Return the loops iterated by a krnl.iterate operation, if they are
+/// the loops of a krnl.define_loops that are neither blocked nor permuted.
+bool getIteratedLoops(KrnlIterateOp iterateOp, SmallVectorImpl<Value> &loops) {
+  int64_t numLoops = iterateOp.getNumOptimizedLoops();
+  if (numLoops != iterateOp.bodyRegion().front().getNumArguments())
+    return false;
+
+  auto operands = iterateOp.getOperands();
+  SmallVector<Value, 4> inputLoops;
+  for (auto operand : llvm::drop_begin(operands, numLoops))
+    if (operand.getType().isa<LoopType>())
+      inputLoops.emplace_back(operand);
+
+  if ((int64_t)inputLoops.size() != numLoops)
+    return false;
+
+  for (int64_t i = 0; i < numLoops; ++i) {
+    Value loop = operands[i];
+    if (loop != inputLoops[i] || !loop.getDefiningOp<KrnlDefineLoopsOp>())
+      return false;
+    // The loops must only be iterated and possibly be marked as parallel.
+    for (Operation *user : loop.getUsers())
+      if (user != iterateOp.getOperation() && !isa<KrnlParallelOp>(user))
+        return false;
+    loops.emplace_back(loop);
+  }
+  return true;
+}
+
+/// Return true if the loop is marked as parallel.
+bool isParallelLoop(Value loop) {
+  return llvm::any_of(loop.getUsers(),
+      [](Operation *user) { return isa<KrnlParallelOp>(user); });
+}
+
+/// Return the buffer accessed through a memref, looking through vector type
+/// casts.
+Value getAccessedBuffer(Value memref) {
+  if (auto castOp = memref.getDefiningOp<KrnlVectorTypeCastOp>())
+    return castOp.source();
+  return memref;
+}
+
+/// Estimated size in bytes of a memref.
+int64_t getFootprint(MemRefType type) {
+  int64_t size = getMemRefEltSizeInBytes(type);
+  for (int64_t dim : type.getShape())
+    size *= dim < 0 ? kDynamicDimSize : dim;
+  return size;
+}
+
+/// A krnl.load or krnl.store of the body, with the loops each of its indices
+/// depends on.
+struct Access {
+  Value memref;
+  ValueRange indices;
+  bool isStore;
+  SmallVector<llvm::SmallBitVector, 4> indexLoops;
+};
+
+/// Collect the accesses of the body of a loop nest with the given number of
+/// loops. Return false if the body contains operations other than krnl.load,
+/// krnl.store and operations without side effects.
+bool collectAccesses(
+    Block &body, int64_t numLoops, SmallVectorImpl<Access> &accesses) {
+  // The loops each value computed in the body depends on.
+  llvm::DenseMap<Value, llvm::SmallBitVector> valueLoops;
+  for (int64_t l = 0; l < numLoops; ++l) {
+    llvm::SmallBitVector loops(numLoops);
+    loops.set(l);
+    valueLoops[body.getArgument(l)] = loops;
+  }
+  auto getLoops = [&](Value value) {
+    auto it = valueLoops.find(value);
+    return it == valueLoops.end() ? llvm::SmallBitVector(numLoops)
+                                  : it->second;
+  };
+  auto addAccess = [&](Value memref, ValueRange indices, bool isStore) {
+    Access access{memref, indices, isStore, {}};
+    for (Value index : indices)
+      access.indexLoops.emplace_back(getLoops(index));
+    accesses.emplace_back(access);
+  };
+
+  for (Operation &op : body.without_terminator()) {
+    if (auto loadOp = dyn_cast<KrnlLoadOp>(op)) {
+      addAccess(loadOp.memref(), loadOp.indices(), /*isStore=*/false);
+      valueLoops[loadOp.getResult()] = llvm::SmallBitVector(numLoops, true);
+      continue;
+    }
+    if (auto storeOp = dyn_cast<KrnlStoreOp>(op)) {
+      addAccess(storeOp.memref(), storeOp.indices(), /*isStore=*/true);
+      continue;
+    }
+    auto memInterface = dyn_cast<MemoryEffectOpInterface>(op);
+    if (op.getNumRegions() > 0 || !memInterface || !memInterface.hasNoEffect())
+      return false;
+    llvm::SmallBitVector loops(numLoops);
+    for (Value operand : op.getOperands())
+      loops |= getLoops(operand);
+    for (Value result : op.getResults())
+      valueLoops[result] = loops;
+  }
+  return true;
+}
+
+/// Return the loops that can be reordered without changing the order of the
+/// accesses to the same elements of the memrefs stored to, as reduction
+/// loops whose relative order must be preserved. Return false if the accesses
+/// to the memrefs stored to prevent any reordering.
+bool getReductionLoops(Block &body, ArrayRef<Access> accesses,
+    int64_t numLoops, llvm::SmallBitVector &reductionLoops) {
+  llvm::SetVector<Value> storedBuffers;
+  for (const Access &access : accesses)
+    if (access.isStore)
+      storedBuffers.insert(getAccessedBuffer(access.memref));
+
+  reductionLoops = llvm::SmallBitVector(numLoops);
+  for (Value buffer : storedBuffers) {
+    const Access *first = nullptr;
+    for (const Access &access : accesses) {
+      if (getAccessedBuffer(access.memref) != buffer)
+        continue;
+      if (!first) {
+        first = &access;
+        continue;
+      }
+      if (access.memref != first->memref ||
+          !llvm::equal(access.indices, first->indices))
+        return false;
+    }
+    // The indices are induction variables or values defined outside the
+    // loops.
+    llvm::SmallBitVector indexedLoops(numLoops);
+    for (Value index : first->indices) {
+      auto arg = index.dyn_cast<BlockArgument>();
+      Operation *defOp = index.getDefiningOp();
+      if (arg && arg.getOwner() == &body)
+        indexedLoops.set(arg.getArgNumber());
+      else if (defOp && body.getParentOp()->isAncestor(defOp))
+        return false;
+    }
+    reductionLoops |= indexedLoops.flip();
+  }
+  return true;
+}
+
+/// Scheduling of a loop nest: the order of its loops from the outermost to
+/// the innermost one, and the loops tiled with the tile size.
+struct LoopSchedule {
+  SmallVector<int64_t, 4> order;
+  llvm::SmallBitVector tiled;
+  int64_t tileSize = 0;
+};
+
+/// Order the loops following the first numFixed ones, without parallel
+/// loops, by the strides at which they walk the memrefs accessed, and
+/// select the loops to tile within the cache size.
+LoopSchedule scheduleLoops(ArrayRef<Access> accesses, int64_t numLoops,
+    int64_t numFixed, const llvm::SmallBitVector &reductionLoops,
+    int64_t cacheSize) {
+  LoopSchedule schedule;
+  schedule.tiled = llvm::SmallBitVector(numLoops);
+  for (int64_t l = 0; l < numLoops; ++l)
+    schedule.order.emplace_back(l);
+
+  // The stride cost of a loop is the sum, over the accesses, of the
+  // footprint of the memref times the number of dims following the innermost
+  // dim the loop indexes. A loop not indexing a memref walks it at a zero
+  // stride, and the innermost loops are those of the lowest costs.
+  llvm::SetVector<Value> buffers;
+  SmallVector<int64_t, 4> costs(numLoops, 0);
+  for (const Access &access : accesses) {
+    buffers.insert(getAccessedBuffer(access.memref));
+    MemRefType type = access.memref.getType().cast<MemRefType>();
+    int64_t footprint = getFootprint(type);
+    int64_t rank = access.indices.size();
+    for (int64_t l = 0; l < numLoops; ++l)
+      for (int64_t d = rank - 1; d >= 0; --d)
+        if (access.indexLoops[d].test(l)) {
+          costs[l] += footprint * (rank - 1 - d);
+          break;
+        }
+  }
+  std::stable_sort(schedule.order.begin() + numFixed, schedule.order.end(),
+      [&](int64_t a, int64_t b) { return costs[a] > costs[b]; });
+
+  // Restore the relative order of the reduction loops, in the positions they
+  // were sorted to.
+  SmallVector<int64_t, 4> reductionOrder, reductionPositions;
+  for (int64_t l = 0; l < numLoops; ++l)
+    if (reductionLoops.test(l))
+      reductionOrder.emplace_back(l);
+  for (int64_t p = 0; p < numLoops; ++p)
+    if (reductionLoops.test(schedule.order[p]))
+      reductionPositions.emplace_back(p);
+  for (auto position : llvm::enumerate(reductionPositions))
+    schedule.order[position.value()] = reductionOrder[position.index()];
+
+  // Tile when the memrefs do not fit in the cache and a memref is walked
+  // across its innermost dim by an outer loop, while the innermost loop
+  // walks another of its dims.
+  if (numLoops - numFixed < 2)
+    return schedule;
+  int64_t totalFootprint = 0, maxEltSize = 0;
+  for (Value buffer : buffers) {
+    MemRefType type = buffer.getType().cast<MemRefType>();
+    totalFootprint += getFootprint(type);
+    maxEltSize = std::max<int64_t>(maxEltSize, getMemRefEltSizeInBytes(type));
+  }
+  if (totalFootprint <= cacheSize)
+    return schedule;
+
+  int64_t innermost = schedule.order.back();
+  int64_t tileSize = llvm::PowerOf2Floor(
+      std::sqrt(cacheSize / (buffers.size() * maxEltSize)));
+  if (tileSize < kMinTileSize || reductionLoops.test(innermost))
+    return schedule;
+  // Return true if the dim of the memref is known to be covered by a tile.
+  auto fitsInTile = [&](const Access &access, int64_t d) {
+    int64_t dimSize = access.memref.getType().cast<MemRefType>().getShape()[d];
+    return dimSize >= 0 && dimSize <= tileSize;
+  };
+  for (const Access &access : accesses) {
+    int64_t rank = access.indices.size();
+    if (rank < 2)
+      continue;
+    const llvm::SmallBitVector &lastLoops = access.indexLoops[rank - 1];
+    if (lastLoops.count() != 1 || lastLoops.test(innermost))
+      continue;
+    int64_t outer = lastLoops.find_first();
+    llvm::Optional<int64_t> innerDim;
+    for (int64_t d = 0; d < rank - 1; ++d)
+      if (access.indexLoops[d].test(innermost))
+        innerDim = d;
+    if (!innerDim || reductionLoops.test(outer) ||
+        llvm::find(schedule.order, outer) <
+            schedule.order.begin() + numFixed ||
+        fitsInTile(access, rank - 1) || fitsInTile(access, *innerDim))
+      continue;
+    schedule.tiled.set(outer);
+    schedule.tiled.set(innermost);
+    schedule.tileSize = tileSize;
+    break;
+  }
+  return schedule;
+}
+
+/// Schedule the loop nest, if it is neither blocked nor permuted and its
+/// accesses allow it.
+void optimizeLoopNest(KrnlIterateOp iterateOp, int64_t cacheSize) {
+  SmallVector<Value, 4> loops;
+  if (!getIteratedLoops(iterateOp, loops) || loops.size() < 2)
+    return;
+  int64_t numLoops = loops.size();
+  // The parallel loops must be the outermost ones, and stay so.
+  int64_t numFixed = 0;
+  while (numFixed < numLoops && isParallelLoop(loops[numFixed]))
+    ++numFixed;
+  for (int64_t l = numFixed; l < numLoops; ++l)
+    if (isParallelLoop(loops[l]))
+      return;
+  if (numLoops - numFixed < 2)
+    return;
+
+  Block &body = iterateOp.bodyRegion().front();
+  SmallVector<Access, 8> accesses;
+  llvm::SmallBitVector reductionLoops;
+  if (!collectAccesses(body, numLoops, accesses) ||
+      !getReductionLoops(body, accesses, numLoops, reductionLoops))
+    return;
+
+  LoopSchedule schedule =
+      scheduleLoops(accesses, numLoops, numFixed, reductionLoops, cacheSize);
+  if (llvm::is_sorted(schedule.order) && schedule.tiled.none())
+    return;
+
+  // Block the tiled loops, and permute the blocked and local loops with the
+  // other loops: the tiled loops are replaced by their blocked loops, and
+  // their local loops are the innermost ones. The operands of the
+  // permutation are the loops in their current nesting order, each local
+  // loop following its blocked loop.
+  OpBuilder builder(iterateOp);
+  Location loc = iterateOp.getLoc();
+  llvm::DenseMap<int64_t, KrnlBlockOp> blockOps;
+  SmallVector<Value, 8> nestedLoops;
+  for (int64_t l = numFixed; l < numLoops; ++l) {
+    if (!schedule.tiled.test(l)) {
+      nestedLoops.emplace_back(loops[l]);
+      continue;
+    }
+    auto blockOp =
+        builder.create<KrnlBlockOp>(loc, loops[l], schedule.tileSize);
+    blockOps[l] = blockOp;
+    nestedLoops.append({blockOp.getResult(0), blockOp.getResult(1)});
+  }
+
+  SmallVector<Value, 8> permutedLoops, localLoops;
+  for (int64_t l : llvm::drop_begin(schedule.order, numFixed)) {
+    if (!schedule.tiled.test(l)) {
+      permutedLoops.emplace_back(loops[l]);
+      continue;
+    }
+    permutedLoops.emplace_back(blockOps[l].getResult(0));
+    localLoops.emplace_back(blockOps[l].getResult(1));
+  }
+  permutedLoops.append(localLoops.begin(), localLoops.end());
+
+  SmallVector<int64_t, 8> map;
+  for (Value loop : nestedLoops)
+    map.emplace_back(llvm::find(permutedLoops, loop) - permutedLoops.begin());
+  builder.create<KrnlPermuteOp>(loc, nestedLoops, map);
+
+  SmallVector<Value, 8> operands(loops.begin(), loops.begin() + numFixed);
+  operands.append(permutedLoops.begin(), permutedLoops.end());
+  auto inputOperands = llvm::drop_begin(iterateOp.getOperands(), numLoops);
+  operands.append(inputOperands.begin(), inputOperands.end());
+  iterateOp->setOperands(operands);
+  iterateOp->setAttr(KrnlIterateOp::getNumOptimizedLoopsAttrName(),
+      builder.getI64IntegerAttr(numFixed + permutedLoops.size()));
+}
+
+/*!
+ *  Function pass that reorders and tiles the unscheduled Krnl loop nests.
+ */
+class KrnlOptimizeLoopLocalityPass
+    : public PassWrapper<KrnlOptimizeLoopLocalityPass, FunctionPass> {
+public:
+  KrnlOptimizeLoopLocalityPass() = default;
+  KrnlOptimizeLoopLocalityPass(const KrnlOptimizeLoopLocalityPass &pass) {}
+  KrnlOptimizeLoopLocalityPass(int64_t cacheSize) {
+    this->cacheSize = cacheSize;
+  }
+
+  Option<int64_t> cacheSize{*this, "cache-size",
+      llvm::cl::desc("Size in bytes of the cache the tiles must fit in."),
+      llvm::cl::init(32 * 1024)};
+
+  void runOnFunction() override {
+    SmallVector<KrnlIterateOp, 32> iterateOps;
+    getFunction().walk(
+        [&](KrnlIterateOp op) { iterateOps.emplace_back(op); });
+    for (auto iterateOp : iterateOps)
+      optimizeLoopNest(iterateOp, cacheSize);
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createKrnlOptimizeLoopLocalityPass(
+    int64_t cacheSize) {
+  return std::make_unique<KrnlOptimizeLoopLocalityPass>(cacheSize);
+}
@@ -13,6 +13,12 @@
 // the internal MemRef static and dynamic memory pools emitted by the
 // BundleMemoryPool pass.
 //
+// With the report option, the pass also prints the memory footprint of each
+// function: the size of its static memory pools before and after their
+// compaction, against the lower bound of the bytes of their buffers live at
+// once, the size expressions of its dynamic memory pools, the size of
+// its constants and the size of each intermediate buffer taken from a pool.
+//
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
@@ -21,6 +27,8 @@
 #include "mlir/Transforms/DialectConversion.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "src/Dialect/Krnl/KrnlOps.hpp"
 #include "src/Pass/Passes.hpp"
@@ -402,6 +410,189 @@ bool checkLiveRangesIntersect(
   return false;
 }
 
+/// Returns true if the two krnl.getref operations are known to have the same
+/// memory footprint. For krnl.getref operations with dynamic dimensions, the
+/// sizes are compared symbolically: each dynamic dimension must be given by
+/// the same value, or by constants with the same value.
+bool getRefsHaveSameSymbolicSize(
+    KrnlGetRefOp firstGetRef, KrnlGetRefOp secondGetRef) {
+  if (firstGetRef.getResult().getType() != secondGetRef.getResult().getType())
+    return false;
+
+  auto firstSizes = firstGetRef.getDynamicSizes();
+  auto secondSizes = secondGetRef.getDynamicSizes();
+  if (llvm::size(firstSizes) != llvm::size(secondSizes))
+    return false;
+
+  for (auto sizes : llvm::zip(firstSizes, secondSizes)) {
+    Value firstSize = std::get<0>(sizes);
+    Value secondSize = std::get<1>(sizes);
+    if (firstSize == secondSize)
+      continue;
+
+    auto firstConstant = firstSize.getDefiningOp<ConstantOp>();
+    auto secondConstant = secondSize.getDefiningOp<ConstantOp>();
+    if (!firstConstant || !secondConstant ||
+        firstConstant.getValue() != secondConstant.getValue())
+      return false;
+  }
+  return true;
+}
+
+/// Returns true if the value is one of the partial sums computing the size of
+/// a bundled dynamic memory pool.
+bool isDynamicMemPoolPartialSize(Value value, memref::AllocOp memPool) {
+  Value partialSize = memPool.getOperand(0);
+  while (partialSize) {
+    if (partialSize == value)
+      return true;
+    auto addOp = partialSize.getDefiningOp<AddIOp>();
+    if (!addOp)
+      return false;
+    partialSize = addOp.lhs();
+  }
+  return false;
+}
+
+/// The size of a bundled dynamic memory pool is computed as a chain of
+/// additions, one for each krnl.getref bundled in the memory pool. The offset
+/// of a krnl.getref is the partial sum preceding its own addition:
+///
+///  %1 = addi %0, %size0 : index
+///  %2 = addi %1, %size1 : index
+///  %3 = index_cast %1 : index to i64
+///  %4 = memref.alloc(%2) : memref<?xi8>
+///  %5 = "krnl.getref"(%4, %3, %dim) : (memref<?xi8>, i64, index) -> ...
+///
+/// Returns the addition reserving the slot of the krnl.getref in the memory
+/// pool, or nullptr if it cannot be found or if the slot is also used by
+/// other krnl.getref operations.
+AddIOp getDynamicMemPoolSlotAddition(
+    KrnlGetRefOp getRef, memref::AllocOp memPool) {
+  auto offsetCast = getRef.offset().getDefiningOp<IndexCastOp>();
+  if (!offsetCast)
+    return nullptr;
+  Value slotStart = offsetCast.getOperand();
+
+  // The slot must only be used by the current krnl.getref.
+  for (Operation *user : slotStart.getUsers()) {
+    if (!llvm::isa<IndexCastOp>(user))
+      continue;
+    for (Operation *castUser : user->getResult(0).getUsers())
+      if (castUser != getRef.getOperation())
+        return nullptr;
+  }
+
+  for (Operation *user : slotStart.getUsers()) {
+    auto addOp = llvm::dyn_cast<AddIOp>(user);
+    if (addOp && addOp.lhs() == slotStart &&
+        isDynamicMemPoolPartialSize(addOp.getResult(), memPool))
+      return addOp;
+  }
+  return nullptr;
+}
+
+/// A slot of a static memory pool: the krnl.getref operations sharing an
+/// offset, with their size and alignment in bytes.
+struct StaticPoolSlot {
+  SmallVector<KrnlGetRefOp, 4> getRefs;
+  int64_t size;
+  int64_t alignment;
+  int64_t offset = -1;
+};
+
+/// Returns true if the two slots cannot share memory, with the same checks
+/// as the reuse of a slot by KrnlOptimizeStaticMemoryPools.
+bool staticPoolSlotsConflict(StaticPoolSlot &first, StaticPoolSlot &second) {
+  for (auto getRef : second.getRefs)
+    if (getRefUsesAreNotUsedBySameOp(first.getRefs, getRef) ||
+        checkLiveRangesIntersect(first.getRefs, getRef))
+      return true;
+  return !getRefUsesAreMutuallyDisjoint(first.getRefs, second.getRefs);
+}
+
+/// Place the slots of a static memory pool with the greedy by size strategy:
+/// the slots are placed from the largest to the smallest, each one in the
+/// smallest gap, at its alignment, between the slots already placed whose
+/// uses conflict with its own, or after them. Returns the size of the pool.
+int64_t packStaticPoolSlots(SmallVectorImpl<StaticPoolSlot> &slots) {
+  SmallVector<StaticPoolSlot *, 16> order;
+  for (auto &slot : slots)
+    order.emplace_back(&slot);
+  std::stable_sort(order.begin(), order.end(),
+      [](StaticPoolSlot *a, StaticPoolSlot *b) { return a->size > b->size; });
+
+  auto alignTo = [](int64_t offset, int64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+  };
+  SmallVector<StaticPoolSlot *, 16> placed;
+  int64_t poolSize = 0;
+  for (StaticPoolSlot *slot : order) {
+    SmallVector<StaticPoolSlot *, 16> conflicts;
+    for (StaticPoolSlot *other : placed)
+      if (staticPoolSlotsConflict(*other, *slot))
+        conflicts.emplace_back(other);
+    std::sort(conflicts.begin(), conflicts.end(),
+        [](StaticPoolSlot *a, StaticPoolSlot *b) {
+          return a->offset < b->offset;
+        });
+
+    // Best fit among the gaps between the conflicting slots.
+    int64_t bestOffset = -1, bestGap = 0, end = 0;
+    for (StaticPoolSlot *other : conflicts) {
+      int64_t offset = alignTo(end, slot->alignment);
+      int64_t gap = other->offset - offset;
+      if (gap >= slot->size && (bestOffset < 0 || gap < bestGap)) {
+        bestOffset = offset;
+        bestGap = gap;
+      }
+      end = std::max(end, other->offset + other->size);
+    }
+    slot->offset = bestOffset >= 0 ? bestOffset : alignTo(end, slot->alignment);
+    poolSize = std::max(poolSize, slot->offset + slot->size);
+    placed.emplace_back(slot);
+  }
+  return poolSize;
+}
+
+/// Returns the lower bound of the size of the static memory pools of the
+/// function: the largest number of bytes of the krnl.getref operations of a
+/// pool live at the same operation, summed over the pools.
+int64_t getStaticMemoryPoolsLowerBound(FuncOp function) {
+  llvm::DenseMap<Operation *, int64_t> positions;
+  function.walk([&](Operation *op) { positions[op] = positions.size(); });
+
+  llvm::DenseMap<Value, SmallVector<std::pair<int64_t, int64_t>, 4>> events;
+  function.walk([&](KrnlGetRefOp getRef) {
+    auto memRefType = getRef.getResult().getType().cast<MemRefType>();
+    auto poolType = getRef.mempool().getType().cast<MemRefType>();
+    if (!hasAllConstantDimensions(memRefType) ||
+        !hasAllConstantDimensions(poolType))
+      return;
+    Operation *firstOp = getLiveRangeFirstOp(getRef);
+    Operation *lastOp = getLiveRangeLastOp(getRef);
+    if (!firstOp || !lastOp)
+      return;
+    int64_t size = getMemRefSizeInBytes(getRef.getResult());
+    auto &poolEvents = events[getRef.mempool()];
+    poolEvents.emplace_back(positions[firstOp], size);
+    poolEvents.emplace_back(positions[lastOp] + 1, -size);
+  });
+
+  int64_t lowerBound = 0;
+  for (auto &poolEvents : events) {
+    // The buffers freed at a position are removed before the ones allocated.
+    llvm::sort(poolEvents.second);
+    int64_t live = 0, peak = 0;
+    for (auto event : poolEvents.second) {
+      live += event.second;
+      peak = std::max(peak, live);
+    }
+    lowerBound += peak;
+  }
+  return lowerBound;
+}
+
 //===----------------------------------------------------------------------===//
 // Rewrite patterns.
 //===----------------------------------------------------------------------===//
@@ -622,6 +813,10 @@ public:
 // run. This means that after this rule is applied there are no slots in the
 // mempool that are not used at least once.
 //
+// The slots are packed by size, see packStaticPoolSlots: a slot can overlap
+// the slots of other sizes whose uses do not conflict with its own, its
+// offset being a multiple of the alignment of the pool and of its elements.
+//
 // Example:
 //
 // Optimized memory pool:
@@ -634,11 +829,11 @@ public:
 //
 // Compacted optimized memory pool:
 //  %1 = alloc() : memref<800xi8>
-//  %2 = "krnl.getref"(%1, 400)
-//  %3 = "krnl.getref"(%1, 0)
-//  %4 = "krnl.getref"(%1, 400)
-//  %5 = "krnl.getref"(%1, 0)
-//  %6 = "krnl.getref"(%1, 0)
+//  %2 = "krnl.getref"(%1, 0)
+//  %3 = "krnl.getref"(%1, 400)
+//  %4 = "krnl.getref"(%1, 0)
+//  %5 = "krnl.getref"(%1, 400)
+//  %6 = "krnl.getref"(%1, 400)
 //
 class KrnlCompactStaticMemoryPools : public OpRewritePattern<memref::AllocOp> {
 public:
@@ -695,14 +890,32 @@ public:
 
     assert(usedMemory <= memPoolShape[0] &&
            "Used memory exceeds allocated memory.");
+    (void)usedMemory;
+
+    // Collect the slots of the memory pool.
+    SmallVector<KrnlGetRefOp, 4> distinctGetRefs =
+        getAllDistinctGetRefsForAlloc(&allocOp);
+    SmallVector<StaticPoolSlot, 16> slots;
+    for (auto getRefOp : distinctGetRefs) {
+      StaticPoolSlot slot;
+      slot.getRefs = getAllGetRefWithSameOffset(&getRefOp);
+      slot.size = getMemRefSizeInBytes(getRefOp.getResult());
+      slot.alignment = std::max<int64_t>(alignment, 1);
+      for (auto getRef : slot.getRefs)
+        slot.alignment = std::max<int64_t>(slot.alignment,
+            getMemRefEltSizeInBytes(
+                getRef.getResult().getType().cast<MemRefType>()));
+      slots.emplace_back(slot);
+    }
 
     // Check if changes to the memory pool are required.
-    if (memPoolShape[0] == usedMemory)
+    int64_t newSize = packStaticPoolSlots(slots);
+    if (newSize >= memPoolShape[0])
       return failure();
 
     // Compute the shape of the new static memory pool.
     SmallVector<int64_t, 1> newStaticMemPoolShape;
-    newStaticMemPoolShape.emplace_back(usedMemory);
+    newStaticMemPoolShape.emplace_back(newSize);
     auto newStaticMemPoolType =
         MemRefType::get(newStaticMemPoolShape, rewriter.getIntegerType(8));
 
@@ -711,37 +924,17 @@ public:
         loc, newStaticMemPoolType, allocOp.alignmentAttr());
     newStaticMemPool.getOperation()->moveBefore(allocOp);
 
-    // Changes are required, memory pool needs to be compacted.
-    SmallVector<KrnlGetRefOp, 4> distinctGetRefs =
-        getAllDistinctGetRefsForAlloc(&allocOp);
-
-    // Size of all distinct getrefs:
-    int64_t distinctGRSize = 0;
-    for (auto getRefOp : distinctGetRefs) {
-      distinctGRSize += getMemRefSizeInBytes(getRefOp.getResult());
-    }
-    assert(distinctGRSize == usedMemory &&
-           "Size of all distinct getrefs must match the total used memory");
-
     // Each krnl.getref using the alloc needs to be re-emitted with the new
-    // static memory pool and the new offset.
-    int64_t currentOffset = 0;
+    // static memory pool and the new offset of its slot.
     std::vector<std::pair<KrnlGetRefOp, KrnlGetRefOp>> oldToNewGetRef;
-    for (auto getRefOp : distinctGetRefs) {
-      // Emit the current offset inside the static memory pool.
+    for (auto &slot : slots) {
+      // Emit the offset of the slot inside the static memory pool.
       auto newOffset = rewriter.create<ConstantOp>(loc,
-          rewriter.getIntegerAttr(rewriter.getIntegerType(64), currentOffset));
-
-      // Size of current getref.
-      int64_t currentGetRefSize = getMemRefSizeInBytes(getRefOp.getResult());
-
-      // Get all getRefs which share the same memory slot.
-      SmallVector<KrnlGetRefOp, 4> sameSlotGetRefs =
-          getAllGetRefWithSameOffset(&getRefOp);
+          rewriter.getIntegerAttr(rewriter.getIntegerType(64), slot.offset));
 
       // Replace each one with a getref using the new offset in the compacted
       // memory pool.
-      for (auto oldGetRef : sameSlotGetRefs) {
+      for (auto oldGetRef : slot.getRefs) {
         // Create a new krnl.getref using the new memory pool and new offset.
         auto newGetRefOp = rewriter.create<KrnlGetRefOp>(
             loc, oldGetRef.getResult().getType(), newStaticMemPool, newOffset);
@@ -750,14 +943,8 @@ public:
         oldToNewGetRef.emplace_back(
             std::pair<KrnlGetRefOp, KrnlGetRefOp>(oldGetRef, newGetRefOp));
       }
-
-      // Update offset.
-      currentOffset += currentGetRefSize;
     }
 
-    assert(currentOffset == usedMemory &&
-           "Size total used memory must match the last offset.");
-
     for (auto getRefPair : oldToNewGetRef)
       rewriter.replaceOp(getRefPair.first, getRefPair.second.getResult());
 
@@ -774,6 +961,264 @@ public:
   }
 };
 
+// This pattern reuses slots of a dynamic memory pool. Since the sizes of the
+// krnl.getref operations are only known at runtime, a krnl.getref can only
+// reuse the slot of another krnl.getref when the two are known to have the
+// same symbolic size, i.e. the same type and the same dynamic dimensions.
+// Unlike for static memory pools, the slot of the reusing krnl.getref is
+// removed from the size of the memory pool by the same rewrite.
+//
+// Example:
+//
+// Unoptimized:
+//  %1 = addi %size, %size : index
+//  %2 = addi %1, %size : index
+//  %3 = index_cast %size : index to i64
+//  %4 = index_cast %1 : index to i64
+//  %5 = memref.alloc(%2) : memref<?xi8>
+//  %6 = "krnl.getref"(%5, %c0_i64, %dim)
+//  %7 = "krnl.getref"(%5, %3, %dim)
+//  %8 = "krnl.getref"(%5, %4, %dim)
+//
+// Optimized, where %6 and %8 have disjoint live ranges:
+//  %1 = addi %size, %size : index
+//  %3 = index_cast %size : index to i64
+//  %5 = memref.alloc(%1) : memref<?xi8>
+//  %6 = "krnl.getref"(%5, %c0_i64, %dim)
+//  %7 = "krnl.getref"(%5, %3, %dim)
+//  %8 = "krnl.getref"(%5, %c0_i64, %dim)
+//
+class KrnlOptimizeDynamicMemoryPools : public OpRewritePattern<KrnlGetRefOp> {
+public:
+  using OpRewritePattern<KrnlGetRefOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(
+      KrnlGetRefOp firstGetRef, PatternRewriter &rewriter) const override {
+    auto loc = firstGetRef.getLoc();
+
+    // Retrieve the AllocOp that this GetRef uses.
+    auto dynamicMemPool = getAllocOfGetRef(&firstGetRef);
+    if (!dynamicMemPool)
+      return failure();
+
+    // Only handle dynamic memory pools.
+    auto memPoolType =
+        dynamicMemPool.getResult().getType().dyn_cast<MemRefType>();
+    if (hasAllConstantDimensions(memPoolType))
+      return failure();
+
+    // Dynamic memory pool type must be byte.
+    if (getMemRefEltSizeInBytes(memPoolType) != 1)
+      return failure();
+
+    // Rank of the dynamic memory pool must be 1.
+    if (memPoolType.getShape().size() != 1)
+      return failure();
+
+    // The memory pool must be bundled.
+    if (getAllocGetRefNum(&dynamicMemPool) < 2)
+      return failure();
+
+    // Get parent block.
+    Block *parentBlock = firstGetRef.getOperation()->getBlock();
+
+    // TODO: relax this condition.
+    // If this is not the top block fail.
+    if (!llvm::dyn_cast_or_null<FuncOp>(parentBlock->getParentOp()))
+      return failure();
+
+    // The memory pool and its size must be defined in the same block.
+    if (dynamicMemPool.getOperation()->getBlock() != parentBlock)
+      return failure();
+
+    // List of all GetRefs which share the slot with firstGetRef.
+    SmallVector<KrnlGetRefOp, 4> firstGetRefList =
+        getAllGetRefWithSameOffset(&firstGetRef);
+
+    // All matches are discovered in one application so applying the rule to
+    // an already optimized set of getrefs will not find new reuses.
+    if (firstGetRefList.size() > 1)
+      return failure();
+
+    // Get the GetRefs, other than the current one, that use the same dynamic
+    // memory pool and have the same symbolic size.
+    SmallVector<KrnlGetRefOp, 4> getRefCandidates;
+    for (auto &op :
+        llvm::make_range(parentBlock->begin(), std::prev(parentBlock->end()))) {
+      KrnlGetRefOp candidate = llvm::dyn_cast_or_null<KrnlGetRefOp>(&op);
+      if (!candidate || candidate == firstGetRef)
+        continue;
+
+      if (candidate.mempool() == dynamicMemPool.getResult() &&
+          getRefsHaveSameSymbolicSize(firstGetRef, candidate))
+        getRefCandidates.emplace_back(candidate);
+    }
+
+    // If no candidate was found, pattern matching failed.
+    if (getRefCandidates.size() < 1)
+      return failure();
+
+    SmallVector<KrnlGetRefOp, 4> validSlotReusers;
+    SmallVector<AddIOp, 4> slotAdditions;
+    for (auto secondGetRef : getRefCandidates) {
+      // If the second getref has the same offset as the first then there is
+      // no work to do.
+      if (firstGetRef.offset() == secondGetRef.offset())
+        continue;
+
+      // Do not merge the secondGetRef if secondGetRef has any reusers.
+      SmallVector<KrnlGetRefOp, 4> secondGetRefList =
+          getAllGetRefWithSameOffsetExcept(&secondGetRef, validSlotReusers);
+      if (secondGetRefList.size() > 1)
+        continue;
+
+      // Only reuse a slot if the slot of the second getref can be removed
+      // from the memory pool.
+      AddIOp slotAddition =
+          getDynamicMemPoolSlotAddition(secondGetRef, dynamicMemPool);
+      if (!slotAddition)
+        continue;
+
+      // The two getRefs must not be used by the same operation.
+      if (getRefUsesAreNotUsedBySameOp(firstGetRefList, secondGetRef))
+        continue;
+
+      // The usage of the two getRefs must be disjoint.
+      if (!getRefUsesAreMutuallyDisjoint(firstGetRefList, secondGetRefList))
+        continue;
+
+      // Check live ranges do not intersect.
+      if (checkLiveRangesIntersect(firstGetRefList, secondGetRef))
+        continue;
+
+      validSlotReusers.emplace_back(secondGetRef);
+      slotAdditions.emplace_back(slotAddition);
+      firstGetRefList.emplace_back(secondGetRef);
+    }
+
+    // No valid slot reuse getRefs have been identified.
+    if (validSlotReusers.size() == 0)
+      return failure();
+
+    // Convert all the reusers to use the slot of firstGetRef and remove their
+    // own slots from the size of the memory pool. The offset of firstGetRef
+    // is computed before the memory pool so it dominates all its getrefs.
+    for (auto secondGetRef : validSlotReusers) {
+      auto newGetRefOp =
+          rewriter.create<KrnlGetRefOp>(loc, secondGetRef.getResult().getType(),
+              dynamicMemPool, firstGetRef.offset(),
+              secondGetRef.getDynamicSizes());
+      newGetRefOp.getOperation()->moveBefore(secondGetRef);
+      rewriter.replaceOp(secondGetRef, newGetRefOp.getResult());
+    }
+    for (auto slotAddition : slotAdditions)
+      rewriter.replaceOp(slotAddition, slotAddition.lhs());
+
+    return success();
+  }
+};
+
+/// Check that the alloc is a memory pool, i.e. a 1-D MemRef of bytes used by
+/// krnl.getref operations.
+bool isMemoryPool(memref::AllocOp allocOp) {
+  auto memRefType = allocOp.getResult().getType().cast<MemRefType>();
+  return checkOpResultIsUsedByGetRef(&allocOp) &&
+         memRefType.getShape().size() == 1 &&
+         getMemRefEltSizeInBytes(memRefType) == 1;
+}
+
+/// Get the total size in bytes of the static memory pools of the function.
+int64_t getStaticMemoryPoolsSize(FuncOp function) {
+  int64_t totalSize = 0;
+  function.walk([&](memref::AllocOp allocOp) {
+    if (isMemoryPool(allocOp) &&
+        hasAllConstantDimensions(
+            allocOp.getResult().getType().cast<MemRefType>()))
+      totalSize += getMemRefSizeInBytes(allocOp.getResult());
+  });
+  return totalSize;
+}
+
+/// Print the expression computing an integer or index value, e.g. the size
+/// of a dynamic memory pool, from the arguments of the function.
+void printSizeExpression(Value value, llvm::raw_ostream &os) {
+  if (auto arg = value.dyn_cast<BlockArgument>()) {
+    os << "%arg" << arg.getArgNumber();
+    return;
+  }
+  Operation *op = value.getDefiningOp();
+  if (auto constantOp = dyn_cast<ConstantOp>(op))
+    if (auto intAttr = constantOp.getValue().dyn_cast<IntegerAttr>()) {
+      os << intAttr.getInt();
+      return;
+    }
+  if (isa<IndexCastOp>(op)) {
+    printSizeExpression(op->getOperand(0), os);
+    return;
+  }
+  StringRef binaryOp = isa<AddIOp>(op)   ? " + "
+                       : isa<SubIOp>(op) ? " - "
+                       : isa<MulIOp>(op) ? " * "
+                                         : "";
+  if (!binaryOp.empty()) {
+    os << "(";
+    printSizeExpression(op->getOperand(0), os);
+    os << binaryOp;
+    printSizeExpression(op->getOperand(1), os);
+    os << ")";
+    return;
+  }
+  // Other operations, e.g. the dimensions of the arguments, are printed as
+  // calls.
+  os << op->getName() << "(";
+  llvm::interleaveComma(op->getOperands(), os,
+      [&](Value operand) { printSizeExpression(operand, os); });
+  os << ")";
+}
+
+/// Print the memory footprint of the function. The whole report is written
+/// at once, the functions being processed in parallel.
+void printMemoryReport(FuncOp function, int64_t staticPoolsSizeBefore) {
+  std::string buffer;
+  llvm::raw_string_ostream os(buffer);
+  os << "memory report of @" << function.getName() << ":\n";
+  os << "  static memory pools: " << staticPoolsSizeBefore
+     << " bytes before compaction, " << getStaticMemoryPoolsSize(function)
+     << " bytes after, " << getStaticMemoryPoolsLowerBound(function)
+     << " bytes lower bound\n";
+
+  function.walk([&](memref::AllocOp allocOp) {
+    if (!isMemoryPool(allocOp) ||
+        hasAllConstantDimensions(
+            allocOp.getResult().getType().cast<MemRefType>()))
+      return;
+    os << "  dynamic memory pool: ";
+    printSizeExpression(allocOp.getOperand(0), os);
+    os << " bytes\n";
+  });
+
+  // The globals sharing a name are emitted once.
+  int64_t constantsSize = 0;
+  llvm::StringSet<> globalNames;
+  function.walk([&](KrnlGlobalOp globalOp) {
+    if (globalNames.insert(globalOp.name()).second)
+      constantsSize += getMemRefSizeInBytes(globalOp.getResult());
+  });
+  os << "  constants: " << constantsSize << " bytes in " << globalNames.size()
+     << " globals\n";
+
+  os << "  intermediate buffers:\n";
+  function.walk([&](KrnlGetRefOp getRef) {
+    auto memRefType = getRef.getResult().getType().cast<MemRefType>();
+    os << "    " << getRef.getLoc() << ": " << memRefType << ", ";
+    if (hasAllConstantDimensions(memRefType))
+      os << getMemRefSizeInBytes(getRef.getResult()) << " bytes\n";
+    else
+      os << "dynamic size\n";
+  });
+  llvm::errs() << os.str();
+}
+
 /*!
  *  Function pass that optimizes memory pools.
  */
@@ -782,8 +1227,18 @@ class KrnlOptimizeMemoryPoolsPass
   BlockToCompactedAlignments blockToStaticPoolAlignments;
 
 public:
+  KrnlOptimizeMemoryPoolsPass() = default;
+  KrnlOptimizeMemoryPoolsPass(const KrnlOptimizeMemoryPoolsPass &pass) {}
+  KrnlOptimizeMemoryPoolsPass(bool report) { this->report = report; }
+
+  Option<bool> report{*this, "report",
+      llvm::cl::desc("Print the memory footprint of each function."),
+      llvm::cl::init(false)};
+
   void runOnFunction() override {
     auto function = getFunction();
+    int64_t staticPoolsSizeBefore =
+        report ? getStaticMemoryPoolsSize(function) : 0;
 
     ConversionTarget target(getContext());
     RewritePatternSet patterns(&getContext());
@@ -791,14 +1246,18 @@ public:
         &getContext(), &blockToStaticPoolAlignments);
     patterns.insert<KrnlCompactStaticMemoryPools>(
         &getContext(), &blockToStaticPoolAlignments);
+    patterns.insert<KrnlOptimizeDynamicMemoryPools>(&getContext());
 
     // No need to test, its ok to fail the apply.
     LogicalResult res =
         applyPatternsAndFoldGreedily(function, std::move(patterns));
+
+    if (report)
+      printMemoryReport(function, staticPoolsSizeBefore);
   }
 };
 } // namespace
 
-std::unique_ptr<Pass> mlir::createKrnlOptimizeMemoryPoolsPass() {
-  return std::make_unique<KrnlOptimizeMemoryPoolsPass>();
+std::unique_ptr<Pass> mlir::createKrnlOptimizeMemoryPoolsPass(bool report) {
+  return std::make_unique<KrnlOptimizeMemoryPoolsPass>(report);
 }
@@ -0,0 +1,258 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-- ParallelizeIndependentLoops.cpp - Run Independent Loops at Once ---===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This pass executes the independent loop nests of a function concurrently,
+// once the affine loops are lowered to SCF loops. The branches of the branchy
+// graphs, e.g. the towers of an Inception module, the heads of an attention
+// split into per-head ops, or the models of an ensemble, are otherwise
+// executed one after the other, each one too small to use the threads well.
+//
+// The consecutive sequential loop nests of the function body that do not access
+// the same memory, one of them writing it, become the tasks of a parallel loop:
+//
+//   scf.parallel (%task) = (%c0) to (%cN) step (%c1) {
+//     scf.if %task == 0 { <nest 0> }
+//     ...
+//     scf.if %task == N-1 { <nest N-1> }
+//   }
+//
+// which is executed by the thread pool of the runtime. The nests holding a
+// parallel loop already use the threads, and are left out of the tasks: the
+// parallel loops nested in a task would run sequentially. The buffers of the
+// memory pools
+// are slices of the pools at constant offsets: the slices reused by the
+// buffers of different ops (see OptimizeMemoryPools.cpp) overlap, and keep
+// their ops ordered.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// The memory accessed through a MemRef: its buffer, and the range of bytes
+/// of the buffer when the MemRef is a slice of a memory pool at a constant
+/// offset. The views of a MemRef stay within the memory it views.
+struct AccessedMemory {
+  Value buffer;
+  Optional<std::pair<int64_t, int64_t>> byteRange;
+  bool isWrite;
+};
+
+AccessedMemory getAccessedMemory(Value memRef, bool isWrite) {
+  AccessedMemory memory = {memRef, None, isWrite};
+  while (Operation *op = memory.buffer.getDefiningOp()) {
+    if (auto viewOp = dyn_cast<ViewLikeOpInterface>(op)) {
+      memory.buffer = viewOp.getViewSource();
+    } else if (auto castOp = dyn_cast<memref::CastOp>(op)) {
+      memory.buffer = castOp.source();
+    } else if (auto reinterpretCastOp =
+                   dyn_cast<memref::ReinterpretCastOp>(op)) {
+      memory.buffer = reinterpretCastOp.source();
+    } else if (auto getRefOp = dyn_cast<KrnlGetRefOp>(op)) {
+      auto sliceType = getRefOp.getResult().getType().cast<MemRefType>();
+      APInt offset;
+      if (!memory.byteRange && sliceType.hasStaticShape() &&
+          sliceType.getElementTypeBitWidth() % 8 == 0 &&
+          matchPattern(getRefOp.offset(), m_ConstantInt(&offset))) {
+        int64_t begin = offset.getSExtValue();
+        memory.byteRange = std::make_pair(begin,
+            begin + sliceType.getNumElements() *
+                        sliceType.getElementTypeBitWidth() / 8);
+      }
+      memory.buffer = getRefOp.mempool();
+    } else {
+      break;
+    }
+  }
+  return memory;
+}
+
+/// Check whether the buffer is allocated by the function, or is a constant,
+/// and so does not alias any other buffer.
+bool isDistinctBuffer(Value buffer) {
+  return buffer.getDefiningOp<memref::AllocOp>() ||
+         buffer.getDefiningOp<memref::AllocaOp>() ||
+         buffer.getDefiningOp<KrnlGlobalOp>();
+}
+
+/// Check whether the accesses may touch the same bytes, one of them writing.
+bool mayConflict(const AccessedMemory &a, const AccessedMemory &b) {
+  if (!a.isWrite && !b.isWrite)
+    return false;
+  if (a.buffer != b.buffer) {
+    // The arguments of the function may alias each other, but not the buffers
+    // allocated by the function.
+    bool aIsArg = a.buffer.isa<BlockArgument>();
+    bool bIsArg = b.buffer.isa<BlockArgument>();
+    return !((isDistinctBuffer(a.buffer) &&
+                 (isDistinctBuffer(b.buffer) || bIsArg)) ||
+             (aIsArg && isDistinctBuffer(b.buffer)));
+  }
+  if (!a.byteRange || !b.byteRange)
+    return true;
+  return a.byteRange->first < b.byteRange->second &&
+         b.byteRange->first < a.byteRange->second;
+}
+
+/// Check whether the operation has no side effects. The slices of the memory
+/// pools only compute addresses in the pools.
+bool hasNoEffect(Operation *op) {
+  return isa<KrnlGetRefOp>(op) || MemoryEffectOpInterface::hasNoEffect(op);
+}
+
+/// Collect the memory accessed by the loop nest. Return false when some
+/// operation of the nest has effects that are not on a known MemRef.
+bool collectAccesses(
+    Operation *loop, SmallVectorImpl<AccessedMemory> &accesses) {
+  WalkResult result = loop->walk([&](Operation *op) {
+    if (op->hasTrait<OpTrait::HasRecursiveSideEffects>() ||
+        isa<KrnlGetRefOp>(op))
+      return WalkResult::advance();
+    auto effectInterface = dyn_cast<MemoryEffectOpInterface>(op);
+    if (!effectInterface)
+      return WalkResult::interrupt();
+    SmallVector<MemoryEffects::EffectInstance, 2> effects;
+    effectInterface.getEffects(effects);
+    for (MemoryEffects::EffectInstance &effect : effects) {
+      Value value = effect.getValue();
+      if (!value)
+        return WalkResult::interrupt();
+      // The buffers local to the nest are not seen by the other nests.
+      if (loop->isAncestor(value.getParentRegion()->getParentOp()) &&
+          isa<MemoryEffects::Allocate, MemoryEffects::Free>(
+              effect.getEffect()))
+        continue;
+      accesses.emplace_back(getAccessedMemory(
+          value, !isa<MemoryEffects::Read>(effect.getEffect())));
+    }
+    return WalkResult::advance();
+  });
+  return !result.wasInterrupted();
+}
+
+/// A loop nest of the function body, with the memory it accesses.
+struct Task {
+  Operation *loop;
+  SmallVector<AccessedMemory, 8> accesses;
+};
+
+bool areIndependent(const Task &a, const Task &b) {
+  for (const AccessedMemory &accessA : a.accesses)
+    for (const AccessedMemory &accessB : b.accesses)
+      if (mayConflict(accessA, accessB))
+        return false;
+  return true;
+}
+
+/// Replace the independent loop nests by the tasks of a parallel loop. The
+/// side-effect free operations that were between them, which do not depend
+/// on the nests, are moved before the parallel loop.
+void parallelizeTasks(
+    ArrayRef<Task> tasks, ArrayRef<Operation *> interleavedOps) {
+  Operation *firstLoop = tasks.front().loop;
+  for (Operation *op : interleavedOps)
+    op->moveBefore(firstLoop);
+  OpBuilder builder(firstLoop);
+  Location loc = firstLoop->getLoc();
+  Value zero = builder.create<ConstantIndexOp>(loc, 0);
+  Value one = builder.create<ConstantIndexOp>(loc, 1);
+  Value numTasks = builder.create<ConstantIndexOp>(loc, tasks.size());
+  auto parallelOp = builder.create<scf::ParallelOp>(loc, ValueRange({zero}),
+      ValueRange({numTasks}), ValueRange({one}));
+  builder.setInsertionPoint(parallelOp.getBody()->getTerminator());
+  Value task = parallelOp.getInductionVars()[0];
+  for (auto it : llvm::enumerate(tasks)) {
+    Value taskId = builder.create<ConstantIndexOp>(loc, it.index());
+    Value isTask = builder.create<CmpIOp>(loc, CmpIPredicate::eq, task, taskId);
+    auto ifOp =
+        builder.create<scf::IfOp>(loc, isTask, /*withElseRegion=*/false);
+    it.value().loop->moveBefore(ifOp.thenRegion().front().getTerminator());
+  }
+}
+
+/// Return true if the loop nest is, or holds, a parallel loop.
+bool hasParallelLoop(Operation *nest) {
+  return nest
+      ->walk([](scf::ParallelOp) { return WalkResult::interrupt(); })
+      .wasInterrupted();
+}
+
+/*!
+ *  Function pass that executes the independent loop nests concurrently.
+ */
+class ParallelizeIndependentLoopsPass
+    : public PassWrapper<ParallelizeIndependentLoopsPass, FunctionPass> {
+public:
+  void runOnFunction() override {
+    SmallVector<SmallVector<Task, 4>, 4> groups;
+    SmallVector<SmallVector<Operation *, 4>, 4> groupInterleavedOps;
+    SmallVector<Task, 4> group;
+    SmallVector<Operation *, 4> interleavedOps, pendingOps;
+    auto closeGroup = [&]() {
+      if (group.size() > 1) {
+        groups.emplace_back(std::move(group));
+        groupInterleavedOps.emplace_back(std::move(interleavedOps));
+      }
+      group.clear();
+      interleavedOps.clear();
+      pendingOps.clear();
+    };
+
+    for (Block &block : getFunction().getBody()) {
+      for (Operation &op : block) {
+        if (isa<scf::ForOp, scf::ParallelOp>(op) && op.getNumResults() == 0) {
+          Task task = {&op, {}};
+          if (hasParallelLoop(&op) || !collectAccesses(&op, task.accesses)) {
+            closeGroup();
+            continue;
+          }
+          if (!llvm::all_of(group, [&](const Task &other) {
+                return areIndependent(task, other);
+              }))
+            closeGroup();
+          // The operations between two nests of the group move before it.
+          if (!group.empty())
+            interleavedOps.append(pendingOps.begin(), pendingOps.end());
+          pendingOps.clear();
+          group.emplace_back(std::move(task));
+          continue;
+        }
+        if (hasNoEffect(&op) && op.getNumRegions() == 0 && !group.empty()) {
+          pendingOps.emplace_back(&op);
+          continue;
+        }
+        closeGroup();
+      }
+      closeGroup();
+    }
+
+    for (unsigned i = 0; i < groups.size(); ++i)
+      parallelizeTasks(groups[i], groupInterleavedOps[i]);
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createParallelizeIndependentLoopsPass() {
+  return std::make_unique<ParallelizeIndependentLoopsPass>();
+}
@@ -0,0 +1,270 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------ ShapePlanCache.cpp - Memoize the shapes computed at runtime ---===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// With dynamic input dims, every call of the model recomputes the sizes of its
+// buffers, the offsets of the buffers in the memory pools and the bounds of
+// its loops from the dims of the inputs, although most callers run the model
+// on the same shapes call after call. This pass moves these shape
+// computations, the index arithmetic of the top block of each function that
+// only depends on the dims of the arguments, into a per-thread shape-plan
+// cache keyed by the dims they use:
+//
+//   %cache = "krnl.arena"() {id = 2 : i64, threadLocal, zeroInit}
+//       : () -> memref<4xi64>
+//   %hit = cache[0] == 1 && cache[1] == %dim0 && cache[2] == %dim1
+//   %size = scf.if %hit -> (index) {
+//     scf.yield cache[3]
+//   } else {
+//     <shape computations>
+//     cache[1] = %dim0, cache[2] = %dim1, cache[3] = %size, cache[0] = 1
+//     scf.yield %size
+//   }
+//
+// The cache is a zero-initialized memory arena, empty on the first call of
+// each thread, and only holds the shapes of the last call: a call on other
+// shapes recomputes and replaces them. Functions whose shape computations are
+// not larger than the cache lookup are left unchanged.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Check that the operation is a dim of an argument of the function at a
+/// constant index, i.e. a key of the cache.
+bool isInputDim(Operation *op) {
+  Value memRef, index;
+  if (auto dimOp = dyn_cast<memref::DimOp>(op)) {
+    memRef = dimOp.memrefOrTensor();
+    index = dimOp.index();
+  } else if (auto dimOp = dyn_cast<KrnlDimOp>(op)) {
+    memRef = dimOp.alloc();
+    index = dimOp.index();
+  } else {
+    return false;
+  }
+  return memRef.isa<BlockArgument>() && index.getDefiningOp<ConstantOp>();
+}
+
+/// Check that the operation is some integer arithmetic of a shape computation.
+bool isShapeComputation(Operation *op) {
+  if (!isa<AddIOp, SubIOp, MulIOp, SignedDivIOp, SignedFloorDivIOp,
+          SignedCeilDivIOp, SignedRemIOp, UnsignedDivIOp, UnsignedRemIOp,
+          IndexCastOp, SelectOp, CmpIOp, AndOp, OrOp, AffineApplyOp,
+          AffineMinOp, AffineMaxOp>(op))
+    return false;
+  return llvm::all_of(op->getResultTypes(),
+      [](Type type) { return type.isIndex() || type.isSignlessInteger(); });
+}
+
+/// Check that the value can be kept in the cache, as an i64.
+bool isCacheable(Type type) {
+  return type.isIndex() || type.isSignlessInteger(64);
+}
+
+/// Move the shape computations of the function into a cache held by the
+/// memory arena of the given identifier. Return whether the function has been
+/// changed.
+bool cacheShapePlan(FuncOp function, int64_t id, int64_t minOps) {
+  Block &block = function.getBody().front();
+
+  // The shape computations are the operations of the top block computed from
+  // the keys and constants only.
+  llvm::SmallPtrSet<Operation *, 16> roots;
+  SmallVector<Operation *, 32> candidates;
+  for (Operation &op : block) {
+    if (isa<ConstantOp>(&op) || isInputDim(&op))
+      roots.insert(&op);
+    else if (isShapeComputation(&op))
+      candidates.emplace_back(&op);
+  }
+  llvm::SmallPtrSet<Operation *, 32> inPlan(
+      candidates.begin(), candidates.end());
+  auto isComputed = [&](Value value) {
+    Operation *defOp = value.getDefiningOp();
+    return defOp && (roots.count(defOp) || inPlan.count(defOp));
+  };
+  auto isUsedOutside = [&](Value value) {
+    return llvm::any_of(value.getUsers(),
+        [&](Operation *user) { return !inPlan.count(user); });
+  };
+  // Dropping a computation whose result cannot be cached makes the results of
+  // its operands used outside, iterate until no computation is dropped.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (Operation *op : candidates) {
+      if (!inPlan.count(op))
+        continue;
+      bool keep =
+          llvm::all_of(op->getOperands(), isComputed) &&
+          llvm::all_of(op->getResults(), [&](Value result) {
+            return isCacheable(result.getType()) || !isUsedOutside(result);
+          });
+      if (!keep) {
+        inPlan.erase(op);
+        changed = true;
+      }
+    }
+  }
+
+  SmallVector<Operation *, 32> plan;
+  SmallVector<Value, 8> outputs;
+  for (Operation *op : candidates) {
+    if (!inPlan.count(op))
+      continue;
+    plan.emplace_back(op);
+    for (Value result : op->getResults())
+      if (isUsedOutside(result))
+        outputs.emplace_back(result);
+  }
+  SmallVector<Value, 4> keys;
+  for (Operation &op : block)
+    if (isInputDim(&op) && llvm::any_of(op.getUsers(), [&](Operation *user) {
+          return inPlan.count(user);
+        }))
+      keys.emplace_back(op.getResult(0));
+  if (keys.empty() || outputs.empty() || (int64_t)plan.size() < minOps ||
+      plan.size() <= keys.size() + outputs.size())
+    return false;
+
+  // The cache lookup goes before the first shape computation, the keys and
+  // constants defined after it are moved above it.
+  Operation *first = plan.front();
+  SmallVector<Operation *, 8> hoisted;
+  llvm::SmallPtrSet<Operation *, 8> isHoisted;
+  for (Operation *op = block.back().getPrevNode(); op && op != first;
+       op = op->getPrevNode())
+    if (roots.count(op) &&
+        llvm::any_of(op->getUsers(), [&](Operation *user) {
+          return inPlan.count(user) || isHoisted.count(user);
+        })) {
+      hoisted.emplace_back(op);
+      isHoisted.insert(op);
+    }
+  for (Operation *op : llvm::reverse(hoisted))
+    op->moveBefore(first);
+
+  Location loc = first->getLoc();
+  OpBuilder builder(first);
+  Type i64Type = builder.getI64Type();
+  int64_t numKeys = keys.size();
+  auto cacheType =
+      MemRefType::get({1 + numKeys + (int64_t)outputs.size()}, i64Type);
+  Value cache = builder.create<KrnlArenaOp>(loc, cacheType, Value(),
+      builder.getI64IntegerAttr(id), /*threadLocal=*/builder.getUnitAttr(),
+      /*alignment=*/nullptr, /*zeroInit=*/builder.getUnitAttr());
+  auto getPos = [&](int64_t pos) -> Value {
+    return builder.create<ConstantIndexOp>(loc, pos);
+  };
+  auto load = [&](int64_t pos) -> Value {
+    return builder.create<KrnlLoadOp>(loc, cache, ValueRange({getPos(pos)}));
+  };
+  auto store = [&](Value value, int64_t pos) {
+    if (value.getType().isIndex())
+      value = builder.create<IndexCastOp>(loc, value, i64Type);
+    builder.create<KrnlStoreOp>(loc, value, cache, ValueRange({getPos(pos)}));
+  };
+
+  // The cache is valid when its first element is 1, and holds the shapes of
+  // the last call when the keys are the same.
+  Value one = builder.create<ConstantIntOp>(loc, 1, 64);
+  Value hit = builder.create<CmpIOp>(loc, CmpIPredicate::eq, load(0), one);
+  for (int64_t i = 0; i < numKeys; ++i) {
+    Value key = builder.create<IndexCastOp>(loc, keys[i], i64Type);
+    Value sameKey =
+        builder.create<CmpIOp>(loc, CmpIPredicate::eq, load(1 + i), key);
+    hit = builder.create<AndOp>(loc, hit, sameKey);
+  }
+  SmallVector<Type, 8> outputTypes;
+  for (Value output : outputs)
+    outputTypes.emplace_back(output.getType());
+  auto ifOp = builder.create<scf::IfOp>(
+      loc, outputTypes, hit, /*withElseRegion=*/true);
+
+  // Replace the uses of the outputs outside the shape computations.
+  for (auto output : llvm::enumerate(outputs))
+    for (OpOperand &use : llvm::make_early_inc_range(output.value().getUses()))
+      if (!inPlan.count(use.getOwner()))
+        use.set(ifOp.getResult(output.index()));
+
+  // Hit: read the outputs from the cache.
+  builder.setInsertionPointToStart(&ifOp.thenRegion().front());
+  SmallVector<Value, 8> cachedOutputs;
+  for (auto output : llvm::enumerate(outputs)) {
+    Value value = load(1 + numKeys + output.index());
+    if (output.value().getType().isIndex())
+      value = builder.create<IndexCastOp>(loc, value, builder.getIndexType());
+    cachedOutputs.emplace_back(value);
+  }
+  builder.create<scf::YieldOp>(loc, cachedOutputs);
+
+  // Miss: compute the outputs and record them with their keys.
+  Block *elseBlock = &ifOp.elseRegion().front();
+  for (Operation *op : plan)
+    op->moveBefore(elseBlock, elseBlock->end());
+  builder.setInsertionPointToEnd(elseBlock);
+  for (int64_t i = 0; i < numKeys; ++i)
+    store(keys[i], 1 + i);
+  for (auto output : llvm::enumerate(outputs))
+    store(output.value(), 1 + numKeys + output.index());
+  store(builder.create<ConstantIntOp>(loc, 1, 64), 0);
+  builder.create<scf::YieldOp>(loc, outputs);
+  return true;
+}
+
+/*!
+ *  Module pass that caches the shape computations of each function. The
+ *  caches take the arena identifiers following those of the memory pools.
+ */
+class KrnlShapePlanCachePass
+    : public PassWrapper<KrnlShapePlanCachePass, OperationPass<ModuleOp>> {
+public:
+  KrnlShapePlanCachePass() = default;
+  KrnlShapePlanCachePass(const KrnlShapePlanCachePass &pass) {}
+  KrnlShapePlanCachePass(int64_t minOps) { this->minOps = minOps; }
+
+  Option<int64_t> minOps{*this, "min-ops",
+      llvm::cl::desc("Minimum number of operations of the shape computations "
+                     "of a function to cache them."),
+      llvm::cl::init(8)};
+
+  void runOnOperation() override {
+    ModuleOp module = getOperation();
+    int64_t id = 0;
+    module.walk([&](KrnlArenaOp arenaOp) {
+      id = std::max(id, (int64_t)arenaOp.id() + 1);
+    });
+
+    module.walk([&](FuncOp function) {
+      if (function.isExternal() || !function.getBody().hasOneBlock())
+        return;
+      if (cacheShapePlan(function, id, minOps))
+        ++id;
+    });
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createKrnlShapePlanCachePass(int64_t minOps) {
+  return std::make_unique<KrnlShapePlanCachePass>(minOps);
+}
@@ -0,0 +1,156 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===--- SpecializeInputAlignment.cpp - Entry points for aligned inputs ---===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// The buffers allocated by the model are aligned, but the data of its inputs
+// come from the caller and the lowering cannot assume anything about their
+// alignment. This pass clones the entry point function, and each of its
+// shape specializations, into a version starting with memref.assume_alignment
+// on all its inputs, so that LLVM can use aligned vector memory accesses on
+// them. The clones are recorded in the specializations of the entry point
+// with the alignment, and the runtime entry point calls the aligned version
+// when the data of all the inputs are aligned. OMTensors created by
+// omTensorCreateEmptyAligned take this fast path.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ *  Module pass that clones the entry point functions for aligned inputs.
+ */
+struct SpecializeInputAlignmentPass
+    : public PassWrapper<SpecializeInputAlignmentPass,
+          OperationPass<ModuleOp>> {
+  SpecializeInputAlignmentPass() = default;
+  SpecializeInputAlignmentPass(const SpecializeInputAlignmentPass &pass) {}
+  SpecializeInputAlignmentPass(int64_t alignment) {
+    this->alignment = alignment;
+  }
+
+  Option<int64_t> alignment{*this, "alignment",
+      llvm::cl::desc("Alignment in bytes of the data of the inputs."),
+      llvm::cl::init(64)};
+
+  void runOnOperation() final {
+    ModuleOp module = getOperation();
+    if (alignment <= 0 || !llvm::isPowerOf2_64(alignment)) {
+      module.emitError("input alignment must be a power of two");
+      signalPassFailure();
+      return;
+    }
+
+    SmallVector<KrnlEntryPointOp, 1> entryPointOps;
+    module.walk([&](KrnlEntryPointOp op) { entryPointOps.emplace_back(op); });
+    for (KrnlEntryPointOp entryPointOp : entryPointOps)
+      if (failed(specialize(module, entryPointOp))) {
+        signalPassFailure();
+        return;
+      }
+  }
+
+  /// Clone the function into a version assuming that the data of its inputs
+  /// are aligned, and return the name of the clone, or an empty name if
+  /// there is no such function.
+  std::string cloneAligned(ModuleOp module, StringRef funcName) {
+    FuncOp func = module.lookupSymbol<FuncOp>(funcName);
+    if (!func || func.isExternal())
+      return "";
+    FuncOp alignedFunc = func.clone();
+    std::string alignedName = (funcName + "_aligned").str();
+    alignedFunc.setName(alignedName);
+    module.insert(Block::iterator(func.getOperation()), alignedFunc);
+
+    Block &entryBlock = alignedFunc.getBody().front();
+    OpBuilder builder(&entryBlock, entryBlock.begin());
+    for (BlockArgument arg : entryBlock.getArguments())
+      if (arg.getType().isa<MemRefType>())
+        builder.create<memref::AssumeAlignmentOp>(
+            alignedFunc.getLoc(), arg, static_cast<uint32_t>(alignment));
+    return alignedName;
+  }
+
+  LogicalResult specialize(ModuleOp module, KrnlEntryPointOp entryPointOp) {
+    Builder builder(&getContext());
+    StringRef funcName =
+        entryPointOp
+            ->getAttrOfType<SymbolRefAttr>(
+                KrnlEntryPointOp::getEntryPointFuncAttrName())
+            .getLeafReference();
+    FuncOp func = module.lookupSymbol<FuncOp>(funcName);
+    if (!func)
+      return entryPointOp.emitError("entry point function not found");
+
+    auto getAlignedSpecialization = [&](StringRef specializedName,
+                                        ArrayAttr shapes) -> Attribute {
+      std::string alignedName = cloneAligned(module, specializedName);
+      if (alignedName.empty())
+        return nullptr;
+      return builder.getDictionaryAttr(
+          {builder.getNamedAttr("func", builder.getSymbolRefAttr(alignedName)),
+              builder.getNamedAttr("shapes", shapes),
+              builder.getNamedAttr(
+                  "alignment", builder.getI64IntegerAttr(alignment))});
+    };
+
+    // Each shape specialization is preceded by its aligned version.
+    SmallVector<Attribute, 4> specializationAttrs;
+    if (auto specializations = entryPointOp->getAttrOfType<ArrayAttr>(
+            KrnlEntryPointOp::getSpecializationsAttrName()))
+      for (Attribute attr : specializations) {
+        auto specialization = attr.cast<DictionaryAttr>();
+        Attribute aligned = getAlignedSpecialization(
+            specialization.get("func").cast<FlatSymbolRefAttr>().getValue(),
+            specialization.get("shapes").cast<ArrayAttr>());
+        if (!aligned)
+          return entryPointOp.emitError("specialized function not found");
+        specializationAttrs.emplace_back(aligned);
+        specializationAttrs.emplace_back(attr);
+      }
+
+    // The aligned version of the function itself comes last, with the shapes
+    // of its inputs.
+    SmallVector<Attribute, 4> shapeAttrs;
+    for (Type argType : func.getType().getInputs()) {
+      MemRefType memRefType = argType.dyn_cast<MemRefType>();
+      if (!memRefType)
+        return func.emitError("entry point inputs must be memrefs");
+      shapeAttrs.emplace_back(builder.getI64ArrayAttr(memRefType.getShape()));
+    }
+    Attribute aligned =
+        getAlignedSpecialization(funcName, builder.getArrayAttr(shapeAttrs));
+    if (!aligned)
+      return entryPointOp.emitError("entry point function not found");
+    specializationAttrs.emplace_back(aligned);
+
+    entryPointOp->setAttr(KrnlEntryPointOp::getSpecializationsAttrName(),
+        builder.getArrayAttr(specializationAttrs));
+    return success();
+  }
+};
+} // namespace
+
+/*!
+ * Create a pass that specializes the entry point functions for aligned
+ * inputs.
+ */
+std::unique_ptr<mlir::Pass> mlir::createSpecializeInputAlignmentPass(
+    int64_t alignment) {
+  return std::make_unique<SpecializeInputAlignmentPass>(alignment);
+}
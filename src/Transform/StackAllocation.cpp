@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- StackAllocation.cpp - Allocate Small MemRefs on the Stack ----===//
+//
+// Copyright 2019-2021 The IBM Research Authors.
+//
+// =============================================================================
+//
+// The lowering allocates the buffers of the tensors on the heap, to be pooled
+// by the EnableMemoryPool pass. The small buffers, e.g. the scalars and rows of
+// the reductions or the gates of an RNN step, cost more in heap or pool
+// bookkeeping than in memory. This pass allocates the temporary buffers of
+// static shape up to a number of bytes on the stack, with memref.alloca, which
+// the memory pool passes leave alone. The buffers of the top block of a
+// function that are freed in the function are the temporaries, and the total
+// of their bytes moved to the stack is bounded, so that a large function does
+// not overflow the stack of its calling thread.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Pass/Passes.hpp"
+#include "src/Support/KrnlSupport.hpp"
+
+using namespace mlir;
+
+namespace {
+
+// Maximum total bytes of the buffers of a function allocated on the stack.
+static const int64_t stackAllocationMaxTotalBytes = 64 * 1024;
+
+// Return true if the alloc is a temporary buffer: it is freed in its block and
+// neither it nor one of its views is returned.
+bool isTemporaryAlloc(memref::AllocOp allocOp) {
+  SmallVector<Value, 4> aliases = {allocOp.getResult()};
+  bool isFreed = false;
+  for (unsigned i = 0; i < aliases.size(); ++i)
+    for (Operation *user : aliases[i].getUsers()) {
+      if (isa<ReturnOp>(user))
+        return false;
+      if (isa<memref::DeallocOp>(user)) {
+        // Only the alloc itself is freed.
+        if (i > 0)
+          return false;
+        isFreed = true;
+      } else if (isa<memref::ViewOp, memref::SubViewOp,
+                     memref::ReinterpretCastOp>(user)) {
+        aliases.emplace_back(user->getResult(0));
+      }
+    }
+  return isFreed;
+}
+
+/*!
+ *  Function pass that allocates the small temporary MemRefs on the stack.
+ */
+class KrnlStackAllocationPass
+    : public PassWrapper<KrnlStackAllocationPass, FunctionPass> {
+public:
+  KrnlStackAllocationPass() = default;
+  KrnlStackAllocationPass(const KrnlStackAllocationPass &pass) {}
+  KrnlStackAllocationPass(int64_t maxBytes) { this->maxBytes = maxBytes; }
+
+  Option<int64_t> maxBytes{*this, "max-bytes",
+      llvm::cl::desc("Maximum bytes of a MemRef allocated on the stack."),
+      llvm::cl::init(1024)};
+
+  void runOnFunction() override {
+    FuncOp function = getFunction();
+    if (function.isExternal())
+      return;
+
+    // Only the allocs of the top block are released at the end of the call,
+    // an alloca in a loop body would grow the stack at each iteration.
+    SmallVector<memref::AllocOp, 8> allocs;
+    int64_t totalBytes = 0;
+    for (auto allocOp : function.getBody().front().getOps<memref::AllocOp>()) {
+      auto memRefType = allocOp.getResult().getType().cast<MemRefType>();
+      if (!hasAllConstantDimensions(memRefType) ||
+          !memRefType.getAffineMaps().empty() ||
+          memRefType.getElementType().isIndex())
+        continue;
+      int64_t bytes = getMemRefSizeInBytes(allocOp.getResult());
+      if (bytes > maxBytes ||
+          totalBytes + bytes > stackAllocationMaxTotalBytes ||
+          !isTemporaryAlloc(allocOp))
+        continue;
+      totalBytes += bytes;
+      allocs.emplace_back(allocOp);
+    }
+
+    for (auto allocOp : allocs) {
+      OpBuilder builder(allocOp);
+      Value alloca = builder.create<memref::AllocaOp>(allocOp.getLoc(),
+          allocOp.getResult().getType().cast<MemRefType>(),
+          allocOp.alignmentAttr());
+      SmallVector<Operation *, 1> deallocs;
+      for (Operation *user : allocOp.getResult().getUsers())
+        if (isa<memref::DeallocOp>(user))
+          deallocs.emplace_back(user);
+      for (Operation *dealloc : deallocs)
+        dealloc->erase();
+      allocOp.getResult().replaceAllUsesWith(alloca);
+      allocOp.erase();
+    }
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createKrnlStackAllocationPass(int64_t maxBytes) {
+  return std::make_unique<KrnlStackAllocationPass>(maxBytes);
+}
@@ -0,0 +1,324 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===-- StrengthReduceMemRefAccesses.cpp - Increment the access offsets ---===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This pass strength-reduces the address computations of the innermost loops
+// once the affine loops are lowered to SCF loops. Each load and store of these
+// loops otherwise recomputes the linearized offset of its indices, a sum of
+// products by the strides of its MemRef, which LLVM does not always recover
+// from, in particular for the scalar lowerings such as Pool, Pad or Tile.
+//
+// The accesses to MemRefs with static shapes and strides, whose indices are
+// affine functions of the induction variable, are rewritten as accesses to a
+// flat 1-D view of their MemRef. Their offset in this view is computed once
+// before the loop and carried by the loop, incremented by a constant at each
+// iteration, which becomes a pointer increment in LLVM.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Return the coefficient of the induction variable iv of the loop in the
+/// index, when the index is an affine function of iv built from additions,
+/// subtractions and multiplications by constants.
+Optional<int64_t> getIVCoefficient(Value index, scf::ForOp loop) {
+  if (index == loop.getInductionVar())
+    return 1;
+  if (!loop.getLoopBody().isAncestor(index.getParentRegion()))
+    return 0;
+  Operation *defOp = index.getDefiningOp();
+  if (!defOp)
+    return None;
+  if (isa<ConstantIndexOp>(defOp))
+    return 0;
+  if (!isa<AddIOp, SubIOp, MulIOp>(defOp))
+    return None;
+  Optional<int64_t> lhs = getIVCoefficient(defOp->getOperand(0), loop);
+  Optional<int64_t> rhs = getIVCoefficient(defOp->getOperand(1), loop);
+  if (!lhs || !rhs)
+    return None;
+  if (isa<AddIOp>(defOp))
+    return *lhs + *rhs;
+  if (isa<SubIOp>(defOp))
+    return *lhs - *rhs;
+  // A product is affine when one of its operands is a constant.
+  auto lhsCst = defOp->getOperand(0).getDefiningOp<ConstantIndexOp>();
+  auto rhsCst = defOp->getOperand(1).getDefiningOp<ConstantIndexOp>();
+  if (rhsCst)
+    return *lhs * rhsCst.getValue();
+  if (lhsCst)
+    return *rhs * lhsCst.getValue();
+  if (*lhs == 0 && *rhs == 0)
+    return 0;
+  return None;
+}
+
+/// Clone the computation of the index before the loop, for the first
+/// iteration of the loop.
+Value cloneForFirstIteration(Value index, scf::ForOp loop, OpBuilder &builder,
+    BlockAndValueMapping &map) {
+  if (Value mapped = map.lookupOrNull(index))
+    return mapped;
+  if (!loop.getLoopBody().isAncestor(index.getParentRegion()))
+    return index;
+  Operation *defOp = index.getDefiningOp();
+  for (Value operand : defOp->getOperands())
+    cloneForFirstIteration(operand, loop, builder, map);
+  return builder.clone(*defOp, map)->getResult(0);
+}
+
+/// Accesses at the same offset of the same MemRef, whose offset is carried by
+/// the loop.
+struct OffsetGroup {
+  Value memRef;
+  SmallVector<Value, 4> indices;
+  int64_t increment;
+  SmallVector<Operation *, 2> accesses;
+};
+
+/// Return the indices of the load or store.
+ValueRange getAccessIndices(Operation *op) {
+  if (auto loadOp = dyn_cast<memref::LoadOp>(op))
+    return loadOp.indices();
+  return cast<memref::StoreOp>(op).indices();
+}
+
+/// Return the MemRef of the load or store.
+Value getAccessMemRef(Operation *op) {
+  if (auto loadOp = dyn_cast<memref::LoadOp>(op))
+    return loadOp.memref();
+  return cast<memref::StoreOp>(op).memref();
+}
+
+/// Get the strides of the MemRef, and the span of its elements, when its
+/// shape, strides and offset are static.
+bool getStaticStrides(MemRefType type, SmallVectorImpl<int64_t> &strides,
+    int64_t &offset, int64_t &span) {
+  if (!type.hasStaticShape() || type.getRank() == 0 ||
+      failed(getStridesAndOffset(type, strides, offset)) ||
+      ShapedType::isDynamicStrideOrOffset(offset) ||
+      llvm::any_of(strides, ShapedType::isDynamicStrideOrOffset))
+    return false;
+  span = 1;
+  for (unsigned i = 0; i < strides.size(); ++i) {
+    if (type.getDimSize(i) == 0 || strides[i] < 0)
+      return false;
+    span += (type.getDimSize(i) - 1) * strides[i];
+  }
+  return true;
+}
+
+/// Collect the groups of strength-reducible accesses of the loop body.
+void collectOffsetGroups(
+    scf::ForOp loop, int64_t step, SmallVectorImpl<OffsetGroup> &groups) {
+  for (Operation &op : loop.getBody()->without_terminator()) {
+    if (!isa<memref::LoadOp, memref::StoreOp>(op))
+      continue;
+    Value memRef = getAccessMemRef(&op);
+    if (loop.getLoopBody().isAncestor(memRef.getParentRegion()))
+      continue;
+    SmallVector<int64_t, 4> strides;
+    int64_t offset, span;
+    if (!getStaticStrides(
+            memRef.getType().cast<MemRefType>(), strides, offset, span))
+      continue;
+    ValueRange indices = getAccessIndices(&op);
+    // A 1-D access at the induction variable is already an increment.
+    if (indices.size() == 1 && indices[0] == loop.getInductionVar() &&
+        strides[0] == 1)
+      continue;
+    int64_t coefficient = 0;
+    bool isAffine = true;
+    for (unsigned i = 0; i < indices.size() && isAffine; ++i) {
+      Optional<int64_t> indexCoefficient = getIVCoefficient(indices[i], loop);
+      isAffine = indexCoefficient.hasValue();
+      if (isAffine)
+        coefficient += *indexCoefficient * strides[i];
+    }
+    // The loop invariant accesses are left to the invariant code motion.
+    if (!isAffine || coefficient == 0)
+      continue;
+    auto group = llvm::find_if(groups, [&](OffsetGroup &group) {
+      return group.memRef == memRef && llvm::equal(group.indices, indices);
+    });
+    if (group != groups.end()) {
+      group->accesses.emplace_back(&op);
+      continue;
+    }
+    OffsetGroup newGroup;
+    newGroup.memRef = memRef;
+    newGroup.indices.assign(indices.begin(), indices.end());
+    newGroup.increment = coefficient * step;
+    newGroup.accesses.emplace_back(&op);
+    groups.emplace_back(newGroup);
+  }
+}
+
+/// Return a flat 1-D view of the elements of the MemRef.
+Value createFlatView(OpBuilder &builder, Location loc, Value memRef) {
+  MemRefType type = memRef.getType().cast<MemRefType>();
+  SmallVector<int64_t, 4> strides;
+  int64_t offset, span;
+  getStaticStrides(type, strides, offset, span);
+  SmallVector<AffineMap, 1> layout;
+  if (offset != 0)
+    layout.emplace_back(
+        makeStridedLinearLayoutMap({1}, offset, builder.getContext()));
+  MemRefType flatType = MemRefType::get(
+      {span}, type.getElementType(), layout, type.getMemorySpace());
+  return builder.create<memref::ReinterpretCastOp>(loc, flatType, memRef,
+      offset, ArrayRef<int64_t>{span}, ArrayRef<int64_t>{1});
+}
+
+/// Rebuild the loop with the additional loop-carried values, and return it.
+scf::ForOp addIterArgs(scf::ForOp loop, ValueRange inits) {
+  OpBuilder builder(loop);
+  SmallVector<Value, 4> iterOperands(
+      loop.getIterOperands().begin(), loop.getIterOperands().end());
+  iterOperands.append(inits.begin(), inits.end());
+  auto newLoop = builder.create<scf::ForOp>(loop.getLoc(), loop.lowerBound(),
+      loop.upperBound(), loop.step(), iterOperands);
+  Block *body = loop.getBody();
+  Block *newBody = newLoop.getBody();
+  newBody->getOperations().splice(newBody->end(), body->getOperations());
+  for (auto arg : llvm::zip(body->getArguments(), newBody->getArguments()))
+    std::get<0>(arg).replaceAllUsesWith(std::get<1>(arg));
+  for (auto result : llvm::zip(loop.getResults(), newLoop.getResults()))
+    std::get<0>(result).replaceAllUsesWith(std::get<1>(result));
+  loop.erase();
+  return newLoop;
+}
+
+/// Strength-reduce the address computations of the innermost loop.
+void strengthReduceLoop(scf::ForOp loop) {
+  auto stepOp = loop.step().getDefiningOp<ConstantIndexOp>();
+  if (!stepOp)
+    return;
+  SmallVector<OffsetGroup, 4> groups;
+  collectOffsetGroups(loop, stepOp.getValue(), groups);
+  if (groups.empty())
+    return;
+
+  // Compute the flat views and the offsets of the first iteration before the
+  // loop.
+  Location loc = loop.getLoc();
+  OpBuilder builder(loop);
+  BlockAndValueMapping map;
+  map.map(loop.getInductionVar(), loop.lowerBound());
+  llvm::DenseMap<Value, Value> flatViews;
+  llvm::DenseMap<int64_t, Value> constants;
+  auto getConstant = [&](int64_t value) {
+    Value &constant = constants[value];
+    if (!constant)
+      constant = builder.create<ConstantIndexOp>(loc, value);
+    return constant;
+  };
+  SmallVector<Value, 4> inits, increments;
+  for (OffsetGroup &group : groups) {
+    if (!flatViews.count(group.memRef))
+      flatViews[group.memRef] = createFlatView(builder, loc, group.memRef);
+    SmallVector<int64_t, 4> strides;
+    int64_t offset, span;
+    getStaticStrides(
+        group.memRef.getType().cast<MemRefType>(), strides, offset, span);
+    Value init;
+    for (unsigned i = 0; i < group.indices.size(); ++i) {
+      if (strides[i] == 0)
+        continue;
+      Value index =
+          cloneForFirstIteration(group.indices[i], loop, builder, map);
+      if (strides[i] != 1)
+        index = builder.create<MulIOp>(loc, index, getConstant(strides[i]));
+      if (init)
+        index = builder.create<AddIOp>(loc, init, index);
+      init = index;
+    }
+    inits.emplace_back(init ? init : getConstant(0));
+    increments.emplace_back(getConstant(group.increment));
+  }
+
+  // Access the flat views at the offsets carried by the loop, incremented
+  // at the end of each iteration.
+  unsigned numIterArgs = loop.getNumIterOperands();
+  scf::ForOp newLoop = addIterArgs(loop, inits);
+  Block *body = newLoop.getBody();
+  auto yieldOp = cast<scf::YieldOp>(body->getTerminator());
+  builder.setInsertionPoint(yieldOp);
+  SmallVector<Value, 4> yieldOperands(
+      yieldOp.getOperands().begin(), yieldOp.getOperands().end());
+  for (unsigned g = 0; g < groups.size(); ++g) {
+    Value offset = newLoop.getRegionIterArgs()[numIterArgs + g];
+    Value flatView = flatViews[groups[g].memRef];
+    for (Operation *op : groups[g].accesses) {
+      OpBuilder accessBuilder(op);
+      if (auto loadOp = dyn_cast<memref::LoadOp>(op)) {
+        Value value = accessBuilder.create<memref::LoadOp>(
+            op->getLoc(), flatView, offset);
+        loadOp.getResult().replaceAllUsesWith(value);
+      } else {
+        accessBuilder.create<memref::StoreOp>(op->getLoc(),
+            cast<memref::StoreOp>(op).value(), flatView, offset);
+      }
+      op->erase();
+    }
+    yieldOperands.emplace_back(
+        builder.create<AddIOp>(loc, offset, increments[g]));
+  }
+  builder.create<scf::YieldOp>(yieldOp.getLoc(), yieldOperands);
+  yieldOp.erase();
+
+  // Remove the index computations that are no longer used.
+  SmallVector<Operation *, 16> bodyOps;
+  for (Operation &op : body->without_terminator())
+    bodyOps.emplace_back(&op);
+  for (Operation *op : llvm::reverse(bodyOps))
+    if (isOpTriviallyDead(op))
+      op->erase();
+}
+
+/*!
+ *  Function pass that strength-reduces the address computations of the
+ *  innermost loops.
+ */
+class StrengthReduceMemRefAccessesPass
+    : public PassWrapper<StrengthReduceMemRefAccessesPass, FunctionPass> {
+public:
+  void runOnFunction() override {
+    SmallVector<scf::ForOp, 8> innermostLoops;
+    getFunction().walk([&](scf::ForOp loop) {
+      bool hasInnerLoop = false;
+      loop.getBody()->walk([&](LoopLikeOpInterface) { hasInnerLoop = true; });
+      if (!hasInnerLoop)
+        innermostLoops.emplace_back(loop);
+    });
+    for (scf::ForOp loop : innermostLoops)
+      strengthReduceLoop(loop);
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createStrengthReduceMemRefAccessesPass() {
+  return std::make_unique<StrengthReduceMemRefAccessesPass>();
+}
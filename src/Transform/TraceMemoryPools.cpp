@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------ TraceMemoryPools.cpp - Trace the memory pools at runtime ------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This pass surrounds the allocations and deallocations of the memory pools
+// bundled by the BundleMemoryPools pass, and the buffers of the memory arenas
+// replacing them, with the instrumentation points of the runtime profiler.
+// Each allocation is then recorded as a `MemoryPool` operation, and each
+// deallocation as a `MemoryPoolFree` one, with its duration and its size in
+// bytes, the actual one for the dynamic pools. The node name of the records
+// tells the kind of the pool: `static`, `dynamic`, `static arena` or
+// `dynamic arena`. See omInstrumentGetMemoryPoolStats in OMInstrument.h.
+//
+// The pass runs after the memory pools are compacted and moved into arenas,
+// on the pools that are actually allocated.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+
+#include "src/Dialect/Krnl/KrnlOps.hpp"
+#include "src/Pass/Passes.hpp"
+#include "src/Support/KrnlSupport.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/// Check that the value is a memory pool, i.e. a static or dynamic 1-D
+/// MemRef of bytes used by krnl.getref operations.
+bool isMemPool(Value value) {
+  auto memRefType = value.getType().dyn_cast<MemRefType>();
+  if (!memRefType || memRefType.getRank() != 1 ||
+      getMemRefEltSizeInBytes(memRefType) != 1)
+    return false;
+  return llvm::any_of(value.getUsers(),
+      [](Operation *user) { return isa<KrnlGetRefOp>(user); });
+}
+
+/// Surround the operation with instrumentation points, the second one
+/// reporting the size of the pool.
+void instrument(Operation *op, Value pool, StringRef opName, bool isArena) {
+  OpBuilder builder(op);
+  bool isStatic = pool.getType().cast<MemRefType>().hasStaticShape();
+  std::string nodeName = isStatic ? "static" : "dynamic";
+  if (isArena)
+    nodeName += " arena";
+  StringAttr opNameAttr = builder.getStringAttr(opName);
+  StringAttr nodeNameAttr = builder.getStringAttr(nodeName);
+  builder.create<KrnlInstrumentOp>(op->getLoc(), ValueRange(), opNameAttr,
+      nodeNameAttr, builder.getI64IntegerAttr(0));
+  builder.setInsertionPointAfter(op);
+  builder.create<KrnlInstrumentOp>(op->getLoc(), pool, opNameAttr,
+      nodeNameAttr, builder.getI64IntegerAttr(1));
+}
+
+/*!
+ *  Function pass that traces the memory pools.
+ */
+class KrnlTraceMemoryPoolsPass
+    : public PassWrapper<KrnlTraceMemoryPoolsPass, FunctionPass> {
+public:
+  void runOnFunction() override {
+    auto function = getFunction();
+
+    SmallVector<Operation *, 8> allocs, deallocs;
+    function.walk([&](Operation *op) {
+      if (isa<memref::AllocOp, KrnlArenaOp>(op) && isMemPool(op->getResult(0)))
+        allocs.emplace_back(op);
+      else if (auto deallocOp = dyn_cast<memref::DeallocOp>(op))
+        if (isMemPool(deallocOp.memref()))
+          deallocs.emplace_back(op);
+    });
+
+    for (Operation *op : allocs)
+      instrument(op, op->getResult(0), "MemoryPool", isa<KrnlArenaOp>(op));
+    for (Operation *op : deallocs)
+      instrument(op, cast<memref::DeallocOp>(op).memref(), "MemoryPoolFree",
+          /*isArena=*/false);
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createKrnlTraceMemoryPoolsPass() {
+  return std::make_unique<KrnlTraceMemoryPoolsPass>();
+}
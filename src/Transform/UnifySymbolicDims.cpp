@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------- UnifySymbolicDims.cpp - Share Dims of Same Symbolic Name -----===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// The dynamic dimensions of the model inputs are all unknown (-1) in the
+// types, so the lowering queries each of them separately and the buffers
+// computed from different inputs get unrelated sizes. The frontend records
+// the symbolic names of the dynamic input dimensions, e.g. "batch" or
+// "seq_len", in the input_dim_params attribute of the function. This pass
+// replaces the memref.dim operations on the dimensions of the inputs that
+// have the same name by a single memref.dim at the start of the function.
+// The allocations and the loop bounds computed from these dimensions then
+// share the same values, which lets loop fusion and the memory pools treat
+// them as the same size.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/StringMap.h"
+
+#include "src/Pass/Passes.hpp"
+
+using namespace mlir;
+
+namespace {
+
+/*!
+ *  Function pass that shares the dims of the inputs with the same symbolic
+ *  name.
+ */
+class UnifySymbolicDimsPass
+    : public PassWrapper<UnifySymbolicDimsPass, FunctionPass> {
+public:
+  void runOnFunction() override {
+    FuncOp function = getFunction();
+    ArrayAttr inputDimParams =
+        function->getAttrOfType<ArrayAttr>("input_dim_params");
+    if (!inputDimParams || function.isExternal())
+      return;
+    Block &entryBlock = function.getBody().front();
+    if (inputDimParams.size() != entryBlock.getNumArguments())
+      return;
+
+    // The symbolic name of each dimension, empty if it has none.
+    auto getDimParam = [&](Value memref, int64_t index) -> StringRef {
+      BlockArgument arg = memref.dyn_cast<BlockArgument>();
+      if (!arg || arg.getOwner() != &entryBlock)
+        return "";
+      ArrayAttr dimParams =
+          inputDimParams[arg.getArgNumber()].dyn_cast<ArrayAttr>();
+      if (!dimParams || index < 0 || index >= (int64_t)dimParams.size())
+        return "";
+      return dimParams[index].cast<StringAttr>().getValue();
+    };
+
+    // The first dimension of the inputs with a given name defines its size.
+    OpBuilder builder(&entryBlock, entryBlock.begin());
+    llvm::StringMap<Value> symbolDims;
+    for (BlockArgument arg : entryBlock.getArguments()) {
+      MemRefType type = arg.getType().dyn_cast<MemRefType>();
+      if (!type)
+        continue;
+      for (int64_t i = 0; i < type.getRank(); ++i) {
+        StringRef name = getDimParam(arg, i);
+        if (name.empty() || type.getShape()[i] != -1 || symbolDims.count(name))
+          continue;
+        symbolDims[name] =
+            builder.create<memref::DimOp>(function.getLoc(), arg, i);
+      }
+    }
+    if (symbolDims.empty())
+      return;
+
+    SmallVector<memref::DimOp, 8> unifiedDimOps;
+    function.walk([&](memref::DimOp dimOp) {
+      Optional<int64_t> index = dimOp.getConstantIndex();
+      if (!index)
+        return;
+      StringRef name = getDimParam(dimOp.memrefOrTensor(), *index);
+      if (name.empty())
+        return;
+      auto it = symbolDims.find(name);
+      if (it == symbolDims.end() || it->second == dimOp.getResult())
+        return;
+      dimOp.getResult().replaceAllUsesWith(it->second);
+      unifiedDimOps.emplace_back(dimOp);
+    });
+    for (memref::DimOp dimOp : unifiedDimOps)
+      dimOp.erase();
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> mlir::createUnifySymbolicDimsPass() {
+  return std::make_unique<UnifySymbolicDimsPass>();
+}
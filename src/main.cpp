@@ -52,12 +52,42 @@ int main(int argc, char *argv[]) {
   llvm::cl::ParseCommandLineOptions(
       argc, argv, "ONNX MLIR modular optimizer driver\n");
 
-  mlir::OwningModuleRef module;
-  processInputFile(inputFilename, context, module);
-
   // Input file base name, replace path if required.
   if (outputBaseName == "")
     outputBaseName = inputFilename.substr(0, inputFilename.find_last_of("."));
 
-  return compileModule(module, context, outputBaseName, emissionTarget);
+  // Shared libraries are reused from the compilation cache, keyed by all the
+  // options but the input and output files.
+  string cacheKey;
+  std::vector<string> options;
+  if (emissionTarget == EmitLib) {
+    for (int i = 1; i < argc; ++i) {
+      llvm::StringRef arg(argv[i]);
+      if (arg == inputFilename)
+        continue;
+      if (arg == "-o" || arg == "--o") {
+        ++i;
+        continue;
+      }
+      if (arg.startswith("-o=") || arg.startswith("--o="))
+        continue;
+      options.emplace_back(arg.str());
+    }
+    cacheKey = getCompilationCacheKey(inputFilename, options);
+    if (loadFromCompilationCache(cacheKey, outputBaseName)) {
+      printf("Shared library %s.so has been loaded from the compilation "
+             "cache.\n",
+          outputBaseName.c_str());
+      return 0;
+    }
+  }
+
+  mlir::OwningModuleRef module;
+  processInputFile(inputFilename, context, module);
+
+  int rc =
+      compileModule(module, context, outputBaseName, emissionTarget, options);
+  if (rc == 0)
+    storeInCompilationCache(cacheKey, outputBaseName);
+  return rc;
 }
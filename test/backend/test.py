@@ -142,6 +142,9 @@ test_to_enable_static_dynamic = {
     "test_argmax_default_axis_example_cpu": (test_static_dynamic,),
 
     # Argmin
+    "test_argmin_no_keepdims_example_cpu": (test_static_dynamic,),
+    "test_argmin_keepdims_example_cpu": (test_static_dynamic,),
+    "test_argmin_default_axis_example_cpu": (test_static_dynamic,),
 
     # Asin
     "test_asin_cpu": (test_static_dynamic,),
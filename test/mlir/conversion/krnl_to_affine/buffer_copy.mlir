@@ -489,6 +489,36 @@ func @copy_to_nested_partial(%p0 : index, %p1 : index) -> () {
 // CHECK:         }
 }
 
+// -----
+
+// Prefetch the start of the rows of the next tile while copying a tile.
+func @copy_to_nested_prefetch(%p0 : index, %p1 : index) -> () {
+  %A = memref.alloca() : memref<45x60xf32>
+  %B = memref.alloca() : memref<10x60xf32>
+  %f0 = constant 0.0 : f32
+  %c0 = constant 0 : index
+
+  affine.for %i = 0 to 45 step 10 {
+      krnl.copy_to_tile_buffer %B, %A [%i, %c0], %f0 {prefetchNext = [10, 0]} : memref<10x60xf32>, memref<45x60xf32>
+  }
+  return
+
+// CHECK-LABEL:  func @copy_to_nested_prefetch
+// CHECK-DAG:       [[ORGINAL_:%.+]] = memref.alloca() : memref<45x60xf32>
+// CHECK-DAG:       [[BUFFER_:%.+]] = memref.alloca() : memref<10x60xf32>
+// CHECK:           affine.for [[I_0_:%.+]] = 0 to 45 step 10 {
+// CHECK:             affine.for [[I_1_:%.+]] = 0 to min #map([[I_0_]]) {
+// CHECK-NEXT:          affine.prefetch [[ORGINAL_]]{{.}}{{.*}} + 10, 0], read, locality<3>, data : memref<45x60xf32>
+// CHECK-NEXT:          affine.for [[I_2_:%.+]] = 0 to 60 {
+// CHECK:                 [[LOAD_ORGINAL_MEM_:%.+]] = affine.load [[ORGINAL_]]{{.*}} + {{.*}}, [[I_2_]]{{.}} : memref<45x60xf32>
+// CHECK:                 affine.store [[LOAD_ORGINAL_MEM_]], [[BUFFER_]]{{.}}[[I_1_]], [[I_2_]]{{.}} : memref<10x60xf32>
+// CHECK:               }
+// CHECK:             }
+// CHECK:           }
+// CHECK:           return
+// CHECK:         }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // COPY FROM
 
@@ -659,3 +689,87 @@ func private @copy_from_partial_runtime(%p0 : index, %p1 : index) -> () {
 // CHECK:           return
 // CHECK:         }
 }
+
+// -----
+
+/// Buffers whose rows are multiples of 8 floats are copied by vectors of 32
+/// bytes, masked against the bounds of the source.
+func private @copy_to_vector(%p0 : index, %p1 : index) -> () {
+  %AA = memref.alloca() : memref<39x56xf32>
+  %B = memref.alloca() : memref<4x16xf32>
+  %f0 = constant 0.0 : f32
+  %i36 = constant 36 : index
+  %i48 = constant 48 : index
+  krnl.copy_to_tile_buffer %B, %AA [%i36, %i48], %f0 {padToNext=[4, 16]}: memref<4x16xf32>, memref<39x56xf32>
+  return
+
+// CHECK-LABEL:  func private @copy_to_vector
+// CHECK-DAG:       [[ZERO_:%.+]] = constant 0.000000e+00 : f32
+// CHECK-DAG:       [[ORGINAL_:%.+]] = memref.alloca() : memref<39x56xf32>
+// CHECK-DAG:       [[BUFFER_:%.+]] = memref.alloca() : memref<4x16xf32>
+// CHECK:           [[VEC_BUFFER_:%.+]] = krnl.vector_type_cast [[BUFFER_]] : memref<4x16xf32> to memref<4x2xvector<8xf32>>
+// CHECK:           affine.for [[I_0_:%.+]] = 0 to 3 {
+// CHECK:             affine.for [[I_1_:%.+]] = 0 to 2 {
+// CHECK:               [[VEC_:%.+]] = vector.transfer_read [[ORGINAL_]]{{.}}{{.*}}{{.}}, [[ZERO_]] : memref<39x56xf32>, vector<8xf32>
+// CHECK:               affine.store [[VEC_]], [[VEC_BUFFER_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<4x2xvector<8xf32>>
+// CHECK:             }
+// CHECK:           }
+// CHECK:           affine.for [[I_2_:%.+]] = 3 to 4 {
+// CHECK:             affine.for [[I_3_:%.+]] = 0 to 2 {
+// CHECK:               [[PAD_:%.+]] = vector.broadcast [[ZERO_]] : f32 to vector<8xf32>
+// CHECK:               affine.store [[PAD_]], [[VEC_BUFFER_]]{{.}}[[I_2_]], [[I_3_]]{{.}} : memref<4x2xvector<8xf32>>
+// CHECK:             }
+// CHECK:           }
+// CHECK:           return
+// CHECK:         }
+}
+
+// -----
+
+/// The full tiles of the transposed copies are transposed by vector shuffles,
+/// the partial ones are copied element by element.
+func private @copy_to_vector_transposed(%p0 : index, %p1 : index) -> () {
+  %AA = memref.alloca() : memref<40x64xf32>
+  %B = memref.alloca() : memref<8x16xf32>
+  %f0 = constant 0.0 : f32
+  krnl.copy_to_tile_buffer %B, %AA [%p0, %p1], %f0 {padToNext=[1, 1], transpose=true}: memref<8x16xf32>, memref<40x64xf32>
+  return
+
+// CHECK-LABEL:  func private @copy_to_vector_transposed
+// CHECK:           affine.if
+// CHECK:             [[VEC_BUFFER_:%.+]] = krnl.vector_type_cast {{.*}} : memref<8x16xf32> to memref<8x2xvector<8xf32>>
+// CHECK:             affine.for [[I_0_:%.+]] = 0 to 8 step 8 {
+// CHECK:               affine.for [[I_1_:%.+]] = 0 to 2 {
+// CHECK-COUNT-8:         vector.transfer_read
+// CHECK-COUNT-24:        vector.shuffle
+// CHECK:                 affine.store {{.*}}, [[VEC_BUFFER_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<8x2xvector<8xf32>>
+// CHECK:           } else {
+// CHECK:             affine.load
+// CHECK:             affine.store {{.*}} : memref<8x16xf32>
+}
+
+// -----
+
+/// Copies from vectorizable buffers write vectors, masked against the bounds
+/// of the destination.
+func private @copy_from_vector(%p0 : index, %p1 : index) -> () {
+  %AA = memref.alloca() : memref<39x56xf32>
+  %B = memref.alloca() : memref<4x16xf32>
+  %i36 = constant 36 : index
+  %i40 = constant 40 : index
+  krnl.copy_from_tile_buffer %B, %AA [%i36, %i40]: memref<4x16xf32>, memref<39x56xf32>
+  return
+
+// CHECK-LABEL:  func private @copy_from_vector
+// CHECK-DAG:       [[ORGINAL_:%.+]] = memref.alloca() : memref<39x56xf32>
+// CHECK-DAG:       [[BUFFER_:%.+]] = memref.alloca() : memref<4x16xf32>
+// CHECK:           [[VEC_BUFFER_:%.+]] = krnl.vector_type_cast [[BUFFER_]] : memref<4x16xf32> to memref<4x2xvector<8xf32>>
+// CHECK:           affine.for [[I_0_:%.+]] = 0 to 3 {
+// CHECK:             affine.for [[I_1_:%.+]] = 0 to 2 {
+// CHECK:               [[VEC_:%.+]] = affine.load [[VEC_BUFFER_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<4x2xvector<8xf32>>
+// CHECK:               vector.transfer_write [[VEC_]], [[ORGINAL_]]{{.}}{{.*}}{{.}} : vector<8xf32>, memref<39x56xf32>
+// CHECK:             }
+// CHECK:           }
+// CHECK:           return
+// CHECK:         }
+}
@@ -111,3 +111,27 @@ func @test_krnl_load_store_with_affine(%arg0: memref<10x10xf32>, %arg1: memref<1
   // CHECK:      {{.*}} = affine.load {{.*}} : memref<10x?xf32>
   // CHECK:      affine.store {{.*}} : memref<10x10xf32>
 }
+
+// -----
+
+// COM: Check the lowering of krnl.prefetch, and of non-temporal krnl.store to std.store.
+func @test_krnl_prefetch_nontemporal_store(%arg0: memref<10x10xf32>, %arg1: memref<10xindex>) -> memref<10x10xf32> {
+  %0 = memref.alloc() : memref<10x10xf32>
+  %1:2 = krnl.define_loops 2
+  krnl.iterate(%1#0, %1#1) with (%1#0 -> %arg2 = 0 to 10, %1#1 -> %arg3 = 0 to 10) {
+    krnl.prefetch %arg0[%arg2, %arg3] {isDataCache = true, isWrite = false, localityHint = 3 : i32} : memref<10x10xf32>
+    %2 = krnl.load %arg1[%arg2] : memref<10xindex>
+    krnl.prefetch %arg0[%arg2, %2] {isDataCache = true, isWrite = false, localityHint = 3 : i32} : memref<10x10xf32>
+    %3 = krnl.load %arg0[%arg2, %arg3] : memref<10x10xf32>
+    krnl.store %3, %0[%arg2, %arg3] {nontemporal} : memref<10x10xf32>
+  }
+  return %0 : memref<10x10xf32>
+
+  // CHECK-LABEL:  @test_krnl_prefetch_nontemporal_store
+  // CHECK:  affine.for [[I:%.+]] = 0 to 10
+  // CHECK:    affine.for [[J:%.+]] = 0 to 10
+  // CHECK:      affine.prefetch %arg0{{.}}[[I]], [[J]]{{.}}, read, locality<3>, data : memref<10x10xf32>
+  // CHECK-NOT:  prefetch
+  // CHECK:      [[LOAD:%.+]] = affine.load %arg0{{.}}[[I]], [[J]]{{.}} : memref<10x10xf32>
+  // CHECK:      memref.store [[LOAD]], {{.*}}{{.}}[[I]], [[J]]{{.}} {nontemporal} : memref<10x10xf32>
+}
@@ -0,0 +1,49 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-affine='matmul-microkernels' --canonicalize %s -split-input-file | FileCheck %s
+
+/// The full tiles of 8 columns call the microkernel of the runtime.
+func private @matmul_microkernel(%A: memref<4x6xf32>, %B: memref<6x8xf32>, %C: memref<4x8xf32>) {
+    %c0 = constant 0: index
+    %c4 = constant 4: index // N
+    %c6 = constant 6: index // K
+    %c8 = constant 8: index // M
+    %ii, %jj, %kk = krnl.define_loops 3
+    %ib, %il = krnl.block %ii 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %jb, %jl = krnl.block %jj 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %kb, %kl = krnl.block %kk 6 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    krnl.permute(%ib, %il, %jb, %jl, %kb, %kl) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+    krnl.iterate(%ib, %jb, %kb) with (%ii -> %i = 0 to 4, %jj -> %j = 0 to 8, %kk -> %k = 0 to 6) {
+        krnl.matmul %A [%c0, %c0], %B[%c0, %c0], %C[%c0, %c0], (%il, %jl, %kl), (%c0, %c0, %c0), (%c4, %c8, %c6)
+            {unroll=false, simdize=true} :
+            memref<4x6xf32>, memref<6x8xf32>, memref<4x8xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
+    }
+    return
+
+// CHECK-LABEL:  func private @matmul_microkernel
+// CHECK-SAME:   ([[A_:%.+]]: memref<4x6xf32>, [[B_:%.+]]: memref<6x8xf32>, [[C_:%.+]]: memref<4x8xf32>) {
+// CHECK:           affine.if
+// CHECK:             krnl.matmul_microkernel [[A_]]{{.}}{{.*}}{{.}}, [[B_]]{{.}}{{.*}}{{.}}, [[C_]]{{.}}{{.*}}{{.}} {iTile = 4 : i64, jTile = 8 : i64, kTile = 6 : i64} : memref<4x6xf32>, memref<6x8xf32>, memref<4x8xf32>
+}
+
+// -----
+
+/// The tiles without tuned microkernel keep the affine code.
+func private @matmul_no_microkernel(%A: memref<4x6xf32>, %B: memref<6x4xf32>, %C: memref<4x4xf32>) {
+    %c0 = constant 0: index
+    %c4 = constant 4: index // N
+    %c6 = constant 6: index // K
+    %ii, %jj, %kk = krnl.define_loops 3
+    %ib, %il = krnl.block %ii 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %jb, %jl = krnl.block %jj 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %kb, %kl = krnl.block %kk 6 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    krnl.permute(%ib, %il, %jb, %jl, %kb, %kl) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+    krnl.iterate(%ib, %jb, %kb) with (%ii -> %i = 0 to 4, %jj -> %j = 0 to 4, %kk -> %k = 0 to 6) {
+        krnl.matmul %A [%c0, %c0], %B[%c0, %c0], %C[%c0, %c0], (%il, %jl, %kl), (%c0, %c0, %c0), (%c4, %c4, %c6)
+            {unroll=false, simdize=true} :
+            memref<4x6xf32>, memref<6x4xf32>, memref<4x4xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
+    }
+    return
+
+// CHECK-LABEL:  func private @matmul_no_microkernel
+// CHECK-NOT:       krnl.matmul_microkernel
+// CHECK:           vector.fma
+}
@@ -0,0 +1,97 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-affine --canonicalize %s -split-input-file | FileCheck %s
+
+// -----
+
+/// With unroll and jam, the rows of a full simd tile are computed together,
+/// each vector of B being loaded once for all the rows.
+func @matmul_unroll_jam(%A: memref<4x6xf32>, %B: memref<6x8xf32>, %C: memref<4x8xf32>) {
+    %c0 = constant 0: index
+    %c4 = constant 4: index
+    %c6 = constant 6: index
+    %c8 = constant 8: index
+    %ii, %jj, %kk = krnl.define_loops 3
+    %ib, %il = krnl.block %ii 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %jb, %jl = krnl.block %jj 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %kb, %kl = krnl.block %kk 6 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    krnl.permute(%ib, %il, %jb, %jl, %kb, %kl) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+    krnl.iterate(%ib, %jb, %kb) with (%ii -> %i = 0 to 4, %jj -> %j = 0 to 8, %kk -> %k = 0 to 6) {
+        krnl.matmul %A[%c0, %c0], %B[%c0, %c0], %C[%c0, %c0], (%il, %jl, %kl), (%c0, %c0, %c0), (%c4, %c8, %c6)
+            {unroll=true, simdize=true} :
+            memref<4x6xf32>, memref<6x8xf32>, memref<4x8xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
+    }
+    return
+
+// CHECK-LABEL:  func @matmul_unroll_jam
+// CHECK:           memref.alloca() {{.*}}: memref<4xvector<8xf32>>
+// CHECK-NOT:       affine.for {{.*}} = 0 to 4 {
+// CHECK:           affine.for [[K:%.+]] = 0 to 6 {
+// CHECK:             affine.load {{.*}}{{.}}[[K]], 0] : memref<6x1xvector<8xf32>>
+// CHECK-NOT:         affine.load {{.*}} : memref<6x1xvector<8xf32>>
+// CHECK-COUNT-4:     vector.fma
+// CHECK:           }
+// CHECK-COUNT-4:   affine.store {{.*}} : memref<4x1xvector<8xf32>>
+}
+
+// -----
+
+/// The partial tiles along the simd dimension of runtime size stay simdized,
+/// the results being merged into C with a mask, and unrolled and jammed.
+func @matmul_partial_simd(%A: memref<4x6xf32>, %B: memref<6x8xf32>, %C: memref<4x8xf32>,
+        %sn: index, %sm: index, %sk: index, %dm: index) {
+    %c0 = constant 0: index
+    %c4 = constant 4: index
+    %c6 = constant 6: index
+    %ii, %jj, %kk = krnl.define_loops 3
+    %ib, %il = krnl.block %ii 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %jb, %jl = krnl.block %jj 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %kb, %kl = krnl.block %kk 6 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    krnl.permute(%ib, %il, %jb, %jl, %kb, %kl) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+    krnl.iterate(%ib, %jb, %kb) with (%ii -> %i = 0 to 4, %jj -> %j = 0 to 8, %kk -> %k = 0 to 6) {
+        krnl.matmul %A[%c0, %c0], %B[%c0, %c0], %C[%c0, %c0], (%il, %jl, %kl), (%sn, %sm, %sk), (%c4, %dm, %c6)
+            {unroll=true, simdize=true} :
+            memref<4x6xf32>, memref<6x8xf32>, memref<4x8xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
+    }
+    return
+
+// CHECK-LABEL:  func @matmul_partial_simd
+// CHECK:           affine.if
+// CHECK-COUNT-4:     vector.fma
+// CHECK:           } else {
+// CHECK:             affine.if
+// CHECK-COUNT-4:       vector.fma
+// CHECK:             } else {
+// CHECK:               [[MASK:%.+]] = vector.create_mask {{.*}} : vector<8xi1>
+// CHECK-NOT:           affine.load {{.*}} : memref<4x8xf32>
+// CHECK-COUNT-4:       vector.fma
+// CHECK:               [[MERGED:%.+]] = select [[MASK]], {{.*}} : vector<8xi1>, vector<8xf32>
+// CHECK:               affine.store [[MERGED]], {{.*}} : memref<4x1xvector<8xf32>>
+}
+
+// -----
+
+/// The simd tiles over a last dimension that is not a multiple of the vector
+/// length access B and C with vector transfers, masked at the memref bounds.
+func @matmul_transfers(%A: memref<4x6xf32>, %B: memref<6x12xf32>, %C: memref<4x12xf32>) {
+    %c0 = constant 0: index
+    %c4 = constant 4: index
+    %c6 = constant 6: index
+    %c12 = constant 12: index
+    %ii, %jj, %kk = krnl.define_loops 3
+    %ib, %il = krnl.block %ii 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %jb, %jl = krnl.block %jj 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    %kb, %kl = krnl.block %kk 6 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+    krnl.permute(%ib, %il, %jb, %jl, %kb, %kl) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+    krnl.iterate(%ib, %jb, %kb) with (%ii -> %i = 0 to 4, %jj -> %j = 0 to 12, %kk -> %k = 0 to 6) {
+        krnl.matmul %A[%c0, %c0], %B[%c0, %c0], %C[%c0, %c0], (%il, %jl, %kl), (%i, %j, %k), (%c4, %c12, %c6)
+            {unroll=true, simdize=true} :
+            memref<4x6xf32>, memref<6x12xf32>, memref<4x12xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
+    }
+    return
+
+// CHECK-LABEL:  func @matmul_transfers
+// CHECK-NOT:       krnl.vector_type_cast
+// CHECK:           vector.transfer_read {{.*}} : memref<4x12xf32>, vector<8xf32>
+// CHECK:           vector.transfer_read {{.*}} : memref<6x12xf32>, vector<8xf32>
+// CHECK:           vector.fma
+// CHECK:           vector.transfer_write {{.*}} : vector<8xf32>, memref<4x12xf32>
+}
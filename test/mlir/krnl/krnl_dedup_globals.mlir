@@ -0,0 +1,45 @@
+// RUN: onnx-mlir-opt --dedup-krnl-globals %s -split-input-file | FileCheck %s
+
+/// The identical globals of two functions share the name of the first one,
+/// the globals with another value or type keep their name.
+func @encoder() -> (memref<3xf32>, memref<3xf32>) {
+  %0 = "krnl.global"() {name = "constant_0", shape = [3], value = dense<[1.0, 2.0, 3.0]> : tensor<3xf32>} : () -> memref<3xf32>
+  %1 = "krnl.global"() {name = "constant_1", shape = [3], value = dense<[4.0, 5.0, 6.0]> : tensor<3xf32>} : () -> memref<3xf32>
+  return %0, %1 : memref<3xf32>, memref<3xf32>
+
+  // CHECK-LABEL: encoder
+  // CHECK:       "krnl.global"() {name = "constant_0"
+  // CHECK:       "krnl.global"() {name = "constant_1"
+}
+
+func @decoder() -> (memref<3xf32>, memref<3xi32>, memref<3xf32>) {
+  %0 = "krnl.global"() {name = "constant_2", shape = [3], value = dense<[1.0, 2.0, 3.0]> : tensor<3xf32>} : () -> memref<3xf32>
+  %1 = "krnl.global"() {name = "constant_3", shape = [3], value = dense<[1, 2, 3]> : tensor<3xi32>} : () -> memref<3xi32>
+  %2 = "krnl.global"() {alignment = 64 : i64, name = "constant_4", shape = [3], value = dense<[1.0, 2.0, 3.0]> : tensor<3xf32>} : () -> memref<3xf32>
+  return %0, %1, %2 : memref<3xf32>, memref<3xi32>, memref<3xf32>
+
+  // CHECK-LABEL: decoder
+  // CHECK:       "krnl.global"() {name = "constant_0"
+  // CHECK:       "krnl.global"() {name = "constant_3"
+  // CHECK:       "krnl.global"() {alignment = 64 : i64, name = "constant_4"
+}
+
+// -----
+
+/// The globals whose values have the same bytes share their name, whatever
+/// their shapes and element types.
+func @tied_weights() -> (memref<2x2xf32>, memref<4xf32>, memref<4xi32>, memref<8xf32>, memref<4xf32>) {
+  %0 = "krnl.global"() {name = "constant_0", shape = [2, 2], value = dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>} : () -> memref<2x2xf32>
+  %1 = "krnl.global"() {name = "constant_1", shape = [4], value = dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>} : () -> memref<4xf32>
+  %2 = "krnl.global"() {name = "constant_2", shape = [4], value = dense<[0, 0, 0, 0]> : tensor<4xi32>} : () -> memref<4xi32>
+  %3 = "krnl.global"() {name = "constant_3", shape = [8], value = dense<0.0> : tensor<8xf32>} : () -> memref<8xf32>
+  %4 = "krnl.global"() {name = "constant_4", shape = [4], value = dense<0.0> : tensor<4xf32>} : () -> memref<4xf32>
+  return %0, %1, %2, %3, %4 : memref<2x2xf32>, memref<4xf32>, memref<4xi32>, memref<8xf32>, memref<4xf32>
+
+  // CHECK-LABEL: tied_weights
+  // CHECK:       "krnl.global"() {name = "constant_0", shape = [2, 2]
+  // CHECK:       "krnl.global"() {name = "constant_0", shape = [4]
+  // CHECK:       "krnl.global"() {name = "constant_2", shape = [4]
+  // CHECK:       "krnl.global"() {name = "constant_3", shape = [8]
+  // CHECK:       "krnl.global"() {name = "constant_2", shape = [4]
+}
@@ -0,0 +1,23 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm %s -split-input-file | FileCheck %s
+
+/// The entry point of a batch-separable model runs the inputs in chunks of
+/// their batch with the runtime, the entry point writing into the outputs of
+/// the caller runs them at once.
+func @main_graph(%arg0: memref<?x10xf32>) -> memref<?x10xf32> {
+  return %arg0 : memref<?x10xf32>
+}
+"krnl.entry_point"() {batchSeparable, func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK:       llvm.func @omBatchRunInChunks(!llvm.ptr<i8>, !llvm.ptr<i8>) -> !llvm.ptr<i8>
+
+// CHECK-LABEL: llvm.func @run_main_graph_unsplit({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         llvm.call @_mlir_ciface_main_graph
+
+// CHECK-LABEL: llvm.func @run_main_graph([[INPUTS:%.+]]: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         [[UNSPLIT:%.+]] = llvm.mlir.addressof @run_main_graph_unsplit
+// CHECK:         [[UNSPLIT_PTR:%.+]] = llvm.bitcast [[UNSPLIT]] : {{.*}} to !llvm.ptr<i8>
+// CHECK:         [[OUTPUTS:%.+]] = llvm.call @omBatchRunInChunks([[UNSPLIT_PTR]], [[INPUTS]]) : (!llvm.ptr<i8>, !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         llvm.return [[OUTPUTS]] : !llvm.ptr<i8>
+
+// CHECK-LABEL: llvm.func @run_main_graph_into
+// CHECK:         llvm.call @_mlir_ciface_main_graph
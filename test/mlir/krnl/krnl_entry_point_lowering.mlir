@@ -0,0 +1,274 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm %s -split-input-file | FileCheck %s
+
+/// Test the entry point writing the outputs into caller-provided OMTensors.
+func @main_graph(%arg0: memref<10xf32>) -> memref<10xf32> {
+  %0 = memref.alloc() : memref<10xf32>
+  return %0 : memref<10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         llvm.call @omTensorListCreateWithOwnership
+
+// CHECK-LABEL: llvm.func @run_main_graph_into([[IN:%.+]]: !llvm.ptr<i8>, [[OUT:%.+]]: !llvm.ptr<i8>) -> i32
+// CHECK:         [[SIZE:%.+]] = llvm.call @omTensorListGetSize([[OUT]]) : (!llvm.ptr<i8>) -> i32
+// CHECK:         llvm.icmp "eq" [[SIZE]]
+// CHECK:         llvm.call @_mlir_ciface_main_graph
+// CHECK:         llvm.call @omTensorGetRank
+// CHECK:         llvm.call @omTensorGetBufferSize
+// CHECK:         llvm.call @llvm.memcpy.p0i8.p0i8.i64
+// CHECK:         llvm.call @free
+// CHECK:         llvm.return
+
+// -----
+
+/// Test the call of the specialization matching the input shapes.
+func @main_graph_spec0(%arg0: memref<1x10xf32>) -> memref<1x10xf32> {
+  %0 = memref.alloc() : memref<1x10xf32>
+  return %0 : memref<1x10xf32>
+}
+func @main_graph(%arg0: memref<?x10xf32>) -> memref<?x10xf32> {
+  %c0 = constant 0 : index
+  %d0 = memref.dim %arg0, %c0 : memref<?x10xf32>
+  %0 = memref.alloc(%d0) : memref<?x10xf32>
+  return %0 : memref<?x10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]", specializations = [{func = @main_graph_spec0, shapes = [[1, 10]]}]} : () -> ()
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK-DAG:     [[DYNAMIC:%.+]] = llvm.mlir.addressof @_mlir_ciface_main_graph
+// CHECK-DAG:     [[SPEC:%.+]] = llvm.mlir.addressof @_mlir_ciface_main_graph_spec0
+// CHECK-DAG:     [[DIM0:%.+]] = llvm.extractvalue {{.*}}[3 : i64, 0 : i64]
+// CHECK-DAG:     llvm.icmp "eq" [[DIM0]]
+// CHECK:         [[CALLEE:%.+]] = llvm.select {{.*}}, [[SPEC]], [[DYNAMIC]]
+// CHECK:         llvm.call [[CALLEE]]({{.*}})
+
+// -----
+
+/// Test the call of the aligned version when the data of the inputs are
+/// aligned.
+func @main_graph_aligned(%arg0: memref<10xf32>) -> memref<10xf32> {
+  memref.assume_alignment %arg0, 64 : memref<10xf32>
+  %0 = memref.alloc() : memref<10xf32>
+  return %0 : memref<10xf32>
+}
+func @main_graph(%arg0: memref<10xf32>) -> memref<10xf32> {
+  %0 = memref.alloc() : memref<10xf32>
+  return %0 : memref<10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]", specializations = [{alignment = 64 : i64, func = @main_graph_aligned, shapes = [[10]]}]} : () -> ()
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK-DAG:     [[DEFAULT:%.+]] = llvm.mlir.addressof @_mlir_ciface_main_graph
+// CHECK-DAG:     [[ALIGNED:%.+]] = llvm.mlir.addressof @_mlir_ciface_main_graph_aligned
+// CHECK-DAG:     [[MASK:%.+]] = llvm.mlir.constant(63 : i64) : i64
+// CHECK-DAG:     [[DATA:%.+]] = llvm.extractvalue {{.*}}[1 : i64]
+// CHECK-DAG:     [[ADDRESS:%.+]] = llvm.ptrtoint [[DATA]]
+// CHECK-DAG:     [[OFFSET:%.+]] = llvm.and [[ADDRESS]], [[MASK]]
+// CHECK-DAG:     llvm.icmp "eq" [[OFFSET]]
+// CHECK:         [[CALLEE:%.+]] = llvm.select {{.*}}, [[ALIGNED]], [[DEFAULT]]
+// CHECK:         llvm.call [[CALLEE]]({{.*}})
+
+// -----
+
+/// Test that the outputs forwarding an input, a constant or a previous output
+/// do not own their buffers, and are not freed by the entry point writing
+/// into caller-provided outputs.
+func @main_graph(%arg0: memref<10xf32>) -> (memref<10xf32>, memref<2xf32>, memref<10xf32>, memref<10xf32>) {
+  %0 = "krnl.global"() {name = "constant_0", shape = [2], value = dense<[1.0, 2.0]> : tensor<2xf32>} : () -> memref<2xf32>
+  %1 = memref.alloc() : memref<10xf32>
+  return %arg0, %0, %1, %1 : memref<10xf32>, memref<2xf32>, memref<10xf32>, memref<10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 4 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         [[NOT_OWNING0:%.+]] = llvm.mlir.constant(0 : i32) : i32
+// CHECK:         llvm.call @omTensorSetDataPtr({{.*}}, [[NOT_OWNING0]], {{.*}})
+// CHECK:         [[NOT_OWNING1:%.+]] = llvm.mlir.constant(0 : i32) : i32
+// CHECK:         llvm.call @omTensorSetDataPtr({{.*}}, [[NOT_OWNING1]], {{.*}})
+// CHECK:         [[OWNING:%.+]] = llvm.mlir.constant(1 : i32) : i32
+// CHECK:         llvm.call @omTensorSetDataPtr({{.*}}, [[OWNING]], {{.*}})
+// CHECK:         [[NOT_OWNING2:%.+]] = llvm.mlir.constant(0 : i32) : i32
+// CHECK:         llvm.call @omTensorSetDataPtr({{.*}}, [[NOT_OWNING2]], {{.*}})
+
+// CHECK-LABEL: llvm.func @run_main_graph_into
+// CHECK:         llvm.call @free
+// CHECK-NOT:     llvm.call @free
+// CHECK:         llvm.return
+
+// -----
+
+/// Test that an output merging a buffer allocated by the function and a view
+/// of an input, e.g. a concat appended in place in the capacity of its input,
+/// owns its buffer when it is not the data of an input.
+func @main_graph(%arg0: memref<1x?xf32>) -> memref<1x?xf32> {
+  %c1 = constant 1 : index
+  %0 = memref.dim %arg0, %c1 : memref<1x?xf32>
+  %1 = addi %0, %c1 : index
+  %2 = krnl.stride %arg0[0] : memref<1x?xf32>
+  %3 = cmpi sle, %1, %2 : index
+  cond_br %3, ^bb1, ^bb2
+^bb1:
+  %4 = memref.reinterpret_cast %arg0 to offset: [0], sizes: [1, %1], strides: [%2, 1] : memref<1x?xf32> to memref<1x?xf32>
+  br ^bb3(%4 : memref<1x?xf32>)
+^bb2:
+  %5 = memref.alloc(%1) : memref<1x?xf32>
+  br ^bb3(%5 : memref<1x?xf32>)
+^bb3(%6: memref<1x?xf32>):
+  return %6 : memref<1x?xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+/// The stride is read from the descriptor of the input.
+// CHECK-LABEL: llvm.func internal @main_graph(
+// CHECK:         llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         [[INPUT_:%.+]] = llvm.call @omTensorGetDataPtr
+// CHECK:         llvm.call @omTensorCreateEmptyDeprecated
+// CHECK:         [[ALLOCATED_:%.+]] = llvm.extractvalue {{.*}}[0]
+// CHECK:         [[INPUT_PTR_:%.+]] = llvm.bitcast [[INPUT_]]
+// CHECK:         [[NOT_INPUT_:%.+]] = llvm.icmp "ne" [[ALLOCATED_]], [[INPUT_PTR_]]
+// CHECK:         [[OWNING_:%.+]] = llvm.zext {{.*}} : i1 to i32
+// CHECK:         llvm.call @omTensorSetDataPtr({{.*}}, [[OWNING_]], {{.*}})
+
+/// The output is not copied when it views an input, and freed otherwise.
+// CHECK-LABEL: llvm.func @run_main_graph_into
+// CHECK:         llvm.icmp "ne"
+// CHECK:         [[FREED_:%.+]] = llvm.select {{.*}}, {{.*}}, {{.*}} : i1, !llvm.ptr<i8>
+// CHECK:         llvm.call @free([[FREED_]])
+
+// -----
+
+/// Test the warm-up function prefaulting the constants and allocating the
+/// static memory arenas, whose identifiers are offset by the base reserved by
+/// the library.
+func @main_graph(%arg0: memref<2xi64>) -> memref<2xi64> {
+  %c0_i64 = constant 0 : i64
+  %0 = "krnl.global"() {name = "constant_0", shape = [2], value = dense<[1, 2]> : tensor<2xi64>} : () -> memref<2xi64>
+  %1 = "krnl.arena"() {alignment = 16 : i64, id = 0 : i64} : () -> memref<16xi8>
+  %2 = "krnl.getref"(%1, %c0_i64) : (memref<16xi8>, i64) -> memref<2xi64>
+  %3 = memref.alloc() : memref<2xi64>
+  return %3 : memref<2xi64>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK:       llvm.mlir.global internal @_arena_id_base(-1 : i64) {num_ids = 1 : i64} : i64
+
+// CHECK-LABEL: llvm.func internal @main_graph(
+// CHECK:         [[BASE:%.+]] = llvm.call @omArenaReserveIds({{.*}}) : (!llvm.ptr<i64>, i64) -> i64
+// CHECK:         [[ARENA_ID:%.+]] = llvm.add [[BASE]], {{.*}} : i64
+// CHECK:         llvm.call @omArenaGet([[ARENA_ID]], {{.*}})
+
+// CHECK-LABEL: llvm.func @omModelWarmup()
+// CHECK:         [[CONSTANT:%.+]] = llvm.mlir.addressof @constant_0 : !llvm.ptr<array<2 x i64>>
+// CHECK:         [[DATA:%.+]] = llvm.bitcast [[CONSTANT]] : !llvm.ptr<array<2 x i64>> to !llvm.ptr<i8>
+// CHECK:         [[SIZE:%.+]] = llvm.mlir.constant(16 : i64) : i64
+// CHECK:         llvm.call @omWeightsPrefault([[DATA]], [[SIZE]]) : (!llvm.ptr<i8>, i64) -> ()
+// CHECK:         [[ID:%.+]] = llvm.mlir.constant(0 : i64) : i64
+// CHECK:         [[BASE_ADDR:%.+]] = llvm.mlir.addressof @_arena_id_base : !llvm.ptr<i64>
+// CHECK:         [[NUM_IDS:%.+]] = llvm.mlir.constant(1 : i64) : i64
+// CHECK:         [[BASE:%.+]] = llvm.call @omArenaReserveIds([[BASE_ADDR]], [[NUM_IDS]]) : (!llvm.ptr<i64>, i64) -> i64
+// CHECK:         [[ARENA_ID:%.+]] = llvm.add [[BASE]], [[ID]] : i64
+// CHECK:         [[ARENA_SIZE:%.+]] = llvm.mlir.constant(16 : i64) : i64
+// CHECK:         [[ALIGN:%.+]] = llvm.mlir.constant(16 : i64) : i64
+// CHECK:         [[THREAD_LOCAL:%.+]] = llvm.mlir.constant(0 : i32) : i32
+// CHECK:         llvm.call @omArenaGet([[ARENA_ID]], [[ARENA_SIZE]], [[ALIGN]], [[THREAD_LOCAL]])
+// CHECK:         llvm.return
+
+/// The arena and the output buffer.
+// CHECK-LABEL: llvm.func @omModelMemoryRequirements() -> i64
+// CHECK:         [[BYTES:%.+]] = llvm.mlir.constant(32 : i64) : i64
+// CHECK:         llvm.return [[BYTES]] : i64
+
+// -----
+
+/// Test a library with the entry points of two models sharing a constant.
+func @main_graph(%arg0: memref<3xf32>) -> memref<3xf32> {
+  %0 = "krnl.global"() {name = "constant_0", shape = [3], value = dense<[1.0, 2.0, 3.0]> : tensor<3xf32>} : () -> memref<3xf32>
+  return %0 : memref<3xf32>
+}
+func @decoder(%arg0: memref<3xf32>) -> memref<3xf32> {
+  %0 = "krnl.global"() {name = "constant_0", shape = [3], value = dense<[1.0, 2.0, 3.0]> : tensor<3xf32>} : () -> memref<3xf32>
+  return %0 : memref<3xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+"krnl.entry_point"() {func = @decoder, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in_decoder]@[out_decoder]"} : () -> ()
+
+// CHECK:         llvm.mlir.global internal constant @constant_0
+// CHECK-NOT:     llvm.mlir.global internal constant @constant_0
+// CHECK-DAG:     llvm.func @omInputSignature() -> !llvm.ptr<i8>
+// CHECK-DAG:     llvm.func @omOutputSignature() -> !llvm.ptr<i8>
+// CHECK-DAG:     llvm.func @omInputSignature_decoder() -> !llvm.ptr<i8>
+// CHECK-DAG:     llvm.func @omOutputSignature_decoder() -> !llvm.ptr<i8>
+// CHECK-DAG:     llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK-DAG:     llvm.func @run_decoder({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+
+// -----
+
+/// Test the signature tables, and the check of the inputs against the input
+/// table before the model is run.
+func @main_graph(%arg0: memref<?x10xf32>, %arg1: memref<i64>) -> memref<?x10xf32> {
+  return %arg0 : memref<?x10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK:         llvm.mlir.global internal constant @_in_signature_table(dense<[2, 1, 2, -1, 10, 7, 0]> : tensor<7xi64>) : !llvm.array<7 x i64>
+// CHECK:         llvm.func @omInputSignatureTable() -> !llvm.ptr<i8>
+// CHECK:         llvm.mlir.global internal constant @_out_signature_table(dense<[1, 1, 2, -1, 10]> : tensor<5xi64>) : !llvm.array<5 x i64>
+// CHECK:         llvm.func @omOutputSignatureTable() -> !llvm.ptr<i8>
+
+// CHECK-LABEL: llvm.func @run_main_graph([[IN:%.+]]: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         [[TABLE:%.+]] = llvm.mlir.addressof @_in_signature_table
+// CHECK:         [[TABLE_PTR:%.+]] = llvm.bitcast [[TABLE]]
+// CHECK:         [[CHECK:%.+]] = llvm.call @omTensorListCheckSignature([[IN]], [[TABLE_PTR]]) : (!llvm.ptr<i8>, !llvm.ptr<i8>) -> i32
+// CHECK:         [[MATCH:%.+]] = llvm.icmp "eq" [[CHECK]]
+// CHECK:         llvm.cond_br [[MATCH]], ^bb1, ^bb2
+// CHECK:       ^bb1:
+// CHECK:         llvm.call @_mlir_ciface_main_graph
+// CHECK:       ^bb2:
+// CHECK:         [[NULL:%.+]] = llvm.mlir.null : !llvm.ptr<i8>
+// CHECK:         llvm.return [[NULL]] : !llvm.ptr<i8>
+
+// CHECK-LABEL: llvm.func @run_main_graph_into
+// CHECK:         llvm.call @omTensorListCheckSignature
+// CHECK:         llvm.and
+// CHECK:         llvm.cond_br
+
+// -----
+
+/// Test the layouts of the inputs: the input only read by the function is
+/// passed as a contiguous copy when its strides are not dense, the input
+/// also returned is checked to be contiguous.
+func @main_graph(%arg0: memref<10xf32>, %arg1: memref<10xf32>) -> (memref<10xf32>, memref<10xf32>) {
+  %c0 = constant 0 : index
+  %0 = memref.alloc() : memref<10xf32>
+  %1 = memref.load %arg0[%c0] : memref<10xf32>
+  %2 = memref.load %arg1[%c0] : memref<10xf32>
+  %3 = addf %1, %2 : f32
+  memref.store %3, %0[%c0] : memref<10xf32>
+  return %0, %arg1 : memref<10xf32>, memref<10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 2 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK:         llvm.call @omTensorListCheckSignature
+// CHECK:         llvm.cond_br {{.*}}, ^bb1, ^bb3
+// CHECK:       ^bb1:
+// CHECK:         [[CONTIGUOUS:%.+]] = llvm.call @omTensorIsContiguous
+// CHECK:         llvm.icmp "ne" [[CONTIGUOUS]]
+// CHECK:         llvm.cond_br {{.*}}, ^bb2, ^bb3
+// CHECK:       ^bb2:
+// CHECK:         [[COPY:%.+]] = llvm.call @omTensorGetContiguous([[INPUT:%[0-9]+]])
+// CHECK:         llvm.call @omTensorGetDataPtr([[COPY]])
+// CHECK-NOT:     llvm.call @omTensorGetContiguous
+// CHECK:         llvm.call @_mlir_ciface_main_graph
+// CHECK:         llvm.call @omTensorReleaseContiguous([[COPY]], [[INPUT]])
+// CHECK:       ^bb3:
+// CHECK:         llvm.mlir.null
+
+// CHECK-LABEL: llvm.func @run_main_graph_into
+// CHECK:         llvm.call @omTensorIsContiguous
+// CHECK:         llvm.call @omTensorGetContiguous
+// CHECK:         llvm.call @_mlir_ciface_main_graph
+// CHECK:         llvm.call @omTensorReleaseContiguous
@@ -0,0 +1,11 @@
+// RUN: printf '\001\000\000\000\002\000\000\000' > %t.bin
+// RUN: sed 's|DATA_FILE|%t.bin|' %s | onnx-mlir-opt --convert-krnl-to-llvm | FileCheck %s
+
+/// The external data of a global is only read when the global is emitted.
+func @test_external_data() -> memref<2xi32> {
+  %0 = "krnl.global"() {name = "constant_0", shape = [2], external_data_location = "DATA_FILE", external_data_offset = 0 : i64} : () -> memref<2xi32>
+  return %0 : memref<2xi32>
+
+  // CHECK: llvm.mlir.global internal constant @constant_0("\01\00\00\00\02\00\00\00")
+  // CHECK-LABEL: llvm.func @test_external_data
+}
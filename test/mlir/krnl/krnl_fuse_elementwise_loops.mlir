@@ -0,0 +1,128 @@
+// RUN: onnx-mlir-opt --fuse-elementwise-loops %s -split-input-file | FileCheck %s
+
+/// Add followed by Relu: the loops are fused and the intermediate buffer is
+/// removed.
+func @fuse_add_relu(%arg0: memref<10x10xf32>, %arg1: memref<10x10xf32>) -> memref<10x10xf32> {
+  %cst = constant 0.000000e+00 : f32
+  %0 = memref.alloc() : memref<10x10xf32>
+  %1 = memref.alloc() : memref<10x10xf32>
+  %2:2 = krnl.define_loops 2
+  krnl.iterate(%2#0, %2#1) with (%2#0 -> %arg2 = 0 to 10, %2#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %arg0[%arg2, %arg3] : memref<10x10xf32>
+    %5 = krnl.load %arg1[%arg2, %arg3] : memref<10x10xf32>
+    %6 = addf %4, %5 : f32
+    krnl.store %6, %1[%arg2, %arg3] : memref<10x10xf32>
+  }
+  %3:2 = krnl.define_loops 2
+  krnl.iterate(%3#0, %3#1) with (%3#0 -> %arg2 = 0 to 10, %3#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %1[%arg2, %arg3] : memref<10x10xf32>
+    %5 = cmpf olt, %4, %cst : f32
+    %6 = select %5, %cst, %4 : f32
+    krnl.store %6, %0[%arg2, %arg3] : memref<10x10xf32>
+  }
+  memref.dealloc %1 : memref<10x10xf32>
+  return %0 : memref<10x10xf32>
+
+  // CHECK-LABEL: fuse_add_relu
+  // CHECK:       [[RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK-NOT:   memref.alloc
+  // CHECK:       [[LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK:       krnl.iterate([[LOOPS]]#0, [[LOOPS]]#1) with ([[LOOPS]]#0 -> [[I:%.+]] = 0 to 10, [[LOOPS]]#1 -> [[J:%.+]] = 0 to 10) {
+  // CHECK:         [[LOAD0:%.+]] = krnl.load %arg0{{\[}}[[I]], [[J]]{{\]}} : memref<10x10xf32>
+  // CHECK:         [[LOAD1:%.+]] = krnl.load %arg1{{\[}}[[I]], [[J]]{{\]}} : memref<10x10xf32>
+  // CHECK:         [[ADD:%.+]] = addf [[LOAD0]], [[LOAD1]] : f32
+  // CHECK:         [[CMP:%.+]] = cmpf olt, [[ADD]], {{.*}} : f32
+  // CHECK:         [[SEL:%.+]] = select [[CMP]], {{.*}}, [[ADD]] : f32
+  // CHECK:         krnl.store [[SEL]], [[RES]]{{\[}}[[I]], [[J]]{{\]}} : memref<10x10xf32>
+  // CHECK:       }
+  // CHECK-NOT:   krnl.iterate
+  // CHECK-NOT:   memref.dealloc
+  // CHECK:       return [[RES]] : memref<10x10xf32>
+}
+
+// -----
+
+/// The consumer broadcasts a second operand: the loops are still fused.
+func @fuse_broadcast(%arg0: memref<10x10xf32>, %arg1: memref<10xf32>) -> memref<10x10xf32> {
+  %0 = memref.alloc() : memref<10x10xf32>
+  %1 = memref.alloc() : memref<10x10xf32>
+  %2:2 = krnl.define_loops 2
+  krnl.iterate(%2#0, %2#1) with (%2#0 -> %arg2 = 0 to 10, %2#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %arg0[%arg2, %arg3] : memref<10x10xf32>
+    %5 = math.exp %4 : f32
+    krnl.store %5, %1[%arg2, %arg3] : memref<10x10xf32>
+  }
+  %3:2 = krnl.define_loops 2
+  krnl.iterate(%3#0, %3#1) with (%3#0 -> %arg2 = 0 to 10, %3#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %1[%arg2, %arg3] : memref<10x10xf32>
+    %5 = krnl.load %arg1[%arg3] : memref<10xf32>
+    %6 = mulf %4, %5 : f32
+    krnl.store %6, %0[%arg2, %arg3] : memref<10x10xf32>
+  }
+  memref.dealloc %1 : memref<10x10xf32>
+  return %0 : memref<10x10xf32>
+
+  // CHECK-LABEL: fuse_broadcast
+  // CHECK:       [[RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK-NOT:   memref.alloc
+  // CHECK:       krnl.iterate
+  // CHECK:         [[EXP:%.+]] = math.exp {{.*}} : f32
+  // CHECK:         [[LOAD:%.+]] = krnl.load %arg1{{\[}}%arg3{{\]}} : memref<10xf32>
+  // CHECK:         [[MUL:%.+]] = mulf [[EXP]], [[LOAD]] : f32
+  // CHECK:         krnl.store [[MUL]], [[RES]]{{\[}}%arg2, %arg3{{\]}} : memref<10x10xf32>
+  // CHECK-NOT:   krnl.iterate
+}
+
+// -----
+
+/// The consumer reads the intermediate buffer at another point than the
+/// current iteration: the loops are not fused.
+func @no_fuse_transposed_read(%arg0: memref<10x10xf32>) -> memref<10x10xf32> {
+  %0 = memref.alloc() : memref<10x10xf32>
+  %1 = memref.alloc() : memref<10x10xf32>
+  %2:2 = krnl.define_loops 2
+  krnl.iterate(%2#0, %2#1) with (%2#0 -> %arg2 = 0 to 10, %2#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %arg0[%arg2, %arg3] : memref<10x10xf32>
+    %5 = math.exp %4 : f32
+    krnl.store %5, %1[%arg2, %arg3] : memref<10x10xf32>
+  }
+  %3:2 = krnl.define_loops 2
+  krnl.iterate(%3#0, %3#1) with (%3#0 -> %arg2 = 0 to 10, %3#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %1[%arg3, %arg2] : memref<10x10xf32>
+    krnl.store %4, %0[%arg2, %arg3] : memref<10x10xf32>
+  }
+  memref.dealloc %1 : memref<10x10xf32>
+  return %0 : memref<10x10xf32>
+
+  // CHECK-LABEL: no_fuse_transposed_read
+  // CHECK:       krnl.iterate
+  // CHECK:         krnl.store {{.*}}, %1{{\[}}%arg2, %arg3{{\]}} : memref<10x10xf32>
+  // CHECK:       krnl.iterate
+  // CHECK:         krnl.load %1{{\[}}%arg3, %arg2{{\]}} : memref<10x10xf32>
+  // CHECK:       memref.dealloc %1 : memref<10x10xf32>
+}
+
+// -----
+
+/// The iteration spaces differ: the loops are not fused.
+func @no_fuse_different_bounds(%arg0: memref<10x10xf32>) -> memref<10x5xf32> {
+  %0 = memref.alloc() : memref<10x5xf32>
+  %1 = memref.alloc() : memref<10x10xf32>
+  %2:2 = krnl.define_loops 2
+  krnl.iterate(%2#0, %2#1) with (%2#0 -> %arg2 = 0 to 10, %2#1 -> %arg3 = 0 to 10) {
+    %4 = krnl.load %arg0[%arg2, %arg3] : memref<10x10xf32>
+    krnl.store %4, %1[%arg2, %arg3] : memref<10x10xf32>
+  }
+  %3:2 = krnl.define_loops 2
+  krnl.iterate(%3#0, %3#1) with (%3#0 -> %arg2 = 0 to 10, %3#1 -> %arg3 = 0 to 5) {
+    %4 = krnl.load %1[%arg2, %arg3] : memref<10x10xf32>
+    krnl.store %4, %0[%arg2, %arg3] : memref<10x5xf32>
+  }
+  memref.dealloc %1 : memref<10x10xf32>
+  return %0 : memref<10x5xf32>
+
+  // CHECK-LABEL: no_fuse_different_bounds
+  // CHECK:       krnl.iterate
+  // CHECK:       krnl.iterate
+  // CHECK:       memref.dealloc
+}
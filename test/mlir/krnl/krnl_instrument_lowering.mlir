@@ -0,0 +1,31 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm %s | FileCheck %s
+
+/// The instrumentation points call the runtime with the names of the op held
+/// by internal globals and the size of its outputs, computed from the
+/// descriptors of the dynamic ones.
+func @test_instrument(%arg0: memref<10x10xf32>, %arg1: memref<?x4xf32>) {
+  "krnl.instrument"() {nodeName = "conv1", opName = "Conv", tag = 0 : i64} : () -> ()
+  "krnl.instrument"(%arg0, %arg1) {nodeName = "conv1", opName = "Conv", tag = 1 : i64} : (memref<10x10xf32>, memref<?x4xf32>) -> ()
+  return
+
+  // CHECK-DAG: llvm.mlir.global internal constant @_instrument_op_Conv("Conv\00")
+  // CHECK-DAG: llvm.mlir.global internal constant @_instrument_node_conv1("conv1\00")
+  // CHECK-DAG: llvm.func @omInstrumentPoint(!llvm.ptr<i8>, !llvm.ptr<i8>, i64, i64)
+  // CHECK-LABEL: llvm.func @test_instrument
+  // CHECK: [[OP:%.+]] = llvm.mlir.addressof @_instrument_op_Conv : !llvm.ptr<array<5 x i8>>
+  // CHECK: [[OP_PTR:%.+]] = llvm.bitcast [[OP]] : !llvm.ptr<array<5 x i8>> to !llvm.ptr<i8>
+  // CHECK: [[NODE:%.+]] = llvm.mlir.addressof @_instrument_node_conv1 : !llvm.ptr<array<6 x i8>>
+  // CHECK: [[NODE_PTR:%.+]] = llvm.bitcast [[NODE]] : !llvm.ptr<array<6 x i8>> to !llvm.ptr<i8>
+  // CHECK: [[START:%.+]] = llvm.mlir.constant(0 : i64) : i64
+  // CHECK: [[ZERO:%.+]] = llvm.mlir.constant(0 : i64) : i64
+  // CHECK: llvm.call @omInstrumentPoint([[OP_PTR]], [[NODE_PTR]], [[START]], [[ZERO]]) : (!llvm.ptr<i8>, !llvm.ptr<i8>, i64, i64) -> ()
+  // CHECK: [[END:%.+]] = llvm.mlir.constant(1 : i64) : i64
+  // CHECK: [[ELT_SIZE:%.+]] = llvm.mlir.constant(4 : i64) : i64
+  // CHECK: [[DIM0:%.+]] = llvm.extractvalue {{.*}}[3, 0]
+  // CHECK: [[BYTES0:%.+]] = llvm.mul [[ELT_SIZE]], [[DIM0]] : i64
+  // CHECK: [[DIM1:%.+]] = llvm.extractvalue {{.*}}[3, 1]
+  // CHECK: [[DYN_BYTES:%.+]] = llvm.mul [[BYTES0]], [[DIM1]] : i64
+  // CHECK: [[STATIC_BYTES:%.+]] = llvm.mlir.constant(400 : i64) : i64
+  // CHECK: [[BYTES:%.+]] = llvm.add [[STATIC_BYTES]], [[DYN_BYTES]] : i64
+  // CHECK: llvm.call @omInstrumentPoint({{.*}}, {{.*}}, [[END]], [[BYTES]]) : (!llvm.ptr<i8>, !llvm.ptr<i8>, i64, i64) -> ()
+}
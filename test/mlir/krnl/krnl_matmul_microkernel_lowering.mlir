@@ -0,0 +1,23 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm %s -split-input-file | FileCheck %s
+
+/// The microkernel calls pass the sizes of the tile, then the address of the
+/// first element and the row stride of each buffer.
+func @test_matmul_microkernel(%A: memref<8x12xf32>, %B: memref<12x32xf32>, %C: memref<8x32xf32>, %i: index) {
+  %c0 = constant 0 : index
+  %c16 = constant 16 : index
+  krnl.matmul_microkernel %A[%i, %c0], %B[%c0, %c16], %C[%i, %c16] {iTile = 4 : i64, jTile = 16 : i64, kTile = 12 : i64} : memref<8x12xf32>, memref<12x32xf32>, memref<8x32xf32>
+  return
+
+  // CHECK: llvm.func @omMatmulMicroKernelF32(i64, i64, i64, !llvm.ptr<f32>, i64, !llvm.ptr<f32>, i64, !llvm.ptr<f32>, i64)
+  // CHECK-LABEL: llvm.func @test_matmul_microkernel
+  // CHECK-DAG: [[I:%.+]] = llvm.mlir.constant(4 : i64) : i64
+  // CHECK-DAG: [[J:%.+]] = llvm.mlir.constant(16 : i64) : i64
+  // CHECK-DAG: [[K:%.+]] = llvm.mlir.constant(12 : i64) : i64
+  // CHECK: [[A_PTR:%.+]] = llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[LDA:%.+]] = llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[B_PTR:%.+]] = llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[LDB:%.+]] = llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[C_PTR:%.+]] = llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[LDC:%.+]] = llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: llvm.call @omMatmulMicroKernelF32([[I]], [[J]], [[K]], [[A_PTR]], [[LDA]], [[B_PTR]], [[LDB]], [[C_PTR]], [[LDC]]) : (i64, i64, i64, !llvm.ptr<f32>, i64, !llvm.ptr<f32>, i64, !llvm.ptr<f32>, i64) -> ()
+}
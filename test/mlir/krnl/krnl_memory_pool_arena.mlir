@@ -0,0 +1,38 @@
+// RUN: onnx-mlir-opt --memory-pool-arena %s -split-input-file | FileCheck %s
+// RUN: onnx-mlir-opt --memory-pool-arena="thread-local=true" %s -split-input-file | FileCheck %s --check-prefix=THREAD
+
+/// Static and dynamic memory pools are moved into arenas.
+func @pools_to_arena(%arg0: memref<10xf32>, %arg1: index) -> memref<10xf32> {
+  %c0_i64 = constant 0 : i64
+  %c40_i64 = constant 40 : i64
+  %0 = memref.alloc() : memref<10xf32>
+  %1 = memref.alloc() {alignment = 16 : i64} : memref<80xi8>
+  %2 = memref.alloc(%arg1) : memref<?xi8>
+  %3 = "krnl.getref"(%1, %c0_i64) : (memref<80xi8>, i64) -> memref<10xf32>
+  %4 = "krnl.getref"(%1, %c40_i64) : (memref<80xi8>, i64) -> memref<10xf32>
+  %5 = "krnl.getref"(%2, %c0_i64) : (memref<?xi8>, i64) -> memref<10xf32>
+  %6 = krnl.define_loops 1
+  krnl.iterate(%6) with (%6 -> %arg2 = 0 to 10) {
+    %7 = krnl.load %arg0[%arg2] : memref<10xf32>
+    krnl.store %7, %3[%arg2] : memref<10xf32>
+    krnl.store %7, %4[%arg2] : memref<10xf32>
+    krnl.store %7, %5[%arg2] : memref<10xf32>
+    krnl.store %7, %0[%arg2] : memref<10xf32>
+  }
+  memref.dealloc %2 : memref<?xi8>
+  memref.dealloc %1 : memref<80xi8>
+  return %0 : memref<10xf32>
+
+  // CHECK-LABEL: pools_to_arena
+  // CHECK: [[ARENA:%.+]] = "krnl.arena"() {alignment = 16 : i64, id = 0 : i64} : () -> memref<80xi8>
+  // CHECK: [[DYN_ARENA:%.+]] = "krnl.arena"(%arg1) {id = 1 : i64} : (index) -> memref<?xi8>
+  // CHECK: "krnl.getref"([[ARENA]], {{.*}}) : (memref<80xi8>, i64) -> memref<10xf32>
+  // CHECK: "krnl.getref"([[ARENA]], {{.*}}) : (memref<80xi8>, i64) -> memref<10xf32>
+  // CHECK: "krnl.getref"([[DYN_ARENA]], {{.*}}) : (memref<?xi8>, i64) -> memref<10xf32>
+  // CHECK-NOT: memref.dealloc
+  // CHECK: return
+
+  // THREAD-LABEL: pools_to_arena
+  // THREAD: "krnl.arena"() {alignment = 16 : i64, id = 0 : i64, threadLocal} : () -> memref<80xi8>
+  // THREAD: "krnl.arena"(%arg1) {id = 1 : i64, threadLocal} : (index) -> memref<?xi8>
+}
@@ -0,0 +1,31 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-affine --convert-krnl-to-llvm %s -split-input-file | FileCheck %s
+
+/// The pointers of the MemRef arguments that are only read are noalias.
+func @test_noalias(%arg0: memref<10xf32>, %arg1: memref<10xf32>) -> memref<10xf32> {
+  %c1 = constant 1 : index
+  %0 = memref.alloc() : memref<10xf32>
+  %1 = krnl.load %arg0[%c1] : memref<10xf32>
+  %2 = krnl.load %arg1[%c1] : memref<10xf32>
+  %3 = addf %1, %2 : f32
+  krnl.store %3, %0[%c1] : memref<10xf32>
+  return %0 : memref<10xf32>
+
+  // CHECK-LABEL: llvm.func @test_noalias
+  // CHECK-SAME:  (%arg0: !llvm.ptr<f32> {llvm.noalias = true}, %arg1: !llvm.ptr<f32> {llvm.noalias = true}, %arg2: i64, %arg3: i64, %arg4: i64,
+  // CHECK-SAME:  %arg5: !llvm.ptr<f32> {llvm.noalias = true}, %arg6: !llvm.ptr<f32> {llvm.noalias = true}, %arg7: i64, %arg8: i64, %arg9: i64)
+}
+
+// -----
+
+/// The arguments of the functions writing into one of their MemRef arguments
+/// are left as they are.
+func @test_written_argument(%arg0: memref<10xf32>, %arg1: memref<10xf32>) {
+  %c1 = constant 1 : index
+  %0 = krnl.load %arg0[%c1] : memref<10xf32>
+  krnl.store %0, %arg1[%c1] : memref<10xf32>
+  return
+
+  // CHECK-LABEL: llvm.func @test_written_argument
+  // CHECK-NOT:   llvm.noalias
+  // CHECK:       llvm.return
+}
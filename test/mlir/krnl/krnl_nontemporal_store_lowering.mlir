@@ -0,0 +1,16 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-affine --convert-krnl-to-llvm %s -split-input-file | FileCheck %s
+
+/// Non-temporal stores are lowered to LLVM stores with the non-temporal
+/// metadata, the other stores are not.
+func @test_nontemporal_store(%arg0: memref<10xf32>, %arg1: memref<10xf32>, %arg2: f32) {
+  %c1 = constant 1 : index
+  krnl.store %arg2, %arg0[%c1] {nontemporal} : memref<10xf32>
+  krnl.store %arg2, %arg1[%c1] : memref<10xf32>
+  return
+
+  // CHECK-LABEL: llvm.func @test_nontemporal_store
+  // CHECK: llvm.store %arg{{.*}} {nontemporal} : !llvm.ptr<f32>
+  // CHECK: llvm.store
+  // CHECK-NOT: nontemporal
+  // CHECK: llvm.return
+}
@@ -0,0 +1,103 @@
+// RUN: onnx-mlir-opt --optimize-loop-locality %s -split-input-file | FileCheck %s
+
+/// The loops are permuted so that the innermost one walks the rows of the
+/// memrefs.
+func @permute_column_walk(%arg0: memref<4x8xf32>) -> memref<4x8xf32> {
+  %0 = memref.alloc() : memref<4x8xf32>
+  %1:2 = krnl.define_loops 2
+  krnl.iterate(%1#0, %1#1) with (%1#0 -> %arg1 = 0 to 8, %1#1 -> %arg2 = 0 to 4) {
+    %2 = krnl.load %arg0[%arg2, %arg1] : memref<4x8xf32>
+    krnl.store %2, %0[%arg2, %arg1] : memref<4x8xf32>
+  }
+  return %0 : memref<4x8xf32>
+
+  // CHECK-LABEL: permute_column_walk
+  // CHECK:       [[LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK-NEXT:  krnl.permute([[LOOPS]]#0, [[LOOPS]]#1) [1, 0] : !krnl.loop, !krnl.loop
+  // CHECK-NEXT:  krnl.iterate([[LOOPS]]#1, [[LOOPS]]#0) with ([[LOOPS]]#0 -> {{.*}} = 0 to 8, [[LOOPS]]#1 -> {{.*}} = 0 to 4) {
+}
+
+// -----
+
+/// The reduction loop can move inwards, the elements of the results being
+/// still accumulated in the same order.
+func @permute_reduction(%arg0: memref<4x8xf32>, %arg1: memref<4xf32>) {
+  %0:2 = krnl.define_loops 2
+  krnl.iterate(%0#0, %0#1) with (%0#0 -> %arg2 = 0 to 8, %0#1 -> %arg3 = 0 to 4) {
+    %1 = krnl.load %arg1[%arg3] : memref<4xf32>
+    %2 = krnl.load %arg0[%arg3, %arg2] : memref<4x8xf32>
+    %3 = addf %1, %2 : f32
+    krnl.store %3, %arg1[%arg3] : memref<4xf32>
+  }
+  return
+
+  // CHECK-LABEL: permute_reduction
+  // CHECK:       [[LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK-NEXT:  krnl.permute([[LOOPS]]#0, [[LOOPS]]#1) [1, 0] : !krnl.loop, !krnl.loop
+  // CHECK-NEXT:  krnl.iterate([[LOOPS]]#1, [[LOOPS]]#0)
+}
+
+// -----
+
+/// The parallel loops stay the outermost ones.
+func @permute_after_parallel(%arg0: memref<2x4x8xf32>) -> memref<2x4x8xf32> {
+  %0 = memref.alloc() : memref<2x4x8xf32>
+  %1:3 = krnl.define_loops 3
+  krnl.parallel %1#0 : !krnl.loop
+  krnl.iterate(%1#0, %1#1, %1#2) with (%1#0 -> %arg1 = 0 to 2, %1#1 -> %arg2 = 0 to 8, %1#2 -> %arg3 = 0 to 4) {
+    %2 = krnl.load %arg0[%arg1, %arg3, %arg2] : memref<2x4x8xf32>
+    krnl.store %2, %0[%arg1, %arg3, %arg2] : memref<2x4x8xf32>
+  }
+  return %0 : memref<2x4x8xf32>
+
+  // CHECK-LABEL: permute_after_parallel
+  // CHECK:       [[LOOPS:%.+]]:3 = krnl.define_loops 3
+  // CHECK:       krnl.permute([[LOOPS]]#1, [[LOOPS]]#2) [1, 0] : !krnl.loop, !krnl.loop
+  // CHECK-NEXT:  krnl.iterate([[LOOPS]]#0, [[LOOPS]]#2, [[LOOPS]]#1)
+}
+
+// -----
+
+/// A transpose exceeding the cache is tiled, so that the tiles of both
+/// memrefs fit in the cache.
+func @tile_transpose(%arg0: memref<256x512xf32>) -> memref<512x256xf32> {
+  %0 = memref.alloc() : memref<512x256xf32>
+  %1:2 = krnl.define_loops 2
+  krnl.iterate(%1#0, %1#1) with (%1#0 -> %arg1 = 0 to 256, %1#1 -> %arg2 = 0 to 512) {
+    %2 = krnl.load %arg0[%arg1, %arg2] : memref<256x512xf32>
+    krnl.store %2, %0[%arg2, %arg1] : memref<512x256xf32>
+  }
+  return %0 : memref<512x256xf32>
+
+  // CHECK-LABEL: tile_transpose
+  // CHECK:       [[LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK-NEXT:  [[I:%.+]]:2 = krnl.block [[LOOPS]]#0 64 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK-NEXT:  [[J:%.+]]:2 = krnl.block [[LOOPS]]#1 64 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK-NEXT:  krnl.permute([[I]]#0, [[I]]#1, [[J]]#0, [[J]]#1) [0, 2, 1, 3] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+  // CHECK-NEXT:  krnl.iterate([[I]]#0, [[J]]#0, [[I]]#1, [[J]]#1) with ([[LOOPS]]#0 -> {{.*}} = 0 to 256, [[LOOPS]]#1 -> {{.*}} = 0 to 512) {
+}
+
+// -----
+
+/// Contiguous nests are left untouched, as well as the nests storing at
+/// indices computed in the loops.
+func @keep_loops(%arg0: memref<4x8xf32>, %arg1: memref<9x4xf32>) -> memref<4x8xf32> {
+  %c1 = constant 1 : index
+  %0 = memref.alloc() : memref<4x8xf32>
+  %1:2 = krnl.define_loops 2
+  krnl.iterate(%1#0, %1#1) with (%1#0 -> %arg2 = 0 to 4, %1#1 -> %arg3 = 0 to 8) {
+    %3 = krnl.load %arg0[%arg2, %arg3] : memref<4x8xf32>
+    krnl.store %3, %0[%arg2, %arg3] : memref<4x8xf32>
+  }
+  %2:2 = krnl.define_loops 2
+  krnl.iterate(%2#0, %2#1) with (%2#0 -> %arg2 = 0 to 4, %2#1 -> %arg3 = 0 to 8) {
+    %3 = krnl.load %arg0[%arg2, %arg3] : memref<4x8xf32>
+    %4 = addi %arg3, %c1 : index
+    krnl.store %3, %arg1[%4, %arg2] : memref<9x4xf32>
+  }
+  return %0 : memref<4x8xf32>
+
+  // CHECK-LABEL: keep_loops
+  // CHECK-NOT:   krnl.permute
+  // CHECK-NOT:   krnl.block
+}
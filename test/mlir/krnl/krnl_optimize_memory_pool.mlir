@@ -609,3 +609,59 @@ func @unknown_op_reuse(%arg0: memref<10x10xf32>, %arg1: memref<10x10xf32>) -> me
   // CHECK: "krnl.getref"([[MEMPOOL]], [[C400]]) : (memref<1200xi8>, i64) -> memref<10x10xf32>
   // CHECK: "krnl.getref"([[MEMPOOL]], [[C0]]) : (memref<1200xi8>, i64) -> memref<10x10xf32>
 }
+
+// -----
+
+/// 7. Slot reuse in a dynamic memory pool.
+func @dynamic_pool_slot_reuse(%arg0: memref<?x10xf32>) -> memref<?x10xf32> {
+  %c0 = constant 0 : index
+  %c40 = constant 40 : index
+  %c0_i64 = constant 0 : i64
+  %0 = memref.dim %arg0, %c0 : memref<?x10xf32>
+  %1 = muli %0, %c40 : index
+  %2 = addi %1, %1 : index
+  %3 = index_cast %1 : index to i64
+  %4 = addi %2, %1 : index
+  %5 = index_cast %2 : index to i64
+  %6 = memref.alloc(%4) : memref<?xi8>
+  %7 = "krnl.getref"(%6, %c0_i64, %0) : (memref<?xi8>, i64, index) -> memref<?x10xf32>
+  %8 = "krnl.getref"(%6, %3, %0) : (memref<?xi8>, i64, index) -> memref<?x10xf32>
+  %9 = "krnl.getref"(%6, %5, %0) : (memref<?xi8>, i64, index) -> memref<?x10xf32>
+  %10 = memref.alloc(%0) : memref<?x10xf32>
+  %11:2 = krnl.define_loops 2
+  krnl.iterate(%11#0, %11#1) with (%11#0 -> %arg1 = 0 to %0, %11#1 -> %arg2 = 0 to 10) {
+    %15 = krnl.load %arg0[%arg1, %arg2] : memref<?x10xf32>
+    krnl.store %15, %7[%arg1, %arg2] : memref<?x10xf32>
+  }
+  %12:2 = krnl.define_loops 2
+  krnl.iterate(%12#0, %12#1) with (%12#0 -> %arg1 = 0 to %0, %12#1 -> %arg2 = 0 to 10) {
+    %15 = krnl.load %7[%arg1, %arg2] : memref<?x10xf32>
+    %16 = addf %15, %15 : f32
+    krnl.store %16, %8[%arg1, %arg2] : memref<?x10xf32>
+  }
+  %13:2 = krnl.define_loops 2
+  krnl.iterate(%13#0, %13#1) with (%13#0 -> %arg1 = 0 to %0, %13#1 -> %arg2 = 0 to 10) {
+    %15 = krnl.load %8[%arg1, %arg2] : memref<?x10xf32>
+    %16 = mulf %15, %15 : f32
+    krnl.store %16, %9[%arg1, %arg2] : memref<?x10xf32>
+  }
+  %14:2 = krnl.define_loops 2
+  krnl.iterate(%14#0, %14#1) with (%14#0 -> %arg1 = 0 to %0, %14#1 -> %arg2 = 0 to 10) {
+    %15 = krnl.load %9[%arg1, %arg2] : memref<?x10xf32>
+    krnl.store %15, %10[%arg1, %arg2] : memref<?x10xf32>
+  }
+  memref.dealloc %6 : memref<?xi8>
+  return %10 : memref<?x10xf32>
+
+  // CHECK-LABEL: dynamic_pool_slot_reuse
+  // CHECK-DAG: [[C0_I64:%.+]] = constant 0 : i64
+  // CHECK: [[DIM:%.+]] = memref.dim %arg0, {{.*}} : memref<?x10xf32>
+  // CHECK: [[SIZE:%.+]] = muli [[DIM]], {{.*}} : index
+  // CHECK: [[POOL_SIZE:%.+]] = addi [[SIZE]], [[SIZE]] : index
+  // CHECK: [[OFFSET:%.+]] = index_cast [[SIZE]] : index to i64
+  // CHECK-NOT: addi
+  // CHECK: [[MEMPOOL:%.+]] = memref.alloc([[POOL_SIZE]]) : memref<?xi8>
+  // CHECK: "krnl.getref"([[MEMPOOL]], [[C0_I64]], [[DIM]]) : (memref<?xi8>, i64, index) -> memref<?x10xf32>
+  // CHECK: "krnl.getref"([[MEMPOOL]], [[OFFSET]], [[DIM]]) : (memref<?xi8>, i64, index) -> memref<?x10xf32>
+  // CHECK: "krnl.getref"([[MEMPOOL]], [[C0_I64]], [[DIM]]) : (memref<?xi8>, i64, index) -> memref<?x10xf32>
+}
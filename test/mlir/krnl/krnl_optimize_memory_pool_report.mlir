@@ -0,0 +1,44 @@
+// RUN: onnx-mlir-opt --optimize-memory-pools="report" %s -split-input-file 2>&1 | FileCheck %s
+
+/// Report of the static and dynamic memory pools, the constants and the
+/// intermediate buffers of the function.
+func @memory_report(%arg0: memref<?xf32>) -> memref<10xf32> {
+  %c0 = constant 0 : index
+  %c4 = constant 4 : index
+  %c0_i64 = constant 0 : i64
+  %c40_i64 = constant 40 : i64
+  %0 = "krnl.global"() {name = "constant_0", shape = [2], value = dense<[1, 2]> : tensor<2xi64>} : () -> memref<2xi64>
+  %1 = memref.alloc() : memref<10xf32>
+  %2 = memref.alloc() : memref<80xi8>
+  %3 = memref.dim %arg0, %c0 : memref<?xf32>
+  %4 = muli %3, %c4 : index
+  %5 = memref.alloc(%4) : memref<?xi8>
+  %6 = "krnl.getref"(%2, %c0_i64) : (memref<80xi8>, i64) -> memref<10xf32> loc("add1")
+  %7 = "krnl.getref"(%2, %c40_i64) : (memref<80xi8>, i64) -> memref<10xf32> loc("relu1")
+  %8 = "krnl.getref"(%5, %c0_i64, %3) : (memref<?xi8>, i64, index) -> memref<?xf32> loc("exp1")
+  %9 = krnl.define_loops 1
+  krnl.iterate(%9) with (%9 -> %arg1 = 0 to 10) {
+    %10 = krnl.load %arg0[%arg1] : memref<?xf32>
+    krnl.store %10, %6[%arg1] : memref<10xf32>
+    krnl.store %10, %7[%arg1] : memref<10xf32>
+    krnl.store %10, %8[%arg1] : memref<?xf32>
+    %11 = krnl.load %6[%arg1] : memref<10xf32>
+    %12 = krnl.load %7[%arg1] : memref<10xf32>
+    %13 = krnl.load %8[%arg1] : memref<?xf32>
+    %14 = addf %11, %12 : f32
+    %15 = addf %13, %14 : f32
+    krnl.store %15, %1[%arg1] : memref<10xf32>
+  }
+  memref.dealloc %5 : memref<?xi8>
+  memref.dealloc %2 : memref<80xi8>
+  return %1 : memref<10xf32>
+
+  // CHECK-LABEL: memory report of @memory_report:
+  // CHECK-NEXT:    static memory pools: 80 bytes before compaction, 80 bytes after, 80 bytes lower bound
+  // CHECK-NEXT:    dynamic memory pool: (memref.dim(%arg0, 0) * 4) bytes
+  // CHECK-NEXT:    constants: 16 bytes in 1 globals
+  // CHECK-NEXT:    intermediate buffers:
+  // CHECK-NEXT:      loc("add1"): memref<10xf32>, 40 bytes
+  // CHECK-NEXT:      loc("relu1"): memref<10xf32>, 40 bytes
+  // CHECK-NEXT:      loc("exp1"): memref<?xf32>, dynamic size
+}
@@ -144,27 +144,27 @@ func @main_graph(%arg0: memref<1x3x3xf32>, %arg1: memref<1x16x3xf32>, %arg2: mem
 }
 
 // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x3x4xf32>
-// CHECK: [[ALIGNED_MEM_POOL:%.+]] = memref.alloc() {alignment = 4096 : i64} : memref<40960xi8>
-// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<40960xi8>, i64) -> memref<1x4x1x1x32x64xf32>
-// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<40960xi8>, i64) -> memref<1x4x1x1x32x64xf32>
-// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<40960xi8>, i64) -> memref<1x4x1x1x32x64xf32>
-// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c32768_i64) : (memref<40960xi8>, i64) -> memref<1x1x1x1x32x64xf32>
-// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c32768_i64) : (memref<40960xi8>, i64) -> memref<1x1x1x1x32x64xf32>
-// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c32768_i64) : (memref<40960xi8>, i64) -> memref<1x1x1x1x32x64xf32>
-// CHECK: [[MEM_POOL:%.+]] = memref.alloc() : memref<512xi8>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c0_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c16_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c32_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c48_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c64_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c80_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c96_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c112_i64) : (memref<512xi8>, i64) -> memref<1x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c128_i64) : (memref<512xi8>, i64) -> memref<1x3x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c176_i64) : (memref<512xi8>, i64) -> memref<1x3x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c224_i64) : (memref<512xi8>, i64) -> memref<1x3x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c272_i64) : (memref<512xi8>, i64) -> memref<1x3x4xf32>
-// CHECK: "krnl.getref"([[MEM_POOL]], %c320_i64) : (memref<512xi8>, i64) -> memref<1x3x16xf32>
+// CHECK: [[ALIGNED_MEM_POOL:%.+]] = memref.alloc() {alignment = 4096 : i64} : memref<32768xi8>
+// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<32768xi8>, i64) -> memref<1x4x1x1x32x64xf32>
+// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<32768xi8>, i64) -> memref<1x4x1x1x32x64xf32>
+// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<32768xi8>, i64) -> memref<1x4x1x1x32x64xf32>
+// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<32768xi8>, i64) -> memref<1x1x1x1x32x64xf32>
+// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<32768xi8>, i64) -> memref<1x1x1x1x32x64xf32>
+// CHECK: "krnl.getref"([[ALIGNED_MEM_POOL]], %c0_i64) : (memref<32768xi8>, i64) -> memref<1x1x1x1x32x64xf32>
+// CHECK: [[MEM_POOL:%.+]] = memref.alloc() : memref<384xi8>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c0_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c16_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c32_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c48_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c64_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c80_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c96_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c112_i64) : (memref<384xi8>, i64) -> memref<1x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c192_i64) : (memref<384xi8>, i64) -> memref<1x3x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c240_i64) : (memref<384xi8>, i64) -> memref<1x3x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c288_i64) : (memref<384xi8>, i64) -> memref<1x3x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c336_i64) : (memref<384xi8>, i64) -> memref<1x3x4xf32>
+// CHECK: "krnl.getref"([[MEM_POOL]], %c0_i64) : (memref<384xi8>, i64) -> memref<1x3x16xf32>
 
 
 
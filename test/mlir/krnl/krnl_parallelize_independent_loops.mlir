@@ -0,0 +1,145 @@
+// RUN: onnx-mlir-opt --parallelize-independent-loops %s -split-input-file | FileCheck %s
+
+/// The loop nests writing distinct buffers are the tasks of a parallel loop.
+/// The operations between them are moved before it.
+func @parallelize_branches(%arg0: memref<8xf32>) -> (memref<8xf32>, memref<8xf32>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c8 = constant 8 : index
+  %0 = memref.alloc() : memref<8xf32>
+  %1 = memref.alloc() : memref<8xf32>
+  scf.for %arg1 = %c0 to %c8 step %c1 {
+    %2 = memref.load %arg0[%arg1] : memref<8xf32>
+    memref.store %2, %0[%arg1] : memref<8xf32>
+  }
+  %cst = constant 2.000000e+00 : f32
+  scf.for %arg1 = %c0 to %c8 step %c1 {
+    %2 = memref.load %arg0[%arg1] : memref<8xf32>
+    %3 = mulf %2, %cst : f32
+    memref.store %3, %1[%arg1] : memref<8xf32>
+  }
+  return %0, %1 : memref<8xf32>, memref<8xf32>
+
+  // CHECK-LABEL: parallelize_branches
+  // CHECK:         [[RES0:%.+]] = memref.alloc() : memref<8xf32>
+  // CHECK:         [[RES1:%.+]] = memref.alloc() : memref<8xf32>
+  // CHECK:         [[CST:%.+]] = constant 2.000000e+00 : f32
+  // CHECK-DAG:     [[C0:%.+]] = constant 0 : index
+  // CHECK-DAG:     [[C2:%.+]] = constant 2 : index
+  // CHECK:         scf.parallel ([[TASK:%.+]]) = ([[C0]]) to ([[C2]]) step ({{%.+}}) {
+  // CHECK:           [[IS_TASK0:%.+]] = cmpi eq, [[TASK]], {{%.+}} : index
+  // CHECK-NEXT:      scf.if [[IS_TASK0]] {
+  // CHECK-NEXT:        scf.for
+  // CHECK:               memref.store {{%.+}}, [[RES0]]
+  // CHECK:           [[IS_TASK1:%.+]] = cmpi eq, [[TASK]], {{%.+}} : index
+  // CHECK-NEXT:      scf.if [[IS_TASK1]] {
+  // CHECK-NEXT:        scf.for
+  // CHECK:               mulf {{%.+}}, [[CST]] : f32
+  // CHECK:               memref.store {{%.+}}, [[RES1]]
+  // CHECK:         return [[RES0]], [[RES1]]
+}
+
+// -----
+
+/// The loop nest reading the buffer written by the loop nest before it, and
+/// the loop nests writing the arguments, which may alias, keep their order.
+func @keep_dependent_loops(%arg0: memref<8xf32>, %arg1: memref<8xf32>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c8 = constant 8 : index
+  %0 = memref.alloc() : memref<8xf32>
+  scf.for %arg2 = %c0 to %c8 step %c1 {
+    %1 = memref.load %arg0[%arg2] : memref<8xf32>
+    memref.store %1, %0[%arg2] : memref<8xf32>
+  }
+  scf.for %arg2 = %c0 to %c8 step %c1 {
+    %1 = memref.load %0[%arg2] : memref<8xf32>
+    memref.store %1, %arg0[%arg2] : memref<8xf32>
+  }
+  scf.for %arg2 = %c0 to %c8 step %c1 {
+    %1 = memref.load %0[%arg2] : memref<8xf32>
+    memref.store %1, %arg1[%arg2] : memref<8xf32>
+  }
+  memref.dealloc %0 : memref<8xf32>
+  return
+
+  // CHECK-LABEL: keep_dependent_loops
+  // CHECK-NOT:   scf.parallel
+  // CHECK-NOT:   scf.if
+}
+
+// -----
+
+/// The slices of a memory pool at disjoint offsets are independent; those
+/// sharing bytes of the pool are not.
+func @parallelize_memory_pool_slices(%arg0: memref<8xf32>) -> memref<8xf32> {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c8 = constant 8 : index
+  %c0_i64 = constant 0 : i64
+  %c16_i64 = constant 16 : i64
+  %c32_i64 = constant 32 : i64
+  %0 = memref.alloc() : memref<64xi8>
+  %1 = "krnl.getref"(%0, %c0_i64) : (memref<64xi8>, i64) -> memref<8xf32>
+  %2 = "krnl.getref"(%0, %c32_i64) : (memref<64xi8>, i64) -> memref<8xf32>
+  %3 = "krnl.getref"(%0, %c16_i64) : (memref<64xi8>, i64) -> memref<8xf32>
+  %4 = memref.alloc() : memref<8xf32>
+  scf.for %arg1 = %c0 to %c8 step %c1 {
+    %5 = memref.load %arg0[%arg1] : memref<8xf32>
+    memref.store %5, %1[%arg1] : memref<8xf32>
+  }
+  scf.for %arg1 = %c0 to %c8 step %c1 {
+    %5 = memref.load %arg0[%arg1] : memref<8xf32>
+    memref.store %5, %2[%arg1] : memref<8xf32>
+  }
+  scf.for %arg1 = %c0 to %c8 step %c1 {
+    %5 = memref.load %3[%arg1] : memref<8xf32>
+    memref.store %5, %4[%arg1] : memref<8xf32>
+  }
+  memref.dealloc %0 : memref<64xi8>
+  return %4 : memref<8xf32>
+
+  // CHECK-LABEL: parallelize_memory_pool_slices
+  // CHECK:         [[SLICE0:%.+]] = "krnl.getref"({{%.+}}, {{%.+}}) : (memref<64xi8>, i64) -> memref<8xf32>
+  // CHECK:         [[SLICE1:%.+]] = "krnl.getref"({{%.+}}, {{%.+}}) : (memref<64xi8>, i64) -> memref<8xf32>
+  // CHECK:         [[SLICE2:%.+]] = "krnl.getref"({{%.+}}, {{%.+}}) : (memref<64xi8>, i64) -> memref<8xf32>
+  // CHECK:         scf.parallel
+  // CHECK:           scf.if
+  // CHECK:             memref.store {{%.+}}, [[SLICE0]]
+  // CHECK:           scf.if
+  // CHECK:             memref.store {{%.+}}, [[SLICE1]]
+  // CHECK-NOT:     scf.if
+  // CHECK:         scf.for
+  // CHECK-NEXT:      memref.load [[SLICE2]]
+}
+
+// -----
+
+/// The loop nests that are already parallel use the threads of the pool, and
+/// are not run as tasks, whose nested parallel loops would run sequentially.
+func @keep_parallel_loops(%arg0: memref<8xf32>) -> (memref<8xf32>, memref<8xf32>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c8 = constant 8 : index
+  %0 = memref.alloc() : memref<8xf32>
+  %1 = memref.alloc() : memref<8xf32>
+  scf.parallel (%arg1) = (%c0) to (%c8) step (%c1) {
+    %2 = memref.load %arg0[%arg1] : memref<8xf32>
+    memref.store %2, %0[%arg1] : memref<8xf32>
+  }
+  scf.for %arg1 = %c0 to %c8 step %c1 {
+    scf.parallel (%arg2) = (%c0) to (%c8) step (%c1) {
+      %2 = memref.load %arg0[%arg2] : memref<8xf32>
+      memref.store %2, %1[%arg2] : memref<8xf32>
+    }
+  }
+  return %0, %1 : memref<8xf32>, memref<8xf32>
+
+  // CHECK-LABEL: keep_parallel_loops
+  // CHECK-NOT:     scf.if
+  // CHECK:         scf.parallel
+  // CHECK:           memref.store
+  // CHECK:         scf.for
+  // CHECK-NEXT:      scf.parallel
+  // CHECK-NOT:     scf.if
+}
@@ -0,0 +1,53 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm %s -split-input-file | FileCheck %s
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm='blas-library=dnnl' %s -split-input-file | FileCheck --check-prefix=DNNL %s
+
+/// The sgemm calls pass the row-major layout, the transpositions, the sizes of
+/// the product, alpha, then the address of the first element and the row
+/// stride of each matrix, and beta before C.
+func @test_sgemm(%A: memref<16x8xf32>, %B: memref<16x32xf32>, %C: memref<8x32xf32>) {
+  krnl.sgemm %A[], %B[], %C[] {transA = true, alpha = 2.0 : f32, beta = 0.0 : f32} : memref<16x8xf32>, memref<16x32xf32>, memref<8x32xf32>
+  return
+
+  // CHECK: llvm.func @cblas_sgemm(i32, i32, i32, i32, i32, i32, f32, !llvm.ptr<f32>, i32, !llvm.ptr<f32>, i32, f32, !llvm.ptr<f32>, i32)
+  // CHECK-LABEL: llvm.func @test_sgemm
+  // CHECK: [[A_PTR:%.+]] = llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[LDA:%.+]] = llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[B_PTR:%.+]] = llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[LDB:%.+]] = llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[C_PTR:%.+]] = llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[LDC:%.+]] = llvm.extractvalue {{.*}}[4, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[M:%.+]] = llvm.extractvalue {{.*}}[3, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[N:%.+]] = llvm.extractvalue {{.*}}[3, 1] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK: [[K:%.+]] = llvm.extractvalue {{.*}}[3, 0] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)>
+  // CHECK-DAG: [[ALPHA:%.+]] = llvm.mlir.constant(2.000000e+00 : f32) : f32
+  // CHECK-DAG: [[BETA:%.+]] = llvm.mlir.constant(0.000000e+00 : f32) : f32
+  // CHECK-DAG: [[ROW_MAJOR:%.+]] = llvm.mlir.constant(101 : i32) : i32
+  // CHECK-DAG: [[TRANS:%.+]] = llvm.mlir.constant(112 : i32) : i32
+  // CHECK-DAG: [[NO_TRANS:%.+]] = llvm.mlir.constant(111 : i32) : i32
+  // CHECK-DAG: [[M_I32:%.+]] = llvm.trunc [[M]] : i64 to i32
+  // CHECK-DAG: [[N_I32:%.+]] = llvm.trunc [[N]] : i64 to i32
+  // CHECK-DAG: [[K_I32:%.+]] = llvm.trunc [[K]] : i64 to i32
+  // CHECK-DAG: [[LDA_I32:%.+]] = llvm.trunc [[LDA]] : i64 to i32
+  // CHECK-DAG: [[LDB_I32:%.+]] = llvm.trunc [[LDB]] : i64 to i32
+  // CHECK-DAG: [[LDC_I32:%.+]] = llvm.trunc [[LDC]] : i64 to i32
+  // CHECK: llvm.call @cblas_sgemm([[ROW_MAJOR]], [[TRANS]], [[NO_TRANS]], [[M_I32]], [[N_I32]], [[K_I32]], [[ALPHA]], [[A_PTR]], [[LDA_I32]], [[B_PTR]], [[LDB_I32]], [[BETA]], [[C_PTR]], [[LDC_I32]]) : (i32, i32, i32, i32, i32, i32, f32, !llvm.ptr<f32>, i32, !llvm.ptr<f32>, i32, f32, !llvm.ptr<f32>, i32) -> ()
+
+  // DNNL: llvm.func @dnnl_sgemm(i8, i8, i64, i64, i64, f32, !llvm.ptr<f32>, i64, !llvm.ptr<f32>, i64, f32, !llvm.ptr<f32>, i64) -> i32
+  // DNNL-LABEL: llvm.func @test_sgemm
+  // DNNL-DAG: [[TRANS:%.+]] = llvm.mlir.constant(84 : i8) : i8
+  // DNNL-DAG: [[NO_TRANS:%.+]] = llvm.mlir.constant(78 : i8) : i8
+  // DNNL: llvm.call @dnnl_sgemm([[TRANS]], [[NO_TRANS]], {{.*}}) : (i8, i8, i64, i64, i64, f32, !llvm.ptr<f32>, i64, !llvm.ptr<f32>, i64, f32, !llvm.ptr<f32>, i64) -> i32
+}
+
+// -----
+
+/// The matrices of higher rank memrefs are selected by the prefix indices.
+func @test_sgemm_prefix(%A: memref<4x8x16xf32>, %B: memref<16x32xf32>, %C: memref<4x8x32xf32>, %n: index) {
+  krnl.sgemm %A[%n], %B[], %C[%n] {beta = 1.0 : f32} : memref<4x8x16xf32>, memref<16x32xf32>, memref<4x8x32xf32>
+  return
+
+  // CHECK-LABEL: llvm.func @test_sgemm_prefix
+  // CHECK: llvm.getelementptr {{.*}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: llvm.extractvalue {{.*}}[4, 1] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<3 x i64>, array<3 x i64>)>
+  // CHECK: llvm.call @cblas_sgemm
+}
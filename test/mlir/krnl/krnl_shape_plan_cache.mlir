@@ -0,0 +1,75 @@
+// RUN: onnx-mlir-opt --shape-plan-cache="min-ops=4" %s -split-input-file | FileCheck %s
+
+#map0 = affine_map<()[s0, s1] -> (s0 * s1 * 4)>
+#map1 = affine_map<()[s0] -> (((s0 * 4 + 63) floordiv 64) * 64)>
+#map2 = affine_map<()[s0] -> (s0, 1)>
+
+/// The size of the pool, the offset of the buffer and the loop bound are
+/// computed from the input dims on a cache miss only. The intermediate values
+/// are not cached.
+func @cache_shapes(%arg0: memref<?x?xf32>) -> memref<?xf32> {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf32>
+  %1 = memref.dim %arg0, %c1 : memref<?x?xf32>
+  %2 = affine.apply #map0()[%0, %1]
+  %3 = affine.apply #map1()[%1]
+  %4 = addi %2, %3 : index
+  %5 = index_cast %3 : index to i64
+  %6 = muli %0, %1 : index
+  %7 = affine.max #map2()[%6]
+  %8 = memref.alloc(%4) : memref<?xi8>
+  %9 = "krnl.getref"(%8, %5, %0) : (memref<?xi8>, i64, index) -> memref<?xf32>
+  %10 = krnl.define_loops 1
+  krnl.iterate(%10) with (%10 -> %arg1 = 0 to %7) {
+    %11 = constant 0.0 : f32
+    krnl.store %11, %9[%arg1] : memref<?xf32>
+  }
+  return %9 : memref<?xf32>
+
+  // CHECK-LABEL: cache_shapes
+  // CHECK: [[DIM0:%.+]] = memref.dim %arg0, %c0 : memref<?x?xf32>
+  // CHECK: [[DIM1:%.+]] = memref.dim %arg0, %c1 : memref<?x?xf32>
+  // CHECK: [[CACHE:%.+]] = "krnl.arena"() {id = 0 : i64, threadLocal, zeroInit} : () -> memref<6xi64>
+  // CHECK: [[VALID:%.+]] = krnl.load [[CACHE]][{{%.+}}] : memref<6xi64>
+  // CHECK: [[HIT0:%.+]] = cmpi eq, [[VALID]], {{%.+}} : i64
+  // CHECK: [[KEY0:%.+]] = index_cast [[DIM0]] : index to i64
+  // CHECK: [[CACHED_KEY0:%.+]] = krnl.load [[CACHE]][{{%.+}}] : memref<6xi64>
+  // CHECK: [[SAME_KEY0:%.+]] = cmpi eq, [[CACHED_KEY0]], [[KEY0]] : i64
+  // CHECK: [[HIT1:%.+]] = and [[HIT0]], [[SAME_KEY0]] : i1
+  // CHECK: [[KEY1:%.+]] = index_cast [[DIM1]] : index to i64
+  // CHECK: [[CACHED_KEY1:%.+]] = krnl.load [[CACHE]][{{%.+}}] : memref<6xi64>
+  // CHECK: [[SAME_KEY1:%.+]] = cmpi eq, [[CACHED_KEY1]], [[KEY1]] : i64
+  // CHECK: [[HIT:%.+]] = and [[HIT1]], [[SAME_KEY1]] : i1
+  // CHECK: [[SHAPES:%.+]]:3 = scf.if [[HIT]] -> (index, i64, index) {
+  // CHECK:   krnl.load [[CACHE]]
+  // CHECK:   scf.yield {{%.+}}, {{%.+}}, {{%.+}} : index, i64, index
+  // CHECK: } else {
+  // CHECK:   affine.apply
+  // CHECK:   affine.apply
+  // CHECK:   [[SIZE:%.+]] = addi
+  // CHECK:   [[OFFSET:%.+]] = index_cast
+  // CHECK:   [[BOUND:%.+]] = affine.max
+  // CHECK:   krnl.store {{%.+}}, [[CACHE]]
+  // CHECK:   scf.yield [[SIZE]], [[OFFSET]], [[BOUND]] : index, i64, index
+  // CHECK: }
+  // CHECK: [[POOL:%.+]] = memref.alloc([[SHAPES]]#0) : memref<?xi8>
+  // CHECK: "krnl.getref"([[POOL]], [[SHAPES]]#1, {{%.+}}) : (memref<?xi8>, i64, index) -> memref<?xf32>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}}[[SHAPES]]#2{{.*}}) {
+}
+
+// -----
+
+/// Too few computations to cache.
+func @small_shapes(%arg0: memref<?xf32>) -> memref<?xf32> {
+  %c0 = constant 0 : index
+  %0 = memref.dim %arg0, %c0 : memref<?xf32>
+  %1 = affine.apply affine_map<()[s0] -> (s0 * 2)>()[%0]
+  %2 = memref.alloc(%1) : memref<?xf32>
+  return %2 : memref<?xf32>
+
+  // CHECK-LABEL: small_shapes
+  // CHECK-NOT: krnl.arena
+  // CHECK-NOT: scf.if
+  // CHECK: return
+}
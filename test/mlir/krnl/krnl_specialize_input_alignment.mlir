@@ -0,0 +1,31 @@
+// RUN: onnx-mlir-opt --specialize-input-alignment=alignment=128 %s -split-input-file | FileCheck %s
+
+/// The aligned clone assumes the alignment of all its inputs and is recorded
+/// last with the shapes of the inputs.
+func @main_graph(%arg0: memref<?x10xf32>, %arg1: memref<10xf32>) -> memref<?x10xf32> {
+  return %arg0 : memref<?x10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK-LABEL: func @main_graph_aligned
+// CHECK-SAME:    ([[ARG0:%.+]]: memref<?x10xf32>, [[ARG1:%.+]]: memref<10xf32>)
+// CHECK-NEXT:    memref.assume_alignment [[ARG0]], 128 : memref<?x10xf32>
+// CHECK-NEXT:    memref.assume_alignment [[ARG1]], 128 : memref<10xf32>
+// CHECK:       func @main_graph
+// CHECK-NOT:     memref.assume_alignment
+// CHECK:       "krnl.entry_point"() {func = @main_graph, {{.*}}specializations = [{alignment = 128 : i64, func = @main_graph_aligned, shapes = {{\[}}[-1, 10], [10]]}]}
+
+// -----
+
+/// Each shape specialization is preceded by its aligned version.
+func @main_graph_spec0(%arg0: memref<1x10xf32>) -> memref<1x10xf32> {
+  return %arg0 : memref<1x10xf32>
+}
+func @main_graph(%arg0: memref<?x10xf32>) -> memref<?x10xf32> {
+  return %arg0 : memref<?x10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[in]@[out]", specializations = [{func = @main_graph_spec0, shapes = [[1, 10]]}]} : () -> ()
+
+// CHECK-LABEL: func @main_graph_spec0_aligned
+// CHECK-NEXT:    memref.assume_alignment
+// CHECK:       "krnl.entry_point"() {func = @main_graph, {{.*}}specializations = [{alignment = 128 : i64, func = @main_graph_spec0_aligned, shapes = {{\[}}[1, 10]]}, {func = @main_graph_spec0, shapes = {{\[}}[1, 10]]}, {alignment = 128 : i64, func = @main_graph_aligned, shapes = {{\[}}[-1, 10]]}]}
@@ -0,0 +1,54 @@
+// RUN: onnx-mlir-opt --krnl-stack-allocation %s -split-input-file | FileCheck %s
+// RUN: onnx-mlir-opt --krnl-stack-allocation="max-bytes=16" %s -split-input-file | FileCheck %s --check-prefix=SMALL
+
+/// The small temporary buffers are allocated on the stack, not the returned
+/// or large ones.
+func @small_temporaries(%arg0: memref<4xf32>) -> memref<4xf32> {
+  %0 = memref.alloc() : memref<4xf32>
+  %1 = memref.alloc() {alignment = 16 : i64} : memref<8xf32>
+  %2 = memref.alloc() : memref<1024xf32>
+  %3 = krnl.define_loops 1
+  krnl.iterate(%3) with (%3 -> %arg1 = 0 to 4) {
+    %4 = krnl.load %arg0[%arg1] : memref<4xf32>
+    krnl.store %4, %1[%arg1] : memref<8xf32>
+    krnl.store %4, %2[%arg1] : memref<1024xf32>
+    %5 = krnl.load %1[%arg1] : memref<8xf32>
+    %6 = krnl.load %2[%arg1] : memref<1024xf32>
+    %7 = addf %5, %6 : f32
+    krnl.store %7, %0[%arg1] : memref<4xf32>
+  }
+  memref.dealloc %2 : memref<1024xf32>
+  memref.dealloc %1 : memref<8xf32>
+  return %0 : memref<4xf32>
+
+  // CHECK-LABEL: small_temporaries
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<4xf32>
+  // CHECK: [[SMALL:%.+]] = memref.alloca() {alignment = 16 : i64} : memref<8xf32>
+  // CHECK: [[LARGE:%.+]] = memref.alloc() : memref<1024xf32>
+  // CHECK: krnl.store {{.*}}, [[SMALL]]{{.}}{{.*}}{{.}} : memref<8xf32>
+  // CHECK: memref.dealloc [[LARGE]] : memref<1024xf32>
+  // CHECK-NOT: memref.dealloc
+  // CHECK: return [[RES]] : memref<4xf32>
+
+  // SMALL-LABEL: small_temporaries
+  // SMALL: memref.alloc() {alignment = 16 : i64} : memref<8xf32>
+  // SMALL-NOT: memref.alloca
+}
+
+// -----
+
+/// The buffers allocated in a loop body stay on the heap.
+func @loop_body_alloc(%arg0: memref<4xf32>) {
+  %0 = krnl.define_loops 1
+  krnl.iterate(%0) with (%0 -> %arg1 = 0 to 4) {
+    %1 = memref.alloc() : memref<4xf32>
+    %2 = krnl.load %arg0[%arg1] : memref<4xf32>
+    krnl.store %2, %1[%arg1] : memref<4xf32>
+    memref.dealloc %1 : memref<4xf32>
+  }
+  return
+
+  // CHECK-LABEL: loop_body_alloc
+  // CHECK-NOT: memref.alloca
+  // CHECK: memref.alloc() : memref<4xf32>
+}
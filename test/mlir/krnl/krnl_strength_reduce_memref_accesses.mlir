@@ -0,0 +1,91 @@
+// RUN: onnx-mlir-opt --strength-reduce-memref-accesses %s -split-input-file | FileCheck %s
+
+/// The accesses of the innermost loop use offsets in flat views, carried by
+/// the loop and incremented by the strides of the induction variable.
+func @strength_reduce_transpose(%arg0: memref<4x8xf32>, %arg1: memref<8x4xf32>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c4 = constant 4 : index
+  %c8 = constant 8 : index
+  scf.for %arg2 = %c0 to %c4 step %c1 {
+    scf.for %arg3 = %c0 to %c8 step %c1 {
+      %0 = memref.load %arg0[%arg2, %arg3] : memref<4x8xf32>
+      memref.store %0, %arg1[%arg3, %arg2] : memref<8x4xf32>
+    }
+  }
+  return
+
+  // CHECK-LABEL: strength_reduce_transpose
+  // CHECK:         scf.for [[I:%.+]] =
+  // CHECK-DAG:       [[A:%.+]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [32], strides: [1] : memref<4x8xf32> to memref<32xf32>
+  // CHECK-DAG:       [[B:%.+]] = memref.reinterpret_cast %arg1 to offset: [0], sizes: [32], strides: [1] : memref<8x4xf32> to memref<32xf32>
+  // CHECK-DAG:       [[INC_A:%.+]] = constant 1 : index
+  // CHECK-DAG:       [[INC_B:%.+]] = constant 4 : index
+  // CHECK:           scf.for {{.*}} iter_args([[OFF_A:%.+]] = {{%.+}}, [[OFF_B:%.+]] = {{%.+}}) -> (index, index) {
+  // CHECK-NEXT:        [[VAL:%.+]] = memref.load [[A]]{{\[}}[[OFF_A]]{{\]}} : memref<32xf32>
+  // CHECK-NEXT:        memref.store [[VAL]], [[B]]{{\[}}[[OFF_B]]{{\]}} : memref<32xf32>
+  // CHECK-NEXT:        [[NEXT_A:%.+]] = addi [[OFF_A]], [[INC_A]] : index
+  // CHECK-NEXT:        [[NEXT_B:%.+]] = addi [[OFF_B]], [[INC_B]] : index
+  // CHECK-NEXT:        scf.yield [[NEXT_A]], [[NEXT_B]] : index, index
+}
+
+// -----
+
+/// The offsets of the first iteration are computed from the index arithmetic
+/// of the lowered affine maps, and incremented by the step of the loop.
+func @strength_reduce_step(%arg0: memref<4x16xf32>, %arg1: memref<4x8xf32>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c2 = constant 2 : index
+  %c4 = constant 4 : index
+  %c8 = constant 8 : index
+  scf.for %arg2 = %c0 to %c4 step %c1 {
+    scf.for %arg3 = %c0 to %c8 step %c2 {
+      %0 = muli %arg3, %c2 : index
+      %1 = addi %0, %c1 : index
+      %2 = memref.load %arg0[%arg2, %1] : memref<4x16xf32>
+      memref.store %2, %arg1[%arg2, %arg3] : memref<4x8xf32>
+    }
+  }
+  return
+
+  // CHECK-LABEL: strength_reduce_step
+  // CHECK:         scf.for [[I:%.+]] = [[C0:%.+]] to
+  // CHECK-DAG:       [[C16:%.+]] = constant 16 : index
+  // CHECK-DAG:       [[ROW_A:%.+]] = muli [[I]], [[C16]] : index
+  // CHECK-DAG:       [[J_2:%.+]] = muli [[C0]], [[C2:%.+]] : index
+  // CHECK-DAG:       [[J_2_1:%.+]] = addi [[J_2]], [[C1:%.+]] : index
+  // CHECK-DAG:       [[FIRST_A:%.+]] = addi [[ROW_A]], [[J_2_1]] : index
+  // CHECK-DAG:       [[INC_A:%.+]] = constant 4 : index
+  // CHECK-DAG:       [[C8:%.+]] = constant 8 : index
+  // CHECK-DAG:       [[ROW_B:%.+]] = muli [[I]], [[C8]] : index
+  // CHECK-DAG:       [[FIRST_B:%.+]] = addi [[ROW_B]], [[C0]] : index
+  // CHECK-DAG:       [[INC_B:%.+]] = constant 2 : index
+  // CHECK:           scf.for {{.*}} iter_args([[OFF_A:%.+]] = [[FIRST_A]], [[OFF_B:%.+]] = [[FIRST_B]]) -> (index, index) {
+  // CHECK-NOT:         muli
+  // CHECK:             memref.load {{.*}}{{\[}}[[OFF_A]]{{\]}} : memref<64xf32>
+  // CHECK:             memref.store {{.*}}{{\[}}[[OFF_B]]{{\]}} : memref<32xf32>
+  // CHECK:             addi [[OFF_A]], [[INC_A]] : index
+  // CHECK:             addi [[OFF_B]], [[INC_B]] : index
+}
+
+// -----
+
+/// The accesses to the MemRefs with dynamic shapes, and the 1-D accesses at
+/// the induction variable, are left untouched.
+func @keep_accesses(%arg0: memref<?x8xf32>, %arg1: memref<8xf32>, %arg2: index) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c8 = constant 8 : index
+  scf.for %arg3 = %c0 to %arg2 step %c1 {
+    scf.for %arg4 = %c0 to %c8 step %c1 {
+      %0 = memref.load %arg0[%arg3, %arg4] : memref<?x8xf32>
+      memref.store %0, %arg1[%arg4] : memref<8xf32>
+    }
+  }
+  return
+
+  // CHECK-LABEL: keep_accesses
+  // CHECK-NOT:   memref.reinterpret_cast
+  // CHECK-NOT:   iter_args
+}
@@ -0,0 +1,61 @@
+// RUN: onnx-mlir-opt --trace-memory-pools %s -split-input-file | FileCheck %s
+
+/// The allocations and deallocations of the static and dynamic memory pools
+/// are surrounded by instrumentation points, the other buffers are not.
+func @trace_pools(%arg0: memref<10xf32>, %arg1: index) -> memref<10xf32> {
+  %c0_i64 = constant 0 : i64
+  %0 = memref.alloc() : memref<10xf32>
+  %1 = memref.alloc() {alignment = 16 : i64} : memref<40xi8>
+  %2 = memref.alloc(%arg1) : memref<?xi8>
+  %3 = "krnl.getref"(%1, %c0_i64) : (memref<40xi8>, i64) -> memref<10xf32>
+  %4 = "krnl.getref"(%2, %c0_i64) : (memref<?xi8>, i64) -> memref<10xf32>
+  %5 = krnl.define_loops 1
+  krnl.iterate(%5) with (%5 -> %arg2 = 0 to 10) {
+    %6 = krnl.load %arg0[%arg2] : memref<10xf32>
+    krnl.store %6, %3[%arg2] : memref<10xf32>
+    krnl.store %6, %4[%arg2] : memref<10xf32>
+    krnl.store %6, %0[%arg2] : memref<10xf32>
+  }
+  memref.dealloc %2 : memref<?xi8>
+  memref.dealloc %1 : memref<40xi8>
+  return %0 : memref<10xf32>
+
+  // CHECK-LABEL: trace_pools
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10xf32>
+  // CHECK-NEXT: "krnl.instrument"() {nodeName = "static", opName = "MemoryPool", tag = 0 : i64} : () -> ()
+  // CHECK-NEXT: [[STATIC:%.+]] = memref.alloc() {alignment = 16 : i64} : memref<40xi8>
+  // CHECK-NEXT: "krnl.instrument"([[STATIC]]) {nodeName = "static", opName = "MemoryPool", tag = 1 : i64} : (memref<40xi8>) -> ()
+  // CHECK-NEXT: "krnl.instrument"() {nodeName = "dynamic", opName = "MemoryPool", tag = 0 : i64} : () -> ()
+  // CHECK-NEXT: [[DYNAMIC:%.+]] = memref.alloc(%arg1) : memref<?xi8>
+  // CHECK-NEXT: "krnl.instrument"([[DYNAMIC]]) {nodeName = "dynamic", opName = "MemoryPool", tag = 1 : i64} : (memref<?xi8>) -> ()
+  // CHECK: "krnl.instrument"() {nodeName = "dynamic", opName = "MemoryPoolFree", tag = 0 : i64} : () -> ()
+  // CHECK-NEXT: memref.dealloc [[DYNAMIC]] : memref<?xi8>
+  // CHECK-NEXT: "krnl.instrument"([[DYNAMIC]]) {nodeName = "dynamic", opName = "MemoryPoolFree", tag = 1 : i64} : (memref<?xi8>) -> ()
+  // CHECK-NEXT: "krnl.instrument"() {nodeName = "static", opName = "MemoryPoolFree", tag = 0 : i64} : () -> ()
+  // CHECK-NEXT: memref.dealloc [[STATIC]] : memref<40xi8>
+  // CHECK-NEXT: "krnl.instrument"([[STATIC]]) {nodeName = "static", opName = "MemoryPoolFree", tag = 1 : i64} : (memref<40xi8>) -> ()
+  // CHECK-NEXT: return [[RES]] : memref<10xf32>
+}
+
+// -----
+
+/// The buffers of the memory arenas are traced where they are requested.
+func @trace_arenas(%arg0: memref<10xf32>, %arg1: index) -> memref<10xf32> {
+  %c0_i64 = constant 0 : i64
+  %0 = memref.alloc() : memref<10xf32>
+  %1 = "krnl.arena"(%arg1) {id = 0 : i64} : (index) -> memref<?xi8>
+  %2 = "krnl.getref"(%1, %c0_i64) : (memref<?xi8>, i64) -> memref<10xf32>
+  %3 = krnl.define_loops 1
+  krnl.iterate(%3) with (%3 -> %arg2 = 0 to 10) {
+    %4 = krnl.load %arg0[%arg2] : memref<10xf32>
+    krnl.store %4, %2[%arg2] : memref<10xf32>
+    krnl.store %4, %0[%arg2] : memref<10xf32>
+  }
+  return %0 : memref<10xf32>
+
+  // CHECK-LABEL: trace_arenas
+  // CHECK: "krnl.instrument"() {nodeName = "dynamic arena", opName = "MemoryPool", tag = 0 : i64} : () -> ()
+  // CHECK-NEXT: [[ARENA:%.+]] = "krnl.arena"(%arg1) {id = 0 : i64} : (index) -> memref<?xi8>
+  // CHECK-NEXT: "krnl.instrument"([[ARENA]]) {nodeName = "dynamic arena", opName = "MemoryPool", tag = 1 : i64} : (memref<?xi8>) -> ()
+  // CHECK-NOT: krnl.instrument
+}
@@ -0,0 +1,29 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-llvm="unchecked=true" %s -split-input-file | FileCheck %s
+
+/// The inputs of the unchecked entry points are not checked against their
+/// signature, their buffers are distinct and their dynamic dims positive.
+func @main_graph(%arg0: memref<?x10xf32>, %arg1: memref<?xf32>) -> memref<?x10xf32> {
+  return %arg0 : memref<?x10xf32>
+}
+"krnl.entry_point"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32, signature = "[in]@[out]"} : () -> ()
+
+// CHECK-LABEL: llvm.func internal @main_graph
+// CHECK-SAME:  (%arg0: !llvm.ptr<f32> {llvm.noalias = true}, %arg1: !llvm.ptr<f32> {llvm.noalias = true}, %arg2: i64, %arg3: i64, %arg4: i64, %arg5: i64, %arg6: i64,
+// CHECK-SAME:  %arg7: !llvm.ptr<f32> {llvm.noalias = true}, %arg8: !llvm.ptr<f32> {llvm.noalias = true}, %arg9: i64, %arg10: i64, %arg11: i64)
+// CHECK:         [[ZERO0:%.+]] = llvm.mlir.constant(0 : i64) : i64
+// CHECK:         [[POSITIVE0:%.+]] = llvm.icmp "sgt" %arg3, [[ZERO0]] : i64
+// CHECK:         llvm.call @llvm.assume([[POSITIVE0]]) : (i1) -> ()
+// CHECK:         [[ZERO1:%.+]] = llvm.mlir.constant(0 : i64) : i64
+// CHECK:         [[POSITIVE1:%.+]] = llvm.icmp "sgt" %arg10, [[ZERO1]] : i64
+// CHECK:         llvm.call @llvm.assume([[POSITIVE1]]) : (i1) -> ()
+
+// CHECK:         llvm.mlir.global internal constant @_in_signature_table
+// CHECK:         llvm.func @omInputSignatureTable() -> !llvm.ptr<i8>
+
+// CHECK-LABEL: llvm.func @run_main_graph({{.*}}: !llvm.ptr<i8>) -> !llvm.ptr<i8>
+// CHECK-NOT:     omTensorListCheckSignature
+// CHECK:         llvm.call @_mlir_ciface_main_graph
+
+// CHECK-LABEL: llvm.func @run_main_graph_into
+// CHECK-NOT:     omTensorListCheckSignature
+// CHECK:         llvm.call @_mlir_ciface_main_graph
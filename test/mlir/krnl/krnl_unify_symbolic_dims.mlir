@@ -0,0 +1,35 @@
+// RUN: onnx-mlir-opt --unify-symbolic-dims %s -split-input-file | FileCheck %s
+
+/// The batch dims of both inputs are the same dim, the seq_len and unnamed
+/// dims are not unified with it.
+func @unify_batch(%arg0: memref<?x?xf32>, %arg1: memref<?x10xf32>, %arg2: memref<?xf32>) -> (index, index, index, index) attributes {input_dim_params = [["batch", "seq_len"], ["batch", ""], [""]]} {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf32>
+  %1 = memref.dim %arg1, %c0 : memref<?x10xf32>
+  %2 = memref.dim %arg0, %c1 : memref<?x?xf32>
+  %3 = memref.dim %arg2, %c0 : memref<?xf32>
+  return %0, %1, %2, %3 : index, index, index, index
+
+  // CHECK-LABEL: unify_batch
+  // CHECK:       [[BATCH:%.+]] = memref.dim %arg0, %c0{{.*}} : memref<?x?xf32>
+  // CHECK:       [[SEQ:%.+]] = memref.dim %arg0, %c1{{.*}} : memref<?x?xf32>
+  // CHECK-NOT:   memref.dim %arg1
+  // CHECK:       [[UNNAMED:%.+]] = memref.dim %arg2, %c0{{.*}} : memref<?xf32>
+  // CHECK:       return [[BATCH]], [[BATCH]], [[SEQ]], [[UNNAMED]] : index, index, index, index
+}
+
+// -----
+
+/// Without symbolic names, the dims are left unchanged.
+func @no_dim_params(%arg0: memref<?xf32>, %arg1: memref<?xf32>) -> (index, index) {
+  %c0 = constant 0 : index
+  %0 = memref.dim %arg0, %c0 : memref<?xf32>
+  %1 = memref.dim %arg1, %c0 : memref<?xf32>
+  return %0, %1 : index, index
+
+  // CHECK-LABEL: no_dim_params
+  // CHECK:       [[DIM0:%.+]] = memref.dim %arg0, %c0 : memref<?xf32>
+  // CHECK:       [[DIM1:%.+]] = memref.dim %arg1, %c0 : memref<?xf32>
+  // CHECK:       return [[DIM0]], [[DIM1]] : index, index
+}
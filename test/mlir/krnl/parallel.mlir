@@ -0,0 +1,38 @@
+// RUN: onnx-mlir-opt --convert-krnl-to-affine %s -split-input-file | FileCheck %s
+
+func @simple_parallel(%arg0 : memref<16x8xf32>) {
+  %ii, %ij = krnl.define_loops 2
+  krnl.parallel %ii : !krnl.loop
+  krnl.iterate(%ii, %ij) with (%ii -> %i = 0 to 16, %ij -> %j = 0 to 8) {
+    %cst = constant 1.0 : f32
+    krnl.store %cst, %arg0[%i, %j] : memref<16x8xf32>
+  }
+  return
+
+  // CHECK-LABEL: simple_parallel
+  // CHECK:       affine.parallel ([[I:%.+]]) = (0) to (16) {
+  // CHECK:         affine.for [[J:%.+]] = 0 to 8 {
+  // CHECK:           affine.store {{.*}}, %arg0{{\[}}[[I]], [[J]]{{\]}} : memref<16x8xf32>
+  // CHECK:         }
+  // CHECK:       }
+}
+
+// -----
+
+func @parallel_tiled_loop(%arg0 : memref<64xf32>) {
+  %ii = krnl.define_loops 1
+  %ib, %il = krnl.block %ii 16 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  krnl.parallel %ib : !krnl.loop
+  krnl.iterate(%ib, %il) with (%ii -> %i = 0 to 64) {
+    %cst = constant 1.0 : f32
+    krnl.store %cst, %arg0[%i] : memref<64xf32>
+  }
+  return
+
+  // CHECK-LABEL: parallel_tiled_loop
+  // CHECK:       affine.parallel ([[IB:%.+]]) = (0) to (64) step (16) {
+  // CHECK:         affine.for [[IL:%.+]] = #map{{.*}}([[IB]]) to #map{{.*}}([[IB]]) {
+  // CHECK:           affine.store {{.*}}, %arg0{{\[}}[[IL]]{{\]}} : memref<64xf32>
+  // CHECK:         }
+  // CHECK:       }
+}
@@ -17,9 +17,13 @@ func @test_reshape(%arg0 : tensor<?x10xf32>, %arg1 : tensor<4xi64>) -> tensor<*x
   // CHECK: [[TMP1:%.+]] = llvm.insertvalue %arg6, %6[4, 1] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)> 
   // CHECK: [[RES:%.+]] = llvm.insertvalue {{.*}}[4, 3] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<4 x i64>, array<4 x i64>)> 
   // CHECK: [[EXT_VAL_0:%.+]] = llvm.extractvalue [[RES]][1] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<4 x i64>, array<4 x i64>)> 
-  // CHECK: [[DST:%.+]] = llvm.bitcast [[EXT_VAL_0]] : !llvm.ptr<f32> to !llvm.ptr<i8>
+  // CHECK: [[OFF_0:%.+]] = llvm.extractvalue [[RES]][2] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<4 x i64>, array<4 x i64>)> 
+  // CHECK: [[GEP_0:%.+]] = llvm.getelementptr [[EXT_VAL_0]]{{.}}[[OFF_0]]{{.}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[DST:%.+]] = llvm.bitcast [[GEP_0]] : !llvm.ptr<f32> to !llvm.ptr<i8>
   // CHECK: [[EXT_VAL_1:%.+]] = llvm.extractvalue [[TMP1]][1] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)> 
-  // CHECK: [[SRC:%.+]] = llvm.bitcast [[EXT_VAL_1]] : !llvm.ptr<f32> to !llvm.ptr<i8>
+  // CHECK: [[OFF_1:%.+]] = llvm.extractvalue [[TMP1]][2] : !llvm.struct<(ptr<f32>, ptr<f32>, i64, array<2 x i64>, array<2 x i64>)> 
+  // CHECK: [[GEP_1:%.+]] = llvm.getelementptr [[EXT_VAL_1]]{{.}}[[OFF_1]]{{.}} : (!llvm.ptr<f32>, i64) -> !llvm.ptr<f32>
+  // CHECK: [[SRC:%.+]] = llvm.bitcast [[GEP_1]] : !llvm.ptr<f32> to !llvm.ptr<i8>
   // CHECK: [[SIZE:%.+]] = llvm.sext %{{.*}} : i64 to i64
   // CHECK: [[VOLATILE:%.+]] = llvm.mlir.constant(false) : i1
   // CHECK: llvm.call @llvm.memcpy.p0i8.p0i8.i64([[DST]], [[SRC]], [[SIZE]], [[VOLATILE]]) : (!llvm.ptr<i8>, !llvm.ptr<i8>, i64, i1) -> ()
@@ -0,0 +1,45 @@
+// RUN: onnx-mlir-opt --assign-layout-onnx %s -split-input-file | FileCheck %s
+// RUN: onnx-mlir-opt --assign-layout-onnx="block-size=16" %s -split-input-file | FileCheck %s --check-prefix=BLOCK16
+
+/// The Conv, Relu and MaxPool run in the blocked layout, the input and the
+/// result being reordered at the boundaries of the region only.
+func @test_blocked_region(%arg0: tensor<1x16x8x8xf32>, %arg1: tensor<16x16x3x3xf32>, %arg2: tensor<16xf32>) -> tensor<1x16x4x4xf32> {
+  %0 = "onnx.Conv"(%arg0, %arg1, %arg2) {auto_pad = "NOTSET", dilations = [1, 1], group = 1 : si64, kernel_shape = [3, 3], pads = [1, 1, 1, 1], strides = [1, 1]} : (tensor<1x16x8x8xf32>, tensor<16x16x3x3xf32>, tensor<16xf32>) -> tensor<1x16x8x8xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<1x16x8x8xf32>) -> tensor<1x16x8x8xf32>
+  %2 = "onnx.MaxPoolSingleOut"(%1) {auto_pad = "NOTSET", ceil_mode = 0 : si64, kernel_shape = [2, 2], pads = [0, 0, 0, 0], storage_order = 0 : si64, strides = [2, 2]} : (tensor<1x16x8x8xf32>) -> tensor<1x16x4x4xf32>
+  return %2 : tensor<1x16x4x4xf32>
+
+  // CHECK-LABEL: test_blocked_region
+  // CHECK: [[X:%.+]] = "onnx.LayoutTransform"(%arg0) {block_size = 8 : si64} : (tensor<1x16x8x8xf32>) -> tensor<1x2x8x8x8xf32>
+  // CHECK: [[CONV:%.+]] = "onnx.ConvNCHWc"([[X]], %arg1, %arg2) {block_size = 8 : si64, dilations = [1, 1], pads = [1, 1, 1, 1], strides = [1, 1]} : (tensor<1x2x8x8x8xf32>, tensor<16x16x3x3xf32>, tensor<16xf32>) -> tensor<1x2x8x8x8xf32>
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[CONV]]) : (tensor<1x2x8x8x8xf32>) -> tensor<1x2x8x8x8xf32>
+  // CHECK: [[POOL:%.+]] = "onnx.MaxPoolSingleOut"([[RELU]]) {auto_pad = "NOTSET", ceil_mode = 0 : si64, kernel_shape = [2, 2, 1], pads = [0, 0, 0, 0, 0, 0], storage_order = 0 : si64, strides = [2, 2, 1]} : (tensor<1x2x8x8x8xf32>) -> tensor<1x2x4x4x8xf32>
+  // CHECK: [[Y:%.+]] = "onnx.LayoutTransform"([[POOL]]) {block_size = 0 : si64, channels = 16 : si64} : (tensor<1x2x4x4x8xf32>) -> tensor<1x16x4x4xf32>
+  // CHECK-NOT: "onnx.Conv"
+  // CHECK: return [[Y]] : tensor<1x16x4x4xf32>
+
+  // BLOCK16-LABEL: test_blocked_region
+  // BLOCK16: "onnx.LayoutTransform"(%arg0) {block_size = 16 : si64} : (tensor<1x16x8x8xf32>) -> tensor<1x1x8x8x16xf32>
+}
+
+// -----
+
+/// The first Conv, on 3 channels, stays in the plain layout. The residual Add
+/// of two blocked values is blocked, the Add broadcasting a bias is not.
+func @test_region_boundaries(%arg0: tensor<1x3x8x8xf32>, %arg1: tensor<12x3x3x3xf32>, %arg2: tensor<12x12x1x1xf32>, %arg3: tensor<12x1x1xf32>) -> tensor<1x12x8x8xf32> {
+  %cst = constant unit
+  %0 = "onnx.Conv"(%arg0, %arg1, %cst) {auto_pad = "NOTSET", group = 1 : si64, kernel_shape = [3, 3], pads = [1, 1, 1, 1]} : (tensor<1x3x8x8xf32>, tensor<12x3x3x3xf32>, none) -> tensor<1x12x8x8xf32>
+  %1 = "onnx.Conv"(%0, %arg2, %cst) {auto_pad = "NOTSET", group = 1 : si64, kernel_shape = [1, 1]} : (tensor<1x12x8x8xf32>, tensor<12x12x1x1xf32>, none) -> tensor<1x12x8x8xf32>
+  %2 = "onnx.Add"(%1, %0) : (tensor<1x12x8x8xf32>, tensor<1x12x8x8xf32>) -> tensor<1x12x8x8xf32>
+  %3 = "onnx.Add"(%2, %arg3) : (tensor<1x12x8x8xf32>, tensor<12x1x1xf32>) -> tensor<1x12x8x8xf32>
+  return %3 : tensor<1x12x8x8xf32>
+
+  // CHECK-LABEL: test_region_boundaries
+  // CHECK: [[CONV0:%.+]] = "onnx.Conv"(%arg0, %arg1, %cst)
+  // CHECK: [[X:%.+]] = "onnx.LayoutTransform"([[CONV0]]) {block_size = 8 : si64} : (tensor<1x12x8x8xf32>) -> tensor<1x2x8x8x8xf32>
+  // CHECK: [[CONV1:%.+]] = "onnx.ConvNCHWc"([[X]], %arg2, %cst) {block_size = 8 : si64, dilations = [1, 1], pads = [0, 0, 0, 0], strides = [1, 1]} : (tensor<1x2x8x8x8xf32>, tensor<12x12x1x1xf32>, none) -> tensor<1x2x8x8x8xf32>
+  // CHECK: [[ADD:%.+]] = "onnx.Add"([[CONV1]], [[X]]) : (tensor<1x2x8x8x8xf32>, tensor<1x2x8x8x8xf32>) -> tensor<1x2x8x8x8xf32>
+  // CHECK: [[Y:%.+]] = "onnx.LayoutTransform"([[ADD]]) {block_size = 0 : si64, channels = 12 : si64} : (tensor<1x2x8x8x8xf32>) -> tensor<1x12x8x8xf32>
+  // CHECK: [[BIAS:%.+]] = "onnx.Add"([[Y]], %arg3) : (tensor<1x12x8x8xf32>, tensor<12x1x1xf32>) -> tensor<1x12x8x8xf32>
+  // CHECK: return [[BIAS]] : tensor<1x12x8x8xf32>
+}
@@ -73,6 +73,326 @@ func @test_gemm_add_fusion_rank3(%arg0: tensor<128x128x256xf32>, %arg1: tensor<1
 
 // -----
 
+// onnx.MatMul, onnx.Add and onnx.Relu become a single onnx.FusedGemm.
+// CHECK-LABEL: func @test_matmul_add_relu_fused(%{{.*}}: tensor<10x10xf32>, %{{.*}}: tensor<10x10xf32>, %{{.*}}: tensor<10xf32>) -> tensor<10x10xf32> {
+func @test_matmul_add_relu_fused(%a0: tensor<10x10xf32>, %a1: tensor<10x10xf32>, %a2: tensor<10xf32>) -> tensor<10x10xf32> {
+  // CHECK-NEXT: [[GEMM:%.+]] = "onnx.FusedGemm"(%{{.*}}, %{{.*}}, %{{.*}}) {activation = "Relu", alpha = 1.000000e+00 : f32, beta = 1.000000e+00 : f32, transA = 0 : si64, transB = 0 : si64} : (tensor<10x10xf32>, tensor<10x10xf32>, tensor<10xf32>) -> tensor<10x10xf32>
+  // CHECK-NEXT: return [[GEMM]] : tensor<10x10xf32>
+  %0 = "onnx.MatMul"(%a0, %a1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<10x10xf32>
+  %1 = "onnx.Add"(%0, %a2) : (tensor<10x10xf32>, tensor<10xf32>) -> tensor<10x10xf32>
+  %2 = "onnx.Relu"(%1) : (tensor<10x10xf32>) -> tensor<10x10xf32>
+  return %2 : tensor<10x10xf32>
+}
+
+// -----
+
+// Gemm with more than one use should not get fused with its activation.
+// CHECK-LABEL: func @test_gemm_tanh_not_fused(%{{.*}}: tensor<10x10xf32>, %{{.*}}: tensor<10x10xf32>) -> (tensor<10x10xf32>, tensor<10x10xf32>) {
+func @test_gemm_tanh_not_fused(%a0: tensor<10x10xf32>, %a1: tensor<10x10xf32>) -> (tensor<10x10xf32>, tensor<10x10xf32>) {
+  // CHECK-NEXT: %{{.*}} = constant unit
+  // CHECK-NEXT: [[GEMM:%.+]] = "onnx.Gemm"
+  // CHECK-NEXT: [[TANH:%.+]] = "onnx.Tanh"([[GEMM]])
+  // CHECK-NEXT: return [[GEMM]], [[TANH]]
+  %cst = constant unit
+  %0 = "onnx.Gemm"(%a0, %a1, %cst) : (tensor<10x10xf32>, tensor<10x10xf32>, none) -> tensor<10x10xf32>
+  %1 = "onnx.Tanh"(%0) : (tensor<10x10xf32>) -> tensor<10x10xf32>
+  return %0, %1 : tensor<10x10xf32>, tensor<10x10xf32>
+}
+
+// -----
+
+// The scaled and masked softmax attention becomes a single onnx.FusedAttention.
+// CHECK-LABEL: func @test_attention_fused(%{{.*}}: tensor<2x8x16xf32>, %{{.*}}: tensor<2x16x8xf32>, %{{.*}}: tensor<2x8x16xf32>, %{{.*}}: tensor<8xf32>) -> tensor<2x8x16xf32> {
+func @test_attention_fused(%q: tensor<2x8x16xf32>, %k: tensor<2x16x8xf32>, %v: tensor<2x8x16xf32>, %mask: tensor<8xf32>) -> tensor<2x8x16xf32> {
+  // CHECK-NEXT: [[ATTENTION:%.+]] = "onnx.FusedAttention"(%{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) {scale = 2.500000e-01 : f32} : (tensor<2x8x16xf32>, tensor<2x16x8xf32>, tensor<2x8x16xf32>, tensor<8xf32>) -> tensor<2x8x16xf32>
+  // CHECK-NEXT: return [[ATTENTION]] : tensor<2x8x16xf32>
+  %cst = "onnx.Constant"() {value = dense<4.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.MatMul"(%q, %k) : (tensor<2x8x16xf32>, tensor<2x16x8xf32>) -> tensor<2x8x8xf32>
+  %1 = "onnx.Div"(%0, %cst) : (tensor<2x8x8xf32>, tensor<f32>) -> tensor<2x8x8xf32>
+  %2 = "onnx.Add"(%1, %mask) : (tensor<2x8x8xf32>, tensor<8xf32>) -> tensor<2x8x8xf32>
+  %3 = "onnx.Softmax"(%2) {axis = -1 : si64} : (tensor<2x8x8xf32>) -> tensor<2x8x8xf32>
+  %4 = "onnx.MatMul"(%3, %v) : (tensor<2x8x8xf32>, tensor<2x8x16xf32>) -> tensor<2x8x16xf32>
+  return %4 : tensor<2x8x16xf32>
+}
+
+// -----
+
+// The softmax is not along the last axis: no fusion.
+// CHECK-LABEL: func @test_attention_not_fused
+func @test_attention_not_fused(%q: tensor<8x16xf32>, %k: tensor<16x8xf32>, %v: tensor<8x16xf32>) -> tensor<8x16xf32> {
+  // CHECK-NOT: onnx.FusedAttention
+  // CHECK: "onnx.Softmax"
+  %cst = "onnx.Constant"() {value = dense<0.25> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.MatMul"(%q, %k) : (tensor<8x16xf32>, tensor<16x8xf32>) -> tensor<8x8xf32>
+  %1 = "onnx.Mul"(%0, %cst) : (tensor<8x8xf32>, tensor<f32>) -> tensor<8x8xf32>
+  %2 = "onnx.Softmax"(%1) {axis = 0 : si64} : (tensor<8x8xf32>) -> tensor<8x8xf32>
+  %3 = "onnx.MatMul"(%2, %v) : (tensor<8x8xf32>, tensor<8x16xf32>) -> tensor<8x16xf32>
+  return %3 : tensor<8x16xf32>
+}
+
+// -----
+
+// The layer normalization along the last axis becomes a single onnx.FusedLayerNorm.
+// CHECK-LABEL: func @test_layernorm_fused(%{{.*}}: tensor<2x8x16xf32>, %{{.*}}: tensor<16xf32>, %{{.*}}: tensor<16xf32>) -> tensor<2x8x16xf32> {
+func @test_layernorm_fused(%x: tensor<2x8x16xf32>, %scale: tensor<16xf32>, %bias: tensor<16xf32>) -> tensor<2x8x16xf32> {
+  // CHECK-NEXT: [[LAYERNORM:%.+]] = "onnx.FusedLayerNorm"(%{{.*}}, %{{.*}}, %{{.*}}) {epsilon = 9.765625E-4 : f32} : (tensor<2x8x16xf32>, tensor<16xf32>, tensor<16xf32>) -> tensor<2x8x16xf32>
+  // CHECK-NEXT: return [[LAYERNORM]] : tensor<2x8x16xf32>
+  %two = "onnx.Constant"() {value = dense<2.0> : tensor<f32>} : () -> tensor<f32>
+  %eps = "onnx.Constant"() {value = dense<9.765625E-4> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.ReduceMean"(%x) {axes = [-1], keepdims = 1 : si64} : (tensor<2x8x16xf32>) -> tensor<2x8x1xf32>
+  %1 = "onnx.Sub"(%x, %0) : (tensor<2x8x16xf32>, tensor<2x8x1xf32>) -> tensor<2x8x16xf32>
+  %2 = "onnx.Pow"(%1, %two) : (tensor<2x8x16xf32>, tensor<f32>) -> tensor<2x8x16xf32>
+  %3 = "onnx.ReduceMean"(%2) {axes = [-1], keepdims = 1 : si64} : (tensor<2x8x16xf32>) -> tensor<2x8x1xf32>
+  %4 = "onnx.Add"(%3, %eps) : (tensor<2x8x1xf32>, tensor<f32>) -> tensor<2x8x1xf32>
+  %5 = "onnx.Sqrt"(%4) : (tensor<2x8x1xf32>) -> tensor<2x8x1xf32>
+  %6 = "onnx.Div"(%1, %5) : (tensor<2x8x16xf32>, tensor<2x8x1xf32>) -> tensor<2x8x16xf32>
+  %7 = "onnx.Mul"(%6, %scale) : (tensor<2x8x16xf32>, tensor<16xf32>) -> tensor<2x8x16xf32>
+  %8 = "onnx.Add"(%7, %bias) : (tensor<2x8x16xf32>, tensor<16xf32>) -> tensor<2x8x16xf32>
+  return %8 : tensor<2x8x16xf32>
+}
+
+// -----
+
+// The mean is not along the last axis: no fusion.
+// CHECK-LABEL: func @test_layernorm_not_fused
+func @test_layernorm_not_fused(%x: tensor<8x16xf32>, %scale: tensor<16xf32>, %bias: tensor<16xf32>) -> tensor<8x16xf32> {
+  // CHECK-NOT: onnx.FusedLayerNorm
+  // CHECK: "onnx.ReduceMean"
+  %two = "onnx.Constant"() {value = dense<2.0> : tensor<f32>} : () -> tensor<f32>
+  %eps = "onnx.Constant"() {value = dense<9.765625E-4> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.ReduceMean"(%x) {axes = [0], keepdims = 1 : si64} : (tensor<8x16xf32>) -> tensor<1x16xf32>
+  %1 = "onnx.Sub"(%x, %0) : (tensor<8x16xf32>, tensor<1x16xf32>) -> tensor<8x16xf32>
+  %2 = "onnx.Pow"(%1, %two) : (tensor<8x16xf32>, tensor<f32>) -> tensor<8x16xf32>
+  %3 = "onnx.ReduceMean"(%2) {axes = [0], keepdims = 1 : si64} : (tensor<8x16xf32>) -> tensor<1x16xf32>
+  %4 = "onnx.Add"(%3, %eps) : (tensor<1x16xf32>, tensor<f32>) -> tensor<1x16xf32>
+  %5 = "onnx.Sqrt"(%4) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %6 = "onnx.Div"(%1, %5) : (tensor<8x16xf32>, tensor<1x16xf32>) -> tensor<8x16xf32>
+  %7 = "onnx.Mul"(%6, %scale) : (tensor<8x16xf32>, tensor<16xf32>) -> tensor<8x16xf32>
+  %8 = "onnx.Add"(%7, %bias) : (tensor<8x16xf32>, tensor<16xf32>) -> tensor<8x16xf32>
+  return %8 : tensor<8x16xf32>
+}
+
+// -----
+
+// The layer normalization whose square is a Mul is fused as well.
+// CHECK-LABEL: func @test_layernorm_mul_fused(%{{.*}}: tensor<2x8x16xf32>, %{{.*}}: tensor<16xf32>, %{{.*}}: tensor<16xf32>) -> tensor<2x8x16xf32> {
+func @test_layernorm_mul_fused(%x: tensor<2x8x16xf32>, %scale: tensor<16xf32>, %bias: tensor<16xf32>) -> tensor<2x8x16xf32> {
+  // CHECK-NEXT: [[LAYERNORM:%.+]] = "onnx.FusedLayerNorm"(%{{.*}}, %{{.*}}, %{{.*}}) {epsilon = 9.765625E-4 : f32} : (tensor<2x8x16xf32>, tensor<16xf32>, tensor<16xf32>) -> tensor<2x8x16xf32>
+  // CHECK-NEXT: return [[LAYERNORM]] : tensor<2x8x16xf32>
+  %eps = "onnx.Constant"() {value = dense<9.765625E-4> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.ReduceMean"(%x) {axes = [-1], keepdims = 1 : si64} : (tensor<2x8x16xf32>) -> tensor<2x8x1xf32>
+  %1 = "onnx.Sub"(%x, %0) : (tensor<2x8x16xf32>, tensor<2x8x1xf32>) -> tensor<2x8x16xf32>
+  %2 = "onnx.Mul"(%1, %1) : (tensor<2x8x16xf32>, tensor<2x8x16xf32>) -> tensor<2x8x16xf32>
+  %3 = "onnx.ReduceMean"(%2) {axes = [-1], keepdims = 1 : si64} : (tensor<2x8x16xf32>) -> tensor<2x8x1xf32>
+  %4 = "onnx.Add"(%3, %eps) : (tensor<2x8x1xf32>, tensor<f32>) -> tensor<2x8x1xf32>
+  %5 = "onnx.Sqrt"(%4) : (tensor<2x8x1xf32>) -> tensor<2x8x1xf32>
+  %6 = "onnx.Div"(%1, %5) : (tensor<2x8x16xf32>, tensor<2x8x1xf32>) -> tensor<2x8x16xf32>
+  %7 = "onnx.Mul"(%6, %scale) : (tensor<2x8x16xf32>, tensor<16xf32>) -> tensor<2x8x16xf32>
+  %8 = "onnx.Add"(%7, %bias) : (tensor<2x8x16xf32>, tensor<16xf32>) -> tensor<2x8x16xf32>
+  return %8 : tensor<2x8x16xf32>
+}
+
+// -----
+
+// The additions of -0.0 and multiplications by 1 that do not broadcast are
+// removed.
+// CHECK-LABEL: func @test_add_zero_mul_one(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_add_zero_mul_one(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %zero = "onnx.Constant"() {value = dense<-0.0> : tensor<f32>} : () -> tensor<f32>
+  %one = "onnx.Constant"() {value = dense<1.0> : tensor<1xf32>} : () -> tensor<1xf32>
+  %0 = "onnx.Add"(%arg0, %zero) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  %1 = "onnx.Mul"(%one, %0) : (tensor<1xf32>, tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: return %arg0 : tensor<4xf32>
+  "std.return"(%1) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The addition of -0.0 broadcasting its input is kept.
+// CHECK-LABEL: func @test_add_zero_broadcast(%arg0: tensor<4xf32>) -> tensor<1x4xf32> {
+func @test_add_zero_broadcast(%arg0: tensor<4xf32>) -> tensor<1x4xf32> {
+  %zero = "onnx.Constant"() {value = dense<-0.0> : tensor<1x1xf32>} : () -> tensor<1x1xf32>
+  %0 = "onnx.Add"(%arg0, %zero) : (tensor<4xf32>, tensor<1x1xf32>) -> tensor<1x4xf32>
+  // CHECK: "onnx.Add"
+  "std.return"(%0) : (tensor<1x4xf32>) -> ()
+}
+
+// -----
+
+// The addition of +0.0 is kept, it turns an input of -0.0 into +0.0.
+// CHECK-LABEL: func @test_add_positive_zero(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_add_positive_zero(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %zero = "onnx.Constant"() {value = dense<0.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Add"(%zero, %arg0) : (tensor<f32>, tensor<4xf32>) -> tensor<4xf32>
+  // CHECK: [[RES:%.+]] = "onnx.Add"
+  // CHECK: return [[RES]] : tensor<4xf32>
+  "std.return"(%0) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The left-nested chains of Adds of the same shape are combined into one Sum,
+// an Add whose result has several uses ending a chain and being a leaf of the
+// next one. The Add of a chain in its second operand is kept.
+// CHECK-LABEL: func @test_add_chain_to_sum(%arg0: tensor<4x8xf32>, %arg1: tensor<4x8xf32>, %arg2: tensor<4x8xf32>, %arg3: tensor<4x8xf32>) -> (tensor<4x8xf32>, tensor<4x8xf32>) {
+func @test_add_chain_to_sum(%arg0: tensor<4x8xf32>, %arg1: tensor<4x8xf32>, %arg2: tensor<4x8xf32>, %arg3: tensor<4x8xf32>) -> (tensor<4x8xf32>, tensor<4x8xf32>) {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  %1 = "onnx.Add"(%0, %arg2) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  %2 = "onnx.Add"(%arg3, %1) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  %3 = "onnx.Add"(%2, %arg0) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  %4 = "onnx.Add"(%3, %2) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: [[SUM:%.+]] = "onnx.Sum"(%arg0, %arg1, %arg2) : (tensor<4x8xf32>, tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: [[ADD:%.+]] = "onnx.Add"(%arg3, [[SUM]]) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Sum"([[ADD]], %arg0, [[ADD]]) : (tensor<4x8xf32>, tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: return [[RES]], [[ADD]] : tensor<4x8xf32>, tensor<4x8xf32>
+  "std.return"(%4, %2) : (tensor<4x8xf32>, tensor<4x8xf32>) -> ()
+}
+
+// -----
+
+// The right-nested chains of float Adds are kept, their Sum would reassociate
+// the additions.
+// CHECK-LABEL: func @test_add_chain_right_nested(%arg0: tensor<4x8xf32>, %arg1: tensor<4x8xf32>, %arg2: tensor<4x8xf32>) -> tensor<4x8xf32> {
+func @test_add_chain_right_nested(%arg0: tensor<4x8xf32>, %arg1: tensor<4x8xf32>, %arg2: tensor<4x8xf32>) -> tensor<4x8xf32> {
+  %0 = "onnx.Add"(%arg1, %arg2) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  %1 = "onnx.Add"(%arg0, %0) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: [[ADD:%.+]] = "onnx.Add"(%arg1, %arg2) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Add"(%arg0, [[ADD]]) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<4x8xf32>
+  "std.return"(%1) : (tensor<4x8xf32>) -> ()
+}
+
+// -----
+
+// The chains of Adds that broadcast are kept.
+// CHECK-LABEL: func @test_add_chain_broadcast(%arg0: tensor<4x8xf32>, %arg1: tensor<8xf32>, %arg2: tensor<4x8xf32>) -> tensor<4x8xf32> {
+func @test_add_chain_broadcast(%arg0: tensor<4x8xf32>, %arg1: tensor<8xf32>, %arg2: tensor<4x8xf32>) -> tensor<4x8xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<4x8xf32>, tensor<8xf32>) -> tensor<4x8xf32>
+  %1 = "onnx.Add"(%0, %arg2) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NOT: "onnx.Sum"
+  "std.return"(%1) : (tensor<4x8xf32>) -> ()
+}
+
+// -----
+
+// The square root of a square is not an absolute value in floating point, the
+// square overflows for large values and underflows for small ones.
+// CHECK-LABEL: func @test_sqrt_pow_two(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_sqrt_pow_two(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %two = "onnx.Constant"() {value = dense<2.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Pow"(%arg0, %two) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  %1 = "onnx.Sqrt"(%0) : (tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[SQUARE:%.+]] = "onnx.Mul"(%arg0, %arg0) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[SQRT:%.+]] = "onnx.Sqrt"([[SQUARE]]) : (tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: return [[SQRT]] : tensor<4xf32>
+  // CHECK-NOT: "onnx.Abs"
+  "std.return"(%1) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The Pow of 2 is a Mul.
+// CHECK-LABEL: func @test_pow_two(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_pow_two(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %two = "onnx.Constant"() {value = dense<2.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Pow"(%arg0, %two) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[SQUARE:%.+]] = "onnx.Mul"(%arg0, %arg0) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: return [[SQUARE]] : tensor<4xf32>
+  "std.return"(%0) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The divisions by a constant with an exact reciprocal are multiplications.
+// CHECK-LABEL: func @test_div_by_constant(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_div_by_constant(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %cst = "onnx.Constant"() {value = dense<4.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Div"(%arg0, %cst) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[RECIPROCAL:%.+]] = "onnx.Constant"() {value = dense<2.500000e-01> : tensor<f32>} : () -> tensor<f32>
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Mul"(%arg0, [[RECIPROCAL]]) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<4xf32>
+  "std.return"(%0) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The division by 3, whose reciprocal is rounded, is kept.
+// CHECK-LABEL: func @test_div_by_inexact_constant(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_div_by_inexact_constant(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %cst = "onnx.Constant"() {value = dense<3.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Div"(%arg0, %cst) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  // CHECK-NOT: "onnx.Mul"
+  // CHECK: "onnx.Div"
+  "std.return"(%0) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// Consecutive reshapes are a single reshape, and the reshapes to the same
+// static shape are removed.
+// CHECK-LABEL: func @test_reshape_fusion(%arg0: tensor<2x3x4xf32>) -> (tensor<4x6xf32>, tensor<2x3x4xf32>) {
+func @test_reshape_fusion(%arg0: tensor<2x3x4xf32>) -> (tensor<4x6xf32>, tensor<2x3x4xf32>) {
+  %s1 = "onnx.Constant"() {value = dense<[6, -1]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %s2 = "onnx.Constant"() {value = dense<[4, 6]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %s3 = "onnx.Constant"() {value = dense<[2, 3, 4]> : tensor<3xi64>} : () -> tensor<3xi64>
+  %0 = "onnx.Reshape"(%arg0, %s1) : (tensor<2x3x4xf32>, tensor<2xi64>) -> tensor<6x4xf32>
+  %1 = "onnx.Reshape"(%0, %s2) : (tensor<6x4xf32>, tensor<2xi64>) -> tensor<4x6xf32>
+  %2 = "onnx.Reshape"(%arg0, %s3) : (tensor<2x3x4xf32>, tensor<3xi64>) -> tensor<2x3x4xf32>
+  // CHECK-NEXT: [[SHAPE:%.+]] = "onnx.Constant"() {value = dense<[4, 6]> : tensor<2xi64>} : () -> tensor<2xi64>
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Reshape"(%arg0, [[SHAPE]]) : (tensor<2x3x4xf32>, tensor<2xi64>) -> tensor<4x6xf32>
+  // CHECK-NEXT: return [[RES]], %arg0 : tensor<4x6xf32>, tensor<2x3x4xf32>
+  "std.return"(%1, %2) : (tensor<4x6xf32>, tensor<2x3x4xf32>) -> ()
+}
+
+// -----
+
+// The GELU exported as x * 0.5 * (1 + erf(x / sqrt(2))) is fused.
+// CHECK-LABEL: func @test_gelu_fusion(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+func @test_gelu_fusion(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %sqrt2 = "onnx.Constant"() {value = dense<1.41421354> : tensor<f32>} : () -> tensor<f32>
+  %one = "onnx.Constant"() {value = dense<1.0> : tensor<f32>} : () -> tensor<f32>
+  %half = "onnx.Constant"() {value = dense<0.5> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Div"(%arg0, %sqrt2) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  %1 = "onnx.Erf"(%0) : (tensor<4xf32>) -> tensor<4xf32>
+  %2 = "onnx.Add"(%1, %one) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  %3 = "onnx.Mul"(%arg0, %2) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  %4 = "onnx.Mul"(%3, %half) : (tensor<4xf32>, tensor<f32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.FusedActivation"(%arg0) {activation = "Gelu"} : (tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<4xf32>
+  "std.return"(%4) : (tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The Swish and the HardSwish are fused, in both orders of the operands.
+// CHECK-LABEL: func @test_swish_fusion(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>) {
+func @test_swish_fusion(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>) {
+  %0 = "onnx.Sigmoid"(%arg0) : (tensor<4xf32>) -> tensor<4xf32>
+  %1 = "onnx.Mul"(%0, %arg0) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  %2 = "onnx.HardSigmoid"(%arg0) {alpha = 0.166666672 : f32, beta = 0.5 : f32} : (tensor<4xf32>) -> tensor<4xf32>
+  %3 = "onnx.Mul"(%arg0, %2) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[SWISH:%.+]] = "onnx.FusedActivation"(%arg0) {activation = "Swish"} : (tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: [[HARDSWISH:%.+]] = "onnx.FusedActivation"(%arg0) {activation = "HardSwish"} : (tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NEXT: return [[SWISH]], [[HARDSWISH]] : tensor<4xf32>, tensor<4xf32>
+  "std.return"(%1, %3) : (tensor<4xf32>, tensor<4xf32>) -> ()
+}
+
+// -----
+
+// The HardSigmoid with the default coefficients is not a HardSwish, and the
+// sigmoid used elsewhere is kept.
+// CHECK-LABEL: func @test_should_not_fuse_swish(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>, tensor<4xf32>) {
+func @test_should_not_fuse_swish(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>, tensor<4xf32>) {
+  %0 = "onnx.HardSigmoid"(%arg0) : (tensor<4xf32>) -> tensor<4xf32>
+  %1 = "onnx.Mul"(%arg0, %0) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  %2 = "onnx.Sigmoid"(%arg0) : (tensor<4xf32>) -> tensor<4xf32>
+  %3 = "onnx.Mul"(%arg0, %2) : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  // CHECK-NOT: "onnx.FusedActivation"
+  "std.return"(%1, %2, %3) : (tensor<4xf32>, tensor<4xf32>, tensor<4xf32>) -> ()
+}
+
+// -----
+
 //CHECK-LABEL: @cast_elimination(%{{.*}}: tensor<2xf32>) -> tensor<2xf32> {
 func @cast_elimination(%arg0: tensor<2xf32>) -> tensor<2xf32> {
   %0 = "onnx.Cast"(%arg0) {to = f32} : (tensor<2xf32>) -> tensor<2xf32>
@@ -83,6 +403,24 @@ func @cast_elimination(%arg0: tensor<2xf32>) -> tensor<2xf32> {
 
 // -----
 
+// The fp16 to fp32 to fp16 Casts are removed, the fp32 to fp16 to fp32 ones,
+// which round, are kept.
+// CHECK-LABEL: func @test_cast_pair_elimination(%arg0: tensor<2xf16>, %arg1: tensor<2xf32>) -> (tensor<2xf16>, tensor<2xf64>, tensor<2xf32>) {
+func @test_cast_pair_elimination(%arg0: tensor<2xf16>, %arg1: tensor<2xf32>) -> (tensor<2xf16>, tensor<2xf64>, tensor<2xf32>) {
+  %0 = "onnx.Cast"(%arg0) {to = f32} : (tensor<2xf16>) -> tensor<2xf32>
+  %1 = "onnx.Cast"(%0) {to = f16} : (tensor<2xf32>) -> tensor<2xf16>
+  %2 = "onnx.Cast"(%0) {to = f64} : (tensor<2xf32>) -> tensor<2xf64>
+  %3 = "onnx.Cast"(%arg1) {to = f16} : (tensor<2xf32>) -> tensor<2xf16>
+  %4 = "onnx.Cast"(%3) {to = f32} : (tensor<2xf16>) -> tensor<2xf32>
+  // CHECK-NEXT: [[WIDE:%.+]] = "onnx.Cast"(%arg0) {to = f64} : (tensor<2xf16>) -> tensor<2xf64>
+  // CHECK-NEXT: [[NARROW:%.+]] = "onnx.Cast"(%arg1) {to = f16} : (tensor<2xf32>) -> tensor<2xf16>
+  // CHECK-NEXT: [[ROUNDED:%.+]] = "onnx.Cast"([[NARROW]]) {to = f32} : (tensor<2xf16>) -> tensor<2xf32>
+  // CHECK-NEXT: return %arg0, [[WIDE]], [[ROUNDED]] : tensor<2xf16>, tensor<2xf64>, tensor<2xf32>
+  return %1, %2, %4 : tensor<2xf16>, tensor<2xf64>, tensor<2xf32>
+}
+
+// -----
+
 func @test_conv_batchnormtestmode_fusion_nobias(%arg0 : tensor<1x3x224x224xf32>) -> tensor<1x64x112x112xf32> {
     %cst = constant unit
     %0 = "onnx.Constant"() : () -> tensor<64x3x7x7xf32>
@@ -159,6 +497,63 @@ func @test_conv_batchnormtestmode_fusion(%arg0 : tensor<1x3x224x224xf32>, %arg1
 
 // -----
 
+// The Conv is not fused with the BatchNormalizationTestMode when its result has another use.
+func @test_conv_batchnormtestmode_multiple_uses(%arg0 : tensor<1x3x224x224xf32>) -> (tensor<1x64x112x112xf32>, tensor<1x64x112x112xf32>) {
+    %cst = constant unit
+    %0 = "onnx.Constant"() : () -> tensor<64x3x7x7xf32>
+    %1 = "onnx.Conv"(%arg0, %0, %cst) {auto_pad = "NOTSET", dilations = [1, 1], group = 1 : si64, kernel_shape = [7, 7], pads = [3, 3, 3, 3], strides = [2, 2]} : (tensor<1x3x224x224xf32>, tensor<64x3x7x7xf32>, none) -> tensor<1x64x112x112xf32>
+    %2 = "onnx.Constant"() : () -> tensor<64xf32>
+    %3 = "onnx.Constant"() : () -> tensor<64xf32>
+    %4 = "onnx.Constant"() : () -> tensor<64xf32>
+    %5 = "onnx.Constant"() : () -> tensor<64xf32>
+    %6 = "onnx.BatchNormalizationTestMode"(%1, %2, %3, %4, %5) {epsilon = 1.00000007E-5 : f32} : (tensor<1x64x112x112xf32>, tensor<64xf32>, tensor<64xf32>, tensor<64xf32>, tensor<64xf32>) -> tensor<1x64x112x112xf32>
+    return %1, %6 : tensor<1x64x112x112xf32>, tensor<1x64x112x112xf32>
+
+    // CHECK-LABEL: test_conv_batchnormtestmode_multiple_uses
+    // CHECK: [[CONV:%.+]] = "onnx.Conv"
+    // CHECK: [[RES:%.+]] = "onnx.BatchNormalizationTestMode"([[CONV]], {{.*}})
+    // CHECK-NOT: "onnx.Conv"
+    // CHECK: return [[CONV]], [[RES]] : tensor<1x64x112x112xf32>, tensor<1x64x112x112xf32>
+}
+
+// -----
+
+// A zero constant Pad of the spatial dimensions is folded into the pads of the Conv.
+func @test_pad_conv_folding(%arg0 : tensor<1x3x222x222xf32>) -> tensor<1x64x112x112xf32> {
+    %cst = constant unit
+    %0 = "onnx.Constant"() {value = dense<[0, 0, 1, 2, 0, 0, 1, 0]> : tensor<8xi64>} : () -> tensor<8xi64>
+    %1 = "onnx.Constant"() {value = dense<0.000000e+00> : tensor<1xf32>} : () -> tensor<1xf32>
+    %2 = "onnx.Pad"(%arg0, %0, %1) {mode = "constant"} : (tensor<1x3x222x222xf32>, tensor<8xi64>, tensor<1xf32>) -> tensor<1x3x224x224xf32>
+    %3 = "onnx.Constant"() : () -> tensor<64x3x7x7xf32>
+    %4 = "onnx.Conv"(%2, %3, %cst) {auto_pad = "NOTSET", dilations = [1, 1], group = 1 : si64, kernel_shape = [7, 7], pads = [3, 3, 3, 3], strides = [2, 2]} : (tensor<1x3x224x224xf32>, tensor<64x3x7x7xf32>, none) -> tensor<1x64x112x112xf32>
+    return %4 : tensor<1x64x112x112xf32>
+
+    // CHECK-LABEL: test_pad_conv_folding
+    // CHECK-NOT: "onnx.Pad"
+    // CHECK: [[RES:%.+]] = "onnx.Conv"(%arg0, {{.*}}) {auto_pad = "NOTSET", dilations = [1, 1], group = 1 : si64, kernel_shape = [7, 7], pads = [4, 5, 4, 3], strides = [2, 2]} : (tensor<1x3x222x222xf32>, tensor<64x3x7x7xf32>, none) -> tensor<1x64x112x112xf32>
+    // CHECK: return [[RES]] : tensor<1x64x112x112xf32>
+}
+
+// -----
+
+// A Pad with a nonzero value is not folded into the Conv.
+func @test_pad_conv_nonzero_value(%arg0 : tensor<1x3x222x222xf32>) -> tensor<1x64x112x112xf32> {
+    %cst = constant unit
+    %0 = "onnx.Constant"() {value = dense<[0, 0, 1, 1, 0, 0, 1, 1]> : tensor<8xi64>} : () -> tensor<8xi64>
+    %1 = "onnx.Constant"() {value = dense<1.000000e+00> : tensor<1xf32>} : () -> tensor<1xf32>
+    %2 = "onnx.Pad"(%arg0, %0, %1) {mode = "constant"} : (tensor<1x3x222x222xf32>, tensor<8xi64>, tensor<1xf32>) -> tensor<1x3x224x224xf32>
+    %3 = "onnx.Constant"() : () -> tensor<64x3x7x7xf32>
+    %4 = "onnx.Conv"(%2, %3, %cst) {auto_pad = "NOTSET", dilations = [1, 1], group = 1 : si64, kernel_shape = [7, 7], pads = [3, 3, 3, 3], strides = [2, 2]} : (tensor<1x3x224x224xf32>, tensor<64x3x7x7xf32>, none) -> tensor<1x64x112x112xf32>
+    return %4 : tensor<1x64x112x112xf32>
+
+    // CHECK-LABEL: test_pad_conv_nonzero_value
+    // CHECK: [[PAD:%.+]] = "onnx.Pad"
+    // CHECK: [[RES:%.+]] = "onnx.Conv"([[PAD]], {{.*}}) {{.*}} pads = [3, 3, 3, 3]
+    // CHECK: return [[RES]] : tensor<1x64x112x112xf32>
+}
+
+// -----
+
 // Check the removal of identity transposes.
 // CHECK-LABEL: func @test_transpose_removal(%arg0: tensor<10x11x12x13xf32>) -> tensor<10x11x12x13xf32> {
 func @test_transpose_removal(%arg0: tensor<10x11x12x13xf32>) -> tensor<10x11x12x13xf32> {
@@ -312,3 +312,184 @@ func @test_split_axis_2(%arg0 : tensor<2x10xf32>) -> (tensor<2x5xf32>, tensor<2x
   // CHECK: {{.*}} = "onnx.Split"(%arg0) {axis = 1 : si64, split = [5, 5]} : (tensor<2x10xf32>) -> (tensor<2x5xf32>, tensor<2x5xf32>)
 }
 
+
+//===----------------------------------------------------------------------===//
+/// Gather tests
+
+// -----
+
+// CHECK-LABEL: @test_gather_axis_1() -> tensor<2x2xf32>
+func @test_gather_axis_1() -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[0.0, 1.0, 2.0], [3.0, 4.0, 5.0]]> : tensor<2x3xf32>} : () -> tensor<2x3xf32>
+  %1 = "onnx.Constant"() {value = dense<[2, -3]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %2 = "onnx.Gather"(%0, %1) {axis = 1 : si64} : (tensor<2x3xf32>, tensor<2xi64>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<{{\[}}[2.000000e+00, 0.000000e+00], [5.000000e+00, 3.000000e+00]{{\]}}> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  // CHECK-NOT: {{.*}} = "onnx.Gather"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// Concat tests
+
+// -----
+
+// CHECK-LABEL: @test_concat_axis_1() -> tensor<2x3xi64>
+func @test_concat_axis_1() -> tensor<*xi64> {
+  %0 = "onnx.Constant"() {value = dense<[[0], [3]]> : tensor<2x1xi64>} : () -> tensor<2x1xi64>
+  %1 = "onnx.Constant"() {value = dense<[[1, 2], [4, 5]]> : tensor<2x2xi64>} : () -> tensor<2x2xi64>
+  %2 = "onnx.Concat"(%0, %1) {axis = -1 : si64} : (tensor<2x1xi64>, tensor<2x2xi64>) -> tensor<*xi64>
+  "std.return"(%2) : (tensor<*xi64>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<{{\[}}[0, 1, 2], [3, 4, 5]{{\]}}> : tensor<2x3xi64>} : () -> tensor<2x3xi64>
+  // CHECK-NOT: {{.*}} = "onnx.Concat"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// Shape computation tests
+
+// -----
+
+// CHECK-LABEL: @test_shape_gather_concat_reshape(%arg0: tensor<2x3x4xf32>) -> tensor<2x12xf32>
+func @test_shape_gather_concat_reshape(%arg0 : tensor<2x3x4xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Shape"(%arg0) : (tensor<2x3x4xf32>) -> tensor<*xi64>
+  %1 = "onnx.Constant"() {value = dense<[0]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %2 = "onnx.Gather"(%0, %1) {axis = 0 : si64} : (tensor<*xi64>, tensor<1xi64>) -> tensor<*xi64>
+  %3 = "onnx.Constant"() {value = dense<[-1]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %4 = "onnx.Concat"(%2, %3) {axis = 0 : si64} : (tensor<*xi64>, tensor<1xi64>) -> tensor<*xi64>
+  %5 = "onnx.Reshape"(%arg0, %4) : (tensor<2x3x4xf32>, tensor<*xi64>) -> tensor<*xf32>
+  "std.return"(%5) : (tensor<*xf32>) -> ()
+  // CHECK: [[SHAPE:%.+]] = "onnx.Constant"() {value = dense<[2, -1]> : tensor<2xi64>} : () -> tensor<2xi64>
+  // CHECK: [[RES:%.+]] = "onnx.Reshape"(%arg0, [[SHAPE]]) : (tensor<2x3x4xf32>, tensor<2xi64>) -> tensor<2x12xf32>
+  // CHECK: return [[RES]] : tensor<2x12xf32>
+}
+
+// -----
+
+// CHECK-LABEL: @test_shape_constant_of_shape(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32>
+func @test_shape_constant_of_shape(%arg0 : tensor<2x3xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Shape"(%arg0) : (tensor<2x3xf32>) -> tensor<*xi64>
+  %1 = "onnx.ConstantOfShape"(%0) {value = dense<[1.0]> : tensor<1xf32>} : (tensor<*xi64>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+  // CHECK: [[RES:%.+]] = "onnx.Constant"() {value = dense<1.000000e+00> : tensor<2x3xf32>} : () -> tensor<2x3xf32>
+  // CHECK-NOT: {{.*}} = "onnx.ConstantOfShape"{{.*}}
+  // CHECK: return [[RES]] : tensor<2x3xf32>
+}
+
+//===----------------------------------------------------------------------===//
+/// Reshape tests
+
+// -----
+
+// CHECK-LABEL: @test_reshape() -> tensor<3x2xf32>
+func @test_reshape() -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[0.0, 1.0, 2.0], [3.0, 4.0, 5.0]]> : tensor<2x3xf32>} : () -> tensor<2x3xf32>
+  %1 = "onnx.Constant"() {value = dense<[3, -1]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %2 = "onnx.Reshape"(%0, %1) : (tensor<2x3xf32>, tensor<2xi64>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<{{\[}}[0.000000e+00, 1.000000e+00], [2.000000e+00, 3.000000e+00], [4.000000e+00, 5.000000e+00]{{\]}}> : tensor<3x2xf32>} : () -> tensor<3x2xf32>
+  // CHECK-NOT: {{.*}} = "onnx.Reshape"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// Cast tests
+
+// -----
+
+// CHECK-LABEL: @test_cast_f32_i32() -> tensor<3xi32>
+func @test_cast_f32_i32() -> tensor<*xi32> {
+  %0 = "onnx.Constant"() {value = dense<[-1.5, 2.7, 3.0]> : tensor<3xf32>} : () -> tensor<3xf32>
+  %1 = "onnx.Cast"(%0) {to = i32} : (tensor<3xf32>) -> tensor<*xi32>
+  "std.return"(%1) : (tensor<*xi32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<[-1, 2, 3]> : tensor<3xi32>} : () -> tensor<3xi32>
+  // CHECK-NOT: {{.*}} = "onnx.Cast"{{.*}}
+}
+
+// -----
+
+// CHECK-LABEL: @test_cast_i64_f32() -> tensor<2xf32>
+func @test_cast_i64_f32() -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[-4, 7]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %1 = "onnx.Cast"(%0) {to = f32} : (tensor<2xi64>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<[-4.000000e+00, 7.000000e+00]> : tensor<2xf32>} : () -> tensor<2xf32>
+  // CHECK-NOT: {{.*}} = "onnx.Cast"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// MatMul tests
+
+// -----
+
+// CHECK-LABEL: @test_matmul_2d() -> tensor<2x2xf32>
+func @test_matmul_2d() -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]> : tensor<2x3xf32>} : () -> tensor<2x3xf32>
+  %1 = "onnx.Constant"() {value = dense<[[1.0, 0.0], [0.0, 1.0], [1.0, 1.0]]> : tensor<3x2xf32>} : () -> tensor<3x2xf32>
+  %2 = "onnx.MatMul"(%0, %1) : (tensor<2x3xf32>, tensor<3x2xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<{{\[}}[4.000000e+00, 5.000000e+00], [1.000000e+01, 1.100000e+01]{{\]}}> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  // CHECK-NOT: {{.*}} = "onnx.MatMul"{{.*}}
+}
+
+// -----
+
+// CHECK-LABEL: @test_matmul_1d_2d() -> tensor<2xi64>
+func @test_matmul_1d_2d() -> tensor<*xi64> {
+  %0 = "onnx.Constant"() {value = dense<[1, 2]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %1 = "onnx.Constant"() {value = dense<[[1, 2], [3, 4]]> : tensor<2x2xi64>} : () -> tensor<2x2xi64>
+  %2 = "onnx.MatMul"(%0, %1) : (tensor<2xi64>, tensor<2x2xi64>) -> tensor<*xi64>
+  "std.return"(%2) : (tensor<*xi64>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<[7, 10]> : tensor<2xi64>} : () -> tensor<2xi64>
+  // CHECK-NOT: {{.*}} = "onnx.MatMul"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// Gemm tests
+
+// -----
+
+// CHECK-LABEL: @test_gemm_transB_bias() -> tensor<2x2xf32>
+func @test_gemm_transB_bias() -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  %1 = "onnx.Constant"() {value = dense<[[1.0, 0.0], [1.0, 1.0]]> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  %2 = "onnx.Constant"() {value = dense<[1.0, -1.0]> : tensor<2xf32>} : () -> tensor<2xf32>
+  %3 = "onnx.Gemm"(%0, %1, %2) {alpha = 2.0 : f32, beta = 1.0 : f32, transB = 1 : si64} : (tensor<2x2xf32>, tensor<2x2xf32>, tensor<2xf32>) -> tensor<*xf32>
+  "std.return"(%3) : (tensor<*xf32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<{{\[}}[3.000000e+00, 5.000000e+00], [7.000000e+00, 1.300000e+01]{{\]}}> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  // CHECK-NOT: {{.*}} = "onnx.Gemm"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// Slice tests
+
+// -----
+
+// CHECK-LABEL: @test_slice() -> tensor<2x2xf32>
+func @test_slice() -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[0.0, 1.0, 2.0, 3.0], [4.0, 5.0, 6.0, 7.0]]> : tensor<2x4xf32>} : () -> tensor<2x4xf32>
+  %1 = "onnx.Constant"() {value = dense<[-1]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %2 = "onnx.Constant"() {value = dense<[0]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %3 = "onnx.Constant"() {value = dense<[1]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %4 = "onnx.Constant"() {value = dense<[-2]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %5 = "onnx.Slice"(%0, %1, %2, %3, %4) : (tensor<2x4xf32>, tensor<1xi64>, tensor<1xi64>, tensor<1xi64>, tensor<1xi64>) -> tensor<*xf32>
+  "std.return"(%5) : (tensor<*xf32>) -> ()
+  // CHECK: {{.*}} = "onnx.Constant"() {value = dense<{{\[}}[3.000000e+00, 1.000000e+00], [7.000000e+00, 5.000000e+00]{{\]}}> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  // CHECK-NOT: {{.*}} = "onnx.Slice"{{.*}}
+}
+
+//===----------------------------------------------------------------------===//
+/// Shared buffer tests
+
+// -----
+
+// The reshaped constant shares the buffer of its input, which must not be
+// overwritten by the in-place sqrt since it is still used.
+// CHECK-LABEL: @test_shared_buffer_reshape_sqrt() -> (tensor<2x2xf32>, tensor<4xf32>)
+func @test_shared_buffer_reshape_sqrt() -> (tensor<*xf32>, tensor<4xf32>) {
+  %0 = "onnx.Constant"() {value = dense<[1.0, 4.0, 9.0, 16.0]> : tensor<4xf32>} : () -> tensor<4xf32>
+  %1 = "onnx.Constant"() {value = dense<[2, 2]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %2 = "onnx.Reshape"(%0, %1) : (tensor<4xf32>, tensor<2xi64>) -> tensor<*xf32>
+  %3 = "onnx.Sqrt"(%2) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%3, %0) : (tensor<*xf32>, tensor<4xf32>) -> ()
+  // CHECK-DAG: [[SQRT:%.+]] = "onnx.Constant"() {value = dense<{{\[}}[1.000000e+00, 2.000000e+00], [3.000000e+00, 4.000000e+00]{{\]}}> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  // CHECK-DAG: [[CST:%.+]] = "onnx.Constant"() {value = dense<[1.000000e+00, 4.000000e+00, 9.000000e+00, 1.600000e+01]> : tensor<4xf32>} : () -> tensor<4xf32>
+  // CHECK: return [[SQRT]], [[CST]] : tensor<2x2xf32>, tensor<4xf32>
+}
@@ -0,0 +1,27 @@
+// RUN: onnx-mlir-opt --canonicalize --shape-inference --constprop-onnx %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The batch normalization of a Conv with constant parameters is folded into
+/// the weights and the bias of the Conv at compile time:
+///   w_ = scale * w / sqrt(var + eps) = [1, 2] * [2, 3] / [2, 4]
+///   b_ = B - scale * mean / sqrt(var + eps) = [1, 1] - [1, 0.75] * [0.5, 1]
+func @test_conv_batchnormtestmode_folding(%arg0 : tensor<1x1x2x2xf32>) -> tensor<1x2x2x2xf32> {
+  %cst = constant unit
+  %0 = "onnx.Constant"() {value = dense<[[[[1.0]]], [[[2.0]]]]> : tensor<2x1x1x1xf32>} : () -> tensor<2x1x1x1xf32>
+  %1 = "onnx.Conv"(%arg0, %0, %cst) {auto_pad = "NOTSET", dilations = [1, 1], group = 1 : si64, kernel_shape = [1, 1], pads = [0, 0, 0, 0], strides = [1, 1]} : (tensor<1x1x2x2xf32>, tensor<2x1x1x1xf32>, none) -> tensor<1x2x2x2xf32>
+  %2 = "onnx.Constant"() {value = dense<[2.0, 3.0]> : tensor<2xf32>} : () -> tensor<2xf32>
+  %3 = "onnx.Constant"() {value = dense<[1.0, 1.0]> : tensor<2xf32>} : () -> tensor<2xf32>
+  %4 = "onnx.Constant"() {value = dense<[0.5, 1.0]> : tensor<2xf32>} : () -> tensor<2xf32>
+  %5 = "onnx.Constant"() {value = dense<[3.0, 15.0]> : tensor<2xf32>} : () -> tensor<2xf32>
+  %6 = "onnx.BatchNormalizationTestMode"(%1, %2, %3, %4, %5) {epsilon = 1.0 : f32} : (tensor<1x2x2x2xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>) -> tensor<1x2x2x2xf32>
+  return %6 : tensor<1x2x2x2xf32>
+
+  // CHECK-LABEL: test_conv_batchnormtestmode_folding
+  // CHECK-DAG: [[WEIGHT:%.+]] = "onnx.Constant"() {value = dense<{{.}}{{.}}{{.}}{{.}}1.000000e+00{{.}}{{.}}{{.}}, {{.}}{{.}}{{.}}1.500000e+00{{.}}{{.}}{{.}}{{.}}> : tensor<2x1x1x1xf32>} : () -> tensor<2x1x1x1xf32>
+  // CHECK-DAG: [[BIAS:%.+]] = "onnx.Constant"() {value = dense<[5.000000e-01, 2.500000e-01]> : tensor<2xf32>} : () -> tensor<2xf32>
+  // CHECK: [[RES:%.+]] = "onnx.Conv"(%arg0, [[WEIGHT]], [[BIAS]])
+  // CHECK-NOT: "onnx.BatchNormalizationTestMode"
+  // CHECK-NOT: "onnx.Sqrt"
+  // CHECK: return [[RES]] : tensor<1x2x2x2xf32>
+}
@@ -0,0 +1,52 @@
+// RUN: onnx-mlir-opt --print-cost-model %s -split-input-file 2>&1 | FileCheck %s
+// RUN: onnx-mlir-opt --print-cost-model="annotate" %s -split-input-file 2>/dev/null | FileCheck --check-prefix=ANNOTATE %s
+
+/// Costs of a fully connected layer, with 2*M*N*K flops for the MatMul.
+func @test_cost_fully_connected(%arg0: tensor<8x16xf32>, %arg1: tensor<16x32xf32>, %arg2: tensor<32xf32>) -> tensor<8x32xf32> {
+  %0 = "onnx.MatMul"(%arg0, %arg1) : (tensor<8x16xf32>, tensor<16x32xf32>) -> tensor<8x32xf32> loc("matmul")
+  %1 = "onnx.Add"(%0, %arg2) : (tensor<8x32xf32>, tensor<32xf32>) -> tensor<8x32xf32> loc("add")
+  %2 = "onnx.Relu"(%1) : (tensor<8x32xf32>) -> tensor<8x32xf32> loc("relu")
+  "std.return"(%2) : (tensor<8x32xf32>) -> ()
+
+  // CHECK-LABEL: cost model of @test_cost_fully_connected:
+  // CHECK-NEXT:  onnx.MatMul loc("matmul"): flops 8192, bytes 3584
+  // CHECK-NEXT:  onnx.Add loc("add"): flops 256, bytes 2176
+  // CHECK-NEXT:  onnx.Relu loc("relu"): flops 256, bytes 2048
+  // CHECK-NEXT:  total: flops 8704, bytes 7808
+
+  // ANNOTATE-LABEL: func @test_cost_fully_connected
+  // ANNOTATE: "onnx.MatMul"(%arg0, %arg1) {cost.bytes = 3584 : i64, cost.flops = 8192 : i64}
+  // ANNOTATE: "onnx.Add"(%0, %arg2) {cost.bytes = 2176 : i64, cost.flops = 256 : i64}
+  // ANNOTATE: "onnx.Relu"(%1) {cost.bytes = 2048 : i64, cost.flops = 256 : i64}
+}
+
+// -----
+
+/// Costs of a convolution without bias, with 2 flops per element of the
+/// result and of the window of its channels.
+func @test_cost_conv(%arg0: tensor<1x3x8x8xf32>, %arg1: tensor<4x3x3x3xf32>) -> tensor<1x4x6x6xf32> {
+  %cst = constant unit
+  %0 = "onnx.Conv"(%arg0, %arg1, %cst) {auto_pad = "NOTSET", group = 1 : si64, kernel_shape = [3, 3]} : (tensor<1x3x8x8xf32>, tensor<4x3x3x3xf32>, none) -> tensor<1x4x6x6xf32> loc("conv")
+  "std.return"(%0) : (tensor<1x4x6x6xf32>) -> ()
+
+  // CHECK-LABEL: cost model of @test_cost_conv:
+  // CHECK-NEXT:  onnx.Conv loc("conv"): flops 7776, bytes 1776
+  // CHECK-NEXT:  total: flops 7776, bytes 1776
+}
+
+// -----
+
+/// The costs of the operations of dynamic shapes are unknown, and left out of
+/// the totals.
+func @test_cost_unknown(%arg0: tensor<?x4xf32>, %arg1: tensor<4xf32>) -> tensor<?x4xf32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<?x4xf32>) -> tensor<?x4xf32> loc("relu")
+  %1 = "onnx.Transpose"(%arg1) {perm = [0]} : (tensor<4xf32>) -> tensor<4xf32> loc("transpose")
+  %2 = "onnx.Add"(%0, %1) : (tensor<?x4xf32>, tensor<4xf32>) -> tensor<?x4xf32> loc("add")
+  "std.return"(%2) : (tensor<?x4xf32>) -> ()
+
+  // CHECK-LABEL: cost model of @test_cost_unknown:
+  // CHECK-NEXT:  onnx.Relu loc("relu"): flops unknown, bytes unknown
+  // CHECK-NEXT:  onnx.Transpose loc("transpose"): flops 0, bytes 32
+  // CHECK-NEXT:  onnx.Add loc("add"): flops unknown, bytes unknown
+  // CHECK-NEXT:  total: flops 0, bytes 32, 2 operations of unknown cost
+}
@@ -0,0 +1,35 @@
+// RUN: onnx-mlir-opt --cse-onnx %s -split-input-file | FileCheck %s
+
+/// The Shape/Gather chains computed twice, by nodes with different names, are
+/// computed once.
+func @test_shape_gather_chain(%arg0 : tensor<?x3xf32>) -> (tensor<1xi64>, tensor<1xi64>) {
+  %0 = "onnx.Shape"(%arg0) {onnx_node_name = "shape0"} : (tensor<?x3xf32>) -> tensor<2xi64>
+  %1 = "onnx.Constant"() {value = dense<[0]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %2 = "onnx.Gather"(%0, %1) {axis = 0 : si64, onnx_node_name = "gather0"} : (tensor<2xi64>, tensor<1xi64>) -> tensor<1xi64>
+  %3 = "onnx.Shape"(%arg0) {onnx_node_name = "shape1"} : (tensor<?x3xf32>) -> tensor<2xi64>
+  %4 = "onnx.Constant"() {value = dense<[0]> : tensor<1xi64>} : () -> tensor<1xi64>
+  %5 = "onnx.Gather"(%3, %4) {axis = 0 : si64, onnx_node_name = "gather1"} : (tensor<2xi64>, tensor<1xi64>) -> tensor<1xi64>
+  "std.return"(%2, %5) : (tensor<1xi64>, tensor<1xi64>) -> ()
+
+  // CHECK-LABEL: test_shape_gather_chain
+  // CHECK-NEXT: [[SHAPE:%.+]] = "onnx.Shape"(%arg0) {onnx_node_name = "shape0"}
+  // CHECK-NEXT: [[INDEX:%.+]] = "onnx.Constant"() {value = dense<0> : tensor<1xi64>}
+  // CHECK-NEXT: [[GATHER:%.+]] = "onnx.Gather"([[SHAPE]], [[INDEX]]) {axis = 0 : si64, onnx_node_name = "gather0"}
+  // CHECK-NEXT: return [[GATHER]], [[GATHER]] : tensor<1xi64>, tensor<1xi64>
+}
+
+// -----
+
+/// The operations with different attributes, and the random generators, are
+/// left as they are.
+func @test_keep_ops(%arg0 : tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>, tensor<4xf32>, tensor<4xf32>) {
+  %0 = "onnx.LeakyRelu"(%arg0) {alpha = 1.0e-01 : f32} : (tensor<4xf32>) -> tensor<4xf32>
+  %1 = "onnx.LeakyRelu"(%arg0) {alpha = 2.0e-01 : f32} : (tensor<4xf32>) -> tensor<4xf32>
+  %2 = "onnx.RandomNormal"() {shape = [4]} : () -> tensor<4xf32>
+  %3 = "onnx.RandomNormal"() {shape = [4]} : () -> tensor<4xf32>
+  "std.return"(%0, %1, %2, %3) : (tensor<4xf32>, tensor<4xf32>, tensor<4xf32>, tensor<4xf32>) -> ()
+
+  // CHECK-LABEL: test_keep_ops
+  // CHECK-COUNT-2: "onnx.LeakyRelu"
+  // CHECK-COUNT-2: "onnx.RandomNormal"
+}
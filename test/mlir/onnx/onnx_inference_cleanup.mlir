@@ -0,0 +1,53 @@
+// RUN: onnx-mlir-opt --inference-cleanup-onnx %s -split-input-file | FileCheck %s
+
+/// The Dropout and the Identity are replaced by their inputs.
+func @test_dropout_identity(%arg0 : tensor<2x3xf32>, %arg1 : tensor<1xf32>, %arg2 : tensor<1xi1>) -> tensor<*xf32> {
+  %output, %mask = "onnx.Dropout"(%arg0, %arg1, %arg2) : (tensor<2x3xf32>, tensor<1xf32>, tensor<1xi1>) -> (tensor<*xf32>, tensor<*xi1>)
+  %0 = "onnx.Identity"(%output) : (tensor<*xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  return %1 : tensor<*xf32>
+
+  // CHECK-LABEL: test_dropout_identity
+  // CHECK-NOT: "onnx.Dropout"
+  // CHECK-NOT: "onnx.Identity"
+  // CHECK: [[RES:%.+]] = "onnx.Relu"(%arg0) : (tensor<2x3xf32>) -> tensor<*xf32>
+  // CHECK: return [[RES]] : tensor<*xf32>
+}
+
+// -----
+
+/// The used mask of a Dropout is a constant of trues.
+func @test_dropout_mask(%arg0 : tensor<2x3xf32>, %arg1 : tensor<1xf32>, %arg2 : tensor<1xi1>) -> (tensor<*xf32>, tensor<*xi1>) {
+  %output, %mask = "onnx.Dropout"(%arg0, %arg1, %arg2) : (tensor<2x3xf32>, tensor<1xf32>, tensor<1xi1>) -> (tensor<*xf32>, tensor<*xi1>)
+  return %output, %mask : tensor<*xf32>, tensor<*xi1>
+
+  // CHECK-LABEL: test_dropout_mask
+  // CHECK-SAME: -> (tensor<2x3xf32>, tensor<2x3xi1>)
+  // CHECK-NOT: "onnx.Dropout"
+  // CHECK: [[MASK:%.+]] = "onnx.Constant"() {value = dense<true> : tensor<2x3xi1>} : () -> tensor<2x3xi1>
+  // CHECK: return %arg0, [[MASK]] : tensor<2x3xf32>, tensor<2x3xi1>
+}
+
+// -----
+
+/// A BatchNormalization whose statistics are not used is in test mode.
+func @test_batchnorm_training(%arg0 : tensor<1x2x4x4xf32>, %arg1 : tensor<2xf32>, %arg2 : tensor<2xf32>, %arg3 : tensor<2xf32>, %arg4 : tensor<2xf32>) -> tensor<*xf32> {
+  %Y, %mean, %var, %saved_mean, %saved_var = "onnx.BatchNormalization"(%arg0, %arg1, %arg2, %arg3, %arg4) {epsilon = 1.000000e-03 : f32} : (tensor<1x2x4x4xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>) -> (tensor<*xf32>, tensor<*xf32>, tensor<*xf32>, tensor<*xf32>, tensor<*xf32>)
+  return %Y : tensor<*xf32>
+
+  // CHECK-LABEL: test_batchnorm_training
+  // CHECK: [[RES:%.+]] = "onnx.BatchNormalizationTestMode"(%arg0, %arg1, %arg2, %arg3, %arg4) {epsilon = 1.000000e-03 : f32, momentum = 0.899999976 : f32} : (tensor<1x2x4x4xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>) -> tensor<*xf32>
+  // CHECK: return [[RES]] : tensor<*xf32>
+}
+
+// -----
+
+/// The unused optional outputs of an LSTM are none.
+func @test_lstm_unused_outputs(%arg0: tensor<7x2x3xf32>, %arg1: tensor<1x16x3xf32>, %arg2: tensor<1x16x4xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %Y, %Y_h, %Y_c = "onnx.LSTM"(%arg0, %arg1, %arg2, %cst, %cst, %cst, %cst, %cst) {hidden_size = 4 : si64} : (tensor<7x2x3xf32>, tensor<1x16x3xf32>, tensor<1x16x4xf32>, none, none, none, none, none) -> (tensor<*xf32>, tensor<*xf32>, tensor<*xf32>)
+  return %Y_h : tensor<*xf32>
+
+  // CHECK-LABEL: test_lstm_unused_outputs
+  // CHECK: "onnx.LSTM"({{.*}}) {hidden_size = 4 : si64} : (tensor<7x2x3xf32>, tensor<1x16x3xf32>, tensor<1x16x4xf32>, none, none, none, none, none) -> (none, tensor<*xf32>, none)
+}
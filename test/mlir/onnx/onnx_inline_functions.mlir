@@ -0,0 +1,55 @@
+// RUN: onnx-mlir-opt --inline-functions-onnx="max-ops=4" %s -split-input-file | FileCheck %s
+
+/// The small function is inlined and erased, its calls of the functions it
+/// calls being inlined first.
+func private @scale(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = "onnx.Constant"() {value = dense<2.0> : tensor<1xf32>} : () -> tensor<1xf32>
+  %1 = "onnx.Mul"(%arg0, %0) : (tensor<2x3xf32>, tensor<1xf32>) -> tensor<2x3xf32>
+  return %1 : tensor<2x3xf32>
+}
+func private @scale_relu(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = call @scale(%arg0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %1 : tensor<2x3xf32>
+}
+func @test_inline(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = call @scale_relu(%arg0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %0 : tensor<2x3xf32>
+
+  // CHECK-NOT: func private @scale
+  // CHECK-LABEL: func @test_inline
+  // CHECK-SAME: ([[ARG:%.+]]: tensor<2x3xf32>)
+  // CHECK-NOT: call
+  // CHECK: [[CST:%.+]] = "onnx.Constant"() {value = dense<2.000000e+00> : tensor<1xf32>} : () -> tensor<1xf32>
+  // CHECK: [[MUL:%.+]] = "onnx.Mul"([[ARG]], [[CST]])
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[MUL]])
+  // CHECK: return [[RELU]] : tensor<2x3xf32>
+}
+
+// -----
+
+/// The functions of more than max-ops ops and the noinline ones are kept.
+func private @large(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  %1 = "onnx.Sigmoid"(%0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  %2 = "onnx.Tanh"(%1) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  %3 = "onnx.Exp"(%2) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  %4 = "onnx.Neg"(%3) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %4 : tensor<2x3xf32>
+}
+func private @layer(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32> attributes {passthrough = ["noinline"]} {
+  %0 = "onnx.Relu"(%arg0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %0 : tensor<2x3xf32>
+}
+func @test_keep(%arg0: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = call @large(%arg0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  %1 = call @layer(%0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %1 : tensor<2x3xf32>
+
+  // CHECK: func private @large
+  // CHECK: func private @layer
+  // CHECK-LABEL: func @test_keep
+  // CHECK: [[LARGE:%.+]] = call @large(%arg0)
+  // CHECK: [[LAYER:%.+]] = call @layer([[LARGE]])
+  // CHECK: return [[LAYER]] : tensor<2x3xf32>
+}
@@ -0,0 +1,73 @@
+// RUN: onnx-mlir-opt --layout-propagation-onnx %s -split-input-file | FileCheck %s
+
+// -----
+
+/// A Transpose pushed through a Relu cancels its inverse.
+func @test_relu_between_transposes(%arg0 : tensor<1x8x8x4xf32>) -> tensor<1x8x8x4xf32> {
+  %0 = "onnx.Transpose"(%arg0) {perm = [0, 3, 1, 2]} : (tensor<1x8x8x4xf32>) -> tensor<1x4x8x8xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<1x4x8x8xf32>) -> tensor<1x4x8x8xf32>
+  %2 = "onnx.Transpose"(%1) {perm = [0, 2, 3, 1]} : (tensor<1x4x8x8xf32>) -> tensor<1x8x8x4xf32>
+  "std.return"(%2) : (tensor<1x8x8x4xf32>) -> ()
+
+  // CHECK-LABEL: test_relu_between_transposes
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Relu"(%arg0) : (tensor<1x8x8x4xf32>) -> tensor<1x8x8x4xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<1x8x8x4xf32>
+}
+
+// -----
+
+/// A constant operand of an Add is transposed by the inverse permutation.
+func @test_add_constant_between_transposes(%arg0 : tensor<4x8xf32>) -> tensor<4x8xf32> {
+  %cst = "onnx.Constant"() {value = dense<1.0> : tensor<8x4xf32>} : () -> tensor<8x4xf32>
+  %0 = "onnx.Transpose"(%arg0) {perm = [1, 0]} : (tensor<4x8xf32>) -> tensor<8x4xf32>
+  %1 = "onnx.Add"(%0, %cst) : (tensor<8x4xf32>, tensor<8x4xf32>) -> tensor<8x4xf32>
+  %2 = "onnx.Transpose"(%1) {perm = [1, 0]} : (tensor<8x4xf32>) -> tensor<4x8xf32>
+  "std.return"(%2) : (tensor<4x8xf32>) -> ()
+
+  // CHECK-LABEL: test_add_constant_between_transposes
+  // CHECK: [[CST:%.+]] = "onnx.Constant"() {value = dense<1.000000e+00> : tensor<8x4xf32>} : () -> tensor<8x4xf32>
+  // CHECK: [[TRANS:%.+]] = "onnx.Transpose"([[CST]]) {perm = [1, 0]} : (tensor<8x4xf32>) -> tensor<4x8xf32>
+  // CHECK: [[RES:%.+]] = "onnx.Add"(%arg0, [[TRANS]]) : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<4x8xf32>
+}
+
+// -----
+
+/// The spatial attributes of a pooling are permuted with its spatial dims.
+func @test_maxpool_between_transposes(%arg0 : tensor<1x3x8x16xf32>) -> tensor<1x3x5x15xf32> {
+  %0 = "onnx.Transpose"(%arg0) {perm = [0, 1, 3, 2]} : (tensor<1x3x8x16xf32>) -> tensor<1x3x16x8xf32>
+  %1 = "onnx.MaxPoolSingleOut"(%0) {kernel_shape = [2, 4], pads = [0, 1, 0, 3], strides = [1, 2]} : (tensor<1x3x16x8xf32>) -> tensor<1x3x15x5xf32>
+  %2 = "onnx.Transpose"(%1) {perm = [0, 1, 3, 2]} : (tensor<1x3x15x5xf32>) -> tensor<1x3x5x15xf32>
+  "std.return"(%2) : (tensor<1x3x5x15xf32>) -> ()
+
+  // CHECK-LABEL: test_maxpool_between_transposes
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.MaxPoolSingleOut"(%arg0) {kernel_shape = [4, 2], pads = [1, 0, 3, 0], strides = [2, 1]} : (tensor<1x3x8x16xf32>) -> tensor<1x3x5x15xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<1x3x5x15xf32>
+}
+
+// -----
+
+/// A transposed operand of a Gemm flips its transA attribute.
+func @test_gemm_transposed_operand(%arg0 : tensor<8x4xf32>, %arg1 : tensor<8x16xf32>, %arg2 : tensor<16xf32>) -> tensor<4x16xf32> {
+  %0 = "onnx.Transpose"(%arg0) {perm = [1, 0]} : (tensor<8x4xf32>) -> tensor<4x8xf32>
+  %1 = "onnx.Gemm"(%0, %arg1, %arg2) : (tensor<4x8xf32>, tensor<8x16xf32>, tensor<16xf32>) -> tensor<4x16xf32>
+  "std.return"(%1) : (tensor<4x16xf32>) -> ()
+
+  // CHECK-LABEL: test_gemm_transposed_operand
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Gemm"(%arg0, %arg1, %arg2) {transA = 1 : si64} : (tensor<8x4xf32>, tensor<8x16xf32>, tensor<16xf32>) -> tensor<4x16xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<4x16xf32>
+}
+
+// -----
+
+/// A MatMul of a transposed matrix becomes a Gemm without bias.
+func @test_matmul_transposed_operand(%arg0 : tensor<4x8xf32>, %arg1 : tensor<16x8xf32>) -> tensor<4x16xf32> {
+  %0 = "onnx.Transpose"(%arg1) {perm = [1, 0]} : (tensor<16x8xf32>) -> tensor<8x16xf32>
+  %1 = "onnx.MatMul"(%arg0, %0) : (tensor<4x8xf32>, tensor<8x16xf32>) -> tensor<4x16xf32>
+  "std.return"(%1) : (tensor<4x16xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_transposed_operand
+  // CHECK-NEXT: [[NONE:%.+]] = constant unit
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Gemm"(%arg0, %arg1, [[NONE]]) {alpha = 1.000000e+00 : f32, beta = 1.000000e+00 : f32, transA = 0 : si64, transB = 1 : si64} : (tensor<4x8xf32>, tensor<16x8xf32>, none) -> tensor<4x16xf32>
+  // CHECK-NEXT: return [[RES]] : tensor<4x16xf32>
+}
@@ -0,0 +1,24 @@
+// RUN: onnx-mlir-opt --loop-invariant-motion-onnx %s -split-input-file | FileCheck %s
+
+/// The operations of the body that only depend on the outer values are moved
+/// before the Loop.
+func @test_loop_invariant(%arg0: tensor<i64>, %arg1: tensor<i1>, %arg2: tensor<3x2xf32>, %arg3: tensor<2x3xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Loop"(%arg0, %arg1, %arg3) ({
+  ^bb0(%body_arg0: tensor<*xi64>, %body_arg1: tensor<*xi1>, %body_arg2: tensor<*xf32>):
+    %1 = "onnx.Transpose"(%arg2) {perm = [1, 0]} : (tensor<3x2xf32>) -> tensor<*xf32>
+    %2 = "onnx.Relu"(%1) : (tensor<*xf32>) -> tensor<*xf32>
+    %3 = "onnx.RandomNormalLike"(%arg3) : (tensor<2x3xf32>) -> tensor<*xf32>
+    %4 = "onnx.Add"(%body_arg2, %2) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+    %5 = "onnx.Add"(%4, %3) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+    onnx.Return %body_arg1, %5 : tensor<*xi1>, tensor<*xf32>
+  }) : (tensor<i64>, tensor<i1>, tensor<2x3xf32>) -> tensor<*xf32>
+  return %0 : tensor<*xf32>
+
+  // CHECK-LABEL: test_loop_invariant
+  // CHECK: [[TRANSPOSE:%.+]] = "onnx.Transpose"(%arg2) {perm = [1, 0]} : (tensor<3x2xf32>) -> tensor<*xf32>
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[TRANSPOSE]]) : (tensor<*xf32>) -> tensor<*xf32>
+  // CHECK: "onnx.Loop"
+  // CHECK: [[RANDOM:%.+]] = "onnx.RandomNormalLike"(%arg3)
+  // CHECK: [[ADD:%.+]] = "onnx.Add"(%arg6, [[RELU]])
+  // CHECK: "onnx.Add"([[ADD]], [[RANDOM]])
+}
@@ -554,6 +554,52 @@ func private @test_min(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) ->
 
 // -----
 
+/// The operands are combined as vectors in one loop nest.
+func private @test_max_vectorized(%arg0 : tensor<2x8xf32>, %arg1 : tensor<2x8xf32>, %arg2 : tensor<2x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Max"(%arg0, %arg1, %arg2) : (tensor<2x8xf32>, tensor<2x8xf32>, tensor<2x8xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_max_vectorized
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<2x8xf32>
+  // CHECK-DAG: [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<2x8xf32> to memref<2x1xvector<8xf32>>
+  // CHECK-DAG: [[VEC_Y:%.+]] = krnl.vector_type_cast %arg1 : memref<2x8xf32> to memref<2x1xvector<8xf32>>
+  // CHECK-DAG: [[VEC_Z:%.+]] = krnl.vector_type_cast %arg2 : memref<2x8xf32> to memref<2x1xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<2x8xf32> to memref<2x1xvector<8xf32>>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> [[I:%.+]] = 0 to 2, {{.*}} -> [[J:%.+]] = 0 to 1) {
+  // CHECK:   [[X:%.+]] = krnl.load [[VEC_X]]{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:   [[Y:%.+]] = krnl.load [[VEC_Y]]{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:   [[Z:%.+]] = krnl.load [[VEC_Z]]{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:   [[CMP1:%.+]] = cmpf ogt, [[X]], [[Y]] : vector<8xf32>
+  // CHECK:   [[MAX1:%.+]] = select [[CMP1]], [[X]], [[Y]] : vector<8xi1>, vector<8xf32>
+  // CHECK:   [[CMP2:%.+]] = cmpf ogt, [[MAX1]], [[Z]] : vector<8xf32>
+  // CHECK:   [[MAX2:%.+]] = select [[CMP2]], [[MAX1]], [[Z]] : vector<8xi1>, vector<8xf32>
+  // CHECK:   krnl.store [[MAX2]], [[VEC_RES]]{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<2x8xf32>
+}
+
+// -----
+
+/// The sum of the operands is divided by their number in the same loop nest.
+func private @test_mean(%arg0 : tensor<2x8xf32>, %arg1 : tensor<2x8xf32>, %arg2 : tensor<2x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Mean"(%arg0, %arg1, %arg2) : (tensor<2x8xf32>, tensor<2x8xf32>, tensor<2x8xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_mean
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<2x8xf32>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> [[I:%.+]] = 0 to 2, {{.*}} -> [[J:%.+]] = 0 to 1) {
+  // CHECK:   [[X:%.+]] = krnl.load {{.*}}{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:   [[Y:%.+]] = krnl.load {{.*}}{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:   [[Z:%.+]] = krnl.load {{.*}}{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:   [[ADD1:%.+]] = addf [[X]], [[Y]] : vector<8xf32>
+  // CHECK:   [[ADD2:%.+]] = addf [[ADD1]], [[Z]] : vector<8xf32>
+  // CHECK:   [[COUNT:%.+]] = constant dense<3.000000e+00> : vector<8xf32>
+  // CHECK:   [[MEAN:%.+]] = divf [[ADD2]], [[COUNT]] : vector<8xf32>
+  // CHECK:   krnl.store [[MEAN]], {{.*}}{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<2x8xf32>
+}
+
+// -----
+
 func private @test_elu(%arg0 : tensor<?x10xf32>) -> tensor<*xf32> {
   %0 = "onnx.Elu"(%arg0) {alpha=2.0:f32} : (tensor<?x10xf32>) -> tensor<*xf32>
   "std.return"(%0) : (tensor<*xf32>) -> ()
@@ -948,14 +994,24 @@ func private @test_transpose(%arg0 : tensor<10x20x30x40xf32>) -> tensor<*xf32> {
   // CHECK: [[RES1:%.+]] = memref.alloc() : memref<40x30x20x10xf32>
 
   // CHECK: [[DEF_LOOPS:%.+]]:4 = krnl.define_loops 4
-  // CHECK: krnl.iterate([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1, [[DEF_LOOPS]]#2, [[DEF_LOOPS]]#3) with ([[DEF_LOOPS]]#0 -> %arg1 = 0 to 10, [[DEF_LOOPS]]#1 -> %arg2 = 0 to 20, [[DEF_LOOPS]]#2 -> %arg3 = 0 to 30, [[DEF_LOOPS]]#3 -> %arg4 = 0 to 40) {
-  // CHECK: [[LOAD:%.+]] = krnl.load %arg0[%arg1, %arg2, %arg3, %arg4] : memref<10x20x30x40xf32>
-  // CHECK: krnl.store [[LOAD]], [[RES1]][%arg4, %arg3, %arg2, %arg1] : memref<40x30x20x10xf32>
+  // CHECK: [[BLOCK_TILE_0:%.+]], [[BLOCK_IN_0:%.+]] = krnl.block [[DEF_LOOPS]]#0 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK: [[BLOCK_TILE_3:%.+]], [[BLOCK_IN_3:%.+]] = krnl.block [[DEF_LOOPS]]#3 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK: krnl.permute([[BLOCK_TILE_0]], [[BLOCK_IN_0]], [[DEF_LOOPS]]#1, [[DEF_LOOPS]]#2, [[BLOCK_TILE_3]], [[BLOCK_IN_3]]) [2, 4, 0, 1, 3, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+  // CHECK: krnl.parallel [[DEF_LOOPS]]#1 : !krnl.loop
+  // CHECK: krnl.iterate([[BLOCK_TILE_0]], [[BLOCK_IN_0]], [[DEF_LOOPS]]#1, [[DEF_LOOPS]]#2, [[BLOCK_TILE_3]], [[BLOCK_IN_3]]) with ([[DEF_LOOPS]]#0 -> %{{.*}} = 0 to 10, [[DEF_LOOPS]]#1 -> %{{.*}} = 0 to 20, [[DEF_LOOPS]]#2 -> %{{.*}} = 0 to 30, [[DEF_LOOPS]]#3 -> %{{.*}} = 0 to 40) {
+  // CHECK: [[IV:%.+]]:4 = krnl.get_induction_var_value([[BLOCK_IN_0]], [[DEF_LOOPS]]#1, [[DEF_LOOPS]]#2, [[BLOCK_IN_3]]) : (!krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop) -> (index, index, index, index)
+  // CHECK: [[LOAD:%.+]] = krnl.load %arg0{{.}}[[IV]]#0, [[IV]]#1, [[IV]]#2, [[IV]]#3{{.}} : memref<10x20x30x40xf32>
+  // CHECK: krnl.store [[LOAD]], [[RES1]]{{.}}[[IV]]#3, [[IV]]#2, [[IV]]#1, [[IV]]#0{{.}} : memref<40x30x20x10xf32>
 
   // CHECK: [[DEF_LOOPS:%.+]]:4 = krnl.define_loops 4
-  // CHECK: krnl.iterate([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1, [[DEF_LOOPS]]#2, [[DEF_LOOPS]]#3) with ([[DEF_LOOPS]]#0 -> %arg1 = 0 to 40, [[DEF_LOOPS]]#1 -> %arg2 = 0 to 30, [[DEF_LOOPS]]#2 -> %arg3 = 0 to 20, [[DEF_LOOPS]]#3 -> %arg4 = 0 to 10) {
-  // CHECK: [[LOAD:%.+]] = krnl.load [[RES1]][%arg1, %arg2, %arg3, %arg4] : memref<40x30x20x10xf32>
-  // CHECK: krnl.store [[LOAD]], [[RES0]][%arg1, %arg4, %arg2, %arg3] : memref<40x10x30x20xf32>
+  // CHECK: [[BLOCK_TILE_2:%.+]], [[BLOCK_IN_2:%.+]] = krnl.block [[DEF_LOOPS]]#2 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK: [[BLOCK_TILE_3:%.+]], [[BLOCK_IN_3:%.+]] = krnl.block [[DEF_LOOPS]]#3 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK: krnl.permute([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1, [[BLOCK_TILE_2]], [[BLOCK_IN_2]], [[BLOCK_TILE_3]], [[BLOCK_IN_3]]) [0, 1, 2, 4, 3, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+  // CHECK: krnl.parallel [[DEF_LOOPS]]#0 : !krnl.loop
+  // CHECK: krnl.iterate([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1, [[BLOCK_TILE_2]], [[BLOCK_IN_2]], [[BLOCK_TILE_3]], [[BLOCK_IN_3]]) with ([[DEF_LOOPS]]#0 -> %{{.*}} = 0 to 40, [[DEF_LOOPS]]#1 -> %{{.*}} = 0 to 30, [[DEF_LOOPS]]#2 -> %{{.*}} = 0 to 20, [[DEF_LOOPS]]#3 -> %{{.*}} = 0 to 10) {
+  // CHECK: [[IV:%.+]]:4 = krnl.get_induction_var_value([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1, [[BLOCK_IN_2]], [[BLOCK_IN_3]]) : (!krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop) -> (index, index, index, index)
+  // CHECK: [[LOAD:%.+]] = krnl.load [[RES1]]{{.}}[[IV]]#0, [[IV]]#1, [[IV]]#2, [[IV]]#3{{.}} : memref<40x30x20x10xf32>
+  // CHECK: krnl.store [[LOAD]], [[RES0]]{{.}}[[IV]]#0, [[IV]]#3, [[IV]]#1, [[IV]]#2{{.}} : memref<40x10x30x20xf32>
 
   // CHECK: memref.dealloc [[RES1]] : memref<40x30x20x10xf32>
   // CHECK: return [[RES0]] : memref<40x10x30x20xf32>
@@ -971,13 +1027,17 @@ func private @test_transpose_dynamic_dims(%arg0 : tensor<10x?x30x40xf32>) -> ten
   // CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<10x?x30x40xf32>) -> memref<10x40x?x30xf32> {
   // CHECK:           [[CST_1_:%.+]] = constant 1 : index
   // CHECK:           [[DIM_0_:%.+]] = memref.dim [[PARAM_0_]], [[CST_1_]] : memref<10x?x30x40xf32>
-  // CHECK-DAG:       [[RES_:%.+]] = memref.alloc([[DIM_0_]]) : memref<10x40x?x30xf32>
-  // CHECK-DAG:       [[LOOP_0_:%.+]]:4 = krnl.define_loops 4
-  // CHECK-DAG:       [[CST_1_1_:%.+]] = constant 1 : index
-  // CHECK:           [[DIM_1_:%.+]] = memref.dim [[PARAM_0_]], [[CST_1_1_]] : memref<10x?x30x40xf32>
-  // CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[LOOP_0_]]#2, [[LOOP_0_]]#3) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 10, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to [[DIM_1_]], [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 30, [[LOOP_0_]]#3 -> [[I_3_:%.+]] = 0 to 40) {
-  // CHECK:             [[LOAD_PARAM_0_MEM_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[I_0_]], [[I_1_]], [[I_2_]], [[I_3_]]{{.}} : memref<10x?x30x40xf32>
-  // CHECK:             krnl.store [[LOAD_PARAM_0_MEM_]], [[RES_]]{{.}}[[I_0_]], [[I_3_]], [[I_1_]], [[I_2_]]{{.}} : memref<10x40x?x30xf32>
+  // CHECK:           [[RES_:%.+]] = memref.alloc([[DIM_0_]]) : memref<10x40x?x30xf32>
+  // CHECK:           [[DIM_1_:%.+]] = memref.dim [[PARAM_0_]], {{.*}} : memref<10x?x30x40xf32>
+  // CHECK:           [[LOOP_0_:%.+]]:4 = krnl.define_loops 4
+  // CHECK:           [[BLOCK_TILE_2_:%.+]], [[BLOCK_IN_2_:%.+]] = krnl.block [[LOOP_0_]]#2 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK:           [[BLOCK_TILE_3_:%.+]], [[BLOCK_IN_3_:%.+]] = krnl.block [[LOOP_0_]]#3 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+  // CHECK:           krnl.permute([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[BLOCK_TILE_2_]], [[BLOCK_IN_2_]], [[BLOCK_TILE_3_]], [[BLOCK_IN_3_]]) [0, 1, 2, 4, 3, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+  // CHECK:           krnl.parallel [[LOOP_0_]]#0 : !krnl.loop
+  // CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[BLOCK_TILE_2_]], [[BLOCK_IN_2_]], [[BLOCK_TILE_3_]], [[BLOCK_IN_3_]]) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 10, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to [[DIM_1_]], [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 30, [[LOOP_0_]]#3 -> [[I_3_:%.+]] = 0 to 40) {
+  // CHECK:             [[IV_:%.+]]:4 = krnl.get_induction_var_value([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[BLOCK_IN_2_]], [[BLOCK_IN_3_]]) : (!krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop) -> (index, index, index, index)
+  // CHECK:             [[LOAD_PARAM_0_MEM_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[IV_]]#0, [[IV_]]#1, [[IV_]]#2, [[IV_]]#3{{.}} : memref<10x?x30x40xf32>
+  // CHECK:             krnl.store [[LOAD_PARAM_0_MEM_]], [[RES_]]{{.}}[[IV_]]#0, [[IV_]]#3, [[IV_]]#1, [[IV_]]#2{{.}} : memref<10x40x?x30xf32>
   // CHECK:           }
   // CHECK:           return [[RES_]] : memref<10x40x?x30xf32>
   // CHECK:         }
@@ -1056,21 +1116,24 @@ func private @test_matmul2(%arg0 : tensor<10x5xf32>, %arg1 : tensor<2x3x5x10xf32
 //CHECK-SAME:   ([[A_:%.+]]: memref<10x5xf32>, [[B_:%.+]]: memref<2x3x5x10xf32>) -> memref<2x3x10x10xf32> {
 //CHECK:           [[RES_:%.+]] = memref.alloc() : memref<2x3x10x10xf32>
 //CHECK:           [[VAR_cst_:%.+]] = constant 0.000000e+00 : f32
-//CHECK:           [[LOOP_0_:%.+]]:4 = krnl.define_loops 4
-//CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[LOOP_0_]]#2, [[LOOP_0_]]#3) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 2, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 3, [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 10, [[LOOP_0_]]#3 -> [[I_3_:%.+]] = 0 to 10) {
-//CHECK:             [[REDUCTION_VAL:%.+]] = memref.alloca() : memref<f32>
-//CHECK:             krnl.store [[VAR_cst_]], [[REDUCTION_VAL]][] : memref<f32>
-//CHECK:             [[LOOP_1_:%.+]] = krnl.define_loops 1
-//CHECK:             krnl.iterate([[LOOP_1_]]) with ([[LOOP_1_]] -> [[I_4_:%.+]] = 0 to 5) {
-//CHECK:               [[LOAD_A_MEM_:%.+]] = krnl.load [[A_]]{{.}}[[I_2_]], [[I_4_]]{{.}} : memref<10x5xf32>
-//CHECK:               [[LOAD_B_MEM_:%.+]] = krnl.load [[B_]]{{.}}[[I_0_]], [[I_1_]], [[I_4_]], [[I_3_]]{{.}} : memref<2x3x5x10xf32>
-//CHECK:               [[LOAD_RES_MEM_:%.+]] = krnl.load [[REDUCTION_VAL]][] : memref<f32>
-//CHECK:               [[VAR_6_:%.+]] = mulf [[LOAD_A_MEM_]], [[LOAD_B_MEM_]] : f32
-//CHECK:               [[VAR_7_:%.+]] = addf [[LOAD_RES_MEM_]], [[VAR_6_]] : f32
-//CHECK:               krnl.store [[VAR_7_]], [[REDUCTION_VAL]][] : memref<f32>
+//CHECK:           [[LOOP_0_:%.+]]:2 = krnl.define_loops 2
+//CHECK:           krnl.parallel [[LOOP_0_]]#0 : !krnl.loop
+//CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 2, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 3) {
+//CHECK:             [[BATCH_:%.+]]:2 = krnl.get_induction_var_value([[LOOP_0_]]#0, [[LOOP_0_]]#1) : (!krnl.loop, !krnl.loop) -> (index, index)
+//CHECK:             [[LOOP_1_:%.+]]:2 = krnl.define_loops 2
+//CHECK:             krnl.iterate([[LOOP_1_]]#0, [[LOOP_1_]]#1) with ([[LOOP_1_]]#0 -> [[I_2_:%.+]] = 0 to 10, [[LOOP_1_]]#1 -> [[I_3_:%.+]] = 0 to 10) {
+//CHECK:               [[VAR_3_:%.+]]:2 = krnl.get_induction_var_value([[LOOP_1_]]#0, [[LOOP_1_]]#1) : (!krnl.loop, !krnl.loop) -> (index, index)
+//CHECK:               krnl.store [[VAR_cst_]], [[RES_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, [[VAR_3_]]#0, [[VAR_3_]]#1] : memref<2x3x10x10xf32>
+//CHECK:             }
+//CHECK:             [[LOOP_2_:%.+]]:3 = krnl.define_loops 3
+//CHECK:             [[BLOCK_TILE__0_:%.+]], [[BLOCK_IN__0_:%.+]] = krnl.block [[LOOP_2_]]#0 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+//CHECK:             [[BLOCK_TILE__1_:%.+]], [[BLOCK_IN__1_:%.+]] = krnl.block [[LOOP_2_]]#1 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+//CHECK:             [[BLOCK_TILE__2_:%.+]], [[BLOCK_IN__2_:%.+]] = krnl.block [[LOOP_2_]]#2 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+//CHECK:             krnl.permute([[BLOCK_TILE__0_]], [[BLOCK_IN__0_]], [[BLOCK_TILE__1_]], [[BLOCK_IN__1_]], [[BLOCK_TILE__2_]], [[BLOCK_IN__2_]]) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+//CHECK:             krnl.iterate([[BLOCK_TILE__0_]], [[BLOCK_TILE__1_]], [[BLOCK_TILE__2_]]) with ([[LOOP_2_]]#0 -> [[I_4_:%.+]] = 0 to 10, [[LOOP_2_]]#1 -> [[I_5_:%.+]] = 0 to 10, [[LOOP_2_]]#2 -> [[I_6_:%.+]] = 0 to 5) {
+//CHECK:               [[VAR_4_:%.+]]:3 = krnl.get_induction_var_value([[BLOCK_TILE__0_]], [[BLOCK_TILE__1_]], [[BLOCK_TILE__2_]]) : (!krnl.loop, !krnl.loop, !krnl.loop) -> (index, index, index)
+//CHECK:               krnl.matmul [[A_]]{{.}}{{.*}}{{.}}, [[B_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, {{.*}}{{.}}, [[RES_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, {{.*}}{{.}}, ([[BLOCK_IN__0_]], [[BLOCK_IN__1_]], [[BLOCK_IN__2_]]), ([[VAR_4_]]#0, [[VAR_4_]]#1, [[VAR_4_]]#2), ({{.*}}) {{.*}} : memref<10x5xf32>, memref<2x3x5x10xf32>, memref<2x3x10x10xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
 //CHECK:             }
-//CHECK:             [[LOAD_REDUCTION:%.+]] = krnl.load [[REDUCTION_VAL]][] : memref<f32>
-//CHECK:             krnl.store [[LOAD_REDUCTION]], [[RES_]]{{.}}[[I_0_]], [[I_1_]], [[I_2_]], [[I_3_]]{{.}} : memref<2x3x10x10xf32>
 //CHECK:           }
 //CHECK:           return [[RES_]] : memref<2x3x10x10xf32>
 //CHECK:         }
@@ -1087,21 +1150,24 @@ func private @test_matmul3(%arg0 : tensor<2x3x10x5xf32>, %arg1 : tensor<2x3x5x10
 //CHECK-SAME:   ([[A_:%.+]]: memref<2x3x10x5xf32>, [[B_:%.+]]: memref<2x3x5x10xf32>) -> memref<2x3x10x10xf32> {
 //CHECK:           [[RES_:%.+]] = memref.alloc() : memref<2x3x10x10xf32>
 //CHECK:           [[VAR_cst_:%.+]] = constant 0.000000e+00 : f32
-//CHECK:           [[LOOP_0_:%.+]]:4 = krnl.define_loops 4
-//CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[LOOP_0_]]#2, [[LOOP_0_]]#3) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 2, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 3, [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 10, [[LOOP_0_]]#3 -> [[I_3_:%.+]] = 0 to 10) {
-//CHECK:             [[REDUCTION_VAL:%.+]] = memref.alloca() : memref<f32>
-//CHECK:             krnl.store [[VAR_cst_]], [[REDUCTION_VAL]][] : memref<f32>
-//CHECK:             [[LOOP_1_:%.+]] = krnl.define_loops 1
-//CHECK:             krnl.iterate([[LOOP_1_]]) with ([[LOOP_1_]] -> [[I_4_:%.+]] = 0 to 5) {
-//CHECK:               [[LOAD_A_MEM_:%.+]] = krnl.load [[A_]]{{.}}[[I_0_]], [[I_1_]], [[I_2_]], [[I_4_]]{{.}} : memref<2x3x10x5xf32>
-//CHECK:               [[LOAD_B_MEM_:%.+]] = krnl.load [[B_]]{{.}}[[I_0_]], [[I_1_]], [[I_4_]], [[I_3_]]{{.}} : memref<2x3x5x10xf32>
-//CHECK:               [[LOAD_RES_MEM_:%.+]] = krnl.load [[REDUCTION_VAL]][] : memref<f32>
-//CHECK:               [[VAR_6_:%.+]] = mulf [[LOAD_A_MEM_]], [[LOAD_B_MEM_]] : f32
-//CHECK:               [[VAR_7_:%.+]] = addf [[LOAD_RES_MEM_]], [[VAR_6_]] : f32
-//CHECK:               krnl.store [[VAR_7_]], [[REDUCTION_VAL]][] : memref<f32>
+//CHECK:           [[LOOP_0_:%.+]]:2 = krnl.define_loops 2
+//CHECK:           krnl.parallel [[LOOP_0_]]#0 : !krnl.loop
+//CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 2, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 3) {
+//CHECK:             [[BATCH_:%.+]]:2 = krnl.get_induction_var_value([[LOOP_0_]]#0, [[LOOP_0_]]#1) : (!krnl.loop, !krnl.loop) -> (index, index)
+//CHECK:             [[LOOP_1_:%.+]]:2 = krnl.define_loops 2
+//CHECK:             krnl.iterate([[LOOP_1_]]#0, [[LOOP_1_]]#1) with ([[LOOP_1_]]#0 -> [[I_2_:%.+]] = 0 to 10, [[LOOP_1_]]#1 -> [[I_3_:%.+]] = 0 to 10) {
+//CHECK:               [[VAR_3_:%.+]]:2 = krnl.get_induction_var_value([[LOOP_1_]]#0, [[LOOP_1_]]#1) : (!krnl.loop, !krnl.loop) -> (index, index)
+//CHECK:               krnl.store [[VAR_cst_]], [[RES_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, [[VAR_3_]]#0, [[VAR_3_]]#1] : memref<2x3x10x10xf32>
+//CHECK:             }
+//CHECK:             [[LOOP_2_:%.+]]:3 = krnl.define_loops 3
+//CHECK:             [[BLOCK_TILE__0_:%.+]], [[BLOCK_IN__0_:%.+]] = krnl.block [[LOOP_2_]]#0 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+//CHECK:             [[BLOCK_TILE__1_:%.+]], [[BLOCK_IN__1_:%.+]] = krnl.block [[LOOP_2_]]#1 8 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+//CHECK:             [[BLOCK_TILE__2_:%.+]], [[BLOCK_IN__2_:%.+]] = krnl.block [[LOOP_2_]]#2 4 : (!krnl.loop) -> (!krnl.loop, !krnl.loop)
+//CHECK:             krnl.permute([[BLOCK_TILE__0_]], [[BLOCK_IN__0_]], [[BLOCK_TILE__1_]], [[BLOCK_IN__1_]], [[BLOCK_TILE__2_]], [[BLOCK_IN__2_]]) [0, 3, 1, 4, 2, 5] : !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop, !krnl.loop
+//CHECK:             krnl.iterate([[BLOCK_TILE__0_]], [[BLOCK_TILE__1_]], [[BLOCK_TILE__2_]]) with ([[LOOP_2_]]#0 -> [[I_4_:%.+]] = 0 to 10, [[LOOP_2_]]#1 -> [[I_5_:%.+]] = 0 to 10, [[LOOP_2_]]#2 -> [[I_6_:%.+]] = 0 to 5) {
+//CHECK:               [[VAR_4_:%.+]]:3 = krnl.get_induction_var_value([[BLOCK_TILE__0_]], [[BLOCK_TILE__1_]], [[BLOCK_TILE__2_]]) : (!krnl.loop, !krnl.loop, !krnl.loop) -> (index, index, index)
+//CHECK:               krnl.matmul [[A_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, {{.*}}{{.}}, [[B_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, {{.*}}{{.}}, [[RES_]]{{.}}[[BATCH_]]#0, [[BATCH_]]#1, {{.*}}{{.}}, ([[BLOCK_IN__0_]], [[BLOCK_IN__1_]], [[BLOCK_IN__2_]]), ([[VAR_4_]]#0, [[VAR_4_]]#1, [[VAR_4_]]#2), ({{.*}}) {{.*}} : memref<2x3x10x5xf32>, memref<2x3x5x10xf32>, memref<2x3x10x10xf32>, (!krnl.loop, !krnl.loop, !krnl.loop)
 //CHECK:             }
-//CHECK:             [[LOAD_REDUCTION:%.+]] = krnl.load [[REDUCTION_VAL]][] : memref<f32>
-//CHECK:             krnl.store [[LOAD_REDUCTION]], [[RES_]]{{.}}[[I_0_]], [[I_1_]], [[I_2_]], [[I_3_]]{{.}} : memref<2x3x10x10xf32>
 //CHECK:           }
 //CHECK:           return [[RES_]] : memref<2x3x10x10xf32>
 //CHECK:         }
@@ -1527,10 +1593,26 @@ func private @test_pad1(%arg0: tensor<16x16xf32>) -> tensor<18x20xf32> {
   // CHECK-LABEL: test_pad1
   // CHECK: [[RES:%.+]] = memref.alloc() : memref<18x20xf32>
   // CHECK: [[DEF_LOOPS1:%.+]]:2 = krnl.define_loops 2
-  // CHECK: krnl.iterate([[DEF_LOOPS1]]#0, [[DEF_LOOPS1]]#1) with ([[DEF_LOOPS1]]#0 -> %arg1 = 0 to 18, [[DEF_LOOPS1]]#1 -> %arg2 = 0 to 20) {
+  // CHECK: krnl.iterate([[DEF_LOOPS1]]#0, [[DEF_LOOPS1]]#1) with ([[DEF_LOOPS1]]#0 -> %arg1 = 16 to 18, [[DEF_LOOPS1]]#1 -> %arg2 = 0 to 20) {
   // CHECK: [[CST:%.+]] = constant 0.000000e+00 : f32
   // CHECK: krnl.store [[CST]], [[RES]][%arg1, %arg2] : memref<18x20xf32>
   // CHECK: }
+  // CHECK: [[DEF_LOOPS2:%.+]]:2 = krnl.define_loops 2
+  // CHECK: krnl.iterate([[DEF_LOOPS2]]#0, [[DEF_LOOPS2]]#1) with ([[DEF_LOOPS2]]#0 -> %arg1 = 0 to 16, [[DEF_LOOPS2]]#1 -> %arg2 = 0 to 3) {
+  // CHECK: krnl.store {{.*}}, [[RES]][%arg1, %arg2] : memref<18x20xf32>
+  // CHECK: }
+  // CHECK: [[DEF_LOOPS3:%.+]]:2 = krnl.define_loops 2
+  // CHECK: krnl.iterate([[DEF_LOOPS3]]#0, [[DEF_LOOPS3]]#1) with ([[DEF_LOOPS3]]#0 -> %arg1 = 0 to 16, [[DEF_LOOPS3]]#1 -> %arg2 = 19 to 20) {
+  // CHECK: krnl.store {{.*}}, [[RES]][%arg1, %arg2] : memref<18x20xf32>
+  // CHECK: }
+  // CHECK: [[DEF_LOOPS4:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.iterate([[DEF_LOOPS4]]) with ([[DEF_LOOPS4]] -> %arg1 = 0 to 16) {
+  // CHECK: [[SRC:%.+]] = memref.subview %arg0[%arg1, 0] [1, 16] [1, 1]
+  // CHECK: [[DST:%.+]] = memref.subview [[RES]][%arg1, 3] [1, 16] [1, 1]
+  // CHECK: [[BYTES:%.+]] = constant 64 : i64
+  // CHECK: "krnl.memcpy"([[DST]], [[SRC]], [[BYTES]])
+  // CHECK: }
+}
   // CHECK: [[DEF_LOOPS2:%.+]]:2 = krnl.define_loops 2
   // CHECK: krnl.iterate([[DEF_LOOPS2]]#0, [[DEF_LOOPS2]]#1) with ([[DEF_LOOPS2]]#0 -> %arg1 = 0 to 16, [[DEF_LOOPS2]]#1 -> %arg2 = 0 to 16) {
   // CHECK: [[ADD:%.+]] = affine.apply #{{.*}}(%arg2)
@@ -1571,8 +1653,24 @@ func private @test_pool_general_computation(%arg0 : tensor<1x3x32x32xf32>) -> te
   // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x3x31x31xf32>
   // CHECK: [[IDENTITY:%.+]] = constant 0.000000e+00 : f32
 
+  // The outputs whose window lies within the input are computed on vectors.
+  // CHECK: [[VEC_IDENTITY:%.+]] = splat [[IDENTITY]] : vector<8xf32>
+  // CHECK: [[INTERIOR_LOOPS:%.+]]:4 = krnl.define_loops 4
+  // CHECK: krnl.parallel [[INTERIOR_LOOPS]]#1 : !krnl.loop
+  // CHECK: krnl.iterate([[INTERIOR_LOOPS]]#0, [[INTERIOR_LOOPS]]#1, [[INTERIOR_LOOPS]]#2, [[INTERIOR_LOOPS]]#3) with ([[INTERIOR_LOOPS]]#0 -> %arg1 = 0 to 1, [[INTERIOR_LOOPS]]#1 -> %arg2 = 0 to 3, [[INTERIOR_LOOPS]]#2 -> %arg3 = 0 to 31, [[INTERIOR_LOOPS]]#3 -> %arg4 = 0 to 3) {
+  // CHECK:   [[VEC_ACC:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   krnl.store [[VEC_IDENTITY]], [[VEC_ACC]][] : memref<vector<8xf32>>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 2, {{.*}} -> %arg6 = 0 to 2) {
+  // CHECK:     [[VEC_IN:%.+]] = vector.transfer_read %arg0[%arg1, %arg2, {{.*}}, {{.*}}], {{.*}} : memref<1x3x32x32xf32>, vector<8xf32>
+  // CHECK:     [[VEC_LOAD:%.+]] = krnl.load [[VEC_ACC]][] : memref<vector<8xf32>>
+  // CHECK:     addf [[VEC_LOAD]], [[VEC_IN]] : vector<8xf32>
+  // CHECK:   }
+  // CHECK:   mulf {{.*}} : vector<8xf32>
+  // CHECK:   vector.transfer_write {{.*}}, [[RES]][%arg1, %arg2, %arg3, {{.*}}] : vector<8xf32>, memref<1x3x31x31xf32>
+  // CHECK: }
+
   // CHECK: [[OUTPUT_LOOPS:%.+]]:4 = krnl.define_loops 4
-  // CHECK: krnl.iterate([[OUTPUT_LOOPS]]#0, [[OUTPUT_LOOPS]]#1, [[OUTPUT_LOOPS]]#2, [[OUTPUT_LOOPS]]#3) with ([[OUTPUT_LOOPS]]#0 -> %arg1 = 0 to 1, [[OUTPUT_LOOPS]]#1 -> %arg2 = 0 to 3, [[OUTPUT_LOOPS]]#2 -> %arg3 = 0 to 31, [[OUTPUT_LOOPS]]#3 -> %arg4 = 0 to 31) {
+  // CHECK: krnl.iterate([[OUTPUT_LOOPS]]#0, [[OUTPUT_LOOPS]]#1, [[OUTPUT_LOOPS]]#2, [[OUTPUT_LOOPS]]#3) with ([[OUTPUT_LOOPS]]#0 -> %arg1 = 0 to 1, [[OUTPUT_LOOPS]]#1 -> %arg2 = 0 to 3, [[OUTPUT_LOOPS]]#2 -> %arg3 = 0 to 31, [[OUTPUT_LOOPS]]#3 -> %arg4 = 24 to 31) {
 
   // CHECK:   [[REDUCTION_VAL:%.+]] = memref.alloca() : memref<f32>
   // CHECK:   krnl.store [[IDENTITY]], [[REDUCTION_VAL]][] : memref<f32>
@@ -1642,8 +1740,24 @@ func private @test_averagepool_pooling_operation(%arg0 : tensor<1x3x32x32xf32>)
   // CHECK-LABEL: @test_averagepool_pooling_operation
   // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x3x31x31xf32>
 
+  // The outputs whose window lies within the input are computed on vectors.
+  // CHECK: [[VEC_IDENTITY:%.+]] = splat {{.*}} : vector<8xf32>
+  // CHECK: [[INTERIOR_LOOPS:%.+]]:4 = krnl.define_loops 4
+  // CHECK: krnl.parallel [[INTERIOR_LOOPS]]#1 : !krnl.loop
+  // CHECK: krnl.iterate([[INTERIOR_LOOPS]]#0, [[INTERIOR_LOOPS]]#1, [[INTERIOR_LOOPS]]#2, [[INTERIOR_LOOPS]]#3) with ([[INTERIOR_LOOPS]]#0 -> %arg1 = 0 to 1, [[INTERIOR_LOOPS]]#1 -> %arg2 = 0 to 3, [[INTERIOR_LOOPS]]#2 -> %arg3 = 0 to 31, [[INTERIOR_LOOPS]]#3 -> %arg4 = 0 to 3) {
+  // CHECK:   [[VEC_ACC:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   krnl.store [[VEC_IDENTITY]], [[VEC_ACC]][] : memref<vector<8xf32>>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 2, {{.*}} -> %arg6 = 0 to 2) {
+  // CHECK:     [[VEC_IN:%.+]] = vector.transfer_read %arg0[%arg1, %arg2, {{.*}}, {{.*}}], {{.*}} : memref<1x3x32x32xf32>, vector<8xf32>
+  // CHECK:     [[VEC_LOAD:%.+]] = krnl.load [[VEC_ACC]][] : memref<vector<8xf32>>
+  // CHECK:     addf [[VEC_LOAD]], [[VEC_IN]] : vector<8xf32>
+  // CHECK:   }
+  // CHECK:   mulf {{.*}} : vector<8xf32>
+  // CHECK:   vector.transfer_write {{.*}}, [[RES]][%arg1, %arg2, %arg3, {{.*}}] : vector<8xf32>, memref<1x3x31x31xf32>
+  // CHECK: }
+
   // CHECK: [[OUTPUT_LOOPS:%.+]]:4 = krnl.define_loops 4
-  // CHECK: krnl.iterate([[OUTPUT_LOOPS]]#0, [[OUTPUT_LOOPS]]#1, [[OUTPUT_LOOPS]]#2, [[OUTPUT_LOOPS]]#3) with ([[OUTPUT_LOOPS]]#0 -> %arg1 = 0 to 1, [[OUTPUT_LOOPS]]#1 -> %arg2 = 0 to 3, [[OUTPUT_LOOPS]]#2 -> %arg3 = 0 to 31, [[OUTPUT_LOOPS]]#3 -> %arg4 = 0 to 31) {
+  // CHECK: krnl.iterate([[OUTPUT_LOOPS]]#0, [[OUTPUT_LOOPS]]#1, [[OUTPUT_LOOPS]]#2, [[OUTPUT_LOOPS]]#3) with ([[OUTPUT_LOOPS]]#0 -> %arg1 = 0 to 1, [[OUTPUT_LOOPS]]#1 -> %arg2 = 0 to 3, [[OUTPUT_LOOPS]]#2 -> %arg3 = 0 to 31, [[OUTPUT_LOOPS]]#3 -> %arg4 = 24 to 31) {
 
   // CHECK:   [[REDUCTION_VAL:%.+]] = memref.alloca() : memref<f32>
   // CHECK:   krnl.store {{.*}}, [[REDUCTION_VAL]][] : memref<f32>
@@ -1674,8 +1788,25 @@ func private @test_maxpool_pooling_operation(%arg0 : tensor<1x3x32x32xf32>) -> t
   // CHECK-LABEL: @test_maxpool_pooling_operation
   // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x3x31x31xf32>
 
+  // The outputs whose window lies within the input are computed on vectors.
+  // CHECK: [[VEC_IDENTITY:%.+]] = splat {{.*}} : vector<8xf32>
+  // CHECK: [[INTERIOR_LOOPS:%.+]]:4 = krnl.define_loops 4
+  // CHECK: krnl.parallel [[INTERIOR_LOOPS]]#1 : !krnl.loop
+  // CHECK: krnl.iterate([[INTERIOR_LOOPS]]#0, [[INTERIOR_LOOPS]]#1, [[INTERIOR_LOOPS]]#2, [[INTERIOR_LOOPS]]#3) with ([[INTERIOR_LOOPS]]#0 -> %arg1 = 0 to 1, [[INTERIOR_LOOPS]]#1 -> %arg2 = 0 to 3, [[INTERIOR_LOOPS]]#2 -> %arg3 = 0 to 31, [[INTERIOR_LOOPS]]#3 -> %arg4 = 0 to 3) {
+  // CHECK:   [[VEC_ACC:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   krnl.store [[VEC_IDENTITY]], [[VEC_ACC]][] : memref<vector<8xf32>>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 2, {{.*}} -> %arg6 = 0 to 2) {
+  // CHECK:     [[VEC_IN:%.+]] = vector.transfer_read %arg0[%arg1, %arg2, {{.*}}, {{.*}}], {{.*}} : memref<1x3x32x32xf32>, vector<8xf32>
+  // CHECK:     [[VEC_LOAD:%.+]] = krnl.load [[VEC_ACC]][] : memref<vector<8xf32>>
+  // CHECK:     [[VEC_GREATER:%.+]] = cmpf ogt, [[VEC_LOAD]], [[VEC_IN]] : vector<8xf32>
+  // CHECK:     select [[VEC_GREATER]], [[VEC_LOAD]], [[VEC_IN]] : vector<8xi1>, vector<8xf32>
+  // CHECK:   }
+  // CHECK-NOT: mulf
+  // CHECK:   vector.transfer_write {{.*}}, [[RES]][%arg1, %arg2, %arg3, {{.*}}] : vector<8xf32>, memref<1x3x31x31xf32>
+  // CHECK: }
+
   // CHECK: [[OUTPUT_LOOPS:%.+]]:4 = krnl.define_loops 4
-  // CHECK: krnl.iterate([[OUTPUT_LOOPS]]#0, [[OUTPUT_LOOPS]]#1, [[OUTPUT_LOOPS]]#2, [[OUTPUT_LOOPS]]#3) with ([[OUTPUT_LOOPS]]#0 -> %arg1 = 0 to 1, [[OUTPUT_LOOPS]]#1 -> %arg2 = 0 to 3, [[OUTPUT_LOOPS]]#2 -> %arg3 = 0 to 31, [[OUTPUT_LOOPS]]#3 -> %arg4 = 0 to 31) {
+  // CHECK: krnl.iterate([[OUTPUT_LOOPS]]#0, [[OUTPUT_LOOPS]]#1, [[OUTPUT_LOOPS]]#2, [[OUTPUT_LOOPS]]#3) with ([[OUTPUT_LOOPS]]#0 -> %arg1 = 0 to 1, [[OUTPUT_LOOPS]]#1 -> %arg2 = 0 to 3, [[OUTPUT_LOOPS]]#2 -> %arg3 = 0 to 31, [[OUTPUT_LOOPS]]#3 -> %arg4 = 24 to 31) {
 
   // CHECK:   [[REDUCTION_VAL:%.+]] = memref.alloca() : memref<f32>
   // CHECK:   krnl.store {{.*}}, [[REDUCTION_VAL]][] : memref<f32>
@@ -1729,26 +1860,52 @@ func private @test_squeeze_unknown_dimensions(%arg0 : tensor<?x1x32x?x64xf32>) -
 
 // -----
 
+/// A squeezed tensor that is not returned is a view of its input.
+func private @test_squeeze_view_unknown_dimensions(%arg0 : tensor<?x1x32x?x64xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Squeeze"(%arg0) { axes = [1,-2]} : (tensor<?x1x32x?x64xf32>) -> (tensor<*xf32>)
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: @test_squeeze_view_unknown_dimensions
+  // CHECK: [[C0:%.+]] = constant 0 : index
+  // CHECK: [[DIM_0:%.+]] = memref.dim %arg0, [[C0]] : memref<?x1x32x?x64xf32>
+  // CHECK: [[VIEW:%.+]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: {{.}}[[DIM_0]], 32, 64], strides: [2048, 64, 1] : memref<?x1x32x?x64xf32> to memref<?x32x64xf32>
+  // CHECK-NOT: krnl.memcpy
+  // CHECK: krnl.load [[VIEW]]{{.}}{{.*}}{{.}} : memref<?x32x64xf32>
+}
+
+// -----
+
+/// A reshaped tensor that is not returned is a view of its input.
+func private @test_reshape_view(%arg0 : tensor<4x6xf32>) -> tensor<*xf32> {
+  %cst = "onnx.Constant"() {value = dense<[2, 12]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %0 = "onnx.Reshape"(%arg0, %cst) : (tensor<4x6xf32>, tensor<2xi64>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: @test_reshape_view
+  // CHECK: [[VIEW:%.+]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [2, 12], strides: [12, 1] : memref<4x6xf32> to memref<2x12xf32>
+  // CHECK-NOT: krnl.memcpy
+  // CHECK: krnl.load [[VIEW]]{{.}}{{.*}}{{.}} : memref<2x12xf32>
+}
+
+// -----
+
 func private @test_split_equal(%arg0 : tensor<16x32x64xf32>) -> (tensor<*xf32>, tensor<*xf32>) {
   %0, %1 = "onnx.Split"(%arg0) { axis = 0 : si64} : (tensor<16x32x64xf32>) -> (tensor<*xf32>, tensor<*xf32>)
   "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> ()
 
-  // CHECK: [[INDEX_MAP:#.+]] = affine_map<(d0) -> (d0 + 8)>
   // CHECK-LABEL: @test_split_equal
 
   // CHECK: [[RES_1:%.+]] = memref.alloc() : memref<8x32x64xf32>
   // CHECK: [[RES_0:%.+]] = memref.alloc() : memref<8x32x64xf32>
-  // CHECK: [[DEF_LOOP_0:%.+]]:3 = krnl.define_loops 3
-  // CHECK: krnl.iterate([[DEF_LOOP_0]]#0, [[DEF_LOOP_0]]#1, [[DEF_LOOP_0]]#2) with ([[DEF_LOOP_0]]#0 -> %arg1 = 0 to 8, [[DEF_LOOP_0]]#1 -> %arg2 = 0 to 32, [[DEF_LOOP_0]]#2 -> %arg3 = 0 to 64) {
-  // CHECK:   [[LOAD_0:%.+]] = krnl.load %arg0[%arg1, %arg2, %arg3] : memref<16x32x64xf32>
-  // CHECK:   krnl.store [[LOAD_0]], [[RES_0]][%arg1, %arg2, %arg3] : memref<8x32x64xf32>
-  // CHECK: }
-  // CHECK: [[DEF_LOOP_1:%.+]]:3 = krnl.define_loops 3
-  // CHECK: krnl.iterate([[DEF_LOOP_1]]#0, [[DEF_LOOP_1]]#1, [[DEF_LOOP_1]]#2) with ([[DEF_LOOP_1]]#0 -> %arg1 = 0 to 8, [[DEF_LOOP_1]]#1 -> %arg2 = 0 to 32, [[DEF_LOOP_1]]#2 -> %arg3 = 0 to 64) {
-  // CHECK:   %[[INDEX:.+]] = affine.apply [[INDEX_MAP]](%arg1)
-  // CHECK:   [[LOAD_1:%.+]] = krnl.load %arg0[%[[INDEX]], %arg2, %arg3] : memref<16x32x64xf32>
-  // CHECK:   krnl.store [[LOAD_1]], [[RES_1]][%arg1, %arg2, %arg3] : memref<8x32x64xf32>
-  // CHECK: }
+  // CHECK: [[SLICE_0:%.+]] = memref.subview %arg0[0, 0, 0] [8, 32, 64] [1, 1, 1] : memref<16x32x64xf32> to memref<8x32x64xf32, #{{.*}}>
+  // CHECK: [[SIZE_0:%.+]] = constant 65536 : i64
+  // CHECK: "krnl.memcpy"([[RES_0]], [[SLICE_0]], [[SIZE_0]]) : (memref<8x32x64xf32>, memref<8x32x64xf32, #{{.*}}>, i64) -> ()
+  // CHECK: [[SLICE_1:%.+]] = memref.subview %arg0[8, 0, 0] [8, 32, 64] [1, 1, 1] : memref<16x32x64xf32> to memref<8x32x64xf32, #{{.*}}>
+  // CHECK: [[SIZE_1:%.+]] = constant 65536 : i64
+  // CHECK: "krnl.memcpy"([[RES_1]], [[SLICE_1]], [[SIZE_1]]) : (memref<8x32x64xf32>, memref<8x32x64xf32, #{{.*}}>, i64) -> ()
+  // CHECK-NOT: krnl.iterate
   // CHECK: return [[RES_0]], [[RES_1]] : memref<8x32x64xf32>, memref<8x32x64xf32>
 }
 
@@ -1758,23 +1915,69 @@ func private @test_split_variable(%arg0 : tensor<16x32x64xf32>) -> (tensor<*xf32
   %0, %1 = "onnx.Split"(%arg0) { axis = 1 : si64, split = [2, 30]} : (tensor<16x32x64xf32>) -> (tensor<*xf32>, tensor<*xf32>)
   "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> ()
 
-  // CHECK: [[INDEX_MAP:#.+]] = affine_map<(d0) -> (d0 + 2)>
   // CHECK-LABEL: @test_split_variable
 
   // CHECK: [[RES_1:%.+]] = memref.alloc() : memref<16x30x64xf32>
   // CHECK: [[RES_0:%.+]] = memref.alloc() : memref<16x2x64xf32>
+  // CHECK: [[DEF_LOOP_0:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.iterate([[DEF_LOOP_0]]) with ([[DEF_LOOP_0]] -> %arg1 = 0 to 16) {
+  // CHECK:   [[SRC_0:%.+]] = memref.subview %arg0[%arg1, 0, 0] [1, 2, 64] [1, 1, 1]
+  // CHECK:   [[DST_0:%.+]] = memref.subview [[RES_0]][%arg1, 0, 0] [1, 2, 64] [1, 1, 1]
+  // CHECK:   [[SIZE_0:%.+]] = constant 512 : i64
+  // CHECK:   "krnl.memcpy"([[DST_0]], [[SRC_0]], [[SIZE_0]])
+  // CHECK: }
+  // CHECK: [[DEF_LOOP_1:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.iterate([[DEF_LOOP_1]]) with ([[DEF_LOOP_1]] -> %arg1 = 0 to 16) {
+  // CHECK:   [[SRC_1:%.+]] = memref.subview %arg0[%arg1, 2, 0] [1, 30, 64] [1, 1, 1]
+  // CHECK:   [[DST_1:%.+]] = memref.subview [[RES_1]][%arg1, 0, 0] [1, 30, 64] [1, 1, 1]
+  // CHECK:   [[SIZE_1:%.+]] = constant 7680 : i64
+  // CHECK:   "krnl.memcpy"([[DST_1]], [[SRC_1]], [[SIZE_1]])
+  // CHECK: }
+  // CHECK-NOT: krnl.load
+  // CHECK: return [[RES_0]], [[RES_1]] : memref<16x2x64xf32>, memref<16x30x64xf32>
+}
+
+// -----
+
+func private @test_split_small_chunks(%arg0 : tensor<16x32x4xf32>) -> (tensor<*xf32>, tensor<*xf32>) {
+  %0, %1 = "onnx.Split"(%arg0) { axis = 1 : si64, split = [2, 30]} : (tensor<16x32x4xf32>) -> (tensor<*xf32>, tensor<*xf32>)
+  "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> ()
+
+  // CHECK: [[INDEX_MAP:#.+]] = affine_map<(d0) -> (d0 + 2)>
+  // CHECK-LABEL: @test_split_small_chunks
+
+  // CHECK: [[RES_1:%.+]] = memref.alloc() : memref<16x30x4xf32>
+  // CHECK: [[RES_0:%.+]] = memref.alloc() : memref<16x2x4xf32>
   // CHECK: [[DEF_LOOP_0:%.+]]:3 = krnl.define_loops 3
-  // CHECK: krnl.iterate([[DEF_LOOP_0]]#0, [[DEF_LOOP_0]]#1, [[DEF_LOOP_0]]#2) with ([[DEF_LOOP_0]]#0 -> %arg1 = 0 to 16, [[DEF_LOOP_0]]#1 -> %arg2 = 0 to 2, [[DEF_LOOP_0]]#2 -> %arg3 = 0 to 64) {
-  // CHECK:   [[LOAD_0:%.+]] = krnl.load %arg0[%arg1, %arg2, %arg3] : memref<16x32x64xf32>
-  // CHECK:   krnl.store [[LOAD_0]], [[RES_0]][%arg1, %arg2, %arg3] : memref<16x2x64xf32>
+  // CHECK: krnl.iterate([[DEF_LOOP_0]]#0, [[DEF_LOOP_0]]#1, [[DEF_LOOP_0]]#2) with ([[DEF_LOOP_0]]#0 -> %arg1 = 0 to 16, [[DEF_LOOP_0]]#1 -> %arg2 = 0 to 2, [[DEF_LOOP_0]]#2 -> %arg3 = 0 to 4) {
+  // CHECK:   [[LOAD_0:%.+]] = krnl.load %arg0[%arg1, %arg2, %arg3] : memref<16x32x4xf32>
+  // CHECK:   krnl.store [[LOAD_0]], [[RES_0]][%arg1, %arg2, %arg3] : memref<16x2x4xf32>
   // CHECK: }
   // CHECK: [[DEF_LOOP_1:%.+]]:3 = krnl.define_loops 3
-  // CHECK: krnl.iterate([[DEF_LOOP_1]]#0, [[DEF_LOOP_1]]#1, [[DEF_LOOP_1]]#2) with ([[DEF_LOOP_1]]#0 -> %arg1 = 0 to 16, [[DEF_LOOP_1]]#1 -> %arg2 = 0 to 30, [[DEF_LOOP_1]]#2 -> %arg3 = 0 to 64) {
+  // CHECK: krnl.iterate([[DEF_LOOP_1]]#0, [[DEF_LOOP_1]]#1, [[DEF_LOOP_1]]#2) with ([[DEF_LOOP_1]]#0 -> %arg1 = 0 to 16, [[DEF_LOOP_1]]#1 -> %arg2 = 0 to 30, [[DEF_LOOP_1]]#2 -> %arg3 = 0 to 4) {
   // CHECK:   %[[INDEX:.+]] = affine.apply [[INDEX_MAP]](%arg2)
-  // CHECK:   [[LOAD_1:%.+]] = krnl.load %arg0[%arg1, %[[INDEX]], %arg3] : memref<16x32x64xf32>
-  // CHECK:   krnl.store [[LOAD_1]], [[RES_1]][%arg1, %arg2, %arg3] : memref<16x30x64xf32>
+  // CHECK:   [[LOAD_1:%.+]] = krnl.load %arg0[%arg1, %[[INDEX]], %arg3] : memref<16x32x4xf32>
+  // CHECK:   krnl.store [[LOAD_1]], [[RES_1]][%arg1, %arg2, %arg3] : memref<16x30x4xf32>
   // CHECK: }
-  // CHECK: return [[RES_0]], [[RES_1]] : memref<16x2x64xf32>, memref<16x30x64xf32>
+  // CHECK: return [[RES_0]], [[RES_1]] : memref<16x2x4xf32>, memref<16x30x4xf32>
+}
+
+// -----
+
+func private @test_split_view(%arg0 : tensor<1x6x64xf32>) -> tensor<*xf32> {
+  %0, %1, %2 = "onnx.Split"(%arg0) { axis = 1 : si64} : (tensor<1x6x64xf32>) -> (tensor<*xf32>, tensor<*xf32>, tensor<*xf32>)
+  %3 = "onnx.Add"(%0, %1) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+  %4 = "onnx.Add"(%3, %2) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%4) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: @test_split_view
+  // CHECK-DAG: [[VIEW_0:%.+]] = memref.subview %arg0[0, 0, 0] [1, 2, 64] [1, 1, 1] : memref<1x6x64xf32> to memref<1x2x64xf32, #{{.*}}>
+  // CHECK-DAG: [[VIEW_1:%.+]] = memref.subview %arg0[0, 2, 0] [1, 2, 64] [1, 1, 1] : memref<1x6x64xf32> to memref<1x2x64xf32, #{{.*}}>
+  // CHECK-DAG: [[VIEW_2:%.+]] = memref.subview %arg0[0, 4, 0] [1, 2, 64] [1, 1, 1] : memref<1x6x64xf32> to memref<1x2x64xf32, #{{.*}}>
+  // CHECK-NOT: krnl.memcpy
+  // CHECK: krnl.load [[VIEW_0]]
+  // CHECK: krnl.load [[VIEW_1]]
+  // CHECK: krnl.load [[VIEW_2]]
 }
 
 // -----
@@ -2101,6 +2304,85 @@ func private @test_less_broadcast(%arg0: tensor<3x4x5xf32>, %arg1: tensor<5xf32>
 
 // -----
 
+func private @test_equal(%arg0: tensor<3x4x5xi64>, %arg1: tensor<3x4x5xi64>) -> tensor<*xi1> {
+  %0 = "onnx.Equal"(%arg0, %arg1) : (tensor<3x4x5xi64>, tensor<3x4x5xi64>) -> tensor<*xi1>
+  return %0 : tensor<*xi1>
+
+  // CHECK-LABEL: test_equal
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<3x4x5xi1>
+  // CHECK: [[DEF_LOOPS:%.+]]:3 = krnl.define_loops 3
+  // CHECK: krnl.iterate([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1, [[DEF_LOOPS]]#2) with ([[DEF_LOOPS]]#0 -> %arg2 = 0 to 3, [[DEF_LOOPS]]#1 -> %arg3 = 0 to 4, [[DEF_LOOPS]]#2 -> %arg4 = 0 to 5) {
+  // CHECK:   [[LHS:%.+]] = krnl.load %arg0[%arg2, %arg3, %arg4] : memref<3x4x5xi64>
+  // CHECK:   [[RHS:%.+]] = krnl.load %arg1[%arg2, %arg3, %arg4] : memref<3x4x5xi64>
+  // CHECK:   [[EQUAL:%.+]] = cmpi eq, [[LHS]], [[RHS]] : i64
+  // CHECK:   krnl.store [[EQUAL]], [[RES]][%arg2, %arg3, %arg4] : memref<3x4x5xi1>
+  // CHECK: }
+  // CHECK: return [[RES]] : memref<3x4x5xi1>
+}
+
+// -----
+
+/// The values are selected as vectors, the scalar being splat once and the
+/// lanes of the condition loaded one by one.
+func private @test_where(%arg0: tensor<2x8xi1>, %arg1: tensor<2x8xf32>, %arg2: tensor<f32>) -> tensor<*xf32> {
+  %0 = "onnx.Where"(%arg0, %arg1, %arg2) : (tensor<2x8xi1>, tensor<2x8xf32>, tensor<f32>) -> tensor<*xf32>
+  return %0 : tensor<*xf32>
+
+  // CHECK-LABEL: test_where
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<2x8xf32>
+  // CHECK-DAG: [[VEC_X:%.+]] = krnl.vector_type_cast %arg1 : memref<2x8xf32> to memref<2x1xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<2x8xf32> to memref<2x1xvector<8xf32>>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> [[I:%.+]] = 0 to 2) {
+  // CHECK:   [[Y:%.+]] = krnl.load %arg2[] : memref<f32>
+  // CHECK:   [[VEC_Y:%.+]] = splat [[Y]] : vector<8xf32>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> [[J:%.+]] = 0 to 1) {
+  // CHECK:     krnl.load %arg0{{.}}[[I]], {{.*}}{{.}} : memref<2x8xi1>
+  // CHECK:     vector.insertelement
+  // CHECK:     [[COND:%.+]] = vector.insertelement
+  // CHECK:     [[X:%.+]] = krnl.load [[VEC_X]]{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK:     [[SELECT:%.+]] = select [[COND]], [[X]], [[VEC_Y]] : vector<8xi1>, vector<8xf32>
+  // CHECK:     krnl.store [[SELECT]], [[VEC_RES]]{{.}}[[I]], [[J]]{{.}} : memref<2x1xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<2x8xf32>
+}
+
+// -----
+
+/// The expanded tensor is a view of its input, with a zero stride along the
+/// broadcast dimension.
+func private @test_expand_view(%arg0: tensor<1x4xf32>, %arg1: tensor<3x4xf32>) -> tensor<*xf32> {
+  %shape = "onnx.Constant"() {value = dense<[3, 4]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %0 = "onnx.Expand"(%arg0, %shape) : (tensor<1x4xf32>, tensor<2xi64>) -> tensor<*xf32>
+  %1 = "onnx.Mul"(%0, %arg1) : (tensor<*xf32>, tensor<3x4xf32>) -> tensor<*xf32>
+  return %1 : tensor<*xf32>
+
+  // CHECK-DAG: #[[MAP:.+]] = affine_map<(d0, d1) -> (d1)>
+  // CHECK-LABEL: test_expand_view
+  // CHECK: [[VIEW:%.+]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [3, 4], strides: [0, 1] : memref<1x4xf32> to memref<3x4xf32, #[[MAP]]>
+  // CHECK-NOT: krnl.store {{.*}}, [[VIEW]]
+  // CHECK: krnl.load [[VIEW]]
+}
+
+// -----
+
+/// An expanded result is copied, the rows of the input as vectors.
+func private @test_expand_copy(%arg0: tensor<4x1xf32>) -> tensor<*xf32> {
+  %shape = "onnx.Constant"() {value = dense<[2, 4, 8]> : tensor<3xi64>} : () -> tensor<3xi64>
+  %0 = "onnx.Expand"(%arg0, %shape) : (tensor<4x1xf32>, tensor<3xi64>) -> tensor<*xf32>
+  return %0 : tensor<*xf32>
+
+  // CHECK-LABEL: test_expand_copy
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<2x4x8xf32>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<2x4x8xf32> to memref<2x4x1xvector<8xf32>>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> [[I:%.+]] = 0 to 2, {{.*}} -> [[J:%.+]] = 0 to 4) {
+  // CHECK:   [[X:%.+]] = krnl.load %arg0{{.}}[[J]], {{.*}}{{.}} : memref<4x1xf32>
+  // CHECK:   [[VEC_X:%.+]] = splat [[X]] : vector<8xf32>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> [[K:%.+]] = 0 to 1) {
+  // CHECK:     krnl.store [[VEC_X]], [[VEC_RES]]{{.}}[[I]], [[J]], [[K]]{{.}} : memref<2x4x1xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<2x4x8xf32>
+}
+
+// -----
+
 func private @test_floor(%arg0 : tensor<?x10xf32>) -> tensor<*xf32> {
   %0 = "onnx.Floor"(%arg0) : (tensor<?x10xf32>) -> tensor<*xf32>
   "std.return"(%0) : (tensor<*xf32>) -> ()
@@ -2308,13 +2590,11 @@ func private @test_loop_simple_main_graph(%arg0: tensor<i64>, %arg1: tensor<i1>,
   // CHECK:       module  {
   // CHECK-LABEL:       func private @test_loop_simple_main_graph
   // CHECK-SAME:     ([[TRIP_COUNT:%.+]]: memref<i64>, [[COND:%.+]]: memref<i1>, [[Y_INIT:%.+]]: memref<1xi64>) -> memref<1xi64> {
+  // CHECK:           [[CURR_LOOP_IV:%.+]] = memref.alloc() : memref<i64>
   // CHECK:           [[COND_GLOBAL:%.+]] = memref.alloc() : memref<i1>
   // CHECK:           [[Y:%.+]] = memref.alloc() : memref<1xi64>
-  // CHECK:           [[Y_COPY_LOOP:%.+]] = krnl.define_loops 1
-  // CHECK:           krnl.iterate([[Y_COPY_LOOP]]) with ([[Y_COPY_LOOP]] -> [[YCOPY_IV:%.+]] = 0 to 1) {
-  // CHECK:             [[Y_VAL:%.+]] = krnl.load [[Y_INIT]]{{.}}[[YCOPY_IV]]{{.}} : memref<1xi64>
-  // CHECK:             krnl.store [[Y_VAL]], [[Y]]{{.}}[[YCOPY_IV]]{{.}} : memref<1xi64>
-  // CHECK:           }
+  // CHECK:           [[Y_SIZE:%.+]] = constant 8 : i64
+  // CHECK:           "krnl.memcpy"([[Y]], [[Y_INIT]], [[Y_SIZE]]) : (memref<1xi64>, memref<1xi64>, i64) -> ()
   // CHECK:           [[COND_VAL:%.+]] = krnl.load [[COND]][] : memref<i1>
   // CHECK:           krnl.store [[COND_VAL]], [[COND_GLOBAL]][] : memref<i1>
   // CHECK:           [[LOOP:%.+]] = krnl.define_loops 1
@@ -2325,7 +2605,6 @@ func private @test_loop_simple_main_graph(%arg0: tensor<i64>, %arg1: tensor<i1>,
   // CHECK:             scf.if [[COND_VAL]] {
   // CHECK:               [[Y_CURR:%.+]] = memref.alloc() : memref<1xi64>
   // CHECK:               [[LOOP_IV_VAL:%.+]] = index_cast [[LOOP_IV]] : index to i64
-  // CHECK:               [[CURR_LOOP_IV:%.+]] = memref.alloc() : memref<i64>
   // CHECK:               krnl.store [[LOOP_IV_VAL]], [[CURR_LOOP_IV]][] : memref<i64>
   // CHECK:               [[Y_COMPUTE_LOOP:%.+]] = krnl.define_loops 1
   // CHECK:               krnl.iterate([[Y_COMPUTE_LOOP]]) with ([[Y_COMPUTE_LOOP]] -> [[Y_COMPUTE_IV:%.+]] = 0 to 1) {
@@ -2338,17 +2617,294 @@ func private @test_loop_simple_main_graph(%arg0: tensor<i64>, %arg1: tensor<i1>,
   // CHECK:               [[Y_CURR_CAST:%.+]] = krnl.dummy_cast [[Y_CURR]] : (memref<1xi64>) -> memref<1xi64>
   // CHECK:               [[COND_CAST_VAL:%.+]] = krnl.load [[COND_CAST]][] : memref<i1>
   // CHECK:               krnl.store [[COND_CAST_VAL]], [[COND_GLOBAL]][] : memref<i1>
-  // CHECK:               [[Y_COPY_LOOP:%.+]] = krnl.define_loops 1
-  // CHECK:               krnl.iterate([[Y_COPY_LOOP]]) with ([[Y_COPY_LOOP]] -> [[Y_COPY_IV:%.+]] = 0 to 1) {
-  // CHECK:                 [[Y_SCAN_VAL:%.+]] = krnl.load [[Y_CURR_CAST]]{{.}}[[Y_COPY_IV]]{{.}} : memref<1xi64>
-  // CHECK:                 krnl.store [[Y_SCAN_VAL]], [[Y]]{{.}}[[Y_COPY_IV]]{{.}} : memref<1xi64>
-  // CHECK:               }
+  // CHECK:               [[Y_CURR_SIZE:%.+]] = constant 8 : i64
+  // CHECK:               "krnl.memcpy"([[Y]], [[Y_CURR_CAST]], [[Y_CURR_SIZE]]) : (memref<1xi64>, memref<1xi64>, i64) -> ()
   // CHECK:               memref.dealloc [[Y_CURR]] : memref<1xi64>
   // CHECK:             }
   // CHECK:           }
   // CHECK:           memref.dealloc [[COND_GLOBAL]] : memref<i1>
+  // CHECK:           memref.dealloc [[CURR_LOOP_IV]] : memref<i64>
   // CHECK:           return [[Y]] : memref<1xi64>
   // CHECK:         }
   // CHECK:       }
 }
 
+// -----
+// COM: Check that the loop carried values passed through unchanged by the body, the condition included, are not copied.
+func private @test_loop_pass_through_main_graph(%arg0: tensor<i64>, %arg1: tensor<i1>, %arg2: tensor<1xi64>, %arg3: tensor<4xf32>) -> (tensor<1xi64>, tensor<4xf32>) {
+  %0:2 = "onnx.Loop"(%arg0, %arg1, %arg2, %arg3) ({
+    ^bb0(%body_arg0: tensor<i64>, %body_arg1: tensor<i1>, %body_arg2: tensor<1xi64>, %body_arg3: tensor<4xf32>):
+    %0 = "onnx.Add"(%body_arg2, %body_arg0) : (tensor<1xi64>, tensor<i64>) -> tensor<1xi64>
+    onnx.Return %body_arg1, %0, %body_arg3 : tensor<i1>, tensor<1xi64>, tensor<4xf32>
+  }) : (tensor<i64>, tensor<i1>, tensor<1xi64>, tensor<4xf32>) -> (tensor<1xi64>, tensor<4xf32>)
+  return %0#0, %0#1 : tensor<1xi64>, tensor<4xf32>
+  // CHECK-LABEL:       func private @test_loop_pass_through_main_graph
+  // CHECK-SAME:     ([[TRIP_COUNT:%.+]]: memref<i64>, [[COND:%.+]]: memref<i1>, [[Y_INIT:%.+]]: memref<1xi64>, [[Z_INIT:%.+]]: memref<4xf32>) -> (memref<1xi64>, memref<4xf32>) {
+  // CHECK-DAG:       [[Y:%.+]] = memref.alloc() : memref<1xi64>
+  // CHECK-DAG:       [[Z:%.+]] = memref.alloc() : memref<4xf32>
+  // CHECK:           "krnl.memcpy"([[Y]], [[Y_INIT]], {{.*}}) : (memref<1xi64>, memref<1xi64>, i64) -> ()
+  // CHECK:           "krnl.memcpy"([[Z]], [[Z_INIT]], {{.*}}) : (memref<4xf32>, memref<4xf32>, i64) -> ()
+  // CHECK:           scf.if
+  // CHECK-NOT:         krnl.memcpy
+  // CHECK:             "krnl.memcpy"([[Y]], {{.*}}) : (memref<1xi64>, memref<1xi64>, i64) -> ()
+  // CHECK-NOT:         krnl.memcpy
+  // CHECK-NOT:         krnl.store {{.*}} : memref<i1>
+  // CHECK:             memref.dealloc {{.*}} : memref<1xi64>
+  // CHECK:           return [[Y]], [[Z]] : memref<1xi64>, memref<4xf32>
+}
+
+
+// -----
+
+/// The scan body reads the slices of the scan input through views and the
+/// slices of the scan output are written by a memcpy.
+func private @test_scan_simple_main_graph(%arg0: tensor<2xf32>, %arg1: tensor<3x2xf32>) -> (tensor<2xf32>, tensor<3x2xf32>) {
+  %0:2 = "onnx.Scan"(%arg0, %arg1) ( {
+  ^bb0(%arg2: tensor<2xf32>, %arg3: tensor<2xf32>):  // no predecessors
+    %1 = "onnx.Add"(%arg2, %arg3) : (tensor<2xf32>, tensor<2xf32>) -> tensor<2xf32>
+    onnx.Return %1, %1 : tensor<2xf32>, tensor<2xf32>
+  }) {num_scan_inputs = 1 : si64} : (tensor<2xf32>, tensor<3x2xf32>) -> (tensor<2xf32>, tensor<3x2xf32>)
+  return %0#0, %0#1 : tensor<2xf32>, tensor<3x2xf32>
+
+  // CHECK-LABEL:       func private @test_scan_simple_main_graph
+  // CHECK-SAME:     ([[SUM_INIT:%.+]]: memref<2xf32>, [[TO_SUM:%.+]]: memref<3x2xf32>) -> (memref<2xf32>, memref<3x2xf32>) {
+  // CHECK-DAG:       [[SUM:%.+]] = memref.alloc() : memref<2xf32>
+  // CHECK-DAG:       [[SCAN_OUT:%.+]] = memref.alloc() : memref<3x2xf32>
+  // CHECK:           [[LOOP:%.+]] = krnl.define_loops 1
+  // CHECK:           krnl.iterate([[LOOP]]) with ([[LOOP]] -> [[IV:%.+]] = 0 to 3) {
+  // CHECK-NOT:         memref.alloc() : memref<2xf32>{{$}}
+  // CHECK:             [[SLICE:%.+]] = memref.subview [[TO_SUM]]{{.}}[[IV]], 0] [1, 2] [1, 1] : memref<3x2xf32> to memref<2xf32, #{{.*}}>
+  // CHECK:             [[ADD:%.+]] = memref.alloc() : memref<2xf32>
+  // CHECK:             krnl.load [[SLICE]]{{.}}{{.*}}{{.}} : memref<2xf32, #{{.*}}>
+  // CHECK:             [[OUT_SLICE:%.+]] = memref.subview [[SCAN_OUT]]{{.}}[[IV]], 0] [1, 2] [1, 1] : memref<3x2xf32> to memref<2xf32, #{{.*}}>
+  // CHECK:             [[SIZE:%.+]] = constant 8 : i64
+  // CHECK:             "krnl.memcpy"([[OUT_SLICE]], {{.*}}, [[SIZE]]) : (memref<2xf32, #{{.*}}>, memref<2xf32>, i64) -> ()
+  // CHECK-NOT:         memref.dealloc
+  // CHECK:           }
+  // CHECK:           return [[SUM]], [[SCAN_OUT]] : memref<2xf32>, memref<3x2xf32>
+}
+
+// -----
+
+/// The producer of the first input of the concat writes in place in the
+/// output, the second input is copied by a memcpy.
+func private @test_concat_in_place(%arg0 : tensor<1x4x8x8xf32>, %arg1 : tensor<1x2x8x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<1x4x8x8xf32>) -> tensor<*xf32>
+  %1 = "onnx.Concat"(%0, %arg1) {axis = 1 : si64} : (tensor<*xf32>, tensor<1x2x8x8xf32>) -> tensor<*xf32>
+  %2 = "onnx.Relu"(%1) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL:  func private @test_concat_in_place
+  // CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<1x4x8x8xf32>, [[PARAM_1_:%.+]]: memref<1x2x8x8xf32>) -> memref<1x6x8x8xf32> {
+  // CHECK-DAG:       [[RES_:%.+]] = memref.alloc() : memref<1x6x8x8xf32>
+  // CHECK-DAG:       [[BUFFER_:%.+]] = memref.alloc() : memref<1536xi8>
+  // CHECK-DAG:       [[CONCAT_:%.+]] = memref.view [[BUFFER_]]{{.}}{{.*}}{{.}}[] : memref<1536xi8> to memref<1x6x8x8xf32>
+  // CHECK-DAG:       [[RELU_:%.+]] = memref.view [[BUFFER_]]{{.}}{{.*}}{{.}}[] : memref<1536xi8> to memref<1x4x8x8xf32>
+  // CHECK-NOT:       memref.alloc
+  // CHECK:           krnl.iterate
+  // CHECK:           [[RELU_]]
+  // CHECK:           [[SIZE_:%.+]] = constant 512 : i64
+  // CHECK:           [[SHIFT_:%.+]] = constant 1024 : index
+  // CHECK:           [[SLICE_:%.+]] = memref.view [[BUFFER_]]{{.}}[[SHIFT_]]{{.}}[] : memref<1536xi8> to memref<1x2x8x8xf32>
+  // CHECK:           "krnl.memcpy"([[SLICE_]], [[PARAM_1_]], [[SIZE_]]) : (memref<1x2x8x8xf32>, memref<1x2x8x8xf32>, i64) -> ()
+  // CHECK:           krnl.iterate
+  // CHECK:           [[CONCAT_]]
+  // CHECK-NOT:       memref.dealloc [[RES_]]
+  // CHECK:           memref.dealloc [[BUFFER_]] : memref<1536xi8>
+  // CHECK:           return [[RES_]] : memref<1x6x8x8xf32>
+}
+
+// -----
+
+/// The large outputs of Concat are written by non-temporal stores.
+func private @test_concat_nontemporal(%arg0 : tensor<1024x512xf32>, %arg1 : tensor<1024x512xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Concat"(%arg0, %arg1) {axis = 1 : si64} : (tensor<1024x512xf32>, tensor<1024x512xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_concat_nontemporal
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<1024x1024xf32>
+  // CHECK: krnl.store {{.*}}, [[RES]]{{.}}{{.*}}{{.}} {nontemporal} : memref<1024x1024xf32>
+  // CHECK: krnl.store {{.*}}, [[RES]]{{.}}{{.*}}{{.}} {nontemporal} : memref<1024x1024xf32>
+  // CHECK: return [[RES]] : memref<1024x1024xf32>
+}
+
+// -----
+
+/// The concat of a past input along its dynamic axis, whose output is
+/// returned, appends in place in the capacity of the buffer of the past, or
+/// copies both inputs into a new buffer.
+func private @test_concat_append_in_place(%arg0 : tensor<1x4x?x8xf32>, %arg1 : tensor<1x4x1x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Concat"(%arg0, %arg1) {axis = 2 : si64} : (tensor<1x4x?x8xf32>, tensor<1x4x1x8xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL:  func private @test_concat_append_in_place
+  // CHECK-SAME:   ([[PAST_:%.+]]: memref<1x4x?x8xf32>, [[NEW_:%.+]]: memref<1x4x1x8xf32>) -> memref<1x4x?x8xf32> {
+  // CHECK:           [[AXIS_STRIDE_:%.+]] = krnl.stride [[PAST_]][2] : memref<1x4x?x8xf32>
+  // CHECK:           [[SIZE_:%.+]] = muli {{.*}}, [[AXIS_STRIDE_]] : index
+  // CHECK:           [[CAPACITY_:%.+]] = krnl.stride [[PAST_]][1] : memref<1x4x?x8xf32>
+  // CHECK:           [[FITS_:%.+]] = cmpi sle, [[SIZE_]], [[CAPACITY_]] : index
+  // CHECK:           [[RES_:%.+]] = scf.if [[FITS_]] -> (memref<1x4x?x8xf32>) {
+  // CHECK:             [[VIEW_:%.+]] = memref.reinterpret_cast [[PAST_]] to offset: [0], sizes: [1, 4, {{.*}}, 8], strides: [{{.*}}, {{.*}}, 8, 1] : memref<1x4x?x8xf32> to memref<1x4x?x8xf32>
+  // CHECK-NOT:         krnl.load [[PAST_]]
+  // CHECK:             krnl.load [[NEW_]]
+  // CHECK:             krnl.store {{.*}}, [[VIEW_]]
+  // CHECK:             scf.yield [[VIEW_]] : memref<1x4x?x8xf32>
+  // CHECK:           } else {
+  // CHECK:             [[ALLOC_:%.+]] = memref.alloc({{.*}}) : memref<1x4x?x8xf32>
+  // CHECK:             krnl.load [[PAST_]]
+  // CHECK:             krnl.store {{.*}}, [[ALLOC_]]
+  // CHECK:             krnl.load [[NEW_]]
+  // CHECK:             krnl.store {{.*}}, [[ALLOC_]]
+  // CHECK:             scf.yield [[ALLOC_]] : memref<1x4x?x8xf32>
+  // CHECK:           }
+  // CHECK-NOT:       memref.dealloc
+  // CHECK:           return [[RES_]] : memref<1x4x?x8xf32>
+}
+
+// -----
+
+/// The 10 largest elements of each row are selected in a sorted buffer, the
+/// rows being processed in parallel.
+func private @test_topk(%arg0 : tensor<4x100000xf32>) -> (tensor<*xf32>, tensor<*xi64>) {
+  %k = "onnx.Constant"() {value = dense<10> : tensor<1xi64>} : () -> tensor<1xi64>
+  %0, %1 = "onnx.TopK"(%arg0, %k) : (tensor<4x100000xf32>, tensor<1xi64>) -> (tensor<*xf32>, tensor<*xi64>)
+  "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: func private @test_topk
+  // CHECK-DAG:   [[VALUES:%.+]] = memref.alloc() : memref<4x10xf32>
+  // CHECK-DAG:   [[INDICES:%.+]] = memref.alloc() : memref<4x10xi64>
+  // CHECK:       [[ROW_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK:       krnl.parallel [[ROW_LOOP]]
+  // CHECK:       krnl.iterate([[ROW_LOOP]]) with ([[ROW_LOOP]] -> [[ROW:%.+]] = 0 to 4) {
+  // CHECK-DAG:     [[BUF_VALUES:%.+]] = memref.alloca() : memref<10xf32>
+  // CHECK-DAG:     [[BUF_INDICES:%.+]] = memref.alloca() : memref<10xindex>
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} -> [[J:%.+]] = 0 to 100000) {
+  // CHECK:           [[X:%.+]] = krnl.load %arg0{{.}}[[ROW]], [[J]]{{.}} : memref<4x100000xf32>
+  // CHECK:           cmpf ogt, [[X]]
+  // CHECK:           scf.if
+  // CHECK:             krnl.iterate({{.*}}) with ({{.*}} = 0 to 10) {
+  // CHECK:               krnl.store {{.*}}, [[BUF_VALUES]]
+  // CHECK:               krnl.store {{.*}}, [[BUF_INDICES]]
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} -> [[I:%.+]] = 0 to 10) {
+  // CHECK:           krnl.store {{.*}}, [[VALUES]]{{.}}[[ROW]], [[I]]{{.}} : memref<4x10xf32>
+  // CHECK:           index_cast
+  // CHECK:           krnl.store {{.*}}, [[INDICES]]{{.}}[[ROW]], [[I]]{{.}} : memref<4x10xi64>
+  // CHECK:       return [[VALUES]], [[INDICES]] : memref<4x10xf32>, memref<4x10xi64>
+}
+
+// -----
+
+/// The linear Resize interpolates along H, the rows of W as vectors, then
+/// along W, with index and weight tables computed at compile time.
+func private @test_resize_linear(%arg0 : tensor<1x1x4x8xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %scales = "onnx.Constant"() {value = dense<[1.0, 1.0, 2.0, 2.0]> : tensor<4xf32>} : () -> tensor<4xf32>
+  %0 = "onnx.Resize"(%arg0, %cst, %scales, %cst) {mode = "linear"} : (tensor<1x1x4x8xf32>, none, tensor<4xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: func private @test_resize_linear
+  // CHECK-DAG:   [[LOW_H:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "resize_indices_2_{{[0-9]+}}", shape = [8], value = dense<[0, 0, 0, 1, 1, 2, 2, 3]> : tensor<8xi32>} : () -> memref<8xi32>
+  // CHECK-DAG:   [[HIGH_H:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "resize_high_indices_2_{{[0-9]+}}", shape = [8], value = dense<[1, 1, 1, 2, 2, 3, 3, 3]> : tensor<8xi32>} : () -> memref<8xi32>
+  // CHECK-DAG:   [[WEIGHTS_H:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "resize_weights_2_{{[0-9]+}}", shape = [8], value = dense<[0.000000e+00, 2.500000e-01, 7.500000e-01, 2.500000e-01, 7.500000e-01, 2.500000e-01, 7.500000e-01, 0.000000e+00]> : tensor<8xf32>} : () -> memref<8xf32>
+  // CHECK-DAG:   [[RES:%.+]] = memref.alloc() : memref<1x1x8x16xf32>
+  // CHECK-DAG:   [[ROWS:%.+]] = memref.alloc() {{.*}}: memref<1x1x8x8xf32>
+  // CHECK-DAG:   [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<1x1x4x8xf32> to memref<1x1x4x1xvector<8xf32>>
+  // CHECK-DAG:   [[VEC_ROWS:%.+]] = krnl.vector_type_cast [[ROWS]] : memref<1x1x8x8xf32> to memref<1x1x8x1xvector<8xf32>>
+  // CHECK:       krnl.iterate
+  // CHECK:         [[WEIGHT:%.+]] = krnl.load [[WEIGHTS_H]]
+  // CHECK:         splat [[WEIGHT]] : vector<8xf32>
+  // CHECK:         krnl.load [[VEC_X]]
+  // CHECK:         krnl.load [[VEC_X]]
+  // CHECK:         subf {{.*}} : vector<8xf32>
+  // CHECK:         krnl.store {{.*}}, [[VEC_ROWS]]
+  // CHECK:       krnl.iterate
+  // CHECK:         krnl.load [[ROWS]]
+  // CHECK:         krnl.load [[ROWS]]
+  // CHECK:         krnl.store {{.*}}, [[RES]]
+  // CHECK:       return [[RES]] : memref<1x1x8x16xf32>
+}
+
+// -----
+
+/// The nearest Upsample gathers the source elements through index tables.
+func private @test_upsample_nearest(%arg0 : tensor<1x1x2x2xf32>) -> tensor<*xf32> {
+  %scales = "onnx.Constant"() {value = dense<[1.0, 1.0, 2.0, 3.0]> : tensor<4xf32>} : () -> tensor<4xf32>
+  %0 = "onnx.Upsample"(%arg0, %scales) {mode = "nearest"} : (tensor<1x1x2x2xf32>, tensor<4xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: func private @test_upsample_nearest
+  // CHECK-DAG:   [[INDICES_H:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "resize_indices_2_{{[0-9]+}}", shape = [4], value = dense<[0, 0, 1, 1]> : tensor<4xi32>} : () -> memref<4xi32>
+  // CHECK-DAG:   [[INDICES_W:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "resize_indices_3_{{[0-9]+}}", shape = [6], value = dense<[0, 0, 0, 1, 1, 1]> : tensor<6xi32>} : () -> memref<6xi32>
+  // CHECK-DAG:   [[RES:%.+]] = memref.alloc() : memref<1x1x4x6xf32>
+  // CHECK:       krnl.iterate({{.*}}) with ({{.*}} -> [[N:%.+]] = 0 to 1, {{.*}} -> [[C:%.+]] = 0 to 1, {{.*}} -> [[H:%.+]] = 0 to 4, {{.*}} -> [[W:%.+]] = 0 to 6) {
+  // CHECK:         [[IH:%.+]] = krnl.load [[INDICES_H]]{{.}}[[H]]{{.}} : memref<4xi32>
+  // CHECK:         [[IH_INDEX:%.+]] = index_cast [[IH]] : i32 to index
+  // CHECK:         [[IW:%.+]] = krnl.load [[INDICES_W]]{{.}}[[W]]{{.}} : memref<6xi32>
+  // CHECK:         [[IW_INDEX:%.+]] = index_cast [[IW]] : i32 to index
+  // CHECK:         [[X:%.+]] = krnl.load %arg0{{.}}[[N]], [[C]], [[IH_INDEX]], [[IW_INDEX]]{{.}} : memref<1x1x2x2xf32>
+  // CHECK:         krnl.store [[X]], [[RES]]{{.}}[[N]], [[C]], [[H]], [[W]]{{.}} : memref<1x1x4x6xf32>
+  // CHECK:       return [[RES]] : memref<1x1x4x6xf32>
+}
+
+// -----
+
+/// The classes are processed in parallel, the boxes overlapping each selected
+/// box being removed as vectors, in at most max_output_boxes_per_class
+/// iterations.
+func private @test_nonmaxsuppression(%arg0 : tensor<1x6x4xf32>, %arg1 : tensor<1x2x6xf32>) -> tensor<*xi64> {
+  %max_output = "onnx.Constant"() {value = dense<3> : tensor<1xi64>} : () -> tensor<1xi64>
+  %iou_threshold = "onnx.Constant"() {value = dense<0.5> : tensor<1xf32>} : () -> tensor<1xf32>
+  %score_threshold = "onnx.Constant"() {value = dense<0.0> : tensor<1xf32>} : () -> tensor<1xf32>
+  %0 = "onnx.NonMaxSuppression"(%arg0, %arg1, %max_output, %iou_threshold, %score_threshold) : (tensor<1x6x4xf32>, tensor<1x2x6xf32>, tensor<1xi64>, tensor<1xf32>, tensor<1xf32>) -> tensor<*xi64>
+  "std.return"(%0) : (tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: func private @test_nonmaxsuppression
+  // CHECK-DAG:   [[CORNERS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x5x8xf32>
+  // CHECK-DAG:   [[CORNER_VECTORS:%.+]] = krnl.vector_type_cast [[CORNERS]] : memref<1x5x8xf32> to memref<1x5x1xvector<8xf32>>
+  // CHECK-DAG:   [[SELECTED:%.+]] = memref.alloc() : memref<1x2x3xi64>
+  // CHECK-DAG:   [[COUNTS:%.+]] = memref.alloc() : memref<1x2xindex>
+  // CHECK:       [[CLASS_LOOP:%.+]]:2 = krnl.define_loops 2
+  // CHECK:       krnl.parallel [[CLASS_LOOP]]#1
+  // CHECK:       krnl.iterate([[CLASS_LOOP]]#0, [[CLASS_LOOP]]#1) with ({{.*}} = 0 to 1, {{.*}} = 0 to 2) {
+  // CHECK:         [[WORK:%.+]] = memref.alloca() : memref<8xf32>
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} -> [[T:%.+]] = 0 to 3) {
+  // CHECK:           scf.if
+  // CHECK:             krnl.iterate({{.*}}) with ({{.*}} = 0 to 6) {
+  // CHECK:             scf.if
+  // CHECK:               krnl.store {{.*}}, [[SELECTED]]
+  // CHECK:               krnl.iterate({{.*}}) with ({{.*}} = 0 to 1) {
+  // CHECK:                 krnl.load [[CORNER_VECTORS]]
+  // CHECK:                 cmpf ogt, {{.*}} : vector<8xf32>
+  // CHECK:             } else {
+  // CHECK:       [[RES:%.+]] = memref.alloc({{.*}}) : memref<?x3xi64>
+  // CHECK:       scf.for
+  // CHECK:         krnl.load [[SELECTED]]
+  // CHECK:       return [[RES]] : memref<?x3xi64>
+}
+
+// -----
+
+/// The buffers returned by the calls are freed by the caller, but the one it
+/// returns.
+func private @test_call_results_layer(%arg0 : tensor<10xf32>) -> tensor<10xf32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<10xf32>) -> tensor<10xf32>
+  "std.return"(%0) : (tensor<10xf32>) -> ()
+}
+
+func private @test_call_results(%arg0 : tensor<10xf32>) -> tensor<10xf32> {
+  %0 = call @test_call_results_layer(%arg0) : (tensor<10xf32>) -> tensor<10xf32>
+  %1 = call @test_call_results_layer(%0) : (tensor<10xf32>) -> tensor<10xf32>
+  "std.return"(%1) : (tensor<10xf32>) -> ()
+
+  // CHECK-LABEL: func private @test_call_results_layer
+  // CHECK: [[RES:%.+]] = memref.alloc() {{.*}}: memref<10xf32>
+  // CHECK-NOT: memref.dealloc
+  // CHECK: return [[RES]] : memref<10xf32>
+
+  // CHECK-LABEL: func private @test_call_results
+  // CHECK: [[L0:%.+]] = call @test_call_results_layer(%arg0) : (memref<10xf32>) -> memref<10xf32>
+  // CHECK: [[L1:%.+]] = call @test_call_results_layer([[L0]]) : (memref<10xf32>) -> memref<10xf32>
+  // CHECK: memref.dealloc [[L0]] : memref<10xf32>
+  // CHECK-NOT: memref.dealloc
+  // CHECK: return [[L1]] : memref<10xf32>
+}
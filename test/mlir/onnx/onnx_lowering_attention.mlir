@@ -0,0 +1,31 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The queries stream over blocks of 64 keys: only the scores of one block are
+/// kept, never the 2x128x128 score matrix.
+func private @test_fused_attention(%arg0 : tensor<2x128x32xf32>, %arg1 : tensor<2x32x128xf32>, %arg2 : tensor<2x128x32xf32>, %arg3 : tensor<128xf32>) -> tensor<*xf32> {
+  %0 = "onnx.FusedAttention"(%arg0, %arg1, %arg2, %arg3) {scale = 0.176776695 : f32} : (tensor<2x128x32xf32>, tensor<2x32x128xf32>, tensor<2x128x32xf32>, tensor<128xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+// CHECK-LABEL:  func private @test_fused_attention
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<2x128x32xf32>, [[PARAM_1_:%.+]]: memref<2x32x128xf32>, [[PARAM_2_:%.+]]: memref<2x128x32xf32>, [[PARAM_3_:%.+]]: memref<128xf32>) -> memref<2x128x32xf32> {
+// CHECK:           [[RES_:%.+]] = memref.alloc() : memref<2x128x32xf32>
+// CHECK:           [[QUERY_LOOPS_:%.+]]:2 = krnl.define_loops 2
+// CHECK:           krnl.parallel [[QUERY_LOOPS_]]#0 : !krnl.loop
+// CHECK:           krnl.iterate([[QUERY_LOOPS_]]#0, [[QUERY_LOOPS_]]#1) with ([[QUERY_LOOPS_]]#0 -> [[I_0_:%.+]] = 0 to 2, [[QUERY_LOOPS_]]#1 -> [[I_1_:%.+]] = 0 to 128) {
+// CHECK:             [[SCORES_:%.+]] = memref.alloca() : memref<64xf32>
+// CHECK:             [[ACC_:%.+]] = memref.alloca() : memref<32xf32>
+// CHECK-NOT:         memref.alloc
+// CHECK:             krnl.iterate({{.*}}) with ({{.*}} -> [[I_2_:%.+]] = 0 to 2) {
+// CHECK:               krnl.load [[PARAM_0_]]{{.}}[[I_0_]], [[I_1_]], {{.*}}{{.}} : memref<2x128x32xf32>
+// CHECK:               krnl.load [[PARAM_1_]]{{.}}[[I_0_]], {{.*}}{{.}} : memref<2x32x128xf32>
+// CHECK:               krnl.load [[PARAM_3_]]{{.}}{{.*}}{{.}} : memref<128xf32>
+// CHECK:               krnl.store {{.*}}, [[SCORES_]]{{.}}{{.*}}{{.}} : memref<64xf32>
+// CHECK:               math.exp
+// CHECK:               krnl.load [[SCORES_]]{{.}}{{.*}}{{.}} : memref<64xf32>
+// CHECK:               math.exp
+// CHECK:               krnl.load [[PARAM_2_]]{{.}}[[I_0_]], {{.*}}{{.}} : memref<2x128x32xf32>
+// CHECK:             divf
+// CHECK:             krnl.store {{.*}}, [[RES_]]{{.}}[[I_0_]], [[I_1_]], {{.*}}{{.}} : memref<2x128x32xf32>
+}
@@ -0,0 +1,64 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='blas-min-flops=1000000' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The large f32 matrix multiplies are offloaded to the BLAS sgemm,
+/// accumulating into the zero initialized result.
+func private @test_matmul_blas(%arg0 : tensor<96x256xf32>, %arg1 : tensor<256x200xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<96x256xf32>, tensor<256x200xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_blas
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<96x200xf32>
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: krnl.sgemm %arg0[], %arg1[], [[RES]][] {alpha = 1.000000e+00 : f32, beta = 1.000000e+00 : f32, transA = false, transB = false} : memref<96x256xf32>, memref<256x200xf32>, memref<96x200xf32>
+  // CHECK-NOT: krnl.matmul
+  // CHECK: return [[RES]] : memref<96x200xf32>
+}
+
+// -----
+
+/// The matrices of the batches are selected by the batch indices, the
+/// broadcast B matrix having none.
+func private @test_matmul_batched_blas(%arg0 : tensor<?x128x256xf32>, %arg1 : tensor<256x256xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<?x128x256xf32>, tensor<256x256xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_batched_blas
+  // CHECK: [[RES:%.+]] = memref.alloc({{.*}}) : memref<?x128x256xf32>
+  // CHECK: krnl.iterate
+  // CHECK: krnl.sgemm %arg0[{{%.+}}], %arg1[], [[RES]][{{%.+}}]
+  // CHECK-NOT: krnl.matmul
+}
+
+// -----
+
+/// The Gemm products are computed by the sgemm, with the transposition of A,
+/// and the alpha/beta computations done in a single pass over the result.
+func private @test_gemm_blas(%arg0 : tensor<256x96xf32>, %arg1 : tensor<256x200xf32>, %arg2 : tensor<200xf32>) -> tensor<*xf32> {
+  %0 ="onnx.Gemm"(%arg0, %arg1, %arg2) {alpha = 2.0 : f32, beta = 1.0 : f32, transA = 1 : si64} : (tensor<256x96xf32>, tensor<256x200xf32>, tensor<200xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_gemm_blas
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<96x200xf32>
+  // CHECK-NOT: krnl.store
+  // CHECK: krnl.sgemm %arg0[], %arg1[], [[RES]][] {alpha = 1.000000e+00 : f32, beta = 0.000000e+00 : f32, transA = true, transB = false} : memref<256x96xf32>, memref<256x200xf32>, memref<96x200xf32>
+  // CHECK: krnl.iterate
+  // CHECK: [[PROD:%.+]] = krnl.load [[RES]]
+  // CHECK: [[SCALED:%.+]] = mulf {{.*}}, [[PROD]] : f32
+  // CHECK: [[BIAS:%.+]] = krnl.load %arg2
+  // CHECK: [[SUM:%.+]] = addf [[SCALED]], [[BIAS]] : f32
+  // CHECK: krnl.store [[SUM]], [[RES]]
+}
+
+// -----
+
+/// The smaller matrix multiplies keep the generated kernels.
+func private @test_matmul_small(%arg0 : tensor<16x32xf32>, %arg1 : tensor<32x64xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<16x32xf32>, tensor<32x64xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_small
+  // CHECK-NOT: krnl.sgemm
+  // CHECK: krnl.matmul
+}
@@ -0,0 +1,74 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The constant kernels are packed at compile time into 8x8 matrices. Each
+/// input element is broadcast and multiplied by a row of them, the positions
+/// of the kernel in the padding being skipped.
+func private @test_conv_nchwc_constant_kernel(%arg0 : tensor<1x1x4x4x8xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %w = "onnx.Constant"() {value = dense<1.0> : tensor<8x8x3x3xf32>} : () -> tensor<8x8x3x3xf32>
+  %0 = "onnx.ConvNCHWc"(%arg0, %w, %cst) {block_size = 8 : si64, dilations = [1, 1], pads = [1, 1, 1, 1], strides = [1, 1]} : (tensor<1x1x4x4x8xf32>, tensor<8x8x3x3xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_nchwc_constant_kernel
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x1x4x4x8xf32>
+  // CHECK-DAG: [[KERNELS:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "packed_conv_kernel_0", shape = [1, 1, 3, 3, 8, 8], value = dense<1.000000e+00> : tensor<1x1x3x3x8x8xf32>} : () -> memref<1x1x3x3x8x8xf32>
+  // CHECK-DAG: [[KERNEL_VECS:%.+]] = krnl.vector_type_cast [[KERNELS]] : memref<1x1x3x3x8x8xf32> to memref<1x1x3x3x8x1xvector<8xf32>>
+  // CHECK-DAG: [[RES_VECS:%.+]] = krnl.vector_type_cast [[RES]] : memref<1x1x4x4x8xf32> to memref<1x1x4x4x1xvector<8xf32>>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 1, {{.*}} = 0 to 4, {{.*}} = 0 to 4) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 3, {{.*}} = 0 to 3) {
+  // CHECK: scf.if
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1) {
+  // CHECK: [[X:%.+]] = krnl.load %arg0
+  // CHECK: [[XS:%.+]] = splat [[X]] : vector<8xf32>
+  // CHECK: [[W:%.+]] = krnl.load [[KERNEL_VECS]]
+  // CHECK: vector.fma [[XS]], [[W]], {{.*}} : vector<8xf32>
+  // CHECK: krnl.store {{.*}}, [[RES_VECS]]
+  // CHECK: return [[RES]] : memref<1x1x4x4x8xf32>
+}
+
+// -----
+
+/// Kernels that are not constant are packed at inference time, the channels
+/// past 12 being zeros. Without padding, the kernel positions are not checked.
+func private @test_conv_nchwc_kernel_bias(%arg0 : tensor<1x2x4x4x8xf32>, %arg1 : tensor<12x12x1x1xf32>, %arg2 : tensor<12xf32>) -> tensor<*xf32> {
+  %0 = "onnx.ConvNCHWc"(%arg0, %arg1, %arg2) {block_size = 8 : si64, dilations = [1, 1], pads = [0, 0, 0, 0], strides = [1, 1]} : (tensor<1x2x4x4x8xf32>, tensor<12x12x1x1xf32>, tensor<12xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_nchwc_kernel_bias
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x2x4x4x8xf32>
+  // CHECK-DAG: [[KERNELS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<2x2x1x1x8x8xf32>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 2, {{.*}} = 0 to 2, {{.*}} = 0 to 1, {{.*}} = 0 to 1, {{.*}} = 0 to 8, {{.*}} = 0 to 8) {
+  // CHECK: krnl.store {{.*}}, [[KERNELS]]
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 12, {{.*}} = 0 to 12, {{.*}} = 0 to 1, {{.*}} = 0 to 1) {
+  // CHECK: krnl.load %arg1
+  // CHECK: krnl.store {{.*}}, [[KERNELS]]
+  // CHECK: vector.transfer_read %arg2
+  // CHECK-NOT: scf.if
+  // CHECK: vector.fma
+  // CHECK: return [[RES]] : memref<1x2x4x4x8xf32>
+}
+
+// -----
+
+/// The reorders zero the channels of the last block past 12, and split or
+/// merge the channel index into the block and the channel in the block.
+func private @test_layout_transform(%arg0 : tensor<1x12x4x4xf32>) -> tensor<*xf32> {
+  %0 = "onnx.LayoutTransform"(%arg0) {block_size = 8 : si64} : (tensor<1x12x4x4xf32>) -> tensor<*xf32>
+  %1 = "onnx.LayoutTransform"(%0) {block_size = 0 : si64, channels = 12 : si64} : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_layout_transform
+  // CHECK-DAG: [[BLOCKED:%.+]] = memref.alloc() : memref<1x2x4x4x8xf32>
+  // CHECK-DAG: [[PLAIN:%.+]] = memref.alloc() : memref<1x12x4x4xf32>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 1 to 2, {{.*}} = 0 to 4, {{.*}} = 0 to 4, {{.*}} = 0 to 8) {
+  // CHECK: krnl.store {{.*}}, [[BLOCKED]]
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 12, {{.*}} = 0 to 4, {{.*}} = 0 to 4) {
+  // CHECK: [[X:%.+]] = krnl.load %arg0
+  // CHECK: krnl.store [[X]], [[BLOCKED]]
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 12, {{.*}} = 0 to 4, {{.*}} = 0 to 4) {
+  // CHECK: [[Y:%.+]] = krnl.load [[BLOCKED]]
+  // CHECK: krnl.store [[Y]], [[PLAIN]]
+  // CHECK: return [[PLAIN]] : memref<1x12x4x4xf32>
+}
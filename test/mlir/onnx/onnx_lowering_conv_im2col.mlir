@@ -0,0 +1,64 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='optimize-conv' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The 1566 output pixels are padded to 1568 columns to be simdized.
+func private @test_conv_im2col_no_bias_no_pad(%arg0 : tensor<1x2x32x64xf32>, %arg1 : tensor<5x2x6x7xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %0 = "onnx.Conv"(%arg0, %arg1, %cst) {auto_pad = "NOTSET", group = 1 : si64} : (tensor<1x2x32x64xf32>, tensor<5x2x6x7xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_im2col_no_bias_no_pad
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<1x5x27x58xf32>
+  // CHECK-DAG: [[WEIGHTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x5x84xf32>
+  // CHECK-DAG: [[PATCHES:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x84x1568xf32>
+  // CHECK-DAG: [[PRODUCTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x5x1568xf32>
+  // CHECK-NOT: memref.alloca
+  // CHECK-NOT: select
+
+  /// Pack the weights.
+  // CHECK: krnl.store {{.*}}, [[WEIGHTS]]
+
+  /// Zero the padding columns.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 84, {{.*}} = 1566 to 1568) {
+  // CHECK: krnl.store {{.*}}, [[PATCHES]]
+
+  /// Pack the input patches of each image.
+  // CHECK: krnl.load %arg0
+  // CHECK: krnl.store {{.*}}, [[PATCHES]]
+
+  /// Tiled matrix multiply.
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[PATCHES]]
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[WEIGHTS]]
+  // CHECK: krnl.matmul {{.*}}, [[PRODUCTS]]
+
+  /// Copy to the result.
+  // CHECK: krnl.load [[PRODUCTS]]
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: return [[RES]] : memref<1x5x27x58xf32>
+}
+
+// -----
+
+/// Padded input elements are read as zero.
+func private @test_conv_im2col_bias_pad(%arg0 : tensor<1x4x8x8xf32>, %arg1 : tensor<8x4x3x3xf32>, %arg2 : tensor<8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Conv"(%arg0, %arg1, %arg2) {auto_pad = "NOTSET", group = 1 : si64, pads = [1, 1, 1, 1]} : (tensor<1x4x8x8xf32>, tensor<8x4x3x3xf32>, tensor<8xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_im2col_bias_pad
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<1x8x8x8xf32>
+  // CHECK-DAG: [[PATCHES:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x36x64xf32>
+  // CHECK-DAG: [[PRODUCTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x8x64xf32>
+
+  /// Pack the input patches, with a select for the padding.
+  // CHECK: [[LOAD:%.+]] = krnl.load %arg0
+  // CHECK: [[VAL:%.+]] = select {{.*}}, [[LOAD]], {{.*}} : f32
+  // CHECK: krnl.store [[VAL]], [[PATCHES]]
+  // CHECK: krnl.matmul {{.*}}, [[PRODUCTS]]
+
+  /// Add the bias.
+  // CHECK: [[PRODUCT:%.+]] = krnl.load [[PRODUCTS]]
+  // CHECK: [[BIAS:%.+]] = krnl.load %arg2
+  // CHECK: [[SUM:%.+]] = addf [[PRODUCT]], [[BIAS]] : f32
+  // CHECK: krnl.store [[SUM]], [[RES]]
+}
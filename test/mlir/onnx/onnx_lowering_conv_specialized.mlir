@@ -0,0 +1,63 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='optimize-conv' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Pointwise convolutions multiply views of the operands, without packing the
+/// input. The 49 output pixels are not a multiple of the vector length, the
+/// results are still computed in place, with masked vector transfers.
+func private @test_conv_pointwise(%arg0 : tensor<1x16x7x7xf32>, %arg1 : tensor<32x16x1x1xf32>, %arg2 : tensor<32xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Conv"(%arg0, %arg1, %arg2) {auto_pad = "NOTSET", group = 1 : si64} : (tensor<1x16x7x7xf32>, tensor<32x16x1x1xf32>, tensor<32xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_pointwise
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x32x7x7xf32>
+  // CHECK-NOT: memref.alloc() {alignment = 128 : i64} : memref<1x16x
+  // CHECK-DAG: [[KERNEL:%.+]] = memref.reinterpret_cast %arg1 to offset: [0], sizes: [32, 16], strides: [16, 1] : memref<32x16x1x1xf32> to memref<32x16xf32>
+  // CHECK-DAG: [[INPUT:%.+]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [1, 16, 49], strides: [784, 49, 1] : memref<1x16x7x7xf32> to memref<1x16x49xf32>
+  // CHECK-DAG: [[RESULT:%.+]] = memref.reinterpret_cast [[RES]] to offset: [0], sizes: [1, 32, 49], strides: [1568, 49, 1] : memref<1x32x7x7xf32> to memref<1x32x49xf32>
+
+  /// Initialize the results with the bias.
+  // CHECK: krnl.load %arg2
+  // CHECK: krnl.store {{.*}}, [[RESULT]]
+
+  /// Tiled matrix multiply of each image.
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[INPUT]]
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[KERNEL]]
+  // CHECK: krnl.matmul {{.*}}, [[RESULT]]
+  // CHECK-NOT: krnl.copy_from_tile_buffer
+  // CHECK: return [[RES]] : memref<1x32x7x7xf32>
+}
+
+// -----
+
+/// Depthwise convolutions unroll the kernel positions, each with a loop nest
+/// restricted to the output pixels reading valid input pixels.
+func private @test_conv_depthwise(%arg0 : tensor<1x8x6x6xf32>, %arg1 : tensor<8x1x3x3xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %0 = "onnx.Conv"(%arg0, %arg1, %cst) {auto_pad = "NOTSET", group = 8 : si64, pads = [1, 1, 1, 1]} : (tensor<1x8x6x6xf32>, tensor<8x1x3x3xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_depthwise
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x8x6x6xf32>
+  // CHECK-NOT: memref.alloca
+  // CHECK-NOT: krnl.matmul
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 8) {
+
+  /// Initialize the output channel.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 6, {{.*}} = 0 to 6) {
+  // CHECK: krnl.store {{.*}}, [[RES]]
+
+  /// Kernel position (0, 0) only reads valid input pixels from (1, 1).
+  // CHECK: krnl.load %arg1
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 1 to 6, {{.*}} = 1 to 6) {
+  // CHECK-NOT: select
+  // CHECK: krnl.load %arg0
+  // CHECK: krnl.store {{.*}}, [[RES]]
+
+  /// Kernel position (1, 1) reads the whole input.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 6, {{.*}} = 0 to 6) {
+
+  /// Kernel position (2, 2) stops at the last column and row.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 5, {{.*}} = 0 to 5) {
+  // CHECK: return [[RES]] : memref<1x8x6x6xf32>
+}
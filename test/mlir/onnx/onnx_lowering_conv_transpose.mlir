@@ -0,0 +1,40 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The 27 columns of each of the 64 input pixels are scattered into the 17x17
+/// output positions.
+func private @test_conv_transpose_col2im(%arg0 : tensor<1x4x8x8xf32>, %arg1 : tensor<4x3x3x3xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %0 = "onnx.ConvTranspose"(%arg0, %arg1, %cst) {strides = [2, 2]} : (tensor<1x4x8x8xf32>, tensor<4x3x3x3xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_transpose_col2im
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<1x3x17x17xf32>
+  // CHECK-DAG: [[WEIGHTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x27x4xf32>
+  // CHECK-DAG: [[COLUMNS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x27x64xf32>
+  // CHECK-DAG: [[SUMS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<1x3x17x17xf32>
+  // CHECK-DAG: [[INPUT:%.+]] = memref.reinterpret_cast %arg0 to offset: [0], sizes: [1, 1, 4, 64], strides: [256, 256, 64, 1] : memref<1x4x8x8xf32> to memref<1x1x4x64xf32>
+
+  /// Pack the transposed weights.
+  // CHECK: krnl.load %arg1
+  // CHECK: krnl.store {{.*}}, [[WEIGHTS]]
+
+  /// Tiled matrix multiply.
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[INPUT]]
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[WEIGHTS]]
+  // CHECK: krnl.matmul {{.*}}, [[COLUMNS]]
+
+  /// Scatter the columns.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 3, {{.*}} = 0 to 3, {{.*}} = 0 to 3, {{.*}} = 0 to 8, {{.*}} = 0 to 8) {
+  // CHECK: krnl.load [[COLUMNS]]
+  // CHECK: select
+  // CHECK: krnl.load [[SUMS]]
+  // CHECK: addf
+  // CHECK: krnl.store {{.*}}, [[SUMS]]
+
+  /// Copy to the result.
+  // CHECK: krnl.load [[SUMS]]
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: return [[RES]] : memref<1x3x17x17xf32>
+}
@@ -0,0 +1,78 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='winograd-conv' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The transform of constant kernels is computed at compile time: the value
+/// at each position of the transformed tiles of an all-ones kernel is the
+/// product of the row sums of G, i.e. [1, 1.5, 0.5, 1].
+func private @test_conv_winograd_constant_kernel(%arg0 : tensor<1x1x4x4xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %w = "onnx.Constant"() {value = dense<1.0> : tensor<2x1x3x3xf32>} : () -> tensor<2x1x3x3xf32>
+  %0 = "onnx.Conv"(%arg0, %w, %cst) {auto_pad = "NOTSET", group = 1 : si64} : (tensor<1x1x4x4xf32>, tensor<2x1x3x3xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_winograd_constant_kernel
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<1x2x2x2xf32>
+  // CHECK-DAG: [[KERNELS:%.+]] = "krnl.global"() {name = "winograd_kernel_0", shape = [16, 2, 1], value = dense<{{.}}{{.}}{{.}}1.000000e+00], [1.000000e+00]], {{.}}{{.}}1.500000e+00], [1.500000e+00]], {{.}}{{.}}5.000000e-01], [5.000000e-01]], {{.}}{{.}}1.000000e+00], [1.000000e+00]], {{.}}{{.}}1.500000e+00], [1.500000e+00]], {{.}}{{.}}2.250000e+00], [2.250000e+00]]{{.*}}> : tensor<16x2x1xf32>} : () -> memref<16x2x1xf32>
+  // CHECK-DAG: [[INPUTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<16x1x8xf32>
+  // CHECK-DAG: [[PRODUCTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<16x2x8xf32>
+  // CHECK-NOT: select
+
+  /// Zero the padding tiles.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 16, {{.*}} = 0 to 1, {{.*}} = 1 to 8) {
+  // CHECK: krnl.store {{.*}}, [[INPUTS]]
+
+  /// Transform the input tiles.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 1, {{.*}} = 0 to 1) {
+  // CHECK: krnl.load %arg0
+  // CHECK: krnl.store {{.*}}, [[INPUTS]]
+
+  /// One matrix multiply per position of the transformed tiles.
+  // CHECK: krnl.store {{.*}}, [[PRODUCTS]]
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[INPUTS]]
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, [[KERNELS]]
+  // CHECK: krnl.matmul {{.*}}, [[PRODUCTS]]
+
+  /// Output transform.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 2, {{.*}} = 0 to 1, {{.*}} = 0 to 1) {
+  // CHECK: krnl.load [[PRODUCTS]]
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: return [[RES]] : memref<1x2x2x2xf32>
+}
+
+// -----
+
+/// Kernels that are not constant are transformed at inference time. With
+/// padding and odd output sizes, the input tiles are read with bound checks
+/// and the last tile row and column store partial output tiles.
+func private @test_conv_winograd_pad_odd(%arg0 : tensor<1x3x5x5xf32>, %arg1 : tensor<4x3x3x3xf32>, %arg2 : tensor<4xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Conv"(%arg0, %arg1, %arg2) {auto_pad = "NOTSET", group = 1 : si64, pads = [1, 1, 1, 1]} : (tensor<1x3x5x5xf32>, tensor<4x3x3x3xf32>, tensor<4xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_conv_winograd_pad_odd
+  // CHECK-DAG: [[RES:%.+]] = memref.alloc() : memref<1x4x5x5xf32>
+  // CHECK-DAG: [[KERNELS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<16x4x3xf32>
+  // CHECK-DAG: [[INPUTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<16x3x16xf32>
+  // CHECK-DAG: [[PRODUCTS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<16x4x16xf32>
+
+  /// Kernel transform.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 4, {{.*}} = 0 to 3) {
+  // CHECK: krnl.load %arg1
+  // CHECK: krnl.store {{.*}}, [[KERNELS]]
+
+  /// Input transform, with padding.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 3, {{.*}} = 0 to 3, {{.*}} = 0 to 3) {
+  // CHECK: select
+  // CHECK: krnl.store {{.*}}, [[INPUTS]]
+
+  // CHECK: krnl.matmul {{.*}}, [[PRODUCTS]]
+
+  /// Full tiles, then the last column, row and corner.
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 4, {{.*}} = 0 to 2, {{.*}} = 0 to 2) {
+  // CHECK: krnl.load %arg2
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 4, {{.*}} = 0 to 2, {{.*}} = 2 to 3) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 4, {{.*}} = 2 to 3, {{.*}} = 0 to 2) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 4, {{.*}} = 2 to 3, {{.*}} = 2 to 3) {
+  // CHECK: return [[RES]] : memref<1x4x5x5xf32>
+}
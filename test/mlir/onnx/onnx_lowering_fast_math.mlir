@@ -0,0 +1,77 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='fast-math' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Erf is approximated with arithmetic ops, which are vectorized.
+func private @test_erf_fast_math(%arg0 : tensor<10x16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Erf"(%arg0) : (tensor<10x16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_erf_fast_math
+  // CHECK-NOT: krnl.erf
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x16xf32>
+  // CHECK-DAG: [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK: krnl.iterate
+  // CHECK: [[LOAD:%.+]] = krnl.load [[VEC_X]][%arg1, %arg2] : memref<10x2xvector<8xf32>>
+  // CHECK: [[LOWER:%.+]] = cmpf olt, [[LOAD]], {{.*}} : vector<8xf32>
+  // CHECK: [[ERF:%.+]] = divf {{.*}} : vector<8xf32>
+  // CHECK: krnl.store [[ERF]], [[VEC_RES]][%arg1, %arg2] : memref<10x2xvector<8xf32>>
+  // CHECK-NOT: krnl.erf
+}
+
+// -----
+
+/// Tanh is approximated on scalars when the innermost dimension is not
+/// vectorized.
+func private @test_tanh_fast_math(%arg0 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Tanh"(%arg0) : (tensor<10x10xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_tanh_fast_math
+  // CHECK-NOT: krnl.vector_type_cast
+  // CHECK: krnl.iterate
+  // CHECK: [[LOAD:%.+]] = krnl.load %arg0[%arg1, %arg2] : memref<10x10xf32>
+  // CHECK-NOT: math.exp
+  // CHECK: [[TANH:%.+]] = divf {{.*}} : f32
+  // CHECK: krnl.store [[TANH]], {{.*}}[%arg1, %arg2] : memref<10x10xf32>
+}
+
+// -----
+
+/// Exp builds 2^n from the exponent bits of a float.
+func private @test_exp_fast_math(%arg0 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Exp"(%arg0) : (tensor<10x10xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_exp_fast_math
+  // CHECK-NOT: math.exp
+  // CHECK: [[N:%.+]] = floorf {{.*}} : f32
+  // CHECK: [[N_INT:%.+]] = fptosi [[N]] : f32 to i32
+  // CHECK: [[BIASED:%.+]] = addi [[N_INT]], {{.*}} : i32
+  // CHECK: [[BITS:%.+]] = shift_left [[BIASED]], {{.*}} : i32
+  // CHECK: [[POW2N:%.+]] = bitcast [[BITS]] : i32 to f32
+  // CHECK: [[EXP:%.+]] = mulf {{.*}}, [[POW2N]] : f32
+  // CHECK-NOT: math.exp
+}
+
+// -----
+
+/// The fused GELU is computed in a single vectorized loop, its erf
+/// approximated.
+func private @test_gelu_fast_math(%arg0 : tensor<10x16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.FusedActivation"(%arg0) {activation = "Gelu"} : (tensor<10x16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_gelu_fast_math
+  // CHECK-NOT: krnl.erf
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x16xf32>
+  // CHECK-DAG: [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK: krnl.iterate
+  // CHECK: [[LOAD:%.+]] = krnl.load [[VEC_X]][%arg1, %arg2] : memref<10x2xvector<8xf32>>
+  // CHECK: [[GELU:%.+]] = mulf [[LOAD]], {{.*}} : vector<8xf32>
+  // CHECK-NEXT: krnl.store [[GELU]], [[VEC_RES]][%arg1, %arg2] : memref<10x2xvector<8xf32>>
+  // CHECK-NOT: krnl.iterate
+  // CHECK-NOT: krnl.erf
+}
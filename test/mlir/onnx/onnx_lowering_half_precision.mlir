@@ -0,0 +1,20 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+/// The f16 products are accumulated in f32, then rounded to f16.
+func private @test_matmul_f16(%arg0 : tensor<16x32xf16>, %arg1 : tensor<32x64xf16>) -> tensor<*xf16> {
+  %0 = "onnx.MatMul"(%arg0, %arg1) : (tensor<16x32xf16>, tensor<32x64xf16>) -> tensor<*xf16>
+  "std.return"(%0) : (tensor<*xf16>) -> ()
+
+// CHECK-LABEL:  func private @test_matmul_f16
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<16x32xf16>, [[PARAM_1_:%.+]]: memref<32x64xf16>) -> memref<16x64xf16> {
+// CHECK-DAG:       [[RES_:%.+]] = memref.alloc() : memref<16x64xf16>
+// CHECK-DAG:       [[ACC_:%.+]] = memref.alloc() : memref<16x64xf32>
+// CHECK:           krnl.matmul [[PARAM_0_]]{{.*}}, [[PARAM_1_]]{{.*}}, [[ACC_]]{{.*}} : memref<16x32xf16>, memref<32x64xf16>, memref<16x64xf32>
+// CHECK:           krnl.iterate
+// CHECK:             [[LOAD_ACC_:%.+]] = krnl.load [[ACC_]]{{.}}[[I_0_:%.+]], [[I_1_:%.+]]{{.}} : memref<16x64xf32>
+// CHECK:             [[VAR_RES_:%.+]] = fptrunc [[LOAD_ACC_]] : f32 to f16
+// CHECK:             krnl.store [[VAR_RES_]], [[RES_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<16x64xf16>
+// CHECK:           memref.dealloc [[ACC_]] : memref<16x64xf32>
+}
@@ -0,0 +1,57 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='emit-in-place' %s -split-input-file | FileCheck %s
+
+// -----
+
+func @test_add_relu_add(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  %2 = "onnx.Add"(%1, %arg1) : (tensor<*xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_add_relu_add
+  // CHECK: [[RET_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK-NOT: memref.alloc
+
+  /// First Add
+  // CHECK: krnl.iterate
+  // CHECK: [[ADDF:%.+]] = addf {{.*}} : f32
+  // CHECK: krnl.store [[ADDF]], [[RES]][%arg2, %arg3] : memref<10x10xf32>
+
+  /// Relu, in place
+  // CHECK: krnl.iterate
+  // CHECK: [[LOAD:%.+]] = krnl.load [[RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: [[RELU:%.+]] = select {{.*}} : f32
+  // CHECK: krnl.store [[RELU]], [[RES]][%arg2, %arg3] : memref<10x10xf32>
+
+  /// Second Add, the result is returned so it is not computed in place.
+  // CHECK: krnl.iterate
+  // CHECK: [[LOAD1:%.+]] = krnl.load [[RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: [[LOAD2:%.+]] = krnl.load %arg1[%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: [[ADDF:%.+]] = addf [[LOAD1]], [[LOAD2]] : f32
+  // CHECK: krnl.store [[ADDF]], [[RET_RES]][%arg2, %arg3] : memref<10x10xf32>
+
+  // CHECK: memref.dealloc [[RES]] : memref<10x10xf32>
+  // CHECK-NOT: memref.dealloc
+  // CHECK: return [[RET_RES]] : memref<10x10xf32>
+}
+
+// -----
+
+func @test_add_relu_live_operand(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  %2 = "onnx.Add"(%1, %0) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  /// The result of the first Add is used after the Relu, so the Relu gets its
+  /// own buffer.
+  // CHECK-LABEL: test_add_relu_live_operand
+  // CHECK: [[RET_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: [[RELU_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: [[ADD_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[ADD_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.load [[ADD_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[RELU_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[RET_RES]][%arg2, %arg3] : memref<10x10xf32>
+}
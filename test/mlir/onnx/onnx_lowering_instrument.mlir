@@ -0,0 +1,26 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='instrument' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Each ONNX op is surrounded by instrumentation points, the second one being
+/// given the buffers of its outputs. Constants are not instrumented.
+func private @test_instrument(%arg0 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<1.0> : tensor<10x10xf32>} : () -> tensor<10x10xf32>
+  %1 = "onnx.Add"(%arg0, %0) {onnx_node_name = "add1"} : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %2 = "onnx.Relu"(%1) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_instrument
+  // CHECK-NOT: krnl.instrument
+  // CHECK: [[CST:%.+]] = "krnl.global"()
+  // CHECK: "krnl.instrument"() {nodeName = "add1", opName = "Add", tag = 0 : i64} : () -> ()
+  // CHECK: [[ADD:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: krnl.iterate
+  // CHECK: "krnl.instrument"([[ADD]]) {nodeName = "add1", opName = "Add", tag = 1 : i64} : (memref<10x10xf32>) -> ()
+  // CHECK: "krnl.instrument"() {nodeName = "", opName = "Relu", tag = 0 : i64} : () -> ()
+  // CHECK: [[RELU:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: krnl.iterate
+  // CHECK: "krnl.instrument"([[RELU]]) {nodeName = "", opName = "Relu", tag = 1 : i64} : (memref<10x10xf32>) -> ()
+  // CHECK: memref.dealloc [[ADD]] : memref<10x10xf32>
+  // CHECK: return [[RELU]] : memref<10x10xf32>
+}
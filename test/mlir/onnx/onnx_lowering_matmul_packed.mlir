@@ -0,0 +1,35 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='matmul-tile-sizes=8,8,8,4,8' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Constant B matrices are packed into 8x8 panels at compile time, transposed
+/// and padded with zeros, and read in place by the matrix multiplies.
+func private @test_gemm_packed_constant(%arg0 : tensor<4x2xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[1.0, 4.0], [2.0, 5.0], [3.0, 6.0]]> : tensor<3x2xf32>} : () -> tensor<3x2xf32>
+  %cst = constant unit
+  %1 = "onnx.Gemm"(%arg0, %0, %cst) {transB = 1 : si64} : (tensor<4x2xf32>, tensor<3x2xf32>, none) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_gemm_packed_constant
+  // CHECK: [[PACKED:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "packed_panels_{{[0-9]+}}", shape = [1, 1, 8, 8], value = dense<{{.}}{{.}}{{.}}{{.}}1.000000e+00, 2.000000e+00, 3.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00], [4.000000e+00, 5.000000e+00, 6.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00], [0.000000e+00
+  // CHECK-SAME: : tensor<1x1x8x8xf32>} : () -> memref<1x1x8x8xf32>
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, %arg0
+  // CHECK-NOT: krnl.copy_to_tile_buffer
+  // CHECK: krnl.matmul {{.*}}, [[PACKED]]{{.}}{{.*}}, {{.*}}, {{.*}}, {{.*}}{{.}}, {{.*}} : memref<8x8xf32>, memref<1x1x8x8xf32>
+}
+
+// -----
+
+/// Constant B matrices shared by all the batches are packed as well.
+func private @test_matmul_packed_constant(%arg0 : tensor<?x4x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<1.0> : tensor<8x16xf32>} : () -> tensor<8x16xf32>
+  %1 ="onnx.MatMul"(%arg0, %0) : (tensor<?x4x8xf32>, tensor<8x16xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_packed_constant
+  // CHECK: [[PACKED:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "packed_panels_{{[0-9]+}}", shape = [1, 2, 8, 8]
+  // CHECK: krnl.parallel
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, %arg0
+  // CHECK-NOT: krnl.copy_to_tile_buffer
+  // CHECK: krnl.matmul {{.*}}, [[PACKED]]{{.}}{{.*}}, {{.*}}, {{.*}}, {{.*}}{{.}}, {{.*}} : memref<8x8xf32>, memref<1x2x8x8xf32>
+}
@@ -0,0 +1,71 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='matmul-tile-sizes=32,64,256,4,16' %s -split-input-file | FileCheck --check-prefix=TILES %s
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='matmul-unroll=false' %s -split-input-file | FileCheck --check-prefix=NOUNROLL %s
+
+// -----
+
+/// 2-D matrix multiplies exceeding a cache tile are packed into tile buffers.
+/// The 200 result columns are not a multiple of the vector length, the
+/// results are still computed in place, with masked vector transfers.
+func private @test_matmul_2d_tiled(%arg0 : tensor<96x256xf32>, %arg1 : tensor<256x200xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<96x256xf32>, tensor<256x200xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_2d_tiled
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<96x200xf32>
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: krnl.parallel
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<64x512xf32>
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<512x128xf32>
+  // CHECK-NOT: memref.alloc
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, %arg1
+  // CHECK-SAME: prefetchNext = [512, 0]
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, %arg0
+  // CHECK-SAME: prefetchNext = [64, 0]
+  // CHECK: krnl.matmul {{.*}}, [[RES]]
+  // CHECK-NOT: krnl.copy_from_tile_buffer
+  // CHECK: return [[RES]] : memref<96x200xf32>
+
+  /// The register tiles are not unrolled for smaller code.
+  // NOUNROLL-LABEL: test_matmul_2d_tiled
+  // NOUNROLL: krnl.matmul {{.*}} unroll = false}
+}
+
+// -----
+
+/// Batched matrix multiplies run in parallel over the batch, with the tile
+/// buffers allocated in each batch iteration. The B matrix is broadcast.
+func private @test_matmul_batched_tiled(%arg0 : tensor<?x128x256xf32>, %arg1 : tensor<256x256xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<?x128x256xf32>, tensor<256x256xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_batched_tiled
+  // CHECK: [[RES:%.+]] = memref.alloc({{.*}}) : memref<?x128x256xf32>
+  // CHECK: [[BATCH_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[BATCH_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[BATCH_LOOP]])
+  // CHECK: [[BATCH:%.+]] = krnl.get_induction_var_value([[BATCH_LOOP]])
+  // CHECK: krnl.store {{.*}}, [[RES]]{{.}}[[BATCH]], {{.*}}] : memref<?x128x256xf32>
+  // CHECK-NOT: krnl.parallel
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<64x512xf32>
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<512x128xf32>
+  // CHECK-NOT: memref.alloc
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, %arg1
+  // CHECK: krnl.copy_to_tile_buffer {{.*}}, %arg0{{.}}[[BATCH]], {{.*}}]
+  // CHECK: krnl.matmul
+  // CHECK: memref.dealloc
+  // CHECK: return [[RES]] : memref<?x128x256xf32>
+}
+
+// -----
+
+/// The tile sizes can be overridden, e.g. for 16 float vectors.
+func private @test_matmul_tile_sizes(%arg0 : tensor<96x256xf32>, %arg1 : tensor<256x256xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<96x256xf32>, tensor<256x256xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // TILES-LABEL: test_matmul_tile_sizes
+  // TILES: memref.alloc() {alignment = 128 : i64} : memref<32x256xf32>
+  // TILES: memref.alloc() {alignment = 128 : i64} : memref<256x64xf32>
+  // TILES: krnl.matmul {{.*}} computeTileSize = [4, 16, 256]
+}
@@ -0,0 +1,34 @@
+// RUN: echo '{"matmul": [{"i": 96, "j": 200, "k": 256, "tile_sizes": [32, 64, 128, 4, 8], "simdize": false, "seconds": 0.001}]}' > %t.json
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='matmul-tuning-db=%t.json' %s -split-input-file | FileCheck %s
+// RUN: echo '{"matmul": [{"i": 96, "j": 200, "tile_sizes": [32, 64, 128, 4, 8]}]}' > %t.bad.json
+// RUN: not onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='matmul-tuning-db=%t.bad.json' %s -split-input-file 2>&1 | FileCheck --check-prefix=ERROR %s
+
+// -----
+
+/// The matrix multiplies of the shapes of the tuning database use its tile
+/// sizes, here without simdization.
+func private @test_matmul_tuned(%arg0 : tensor<96x256xf32>, %arg1 : tensor<256x200xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<96x256xf32>, tensor<256x200xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_tuned
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<32x128xf32>
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<128x64xf32>
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<32x64xf32>
+  // CHECK: krnl.matmul {{.*}} {aTileSize = [], bTileSize = [], cTileSize = [], computeTileSize = [4, 8, 128], overcompute = false, simdize = false, unroll = true}
+}
+
+// -----
+
+/// The other shapes keep the default tile sizes.
+func private @test_matmul_not_tuned(%arg0 : tensor<96x256xf32>, %arg1 : tensor<256x256xf32>) -> tensor<*xf32> {
+  %0 ="onnx.MatMul"(%arg0, %arg1) : (tensor<96x256xf32>, tensor<256x256xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_not_tuned
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<64x512xf32>
+  // CHECK: memref.alloc() {alignment = 128 : i64} : memref<512x128xf32>
+  // CHECK: krnl.matmul {{.*}} simdize = true, unroll = true}
+}
+
+// ERROR: expected i, j, k and 5 positive tile_sizes in each matmul entry
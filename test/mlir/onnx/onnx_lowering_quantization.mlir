@@ -0,0 +1,59 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Quantization rounds half to even, adds the zero point and saturates.
+func private @test_quantize_linear(%arg0 : tensor<4x8xf32>, %arg1 : tensor<f32>, %arg2 : tensor<i8>) -> tensor<*xi8> {
+  %0 = "onnx.QuantizeLinear"(%arg0, %arg1, %arg2) : (tensor<4x8xf32>, tensor<f32>, tensor<i8>) -> tensor<*xi8>
+  "std.return"(%0) : (tensor<*xi8>) -> ()
+
+// CHECK-LABEL:  func private @test_quantize_linear
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<4x8xf32>, [[PARAM_1_:%.+]]: memref<f32>, [[PARAM_2_:%.+]]: memref<i8>) -> memref<4x8xi8> {
+// CHECK:           [[RES_:%.+]] = memref.alloc() : memref<4x8xi8>
+// CHECK:           krnl.iterate
+// CHECK-DAG:         [[LOAD_X_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[I_0_:%.+]], [[I_1_:%.+]]{{.}} : memref<4x8xf32>
+// CHECK-DAG:         [[LOAD_SCALE_:%.+]] = krnl.load [[PARAM_1_]][] : memref<f32>
+// CHECK-DAG:         [[LOAD_ZERO_:%.+]] = krnl.load [[PARAM_2_]][] : memref<i8>
+// CHECK:             [[VAR_DIV_:%.+]] = divf [[LOAD_X_]], [[LOAD_SCALE_]] : f32
+// CHECK:             floorf [[VAR_DIV_]] : f32
+// CHECK:             sitofp [[LOAD_ZERO_]] : i8 to f32
+// CHECK:             [[VAR_Q_:%.+]] = fptosi {{.*}} : f32 to i8
+// CHECK:             krnl.store [[VAR_Q_]], [[RES_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<4x8xi8>
+}
+
+// -----
+
+/// Dequantization subtracts the per-axis zero points in 32 bits.
+func private @test_dequantize_linear_per_axis(%arg0 : tensor<4x8xi8>, %arg1 : tensor<8xf32>, %arg2 : tensor<8xi8>) -> tensor<*xf32> {
+  %0 = "onnx.DequantizeLinear"(%arg0, %arg1, %arg2) : (tensor<4x8xi8>, tensor<8xf32>, tensor<8xi8>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+// CHECK-LABEL:  func private @test_dequantize_linear_per_axis
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<4x8xi8>, [[PARAM_1_:%.+]]: memref<8xf32>, [[PARAM_2_:%.+]]: memref<8xi8>) -> memref<4x8xf32> {
+// CHECK:           krnl.iterate
+// CHECK:             [[LOAD_X_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[I_0_:%.+]], [[I_1_:%.+]]{{.}} : memref<4x8xi8>
+// CHECK:             [[VAR_X_:%.+]] = sexti [[LOAD_X_]] : i8 to i32
+// CHECK:             [[LOAD_ZERO_:%.+]] = krnl.load [[PARAM_2_]]{{.}}[[I_1_]]{{.}} : memref<8xi8>
+// CHECK:             [[VAR_ZERO_:%.+]] = sexti [[LOAD_ZERO_]] : i8 to i32
+// CHECK:             [[VAR_SUB_:%.+]] = subi [[VAR_X_]], [[VAR_ZERO_]] : i32
+// CHECK:             [[LOAD_SCALE_:%.+]] = krnl.load [[PARAM_1_]]{{.}}[[I_1_]]{{.}} : memref<8xf32>
+// CHECK:             [[VAR_FP_:%.+]] = sitofp [[VAR_SUB_]] : i32 to f32
+// CHECK:             mulf [[VAR_FP_]], [[LOAD_SCALE_]] : f32
+}
+
+// -----
+
+/// The int8 products are accumulated in i32 by the tiled matrix multiply.
+func private @test_matmul_integer(%arg0 : tensor<16x32xi8>, %arg1 : tensor<32x64xi8>) -> tensor<*xi32> {
+  %cst = constant unit
+  %0 = "onnx.MatMulInteger"(%arg0, %arg1, %cst, %cst) : (tensor<16x32xi8>, tensor<32x64xi8>, none, none) -> tensor<*xi32>
+  "std.return"(%0) : (tensor<*xi32>) -> ()
+
+// CHECK-LABEL:  func private @test_matmul_integer
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<16x32xi8>, [[PARAM_1_:%.+]]: memref<32x64xi8>) -> memref<16x64xi32> {
+// CHECK:           [[RES_:%.+]] = memref.alloc() : memref<16x64xi32>
+// CHECK:           krnl.store {{.*}}, [[RES_]]{{.}}{{.*}}{{.}} : memref<16x64xi32>
+// CHECK:           krnl.copy_to_buffer {{.*}}, [[PARAM_1_]]{{.*}} : memref<{{.*}}xi8>, memref<32x64xi8>
+// CHECK:           krnl.copy_to_buffer {{.*}}, [[PARAM_0_]]{{.*}} : memref<{{.*}}xi8>, memref<16x32xi8>
+// CHECK:           krnl.matmul {{.*}}, [[RES_]]{{.*}} : memref<{{.*}}xi8>, memref<{{.*}}xi8>, memref<16x64xi32>
+}
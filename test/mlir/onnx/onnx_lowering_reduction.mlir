@@ -0,0 +1,111 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Reducing the innermost dimension accumulates vectors of partial sums,
+/// combined by a horizontal reduction.
+func private @test_reducesum_inner(%arg0 : tensor<4x32xf32>) -> tensor<*xf32> {
+  %0 ="onnx.ReduceSumV11"(%arg0) {axes=[1], keepdims = 0 : si64} : (tensor<4x32xf32>)-> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_reducesum_inner
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<4xf32>
+  // CHECK: [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<4x32xf32> to memref<4x4xvector<8xf32>>
+  // CHECK: [[OUTER_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[OUTER_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[OUTER_LOOP]]) with ([[OUTER_LOOP]] -> [[I:%.+]] = 0 to 4) {
+  // CHECK:   [[ACC:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   [[INNER_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK:   krnl.iterate([[INNER_LOOP]]) with ([[INNER_LOOP]] -> [[J:%.+]] = 0 to 4) {
+  // CHECK:     [[LOAD_X:%.+]] = krnl.load [[VEC_X]]{{.}}[[I]], [[J]]{{.}} : memref<4x4xvector<8xf32>>
+  // CHECK:     [[LOAD_ACC:%.+]] = krnl.load [[ACC]][] : memref<vector<8xf32>>
+  // CHECK:     [[ADD:%.+]] = addf [[LOAD_ACC]], [[LOAD_X]] : vector<8xf32>
+  // CHECK:     krnl.store [[ADD]], [[ACC]][] : memref<vector<8xf32>>
+  // CHECK:   }
+  // CHECK:   [[SUMS:%.+]] = krnl.load [[ACC]][] : memref<vector<8xf32>>
+  // CHECK:   [[SUM:%.+]] = vector.reduction "add", [[SUMS]] : vector<8xf32> into f32
+  // CHECK:   krnl.store [[SUM]], [[RES]]{{.}}[[I]]{{.}} : memref<4xf32>
+  // CHECK: return [[RES]] : memref<4xf32>
+}
+
+// -----
+
+/// Reducing the outermost dimension computes partial results over chunks of
+/// rows in parallel, then combines them pairwise.
+func private @test_reducemax_outer(%arg0 : tensor<64x16xf32>) -> tensor<*xf32> {
+  %0 ="onnx.ReduceMax"(%arg0) {axes=[0], keepdims = 1 : si64} : (tensor<64x16xf32>)-> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_reducemax_outer
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x16xf32>
+  // CHECK: [[PARTIALS:%.+]] = memref.alloc() {alignment = 128 : i64} : memref<8x16xf32>
+  // CHECK-DAG: [[VEC_P:%.+]] = krnl.vector_type_cast [[PARTIALS]] : memref<8x16xf32> to memref<8x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<1x16xf32> to memref<1x2xvector<8xf32>>
+  // CHECK: [[CHUNK_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[CHUNK_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[CHUNK_LOOP]]) with ([[CHUNK_LOOP]] -> [[C:%.+]] = 0 to 8) {
+  // CHECK:   krnl.store {{.*}}, [[VEC_P]]{{.}}[[C]], {{.*}}{{.}} : memref<8x2xvector<8xf32>>
+  // CHECK:   [[ROW_LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK:   krnl.iterate([[ROW_LOOPS]]#0, [[ROW_LOOPS]]#1) with ([[ROW_LOOPS]]#0 -> [[R:%.+]] = {{.*}} to {{.*}}, [[ROW_LOOPS]]#1 -> [[K:%.+]] = 0 to 2) {
+  // CHECK:     [[LOAD_P:%.+]] = krnl.load [[VEC_P]]{{.}}[[C]], [[K]]{{.}} : memref<8x2xvector<8xf32>>
+  // CHECK:     cmpf ogt, [[LOAD_P]], {{.*}} : vector<8xf32>
+  // CHECK:     krnl.store {{.*}}, [[VEC_P]]{{.}}[[C]], [[K]]{{.}} : memref<8x2xvector<8xf32>>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 2, {{.*}} = 0 to 4) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} = 0 to 2, {{.*}} = 0 to 2) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> [[K:%.+]] = 0 to 2) {
+  // CHECK:   krnl.store {{.*}}, [[VEC_RES]]{{.}}{{.*}}, [[K]]{{.}} : memref<1x2xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<1x16xf32>
+}
+
+// -----
+
+/// ArgMax along the innermost dimension keeps the best values and their
+/// indices in vectors, resolved horizontally for each row.
+func private @test_argmax_vectorized(%arg0 : tensor<4x64xf32>) -> tensor<*xi64> {
+  %0 = "onnx.ArgMax"(%arg0) {axis = 1 : si64, keepdims = 0 : si64} : (tensor<4x64xf32>) -> tensor<*xi64>
+  "std.return"(%0) : (tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: test_argmax_vectorized
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<4xi64>
+  // CHECK: [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<4x64xf32> to memref<4x8xvector<8xf32>>
+  // CHECK: [[LANES:%.+]] = constant dense<[0, 1, 2, 3, 4, 5, 6, 7]> : vector<8xi64>
+  // CHECK: [[ROW_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[ROW_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[ROW_LOOP]]) with ([[ROW_LOOP]] -> [[I:%.+]] = 0 to 4) {
+  // CHECK:   [[BEST_VALUES:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   [[BEST_INDICES:%.+]] = memref.alloca() : memref<vector<8xi64>>
+  // CHECK:   krnl.store [[LANES]], [[BEST_INDICES]][] : memref<vector<8xi64>>
+  // CHECK:   [[VEC_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK:   krnl.iterate([[VEC_LOOP]]) with ([[VEC_LOOP]] -> [[J:%.+]] = 1 to 8) {
+  // CHECK:     [[NEXT:%.+]] = krnl.load [[VEC_X]]{{.}}[[I]], [[J]]{{.}} : memref<4x8xvector<8xf32>>
+  // CHECK:     [[BEST:%.+]] = krnl.load [[BEST_VALUES]][] : memref<vector<8xf32>>
+  // CHECK:     cmpf ogt, [[NEXT]], [[BEST]] : vector<8xf32>
+  // CHECK:   }
+  // CHECK:   [[MAX:%.+]] = vector.reduction "max", {{.*}} : vector<8xf32> into f32
+  // CHECK:   cmpf oeq, {{.*}} : vector<8xf32>
+  // CHECK:   [[INDEX:%.+]] = vector.reduction "min", {{.*}} : vector<8xi64> into i64
+  // CHECK:   krnl.store [[INDEX]], [[RES]]{{.}}[[I]]{{.}} : memref<4xi64>
+  // CHECK: return [[RES]] : memref<4xi64>
+}
+
+// -----
+
+/// The last index of the min is selected by also accepting equal values. The
+/// kept dimension is iterated in parallel.
+func private @test_argmin_select_last_index(%arg0 : tensor<3x5xf32>) -> tensor<*xi64> {
+  %0 = "onnx.ArgMin"(%arg0) {axis = 0 : si64, select_last_index = 1 : si64} : (tensor<3x5xf32>) -> tensor<*xi64>
+  "std.return"(%0) : (tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: test_argmin_select_last_index
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x5xi64>
+  // CHECK: [[INIT_LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK: krnl.iterate([[INIT_LOOPS]]#0, [[INIT_LOOPS]]#1) with ([[INIT_LOOPS]]#0 -> %arg1 = 0 to 1, [[INIT_LOOPS]]#1 -> %arg2 = 0 to 5) {
+  // CHECK: [[CALC_LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK: krnl.parallel [[CALC_LOOPS]]#1 : !krnl.loop
+  // CHECK: krnl.iterate([[CALC_LOOPS]]#0, [[CALC_LOOPS]]#1) with ([[CALC_LOOPS]]#0 -> %arg1 = 0 to 3, [[CALC_LOOPS]]#1 -> %arg2 = 0 to 5) {
+  // CHECK:   [[NEXT:%.+]] = krnl.load %arg0[%arg1, %arg2] : memref<3x5xf32>
+  // CHECK:   [[BEST:%.+]] = krnl.load %arg0[{{.*}}, %arg2] : memref<3x5xf32>
+  // CHECK:   cmpf ole, [[NEXT]], [[BEST]] : f32
+  // CHECK:   krnl.store {{.*}}, [[RES]]{{.}}[[C0:%.+]], %arg2{{.}} : memref<1x5xi64>
+  // CHECK: return [[RES]] : memref<1x5xi64>
+}
@@ -0,0 +1,49 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='check-rnn-ops-lowering persistent-rnn-states' %s -split-input-file | FileCheck %s
+
+/// The hidden and cell states of a forward LSTM without initial states are
+/// globals, neither allocated nor initialized by the calls of the model.
+func private @test_lstm_persistent_states(%arg0: tensor<7x2x3xf32>, %arg1: tensor<1x16x3xf32>, %arg2: tensor<1x16x4xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %Y, %Y_h, %Y_c = "onnx.LSTM"(%arg0, %arg1, %arg2, %cst, %cst, %cst, %cst, %cst) {hidden_size = 4 : si64} : (tensor<7x2x3xf32>, tensor<1x16x3xf32>, tensor<1x16x4xf32>, none, none, none, none, none) -> (none, tensor<*xf32>, none)
+  return %Y_h : tensor<*xf32>
+
+// CHECK-DAG:     memref.global "private" @rnn_state : memref<2x4xf32> = dense<0.000000e+00>
+// CHECK-DAG:     memref.global "private" @rnn_state_0 : memref<2x4xf32> = dense<0.000000e+00>
+// CHECK-LABEL:   func private @test_lstm_persistent_states
+// CHECK:           [[RES:%.+]] = memref.alloc() : memref<1x2x4xf32>
+// CHECK-NOT:       memref.alloc() : memref<2x4xf32>
+// CHECK-DAG:       [[HT:%.+]] = memref.get_global @rnn_state : memref<2x4xf32>
+// CHECK-DAG:       memref.get_global @rnn_state_0 : memref<2x4xf32>
+// CHECK:           krnl.iterate
+// CHECK:           krnl.load [[HT]]
+// CHECK:           krnl.store {{%.+}}, [[RES]]
+// CHECK:           return [[RES]] : memref<1x2x4xf32>
+}
+
+// -----
+
+/// The states given initial values by the graph are computed by each call.
+func private @test_gru_initial_state(%arg0: tensor<7x2x3xf32>, %arg1: tensor<1x12x3xf32>, %arg2: tensor<1x12x4xf32>, %arg3: tensor<1x2x4xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %Y, %Y_h = "onnx.GRU"(%arg0, %arg1, %arg2, %cst, %cst, %arg3) {hidden_size = 4 : si64} : (tensor<7x2x3xf32>, tensor<1x12x3xf32>, tensor<1x12x4xf32>, none, none, tensor<1x2x4xf32>) -> (none, tensor<*xf32>)
+  return %Y_h : tensor<*xf32>
+
+// CHECK-NOT:     memref.global
+// CHECK-LABEL:   func private @test_gru_initial_state
+// CHECK-NOT:       memref.get_global
+// CHECK:           memref.alloc() : memref<2x4xf32>
+}
+
+// -----
+
+/// The states of the bidirectional ops are computed by each call.
+func private @test_rnn_bidirectional(%arg0: tensor<7x2x3xf32>, %arg1: tensor<2x4x3xf32>, %arg2: tensor<2x4x4xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %Y, %Y_h = "onnx.RNN"(%arg0, %arg1, %arg2, %cst, %cst, %cst) {hidden_size = 4 : si64, direction = "bidirectional"} : (tensor<7x2x3xf32>, tensor<2x4x3xf32>, tensor<2x4x4xf32>, none, none, none) -> (none, tensor<*xf32>)
+  return %Y_h : tensor<*xf32>
+
+// CHECK-NOT:     memref.global
+// CHECK-LABEL:   func private @test_rnn_bidirectional
+// CHECK-NOT:       memref.get_global
+// CHECK:           memref.alloc() : memref<2x4xf32>
+}
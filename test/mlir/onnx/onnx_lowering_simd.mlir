@@ -0,0 +1,263 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl %s -split-input-file | FileCheck %s
+
+// -----
+
+func private @test_add_simd(%arg0 : tensor<10x16xf32>, %arg1 : tensor<10x16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x16xf32>, tensor<10x16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_add_simd
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x16xf32>
+  // CHECK-DAG: [[VEC_A:%.+]] = krnl.vector_type_cast %arg0 : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_B:%.+]] = krnl.vector_type_cast %arg1 : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK: [[DEF_LOOPS:%.+]]:2 = krnl.define_loops 2
+  // CHECK: krnl.iterate([[DEF_LOOPS]]#0, [[DEF_LOOPS]]#1) with ([[DEF_LOOPS]]#0 -> %arg2 = 0 to 10, [[DEF_LOOPS]]#1 -> %arg3 = 0 to 2) {
+  // CHECK: [[LOAD_A:%.+]] = krnl.load [[VEC_A]][%arg2, %arg3] : memref<10x2xvector<8xf32>>
+  // CHECK: [[LOAD_B:%.+]] = krnl.load [[VEC_B]][%arg2, %arg3] : memref<10x2xvector<8xf32>>
+  // CHECK: [[ADDF:%.+]] = addf [[LOAD_A]], [[LOAD_B]] : vector<8xf32>
+  // CHECK: krnl.store [[ADDF]], [[VEC_RES]][%arg2, %arg3] : memref<10x2xvector<8xf32>>
+  // CHECK-NOT: krnl.iterate
+  // CHECK: return [[RES]] : memref<10x16xf32>
+}
+
+// -----
+
+/// The last dimension is not a multiple of the vector length: the trailing
+/// elements of a rank one memref are computed by a scalar loop.
+func private @test_exp_simd_epilogue(%arg0 : tensor<20xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Exp"(%arg0) : (tensor<20xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_exp_simd_epilogue
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<20xf32>
+  // CHECK-DAG: [[VEC_X:%.+]] = krnl.vector_type_cast %arg0 : memref<20xf32> to memref<2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<20xf32> to memref<2xvector<8xf32>>
+  // CHECK: [[DEF_LOOPS:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.iterate([[DEF_LOOPS]]) with ([[DEF_LOOPS]] -> %arg1 = 0 to 2) {
+  // CHECK: [[LOAD:%.+]] = krnl.load [[VEC_X]][%arg1] : memref<2xvector<8xf32>>
+  // CHECK: [[EXP:%.+]] = math.exp [[LOAD]] : vector<8xf32>
+  // CHECK: krnl.store [[EXP]], [[VEC_RES]][%arg1] : memref<2xvector<8xf32>>
+  // CHECK: [[DEF_EPILOGUE:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.iterate([[DEF_EPILOGUE]]) with ([[DEF_EPILOGUE]] -> %arg1 = 16 to 20) {
+  // CHECK: [[LOAD_SCALAR:%.+]] = krnl.load %arg0[%arg1] : memref<20xf32>
+  // CHECK: [[EXP_SCALAR:%.+]] = math.exp [[LOAD_SCALAR]] : f32
+  // CHECK: krnl.store [[EXP_SCALAR]], [[RES]][%arg1] : memref<20xf32>
+  // CHECK: return [[RES]] : memref<20xf32>
+}
+
+// -----
+
+/// A broadcast row is loaded along the innermost dimension of the output,
+/// without computing broadcast indices.
+func private @test_add_broadcast_row_simd(%arg0 : tensor<10x16xf32>, %arg1 : tensor<16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x16xf32>, tensor<16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_add_broadcast_row_simd
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x16xf32>
+  // CHECK-DAG: [[VEC_A:%.+]] = krnl.vector_type_cast %arg0 : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_B:%.+]] = krnl.vector_type_cast %arg1 : memref<16xf32> to memref<2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<10x16xf32> to memref<10x2xvector<8xf32>>
+  // CHECK: [[OUTER_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[OUTER_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[OUTER_LOOP]]) with ([[OUTER_LOOP]] -> %arg2 = 0 to 10) {
+  // CHECK:   [[INNER_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK:   krnl.iterate([[INNER_LOOP]]) with ([[INNER_LOOP]] -> %arg3 = 0 to 2) {
+  // CHECK:     [[LOAD_A:%.+]] = krnl.load [[VEC_A]][%arg2, %arg3] : memref<10x2xvector<8xf32>>
+  // CHECK:     [[LOAD_B:%.+]] = krnl.load [[VEC_B]][%arg3] : memref<2xvector<8xf32>>
+  // CHECK:     [[ADDF:%.+]] = addf [[LOAD_A]], [[LOAD_B]] : vector<8xf32>
+  // CHECK:     krnl.store [[ADDF]], [[VEC_RES]][%arg2, %arg3] : memref<10x2xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<10x16xf32>
+}
+
+// -----
+
+/// A per-row scale is loaded once per row and splat into a vector.
+func private @test_mul_broadcast_scalar_per_row_simd(%arg0 : tensor<4x32xf32>, %arg1 : tensor<4x1xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Mul"(%arg0, %arg1) : (tensor<4x32xf32>, tensor<4x1xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_mul_broadcast_scalar_per_row_simd
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<4x32xf32>
+  // CHECK-DAG: [[ZERO:%.+]] = constant 0 : index
+  // CHECK-DAG: [[VEC_A:%.+]] = krnl.vector_type_cast %arg0 : memref<4x32xf32> to memref<4x4xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<4x32xf32> to memref<4x4xvector<8xf32>>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg2 = 0 to 4) {
+  // CHECK:   [[SCALE:%.+]] = krnl.load %arg1[%arg2, [[ZERO]]] : memref<4x1xf32>
+  // CHECK:   [[SPLAT:%.+]] = splat [[SCALE]] : vector<8xf32>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg3 = 0 to 4) {
+  // CHECK:     [[LOAD_A:%.+]] = krnl.load [[VEC_A]][%arg2, %arg3] : memref<4x4xvector<8xf32>>
+  // CHECK:     [[MULF:%.+]] = mulf [[LOAD_A]], [[SPLAT]] : vector<8xf32>
+  // CHECK:     krnl.store [[MULF]], [[VEC_RES]][%arg2, %arg3] : memref<4x4xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<4x32xf32>
+}
+
+// -----
+
+/// Online softmax: one pass computes the max and the sum of the exponentials
+/// of each row, a second pass normalizes it.
+func private @test_softmax_simd(%arg0 : tensor<?x16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Softmax"(%arg0) {axis=1: si64} : (tensor<?x16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_softmax_simd
+  // CHECK: [[RES:%.+]] = memref.alloc({{.*}}) : memref<?x16xf32>
+  // CHECK-DAG: [[VEC_IN:%.+]] = krnl.vector_type_cast %arg0 : memref<?x16xf32> to memref<?x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<?x16xf32> to memref<?x2xvector<8xf32>>
+  // CHECK: [[OUTER_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[OUTER_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[OUTER_LOOP]]) with ([[OUTER_LOOP]] -> %arg1 = 0 to {{.*}}) {
+  // CHECK:   [[MAX:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   [[SUM:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg2 = 0 to 2) {
+  // CHECK:     [[LOAD_X:%.+]] = krnl.load [[VEC_IN]][%arg1, %arg2] : memref<?x2xvector<8xf32>>
+  // CHECK:     math.exp {{.*}} : vector<8xf32>
+  // CHECK-NOT: math.exp
+  // CHECK:     krnl.store {{.*}}, [[MAX]][] : memref<vector<8xf32>>
+  // CHECK:   }
+  // CHECK:   [[ROW_MAX:%.+]] = vector.reduction "max", {{.*}} : vector<8xf32> into f32
+  // CHECK:   [[ROW_SUM:%.+]] = vector.reduction "add", {{.*}} : vector<8xf32> into f32
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg2 = 0 to 2) {
+  // CHECK:     math.exp {{.*}} : vector<8xf32>
+  // CHECK:     krnl.store {{.*}}, [[VEC_RES]][%arg1, %arg2] : memref<?x2xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<?x16xf32>
+}
+
+// -----
+
+/// A padded pool computes the outputs whose window lies within the input on
+/// vectors, the border outputs by the generic loop nest.
+func private @test_maxpool_pads_simd(%arg0 : tensor<1x2x10x18xf32>) -> tensor<*xf32> {
+  %0 = "onnx.MaxPoolSingleOut"(%arg0) {auto_pad = "NOTSET", kernel_shape = [3, 3], pads = [1, 1, 1, 1]} : (tensor<1x2x10x18xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_maxpool_pads_simd
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<1x2x10x18xf32>
+  // CHECK: [[INTERIOR_LOOPS:%.+]]:4 = krnl.define_loops 4
+  // CHECK: krnl.parallel [[INTERIOR_LOOPS]]#1 : !krnl.loop
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg1 = 0 to 1, {{.*}} -> %arg2 = 0 to 2, {{.*}} -> %arg3 = 1 to 9, {{.*}} -> %arg4 = 0 to 2) {
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 3, {{.*}} -> %arg6 = 0 to 3) {
+  // CHECK:     vector.transfer_read %arg0{{.*}} : memref<1x2x10x18xf32>, vector<8xf32>
+  // CHECK:   vector.transfer_write {{.*}}, [[RES]]{{.*}} : vector<8xf32>, memref<1x2x10x18xf32>
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg1 = 0 to 1, {{.*}} -> %arg2 = 0 to 2, {{.*}} -> %arg3 = 0 to 1, {{.*}} -> %arg4 = 0 to 18) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg1 = 0 to 1, {{.*}} -> %arg2 = 0 to 2, {{.*}} -> %arg3 = 9 to 10, {{.*}} -> %arg4 = 0 to 18) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg1 = 0 to 1, {{.*}} -> %arg2 = 0 to 2, {{.*}} -> %arg3 = 1 to 9, {{.*}} -> %arg4 = 0 to 1) {
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> %arg1 = 0 to 1, {{.*}} -> %arg2 = 0 to 2, {{.*}} -> %arg3 = 1 to 9, {{.*}} -> %arg4 = 17 to 18) {
+  // CHECK: return [[RES]] : memref<1x2x10x18xf32>
+}
+
+// -----
+
+/// Layer normalization: one Welford pass computes the mean and the variance
+/// of each row on vectors, a second pass normalizes it.
+func private @test_layernorm_simd(%arg0 : tensor<4x16xf32>, %arg1 : tensor<16xf32>, %arg2 : tensor<16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.FusedLayerNorm"(%arg0, %arg1, %arg2) {epsilon = 9.765625E-4 : f32} : (tensor<4x16xf32>, tensor<16xf32>, tensor<16xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_layernorm_simd
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<4x16xf32>
+  // CHECK-DAG: [[VEC_IN:%.+]] = krnl.vector_type_cast %arg0 : memref<4x16xf32> to memref<4x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<4x16xf32> to memref<4x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_SCALE:%.+]] = krnl.vector_type_cast %arg1 : memref<16xf32> to memref<2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_BIAS:%.+]] = krnl.vector_type_cast %arg2 : memref<16xf32> to memref<2xvector<8xf32>>
+  // CHECK: [[ROW_LOOP:%.+]] = krnl.define_loops 1
+  // CHECK: krnl.parallel [[ROW_LOOP]] : !krnl.loop
+  // CHECK: krnl.iterate([[ROW_LOOP]]) with ([[ROW_LOOP]] -> %arg3 = 0 to 4) {
+  // CHECK:   [[MEAN:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   [[M2:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg4 = 0 to 2) {
+  // CHECK:     [[LOAD_X:%.+]] = krnl.load [[VEC_IN]][%arg3, %arg4] : memref<4x2xvector<8xf32>>
+  // CHECK:     divf {{.*}} : vector<8xf32>
+  // CHECK:     krnl.store {{.*}}, [[MEAN]][] : memref<vector<8xf32>>
+  // CHECK:     krnl.store {{.*}}, [[M2]][] : memref<vector<8xf32>>
+  // CHECK:   }
+  // CHECK:   vector.reduction "add", {{.*}} : vector<8xf32> into f32
+  // CHECK:   vector.reduction "add", {{.*}} : vector<8xf32> into f32
+  // CHECK:   math.sqrt {{.*}} : f32
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg4 = 0 to 2) {
+  // CHECK:     krnl.load [[VEC_SCALE]][%arg4] : memref<2xvector<8xf32>>
+  // CHECK:     krnl.load [[VEC_BIAS]][%arg4] : memref<2xvector<8xf32>>
+  // CHECK:     krnl.store {{.*}}, [[VEC_RES]][%arg3, %arg4] : memref<4x2xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<4x16xf32>
+}
+
+// -----
+
+/// The 8x8 tiles are transposed in registers by shuffles.
+func private @test_transpose_simd(%arg0 : tensor<16x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Transpose"(%arg0) {perm = [1, 0]} : (tensor<16x8xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: func private @test_transpose_simd
+  // CHECK-SAME:  ([[PARAM_0_:%.+]]: memref<16x8xf32>) -> memref<8x16xf32> {
+  // CHECK:       [[RES_:%.+]] = memref.alloc() : memref<8x16xf32>
+  // CHECK-DAG:   [[VEC_IN_:%.+]] = krnl.vector_type_cast [[PARAM_0_]] : memref<16x8xf32> to memref<16x1xvector<8xf32>>
+  // CHECK-DAG:   [[VEC_RES_:%.+]] = krnl.vector_type_cast [[RES_]] : memref<8x16xf32> to memref<8x2xvector<8xf32>>
+  // CHECK:       [[LOOP_:%.+]]:2 = krnl.define_loops 2
+  // CHECK:       krnl.iterate([[LOOP_]]#0, [[LOOP_]]#1) with ([[LOOP_]]#0 -> [[I_0_:%.+]] = 0 to 2, [[LOOP_]]#1 -> [[I_1_:%.+]] = 0 to 1) {
+  // CHECK-COUNT-8: krnl.load [[VEC_IN_]]{{.}}{{.*}}, [[I_1_]]{{.}} : memref<16x1xvector<8xf32>>
+  // CHECK-COUNT-24: vector.shuffle {{.*}} : vector<8xf32>, vector<8xf32>
+  // CHECK-COUNT-8: krnl.store {{.*}}, [[VEC_RES_]]{{.}}{{.*}}, [[I_0_]]{{.}} : memref<8x2xvector<8xf32>>
+  // CHECK:       return [[RES_]] : memref<8x16xf32>
+}
+
+// -----
+
+/// The square sum slides over the channels, by vectors of pixels.
+func private @test_lrn_simd(%arg0 : tensor<1x5x2x8xf32>) -> tensor<*xf32> {
+  %0 = "onnx.LRN"(%arg0) {size = 3 : si64} : (tensor<1x5x2x8xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: func private @test_lrn_simd
+  // CHECK:       [[RES_:%.+]] = memref.alloc() : memref<1x5x2x8xf32>
+  // CHECK-DAG:   [[VEC_IN_:%.+]] = krnl.vector_type_cast %arg0 : memref<1x5x2x8xf32> to memref<1x5x2x1xvector<8xf32>>
+  // CHECK-DAG:   [[VEC_RES_:%.+]] = krnl.vector_type_cast [[RES_]] : memref<1x5x2x8xf32> to memref<1x5x2x1xvector<8xf32>>
+  // CHECK:       krnl.iterate({{.*}}) with ({{.*}} = 0 to 1, {{.*}} = 0 to 2, {{.*}} = 0 to 1) {
+  // CHECK:         [[SUM_:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} = 0 to 1) {
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} = 0 to 2) {
+  // CHECK-NOT:       subf
+  // CHECK:           math.powf {{.*}} : vector<8xf32>
+  // CHECK:           krnl.store {{.*}}, [[VEC_RES_]]{{.*}} : memref<1x5x2x1xvector<8xf32>>
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} = 2 to 4) {
+  // CHECK:           addf
+  // CHECK:           subf
+  // CHECK:         krnl.iterate({{.*}}) with ({{.*}} = 4 to 5) {
+  // CHECK-NOT:       addf {{.*}} : vector<8xf32>
+  // CHECK:           subf
+  // CHECK:       return [[RES_]] : memref<1x5x2x8xf32>
+}
+
+// -----
+
+/// Instance normalization: one Welford pass over each [n, c] slab on vectors,
+/// then one pass normalizes it.
+func private @test_instance_normalization_simd(%arg0 : tensor<2x3x4x16xf32>, %arg1 : tensor<3xf32>, %arg2 : tensor<3xf32>) -> tensor<*xf32> {
+  %0 = "onnx.InstanceNormalization"(%arg0, %arg1, %arg2) {epsilon = 9.765625E-4 : f32} : (tensor<2x3x4x16xf32>, tensor<3xf32>, tensor<3xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_instance_normalization_simd
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<2x3x4x16xf32>
+  // CHECK-DAG: [[VEC_IN:%.+]] = krnl.vector_type_cast %arg0 : memref<2x3x4x16xf32> to memref<2x3x4x2xvector<8xf32>>
+  // CHECK-DAG: [[VEC_RES:%.+]] = krnl.vector_type_cast [[RES]] : memref<2x3x4x16xf32> to memref<2x3x4x2xvector<8xf32>>
+  // CHECK: [[SLAB_LOOP:%.+]]:2 = krnl.define_loops 2
+  // CHECK: krnl.parallel [[SLAB_LOOP]]#0 : !krnl.loop
+  // CHECK: krnl.iterate([[SLAB_LOOP]]#0, [[SLAB_LOOP]]#1) with ([[SLAB_LOOP]]#0 -> %arg3 = 0 to 2, [[SLAB_LOOP]]#1 -> %arg4 = 0 to 3) {
+  // CHECK:   [[MEAN:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   [[M2:%.+]] = memref.alloca() : memref<vector<8xf32>>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 4, {{.*}} -> %arg6 = 0 to 2) {
+  // CHECK:     krnl.load [[VEC_IN]][%arg3, %arg4, %arg5, %arg6] : memref<2x3x4x2xvector<8xf32>>
+  // CHECK:     krnl.store {{.*}}, [[MEAN]][] : memref<vector<8xf32>>
+  // CHECK:     krnl.store {{.*}}, [[M2]][] : memref<vector<8xf32>>
+  // CHECK:   }
+  // CHECK:   vector.reduction "add", {{.*}} : vector<8xf32> into f32
+  // CHECK:   vector.reduction "add", {{.*}} : vector<8xf32> into f32
+  // CHECK:   math.sqrt {{.*}} : f32
+  // CHECK:   krnl.load %arg1[%arg4] : memref<3xf32>
+  // CHECK:   krnl.load %arg2[%arg4] : memref<3xf32>
+  // CHECK:   krnl.iterate({{.*}}) with ({{.*}} -> %arg5 = 0 to 4, {{.*}} -> %arg6 = 0 to 2) {
+  // CHECK:     krnl.load [[VEC_IN]][%arg3, %arg4, %arg5, %arg6] : memref<2x3x4x2xvector<8xf32>>
+  // CHECK:     krnl.store {{.*}}, [[VEC_RES]][%arg3, %arg4, %arg5, %arg6] : memref<2x3x4x2xvector<8xf32>>
+  // CHECK: return [[RES]] : memref<2x3x4x16xf32>
+}
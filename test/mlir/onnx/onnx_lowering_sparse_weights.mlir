@@ -0,0 +1,69 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='sparse-weights-min-zeros=50' %s -split-input-file | FileCheck %s
+
+// -----
+
+/// Constant B matrices with enough zeros are encoded as CSR matrices at
+/// compile time, transposed, and multiplied with their nonzero elements only.
+func private @test_gemm_sparse_constant(%arg0 : tensor<4x2xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[1.0, 0.0], [0.0, 0.0], [0.0, 2.0]]> : tensor<3x2xf32>} : () -> tensor<3x2xf32>
+  %cst = constant unit
+  %1 = "onnx.Gemm"(%arg0, %0, %cst) {transB = 1 : si64} : (tensor<4x2xf32>, tensor<3x2xf32>, none) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_gemm_sparse_constant
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<4x3xf32>
+  // CHECK: krnl.store {{.*}}, [[RES]]
+  // CHECK: [[OFFSETS:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "sparse_row_offsets_{{[0-9]+}}", shape = [3], value = dense<[0, 1, 2]> : tensor<3xi32>} : () -> memref<3xi32>
+  // CHECK: [[COLUMNS:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "sparse_columns_{{[0-9]+}}", shape = [2], value = dense<[0, 2]> : tensor<2xi32>} : () -> memref<2xi32>
+  // CHECK: [[VALUES:%.+]] = "krnl.global"() {alignment = 128 : i64, name = "sparse_values_{{[0-9]+}}", shape = [2], value = dense<[1.000000e+00, 2.000000e+00]> : tensor<2xf32>} : () -> memref<2xf32>
+  // CHECK: krnl.parallel
+  // CHECK: krnl.iterate({{.*}}) with ({{.*}} -> [[I:%.+]] = 0 to 4, {{.*}} -> [[K:%.+]] = 0 to 2) {
+  // CHECK: [[A:%.+]] = krnl.load %arg0{{.}}[[I]], [[K]]{{.}} : memref<4x2xf32>
+  // CHECK: [[BEGIN:%.+]] = krnl.load [[OFFSETS]]{{.}}[[K]]{{.}} : memref<3xi32>
+  // CHECK: [[BEGIN_INDEX:%.+]] = index_cast [[BEGIN]] : i32 to index
+  // CHECK: [[END:%.+]] = krnl.load [[OFFSETS]]
+  // CHECK: [[END_INDEX:%.+]] = index_cast [[END]] : i32 to index
+  // CHECK: scf.for [[P:%.+]] = [[BEGIN_INDEX]] to [[END_INDEX]] step {{.*}} {
+  // CHECK: [[J:%.+]] = krnl.load [[COLUMNS]]{{.}}[[P]]{{.}} : memref<2xi32>
+  // CHECK: [[J_INDEX:%.+]] = index_cast [[J]] : i32 to index
+  // CHECK: [[B:%.+]] = krnl.load [[VALUES]]{{.}}[[P]]{{.}} : memref<2xf32>
+  // CHECK: [[C:%.+]] = krnl.load [[RES]]{{.}}[[I]], [[J_INDEX]]{{.}} : memref<4x3xf32>
+  // CHECK: [[PROD:%.+]] = mulf [[A]], [[B]] : f32
+  // CHECK: [[SUM:%.+]] = addf [[C]], [[PROD]] : f32
+  // CHECK: krnl.store [[SUM]], [[RES]]{{.}}[[I]], [[J_INDEX]]{{.}} : memref<4x3xf32>
+  // CHECK-NOT: krnl.matmul
+}
+
+// -----
+
+/// Constant B matrices shared by all the batches are encoded once, the
+/// matrix multiplies of the batches being parallel.
+func private @test_matmul_sparse_constant(%arg0 : tensor<?x4x2xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[0.0, 3.0, 0.0], [0.0, 0.0, 0.0]]> : tensor<2x3xf32>} : () -> tensor<2x3xf32>
+  %1 ="onnx.MatMul"(%arg0, %0) : (tensor<?x4x2xf32>, tensor<2x3xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_sparse_constant
+  // CHECK: "krnl.global"() {alignment = 128 : i64, name = "sparse_row_offsets_{{[0-9]+}}", shape = [3], value = dense<[0, 1, 1]> : tensor<3xi32>}
+  // CHECK: "krnl.global"() {alignment = 128 : i64, name = "sparse_columns_{{[0-9]+}}", shape = [1], value = dense<1> : tensor<1xi32>}
+  // CHECK: "krnl.global"() {alignment = 128 : i64, name = "sparse_values_{{[0-9]+}}", shape = [1], value = dense<3.000000e+00> : tensor<1xf32>}
+  // CHECK: krnl.parallel
+  // CHECK: krnl.iterate
+  // CHECK: krnl.load %arg0{{.}}{{%.+}}, {{%.+}}, {{%.+}}{{.}} : memref<?x4x2xf32>
+  // CHECK: scf.for
+  // CHECK-NOT: krnl.matmul
+}
+
+// -----
+
+/// The constant B matrices with fewer zeros stay dense.
+func private @test_matmul_dense_constant(%arg0 : tensor<4x2xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() {value = dense<[[0.0, 1.0], [2.0, 3.0]]> : tensor<2x2xf32>} : () -> tensor<2x2xf32>
+  %1 ="onnx.MatMul"(%arg0, %0) : (tensor<4x2xf32>, tensor<2x2xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_matmul_dense_constant
+  // CHECK-NOT: sparse_
+  // CHECK-NOT: scf.for
+  // CHECK: krnl.matmul
+}
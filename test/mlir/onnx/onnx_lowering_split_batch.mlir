@@ -0,0 +1,62 @@
+// RUN: onnx-mlir-opt --convert-onnx-to-krnl='split-batch' %s -split-input-file | FileCheck %s
+
+/// The rows of an MLP are computed independently, the entry point is run in
+/// chunks of its batch.
+func @main_graph(%arg0: tensor<?x4xf32>) -> tensor<?x3xf32> {
+  %0 = "onnx.Constant"() {value = dense<1.0> : tensor<4x3xf32>} : () -> tensor<4x3xf32>
+  %1 = "onnx.Constant"() {value = dense<0.0> : tensor<3xf32>} : () -> tensor<3xf32>
+  %2 = "onnx.Gemm"(%arg0, %0, %1) : (tensor<?x4xf32>, tensor<4x3xf32>, tensor<3xf32>) -> tensor<?x3xf32>
+  %3 = "onnx.Relu"(%2) : (tensor<?x3xf32>) -> tensor<?x3xf32>
+  %4 = "onnx.Softmax"(%3) {axis = 1 : si64} : (tensor<?x3xf32>) -> tensor<?x3xf32>
+  return %4 : tensor<?x3xf32>
+}
+"onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = ""} : () -> ()
+
+// CHECK: "krnl.entry_point"() {batchSeparable, func = @main_graph
+
+// -----
+
+/// A reduction over the batch mixes its rows.
+func @main_graph(%arg0: tensor<?x4xf32>) -> tensor<1x4xf32> {
+  %0 = "onnx.ReduceMean"(%arg0) {axes = [0]} : (tensor<?x4xf32>) -> tensor<1x4xf32>
+  return %0 : tensor<1x4xf32>
+}
+"onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = ""} : () -> ()
+
+// CHECK-NOT: batchSeparable
+// CHECK: "krnl.entry_point"() {func = @main_graph
+
+// -----
+
+/// A transpose moves the batch to another dimension.
+func @main_graph(%arg0: tensor<?x4xf32>) -> tensor<4x?xf32> {
+  %0 = "onnx.Transpose"(%arg0) {perm = [1, 0]} : (tensor<?x4xf32>) -> tensor<4x?xf32>
+  return %0 : tensor<4x?xf32>
+}
+"onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = ""} : () -> ()
+
+// CHECK-NOT: batchSeparable
+// CHECK: "krnl.entry_point"() {func = @main_graph
+
+// -----
+
+/// A flatten at axis 1 keeps the batch as the first dimension.
+func @main_graph(%arg0: tensor<?x2x3xf32>) -> tensor<?x6xf32> {
+  %0 = "onnx.Flatten"(%arg0) {axis = 1 : si64} : (tensor<?x2x3xf32>) -> tensor<?x6xf32>
+  return %0 : tensor<?x6xf32>
+}
+"onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = ""} : () -> ()
+
+// CHECK: "krnl.entry_point"() {batchSeparable, func = @main_graph
+
+// -----
+
+/// A flatten at axis 2 merges the batch with the next dimension.
+func @main_graph(%arg0: tensor<?x2x3xf32>) -> tensor<?x3xf32> {
+  %0 = "onnx.Flatten"(%arg0) {axis = 2 : si64} : (tensor<?x2x3xf32>) -> tensor<?x3xf32>
+  return %0 : tensor<?x3xf32>
+}
+"onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = ""} : () -> ()
+
+// CHECK-NOT: batchSeparable
+// CHECK: "krnl.entry_point"() {func = @main_graph
@@ -0,0 +1,77 @@
+// RUN: onnx-mlir-opt --shape-inference --convert-onnx-to-krnl='fuse-store-epilogues' %s -split-input-file | FileCheck %s
+
+// -----
+
+func @test_add_relu(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+  /// The Relu is applied by the Add, into the returned buffer.
+  // CHECK-LABEL: test_add_relu
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK-NOT: memref.alloc
+  // CHECK: krnl.iterate
+  // CHECK: [[ADDF:%.+]] = addf {{.*}} : f32
+  // CHECK: [[ZERO:%.+]] = constant 0.000000e+00 : f32
+  // CHECK: [[LT:%.+]] = cmpf olt, [[ADDF]], [[ZERO]] : f32
+  // CHECK: [[RELU:%.+]] = select [[LT]], [[ZERO]], [[ADDF]] : f32
+  // CHECK: krnl.store [[RELU]], [[RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK-NOT: krnl.iterate
+  // CHECK-NOT: memref.dealloc
+  // CHECK: return [[RES]] : memref<10x10xf32>
+}
+
+// -----
+
+func @test_sub_clip_add(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Sub"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %min = "onnx.Constant"() {value = dense<0.0> : tensor<f32>} : () -> tensor<f32>
+  %max = "onnx.Constant"() {value = dense<6.0> : tensor<f32>} : () -> tensor<f32>
+  %1 = "onnx.Clip"(%0, %min, %max) : (tensor<*xf32>, tensor<f32>, tensor<f32>) -> tensor<*xf32>
+  %2 = "onnx.Add"(%1, %arg1) : (tensor<*xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  /// The Clip is applied by the Sub, whose buffer is freed after the Add.
+  // CHECK-LABEL: test_sub_clip_add
+  // CHECK: [[RET_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: [[RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK-NOT: memref.alloc
+  // CHECK: krnl.iterate
+  // CHECK: [[SUBF:%.+]] = subf {{.*}} : f32
+  // CHECK: [[MIN:%.+]] = constant 0.000000e+00 : f32
+  // CHECK: [[LT_MIN:%.+]] = cmpf olt, [[SUBF]], [[MIN]] : f32
+  // CHECK: [[CLIP_MIN:%.+]] = select [[LT_MIN]], [[MIN]], [[SUBF]] : f32
+  // CHECK: [[MAX:%.+]] = constant 6.000000e+00 : f32
+  // CHECK: [[LT_MAX:%.+]] = cmpf olt, [[CLIP_MIN]], [[MAX]] : f32
+  // CHECK: [[CLIP:%.+]] = select [[LT_MAX]], [[CLIP_MIN]], [[MAX]] : f32
+  // CHECK: krnl.store [[CLIP]], [[RES]][%arg2, %arg3] : memref<10x10xf32>
+
+  /// The Add reads the clipped values.
+  // CHECK: krnl.iterate
+  // CHECK: [[LOAD:%.+]] = krnl.load [[RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[RET_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK-NOT: krnl.iterate
+  // CHECK: memref.dealloc [[RES]] : memref<10x10xf32>
+  // CHECK: return [[RET_RES]] : memref<10x10xf32>
+}
+
+// -----
+
+func @test_add_relu_live_operand(%arg0 : tensor<10x10xf32>, %arg1 : tensor<10x10xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Add"(%arg0, %arg1) : (tensor<10x10xf32>, tensor<10x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  %2 = "onnx.Add"(%1, %0) : (tensor<*xf32>, tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  /// The result of the first Add is used after the Relu, so the Relu keeps
+  /// its own loop nest and buffer.
+  // CHECK-LABEL: test_add_relu_live_operand
+  // CHECK: [[RET_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: [[RELU_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: [[ADD_RES:%.+]] = memref.alloc() : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[ADD_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.load [[ADD_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[RELU_RES]][%arg2, %arg3] : memref<10x10xf32>
+  // CHECK: krnl.store {{.*}}, [[RET_RES]][%arg2, %arg3] : memref<10x10xf32>
+}
@@ -178,6 +178,51 @@ func @dyntest_slice_constant_dynshape_not_spliced(%arg0 : tensor<?x4x5xf32>) ->
 
 // -----
 
+// Slice with unit steps whose result is not returned, a view of the data.
+func @test_slice_view(%arg0 : tensor<8x16xf32>) -> tensor<*xf32> {
+  %axes = "onnx.Constant"() {value = dense<[0]> : tensor<1xi64> } : () -> tensor<1xi64>
+  %starts = "onnx.Constant"() {value = dense<[2]> : tensor<1xi64> } : () -> tensor<1xi64>
+  %ends = "onnx.Constant"() {value = dense<[6]> : tensor<1xi64> } : () -> tensor<1xi64>
+  %steps = "onnx.Constant"() {value = dense<[1]> : tensor<1xi64> } : () -> tensor<1xi64>
+  %0 = "onnx.Slice"(%arg0, %starts, %ends, %axes, %steps) : (tensor<8x16xf32>, tensor<1xi64>, tensor<1xi64>, tensor<1xi64>, tensor<1xi64>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<*xf32>) -> tensor<*xf32>
+  "std.return"(%1) : (tensor<*xf32>) -> ()
+
+// CHECK-LABEL:  func @test_slice_view
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<8x16xf32>) -> memref<4x16xf32> {
+// CHECK:           [[VIEW_:%.+]] = memref.subview [[PARAM_0_]][2, 0] [4, 16] [1, 1] : memref<8x16xf32> to memref<4x16xf32, #{{.*}}>
+// CHECK-NOT:       krnl.store {{.*}}, [[VIEW_]]
+// CHECK:           krnl.load [[VIEW_]]{{.}}{{.*}}{{.}} : memref<4x16xf32, #{{.*}}>
+}
+
+// -----
+
+// Slice with a unit step along the innermost dimension, whose rows are copied
+// by a memcpy.
+func @test_slice_copy_rows(%arg0 : tensor<8x32xf32>) -> tensor<*xf32> {
+  %axes = constant unit
+  %starts = "onnx.Constant"() {value = dense<[0, 4]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %ends = "onnx.Constant"() {value = dense<[8, 28]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %steps = "onnx.Constant"() {value = dense<[2, 1]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %0 = "onnx.Slice"(%arg0, %starts, %ends, %axes, %steps) : (tensor<8x32xf32>, tensor<2xi64>, tensor<2xi64>, none, tensor<2xi64>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+// CHECK-LABEL:  func @test_slice_copy_rows
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<8x32xf32>) -> memref<4x24xf32> {
+// CHECK-DAG:       [[CST_96_:%.+]] = constant 96 : i64
+// CHECK-DAG:       [[RES_:%.+]] = memref.alloc() : memref<4x24xf32>
+// CHECK-DAG:       [[LOOP_0_:%.+]] = krnl.define_loops 1
+// CHECK:           krnl.iterate([[LOOP_0_]]) with ([[LOOP_0_]] -> [[I_0_:%.+]] = 0 to 4) {
+// CHECK:             [[VAR_ROW_:%.+]] = affine.apply #{{.*}}([[I_0_]])
+// CHECK-DAG:         [[SRC_:%.+]] = memref.subview [[PARAM_0_]]{{.}}[[VAR_ROW_]], 4] [1, 24] [1, 1] : memref<8x32xf32> to memref<1x24xf32, #{{.*}}>
+// CHECK-DAG:         [[DST_:%.+]] = memref.subview [[RES_]]{{.}}[[I_0_]], 0] [1, 24] [1, 1] : memref<4x24xf32> to memref<1x24xf32, #{{.*}}>
+// CHECK:             "krnl.memcpy"([[DST_]], [[SRC_]], [[CST_96_]]) : (memref<1x24xf32, #{{.*}}>, memref<1x24xf32, #{{.*}}>, i64) -> ()
+// CHECK:           }
+// CHECK:           return [[RES_]] : memref<4x24xf32>
+}
+
+// -----
+
 // Check where all is dynamic except input size and axis. The code was verified
 // using a procedure simioar to mlir-run and by manually adding code to print the
 // output as a vector
@@ -351,6 +396,26 @@ func @test_gemm_c_dyn(%arg0 : tensor<5x10xf32>, %arg1 : tensor<5x10xf32>, %arg2:
 
 // -----
 
+// Gemm fused with a Relu, applied together with alpha and beta on the result.
+func @test_fused_gemm_relu(%arg0 : tensor<5x10xf32>, %arg1 : tensor<5x10xf32>, %arg2: tensor<10xf32>) -> tensor<*xf32> {
+  %0 ="onnx.FusedGemm"(%arg0, %arg1, %arg2) {activation = "Relu", alpha = 1.0 : f32, beta = 5.0 : f32, transA = 1 : si64, transB = 0 : si64} : (tensor<5x10xf32>, tensor<5x10xf32>, tensor<10xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+// CHECK-LABEL:  func @test_fused_gemm_relu
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<5x10xf32>, [[PARAM_1_:%.+]]: memref<5x10xf32>, [[PARAM_2_:%.+]]: memref<10xf32>) -> memref<10x10xf32> {
+// CHECK:           krnl.matmul
+// CHECK:           krnl.iterate
+// CHECK:             [[LOAD_RES_MEM_:%.+]] = krnl.load [[RES_:%.+]]{{.}}[[I_0_:%.+]], [[I_1_:%.+]]{{.}} : memref<10x10xf32>
+// CHECK:             [[LOAD_PARAM_2_MEM_:%.+]] = krnl.load [[PARAM_2_]]{{.}}[[I_1_]]{{.}} : memref<10xf32>
+// CHECK:             [[VAR_C_:%.+]] = mulf {{.*}}, [[LOAD_PARAM_2_MEM_]] : f32
+// CHECK:             [[VAR_SUM_:%.+]] = addf [[LOAD_RES_MEM_]], [[VAR_C_]] : f32
+// CHECK:             [[VAR_LT_:%.+]] = cmpf olt, [[VAR_SUM_]], {{.*}} : f32
+// CHECK:             [[VAR_RELU_:%.+]] = select [[VAR_LT_]], {{.*}}, [[VAR_SUM_]] : f32
+// CHECK:             krnl.store [[VAR_RELU_]], [[RES_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<10x10xf32>
+}
+
+// -----
+
 // Test tile with constant repeats
 func @test_tile1(%arg0 : tensor<4x8xf32>) -> tensor<*xf32> {
   %0 = "onnx.Constant"() { value = dense<[3, 2]> : tensor<2xi64>} : () -> tensor<2xi64>
@@ -397,6 +462,34 @@ func @test_tile2(%arg0 : tensor<8xf32>, %arg1 : tensor<1xi64>) -> tensor<*xf32>
 
 // -----
 
+// Test tile with static shapes, whose rows are copied by memcpys and then
+// replicated by doubling copies.
+func @test_tile_block_copies(%arg0 : tensor<2x16xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Constant"() { value = dense<[3, 2]> : tensor<2xi64>} : () -> tensor<2xi64>
+  %1 = "onnx.Tile"(%arg0, %0) : (tensor<2x16xf32>, tensor<2xi64>) -> tensor<*xf32>
+  return %1 : tensor<*xf32>
+
+// CHECK-LABEL:  func @test_tile_block_copies
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<2x16xf32>) -> memref<6x32xf32> {
+// CHECK-DAG:       [[CST_64_:%.+]] = constant 64 : i64
+// CHECK-DAG:       [[CST_256_:%.+]] = constant 256 : i64
+// CHECK-DAG:       [[RES_:%.+]] = memref.alloc() : memref<6x32xf32>
+// CHECK-DAG:       [[IN_:%.+]] = memref.reinterpret_cast [[PARAM_0_]] to offset: [0], sizes: [32], strides: [1] : memref<2x16xf32> to memref<32xf32>
+// CHECK-DAG:       [[OUT_:%.+]] = memref.reinterpret_cast [[RES_]] to offset: [0], sizes: [192], strides: [1] : memref<6x32xf32> to memref<192xf32>
+// CHECK:           krnl.iterate
+// CHECK:             "krnl.memcpy"({{.*}}, {{.*}}, [[CST_64_]]) : (memref<16xf32, #{{.*}}>, memref<16xf32, #{{.*}}>, i64) -> ()
+// CHECK:           krnl.iterate
+// CHECK:             "krnl.memcpy"({{.*}}, {{.*}}, [[CST_64_]]) : (memref<16xf32, #{{.*}}>, memref<16xf32, #{{.*}}>, i64) -> ()
+// CHECK-DAG:       [[DST_0_:%.+]] = memref.subview [[OUT_]][64] [64] [1] : memref<192xf32> to memref<64xf32, #{{.*}}>
+// CHECK-DAG:       [[SRC_0_:%.+]] = memref.subview [[OUT_]][0] [64] [1] : memref<192xf32> to memref<64xf32, #{{.*}}>
+// CHECK:           "krnl.memcpy"([[DST_0_]], [[SRC_0_]], [[CST_256_]])
+// CHECK-DAG:       [[DST_1_:%.+]] = memref.subview [[OUT_]][128] [64] [1] : memref<192xf32> to memref<64xf32, #{{.*}}>
+// CHECK:           "krnl.memcpy"([[DST_1_]], {{.*}}, [[CST_256_]])
+// CHECK:           return [[RES_]] : memref<6x32xf32>
+}
+
+// -----
+
 // Test gather along axis 0, first example in ONNX for Gather. Positive indices, so no select.
 func @test_gather_axis0(%arg0 : tensor<3x2xf32>) -> tensor<2x2x2xf32> {
   %indices = "onnx.Constant"() {value = dense<[[0, 1], [1, 2]]> : tensor<2x2xi64>} : () -> tensor<2x2xi64>
@@ -471,6 +564,31 @@ func @test_gather_axis1(%arg0 : tensor<3x3xf32>) -> tensor<3x1x2xf32> {
 
 // -----
 
+// Test gather of the rows of an embedding table, copied by a memcpy per row.
+func @test_gather_embedding(%arg0 : tensor<1000x64xf32>, %arg1 : tensor<4x8xi64>) -> tensor<4x8x64xf32> {
+  %0 = "onnx.Gather"(%arg0, %arg1) {axis = 0 : si64} : (tensor<1000x64xf32>, tensor<4x8xi64>) -> tensor<4x8x64xf32>
+  "std.return"(%0) : (tensor<4x8x64xf32>) -> ()
+
+// CHECK-LABEL:  func @test_gather_embedding
+// CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<1000x64xf32>, [[PARAM_1_:%.+]]: memref<4x8xi64>) -> memref<4x8x64xf32> {
+// CHECK-DAG:       [[RES_:%.+]] = memref.alloc() : memref<4x8x64xf32>
+// CHECK-DAG:       [[LOOP_0_:%.+]]:2 = krnl.define_loops 2
+// CHECK:           krnl.parallel [[LOOP_0_]]#0 : !krnl.loop
+// CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to 4, [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 8) {
+// CHECK:             [[LOAD_PARAM_1_MEM_:%.+]] = krnl.load [[PARAM_1_]]{{.}}[[I_0_]], [[I_1_]]{{.}} : memref<4x8xi64>
+// CHECK:             [[VAR_INDEX_:%.+]] = select {{.*}} : index
+// CHECK-DAG:         [[DATA_ROW_:%.+]] = memref.subview [[PARAM_0_]]{{.}}[[VAR_INDEX_]], 0] [1, 64] [1, 1] : memref<1000x64xf32> to memref<64xf32, #{{.*}}>
+// CHECK-DAG:         [[RES_ROW_:%.+]] = memref.subview [[RES_]]{{.}}[[I_0_]], [[I_1_]], 0] [1, 1, 64] [1, 1, 1] : memref<4x8x64xf32> to memref<64xf32, #{{.*}}>
+// CHECK-DAG:         [[SIZE_:%.+]] = constant 256 : i64
+// CHECK:             "krnl.memcpy"([[RES_ROW_]], [[DATA_ROW_]], [[SIZE_]]) : (memref<64xf32, #{{.*}}>, memref<64xf32, #{{.*}}>, i64) -> ()
+// CHECK-NOT:         krnl.store
+// CHECK:           }
+// CHECK:           return [[RES_]] : memref<4x8x64xf32>
+// CHECK:         }
+}
+
+// -----
+
 // COM: test split with unknown dimensions and explicit split.
 func @test_split_unknown_dimension(%arg0 : tensor<?x?x64xf32>) -> (tensor<*xf32>, tensor<*xf32>) {
   %0, %1 = "onnx.Split"(%arg0) { axis = 1 : si64, split = [2, 30]} : (tensor<?x?x64xf32>) -> (tensor<*xf32>, tensor<*xf32>)
@@ -478,22 +596,19 @@ func @test_split_unknown_dimension(%arg0 : tensor<?x?x64xf32>) -> (tensor<*xf32>
 
 // CHECK-LABEL:  func @test_split_unknown_dimension
 // CHECK-SAME:   ([[PARAM_0_:%.+]]: memref<?x?x64xf32>) -> (memref<?x2x64xf32>, memref<?x30x64xf32>) {
-// CHECK:           [[CST_0_:%.+]] = constant 0 : index
-// CHECK-DAG:       [[DIM_0_:%.+]] = memref.dim [[PARAM_0_]], [[CST_0_]] : memref<?x?x64xf32>
-// CHECK-DAG:       [[DIM_1_:%.+]] = memref.dim [[PARAM_0_]], [[CST_0_]] : memref<?x?x64xf32>
-// CHECK-NOT: separator of consecutive DAGs
-// CHECK-DAG:       [[RES_:%.+]] = memref.alloc([[DIM_0_]]) : memref<?x2x64xf32>
-// CHECK-DAG:       [[RES_1_:%.+]] = memref.alloc([[DIM_1_]]) : memref<?x30x64xf32>
-// CHECK-DAG:       [[LOOP_0_:%.+]]:3 = krnl.define_loops 3
-// CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[LOOP_0_]]#2) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to [[DIM_0_]], [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 2, [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 64) {
-// CHECK:             [[LOAD_PARAM_0_MEM_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[I_0_]], [[I_1_]], [[I_2_]]{{.}} : memref<?x?x64xf32>
-// CHECK:             krnl.store [[LOAD_PARAM_0_MEM_]], [[RES_]]{{.}}[[I_0_]], [[I_1_]], [[I_2_]]{{.}} : memref<?x2x64xf32>
+// CHECK-DAG:       [[RES_:%.+]] = memref.alloc({{.*}}) : memref<?x2x64xf32>
+// CHECK-DAG:       [[RES_1_:%.+]] = memref.alloc({{.*}}) : memref<?x30x64xf32>
+// CHECK:           [[LOOP_0_:%.+]] = krnl.define_loops 1
+// CHECK:           krnl.iterate([[LOOP_0_]]) with ([[LOOP_0_]] -> [[I_0_:%.+]] = 0 to {{.*}}) {
+// CHECK-DAG:         [[SRC_0_:%.+]] = memref.subview [[PARAM_0_]]{{.}}[[I_0_]], 0, 0] [1, 2, 64] [1, 1, 1]
+// CHECK-DAG:         [[DST_0_:%.+]] = memref.subview [[RES_]]{{.}}[[I_0_]], 0, 0] [1, 2, 64] [1, 1, 1]
+// CHECK:             "krnl.memcpy"([[DST_0_]], [[SRC_0_]], {{.*}})
 // CHECK:           }
-// CHECK:           [[LOOP_1_:%.+]]:3 = krnl.define_loops 3
-// CHECK:           krnl.iterate([[LOOP_1_]]#0, [[LOOP_1_]]#1, [[LOOP_1_]]#2) with ([[LOOP_1_]]#0 -> [[I_3_:%.+]] = 0 to [[DIM_1_]], [[LOOP_1_]]#1 -> [[I_4_:%.+]] = 0 to 30, [[LOOP_1_]]#2 -> [[I_5_:%.+]] = 0 to 64) {
-// CHECK:             [[LOAD_PARAM_0_MEM_1_:%.+]] = affine.apply #map([[I_4_]])
-// CHECK:             [[LOAD_PARAM_0_MEM_2_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[I_3_]], [[LOAD_PARAM_0_MEM_1_]], [[I_5_]]{{.}} : memref<?x?x64xf32>
-// CHECK:             krnl.store [[LOAD_PARAM_0_MEM_2_]], [[RES_1_]]{{.}}[[I_3_]], [[I_4_]], [[I_5_]]{{.}} : memref<?x30x64xf32>
+// CHECK:           [[LOOP_1_:%.+]] = krnl.define_loops 1
+// CHECK:           krnl.iterate([[LOOP_1_]]) with ([[LOOP_1_]] -> [[I_1_:%.+]] = 0 to {{.*}}) {
+// CHECK-DAG:         [[SRC_1_:%.+]] = memref.subview [[PARAM_0_]]{{.}}[[I_1_]], 2, 0] [1, 30, 64] [1, 1, 1]
+// CHECK-DAG:         [[DST_1_:%.+]] = memref.subview [[RES_1_]]{{.}}[[I_1_]], 0, 0] [1, 30, 64] [1, 1, 1]
+// CHECK:             "krnl.memcpy"([[DST_1_]], [[SRC_1_]], {{.*}})
 // CHECK:           }
 // CHECK:           return [[RES_]], [[RES_1_]] : memref<?x2x64xf32>, memref<?x30x64xf32>
 // CHECK:         }
@@ -583,10 +698,10 @@ func @test_binary_elementwise_op_template_unknown_dims(%arg0: tensor<?x4x5xf32>,
 // CHECK:           [[VAR_2_:%.+]] = affine.max #map(){{.}}[[DIM_0_]]{{.}}
 // CHECK-DAG:       [[RES_:%.+]] = memref.alloc([[VAR_2_]]) : memref<?x4x5xi1>
 // CHECK-DAG:       [[LOOP_0_:%.+]]:3 = krnl.define_loops 3
+// CHECK-DAG:       [[VAR_5_:%.+]] = cmpi sgt, [[DIM_1_]], [[CST_1_]] : index
 // CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[LOOP_0_]]#2) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to [[VAR_2_]], [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 4, [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 5) {
 // CHECK-DAG:         [[LOAD_PARAM_0_MEM_:%.+]] = krnl.load [[PARAM_0_]]{{\[}}[[I_0_]], [[I_1_]], [[I_2_]]] : memref<?x4x5xf32>
-// CHECK-DAG:         [[VAR_6_:%.+]] = cmpi sgt, [[DIM_1_]], [[CST_1_]] : index
-// CHECK:             [[VAR_7_:%.+]] = select [[VAR_6_]], [[I_1_]], [[CST_0_]] : index
+// CHECK-DAG:         [[VAR_7_:%.+]] = select [[VAR_5_]], [[I_1_]], [[CST_0_]] : index
 // CHECK:             [[LOAD_PARAM_1_MEM_:%.+]] = krnl.load [[PARAM_1_]]{{.}}[[CST_0_]], [[VAR_7_]], [[CST_0_]]{{.}} : memref<1x?x1xf32>
 // CHECK:             [[VAR_9_:%.+]] = cmpf olt, [[LOAD_PARAM_0_MEM_]], [[LOAD_PARAM_1_MEM_]] : f32
 // CHECK:             krnl.store [[VAR_9_]], [[RES_]]{{\[}}[[I_0_]], [[I_1_]], [[I_2_]]{{\]}} : memref<?x4x5xi1>
@@ -613,20 +728,19 @@ func @test_variadic_elementwise_op_template_unknown_dims(%arg0: tensor<?x4x1xf32
 // CHECK:           [[VAR_4_:%.+]] = affine.max #map(){{.}}[[DIM_0_]], [[DIM_1_]]{{.}}
 // CHECK-DAG:       [[RES_:%.+]] = memref.alloc([[VAR_4_]]) : memref<?x4x5xf32>
 // CHECK-DAG:       [[LOOP_0_:%.+]]:3 = krnl.define_loops 3
+// CHECK-DAG:       [[VAR_7_:%.+]] = cmpi sgt, [[DIM_0_]], [[CST_1_]] : index
+// CHECK-DAG:       [[VAR_8_:%.+]] = cmpi sgt, [[DIM_1_]], [[CST_1_]] : index
+// CHECK-DAG:       [[VAR_9_:%.+]] = cmpi sgt, [[DIM_2_]], [[CST_1_]] : index
+// CHECK-DAG:       [[VAR_10_:%.+]] = cmpi sgt, [[DIM_3_]], [[CST_1_]] : index
 // CHECK:           krnl.iterate([[LOOP_0_]]#0, [[LOOP_0_]]#1, [[LOOP_0_]]#2) with ([[LOOP_0_]]#0 -> [[I_0_:%.+]] = 0 to [[VAR_4_]], [[LOOP_0_]]#1 -> [[I_1_:%.+]] = 0 to 4, [[LOOP_0_]]#2 -> [[I_2_:%.+]] = 0 to 5) {
-// CHECK:             [[VAR_7_:%.+]] = cmpi sgt, [[DIM_0_]], [[CST_1_]] : index
-// CHECK:             [[VAR_8_:%.+]] = select [[VAR_7_]], [[I_0_]], [[CST_0_]] : index
-// CHECK-DAG:         [[LOAD_PARAM_0_MEM_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[VAR_8_]], [[I_1_]], [[CST_0_]]{{.}} : memref<?x4x1xf32>
-// CHECK-DAG:         [[VAR_10_:%.+]] = cmpi sgt, [[DIM_1_]], [[CST_1_]] : index
-// CHECK-NOT: separator of consecutive DAGs
-// CHECK-DAG:         [[VAR_11_:%.+]] = select [[VAR_10_]], [[I_0_]], [[CST_0_]] : index
-// CHECK-DAG:         [[VAR_12_:%.+]] = cmpi sgt, [[DIM_2_]], [[CST_1_]] : index
-// CHECK:             [[VAR_13_:%.+]] = select [[VAR_12_]], [[I_1_]], [[CST_0_]] : index
-// CHECK:             [[LOAD_PARAM_1_MEM_:%.+]] = krnl.load [[PARAM_1_]]{{.}}[[VAR_11_]], [[VAR_13_]], [[I_2_]]{{.}} : memref<?x?x5xf32>
+// CHECK:             [[VAR_11_:%.+]] = select [[VAR_7_]], [[I_0_]], [[CST_0_]] : index
+// CHECK-DAG:         [[LOAD_PARAM_0_MEM_:%.+]] = krnl.load [[PARAM_0_]]{{.}}[[VAR_11_]], [[I_1_]], [[CST_0_]]{{.}} : memref<?x4x1xf32>
+// CHECK-DAG:         [[VAR_12_:%.+]] = select [[VAR_8_]], [[I_0_]], [[CST_0_]] : index
+// CHECK-DAG:         [[VAR_13_:%.+]] = select [[VAR_9_]], [[I_1_]], [[CST_0_]] : index
+// CHECK:             [[LOAD_PARAM_1_MEM_:%.+]] = krnl.load [[PARAM_1_]]{{.}}[[VAR_12_]], [[VAR_13_]], [[I_2_]]{{.}} : memref<?x?x5xf32>
 // CHECK:             [[VAR_15_:%.+]] = cmpf ogt, [[LOAD_PARAM_0_MEM_]], [[LOAD_PARAM_1_MEM_]] : f32
 // CHECK-DAG:         [[VAR_16_:%.+]] = select [[VAR_15_]], [[LOAD_PARAM_0_MEM_]], [[LOAD_PARAM_1_MEM_]] : f32
-// CHECK-DAG:         [[VAR_17_:%.+]] = cmpi sgt, [[DIM_3_]], [[CST_1_]] : index
-// CHECK:             [[VAR_18_:%.+]] = select [[VAR_17_]], [[I_0_]], [[CST_0_]] : index
+// CHECK-DAG:         [[VAR_18_:%.+]] = select [[VAR_10_]], [[I_0_]], [[CST_0_]] : index
 // CHECK:             [[LOAD_PARAM_2_MEM_:%.+]] = krnl.load [[PARAM_2_]]{{.}}[[VAR_18_]], [[CST_0_]], [[I_2_]]{{.}} : memref<?x1x5xf32>
 // CHECK:             [[VAR_20_:%.+]] = cmpf ogt, [[VAR_16_]], [[LOAD_PARAM_2_MEM_]] : f32
 // CHECK:             [[VAR_21_:%.+]] = select [[VAR_20_]], [[VAR_16_]], [[LOAD_PARAM_2_MEM_]] : f32
@@ -675,9 +789,9 @@ func @test_prelu_broadcast_unknown_dims1(%arg0: tensor<?x2x?xf32>, %arg1: tensor
   // CHECK:     [[DIM0_SLOPE:%.+]] = memref.dim %arg1, [[CST0]] : memref<?x5xf32>
   // CHECK:     [[RES:%.+]] = memref.alloc([[DIM0_X]]) : memref<?x2x5xf32>
   // CHECK:     [[MAIN_LOOP:%.+]]:3 = krnl.define_loops 3
+  // CHECK:     [[GREATER_THAN_ONE:%.+]] = cmpi sgt, [[DIM0_SLOPE]], [[CST1]] : index
   // CHECK:     krnl.iterate([[MAIN_LOOP]]#0, [[MAIN_LOOP]]#1, [[MAIN_LOOP]]#2) with ([[MAIN_LOOP]]#0 -> %arg2 = 0 to [[DIM0_X]], [[MAIN_LOOP]]#1 -> %arg3 = 0 to 2, [[MAIN_LOOP]]#2 -> %arg4 = 0 to 5) {
   // CHECK:       [[LOAD_X:%.+]] = krnl.load %arg0[%arg2, %arg3, %arg4] : memref<?x2x?xf32>
-  // CHECK:       [[GREATER_THAN_ONE:%.+]] = cmpi sgt, [[DIM0_SLOPE]], [[CST1]] : index
   // CHECK:       [[SELECT1:%.+]] = select [[GREATER_THAN_ONE]], %arg3, [[CST0]] : index
   // CHECK:       [[LOAD_SLOPE:%.+]] = krnl.load %arg1{{\[}}[[SELECT1]], %arg4] : memref<?x5xf32>
   // CHECK:       [[LESS_THAN_ZERO:%.+]] = cmpf olt, [[LOAD_X]], [[CST0_f32]] : f32
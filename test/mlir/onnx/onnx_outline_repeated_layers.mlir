@@ -0,0 +1,116 @@
+// RUN: onnx-mlir-opt --outline-repeated-layers-onnx="min-ops=4" %s -split-input-file | FileCheck %s
+
+/// The three layers are computed by calls of the same function, taking the
+/// weights of each layer as arguments. The scale shared by the layers is
+/// cloned into the function.
+func @test_layers(%arg0: tensor<1x16xf32>, %w0: tensor<16x16xf32>, %b0: tensor<16xf32>, %w1: tensor<16x16xf32>, %b1: tensor<16xf32>, %w2: tensor<16x16xf32>, %b2: tensor<16xf32>) -> tensor<1x16xf32> {
+  %scale = "onnx.Constant"() {value = dense<2.0> : tensor<1xf32>} : () -> tensor<1xf32>
+  %0 = "onnx.MatMul"(%arg0, %w0) : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %1 = "onnx.Add"(%0, %b0) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %2 = "onnx.Relu"(%1) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %3 = "onnx.Mul"(%2, %scale) : (tensor<1x16xf32>, tensor<1xf32>) -> tensor<1x16xf32>
+  %4 = "onnx.MatMul"(%3, %w1) : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %5 = "onnx.Add"(%4, %b1) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %6 = "onnx.Relu"(%5) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %7 = "onnx.Mul"(%6, %scale) : (tensor<1x16xf32>, tensor<1xf32>) -> tensor<1x16xf32>
+  %8 = "onnx.MatMul"(%7, %w2) : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %9 = "onnx.Add"(%8, %b2) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %10 = "onnx.Relu"(%9) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %11 = "onnx.Mul"(%10, %scale) : (tensor<1x16xf32>, tensor<1xf32>) -> tensor<1x16xf32>
+  return %11 : tensor<1x16xf32>
+
+  // CHECK-LABEL: func private @test_layers_layer
+  // CHECK-SAME: ([[X:%.+]]: tensor<1x16xf32>, [[W:%.+]]: tensor<16x16xf32>, [[B:%.+]]: tensor<16xf32>) -> tensor<1x16xf32> attributes {passthrough = ["noinline"]} {
+  // CHECK: [[SCALE:%.+]] = "onnx.Constant"() {value = dense<2.000000e+00> : tensor<1xf32>} : () -> tensor<1xf32>
+  // CHECK: [[MATMUL:%.+]] = "onnx.MatMul"([[X]], [[W]])
+  // CHECK: [[ADD:%.+]] = "onnx.Add"([[MATMUL]], [[B]])
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[ADD]])
+  // CHECK: [[MUL:%.+]] = "onnx.Mul"([[RELU]], [[SCALE]])
+  // CHECK: return [[MUL]] : tensor<1x16xf32>
+
+  // CHECK-LABEL: func @test_layers
+  // CHECK-NOT: "onnx.Constant"
+  // CHECK: [[L0:%.+]] = call @test_layers_layer(%arg0, %arg1, %arg2) : (tensor<1x16xf32>, tensor<16x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  // CHECK: [[L1:%.+]] = call @test_layers_layer([[L0]], %arg3, %arg4)
+  // CHECK: [[L2:%.+]] = call @test_layers_layer([[L1]], %arg5, %arg6)
+  // CHECK-NOT: "onnx.
+  // CHECK: return [[L2]] : tensor<1x16xf32>
+}
+
+// -----
+
+/// The names of the imported nodes, unique to each op, do not tell the layers
+/// apart. The constant scales of the layers, with their own names, have the
+/// same value and are cloned into the function.
+func @test_named_layers(%arg0: tensor<1x16xf32>, %w0: tensor<16x16xf32>, %b0: tensor<16xf32>, %w1: tensor<16x16xf32>, %b1: tensor<16xf32>) -> tensor<1x16xf32> {
+  %s0 = "onnx.Constant"() {onnx_node_name = "scale0", value = dense<2.0> : tensor<1xf32>} : () -> tensor<1xf32>
+  %s1 = "onnx.Constant"() {onnx_node_name = "scale1", value = dense<2.0> : tensor<1xf32>} : () -> tensor<1xf32>
+  %0 = "onnx.MatMul"(%arg0, %w0) {onnx_node_name = "layer0/matmul"} : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %1 = "onnx.Add"(%0, %b0) {onnx_node_name = "layer0/add"} : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %2 = "onnx.Relu"(%1) {onnx_node_name = "layer0/relu"} : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %3 = "onnx.Mul"(%2, %s0) {onnx_node_name = "layer0/mul"} : (tensor<1x16xf32>, tensor<1xf32>) -> tensor<1x16xf32>
+  %4 = "onnx.MatMul"(%3, %w1) {onnx_node_name = "layer1/matmul"} : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %5 = "onnx.Add"(%4, %b1) {onnx_node_name = "layer1/add"} : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %6 = "onnx.Relu"(%5) {onnx_node_name = "layer1/relu"} : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %7 = "onnx.Mul"(%6, %s1) {onnx_node_name = "layer1/mul"} : (tensor<1x16xf32>, tensor<1xf32>) -> tensor<1x16xf32>
+  return %7 : tensor<1x16xf32>
+
+  // CHECK-LABEL: func private @test_named_layers_layer
+  // CHECK-SAME: ([[X:%.+]]: tensor<1x16xf32>, [[W:%.+]]: tensor<16x16xf32>, [[B:%.+]]: tensor<16xf32>) -> tensor<1x16xf32>
+  // CHECK: [[SCALE:%.+]] = "onnx.Constant"()
+  // CHECK: [[MATMUL:%.+]] = "onnx.MatMul"([[X]], [[W]])
+  // CHECK: [[ADD:%.+]] = "onnx.Add"([[MATMUL]], [[B]])
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[ADD]])
+  // CHECK: [[MUL:%.+]] = "onnx.Mul"([[RELU]], [[SCALE]])
+  // CHECK: return [[MUL]] : tensor<1x16xf32>
+
+  // CHECK-LABEL: func @test_named_layers
+  // CHECK: [[L0:%.+]] = call @test_named_layers_layer(%arg0, %arg1, %arg2) : (tensor<1x16xf32>, tensor<16x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  // CHECK: [[L1:%.+]] = call @test_named_layers_layer([[L0]], %arg3, %arg4)
+  // CHECK-NOT: "onnx.
+  // CHECK: return [[L1]] : tensor<1x16xf32>
+}
+
+// -----
+
+/// The copies stop at the layer whose LeakyRelu has another alpha, left
+/// inline.
+func @test_different_attributes(%arg0: tensor<1x16xf32>, %w0: tensor<16x16xf32>, %b0: tensor<16xf32>, %w1: tensor<16x16xf32>, %b1: tensor<16xf32>, %w2: tensor<16x16xf32>, %b2: tensor<16xf32>) -> tensor<1x16xf32> {
+  %0 = "onnx.MatMul"(%arg0, %w0) : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %1 = "onnx.Add"(%0, %b0) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %2 = "onnx.LeakyRelu"(%1) {alpha = 0.1 : f32} : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %3 = "onnx.Neg"(%2) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %4 = "onnx.MatMul"(%3, %w1) : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %5 = "onnx.Add"(%4, %b1) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %6 = "onnx.LeakyRelu"(%5) {alpha = 0.1 : f32} : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %7 = "onnx.Neg"(%6) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %8 = "onnx.MatMul"(%7, %w2) : (tensor<1x16xf32>, tensor<16x16xf32>) -> tensor<1x16xf32>
+  %9 = "onnx.Add"(%8, %b2) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %10 = "onnx.LeakyRelu"(%9) {alpha = 0.2 : f32} : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %11 = "onnx.Neg"(%10) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  return %11 : tensor<1x16xf32>
+
+  // CHECK-LABEL: func private @test_different_attributes_layer
+  // CHECK: "onnx.LeakyRelu"({{.*}}) {alpha = 1.000000e-01 : f32}
+
+  // CHECK-LABEL: func @test_different_attributes
+  // CHECK: [[L0:%.+]] = call @test_different_attributes_layer(%arg0, %arg1, %arg2)
+  // CHECK: [[L1:%.+]] = call @test_different_attributes_layer([[L0]], %arg3, %arg4)
+  // CHECK: [[MATMUL:%.+]] = "onnx.MatMul"([[L1]], %arg5)
+  // CHECK: "onnx.LeakyRelu"({{.*}}) {alpha = 2.000000e-01 : f32}
+}
+
+// -----
+
+/// The layers of fewer than min-ops ops are left inline.
+func @test_small_layers(%arg0: tensor<1x16xf32>, %b0: tensor<16xf32>, %b1: tensor<16xf32>) -> tensor<1x16xf32> {
+  %0 = "onnx.Add"(%arg0, %b0) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  %2 = "onnx.Add"(%1, %b1) : (tensor<1x16xf32>, tensor<16xf32>) -> tensor<1x16xf32>
+  %3 = "onnx.Relu"(%2) : (tensor<1x16xf32>) -> tensor<1x16xf32>
+  return %3 : tensor<1x16xf32>
+
+  // CHECK-LABEL: func @test_small_layers
+  // CHECK-NOT: call
+  // CHECK: return
+}
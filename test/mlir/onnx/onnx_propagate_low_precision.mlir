@@ -0,0 +1,38 @@
+// RUN: onnx-mlir-opt --propagate-low-precision-onnx %s -split-input-file | FileCheck %s
+
+/// The region between the Casts from and to fp16 is computed in fp16, its
+/// constant converted.
+func @test_cast_region(%arg0 : tensor<3x4xf16>, %arg1 : tensor<4xf16>) -> tensor<3x4xf16> {
+  %cst = "onnx.Constant"() {value = dense<2.0> : tensor<f32>} : () -> tensor<f32>
+  %0 = "onnx.Cast"(%arg0) {to = f32} : (tensor<3x4xf16>) -> tensor<3x4xf32>
+  %1 = "onnx.Cast"(%arg1) {to = f32} : (tensor<4xf16>) -> tensor<4xf32>
+  %2 = "onnx.Add"(%0, %1) : (tensor<3x4xf32>, tensor<4xf32>) -> tensor<3x4xf32>
+  %3 = "onnx.Mul"(%2, %cst) : (tensor<3x4xf32>, tensor<f32>) -> tensor<3x4xf32>
+  %4 = "onnx.Relu"(%3) : (tensor<3x4xf32>) -> tensor<3x4xf32>
+  %5 = "onnx.Cast"(%4) {to = f16} : (tensor<3x4xf32>) -> tensor<3x4xf16>
+  return %5 : tensor<3x4xf16>
+
+  // CHECK-LABEL: test_cast_region
+  // CHECK-NOT: "onnx.Cast"
+  // CHECK: [[CST:%.+]] = "onnx.Constant"() {value = dense<2.000000e+00> : tensor<f16>} : () -> tensor<f16>
+  // CHECK: [[ADD:%.+]] = "onnx.Add"(%arg0, %arg1) : (tensor<3x4xf16>, tensor<4xf16>) -> tensor<3x4xf16>
+  // CHECK: [[MUL:%.+]] = "onnx.Mul"([[ADD]], [[CST]]) : (tensor<3x4xf16>, tensor<f16>) -> tensor<3x4xf16>
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[MUL]]) : (tensor<3x4xf16>) -> tensor<3x4xf16>
+  // CHECK-NOT: "onnx.Cast"
+  // CHECK: return [[RELU]] : tensor<3x4xf16>
+}
+
+// -----
+
+/// The region whose result is also used in fp32 is kept.
+func @test_cast_region_used_in_fp32(%arg0 : tensor<4xf16>) -> (tensor<4xf16>, tensor<4xf32>) {
+  %0 = "onnx.Cast"(%arg0) {to = f32} : (tensor<4xf16>) -> tensor<4xf32>
+  %1 = "onnx.Relu"(%0) : (tensor<4xf32>) -> tensor<4xf32>
+  %2 = "onnx.Cast"(%1) {to = f16} : (tensor<4xf32>) -> tensor<4xf16>
+  return %2, %1 : tensor<4xf16>, tensor<4xf32>
+
+  // CHECK-LABEL: test_cast_region_used_in_fp32
+  // CHECK: [[CAST:%.+]] = "onnx.Cast"(%arg0) {to = f32} : (tensor<4xf16>) -> tensor<4xf32>
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"([[CAST]]) : (tensor<4xf32>) -> tensor<4xf32>
+  // CHECK: "onnx.Cast"([[RELU]]) {to = f16} : (tensor<4xf32>) -> tensor<4xf16>
+}
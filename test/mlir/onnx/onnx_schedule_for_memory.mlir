@@ -0,0 +1,33 @@
+// RUN: onnx-mlir-opt --schedule-for-memory-onnx %s -split-input-file | FileCheck %s
+
+/// Each branch is reduced before the large result of the next one is
+/// computed.
+func @test_schedule_branches(%arg0 : tensor<1024xf32>) -> tensor<f32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<1024xf32>) -> tensor<1024xf32>
+  %1 = "onnx.Exp"(%arg0) : (tensor<1024xf32>) -> tensor<1024xf32>
+  %2 = "onnx.ReduceMean"(%0) {axes = [0], keepdims = 0 : si64} : (tensor<1024xf32>) -> tensor<f32>
+  %3 = "onnx.ReduceMean"(%1) {axes = [0], keepdims = 0 : si64} : (tensor<1024xf32>) -> tensor<f32>
+  %4 = "onnx.Add"(%2, %3) : (tensor<f32>, tensor<f32>) -> tensor<f32>
+  "std.return"(%4) : (tensor<f32>) -> ()
+
+  // CHECK-LABEL: test_schedule_branches
+  // CHECK-NEXT: [[RELU:%.+]] = "onnx.Relu"(%arg0)
+  // CHECK-NEXT: [[MEAN_RELU:%.+]] = "onnx.ReduceMean"([[RELU]])
+  // CHECK-NEXT: [[EXP:%.+]] = "onnx.Exp"(%arg0)
+  // CHECK-NEXT: [[MEAN_EXP:%.+]] = "onnx.ReduceMean"([[EXP]])
+  // CHECK-NEXT: [[RES:%.+]] = "onnx.Add"([[MEAN_RELU]], [[MEAN_EXP]])
+  // CHECK-NEXT: return [[RES]] : tensor<f32>
+}
+
+// -----
+
+/// The order of the ops is kept when another order does not lower the peak.
+func @test_keep_order(%arg0 : tensor<1024xf32>) -> (tensor<1024xf32>, tensor<1024xf32>) {
+  %0 = "onnx.Exp"(%arg0) : (tensor<1024xf32>) -> tensor<1024xf32>
+  %1 = "onnx.Relu"(%arg0) : (tensor<1024xf32>) -> tensor<1024xf32>
+  "std.return"(%0, %1) : (tensor<1024xf32>, tensor<1024xf32>) -> ()
+
+  // CHECK-LABEL: test_keep_order
+  // CHECK-NEXT: "onnx.Exp"(%arg0)
+  // CHECK-NEXT: "onnx.Relu"(%arg0)
+}
@@ -18,6 +18,113 @@ func @test_default_argmax(%arg0 : tensor<2x3x4xf32>) -> tensor<*xi64> {
 
 // -----
 
+func @test_argmin_no_keepdims(%arg0 : tensor<2x3x4xf32>) -> tensor<*xi64> {
+  %0 = "onnx.ArgMin"(%arg0) {axis = -1 : si64, keepdims = 0 : si64} : (tensor<2x3x4xf32>) -> tensor<*xi64>
+  "std.return"(%0) : (tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: test_argmin_no_keepdims
+  // CHECK: [[RES:%.+]] = "onnx.ArgMin"(%arg0) {axis = 2 : si64, keepdims = 0 : si64} : (tensor<2x3x4xf32>) -> tensor<2x3xi64>
+  // CHECK: return [[RES]] : tensor<2x3xi64>
+}
+
+// -----
+
+func @test_topk(%arg0 : tensor<4x100000xf32>) -> (tensor<*xf32>, tensor<*xi64>) {
+  %k = "onnx.Constant"() {value = dense<10> : tensor<1xi64>} : () -> tensor<1xi64>
+  %0, %1 = "onnx.TopK"(%arg0, %k) : (tensor<4x100000xf32>, tensor<1xi64>) -> (tensor<*xf32>, tensor<*xi64>)
+  "std.return"(%0, %1) : (tensor<*xf32>, tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: test_topk
+  // CHECK: [[RES:%.+]]:2 = "onnx.TopK"(%arg0, {{.*}}) {axis = 1 : si64} : (tensor<4x100000xf32>, tensor<1xi64>) -> (tensor<4x10xf32>, tensor<4x10xi64>)
+  // CHECK: return [[RES]]#0, [[RES]]#1 : tensor<4x10xf32>, tensor<4x10xi64>
+}
+
+// -----
+
+func @test_resize_scales(%arg0 : tensor<1x3x4x5xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %scales = "onnx.Constant"() {value = dense<[1.0, 1.0, 2.0, 1.5]> : tensor<4xf32>} : () -> tensor<4xf32>
+  %0 = "onnx.Resize"(%arg0, %cst, %scales, %cst) : (tensor<1x3x4x5xf32>, none, tensor<4xf32>, none) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_resize_scales
+  // CHECK: [[RES:%.+]] = "onnx.Resize"(%arg0, {{.*}}) : (tensor<1x3x4x5xf32>, none, tensor<4xf32>, none) -> tensor<1x3x8x7xf32>
+  // CHECK: return [[RES]] : tensor<1x3x8x7xf32>
+}
+
+// -----
+
+func @test_resize_sizes(%arg0 : tensor<1x3x4x5xf32>) -> tensor<*xf32> {
+  %cst = constant unit
+  %sizes = "onnx.Constant"() {value = dense<[1, 3, 6, 10]> : tensor<4xi64>} : () -> tensor<4xi64>
+  %0 = "onnx.Resize"(%arg0, %cst, %cst, %sizes) : (tensor<1x3x4x5xf32>, none, none, tensor<4xi64>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_resize_sizes
+  // CHECK: [[RES:%.+]] = "onnx.Resize"(%arg0, {{.*}}) : (tensor<1x3x4x5xf32>, none, none, tensor<4xi64>) -> tensor<1x3x6x10xf32>
+  // CHECK: return [[RES]] : tensor<1x3x6x10xf32>
+}
+
+// -----
+
+func @test_upsample(%arg0 : tensor<1x3x4x5xf32>) -> tensor<*xf32> {
+  %scales = "onnx.Constant"() {value = dense<[1.0, 1.0, 2.0, 2.0]> : tensor<4xf32>} : () -> tensor<4xf32>
+  %0 = "onnx.Upsample"(%arg0, %scales) : (tensor<1x3x4x5xf32>, tensor<4xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_upsample
+  // CHECK: [[RES:%.+]] = "onnx.Upsample"(%arg0, {{.*}}) : (tensor<1x3x4x5xf32>, tensor<4xf32>) -> tensor<1x3x8x10xf32>
+  // CHECK: return [[RES]] : tensor<1x3x8x10xf32>
+}
+
+// -----
+
+func @test_nonmaxsuppression(%arg0 : tensor<1x6x4xf32>, %arg1 : tensor<1x2x6xf32>) -> tensor<*xi64> {
+  %max_output = "onnx.Constant"() {value = dense<3> : tensor<1xi64>} : () -> tensor<1xi64>
+  %cst = constant unit
+  %0 = "onnx.NonMaxSuppression"(%arg0, %arg1, %max_output, %cst, %cst) : (tensor<1x6x4xf32>, tensor<1x2x6xf32>, tensor<1xi64>, none, none) -> tensor<*xi64>
+  "std.return"(%0) : (tensor<*xi64>) -> ()
+
+  // CHECK-LABEL: test_nonmaxsuppression
+  // CHECK: [[RES:%.+]] = "onnx.NonMaxSuppression"(%arg0, %arg1, {{.*}}) : (tensor<1x6x4xf32>, tensor<1x2x6xf32>, tensor<1xi64>, none, none) -> tensor<?x3xi64>
+  // CHECK: return [[RES]] : tensor<?x3xi64>
+}
+
+// -----
+
+func @test_equal(%arg0 : tensor<2x1x8xf32>, %arg1 : tensor<4x1xf32>) -> tensor<*xi1> {
+  %0 = "onnx.Equal"(%arg0, %arg1) : (tensor<2x1x8xf32>, tensor<4x1xf32>) -> tensor<*xi1>
+  "std.return"(%0) : (tensor<*xi1>) -> ()
+
+  // CHECK-LABEL: test_equal
+  // CHECK: [[RES:%.+]] = "onnx.Equal"(%arg0, %arg1) : (tensor<2x1x8xf32>, tensor<4x1xf32>) -> tensor<2x4x8xi1>
+  // CHECK: return [[RES]] : tensor<2x4x8xi1>
+}
+
+// -----
+
+func @test_where(%arg0 : tensor<2x1x1x8xi1>, %arg1 : tensor<2x4x8x8xf32>, %arg2 : tensor<f32>) -> tensor<*xf32> {
+  %0 = "onnx.Where"(%arg0, %arg1, %arg2) : (tensor<2x1x1x8xi1>, tensor<2x4x8x8xf32>, tensor<f32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_where
+  // CHECK: [[RES:%.+]] = "onnx.Where"(%arg0, %arg1, %arg2) : (tensor<2x1x1x8xi1>, tensor<2x4x8x8xf32>, tensor<f32>) -> tensor<2x4x8x8xf32>
+  // CHECK: return [[RES]] : tensor<2x4x8x8xf32>
+}
+
+// -----
+
+func @test_mean(%arg0 : tensor<2x1x8xf32>, %arg1 : tensor<4x8xf32>, %arg2 : tensor<f32>) -> tensor<*xf32> {
+  %0 = "onnx.Mean"(%arg0, %arg1, %arg2) : (tensor<2x1x8xf32>, tensor<4x8xf32>, tensor<f32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_mean
+  // CHECK: [[RES:%.+]] = "onnx.Mean"(%arg0, %arg1, %arg2) : (tensor<2x1x8xf32>, tensor<4x8xf32>, tensor<f32>) -> tensor<2x4x8xf32>
+  // CHECK: return [[RES]] : tensor<2x4x8xf32>
+}
+
+// -----
+
 //===----------------------------------------------------------------------===//
 /// Test the default behavior of transpose when no information for the
 /// permutation of the axes is provided and when a permutation is provided.
@@ -1747,3 +1854,48 @@ func @test_scan_simple_main_graph(%arg0: tensor<2xf32>, %arg1: tensor<3x2xf32>)
 // CHECK:         }
 // CHECK:       }
 }
+
+// -----
+
+func @test_instance_normalization(%arg0 : tensor<2x3x4x5xf32>, %arg1 : tensor<3xf32>, %arg2 : tensor<3xf32>) -> tensor<*xf32> {
+  %0 = "onnx.InstanceNormalization"(%arg0, %arg1, %arg2) : (tensor<2x3x4x5xf32>, tensor<3xf32>, tensor<3xf32>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_instance_normalization
+  // CHECK: [[RES:%.+]] = "onnx.InstanceNormalization"(%arg0, %arg1, %arg2) {epsilon = 9.99999974E-6 : f32} : (tensor<2x3x4x5xf32>, tensor<3xf32>, tensor<3xf32>) -> tensor<2x3x4x5xf32>
+  // CHECK: return [[RES]] : tensor<2x3x4x5xf32>
+}
+
+// -----
+
+/// The ops whose operand types are refined are inferred again, although their
+/// results are ranked.
+func @test_propagate_refined_shapes(%arg0 : tensor<2x3xf32>) -> tensor<*xf32> {
+  %0 = "onnx.Relu"(%arg0) : (tensor<2x3xf32>) -> tensor<*xf32>
+  %1 = "onnx.Sigmoid"(%0) : (tensor<*xf32>) -> tensor<?x?xf32>
+  %2 = "onnx.Tanh"(%1) : (tensor<?x?xf32>) -> tensor<*xf32>
+  "std.return"(%2) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_propagate_refined_shapes
+  // CHECK: [[RELU:%.+]] = "onnx.Relu"(%arg0) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  // CHECK: [[SIGMOID:%.+]] = "onnx.Sigmoid"([[RELU]]) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  // CHECK: [[TANH:%.+]] = "onnx.Tanh"([[SIGMOID]]) : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  // CHECK: return [[TANH]] : tensor<2x3xf32>
+}
+
+// -----
+
+/// The ends of the Slices to the last element are INT64_MAX, the empty key of
+/// the shared literals, and INT64_MAX - 1, their tombstone key.
+func @test_slice_int64_max_ends(%arg0 : tensor<2x4xf32>) -> tensor<*xf32> {
+  %starts = "onnx.Constant"() {value = dense<[0, 1]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %ends = "onnx.Constant"() {value = dense<[9223372036854775806, 9223372036854775807]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %axes = "onnx.Constant"() {value = dense<[0, 1]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %steps = "onnx.Constant"() {value = dense<[1, 1]> : tensor<2xi64> } : () -> tensor<2xi64>
+  %0 = "onnx.Slice"(%arg0, %starts, %ends, %axes, %steps) : (tensor<2x4xf32>, tensor<2xi64>, tensor<2xi64>, tensor<2xi64>, tensor<2xi64>) -> tensor<*xf32>
+  "std.return"(%0) : (tensor<*xf32>) -> ()
+
+  // CHECK-LABEL: test_slice_int64_max_ends
+  // CHECK: [[RES:%.+]] = "onnx.Slice"(%arg0, {{.*}}) : (tensor<2x4xf32>, tensor<2xi64>, tensor<2xi64>, tensor<2xi64>, tensor<2xi64>) -> tensor<2x3xf32>
+  // CHECK: return [[RES]] : tensor<2x3xf32>
+}
@@ -0,0 +1,20 @@
+// RUN: onnx-mlir-opt --specialize-shapes="shapes=1x10:?x5,8x10:8x5" --shape-inference %s | FileCheck %s
+
+/// One clone of the entry point is created for each specialization, with the
+/// given input shapes, and the shape inference refines its results.
+func @main_graph(%arg0: tensor<?x10xf32>, %arg1: tensor<?x5xf32>) -> (tensor<*xf32>, tensor<*xf32>) {
+  %0 = "onnx.Relu"(%arg0) : (tensor<?x10xf32>) -> tensor<*xf32>
+  %1 = "onnx.Relu"(%arg1) : (tensor<?x5xf32>) -> tensor<*xf32>
+  return %0, %1 : tensor<*xf32>, tensor<*xf32>
+}
+"onnx.EntryPoint"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 2 : i32, signature = ""} : () -> ()
+
+// CHECK-LABEL: func @main_graph_spec0(%arg0: tensor<1x10xf32>, %arg1: tensor<?x5xf32>) -> (tensor<1x10xf32>, tensor<?x5xf32>)
+// CHECK:         "onnx.Relu"(%arg0) : (tensor<1x10xf32>) -> tensor<1x10xf32>
+
+// CHECK-LABEL: func @main_graph_spec1(%arg0: tensor<8x10xf32>, %arg1: tensor<8x5xf32>) -> (tensor<8x10xf32>, tensor<8x5xf32>)
+// CHECK:         "onnx.Relu"(%arg1) : (tensor<8x5xf32>) -> tensor<8x5xf32>
+
+// CHECK-LABEL: func @main_graph(%arg0: tensor<?x10xf32>, %arg1: tensor<?x5xf32>) -> (tensor<?x10xf32>, tensor<?x5xf32>)
+
+// CHECK:       "onnx.EntryPoint"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 2 : i32, signature = "", specializations = [{func = @main_graph_spec0, shapes = {{\[}}[1, 10], [-1, 5]{{\]}}}, {func = @main_graph_spec1, shapes = {{\[}}[8, 10], [8, 5]{{\]}}}]} : () -> ()
@@ -0,0 +1,49 @@
+// RUN: onnx-mlir-opt --unroll-loop-onnx %s -split-input-file | FileCheck %s
+// RUN: onnx-mlir-opt --unroll-loop-onnx="max-trip-count=1" %s -split-input-file | FileCheck %s --check-prefix=SMALL
+
+/// The Loop of a constant trip count is replaced by the copies of its body,
+/// its scan output by the concatenation of the values of the iterations.
+func @test_loop_unroll(%arg0: tensor<1xi64>) -> (tensor<*xi64>, tensor<*xi64>) {
+  %0 = "onnx.Constant"() {value = dense<2> : tensor<i64>} : () -> tensor<i64>
+  %1 = "onnx.Constant"() {value = dense<true> : tensor<i1>} : () -> tensor<i1>
+  %2:2 = "onnx.Loop"(%0, %1, %arg0) ({
+  ^bb0(%body_arg0: tensor<*xi64>, %body_arg1: tensor<*xi1>, %body_arg2: tensor<*xi64>):
+    %3 = "onnx.Identity"(%body_arg1) : (tensor<*xi1>) -> tensor<*xi1>
+    %4 = "onnx.Add"(%body_arg2, %body_arg0) : (tensor<*xi64>, tensor<*xi64>) -> tensor<*xi64>
+    onnx.Return %3, %4, %4 : tensor<*xi1>, tensor<*xi64>, tensor<*xi64>
+  }) : (tensor<i64>, tensor<i1>, tensor<1xi64>) -> (tensor<*xi64>, tensor<*xi64>)
+  return %2#0, %2#1 : tensor<*xi64>, tensor<*xi64>
+
+  // CHECK-LABEL: test_loop_unroll
+  // CHECK-NOT: "onnx.Loop"
+  // CHECK: [[I0:%.+]] = "onnx.Constant"() {value = dense<0> : tensor<i64>} : () -> tensor<i64>
+  // CHECK: [[Y0:%.+]] = "onnx.Add"(%arg0, [[I0]]) : (tensor<1xi64>, tensor<i64>) -> tensor<*xi64>
+  // CHECK: [[I1:%.+]] = "onnx.Constant"() {value = dense<1> : tensor<i64>} : () -> tensor<i64>
+  // CHECK: [[Y1:%.+]] = "onnx.Add"([[Y0]], [[I1]]) : (tensor<*xi64>, tensor<i64>) -> tensor<*xi64>
+  // CHECK: [[S0:%.+]] = "onnx.Unsqueeze"([[Y0]]) {axes = [0]} : (tensor<*xi64>) -> tensor<*xi64>
+  // CHECK: [[S1:%.+]] = "onnx.Unsqueeze"([[Y1]]) {axes = [0]} : (tensor<*xi64>) -> tensor<*xi64>
+  // CHECK: [[SCAN:%.+]] = "onnx.Concat"([[S0]], [[S1]]) {axis = 0 : si64} : (tensor<*xi64>, tensor<*xi64>) -> tensor<*xi64>
+  // CHECK: return [[Y1]], [[SCAN]] : tensor<*xi64>, tensor<*xi64>
+
+  // SMALL-LABEL: test_loop_unroll
+  // SMALL: "onnx.Loop"
+}
+
+// -----
+
+/// The Loop whose body computes its condition may terminate early and is not
+/// unrolled.
+func @test_loop_early_exit(%arg0: tensor<i64>) -> tensor<*xi64> {
+  %0 = "onnx.Constant"() {value = dense<2> : tensor<i64>} : () -> tensor<i64>
+  %1 = "onnx.Constant"() {value = dense<true> : tensor<i1>} : () -> tensor<i1>
+  %2 = "onnx.Loop"(%0, %1, %arg0) ({
+  ^bb0(%body_arg0: tensor<*xi64>, %body_arg1: tensor<*xi1>, %body_arg2: tensor<*xi64>):
+    %3 = "onnx.Add"(%body_arg2, %body_arg0) : (tensor<*xi64>, tensor<*xi64>) -> tensor<*xi64>
+    %4 = "onnx.Less"(%3, %body_arg0) : (tensor<*xi64>, tensor<*xi64>) -> tensor<*xi1>
+    onnx.Return %4, %3 : tensor<*xi1>, tensor<*xi64>
+  }) : (tensor<i64>, tensor<i1>, tensor<i64>) -> tensor<*xi64>
+  return %2 : tensor<*xi64>
+
+  // CHECK-LABEL: test_loop_early_exit
+  // CHECK: "onnx.Loop"
+}
@@ -0,0 +1,278 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//===------------- BenchKernels.cpp - Kernel Microbenchmarks --------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains the onnx-mlir-bench microbenchmarks, which compile the
+// MatMul, Gemm and Conv operations over a sweep of shapes, with the graphs of
+// the numerical tests, and report their throughput in GFLOP/s and GB/s. When
+// the peak compute and memory bandwidth of the machine are given, the
+// throughput is also reported as a fraction of the roofline, the attainable
+// GFLOP/s at the arithmetic intensity of the shape.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "src/Dialect/ONNX/ONNXOps.hpp"
+#include "src/MainUtils.hpp"
+#include "src/Runtime/ExecutionSession.hpp"
+#include "src/Runtime/OMTensorHelper.h"
+
+#define SHARED_LIB_BASE string("./onnx-mlir-bench_main_graph")
+
+using namespace std;
+using namespace mlir;
+
+// Include some helper functions.
+#include "test/numerical/Helper.hpp"
+
+static llvm::cl::OptionCategory BenchOptions(
+    "onnx-mlir-bench options", "These are the microbenchmark options.");
+
+static llvm::cl::list<string> benchOps("ops",
+    llvm::cl::desc("operations to benchmark: matmul, gemm, conv (default all)"),
+    llvm::cl::CommaSeparated, llvm::cl::cat(BenchOptions));
+
+static llvm::cl::opt<int> repetitions("repetitions",
+    llvm::cl::desc("number of timed runs of each shape, the median is kept"),
+    llvm::cl::init(20), llvm::cl::cat(BenchOptions));
+
+static llvm::cl::opt<int> warmupRuns("warmupRuns",
+    llvm::cl::desc("number of runs of each shape before the timed runs"),
+    llvm::cl::init(3), llvm::cl::cat(BenchOptions));
+
+static llvm::cl::opt<double> peakGFlops("peakGFlops",
+    llvm::cl::desc("peak compute of the machine in GFLOP/s, for the roofline"),
+    llvm::cl::init(0), llvm::cl::cat(BenchOptions));
+
+static llvm::cl::opt<double> peakGBs("peakGBs",
+    llvm::cl::desc("peak memory bandwidth of the machine in GB/s, for the "
+                   "roofline"),
+    llvm::cl::init(0), llvm::cl::cat(BenchOptions));
+
+using OMTensorPtr = unique_ptr<OMTensor, decltype(&omTensorDestroy)>;
+
+// A shape of an operation to benchmark, with the number of floating point
+// operations it performs and the minimal number of bytes it moves, each input
+// read and the output written once.
+struct BenchCase {
+  string name;
+  OwningModuleRef module;
+  vector<vector<int64_t>> inputShapes;
+  vector<int64_t> outputShape;
+  double flops;
+  double bytes;
+};
+
+static double getNumElems(ArrayRef<int64_t> shape) {
+  double numElems = 1;
+  for (int64_t dim : shape)
+    numElems *= dim;
+  return numElems;
+}
+
+static double getNumBytes(
+    const vector<vector<int64_t>> &inputShapes, ArrayRef<int64_t> outputShape) {
+  double numElems = getNumElems(outputShape);
+  for (const vector<int64_t> &shape : inputShapes)
+    numElems += getNumElems(shape);
+  return numElems * sizeof(float);
+}
+
+// Y[MxN] = A[MxK] * B[KxN]
+static BenchCase buildMatMul(MLIRContext &ctx, int M, int N, int K) {
+  Type f32 = FloatType::getF32(&ctx);
+  auto aType = RankedTensorType::get({M, K}, f32);
+  auto bType = RankedTensorType::get({K, N}, f32);
+  auto yType = RankedTensorType::get({M, N}, f32);
+  BenchCase bench;
+  bench.name = "MatMul " + to_string(M) + "x" + to_string(N) + "x" +
+               to_string(K);
+  bench.module = buildMainGraphModule(ctx, {aType, bType}, yType,
+      [&](OpBuilder &builder, Block *entryBlock) -> Value {
+        return builder.create<ONNXMatMulOp>(UnknownLoc::get(&ctx),
+            /*Y=*/yType, /*A=*/entryBlock->getArgument(0),
+            /*B=*/entryBlock->getArgument(1));
+      });
+  bench.inputShapes = {{M, K}, {K, N}};
+  bench.outputShape = {M, N};
+  bench.flops = 2.0 * M * N * K;
+  bench.bytes = getNumBytes(bench.inputShapes, bench.outputShape);
+  return bench;
+}
+
+// Y[MxN] = A[MxK] * B[KxN] + C[N]
+static BenchCase buildGemm(MLIRContext &ctx, int M, int N, int K) {
+  Type f32 = FloatType::getF32(&ctx);
+  auto aType = RankedTensorType::get({M, K}, f32);
+  auto bType = RankedTensorType::get({K, N}, f32);
+  auto cType = RankedTensorType::get({N}, f32);
+  auto yType = RankedTensorType::get({M, N}, f32);
+  BenchCase bench;
+  bench.name =
+      "Gemm " + to_string(M) + "x" + to_string(N) + "x" + to_string(K);
+  bench.module = buildMainGraphModule(ctx, {aType, bType, cType}, yType,
+      [&](OpBuilder &builder, Block *entryBlock) -> Value {
+        IntegerType i64 = builder.getIntegerType(64, /*isSigned=*/true);
+        auto gemmOp = builder.create<ONNXGemmOp>(UnknownLoc::get(&ctx),
+            /*Y=*/yType, /*A=*/entryBlock->getArgument(0),
+            /*B=*/entryBlock->getArgument(1),
+            /*C=*/entryBlock->getArgument(2),
+            /*alpha=*/FloatAttr::get(f32, 1.0),
+            /*beta=*/FloatAttr::get(f32, 1.0),
+            /*transA=*/IntegerAttr::get(i64, 0),
+            /*transB=*/IntegerAttr::get(i64, 0));
+        return gemmOp.getResult();
+      });
+  bench.inputShapes = {{M, K}, {K, N}, {N}};
+  bench.outputShape = {M, N};
+  bench.flops = 2.0 * M * N * K + 2.0 * M * N;
+  bench.bytes = getNumBytes(bench.inputShapes, bench.outputShape);
+  return bench;
+}
+
+// Y[NxFxHxW] = conv(X[NxCxHxW], W[FxCx3x3]), padded to keep the image size.
+static BenchCase buildConv(MLIRContext &ctx, int N, int C, int F, int HW) {
+  Type f32 = FloatType::getF32(&ctx);
+  const int K = 3;
+  auto xType = RankedTensorType::get({N, C, HW, HW}, f32);
+  auto wType = RankedTensorType::get({F, C, K, K}, f32);
+  auto yType = RankedTensorType::get({N, F, HW, HW}, f32);
+  BenchCase bench;
+  bench.name = "Conv " + to_string(N) + "x" + to_string(C) + "x" +
+               to_string(HW) + "x" + to_string(HW) + " 3x3 -> " +
+               to_string(F);
+  bench.module = buildMainGraphModule(ctx, {xType, wType}, yType,
+      [&](OpBuilder &builder, Block *entryBlock) -> Value {
+        auto bVal = builder
+                        .create<ConstantOp>(
+                            UnknownLoc::get(&ctx), builder.getUnitAttr())
+                        .getResult();
+        auto convOp = builder.create<ONNXConvOp>(UnknownLoc::get(&ctx),
+            /*Y=*/yType,
+            /*X=*/entryBlock->getArgument(0),
+            /*W=*/entryBlock->getArgument(1), /*B=*/bVal,
+            /*auto_pad=*/builder.getStringAttr("NOTSET"),
+            /*dilations=*/builder.getI64ArrayAttr({1, 1}),
+            /*group=*/
+            IntegerAttr::get(builder.getIntegerType(64, /*isSigned=*/true),
+                APInt(64, 1, /*isSigned=*/true)),
+            /*kernel_shape=*/builder.getI64ArrayAttr({K, K}),
+            /*pads=*/builder.getI64ArrayAttr({1, 1, 1, 1}),
+            /*strides=*/builder.getI64ArrayAttr({1, 1}));
+        return convOp.getResult();
+      });
+  bench.inputShapes = {{N, C, HW, HW}, {F, C, K, K}};
+  bench.outputShape = {N, F, HW, HW};
+  bench.flops = 2.0 * N * F * HW * HW * C * K * K;
+  bench.bytes = getNumBytes(bench.inputShapes, bench.outputShape);
+  return bench;
+}
+
+// Compile the case and return the median time of its runs, in seconds.
+static double runBenchCase(MLIRContext &ctx, BenchCase &bench) {
+  compileModule(bench.module, ctx, SHARED_LIB_BASE, EmitLib);
+  onnx_mlir::ExecutionSession sess(
+      SHARED_LIB_BASE + ".so", "run_main_graph", /*warmup=*/true);
+
+  vector<OMTensorPtr> inputs;
+  for (const vector<int64_t> &shape : bench.inputShapes)
+    inputs.emplace_back(
+        omTensorCreateWithRandomData<float>(shape), omTensorDestroy);
+  vector<OMTensorPtr> outputs;
+  outputs.emplace_back(
+      omTensorCreateWithShape<float>(bench.outputShape), omTensorDestroy);
+
+  for (int i = 0; i < warmupRuns; ++i)
+    sess.runInto(inputs, outputs);
+  vector<double> times;
+  for (int i = 0; i < max<int>(repetitions, 1); ++i) {
+    auto start = chrono::steady_clock::now();
+    sess.runInto(inputs, outputs);
+    times.push_back(
+        chrono::duration<double>(chrono::steady_clock::now() - start)
+            .count());
+  }
+  nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+  return times[times.size() / 2];
+}
+
+static bool isBenchmarked(StringRef op) {
+  return benchOps.empty() ||
+         find(benchOps.begin(), benchOps.end(), op.str()) != benchOps.end();
+}
+
+int main(int argc, char *argv[]) {
+  setExecPath(argv[0], (void *)main);
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv, "ONNX MLIR kernel microbenchmarks\n");
+  llvm::FileRemover remover(SHARED_LIB_BASE + ".so");
+
+  // Each case is built in its own context, like the numerical tests, as the
+  // execution sessions shut LLVM down when they are destroyed.
+  vector<function<BenchCase(MLIRContext &)>> benches;
+  if (isBenchmarked("matmul")) {
+    for (int size : {64, 128, 256, 512, 1024})
+      benches.push_back(
+          [=](MLIRContext &ctx) { return buildMatMul(ctx, size, size, size); });
+    // Vector-matrix products of the inferences with a batch of 1.
+    for (int size : {256, 1024, 4096})
+      benches.push_back(
+          [=](MLIRContext &ctx) { return buildMatMul(ctx, 1, size, size); });
+  }
+  if (isBenchmarked("gemm")) {
+    for (int size : {64, 128, 256, 512, 1024})
+      benches.push_back(
+          [=](MLIRContext &ctx) { return buildGemm(ctx, size, size, size); });
+    for (int size : {256, 1024, 4096})
+      benches.push_back(
+          [=](MLIRContext &ctx) { return buildGemm(ctx, 1, size, size); });
+  }
+  if (isBenchmarked("conv")) {
+    // The 3x3 convolutions of the stages of ResNet.
+    for (int stage = 0; stage < 4; ++stage)
+      benches.push_back([=](MLIRContext &ctx) {
+        return buildConv(ctx, 1, 64 << stage, 64 << stage, 56 >> stage);
+      });
+  }
+
+  bool roofline = peakGFlops > 0 && peakGBs > 0;
+  printf("%-32s %10s %10s %10s %8s%s\n", "shape", "time(ms)", "GFLOP/s",
+      "GB/s", "flop/B", roofline ? "   roofline" : "");
+  for (auto &buildBench : benches) {
+    MLIRContext ctx;
+    registerDialects(ctx);
+    BenchCase bench = buildBench(ctx);
+    double seconds = runBenchCase(ctx, bench);
+    double gflops = bench.flops / seconds * 1e-9;
+    double gbs = bench.bytes / seconds * 1e-9;
+    double intensity = bench.flops / bench.bytes;
+    printf("%-32s %10.3f %10.2f %10.2f %8.2f", bench.name.c_str(),
+        seconds * 1e3, gflops, gbs, intensity);
+    if (roofline) {
+      // The attainable throughput is bound by the compute or by the memory
+      // bandwidth, depending on the arithmetic intensity.
+      double attainable = min<double>(peakGFlops, intensity * peakGBs);
+      printf("   %7.1f%%", gflops / attainable * 100);
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+  return 0;
+}
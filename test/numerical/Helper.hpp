@@ -26,3 +26,33 @@ ONNXConstantOp buildONNXConstantOp(MLIRContext *ctx, OpBuilder builder,
       ArrayAttr(), IntegerAttr(), ArrayAttr(), StringAttr(), ArrayAttr());
   return constantTensor;
 }
+
+/// Build a module whose main_graph function takes arguments of the given
+/// types and returns the single value built by buildGraph from them, along
+/// with its entry point.
+OwningModuleRef buildMainGraphModule(MLIRContext &ctx,
+    ArrayRef<Type> inputsType, Type outputType,
+    function_ref<Value(OpBuilder &, Block *)> buildGraph) {
+  auto module = ModuleOp::create(UnknownLoc::get(&ctx));
+  OpBuilder builder(&ctx);
+  auto funcType = builder.getFunctionType(inputsType, {outputType});
+  llvm::SmallVector<NamedAttribute, 1> attrs;
+  auto funcOp = builder.create<FuncOp>(
+      UnknownLoc::get(&ctx), "main_graph", funcType, attrs);
+
+  auto entryBlock = funcOp.addEntryBlock();
+  builder.setInsertionPointToStart(entryBlock);
+  llvm::SmallVector<Value, 1> results = {buildGraph(builder, entryBlock)};
+  builder.create<ReturnOp>(UnknownLoc::get(&ctx), results);
+  module.push_back(funcOp);
+
+  // Emit the entry point operation which specifies the number of user
+  // inputs and outputs.
+  std::string signature("");
+  auto entryPoint = ONNXEntryPointOp::create(UnknownLoc::get(&ctx), funcOp,
+      /*numInputs=*/inputsType.size(),
+      /*numOutputs=*/1,
+      /*signature*/ signature);
+  module.push_back(entryPoint);
+  return OwningModuleRef(module);
+}
@@ -0,0 +1,86 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <iostream>
+#include <rapidcheck.h>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Parser.h"
+
+#include "src/MainUtils.hpp"
+#include "src/Runtime/ExecutionSession.hpp"
+#include "src/Runtime/OMTensorHelper.h"
+
+using namespace std;
+using namespace mlir;
+
+std::string testMatMulIR = R"(
+module {
+  func @main_graph(%arg0: tensor<?x?xf32>, %arg1: tensor<?x?xf32>) -> tensor<?x?xf32> {
+    %0 = "onnx.MatMul"(%arg0, %arg1) : (tensor<?x?xf32>, tensor<?x?xf32>) -> tensor<?x?xf32>
+    return %0 : tensor<?x?xf32>
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 2 : i32, numOutputs = 1 : i32, signature = "[    ]"} : () -> ()
+})";
+
+// Returns whether the Matmul compiled in process produces the same results as
+// a naive implementation of Matmul. Matmul: A[IxK] * B[KxJ] = C[IxJ]
+bool isJitMatmulTheSameAsNaiveImplFor(
+    onnx_mlir::ExecutionSession &sess, const int I, const int J, const int K) {
+  static int testNum = 0;
+  printf("attempt %d with i %d, j %d, k %d\n", ++testNum, I, J, K);
+
+  std::vector<unique_ptr<OMTensor, decltype(&omTensorDestroy)>> inputs;
+  inputs.emplace_back(unique_ptr<OMTensor, decltype(&omTensorDestroy)>(
+      omTensorCreateWithRandomData<float>({I, K}), omTensorDestroy));
+  inputs.emplace_back(unique_ptr<OMTensor, decltype(&omTensorDestroy)>(
+      omTensorCreateWithRandomData<float>({K, J}), omTensorDestroy));
+
+  auto ref = omTensorCreateWithShape<float>({I, J});
+  auto &a = inputs.at(0);
+  auto &b = inputs.at(1);
+  for (int64_t i = 0; i < I; ++i) {
+    for (int64_t j = 0; j < J; ++j) {
+      omTensorGetElem<float>(ref, {i, j}) = 0;
+      for (int64_t k = 0; k < K; k++) {
+        omTensorGetElem<float>(ref, {i, j}) +=
+            omTensorGetElem<float>(a.get(), {i, k}) *
+            omTensorGetElem<float>(b.get(), {k, j});
+      }
+    }
+  }
+
+  auto outputs = sess.run(move(inputs));
+  auto &Matmul = outputs.at(0);
+
+  float rtol = getenv("TEST_RTOL") ? atof(getenv("TEST_RTOL")) : 1e-5;
+  float atol = getenv("TEST_ATOL") ? atof(getenv("TEST_ATOL")) : 1e-5;
+
+  return omTensorAreTwoOmtsClose<float>(Matmul.get(), ref, rtol, atol);
+}
+
+int main(int argc, char *argv[]) {
+  setExecPath(argv[0], (void *)main);
+
+  // The model is compiled once, with its dynamic shapes, for all the runs.
+  MLIRContext ctx;
+  registerDialects(ctx);
+  OwningModuleRef moduleRef(parseSourceString(testMatMulIR, &ctx));
+  onnx_mlir::ExecutionSession sess(moduleRef, "run_main_graph");
+
+  printf("RapidCheck test case generation.\n");
+  bool success = rc::check("Jit Matmul implementation correctness", [&]() {
+    const auto I = *rc::gen::inRange(1, 50);
+    const auto J = *rc::gen::inRange(1, 50);
+    const auto K = *rc::gen::inRange(1, 50);
+
+    RC_ASSERT(isJitMatmulTheSameAsNaiveImplFor(sess, I, J, K));
+  });
+  if (!success)
+    return 1;
+
+  return 0;
+}
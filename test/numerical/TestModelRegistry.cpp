@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <future>
+#include <iostream>
+#include <rapidcheck.h>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "src/MainUtils.hpp"
+#include "src/Runtime/ModelRegistry.hpp"
+#include "src/Runtime/OMTensorHelper.h"
+
+#define TRIPLE_LIB_BASE string("./TestModelRegistry_triple")
+#define CUBE_LIB_BASE string("./TestModelRegistry_cube")
+
+using namespace std;
+using namespace mlir;
+
+// Two models with the same function and entry point names, whose temporary
+// buffers are kept in memory arenas with the same identifier in each library.
+std::string testTripleIR = R"(
+module {
+  func @main_graph(%arg0: tensor<?x8xf32>) -> tensor<?x8xf32> {
+    %0 = "onnx.Add"(%arg0, %arg0) : (tensor<?x8xf32>, tensor<?x8xf32>) -> tensor<?x8xf32>
+    %1 = "onnx.Add"(%0, %arg0) : (tensor<?x8xf32>, tensor<?x8xf32>) -> tensor<?x8xf32>
+    return %1 : tensor<?x8xf32>
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[    ]"} : () -> ()
+})";
+
+std::string testCubeIR = R"(
+module {
+  func @main_graph(%arg0: tensor<?x8xf32>) -> tensor<?x8xf32> {
+    %0 = "onnx.Mul"(%arg0, %arg0) : (tensor<?x8xf32>, tensor<?x8xf32>) -> tensor<?x8xf32>
+    %1 = "onnx.Mul"(%0, %arg0) : (tensor<?x8xf32>, tensor<?x8xf32>) -> tensor<?x8xf32>
+    return %1 : tensor<?x8xf32>
+  }
+  "onnx.EntryPoint"() {func = @main_graph, numInputs = 1 : i32, numOutputs = 1 : i32, signature = "[    ]"} : () -> ()
+})";
+
+void compileIR(const std::string &ir, const string &outputBaseName) {
+  MLIRContext ctx;
+  registerDialects(ctx);
+  OwningModuleRef moduleRef(parseSourceString(ir, &ctx));
+  compileModule(moduleRef, ctx, outputBaseName, EmitLib);
+}
+
+// Returns whether the requests of both models, served at the same time by
+// the registry, produce the results of their own model.
+bool areModelsKeptApartFor(onnx_mlir::ModelRegistry &registry, const int I) {
+  static int testNum = 0;
+  printf("attempt %d with i %d\n", ++testNum, I);
+
+  vector<string> names = {"triple", "cube"};
+  vector<OMTensor *> refs;
+  vector<future<vector<onnx_mlir::OMTensorUniquePtr>>> outputs;
+  for (const string &name : names) {
+    vector<onnx_mlir::OMTensorUniquePtr> inputs;
+    inputs.emplace_back(onnx_mlir::OMTensorUniquePtr(
+        omTensorCreateWithRandomData<float>({I, 8}), omTensorDestroy));
+    auto ref = omTensorCreateWithShape<float>({I, 8});
+    for (int64_t i = 0; i < I; ++i)
+      for (int64_t j = 0; j < 8; ++j) {
+        float x = omTensorGetElem<float>(inputs.at(0).get(), {i, j});
+        omTensorGetElem<float>(ref, {i, j}) =
+            name == "triple" ? x + x + x : x * x * x;
+      }
+    refs.emplace_back(ref);
+    outputs.emplace_back(registry.runAsync(name, move(inputs)));
+  }
+
+  float rtol = getenv("TEST_RTOL") ? atof(getenv("TEST_RTOL")) : 1e-5;
+  float atol = getenv("TEST_ATOL") ? atof(getenv("TEST_ATOL")) : 1e-5;
+
+  bool same = true;
+  for (size_t m = 0; m < refs.size(); ++m) {
+    auto outs = outputs[m].get();
+    same &=
+        omTensorAreTwoOmtsClose<float>(outs.at(0).get(), refs[m], rtol, atol);
+    omTensorDestroy(refs[m]);
+  }
+  return same;
+}
+
+int main(int argc, char *argv[]) {
+  setExecPath(argv[0], (void *)main);
+  // The temporary buffers of the models are kept across inferences.
+  const char *compileArgs[] = {argv[0], "--memPoolArena=shared"};
+  llvm::cl::ParseCommandLineOptions(2, compileArgs, "");
+  llvm::FileRemover tripleRemover(TRIPLE_LIB_BASE + ".so");
+  llvm::FileRemover cubeRemover(CUBE_LIB_BASE + ".so");
+
+  compileIR(testTripleIR, TRIPLE_LIB_BASE);
+  compileIR(testCubeIR, CUBE_LIB_BASE);
+  onnx_mlir::ModelRegistry registry(/*numRunners=*/2, /*numThreads=*/0,
+      /*pooling=*/true, getRuntimeDir() + "/libcruntime_shared.so");
+  registry.load("triple", TRIPLE_LIB_BASE + ".so");
+  registry.load("cube", CUBE_LIB_BASE + ".so");
+
+  printf("RapidCheck test case generation.\n");
+  bool success = rc::check("ModelRegistry serving two models", [&]() {
+    const auto I = *rc::gen::inRange(1, 50);
+
+    RC_ASSERT(areModelsKeptApartFor(registry, I));
+  });
+  if (!success)
+    return 1;
+
+  return 0;
+}
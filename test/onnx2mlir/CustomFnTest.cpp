@@ -3,6 +3,7 @@
  */
 
 #include <iostream>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -93,6 +94,11 @@ void testCustomFunTranslation() {
   t->set_name("t");
   t->mutable_type()->mutable_tensor_type()->set_elem_type(elt_type);
 
+  // The nodes that do not feed an output are not imported.
+  auto *tOutput = graph->add_output();
+  tOutput->set_name("t");
+  tOutput->mutable_type()->mutable_tensor_type()->set_elem_type(elt_type);
+
   node = graph->add_node();
   node->add_input("x");
   node->add_output("t");
@@ -224,10 +230,113 @@ void testOptionalParameter() {
   check(model_proto);
 }
 
+// Add to `values` a value named `name` of 10 float elements.
+void addFloatValue(google::protobuf::RepeatedPtrField<ValueInfoProto> *values,
+    const string &name) {
+  auto *value = values->Add();
+  value->set_name(name);
+  auto *type = value->mutable_type()->mutable_tensor_type();
+  type->set_elem_type(TensorProto_DataType::TensorProto_DataType_FLOAT);
+  type->mutable_shape()->add_dim()->set_dim_value(10);
+}
+
+// Add to the node a graph attribute returning the identity of `input`.
+void addIdentityBranch(
+    NodeProto *node, const string &attrName, const string &input) {
+  auto *attr = node->add_attribute();
+  attr->set_name(attrName);
+  attr->set_type(AttributeProto::GRAPH);
+  auto *branch = attr->mutable_g();
+  branch->set_name(node->name() + "_" + attrName);
+  auto *identity = branch->add_node();
+  identity->add_input(input);
+  identity->add_output(branch->name() + "_out");
+  identity->set_op_type("Identity");
+  addFloatValue(branch->mutable_output(), branch->name() + "_out");
+}
+
+// Return whether the nodes imported from the model are exactly `expected`.
+bool checkImportedNodes(ModelProto &model,
+    const vector<string> &prunedOutputs, const set<string> &expected) {
+  mlir::MLIRContext context;
+  registerDialects(context);
+  mlir::OwningModuleRef module;
+
+  onnx_mlir::ImportOptions options;
+  options.useOnnxModelTypes = true;
+  options.prunedOutputs = prunedOutputs;
+  onnx_mlir::ImportFrontendModel(model, context, module, options);
+
+  set<string> imported;
+  module->walk([&](mlir::Operation *op) {
+    if (auto name = op->getAttrOfType<mlir::StringAttr>("onnx_node_name"))
+      imported.insert(name.getValue().str());
+  });
+  if (imported == expected)
+    return true;
+  std::cerr << "unexpected nodes imported:";
+  for (const string &name : imported)
+    std::cerr << " " << name;
+  std::cerr << std::endl;
+  return false;
+}
+
+bool testPruneDeadNodes() {
+  ModelProto model_proto;
+  model_proto.set_ir_version(7);
+  auto *opset_version = model_proto.add_opset_import();
+  opset_version->set_domain(ONNX_DOMAIN);
+  opset_version->set_version(ONNX_OPSET_VERSION);
+
+  auto *graph = model_proto.mutable_graph();
+  addFloatValue(graph->mutable_input(), "x");
+  auto *c = graph->add_input();
+  c->set_name("c");
+  auto *c_type = c->mutable_type()->mutable_tensor_type();
+  c_type->set_elem_type(TensorProto_DataType::TensorProto_DataType_BOOL);
+  c_type->mutable_shape();
+
+  addFloatValue(graph->mutable_output(), "y");
+  addFloatValue(graph->mutable_output(), "p");
+
+  auto addNode = [&](const string &name, const string &opType,
+                     const vector<string> &inputs, const string &output) {
+    auto *node = graph->add_node();
+    node->set_name(name);
+    node->set_op_type(opType);
+    for (const string &input : inputs)
+      node->add_input(input);
+    node->add_output(output);
+    return node;
+  };
+
+  // The output y is computed by an If whose then branch reads b, computed
+  // outside of the If.
+  addNode("relu", "Relu", {"x"}, "a");
+  addNode("neg", "Neg", {"x"}, "b");
+  auto *liveIf = addNode("live_if", "If", {"c"}, "y");
+  addIdentityBranch(liveIf, "then_branch", "b");
+  addIdentityBranch(liveIf, "else_branch", "a");
+
+  // A dead branch, with a node only read by the subgraph of a dead If.
+  addNode("sigmoid", "Sigmoid", {"x"}, "d");
+  addNode("exp", "Exp", {"x"}, "e");
+  auto *deadIf = addNode("dead_if", "If", {"c"}, "q");
+  addIdentityBranch(deadIf, "then_branch", "e");
+  addIdentityBranch(deadIf, "else_branch", "d");
+
+  // The output p is pruned, so the node only computing it is dead.
+  addNode("tanh", "Tanh", {"x"}, "p");
+
+  return checkImportedNodes(model_proto, {"p"}, {"relu", "neg", "live_if"});
+}
+
 int main(int argc, char *argv[]) {
   testCustomFunTranslation();
   testUseOfOnnxModelTypes();
   testOptionalParameter();
+  if (!testPruneDeadNodes())
+    return 1;
 
   return 0;
 }
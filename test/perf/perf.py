@@ -0,0 +1,266 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+##################### perf.py ##################################################
+#
+# Performance regression tests of onnx-mlir on end-to-end models.
+#
+# Each model is compiled with onnx-mlir, and the compile time, the size of the
+# shared library, the peak memory of the process running the inferences and
+# the median latency of the inferences are compared with the ones stored in a
+# baseline file. The tests fail when a metric exceeds its baseline by more
+# than its tolerance. The baseline depends on the machine running the tests;
+# it is created, and updated after an expected change, with --update-baseline.
+#
+################################################################################
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+import numpy as np
+import onnx
+from onnx import helper, numpy_helper, TensorProto
+
+import test_config
+
+ZOO_URL = "https://github.com/onnx/models/raw/master/"
+
+# Models of the ONNX model zoo, downloaded once. The dimensions of the inputs
+# left symbolic in the models, e.g. the batch size, are set to 1.
+ZOO_MODELS = {
+    "resnet50":
+        "vision/classification/resnet/model/resnet50-v1-7.onnx",
+    "mobilenetv2":
+        "vision/classification/mobilenet/model/mobilenetv2-7.onnx",
+    "bert-base":
+        "text/machine_comprehension/bert-squad/model/bertsquad-10.onnx",
+}
+
+# Tolerances of the metrics, as fractions of their baseline. The latencies
+# and compile times are noisier than the sizes.
+TOLERANCES = {
+    "compile_seconds": 0.2,
+    "library_bytes": 0.05,
+    "peak_memory_bytes": 0.1,
+    "latency_seconds": 0.1,
+}
+
+ONNX_HOME = os.getenv("ONNX_HOME", os.path.expanduser("~/.onnx"))
+
+parser = argparse.ArgumentParser(
+    description='end-to-end performance regression tests of onnx-mlir.')
+parser.add_argument('--models', type=str,
+    default=",".join(list(ZOO_MODELS) + ["lstm"]),
+    help='comma separated models to test (default: all)')
+parser.add_argument('--baseline', type=str,
+    default=os.getenv("PERF_BASELINE",
+        os.path.join(test_config.PERF_SOURCE_DIR, "baseline.json")),
+    help='baseline file (default: PERF_BASELINE env var or baseline.json '
+    'next to this script)')
+parser.add_argument('--update-baseline', action='store_true',
+    help='store the measured metrics as the baseline instead of checking them')
+parser.add_argument('--tolerance', type=float, default=None,
+    help='tolerance of all the metrics, as a fraction of their baseline')
+parser.add_argument('--iterations', type=int, default=20,
+    help='number of timed inferences (default: 20)')
+parser.add_argument('--warmup', type=int, default=3,
+    help='number of inferences before the timed ones (default: 3)')
+parser.add_argument('--mcpu', type=str, default=os.getenv("TEST_MCPU", ""),
+    help='target a specific cpu, passed to the compiler')
+parser.add_argument('-v', '--verbose', action='store_true',
+    help='verbose output')
+# Used by the test itself to run the inferences in a separate process.
+parser.add_argument('--run-library', type=str, help=argparse.SUPPRESS)
+parser.add_argument('--run-inputs', type=str, help=argparse.SUPPRESS)
+args = parser.parse_args()
+
+
+def build_lstm_model(path):
+    """A single layer LSTM, with a sequence of 64, a batch of 1, 256 inputs
+    and 512 hidden units."""
+    seq_length, batch_size, input_size, hidden_size = 64, 1, 256, 512
+    rng = np.random.default_rng(0)
+
+    def weight(name, shape):
+        data = rng.uniform(-0.1, 0.1, shape).astype(np.float32)
+        return numpy_helper.from_array(data, name)
+
+    initializers = [
+        weight("W", [1, 4 * hidden_size, input_size]),
+        weight("R", [1, 4 * hidden_size, hidden_size]),
+        weight("B", [1, 8 * hidden_size]),
+    ]
+    node = helper.make_node("LSTM", inputs=["X", "W", "R", "B"],
+        outputs=["Y"], hidden_size=hidden_size)
+    graph = helper.make_graph([node], "lstm",
+        [helper.make_tensor_value_info("X", TensorProto.FLOAT,
+            [seq_length, batch_size, input_size])],
+        [helper.make_tensor_value_info("Y", TensorProto.FLOAT, None)],
+        initializers)
+    onnx.save(helper.make_model(graph), path)
+
+
+def get_model(name, result_dir):
+    """Return the path of the model, with its symbolic dimensions set."""
+    if name == "lstm":
+        path = os.path.join(result_dir, name + ".onnx")
+        build_lstm_model(path)
+        return path
+    if name not in ZOO_MODELS:
+        sys.exit("unknown model: " + name)
+    cached = os.path.join(ONNX_HOME, "models",
+        os.path.basename(ZOO_MODELS[name]))
+    if not os.path.exists(cached):
+        print("  downloading", ZOO_URL + ZOO_MODELS[name])
+        os.makedirs(os.path.dirname(cached), exist_ok=True)
+        urllib.request.urlretrieve(ZOO_URL + ZOO_MODELS[name], cached + ".tmp")
+        os.rename(cached + ".tmp", cached)
+    model = onnx.load(cached)
+    for value_info in model.graph.input:
+        for dim in value_info.type.tensor_type.shape.dim:
+            if not dim.HasField("dim_value"):
+                dim.dim_value = 1
+    path = os.path.join(result_dir, name + ".onnx")
+    onnx.save(model, path)
+    return path
+
+
+def create_inputs(model_path, inputs_path):
+    """Write random inputs of the model. The integer inputs, e.g. the token
+    ids of BERT, are zeros, which are valid indices."""
+    model = onnx.load(model_path)
+    initializers = {tensor.name for tensor in model.graph.initializer}
+    inputs = []
+    for value_info in model.graph.input:
+        if value_info.name in initializers:
+            continue
+        tensor_type = value_info.type.tensor_type
+        shape = [dim.dim_value for dim in tensor_type.shape.dim]
+        dtype = onnx.mapping.TENSOR_TYPE_TO_NP_TYPE[tensor_type.elem_type]
+        if np.issubdtype(dtype, np.floating):
+            inputs.append(np.random.uniform(-1, 1, shape).astype(dtype))
+        else:
+            inputs.append(np.zeros(shape, dtype))
+    np.savez(inputs_path, *inputs)
+
+
+def run_library():
+    """Run the inferences, in the process whose peak memory is measured."""
+    sys.path.append(test_config.TEST_DRIVER_RUNTIME_PATH)
+    from PyRuntime import ExecutionSession
+
+    session = ExecutionSession(args.run_library, "run_main_graph")
+    saved = np.load(args.run_inputs)
+    inputs = [saved["arr_%d" % i] for i in range(len(saved.files))]
+    for _ in range(args.warmup):
+        session.run(inputs)
+    times = []
+    for _ in range(max(args.iterations, 1)):
+        start = time.perf_counter()
+        session.run(inputs)
+        times.append(time.perf_counter() - start)
+    times.sort()
+    print(json.dumps({"latency_seconds": times[len(times) // 2]}))
+
+
+def measure(name, result_dir):
+    """Compile the model and run its inferences, return its metrics."""
+    model_path = get_model(name, result_dir)
+    library_path = os.path.splitext(model_path)[0] + ".so"
+    command = [test_config.TEST_DRIVER_PATH]
+    if args.mcpu:
+        command.append("--mcpu=" + args.mcpu)
+    command.append(model_path)
+    if args.verbose:
+        print("  " + " ".join(command))
+    start = time.perf_counter()
+    if subprocess.run(command).returncode != 0:
+        sys.exit("failed to compile " + name)
+    compile_seconds = time.perf_counter() - start
+
+    inputs_path = os.path.join(result_dir, name + ".npz")
+    create_inputs(model_path, inputs_path)
+    output_path = os.path.join(result_dir, name + ".json")
+    with open(output_path, "w") as output:
+        process = subprocess.Popen([sys.executable, __file__,
+            "--run-library", library_path, "--run-inputs", inputs_path,
+            "--iterations", str(args.iterations),
+            "--warmup", str(args.warmup)], stdout=output)
+        # The usage of this process alone, rather than of all the children.
+        _, status, usage = os.wait4(process.pid, 0)
+        process.returncode = status
+    if status != 0:
+        sys.exit("failed to run " + name)
+    with open(output_path) as output:
+        metrics = json.load(output)
+
+    metrics["compile_seconds"] = compile_seconds
+    metrics["library_bytes"] = os.path.getsize(library_path)
+    # ru_maxrss is in bytes on macOS and in kilobytes elsewhere.
+    metrics["peak_memory_bytes"] = usage.ru_maxrss * \
+        (1 if sys.platform == "darwin" else 1024)
+    return metrics
+
+
+def check(name, metrics, baseline):
+    """Print the metrics against the baseline, return whether none
+    regressed."""
+    success = True
+    for metric in TOLERANCES:
+        value = metrics[metric]
+        if metric not in baseline:
+            print("  %-20s %14.6g (no baseline)" % (metric, value))
+            continue
+        reference = baseline[metric]
+        tolerance = args.tolerance if args.tolerance is not None \
+            else TOLERANCES[metric]
+        change = (value - reference) / reference if reference else 0
+        regressed = change > tolerance
+        success &= not regressed
+        print("  %-20s %14.6g %+7.1f%% (baseline %g, tolerance %.0f%%)%s" % (
+            metric, value, change * 100, reference, tolerance * 100,
+            " REGRESSION" if regressed else ""))
+    return success
+
+
+def main():
+    if args.run_library:
+        run_library()
+        return 0
+
+    baselines = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as baseline_file:
+            baselines = json.load(baseline_file)
+    elif not args.update_baseline:
+        print("No baseline at " + args.baseline +
+            ", create it with --update-baseline.")
+
+    success = True
+    with tempfile.TemporaryDirectory() as result_dir:
+        for name in args.models.split(","):
+            print(name)
+            metrics = measure(name, result_dir)
+            success &= check(name, metrics, baselines.get(name, {}))
+            if args.update_baseline:
+                baselines[name] = metrics
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(baselines, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        print("Baseline written to " + args.baseline)
+        return 0
+    if not success:
+        print("Performance regressions detected.")
+    return 0 if success else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,70 @@
+//===---------------- OMAllocTest.c - OMAlloc Unit Test -------------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the block allocator of the runtime and of
+// the OMTensors using it.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "OnnxMlirRuntime.h"
+
+void testAlignment() {
+  void *block = omAllocBlock(3);
+  assert(block);
+  assert((uintptr_t)block % 64 == 0);
+  omFreeBlock(block, 3);
+  /* Blocks larger than the pooled classes are still aligned. */
+  block = omAllocBlock((int64_t)1 << 25);
+  assert(block);
+  assert((uintptr_t)block % 64 == 0);
+  omFreeBlock(block, (int64_t)1 << 25);
+}
+
+void testPooling() {
+  omAllocSetPooling(1);
+  void *block = omAllocBlock(100);
+  omFreeBlock(block, 100);
+  /* Sizes of the same class reuse the released block. */
+  assert(omAllocBlock(128) == block);
+  omFreeBlock(block, 128);
+  omAllocRelease();
+  omAllocSetPooling(0);
+}
+
+void testTensorStructs() {
+  omAllocSetPooling(1);
+  int64_t shape[] = {2, 3, 4};
+  OMTensor *tensor = omTensorCreateEmpty(shape, 3, ONNX_TYPE_FLOAT);
+  assert(tensor);
+  assert(omTensorGetStrides(tensor)[0] == 12);
+  void *data = omTensorGetDataPtr(tensor);
+  omTensorDestroy(tensor);
+  /* A tensor of the same size reuses the struct and the data buffer. */
+  OMTensor *other = omTensorCreateEmpty(shape, 3, ONNX_TYPE_INT32);
+  assert(other == tensor);
+  assert(omTensorGetDataPtr(other) == data);
+  omTensorDestroy(other);
+
+  /* Shapes and strides larger than the inline storage. */
+  int64_t largeShape[] = {1, 2, 1, 2, 1, 2, 1, 2};
+  tensor = omTensorCreateEmpty(largeShape, 8, ONNX_TYPE_DOUBLE);
+  assert(tensor);
+  assert(omTensorGetNumElems(tensor) == 16);
+  assert(omTensorGetStrides(tensor)[0] == 16);
+  omTensorDestroy(tensor);
+  omAllocRelease();
+  omAllocSetPooling(0);
+}
+
+int main() {
+  testAlignment();
+  testPooling();
+  testTensorStructs();
+  return 0;
+}
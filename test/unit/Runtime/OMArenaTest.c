@@ -0,0 +1,95 @@
+//===---------------- OMArenaTest.c - OMArena Unit Test -------------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the memory arenas keeping the memory pools
+// of compiled models across inferences.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "OnnxMlirRuntime.h"
+
+static void *getThreadArena(void *args) {
+  void *buffer = omArenaGet(0, 256, 64, /*threadLocal=*/1);
+  assert(buffer);
+  assert(omArenaGet(0, 256, 64, /*threadLocal=*/1) == buffer);
+  return buffer;
+}
+
+void testSharedArena() {
+  void *buffer = omArenaGet(3, 100, 64, /*threadLocal=*/0);
+  assert(buffer);
+  assert((uintptr_t)buffer % 64 == 0);
+  assert(omArenaGet(3, 100, 64, /*threadLocal=*/0) == buffer);
+  assert(omArenaGet(1, 100, 0, /*threadLocal=*/0) != buffer);
+}
+
+void testThreadLocalArena() {
+  void *buffer = getThreadArena(NULL);
+  pthread_t thread;
+  void *threadBuffer;
+  pthread_create(&thread, NULL, getThreadArena, NULL);
+  pthread_join(thread, &threadBuffer);
+  assert(threadBuffer != buffer);
+}
+
+void testHighWaterMark() {
+  void *buffer = omArenaGet(5, 64, 0, /*threadLocal=*/0);
+  assert(buffer);
+  assert(omArenaGetHighWaterMark(5, /*threadLocal=*/0) == 64);
+  /* Smaller requests reuse the buffer. */
+  assert(omArenaGet(5, 32, 0, /*threadLocal=*/0) == buffer);
+  assert(omArenaGetHighWaterMark(5, /*threadLocal=*/0) == 64);
+  /* Larger requests raise the high-water mark. */
+  assert(omArenaGet(5, 1024, 0, /*threadLocal=*/0));
+  assert(omArenaGetHighWaterMark(5, /*threadLocal=*/0) == 1024);
+  assert(omArenaGetHighWaterMark(6, /*threadLocal=*/0) == 0);
+  assert(omArenaGetTotalSize(/*threadLocal=*/0) >= 1024);
+}
+
+void testZeroedArena() {
+  int64_t *buffer = (int64_t *)omArenaGetZeroed(7, 64, 0, /*threadLocal=*/0);
+  assert(buffer);
+  for (int i = 0; i < 8; ++i)
+    assert(buffer[i] == 0);
+  /* The content is kept by the next calls. */
+  buffer[3] = 42;
+  assert(omArenaGetZeroed(7, 64, 0, /*threadLocal=*/0) == buffer);
+  assert(buffer[3] == 42);
+  /* And zeroed again once the arena is reallocated. */
+  buffer = (int64_t *)omArenaGetZeroed(7, 128, 0, /*threadLocal=*/0);
+  assert(buffer);
+  for (int i = 0; i < 16; ++i)
+    assert(buffer[i] == 0);
+}
+
+void testReserveIds() {
+  int64_t firstBase = -1, secondBase = -1;
+  int64_t first = omArenaReserveIds(&firstBase, 3);
+  assert(first >= 0 && firstBase == first);
+  /* The base is reserved once per model. */
+  assert(omArenaReserveIds(&firstBase, 3) == first);
+  /* The identifiers of the models do not overlap. */
+  int64_t second = omArenaReserveIds(&secondBase, 2);
+  assert(second >= first + 3 && secondBase == second);
+  assert(omArenaGet(first, 64, 0, /*threadLocal=*/0) !=
+         omArenaGet(second, 64, 0, /*threadLocal=*/0));
+}
+
+int main() {
+  testSharedArena();
+  testThreadLocalArena();
+  testHighWaterMark();
+  testZeroedArena();
+  testReserveIds();
+  omArenaRelease();
+  assert(omArenaGet(3, 100, 64, /*threadLocal=*/0));
+  omArenaRelease();
+  return 0;
+}
@@ -0,0 +1,85 @@
+//===---------------- OMBatchTest.c - OMBatch Unit Test -------------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the inferences run in chunks of their
+// batch.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "OnnxMlirRuntime.h"
+
+/* Left out of the header, see OMTensorList.inc. */
+extern OMTensorList *omTensorListCreateWithOwnership(
+    OMTensor **tensors, int n, int owning);
+
+static int numRuns = 0;
+static int64_t maxRows = 0;
+
+/* Stands for a compiled model doubling its input of shape [N, 3]. */
+static OMTensorList *runDouble(OMTensorList *inputs) {
+  OMTensor *input = omTensorListGetOmtByIndex(inputs, 0);
+  int64_t rows = omTensorGetShape(input)[0];
+  int64_t *strides = omTensorGetStrides(input);
+  numRuns++;
+  maxRows = rows > maxRows ? rows : maxRows;
+
+  int64_t shape[] = {rows, 3};
+  OMTensor *output = omTensorCreateEmpty(shape, 2, ONNX_TYPE_FLOAT);
+  float *in = (float *)omTensorGetDataPtr(input);
+  float *out = (float *)omTensorGetDataPtr(output);
+  for (int64_t i = 0; i < rows; i++)
+    for (int64_t j = 0; j < 3; j++)
+      out[i * 3 + j] = 2 * in[i * strides[0] + j * strides[1]];
+  OMTensor **outputs = (OMTensor **)malloc(sizeof(OMTensor *));
+  outputs[0] = output;
+  return omTensorListCreateWithOwnership(outputs, 1, /*owning=*/1);
+}
+
+static void runBatch(int64_t chunkSize, int64_t expectedRuns) {
+  float data[10][3];
+  for (int i = 0; i < 10; i++)
+    for (int j = 0; j < 3; j++)
+      data[i][j] = i * 3 + j;
+  int64_t shape[] = {10, 3};
+  OMTensor *inputs[] = {omTensorCreate(data, shape, 2, ONNX_TYPE_FLOAT)};
+  OMTensorList *inputList = omTensorListCreate(inputs, 1);
+
+  omBatchSetChunkSize(chunkSize);
+  numRuns = 0;
+  maxRows = 0;
+  OMTensorList *outputs = omBatchRunInChunks((void *)runDouble, inputList);
+  assert(outputs);
+  assert(numRuns == expectedRuns);
+  assert(maxRows == (chunkSize > 0 && chunkSize < 10 ? chunkSize : 10));
+
+  OMTensor *output = omTensorListGetOmtByIndex(outputs, 0);
+  assert(omTensorGetShape(output)[0] == 10);
+  assert(omTensorGetShape(output)[1] == 3);
+  float *out = (float *)omTensorGetDataPtr(output);
+  for (int i = 0; i < 30; i++)
+    assert(out[i] == 2 * i);
+
+  omTensorListDestroy(outputs);
+  omTensorListDestroy(inputList);
+}
+
+int main() {
+  /* Not split by default. */
+  assert(omBatchGetChunkSize() == 0);
+  runBatch(0, 1);
+  /* The last chunk takes the remaining rows. */
+  runBatch(4, 3);
+  runBatch(5, 2);
+  /* Not split when the batch fits in a chunk. */
+  runBatch(16, 1);
+  omBatchSetChunkSize(-2);
+  assert(omBatchGetChunkSize() == 0);
+  return 0;
+}
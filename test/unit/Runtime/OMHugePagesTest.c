@@ -0,0 +1,85 @@
+//===------------- OMHugePagesTest.c - OMHugePages Unit Test --------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the huge pages backing the memory arenas
+// and the weights of compiled models.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "OnnxMlirRuntime.h"
+
+#define HUGE_PAGE_SIZE ((int64_t)2 << 20)
+
+static int64_t getHugePagesBytes() {
+  int64_t hugetlbBytes, advisedBytes;
+  omHugePagesGetStats(&hugetlbBytes, &advisedBytes);
+  return hugetlbBytes + advisedBytes;
+}
+
+void testDisabled() {
+  int hugetlb;
+  omHugePagesSetEnabled(0);
+  assert(!omHugePagesGetEnabled());
+  assert(!omHugePagesAlloc(HUGE_PAGE_SIZE, &hugetlb));
+  void *buffer = omArenaGet(0, HUGE_PAGE_SIZE, 64, /*threadLocal=*/0);
+  assert(buffer);
+  assert(getHugePagesBytes() == 0);
+  omArenaRelease();
+}
+
+void testArena() {
+  /* Platforms without huge pages keep the regular buffers. */
+  if (omHugePagesSetEnabled(1) != 0)
+    return;
+  assert(omHugePagesGetEnabled());
+  /* Small buffers do not use huge pages. */
+  assert(omArenaGet(0, 4096, 64, /*threadLocal=*/0));
+  assert(getHugePagesBytes() == 0);
+
+  char *buffer =
+      (char *)omArenaGet(1, HUGE_PAGE_SIZE + 100, 64, /*threadLocal=*/0);
+  assert(buffer);
+  memset(buffer, 1, HUGE_PAGE_SIZE + 100);
+  if (getHugePagesBytes() > 0) {
+    assert((uintptr_t)buffer % HUGE_PAGE_SIZE == 0);
+    assert(getHugePagesBytes() == 2 * HUGE_PAGE_SIZE);
+  }
+  omArenaRelease();
+  assert(getHugePagesBytes() == 0);
+  omHugePagesSetEnabled(0);
+}
+
+void testWeights() {
+  static const char *weightsPath = "OMHugePagesTest.weights";
+  static char data[HUGE_PAGE_SIZE + 100];
+  for (int64_t i = 0; i < (int64_t)sizeof(data); ++i)
+    data[i] = (char)i;
+  FILE *file = fopen(weightsPath, "wb");
+  assert(file);
+  assert(fwrite(data, sizeof(data), 1, file) == 1);
+  fclose(file);
+
+  int enabled = omHugePagesSetEnabled(1) == 0;
+  void *weights = NULL;
+  assert(omWeightsLoad(&weights, weightsPath) == 0);
+  assert(weights);
+  assert(memcmp(weights, data, sizeof(data)) == 0);
+  if (enabled && getHugePagesBytes() > 0)
+    assert((uintptr_t)weights % HUGE_PAGE_SIZE == 0);
+  omHugePagesSetEnabled(0);
+  remove(weightsPath);
+}
+
+int main() {
+  testDisabled();
+  testArena();
+  testWeights();
+  return 0;
+}
@@ -0,0 +1,182 @@
+//===--------------- OMInstrumentTest.c - OMInstrument Unit Test ----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the profiler of the ONNX operations of the
+// models compiled with `--instrument`. The instrumentation points are called
+// the way the models call them.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "OnnxMlirRuntime.h"
+
+static const char *profilePath = "OMInstrumentTest.profile";
+
+/* Read the whole profile, to be freed by the caller. */
+static char *readProfile() {
+  FILE *file = fopen(profilePath, "rb");
+  assert(file);
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *profile = (char *)malloc(size + 1);
+  assert(fread(profile, 1, size, file) == (size_t)size);
+  profile[size] = '\0';
+  fclose(file);
+  return profile;
+}
+
+static void runOp(const char *opName, const char *nodeName, int64_t bytes) {
+  omInstrumentPoint(opName, nodeName, 0, 0);
+  omInstrumentPoint(opName, nodeName, 1, bytes);
+}
+
+void testEnable() {
+  omInstrumentReset();
+  omInstrumentSetEnabled(0);
+  assert(!omInstrumentGetEnabled());
+  runOp("Relu", "relu", 16);
+  assert(omInstrumentGetNumRecords() == 0);
+
+  omInstrumentSetEnabled(1);
+  assert(omInstrumentGetEnabled());
+  runOp("Relu", "relu", 16);
+  assert(omInstrumentGetNumRecords() == 1);
+
+  /* Operations started while disabled are not recorded. */
+  omInstrumentSetEnabled(0);
+  omInstrumentPoint("Relu", "relu", 0, 0);
+  omInstrumentSetEnabled(1);
+  omInstrumentPoint("Relu", "relu", 1, 16);
+  assert(omInstrumentGetNumRecords() == 1);
+  /* Unmatched ends are ignored. */
+  omInstrumentPoint("Relu", "relu", 1, 16);
+  assert(omInstrumentGetNumRecords() == 1);
+
+  omInstrumentReset();
+  assert(omInstrumentGetNumRecords() == 0);
+}
+
+void testCsv() {
+  omInstrumentReset();
+  omInstrumentSetEnabled(1);
+  /* The body of a Loop runs nested in the Loop. */
+  omInstrumentPoint("Loop", "loop", 0, 0);
+  runOp("Conv", "conv,1", 4096);
+  omInstrumentPoint("Loop", "loop", 1, 64);
+  assert(omInstrumentGetNumRecords() == 2);
+
+  assert(omInstrumentDump(profilePath, OM_INSTRUMENT_CSV) == 0);
+  char *profile = readProfile();
+  /* The records are in the order of the ends of the operations. */
+  const char *head = "op,node,thread,start_ns,duration_ns,output_bytes\n"
+                     "Conv,\"conv,1\",0,";
+  assert(strncmp(profile, head, strlen(head)) == 0);
+  char *loop = strstr(profile, "\nLoop,loop,0,0,");
+  assert(loop);
+  assert(strstr(loop, ",64\n"));
+  free(profile);
+  remove(profilePath);
+}
+
+void testChromeTrace() {
+  omInstrumentReset();
+  omInstrumentSetEnabled(1);
+  runOp("MatMul", "node \"a\"", 128);
+  assert(omInstrumentDump(profilePath, OM_INSTRUMENT_CHROME_TRACE) == 0);
+  char *profile = readProfile();
+  assert(strncmp(profile, "{\"traceEvents\":[", 16) == 0);
+  assert(strstr(
+      profile, "{\"name\":\"MatMul\",\"cat\":\"onnx\",\"ph\":\"X\","));
+  assert(strstr(profile, "\"node\":\"node \\\"a\\\"\",\"output_bytes\":128}"));
+  free(profile);
+  remove(profilePath);
+  assert(omInstrumentDump("missing/OMInstrumentTest.profile",
+             OM_INSTRUMENT_CSV) == -1);
+}
+
+void testCounters() {
+  omInstrumentReset();
+  omInstrumentSetEnabled(1);
+  if (omInstrumentSetCounters(1) != 0) {
+    /* Not supported on this platform. */
+    assert(!omInstrumentGetCounters());
+    return;
+  }
+  assert(omInstrumentGetCounters());
+  runOp("Conv", "conv", 64);
+  assert(omInstrumentGetNumRecords() == 1);
+  assert(omInstrumentDump(profilePath, OM_INSTRUMENT_CSV) == 0);
+  char *profile = readProfile();
+  /* perf_event_open may be forbidden, then no counter is read. */
+  const char *head = "op,node,thread,start_ns,duration_ns,output_bytes";
+  assert(strncmp(profile, head, strlen(head)) == 0);
+  const char *counters =
+      ",cycles,instructions,llc_misses,vector_instructions\n";
+  char *header = profile + strlen(head);
+  assert(*header == '\n' || strncmp(header, counters, strlen(counters)) == 0);
+  free(profile);
+  remove(profilePath);
+
+  omInstrumentSetCounters(0);
+  assert(!omInstrumentGetCounters());
+  omInstrumentReset();
+}
+
+void testMemoryPools() {
+  omInstrumentReset();
+  omInstrumentSetEnabled(1);
+  /* A dynamic pool allocated and freed in the body of an operation. */
+  runOp("MemoryPool", "static", 1024);
+  omInstrumentPoint("Conv", "conv", 0, 0);
+  runOp("MemoryPool", "dynamic", 4096);
+  runOp("MemoryPoolFree", "dynamic", 4096);
+  omInstrumentPoint("Conv", "conv", 1, 64);
+  runOp("MemoryPool", "dynamic arena", 512);
+  runOp("MemoryPoolFree", "static", 1024);
+
+  OMMemoryPoolStats stats;
+  omInstrumentGetMemoryPoolStats(&stats);
+  assert(stats.numAllocations == 3);
+  assert(stats.totalBytes == 1024 + 4096 + 512);
+  assert(stats.dynamicBytes == 4096 + 512);
+  assert(stats.maxBytes == 4096);
+  assert(stats.peakBytes == 1024 + 4096);
+  assert(stats.durationNs >= 0);
+
+  omInstrumentReset();
+  omInstrumentGetMemoryPoolStats(&stats);
+  assert(stats.numAllocations == 0 && stats.peakBytes == 0);
+  omInstrumentSetEnabled(0);
+}
+
+static void opsBody(int64_t lb, int64_t ub, int64_t step, void *args) {
+  for (int64_t i = lb; i < ub; i += step)
+    runOp("Add", "add", 8);
+}
+
+void testThreads() {
+  omInstrumentReset();
+  omInstrumentSetEnabled(1);
+  omThreadPoolParallelFor(0, 1000, 1, opsBody, NULL);
+  assert(omInstrumentGetNumRecords() == 1000);
+  omInstrumentReset();
+  omInstrumentSetEnabled(0);
+}
+
+int main() {
+  testEnable();
+  testCsv();
+  testChromeTrace();
+  testCounters();
+  testMemoryPools();
+  testThreads();
+  return 0;
+}
@@ -0,0 +1,56 @@
+//===----------- OMMicroKernelTest.c - OMMicroKernel Unit Test ------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the matrix multiply microkernels called by
+// compiled models.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "OnnxMlirRuntime.h"
+
+// Leading dimensions larger than the tiles, as for tiles within buffers.
+#define LDA 13
+#define LDB 20
+#define LDC 24
+#define MAX_K 11
+
+static float A[OM_MICRO_KERNEL_MAX_ROWS * LDA];
+static float B[MAX_K * LDB];
+static float C[OM_MICRO_KERNEL_MAX_ROWS * LDC];
+static float expected[OM_MICRO_KERNEL_MAX_ROWS * LDC];
+
+void testMatmul(int64_t I, int64_t J, int64_t K) {
+  for (int64_t i = 0; i < OM_MICRO_KERNEL_MAX_ROWS * LDA; ++i)
+    A[i] = (float)(i % 7) - 3.0f;
+  for (int64_t i = 0; i < MAX_K * LDB; ++i)
+    B[i] = (float)(i % 5) * 0.5f;
+  for (int64_t i = 0; i < OM_MICRO_KERNEL_MAX_ROWS * LDC; ++i)
+    expected[i] = C[i] = (float)(i % 3);
+  for (int64_t i = 0; i < I; ++i)
+    for (int64_t j = 0; j < J; ++j)
+      for (int64_t k = 0; k < K; ++k)
+        expected[i * LDC + j] += A[i * LDA + k] * B[k * LDB + j];
+
+  omMatmulMicroKernelF32(I, J, K, A, LDA, B, LDB, C, LDC);
+  // The elements out of the tile of C are left untouched.
+  for (int64_t i = 0; i < OM_MICRO_KERNEL_MAX_ROWS * LDC; ++i)
+    assert(fabsf(C[i] - expected[i]) <= 1e-4f * fabsf(expected[i]) + 1e-4f);
+}
+
+int main() {
+  // Tuned kernels of 8 and 16 columns, then the generic loop nest.
+  for (int64_t I = 1; I <= OM_MICRO_KERNEL_MAX_ROWS; ++I)
+    for (int64_t K = 0; K <= MAX_K; K += 1) {
+      testMatmul(I, 8, K);
+      testMatmul(I, 16, K);
+      testMatmul(I, 5, K);
+    }
+  return 0;
+}
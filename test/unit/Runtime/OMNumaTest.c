@@ -0,0 +1,105 @@
+//===------------------ OMNumaTest.c - OMNuma Unit Test -------------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the NUMA placement of the weights, the
+// memory arenas and the worker threads of compiled models. On hosts with a
+// single node, the weights are not replicated and the tests check that the
+// calls fall back to the original data.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "OnnxMlirRuntime.h"
+
+#define NUM_WEIGHTS (1 << 16)
+
+void testTopology() {
+  int numNodes = omNumaGetNumNodes();
+  assert(numNodes >= 1);
+  int node = omNumaGetCurrentNode();
+  assert(node >= 0 && node < numNodes);
+  assert(omNumaGetNodeCpus(numNodes, NULL, 0) == -1);
+  /* Platforms without NUMA support have no CPU list. */
+  int numCpus = omNumaGetNodeCpus(node, NULL, 0);
+  if (numCpus < 0)
+    return;
+  int *cpus = (int *)malloc(numCpus * sizeof(int));
+  assert(omNumaGetNodeCpus(node, cpus, numCpus) == numCpus);
+  for (int i = 1; i < numCpus; ++i)
+    assert(cpus[i] > cpus[i - 1]);
+  free(cpus);
+}
+
+void testReplicas(int enable) {
+  float *weights = (float *)malloc(NUM_WEIGHTS * sizeof(float));
+  for (int i = 0; i < NUM_WEIGHTS; ++i)
+    weights[i] = (float)i;
+  int64_t size = NUM_WEIGHTS * sizeof(float);
+  if (omNumaSetEnabled(enable) != 0)
+    enable = 0;
+
+  assert(omNumaReplicate(weights, size) == 0);
+  const float *local = (const float *)omNumaGetLocalReplica(weights, size);
+  assert(local);
+  assert(memcmp(local, weights, size) == 0);
+  /* The data is only replicated on hosts with several nodes. */
+  if (!enable || omNumaGetNumNodes() < 2)
+    assert(local == weights);
+  else
+    assert(local != weights);
+  /* The replica is found again without copying the data. */
+  assert(omNumaGetLocalReplica(weights, size) == local);
+  /* The replicas are never released with the data, keep it alive. */
+  if (enable && local != weights)
+    return;
+  free(weights);
+}
+
+void testArena() {
+  omNumaSetEnabled(1);
+  int64_t size = NUM_WEIGHTS * sizeof(float);
+  float *buffer = (float *)omArenaGet(0, size, 64, /*threadLocal=*/1);
+  assert(buffer);
+  for (int i = 0; i < NUM_WEIGHTS; ++i)
+    buffer[i] = (float)i;
+  omArenaRelease();
+  omNumaSetEnabled(0);
+}
+
+typedef struct {
+  int64_t *iterations;
+} CountArgs;
+
+static void countBody(int64_t lb, int64_t ub, int64_t step, void *args) {
+  CountArgs *count = (CountArgs *)args;
+  for (int64_t i = lb; i < ub; i += step)
+    count->iterations[i]++;
+}
+
+void testBindThreadPool() {
+  assert(omNumaBindThreadPool(omNumaGetNumNodes()) == -1);
+  /* Platforms without thread affinity keep the pool unpinned. */
+  if (omNumaBindThreadPool(-1) != 0)
+    return;
+  int64_t iterations[1000] = {0};
+  CountArgs args = {iterations};
+  omThreadPoolParallelFor(0, 1000, 1, countBody, &args);
+  for (int i = 0; i < 1000; ++i)
+    assert(iterations[i] == 1);
+  omThreadPoolSetAffinity(NULL, 0);
+}
+
+int main() {
+  testTopology();
+  testReplicas(0);
+  testReplicas(1);
+  testArena();
+  testBindThreadPool();
+  return 0;
+}
@@ -0,0 +1,106 @@
+//===------------- OMReentrancyTest.c - Runtime Reentrancy Test -----------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains a stress test of the runtime calls made by a reentrant
+// model library, i.e. one compiled with --reentrant. Several threads run
+// inferences concurrently, each one creating its OMTensors from the pooled
+// allocator, computing in a thread-local arena with parallel loops and
+// checking that no other inference touched its data.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "OnnxMlirRuntime.h"
+
+/* Used by the generated entry points to return their outputs. */
+extern OMTensorList *omTensorListCreateWithOwnership(
+    OMTensor **tensors, int n, int owning);
+
+#define NUM_CALLERS 8
+#define NUM_INFERENCES 200
+#define NUM_ELEMS 4096
+
+typedef struct {
+  float *x1, *x2, *tmp, *y;
+} AddArgs;
+
+/* Compute y = x1 + x2 through a temporary buffer of the memory pool. */
+static void addBody(int64_t lb, int64_t ub, int64_t step, void *args) {
+  AddArgs *add = (AddArgs *)args;
+  for (int64_t i = lb; i < ub; i += step)
+    add->tmp[i] = add->x1[i] + add->x2[i];
+  for (int64_t i = lb; i < ub; i += step)
+    add->y[i] = add->tmp[i];
+}
+
+/* One inference of a model adding its two inputs. */
+static OMTensorList *runAdd(OMTensorList *input) {
+  int64_t shape[] = {NUM_ELEMS};
+  OMTensor *y = omTensorCreateEmpty(shape, 1, ONNX_TYPE_FLOAT);
+  assert(y);
+  AddArgs args;
+  args.x1 = (float *)omTensorGetDataPtr(omTensorListGetOmtByIndex(input, 0));
+  args.x2 = (float *)omTensorGetDataPtr(omTensorListGetOmtByIndex(input, 1));
+  args.tmp = (float *)omArenaGet(
+      0, NUM_ELEMS * sizeof(float), 64, /*threadLocal=*/1);
+  assert(args.tmp);
+  args.y = (float *)omTensorGetDataPtr(y);
+  omThreadPoolParallelFor(0, NUM_ELEMS, 1, addBody, &args);
+
+  OMTensor **outputs = (OMTensor **)malloc(sizeof(OMTensor *));
+  outputs[0] = y;
+  return omTensorListCreateWithOwnership(outputs, 1, /*owning=*/1);
+}
+
+static void *callerMain(void *arg) {
+  int callerId = (int)(intptr_t)arg;
+  int64_t shape[] = {NUM_ELEMS};
+  for (int n = 0; n < NUM_INFERENCES; ++n) {
+    OMTensor *x1 = omTensorCreateEmpty(shape, 1, ONNX_TYPE_FLOAT);
+    OMTensor *x2 = omTensorCreateEmpty(shape, 1, ONNX_TYPE_FLOAT);
+    assert(x1 && x2);
+    float *x1Data = (float *)omTensorGetDataPtr(x1);
+    float *x2Data = (float *)omTensorGetDataPtr(x2);
+    for (int i = 0; i < NUM_ELEMS; ++i) {
+      x1Data[i] = (float)callerId;
+      x2Data[i] = (float)(n + i % 7);
+    }
+    OMTensor *list[2] = {x1, x2};
+    OMTensorList *input = omTensorListCreate(list, 2);
+
+    OMTensorList *output = runAdd(input);
+    float *yData =
+        (float *)omTensorGetDataPtr(omTensorListGetOmtByIndex(output, 0));
+    for (int i = 0; i < NUM_ELEMS; ++i)
+      assert(yData[i] == (float)(callerId + n + i % 7));
+
+    omTensorListDestroy(output);
+    omTensorListDestroy(input);
+  }
+  return NULL;
+}
+
+void testConcurrentInferences(int numThreads) {
+  pthread_t callers[NUM_CALLERS];
+  omThreadPoolSetNumThreads(numThreads);
+  for (int i = 0; i < NUM_CALLERS; ++i)
+    assert(pthread_create(&callers[i], NULL, callerMain,
+               (void *)(intptr_t)(i + 1)) == 0);
+  for (int i = 0; i < NUM_CALLERS; ++i)
+    pthread_join(callers[i], NULL);
+}
+
+int main() {
+  omAllocSetPooling(1);
+  testConcurrentInferences(1);
+  testConcurrentInferences(4);
+  omAllocRelease();
+  omArenaRelease();
+  return 0;
+}
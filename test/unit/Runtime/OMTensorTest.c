@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "OnnxMlirRuntime.h"
 
@@ -31,7 +33,93 @@ void testOMTensorCtor() {
   assert(strides_ptr[1] == 1);
 }
 
+void testOMTensorOwning() {
+  float data[4] = {1.f, 1.f};
+  int64_t shape[2] = {2, 2};
+  OMTensor *tensor = omTensorCreate(data, shape, 2, ONNX_TYPE_FLOAT);
+  assert(tensor);
+  assert(!omTensorGetOwning(tensor));
+
+  omTensorSetOwning(tensor, 1);
+  assert(omTensorGetOwning(tensor));
+  // The data is on the stack, do not free it.
+  omTensorSetOwning(tensor, 0);
+  omTensorDestroy(tensor);
+}
+
+void testOMTensorAligned() {
+  int64_t shape[2] = {3, 5};
+  int64_t alignments[3] = {1, 64, 4096};
+  for (int i = 0; i < 3; i++) {
+    OMTensor *tensor =
+        omTensorCreateEmptyAligned(shape, 2, ONNX_TYPE_FLOAT, alignments[i]);
+    assert(tensor);
+    assert(omTensorGetOwning(tensor));
+    assert((uintptr_t)omTensorGetDataPtr(tensor) % alignments[i] == 0);
+    assert(omTensorGetStrides(tensor)[0] == 5);
+    // The whole buffer is writable.
+    memset(omTensorGetDataPtr(tensor), 0, omTensorGetBufferSize(tensor));
+    omTensorDestroy(tensor);
+  }
+  assert(!omTensorCreateEmptyAligned(shape, 2, ONNX_TYPE_FLOAT, 48));
+}
+
+void testOMTensorCapacity() {
+  int64_t shape[4] = {1, 2, 3, 4};
+  OMTensor *tensor =
+      omTensorCreateWithCapacity(shape, 4, ONNX_TYPE_FLOAT, 2, 16);
+  assert(tensor);
+  assert(omTensorGetOwning(tensor));
+  assert(omTensorGetShape(tensor)[2] == 3);
+  int64_t *strides = omTensorGetStrides(tensor);
+  assert(strides[0] == 128 && strides[1] == 64);
+  assert(strides[2] == 4 && strides[3] == 1);
+  assert(omTensorGetNumElems(tensor) == 24);
+  // The whole capacity is writable.
+  memset(omTensorGetDataPtr(tensor), 0, 128 * sizeof(float));
+  omTensorDestroy(tensor);
+  assert(!omTensorCreateWithCapacity(shape, 4, ONNX_TYPE_FLOAT, 2, 2));
+  assert(!omTensorCreateWithCapacity(shape, 4, ONNX_TYPE_FLOAT, 4, 16));
+}
+
+void testOMTensorContiguous() {
+  // A 2x3 view of the even columns of a 2x6 array.
+  float data[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  int64_t shape[2] = {2, 3};
+  int64_t strides[2] = {6, 2};
+  OMTensor *tensor = omTensorCreate(data, shape, 2, ONNX_TYPE_FLOAT);
+  assert(tensor);
+  assert(omTensorIsContiguous(tensor));
+  assert(omTensorGetContiguous(tensor) == tensor);
+  omTensorSetStrides(tensor, strides);
+  assert(!omTensorIsContiguous(tensor));
+  OMTensor *contiguous = omTensorGetContiguous(tensor);
+  assert(contiguous && contiguous != tensor);
+  assert(omTensorIsContiguous(contiguous));
+  float *copy = (float *)omTensorGetDataPtr(contiguous);
+  for (int i = 0; i < 6; i++)
+    assert(copy[i] == 2 * i);
+  omTensorReleaseContiguous(contiguous, tensor);
+
+  omTensorDestroy(tensor);
+
+  // The first 2 rows of a 4x3 array, in reverse order.
+  int64_t reversedStrides[2] = {-3, 1};
+  tensor = omTensorCreate(data + 3, shape, 2, ONNX_TYPE_FLOAT);
+  omTensorSetStrides(tensor, reversedStrides);
+  assert(!omTensorIsContiguous(tensor));
+  contiguous = omTensorGetContiguous(tensor);
+  copy = (float *)omTensorGetDataPtr(contiguous);
+  assert(copy[0] == 3 && copy[2] == 5 && copy[3] == 0 && copy[5] == 2);
+  omTensorReleaseContiguous(contiguous, tensor);
+  omTensorDestroy(tensor);
+}
+
 int main() {
   testOMTensorCtor();
+  testOMTensorOwning();
+  testOMTensorAligned();
+  testOMTensorCapacity();
+  testOMTensorContiguous();
   return 0;
 }
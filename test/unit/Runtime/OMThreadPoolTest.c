@@ -0,0 +1,77 @@
+//===------------- OMThreadPoolTest.c - OMThreadPool Unit Test ------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the thread pool executing the parallel
+// loops of compiled models.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "OnnxMlirRuntime.h"
+
+#define NUM_ITERATIONS 1000
+
+static void fillBody(int64_t lb, int64_t ub, int64_t step, void *args) {
+  int *data = (int *)args;
+  for (int64_t i = lb; i < ub; i += step)
+    data[i] += 1;
+}
+
+static void nestedBody(int64_t lb, int64_t ub, int64_t step, void *args) {
+  int *data = (int *)args;
+  for (int64_t i = lb; i < ub; i += step)
+    omThreadPoolParallelFor(0, 10, 1, fillBody, data + i * 10);
+}
+
+static void checkFilled(int *data, int64_t size, int64_t step) {
+  for (int64_t i = 0; i < size; ++i)
+    assert(data[i] == (i % step == 0 ? 1 : 0));
+}
+
+void testParallelFor(int numThreads, int64_t step) {
+  int data[NUM_ITERATIONS] = {0};
+  omThreadPoolSetNumThreads(numThreads);
+  assert(omThreadPoolGetNumThreads() == numThreads);
+  omThreadPoolParallelFor(0, NUM_ITERATIONS, step, fillBody, data);
+  checkFilled(data, NUM_ITERATIONS, step);
+}
+
+void testEmptyLoop() {
+  int data[1] = {0};
+  omThreadPoolParallelFor(5, 5, 1, fillBody, data);
+  assert(data[0] == 0);
+}
+
+void testNestedParallelFor() {
+  int data[NUM_ITERATIONS] = {0};
+  omThreadPoolSetNumThreads(4);
+  omThreadPoolParallelFor(0, NUM_ITERATIONS / 10, 1, nestedBody, data);
+  checkFilled(data, NUM_ITERATIONS, 1);
+}
+
+void testAffinity() {
+  int cpus[1] = {0};
+  int status = omThreadPoolSetAffinity(cpus, 1);
+  assert(status == 0 || status == -1);
+  testParallelFor(2, 1);
+  /* A NULL list clears the affinity whatever the number of CPUs. */
+  assert(omThreadPoolSetAffinity(NULL, 4) == status);
+  omThreadPoolSetAffinity(NULL, 0);
+}
+
+int main() {
+  testParallelFor(1, 1);
+  testParallelFor(4, 1);
+  testParallelFor(3, 7);
+  testEmptyLoop();
+  testNestedParallelFor();
+  testAffinity();
+  omThreadPoolSetNumThreads(0);
+  assert(omThreadPoolGetNumThreads() >= 1);
+  return 0;
+}
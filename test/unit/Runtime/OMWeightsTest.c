@@ -0,0 +1,68 @@
+//===--------------- OMWeightsTest.c - OMWeights Unit Test ----------------===//
+//
+// Copyright 2019-2020 The IBM Research Authors.
+//
+// =============================================================================
+//
+// This file contains unit tests of the mapping of the weights files of
+// compiled models.
+//
+//===----------------------------------------------------------------------===//
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "OnnxMlirRuntime.h"
+
+static const char *weightsPath = "OMWeightsTest.weights";
+
+void testLoad() {
+  float data[16];
+  for (int i = 0; i < 16; ++i)
+    data[i] = (float)i;
+  FILE *file = fopen(weightsPath, "wb");
+  assert(file);
+  assert(fwrite(data, sizeof(data), 1, file) == 1);
+  fclose(file);
+
+  void *weights = NULL;
+  assert(omWeightsLoad(&weights, weightsPath) == 0);
+  assert(weights);
+  /* Mappings are page aligned, hence aligned for the offsets of the file. */
+  assert((uintptr_t)weights % 64 == 0);
+  assert(memcmp(weights, data, sizeof(data)) == 0);
+
+  /* Weights already loaded are kept. */
+  void *loaded = weights;
+  assert(omWeightsLoad(&weights, "missing.weights") == 0);
+  assert(weights == loaded);
+  remove(weightsPath);
+}
+
+void testMissingFile() {
+  void *weights = NULL;
+  assert(omWeightsLoad(&weights, "missing.weights") == -1);
+  assert(!weights);
+  assert(omWeightsLoad(NULL, weightsPath) == -1);
+}
+
+void testPrefault() {
+  /* Unaligned data spanning several pages keeps its content. */
+  static char data[3 * 4096 + 100];
+  for (int i = 0; i < (int)sizeof(data); ++i)
+    data[i] = (char)i;
+  omWeightsPrefault(data + 10, sizeof(data) - 10);
+  for (int i = 0; i < (int)sizeof(data); ++i)
+    assert(data[i] == (char)i);
+  omWeightsPrefault(data, 1);
+  omWeightsPrefault(NULL, 100);
+  omWeightsPrefault(data, 0);
+}
+
+int main() {
+  testLoad();
+  testMissingFile();
+  testPrefault();
+  return 0;
+}
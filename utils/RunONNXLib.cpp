@@ -33,16 +33,29 @@ Usage: run-onnx-lib [options] model.so
   the results. A model is typically generated by lowering
   an ONNX model using a "onnx-mlir --EmitLib model.onnx"
   command. When the input model is not found as is, the
-  path to the local directory is also prepended.
+  path to the local directory is also prepended. The
+  latency of the iterations and the throughput are
+  reported at the end.
 
   Options:
     -e name | --entry-point name
          Name of the ONNX model entry point.
          Default is "run_main_graph".
+    -i file.pb | --input file.pb
+         Read the next input of the model from a TensorProto file
+         instead of using random values, once per input
     -n NUM | --iterations NUM
          Number of times to run the tests, default 1
+    -t NUM | --threads NUM
+         Number of threads running the iterations concurrently,
+         each with its own inputs, default 1
     -v | --verbose
          Print the shape of the inputs and outputs
+    -w | --warmup
+         Bind all the symbols of the model when it is loaded and warm it
+         up with omModelWarmup before the first iteration
+    -W NUM | --warmup-iterations NUM
+         Number of iterations run before the timed ones, default 0
     -h | --help
          help
 */
@@ -52,11 +65,22 @@ Usage: run-onnx-lib [options] model.so
 // Define while compiling.
 // #define LOAD_MODEL_STATICALLY 1
 
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <condition_variable>
 #include <dlfcn.h>
+#include <fstream>
 #include <getopt.h>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <math.h>
+#include <mutex>
+#include <string.h>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Json reader
 #include "llvm/Support/JSON.h"
@@ -69,6 +93,7 @@ using namespace std;
 extern "C" OMTensorList *run_main_graph(OMTensorList *);
 extern "C" const char *omInputSignature();
 extern "C" const char *omOutputSignature();
+extern "C" void omModelWarmup();
 extern "C" OMTensor *omTensorCreate(void *, int64_t *, int64_t, OM_DATA_TYPE);
 extern "C" OMTensorList *TensorListCreate(OMTensor **, int);
 extern "C" void omTensorListDestroy(OMTensorList *list);
@@ -76,6 +101,7 @@ extern "C" void omTensorListDestroy(OMTensorList *list);
 OMTensorList *(*dll_run_main_graph)(OMTensorList *);
 const char *(*dll_omInputSignature)();
 const char *(*dll_omOutputSignature)();
+void (*dll_omModelWarmup)();
 OMTensor *(*dll_omTensorCreate)(void *, int64_t *, int64_t, OM_DATA_TYPE);
 OMTensorList *(*dll_omTensorListCreate)(OMTensor **, int);
 void (*dll_omTensorListDestroy)(OMTensorList *);
@@ -84,22 +110,28 @@ void (*dll_omTensorListDestroy)(OMTensorList *);
 #define RUN_MAIN_GRAPH run_main_graph
 #define OM_INPUT_SIGNATURE omInputSignature
 #define OM_OUTPUT_SIGNATURE omOutputSignature
+#define OM_MODEL_WARMUP omModelWarmup
 #define OM_TENSOR_CREATE omTensorCreate
 #define OM_TENSOR_LIST_CREATE omTensorListCreate
 #define OM_TENSOR_LIST_DESTROY omTensorListDestroy
-#define OPTIONS "hn:v"
+#define OPTIONS "hi:n:t:vwW:"
 #else
 #define RUN_MAIN_GRAPH dll_run_main_graph
 #define OM_INPUT_SIGNATURE dll_omInputSignature
 #define OM_OUTPUT_SIGNATURE dll_omOutputSignature
+#define OM_MODEL_WARMUP dll_omModelWarmup
 #define OM_TENSOR_CREATE dll_omTensorCreate
 #define OM_TENSOR_LIST_CREATE dll_omTensorListCreate
 #define OM_TENSOR_LIST_DESTROY dll_omTensorListDestroy
-#define OPTIONS "e:hn:v"
+#define OPTIONS "e:hi:n:t:vwW:"
 #endif
 
 static int sIterations = 1;
+static int sWarmupIterations = 0;
+static int sThreads = 1;
 static bool verbose = false;
+static bool warmup = false;
+static vector<string> sInputFiles;
 
 void usage(const char *name) {
 #if LOAD_MODEL_STATICALLY
@@ -113,7 +145,9 @@ void usage(const char *name) {
   cout << "  the results. A model is typically generated by lowering" << endl;
   cout << "  an ONNX model using a \"onnx-mlir --EmitLib model.onnx\"" << endl;
   cout << "  command. When the input model is not found as is, the" << endl;
-  cout << "  path to the local directory is also prepended." << endl;
+  cout << "  path to the local directory is also prepended. The" << endl;
+  cout << "  latency of the iterations and the throughput are" << endl;
+  cout << "  reported at the end." << endl;
   cout << endl;
   cout << "  Options:" << endl;
 #if !LOAD_MODEL_STATICALLY
@@ -121,10 +155,26 @@ void usage(const char *name) {
   cout << "         Name of the ONNX model entry point." << endl;
   cout << "         Default is \"run_main_graph\"." << endl;
 #endif
+  cout << "    -i file.pb | --input file.pb" << endl;
+  cout << "         Read the next input of the model from a TensorProto file"
+       << endl;
+  cout << "         instead of using random values, once per input" << endl;
   cout << "    -n NUM | --iterations NUM" << endl;
   cout << "         Number of times to run the tests, default 1" << endl;
+  cout << "    -t NUM | --threads NUM" << endl;
+  cout << "         Number of threads running the iterations concurrently,"
+       << endl;
+  cout << "         each with its own inputs, default 1" << endl;
   cout << "    -v | --verbose" << endl;
   cout << "         Print the shape of the inputs and outputs" << endl;
+  cout << "    -w | --warmup" << endl;
+  cout << "         Bind all the symbols of the model when it is loaded and"
+       << endl;
+  cout << "         warm it up with omModelWarmup before the first iteration"
+       << endl;
+  cout << "    -W NUM | --warmup-iterations NUM" << endl;
+  cout << "         Number of iterations run before the timed ones, default 0"
+       << endl;
   cout << "    -h | --help" << endl;
   cout << "         help" << endl;
   cout << endl;
@@ -133,12 +183,14 @@ void usage(const char *name) {
 void loadDLL(string name, string entryPointName) {
   cout << "Load model file " << name << " with entry point " << entryPointName
        << endl;
-  void *handle = dlopen(name.c_str(), RTLD_LAZY);
+  // Lazy binding defers the symbol resolutions to the first iteration.
+  int mode = warmup ? RTLD_NOW : RTLD_LAZY;
+  void *handle = dlopen(name.c_str(), mode);
   if (!handle) {
     string qualifiedName = "./" + name;
     cout << "  Did not find model, try in current dir " << qualifiedName
          << endl;
-    handle = dlopen(qualifiedName.c_str(), RTLD_LAZY);
+    handle = dlopen(qualifiedName.c_str(), mode);
   }
   assert(handle && "Error loading the model's dll file; you may have provide a "
                    "fully qualified path");
@@ -149,6 +201,10 @@ void loadDLL(string name, string entryPointName) {
   assert(!dlerror() && "failed to load omInputSignature");
   dll_omOutputSignature = (const char *(*)())dlsym(handle, "omOutputSignature");
   assert(!dlerror() && "failed to load omOutputSignature");
+  if (warmup) {
+    dll_omModelWarmup = (void (*)())dlsym(handle, "omModelWarmup");
+    assert(!dlerror() && "failed to load omModelWarmup");
+  }
   dll_omTensorCreate =
       (OMTensor * (*)(void *, int64_t *, int64_t, OM_DATA_TYPE))
           dlsym(handle, "omTensorCreate");
@@ -166,8 +222,11 @@ void parseArgs(int argc, char **argv) {
   string entryPointName("run_main_graph");
   static struct option long_options[] = {
       {"entry-point", required_argument, 0, 'e'}, {"help", no_argument, 0, 'h'},
+      {"input", required_argument, 0, 'i'},
       {"iterations", required_argument, 0, 'n'},
-      {"verbose", no_argument, 0, 'v'}, {0, 0, 0, 0}};
+      {"threads", required_argument, 0, 't'},
+      {"verbose", no_argument, 0, 'v'}, {"warmup", no_argument, 0, 'w'},
+      {"warmup-iterations", required_argument, 0, 'W'}, {0, 0, 0, 0}};
 
   while (true) {
     int index = 0;
@@ -180,12 +239,28 @@ void parseArgs(int argc, char **argv) {
     case 'e':
       entryPointName = optarg;
       break;
+    case 'i':
+      sInputFiles.emplace_back(optarg);
+      break;
     case 'n':
       sIterations = atoi(optarg);
       break;
+    case 't':
+      sThreads = atoi(optarg);
+      if (sThreads < 1) {
+        cout << "error: need at least one thread" << endl;
+        exit(1);
+      }
+      break;
     case 'v':
       verbose = true;
       break;
+    case 'w':
+      warmup = true;
+      break;
+    case 'W':
+      sWarmupIterations = atoi(optarg);
+      break;
     default:
       usage(argv[0]);
       exit(1);
@@ -215,6 +290,218 @@ void parseArgs(int argc, char **argv) {
 #endif
 }
 
+//===----------------------------------------------------------------------===//
+// Reading of the inputs from TensorProto files.
+//===----------------------------------------------------------------------===//
+
+// An input read from a TensorProto file, whose data is shared by the inputs
+// of all the threads.
+struct InputData {
+  vector<int64_t> shape;
+  int dataType = 0;
+  vector<char> data;
+};
+static vector<InputData> sInputData;
+
+static int64_t getDataTypeSize(int dataType) {
+  switch (dataType) {
+#define OM_TYPE_METADATA_DEF(ENUM_NAME, ENUM_VAL, DTYPE_SIZE)                  \
+  case ENUM_VAL:                                                               \
+    return DTYPE_SIZE;
+#include "onnx-mlir/Runtime/OnnxDataTypeMetaData.inc"
+#undef OM_TYPE_METADATA_DEF
+  }
+  return 0;
+}
+
+// Name of the ONNX data type in the model signatures, empty when a signature
+// does not name it.
+static string getSignatureTypeName(int dataType) {
+  switch (dataType) {
+  case ONNX_TYPE_FLOAT:
+    return "float";
+  case ONNX_TYPE_DOUBLE:
+    return "double";
+  case ONNX_TYPE_INT16:
+    return "short";
+  case ONNX_TYPE_INT32:
+    return "integer";
+  case ONNX_TYPE_INT64:
+    return "long";
+  }
+  return "";
+}
+
+// Protobuf wire format, see
+// https://developers.google.com/protocol-buffers/docs/encoding
+class ProtoReader {
+public:
+  ProtoReader(const char *begin, const char *end) : ptr(begin), end(end) {}
+
+  bool done() const { return ptr >= end; }
+
+  bool readVarint(uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && ptr < end; shift += 7) {
+      uint8_t byte = *ptr++;
+      value |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool readFixed(void *value, size_t size) {
+    if ((size_t)(end - ptr) < size)
+      return false;
+    // Protobuf is little endian, as the hosts the models run on.
+    memcpy(value, ptr, size);
+    ptr += size;
+    return true;
+  }
+
+  // Read a length delimited field into a reader of its bytes.
+  bool readBytes(ProtoReader &bytes) {
+    uint64_t length;
+    if (!readVarint(length) || length > (uint64_t)(end - ptr))
+      return false;
+    bytes = ProtoReader(ptr, ptr + length);
+    ptr += length;
+    return true;
+  }
+
+  bool skip(int wireType) {
+    uint64_t value;
+    ProtoReader bytes(nullptr, nullptr);
+    switch (wireType) {
+    case 0:
+      return readVarint(value);
+    case 1:
+      return readFixed(&value, 8);
+    case 2:
+      return readBytes(bytes);
+    case 5:
+      return readFixed(&value, 4);
+    }
+    return false;
+  }
+
+  const char *ptr;
+  const char *end;
+};
+
+// Read the values of a repeated field, which are packed or not, appending
+// each to values with a size of eltSize bytes. Varints are truncated to
+// eltSize bytes, e.g. the int32_data of the int8 or float16 tensors.
+static bool readRepeated(ProtoReader &reader, int wireType, int valueType,
+    size_t eltSize, vector<char> &values) {
+  auto readValue = [&](ProtoReader &r) {
+    uint64_t value = 0;
+    bool ok = valueType == 0 ? r.readVarint(value)
+                             : r.readFixed(&value, valueType == 1 ? 8 : 4);
+    const char *bytes = (const char *)&value;
+    values.insert(values.end(), bytes, bytes + eltSize);
+    return ok;
+  };
+  if (wireType != 2)
+    return wireType == valueType && readValue(reader);
+  ProtoReader packed(nullptr, nullptr);
+  if (!reader.readBytes(packed))
+    return false;
+  while (!packed.done())
+    if (!readValue(packed))
+      return false;
+  return true;
+}
+
+// Read a TensorProto, see onnx.proto. Only the tensors with their data in the
+// file are supported.
+static bool readTensorProto(const string &fileName, InputData &input) {
+  ifstream file(fileName, ios::binary);
+  if (!file)
+    return false;
+  vector<char> buffer(
+      (istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  ProtoReader reader(buffer.data(), buffer.data() + buffer.size());
+  vector<char> rawData, fieldData;
+  // The typed fields are read into 8 byte values, converted below once the
+  // data type is known.
+  int valueType = -1;
+  while (!reader.done()) {
+    uint64_t key;
+    if (!reader.readVarint(key))
+      return false;
+    int field = key >> 3, wireType = key & 7;
+    bool ok = true;
+    ProtoReader bytes(nullptr, nullptr);
+    uint64_t value;
+    switch (field) {
+    case 1: // dims
+      fieldData.clear();
+      ok = readRepeated(reader, wireType, 0, 8, fieldData);
+      for (size_t i = 0; ok && i < fieldData.size(); i += 8) {
+        int64_t dim;
+        memcpy(&dim, &fieldData[i], 8);
+        input.shape.emplace_back(dim);
+      }
+      fieldData.clear();
+      break;
+    case 2: // data_type
+      ok = wireType == 0 && reader.readVarint(value);
+      input.dataType = (int)value;
+      break;
+    case 4:  // float_data
+    case 5:  // int32_data
+    case 7:  // int64_data
+    case 10: // double_data
+    case 11: // uint64_data
+      valueType = field == 4 ? 5 : field == 10 ? 1 : 0;
+      ok = readRepeated(reader, wireType, valueType, 8, fieldData);
+      break;
+    case 9: // raw_data
+      ok = wireType == 2 && reader.readBytes(bytes);
+      if (ok)
+        rawData.assign(bytes.ptr, bytes.end);
+      break;
+    case 14: // data_location
+      ok = wireType == 0 && reader.readVarint(value) && value == 0;
+      break;
+    default:
+      ok = reader.skip(wireType);
+    }
+    if (!ok)
+      return false;
+  }
+
+  int64_t eltSize = getDataTypeSize(input.dataType);
+  if (eltSize == 0)
+    return false;
+  int64_t numElements = 1;
+  for (int64_t dim : input.shape)
+    numElements *= dim;
+  if (!rawData.empty()) {
+    input.data = move(rawData);
+  } else {
+    // Narrow the 8 byte values to the element size; floats are stored in
+    // their 4 bytes and doubles in their 8 bytes.
+    input.data.resize(fieldData.size() / 8 * eltSize);
+    for (size_t i = 0; i < fieldData.size() / 8; ++i)
+      memcpy(&input.data[i * eltSize], &fieldData[i * 8], eltSize);
+  }
+  return (int64_t)input.data.size() == numElements * eltSize;
+}
+
+static void readInputFiles() {
+  for (const string &fileName : sInputFiles) {
+    InputData input;
+    if (!readTensorProto(fileName, input)) {
+      cout << "error: cannot read a tensor from " << fileName << endl;
+      exit(1);
+    }
+    sInputData.emplace_back(move(input));
+  }
+}
+
 /**
  * \brief Create and initialize an OMTensorList from the signature of a model
  *
@@ -275,6 +562,11 @@ OMTensorList *omTensorListCreateFromInputSignature(
       // size_t dim = JSONDimItem->getInteger();
       auto JSONDimValue = (*JSONDimArray)[d].getAsInteger();
       assert(JSONDimValue && "failed to get value");
+      if (JSONDimValue.getValue() < 0) {
+        cout << "error: input " << i << " has dynamic dimensions, give its "
+             << "values with --input" << endl;
+        exit(1);
+      }
       size_t dim = JSONDimValue.getValue();
       shape[d] = dim;
       size *= dim;
@@ -288,6 +580,8 @@ OMTensorList *omTensorListCreateFromInputSignature(
       } else if (dataAlloc) {
         data = new float[size];
         assert(data && "failed to allocate data");
+        for (size_t e = 0; e < size; ++e)
+          data[e] = (float)rand() / RAND_MAX;
       }
       tensor = OM_TENSOR_CREATE(data, shape, rank, ONNX_TYPE_FLOAT);
     }
@@ -304,26 +598,194 @@ OMTensorList *omTensorListCreateFromInputSignature(
   return OM_TENSOR_LIST_CREATE(inputTensors, inputNum);
 }
 
-int main(int argc, char **argv) {
-  // Init args.
-  parseArgs(argc, argv);
-  // Init inputs.
-  OMTensorList *tensorListIn =
-      omTensorListCreateFromInputSignature(nullptr, true, verbose);
-  assert(tensorListIn && "failed to scan signature");
-  // Call the compiled onnx model function.
-  cout << "Start computing " << sIterations << " iterations" << endl;
+/**
+ * \brief Create an OMTensorList from the inputs read from TensorProto files
+ *
+ * The inputs are checked against the signature of the model, their dynamic
+ * dimensions being given by the files. The tensors do not own their data,
+ * which is shared by the lists created by every thread.
+ *
+ * @param trace If true, provide a printout of the inputs.
+ * @return pointer to the TensorList just created.
+ */
+OMTensorList *omTensorListCreateFromInputData(bool trace) {
+  const char *sigIn = OM_INPUT_SIGNATURE();
+  auto JSONInput = llvm::json::parse(sigIn ? sigIn : "[]");
+  assert(JSONInput && "failed to parse json");
+  auto JSONArray = JSONInput->getAsArray();
+  assert(JSONArray && "failed to parse json as array");
+  if (JSONArray->size() != sInputData.size()) {
+    cout << "error: the model has " << JSONArray->size() << " inputs, "
+         << sInputData.size() << " input files given" << endl;
+    exit(1);
+  }
+
+  int inputNum = sInputData.size();
+  OMTensor **inputTensors = nullptr;
+  if (inputNum > 0)
+    inputTensors = (OMTensor **)malloc(inputNum * sizeof(OMTensor *));
+  for (int i = 0; i < inputNum; ++i) {
+    InputData &input = sInputData[i];
+    auto JSONItem = (*JSONArray)[i].getAsObject();
+    auto JSONItemType = JSONItem->getString("type");
+    assert(JSONItemType && "failed to get type");
+    auto JSONDimArray = JSONItem->getArray("dims");
+    // The signatures name some types only.
+    string typeName = getSignatureTypeName(input.dataType);
+    bool matches = JSONDimArray->size() == input.shape.size() &&
+                   (typeName.empty() || JSONItemType->equals(typeName));
+    for (size_t d = 0; matches && d < input.shape.size(); ++d) {
+      auto JSONDimValue = (*JSONDimArray)[d].getAsInteger();
+      assert(JSONDimValue && "failed to get value");
+      int64_t dim = JSONDimValue.getValue();
+      matches = dim < 0 || dim == input.shape[d];
+    }
+    if (!matches) {
+      cout << "error: " << sInputFiles[i]
+           << " does not match the signature of input " << i << endl;
+      exit(1);
+    }
+    inputTensors[i] = OM_TENSOR_CREATE(input.data.data(), input.shape.data(),
+        input.shape.size(), (OM_DATA_TYPE)input.dataType);
+    assert(inputTensors[i] && "failed to create tensor");
+    if (trace) {
+      cout << "Input " << i << ": tensor of " << JSONItemType->str()
+           << " with shape ";
+      for (int64_t dim : input.shape)
+        cout << dim << " ";
+      cout << "read from " << sInputFiles[i] << endl;
+    }
+  }
+  return OM_TENSOR_LIST_CREATE(inputTensors, inputNum);
+}
+
+//===----------------------------------------------------------------------===//
+// Timing of the iterations.
+//===----------------------------------------------------------------------===//
+
+using Clock = chrono::steady_clock;
+
+// Timings of the iterations run by one thread.
+struct ThreadTimings {
+  vector<double> latencies; // in milliseconds
+  Clock::time_point start;
+  Clock::time_point stop;
+};
+
+// Barrier making the threads start their timed iterations together, once
+// they are all warmed up.
+static mutex sBarrierMutex;
+static condition_variable sBarrierCondition;
+static int sThreadsWaiting = 0;
+
+static void waitForAllThreads() {
+  unique_lock<mutex> lock(sBarrierMutex);
+  if (++sThreadsWaiting == sThreads) {
+    sBarrierCondition.notify_all();
+    return;
+  }
+  sBarrierCondition.wait(lock, [] { return sThreadsWaiting == sThreads; });
+}
+
+static void runIterations(
+    OMTensorList *tensorListIn, ThreadTimings &timings, bool progress) {
+  for (int i = 0; i < sWarmupIterations; ++i) {
+    OMTensorList *tensorListOut = RUN_MAIN_GRAPH(tensorListIn);
+    if (tensorListOut)
+      OM_TENSOR_LIST_DESTROY(tensorListOut);
+  }
+  waitForAllThreads();
+
+  timings.latencies.reserve(sIterations);
+  timings.start = Clock::now();
   for (int i = 0; i < sIterations; ++i) {
-    OMTensorList *tensorListOut = nullptr;
-    tensorListOut = RUN_MAIN_GRAPH(tensorListIn);
+    Clock::time_point start = Clock::now();
+    OMTensorList *tensorListOut = RUN_MAIN_GRAPH(tensorListIn);
+    Clock::time_point stop = Clock::now();
+    timings.latencies.emplace_back(
+        chrono::duration<double, milli>(stop - start).count());
     if (tensorListOut)
       OM_TENSOR_LIST_DESTROY(tensorListOut);
-    if (i > 0 && i % 10 == 0)
+    if (progress && i > 0 && i % 10 == 0)
       cout << "  computed " << i << " iterations" << endl;
   }
+  timings.stop = Clock::now();
+}
+
+// Latency of the given percentile, by the nearest-rank method.
+static double getPercentile(const vector<double> &sorted, double percentile) {
+  size_t rank = (size_t)ceil(percentile / 100 * sorted.size());
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void reportTimings(const vector<ThreadTimings> &timings) {
+  vector<double> latencies;
+  Clock::time_point start = timings[0].start, stop = timings[0].stop;
+  for (const ThreadTimings &thread : timings) {
+    latencies.insert(
+        latencies.end(), thread.latencies.begin(), thread.latencies.end());
+    start = min(start, thread.start);
+    stop = max(stop, thread.stop);
+  }
+  if (latencies.empty())
+    return;
+  sort(latencies.begin(), latencies.end());
+  double total = 0;
+  for (double latency : latencies)
+    total += latency;
+  double seconds = chrono::duration<double>(stop - start).count();
+
+  cout << fixed << setprecision(3);
+  cout << "Latency of " << latencies.size() << " iterations on " << sThreads
+       << (sThreads > 1 ? " threads" : " thread") << " (ms):" << endl;
+  cout << "  mean " << total / latencies.size() << ", p50 "
+       << getPercentile(latencies, 50) << ", p90 "
+       << getPercentile(latencies, 90) << ", p99 "
+       << getPercentile(latencies, 99) << ", max " << latencies.back()
+       << endl;
+  if (seconds > 0)
+    cout << "Throughput: " << latencies.size() / seconds << " inferences/s"
+         << endl;
+}
+
+int main(int argc, char **argv) {
+  // Init args.
+  parseArgs(argc, argv);
+  readInputFiles();
+  // Init inputs, one list per thread.
+  vector<OMTensorList *> tensorListsIn;
+  for (int t = 0; t < sThreads; ++t) {
+    bool trace = verbose && t == 0;
+    OMTensorList *tensorListIn =
+        sInputFiles.empty()
+            ? omTensorListCreateFromInputSignature(nullptr, true, trace)
+            : omTensorListCreateFromInputData(trace);
+    assert(tensorListIn && "failed to scan signature");
+    tensorListsIn.emplace_back(tensorListIn);
+  }
+  if (warmup)
+    OM_MODEL_WARMUP();
+  // Call the compiled onnx model function.
+  cout << "Start computing " << sIterations << " iterations";
+  if (sThreads > 1)
+    cout << " on each of " << sThreads << " threads";
+  cout << endl;
+  vector<ThreadTimings> timings(sThreads);
+  if (sThreads == 1) {
+    runIterations(tensorListsIn[0], timings[0], /*progress=*/true);
+  } else {
+    vector<thread> threads;
+    for (int t = 0; t < sThreads; ++t)
+      threads.emplace_back(runIterations, tensorListsIn[t], ref(timings[t]),
+          /*progress=*/false);
+    for (thread &t : threads)
+      t.join();
+  }
   cout << "Finish computing " << sIterations << " iterations" << endl;
+  reportTimings(timings);
 
   // Cleanup.
-  OM_TENSOR_LIST_DESTROY(tensorListIn);
+  for (OMTensorList *tensorListIn : tensorListsIn)
+    OM_TENSOR_LIST_DESTROY(tensorListIn);
   return 0;
 }
@@ -0,0 +1,323 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+##################### autotune-matmul.py #######################################
+#
+# Offline autotuning of the matrix multiplies of a model.
+#
+# The tile sizes of the matrix multiplies of Gemm and MatMul, and whether their
+# register tiles are simdized and unrolled, are fixed when onnx-mlir compiles a
+# model (see --matmulTileSizes). This script finds, for each distinct shape of
+# the matrix multiplies of a model, the configuration running fastest on this
+# host: a model made of a single matrix multiply of this shape is compiled for
+# each candidate configuration and timed. The best configurations are written
+# to a tuning database, which later compilations read with
+#
+#   onnx-mlir --matmulTuningDatabase=matmul-tuning.json model.onnx
+#
+# The candidates are searched in stages, from the default configuration: the
+# cache tiles first, then the register tiles, then simdization and unrolling.
+# Running the script again adds the shapes of other models to the database.
+#
+################################################################################
+
+import argparse
+import concurrent.futures
+import itertools
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+import numpy as np
+import onnx
+from onnx import helper, numpy_helper, shape_inference, TensorProto
+
+if (not os.environ.get('ONNX_MLIR_HOME', None)):
+    raise RuntimeError(
+        "Environment variable ONNX_MLIR_HOME is not set, please set it to the path to "
+        "the HOME directory for onnx-mlir. The HOME directory for onnx-mlir refers to "
+        "the parent folder containing the bin, lib, etc sub-folders in which ONNX-MLIR "
+        "executables and libraries can be found.")
+
+ONNX_MLIR_EXENAME = "onnx-mlir"
+if sys.platform == "win32":
+    ONNX_MLIR_EXENAME = "onnx-mlir.exe"
+
+ONNX_MLIR = os.path.join(os.environ['ONNX_MLIR_HOME'], "bin", ONNX_MLIR_EXENAME)
+
+# Include runtime directory in python paths, so PyRuntime can be imported.
+RUNTIME_DIR = os.path.join(os.environ['ONNX_MLIR_HOME'], "lib")
+sys.path.append(RUNTIME_DIR)
+
+try:
+    from PyRuntime import ExecutionSession
+except ImportError:
+    raise ImportError(
+        "Looks like you did not build the PyRuntime target, build it by running `make PyRuntime`."
+    )
+
+# Default configuration of the lowering, see MatMulTileSizes.
+DEFAULT_CONFIG = {"tile_sizes": [64, 128, 512, 4, 8],
+                  "simdize": True, "unroll": True}
+
+# Candidates of each stage of the search.
+CACHE_TILES = {"i": [32, 64, 128, 256], "j": [64, 128, 256],
+               "k": [128, 256, 512, 1024]}
+REGISTER_TILES = {"i": [2, 4, 6, 8], "j": [8, 16, 32]}
+
+parser = argparse.ArgumentParser(
+    description='autotune the matrix multiplies of a model for this host.')
+parser.add_argument('model', type=str, help='onnx model to tune')
+parser.add_argument('--database', type=str, default='matmul-tuning.json',
+    help='tuning database to update (default: matmul-tuning.json)')
+parser.add_argument('--mcpu', type=str, default='',
+    help='target a specific cpu, passed to the compiler')
+parser.add_argument('--iterations', type=int, default=20,
+    help='number of timed runs of each candidate (default: 20)')
+parser.add_argument('--warmup', type=int, default=3,
+    help='number of runs of each candidate before the timed ones (default: 3)')
+parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+    help='number of candidates compiled at once (default: number of cpus)')
+parser.add_argument('-v', '--verbose', action='store_true',
+    help='print the time of each candidate')
+args = parser.parse_args()
+
+
+class MatMulShape:
+    """Shape of an [I, K] x [K, J] matrix multiply, with the op computing it
+    and whether its B matrix is a constant, which changes its lowering."""
+
+    def __init__(self, i, j, k, op_type, constant_b):
+        self.i, self.j, self.k = i, j, k
+        self.op_type = op_type
+        self.constant_b = constant_b
+
+    def key(self):
+        return (self.i, self.j, self.k)
+
+    def __str__(self):
+        return "%s %dx%dx%d" % (self.op_type, self.i, self.j, self.k)
+
+
+def get_static_shape(value_infos, name):
+    if name not in value_infos:
+        return None
+    dims = value_infos[name].type.tensor_type.shape.dim
+    if not dims or any(not dim.HasField("dim_value") for dim in dims):
+        return None
+    return [dim.dim_value for dim in dims]
+
+
+def get_matmul_shapes(model_path):
+    """Return the distinct shapes of the f32 Gemm and MatMul of the model
+    whose sizes are known at compile time, by decreasing number of flops."""
+    model = shape_inference.infer_shapes(onnx.load(model_path))
+    graph = model.graph
+    value_infos = {}
+    for value_info in itertools.chain(
+            graph.input, graph.value_info, graph.output):
+        value_infos[value_info.name] = value_info
+    initializers = {tensor.name: tensor for tensor in graph.initializer}
+    for tensor in graph.initializer:
+        if tensor.name not in value_infos:
+            value_infos[tensor.name] = helper.make_tensor_value_info(
+                tensor.name, tensor.data_type, list(tensor.dims))
+
+    shapes = {}
+    for node in graph.node:
+        if node.op_type not in ("Gemm", "MatMul"):
+            continue
+        a = get_static_shape(value_infos, node.input[0])
+        b = get_static_shape(value_infos, node.input[1])
+        if a is None or b is None or len(a) < 2 or len(b) < 2:
+            continue
+        elem_type = value_infos[node.input[0]].type.tensor_type.elem_type
+        if elem_type != TensorProto.FLOAT:
+            continue
+        attrs = {attr.name: helper.get_attribute_value(attr)
+                 for attr in node.attribute}
+        if node.op_type == "Gemm" and attrs.get("transA", 0):
+            a = [a[1], a[0]]
+        if node.op_type == "Gemm" and attrs.get("transB", 0):
+            b = [b[1], b[0]]
+        shape = MatMulShape(a[-2], b[-1], a[-1], node.op_type,
+            node.input[1] in initializers)
+        shapes.setdefault(shape.key(), shape)
+    return sorted(shapes.values(), key=lambda s: -s.i * s.j * s.k)
+
+
+def build_matmul_model(shape, path):
+    """A model made of a single matrix multiply of the shape."""
+    rng = np.random.default_rng(0)
+    inputs = [helper.make_tensor_value_info(
+        "A", TensorProto.FLOAT, [shape.i, shape.k])]
+    initializers = []
+    if shape.constant_b:
+        data = rng.uniform(-1, 1, [shape.k, shape.j]).astype(np.float32)
+        initializers.append(numpy_helper.from_array(data, "B"))
+    else:
+        inputs.append(helper.make_tensor_value_info(
+            "B", TensorProto.FLOAT, [shape.k, shape.j]))
+    node = helper.make_node(shape.op_type, inputs=["A", "B"], outputs=["Y"])
+    graph = helper.make_graph([node], "matmul", inputs,
+        [helper.make_tensor_value_info(
+            "Y", TensorProto.FLOAT, [shape.i, shape.j])],
+        initializers)
+    onnx.save(helper.make_model(graph), path)
+    rng_inputs = [rng.uniform(-1, 1, [shape.i, shape.k]).astype(np.float32)]
+    if not shape.constant_b:
+        rng_inputs.append(
+            rng.uniform(-1, 1, [shape.k, shape.j]).astype(np.float32))
+    return rng_inputs
+
+
+def compile_candidate(shape, config, model_path, work_dir, index):
+    """Compile the model of the shape with the configuration, return the path
+    of its library or None if it failed."""
+    base = os.path.join(work_dir, "candidate_%d" % index)
+    database = base + ".json"
+    entry = dict(config, i=shape.i, j=shape.j, k=shape.k)
+    with open(database, "w") as database_file:
+        json.dump({"matmul": [entry]}, database_file)
+    # onnx-mlir writes the library next to its input.
+    candidate_model = base + ".onnx"
+    os.symlink(model_path, candidate_model)
+    command = [ONNX_MLIR, "--matmulTuningDatabase=" + database]
+    if args.mcpu:
+        command.append("--mcpu=" + args.mcpu)
+    command.append(candidate_model)
+    result = subprocess.run(command, stdout=subprocess.DEVNULL,
+        stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        if args.verbose:
+            print("    failed to compile %s:\n%s" % (
+                config, result.stderr.decode()))
+        return None
+    return base + ".so"
+
+
+def time_library(library, inputs):
+    """Return the median time of the runs of the library."""
+    session = ExecutionSession(library, "run_main_graph")
+    for _ in range(args.warmup):
+        session.run(inputs)
+    times = []
+    for _ in range(max(args.iterations, 1)):
+        start = time.perf_counter()
+        session.run(inputs)
+        times.append(time.perf_counter() - start)
+    times.sort()
+    return times[len(times) // 2]
+
+
+def is_relevant(config, shape):
+    """Whether the configuration may differ from smaller ones for the shape:
+    the tiles larger than a dimension are equivalent to each other."""
+    i_cache, j_cache, k_cache, i_reg, j_reg = config["tile_sizes"]
+    def fits_once(tile, dim, smaller):
+        return tile == smaller or tile // 2 < dim
+    return (i_reg <= i_cache and j_reg <= j_cache and
+            fits_once(i_cache, shape.i, min(CACHE_TILES["i"])) and
+            fits_once(j_cache, shape.j, min(CACHE_TILES["j"])) and
+            fits_once(k_cache, shape.k, min(CACHE_TILES["k"])))
+
+
+def evaluate(shape, configs, model_path, inputs, work_dir, counter):
+    """Compile the configurations at once, then time them one at a time.
+    Return the best configuration and its time."""
+    with concurrent.futures.ThreadPoolExecutor(args.jobs) as executor:
+        libraries = list(executor.map(
+            lambda c: compile_candidate(shape, c, model_path, work_dir,
+                next(counter)), configs))
+    best, best_seconds = None, float("inf")
+    for config, library in zip(configs, libraries):
+        if library is None:
+            continue
+        seconds = time_library(library, inputs)
+        if args.verbose:
+            print("    %s %s simdize=%s unroll=%s: %.3f ms" % (shape,
+                config["tile_sizes"], config["simdize"], config["unroll"],
+                seconds * 1e3))
+        if seconds < best_seconds:
+            best, best_seconds = config, seconds
+    return best, best_seconds
+
+
+def tune(shape, work_dir, counter):
+    """Return the best configuration found for the shape, with its time and
+    the time of the default configuration."""
+    model_path = os.path.join(work_dir, "matmul_%d_%d_%d.onnx" % shape.key())
+    inputs = build_matmul_model(shape, model_path)
+    best, default_seconds = evaluate(
+        shape, [DEFAULT_CONFIG], model_path, inputs, work_dir, counter)
+    if best is None:
+        return None, None, None
+    seconds = default_seconds
+
+    def with_sizes(config, **sizes):
+        tile_sizes = list(config["tile_sizes"])
+        for index, name in enumerate(["ic", "jc", "kc", "ir", "jr"]):
+            if name in sizes:
+                tile_sizes[index] = sizes[name]
+        return dict(config, tile_sizes=tile_sizes)
+
+    stages = [
+        lambda c: [with_sizes(c, ic=i, jc=j, kc=k) for i, j, k in
+            itertools.product(CACHE_TILES["i"], CACHE_TILES["j"],
+                CACHE_TILES["k"])],
+        lambda c: [with_sizes(c, ir=i, jr=j) for i, j in
+            itertools.product(REGISTER_TILES["i"], REGISTER_TILES["j"])],
+        lambda c: [dict(c, simdize=s, unroll=u) for s, u in
+            itertools.product([True, False], repeat=2)],
+    ]
+    for stage in stages:
+        configs = [c for c in stage(best) if is_relevant(c, shape)]
+        config, stage_seconds = evaluate(
+            shape, configs, model_path, inputs, work_dir, counter)
+        if config is not None and stage_seconds < seconds:
+            best, seconds = config, stage_seconds
+    return best, seconds, default_seconds
+
+
+def main():
+    shapes = get_matmul_shapes(args.model)
+    if not shapes:
+        print("No f32 Gemm or MatMul of static shape in " + args.model)
+        return 0
+
+    database = {"matmul": []}
+    if os.path.exists(args.database):
+        with open(args.database) as database_file:
+            database = json.load(database_file)
+    entries = {(e["i"], e["j"], e["k"]): e for e in database["matmul"]}
+
+    counter = itertools.count()
+    with tempfile.TemporaryDirectory() as work_dir:
+        for shape in shapes:
+            print(shape)
+            config, seconds, default_seconds = tune(shape, work_dir, counter)
+            if config is None:
+                print("  not tuned, the default configuration fails")
+                continue
+            print("  tile_sizes=%s simdize=%s unroll=%s: %.3f ms, "
+                "%.2fx the default" % (config["tile_sizes"],
+                config["simdize"], config["unroll"], seconds * 1e3,
+                default_seconds / seconds))
+            entries[shape.key()] = dict(config, i=shape.i, j=shape.j,
+                k=shape.k, seconds=seconds, default_seconds=default_seconds,
+                host=platform.node(), mcpu=args.mcpu)
+
+    database["matmul"] = [entries[key] for key in sorted(entries)]
+    with open(args.database, "w") as database_file:
+        json.dump(database, database_file, indent=2, sort_keys=True)
+        database_file.write("\n")
+    print("Tuning database written to " + args.database)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -292,6 +292,7 @@ OpsWithShapeInference=[
     'GlobalMaxPool',
     'HardSigmoid',
     'Identity',
+    'InstanceNormalization',
     'LSTM',
     'LeakyRelu',
     'Less',
@@ -347,7 +348,8 @@ OpsWithShapeInference=[
 # Operations supporting canonicalization.
 OpsWithCanonicalizer = ['Add', 'Constant', 'Identity', 'Gemm', 'Cast', 'Transpose',
                         'Dropout', 'Shape', 'Size', 'GlobalAveragePool',
-                        'GlobalMaxPool', 'Squeeze', 'Unsqueeze']
+                        'GlobalMaxPool', 'Squeeze', 'Unsqueeze', 'Conv',
+                        'MatMul', 'Mul', 'Div', 'Pow', 'Reshape']
 
 OpsWithHelpers = {
   "Loop": """
@@ -361,6 +363,16 @@ OpsWithHelpers = {
     mlir::Operation::result_range scan_outputs();
   """
 }
+
+# Ops whose cost, in FLOPs and bytes, is given by the CostModelOpInterface.
+# Their getFlops methods are implemented in ONNXOpsCostModel.cpp.
+OpsWithCostModel = [
+    'Abs', 'Add', 'AveragePool', 'Concat', 'Conv', 'Div', 'Erf', 'Exp', 'Gemm',
+    'GlobalAveragePool', 'LeakyRelu', 'Log', 'MatMul', 'Max', 'Min', 'Mul',
+    'Neg', 'Pow', 'ReduceMean', 'ReduceSum', 'Relu', 'Sigmoid', 'Softmax',
+    'Sqrt', 'Sub', 'Sum', 'Tanh', 'Transpose'
+]
+
 # Interface for special handling of type inference
 # The common code are put into get_type_inference_func
 OpsWithResultTypeInference = {
@@ -906,6 +918,8 @@ def gen_op_def(schema, with_version = False):
     # Dummy implementations are added to ONNXOps.cpp
     # Error will be report if these operations are encountered at runtime
     traits.append("DeclareOpInterfaceMethods<ShapeInferenceOpInterface>")
+    if schema.name in OpsWithCostModel:
+        traits.append("DeclareOpInterfaceMethods<CostModelOpInterface>")
     if schema.name in OpsWithResultTypeInference.keys():
         traits.append("OpInterface<\"ResultTypeInferenceOpInterface\">")
     if len(regions):